@@ -0,0 +1,183 @@
+#include "data/tileSource.h"
+#include "log.h"
+#include "map.h"
+#include "mockPlatform.h"
+#include "scene/importer.h"
+#include "scene/scene.h"
+#include "scene/sceneLoader.h"
+#include "text/fontContext.h"
+#include "tile/buildCost.h"
+#include "tile/tile.h"
+#include "tile/tileBuilder.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Builds tiles of a scene and prints the data layers and styles that took the
+// most time to build.
+//
+// Usage: buildCost.out [--runs N] [--top N] [scene.yaml] [z_x_y.mvt ...]
+//
+// The tile coordinates are taken from the file names, tiles are built with the
+// first source of the scene.
+
+using namespace Tangram;
+
+struct TileFile {
+    std::string path;
+    TileID id;
+};
+
+// Reads 'z_x_y' from the end of _path, e.g. test_tile_10_301_384.mvt
+static bool tileIdFromPath(const std::string& _path, TileID& _id) {
+    auto name = _path.substr(_path.find_last_of('/') + 1);
+    name = name.substr(0, name.find('.'));
+
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t end = name.find('_', start);
+        parts.push_back(name.substr(start, end - start));
+        if (end == std::string::npos) { break; }
+        start = end + 1;
+    }
+    if (parts.size() < 3) { return false; }
+
+    size_t n = parts.size();
+    for (size_t i = n - 3; i < n; i++) {
+        if (parts[i].empty() || parts[i].find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+    }
+    _id = TileID(std::atoi(parts[n - 2].c_str()), std::atoi(parts[n - 1].c_str()),
+                 std::atoi(parts[n - 3].c_str()));
+    return true;
+}
+
+static void printCosts(const char* _title, const std::vector<BuildCost>& _costs, size_t _top,
+                       uint64_t _tiles, bool _layers) {
+
+    printf("\n%s\n", _title);
+    if (_layers) {
+        printf("%-32s %10s %10s %10s %8s\n", "name", "ms/tile", "features", "matched", "share");
+    } else {
+        printf("%-32s %10s %10s %10s %10s\n", "name", "ms/tile", "features", "vertices", "kb/tile");
+    }
+
+    double total = 0;
+    for (auto& cost : _costs) { total += cost.milliseconds; }
+
+    for (size_t i = 0; i < _costs.size() && i < _top; i++) {
+        auto& cost = _costs[i];
+        double ms = cost.milliseconds / _tiles;
+        if (_layers) {
+            printf("%-32s %10.3f %10llu %10llu %7.1f%%\n", cost.name.c_str(), ms,
+                   (unsigned long long)(cost.features / _tiles),
+                   (unsigned long long)(cost.matched / _tiles),
+                   total > 0 ? 100 * cost.milliseconds / total : 0);
+        } else {
+            printf("%-32s %10.3f %10llu %10llu %10.1f\n", cost.name.c_str(), ms,
+                   (unsigned long long)(cost.features / _tiles),
+                   (unsigned long long)(cost.vertices / _tiles),
+                   cost.bytes / 1024.0 / _tiles);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+
+    int runs = 10;
+    size_t top = 10;
+    std::string scenePath = "scene.yaml";
+    std::vector<TileFile> tiles;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--top" && i + 1 < argc) {
+            top = std::max(1, std::atoi(argv[++i]));
+        } else if (arg.size() > 5 && arg.compare(arg.size() - 5, 5, ".yaml") == 0) {
+            scenePath = arg;
+        } else {
+            TileFile tile{ arg, TileID(0, 0, 10) };
+            if (!tileIdFromPath(arg, tile.id)) {
+                LOGW("No tile coordinates in '%s', building it as %s", arg.c_str(),
+                     tile.id.toString().c_str());
+            }
+            tiles.push_back(tile);
+        }
+    }
+    if (tiles.empty()) {
+        tiles.push_back({ "test_tile_10_301_384.mvt", TileID(301, 384, 10) });
+    }
+
+    auto platform = std::make_shared<MockPlatform>();
+
+    Url sceneUrl(scenePath);
+    platform->putMockUrlContents(sceneUrl, MockPlatform::getBytesFromFile(scenePath.c_str()));
+
+    auto scene = std::make_shared<Scene>(platform, sceneUrl);
+    Importer importer(scene);
+    try {
+        scene->config() = importer.applySceneImports(platform);
+    } catch (YAML::ParserException e) {
+        LOGE("Parsing scene config '%s'", e.what());
+        return 1;
+    }
+    SceneLoader::applyConfig(platform, scene);
+    scene->fontContext()->loadFonts();
+
+    if (scene->tileSources().empty()) {
+        LOGE("Scene '%s' has no sources", scenePath.c_str());
+        return 1;
+    }
+    auto source = *scene->tileSources().begin();
+
+    BuildCostAccounting costs;
+    TileBuilder builder(scene);
+    builder.setCostAccounting(&costs);
+
+    MercatorProjection projection;
+
+    for (auto& file : tiles) {
+        auto data = MockPlatform::getBytesFromFile(file.path.c_str());
+        if (data.empty()) {
+            LOGE("Cannot read tile '%s'", file.path.c_str());
+            return 1;
+        }
+
+        auto task = source->createTask(file.id);
+        auto& binaryTask = static_cast<BinaryTileTask&>(*task);
+        binaryTask.rawTileData = ByteBuffer(std::move(data));
+
+        auto tileData = source->parse(*task, projection);
+        if (!tileData) {
+            LOGE("Cannot parse tile '%s'", file.path.c_str());
+            return 1;
+        }
+
+        // The first build warms up the style context and builders
+        builder.build(file.id, *tileData, *source);
+
+        costs.setEnabled(true);
+        for (int i = 0; i < runs; i++) {
+            builder.build(file.id, *tileData, *source);
+        }
+        costs.setEnabled(false);
+    }
+
+    auto stats = costs.stats();
+    if (stats.tiles == 0) { return 1; }
+
+    printf("%llu tile builds of %zu tiles\n", (unsigned long long)stats.tiles, tiles.size());
+    printCosts("Data layers", stats.layers, top, stats.tiles, true);
+    printCosts("Styles", stats.styles, top, stats.tiles, false);
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "data/tileSource.h"
+#include "log.h"
+#include "mockPlatform.h"
+#include "scene/importer.h"
+#include "scene/scene.h"
+#include "scene/sceneLoader.h"
+#include "text/fontContext.h"
+#include "tile/builtTileCache.h"
+#include "tile/tile.h"
+#include "tile/tileBuilder.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Tangram;
+
+// Builds tiles of a source for the styles of a scene and writes them as
+// tiles of a 'Mesh' source, see TileSource::Format::Mesh:
+//
+//   buildMeshTiles.out [--pixel-scale 2] scene.yaml source tiles/ out/ 14/4823/6160 ...
+//
+// reads tiles/14/4823/6160.mvt and writes out/14-4823-6160.mesh. The tiles
+// are drawn only at the pixel scale they were built for. Labels are not
+// stored, they need the fonts and textures of the device.
+
+static bool writeFile(const std::string& _path, const std::vector<char>& _data) {
+    FILE* file = fopen(_path.c_str(), "wb");
+    if (!file) { return false; }
+    bool ok = fwrite(_data.data(), 1, _data.size(), file) == _data.size();
+    return (fclose(file) == 0) && ok;
+}
+
+int main(int argc, char** argv) {
+
+    float pixelScale = 1.f;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pixel-scale" && i + 1 < argc) {
+            pixelScale = std::atof(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() < 5 || pixelScale <= 0.f) {
+        fprintf(stderr, "usage: %s [--pixel-scale <scale>] <scene.yaml> <source> <input dir> <output dir> <z/x/y>...\n",
+                argv[0]);
+        return 1;
+    }
+    std::string scenePath = args[0];
+    std::string sourceName = args[1];
+    std::string inputDir = args[2];
+    std::string outputDir = args[3];
+
+    auto platform = std::make_shared<MockPlatform>();
+    Url sceneUrl(scenePath);
+    platform->putMockUrlContents(sceneUrl, MockPlatform::getBytesFromFile(scenePath.c_str()));
+
+    auto scene = std::make_shared<Scene>(platform, sceneUrl);
+    Importer importer(scene);
+    try {
+        scene->config() = importer.applySceneImports(platform);
+    } catch (YAML::ParserException& e) {
+        LOGE("Cannot parse scene '%s': %s", scenePath.c_str(), e.what());
+        return 1;
+    }
+    if (!SceneLoader::applyConfig(platform, scene)) {
+        LOGE("Cannot load scene '%s'", scenePath.c_str());
+        return 1;
+    }
+    // Styles are created by applyConfig
+    scene->setPixelScale(pixelScale);
+    scene->fontContext()->loadFonts();
+
+    std::shared_ptr<TileSource> source;
+    for (auto& s : scene->tileSources()) {
+        if (s->name() == sourceName) { source = s; }
+    }
+    if (!source) {
+        LOGE("No source '%s' in the scene", sourceName.c_str());
+        return 1;
+    }
+
+    TileBuilder tileBuilder(scene);
+    int failed = 0;
+
+    for (size_t i = 4; i < args.size(); i++) {
+        int x, y, z;
+        if (sscanf(args[i].c_str(), "%d/%d/%d", &z, &x, &y) != 3) {
+            LOGE("Invalid tile '%s', expected z/x/y", args[i].c_str());
+            failed++;
+            continue;
+        }
+        TileID tileId(x, y, z);
+        std::string input = inputDir + "/" + args[i] + ".mvt";
+
+        auto task = source->createTask(tileId);
+        auto binaryTask = dynamic_cast<BinaryTileTask*>(task.get());
+        if (!binaryTask) { return 1; }
+        binaryTask->rawTileData = ByteBuffer(MockPlatform::getBytesFromFile(input.c_str()));
+        if (binaryTask->rawTileData.empty()) {
+            LOGE("Cannot read tile '%s'", input.c_str());
+            failed++;
+            continue;
+        }
+
+        auto tileData = source->parse(*task, *scene->mapProjection());
+        if (!tileData) {
+            LOGE("Cannot parse tile '%s'", input.c_str());
+            failed++;
+            continue;
+        }
+        auto tile = tileBuilder.build(tileId, *tileData, *source);
+
+        std::vector<char> data;
+        uint32_t skipped = 0;
+        if (!tile || !BuiltTileCache::encodeMeshTile(*tile, *scene, data, &skipped)) {
+            LOGE("Cannot encode tile %s", tileId.toString().c_str());
+            failed++;
+            continue;
+        }
+
+        std::string output = outputDir + "/" + std::to_string(z) + "-" + std::to_string(x) + "-" +
+            std::to_string(y) + ".mesh";
+        if (!writeFile(output, data)) {
+            LOGE("Cannot write '%s'", output.c_str());
+            failed++;
+            continue;
+        }
+        printf("%s: %zu bytes%s\n", output.c_str(), data.size(),
+               skipped ? (", " + std::to_string(skipped) + " label styles left out").c_str() : "");
+    }
+
+    return failed > 0 ? 1 : 0;
+}
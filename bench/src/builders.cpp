@@ -3,6 +3,7 @@
 
 #include "util/builders.h"
 #include "glm/glm.hpp"
+#include <cmath>
 #include <vector>
 
 #include "benchmark/benchmark_api.h"
@@ -58,4 +59,100 @@ static void BM_Tangram_BuildRoundRoundLine(benchmark::State& state) {
 }
 BENCHMARK(BM_Tangram_BuildRoundRoundLine);
 
+struct LineVertexWriter {
+    std::vector<PosNormEnormColVertex>* vertices;
+
+    void operator()(const glm::vec2& coord, const glm::vec2& normal, const glm::vec2& uv) {
+        vertices->push_back({ coord, uv, normal, 0.5f, 0xffffff, 0.f });
+    }
+};
+
+static void BM_Tangram_BuildButtMiterLineInlined(benchmark::State& state) {
+    while(state.KeepRunning()) {
+        std::vector<PosNormEnormColVertex> vertices;
+        PolyLineBuilderT<LineVertexWriter> builder {
+            { &vertices },
+            CapTypes::butt,
+            JoinTypes::miter
+        };
+
+        Builders::buildPolyLine(line, builder);
+    }
+}
+BENCHMARK(BM_Tangram_BuildButtMiterLineInlined);
+
+static void BM_Tangram_BuildRoundRoundLineInlined(benchmark::State& state) {
+    while(state.KeepRunning()) {
+        std::vector<PosNormEnormColVertex> vertices;
+        PolyLineBuilderT<LineVertexWriter> builder {
+            { &vertices },
+            CapTypes::round,
+            JoinTypes::round
+        };
+
+        Builders::buildPolyLine(line, builder);
+    }
+}
+BENCHMARK(BM_Tangram_BuildRoundRoundLineInlined);
+
+// Circle-like outline with a hole, built as roof and walls
+static Polygon makePolygon(size_t _points) {
+    Polygon polygon(2);
+    for (size_t i = 0; i <= _points; i++) {
+        float a = 2.f * M_PI * i / _points;
+        polygon[0].push_back({ .5f + .4f * cosf(a), .5f + .4f * sinf(a) });
+        polygon[1].push_back({ .5f + .1f * cosf(-a), .5f + .1f * sinf(-a) });
+    }
+    return polygon;
+}
+
+struct PolygonVertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+    GLuint abgr;
+};
+
+struct PolygonVertexWriter {
+    std::vector<PolygonVertex>* vertices;
+
+    void operator()(const glm::vec3& coord, const glm::vec3& normal, const glm::vec2& uv) {
+        vertices->push_back({ coord, normal, uv, 0xffffff });
+    }
+};
+
+static void BM_Tangram_BuildExtrudedPolygon(benchmark::State& state) {
+    auto polygon = makePolygon(state.range(0));
+    std::vector<PolygonVertex> vertices;
+
+    PolygonBuilder builder {
+        [&](const glm::vec3& coord, const glm::vec3& normal, const glm::vec2& uv) {
+            vertices.push_back({ coord, normal, uv, 0xffffff });
+        }
+    };
+
+    while(state.KeepRunning()) {
+        vertices.clear();
+        builder.clear();
+        Builders::buildPolygonExtrusion(polygon, 0.f, 1.f, builder);
+        Builders::buildPolygon(polygon, 1.f, builder);
+    }
+}
+BENCHMARK(BM_Tangram_BuildExtrudedPolygon)->Arg(16)->Arg(256);
+
+static void BM_Tangram_BuildExtrudedPolygonInlined(benchmark::State& state) {
+    auto polygon = makePolygon(state.range(0));
+    std::vector<PolygonVertex> vertices;
+
+    PolygonBuilderT<PolygonVertexWriter> builder { { &vertices } };
+
+    while(state.KeepRunning()) {
+        vertices.clear();
+        builder.clear();
+        Builders::buildPolygonExtrusion(polygon, 0.f, 1.f, builder);
+        Builders::buildPolygon(polygon, 1.f, builder);
+    }
+}
+BENCHMARK(BM_Tangram_BuildExtrudedPolygonInlined)->Arg(16)->Arg(256);
+
 BENCHMARK_MAIN();
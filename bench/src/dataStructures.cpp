@@ -0,0 +1,310 @@
+#include "data/properties.h"
+#include "data/propertyItem.h"
+#include "selection/featureSelection.h"
+#include "tile/tile.h"
+#include "tile/tileCache.h"
+#include "tile/tileHash.h"
+#include "util/fastmap.h"
+#include "util/hashmap.h"
+#include "util/jobQueue.h"
+#include "util/mapProjection.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+// Each structure is measured next to std::unordered_map (or the equivalent
+// standard container), so candidate replacements can be compared directly.
+
+// Keys in the order of lookups, each key looked up as often as the others
+template<typename K>
+static std::vector<K> shuffledKeys(size_t _count, size_t _seed) {
+    std::vector<K> keys;
+    for (size_t i = 0; i < _count; i++) { keys.push_back(K(i)); }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(_seed));
+    return keys;
+}
+
+// ShaderProgram::m_uniformCache: a few dozen uniform locations per program,
+// every location read and written each frame
+template<typename Map>
+static void uniformCache(benchmark::State& _state) {
+    auto locations = shuffledKeys<int>(_state.range(0), 1);
+    Map cache;
+    for (int location : locations) { cache[location] = 0.f; }
+
+    while (_state.KeepRunning()) {
+        for (int location : locations) {
+            auto& value = cache[location];
+            value += 1.f;
+        }
+        benchmark::DoNotOptimize(cache);
+    }
+    _state.SetItemsProcessed(_state.iterations() * locations.size());
+}
+
+static void BM_Tangram_Fastmap_UniformCache(benchmark::State& _state) {
+    uniformCache<fastmap<int, float>>(_state);
+}
+BENCHMARK(BM_Tangram_Fastmap_UniformCache)->Arg(8)->Arg(32);
+
+static void BM_Tangram_UnorderedMap_UniformCache(benchmark::State& _state) {
+    uniformCache<std::unordered_map<int, float>>(_state);
+}
+BENCHMARK(BM_Tangram_UnorderedMap_UniformCache)->Arg(8)->Arg(32);
+
+// Tile::m_selectionFeatures: filled once per tile with increasing ids, then
+// looked up by the ids read back from the selection buffer
+template<typename Map>
+static void selectionFeatures(benchmark::State& _state) {
+    size_t count = _state.range(0);
+    auto lookups = shuffledKeys<uint32_t>(count, 2);
+    auto properties = std::make_shared<Properties>();
+
+    while (_state.KeepRunning()) {
+        Map features;
+        for (uint32_t id = 0; id < count; id++) { features[id] = properties; }
+
+        size_t found = 0;
+        for (uint32_t id : lookups) {
+            if (features.find(id) != features.end()) { found++; }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    _state.SetItemsProcessed(_state.iterations() * count);
+}
+
+static void BM_Tangram_Fastmap_SelectionFeatures(benchmark::State& _state) {
+    selectionFeatures<fastmap<uint32_t, std::shared_ptr<Properties>>>(_state);
+}
+BENCHMARK(BM_Tangram_Fastmap_SelectionFeatures)->Arg(64)->Arg(1024);
+
+static void BM_Tangram_UnorderedMap_SelectionFeatures(benchmark::State& _state) {
+    selectionFeatures<std::unordered_map<uint32_t, std::shared_ptr<Properties>>>(_state);
+}
+BENCHMARK(BM_Tangram_UnorderedMap_SelectionFeatures)->Arg(64)->Arg(1024);
+
+// Feature properties of a typical vector tile layer, e.g. OSM roads
+static const std::vector<std::string> s_propertyNames = {
+    "kind", "kind_detail", "name", "name:en", "name:de", "ref", "network", "shield_text",
+    "is_bridge", "is_tunnel", "is_link", "oneway", "min_zoom", "sort_rank", "id", "source",
+    "surface", "landuse_kind", "colour", "layer",
+};
+
+static Properties makeProperties() {
+    Properties properties;
+    for (auto& name : s_propertyNames) {
+        if (name == "min_zoom" || name == "sort_rank" || name == "id" || name == "layer") {
+            properties.set(name, double(name.size()));
+        } else {
+            properties.set(name, name + " value");
+        }
+    }
+    properties.sort();
+    return properties;
+}
+
+// Lookups of filters and draw rules, each feature is matched on a handful of keys
+static const std::vector<std::string> s_lookupNames = {
+    "kind", "kind_detail", "name", "min_zoom", "is_bridge", "missing", "sort_rank", "oneway",
+};
+
+static void BM_Tangram_Properties_GetByName(benchmark::State& _state) {
+    auto properties = makeProperties();
+
+    while (_state.KeepRunning()) {
+        for (auto& name : s_lookupNames) {
+            benchmark::DoNotOptimize(&properties.get(name));
+        }
+    }
+    _state.SetItemsProcessed(_state.iterations() * s_lookupNames.size());
+}
+BENCHMARK(BM_Tangram_Properties_GetByName);
+
+static void BM_Tangram_Properties_GetByKey(benchmark::State& _state) {
+    auto properties = makeProperties();
+
+    std::vector<PropertyKey> keys;
+    for (auto& name : s_lookupNames) { keys.emplace_back(name); }
+
+    while (_state.KeepRunning()) {
+        for (auto& key : keys) {
+            benchmark::DoNotOptimize(&properties.get(key));
+        }
+    }
+    _state.SetItemsProcessed(_state.iterations() * keys.size());
+}
+BENCHMARK(BM_Tangram_Properties_GetByKey);
+
+// Tiles of a pan over a 32x32 area at zoom 16, each with a few selectable features
+static std::vector<std::shared_ptr<Tile>> makeTiles(size_t _count) {
+    MercatorProjection projection;
+    FeatureSelection selection;
+    auto properties = std::make_shared<Properties>();
+
+    std::vector<std::shared_ptr<Tile>> tiles;
+    for (size_t i = 0; i < _count; i++) {
+        auto tile = std::make_shared<Tile>(TileID(19290 + i % 32, 24630 + i / 32, 16), projection);
+
+        SelectionFeatures features;
+        for (uint32_t id = 0; id < 4; id++) {
+            features.set(features.nextColor(selection), *properties);
+        }
+        features.finish();
+        tile->setSelectionFeatures(std::move(features));
+
+        tiles.push_back(tile);
+    }
+    return tiles;
+}
+
+// Evicts once the cache holds range(0) tiles. Every put is followed by getting
+// back a tile that left the view a few frames earlier, which hits while it is
+// still cached.
+static void BM_Tangram_TileCache_PutGetEvict(benchmark::State& _state) {
+    size_t capacity = _state.range(0);
+    auto tiles = makeTiles(1024);
+
+    size_t tileBytes = tiles[0]->getMemoryUsage() + tiles[0]->getCpuMemoryUsage();
+    TileCache cache(capacity * tileBytes);
+
+    size_t next = 0;
+    while (_state.KeepRunning()) {
+        auto& tile = tiles[next % tiles.size()];
+        cache.put(0, tile);
+
+        auto& earlier = tiles[(next + tiles.size() - capacity / 2) % tiles.size()];
+        auto cached = cache.get(0, earlier->getID());
+        benchmark::DoNotOptimize(cached);
+
+        next++;
+    }
+    _state.SetItemsProcessed(_state.iterations());
+}
+BENCHMARK(BM_Tangram_TileCache_PutGetEvict)->Arg(64)->Arg(512);
+
+// Jobs posted from the tile workers and the scene loader for one frame
+static void BM_Tangram_JobQueue_RunJobs(benchmark::State& _state) {
+    JobQueue queue;
+    size_t count = _state.range(0);
+    int counter = 0;
+
+    while (_state.KeepRunning()) {
+        for (size_t i = 0; i < count; i++) {
+            queue.add([&counter]() { counter++; });
+        }
+        queue.runJobs();
+    }
+    benchmark::DoNotOptimize(counter);
+    _state.SetItemsProcessed(_state.iterations() * count);
+}
+BENCHMARK(BM_Tangram_JobQueue_RunJobs)->Arg(4)->Arg(64);
+
+// The visible tiles of a view over a few zoom levels, as kept in the tile sets
+static std::vector<TileID> visibleTileIDs() {
+    std::vector<TileID> ids;
+    for (int z = 14; z <= 16; z++) {
+        int scale = 1 << (z - 14);
+        for (int y = 0; y < 6; y++) {
+            for (int x = 0; x < 8; x++) {
+                ids.emplace_back(4822 * scale + x, 6157 * scale + y, z);
+            }
+        }
+    }
+    return ids;
+}
+
+static void BM_Tangram_TileID_Hash(benchmark::State& _state) {
+    auto ids = visibleTileIDs();
+    std::hash<TileID> hash;
+
+    while (_state.KeepRunning()) {
+        size_t seed = 0;
+        for (auto& id : ids) { seed ^= hash(id); }
+        benchmark::DoNotOptimize(seed);
+    }
+    _state.SetItemsProcessed(_state.iterations() * ids.size());
+}
+BENCHMARK(BM_Tangram_TileID_Hash);
+
+static void BM_Tangram_TileID_UnorderedSet(benchmark::State& _state) {
+    auto ids = visibleTileIDs();
+    auto lookups = ids;
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(3));
+
+    while (_state.KeepRunning()) {
+        std::unordered_set<TileID> set(ids.begin(), ids.end());
+
+        size_t found = 0;
+        for (auto& id : lookups) { found += set.count(id); }
+        benchmark::DoNotOptimize(found);
+    }
+    _state.SetItemsProcessed(_state.iterations() * ids.size());
+}
+BENCHMARK(BM_Tangram_TileID_UnorderedSet);
+
+static void BM_Tangram_TileID_Hashmap(benchmark::State& _state) {
+    auto ids = visibleTileIDs();
+    auto lookups = ids;
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(3));
+
+    while (_state.KeepRunning()) {
+        TileIDMap<bool> map;
+        for (auto& id : ids) { map[id] = true; }
+
+        size_t found = 0;
+        for (auto& id : lookups) { found += map.count(id); }
+        benchmark::DoNotOptimize(found);
+    }
+    _state.SetItemsProcessed(_state.iterations() * ids.size());
+}
+BENCHMARK(BM_Tangram_TileID_Hashmap);
+
+static void BM_Tangram_TileCacheKey_UnorderedMap(benchmark::State& _state) {
+    auto ids = visibleTileIDs();
+
+    std::unordered_map<TileCacheKey, int32_t> map;
+    for (size_t i = 0; i < ids.size(); i++) {
+        map.emplace(TileCacheKey(i % 2, ids[i]), i);
+    }
+
+    while (_state.KeepRunning()) {
+        size_t found = 0;
+        for (size_t i = 0; i < ids.size(); i++) {
+            found += map.count(TileCacheKey(i % 2, ids[i]));
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    _state.SetItemsProcessed(_state.iterations() * ids.size());
+}
+BENCHMARK(BM_Tangram_TileCacheKey_UnorderedMap);
+
+static void BM_Tangram_TileCacheKey_Hashmap(benchmark::State& _state) {
+    auto ids = visibleTileIDs();
+
+    hashmap<TileCacheKey, int32_t> map;
+    for (size_t i = 0; i < ids.size(); i++) {
+        map.emplace(TileCacheKey(i % 2, ids[i]), i);
+    }
+
+    while (_state.KeepRunning()) {
+        size_t found = 0;
+        for (size_t i = 0; i < ids.size(); i++) {
+            found += map.count(TileCacheKey(i % 2, ids[i]));
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    _state.SetItemsProcessed(_state.iterations() * ids.size());
+}
+BENCHMARK(BM_Tangram_TileCacheKey_Hashmap);
+
+BENCHMARK_MAIN();
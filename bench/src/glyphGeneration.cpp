@@ -0,0 +1,87 @@
+#include "text/glyphSdf.h"
+#include "sdf.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+// SDF radius and glyph padding of FontContext at pixel scale 1
+static const int glyphPad = 6;
+
+struct GlyphBitmap {
+    int width, height;
+    std::vector<unsigned char> pixels;
+};
+
+// Padded bitmaps of anti-aliased strokes, about the glyph sizes FontContext
+// rasterizes for _fontSize
+static std::vector<GlyphBitmap> glyphBitmaps(int _fontSize, size_t _count) {
+    std::mt19937 random(_fontSize);
+    std::vector<GlyphBitmap> glyphs;
+
+    for (size_t i = 0; i < _count; i++) {
+        int gw = _fontSize / 2 + random() % (_fontSize / 2);
+        int gh = _fontSize * 3 / 4 + random() % (_fontSize / 4);
+        GlyphBitmap glyph{ gw + glyphPad * 2, gh + glyphPad * 2, {} };
+        glyph.pixels.assign(glyph.width * glyph.height, 0);
+
+        // A ring and a diagonal bar of stroke width _fontSize / 8
+        float stroke = std::fmax(_fontSize / 8.f, 1.5f);
+        float cx = glyph.width * 0.5f, cy = glyph.height * 0.5f;
+        float r = std::fmin(gw, gh) * 0.4f;
+        for (int y = glyphPad; y < glyph.height - glyphPad; y++) {
+            for (int x = glyphPad; x < glyph.width - glyphPad; x++) {
+                float px = x + 0.5f - cx, py = y + 0.5f - cy;
+                float ring = std::fabs(std::hypot(px, py) - r);
+                float bar = std::fabs(px - py) * 0.7071f;
+                float d = std::fmin(ring, bar) - stroke * 0.5f;
+                float a = std::fmin(std::fmax(0.5f - d, 0.f), 1.f);
+                glyph.pixels[x + y * glyph.width] = (unsigned char)(a * 255.f);
+            }
+        }
+        glyphs.push_back(std::move(glyph));
+    }
+    return glyphs;
+}
+
+// Glyph SDFs per second, the bitmaps are copied into the output first
+// like the staging buffer of FontContext::addGlyph
+template<typename Build>
+static void buildGlyphs(benchmark::State& _state, Build _build) {
+    auto glyphs = glyphBitmaps(_state.range(0), 64);
+    std::vector<unsigned char> out;
+
+    while (_state.KeepRunning()) {
+        for (auto& glyph : glyphs) {
+            out = glyph.pixels;
+            _build(out.data(), glyph.width, glyph.height);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    _state.SetItemsProcessed(_state.iterations() * glyphs.size());
+}
+
+static void BM_Tangram_GlyphSdf_Scalar(benchmark::State& _state) {
+    std::vector<unsigned char> temp;
+    buildGlyphs(_state, [&](unsigned char* _pixels, int _width, int _height) {
+        temp.resize(size_t(_width) * _height * sizeof(float) * 3);
+        sdfBuildDistanceFieldNoAlloc(_pixels, _width, glyphPad, _pixels,
+                                     _width, _height, _width, temp.data());
+    });
+}
+BENCHMARK(BM_Tangram_GlyphSdf_Scalar)->Arg(16)->Arg(28)->Arg(40);
+
+static void BM_Tangram_GlyphSdf_Vectorized(benchmark::State& _state) {
+    GlyphSdfScratch scratch;
+    buildGlyphs(_state, [&](unsigned char* _pixels, int _width, int _height) {
+        buildGlyphSdf(_pixels, _width, glyphPad, _pixels, _width, _height, _width, scratch);
+    });
+}
+BENCHMARK(BM_Tangram_GlyphSdf_Vectorized)->Arg(16)->Arg(28)->Arg(40);
+
+BENCHMARK_MAIN();
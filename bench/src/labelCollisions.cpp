@@ -0,0 +1,140 @@
+#include "labels/labelGrid.h"
+
+#include "glm_vec.h" // for isect2d.h
+#include "isect2d.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+using AABB = isect2d::AABB<glm::vec2>;
+
+static const glm::vec2 s_viewport = { 1024, 768 };
+
+// Label-like boxes: wide text lines and small icons, partly off screen
+static std::vector<AABB> makeBoxes(size_t _count) {
+    std::mt19937 rng(_count);
+    std::uniform_real_distribution<float> x(-128, s_viewport.x + 128);
+    std::uniform_real_distribution<float> y(-128, s_viewport.y + 128);
+    std::uniform_real_distribution<float> width(16, 160);
+    std::uniform_real_distribution<float> height(12, 32);
+
+    std::vector<AABB> boxes;
+    for (size_t i = 0; i < _count; i++) {
+        glm::vec2 min(x(rng), y(rng));
+        boxes.emplace_back(min.x, min.y, min.x + width(rng), min.y + height(rng));
+    }
+    return boxes;
+}
+
+// Greedy placement as in Labels::handleOcclusions: query, insert when free
+template<typename Broadphase>
+static size_t place(Broadphase& _broadphase, const std::vector<AABB>& _boxes) {
+    size_t placed = 0;
+    for (size_t i = 0; i < _boxes.size(); i++) {
+        bool occluded = false;
+        _broadphase.intersect(_boxes[i], [&](auto& a, auto& b) {
+                occluded = true;
+                return false;
+            });
+        if (occluded) { continue; }
+
+        AABB aabb = _boxes[i];
+        aabb.m_userData = reinterpret_cast<void*>(i);
+        _broadphase.insert(aabb);
+        placed++;
+    }
+    return placed;
+}
+
+static void BM_Tangram_LabelGridPlacement(benchmark::State& st) {
+    auto boxes = makeBoxes(st.range(0));
+
+    std::vector<float> sizes;
+    for (auto& b : boxes) { sizes.push_back(std::max(b.max.x - b.min.x, b.max.y - b.min.y)); }
+
+    LabelGrid grid;
+    grid.resize(s_viewport, LabelGrid::cellSize(sizes));
+
+    size_t placed = 0;
+    size_t iterations = 0;
+    while (st.KeepRunning()) {
+        iterations++;
+        grid.clear();
+        placed = place(grid, boxes);
+    }
+    st.SetItemsProcessed(iterations * boxes.size());
+    st.SetLabel("placed: " + std::to_string(placed));
+}
+
+struct ISect2DBroadphase {
+    isect2d::ISect2D<glm::vec2> isect;
+
+    template<typename F>
+    void intersect(const AABB& _aabb, F&& _cb) { isect.intersect(_aabb, _cb, false); }
+    void insert(const AABB& _aabb) { isect.insert(_aabb); }
+};
+
+static void BM_Tangram_ISect2DPlacement(benchmark::State& st) {
+    auto boxes = makeBoxes(st.range(0));
+
+    ISect2DBroadphase broadphase;
+    broadphase.isect.resize({s_viewport.x / 256, s_viewport.y / 256}, s_viewport);
+
+    size_t placed = 0;
+    size_t iterations = 0;
+    while (st.KeepRunning()) {
+        iterations++;
+        broadphase.isect.clear();
+        placed = place(broadphase, boxes);
+    }
+    st.SetItemsProcessed(iterations * boxes.size());
+    st.SetLabel("placed: " + std::to_string(placed));
+}
+
+// All intersecting pairs as in LabelCollider::process
+static void BM_Tangram_LabelGridPairs(benchmark::State& st) {
+    auto boxes = makeBoxes(st.range(0));
+
+    std::vector<float> sizes;
+    for (auto& b : boxes) { sizes.push_back(std::max(b.max.x - b.min.x, b.max.y - b.min.y)); }
+
+    LabelGrid grid;
+    grid.resize(s_viewport, LabelGrid::cellSize(sizes));
+
+    size_t iterations = 0;
+    while (st.KeepRunning()) {
+        iterations++;
+        grid.intersect(boxes);
+    }
+    st.SetItemsProcessed(iterations * boxes.size());
+    st.SetLabel("pairs: " + std::to_string(grid.pairs.size()));
+}
+
+static void BM_Tangram_ISect2DPairs(benchmark::State& st) {
+    auto boxes = makeBoxes(st.range(0));
+
+    isect2d::ISect2D<glm::vec2> isect;
+    isect.resize({s_viewport.x / 128, s_viewport.y / 128}, s_viewport);
+
+    size_t iterations = 0;
+    while (st.KeepRunning()) {
+        iterations++;
+        isect.intersect(boxes);
+    }
+    st.SetItemsProcessed(iterations * boxes.size());
+    st.SetLabel("pairs: " + std::to_string(isect.pairs.size()));
+}
+
+BENCHMARK(BM_Tangram_LabelGridPlacement)->Arg(1000)->Arg(5000)->Arg(10000);
+BENCHMARK(BM_Tangram_ISect2DPlacement)->Arg(1000)->Arg(5000)->Arg(10000);
+BENCHMARK(BM_Tangram_LabelGridPairs)->Arg(100)->Arg(1000)->Arg(5000);
+BENCHMARK(BM_Tangram_ISect2DPairs)->Arg(100)->Arg(1000)->Arg(5000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,361 @@
+#include "data/tileSource.h"
+#include "gl.h"
+#include "labels/labels.h"
+#include "labels/labelSet.h"
+#include "log.h"
+#include "map.h"
+#include "marker/marker.h"
+#include "mockPlatform.h"
+#include "scene/importer.h"
+#include "scene/scene.h"
+#include "scene/sceneLoader.h"
+#include "style/style.h"
+#include "text/fontContext.h"
+#include "tile/tile.h"
+#include "tile/tileBuilder.h"
+#include "tile/tileManager.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+#include "view/view.h"
+
+#include "unicode/unistr.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+// Count heap allocations per replayed frame
+static std::atomic<size_t> s_allocations{0};
+
+void* operator new(size_t _size) {
+    s_allocations++;
+    if (void* p = std::malloc(_size)) { return p; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* _p) noexcept { std::free(_p); }
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double secondsSince(Clock::time_point _start) {
+    return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+struct TileFile { const char* path; TileID id; };
+
+static const std::vector<TileFile> s_tiles = {
+    { "test_tile_10_301_384.mvt", TileID(301, 384, 10) },
+};
+
+// Camera path over the test tiles: lng, lat, zoom key frames, interpolated
+// linearly at 60 fps. Crosses zoom 11 to include the transitions reset.
+struct CameraKey { double lng, lat; float zoom; };
+
+static const std::vector<CameraKey> s_cameraPath = {
+    { -74.060, 40.800, 10.4f },
+    { -74.020, 40.830, 10.7f },
+    { -73.980, 40.860, 11.1f },
+    { -73.940, 40.890, 11.3f },
+    { -73.960, 40.870, 10.9f },
+    { -74.010, 40.840, 10.5f },
+};
+
+static const int s_framesPerKey = 30;
+static const float s_frameTime = 1.f / 60.f;
+
+struct NullTileWorker : TileTaskQueue {
+    void enqueue(std::shared_ptr<TileTask> task) override {}
+};
+
+// Exposes the stages of Labels::updateLabelSet
+struct ReplayLabels : public Labels {
+
+    void collectLabels(const ViewState& _viewState, float _dt, const std::shared_ptr<Scene>& _scene,
+                       const std::vector<std::shared_ptr<Tile>>& _tiles,
+                       const std::vector<std::unique_ptr<Marker>>& _markers) {
+        m_transforms.clear();
+        m_obbs.clear();
+
+        updateLabels(_viewState, _dt, _scene->styles(), _tiles, _markers, false);
+        sortByPriority();
+
+        resizeCollisionGrid(_viewState);
+    }
+
+    void occlusions(const ViewState& _viewState) { handleOcclusions(_viewState); }
+
+    void evalStates(float _dt) {
+        for (auto& entry : m_labels) { entry.label->evalState(_dt); }
+    }
+
+    size_t labelCount() const { return m_labels.size(); }
+
+    size_t visibleCount() const {
+        return std::count_if(m_labels.begin(), m_labels.end(),
+                             [](auto& entry) { return entry.label->visibleState(); });
+    }
+};
+
+class LabelPlacementFixture : public benchmark::Fixture {
+public:
+    std::shared_ptr<MockPlatform> platform = std::make_shared<MockPlatform>();
+    std::shared_ptr<Scene> scene;
+    std::shared_ptr<TileSource> source;
+
+    std::vector<std::shared_ptr<TileData>> tileData;
+    std::vector<std::shared_ptr<Tile>> tiles;
+    std::vector<std::unique_ptr<Marker>> markers;
+
+    NullTileWorker worker;
+    std::unique_ptr<TileManager> tileManager;
+    std::unique_ptr<View> view;
+
+    // Recorded view positions (x, y in meters, zoom)
+    std::vector<glm::dvec3> frames;
+
+    void SetUp() override {
+        Url sceneUrl("scene.yaml");
+        platform->putMockUrlContents(sceneUrl, MockPlatform::getBytesFromFile("scene.yaml"));
+
+        scene = std::make_shared<Scene>(platform, sceneUrl);
+        Importer importer(scene);
+        try {
+            scene->config() = importer.applySceneImports(platform);
+        } catch (YAML::ParserException e) {
+            LOGE("Parsing scene config '%s'", e.what());
+            return;
+        }
+        SceneLoader::applyConfig(platform, scene);
+        scene->fontContext()->loadFonts();
+
+        source = *scene->tileSources().begin();
+        tileManager = std::make_unique<TileManager>(platform, worker);
+
+        view = std::make_unique<View>(1024, 768);
+        view->setPixelScale(2.0f);
+
+        TileBuilder builder(scene);
+        for (auto& file : s_tiles) {
+            auto task = source->createTask(file.id);
+            auto& binaryTask = dynamic_cast<BinaryTileTask&>(*task);
+            binaryTask.rawTileData = ByteBuffer(MockPlatform::getBytesFromFile(file.path));
+
+            auto data = source->parse(*task, view->getMapProjection());
+            if (!data) { continue; }
+
+            tileData.push_back(data);
+            tiles.push_back(builder.build(file.id, *data, *source));
+        }
+
+        auto& projection = view->getMapProjection();
+        for (size_t i = 0; i + 1 < s_cameraPath.size(); i++) {
+            auto& a = s_cameraPath[i];
+            auto& b = s_cameraPath[i + 1];
+
+            for (int f = 0; f < s_framesPerKey; f++) {
+                double t = double(f) / s_framesPerKey;
+                glm::dvec2 pos = projection.LonLatToMeters({ a.lng + (b.lng - a.lng) * t,
+                                                             a.lat + (b.lat - a.lat) * t });
+                frames.emplace_back(pos.x, pos.y, a.zoom + (b.zoom - a.zoom) * t);
+            }
+        }
+    }
+
+    void TearDown() override {
+        tiles.clear();
+        tileData.clear();
+        scene.reset();
+    }
+
+    void applyFrame(size_t _frame) {
+        auto& frame = frames[_frame];
+        view->setPosition(frame.x, frame.y);
+        view->setZoom(frame.z);
+        view->update();
+
+        for (auto& tile : tiles) { tile->update(s_frameTime, *view); }
+    }
+
+    // Labels keep their state in the tiles: start each replay from scratch
+    void resetLabels() {
+        for (auto& tile : tiles) {
+            for (auto& style : scene->styles()) {
+                auto labelSet = dynamic_cast<LabelSet*>(tile->getMesh(*style).get());
+                if (!labelSet) { continue; }
+                for (auto& label : labelSet->getLabels()) { label->resetState(); }
+            }
+        }
+    }
+};
+
+BENCHMARK_DEFINE_F(LabelPlacementFixture, UpdateLabelSet)(benchmark::State& st) {
+    size_t frameCount = 0, labels = 0, visible = 0, allocations = 0;
+
+    while (st.KeepRunning()) {
+        resetLabels();
+        ReplayLabels replay;
+        replay.setIncrementalOcclusion(st.range(0));
+
+        for (size_t i = 0; i < frames.size(); i++) {
+            applyFrame(i);
+
+            size_t start = s_allocations;
+            replay.updateLabelSet(view->state(), s_frameTime, scene, tiles, markers, *tileManager);
+            allocations += s_allocations - start;
+
+            labels += replay.labelCount();
+            visible += replay.visibleCount();
+            frameCount++;
+        }
+    }
+
+    st.SetItemsProcessed(frameCount);
+    if (frameCount == 0) { return; }
+    st.SetLabel("labels/frame: " + std::to_string(labels / frameCount) +
+                " visible/frame: " + std::to_string(visible / frameCount) +
+                " allocations/frame: " + std::to_string(allocations / frameCount));
+}
+
+// Arg: incremental occlusion off/on
+BENCHMARK_REGISTER_F(LabelPlacementFixture, UpdateLabelSet)->Arg(0)->Arg(1);
+
+// Splits the time of a replay into the stages of updateLabelSet
+BENCHMARK_DEFINE_F(LabelPlacementFixture, HandleOcclusions)(benchmark::State& st) {
+    double collect = 0, occlusion = 0, state = 0;
+    size_t frameCount = 0, allocations = 0;
+
+    while (st.KeepRunning()) {
+        resetLabels();
+        ReplayLabels replay;
+        double iteration = 0;
+
+        for (size_t i = 0; i < frames.size(); i++) {
+            applyFrame(i);
+            auto viewState = view->state();
+
+            auto start = Clock::now();
+            replay.collectLabels(viewState, s_frameTime, scene, tiles, markers);
+            collect += secondsSince(start);
+
+            size_t allocStart = s_allocations;
+            start = Clock::now();
+            replay.occlusions(viewState);
+            double elapsed = secondsSince(start);
+            allocations += s_allocations - allocStart;
+            occlusion += elapsed;
+            iteration += elapsed;
+
+            start = Clock::now();
+            replay.evalStates(s_frameTime);
+            state += secondsSince(start);
+
+            frameCount++;
+        }
+        st.SetIterationTime(iteration);
+    }
+
+    st.SetItemsProcessed(frameCount);
+    if (frameCount == 0) { return; }
+    auto usPerFrame = [&](double _seconds) { return std::to_string(int(_seconds * 1e6 / frameCount)); };
+    st.SetLabel("us/frame collect: " + usPerFrame(collect) +
+                " occlusions: " + usPerFrame(occlusion) +
+                " state: " + usPerFrame(state) +
+                " occlusion allocations/frame: " + std::to_string(allocations / frameCount));
+}
+
+BENCHMARK_REGISTER_F(LabelPlacementFixture, HandleOcclusions)->UseManualTime();
+
+// Building the tiles includes text layout and LabelCollider::process
+BENCHMARK_DEFINE_F(LabelPlacementFixture, BuildTileLabels)(benchmark::State& st) {
+    size_t builds = 0, allocations = 0;
+    TileBuilder builder(scene);
+
+    while (st.KeepRunning()) {
+        for (size_t i = 0; i < tileData.size(); i++) {
+            size_t start = s_allocations;
+            auto tile = builder.build(s_tiles[i].id, *tileData[i], *source);
+            allocations += s_allocations - start;
+            builds++;
+        }
+    }
+
+    st.SetItemsProcessed(builds);
+    if (builds == 0) { return; }
+    st.SetLabel("allocations/tile: " + std::to_string(allocations / builds));
+}
+
+BENCHMARK_REGISTER_F(LabelPlacementFixture, BuildTileLabels);
+
+// FontContext::layoutText for the names in the test tiles
+BENCHMARK_DEFINE_F(LabelPlacementFixture, LayoutText)(benchmark::State& st) {
+    auto fontContext = scene->fontContext();
+
+    std::vector<std::string> names;
+    Feature feature;
+    for (auto& data : tileData) {
+        for (auto& layer : data->layers) {
+            for (auto& f : layer.features) {
+                auto& name = f.props.getString("name");
+                if (!name.empty()) { names.push_back(name); }
+            }
+        }
+        for (auto& layer : data->columnarLayers) {
+            for (size_t i = 0; i < layer.features.size(); i++) {
+                layer.getFeature(i, feature);
+                auto& name = feature.props.getString("name");
+                if (!name.empty()) { names.push_back(name); }
+            }
+        }
+    }
+
+    TextStyle::Parameters params;
+    params.fontSize = 12.f * view->pixelScale();
+    params.font = fontContext->getFont("Open Sans", "normal", "400", params.fontSize);
+    if (!params.font || names.empty()) { return; }
+    params.fontScale = params.fontSize / params.font->size();
+
+    bool utf8 = st.range(0);
+
+    std::vector<GlyphQuad> quads;
+    std::bitset<FontContext::max_textures> refs;
+    size_t layouts = 0, glyphs = 0, allocations = 0;
+
+    while (st.KeepRunning()) {
+        for (auto& name : names) {
+            quads.clear();
+            glm::vec2 bbox(0);
+            TextRange ranges;
+
+            size_t start = s_allocations;
+            if (utf8) {
+                fontContext->layoutText(params, name, quads, refs, bbox, ranges);
+            } else {
+                auto text = icu::UnicodeString::fromUTF8(name);
+                fontContext->layoutText(params, text, quads, refs, bbox, ranges);
+            }
+            allocations += s_allocations - start;
+
+            glyphs += quads.size();
+            layouts++;
+        }
+    }
+
+    st.SetItemsProcessed(layouts);
+    st.SetLabel("texts: " + std::to_string(names.size()) +
+                " glyphs/text: " + std::to_string(glyphs / layouts) +
+                " allocations/text: " + std::to_string(allocations / layouts));
+}
+
+// Arg: UTF-16 conversion per text / UTF-8 layout
+BENCHMARK_REGISTER_F(LabelPlacementFixture, LayoutText)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
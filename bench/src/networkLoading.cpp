@@ -0,0 +1,143 @@
+#include "data/networkDataSource.h"
+#include "data/tileSource.h"
+#include "mockPlatform.h"
+#include "tile/tile.h"
+#include "tile/tileManager.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+#include "view/view.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+}
+
+// Camera script of an app start: zoom in on a place, then pan a bit.
+// lng, lat, zoom at key frames 0.5s apart, interpolated linearly in between.
+struct CameraKey { double lng, lat; float zoom; };
+
+static const std::vector<CameraKey> s_cameraScript = {
+    { -73.9850, 40.7480, 12.0f },
+    { -73.9850, 40.7480, 13.5f },
+    { -73.9850, 40.7480, 15.0f },
+    { -73.9800, 40.7530, 15.0f },
+    { -73.9750, 40.7580, 15.0f },
+};
+
+static const int s_framesPerKey = 30;
+static const auto s_frameTime = std::chrono::microseconds(16667);
+
+// Size of the response to each tile request, about that of an MVT tile
+static const size_t s_tileBytes = 40 * 1024;
+
+// Give up on loading the last tiles after this time
+static const double s_maxLoadingMs = 60 * 1000;
+
+static MercatorProjection s_projection;
+
+// Makes empty tiles of the loaded tasks, without parsing and building, so
+// that the time to load the tiles is taken by the network only
+struct EmptyTileWorker : TileTaskQueue {
+    void enqueue(std::shared_ptr<TileTask> task) override {
+        if (task->isCanceled()) { return; }
+        task->setTile(std::make_unique<Tile>(task->tileId(), s_projection, &task->source()));
+    }
+};
+
+static MockPlatform::NetworkProfile networkProfile(int64_t _which) {
+    return _which == 0 ? MockPlatform::NetworkProfile::mobile3G() : MockPlatform::NetworkProfile::lte();
+}
+
+static bool hasLoadedTile(const TileManager& _tileManager) {
+    for (auto& tile : _tileManager.getVisibleTiles()) {
+        if (!tile->isProxy()) { return true; }
+    }
+    return false;
+}
+
+// Time to the first shown tile and until the last tile of the final view
+// was loaded, for the camera script on the network profile of st.range(0)
+static void BM_Tangram_LoadTiles_CameraScript(benchmark::State& st) {
+    double firstTileMs = 0;
+    double completeMs = 0;
+    int runs = 0;
+
+    EmptyTileWorker worker;
+
+    while (st.KeepRunning()) {
+        auto platform = std::make_shared<MockPlatform>();
+        platform->putMockUrlFallback(std::vector<char>(s_tileBytes, 'x'));
+        platform->setNetworkProfile(networkProfile(st.range(0)));
+
+        TileManager tileManager(platform, worker);
+        auto source = std::make_shared<TileSource>("network",
+            std::make_unique<NetworkDataSource>(platform, "https://tiles/{z}/{x}/{y}.mvt",
+                                                std::vector<std::string>{}, false));
+        tileManager.setTileSources({ source });
+
+        View view(1024, 768);
+        view.setPixelScale(2.0f);
+        auto& projection = view.getMapProjection();
+
+        auto start = Clock::now();
+        auto frameTime = start;
+        double firstTile = -1;
+
+        auto updateFrame = [&]() {
+            view.update();
+            tileManager.updateTileSets(view);
+            if (firstTile < 0 && hasLoadedTile(tileManager)) {
+                firstTile = millisecondsSince(start);
+            }
+            frameTime += s_frameTime;
+            std::this_thread::sleep_until(frameTime);
+        };
+
+        for (size_t i = 0; i + 1 < s_cameraScript.size(); i++) {
+            auto& a = s_cameraScript[i];
+            auto& b = s_cameraScript[i + 1];
+
+            for (int f = 0; f < s_framesPerKey; f++) {
+                double t = double(f) / s_framesPerKey;
+                glm::dvec2 pos = projection.LonLatToMeters({ a.lng + (b.lng - a.lng) * t,
+                                                             a.lat + (b.lat - a.lat) * t });
+                view.setPosition(pos.x, pos.y);
+                view.setZoom(a.zoom + (b.zoom - a.zoom) * t);
+                updateFrame();
+            }
+        }
+
+        // Stay at the last key frame until its tiles are loaded
+        do {
+            updateFrame();
+        } while (tileManager.hasLoadingTiles() && millisecondsSince(start) < s_maxLoadingMs);
+
+        double complete = millisecondsSince(start);
+        if (firstTile < 0) { firstTile = complete; }
+        st.SetIterationTime(complete / 1000);
+
+        firstTileMs += firstTile;
+        completeMs += complete;
+        runs++;
+    }
+
+    if (runs == 0) { return; }
+    st.SetLabel(std::string(st.range(0) == 0 ? "3G" : "LTE") +
+                " ms to first tile: " + std::to_string(int(firstTileMs / runs)) +
+                ", ms to complete: " + std::to_string(int(completeMs / runs)));
+}
+BENCHMARK(BM_Tangram_LoadTiles_CameraScript)->Arg(0)->Arg(1)->UseManualTime();
+
+BENCHMARK_MAIN();
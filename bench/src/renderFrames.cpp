@@ -0,0 +1,359 @@
+#include "debug/sessionRecorder.h"
+#include "gl.h"
+#include "log.h"
+#include "map.h"
+#include "mockPlatform.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+// Renders a scene headlessly along a camera path and prints frame timings,
+// the time until the first view was loaded and the peak memory use.
+//
+// Usage: renderFrames.out [--frames N] [--size WxH] [--tiles DIR] [--path FILE] [--json] [scene.yaml]
+//        renderFrames.out --replay SESSION [--json]
+//
+// Tiles are served from DIR/z/x/y.ext, named by the last three components of
+// the tile URL, so recorded tiles give the same frames on every run. Tiles
+// which are missing count as failed loads. The path file has one keyframe per
+// line: 'lon lat zoom [rotation tilt]', angles in degrees. Without it a fixed
+// path around the scene position is used. With --json one line of results is
+// printed, to be compared across commits.
+//
+// With --replay a session written by a SessionRecorder is played back instead:
+// its scene loads, view changes and gestures are applied and its network
+// responses served with their recorded latency, one frame per recorded update.
+
+using namespace Tangram;
+
+using Clock = std::chrono::steady_clock;
+
+static double millisSince(Clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+}
+
+class BenchPlatform : public MockPlatform {
+
+public:
+
+    explicit BenchPlatform(std::string _tileDir) : m_tileDir(std::move(_tileDir)) {}
+
+    UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override {
+        UrlResponse response;
+
+        std::string path;
+        if (_url.hasHttpScheme()) {
+            path = tilePath(_url.path());
+            requests++;
+        } else {
+            path = _url.hasFileScheme() ? _url.path() : _url.string();
+        }
+
+        response.content = getBytesFromFile(path.c_str());
+        if (response.content.empty()) {
+            response.error = "No recorded file for url";
+            if (_url.hasHttpScheme()) { misses++; }
+        }
+        _callback(response);
+
+        return 0;
+    }
+
+    uint32_t requests = 0;
+    uint32_t misses = 0;
+
+private:
+
+    // DIR/z/x/y.ext from the last three components of _path
+    std::string tilePath(const std::string& _path) {
+        std::string path = m_tileDir;
+        size_t pos = _path.size();
+        for (int i = 0; i < 3 && pos != std::string::npos && pos > 0; i++) {
+            pos = _path.find_last_of('/', pos - 1);
+        }
+        path += (pos == std::string::npos) ? "/" + _path : _path.substr(pos);
+        return path;
+    }
+
+    std::string m_tileDir;
+};
+
+struct Keyframe {
+    double lon, lat;
+    float zoom, rotation, tilt;
+};
+
+static std::vector<Keyframe> readPath(const std::string& _file) {
+    std::vector<Keyframe> path;
+    std::ifstream in(_file);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') { continue; }
+        std::istringstream fields(line);
+        Keyframe key{ 0, 0, 0, 0, 0 };
+        if (fields >> key.lon >> key.lat >> key.zoom) {
+            fields >> key.rotation >> key.tilt;
+            path.push_back(key);
+        }
+    }
+    return path;
+}
+
+// Pan over a few tiles, zoom in while rotating and tilting, then zoom back out
+static std::vector<Keyframe> defaultPath(double _lon, double _lat, float _zoom) {
+    double tile = 360.0 / std::exp2(_zoom);
+    return {
+        { _lon, _lat, _zoom, 0, 0 },
+        { _lon + 2 * tile, _lat, _zoom, 0, 0 },
+        { _lon + 2 * tile, _lat + tile, _zoom + 2, 45, 30 },
+        { _lon, _lat + tile, _zoom + 2, 90, 45 },
+        { _lon, _lat, _zoom, 0, 0 },
+    };
+}
+
+static Keyframe interpolate(const std::vector<Keyframe>& _path, float _t) {
+    if (_path.size() == 1) { return _path[0]; }
+
+    float position = std::min(std::max(_t, 0.f), 1.f) * (_path.size() - 1);
+    size_t i = std::min<size_t>(position, _path.size() - 2);
+    float f = position - i;
+
+    auto& a = _path[i];
+    auto& b = _path[i + 1];
+    return { a.lon + (b.lon - a.lon) * f, a.lat + (b.lat - a.lat) * f,
+             a.zoom + (b.zoom - a.zoom) * f, a.rotation + (b.rotation - a.rotation) * f,
+             a.tilt + (b.tilt - a.tilt) * f };
+}
+
+static double percentile(const std::vector<double>& _sorted, double _p) {
+    if (_sorted.empty()) { return 0; }
+    size_t rank = std::ceil(_p * _sorted.size());
+    return _sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static bool readSession(const std::string& _file, std::vector<SessionEvent>& _events) {
+    auto data = MockPlatform::getBytesFromFile(_file.c_str());
+    return !data.empty() && SessionRecorder::parse(std::string(data.begin(), data.end()), _events);
+}
+
+// Renders one frame per update of the session
+static int replaySession(SessionPlayer& _player, int _width, int _height, bool _json) {
+    Map map(_player.platform());
+    map.setupGL();
+    map.resize(_width, _height);
+
+    std::vector<unsigned int> pixels(_width * _height);
+    std::vector<double> frameTimes;
+
+    auto start = Clock::now();
+    while (true) {
+        auto frameStart = Clock::now();
+        if (!_player.step(map)) { break; }
+        map.render();
+        map.captureSnapshot(pixels.data());
+        frameTimes.push_back(millisSince(frameStart));
+    }
+    double totalTime = millisSince(start);
+
+    if (frameTimes.empty()) {
+        LOGE("No updates in the session");
+        return 1;
+    }
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    double fps = frameTimes.size() * 1000.0 / totalTime;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakKb = usage.ru_maxrss;
+    uint32_t misses = _player.platform()->misses();
+
+    if (_json) {
+        printf("{\"frames\":%zu,\"fps\":%.2f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+               "\"max\":%.3f,\"peak_kb\":%ld,\"response_misses\":%u}\n",
+               frameTimes.size(), fps, percentile(frameTimes, 0.5), percentile(frameTimes, 0.9),
+               percentile(frameTimes, 0.99), frameTimes.back(), peakKb, misses);
+    } else {
+        printf("%zu replayed frames at %dx%d, %.2f fps\n", frameTimes.size(), _width, _height, fps);
+        printf("frame ms: p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+               percentile(frameTimes, 0.5), percentile(frameTimes, 0.9),
+               percentile(frameTimes, 0.99), frameTimes.back());
+        printf("peak memory %ld kB\n", peakKb);
+        printf("%u requests without a recorded response\n", misses);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+
+    int frames = 300;
+    int width = 1024, height = 768;
+    std::string scenePath = "scene.yaml";
+    std::string tileDir = "tiles";
+    std::string pathFile;
+    std::string sessionFile;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            std::sscanf(argv[++i], "%dx%d", &width, &height);
+        } else if (arg == "--tiles" && i + 1 < argc) {
+            tileDir = argv[++i];
+        } else if (arg == "--path" && i + 1 < argc) {
+            pathFile = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            sessionFile = argv[++i];
+        } else if (arg == "--json") {
+            json = true;
+        } else {
+            scenePath = arg;
+        }
+    }
+
+    std::vector<SessionEvent> session;
+    if (!sessionFile.empty()) {
+        if (!readSession(sessionFile, session)) {
+            LOGE("Cannot read session '%s'", sessionFile.c_str());
+            return 1;
+        }
+        // Draw at the size of the recorded map
+        for (auto& event : session) {
+            if (event.name == "resize" && event.args.size() == 2) {
+                width = std::atoi(event.args[0].c_str());
+                height = std::atoi(event.args[1].c_str());
+                break;
+            }
+        }
+    }
+
+    if (!glfwInit()) {
+        LOGE("Cannot initialize GLFW");
+        return 1;
+    }
+
+    // A hidden window gives an offscreen context with a default framebuffer
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_STENCIL_BITS, 8);
+    GLFWwindow* window = glfwCreateWindow(width, height, "renderFrames", nullptr, nullptr);
+    if (!window) {
+        LOGE("Cannot create a GL context");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+
+    int result = 0;
+    if (!sessionFile.empty()) {
+        SessionPlayer player(std::move(session));
+        result = replaySession(player, width, height, json);
+
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return result;
+    }
+
+    auto platform = std::make_shared<BenchPlatform>(tileDir);
+    {
+        Map map(platform);
+        map.setupGL();
+        map.resize(width, height);
+
+        map.setSceneReadyListener([&](SceneID, const SceneError* _error) {
+            if (_error) {
+                LOGE("Cannot load scene '%s', error %d", scenePath.c_str(), _error->error);
+                result = 1;
+            }
+        });
+        map.loadScene(scenePath, true);
+
+        std::vector<unsigned int> pixels(width * height);
+        const float dt = 1.f / 60.f;
+
+        // Wait until the tiles of the first view are loaded and drawn
+        auto loadStart = Clock::now();
+        double loadTime = -1;
+        while (result == 0 && millisSince(loadStart) < 60000) {
+            bool complete = map.update(dt);
+            map.render();
+            map.captureSnapshot(pixels.data());
+            if (complete && map.getPerformanceStats().tilesInFlight == 0) {
+                loadTime = millisSince(loadStart);
+                break;
+            }
+        }
+        if (result == 0 && loadTime < 0) { LOGW("Tiles were not loaded within 60s"); }
+
+        double lon = 0, lat = 0;
+        map.getPosition(lon, lat);
+        auto path = pathFile.empty() ? defaultPath(lon, lat, map.getZoom()) : readPath(pathFile);
+        if (path.empty()) {
+            LOGE("No keyframes in '%s'", pathFile.c_str());
+            result = 1;
+        }
+
+        // Reading back the pixels waits for the GPU, so frame times include drawing
+        std::vector<double> frameTimes;
+        frameTimes.reserve(frames);
+        auto pathStart = Clock::now();
+        for (int i = 0; result == 0 && i < frames; i++) {
+            auto key = interpolate(path, frames > 1 ? float(i) / (frames - 1) : 0.f);
+
+            auto frameStart = Clock::now();
+            map.setPosition(key.lon, key.lat);
+            map.setZoom(key.zoom);
+            map.setRotation(key.rotation * M_PI / 180.0);
+            map.setTilt(key.tilt * M_PI / 180.0);
+            map.update(dt);
+            map.render();
+            map.captureSnapshot(pixels.data());
+            frameTimes.push_back(millisSince(frameStart));
+        }
+        double pathTime = millisSince(pathStart);
+
+        if (result == 0) {
+            std::sort(frameTimes.begin(), frameTimes.end());
+
+            double fps = frameTimes.size() * 1000.0 / pathTime;
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            long peakKb = usage.ru_maxrss;
+
+            if (json) {
+                printf("{\"frames\":%zu,\"fps\":%.2f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+                       "\"max\":%.3f,\"load_ms\":%.1f,\"peak_kb\":%ld,\"tile_requests\":%u,"
+                       "\"tile_misses\":%u}\n",
+                       frameTimes.size(), fps, percentile(frameTimes, 0.5),
+                       percentile(frameTimes, 0.9), percentile(frameTimes, 0.99),
+                       frameTimes.back(), loadTime, peakKb, platform->requests, platform->misses);
+            } else {
+                printf("%zu frames at %dx%d, %.2f fps\n", frameTimes.size(), width, height, fps);
+                printf("frame ms: p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+                       percentile(frameTimes, 0.5), percentile(frameTimes, 0.9),
+                       percentile(frameTimes, 0.99), frameTimes.back());
+                printf("first view loaded in %.1f ms\n", loadTime);
+                printf("peak memory %ld kB\n", peakKb);
+                printf("%u tile requests, %u without a recorded tile\n",
+                       platform->requests, platform->misses);
+            }
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return result;
+}
@@ -0,0 +1,253 @@
+#include "log.h"
+#include "map.h"
+#include "mockPlatform.h"
+#include "scene/importer.h"
+#include "scene/lights.h"
+#include "scene/scene.h"
+#include "scene/sceneLoader.h"
+#include "scene/styleContext.h"
+#include "scene/styleMixer.h"
+#include "style/style.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point _start) {
+    return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+// Scene with _layers layers of two rules each, with filter and style
+// functions, drawn by _styles styles that mix each other's shader blocks.
+static std::string syntheticScene(int _layers, int _styles) {
+    std::string yaml;
+
+    yaml += "global:\n"
+            "    order: function() { return feature.sort_rank; }\n"
+            "sources:\n"
+            "    synthetic:\n"
+            "        type: MVT\n"
+            "        url: https://localhost/{z}/{x}/{y}.mvt\n"
+            "lights:\n"
+            "    sun: { type: directional, direction: [1, 1, -1], diffuse: 0.6 }\n"
+            "    lamp: { type: point, position: [0, 0, 100px], radius: 500px }\n"
+            "styles:\n";
+
+    for (int i = 0; i < _styles; i++) {
+        auto name = "style" + std::to_string(i);
+        yaml += "    " + name + ":\n";
+        yaml += std::string("        base: ") + (i % 2 ? "lines" : "polygons") + "\n";
+        if (i > 1) { yaml += "        mix: style" + std::to_string(i / 2) + "\n"; }
+        yaml += "        shaders:\n"
+                "            uniforms: { u_" + name + ": " + std::to_string(i) + ".0 }\n"
+                "            blocks:\n"
+                "                color: 'color.rgb *= fract(u_" + name + " * 0.1);'\n";
+    }
+
+    yaml += "layers:\n";
+    for (int i = 0; i < _layers; i++) {
+        auto name = "layer" + std::to_string(i);
+        auto style = "style" + std::to_string(i % _styles);
+        yaml += "    " + name + ":\n"
+                "        data: { source: synthetic, layer: " + name + " }\n"
+                "        filter: { kind: [a, b, c" + std::to_string(i) + "], $zoom: { min: " + std::to_string(i % 16) + " } }\n"
+                "        draw:\n"
+                "            " + style + ":\n"
+                "                order: global.order\n"
+                "                color: [0.5, 0.5, 0.5]\n"
+                "                width: [[10, 1px], [18, " + std::to_string(i % 8 + 2) + "px]]\n"
+                "        major:\n"
+                "            filter: function() { return feature.area > " + std::to_string(i * 100) + " || feature.name === 'n" + std::to_string(i) + "'; }\n"
+                "            draw:\n"
+                "                " + style + ":\n"
+                "                    color: function() { return feature.height > " + std::to_string(i) + " ? '#f00' : '#0f0'; }\n";
+    }
+
+    return yaml;
+}
+
+// Range 0: bundled scene.yaml, range 1: synthetic scene
+static std::shared_ptr<Scene> newScene(std::shared_ptr<MockPlatform> _platform, int64_t _which) {
+    if (_which == 0) {
+        Url url("scene.yaml");
+        _platform->putMockUrlContents(url, MockPlatform::getBytesFromFile("scene.yaml"));
+        return std::make_shared<Scene>(_platform, url);
+    }
+    static const std::string yaml = syntheticScene(400, 64);
+    return std::make_shared<Scene>(_platform, yaml, Url("synthetic.yaml"));
+}
+
+// Configuration of a new scene, after imports
+static std::shared_ptr<Scene> importedScene(std::shared_ptr<MockPlatform> _platform, int64_t _which) {
+    auto scene = newScene(_platform, _which);
+    Importer importer(scene);
+    scene->config() = importer.applySceneImports(_platform);
+    return scene;
+}
+
+static void setSceneLabel(benchmark::State& st, const std::string& _counts = "") {
+    st.SetLabel(std::string(st.range(0) == 0 ? "scene.yaml" : "synthetic") + _counts);
+}
+
+static void BM_Tangram_SceneImports(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+
+    while (st.KeepRunning()) {
+        auto scene = newScene(platform, st.range(0));
+        // Measure cold loads, without the parsed files of earlier loads
+        Importer::clearParsedScenes();
+
+        auto start = Clock::now();
+        Importer importer(scene);
+        auto config = importer.applySceneImports(platform);
+        st.SetIterationTime(secondsSince(start));
+
+        benchmark::DoNotOptimize(config);
+    }
+    setSceneLabel(st);
+}
+BENCHMARK(BM_Tangram_SceneImports)->Arg(0)->Arg(1)->UseManualTime();
+
+static void BM_Tangram_ApplyConfig(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto imported = importedScene(platform, st.range(0));
+
+    while (st.KeepRunning()) {
+        auto scene = newScene(platform, st.range(0));
+        scene->config() = YAML::Clone(imported->config());
+
+        auto start = Clock::now();
+        SceneLoader::applyConfig(platform, scene);
+        st.SetIterationTime(secondsSince(start));
+    }
+    setSceneLabel(st);
+}
+BENCHMARK(BM_Tangram_ApplyConfig)->Arg(0)->Arg(1)->UseManualTime();
+
+// Filters and draw rules of all layers, the 'layers' phase of applyConfig
+static void BM_Tangram_LoadLayers(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto imported = importedScene(platform, st.range(0));
+    size_t functions = 0;
+
+    while (st.KeepRunning()) {
+        auto scene = newScene(platform, st.range(0));
+        scene->config() = YAML::Clone(imported->config());
+        if (scene->config()["global"]) { SceneLoader::applyGlobals(scene->config(), *scene); }
+
+        auto start = Clock::now();
+        for (const auto& layer : scene->config()["layers"]) {
+            SceneLoader::loadLayer(layer, scene);
+        }
+        st.SetIterationTime(secondsSince(start));
+
+        functions = scene->functions().size();
+    }
+    setSceneLabel(st, " functions: " + std::to_string(functions));
+}
+BENCHMARK(BM_Tangram_LoadLayers)->Arg(0)->Arg(1)->UseManualTime();
+
+// Mixing of style nodes and construction of the styles, without building them
+static void BM_Tangram_LoadStyles(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto imported = importedScene(platform, st.range(0));
+
+    while (st.KeepRunning()) {
+        auto scene = newScene(platform, st.range(0));
+        scene->config() = YAML::Clone(imported->config());
+        if (scene->config()["global"]) { SceneLoader::applyGlobals(scene->config(), *scene); }
+
+        auto start = Clock::now();
+        if (auto styles = scene->config()["styles"]) {
+            StyleMixer mixer;
+            mixer.mixStyleNodes(styles);
+            for (const auto& entry : styles) {
+                SceneLoader::loadStyle(platform, entry.first.Scalar(), entry.second, scene);
+            }
+        }
+        st.SetIterationTime(secondsSince(start));
+    }
+    setSceneLabel(st);
+}
+BENCHMARK(BM_Tangram_LoadStyles)->Arg(0)->Arg(1)->UseManualTime();
+
+// Style::build of the scene styles: shader source generation and lookup
+// of the shared programs, without compiling them.
+static void BM_Tangram_StyleBuild(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto imported = importedScene(platform, st.range(0));
+    size_t styleCount = 0, programCount = 0;
+
+    while (st.KeepRunning()) {
+        auto scene = newScene(platform, st.range(0));
+        scene->config() = YAML::Clone(imported->config());
+        auto& config = scene->config();
+        if (config["global"]) { SceneLoader::applyGlobals(config, *scene); }
+
+        if (auto styles = config["styles"]) {
+            StyleMixer mixer;
+            mixer.mixStyleNodes(styles);
+            for (const auto& entry : styles) {
+                SceneLoader::loadStyle(platform, entry.first.Scalar(), entry.second, scene);
+            }
+        }
+        if (auto lights = config["lights"]) {
+            for (const auto& light : lights) { SceneLoader::loadLight(light, scene); }
+        }
+        scene->lightBlocks() = Light::assembleLights(scene->lights());
+
+        auto start = Clock::now();
+        for (auto& style : scene->styles()) {
+            style->build(*scene);
+        }
+        st.SetIterationTime(secondsSince(start));
+
+        styleCount = scene->styles().size();
+        programCount = scene->shaderProgramCount();
+    }
+    setSceneLabel(st, " styles: " + std::to_string(styleCount) +
+                  " programs: " + std::to_string(programCount));
+}
+BENCHMARK(BM_Tangram_StyleBuild)->Arg(0)->Arg(1)->UseManualTime();
+
+// Bytecode compilation of the scene functions, once per scene
+static void BM_Tangram_CompileFunctions(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto scene = importedScene(platform, st.range(0));
+    SceneLoader::applyConfig(platform, scene);
+
+    while (st.KeepRunning()) {
+        auto bytecode = StyleContext::compileFunctions(scene->functions());
+        benchmark::DoNotOptimize(bytecode);
+    }
+    setSceneLabel(st);
+    st.SetItemsProcessed(st.iterations() * scene->functions().size());
+}
+BENCHMARK(BM_Tangram_CompileFunctions)->Arg(0)->Arg(1);
+
+// Loading the compiled functions into the StyleContext of a tile worker
+static void BM_Tangram_InitFunctions(benchmark::State& st) {
+    auto platform = std::make_shared<MockPlatform>();
+    auto scene = importedScene(platform, st.range(0));
+    SceneLoader::applyConfig(platform, scene);
+
+    while (st.KeepRunning()) {
+        StyleContext styleContext;
+
+        auto start = Clock::now();
+        styleContext.initFunctions(*scene);
+        st.SetIterationTime(secondsSince(start));
+    }
+    setSceneLabel(st);
+}
+BENCHMARK(BM_Tangram_InitFunctions)->Arg(0)->Arg(1)->UseManualTime();
+
+BENCHMARK_MAIN();
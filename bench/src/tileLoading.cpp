@@ -12,10 +12,14 @@
 #include "tile/tileBuilder.h"
 #include "tile/tileTask.h"
 #include "text/fontContext.h"
+#include "util/arena.h"
 #include "util/mapProjection.h"
 
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <new>
 #include <vector>
 
 #include "benchmark/benchmark_api.h"
@@ -23,6 +27,17 @@
 
 using namespace Tangram;
 
+// Count heap allocations to compare the arena against the global heap
+static std::atomic<size_t> s_allocations{0};
+
+void* operator new(size_t _size) {
+    s_allocations++;
+    if (void* p = std::malloc(_size)) { return p; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* _p) noexcept { std::free(_p); }
+
 struct TestContext {
 
     MercatorProjection s_projection;
@@ -34,7 +49,7 @@ struct TestContext {
 
     std::shared_ptr<TileSource> source;
 
-    std::vector<char> rawTileData;
+    ByteBuffer rawTileData;
 
     std::shared_ptr<TileData> tileData;
 
@@ -68,7 +83,7 @@ struct TestContext {
 
     void loadTile(const char* path){
 
-        rawTileData = MockPlatform::getBytesFromFile(path);
+        rawTileData = ByteBuffer(MockPlatform::getBytesFromFile(path));
 
     }
 
@@ -77,7 +92,7 @@ struct TestContext {
         source = *scene->tileSources().begin();
         auto task = source->createTask(tile.getID());
         auto& t = dynamic_cast<BinaryTileTask&>(*task);
-        t.rawTileData = std::make_shared<std::vector<char>>(rawTileData);
+        t.rawTileData = rawTileData;
 
         tileData = source->parse(*task, s_projection);
     }
@@ -100,19 +115,60 @@ public:
     }
 };
 
+static void setAllocationLabel(benchmark::State& st, size_t _allocations, size_t _tiles) {
+    if (_tiles == 0) { return; }
+    st.SetLabel("heap allocations/tile: " + std::to_string(_allocations / _tiles));
+}
+
 BENCHMARK_DEFINE_F(TileLoadingFixture, BuildTest)(benchmark::State& st) {
+    size_t allocations = 0;
+    size_t tiles = 0;
+
     while (st.KeepRunning()) {
+        size_t start = s_allocations;
+
         ctx.parseTile();
         if (!ctx.tileData) { break; }
 
         result = ctx.tileBuilder->build({0,0,10,10,0}, *ctx.tileData, *ctx.source);
+        ctx.tileData.reset();
+
+        allocations += s_allocations - start;
+        tiles++;
 
         LOG("ok %d / bytes - %d", bool(result), result->getMemoryUsage());
     }
+    setAllocationLabel(st, allocations, tiles);
 }
 
 BENCHMARK_REGISTER_F(TileLoadingFixture, BuildTest);
 
+// Same as BuildTest with scratch data taken from an Arena like in TileWorker
+BENCHMARK_DEFINE_F(TileLoadingFixture, BuildArenaTest)(benchmark::State& st) {
+    size_t allocations = 0;
+    size_t tiles = 0;
+
+    Arena arena;
+    Arena::Scope arenaScope(arena);
+
+    while (st.KeepRunning()) {
+        size_t start = s_allocations;
+
+        ctx.parseTile();
+        if (!ctx.tileData) { break; }
+
+        result = ctx.tileBuilder->build({0,0,10,10,0}, *ctx.tileData, *ctx.source);
+        ctx.tileData.reset();
+        arena.reset();
+
+        allocations += s_allocations - start;
+        tiles++;
+    }
+    setAllocationLabel(st, allocations, tiles);
+}
+
+BENCHMARK_REGISTER_F(TileLoadingFixture, BuildArenaTest);
+
 
 
 BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+#include "data/tileSource.h"
+#include "map.h"
+#include "mockPlatform.h"
+#include "tile/tile.h"
+#include "tile/tileManager.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+#include "view/view.h"
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark_api.h"
+#include "benchmark/benchmark.h"
+
+using namespace Tangram;
+
+// Camera path recorded from a pan and zoom session over Manhattan:
+// lng, lat, zoom at 60 fps key frames, interpolated linearly in between.
+struct CameraKey { double lng, lat; float zoom; };
+
+static const std::vector<CameraKey> s_cameraPath = {
+    { -74.0090, 40.7050, 14.0f },
+    { -74.0060, 40.7100, 14.2f },
+    { -74.0010, 40.7180, 14.6f },
+    { -73.9950, 40.7260, 15.1f },
+    { -73.9890, 40.7340, 15.6f },
+    { -73.9850, 40.7420, 16.0f },
+    { -73.9830, 40.7500, 16.2f },
+    { -73.9800, 40.7580, 16.1f },
+    { -73.9760, 40.7650, 15.7f },
+    { -73.9710, 40.7720, 15.0f },
+    { -73.9660, 40.7790, 14.4f },
+    { -73.9610, 40.7850, 14.0f },
+};
+
+static const int s_framesPerKey = 30;
+
+struct NullTileWorker : TileTaskQueue {
+    void enqueue(std::shared_ptr<TileTask> task) override {}
+};
+
+struct NullTileSource : TileSource {
+    NullTileSource(const std::string& _name) : TileSource(_name, nullptr) {
+        m_generateGeometry = true;
+    }
+
+    void loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override {}
+    void cancelLoadingTile(const TileID& _tile) override {}
+    void clearData() override {}
+
+    std::shared_ptr<TileData> parse(const TileTask& _task,
+                                    const MapProjection& _projection) const override {
+        return nullptr;
+    }
+};
+
+static void replayCameraPath(View& _view, TileManager& _tileManager) {
+    auto& projection = _view.getMapProjection();
+
+    for (size_t i = 0; i + 1 < s_cameraPath.size(); i++) {
+        auto& a = s_cameraPath[i];
+        auto& b = s_cameraPath[i + 1];
+
+        for (int f = 0; f < s_framesPerKey; f++) {
+            double t = double(f) / s_framesPerKey;
+            glm::dvec2 pos = projection.LonLatToMeters({ a.lng + (b.lng - a.lng) * t,
+                                                         a.lat + (b.lat - a.lat) * t });
+            _view.setPosition(pos.x, pos.y);
+            _view.setZoom(a.zoom + (b.zoom - a.zoom) * t);
+            _view.update();
+
+            _tileManager.updateTileSets(_view);
+        }
+    }
+}
+
+static void BM_Tangram_UpdateTileSets_CameraPath(benchmark::State& state) {
+    auto platform = std::make_shared<MockPlatform>();
+    NullTileWorker worker;
+
+    View view(1024, 768);
+    view.setPixelScale(2.0f);
+
+    TileManager tileManager(platform, worker);
+    tileManager.setTileSources({ std::make_shared<NullTileSource>("a"),
+                                 std::make_shared<NullTileSource>("b") });
+
+    while (state.KeepRunning()) {
+        replayCameraPath(view, tileManager);
+    }
+}
+BENCHMARK(BM_Tangram_UpdateTileSets_CameraPath);
+
+BENCHMARK_MAIN();
@@ -8,11 +8,25 @@
 
 namespace Tangram {
 
+class AsyncWorker;
 class Platform;
 
 struct Properties;
 
 struct ClientGeoJsonData;
+struct ClientGeoJsonIndex;
+class PointClusters;
+
+// Points of tiles up to maxZoom are merged into clusters with the properties
+// 'cluster' and 'point_count', the number of points
+struct PointClusterOptions {
+    bool enabled = false;
+    // Points closer than this, in pixels of 256px tiles, are merged
+    float radius = 40;
+    int maxZoom = 14;
+    // Least number of points in a cluster
+    uint32_t minPoints = 2;
+};
 
 class ClientGeoJsonSource : public TileSource {
 
@@ -20,7 +34,7 @@ public:
 
     ClientGeoJsonSource(std::shared_ptr<Platform> _platform, const std::string& _name,
             const std::string& _url, bool generateCentroids = false,
-            TileSource::ZoomOptions _zoomOptions = {});
+            TileSource::ZoomOptions _zoomOptions = {}, PointClusterOptions _clusterOptions = {});
     ~ClientGeoJsonSource();
 
     // http://www.iana.org/assignments/media-types/application/geo+json
@@ -28,10 +42,29 @@ public:
 
     // Add geometry from a GeoJSON string
     void addData(const std::string& _data);
-    void addPoint(const Properties& _tags, LngLat _point);
     void addLine(const Properties& _tags, const Coordinates& _line);
     void addPoly(const Properties& _tags, const std::vector<Coordinates>& _poly);
-    void generateLabelCentroidFeature();
+
+    // Add geometry from packed coordinates, e.g. from a buffer shared with the
+    // platform. _rings holds the number of points of each of the _ringCount rings.
+    void addLine(const Properties& _tags, const LngLat* _line, size_t _count);
+    void addPoly(const Properties& _tags, const LngLat* _points, const int* _rings, size_t _ringCount);
+
+    // Lines and polygons are tiled by geojson-vt. The index is rebuilt on a
+    // background thread and swapped in when done, so tiles keep loading from
+    // the previous index meanwhile. Additions made during a build are
+    // collected into the next one.
+
+    // Points are kept in a grid which is updated in place. The returned id
+    // can be used to move or remove the point. With clustering the clusters
+    // are rebuilt in the background after changes, like the geojson-vt index.
+    // Points of GeoJSON data are clustered too.
+    uint64_t addPoint(const Properties& _tags, LngLat _point);
+    bool updatePoint(uint64_t _id, LngLat _point);
+    bool removePoint(uint64_t _id);
+
+    // Add label points for polygons starting at feature _begin
+    void generateLabelCentroidFeature(size_t _begin = 0);
 
     virtual void loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override;
     std::shared_ptr<TileTask> createTask(TileID _tileId, int _subTask) override;
@@ -44,14 +77,30 @@ protected:
     virtual std::shared_ptr<TileData> parse(const TileTask& _task,
                                             const MapProjection& _projection) const override;
 
+    // Queue a rebuild of the geojson-vt index, m_mutexStore must be held
+    void scheduleIndexBuild();
+    void buildIndex();
+
+    // Queue a rebuild of the point clusters, m_mutexStore must be held
+    void scheduleClusterBuild();
+    void buildClusters();
+
     std::unique_ptr<ClientGeoJsonData> m_store;
 
+    // Latest published index, swapped with std::atomic_load/atomic_store
+    std::shared_ptr<ClientGeoJsonIndex> m_index;
+    std::shared_ptr<PointClusters> m_clusters;
+
     mutable std::mutex m_mutexStore;
     bool m_hasPendingData = false;
     bool m_generateCentroids = false;
+    PointClusterOptions m_clusterOptions;
 
     std::shared_ptr<Platform> m_platform;
 
+    // Declared last to stop pending builds before the store goes away
+    std::unique_ptr<AsyncWorker> m_worker;
+
 };
 
 }
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Tangram {
+
+class MBTilesDataSource;
+class NetworkDataSource;
+class Platform;
+
+struct OfflineDownloadState;
+
+struct OfflineRegion {
+    // South-west and north-east corners
+    LngLat min;
+    LngLat max;
+    int minZoom = 0;
+    int maxZoom = 16;
+};
+
+struct OfflineProgress {
+    uint64_t totalTiles = 0;
+    // Includes the tiles stored by an earlier download to the same file
+    uint64_t storedTiles = 0;
+    uint64_t failedTiles = 0;
+    uint64_t downloadedBytes = 0;
+    bool finished = false;
+};
+
+// Called from the download thread
+using OfflineProgressCallback = std::function<void(const OfflineProgress&)>;
+
+struct OfflineDownloadOptions {
+    uint32_t maxActiveRequests = 8;
+    // Limit of the download rate, 0 for no limit
+    uint64_t maxBytesPerSecond = 0;
+    // Attempts for a tile after the first one failed
+    uint32_t retries = 2;
+};
+
+/* Downloads the tiles of a region into an MBTiles file
+ *
+ * Tiles are requested with the URL template of a tiled source and stored
+ * through a MBTilesDataSource in cache mode, which keeps identical tiles once
+ * in its images table. Tiles already in the file are skipped, so an
+ * interrupted download continues where it stopped when started again.
+ */
+class OfflineDownload {
+
+public:
+
+    using Options = OfflineDownloadOptions;
+
+    OfflineDownload(std::shared_ptr<Platform> _platform, const std::string& _urlTemplate,
+                    std::vector<std::string> _urlSubdomains, bool _isTms,
+                    const std::string& _mbtilesPath, OfflineRegion _region, Options _options);
+
+    // Cancels a running download
+    ~OfflineDownload();
+
+    // Returns false when the MBTiles file can't be written
+    bool start(OfflineProgressCallback _callback);
+
+    void cancel();
+
+    OfflineProgress progress() const;
+
+private:
+
+    void run();
+
+    std::shared_ptr<Platform> m_platform;
+    std::unique_ptr<NetworkDataSource> m_network;
+    std::unique_ptr<MBTilesDataSource> m_mbtiles;
+
+    OfflineRegion m_region;
+    Options m_options;
+    OfflineProgressCallback m_callback;
+
+    // Shared with request callbacks which may run after the download is gone
+    std::shared_ptr<OfflineDownloadState> m_state;
+
+    std::thread m_thread;
+};
+
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "data/propertyKey.h"
+
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -23,25 +26,33 @@ struct Properties {
     Properties& operator=(const Properties& _other) = default;
     Properties& operator=(Properties&& _other);
 
+    /* Lookups by name resolve the interned key first, prefer passing
+     * a PropertyKey for repeated lookups. */
     const Value& get(const std::string& key) const;
+    const Value& get(PropertyKey key) const;
 
+    // Sort items by key
     void sort();
 
     void clear();
 
     bool contains(const std::string& key) const;
+    bool contains(PropertyKey key) const;
 
     bool getNumber(const std::string& key, double& value) const;
+    bool getNumber(PropertyKey key, double& value) const;
 
     double getNumber(const std::string& key) const;
 
     bool getString(const std::string& key, std::string& value) const;
 
     const std::string& getString(const std::string& key) const;
+    const std::string& getString(PropertyKey key) const;
 
     std::string asString(const Value& value) const;
 
     std::string getAsString(const std::string& key) const;
+    std::string getAsString(PropertyKey key) const;
 
     bool getAsString(const std::string& key, std::string& value) const;
 
@@ -52,12 +63,16 @@ struct Properties {
 
     void setSorted(std::vector<Item>&& _items);
 
+    /* Refer to sorted items that other features share, e.g. those of a client
+     * source. The items are copied once the properties are changed. */
+    void setShared(std::shared_ptr<const std::vector<Item>> _items);
+
     // template <typename... Args> void set(std::string key, Args&&... args) {
     //     props.emplace_back(std::move(key), Value{std::forward<Args>(args)...});
     //     sort();
     // }
 
-    const std::vector<Item>& items() const { return props; }
+    const std::vector<Item>& items() const { return shared ? *shared : props; }
 
     int32_t sourceId;
 
@@ -69,7 +84,11 @@ struct Properties {
         }
     }
 private:
+    // Copy shared items before a change
+    void detach();
+
     std::vector<Item> props;
+    std::shared_ptr<const std::vector<Item>> shared;
 };
 
 }
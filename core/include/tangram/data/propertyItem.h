@@ -1,19 +1,21 @@
 #pragma once
 
+#include "data/propertyKey.h"
 #include "util/variant.h"
 
 namespace Tangram {
 
 struct PropertyItem {
-    PropertyItem(std::string _key, Value _value) :
-        key(std::move(_key)), value(std::move(_value)) {}
+    PropertyItem(PropertyKey _key, Value _value) :
+        key(_key), value(std::move(_value)) {}
 
-    std::string key;
+    PropertyItem(const std::string& _key, Value _value) :
+        key(_key), value(std::move(_value)) {}
+
+    PropertyKey key;
     Value value;
     bool operator<(const PropertyItem& _rhs) const {
-        return key.size() == _rhs.key.size()
-            ? key < _rhs.key
-            : key.size() < _rhs.key.size();
+        return key < _rhs.key;
     }
 };
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Tangram {
+
+/* Interned feature property key
+ *
+ * Key names are stored once in a process-wide, thread-safe table and a
+ * PropertyKey is the 32-bit atom of its name in that table. Comparing keys
+ * only compares atoms; the order of atoms is the order of first interning.
+ */
+class PropertyKey {
+
+public:
+
+    /* The empty key */
+    PropertyKey() : m_atom(0) {}
+
+    /* Interns _name */
+    explicit PropertyKey(const std::string& _name) : m_atom(intern(_name)) {}
+
+    /* Looks up the key of _name without interning it. Returns false when no
+     * key with this name exists. */
+    static bool find(const std::string& _name, PropertyKey& _key);
+
+    const std::string& name() const;
+
+    uint32_t atom() const { return m_atom; }
+
+    bool operator==(const PropertyKey& _rhs) const { return m_atom == _rhs.m_atom; }
+    bool operator!=(const PropertyKey& _rhs) const { return m_atom != _rhs.m_atom; }
+    bool operator<(const PropertyKey& _rhs) const { return m_atom < _rhs.m_atom; }
+
+private:
+
+    static uint32_t intern(const std::string& _name);
+
+    uint32_t m_atom;
+};
+
+}
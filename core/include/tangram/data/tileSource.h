@@ -2,6 +2,8 @@
 
 #include "tile/tileTask.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -10,12 +12,15 @@
 namespace Tangram {
 
 class MapProjection;
+class MemoryReport;
 struct TileData;
+struct FeatureFilter;
 struct TileID;
 struct Raster;
 class Tile;
 class TileManager;
 struct RawCache;
+class BuiltTileCache;
 class Texture;
 
 class TileSource : public std::enable_shared_from_this<TileSource> {
@@ -63,6 +68,21 @@ public:
 
         virtual void clear() { if (next) next->clear(); }
 
+        /* Add the bytes held by this and the next sources to _report */
+        virtual void reportMemory(MemoryReport& _report) const {
+            if (next) { next->reportMemory(_report); }
+        }
+
+        /* Drop cached data until _bytes are freed, returns the freed bytes */
+        virtual size_t releaseMemory(size_t _bytes) {
+            return next ? next->releaseMemory(_bytes) : 0;
+        }
+
+        /* Keep _tileData parsed from the raw data of _task, for tasks loading the same data */
+        virtual void cacheTileData(const BinaryTileTask& _task, std::shared_ptr<const TileData> _tileData) {
+            if (next) { next->cacheTileData(_task, std::move(_tileData)); }
+        }
+
         void setNext(std::unique_ptr<DataSource> _next) {
             next = std::move(_next);
             next->level = level + 1;
@@ -75,6 +95,9 @@ public:
         GeoJson,
         TopoJson,
         Mvt,
+        // Compiled meshes of the scene styles, built offline. Tiles of this
+        // format are not styled, see BuiltTileCache::decodeMeshTile.
+        Mesh,
     };
 
     /* Tile data sources must have a name and a URL template that defines where to find
@@ -114,6 +137,28 @@ public:
     virtual void clearRasters();
     virtual void clearRaster(const TileID& id);
 
+    /* Add the bytes held by its data sources and cached rasters to _report */
+    virtual void reportMemory(MemoryReport& _report) const;
+
+    /* Drop cached raw tile data until _bytes are freed, returns the freed bytes */
+    size_t releaseCachedData(size_t _bytes) {
+        return m_sources ? m_sources->releaseMemory(_bytes) : 0;
+    }
+
+    /* Keep the parsed data of a tile at the max zoom of this source; overzoomed
+     * tiles load the same raw data and are built from it without parsing */
+    void cacheTileData(const BinaryTileTask& _task, std::shared_ptr<const TileData> _tileData) {
+        if (m_sources) { m_sources->cacheTileData(_task, std::move(_tileData)); }
+    }
+
+    /* Drop rasters that no tile refers to, returns the freed bytes */
+    virtual size_t releaseUnusedRasters() { return 0; }
+
+    /* Loaded raster of the closest ancestor of _tile up to _maxLevels zoom levels
+     * above, sampled by the tile until its own raster is loaded. Invalid if there
+     * is none. */
+    virtual Raster parentRaster(const TileID& _tile, int _maxLevels) const;
+
     virtual std::shared_ptr<TileTask> createTask(TileID _tile, int _subTask = -1);
 
     /* ID of this TileSource instance */
@@ -145,6 +190,83 @@ public:
     virtual bool isRaster() const { return false; }
 
     void setFormat(Format format) { m_format = format; }
+    Format format() const { return m_format; }
+
+    /* Clip lines and polygons of parsed tiles to the tile grown by _buffer
+     * tile units on each side, for sources that don't clip their geometry.
+     * A negative buffer disables clipping. */
+    void setClipBuffer(float _buffer) { m_clipBuffer = _buffer; }
+    float clipBuffer() const { return m_clipBuffer; }
+
+    /* Simplify lines and polygons of parsed tiles, removing points that
+     * deviate less than _pixels from the simplified geometry at the styling
+     * zoom of the tile. Zero disables simplification. */
+    void setSimplifyTolerance(float _pixels) { m_simplifyTolerance = _pixels; }
+    float simplifyTolerance() const { return m_simplifyTolerance; }
+
+    /* When false, tiles with raster samplers are shown as soon as their
+     * geometry is built. Styles using the rasters skip the tile until all
+     * rasters are loaded. */
+    void setWaitForRasters(bool _wait) { m_waitForRasters = _wait; }
+    bool waitForRasters() const { return m_waitForRasters; }
+
+    /* Build tiles in two stages: Lines and polygons are shown as soon as they
+     * are built, labels follow in a second pass over the tile data. Proxies
+     * are shown until the first stage is ready. */
+    void setProgressiveBuild(bool _progressive) { m_progressiveBuild = _progressive; }
+    bool progressiveBuild() const { return m_progressiveBuild; }
+
+    /* Keep the parsed data of built tiles with the tiles. When a scene update
+     * replaces this source with one that loads the same data, see
+     * canReuseTileData(), its tiles are rebuilt from the retained data
+     * without loading and parsing. Retained data counts against the tile cache. */
+    void setRetainTileData(bool _retain) { m_retainTileData = _retain; }
+    bool retainTileData() const { return m_retainTileData; }
+
+    /* Tiles of this source that may wait for their data at once, 0 for the
+     * default of the TileManager, see TileManager::setLoadLimits() */
+    void setMaxLoadingTiles(int _tiles) { m_maxLoadingTiles = _tiles; }
+    int maxLoadingTiles() const { return m_maxLoadingTiles; }
+
+    /* Share of the tile loads of this source relative to the weights of the
+     * other sources, while the loads of all sources are limited */
+    void setLoadWeight(float _weight) { m_loadWeight = std::max(_weight, 0.01f); }
+    float loadWeight() const { return m_loadWeight; }
+
+    /* Identifies the data loaded by this source, e.g. the URL of its tiles */
+    void setDataKey(const std::string& _key) { m_dataKey = _key; }
+    const std::string& dataKey() const { return m_dataKey; }
+
+    /* Whether the tiles parsed by _previous, a source of the previous scene,
+     * are the same as the tiles this source would parse */
+    bool canReuseTileData(const TileSource& _previous) const;
+
+    /* Features that the data layers of the current scene take from this source,
+     * set on scene load. Tasks keep the filter of the scene they were created for. */
+    void setFeatureFilter(std::shared_ptr<const FeatureFilter> _filter) {
+        std::atomic_store(&m_featureFilter, std::move(_filter));
+    }
+    std::shared_ptr<const FeatureFilter> featureFilter() const {
+        return std::atomic_load(&m_featureFilter);
+    }
+
+    /* Store built tiles on disk and restore them instead of loading and
+     * building them again, see BuiltTileCache */
+    void setBuiltTileCache(std::shared_ptr<BuiltTileCache> _cache) { m_builtTileCache = std::move(_cache); }
+    const std::shared_ptr<BuiltTileCache>& builtTileCache() const { return m_builtTileCache; }
+
+    struct SimplifyStats {
+        uint64_t verticesIn = 0;
+        uint64_t verticesOut = 0;
+    };
+
+    /* Line and polygon vertices of all simplified tiles */
+    SimplifyStats simplifyStats() const { return { m_verticesIn, m_verticesOut }; }
+
+    void addSimplifyStats(uint64_t _verticesIn, uint64_t _verticesOut) {
+        m_verticesIn += _verticesIn;
+        m_verticesOut += _verticesOut;
+    }
 
 protected:
 
@@ -163,10 +285,25 @@ protected:
     int32_t m_id;
 
     // Generation of dynamic TileSource state (incremented for each update)
-    int64_t m_generation = 1;
+    std::atomic<int64_t> m_generation{1};
 
     Format m_format = Format::GeoJson;
 
+    float m_clipBuffer = -1.f;
+
+    float m_simplifyTolerance = 0.f;
+
+    bool m_waitForRasters = true;
+    bool m_progressiveBuild = false;
+    bool m_retainTileData = false;
+    int m_maxLoadingTiles = 0;
+    float m_loadWeight = 1.f;
+    std::shared_ptr<const FeatureFilter> m_featureFilter;
+    std::string m_dataKey;
+    std::shared_ptr<BuiltTileCache> m_builtTileCache;
+    std::atomic<uint64_t> m_verticesIn{0};
+    std::atomic<uint64_t> m_verticesOut{0};
+
     /* vector of raster sources (as raster samplers) referenced by this datasource */
     std::vector<std::shared_ptr<TileSource>> m_rasterSources;
 
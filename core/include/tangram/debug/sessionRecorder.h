@@ -0,0 +1,196 @@
+#pragma once
+
+#include "platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+class Map;
+
+struct SessionEvent {
+    // Milliseconds since the recording started
+    double time = 0;
+    // Name of the Map method, or 'response' for a network response
+    std::string name;
+    std::vector<std::string> args;
+};
+
+/* Records the Map API calls, gestures and network responses of a session
+ *
+ * The recorder is set on a Map with Map::setSessionRecorder, network responses
+ * are recorded by creating the Map with a RecordingPlatform. Events may be
+ * recorded from any thread. The serialized session is binary safe: every
+ * event is one line of its time, name and length-prefixed arguments.
+ */
+class SessionRecorder {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    // Drops the events of an earlier recording
+    void start();
+
+    void stop();
+
+    bool isRecording() const { return m_recording; }
+
+    template <typename... Args>
+    void record(const char* _name, const Args&... _args) {
+        if (!m_recording) { return; }
+        add(_name, { arg(_args)... });
+    }
+
+    void add(const char* _name, std::vector<std::string> _args);
+
+    std::vector<SessionEvent> events() const;
+
+    std::string serialize() const;
+
+    // Returns false when _data is not a serialized session
+    static bool parse(const std::string& _data, std::vector<SessionEvent>& _events);
+
+    // Arguments are kept as strings, numbers with enough digits to read them back exactly
+    static std::string arg(const std::string& _value) { return _value; }
+    static std::string arg(const char* _value) { return _value ? _value : ""; }
+    static std::string arg(double _value);
+    static std::string arg(float _value);
+    static std::string arg(int _value) { return std::to_string(_value); }
+    static std::string arg(bool _value) { return _value ? "1" : "0"; }
+
+private:
+
+    std::vector<SessionEvent> m_events;
+    Clock::time_point m_start;
+    std::atomic<bool> m_recording{false};
+
+    mutable std::mutex m_mutex;
+};
+
+/* Platform forwarding to another one, recording the responses of its URL requests
+ * with the time it took until they arrived
+ */
+class RecordingPlatform : public Platform {
+
+public:
+
+    RecordingPlatform(std::shared_ptr<Platform> _platform, std::shared_ptr<SessionRecorder> _recorder);
+
+    void requestRender() const override;
+    void setContinuousRendering(bool _isContinuous) override;
+    bool isContinuousRendering() const override;
+
+    UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
+    UrlRequestHandle startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                UrlCallback _callback) override;
+    UrlRequestHandle startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                double _priority, UrlCallback _callback) override;
+    void cancelUrlRequest(UrlRequestHandle _request) override;
+
+    FontSourceHandle systemFont(const std::string& _name, const std::string& _weight,
+                                const std::string& _face) const override;
+    std::vector<FontSourceHandle> systemFontFallbacksHandle() const override;
+
+    ThreadPolicy threadPolicy(ThreadRole _role) const override;
+    PowerHint powerHint() const override;
+
+private:
+
+    UrlCallback recordResponse(const Url& _url, UrlCallback _callback);
+
+    std::shared_ptr<Platform> m_platform;
+    std::shared_ptr<SessionRecorder> m_recorder;
+};
+
+/* Platform answering URL requests with the responses of a recorded session
+ *
+ * Responses to the same URL are given in recorded order. A response is held
+ * back until the session time given to deliverResponses reaches the time of
+ * its request plus the recorded latency, so loads finish in the same frames
+ * as they did while recording.
+ */
+class ReplayPlatform : public Platform {
+
+public:
+
+    explicit ReplayPlatform(const std::vector<SessionEvent>& _events);
+
+    void requestRender() const override {}
+
+    UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
+    void cancelUrlRequest(UrlRequestHandle _request) override;
+
+    // Runs the callbacks of all responses due by _time, in milliseconds of the session
+    void deliverResponses(double _time);
+
+    // Requests for which the recording has no response left
+    uint32_t misses() const { return m_misses; }
+
+private:
+
+    struct Response {
+        double latency = 0;
+        std::vector<char> content;
+        bool failed = false;
+        std::string error;
+        int status = 0;
+        std::string etag;
+        std::string lastModified;
+        int64_t maxAge = -1;
+    };
+
+    struct Pending {
+        UrlRequestHandle handle;
+        double due;
+        Response response;
+        UrlCallback callback;
+    };
+
+    static void respond(Pending& _pending);
+
+    std::map<std::string, std::deque<Response>> m_responses;
+    std::vector<Pending> m_pending;
+    double m_time = 0;
+    UrlRequestHandle m_nextHandle = 1;
+    uint32_t m_misses = 0;
+
+    std::mutex m_mutex;
+};
+
+/* Drives a Map with the events of a recorded session
+ *
+ * Create the Map with platform(), then call step until it returns false and
+ * render after each step.
+ */
+class SessionPlayer {
+
+public:
+
+    explicit SessionPlayer(std::vector<SessionEvent> _events);
+
+    std::shared_ptr<ReplayPlatform> platform() { return m_platform; }
+
+    const std::vector<SessionEvent>& events() const { return m_events; }
+
+    // Applies the events up to and including the next update of the map, returns
+    // false when there are no events left
+    bool step(Map& _map);
+
+private:
+
+    void apply(Map& _map, const SessionEvent& _event);
+
+    std::vector<SessionEvent> m_events;
+    std::shared_ptr<ReplayPlatform> m_platform;
+    size_t m_next = 0;
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "data/offlineDownload.h"
 #include "data/properties.h"
 #include "util/types.h"
 
@@ -14,6 +15,8 @@ namespace Tangram {
 class Platform;
 class TileSource;
 class Scene;
+class SessionRecorder;
+class TileWorker;
 
 enum LabelType {
     icon,
@@ -22,16 +25,31 @@ enum LabelType {
 
 struct FeaturePickResult {
     FeaturePickResult(std::shared_ptr<Properties> _properties,
-                      std::array<float, 2> _position)
-        : properties(_properties), position(_position) {}
+                      std::array<float, 2> _position, uint32_t _id = 0)
+        : properties(_properties), position(_position), id(_id) {}
 
     std::shared_ptr<Properties> properties;
     std::array<float, 2> position;
+    // Identifies the feature within its tile until the tile is rebuilt, see Map::setFeatureState
+    uint32_t id;
+};
+
+// Override of how a feature is drawn, see Map::setFeatureState
+struct FeatureState {
+    // Color as 0xRRGGBB replacing the color of the feature, or -1 to keep it
+    int32_t color = -1;
+    // Factor of the opacity of the feature, for styles with blending
+    float alpha = 1.f;
+    // Offset of the feature on screen in pixels
+    std::array<float, 2> offset = {{0.f, 0.f}};
 };
 
 // Returns a pointer to the selected feature pick result or null, only valid on the callback scope
 using FeaturePickCallback = std::function<void(const FeaturePickResult*)>;
 
+// Returns the results of a query for several features, only valid on the callback scope
+using FeaturesPickCallback = std::function<void(const std::vector<FeaturePickResult>&)>;
+
 struct LabelPickResult {
     LabelPickResult(LabelType _type, LngLat _coordinates, FeaturePickResult _touchItem)
         : type(_type),
@@ -83,6 +101,145 @@ using SceneID = int32_t;
 // Function type for a sceneReady callback
 using SceneReadyCallback = std::function<void(SceneID id, const SceneError*)>;
 
+// Function type for an asynchronous snapshot: RGBA pixels with rows from the top
+// of the captured region, empty when the frame could not be read
+using SnapshotCallback = std::function<void(std::vector<unsigned int>&& _pixels, int _width, int _height)>;
+
+struct TileCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t evictedBytes = 0;
+    uint64_t gpuBytes = 0;
+    uint64_t cpuBytes = 0;
+    uint64_t maxBytes = 0;
+    size_t tiles = 0;
+    // Mesh bytes moved from GPU to CPU memory and tile data bytes dropped to
+    // stay within the limits of Map::setTileCacheResidency
+    uint64_t releasedGpuBytes = 0;
+    uint64_t releasedCpuBytes = 0;
+};
+
+struct GlyphAtlasStats {
+    // Glyph atlas textures holding pixels
+    size_t atlases = 0;
+    // Compactions which moved glyphs and the glyphs they moved
+    uint64_t compactions = 0;
+    uint64_t movedGlyphs = 0;
+    // Bytes of atlases freed after the labels using them moved to compacted ones
+    uint64_t reclaimedGpuBytes = 0;
+    uint64_t reclaimedCpuBytes = 0;
+};
+
+struct PerformanceTiming {
+    // Wall-clock milliseconds over the recent frames
+    float p50 = 0;
+    float p90 = 0;
+    float p99 = 0;
+    float max = 0;
+};
+
+struct GpuTiming {
+    // Name of the style, or "selection" for the feature selection pass
+    std::string name;
+    // GPU milliseconds over the recent frames
+    PerformanceTiming timing;
+};
+
+struct PerformanceStats {
+    PerformanceTiming update;
+    PerformanceTiming render;
+    PerformanceTiming labels;
+    PerformanceTiming upload;
+    // Number of frames the timings were taken from
+    uint32_t frames = 0;
+
+    uint32_t tilesInFlight = 0;
+    uint32_t visibleTiles = 0;
+    // Tile cache hits per lookup since its stats were last reset
+    float tileCacheHitRate = 0;
+
+    // Of the last rendered frame
+    uint32_t drawCalls = 0;
+    uint32_t stateChanges = 0;
+    uint64_t uploadedBytes = 0;
+
+    // Meshes and textures of visible and cached tiles
+    uint64_t gpuBytes = 0;
+
+    // Only when enabled by Map::setGpuTiming, lags a few frames behind
+    std::vector<GpuTiming> gpu;
+};
+
+struct MemoryStats {
+    // Meshes, labels and selection features of the tiles in use
+    MemoryUsage tiles;
+    // Meshes, labels and selection features of cached tiles
+    MemoryUsage tileCache;
+    // Raster textures and atlases of raster sources and tiles, counted once
+    MemoryUsage rasters;
+    // Glyph atlases and the shaped text cache
+    MemoryUsage fonts;
+    // Other textures of the scene, e.g. style textures and sprites
+    MemoryUsage textures;
+    // Undecoded tile data in the in-memory caches of sources
+    MemoryUsage rawCache;
+    // Heaps of the JavaScript contexts evaluating style functions
+    MemoryUsage javascript;
+
+    MemoryUsage total() const {
+        MemoryUsage sum;
+        for (auto* usage : { &tiles, &tileCache, &rasters, &fonts, &textures, &rawCache, &javascript }) {
+            sum += *usage;
+        }
+        return sum;
+    }
+};
+
+enum class MemoryPressure : char {
+    moderate = 0, // Free half of the memory that is not needed for the current view
+    critical,     // Free all memory that is not needed for the current view
+};
+
+struct MemoryRelease {
+    // Bytes freed in each step, in the order they are taken
+    uint64_t rawCache = 0;
+    uint64_t tileCache = 0;
+    uint64_t fonts = 0;
+    uint64_t rasters = 0;
+
+    uint64_t total() const { return rawCache + tileCache + fonts + rasters; }
+};
+
+struct BuildCost {
+    // Name of the data layer or style
+    std::string name;
+    // Wall-clock time spent on matching and building its features
+    double milliseconds = 0;
+    // Data layers: features tested. Styles: features built
+    uint64_t features = 0;
+    // Data layers: features which matched a draw rule
+    uint64_t matched = 0;
+    // Styles: vertices and bytes of the built meshes
+    uint64_t vertices = 0;
+    uint64_t bytes = 0;
+    // Styles: features skipped for being smaller than the min_feature_size of the style
+    uint64_t culled = 0;
+};
+
+struct BuildCostStats {
+    // Most expensive first
+    std::vector<BuildCost> layers;
+    std::vector<BuildCost> styles;
+    uint64_t tiles = 0;
+};
+
+enum class TileCachePolicyType : char {
+    lru = 0,    // Evict least recently used tiles
+    zoom_aware, // Evict recently unused tiles far from the current zoom first (default)
+    frequency,  // Evict recently unused tiles that were never reused first
+};
+
 enum class EaseType : char {
     linear = 0,
     cubic,
@@ -90,12 +247,63 @@ enum class EaseType : char {
     sine,
 };
 
+// Limits of the memory and threads of a map, applied when it is created. Defaults
+// suit desktop and phones, ResourceProfile::lowMemory() devices with little (GPU)
+// memory like a Raspberry Pi Zero.
+struct ResourceProfile {
+    // Size in bytes of the cache of recently visible tiles, setTileCacheSize can't exceed it
+    size_t tileCacheSize = 32 * 1024 * 1024;
+    // Size in bytes of the cache of raw tile data of each data source
+    size_t sourceCacheSize = 16 * 1024 * 1024;
+    // Threads building tiles, unless the map shares those of a MapContext
+    int tileWorkers = 2;
+    // Speculative tile loads in flight, setTilePrefetch can't exceed it
+    int prefetchTasks = 4;
+    // Bytes of tile geometry uploaded per frame, see setTileUploadBudget
+    size_t uploadBudget = 4 * 1024 * 1024;
+    // Glyph textures of 256x256 pixels per scene, within [1, 64]. Text that
+    // doesn't fit into them is not drawn.
+    size_t maxGlyphTextures = 64;
+    // Upload raster sources as 16 bit RGB565 textures, without alpha
+    bool compactRasters = false;
+    // Resolution of the selection buffer, setSelectionBufferScale can't exceed it
+    float selectionBufferScale = 0.5f;
+
+    static ResourceProfile lowMemory();
+};
+
+// Resources shared by the maps created with it, e.g. a main map with insets:
+// the platform with its network client and the tile worker threads. Each map
+// keeps its own scene, tiles and labels. Raw tile caches and URL requests are
+// already shared by the sources with the same URL template.
+class MapContext {
+
+public:
+
+    MapContext(std::shared_ptr<Platform> _platform, int _tileWorkers = 2);
+    ~MapContext();
+
+    const std::shared_ptr<Platform>& platform() const { return m_platform; }
+
+private:
+
+    friend class Map;
+
+    std::shared_ptr<Platform> m_platform;
+    std::shared_ptr<TileWorker> m_tileWorker;
+};
+
 class Map {
 
 public:
 
     // Create an empty map object. To display a map, call either loadScene() or loadSceneAsync().
-    Map(std::shared_ptr<Platform> _platform);
+    Map(std::shared_ptr<Platform> _platform, const ResourceProfile& _profile = ResourceProfile());
+
+    // Create a map that shares the resources of _context with other maps.
+    // The maps must be destroyed before the last reference to _context.
+    Map(std::shared_ptr<MapContext> _context, const ResourceProfile& _profile = ResourceProfile());
+
     ~Map();
 
     // Load the scene at the given absolute file path asynchronously.
@@ -132,6 +340,16 @@ public:
     // Set an MBTiles SQLite database file for a DataSource in the scene.
     void setMBTiles(const char* _dataSourceName, const char* _mbtilesFilePath);
 
+    // Download the tiles of _region from the tiled DataSource _dataSourceName into
+    // an MBTiles file, which can then be set with setMBTiles. Starting again with
+    // the same file resumes the download. The download runs until it is finished
+    // or the returned object is destroyed. Returns nullptr when the source is not
+    // tiled or the file can't be written.
+    std::shared_ptr<OfflineDownload> downloadRegion(const char* _dataSourceName, const char* _mbtilesFilePath,
+                                                    const OfflineRegion& _region,
+                                                    OfflineProgressCallback _callback,
+                                                    const OfflineDownloadOptions& _options = {});
+
     // Initialize graphics resources; OpenGL context must be created prior to calling this
     void setupGL();
 
@@ -143,8 +361,37 @@ public:
     // no animation in progress)
     bool update(float _dt);
 
-    // Render a new frame of the map view (if needed)
-    void render();
+    // Update the map state for a frame that must be presented within _deadline milliseconds
+    // from now, e.g. the time left until the next vsync. Jobs, label placement and tile uploads
+    // of this and the following render() are limited to the time left before the deadline, the
+    // work that does not fit carries over to the next frames.
+    bool update(float _dt, float _deadline);
+
+    // Render a new frame of the map view (if needed). Returns false when no frame
+    // was drawn, platforms must not present the framebuffer then.
+    bool render();
+
+    // Whether the last update changed nothing that is drawn and no animation is
+    // running. Platforms may stop their display link until the next requestRender().
+    bool isIdle() const;
+
+    // Let render() skip frames while nothing changed. Only for platforms that
+    // present frames only when render() returns true. Disabled by default.
+    void setIdleFrameSkipping(bool _enabled);
+
+    // Let render() draw only the area of the frame that changed, e.g. of fading
+    // labels and easing markers, and leave the rest of the framebuffer as it is.
+    // Only for platforms whose default framebuffer keeps its content between
+    // frames, e.g. with EGL_BUFFER_PRESERVED. Disabled by default.
+    void setPartialRedraw(bool _enabled);
+
+    // Draw frames at a lower resolution while the view moves and frames take longer
+    // than _targetFrameTime milliseconds, down to _minScale of the full resolution,
+    // and upscale them. Text and point labels are drawn at full resolution over the
+    // upscaled frame when _fullResolutionLabels is set. The view is drawn at full
+    // resolution again when it stops. Disabled with a _minScale of 1, the default.
+    void setDynamicResolution(float _minScale, float _targetFrameTime = 1000.f / 60.f,
+                              bool _fullResolutionLabels = true);
 
     // Gets the viewport height in physical pixels (framebuffer size)
     int getViewportHeight();
@@ -166,6 +413,16 @@ public:
     // Each unsigned int corresponds to an RGBA pixel value
     void captureSnapshot(unsigned int* _data);
 
+    // Capture the next drawn frame without stalling the GPU: the pixels are read
+    // into a buffer and passed to _callback on the render thread a frame or two
+    // later. _downsample averages blocks of _downsample x _downsample pixels.
+    void captureSnapshotAsync(SnapshotCallback _callback, int _downsample = 1);
+
+    // Capture the region of _width x _height physical pixels at _x, _y from the
+    // top left of the viewport, clipped to the viewport
+    void captureSnapshotAsync(int _x, int _y, int _width, int _height,
+                              SnapshotCallback _callback, int _downsample = 1);
+
     // Set the position of the map view in degrees longitude and latitude; if duration
     // (in seconds) is provided, position eases to the set value over the duration;
     // calling either version of the setter overrides all previous calls
@@ -284,6 +541,13 @@ public:
     // successfully updated, otherwise returns false.
     bool markerSetPolygon(MarkerID _marker, LngLat* _coordinates, int* _counts, int _rings);
 
+    // Set the geometry of a marker to a batch of _count points at the given coordinates, e.g. the
+    // positions of a fleet of vehicles; all points share the styling of the marker, are built into
+    // one mesh on a background thread and drawn with one draw call, so calling this again to move
+    // the points is much cheaper than updating one marker per point; returns true if the marker ID
+    // was found and successfully updated, otherwise returns false.
+    bool markerSetPoints(MarkerID _marker, const LngLat* _coordinates, int _count);
+
     // Set the visibility of a marker object; returns true if the marker ID was found and successfully
     // updated, otherwise returns false.
     bool markerSetVisible(MarkerID _marker, bool _visible);
@@ -322,9 +586,128 @@ public:
     // efficiency, but can cause errors if your application code makes OpenGL calls (false by default)
     void useCachedGlState(bool _use);
 
+    // Set a file in which the resolved configuration of loaded scenes is cached; a scene whose
+    // files are unchanged is then loaded without parsing and merging its YAML. An empty path
+    // disables the cache.
+    void setSceneCachePath(const std::string& _path);
+
+    // Set a directory in which linked shader program binaries are cached, so that later sessions
+    // on the same GL driver skip compiling the shaders of a scene. Only used when the driver
+    // supports program binaries; an empty path disables the cache.
+    void setShaderCachePath(const std::string& _path);
+
+    // Set a file of precomputed glyph SDFs used by scenes loaded afterwards; only glyphs missing
+    // from it are rasterized. Glyphs rasterized during a session are added to the file when the
+    // scene is released. An empty path disables the bundle.
+    void setGlyphBundlePath(const std::string& _path);
+
+    // Enable sub-allocating static tile meshes from large GPU buffers shared per vertex format:
+    // tiles of a style are then drawn without rebinding buffers. Applies to meshes uploaded
+    // afterwards.
+    void setMeshBufferPooling(bool _enabled);
+
+    // Set the size in bytes of the in-memory cache of recently visible tiles
+    void setTileCacheSize(size_t _bytes);
+
+    // Set the eviction policy of the tile cache
+    void setTileCachePolicy(TileCachePolicyType _policy);
+
+    // Limit the GPU and CPU bytes of the tile cache as reported in getMemoryStats().tileCache,
+    // without evicting tiles, for devices where one of them is much scarcer than the other.
+    // Beyond _gpuBytes, the meshes of the least recently used cached tiles are read back into
+    // CPU memory and uploaded again within the tile upload budget when their tile is shown.
+    // Beyond _cpuBytes, their retained tile data is dropped, so that rebuilding them needs new
+    // loads. The cache size of setTileCacheSize still bounds the sum. 0 for no limit (default).
+    void setTileCacheResidency(size_t _gpuBytes, size_t _cpuBytes);
+
+    // Get tile cache usage and eviction counters since the last call with _reset = true
+    TileCacheStats getTileCacheStats(bool _reset = false);
+
+    // Set the seconds between compactions of the glyph atlases, which move the glyphs that
+    // labels use out of sparse atlases into fewer ones in the background. Labels are moved to
+    // them without rebuilding tiles, and the atlases they left are released. 0 disables it.
+    void setGlyphAtlasCompaction(float _interval);
+
+    // Get glyph atlas compaction counters since the last call with _reset = true
+    GlyphAtlasStats getGlyphAtlasStats(bool _reset = false);
+
+    // Configure speculative loading of the tiles that come into view during flings and flyTo
+    // animations; _lookahead is the time in seconds that the camera path is predicted ahead and
+    // _maxTasks the number of speculative tile loads in flight, which visible tile loads take
+    // precedence over. A _maxTasks of 0 disables prefetching (defaults are 0.5s and 4 tasks).
+    void setTilePrefetch(float _lookahead, int _maxTasks);
+
+    // Limit the number of tiles in view; when a tilted view would need more, distant tiles are
+    // taken from lower zoom levels until it fits. 0 for no limit (default).
+    void setMaxVisibleTiles(int _count);
+
+    // Set the number of bytes of tile geometry uploaded to the GPU per frame; newly loaded tiles
+    // are shown once all their geometry is uploaded. 0 uploads everything at once (default is 4MB).
+    void setTileUploadBudget(size_t _bytes);
+
+    // When true, the tiles of the previous zoom level are drawn scaled after a one level zoom
+    // step until all tiles of the new level are ready, which then replace them at once. When
+    // false (default), each new tile replaces its parent or children as soon as it is ready.
+    void setHoldProxyTiles(bool _hold);
+
+    // Set the time in milliseconds per frame for placing labels. When many labels arrive at once,
+    // labels that were not visible yet are placed in later frames in priority order and fade in
+    // then. 0 places all labels in one frame (default).
+    void setLabelPlacementBudget(float _milliseconds);
+
+    // Get the number of labels deferred to later frames by the placement budget in the last frame
+    size_t getDeferredLabelCount();
+
+    // Set the time in milliseconds per update for running the work that background threads hand
+    // to the GL thread, e.g. scene switches and resource deletions. Jobs that do not fit run on
+    // the next frames in order. 0 runs all jobs in one frame (default).
+    void setJobBudget(float _milliseconds);
+
+    // Place labels on a background thread while the labels of the previous update are drawn.
+    // Labels then lag the view by up to one frame, in return update does not wait for label
+    // placement (default is false). update and render must be called from the same thread.
+    void setPipelinedUpdates(bool _enabled);
+
+    // Get frame timings and tile loading counters. The timings are always recorded,
+    // reading them is the only cost beyond a few clock reads per frame.
+    PerformanceStats getPerformanceStats();
+
+    // Get the CPU and GPU bytes held by tiles, caches, textures, fonts and JavaScript heaps,
+    // e.g. to decide what to drop on a memory warning. Walks all owners, so it is not meant
+    // to be called every frame.
+    MemoryStats getMemoryStats();
+
+    // Enable measuring the GPU time of each style and of the feature selection pass with
+    // timer queries. Results are read back a few frames later, so the GPU is never stalled.
+    // Has no effect when the driver lacks GL_EXT_disjoint_timer_query (off by default).
+    void setGpuTiming(bool _enabled);
+
+    // Enable counting the time, features, vertices and bytes of each data layer and style
+    // while building tiles, to find the filters and draw rules that are slow to build.
+    // Off by default, the totals are kept across scene loads.
+    void setBuildCostAccounting(bool _enabled);
+
+    // Get the build costs counted since the last call with _reset = true
+    BuildCostStats getBuildCostStats(bool _reset = false);
+
+    // Get the recorded load, parse, build and upload spans of tiles as Chrome trace
+    // JSON, which chrome://tracing and the Perfetto UI open. Only recorded in builds
+    // with TANGRAM_TILE_TRACING defined, empty otherwise.
+    std::string getTileTrace(bool _clear = false);
+
+    // Record the scene loads, view changes, gestures and updates of this map while
+    // _recorder is recording, to replay them with a SessionPlayer. Network responses
+    // are recorded when the map was created with a RecordingPlatform. Pass nullptr
+    // to stop recording.
+    void setSessionRecorder(std::shared_ptr<SessionRecorder> _recorder);
+
     // Set the radius in logical pixels to use when picking features on the map (default is 0.5).
     void setPickRadius(float _radius);
 
+    // Set the resolution of the offscreen buffer that picking queries draw into, relative to the
+    // view size, within [0.1, 1]. Lower values draw faster but miss small features (default is 0.5).
+    void setSelectionBufferScale(float _scale);
+
     // Create a query to select a feature marked as 'interactive'. The query runs on the next frame.
     // Calls _onFeaturePickCallback once the query has completed, and returns the FeaturePickResult
     // with its associated properties or null if no feature was found.
@@ -341,12 +724,56 @@ public:
     // with its associated properties or null if no marker was found.
     void pickMarkerAt(float _x, float _y, MarkerPickCallback _onMarkerPickCallback);
 
+    // Create a query to select the features marked as 'interactive' at each of _positions, given
+    // as x, y pairs of screen coordinates. The query runs on the next frame and reads the selection
+    // buffer once for all positions, together with the other queries of the frame.
+    // Calls _onFeaturesPickCallback with a result for each position where a feature was found.
+    void pickFeaturesAt(const std::vector<std::array<float, 2>>& _positions,
+                        FeaturesPickCallback _onFeaturesPickCallback);
+
+    // Create a query to select all features marked as 'interactive' within the rectangle at _x, _y
+    // of _width and _height in screen coordinates. The query runs on the next frame.
+    // Calls _onFeaturesPickCallback with one result for each feature, positioned at one of its pixels.
+    void pickFeaturesInRect(float _x, float _y, float _width, float _height,
+                            FeaturesPickCallback _onFeaturesPickCallback);
+
+    // Build an index of the geometry of features marked as 'interactive' for the tiles that are
+    // built from now on, used by pickFeatureFromIndexAt. Off by default.
+    void setFeatureIndexing(bool _enabled);
+
+    // Select a feature marked as 'interactive' from the feature index of the visible tiles.
+    // Calls _onFeaturePickCallback before returning, without waiting for a frame; the feature is
+    // the one with the highest draw order under the position. Unlike pickFeatureAt, shader
+    // displacement and labels are not considered.
+    void pickFeatureFromIndexAt(float _x, float _y, FeaturePickCallback _onFeaturePickCallback);
+
+    // Draw the feature with _id, as returned in FeaturePickResult::id, with _state from the next
+    // frame on without rebuilding its tile. Applies to styles with 'feature_state: true' only.
+    // At most 16 features have a state at once, returns false when there is no room for _id.
+    // States are cleared with the scene, ids of rebuilt tiles refer to other features.
+    bool setFeatureState(uint32_t _id, const FeatureState& _state);
+
+    // Draw the feature with _id as its style does again
+    void clearFeatureState(uint32_t _id);
+
+    void clearFeatureStates();
+
     // Run this task asynchronously to Tangram's main update loop.
     void runAsyncTask(std::function<void()> _task);
 
-    // Send a signal to Tangram that the platform received a memory warning
+    // Send a signal to Tangram that the platform received a memory warning,
+    // same as releaseMemory(MemoryPressure::critical)
     void onMemoryWarning();
 
+    // Free memory that is not needed for the current view, cheapest to restore first:
+    // raw tile data, cached tiles farthest from the view, unused glyph atlases and
+    // rasters no tile refers to. Critical pressure also runs a garbage collection of
+    // the JavaScript heaps on the tile workers, which is not part of the result.
+    MemoryRelease releaseMemory(MemoryPressure _pressure);
+
+    // Free memory in the same order until getMemoryStats().total() is at most _bytes
+    MemoryRelease releaseMemory(uint64_t _bytes);
+
     // Sets an opaque default background color used as default color when a scene is being loaded
     // r, g, b must be between 0.0 and 1.0
     void setDefaultBackgroundColor(float r, float g, float b);
@@ -380,6 +807,9 @@ enum DebugFlags {
     draw_all_labels,    // Draw all labels
     tangram_stats,      // Tangram frame graph stats
     selection_buffer,   // Render selection framebuffer
+    native_functions,   // Log which scene functions are evaluated without duktape
+    isect2d_collisions, // Use isect2d instead of LabelGrid as label collision broadphase
+    overdraw,           // Colors each pixel by the number of fragments drawn to it
 };
 
 // Set debug features on or off using a boolean (see debug.h)
@@ -2,6 +2,7 @@
 
 #include "util/url.h"
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -21,6 +22,27 @@ using UrlRequestHandle = uint64_t;
 struct UrlResponse {
     std::vector<char> content;
     const char* error = nullptr;
+
+    // HTTP status code, 0 when the platform does not provide it. A
+    // conditional request for an unchanged resource gets 304 and no content.
+    int status = 0;
+
+    // Cache validators and freshness lifetime in seconds taken from the
+    // 'ETag', 'Last-Modified' and 'Cache-Control' headers. Empty or -1 when
+    // the platform does not provide them; a 'no-store' or 'no-cache' response
+    // has maxAge 0.
+    std::string etag;
+    std::string lastModified;
+    int64_t maxAge = -1;
+};
+
+// Validators of a cached response, sent as 'If-None-Match' and
+// 'If-Modified-Since' with a conditional request.
+struct UrlValidators {
+    std::string etag;
+    std::string lastModified;
+
+    bool empty() const { return etag.empty() && lastModified.empty(); }
 };
 
 // Function type for receiving data from a URL request.
@@ -54,6 +76,40 @@ void initGLExtensions();
 // Set the priority of the current thread. Priority is equivalent to pthread niceness
 void setCurrentThreadPriority(int priority);
 
+// Work done by a thread that Tangram starts
+enum class ThreadRole : uint8_t {
+    tileWorker = 0, // Parsing and building tiles
+    network,        // Running URL requests
+    background,     // Other asynchronous jobs, e.g. scene cache writes
+};
+
+// Quality of service class, mapped to the scheduler classes of the OS where
+// it has them (e.g. QOS_CLASS_UTILITY on Apple platforms)
+enum class ThreadQoS : uint8_t {
+    background = 0,
+    utility,
+    userInitiated,
+};
+
+struct ThreadPolicy {
+    // Niceness, as with setCurrentThreadPriority
+    int priority = 0;
+    ThreadQoS qos = ThreadQoS::utility;
+    // CPUs the thread may run on, bit i for CPU i. 0 for any CPU. Only applied
+    // where the OS allows to pin threads, e.g. to keep workers off the big cores.
+    uint64_t affinity = 0;
+};
+
+// Apply _policy to the current thread
+void setCurrentThreadPolicy(const ThreadPolicy& _policy);
+
+// State of the device that limits how much work should run in parallel
+enum class PowerHint : uint8_t {
+    normal = 0,
+    lowBattery,
+    thermalThrottled,
+};
+
 class Platform {
 
 public:
@@ -76,6 +132,19 @@ public:
     // thread than the original call to startUrlRequest.
     virtual UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) = 0;
 
+    // Start a request which the server answers with status 304 and no content
+    // when the resource still matches _validators. Platforms that can't send
+    // the validators make a regular request.
+    virtual UrlRequestHandle startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                        UrlCallback _callback);
+
+    // Start a request with the importance of the task that waits for it, lower
+    // values of _priority are more important as with TileTask::getPriority.
+    // Platforms that can order their requests override this, the default makes
+    // a conditional request when there are _validators and a regular one else.
+    virtual UrlRequestHandle startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                        double _priority, UrlCallback _callback);
+
     // Stop retrieving data from a URL that was previously requested. When a
     // request is canceled its callback will still be run, but the response
     // will have an error string and the data may not be complete.
@@ -85,6 +154,13 @@ public:
 
     virtual std::vector<FontSourceHandle> systemFontFallbacksHandle() const;
 
+    // Policy for the threads of _role, applied by each thread when it starts
+    virtual ThreadPolicy threadPolicy(ThreadRole _role) const;
+
+    // Checked when tile work is scheduled, fewer tile workers run while it is
+    // not 'normal'. Platforms may report battery saving or thermal throttling.
+    virtual PowerHint powerHint() const { return PowerHint::normal; }
+
 protected:
 
     static bool bytesFromFileSystem(const char* _path, std::function<char*(size_t)> _allocator);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "map.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Tangram {
+
+struct StaticMapRequest {
+    double lon = 0;
+    double lat = 0;
+    float zoom = 0;
+    // In radians, as for Map::setRotation and Map::setTilt
+    float rotation = 0;
+    float tilt = 0;
+    int width = 512;
+    int height = 512;
+    // Encode the image as PNG, otherwise only the raw pixels are returned
+    bool png = true;
+};
+
+struct StaticMapImage {
+    uint64_t id = 0;
+    int width = 0;
+    int height = 0;
+    // RGBA rows from the top, empty when the request could not be drawn
+    std::vector<unsigned int> pixels;
+    // PNG file contents when requested
+    std::vector<char> png;
+    // False when the tiles of the view were not all loaded before the timeout
+    bool complete = false;
+    // Milliseconds from the request until the image was drawn, and spent drawing it
+    double latency = 0;
+    double renderTime = 0;
+};
+
+// Called on the render thread of the image
+using StaticMapCallback = std::function<void(StaticMapImage&&)>;
+
+struct StaticMapStats {
+    uint64_t requests = 0;
+    uint64_t images = 0;
+    uint64_t incomplete = 0;
+    uint32_t queued = 0;
+    // Images per second since the renderer was started
+    double imagesPerSecond = 0;
+    double averageLatency = 0;
+    double averageRenderTime = 0;
+    // Images drawn from the view of the image before on the same context,
+    // which reuses the tiles still held by its map
+    uint64_t reusedViews = 0;
+};
+
+struct StaticMapOptions {
+    // Longest wait for the tiles of a view, in milliseconds
+    float timeout = 10000.f;
+    // Update interval of the maps while tiles load, in seconds
+    float frameDelta = 1.f / 60.f;
+    // Resources of the map of each context
+    ResourceProfile profile = ResourceProfile();
+};
+
+/* Draws static map images of one scene for many requests
+ *
+ * Each GL context gets a render thread with its own Map, all created on a
+ * shared MapContext: the tile workers, the network client and the raw tile
+ * caches are shared by the contexts. Every map loads the scene once and keeps
+ * its built tiles between requests, so a thread picks the queued request
+ * nearest to its last view.
+ *
+ * Tangram doesn't create GL contexts: _makeCurrent is called once on each
+ * render thread and has to make a context current there whose default
+ * framebuffer is at least as large as the requested images, e.g. a pbuffer
+ * or a hidden window.
+ */
+class StaticMapRenderer {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+    using Options = StaticMapOptions;
+
+    StaticMapRenderer(std::shared_ptr<MapContext> _context, const std::string& _scenePath,
+                      std::vector<std::function<bool()>> _makeCurrent, Options _options = Options());
+
+    // Waits for the images being drawn, requests still queued are dropped
+    ~StaticMapRenderer();
+
+    // Returns the id of the request, which is passed to _callback with its image
+    uint64_t request(const StaticMapRequest& _request, StaticMapCallback _callback);
+
+    // Blocks until all queued requests are drawn, or no context could be made current
+    void wait();
+
+    StaticMapStats stats() const;
+
+private:
+
+    struct Job {
+        uint64_t id;
+        StaticMapRequest request;
+        StaticMapCallback callback;
+        Clock::time_point queued;
+    };
+
+    void run(size_t _context);
+
+    // Takes the queued job with the view nearest to _last, or false when stopped
+    bool nextJob(const StaticMapRequest* _last, Job& _job);
+
+    void draw(Map& _map, Job& _job, StaticMapImage& _image);
+
+    std::shared_ptr<MapContext> m_context;
+    std::string m_scenePath;
+    std::vector<std::function<bool()>> m_makeCurrent;
+    Options m_options;
+
+    std::vector<std::thread> m_threads;
+    std::deque<Job> m_jobs;
+    uint32_t m_drawing = 0;
+    // Threads with a GL context
+    uint32_t m_running = 0;
+    uint64_t m_nextId = 1;
+    bool m_stop = false;
+
+    StaticMapStats m_stats;
+    double m_totalLatency = 0;
+    double m_totalRenderTime = 0;
+    Clock::time_point m_start;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobsChanged;
+};
+
+}
@@ -46,6 +46,11 @@ struct TileID {
         return isValid() && z <= _maxZoom;
     }
 
+    /* The same tile in another copy of the world */
+    TileID withWrap(int32_t _wrap) const {
+        return TileID(x, y, z, s, _wrap);
+    }
+
     TileID withMaxSourceZoom(int32_t _maxZoom) const {
 
         if (z <= _maxZoom) {
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "tile/tileID.h"
+#include "util/byteBuffer.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace Tangram {
@@ -15,6 +17,7 @@ class TileSource;
 class Tile;
 class MapProjection;
 struct TileData;
+struct FeatureFilter;
 
 
 class TileTask {
@@ -42,9 +45,23 @@ public:
     std::unique_ptr<Tile> getTile();
     void setTile(std::unique_ptr<Tile>&& _tile);
 
+    // First stage of a progressive build, shown until the task is ready.
+    // Set on the worker thread, taken on the main thread.
+    std::unique_ptr<Tile> getPartialTile();
+    void setPartialTile(std::unique_ptr<Tile>&& _tile);
+
+    // Build only the labels of _tile again, which is shown until the task is
+    // ready, see TileBuilder::rebuildLabels
+    void rebuildLabelsOf(std::shared_ptr<const Tile> _tile) { m_labelsOf = std::move(_tile); }
+    bool rebuildsLabels() const { return bool(m_labelsOf); }
+
     TileSource& source() { return *m_source; }
+    const TileSource& source() const { return *m_source; }
     int64_t sourceGeneration() const { return m_sourceGeneration; }
 
+    // Features the scene of this task takes from its source, see TileSource::featureFilter()
+    const std::shared_ptr<const FeatureFilter>& featureFilter() const { return m_featureFilter; }
+
     TileID tileId() const { return m_tileId; }
 
     void cancel() { m_canceled = true; }
@@ -58,6 +75,10 @@ public:
         m_priority.store(_priority);
     }
 
+    // Time in microseconds this task waited in the TileWorker queue
+    uint64_t queueWaitTime() const { return m_queueWaitTime; }
+    void setQueueWaitTime(uint64_t _waitTime) { m_queueWaitTime = _waitTime; }
+
     void setProxyState(bool isProxy) { m_proxyState = isProxy; }
     bool isProxy() const { return m_proxyState; }
 
@@ -71,8 +92,8 @@ public:
     // running on main thread when the tile is added to
     virtual void complete();
 
-    // onDone for sub-tasks
-    virtual void complete(TileTask& _mainTask) {}
+    // onDone for sub-tasks, adds the results to the tile of the main task
+    virtual void complete(Tile& _tile) {}
 
     int rawSource = 0;
 
@@ -87,6 +108,15 @@ public:
 
 protected:
 
+    // Parse the task data and clip it when the source clips its tiles
+    std::shared_ptr<TileData> parseTileData(TileBuilder& _tileBuilder);
+
+    // Simplify _tileData when the source simplifies its tiles
+    void simplifyTileData(TileBuilder& _tileBuilder, TileData& _tileData);
+
+    // Build the tile from _tileData, cancels the task when it is null
+    void buildTile(TileBuilder& _tileBuilder, const TileData* _tileData);
+
     const TileID m_tileId;
 
     const int m_subTaskId;
@@ -99,15 +129,25 @@ protected:
 
     const int64_t m_sourceGeneration;
 
+    const std::shared_ptr<const FeatureFilter> m_featureFilter;
+
     // Tile result, set when tile was  sucessfully created
     std::unique_ptr<Tile> m_tile;
 
+    // Tile whose labels are rebuilt, see rebuildLabelsOf
+    std::shared_ptr<const Tile> m_labelsOf;
+
+    std::unique_ptr<Tile> m_partialTile;
+    std::mutex m_partialMutex;
+
     std::atomic<bool> m_ready;
     std::atomic<bool> m_canceled;
     std::atomic<bool> m_needsLoading;
 
     std::atomic<float> m_priority;
     std::atomic<bool> m_proxyState;
+
+    uint64_t m_queueWaitTime = 0;
 };
 
 class BinaryTileTask : public TileTask {
@@ -116,12 +156,56 @@ public:
         : TileTask(_tileId, _source, _subTask) {}
 
     virtual bool hasData() const override {
-        return rawTileData && !rawTileData->empty();
+        return !rawTileData.empty() || parsedTileData || fromBuiltTileCache;
     }
-    // Raw tile data that will be processed by TileSource.
-    std::shared_ptr<std::vector<char>> rawTileData;
+
+    void process(TileBuilder& _tileBuilder) override;
+
+    // Inflate rawTileData when it came compressed from the memory cache.
+    // Returns false for invalid data.
+    bool inflateRawTileData();
+
+    // Build the tile from tile data that is shared with other tasks
+    void buildSharedTile(TileBuilder& _tileBuilder, const TileData& _tileData);
+
+    // Parse and build the tile from rawTileData or parsedTileData
+    void buildFromTileData(TileBuilder& _tileBuilder);
+
+    // Restore the tile from the BuiltTileCache of the source. Returns false
+    // when the cached tile is stale, the task then loads the tile data.
+    bool restoreBuiltTile(TileBuilder& _tileBuilder);
+
+    // Decode the meshes of a tile of TileSource::Format::Mesh
+    void decodeMeshTile(TileBuilder& _tileBuilder);
+
+    // Raw tile data that will be processed by TileSource. Shares its memory
+    // with the data source, cache or response that provided it.
+    ByteBuffer rawTileData;
 
     bool dataFromCache = false;
+
+    // rawTileData is gzip compressed, see MemoryCacheDataSource::setCompression
+    bool rawTileDataCompressed = false;
+
+    // Parsed and clipped rawTileData, set when the memory cache kept it for
+    // another tile with the same data, e.g. the same tile at a higher overzoom,
+    // or when the tile is rebuilt from the data retained by its previous tile
+    std::shared_ptr<const TileData> parsedTileData;
+
+    // The tile is restored from the BuiltTileCache of the source instead of
+    // being built from tile data
+    bool fromBuiltTileCache = false;
+
+    // Cache headers of the response that provided rawTileData, see UrlResponse.
+    // A cache sets the validators of its stale copy before loading from the
+    // next source, which then makes a conditional request.
+    std::string etag;
+    std::string lastModified;
+    int64_t maxAge = -1;
+
+    // The server confirmed that the cached copy is unchanged (status 304).
+    // rawTileData stays empty until the cache provides it.
+    bool notModified = false;
 };
 
 struct TileTaskQueue {
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+/* Immutable bytes with a shared owner
+ *
+ * The owner keeps the memory alive: a vector moved into the buffer, a memory
+ * mapped file or any other shared object. Copies of a ByteBuffer share the
+ * owner, so tile data is passed between data sources, caches and parsers
+ * without copying the bytes.
+ */
+class ByteBuffer {
+
+public:
+
+    ByteBuffer() = default;
+
+    // Takes the memory of _bytes
+    explicit ByteBuffer(std::vector<char>&& _bytes);
+
+    // _data must stay valid while _owner is alive
+    ByteBuffer(std::shared_ptr<const void> _owner, const char* _data, size_t _size)
+        : m_owner(std::move(_owner)), m_data(_data), m_size(_size) {}
+
+    // Maps the file at _path read-only, returns an empty buffer when it can't
+    // be mapped. The file must only be replaced, not truncated, while mapped.
+    static ByteBuffer mapFile(const std::string& _path);
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+
+    // Bytes from _offset on, sharing the owner of this buffer
+    ByteBuffer slice(size_t _offset, size_t _size) const;
+
+    void reset() { *this = ByteBuffer(); }
+
+private:
+
+    std::shared_ptr<const void> m_owner;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 namespace Tangram {
@@ -52,4 +53,17 @@ typedef std::vector<LngLat> Coordinates;
 
 typedef uint32_t MarkerID;
 
+struct MemoryUsage {
+    uint64_t cpuBytes = 0;
+    uint64_t gpuBytes = 0;
+
+    uint64_t total() const { return cpuBytes + gpuBytes; }
+
+    MemoryUsage& operator+=(const MemoryUsage& _other) {
+        cpuBytes += _other.cpuBytes;
+        gpuBytes += _other.gpuBytes;
+        return *this;
+    }
+};
+
 } // namespace Tangram
@@ -0,0 +1,30 @@
+// States of features by their selection color, see FeatureStates::uniforms
+uniform vec4 u_feature_state_ids[TANGRAM_FEATURE_STATES];
+uniform vec4 u_feature_states[TANGRAM_FEATURE_STATES];
+uniform int u_feature_state_count;
+
+// State of the feature with _id as (0xRRGGBB or -1, alpha, offset in pixels),
+// a state without changes when the feature has none
+vec4 featureState(vec4 _id) {
+    for (int i = 0; i < TANGRAM_FEATURE_STATES; i++) {
+        if (i >= u_feature_state_count) { break; }
+        if (all(lessThan(abs(u_feature_state_ids[i] - _id), vec4(.5 / 255.)))) {
+            return u_feature_states[i];
+        }
+    }
+    return vec4(-1., 1., 0., 0.);
+}
+
+vec4 featureStateColor(vec4 _state, vec4 _color) {
+    if (_state.x >= 0.) {
+        _color.rgb = vec3(floor(_state.x / 65536.), mod(floor(_state.x / 256.), 256.), mod(_state.x, 256.)) / 255.;
+    }
+    _color.a *= _state.y;
+    return _color;
+}
+
+// Move _position in clip space by the offset of _state, y down on screen
+vec4 featureStateOffset(vec4 _state, vec4 _position) {
+    _position.xy += vec2(_state.z, -_state.w) * u_device_pixel_ratio * 2. / u_resolution * _position.w;
+    return _position;
+}
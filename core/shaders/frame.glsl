@@ -0,0 +1,28 @@
+// Uniforms of the view and time, set once per frame for all style programs.
+// With uniform buffers the block is shared, see UniformBuffer::FRAME_BLOCK;
+// the members have to stay in the order Style::setupFrameUniforms adds them.
+#ifdef TANGRAM_UNIFORM_BUFFERS
+layout(std140) uniform TangramFrame {
+    highp mat4 u_view;
+    highp mat4 u_proj;
+    highp mat3 u_normal_matrix;
+    highp mat3 u_inverse_normal_matrix;
+    highp vec3 u_map_position;
+    highp float u_time;
+    highp vec2 u_resolution;
+    highp vec2 u_eye_offset;
+    highp float u_meters_per_pixel;
+    highp float u_device_pixel_ratio;
+};
+#else
+uniform mat4 u_view;
+uniform mat4 u_proj;
+uniform mat3 u_normal_matrix;
+uniform mat3 u_inverse_normal_matrix;
+uniform vec3 u_map_position;
+uniform float u_time;
+uniform vec2 u_resolution;
+uniform vec2 u_eye_offset;
+uniform float u_meters_per_pixel;
+uniform float u_device_pixel_ratio;
+#endif
@@ -10,11 +10,8 @@ precision mediump float;
 #pragma tangram: defines
 
 uniform vec4 u_tile_origin;
-uniform vec3 u_map_position;
-uniform vec2 u_resolution;
-uniform float u_time;
-uniform float u_meters_per_pixel;
-uniform float u_device_pixel_ratio;
+
+#pragma tangram: frame
 
 #pragma tangram: uniforms
 
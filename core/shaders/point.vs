@@ -13,7 +13,17 @@ uniform LOWP int u_sprite_mode;
 
 #pragma tangram: uniforms
 
+#ifdef TANGRAM_INSTANCED
+// Per vertex corner of the quad in -1/1
+attribute vec2 a_corner;
+// Per instance: center and half axes of the quad in clip space,
+// texture coordinates of the corners -1/-1 and 1/1
+attribute vec4 a_axis_x;
+attribute vec4 a_axis_y;
+attribute vec4 a_uv;
+#else
 attribute vec2 a_uv;
+#endif
 attribute LOWP float a_alpha;
 attribute LOWP vec4 a_color;
 attribute vec4 a_position;
@@ -48,14 +58,22 @@ void main() {
     }
 #endif
 
+#ifdef TANGRAM_INSTANCED
+    vec2 uv = mix(a_uv.xy, a_uv.zw, a_corner * 0.5 + 0.5);
+    vec4 position = a_position + a_corner.x * a_axis_x + a_corner.y * a_axis_y;
+#else
+    vec2 uv = a_uv;
+    vec4 position = a_position;
+#endif
+
     if (u_sprite_mode == 0) {
-        v_texcoords = sign(a_uv);
-        v_edge = abs(a_uv);
+        v_texcoords = sign(uv);
+        v_edge = abs(uv);
     } else {
-        v_texcoords = a_uv;
+        v_texcoords = uv;
     }
     v_outline_color = a_outline_color;
     v_aa_factor = a_aa_factor;
 
-    gl_Position = a_position;
+    gl_Position = position;
 }
@@ -11,18 +11,9 @@ struct PointLight {
     vec4 diffuse;
     vec4 specular;
     vec4 position;
-
-#ifdef TANGRAM_POINTLIGHT_ATTENUATION_EXPONENT
     float attenuationExponent;
-#endif
-
-#ifdef TANGRAM_POINTLIGHT_ATTENUATION_INNER_RADIUS
     float innerRadius;
-#endif
-
-#ifdef TANGRAM_POINTLIGHT_ATTENUATION_OUTER_RADIUS
     float outerRadius;
-#endif
 };
 
 void calculateLight(in PointLight _light, in vec3 _eyeToPoint, in vec3 _normal) {
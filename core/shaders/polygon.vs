@@ -7,33 +7,39 @@ precision highp float;
 #pragma tangram: defines
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_proj;
-uniform mat3 u_normal_matrix;
 uniform vec4 u_tile_origin;
-uniform vec3 u_map_position;
-uniform vec2 u_resolution;
-uniform float u_time;
-uniform float u_meters_per_pixel;
-uniform float u_device_pixel_ratio;
 uniform float u_proxy_depth;
 
+#pragma tangram: frame
+
+#ifdef TANGRAM_FEATURE_STATES
+    #pragma tangram: feature_state
+#endif
+
 #pragma tangram: uniforms
 
 attribute vec4 a_position;
 attribute vec4 a_color;
+#ifndef TANGRAM_NO_NORMALS
 attribute vec3 a_normal;
+#else
+// Unlit styles without shader blocks leave out the normal attribute
+const vec3 a_normal = vec3(0., 0., 1.);
+#endif
 
 #ifdef TANGRAM_USE_TEX_COORDS
     attribute vec2 a_texcoord;
     varying vec2 v_texcoord;
 #endif
 
+#if defined(TANGRAM_FEATURE_SELECTION) || defined(TANGRAM_FEATURE_STATES)
+    attribute vec4 a_selection_color;
+#endif
+
 #ifdef TANGRAM_FEATURE_SELECTION
     // Make sure lighting is a no-op for feature selection pass
     #undef TANGRAM_LIGHTING_VERTEX
 
-    attribute vec4 a_selection_color;
     varying vec4 v_selection_color;
 #endif
 
@@ -91,6 +97,11 @@ void main() {
 
     v_color = a_color;
 
+    #ifdef TANGRAM_FEATURE_STATES
+        vec4 feature_state = featureState(a_selection_color);
+        v_color = featureStateColor(feature_state, v_color);
+    #endif
+
     #ifdef TANGRAM_USE_TEX_COORDS
         v_texcoord = a_texcoord;
     #endif
@@ -105,9 +116,12 @@ void main() {
     position = u_model * position;
 
     // World coordinates for 3d procedural textures
-    vec4 local_origin = vec4(u_map_position.xy, 0., 0.);
     #ifdef TANGRAM_WORLD_POSITION_WRAP
-        local_origin = mod(local_origin, TANGRAM_WORLD_POSITION_WRAP);
+        // The eye offset is taken from a multiple of the wrap in double precision,
+        // u_map_position is too coarse in float at high zoom
+        vec4 local_origin = vec4(mod(u_eye_offset, TANGRAM_WORLD_POSITION_WRAP), 0., 0.);
+    #else
+        vec4 local_origin = vec4(u_map_position.xy, 0., 0.);
     #endif
     v_world_position = position + local_origin;
 
@@ -134,4 +148,8 @@ void main() {
         float layer = a_position.w;
         gl_Position.z -= layer * TANGRAM_DEPTH_DELTA * gl_Position.w;
     #endif
+
+    #ifdef TANGRAM_FEATURE_STATES
+        gl_Position = featureStateOffset(feature_state, gl_Position);
+    #endif
 }
@@ -7,19 +7,16 @@ precision highp float;
 #pragma tangram: defines
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_proj;
-uniform mat3 u_normal_matrix;
-uniform mat3 u_inverse_normal_matrix;
 uniform vec4 u_tile_origin;
-uniform vec3 u_map_position;
-uniform vec2 u_resolution;
-uniform float u_time;
-uniform float u_meters_per_pixel;
-uniform float u_device_pixel_ratio;
 uniform float u_texture_ratio;
 uniform sampler2D u_texture;
 
+#ifdef TANGRAM_LINE_DASH_ATLAS
+    uniform vec2 u_dash_atlas;
+#endif
+
+#pragma tangram: frame
+
 #pragma tangram: uniforms
 
 varying vec4 v_world_position;
@@ -65,7 +62,12 @@ void main(void) {
     #endif
 
     #ifdef TANGRAM_LINE_TEXTURE
-        vec2 line_st = vec2(v_texcoord.x, fract(v_texcoord.y * TANGRAM_DASHLINE_TEX_SCALE / u_texture_ratio));
+        #ifdef TANGRAM_LINE_DASH_ATLAS
+            // Column of the pattern in the dash atlas, repeating over its length
+            vec2 line_st = vec2(u_dash_atlas.x, fract(v_texcoord.y * TANGRAM_DASHLINE_TEX_SCALE / u_texture_ratio) * u_dash_atlas.y);
+        #else
+            vec2 line_st = vec2(v_texcoord.x, fract(v_texcoord.y * TANGRAM_DASHLINE_TEX_SCALE / u_texture_ratio));
+        #endif
         vec4 line_color = texture2D(u_texture, line_st);
 
         if (line_color.a < TANGRAM_ALPHA_TEST) {
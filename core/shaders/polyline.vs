@@ -7,33 +7,39 @@ precision highp float;
 #pragma tangram: defines
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_proj;
-uniform mat3 u_normal_matrix;
 uniform vec4 u_tile_origin;
-uniform vec3 u_map_position;
-uniform vec2 u_resolution;
-uniform float u_time;
-uniform float u_meters_per_pixel;
-uniform float u_device_pixel_ratio;
 uniform float u_proxy_depth;
 
+#pragma tangram: frame
+
+#ifdef TANGRAM_FEATURE_STATES
+    #pragma tangram: feature_state
+#endif
+
 #pragma tangram: uniforms
 
 attribute vec4 a_position;
 attribute vec4 a_color;
 attribute vec4 a_extrude;
 
+#ifdef TANGRAM_LINE_WIDTH_TABLE
+    // Half widths in pixels of the width classes at the current zoom
+    uniform float u_line_widths[TANGRAM_LINE_WIDTH_TABLE];
+#endif
+
 #ifdef TANGRAM_USE_TEX_COORDS
     attribute vec2 a_texcoord;
     varying vec2 v_texcoord;
 #endif
 
+#if defined(TANGRAM_FEATURE_SELECTION) || defined(TANGRAM_FEATURE_STATES)
+    attribute vec4 a_selection_color;
+#endif
+
 #ifdef TANGRAM_FEATURE_SELECTION
     // Make sure lighting is a no-op for feature selection pass
     #undef TANGRAM_LIGHTING_VERTEX
 
-    attribute vec4 a_selection_color;
     varying vec4 v_selection_color;
 #endif
 
@@ -94,6 +100,11 @@ void main() {
 
     v_color = a_color;
 
+    #ifdef TANGRAM_FEATURE_STATES
+        vec4 feature_state = featureState(a_selection_color);
+        v_color = featureStateColor(feature_state, v_color);
+    #endif
+
     #ifdef TANGRAM_USE_TEX_COORDS
         v_texcoord = UNPACK_TEXCOORD(a_texcoord);
     #endif
@@ -106,12 +117,20 @@ void main() {
 
     {
         vec4 extrude = UNPACK_EXTRUSION(a_extrude);
-        float width = extrude.z;
-        float dwdz = extrude.w;
         float dz = u_map_position.z - u_tile_origin.z;
 
-        // Interpolate between zoom levels
-        width += dwdz * clamp(dz, 0.0, 1.0);
+        #ifdef TANGRAM_LINE_WIDTH_TABLE
+            // Width of the class of the vertex, converted from pixels to tile units
+            float width = u_line_widths[int(a_extrude.z)] * exp2(a_extrude.w / 1024.);
+            float baseWidth = width;
+        #else
+            float width = extrude.z;
+            float dwdz = extrude.w;
+            float baseWidth = extrude.z;
+
+            // Interpolate between zoom levels
+            width += dwdz * clamp(dz, 0.0, 1.0);
+        #endif
         // Scale pixel dimensions to be consistent in screen space
         // and adjust scale for overzooming.
         width *= exp2(-dz + (u_tile_origin.w - u_tile_origin.z));
@@ -120,7 +139,7 @@ void main() {
         #pragma tangram: width
 
         #ifdef TANGRAM_USE_TEX_COORDS
-            v_texcoord.y /= 2. * extrude.z;
+            v_texcoord.y /= 2. * baseWidth;
         #endif
 
         position.xy += extrude.xy * width;
@@ -130,9 +149,12 @@ void main() {
     position = u_model * position;
 
     // World coordinates for 3d procedural textures
-    vec4 local_origin = vec4(u_map_position.xy, 0., 0.);
     #ifdef TANGRAM_WORLD_POSITION_WRAP
-        local_origin = mod(local_origin, TANGRAM_WORLD_POSITION_WRAP);
+        // The eye offset is taken from a multiple of the wrap in double precision,
+        // u_map_position is too coarse in float at high zoom
+        vec4 local_origin = vec4(mod(u_eye_offset, TANGRAM_WORLD_POSITION_WRAP), 0., 0.);
+    #else
+        vec4 local_origin = vec4(u_map_position.xy, 0., 0.);
     #endif
     v_world_position = position + local_origin;
 
@@ -159,4 +181,8 @@ void main() {
         float layer = UNPACK_ORDER(a_position.w);
         gl_Position.z -= layer * TANGRAM_DEPTH_DELTA * gl_Position.w;
     #endif
+
+    #ifdef TANGRAM_FEATURE_STATES
+        gl_Position = featureStateOffset(feature_state, gl_Position);
+    #endif
 }
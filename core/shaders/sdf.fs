@@ -10,15 +10,12 @@
 #pragma tangram: defines
 
 uniform sampler2D u_tex;
-uniform vec3 u_map_position;
 uniform vec4 u_tile_origin;
-uniform vec2 u_resolution;
-uniform float u_time;
-uniform float u_meters_per_pixel;
-uniform float u_device_pixel_ratio;
 uniform float u_max_stroke_width;
 uniform LOWP int u_pass;
 
+#pragma tangram: frame
+
 #pragma tangram: uniforms
 
 varying vec4 v_color;
@@ -16,7 +16,17 @@ uniform LOWP int u_pass;
 
 #pragma tangram: uniforms
 
+#ifdef TANGRAM_INSTANCED
+// Per vertex corner of the quad in -1/1
+attribute vec2 a_corner;
+// Per instance: first corner of the glyph quad and its edges along x and y,
+// texture coordinates of the first and the opposite corner
+attribute vec2 a_axis_x;
+attribute vec2 a_axis_y;
+attribute vec4 a_uv;
+#else
 attribute vec2 a_uv;
+#endif
 attribute LOWP float a_alpha;
 attribute LOWP vec4 a_color;
 attribute vec2 a_position;
@@ -54,8 +64,15 @@ void main() {
     }
 #endif
 
+#ifdef TANGRAM_INSTANCED
+    vec2 corner = a_corner * 0.5 + 0.5;
+    vec2 uv = mix(a_uv.xy, a_uv.zw, corner);
+    vec2 vertex_pos = UNPACK_POSITION(a_position + corner.x * a_axis_x + corner.y * a_axis_y);
+#else
+    vec2 uv = a_uv;
     vec2 vertex_pos = UNPACK_POSITION(a_position);
-    v_texcoords = UNPACK_TEXTURE(a_uv);
+#endif
+    v_texcoords = UNPACK_TEXTURE(uv);
     float sdf_scale = a_scale / 64.0;
     v_sdf_pixel = 0.5 / (u_max_stroke_width * sdf_scale);
 
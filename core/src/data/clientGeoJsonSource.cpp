@@ -4,11 +4,14 @@
 #include "platform.h"
 #include "tile/tileTask.h"
 #include "util/geom.h"
+#include "data/pointClusters.h"
 #include "data/propertyItem.h"
 #include "data/tileData.h"
 #include "tile/tile.h"
+#include "util/asyncWorker.h"
 #include "view/view.h"
 
+#include "glm/vec2.hpp"
 #include "mapbox/geojsonvt.hpp"
 
 // RapidJson parser
@@ -16,7 +19,10 @@
 #include <mapbox/geojson_impl.hpp>
 
 
+#include <algorithm>
+#include <cmath>
 #include <regex>
+#include <unordered_map>
 
 namespace Tangram {
 
@@ -34,10 +40,167 @@ geojsonvt::Options options() {
     return opt;
 }
 
+// Points are bucketed into the tiles of this zoom level
+static constexpr int pointIndexZoom = 12;
+
+struct PointIndex {
+
+    struct Entry {
+        // Web mercator in [0, 1], y pointing down like geojson-vt tiles
+        glm::dvec2 pos;
+        uint64_t cell;
+        Properties props;
+    };
+
+    std::unordered_map<uint64_t, Entry> points;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> cells;
+    uint64_t nextId = 0;
+
+    static glm::dvec2 project(LngLat _point) {
+        double s = std::sin(_point.latitude * M_PI / 180.0);
+        double y = 0.5 - 0.25 * std::log((1.0 + s) / (1.0 - s)) / M_PI;
+        return { _point.longitude / 360.0 + 0.5, std::min(1.0, std::max(0.0, y)) };
+    }
+
+    static uint64_t cellKey(glm::dvec2 _pos) {
+        const double n = 1 << pointIndexZoom;
+        uint64_t x = std::min(n - 1, std::max(0.0, std::floor(_pos.x * n)));
+        uint64_t y = std::min(n - 1, std::max(0.0, std::floor(_pos.y * n)));
+        return (x << 32) | y;
+    }
+
+    void removeFromCell(uint64_t _id, uint64_t _cell) {
+        auto it = cells.find(_cell);
+        if (it == cells.end()) { return; }
+        auto& ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), _id);
+        if (pos != ids.end()) {
+            *pos = ids.back();
+            ids.pop_back();
+        }
+        if (ids.empty()) { cells.erase(it); }
+    }
+
+    uint64_t add(const Properties& _props, LngLat _point) {
+        uint64_t id = nextId++;
+        auto pos = project(_point);
+        auto cell = cellKey(pos);
+        points.emplace(id, Entry{ pos, cell, _props });
+        cells[cell].push_back(id);
+        return id;
+    }
+
+    bool update(uint64_t _id, LngLat _point) {
+        auto it = points.find(_id);
+        if (it == points.end()) { return false; }
+        auto& entry = it->second;
+        entry.pos = project(_point);
+        auto cell = cellKey(entry.pos);
+        if (cell != entry.cell) {
+            removeFromCell(_id, entry.cell);
+            cells[cell].push_back(_id);
+            entry.cell = cell;
+        }
+        return true;
+    }
+
+    bool remove(uint64_t _id) {
+        auto it = points.find(_id);
+        if (it == points.end()) { return false; }
+        removeFromCell(_id, it->second.cell);
+        points.erase(it);
+        return true;
+    }
+
+    void clear() {
+        points.clear();
+        cells.clear();
+    }
+
+    // Returns the feature when _pos is within _tile, or null
+    static Feature* addFeature(glm::dvec2 _pos, const TileID& _tile, int32_t _sourceId, Layer& _layer) {
+        const double scale = double(1 << _tile.z);
+        double x = _pos.x * scale - _tile.x;
+        double y = _pos.y * scale - _tile.y;
+        // Half-open so that points on tile edges are added once
+        if (x < 0.0 || x >= 1.0 || y < 0.0 || y >= 1.0) { return nullptr; }
+
+        _layer.features.emplace_back(_sourceId);
+        Feature& feature = _layer.features.back();
+        feature.geometryType = GeometryType::points;
+        feature.points.push_back({ float(x), float(1.0 - y) });
+        return &feature;
+    }
+
+    void addCell(const std::vector<uint64_t>& _ids, const TileID& _tile,
+                 int32_t _sourceId, Layer& _layer) const {
+        for (auto id : _ids) {
+            auto& entry = points.at(id);
+            if (auto feature = addFeature(entry.pos, _tile, _sourceId, _layer)) {
+                feature->props = entry.props;
+            }
+        }
+    }
+
+    void getClusters(const PointClusters& _clusters, const TileID& _tile,
+                     int32_t _sourceId, Layer& _layer) const {
+        std::vector<PointClusters::Cluster> clusters;
+        _clusters.getTile(_tile.z, _tile.x, _tile.y, clusters);
+
+        for (auto& cluster : clusters) {
+            if (cluster.count == 1) {
+                // Points keep their current position and properties until the
+                // clusters are rebuilt, removed points are skipped
+                auto it = points.find(cluster.id);
+                if (it == points.end()) { continue; }
+                if (auto feature = addFeature(it->second.pos, _tile, _sourceId, _layer)) {
+                    feature->props = it->second.props;
+                }
+                continue;
+            }
+            if (auto feature = addFeature(cluster.pos, _tile, _sourceId, _layer)) {
+                feature->props.set("cluster", 1.0);
+                feature->props.set("point_count", double(cluster.count));
+            }
+        }
+    }
+
+    void getTile(const TileID& _tile, int32_t _sourceId, Layer& _layer) const {
+        if (_tile.z >= pointIndexZoom) {
+            int shift = _tile.z - pointIndexZoom;
+            uint64_t key = (uint64_t(_tile.x >> shift) << 32) | uint64_t(_tile.y >> shift);
+            auto it = cells.find(key);
+            if (it != cells.end()) { addCell(it->second, _tile, _sourceId, _layer); }
+            return;
+        }
+        int shift = pointIndexZoom - _tile.z;
+        for (auto& cell : cells) {
+            int64_t x = (cell.first >> 32) >> shift;
+            int64_t y = (cell.first & 0xffffffff) >> shift;
+            if (x == _tile.x && y == _tile.y) {
+                addCell(cell.second, _tile, _sourceId, _layer);
+            }
+        }
+    }
+};
+
 struct ClientGeoJsonData {
-    std::unique_ptr<geojsonvt::GeoJSONVT> tiles;
     mapbox::geometry::feature_collection<double> features;
     std::vector<Properties> properties;
+    PointIndex points;
+    // Set while a build is queued that has not yet copied the features
+    bool buildPending = false;
+    bool clustersPending = false;
+    // Incremented by clearData, builds started before are dropped
+    uint64_t epoch = 0;
+};
+
+// Immutable once published, except for the tiles geojson-vt slices on demand
+struct ClientGeoJsonIndex {
+    std::unique_ptr<geojsonvt::GeoJSONVT> tiles;
+    // Shared by the features of all tiles, by feature id
+    std::vector<std::shared_ptr<const std::vector<Properties::Item>>> properties;
+    std::mutex mutex;
 };
 
 std::shared_ptr<TileTask> ClientGeoJsonSource::createTask(TileID _tileId, int _subTask) {
@@ -49,14 +212,17 @@ std::shared_ptr<TileTask> ClientGeoJsonSource::createTask(TileID _tileId, int _s
 ClientGeoJsonSource::ClientGeoJsonSource(std::shared_ptr<Platform> _platform,
                                          const std::string& _name, const std::string& _url,
                                          bool _generateCentroids,
-                                         TileSource::ZoomOptions _zoomOptions)
+                                         TileSource::ZoomOptions _zoomOptions,
+                                         PointClusterOptions _clusterOptions)
 
     : TileSource(_name, nullptr, _zoomOptions),
       m_generateCentroids(_generateCentroids),
+      m_clusterOptions(_clusterOptions),
       m_platform(_platform) {
 
     m_generateGeometry = true;
     m_store = std::make_unique<ClientGeoJsonData>();
+    m_worker = std::make_unique<AsyncWorker>();
 
     if (!_url.empty()) {
         UrlCallback onUrlFinished = [&, this](UrlResponse response) {
@@ -73,7 +239,83 @@ ClientGeoJsonSource::ClientGeoJsonSource(std::shared_ptr<Platform> _platform,
 
 }
 
-ClientGeoJsonSource::~ClientGeoJsonSource() {}
+ClientGeoJsonSource::~ClientGeoJsonSource() {
+    // Wait for a running build
+    m_worker.reset();
+}
+
+void ClientGeoJsonSource::scheduleIndexBuild() {
+    if (m_store->buildPending) { return; }
+
+    m_store->buildPending = true;
+    m_worker->enqueue([this]() { buildIndex(); });
+}
+
+void ClientGeoJsonSource::buildIndex() {
+
+    auto index = std::make_shared<ClientGeoJsonIndex>();
+    mapbox::geometry::feature_collection<double> features;
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutexStore);
+        m_store->buildPending = false;
+        features = m_store->features;
+        index->properties.reserve(m_store->properties.size());
+        for (auto& props : m_store->properties) {
+            index->properties.push_back(std::make_shared<const std::vector<Properties::Item>>(props.items()));
+        }
+        epoch = m_store->epoch;
+    }
+
+    if (!features.empty()) {
+        index->tiles = std::make_unique<geojsonvt::GeoJSONVT>(features, options());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutexStore);
+        if (epoch != m_store->epoch) { return; }
+        std::atomic_store(&m_index, index);
+    }
+
+    m_generation++;
+}
+
+void ClientGeoJsonSource::scheduleClusterBuild() {
+    if (!m_clusterOptions.enabled || m_store->clustersPending) { return; }
+
+    m_store->clustersPending = true;
+    m_worker->enqueue([this]() { buildClusters(); });
+}
+
+void ClientGeoJsonSource::buildClusters() {
+
+    std::vector<PointClusters::Cluster> points;
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutexStore);
+        m_store->clustersPending = false;
+        epoch = m_store->epoch;
+        points.reserve(m_store->points.points.size());
+        for (auto& it : m_store->points.points) {
+            points.push_back({ it.second.pos, 1, it.first });
+        }
+    }
+
+    // Clustered in the order of the ids, so that rebuilds of the same points
+    // make the same clusters
+    std::sort(points.begin(), points.end(), [](auto& a, auto& b) { return a.id < b.id; });
+
+    auto clusters = std::make_shared<PointClusters>(std::move(points), m_clusterOptions.radius,
+                                                    m_clusterOptions.maxZoom,
+                                                    m_clusterOptions.minPoints);
+    {
+        std::lock_guard<std::mutex> lock(m_mutexStore);
+        if (epoch != m_store->epoch) { return; }
+        std::atomic_store(&m_clusters, clusters);
+    }
+
+    m_generation++;
+}
 
 struct add_centroid {
 
@@ -137,8 +379,11 @@ struct prop_visitor {
     }
 };
 
-void ClientGeoJsonSource::generateLabelCentroidFeature() {
-    for (const auto &feat : m_store->features) {
+void ClientGeoJsonSource::generateLabelCentroidFeature(size_t _begin) {
+    // Only visit the features that were there before adding centroids
+    size_t end = m_store->features.size();
+    for (size_t i = _begin; i < end; i++) {
+        const auto& feat = m_store->features[i];
         geometry::point<double> centroid;
         const auto& properties = m_store->properties[feat.id.get<uint64_t>()];
         if (geometry::geometry<double>::visit(feat.geometry, add_centroid{ centroid })) {
@@ -153,35 +398,62 @@ void ClientGeoJsonSource::generateLabelCentroidFeature() {
 
 void ClientGeoJsonSource::addData(const std::string& _data) {
 
-    std::lock_guard<std::mutex> lock(m_mutexStore);
-
+    // Parse without holding the lock, tile workers can keep reading the store
     const auto json = geojson::parse(_data);
     auto features = geojsonvt::geojson::visit(json, geojsonvt::ToFeatureCollection{});
 
-    for (auto& feature : features) {
-
-        feature.id = uint64_t(m_store->properties.size());
-        m_store->properties.emplace_back();
-        Properties& props = m_store->properties.back();
+    std::vector<Properties> properties(features.size());
 
+    for (size_t i = 0; i < features.size(); i++) {
+        auto& feature = features[i];
         for (const auto& prop : feature.properties) {
             auto key = prop.first;
-            prop_visitor visitor = {props, key};
+            prop_visitor visitor = {properties[i], key};
             mapbox::util::apply_visitor(visitor, prop.second);
         }
         feature.properties.clear();
     }
 
+    std::lock_guard<std::mutex> lock(m_mutexStore);
+
+    size_t begin = m_store->features.size();
+
+    if (m_clusterOptions.enabled) {
+        // Points are clustered with those of addPoint
+        size_t end = 0;
+        for (size_t i = 0; i < features.size(); i++) {
+            if (features[i].geometry.is<geometry::point<double>>()) {
+                auto& point = features[i].geometry.get<geometry::point<double>>();
+                m_store->points.add(properties[i], LngLat(point.x, point.y));
+                continue;
+            }
+            if (end != i) {
+                features[end] = std::move(features[i]);
+                properties[end] = std::move(properties[i]);
+            }
+            end++;
+        }
+        if (end < features.size()) {
+            features.resize(end);
+            scheduleClusterBuild();
+            m_generation++;
+        }
+    }
+
+    for (size_t i = 0; i < features.size(); i++) {
+        features[i].id = uint64_t(m_store->properties.size());
+        m_store->properties.push_back(std::move(properties[i]));
+    }
+
     m_store->features.insert(m_store->features.end(),
                              std::make_move_iterator(features.begin()),
                              std::make_move_iterator(features.end()));
 
     if (m_generateCentroids) {
-        generateLabelCentroidFeature();
+        generateLabelCentroidFeature(begin);
     }
 
-    m_store->tiles = std::make_unique<geojsonvt::GeoJSONVT>(m_store->features, options());
-    m_generation++;
+    scheduleIndexBuild();
 }
 
 void ClientGeoJsonSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
@@ -206,50 +478,71 @@ void ClientGeoJsonSource::clearData() {
 
     m_store->features.clear();
     m_store->properties.clear();
-    m_store->tiles.reset();
+    m_store->points.clear();
+    m_store->epoch++;
+    std::atomic_store(&m_index, std::shared_ptr<ClientGeoJsonIndex>());
+    std::atomic_store(&m_clusters, std::shared_ptr<PointClusters>());
 
     m_generation++;
 }
 
-void ClientGeoJsonSource::addPoint(const Properties& _tags, LngLat _point) {
+uint64_t ClientGeoJsonSource::addPoint(const Properties& _tags, LngLat _point) {
 
     std::lock_guard<std::mutex> lock(m_mutexStore);
 
-    geometry::point<double> geom { _point.longitude, _point.latitude };
+    uint64_t id = m_store->points.add(_tags, _point);
+    scheduleClusterBuild();
 
-    uint64_t id = m_store->features.size();
+    m_generation++;
+    return id;
+}
 
-    m_store->features.emplace_back(geom, id);
-    m_store->properties.emplace_back(_tags);
+bool ClientGeoJsonSource::updatePoint(uint64_t _id, LngLat _point) {
+
+    std::lock_guard<std::mutex> lock(m_mutexStore);
+
+    if (!m_store->points.update(_id, _point)) { return false; }
+    scheduleClusterBuild();
 
-    m_store->tiles = std::make_unique<geojsonvt::GeoJSONVT>(m_store->features, options());
     m_generation++;
+    return true;
 }
 
-void ClientGeoJsonSource::addLine(const Properties& _tags, const Coordinates& _line) {
-
+bool ClientGeoJsonSource::removePoint(uint64_t _id) {
 
     std::lock_guard<std::mutex> lock(m_mutexStore);
 
+    if (!m_store->points.remove(_id)) { return false; }
+    scheduleClusterBuild();
+
+    m_generation++;
+    return true;
+}
+
+void ClientGeoJsonSource::addLine(const Properties& _tags, const Coordinates& _line) {
+    addLine(_tags, _line.data(), _line.size());
+}
+
+void ClientGeoJsonSource::addLine(const Properties& _tags, const LngLat* _line, size_t _count) {
+
     geometry::line_string<double> geom;
-    for (auto& p : _line) {
-        geom.emplace_back(p.longitude, p.latitude);
+    geom.reserve(_count);
+    for (size_t i = 0; i < _count; i++) {
+        geom.emplace_back(_line[i].longitude, _line[i].latitude);
     }
 
+    std::lock_guard<std::mutex> lock(m_mutexStore);
+
     uint64_t id = m_store->features.size();
 
-    m_store->features.emplace_back(geom, id);
+    m_store->features.emplace_back(std::move(geom), id);
     m_store->properties.emplace_back(_tags);
 
-    m_store->tiles = std::make_unique<geojsonvt::GeoJSONVT>(m_store->features, options());
-    m_generation++;
+    scheduleIndexBuild();
 }
 
 void ClientGeoJsonSource::addPoly(const Properties& _tags, const std::vector<Coordinates>& _poly) {
 
-
-    std::lock_guard<std::mutex> lock(m_mutexStore);
-
     geometry::polygon<double> geom;
     for (auto& ring : _poly) {
         geom.emplace_back();
@@ -259,17 +552,46 @@ void ClientGeoJsonSource::addPoly(const Properties& _tags, const std::vector<Coo
         }
     }
 
+    std::lock_guard<std::mutex> lock(m_mutexStore);
+
     uint64_t id = m_store->features.size();
 
     m_store->features.emplace_back(geom, id);
     m_store->properties.emplace_back(_tags);
 
     if (m_generateCentroids) {
-        generateLabelCentroidFeature();
+        generateLabelCentroidFeature(m_store->features.size() - 1);
     }
 
-    m_store->tiles = std::make_unique<geojsonvt::GeoJSONVT>(m_store->features, options());
-    m_generation++;
+    scheduleIndexBuild();
+}
+
+void ClientGeoJsonSource::addPoly(const Properties& _tags, const LngLat* _points, const int* _rings,
+                                  size_t _ringCount) {
+
+    geometry::polygon<double> geom;
+    geom.reserve(_ringCount);
+    for (size_t i = 0; i < _ringCount; i++) {
+        geom.emplace_back();
+        auto &line = geom.back();
+        line.reserve(_rings[i]);
+        for (int j = 0; j < _rings[i]; j++, _points++) {
+            line.emplace_back(_points->longitude, _points->latitude);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutexStore);
+
+    uint64_t id = m_store->features.size();
+
+    m_store->features.emplace_back(std::move(geom), id);
+    m_store->properties.emplace_back(_tags);
+
+    if (m_generateCentroids) {
+        generateLabelCentroidFeature(m_store->features.size() - 1);
+    }
+
+    scheduleIndexBuild();
 }
 
 struct add_geometry {
@@ -336,28 +658,83 @@ struct add_geometry {
     }
 };
 
+// Features of a geojson-vt tile, read in place. geojson-vt keeps the tiles it
+// sliced until the index is destroyed, which the view holds on to.
+struct ClientGeoJsonLayer : LayerView {
+
+    ClientGeoJsonLayer(int32_t _sourceId, std::shared_ptr<ClientGeoJsonIndex> _index,
+                       const geojsonvt::Tile& _tile)
+        : LayerView("", _sourceId), index(std::move(_index)), tile(_tile) {
+
+        features.reserve(tile.features.size());
+        for (size_t i = 0; i < tile.features.size(); i++) {
+            // Geometry collections are ignored, see add_geometry
+            if (tile.features[i].geometry.is<geometry::geometry_collection<int16_t>>()) { continue; }
+            features.push_back(uint32_t(i));
+        }
+    }
+
+    size_t size() const override { return features.size(); }
+
+    void getFeature(size_t _index, Feature& _feature) const override {
+        const auto& feature = tile.features[features[_index]];
+
+        _feature.points.clear();
+        _feature.lines.clear();
+        _feature.polygons.clear();
+        geometry::geometry<int16_t>::visit(feature.geometry, add_geometry{ _feature });
+
+        _feature.props.setShared(index->properties[feature.id.get<uint64_t>()]);
+        _feature.props.sourceId = sourceId;
+    }
+
+    size_t memoryUsage() const override {
+        return sizeof(*this) + features.capacity() * sizeof(uint32_t);
+    }
+
+    std::shared_ptr<ClientGeoJsonIndex> index;
+    const geojsonvt::Tile& tile;
+    // Indices of the features in tile
+    std::vector<uint32_t> features;
+};
+
 std::shared_ptr<TileData> ClientGeoJsonSource::parse(const TileTask& _task,
                                                      const MapProjection& _projection) const {
 
-    std::lock_guard<std::mutex> lock(m_mutexStore);
-
     auto data = std::make_shared<TileData>();
-
-    if (!m_store->tiles) { return nullptr; }
-    auto tile = m_store->tiles->getTile(_task.tileId().z, _task.tileId().x, _task.tileId().y);
+    const auto& tileId = _task.tileId();
 
     data->layers.emplace_back("");  // empty name will skip filtering by 'collection'
     Layer& layer = data->layers.back();
 
-    for (auto& it : tile.features) {
-        Feature feature(m_id);
+    auto index = std::atomic_load(&m_index);
+
+    if (index && index->tiles) {
+        const geojsonvt::Tile* tile;
+        {
+            // Only tile slicing is serialized, writers never take this lock.
+            // Features are read later without it, sliced tiles don't change.
+            std::lock_guard<std::mutex> lock(index->mutex);
+            tile = &index->tiles->getTile(tileId.z, tileId.x, tileId.y);
+        }
+        if (!tile->features.empty()) {
+            data->layerViews.push_back(std::make_shared<ClientGeoJsonLayer>(m_id, index, *tile));
+        }
+    }
+
+    // Until the first clusters are built all points are added
+    auto clusters = std::atomic_load(&m_clusters);
 
-        if (geometry::geometry<int16_t>::visit(it.geometry, add_geometry{ feature })) {
-            feature.props = m_store->properties[it.id.get<uint64_t>()];
-            layer.features.emplace_back(std::move(feature));
+    {
+        std::lock_guard<std::mutex> lock(m_mutexStore);
+        if (clusters && tileId.z <= clusters->maxZoom()) {
+            m_store->points.getClusters(*clusters, tileId, m_id, layer);
+        } else {
+            m_store->points.getTile(tileId, m_id, layer);
         }
     }
 
+    if (layer.features.empty() && !(index && index->tiles)) { return nullptr; }
 
     return data;
 }
@@ -0,0 +1,433 @@
+#include "data/diskCacheDataSource.h"
+
+#include "util/asyncWorker.h"
+#include "log.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace Tangram {
+
+// Freshness lifetime of tiles whose response did not specify one: 7 days
+constexpr int64_t DEFAULT_MAX_AGE = 7 * 24 * 60 * 60;
+
+static const char* SCHEMA = R"SQL_ESC(
+CREATE TABLE IF NOT EXISTS tiles (
+    zoom_level INTEGER,
+    tile_column INTEGER,
+    tile_row INTEGER,
+    etag TEXT,
+    last_modified TEXT,
+    expires INTEGER,
+    last_access INTEGER,
+    size INTEGER,
+    PRIMARY KEY (zoom_level, tile_column, tile_row)
+);)SQL_ESC";
+
+static int64_t now() {
+    using namespace std::chrono;
+    return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+}
+
+DiskCacheDataSource::DiskCacheDataSource(std::string _directory, size_t _maxSize)
+    : m_directory(_directory),
+      m_maxSize(_maxSize) {
+
+    openIndex();
+
+    m_reader = std::make_unique<AsyncWorker>();
+    m_writer = std::make_unique<AsyncWorker>();
+}
+
+DiskCacheDataSource::~DiskCacheDataSource() {
+    // Stop workers before writing what is left.
+    m_reader.reset();
+    m_writer.reset();
+
+    flush();
+}
+
+void DiskCacheDataSource::setMaxSize(size_t _maxSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxSize = _maxSize;
+    scheduleFlush();
+}
+
+std::string DiskCacheDataSource::tilePath(const TileID& _tileId) const {
+    return m_directory + "/" + std::to_string(_tileId.z) + "-" +
+        std::to_string(_tileId.x) + "-" + std::to_string(_tileId.y) + ".tile";
+}
+
+void DiskCacheDataSource::openIndex() {
+
+    if (mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOGE("Unable to create tile cache directory: %s", m_directory.c_str());
+        return;
+    }
+
+    try {
+        std::string path = m_directory + "/index.db";
+        m_db = std::make_unique<SQLite::Database>(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        m_db->exec(SCHEMA);
+
+        // Indexes created before tiles were revalidated
+        bool hasLastModified = false;
+        SQLite::Statement columns(*m_db, "PRAGMA table_info(tiles);");
+        while (columns.executeStep()) {
+            if (columns.getColumn(1).getString() == "last_modified") { hasLastModified = true; }
+        }
+        if (!hasLastModified) {
+            m_db->exec("ALTER TABLE tiles ADD COLUMN last_modified TEXT;");
+        }
+
+        SQLite::Statement query(*m_db, "SELECT zoom_level, tile_column, tile_row, etag, "
+                                "expires, last_access, size, last_modified FROM tiles;");
+        while (query.executeStep()) {
+            TileID id(query.getColumn(1).getInt(), query.getColumn(2).getInt(),
+                      query.getColumn(0).getInt());
+            auto& entry = m_index[id];
+            entry.etag = query.getColumn(3).getString();
+            entry.expires = query.getColumn(4).getInt64();
+            entry.lastAccess = query.getColumn(5).getInt64();
+            entry.size = query.getColumn(6).getInt64();
+            entry.lastModified = query.getColumn(7).getString();
+            m_usage += entry.size;
+        }
+        LOG("Tile cache opened: %s, %d tiles", m_directory.c_str(), int(m_index.size()));
+
+    } catch (std::exception& e) {
+        LOGE("Unable to open tile cache index: %s - %s", m_directory.c_str(), e.what());
+        m_db.reset();
+        m_index.clear();
+        m_usage = 0;
+    }
+}
+
+bool DiskCacheDataSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
+
+    if (m_db && _task->rawSource == this->level) {
+        const auto& taskTileID = _task->tileId();
+        TileID tileId(taskTileID.x, taskTileID.y, taskTileID.z);
+
+        bool fresh = false;
+        UrlValidators validators;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_index.find(tileId);
+            if (it != m_index.end()) {
+                fresh = it->second.expires > now();
+                validators = { it->second.etag, it->second.lastModified };
+            }
+        }
+
+        // Try next source on subsequent calls
+        if (next) { _task->rawSource = next->level; }
+
+        if (fresh) {
+            m_reader->enqueue([this, tileId, _task, _cb](){
+                if (_task->isCanceled()) { return; }
+
+                auto& task = static_cast<BinaryTileTask&>(*_task);
+                if (readTile(tileId, task.rawTileData)) {
+                    touch(tileId);
+                    _cb.func(_task);
+                    return;
+                }
+
+                // Tile file went missing
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_index.find(tileId);
+                    if (it != m_index.end()) {
+                        m_usage -= it->second.size;
+                        m_index.erase(it);
+                    }
+                }
+
+                if (!loadNextSource(_task, _cb)) {
+                    _task->setNeedsLoading(true);
+                }
+            });
+            return true;
+        }
+
+        // Ask the next source to revalidate the stale copy
+        auto& task = static_cast<BinaryTileTask&>(*_task);
+        task.etag = std::move(validators.etag);
+        task.lastModified = std::move(validators.lastModified);
+    }
+
+    return loadNextSource(_task, _cb);
+}
+
+bool DiskCacheDataSource::loadNextSource(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
+    if (!next) { return false; }
+
+    if (!m_db) {
+        return next->loadTileData(_task, _cb);
+    }
+
+    // Intercept TileTaskCb to store result from next source.
+    return next->loadTileData(_task, {[this, _cb](std::shared_ptr<TileTask> _task) {
+
+        auto& task = static_cast<BinaryTileTask&>(*_task);
+
+        if (task.notModified) {
+            // Only the expiry date changes, the tile is read from its file
+            m_reader->enqueue([this, _task, _cb]() { loadNotModified(_task, _cb); });
+            return;
+        }
+
+        if (task.hasData()) { store(task); }
+
+        _cb.func(_task);
+    }});
+}
+
+void DiskCacheDataSource::loadNotModified(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
+    if (_task->isCanceled()) { return; }
+
+    auto& task = static_cast<BinaryTileTask&>(*_task);
+    const auto& taskTileID = _task->tileId();
+    TileID tileId(taskTileID.x, taskTileID.y, taskTileID.z);
+
+    if (readTile(tileId, task.rawTileData)) {
+        store(task);
+        _cb.func(_task);
+        return;
+    }
+
+    // Tile file went missing, load it again without validators
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(tileId);
+        if (it != m_index.end()) {
+            m_usage -= it->second.size;
+            m_index.erase(it);
+        }
+    }
+    task.notModified = false;
+    task.etag.clear();
+    task.lastModified.clear();
+
+    if (!loadNextSource(_task, _cb)) {
+        _task->setNeedsLoading(true);
+    }
+}
+
+bool DiskCacheDataSource::readTile(const TileID& _tileId, ByteBuffer& _data) {
+
+    // The tile is parsed from the mapping. Writers replace tile files by
+    // rename and eviction unlinks them, so mapped pages stay valid.
+    _data = ByteBuffer::mapFile(tilePath(_tileId));
+
+    return !_data.empty();
+}
+
+bool DiskCacheDataSource::writeTile(const TileID& _tileId, const ByteBuffer& _data) {
+
+    // Write to a temporary file and rename, so that readers never see
+    // partially written tiles.
+    std::string path = tilePath(_tileId);
+    std::string tmpPath = path + ".tmp";
+
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) { return false; }
+
+    bool ok = fwrite(_data.data(), 1, _data.size(), file) == _data.size();
+    ok &= (fclose(file) == 0);
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOGW("Unable to write cached tile: %s", path.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void DiskCacheDataSource::store(BinaryTileTask& _task) {
+
+    // 'no-store' or 'no-cache'
+    if (_task.maxAge == 0) { return; }
+
+    int64_t expires = now() + (_task.maxAge > 0 ? _task.maxAge : DEFAULT_MAX_AGE);
+
+    const auto& taskTileID = _task.tileId();
+    TileID tileId(taskTileID.x, taskTileID.y, taskTileID.z);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Unchanged content only needs a new expiry date
+    auto it = m_index.find(tileId);
+    if (it != m_index.end() &&
+        (_task.notModified || (!_task.etag.empty() && it->second.etag == _task.etag))) {
+        it->second.expires = expires;
+        m_pendingWrites.push_back({ tileId, {}, _task.etag, _task.lastModified, expires });
+    } else {
+        m_pendingWrites.push_back({ tileId, _task.rawTileData, _task.etag, _task.lastModified, expires });
+    }
+
+    scheduleFlush();
+}
+
+void DiskCacheDataSource::touch(const TileID& _tileId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(_tileId);
+    if (it == m_index.end()) { return; }
+
+    it->second.lastAccess = now();
+    m_pendingTouches.push_back(_tileId);
+
+    scheduleFlush();
+}
+
+void DiskCacheDataSource::scheduleFlush() {
+    // Must be called with m_mutex locked. Writes and touches that arrive
+    // while a flush is pending are batched into the same transaction.
+    if (m_flushScheduled || !m_writer) { return; }
+
+    m_flushScheduled = true;
+    m_writer->enqueue([this](){ flush(); });
+}
+
+void DiskCacheDataSource::flush() {
+
+    std::vector<PendingWrite> writes;
+    std::vector<TileID> touches;
+    std::vector<TileID> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flushScheduled = false;
+        std::swap(writes, m_pendingWrites);
+        std::swap(touches, m_pendingTouches);
+    }
+
+    if (!m_db) { return; }
+
+    // Tile files are written outside of the lock
+    for (auto& write : writes) {
+        if (!write.data.empty() && !writeTile(write.tileId, write.data)) {
+            write.expires = 0;
+        }
+    }
+
+    int64_t time = now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& write : writes) {
+            if (write.expires == 0) { continue; }
+
+            auto& entry = m_index[write.tileId];
+            entry.etag = write.etag;
+            entry.lastModified = write.lastModified;
+            entry.expires = write.expires;
+            entry.lastAccess = time;
+            if (!write.data.empty()) {
+                m_usage -= entry.size;
+                entry.size = write.data.size();
+                m_usage += entry.size;
+            }
+        }
+
+        if (m_usage > m_maxSize) {
+            std::vector<std::pair<int64_t, TileID>> candidates;
+            candidates.reserve(m_index.size());
+            for (auto& entry : m_index) {
+                candidates.emplace_back(entry.second.lastAccess, entry.first);
+            }
+            std::sort(candidates.begin(), candidates.end(),
+                      [](auto& a, auto& b) { return a.first < b.first; });
+
+            for (auto& candidate : candidates) {
+                if (m_usage <= m_maxSize) { break; }
+
+                auto it = m_index.find(candidate.second);
+                m_usage -= it->second.size;
+                m_index.erase(it);
+                evicted.push_back(candidate.second);
+            }
+        }
+    }
+
+    if (writes.empty() && touches.empty() && evicted.empty()) { return; }
+
+    try {
+        SQLite::Transaction transaction(*m_db);
+
+        SQLite::Statement putTile(*m_db, "REPLACE INTO tiles (zoom_level, tile_column, tile_row, "
+                                  "etag, expires, last_access, size, last_modified) "
+                                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?);");
+        SQLite::Statement updateExpiry(*m_db, "UPDATE tiles SET etag = ?, expires = ?, last_access = ?, "
+                                       "last_modified = ? "
+                                       "WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;");
+        SQLite::Statement updateAccess(*m_db, "UPDATE tiles SET last_access = ? "
+                                       "WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;");
+        SQLite::Statement deleteTile(*m_db, "DELETE FROM tiles "
+                                     "WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;");
+
+        for (auto& write : writes) {
+            if (write.expires == 0) { continue; }
+
+            auto& id = write.tileId;
+            if (!write.data.empty()) {
+                putTile.bind(1, id.z);
+                putTile.bind(2, id.x);
+                putTile.bind(3, id.y);
+                putTile.bind(4, write.etag);
+                putTile.bind(5, (long long)write.expires);
+                putTile.bind(6, (long long)time);
+                putTile.bind(7, (long long)write.data.size());
+                putTile.bind(8, write.lastModified);
+                putTile.exec();
+                putTile.reset();
+            } else {
+                updateExpiry.bind(1, write.etag);
+                updateExpiry.bind(2, (long long)write.expires);
+                updateExpiry.bind(3, (long long)time);
+                updateExpiry.bind(4, write.lastModified);
+                updateExpiry.bind(5, id.z);
+                updateExpiry.bind(6, id.x);
+                updateExpiry.bind(7, id.y);
+                updateExpiry.exec();
+                updateExpiry.reset();
+            }
+        }
+
+        for (auto& id : touches) {
+            updateAccess.bind(1, (long long)time);
+            updateAccess.bind(2, id.z);
+            updateAccess.bind(3, id.x);
+            updateAccess.bind(4, id.y);
+            updateAccess.exec();
+            updateAccess.reset();
+        }
+
+        for (auto& id : evicted) {
+            deleteTile.bind(1, id.z);
+            deleteTile.bind(2, id.x);
+            deleteTile.bind(3, id.y);
+            deleteTile.exec();
+            deleteTile.reset();
+        }
+
+        transaction.commit();
+
+    } catch (std::exception& e) {
+        LOGE("Tile cache index update failed: %s", e.what());
+    }
+
+    for (auto& id : evicted) {
+        remove(tilePath(id).c_str());
+    }
+}
+
+}
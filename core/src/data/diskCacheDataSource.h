@@ -0,0 +1,97 @@
+#pragma once
+
+#include "data/tileSource.h"
+#include "tile/tileHash.h"
+#include "tile/tileID.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace SQLite {
+class Database;
+}
+
+namespace Tangram {
+
+class AsyncWorker;
+
+/* Persistent tile data cache
+ *
+ * Tile data from the next source is stored as one file per tile in
+ * _directory. An SQLite index in the same directory keeps validators, expiry
+ * and last access time of each tile. Expired tiles are revalidated with a
+ * conditional request and kept when the server reports them unchanged. The index is held in memory, writes are
+ * batched into a single transaction on a background thread and the total
+ * size on disk is bounded by evicting least recently used tiles.
+ */
+class DiskCacheDataSource : public TileSource::DataSource {
+public:
+
+    DiskCacheDataSource(std::string _directory, size_t _maxSize);
+
+    ~DiskCacheDataSource();
+
+    bool loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override;
+
+    /* @_maxSize: Upper bound in bytes for tile files on disk */
+    void setMaxSize(size_t _maxSize);
+
+private:
+
+    struct Entry {
+        std::string etag;
+        std::string lastModified;
+        // Seconds since epoch
+        int64_t expires = 0;
+        int64_t lastAccess = 0;
+        uint64_t size = 0;
+    };
+
+    struct PendingWrite {
+        TileID tileId;
+        // Empty when only the expiry date changed
+        ByteBuffer data;
+        std::string etag;
+        std::string lastModified;
+        int64_t expires;
+    };
+
+    bool loadNextSource(std::shared_ptr<TileTask> _task, TileTaskCb _cb);
+
+    void openIndex();
+
+    bool readTile(const TileID& _tileId, ByteBuffer& _data);
+    bool writeTile(const TileID& _tileId, const ByteBuffer& _data);
+
+    // Runs on m_reader: Provide the cached tile after a 304 response
+    void loadNotModified(std::shared_ptr<TileTask> _task, TileTaskCb _cb);
+
+    void store(BinaryTileTask& _task);
+    void touch(const TileID& _tileId);
+    void scheduleFlush();
+
+    // Runs on m_writer: Writes pending tiles and access times in one
+    // transaction and evicts tiles above m_maxSize.
+    void flush();
+
+    std::string tilePath(const TileID& _tileId) const;
+
+    std::string m_directory;
+    uint64_t m_maxSize;
+
+    std::unique_ptr<SQLite::Database> m_db;
+
+    // Guards m_index, m_usage and the pending lists
+    std::mutex m_mutex;
+    TileIDMap<Entry> m_index;
+    uint64_t m_usage = 0;
+
+    std::vector<PendingWrite> m_pendingWrites;
+    std::vector<TileID> m_pendingTouches;
+    bool m_flushScheduled = false;
+
+    std::unique_ptr<AsyncWorker> m_reader;
+    std::unique_ptr<AsyncWorker> m_writer;
+};
+
+}
@@ -0,0 +1,162 @@
+#include "data/featureFilter.h"
+
+#include "scene/dataLayer.h"
+#include "scene/filters.h"
+#include "scene/styleContext.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+// Get the property and its string values that every feature passing _filter
+// has, returns false when there is no such condition
+static bool requiredValues(const Filter& _filter, std::string& _key, std::vector<std::string>& _values) {
+    using Data = Filter::Data;
+
+    switch (_filter.data.which()) {
+    case Data::type<Filter::Equality>::value: {
+        auto& f = _filter.data.get<Filter::Equality>();
+        if (f.keyword != FilterKeyword::undefined || !f.value.is<std::string>()) { return false; }
+        _key = f.key;
+        _values = { f.value.get<std::string>() };
+        return true;
+    }
+    case Data::type<Filter::EqualitySet>::value: {
+        auto& f = _filter.data.get<Filter::EqualitySet>();
+        if (f.keyword != FilterKeyword::undefined) { return false; }
+        _values.clear();
+        for (auto& value : f.values) {
+            if (!value.is<std::string>()) { return false; }
+            _values.push_back(value.get<std::string>());
+        }
+        _key = f.key;
+        return true;
+    }
+    case Data::type<Filter::OperatorAll>::value:
+        for (auto& operand : _filter.data.get<Filter::OperatorAll>().operands) {
+            if (requiredValues(operand, _key, _values)) { return true; }
+        }
+        return false;
+
+    default:
+        return false;
+    }
+}
+
+// Read by styles without being named in the scene: the default text source
+// of labels and the heights of extrusions
+static const char* const styleProperties[] = { "name", "height", "min_height" };
+
+// Adds the properties that _layer and its sublayers read to _properties,
+// returns false when any property may be read
+static bool readProperties(const SceneLayer& _layer, const FeatureFilter::Usage& _usage,
+                           std::vector<std::string>& _properties) {
+
+    auto addFunction = [&](uint32_t _id) {
+        if (!_usage.functions || _id >= _usage.functions->size()) { return false; }
+        // Functions which can't be analyzed may read anything through the feature
+        auto inputs = StyleContext::analyzeFunction((*_usage.functions)[_id]);
+        if (!inputs.memoizable) { return false; }
+        for (auto& key : inputs.properties) { _properties.push_back(key.name()); }
+        return true;
+    };
+
+    for (auto& key : _layer.program().keys()) { _properties.push_back(key.name()); }
+    for (auto& ins : _layer.program().instructions()) {
+        if (ins.op == FilterProgram::Op::function && !addFunction(ins.arg)) { return false; }
+    }
+
+    for (auto& rule : _layer.rules()) {
+        for (auto& param : rule.parameters) {
+            if (param.function >= 0 && !addFunction(param.function)) { return false; }
+
+            if (param.value.is<StyleParam::TextSource>()) {
+                for (auto& key : param.value.get<StyleParam::TextSource>().keys) {
+                    _properties.push_back(key.name());
+                }
+            }
+            if (param.key == StyleParamKey::interactive || param.key == StyleParamKey::text_interactive) {
+                bool interactive = param.function >= 0 ||
+                    (param.value.is<bool>() && param.value.get<bool>());
+                if (!interactive) { continue; }
+                // Picking returns the properties of interactive features
+                if (!_usage.pickingProperties) { return false; }
+                _properties.insert(_properties.end(), _usage.pickingProperties->begin(),
+                                   _usage.pickingProperties->end());
+            }
+        }
+    }
+
+    for (auto& sublayer : _layer.sublayers()) {
+        if (!readProperties(sublayer, _usage, _properties)) { return false; }
+    }
+    return true;
+}
+
+const FeatureFilter::Collection* FeatureFilter::collection(const std::string& _name) const {
+    auto it = collections.find(_name);
+    return it == collections.end() ? nullptr : &it->second;
+}
+
+bool FeatureFilter::keepsProperty(const std::string& _key) const {
+    return allProperties || std::binary_search(properties.begin(), properties.end(), _key);
+}
+
+bool FeatureFilter::covers(const FeatureFilter* _parsed, const FeatureFilter* _current) {
+    if (!_parsed) { return true; }
+    return _current && *_parsed == *_current;
+}
+
+std::shared_ptr<const FeatureFilter> FeatureFilter::build(const std::vector<DataLayer>& _layers,
+                                                          const std::string& _source,
+                                                          const Usage& _usage) {
+
+    auto filter = std::make_shared<FeatureFilter>();
+    filter->allProperties = _usage.allProperties;
+
+    for (auto& layer : _layers) {
+        if (layer.source() != _source) { continue; }
+
+        if (!filter->allProperties) {
+            filter->allProperties = !readProperties(layer, _usage, filter->properties);
+        }
+
+        std::string key;
+        std::vector<std::string> values;
+        if (!requiredValues(layer.filter(), key, values)) { key.clear(); }
+
+        for (auto& name : layer.collections()) {
+            auto entry = filter->collections.emplace(name, Collection{ key, values });
+            if (entry.second) { continue; }
+
+            // Other layers take the same collection, keep what any of them may match
+            auto& collection = entry.first->second;
+            if (collection.keepAll()) { continue; }
+            if (collection.key != key) {
+                collection = {};
+            } else {
+                collection.values.insert(collection.values.end(), values.begin(), values.end());
+            }
+        }
+    }
+
+    for (auto& entry : filter->collections) {
+        auto& values = entry.second.values;
+        if (entry.second.keepAll()) { values.clear(); }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    }
+
+    auto& properties = filter->properties;
+    if (filter->allProperties) {
+        properties.clear();
+    } else {
+        properties.insert(properties.end(), std::begin(styleProperties), std::end(styleProperties));
+        std::sort(properties.begin(), properties.end());
+        properties.erase(std::unique(properties.begin(), properties.end()), properties.end());
+    }
+
+    return filter;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+class DataLayer;
+
+/* Features of a tile source that the data layers of a scene can match
+ *
+ * Built once per scene for each source from the collections of its data
+ * layers and their top-level filters. Parsers use it to skip collections
+ * that no layer takes, and features that can't pass the equality filter
+ * on a property that all layers of a collection require, e.g. 'kind'.
+ *
+ * It also holds the properties that the layers of the source read, from
+ * their filters, text sources and JS functions. Parsers drop the others.
+ */
+struct FeatureFilter {
+
+    struct Collection {
+        // Property that features must have one of the values of, empty to keep all features
+        std::string key;
+        // Sorted string values of key
+        std::vector<std::string> values;
+
+        bool keepAll() const { return key.empty(); }
+
+        bool operator==(const Collection& _other) const {
+            return key == _other.key && values == _other.values;
+        }
+    };
+
+    // Collections taken by the data layers, by name
+    std::map<std::string, Collection> collections;
+
+    // Sorted names of the properties the layers read, unused with allProperties
+    std::vector<std::string> properties;
+    // Set when any property may be read, e.g. by a JS function that passes the
+    // feature on, or returned, e.g. by picking without a property allowlist
+    bool allProperties = true;
+
+    struct Usage {
+        // Functions of the scene, by id
+        const std::vector<std::string>* functions = nullptr;
+        // Properties that picking returns for interactive features, null for all of them
+        const std::vector<std::string>* pickingProperties = nullptr;
+        // Keep all properties regardless of what the layers read
+        bool allProperties = false;
+    };
+
+    /* Returns the filter of the collection _name, null when no layer takes it */
+    const Collection* collection(const std::string& _name) const;
+
+    /* Whether parsers keep the property _key */
+    bool keepsProperty(const std::string& _key) const;
+
+    bool operator==(const FeatureFilter& _other) const {
+        return collections == _other.collections && allProperties == _other.allProperties &&
+            properties == _other.properties;
+    }
+
+    /* Whether data parsed with _parsed holds all features needed by _current.
+     * Data parsed without filter holds all of them. */
+    static bool covers(const FeatureFilter* _parsed, const FeatureFilter* _current);
+
+    static std::shared_ptr<const FeatureFilter> build(const std::vector<DataLayer>& _layers,
+                                                      const std::string& _source,
+                                                      const Usage& _usage);
+
+    /* Without the scene functions, properties are only pruned when the
+     * layers of _source use no function */
+    static std::shared_ptr<const FeatureFilter> build(const std::vector<DataLayer>& _layers,
+                                                      const std::string& _source) {
+        return build(_layers, _source, Usage());
+    }
+};
+
+}
@@ -1,5 +1,6 @@
 #include "data/formats/geoJson.h"
 
+#include "data/featureFilter.h"
 #include "data/propertyItem.h"
 #include "log.h"
 #include "tile/tileTask.h"
@@ -7,6 +8,12 @@
 #include "util/mapProjection.h"
 
 #include "glm/glm.hpp"
+#include "rapidjson/encodedstream.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
+
+#include <cstring>
 
 namespace Tangram {
 
@@ -158,48 +165,314 @@ Layer GeoJson::getLayer(const JsonValue& _in, const Transform& _proj, int32_t _s
 
 }
 
-std::shared_ptr<TileData> GeoJson::parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId) {
+namespace {
 
-    auto& task = static_cast<const BinaryTileTask&>(_task);
+/* rapidjson SAX handler building TileData while the GeoJSON is read
+ *
+ * Every object and array pushes the context it was opened in, members that
+ * are not part of a FeatureCollection are skipped. Positions are collected
+ * until their line is complete and then projected at once, lines are collected
+ * into the nested containers of the coordinate depth, so that the geometry type
+ * may come after the coordinates.
+ */
+struct GeoJsonHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, GeoJsonHandler> {
 
-    std::shared_ptr<TileData> tileData = std::make_shared<TileData>();
+    enum class Context : uint8_t {
+        collection, features, feature, properties, geometry, coordinates, skip,
+    };
 
-    // Parse data into a JSON document
-    const char* error;
-    size_t offset;
-    auto document = JsonParseBytes(task.rawTileData->data(), task.rawTileData->size(), &error, &offset);
+    struct Collection {
+        explicit Collection(std::string _name) : layer(std::move(_name)) {}
+        Layer layer;
+        bool isFeatureCollection = false;
+        bool hasFeatures = false;
+    };
 
-    if (error) {
-        LOGE("Json parsing failed on tile [%s]: %s (%u)", task.tileId().toString().c_str(), error, offset);
-        return tileData;
+    GeoJsonHandler(TileData& _tileData, TileID _tileId, const MapProjection& _projection, int32_t _sourceId,
+                   const FeatureFilter* _filter)
+        : tileData(_tileData), projection(_projection), sourceId(_sourceId), filter(_filter) {
+        BoundingBox tileBounds(_projection.TileBounds(_tileId));
+        tileOrigin = {tileBounds.min.x, tileBounds.max.y*-1.0};
+        tileInverseScale = 1.0 / tileBounds.width();
     }
 
-    BoundingBox tileBounds(_projection.TileBounds(task.tileId()));
-    glm::dvec2 tileOrigin = {tileBounds.min.x, tileBounds.max.y*-1.0};
-    double tileInverseScale = 1.0 / tileBounds.width();
+    TileData& tileData;
+    const MapProjection& projection;
+    int32_t sourceId;
+    // Null to keep all properties
+    const FeatureFilter* filter;
+    glm::dvec2 tileOrigin;
+    double tileInverseScale;
 
-    const auto projFn = [&](glm::dvec2 _lonLat){
-        glm::dvec2 tmp = _projection.LonLatToMeters(_lonLat);
-        return Point {
-            (tmp.x - tileOrigin.x) * tileInverseScale,
-            (tmp.y - tileOrigin.y) * tileInverseScale,
-        };
-    };
+    std::vector<Context> stack;
+    std::vector<Collection> collections;
+    std::vector<Layer> namedLayers;
+    std::string key;
+
+    Feature feature;
+    std::vector<PropertyItem> items;
+    std::string geometryType;
+
+    // Array depth within 'coordinates' and the depth at which numbers were found
+    int coordinateDepth = 0;
+    int positionDepth = 0;
+    int numbers = 0;
+    double position[2] = { 0, 0 };
+    // Positions of the current line that are not projected yet
+    std::vector<glm::dvec2> lonLats;
+    Line line;
+    std::vector<Line> rings;
+    std::vector<Polygon> polygons;
+
+    Context top() const { return stack.back(); }
+
+    bool keepProperty() const { return !filter || filter->keepsProperty(key); }
 
-    // Transform JSON data into TileData using GeoJson functions
-    if (GeoJson::isFeatureCollection(document)) {
-        tileData->layers.push_back(GeoJson::getLayer(document, projFn, _sourceId));
-    } else {
-        for (auto layer = document.MemberBegin(); layer != document.MemberEnd(); ++layer) {
-            if (GeoJson::isFeatureCollection(layer->value)) {
-                tileData->layers.push_back(GeoJson::getLayer(layer->value, projFn, _sourceId));
-                tileData->layers.back().name = layer->name.GetString();
+    bool StartObject() {
+        if (stack.empty()) {
+            collections.emplace_back("");
+            stack.push_back(Context::collection);
+            return true;
+        }
+        switch (top()) {
+        case Context::collection:
+            // Members of the root object may be named layers
+            if (stack.size() == 1 && collections.size() == 1) {
+                collections.emplace_back(key);
+                stack.push_back(Context::collection);
+                return true;
+            }
+            break;
+        case Context::features:
+            feature = Feature(sourceId);
+            geometryType.clear();
+            stack.push_back(Context::feature);
+            return true;
+        case Context::feature:
+            if (key == "properties") {
+                items.clear();
+                stack.push_back(Context::properties);
+                return true;
             }
+            if (key == "geometry") {
+                lonLats.clear();
+                line.clear();
+                rings.clear();
+                polygons.clear();
+                stack.push_back(Context::geometry);
+                return true;
+            }
+            break;
+        default:
+            break;
         }
+        stack.push_back(Context::skip);
+        return true;
     }
 
+    bool EndObject(rapidjson::SizeType) {
+        Context context = top();
+        stack.pop_back();
+        switch (context) {
+        case Context::collection:
+            endCollection();
+            break;
+        case Context::feature:
+            if (!collections.empty()) {
+                collections.back().layer.features.push_back(std::move(feature));
+            }
+            break;
+        case Context::properties:
+            feature.props.setSorted(std::move(items));
+            feature.props.sort();
+            items.clear();
+            break;
+        case Context::geometry:
+            endGeometry();
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool StartArray() {
+        Context context = stack.empty() ? Context::skip : top();
+        if (context == Context::collection && key == "features") {
+            collections.back().hasFeatures = true;
+            stack.push_back(Context::features);
+        } else if (context == Context::geometry && key == "coordinates") {
+            coordinateDepth = 1;
+            positionDepth = 0;
+            numbers = 0;
+            stack.push_back(Context::coordinates);
+        } else if (context == Context::coordinates) {
+            coordinateDepth++;
+            stack.push_back(Context::coordinates);
+        } else {
+            stack.push_back(Context::skip);
+        }
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        Context context = top();
+        stack.pop_back();
+        if (context != Context::coordinates) { return true; }
+
+        switch (positionDepth - coordinateDepth) {
+        case 0:
+            if (numbers >= 2) { lonLats.emplace_back(position[0], position[1]); }
+            numbers = 0;
+            break;
+        case 1:
+            projectLine();
+            rings.push_back(std::move(line));
+            line.clear();
+            break;
+        case 2:
+            polygons.push_back(std::move(rings));
+            rings.clear();
+            break;
+        default:
+            break;
+        }
+        coordinateDepth--;
+        return true;
+    }
 
-    // Discard original JSON object and return TileData
+    bool Key(const char* _str, rapidjson::SizeType _length, bool) {
+        key.assign(_str, _length);
+        return true;
+    }
+
+    bool String(const char* _str, rapidjson::SizeType _length, bool) {
+        switch (top()) {
+        case Context::collection:
+            if (key == "type") {
+                collections.back().isFeatureCollection = (std::strcmp(_str, "FeatureCollection") == 0);
+            }
+            break;
+        case Context::properties:
+            if (keepProperty()) { items.emplace_back(key, std::string(_str, _length)); }
+            break;
+        case Context::geometry:
+            if (key == "type") { geometryType.assign(_str, _length); }
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool Bool(bool _value) { return number(double(_value)); }
+    bool Int(int _value) { return number(_value); }
+    bool Uint(unsigned _value) { return number(_value); }
+    bool Int64(int64_t _value) { return number(_value); }
+    bool Uint64(uint64_t _value) { return number(_value); }
+    bool Double(double _value) { return number(_value); }
+
+    bool number(double _value) {
+        Context context = top();
+        if (context == Context::properties) {
+            if (keepProperty()) { items.emplace_back(key, _value); }
+        } else if (context == Context::coordinates) {
+            if (positionDepth == 0) { positionDepth = coordinateDepth; }
+            if (coordinateDepth == positionDepth && numbers < 2) {
+                position[numbers] = _value;
+            }
+            numbers++;
+        }
+        return true;
+    }
+
+    void projectLine() {
+        size_t start = line.size();
+        line.resize(start + lonLats.size());
+        projection.LonLatToLocal(lonLats.data(), line.data() + start, lonLats.size(),
+                                 tileOrigin, tileInverseScale);
+        lonLats.clear();
+    }
+
+    void endGeometry() {
+        // The position of a Point
+        projectLine();
+
+        if (geometryType == "Point") {
+            feature.geometryType = GeometryType::points;
+            if (!line.empty()) { feature.points.push_back(line[0]); }
+        } else if (geometryType == "MultiPoint") {
+            feature.geometryType = GeometryType::points;
+            if (!rings.empty()) { feature.points = std::move(rings[0]); }
+        } else if (geometryType == "LineString") {
+            feature.geometryType = GeometryType::lines;
+            feature.lines = std::move(rings);
+        } else if (geometryType == "MultiLineString") {
+            feature.geometryType = GeometryType::lines;
+            if (!polygons.empty()) { feature.lines = std::move(polygons[0]); }
+        } else if (geometryType == "Polygon" || geometryType == "MultiPolygon") {
+            feature.geometryType = GeometryType::polygons;
+            feature.polygons = std::move(polygons);
+        }
+        line.clear();
+        rings.clear();
+        polygons.clear();
+    }
+
+    void endCollection() {
+        Collection collection = std::move(collections.back());
+        collections.pop_back();
+        bool valid = collection.isFeatureCollection && collection.hasFeatures;
+
+        if (!collections.empty()) {
+            // A named layer of the root object
+            if (valid) { namedLayers.push_back(std::move(collection.layer)); }
+            return;
+        }
+        // A root FeatureCollection is the only layer of the tile
+        if (valid) {
+            tileData.layers.push_back(std::move(collection.layer));
+        } else {
+            for (auto& layer : namedLayers) { tileData.layers.push_back(std::move(layer)); }
+        }
+        namedLayers.clear();
+    }
+};
+
+}
+
+std::shared_ptr<TileData> GeoJson::parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId) {
+
+    auto& task = static_cast<const BinaryTileTask&>(_task);
+    auto& filter = _task.featureFilter();
+
+    auto tileData = parseTile(task.rawTileData.data(), task.rawTileData.size(), task.tileId(),
+                              _projection, _sourceId, filter.get());
+    tileData->featureFilter = filter;
+
+    return tileData;
+
+}
+
+std::shared_ptr<TileData> GeoJson::parseTile(const char* _bytes, size_t _length, TileID _tileId,
+                                             const MapProjection& _projection, int32_t _sourceId,
+                                             const FeatureFilter* _filter) {
+
+    auto tileData = std::make_shared<TileData>();
+
+    GeoJsonHandler handler(*tileData, _tileId, _projection, _sourceId, _filter);
+
+    rapidjson::MemoryStream stream(_bytes, _length);
+    rapidjson::EncodedInputStream<rapidjson::UTF8<char>, rapidjson::MemoryStream> input(stream);
+    rapidjson::Reader reader;
+
+    auto result = reader.Parse(input, handler);
+
+    if (result.IsError()) {
+        LOGE("Json parsing failed on tile [%s]: %s (%u)", _tileId.toString().c_str(),
+             rapidjson::GetParseError_En(result.Code()), result.Offset());
+        tileData->layers.clear();
+    }
 
     return tileData;
 
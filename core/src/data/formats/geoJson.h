@@ -1,6 +1,7 @@
 #pragma once
 
 #include "data/tileData.h"
+#include "tile/tileID.h"
 #include "util/json.h"
 #include <functional>
 #include <memory>
@@ -30,6 +31,13 @@ Layer getLayer(const JsonValue& _in, const Transform& _proj, int32_t _sourceId);
 
 std::shared_ptr<TileData> parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId);
 
+// Streams the GeoJSON in _bytes into TileData, projecting coordinates into
+// the tile space of _tileId as they are read, without building a document.
+// Properties that _filter doesn't keep are skipped.
+std::shared_ptr<TileData> parseTile(const char* _bytes, size_t _length, TileID _tileId,
+                                    const MapProjection& _projection, int32_t _sourceId,
+                                    const FeatureFilter* _filter = nullptr);
+
 } // namespace GeoJson
 
 } // namespace Tangram
@@ -2,13 +2,24 @@
 #include "data/propertyItem.h"
 #include "tile/tile.h"
 #include "tile/tileTask.h"
+#include "tile/tileWorker.h"
 #include "log.h"
 #include "platform.h"
 #include "util/geom.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iterator>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MVT_SIMD_GEOMETRY
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MVT_SIMD_GEOMETRY
+#endif
+
 #define FEATURE_ID 1
 #define FEATURE_TAGS 2
 #define FEATURE_TYPE 3
@@ -20,11 +31,195 @@
 #define LAYER_VALUE 4
 #define LAYER_TILE_EXTENT 5
 
+// Tiles from this size on are decoded one layer per job on the idle tile workers
+#define PARALLEL_DECODE_BYTES (256 * 1024)
+
 namespace Tangram {
 
-Mvt::Geometry Mvt::getGeometry(ParserContext& _ctx, protobuf::message _geomIn) {
+#ifdef MVT_SIMD_GEOMETRY
+
+// Points of a LineTo command decoded per block, shorter commands take the
+// scalar path
+static constexpr uint32_t lineToBlock = 32;
+static constexpr uint32_t minLineToBlock = 8;
+
+// Varints of up to 3 bytes and cursors below 2^29 keep the sums of a block
+// in 32 bits
+static constexpr int32_t maxBlockCursor = 1 << 29;
+
+static inline int32_t zigzag(uint32_t _value) {
+    return int32_t(_value >> 1) ^ -int32_t(_value & 1);
+}
+
+// Decode up to _count zigzag varints of at most three bytes from _data, until
+// the buffer ends or a varint is longer. Returns the number of decoded x, y
+// pairs and sets _pairsEnd to the end of the last one.
+static uint32_t decodeDeltas(const uint8_t* _data, const uint8_t* _end, uint32_t _count,
+                             int32_t* _deltas, const uint8_t*& _pairsEnd) {
+    uint32_t i = 0;
+    _pairsEnd = _data;
+    while (i < _count) {
+        // Small deltas of neighboring points are mostly one byte each
+        if (_count - i >= 16 && _end - _data >= 16) {
+#if defined(__SSE2__)
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data));
+            if (_mm_movemask_epi8(bytes) == 0) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i one = _mm_set1_epi32(1);
+                __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+                __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+                __m128i v[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                                 _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+                for (int j = 0; j < 4; j++) {
+                    // (v >> 1) ^ -(v & 1)
+                    __m128i sign = _mm_sub_epi32(zero, _mm_and_si128(v[j], one));
+                    __m128i delta = _mm_xor_si128(_mm_srli_epi32(v[j], 1), sign);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(_deltas + i + 4 * j), delta);
+                }
+                _data += 16;
+                i += 16;
+                _pairsEnd = _data - (i & 1);
+                continue;
+            }
+#else
+            uint8x16_t bytes = vld1q_u8(_data);
+            if (vmaxvq_u8(bytes) < 0x80) {
+                const uint32x4_t one = vdupq_n_u32(1);
+                uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+                uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+                uint32x4_t v[4] = { vmovl_u16(vget_low_u16(lo)), vmovl_u16(vget_high_u16(lo)),
+                                    vmovl_u16(vget_low_u16(hi)), vmovl_u16(vget_high_u16(hi)) };
+                for (int j = 0; j < 4; j++) {
+                    // (v >> 1) ^ -(v & 1)
+                    int32x4_t sign = vnegq_s32(vreinterpretq_s32_u32(vandq_u32(v[j], one)));
+                    int32x4_t delta = veorq_s32(vreinterpretq_s32_u32(vshrq_n_u32(v[j], 1)), sign);
+                    vst1q_s32(_deltas + i + 4 * j, delta);
+                }
+                _data += 16;
+                i += 16;
+                _pairsEnd = _data - (i & 1);
+                continue;
+            }
+#endif
+        }
+
+        uint32_t value = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (_data >= _end || shift > 14) { return i / 2; }
+            uint8_t byte = *_data++;
+            value |= uint32_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) { break; }
+        }
+        _deltas[i++] = zigzag(value);
+        if ((i & 1) == 0) { _pairsEnd = _data; }
+    }
+    return i / 2;
+}
+
+// Decode LineTo points of the current command until _count points are read,
+// returns the number of points read. Leaves _geomIn at the first point it
+// did not read, the caller decodes those one by one.
+static uint32_t decodeLineTo(protobuf::message& _geomIn, uint32_t _count, int64_t& _x, int64_t& _y,
+                             int _tileExtent, double _invTileExtent, Mvt::Geometry& _geometry,
+                             size_t& _numCoordinates) {
+
+    alignas(16) int32_t deltas[2 * lineToBlock];
+    alignas(16) float points[2 * lineToBlock];
+
+    uint32_t done = 0;
+    while (_count - done >= minLineToBlock) {
+        if (std::abs(_x) >= maxBlockCursor || std::abs(_y) >= maxBlockCursor) { break; }
+
+        auto data = reinterpret_cast<const uint8_t*>(_geomIn.getData());
+        auto end = reinterpret_cast<const uint8_t*>(_geomIn.getEnd());
+        const uint8_t* next = nullptr;
+
+        uint32_t requested = std::min(_count - done, lineToBlock);
+        uint32_t count = decodeDeltas(data, end, 2 * requested, deltas, next);
+        if (count == 0) { break; }
+
+        // Prefix sums of the interleaved x, y deltas, two points at a time,
+        // then scaled as in the scalar path: (x, extent - y) / (extent - 1)
+        // in double precision, rounded once to float.
+        int32_t x = int32_t(_x), y = int32_t(_y);
+        uint32_t i = 0;
+#if defined(__SSE2__)
+        const __m128i negateY = _mm_set_epi32(-1, 0, -1, 0);
+        const __m128i extent = _mm_set_epi32(_tileExtent, 0, _tileExtent, 0);
+        const __m128d scale = _mm_set1_pd(_invTileExtent);
+        __m128i carry = _mm_set_epi32(y, x, y, x);
+
+        for (; i + 2 <= count; i += 2) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(deltas + 2 * i));
+            __m128i sum = _mm_add_epi32(_mm_add_epi32(d, _mm_slli_si128(d, 8)), carry);
+            carry = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 2, 3, 2));
+
+            __m128i flipped = _mm_add_epi32(_mm_sub_epi32(_mm_xor_si128(sum, negateY), negateY), extent);
+            __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(flipped), scale));
+            __m128 hi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(flipped, _MM_SHUFFLE(1, 0, 3, 2))), scale));
+            _mm_storeu_ps(points + 2 * i, _mm_movelh_ps(lo, hi));
+        }
+        x = _mm_cvtsi128_si32(carry);
+        y = _mm_cvtsi128_si32(_mm_shuffle_epi32(carry, _MM_SHUFFLE(1, 1, 1, 1)));
+#else
+        const int32_t flipValues[4] = { 1, -1, 1, -1 };
+        const int32_t extentValues[4] = { 0, _tileExtent, 0, _tileExtent };
+        const int32x4_t flip = vld1q_s32(flipValues);
+        const int32x4_t extent = vld1q_s32(extentValues);
+        const float64x2_t scale = vdupq_n_f64(_invTileExtent);
+        const int32_t carryValues[4] = { x, y, x, y };
+        int32x4_t carry = vld1q_s32(carryValues);
+
+        for (; i + 2 <= count; i += 2) {
+            int32x4_t d = vld1q_s32(deltas + 2 * i);
+            int32x4_t shifted = vextq_s32(vdupq_n_s32(0), d, 2);
+            int32x4_t sum = vaddq_s32(vaddq_s32(d, shifted), carry);
+            carry = vcombine_s32(vget_high_s32(sum), vget_high_s32(sum));
+
+            int32x4_t flipped = vmlaq_s32(extent, sum, flip);
+            float64x2_t lo = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(flipped))), scale);
+            float64x2_t hi = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(flipped))), scale);
+            vst1q_f32(points + 2 * i, vcombine_f32(vcvt_f32_f64(lo), vcvt_f32_f64(hi)));
+        }
+        x = vgetq_lane_s32(carry, 0);
+        y = vgetq_lane_s32(carry, 1);
+#endif
+        // Odd last point
+        for (; i < count; i++) {
+            x += deltas[2 * i];
+            y += deltas[2 * i + 1];
+            points[2 * i] = float(_invTileExtent * double(x));
+            points[2 * i + 1] = float(_invTileExtent * double(_tileExtent - y));
+        }
 
-    Geometry geometry;
+        // Append, skipping repeated points like the scalar path
+        for (i = 0; i < count; i++) {
+            Point p(points[2 * i], points[2 * i + 1]);
+            if (_numCoordinates == 0 || _geometry.coordinates.back() != p) {
+                _geometry.coordinates.push_back(p);
+                _numCoordinates++;
+            }
+        }
+
+        _x = x;
+        _y = y;
+        _geomIn.skipBytes(next - data);
+        done += count;
+
+        // Stopped at a longer varint
+        if (count < requested) { break; }
+    }
+    return done;
+}
+
+#endif
+
+void Mvt::getGeometry(ParserContext& _ctx, protobuf::message _geomIn) {
+
+    // Reuse buffers of the previous feature
+    Geometry& geometry = _ctx.geometry;
+    geometry.coordinates.clear();
+    geometry.sizes.clear();
 
     GeomCmd cmd = GeomCmd::moveTo;
     uint32_t cmdRepeat = 0;
@@ -44,6 +239,17 @@ Mvt::Geometry Mvt::getGeometry(ParserContext& _ctx, protobuf::message _geomIn) {
             cmdRepeat = cmdData >> 3; //last 5 bits
         }
 
+#ifdef MVT_SIMD_GEOMETRY
+        if (cmd == GeomCmd::lineTo && cmdRepeat >= minLineToBlock) {
+            uint32_t decoded = decodeLineTo(_geomIn, cmdRepeat, x, y, _ctx.tileExtent, invTileExtent,
+                                            geometry, numCoordinates);
+            if (decoded > 0) {
+                cmdRepeat -= decoded;
+                continue;
+            }
+        }
+#endif
+
         if(cmd == GeomCmd::moveTo || cmd == GeomCmd::lineTo) { // get parameters/points
             // if cmd is move then move to a new line/set of points and save this line
             if(cmd == GeomCmd::moveTo) {
@@ -79,17 +285,17 @@ Mvt::Geometry Mvt::getGeometry(ParserContext& _ctx, protobuf::message _geomIn) {
     if (numCoordinates > 0) {
         geometry.sizes.push_back(numCoordinates);
     }
-
-    return geometry;
 }
 
-Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
+void Mvt::addFeature(ParserContext& _ctx, protobuf::message _featureIn, ColumnarLayer& _layer) {
 
-    Feature feature(_ctx.sourceId);
+    GeometryType geometryType = GeometryType::polygons;
 
     _ctx.featureTags.clear();
-    _ctx.featureTags.assign(_ctx.keys.size(), -1);
+    _ctx.featureTags.assign(_layer.keys.size(), -1);
 
+    _ctx.geometry.coordinates.clear();
+    _ctx.geometry.sizes.clear();
 
     while(_featureIn.next()) {
         switch(_featureIn.tag) {
@@ -104,21 +310,21 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
                 while(tagsMsg) {
                     auto tagKey = tagsMsg.varint();
 
-                    if(_ctx.keys.size() <= tagKey) {
+                    if(_layer.keys.size() <= tagKey) {
                         LOGE("accessing out of bound key");
-                        return feature;
+                        return;
                     }
 
                     if(!tagsMsg) {
                         LOGE("uneven number of feature tag ids");
-                        return feature;
+                        return;
                     }
 
                     auto valueKey = tagsMsg.varint();
 
-                    if( _ctx.values.size() <= valueKey ) {
+                    if( _layer.values.size() <= valueKey ) {
                         LOGE("accessing out of bound values");
-                        return feature;
+                        return;
                     }
 
                     _ctx.featureTags[tagKey] = valueKey;
@@ -126,11 +332,11 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
                 break;
             }
             case FEATURE_TYPE:
-                feature.geometryType = (GeometryType)_featureIn.varint();
+                geometryType = (GeometryType)_featureIn.varint();
                 break;
             // Actual geometry data
             case FEATURE_GEOM:
-                _ctx.geometry = getGeometry(_ctx, _featureIn.getMessage());
+                getGeometry(_ctx, _featureIn.getMessage());
                 break;
 
             default:
@@ -139,22 +345,28 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
         }
     }
 
-    std::vector<Properties::Item> properties;
-    properties.reserve(_ctx.featureTags.size());
+    ColumnarLayer::FeatureRange feature;
+    feature.geometryType = geometryType;
 
+    feature.tagsBegin = _layer.tags.size();
     for (int tagKey : _ctx.orderedKeys) {
         int tagValue = _ctx.featureTags[tagKey];
         if (tagValue >= 0) {
-            properties.emplace_back(_ctx.keys[tagKey], _ctx.values[tagValue]);
+            _layer.tags.emplace_back(tagKey, tagValue);
         }
     }
-    feature.props.setSorted(std::move(properties));
+    feature.tagsEnd = _layer.tags.size();
+
+    feature.partsBegin = _layer.parts.size();
+    feature.coordinatesBegin = _layer.coordinates.size();
 
-    switch(feature.geometryType) {
+    auto& coordinates = _layer.coordinates;
+
+    switch(geometryType) {
         case GeometryType::points:
-            feature.points.insert(feature.points.begin(),
-                                  _ctx.geometry.coordinates.begin(),
-                                  _ctx.geometry.coordinates.end());
+            coordinates.insert(coordinates.end(),
+                               _ctx.geometry.coordinates.begin(),
+                               _ctx.geometry.coordinates.end());
             break;
 
         case GeometryType::lines:
@@ -162,11 +374,9 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
             auto pos = _ctx.geometry.coordinates.begin();
             for (int length : _ctx.geometry.sizes) {
                 if (length == 0) { continue; }
-                Line line;
-                line.reserve(length);
-                line.insert(line.begin(), pos, pos + length);
+                coordinates.insert(coordinates.end(), pos, pos + length);
+                _layer.parts.push_back({ uint32_t(length), false });
                 pos += length;
-                feature.lines.emplace_back(std::move(line));
             }
             break;
         }
@@ -174,6 +384,7 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
         {
             auto pos = _ctx.geometry.coordinates.begin();
             auto rpos = _ctx.geometry.coordinates.rend();
+            bool first = true;
             for (int length : _ctx.geometry.sizes) {
                 if (length == 0) { continue; }
                 float area = signedArea(pos, pos + length);
@@ -187,20 +398,18 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
                 if (_ctx.winding == 0) {
                     _ctx.winding = winding;
                 }
-                Line line;
-                line.reserve(length);
                 if (_ctx.winding > 0) {
-                    line.insert(line.end(), pos, pos + length);
+                    coordinates.insert(coordinates.end(), pos, pos + length);
                 } else {
-                    line.insert(line.end(), rpos - length, rpos);
+                    coordinates.insert(coordinates.end(), rpos - length, rpos);
                 }
                 pos += length;
                 rpos -= length;
-                if (winding == _ctx.winding || feature.polygons.empty()) {
-                    // This is an exterior polygon.
-                    feature.polygons.emplace_back();
-                }
-                feature.polygons.back().push_back(std::move(line));
+
+                // Exterior polygon rings start a new polygon.
+                bool exterior = (winding == _ctx.winding || first);
+                _layer.parts.push_back({ uint32_t(length), exterior });
+                first = false;
             }
             break;
         }
@@ -210,15 +419,14 @@ Feature Mvt::getFeature(ParserContext& _ctx, protobuf::message _featureIn) {
             break;
     }
 
-    return feature;
-}
+    feature.partsEnd = _layer.parts.size();
+    feature.coordinatesEnd = _layer.coordinates.size();
 
-Layer Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn) {
+    _layer.features.push_back(feature);
+}
 
-    Layer layer("");
+void Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn, ColumnarLayer& _layer) {
 
-    _ctx.keys.clear();
-    _ctx.values.clear();
     _ctx.featureMsgs.clear();
 
     bool lastWasFeature = false;
@@ -230,7 +438,7 @@ Layer Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn) {
 
         switch(_layerIn.tag) {
             case LAYER_NAME: {
-                layer.name = _layerIn.string();
+                _layer.name = _layerIn.string();
                 break;
             }
             case LAYER_FEATURE: {
@@ -243,7 +451,7 @@ Layer Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn) {
                 continue;
             }
             case LAYER_KEY: {
-                _ctx.keys.push_back(_layerIn.string());
+                _layer.keys.emplace_back(_layerIn.string());
                 break;
             }
             case LAYER_VALUE: {
@@ -252,28 +460,28 @@ Layer Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn) {
                 while (valueItr.next()) {
                     switch (valueItr.tag) {
                         case 1: // string value
-                            _ctx.values.push_back(valueItr.string());
+                            _layer.values.push_back(valueItr.string());
                             break;
                         case 2: // float value
-                            _ctx.values.push_back(valueItr.float32());
+                            _layer.values.push_back(valueItr.float32());
                             break;
                         case 3: // double value
-                            _ctx.values.push_back(valueItr.float64());
+                            _layer.values.push_back(valueItr.float64());
                             break;
                         case 4: // int value
-                            _ctx.values.push_back(valueItr.int64());
+                            _layer.values.push_back(valueItr.int64());
                             break;
                         case 5: // uint value
-                            _ctx.values.push_back(valueItr.varint());
+                            _layer.values.push_back(valueItr.varint());
                             break;
                         case 6: // sint value
-                            _ctx.values.push_back(valueItr.int64());
+                            _layer.values.push_back(valueItr.int64());
                             break;
                         case 7: // bool value
-                            _ctx.values.push_back(valueItr.boolean());
+                            _layer.values.push_back(valueItr.boolean());
                             break;
                         default:
-                            _ctx.values.push_back(none_type{});
+                            _layer.values.push_back(none_type{});
                             valueItr.skip();
                             break;
                     }
@@ -291,32 +499,82 @@ Layer Mvt::getLayer(ParserContext& _ctx, protobuf::message _layerIn) {
         lastWasFeature = false;
     }
 
-    if (_ctx.featureMsgs.empty()) { return layer; }
+    if (_ctx.featureMsgs.empty()) { return; }
+
+    // Features that can't pass the filter of the collection are not decoded
+    bool filtering = _ctx.collection && !_ctx.collection->keepAll();
+    if (filtering) {
+        PropertyKey key;
+        if (!PropertyKey::find(_ctx.collection->key, key)) { return; }
+
+        auto keyIt = std::find(_layer.keys.begin(), _layer.keys.end(), key);
+        if (keyIt == _layer.keys.end()) { return; }
+        _ctx.filterKey = int(keyIt - _layer.keys.begin());
+
+        auto& accepted = _ctx.collection->values;
+        _ctx.filterValues.clear();
+        _ctx.filterValues.reserve(_layer.values.size());
+        for (auto& value : _layer.values) {
+            _ctx.filterValues.push_back(value.is<std::string>() &&
+                                        std::binary_search(accepted.begin(), accepted.end(),
+                                                           value.get<std::string>()));
+        }
+    }
 
     //// Assign ordering to keys for faster sorting
     _ctx.orderedKeys.clear();
-    _ctx.orderedKeys.reserve(_ctx.keys.size());
+    _ctx.orderedKeys.reserve(_layer.keys.size());
     // assign key ids
-    for (int i = 0, n = _ctx.keys.size(); i < n; i++) {
+    for (int i = 0, n = _layer.keys.size(); i < n; i++) {
+        // Tags of properties that no layer reads are dropped
+        if (_ctx.filter && !_ctx.filter->keepsProperty(_layer.keys[i].name())) { continue; }
         _ctx.orderedKeys.push_back(i);
     }
     // sort by Property key ordering
     std::sort(_ctx.orderedKeys.begin(), _ctx.orderedKeys.end(),
               [&](int a, int b) {
-                  return Properties::keyComparator(_ctx.keys[a], _ctx.keys[b]);
+                  return _layer.keys[a] < _layer.keys[b];
               });
 
-    layer.features.reserve(numFeatures);
+    _layer.features.reserve(numFeatures);
     for (auto& featureItr : _ctx.featureMsgs) {
         do {
             auto featureMsg = featureItr.getMessage();
 
-            layer.features.push_back(getFeature(_ctx, featureMsg));
+            if (filtering && !passesFilter(_ctx, featureMsg)) { continue; }
+
+            addFeature(_ctx, featureMsg, _layer);
 
         } while (featureItr.next() && featureItr.tag == LAYER_FEATURE);
     }
+}
+
+std::string Mvt::getLayerName(protobuf::message _layerIn) {
+    while (_layerIn.next()) {
+        if (_layerIn.tag == LAYER_NAME) { return _layerIn.string(); }
+        _layerIn.skip();
+    }
+    return "";
+}
 
-    return layer;
+bool Mvt::passesFilter(const ParserContext& _ctx, protobuf::message _featureIn) {
+    while (_featureIn.next()) {
+        if (_featureIn.tag != FEATURE_TAGS) {
+            _featureIn.skip();
+            continue;
+        }
+        protobuf::message tagsMsg = _featureIn.getMessage();
+        while (tagsMsg) {
+            auto tagKey = tagsMsg.varint();
+            if (!tagsMsg) { return false; }
+            auto valueKey = tagsMsg.varint();
+
+            if (int(tagKey) == _ctx.filterKey) {
+                return valueKey < _ctx.filterValues.size() && _ctx.filterValues[valueKey];
+            }
+        }
+    }
+    return false;
 }
 
 std::shared_ptr<TileData> Mvt::parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId) {
@@ -325,17 +583,48 @@ std::shared_ptr<TileData> Mvt::parseTile(const TileTask& _task, const MapProject
 
     auto& task = static_cast<const BinaryTileTask&>(_task);
 
-    protobuf::message item(task.rawTileData->data(), task.rawTileData->size());
+    protobuf::message item(task.rawTileData.data(), task.rawTileData.size());
     ParserContext ctx(_sourceId);
 
+    auto& filter = _task.featureFilter();
+    ctx.filter = filter.get();
+
+    // Layers to decode with the filter of their collection
+    std::vector<std::pair<protobuf::message, const FeatureFilter::Collection*>> layers;
+
     try {
         while(item.next()) {
             if(item.tag == 3) {
-                tileData->layers.push_back(getLayer(ctx, item.getMessage()));
+                auto layerMsg = item.getMessage();
+                const FeatureFilter::Collection* collection = nullptr;
+
+                // Skip layers that no data layer of the scene takes
+                if (filter) {
+                    auto name = getLayerName(layerMsg);
+                    collection = filter->collection(name);
+                    if (!collection && !name.empty()) { continue; }
+                }
+                layers.emplace_back(layerMsg, collection);
             } else {
                 item.skip();
             }
         }
+
+        if (task.rawTileData.size() < PARALLEL_DECODE_BYTES || layers.size() < 2) {
+            for (auto& layer : layers) {
+                // The tile went offscreen, partial data must not be cached
+                if (_task.isCanceled()) { return {}; }
+
+                ctx.collection = layer.second;
+                tileData->columnarLayers.emplace_back("", _sourceId);
+                getLayer(ctx, layer.first, tileData->columnarLayers.back());
+            }
+        } else if (!parseLayers(_task, layers, _sourceId, *tileData)) {
+            if (!_task.isCanceled()) {
+                LOGE("Cannot parse tile %s", _task.tileId().toString().c_str());
+            }
+            return {};
+        }
     } catch(const std::invalid_argument& e) {
         LOGE("Cannot parse tile %s: %s", _task.tileId().toString().c_str(), e.what());
         return {};
@@ -345,7 +634,45 @@ std::shared_ptr<TileData> Mvt::parseTile(const TileTask& _task, const MapProject
     } catch(...) {
         return {};
     }
+    tileData->featureFilter = filter;
+
     return tileData;
 }
 
+bool Mvt::parseLayers(const TileTask& _task,
+                      const std::vector<std::pair<protobuf::message, const FeatureFilter::Collection*>>& _layers,
+                      int32_t _sourceId, TileData& _tileData) {
+
+    // Each job decodes one layer with its own context. Layers are appended
+    // in tile order once all are done, independent of which worker ran them.
+    std::vector<std::unique_ptr<ColumnarLayer>> results(_layers.size());
+    std::atomic<bool> failed{false};
+
+    TileWorker::parallelFor(_layers.size(), [&](size_t _index) {
+        if (failed || _task.isCanceled()) { return; }
+        try {
+            ParserContext ctx(_sourceId);
+            ctx.filter = _task.featureFilter().get();
+            ctx.collection = _layers[_index].second;
+
+            auto layer = std::make_unique<ColumnarLayer>("", _sourceId);
+            getLayer(ctx, _layers[_index].first, *layer);
+            results[_index] = std::move(layer);
+        } catch (const std::exception& e) {
+            LOGE("Cannot parse layer %d: %s", int(_index), e.what());
+            failed = true;
+        } catch (...) {
+            failed = true;
+        }
+    });
+
+    if (failed || _task.isCanceled()) { return false; }
+
+    _tileData.columnarLayers.reserve(_tileData.columnarLayers.size() + results.size());
+    for (auto& layer : results) {
+        _tileData.columnarLayers.push_back(std::move(*layer));
+    }
+    return true;
+}
+
 }
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "data/featureFilter.h"
 #include "data/tileData.h"
 #include "pbf/pbf.hpp"
+#include "util/arena.h"
 #include "util/variant.h"
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace Tangram {
@@ -17,25 +20,31 @@ class MapProjection;
 namespace Mvt {
 
     struct Geometry {
-        std::vector<Point> coordinates;
-        std::vector<int> sizes;
+        ArenaVector<Point> coordinates;
+        ArenaVector<int> sizes;
     };
 
     struct ParserContext {
         ParserContext(int32_t _sourceId) : sourceId(_sourceId){}
 
         int32_t sourceId;
-        std::vector<std::string> keys;
-        std::vector<Value> values;
-        std::vector<protobuf::message> featureMsgs;
+        ArenaVector<protobuf::message> featureMsgs;
         Geometry geometry;
         // Map Key ID -> Tag values
-        std::vector<int> featureTags;
+        ArenaVector<int> featureTags;
         // Key IDs sorted by Property key ordering
-        std::vector<int> orderedKeys;
+        ArenaVector<int> orderedKeys;
 
         int tileExtent = 0;
         int winding = 0;
+
+        // Filter of the tile, null to keep all properties
+        const FeatureFilter* filter = nullptr;
+        // Filter of the current layer, null to keep all features
+        const FeatureFilter::Collection* collection = nullptr;
+        // Key ID of the filter property and which value IDs pass the filter
+        int filterKey = -1;
+        ArenaVector<char> filterValues;
     };
 
     enum GeomCmd {
@@ -44,11 +53,25 @@ namespace Mvt {
         closePath = 7
     };
 
-    Geometry getGeometry(ParserContext& _ctx, protobuf::message _geomIn);
+    // Decode _geomIn into _ctx.geometry
+    void getGeometry(ParserContext& _ctx, protobuf::message _geomIn);
+
+    // Append the feature to the columns of _layer
+    void addFeature(ParserContext& _ctx, protobuf::message _featureIn, ColumnarLayer& _layer);
+
+    void getLayer(ParserContext& _ctx, protobuf::message _layerIn, ColumnarLayer& _layer);
+
+    // Name of the layer, read without decoding its features
+    std::string getLayerName(protobuf::message _layerIn);
 
-    Feature getFeature(ParserContext& _ctx, protobuf::message _featureIn);
+    // Whether the tags of the feature pass the filter of the current layer
+    bool passesFilter(const ParserContext& _ctx, protobuf::message _featureIn);
 
-    Layer getLayer(ParserContext& _ctx, protobuf::message _layerIn);
+    // Decode _layers in parallel, see TileWorker::parallelFor. Returns false
+    // when one of them is invalid or _task got canceled.
+    bool parseLayers(const TileTask& _task,
+                     const std::vector<std::pair<protobuf::message, const FeatureFilter::Collection*>>& _layers,
+                     int32_t _sourceId, TileData& _tileData);
 
     std::shared_ptr<TileData> parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId);
 
@@ -1,11 +1,13 @@
 #include "data/formats/topoJson.h"
-#include "data/formats/geoJson.h"
 #include "data/propertyItem.h"
 #include "tile/tileTask.h"
 #include "util/geom.h"
 #include "util/mapProjection.h"
 #include "log.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace Tangram {
 
 TopoJson::Topology TopoJson::getTopology(const JsonDocument& _document, const Transform& _proj) {
@@ -41,57 +43,74 @@ TopoJson::Topology TopoJson::getTopology(const JsonDocument& _document, const Tr
 
     topo.arcs.reserve(jsonArcs.Size());
 
-    // Decode and transform the points that make up 'arcs'
+    // Decode the points that make up 'arcs' and project all of them at once
+    std::vector<glm::dvec2> lonLats;
     for (auto jsonArcsIt = jsonArcs.Begin(); jsonArcsIt != jsonArcs.End(); ++jsonArcsIt) {
 
         const auto& jsonArc = *jsonArcsIt;
 
-        if (!jsonArc.IsArray()) { // According to spec, jsonArc.Size() >= 2 should also hold
-            continue;
-        }
-
-        Line arc;
-        arc.reserve(jsonArc.Size());
+        Topology::Arc arc;
+        arc.begin = lonLats.size();
 
-        // Quantized position
-        glm::ivec2 q;
+        // Arcs that are not arrays stay empty to keep the indices of the following arcs
+        // According to spec, jsonArc.Size() >= 2 should also hold
+        if (jsonArc.IsArray()) {
+            // Quantized position
+            glm::ivec2 q;
 
-        for (auto jsonCoordsIt = jsonArc.Begin(); jsonCoordsIt != jsonArc.End(); ++jsonCoordsIt) {
-
-            const auto& jsonCoords = *jsonCoordsIt;
-
-            arc.push_back(getPoint(jsonCoords, topo, q));
+            for (auto jsonCoordsIt = jsonArc.Begin(); jsonCoordsIt != jsonArc.End(); ++jsonCoordsIt) {
+                lonLats.push_back(decode(*jsonCoordsIt, topo, q));
+            }
         }
 
+        arc.end = lonLats.size();
         topo.arcs.push_back(arc);
     }
 
+    topo.points.resize(lonLats.size());
+    if (!lonLats.empty()) { topo.proj(lonLats.data(), topo.points.data(), lonLats.size()); }
+
     return topo;
 }
 
-Point TopoJson::getPoint(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor) {
+glm::dvec2 TopoJson::decode(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor) {
 
     if (!_coordinates.IsArray() || _coordinates.Size() < 2) {
-        return Point();
+        return glm::dvec2(_cursor) * _topology.scale + _topology.translate;
     }
 
     _cursor.x += _coordinates[0].GetInt();
     _cursor.y += _coordinates[1].GetInt();
 
-    return _topology.proj(glm::dvec2(_cursor) * _topology.scale + _topology.translate);
+    return glm::dvec2(_cursor) * _topology.scale + _topology.translate;
 
 }
 
-Line TopoJson::getLine(const JsonValue& _arcs, const Topology& _topology) {
+Point TopoJson::getPoint(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor) {
 
-    Line line;
+    if (!_coordinates.IsArray() || _coordinates.Size() < 2) {
+        return Point();
+    }
+
+    glm::dvec2 lonLat = decode(_coordinates, _topology, _cursor);
+    Point point;
+    _topology.proj(&lonLat, &point, 1);
+    return point;
+
+}
+
+uint32_t TopoJson::getLine(const JsonValue& _arcs, const Topology& _topology, ArenaVector<Point>& _coordinates) {
 
     if (!_arcs.IsArray()) {
-        return line;
+        return 0;
     }
 
+    size_t start = _coordinates.size();
+
     for (auto arcIt = _arcs.Begin(); arcIt != _arcs.End(); ++arcIt) {
 
+        if (!arcIt->IsInt()) { continue; }
+
         auto index = arcIt->GetInt();
         bool reverse = false;
         if (index < 0) {
@@ -99,70 +118,71 @@ Line TopoJson::getLine(const JsonValue& _arcs, const Topology& _topology) {
             index = -1 - index;
         }
 
-        if (index < 0 || (std::vector<Line>::size_type)index >= _topology.arcs.size()) {
+        if (index < 0 || size_t(index) >= _topology.arcs.size()) {
             continue;
         }
 
         const auto& arc = _topology.arcs[index];
+        if (arc.begin == arc.end) { continue; }
 
-        auto begin = arc.begin();
-        auto end = arc.end();
-        size_t inc = 1;
-        if (reverse) {
-            begin = arc.end() - 1;
-            end = arc.begin() - 1;
-            inc = -inc;
-        }
+        auto begin = _topology.points.begin() + arc.begin;
+        auto end = _topology.points.begin() + arc.end;
 
         // If a line is made from multiple arcs, the first position of an arc must
         // be equal to the last position of the previous arc. So when reconstructing
         // the geometry, the first position of each arc except the first may be dropped
-        if (arcIt != _arcs.Begin()) {
-            begin = begin + inc;
-        }
+        bool skipFirst = _coordinates.size() > start;
 
-        for (auto pointIt = begin; pointIt != end; pointIt += inc) {
-            line.push_back(*pointIt);
+        if (reverse) {
+            auto rbegin = std::make_reverse_iterator(end) + (skipFirst ? 1 : 0);
+            _coordinates.insert(_coordinates.end(), rbegin, std::make_reverse_iterator(begin));
+        } else {
+            _coordinates.insert(_coordinates.end(), begin + (skipFirst ? 1 : 0), end);
         }
-
-    }
-
-    return line;
-
-}
-
-Polygon TopoJson::getPolygon(const JsonValue& _arcSets, const Topology& _topology) {
-
-    Polygon polygon;
-
-    if (!_arcSets.IsArray()) {
-        return polygon;
-    }
-
-    for (auto arcSetIt = _arcSets.Begin(); arcSetIt != _arcSets.End(); ++arcSetIt) {
-
-        auto ring = getLine(*arcSetIt, _topology);
-        polygon.push_back(ring);
-
     }
 
-    return polygon;
+    return _coordinates.size() - start;
 
 }
 
-Feature TopoJson::getFeature(const JsonValue& _geometry, const Topology& _topology, int32_t _source) {
+void TopoJson::addFeature(const JsonValue& _geometry, const Topology& _topology, ColumnarLayer& _layer,
+                          std::unordered_map<std::string, uint32_t>& _keys) {
 
     static const JsonValue keyProperties("properties");
     static const JsonValue keyType("type");
     static const JsonValue keyCoordinates("coordinates");
     static const JsonValue keyArcs("arcs");
 
-    Feature feature;
+    ColumnarLayer::FeatureRange feature;
+    feature.geometryType = GeometryType::polygons;
 
+    // Properties are interned per layer, tags are kept in key order
+    feature.tagsBegin = _layer.tags.size();
     auto propertiesIt = _geometry.FindMember(keyProperties);
     if (propertiesIt != _geometry.MemberEnd() && propertiesIt->value.IsObject()) {
-        feature.props = GeoJson::getProperties(propertiesIt->value, _source);
+        const auto& properties = propertiesIt->value;
+        for (auto it = properties.MemberBegin(); it != properties.MemberEnd(); ++it) {
+            const auto& value = it->value;
+            if (value.IsNumber()) {
+                _layer.values.push_back(value.GetDouble());
+            } else if (value.IsString()) {
+                _layer.values.push_back(std::string(value.GetString(), value.GetStringLength()));
+            } else if (value.IsBool()) {
+                _layer.values.push_back(double(value.GetBool()));
+            } else {
+                continue;
+            }
+            auto key = _keys.emplace(it->name.GetString(), _layer.keys.size());
+            if (key.second) { _layer.keys.emplace_back(key.first->first); }
+
+            _layer.tags.emplace_back(key.first->second, _layer.values.size() - 1);
+        }
     }
+    feature.tagsEnd = _layer.tags.size();
+    std::sort(_layer.tags.begin() + feature.tagsBegin, _layer.tags.end(),
+              [&](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+                  return _layer.keys[a.first] < _layer.keys[b.first];
+              });
 
     std::string type;
     auto typeIt = _geometry.FindMember(keyType);
@@ -170,77 +190,96 @@ Feature TopoJson::getFeature(const JsonValue& _geometry, const Topology& _topolo
         type = typeIt->value.GetString();
     }
 
+    feature.partsBegin = _layer.parts.size();
+    feature.coordinatesBegin = _layer.coordinates.size();
+
+    auto coordinatesIt = _geometry.FindMember(keyCoordinates);
+    auto arcsIt = _geometry.FindMember(keyArcs);
+    bool hasCoordinates = coordinatesIt != _geometry.MemberEnd();
+    bool hasArcs = arcsIt != _geometry.MemberEnd() && arcsIt->value.IsArray();
+
+    auto addLine = [&](const JsonValue& _arcs, bool _exterior) {
+        uint32_t length = getLine(_arcs, _topology, _layer.coordinates);
+        if (length > 0) { _layer.parts.push_back({ length, _exterior }); }
+    };
+
+    // The first ring of a polygon is its exterior ring
+    auto addPolygon = [&](const JsonValue& _rings) {
+        if (!_rings.IsArray()) { return; }
+        bool exterior = true;
+        for (auto ring = _rings.Begin(); ring != _rings.End(); ++ring) {
+            addLine(*ring, exterior);
+            exterior = false;
+        }
+    };
+
     if (type == "Point") {
         feature.geometryType = GeometryType::points;
-        auto coordinatesIt = _geometry.FindMember(keyCoordinates);
-        if (coordinatesIt != _geometry.MemberEnd()) {
+        if (hasCoordinates) {
             glm::ivec2 cursor;
-            feature.points.push_back(getPoint(coordinatesIt->value, _topology, cursor));
+            _layer.coordinates.push_back(getPoint(coordinatesIt->value, _topology, cursor));
         }
     } else if (type == "MultiPoint") {
         feature.geometryType = GeometryType::points;
-        auto coordinatesIt = _geometry.FindMember(keyCoordinates);
-        if (coordinatesIt != _geometry.MemberEnd() && coordinatesIt->value.IsArray()) {
+        if (hasCoordinates && coordinatesIt->value.IsArray()) {
             auto& coordinates = coordinatesIt->value;
             for (auto point = coordinates.Begin(); point != coordinates.End(); ++point) {
                 glm::ivec2 cursor;
-                feature.points.push_back(getPoint(*point, _topology, cursor));
+                _layer.coordinates.push_back(getPoint(*point, _topology, cursor));
             }
         }
     } else if (type == "LineString") {
         feature.geometryType = GeometryType::lines;
-        auto arcsIt = _geometry.FindMember(keyArcs);
-        if (arcsIt != _geometry.MemberEnd()) {
-            feature.lines.push_back(getLine(arcsIt->value, _topology));
-        }
+        if (hasArcs) { addLine(arcsIt->value, false); }
     } else if (type == "MultiLineString") {
         feature.geometryType = GeometryType::lines;
-        auto arcsIt = _geometry.FindMember(keyArcs);
-        if (arcsIt != _geometry.MemberEnd() && arcsIt->value.IsArray()) {
+        if (hasArcs) {
             auto& arcs = arcsIt->value;
             for (auto arcList = arcs.Begin(); arcList != arcs.End(); ++arcList) {
-                feature.lines.push_back(getLine(*arcList, _topology));
+                addLine(*arcList, false);
             }
         }
     } else if (type == "Polygon") {
         feature.geometryType = GeometryType::polygons;
-        auto arcsIt = _geometry.FindMember(keyArcs);
-        if (arcsIt != _geometry.MemberEnd()) {
-            feature.polygons.push_back(getPolygon(arcsIt->value, _topology));
-        }
+        if (hasArcs) { addPolygon(arcsIt->value); }
     } else if (type == "MultiPolygon") {
         feature.geometryType = GeometryType::polygons;
-        auto arcsIt = _geometry.FindMember(keyArcs);
-        if (arcsIt != _geometry.MemberEnd() && arcsIt->value.IsArray()) {
+        if (hasArcs) {
             auto& arcs = arcsIt->value;
             for (auto arcList = arcs.Begin(); arcList != arcs.End(); ++arcList) {
-                feature.polygons.push_back(getPolygon(*arcList, _topology));
+                addPolygon(*arcList);
             }
         }
     } else if (type == "GeometryCollection") {
         // Not handled
     }
 
-    return feature;
+    feature.partsEnd = _layer.parts.size();
+    feature.coordinatesEnd = _layer.coordinates.size();
+
+    _layer.features.push_back(feature);
 
 }
 
-Layer TopoJson::getLayer(JsonValue::MemberIterator& _objectIt, const Topology& _topology, int32_t _source) {
+void TopoJson::getLayer(const JsonValue& _object, const Topology& _topology, ColumnarLayer& _layer) {
 
-    Layer layer(_objectIt->name.GetString());
+    auto type = _object.FindMember("type");
+    if (type == _object.MemberEnd() || !type->value.IsString() ||
+        strcmp("GeometryCollection", type->value.GetString()) != 0) {
+        return;
+    }
 
-    JsonValue& object = _objectIt->value;
-    auto type = object.FindMember("type");
-    if (type != object.MemberEnd() && strcmp("GeometryCollection", type->value.GetString()) == 0) {
-        auto geometries = object.FindMember("geometries");
-        if (geometries != object.MemberEnd() && geometries->value.IsArray()) {
-            for (auto it = geometries->value.Begin(); it != geometries->value.End(); ++it) {
-                layer.features.push_back(getFeature(*it, _topology, _source));
-            }
-        }
+    auto geometries = _object.FindMember("geometries");
+    if (geometries == _object.MemberEnd() || !geometries->value.IsArray()) {
+        return;
     }
 
-    return layer;
+    std::unordered_map<std::string, uint32_t> keys;
+
+    _layer.features.reserve(geometries->value.Size());
+    for (auto it = geometries->value.Begin(); it != geometries->value.End(); ++it) {
+        addFeature(*it, _topology, _layer, keys);
+    }
 
 }
 
@@ -253,7 +292,7 @@ std::shared_ptr<TileData> TopoJson::parseTile(const TileTask& _task, const MapPr
     // Parse data into a JSON document
     const char* error;
     size_t offset;
-    auto document = JsonParseBytes(task.rawTileData->data(), task.rawTileData->size(), &error, &offset);
+    auto document = JsonParseBytes(task.rawTileData.data(), task.rawTileData.size(), &error, &offset);
 
     if (error) {
         LOGE("Json parsing failed on tile [%s]: %s (%u)", task.tileId().toString().c_str(), error, offset);
@@ -265,12 +304,8 @@ std::shared_ptr<TileData> TopoJson::parseTile(const TileTask& _task, const MapPr
     glm::dvec2 tileOrigin = {tileBounds.min.x, tileBounds.max.y*-1.0};
     double tileInverseScale = 1.0 / tileBounds.width();
 
-    const auto projFn = [&](glm::dvec2 _lonLat){
-        glm::dvec2 tmp = _projection.LonLatToMeters(_lonLat);
-        return Point {
-            (tmp.x - tileOrigin.x) * tileInverseScale,
-            (tmp.y - tileOrigin.y) * tileInverseScale,
-        };
+    const auto projFn = [&](const glm::dvec2* _lonLat, Point* _out, size_t _count) {
+        _projection.LonLatToLocal(_lonLat, _out, _count, tileOrigin, tileInverseScale);
     };
 
     // Parse topology and transform
@@ -281,7 +316,8 @@ std::shared_ptr<TileData> TopoJson::parseTile(const TileTask& _task, const MapPr
     if (objectsIt == document.MemberEnd()) { return tileData; }
     auto& objects = objectsIt->value;
     for (auto layer = objects.MemberBegin(); layer != objects.MemberEnd(); ++layer) {
-        tileData->layers.push_back(TopoJson::getLayer(layer, topology, _source));
+        tileData->columnarLayers.emplace_back(layer->name.GetString(), _source);
+        TopoJson::getLayer(layer->value, topology, tileData->columnarLayers.back());
     }
 
     // Discard JSON object and return TileData
@@ -6,6 +6,8 @@
 #include "glm/vec2.hpp"
 #include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 namespace Tangram {
 
@@ -14,26 +16,40 @@ class MapProjection;
 
 namespace TopoJson {
 
-using Transform = std::function<Point(glm::dvec2 _lonLat)>;
+// Projects _count positions at once into _out
+using Transform = std::function<void(const glm::dvec2* _lonLat, Point* _out, size_t _count)>;
 
 struct Topology {
+    // Range of an arc in points
+    struct Arc {
+        uint32_t begin, end;
+    };
     glm::dvec2 scale = { 1., 1. };
     glm::dvec2 translate = { 0., 0. };
-    std::vector<Line> arcs;
+    // Decoded and projected positions of all arcs, shared borders are
+    // decoded once and referenced by every geometry using them
+    std::vector<Point> points;
+    std::vector<Arc> arcs;
     Transform proj;
 };
 
 Topology getTopology(const JsonDocument& _document, const Transform& _proj);
 
-Point getPoint(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor);
+// Position of a quantized, delta-encoded _coordinates pair relative to _cursor
+glm::dvec2 decode(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor);
 
-Line getLine(const JsonValue& _arcs, const Topology& _topology);
+Point getPoint(const JsonValue& _coordinates, const Topology& _topology, glm::ivec2& _cursor);
 
-Polygon getPolygon(const JsonValue& _arcs, const Topology& _topology);
+// Appends the line stitched from the arc indices in _arcs to _coordinates,
+// returns the number of appended points
+uint32_t getLine(const JsonValue& _arcs, const Topology& _topology, ArenaVector<Point>& _coordinates);
 
-Feature getFeature(const JsonValue& _geometry, const Topology& _topology, int32_t _sourceId);
+// Appends the geometry object to _layer, _keys maps property names to the
+// indices of _layer.keys
+void addFeature(const JsonValue& _geometry, const Topology& _topology, ColumnarLayer& _layer,
+                std::unordered_map<std::string, uint32_t>& _keys);
 
-Layer getLayer(JsonValue::MemberIterator& _object, const Topology& _topology, int32_t _sourceId);
+void getLayer(const JsonValue& _object, const Topology& _topology, ColumnarLayer& _layer);
 
 std::shared_ptr<TileData> parseTile(const TileTask& _task, const MapProjection& _projection, int32_t _sourceId);
 
@@ -0,0 +1,274 @@
+#include "data/geometryClipper.h"
+
+#include "glm/common.hpp"
+
+#include <limits>
+
+namespace Tangram {
+
+GeometryClipper::GeometryClipper(float _buffer)
+    : m_min(-_buffer),
+      m_max(1.f + _buffer) {}
+
+static Point intersect(const Point& _a, const Point& _b, float _da, float _db) {
+    return _a + (_b - _a) * (_da / (_da - _db));
+}
+
+auto GeometryClipper::bounds(const Line& _line) const -> Bounds {
+    glm::vec2 min(std::numeric_limits<float>::max());
+    glm::vec2 max(std::numeric_limits<float>::lowest());
+
+    for (auto& p : _line) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    if (max.x < m_min || min.x > m_max || max.y < m_min || min.y > m_max) {
+        return Bounds::outside;
+    }
+    if (min.x >= m_min && max.x <= m_max && min.y >= m_min && max.y <= m_max) {
+        return Bounds::inside;
+    }
+    return Bounds::intersecting;
+}
+
+void GeometryClipper::distances(const Line& _line, int _edge) {
+    // Edges are x >= min, x <= max, y >= min and y <= max
+    int axis = _edge / 2;
+    float bound = (_edge % 2) ? m_max : m_min;
+    float sign = (_edge % 2) ? -1.f : 1.f;
+
+    size_t n = _line.size();
+    m_distances.resize(n);
+
+    float* d = m_distances.data();
+    for (size_t i = 0; i < n; i++) {
+        d[i] = sign * (_line[i][axis] - bound);
+    }
+}
+
+void GeometryClipper::clipLine(const Line& _line, int _edge, std::vector<Line>& _out) {
+    distances(_line, _edge);
+
+    const auto& d = m_distances;
+    bool open = false;
+
+    for (size_t i = 0; i < _line.size(); i++) {
+        if (d[i] >= 0.f) {
+            if (!open) {
+                _out.emplace_back();
+                open = true;
+                // Points on the edge need no intersection
+                if (i > 0 && d[i] > 0.f) {
+                    _out.back().push_back(intersect(_line[i - 1], _line[i], d[i - 1], d[i]));
+                }
+            }
+            _out.back().push_back(_line[i]);
+
+        } else if (open) {
+            if (d[i - 1] > 0.f) {
+                _out.back().push_back(intersect(_line[i - 1], _line[i], d[i - 1], d[i]));
+            }
+            open = false;
+            if (_out.back().size() < 2) { _out.pop_back(); }
+        }
+    }
+
+    if (open && _out.back().size() < 2) { _out.pop_back(); }
+}
+
+void GeometryClipper::clipLine(const Line& _line, std::vector<Line>& _out) {
+    switch (bounds(_line)) {
+    case Bounds::inside: _out.push_back(_line); return;
+    case Bounds::outside: return;
+    case Bounds::intersecting: break;
+    }
+
+    auto& lines = m_lines[0];
+    auto& next = m_lines[1];
+
+    lines.clear();
+    clipLine(_line, 0, lines);
+
+    for (int edge = 1; edge < 4; edge++) {
+        next.clear();
+        for (auto& line : lines) { clipLine(line, edge, next); }
+        std::swap(lines, next);
+    }
+
+    for (auto& line : lines) { _out.push_back(std::move(line)); }
+}
+
+void GeometryClipper::clipRing(const Line& _ring, int _edge, Line& _out) {
+    _out.clear();
+    if (_ring.empty()) { return; }
+
+    distances(_ring, _edge);
+
+    const auto& d = m_distances;
+    size_t prev = _ring.size() - 1;
+
+    for (size_t i = 0; i < _ring.size(); i++) {
+        if ((d[i] < 0.f && d[prev] > 0.f) || (d[i] > 0.f && d[prev] < 0.f)) {
+            _out.push_back(intersect(_ring[prev], _ring[i], d[prev], d[i]));
+        }
+        if (d[i] >= 0.f) { _out.push_back(_ring[i]); }
+        prev = i;
+    }
+}
+
+bool GeometryClipper::clipRing(const Line& _ring, Line& _out) {
+    switch (bounds(_ring)) {
+    case Bounds::inside: _out = _ring; return true;
+    case Bounds::outside: _out.clear(); return false;
+    case Bounds::intersecting: break;
+    }
+
+    clipRing(_ring, 0, m_rings[0]);
+    clipRing(m_rings[0], 1, m_rings[1]);
+    clipRing(m_rings[1], 2, m_rings[0]);
+    clipRing(m_rings[0], 3, _out);
+
+    if (_out.size() < 3) {
+        _out.clear();
+        return false;
+    }
+    if (_out.front() != _out.back()) { _out.push_back(_out.front()); }
+
+    return true;
+}
+
+void GeometryClipper::clipPolygon(const Polygon& _polygon, std::vector<Polygon>& _out) {
+    if (_polygon.empty()) { return; }
+
+    Polygon clipped;
+    clipped.reserve(_polygon.size());
+
+    for (size_t i = 0; i < _polygon.size(); i++) {
+        clipped.emplace_back();
+        if (!clipRing(_polygon[i], clipped.back())) {
+            // Holes are within the exterior ring
+            if (i == 0) { return; }
+            clipped.pop_back();
+        }
+    }
+
+    _out.push_back(std::move(clipped));
+}
+
+void GeometryClipper::clip(Feature& _feature) {
+
+    bool clipLines = false;
+    for (auto& line : _feature.lines) {
+        if (bounds(line) != Bounds::inside) {
+            clipLines = true;
+            break;
+        }
+    }
+    if (clipLines) {
+        m_clippedLines.clear();
+        for (auto& line : _feature.lines) { clipLine(line, m_clippedLines); }
+        std::swap(_feature.lines, m_clippedLines);
+    }
+
+    bool clipPolygons = false;
+    for (auto& polygon : _feature.polygons) {
+        if (polygon.empty() || bounds(polygon[0]) != Bounds::inside) {
+            clipPolygons = true;
+            break;
+        }
+    }
+    if (clipPolygons) {
+        m_clippedPolygons.clear();
+        for (auto& polygon : _feature.polygons) { clipPolygon(polygon, m_clippedPolygons); }
+        std::swap(_feature.polygons, m_clippedPolygons);
+    }
+}
+
+void GeometryClipper::clip(ColumnarLayer& _layer) {
+
+    ArenaVector<Point> coordinates(_layer.coordinates.get_allocator());
+    ArenaVector<ColumnarLayer::Part> parts(_layer.parts.get_allocator());
+    coordinates.reserve(_layer.coordinates.size());
+    parts.reserve(_layer.parts.size());
+
+    auto addLine = [&](const Line& _line, bool _exterior) {
+        parts.push_back({ uint32_t(_line.size()), _exterior });
+        coordinates.insert(coordinates.end(), _line.begin(), _line.end());
+    };
+
+    auto addPolygon = [&]() {
+        if (m_polygon.empty()) { return; }
+
+        m_clippedPolygons.clear();
+        clipPolygon(m_polygon, m_clippedPolygons);
+        for (auto& polygon : m_clippedPolygons) {
+            for (size_t i = 0; i < polygon.size(); i++) { addLine(polygon[i], i == 0); }
+        }
+        m_polygon.clear();
+    };
+
+    for (auto& feature : _layer.features) {
+
+        uint32_t coordinatesBegin = coordinates.size();
+        uint32_t partsBegin = parts.size();
+
+        auto pos = _layer.coordinates.begin() + feature.coordinatesBegin;
+
+        switch (feature.geometryType) {
+        case GeometryType::lines:
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                uint32_t length = _layer.parts[i].length;
+                m_line.assign(pos, pos + length);
+                pos += length;
+
+                if (bounds(m_line) == Bounds::inside) {
+                    addLine(m_line, false);
+                    continue;
+                }
+                m_clippedLines.clear();
+                clipLine(m_line, m_clippedLines);
+                for (auto& line : m_clippedLines) { addLine(line, false); }
+            }
+            break;
+
+        case GeometryType::polygons:
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                if (_layer.parts[i].exterior) { addPolygon(); }
+
+                uint32_t length = _layer.parts[i].length;
+                m_polygon.emplace_back(pos, pos + length);
+                pos += length;
+            }
+            addPolygon();
+            break;
+
+        default:
+            coordinates.insert(coordinates.end(), pos,
+                               _layer.coordinates.begin() + feature.coordinatesEnd);
+            parts.insert(parts.end(), _layer.parts.begin() + feature.partsBegin,
+                         _layer.parts.begin() + feature.partsEnd);
+            break;
+        }
+
+        feature.coordinatesBegin = coordinatesBegin;
+        feature.coordinatesEnd = coordinates.size();
+        feature.partsBegin = partsBegin;
+        feature.partsEnd = parts.size();
+    }
+
+    _layer.coordinates = std::move(coordinates);
+    _layer.parts = std::move(parts);
+}
+
+void GeometryClipper::clip(TileData& _tileData) {
+
+    _tileData.readViews();
+
+    for (auto& layer : _tileData.layers) {
+        for (auto& feature : layer.features) { clip(feature); }
+    }
+    for (auto& layer : _tileData.columnarLayers) { clip(layer); }
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "data/tileData.h"
+
+#include <vector>
+
+namespace Tangram {
+
+/* Clips lines and polygons of a tile to the tile area grown by a buffer
+ *
+ * Sources that don't clip their data, like plain GeoJSON or some MVT
+ * producers, can contain geometry far beyond the tile which would otherwise be
+ * built and uploaded. Lines and rings are clipped against one edge of the
+ * rectangle at a time (Sutherland-Hodgman). For each edge the signed
+ * distances of all points are computed in a separate loop without branches,
+ * which the compiler can vectorize, before the points are emitted.
+ *
+ * Points are kept as they are. Clipped rings are closed by repeating their
+ * first point, as the polygon builders expect.
+ */
+class GeometryClipper {
+
+public:
+
+    // _buffer in tile units, i.e. 0.25 keeps a quarter tile around each side
+    explicit GeometryClipper(float _buffer);
+
+    void clip(TileData& _tileData);
+
+    void clip(Feature& _feature);
+
+    void clip(ColumnarLayer& _layer);
+
+    /* Append the parts of _line inside the clip rectangle to _out */
+    void clipLine(const Line& _line, std::vector<Line>& _out);
+
+    /* Clip _ring into _out, returns false when no area is left */
+    bool clipRing(const Line& _ring, Line& _out);
+
+private:
+
+    enum class Bounds { inside, outside, intersecting };
+
+    Bounds bounds(const Line& _line) const;
+
+    // Signed distances of _line inside the boundary of _edge
+    void distances(const Line& _line, int _edge);
+
+    void clipLine(const Line& _line, int _edge, std::vector<Line>& _out);
+
+    void clipRing(const Line& _ring, int _edge, Line& _out);
+
+    void clipPolygon(const Polygon& _polygon, std::vector<Polygon>& _out);
+
+    float m_min;
+    float m_max;
+
+    // Scratch buffers
+    std::vector<float> m_distances;
+    std::vector<Line> m_lines[2];
+    Line m_rings[2];
+    std::vector<Line> m_clippedLines;
+    std::vector<Polygon> m_clippedPolygons;
+    Line m_line;
+    Polygon m_polygon;
+};
+
+}
@@ -0,0 +1,144 @@
+#include "data/geometrySimplifier.h"
+
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+
+namespace Tangram {
+
+GeometrySimplifier::GeometrySimplifier(float _tolerance)
+    : m_tolerance2(_tolerance * _tolerance) {}
+
+// Squared distance of _p to the segment from _a to _b
+static float segmentDistance2(const Point& _p, const Point& _a, const Point& _b) {
+    glm::vec2 ab = _b - _a;
+    float length2 = glm::dot(ab, ab);
+
+    float t = 0.f;
+    if (length2 > 0.f) {
+        t = std::max(0.f, std::min(1.f, glm::dot(_p - _a, ab) / length2));
+    }
+    glm::vec2 d = _a + ab * t - _p;
+
+    return glm::dot(d, d);
+}
+
+size_t GeometrySimplifier::simplify(Point* _points, size_t _count, bool _ring) {
+
+    m_verticesIn += _count;
+
+    // A closed triangle can't be simplified further
+    size_t minCount = _ring ? 4 : 2;
+    if (_count <= minCount) {
+        m_verticesOut += _count;
+        return _count;
+    }
+
+    m_keep.assign(_count, 0);
+    m_keep[0] = m_keep[_count - 1] = 1;
+
+    m_stack.clear();
+    m_stack.emplace_back(0, _count - 1);
+
+    while (!m_stack.empty()) {
+        size_t first = m_stack.back().first;
+        size_t last = m_stack.back().second;
+        m_stack.pop_back();
+
+        float maxDistance2 = 0.f;
+        size_t index = 0;
+
+        for (size_t i = first + 1; i < last; i++) {
+            float distance2 = segmentDistance2(_points[i], _points[first], _points[last]);
+            if (distance2 > maxDistance2) {
+                maxDistance2 = distance2;
+                index = i;
+            }
+        }
+
+        if (maxDistance2 > m_tolerance2) {
+            m_keep[index] = 1;
+            if (index - first > 1) { m_stack.emplace_back(first, index); }
+            if (last - index > 1) { m_stack.emplace_back(index, last); }
+        }
+    }
+
+    size_t kept = std::count(m_keep.begin(), m_keep.end(), 1);
+
+    if (kept < minCount) {
+        m_verticesOut += _count;
+        return _count;
+    }
+
+    // Kept points only move to lower indices
+    size_t out = 0;
+    for (size_t i = 0; i < _count; i++) {
+        if (m_keep[i]) { _points[out++] = _points[i]; }
+    }
+
+    m_verticesOut += out;
+    return out;
+}
+
+void GeometrySimplifier::simplify(Feature& _feature) {
+
+    for (auto& line : _feature.lines) {
+        line.resize(simplify(line.data(), line.size(), false));
+    }
+    for (auto& polygon : _feature.polygons) {
+        for (auto& ring : polygon) {
+            ring.resize(simplify(ring.data(), ring.size(), true));
+        }
+    }
+}
+
+void GeometrySimplifier::simplify(ColumnarLayer& _layer) {
+
+    auto& coordinates = _layer.coordinates;
+    uint32_t write = 0;
+
+    for (auto& feature : _layer.features) {
+
+        uint32_t begin = write;
+        uint32_t read = feature.coordinatesBegin;
+
+        if (feature.geometryType == GeometryType::lines ||
+            feature.geometryType == GeometryType::polygons) {
+
+            bool ring = feature.geometryType == GeometryType::polygons;
+
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                uint32_t length = _layer.parts[i].length;
+                uint32_t kept = simplify(coordinates.data() + read, length, ring);
+
+                std::copy(coordinates.begin() + read, coordinates.begin() + read + kept,
+                          coordinates.begin() + write);
+
+                _layer.parts[i].length = kept;
+                read += length;
+                write += kept;
+            }
+        } else {
+            std::copy(coordinates.begin() + read, coordinates.begin() + feature.coordinatesEnd,
+                      coordinates.begin() + write);
+            write += feature.coordinatesEnd - read;
+        }
+
+        feature.coordinatesBegin = begin;
+        feature.coordinatesEnd = write;
+    }
+
+    coordinates.resize(write);
+}
+
+void GeometrySimplifier::simplify(TileData& _tileData) {
+
+    _tileData.readViews();
+
+    for (auto& layer : _tileData.layers) {
+        for (auto& feature : layer.features) { simplify(feature); }
+    }
+    for (auto& layer : _tileData.columnarLayers) { simplify(layer); }
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "data/tileData.h"
+
+#include <utility>
+#include <vector>
+
+namespace Tangram {
+
+/* Simplifies lines and polygon rings of a tile with Douglas-Peucker
+ *
+ * Removes points that deviate less than a tolerance, given in tile units,
+ * from the simplified line. Geometry is simplified in place: end points of
+ * lines are kept, and rings which would collapse to less than a triangle
+ * are left as they are. Points are not touched.
+ */
+class GeometrySimplifier {
+
+public:
+
+    explicit GeometrySimplifier(float _tolerance);
+
+    void simplify(TileData& _tileData);
+
+    void simplify(Feature& _feature);
+
+    void simplify(ColumnarLayer& _layer);
+
+    /* Simplify _count points in place, returns the number of points kept */
+    size_t simplify(Point* _points, size_t _count, bool _ring);
+
+    // Number of line and ring points before and after simplification
+    uint64_t verticesIn() const { return m_verticesIn; }
+    uint64_t verticesOut() const { return m_verticesOut; }
+
+private:
+
+    float m_tolerance2;
+
+    uint64_t m_verticesIn = 0;
+    uint64_t m_verticesOut = 0;
+
+    // Scratch buffers
+    std::vector<uint8_t> m_keep;
+    std::vector<std::pair<size_t, size_t>> m_stack;
+};
+
+}
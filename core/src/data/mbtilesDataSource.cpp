@@ -7,8 +7,13 @@
 #include "util/url.h"
 
 #include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Transaction.h>
 #include "hash-library/md5.cpp"
 
+#include <algorithm>
+#include <future>
+#include <unordered_map>
+
 
 namespace Tangram {
 
@@ -98,10 +103,22 @@ CREATE VIEW IF NOT EXISTS grid_data AS
     JOIN keymap ON grid_key.key_name = keymap.key_name;
 COMMIT;)SQL_ESC";
 
-struct MBTilesQueries {
-    // SELECT statement from tiles view
-    SQLite::Statement getTileData;
+// Tiles read by one query of a reader
+static constexpr size_t maxReadBatch = 32;
+
+// Downloaded tiles are not cached while the queued writes exceed this size
+static constexpr size_t maxPendingWriteBytes = 16 * 1024 * 1024;
 
+// A range query is used for a batch when its rectangle is at most this many
+// times larger than the number of tiles
+static constexpr int maxRangeOverhead = 4;
+
+// Tiles remembered as not in the file. Files only change by storing tiles
+// of the next source, which removes them, so they are kept for long.
+static constexpr size_t maxMissingTiles = 4096;
+static constexpr auto missingTileTtl = std::chrono::hours(1);
+
+struct MBTilesQueries {
     // REPLACE INTO statement in map table
     SQLite::Statement putMap;
 
@@ -109,19 +126,40 @@ struct MBTilesQueries {
     SQLite::Statement putImage;
 
     MBTilesQueries(SQLite::Database& _db, bool _cache)
-        : getTileData(_db, "SELECT tile_data FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;"),
-          putMap(_db, _cache ? "REPLACE INTO map (zoom_level, tile_column, tile_row, tile_id) VALUES (?, ?, ?, ?);" : ";" ),
+        : putMap(_db, _cache ? "REPLACE INTO map (zoom_level, tile_column, tile_row, tile_id) VALUES (?, ?, ?, ?);" : ";" ),
           putImage(_db, _cache ? "REPLACE INTO images (tile_id, tile_data) VALUES (?, ?);" : ";") {}
 
 };
 
+struct MBTilesReader {
+    SQLite::Database db;
+
+    // SELECT statement from tiles view
+    SQLite::Statement getTileData;
+
+    // SELECT statement for a rectangle of tiles
+    SQLite::Statement getTileRange;
+
+    // Declared last to stop the thread before closing the connection
+    AsyncWorker worker;
+
+    MBTilesReader(const std::string& _path, const char* _vfs)
+        : db(_path, SQLite::OPEN_READONLY, 0, _vfs),
+          getTileData(db, "SELECT tile_data FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;"),
+          getTileRange(db, "SELECT tile_column, tile_row, tile_data FROM tiles WHERE zoom_level = ?"
+                       " AND tile_column BETWEEN ? AND ? AND tile_row BETWEEN ? AND ?;") {}
+};
+
 MBTilesDataSource::MBTilesDataSource(std::shared_ptr<Platform> _platform, std::string _name,
-                                     std::string _path, std::string _mime, bool _cache, bool _offlineFallback)
+                                     std::string _path, std::string _mime, bool _cache, bool _offlineFallback,
+                                     ReadOptions _readOptions)
     : m_name(_name),
       m_path(_path),
       m_mime(_mime),
       m_cacheMode(_cache),
       m_offlineMode(_offlineFallback),
+      m_readOptions(_readOptions),
+      m_misses(maxMissingTiles, missingTileTtl),
       m_platform(_platform) {
 
     m_worker = std::make_unique<AsyncWorker>();
@@ -130,6 +168,12 @@ MBTilesDataSource::MBTilesDataSource(std::shared_ptr<Platform> _platform, std::s
 }
 
 MBTilesDataSource::~MBTilesDataSource() {
+    // Stop the threads before the members they use go away
+    m_readers.clear();
+    m_worker.reset();
+
+    // Store the tiles which are still queued
+    if (m_db && m_cacheMode) { writeTiles(); }
 }
 
 bool MBTilesDataSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
@@ -146,39 +190,120 @@ bool MBTilesDataSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb
     if (!m_db) { return false; }
 
     if (_task->rawSource == this->level) {
+        if (!m_misses.contains(_task->tileId())) {
+            readTile(_task, _cb, false);
+            return true;
+        }
+
+        // Not in the file, skip the query
+        if (!next) {
+            _cb.func(_task);
+            return true;
+        }
+        _task->rawSource = next->level;
+    }
+
+    return loadNextSource(_task, _cb);
+}
 
-        m_worker->enqueue([this, _task, _cb](){
-            TileID tileId = _task->tileId();
+void MBTilesDataSource::readTile(std::shared_ptr<TileTask> _task, TileTaskCb _cb, bool _fallback) {
+    std::lock_guard<std::mutex> lock(m_readMutex);
+    m_pendingReads.push_back({ _task, _cb, _fallback });
+    scheduleReads();
+}
 
-            auto& task = static_cast<BinaryTileTask&>(*_task);
-            task.rawTileData = std::make_shared<std::vector<char>>();
+void MBTilesDataSource::scheduleReads() {
+    // Each reader works on one batch at a time, further tiles wait and are
+    // taken together by the next batch.
+    if (m_pendingReads.empty() || m_activeReads >= m_readers.size()) { return; }
 
-            getTileData(tileId, *task.rawTileData);
+    m_activeReads++;
+    auto& reader = *m_readers[m_nextReader++ % m_readers.size()];
+    reader.worker.enqueue([this, &reader]() { readBatch(reader); });
+}
 
-            if (task.hasData()) {
-                LOGW("loaded tile: %s, %d", tileId.toString().c_str(), task.rawTileData->size());
+void MBTilesDataSource::readBatch(MBTilesReader& _reader) {
 
-                _cb.func(_task);
+    std::vector<TileRead> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_readMutex);
 
-            } else if (next) {
+        // Take the most important tiles first
+        std::sort(m_pendingReads.begin(), m_pendingReads.end(),
+                  [](const TileRead& a, const TileRead& b) {
+                      return a.task->getPriority() < b.task->getPriority();
+                  });
 
-                // Don't try this source again
-                _task->rawSource = next->level;
+        size_t count = std::min(m_pendingReads.size(), maxReadBatch);
+        batch.assign(std::make_move_iterator(m_pendingReads.begin()),
+                     std::make_move_iterator(m_pendingReads.begin() + count));
+        m_pendingReads.erase(m_pendingReads.begin(), m_pendingReads.begin() + count);
+    }
 
-                if (!loadNextSource(_task, _cb)) {
-                    // Trigger TileManager update so that tile will be
-                    // downloaded next time.
-                    _task->setNeedsLoading(true);
-                    m_platform->requestRender();
-                }
-            } else {
-                LOGW("missing tile: %s, %d", _task->tileId().toString().c_str());
-            }
+    // Group by zoom level for range queries
+    std::vector<TileRead*> reads;
+    for (auto& read : batch) {
+        if (read.task->isCanceled()) { continue; }
+
+        reads.push_back(&read);
+    }
+    std::sort(reads.begin(), reads.end(), [](const TileRead* a, const TileRead* b) {
+            return a->task->tileId().z < b->task->tileId().z;
         });
-        return true;
+
+    std::vector<TileRead*> zoomReads;
+    for (size_t i = 0; i < reads.size();) {
+        zoomReads.clear();
+        int z = reads[i]->task->tileId().z;
+        for (; i < reads.size() && reads[i]->task->tileId().z == z; i++) {
+            zoomReads.push_back(reads[i]);
+        }
+        getTileData(_reader, zoomReads);
     }
 
-    return loadNextSource(_task, _cb);
+    for (auto* read : reads) { finishRead(*read); }
+
+    {
+        std::lock_guard<std::mutex> lock(m_readMutex);
+        m_activeReads--;
+        scheduleReads();
+    }
+}
+
+void MBTilesDataSource::finishRead(TileRead& _read) {
+
+    auto& _task = _read.task;
+    auto& task = static_cast<BinaryTileTask&>(*_task);
+    TileID tileId = _task->tileId();
+
+    if (_read.fallback) {
+        LOGW("loaded tile: %s, %d", tileId.toString().c_str(), task.rawTileData.size());
+        _read.cb.func(_task);
+
+    } else if (task.hasData()) {
+        LOGW("loaded tile: %s, %d", tileId.toString().c_str(), task.rawTileData.size());
+
+        _read.cb.func(_task);
+
+    } else if (next) {
+        m_misses.add(tileId);
+
+        // Don't try this source again
+        _task->rawSource = next->level;
+
+        if (!loadNextSource(_task, _read.cb)) {
+            // Trigger TileManager update so that tile will be
+            // downloaded next time.
+            _task->setNeedsLoading(true);
+            m_platform->requestRender();
+        }
+    } else {
+        LOGW("missing tile: %s, %d", tileId.toString().c_str());
+        m_misses.add(tileId);
+
+        // Done without data, the tile is not loaded again
+        _read.cb.func(_task);
+    }
 }
 
 bool MBTilesDataSource::loadNextSource(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
@@ -194,14 +319,9 @@ bool MBTilesDataSource::loadNextSource(std::shared_ptr<TileTask> _task, TileTask
         if (_task->hasData()) {
 
             if (m_cacheMode) {
-                m_worker->enqueue([this, _task](){
-
-                        auto& task = static_cast<BinaryTileTask&>(*_task);
-
-                        LOGW("store tile: %s, %d", _task->tileId().toString().c_str(), task.hasData());
-
-                        storeTileData(_task->tileId(), *task.rawTileData);
-                    });
+                auto& task = static_cast<BinaryTileTask&>(*_task);
+                queueTileData(_task->tileId(), task.rawTileData);
+                m_misses.remove(_task->tileId());
             }
 
             _cb.func(_task);
@@ -209,18 +329,7 @@ bool MBTilesDataSource::loadNextSource(std::shared_ptr<TileTask> _task, TileTask
         } else if (m_offlineMode) {
             LOGW("try fallback tile: %s, %d", _task->tileId().toString().c_str());
 
-            m_worker->enqueue([this, _task, _cb](){
-
-                auto& task = static_cast<BinaryTileTask&>(*_task);
-                task.rawTileData = std::make_shared<std::vector<char>>();
-
-                getTileData(_task->tileId(), *task.rawTileData);
-
-                LOGW("loaded tile: %s, %d", _task->tileId().toString().c_str(), task.rawTileData->size());
-
-                _cb.func(_task);
-
-            });
+            readTile(_task, _cb, true);
         } else {
             LOGW("missing tile: %s, %d", _task->tileId().toString().c_str());
             _cb.func(_task);
@@ -232,6 +341,9 @@ bool MBTilesDataSource::loadNextSource(std::shared_ptr<TileTask> _task, TileTask
 
 void MBTilesDataSource::openMBTiles() {
 
+    std::string path;
+    const char* vfs = "";
+
     try {
         auto mode = SQLite::OPEN_READONLY;
         if (m_cacheMode) {
@@ -241,8 +353,7 @@ void MBTilesDataSource::openMBTiles() {
         }
 
         auto url = Url(m_path);
-        auto path = url.path();
-        const char* vfs = "";
+        path = url.path();
         if (url.scheme() == "asset") {
             vfs = "ndk-asset";
             path.erase(path.begin()); // Remove leading '/'.
@@ -288,12 +399,42 @@ void MBTilesDataSource::openMBTiles() {
     }
 
     try {
+        if (m_cacheMode) {
+            // Let readers continue while tiles are stored
+            m_db->exec("PRAGMA journal_mode=WAL;");
+        }
         m_queries = std::make_unique<MBTilesQueries>(*m_db, m_cacheMode);
     } catch (std::exception& e) {
         LOGE("Unable to initialize queries: %s", e.what());
         m_db.reset();
         return;
     }
+
+    if (!openReaders(path, vfs)) {
+        m_db.reset();
+        return;
+    }
+}
+
+bool MBTilesDataSource::openReaders(const std::string& _path, const char* _vfs) {
+
+    uint32_t count = std::max(1u, m_readOptions.connections);
+
+    try {
+        for (uint32_t i = 0; i < count; i++) {
+            auto reader = std::make_unique<MBTilesReader>(_path, _vfs);
+            if (m_readOptions.mmapSize > 0) {
+                // Serve blobs from mapped pages instead of reading them into the page cache
+                reader->db.exec("PRAGMA mmap_size=" + std::to_string(m_readOptions.mmapSize) + ";");
+            }
+            m_readers.push_back(std::move(reader));
+        }
+    } catch (std::exception& e) {
+        LOGE("Unable to open SQLite read connection: %s - %s", m_path.c_str(), e.what());
+        m_readers.clear();
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -422,69 +563,219 @@ void MBTilesDataSource::initSchema(SQLite::Database& db, std::string _name, std:
     }
 }
 
-bool MBTilesDataSource::getTileData(const TileID& _tileId, std::vector<char>& _data) {
+ByteBuffer MBTilesDataSource::decodeTileData(const char* _blob, int _length) {
 
-    auto& stmt = m_queries->getTileData;
-    try {
-        // Google TMS to WMTS
-        // https://github.com/mapbox/node-mbtiles/blob/
-        // 4bbfaf991969ce01c31b95184c4f6d5485f717c3/lib/mbtiles.js#L149
-        int z = _tileId.z;
-        int y = (1 << z) - 1 - _tileId.y;
+    // The blob is only valid until the statement steps, so uncompressed
+    // tiles are copied once into the buffer shared by all tasks of the tile.
+    std::vector<char> data;
 
-        stmt.bind(1, z);
-        stmt.bind(2, _tileId.x);
-        stmt.bind(3, y);
+    if ((m_schemaOptions.compression == Compression::undefined) ||
+        (m_schemaOptions.compression == Compression::deflate)) {
 
-        if (stmt.executeStep()) {
-            SQLite::Column column = stmt.getColumn(0);
-            const char* blob = (const char*) column.getBlob();
-            const int length = column.getBytes();
-
-            if ((m_schemaOptions.compression == Compression::undefined) ||
-                (m_schemaOptions.compression == Compression::deflate)) {
-
-                if (zlib::inflate(blob, length, _data) != 0) {
-                    if (m_schemaOptions.compression == Compression::undefined) {
-                        _data.resize(length);
-                        memcpy(_data.data(), blob, length);
-                    } else {
-                        LOGW("Invalid deflate compression");
-                    }
-                }
+        if (zlib::inflate(_blob, _length, data) != 0) {
+            if (m_schemaOptions.compression == Compression::undefined) {
+                data.assign(_blob, _blob + _length);
             } else {
-                _data.resize(length);
-                memcpy(_data.data(), blob, length);
+                LOGW("Invalid deflate compression");
+                return {};
             }
+        }
+    } else {
+        data.assign(_blob, _blob + _length);
+    }
+    return ByteBuffer(std::move(data));
+}
 
-            stmt.reset();
-            return true;
+void MBTilesDataSource::getTileData(MBTilesReader& _reader, std::vector<TileRead*>& _reads) {
+
+    if (_reads.empty()) { return; }
+
+    // Google TMS to WMTS
+    // https://github.com/mapbox/node-mbtiles/blob/
+    // 4bbfaf991969ce01c31b95184c4f6d5485f717c3/lib/mbtiles.js#L149
+    int z = _reads[0]->task->tileId().z;
+    auto tmsRow = [z](const TileID& _id) { return (1 << z) - 1 - _id.y; };
+
+    auto data = [](TileRead* _read) -> ByteBuffer& {
+        return static_cast<BinaryTileTask&>(*_read->task).rawTileData;
+    };
+
+    int minX = _reads[0]->task->tileId().x, maxX = minX;
+    int minY = tmsRow(_reads[0]->task->tileId()), maxY = minY;
+    for (auto* read : _reads) {
+        auto id = read->task->tileId();
+        minX = std::min(minX, id.x);
+        maxX = std::max(maxX, id.x);
+        minY = std::min(minY, tmsRow(id));
+        maxY = std::max(maxY, tmsRow(id));
+    }
+
+    int64_t area = int64_t(maxX - minX + 1) * (maxY - minY + 1);
+    bool range = _reads.size() > 1 && area <= int64_t(_reads.size()) * maxRangeOverhead;
+
+    if (range) {
+        std::unordered_map<uint64_t, std::vector<TileRead*>> byTile;
+        for (auto* read : _reads) {
+            auto id = read->task->tileId();
+            byTile[(uint64_t(id.x) << 32) | uint32_t(tmsRow(id))].push_back(read);
         }
 
-    } catch (std::exception& e) {
-        LOGE("MBTiles SQLite get tile_data statement failed: %s", e.what());
+        auto& stmt = _reader.getTileRange;
+        try {
+            stmt.bind(1, z);
+            stmt.bind(2, minX);
+            stmt.bind(3, maxX);
+            stmt.bind(4, minY);
+            stmt.bind(5, maxY);
+
+            while (stmt.executeStep()) {
+                int x = stmt.getColumn(0);
+                int y = stmt.getColumn(1);
+                auto it = byTile.find((uint64_t(x) << 32) | uint32_t(y));
+                if (it == byTile.end()) { continue; }
+
+                SQLite::Column column = stmt.getColumn(2);
+                const char* blob = (const char*) column.getBlob();
+                const int length = column.getBytes();
+
+                auto tileData = decodeTileData(blob, length);
+                for (auto* read : it->second) { data(read) = tileData; }
+            }
+        } catch (std::exception& e) {
+            LOGE("MBTiles SQLite get tile range statement failed: %s", e.what());
+        }
+        try {
+            stmt.reset();
+        } catch(...) {}
+
+        return;
     }
-    try {
-        stmt.reset();
-    } catch(...) {}
 
-    return false;
+    auto& stmt = _reader.getTileData;
+    for (auto* read : _reads) {
+        auto id = read->task->tileId();
+        try {
+            stmt.bind(1, z);
+            stmt.bind(2, id.x);
+            stmt.bind(3, tmsRow(id));
+
+            if (stmt.executeStep()) {
+                SQLite::Column column = stmt.getColumn(0);
+                data(read) = decodeTileData((const char*) column.getBlob(), column.getBytes());
+            }
+        } catch (std::exception& e) {
+            LOGE("MBTiles SQLite get tile_data statement failed: %s", e.what());
+        }
+        try {
+            stmt.reset();
+        } catch(...) {}
+    }
 }
 
-void MBTilesDataSource::storeTileData(const TileID& _tileId, const std::vector<char>& _data) {
-    int z = _tileId.z;
-    int y = (1 << z) - 1 - _tileId.y;
-
-    const char* data = _data.data();
-    size_t size = _data.size();
+bool MBTilesDataSource::queueTileData(const TileID& _tileId, ByteBuffer _data) {
 
     /**
      * We create an MD5 of the raw tile data. The MD5 functions as a hash
      * between the map and images tables. With this, tiles with duplicate
      * data will join to a single entry in the images table.
+     *
+     * It is computed here on the thread delivering the tile, which keeps
+     * the MBTiles writer free for the inserts.
      */
     MD5 md5;
-    std::string md5id = md5(data, size);
+    std::string md5id = md5(_data.data(), _data.size());
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+
+    if (m_pendingWriteBytes + _data.size() > maxPendingWriteBytes) {
+        // The writer can't keep up, the tile will be downloaded again if needed
+        LOGW("Skip storing tile %s: %d bytes queued", _tileId.toString().c_str(), m_pendingWriteBytes);
+        return false;
+    }
+
+    m_pendingWriteBytes += _data.size();
+    m_pendingWrites.push_back({ _tileId, std::move(_data), std::move(md5id) });
+
+    if (!m_writeScheduled) {
+        // Tiles arriving until the writer runs join the same transaction
+        m_writeScheduled = true;
+        m_worker->enqueue([this]() { writeTiles(); });
+    }
+    return true;
+}
+
+std::vector<TileID> MBTilesDataSource::storedTiles(int _z, int _minX, int _maxX, int _minY, int _maxY) {
+
+    std::vector<TileID> tiles;
+    if (m_readers.empty()) { return tiles; }
+
+    // XYZ to TMS rows
+    int minRow = (1 << _z) - 1 - _maxY;
+    int maxRow = (1 << _z) - 1 - _minY;
+
+    std::promise<void> done;
+    m_readers[0]->worker.enqueue([&]() {
+        try {
+            SQLite::Statement stmt(m_readers[0]->db, "SELECT tile_column, tile_row FROM tiles WHERE zoom_level = ?"
+                                   " AND tile_column BETWEEN ? AND ? AND tile_row BETWEEN ? AND ?;");
+            stmt.bind(1, _z);
+            stmt.bind(2, _minX);
+            stmt.bind(3, _maxX);
+            stmt.bind(4, minRow);
+            stmt.bind(5, maxRow);
+
+            while (stmt.executeStep()) {
+                int x = stmt.getColumn(0);
+                int row = stmt.getColumn(1);
+                tiles.emplace_back(x, (1 << _z) - 1 - row, _z);
+            }
+        } catch (std::exception& e) {
+            LOGE("MBTiles SQLite stored tiles query failed: %s", e.what());
+        }
+        done.set_value();
+    });
+    done.get_future().wait();
+
+    return tiles;
+}
+
+void MBTilesDataSource::writeTiles() {
+
+    std::vector<TileWrite> writes;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        std::swap(writes, m_pendingWrites);
+        m_writeScheduled = false;
+    }
+    if (writes.empty()) { return; }
+
+    try {
+        SQLite::Transaction transaction(*m_db);
+
+        for (auto& write : writes) {
+            LOGW("store tile: %s, %d", write.tileId.toString().c_str(), write.data.size());
+            storeTileData(write);
+        }
+
+        transaction.commit();
+
+    } catch (std::exception& e) {
+        LOGE("MBTiles SQLite write transaction failed: %s", e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    for (auto& write : writes) { m_pendingWriteBytes -= write.data.size(); }
+}
+
+void MBTilesDataSource::storeTileData(const TileWrite& _write) {
+    auto& _tileId = _write.tileId;
+    int z = _tileId.z;
+    int y = (1 << z) - 1 - _tileId.y;
+
+    const char* data = _write.data.data();
+    size_t size = _write.data.size();
+
+    const std::string& md5id = _write.md5;
 
     try {
         auto& stmt = m_queries->putMap;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "data/tileMissCache.h"
 #include "data/tileSource.h"
 
+#include <mutex>
+#include <vector>
+
 namespace SQLite {
 class Database;
 }
@@ -12,13 +16,23 @@ namespace Tangram {
 class Platform;
 
 struct MBTilesQueries;
+struct MBTilesReader;
 class AsyncWorker;
 
+struct MBTilesReadOptions {
+    // Read-only connections, each with its own thread
+    uint32_t connections = 2;
+    // PRAGMA mmap_size in bytes, 0 keeps the SQLite default
+    int64_t mmapSize = 0;
+};
+
 class MBTilesDataSource : public TileSource::DataSource {
 public:
 
+    using ReadOptions = MBTilesReadOptions;
+
     MBTilesDataSource(std::shared_ptr<Platform> _platform, std::string _name, std::string _path, std::string _mime,
-                      bool _cache = false, bool _offlineFallback = false);
+                      bool _cache = false, bool _offlineFallback = false, ReadOptions _readOptions = {});
 
     ~MBTilesDataSource();
 
@@ -26,12 +40,50 @@ public:
 
     void clear() override {}
 
+    // Whether tiles can be stored, i.e. the file was opened in cache mode
+    bool isWritable() const { return bool(m_db) && m_cacheMode; }
+
+    // Queue a tile to be stored by the next write transaction. Returns false
+    // while too much data is queued, the tile is not stored then.
+    bool queueTileData(const TileID& _tileId, ByteBuffer _data);
+
+    // TileIDs of the stored tiles at zoom _z within the column and
+    // (XYZ) row ranges. Blocks until a reader has run the query.
+    std::vector<TileID> storedTiles(int _z, int _minX, int _maxX, int _minY, int _maxY);
+
 private:
-    bool getTileData(const TileID& _tileId, std::vector<char>& _data);
-    void storeTileData(const TileID& _tileId, const std::vector<char>& _data);
+    struct TileRead {
+        std::shared_ptr<TileTask> task;
+        TileTaskCb cb;
+        // Read after the next source failed, the callback runs in any case
+        bool fallback;
+    };
+
+    // Queue a tile to be read in the next batch
+    void readTile(std::shared_ptr<TileTask> _task, TileTaskCb _cb, bool _fallback);
+    // Start a batch on a free reader, m_readMutex must be held
+    void scheduleReads();
+    void readBatch(MBTilesReader& _reader);
+    void finishRead(TileRead& _read);
+
+    // Read the tiles of _reads which have the same zoom level into their tasks
+    void getTileData(MBTilesReader& _reader, std::vector<TileRead*>& _reads);
+    // Returns an empty buffer for invalid data
+    ByteBuffer decodeTileData(const char* _blob, int _length);
+
+    struct TileWrite {
+        TileID tileId;
+        ByteBuffer data;
+        std::string md5;
+    };
+
+    // Store all queued tiles in one transaction
+    void writeTiles();
+    void storeTileData(const TileWrite& _write);
     bool loadNextSource(std::shared_ptr<TileTask> _task, TileTaskCb _cb);
 
     void openMBTiles();
+    bool openReaders(const std::string& _path, const char* _vfs);
     bool testSchema(SQLite::Database& db);
     void initSchema(SQLite::Database& db, std::string _name, std::string _mimeType);
 
@@ -52,6 +104,23 @@ private:
     std::unique_ptr<MBTilesQueries> m_queries;
     std::unique_ptr<AsyncWorker> m_worker;
 
+    ReadOptions m_readOptions;
+
+    // Read-only connections, each used only by its own worker
+    std::vector<std::unique_ptr<MBTilesReader>> m_readers;
+    std::vector<TileRead> m_pendingReads;
+    size_t m_activeReads = 0;
+    size_t m_nextReader = 0;
+    std::mutex m_readMutex;
+
+    // Tiles not in the file, they are not queried again
+    TileMissCache m_misses;
+
+    std::vector<TileWrite> m_pendingWrites;
+    size_t m_pendingWriteBytes = 0;
+    bool m_writeScheduled = false;
+    std::mutex m_writeMutex;
+
     // Platform reference
     std::shared_ptr<Platform> m_platform;
 
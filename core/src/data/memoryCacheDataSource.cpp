@@ -1,24 +1,45 @@
 #include "data/memoryCacheDataSource.h"
 
+#include "data/tileData.h"
 #include "tile/tileHash.h"
 #include "tile/tileID.h"
+#include "util/asyncWorker.h"
+#include "util/memoryReport.h"
+#include "util/zlibHelper.h"
 #include "log.h"
 
+#include <algorithm>
 #include <list>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 
 namespace Tangram {
 
+// Fast zlib level, cached tiles are compressed for every download
+static constexpr int compressionLevel = 1;
+// Entries are kept uncompressed unless compression saves at least a quarter
+static constexpr double maxCompressionRatio = 0.75;
+
 struct RawCache {
 
     // Used to ensure safe access from async loading threads
     std::mutex m_mutex;
 
     // LRU in-memory cache for raw tile data
-    using CacheEntry = std::pair<TileID, std::shared_ptr<std::vector<char>>>;
+    struct CacheEntry {
+        TileID id;
+        ByteBuffer data;
+        bool compressed;
+        // Parsed data of a tile source, shared by the tasks loading this entry
+        std::shared_ptr<const TileData> parsed;
+        size_t parsedSize = 0;
+        int32_t parsedSource = -1;
+
+        size_t size() const { return data.size() + parsedSize; }
+    };
     using CacheList = std::list<CacheEntry>;
-    using CacheMap = std::unordered_map<TileID, typename CacheList::iterator>;
+    using CacheMap = TileIDMap<typename CacheList::iterator>;
 
     CacheMap m_cacheMap;
     CacheList m_cacheList;
@@ -37,25 +58,40 @@ struct RawCache {
         if (it != m_cacheMap.end()) {
             // Move cached entry to start of list
             m_cacheList.splice(m_cacheList.begin(), m_cacheList, it->second);
-            _task.rawTileData = m_cacheList.front().second;
+            auto& entry = m_cacheList.front();
+            _task.rawTileData = entry.data;
+            _task.rawTileDataCompressed = entry.compressed;
+            if (entry.parsed && entry.parsedSource == _task.source().id()) {
+                _task.parsedTileData = entry.parsed;
+            }
 
             return true;
         }
 
         return false;
     }
-    void put(const TileID& tileID, std::shared_ptr<std::vector<char>> rawDataRef) {
+    void put(const TileID& tileID, ByteBuffer rawDataRef) {
 
         if (m_maxUsage <= 0) { return; }
 
         std::lock_guard<std::mutex> lock(m_mutex);
         TileID id(tileID.x, tileID.y, tileID.z);
 
-        m_cacheList.push_front({id, rawDataRef});
+        auto it = m_cacheMap.find(id);
+        if (it != m_cacheMap.end()) {
+            m_usage -= it->second->size();
+            m_cacheList.erase(it->second);
+        }
+
+        m_usage += rawDataRef.size();
+
+        m_cacheList.push_front({id, std::move(rawDataRef), false});
         m_cacheMap[id] = m_cacheList.begin();
 
-        m_usage += rawDataRef->size();
+        evict();
+    }
 
+    void evict() {
         while (m_usage > m_maxUsage) {
             if (m_cacheList.empty()) {
                 LOGE("Error: invalid cache state!");
@@ -67,13 +103,77 @@ struct RawCache {
             //        double(m_cacheUsage) / (1024*1024));
 
             auto& entry = m_cacheList.back();
-            m_usage -= entry.second->size();
+            m_usage -= entry.size();
 
-            m_cacheMap.erase(entry.first);
+            m_cacheMap.erase(entry.id);
             m_cacheList.pop_back();
         }
     }
 
+    // Attach parsed data to the entry for tileID, unless the entry was evicted
+    // or its data was replaced by a newer response in the meantime. The parsed
+    // data counts towards the cache size.
+    void parsed(const TileID& tileID, const char* _rawData, int32_t _source,
+                std::shared_ptr<const TileData> _tileData) {
+
+        if (m_maxUsage <= 0) { return; }
+
+        size_t size = _tileData->memoryUsage();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_cacheMap.find(tileID);
+        if (it == m_cacheMap.end()) { return; }
+
+        auto& entry = *it->second;
+        if (!entry.compressed && entry.data.data() != _rawData) { return; }
+
+        m_usage -= entry.parsedSize;
+        m_usage += size;
+        entry.parsed = std::move(_tileData);
+        entry.parsedSize = size;
+        entry.parsedSource = _source;
+
+        evict();
+    }
+
+    // Replace the entry for tileID by its compressed data, unless the entry
+    // was evicted or updated in the meantime
+    void compressed(const TileID& tileID, const char* _rawData, ByteBuffer _compressed) {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_cacheMap.find(tileID);
+        if (it == m_cacheMap.end()) { return; }
+
+        auto& entry = *it->second;
+        if (entry.compressed || entry.data.data() != _rawData) { return; }
+
+        m_usage -= entry.data.size() - _compressed.size();
+        entry.data = std::move(_compressed);
+        entry.compressed = true;
+    }
+
+    // Evict least recently used entries until _bytes are freed
+    size_t release(size_t _bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t freed = 0;
+        while (freed < _bytes && !m_cacheList.empty()) {
+            auto& entry = m_cacheList.back();
+            freed += entry.size();
+            m_usage -= entry.size();
+
+            m_cacheMap.erase(entry.id);
+            m_cacheList.pop_back();
+        }
+        return freed;
+    }
+
+    size_t memoryUsage() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_usage + m_cacheList.size() * (sizeof(CacheEntry) + sizeof(typename CacheMap::value_type));
+    }
+
     void clear() {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_cacheMap.clear();
@@ -83,22 +183,78 @@ struct RawCache {
 };
 
 
+// Caches shared by MemoryCacheDataSources, see shareCache()
+static std::mutex s_sharedCacheMutex;
+static std::unordered_map<std::string, std::weak_ptr<RawCache>> s_sharedCaches;
+
 MemoryCacheDataSource::MemoryCacheDataSource() :
-    m_cache(std::make_unique<RawCache>()) {
+    m_cache(std::make_shared<RawCache>()) {
 }
 
 MemoryCacheDataSource::~MemoryCacheDataSource() {}
 
 void MemoryCacheDataSource::setCacheSize(size_t _cacheSize) {
+    std::lock_guard<std::mutex> lock(m_cache->m_mutex);
     m_cache->m_maxUsage = _cacheSize;
 }
 
+void MemoryCacheDataSource::shareCache(const std::string& _key) {
+    std::lock_guard<std::mutex> lock(s_sharedCacheMutex);
+
+    for (auto it = s_sharedCaches.begin(); it != s_sharedCaches.end();) {
+        if (it->second.expired()) { it = s_sharedCaches.erase(it); } else { ++it; }
+    }
+
+    auto& shared = s_sharedCaches[_key];
+    auto cache = shared.lock();
+    if (!cache) {
+        shared = m_cache;
+        return;
+    }
+    if (cache == m_cache) { return; }
+
+    // The shared cache gets the larger size of both
+    {
+        std::lock_guard<std::mutex> cacheLock(cache->m_mutex);
+        cache->m_maxUsage = std::max(cache->m_maxUsage, m_cache->m_maxUsage);
+    }
+    m_cache = cache;
+}
+
 bool MemoryCacheDataSource::cacheGet(BinaryTileTask& _task) {
     return m_cache->get(_task);
 }
 
-void MemoryCacheDataSource::cachePut(const TileID& _tileID, std::shared_ptr<std::vector<char>> _rawDataRef) {
+void MemoryCacheDataSource::setCompression(bool _compress) {
+    if (_compress && !m_compressor) {
+        m_compressor = std::make_unique<AsyncWorker>();
+    } else if (!_compress) {
+        m_compressor.reset();
+    }
+}
+
+void MemoryCacheDataSource::cachePut(const TileID& _tileID, ByteBuffer _rawDataRef) {
     m_cache->put(_tileID, _rawDataRef);
+
+    if (!m_compressor) { return; }
+
+    // The entry is usable right away and replaced once compressed, this keeps
+    // compression off the thread delivering the tile.
+    TileID id(_tileID.x, _tileID.y, _tileID.z);
+    m_compressor->enqueue([this, id, data = std::move(_rawDataRef)]() {
+            std::vector<char> compressed;
+            if (zlib::deflate(data.data(), data.size(), compressed, compressionLevel) != 0 ||
+                compressed.size() > data.size() * maxCompressionRatio) {
+                return;
+            }
+            m_cache->compressed(id, data.data(), ByteBuffer(std::move(compressed)));
+        });
+}
+
+void MemoryCacheDataSource::cacheTileData(const BinaryTileTask& _task, std::shared_ptr<const TileData> _tileData) {
+    const auto& tileID = _task.tileId();
+    TileID id(tileID.x, tileID.y, tileID.z);
+    m_cache->parsed(id, _task.rawTileData.data(), _task.source().id(), std::move(_tileData));
 }
 
 bool MemoryCacheDataSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
@@ -139,4 +295,19 @@ void MemoryCacheDataSource::clear() {
     if (next) { next->clear(); }
 }
 
+void MemoryCacheDataSource::reportMemory(MemoryReport& _report) const {
+    // A shared cache is counted by the first source using it
+    if (_report.count(m_cache.get())) {
+        _report.stats.rawCache.cpuBytes += m_cache->memoryUsage();
+    }
+
+    if (next) { next->reportMemory(_report); }
+}
+
+size_t MemoryCacheDataSource::releaseMemory(size_t _bytes) {
+    size_t freed = m_cache->release(_bytes);
+    if (next && freed < _bytes) { freed += next->releaseMemory(_bytes - freed); }
+    return freed;
+}
+
 }
@@ -4,6 +4,8 @@
 
 namespace Tangram {
 
+class AsyncWorker;
+
 class MemoryCacheDataSource : public TileSource::DataSource {
 public:
 
@@ -14,17 +16,37 @@ public:
 
     void clear() override;
 
+    void reportMemory(MemoryReport& _report) const override;
+
+    size_t releaseMemory(size_t _bytes) override;
+
+    void cacheTileData(const BinaryTileTask& _task, std::shared_ptr<const TileData> _tileData) override;
+
     /* @_cacheSize: Set size of in-memory cache for tile data in bytes.
      * This cache holds unprocessed tile data for fast recreation of recently used tiles.
      */
     void setCacheSize(size_t _cacheSize);
 
+    /* Keep cached tile data gzip compressed. Tiles are compressed on a worker
+     * thread after they are cached, and inflated by the TileWorker on a hit.
+     */
+    void setCompression(bool _compress);
+
+    /* Use one cache with all other MemoryCacheDataSources sharing _key, e.g.
+     * sources which load tiles from the same URL template. Call before
+     * loading tiles.
+     */
+    void shareCache(const std::string& _key);
+
 private:
     bool cacheGet(BinaryTileTask& _task);
 
-    void cachePut(const TileID& _tileID, std::shared_ptr<std::vector<char>> _rawDataRef);
+    void cachePut(const TileID& _tileID, ByteBuffer _rawDataRef);
+
+    std::shared_ptr<RawCache> m_cache;
 
-    std::unique_ptr<RawCache> m_cache;
+    // Compresses new entries when set, stopped before m_cache is destroyed
+    std::unique_ptr<AsyncWorker> m_compressor;
 
 };
 
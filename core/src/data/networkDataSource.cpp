@@ -3,14 +3,183 @@
 #include "log.h"
 #include "platform.h"
 
+#include <algorithm>
+#include <map>
+
 namespace Tangram {
 
+// Requests sent to the platform at once
+static constexpr size_t maxActiveRequests = 16;
+// Tasks waiting for a request, the least important ones beyond are dropped
+static constexpr size_t maxQueuedRequests = 64;
+// An active request is cancelled for a queued one with this many times lower priority
+// value, i.e. a tile four times closer to the view center
+static constexpr double preemptFactor = 16.0;
+// Tiles remembered as missing, and for how long when the response has no max-age
+static constexpr size_t maxMissingTiles = 4096;
+static constexpr auto missingTileTtl = std::chrono::minutes(10);
+// Backoff of a host that failed to respond
+static constexpr auto minBackoff = std::chrono::seconds(1);
+static constexpr auto maxBackoff = std::chrono::minutes(5);
+// Weight of a new response time in the average of its subdomain
+static constexpr float latencyWeight = 0.2f;
+// Requests are copied once they take longer than this share of the recent
+// responses of their subdomain, given that many responses to tell
+static constexpr float hedgePercentile = 0.9f;
+static constexpr size_t minHedgeSamples = 8;
+static constexpr auto minHedgeDelay = std::chrono::milliseconds(50);
+
+// Whether the server answered that it has no tile, as opposed to failing
+// to provide one. Files of file:// templates that don't exist are missing.
+static bool isMissingTile(const UrlResponse& _response, const ByteBuffer& _content, bool _file) {
+    if (_file) { return _response.error != nullptr || _content.empty(); }
+
+    int status = _response.status;
+    if (status == 408 || status == 429) { return false; }
+    if (status >= 400 && status < 500) { return true; }
+
+    // 'No Content', or an empty tile
+    return !_response.error && (status == 204 || (status == 200 && _content.empty()));
+}
+
+// Tile requests in flight for all NetworkDataSources. Sources with the same
+// URL template, like several scene sources for one endpoint, share a single
+// platform request per tile and its response is handed to all of them.
+class SharedUrlRequests {
+
+public:
+
+    using Callback = std::function<void(const UrlResponse&, ByteBuffer)>;
+
+    // Returns a handle to cancel the request of this caller. Conditional
+    // requests are never shared. _priority is passed on to the platform for the
+    // first caller only.
+    uint64_t start(Platform& _platform, const std::string& _key, const Url& _url,
+                   const UrlValidators& _validators, double _priority, Callback _callback) {
+
+        Key key{ &_platform, _key };
+        uint64_t handle;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            handle = ++m_count;
+            if (!_validators.empty()) { key.second += "#" + std::to_string(handle); }
+
+            auto& request = m_requests[key];
+            request.waiters.emplace_back(handle, std::move(_callback));
+            m_waiters[handle] = key;
+
+            // Already in flight
+            if (request.waiters.size() > 1) { return handle; }
+            request.serial = handle;
+        }
+
+        UrlCallback onFinish = [this, key, handle](UrlResponse _response) {
+            finish(key, handle, std::move(_response));
+        };
+        auto platformHandle = _platform.startPrioritizedUrlRequest(_url, _validators, _priority,
+                                                                   std::move(onFinish));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_requests.find(key);
+        if (it != m_requests.end() && it->second.serial == handle) {
+            it->second.platformHandle = platformHandle;
+        }
+        return handle;
+    }
+
+    // The callback of a cancelled caller is not run. The platform request is
+    // cancelled once no caller waits for it.
+    void cancel(Platform& _platform, uint64_t _handle) {
+        UrlRequestHandle platformHandle = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto waiter = m_waiters.find(_handle);
+            if (waiter == m_waiters.end()) { return; }
+
+            auto it = m_requests.find(waiter->second);
+            m_waiters.erase(waiter);
+            if (it == m_requests.end()) { return; }
+
+            auto& waiters = it->second.waiters;
+            waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                         [&](auto& w) { return w.first == _handle; }),
+                          waiters.end());
+            if (!waiters.empty()) { return; }
+
+            // Not yet started requests have no handle, their response is dropped
+            platformHandle = it->second.platformHandle;
+            m_requests.erase(it);
+        }
+        if (platformHandle) { _platform.cancelUrlRequest(platformHandle); }
+    }
+
+private:
+
+    using Key = std::pair<Platform*, std::string>;
+
+    struct Request {
+        std::vector<std::pair<uint64_t, Callback>> waiters;
+        UrlRequestHandle platformHandle = 0;
+        // Handle of the first caller, tells the response apart from those of
+        // earlier requests for the same key
+        uint64_t serial = 0;
+    };
+
+    void finish(const Key& _key, uint64_t _serial, UrlResponse _response) {
+        std::vector<std::pair<uint64_t, Callback>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_requests.find(_key);
+            if (it == m_requests.end() || it->second.serial != _serial) { return; }
+
+            waiters = std::move(it->second.waiters);
+            m_requests.erase(it);
+            for (auto& waiter : waiters) { m_waiters.erase(waiter.first); }
+        }
+
+        // All callers share the content
+        ByteBuffer content(std::move(_response.content));
+        for (auto& waiter : waiters) { waiter.second(_response, content); }
+    }
+
+    std::mutex m_mutex;
+    std::map<Key, Request> m_requests;
+    std::unordered_map<uint64_t, Key> m_waiters;
+    uint64_t m_count = 0;
+};
+
+static SharedUrlRequests s_sharedRequests;
+
 NetworkDataSource::NetworkDataSource(std::shared_ptr<Platform> _platform, const std::string& _urlTemplate,
         std::vector<std::string>&& _urlSubdomains, bool isTms) :
     m_platform(_platform),
     m_urlTemplate(_urlTemplate),
     m_urlSubdomains(std::move(_urlSubdomains)),
-    m_isTms(isTms) {}
+    m_isTms(isTms),
+    m_mapFiles(Url(_urlTemplate).hasFileScheme()),
+    m_misses(maxMissingTiles, missingTileTtl),
+    m_backoff(minBackoff, maxBackoff) {
+
+    m_subdomains.resize(std::max(m_urlSubdomains.size(), size_t(1)));
+    for (size_t i = 0; i < m_subdomains.size(); i++) {
+        m_subdomains[i].host = Url(buildUrlForTile(TileID(0, 0, 0), i)).netLocation();
+    }
+}
+
+NetworkDataSource::~NetworkDataSource() {
+    std::vector<uint64_t> requests;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (auto& it : m_pending) {
+            if (it.second.request) { requests.push_back(it.second.request); }
+            if (it.second.hedgeRequest) { requests.push_back(it.second.hedgeRequest); }
+        }
+        m_pending.clear();
+    }
+    for (auto request : requests) {
+        s_sharedRequests.cancel(*m_platform, request);
+    }
+}
 
 std::string NetworkDataSource::buildUrlForTile(const TileID& tile, size_t subdomainIndex) const {
 
@@ -52,61 +221,437 @@ bool NetworkDataSource::loadTileData(std::shared_ptr<TileTask> task, TileTaskCb
 
     auto tileId = task->tileId();
 
-    Url url(buildUrlForTile(tileId, m_urlSubdomainIndex));
+    if (m_misses.contains(tileId)) {
+        // Done without data, as for the response that told the tile is missing
+        callback.func(task);
+        return true;
+    }
+
+    // The TileManager tries again after the backoff of the hosts
+    if (std::all_of(m_subdomains.begin(), m_subdomains.end(),
+                    [&](auto& s) { return m_backoff.isBackingOff(s.host); })) {
+        return false;
+    }
+
+    if (m_mapFiles) {
+        // Parse local tiles from the mapped file, without reading them into a response
+        auto& fileTask = static_cast<BinaryTileTask&>(*task);
+        fileTask.rawTileData = ByteBuffer::mapFile(Url(buildUrlForTile(tileId, 0)).path());
+        if (fileTask.hasData()) {
+            callback.func(task);
+            return true;
+        }
+        // Let the platform report the error
+    }
+
+    Dispatch requests;
+    bool queued = true;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (m_pending.find(tileId) != m_pending.end()) {
+            // Already queued or loading
+            return true;
+        }
+
+        m_pending.emplace(tileId, TileRequest{ task, callback, 0, ++m_serial, false });
+
+        size_t waiting = m_pending.size() - m_activeRequests;
+        if (waiting > maxQueuedRequests) {
+            // Drop the waiting task which is least important now
+            auto worst = m_pending.end();
+            for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+                if (it->second.active) { continue; }
+                if (worst == m_pending.end() ||
+                    it->second.task->getPriority() > worst->second.task->getPriority()) {
+                    worst = it;
+                }
+            }
+            if (worst->first == tileId) {
+                queued = false;
+            } else {
+                requeue(worst->second);
+            }
+            m_pending.erase(worst);
+        }
+
+        dispatch(requests);
+    }
+
+    apply(requests);
+
+    return queued;
+}
+
+void NetworkDataSource::dispatch(Dispatch& dispatch) {
+
+    while (m_activeRequests < m_pending.size()) {
+
+        if (m_activeRequests + m_hedges >= maxActiveRequests && m_hedges > 0) {
+            // Copies only take slots which no queued task needs
+            for (auto& it : m_pending) {
+                if (it.second.hedgeSerial) {
+                    dropHedge(it.second, dispatch);
+                    break;
+                }
+            }
+        }
+
+        // Lower values are more important
+        TileRequest* best = nullptr;
+        TileRequest* worstActive = nullptr;
+        for (auto& it : m_pending) {
+            auto& entry = it.second;
+            if (entry.active) {
+                if (!worstActive || entry.task->getPriority() > worstActive->task->getPriority()) {
+                    worstActive = &entry;
+                }
+            } else if (!best || entry.task->getPriority() < best->task->getPriority()) {
+                best = &entry;
+            }
+        }
+        if (!best) { break; }
+
+        if (m_activeRequests + m_hedges >= maxActiveRequests) {
+            // Give the slot of a request that became far less important, e.g.
+            // a tile which moved out of view, to the most important queued one.
+            if (!worstActive ||
+                worstActive->task->getPriority() <= preemptFactor * best->task->getPriority()) {
+                break;
+            }
+            // Not yet started requests have no handle, their response is dropped
+            if (worstActive->request) { dispatch.cancel.push_back(worstActive->request); }
+            if (worstActive->hedgeRequest) { dispatch.cancel.push_back(worstActive->hedgeRequest); }
+            requeue(*worstActive);
+            release(*worstActive);
+            m_pending.erase(worstActive->task->tileId());
+        }
+
+        startRequest(*best, dispatch);
+    }
+
+    startHedges(dispatch);
+}
+
+void NetworkDataSource::startHedges(Dispatch& dispatch) {
+
+    if (!m_hedgeRequests || m_subdomains.size() < 2 || m_activeRequests < m_pending.size()) {
+        return;
+    }
+
+    auto now = Clock::now();
+    for (auto& it : m_pending) {
+        if (m_activeRequests + m_hedges >= maxActiveRequests) { break; }
+
+        auto& entry = it.second;
+        if (entry.hedgeSerial || now - entry.started < hedgeDelay(entry.subdomain)) { continue; }
+
+        startHedge(entry, dispatch);
+    }
+}
+
+void NetworkDataSource::dropHedge(TileRequest& entry, Dispatch& dispatch) {
+    if (entry.hedgeRequest) { dispatch.cancel.push_back(entry.hedgeRequest); }
+    m_subdomains[entry.hedgeSubdomain].active--;
+    entry.hedgeRequest = 0;
+    entry.hedgeSerial = 0;
+    m_hedges--;
+}
+
+void NetworkDataSource::release(TileRequest& entry) {
+    if (!entry.active) { return; }
+
+    m_subdomains[entry.subdomain].active--;
+    m_activeRequests--;
+    if (entry.hedgeSerial) {
+        m_subdomains[entry.hedgeSubdomain].active--;
+        m_hedges--;
+    }
+}
+
+size_t NetworkDataSource::pickSubdomain(size_t _exclude) {
+
+    size_t count = m_subdomains.size();
+    size_t best = count;
+    bool bestBackingOff = true;
+    float bestCost = 0;
 
-    if (!m_urlSubdomains.empty()) {
-        m_urlSubdomainIndex = (m_urlSubdomainIndex + 1) % m_urlSubdomains.size();
+    for (size_t i = 0; i < count; i++) {
+        // Subdomains with the same cost take turns
+        size_t index = (m_urlSubdomainIndex + i) % count;
+        if (index == _exclude) { continue; }
+
+        // A new request waits for those in flight, hosts which failed recently
+        // are tried less and those which have not answered yet are tried first.
+        auto& subdomain = m_subdomains[index];
+        float latency = subdomain.samples > 0 ? subdomain.latency + 1.f : 0.f;
+        float cost = latency * (subdomain.active + 1) * float(1 << std::min(subdomain.failures, 8u));
+        bool backingOff = m_backoff.isBackingOff(subdomain.host);
+
+        if (best == count || (bestBackingOff && !backingOff) ||
+            (bestBackingOff == backingOff && cost < bestCost)) {
+            best = index;
+            bestCost = cost;
+            bestBackingOff = backingOff;
+        }
     }
+    if (best == count) { best = 0; }
+
+    m_urlSubdomainIndex = (best + 1) % count;
+    return best;
+}
+
+NetworkDataSource::Clock::duration NetworkDataSource::hedgeDelay(size_t _subdomain) const {
+
+    auto& subdomain = m_subdomains[_subdomain];
+    if (subdomain.samples < minHedgeSamples) { return Clock::duration::max(); }
+
+    size_t count = std::min(subdomain.samples, subdomain.latencies.size());
+    std::array<float, 32> latencies = subdomain.latencies;
+    auto nth = latencies.begin() + size_t(hedgePercentile * (count - 1));
+    std::nth_element(latencies.begin(), nth, latencies.begin() + count);
+
+    auto delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(*nth));
+    return std::max<Clock::duration>(delay, minHedgeDelay);
+}
+
+void NetworkDataSource::recordResponse(size_t _subdomain, Clock::duration _latency, bool _failed) {
+
+    auto& subdomain = m_subdomains[_subdomain];
+    if (_failed) {
+        subdomain.failures++;
+        return;
+    }
+    subdomain.failures = 0;
+
+    float latency = std::chrono::duration<float, std::milli>(_latency).count();
+    subdomain.latencies[subdomain.samples % subdomain.latencies.size()] = latency;
+    subdomain.latency = subdomain.samples == 0 ? latency :
+        subdomain.latency + latencyWeight * (latency - subdomain.latency);
+    subdomain.samples++;
+}
+
+void NetworkDataSource::apply(Dispatch& dispatch) {
+
+    for (auto& start : dispatch.start) {
+        // The same tile of any source with this URL template, whichever subdomain serves it
+        auto key = buildUrlForTile(start.tile, m_urlSubdomains.size());
+        // Copies are not joined with the request they are meant to overtake
+        if (start.hedge) { key += "#hedge"; }
+        auto handle = s_sharedRequests.start(*m_platform, key, start.url, start.validators,
+                                             start.priority, std::move(start.callback));
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_pending.find(start.tile);
+        if (it == m_pending.end()) { continue; }
+
+        if (it->second.serial == start.serial) {
+            it->second.request = handle;
+        } else if (it->second.hedgeSerial == start.serial) {
+            it->second.hedgeRequest = handle;
+        }
+    }
+    // Cancelling a request will run its callback, which can call into this class again,
+    // so we must perform the cancellation outside the mutex lock or we'll deadlock.
+    for (auto request : dispatch.cancel) {
+        s_sharedRequests.cancel(*m_platform, request);
+    }
+}
+
+void NetworkDataSource::requeue(TileRequest& entry) {
+    if (!entry.task->isCanceled()) {
+        entry.task->setNeedsLoading(true);
+    }
+}
+
+void NetworkDataSource::startRequest(TileRequest& entry, Dispatch& dispatch) {
 
-    UrlCallback onRequestFinish = [this, callback, task, url](UrlResponse response) mutable {
+    auto tileId = entry.task->tileId();
 
-        removePending(task->tileId(), false);
+    entry.subdomain = pickSubdomain(m_subdomains.size());
+    entry.started = Clock::now();
+    m_subdomains[entry.subdomain].active++;
+
+    Url url(buildUrlForTile(tileId, entry.subdomain));
+
+    // Validators of a stale copy in a cache before this source
+    auto& dlTask = static_cast<BinaryTileTask&>(*entry.task);
+    UrlValidators validators{ dlTask.etag, dlTask.lastModified };
+
+    entry.active = true;
+    m_activeRequests++;
+    dispatch.start.push_back({ tileId, entry.serial, url, std::move(validators), entry.task->getPriority(),
+                               onResponse(entry, url, entry.serial, entry.subdomain), false });
+}
+
+void NetworkDataSource::startHedge(TileRequest& entry, Dispatch& dispatch) {
+
+    auto tileId = entry.task->tileId();
+
+    entry.hedgeSerial = ++m_serial;
+    entry.hedgeSubdomain = pickSubdomain(entry.subdomain);
+    entry.hedgeStarted = Clock::now();
+    m_subdomains[entry.hedgeSubdomain].active++;
+    m_hedges++;
+
+    Url url(buildUrlForTile(tileId, entry.hedgeSubdomain));
+
+    auto& dlTask = static_cast<BinaryTileTask&>(*entry.task);
+    UrlValidators validators{ dlTask.etag, dlTask.lastModified };
+
+    dispatch.start.push_back({ tileId, entry.hedgeSerial, url, std::move(validators), entry.task->getPriority(),
+                               onResponse(entry, url, entry.hedgeSerial, entry.hedgeSubdomain), true });
+}
+
+std::function<void(const UrlResponse&, ByteBuffer)> NetworkDataSource::onResponse(TileRequest& entry,
+    const Url& url, uint64_t serial, size_t subdomain) {
+
+    auto task = entry.task;
+    auto callback = entry.callback;
+
+    return [this, callback, task, url, serial, subdomain](const UrlResponse& response,
+                                                         ByteBuffer content) mutable {
+
+        bool missing = isMissingTile(response, content, m_mapFiles);
+        bool failed = response.error && !missing;
+
+        // Requests that were cancelled or preempted have no entry anymore
+        if (!finishPending(task->tileId(), serial, failed)) {
+            return;
+        }
 
         if (task->isCanceled()) {
             return;
         }
 
-        if (response.error) {
+        auto& host = m_subdomains[subdomain].host;
+
+        if (missing) {
+            m_backoff.succeeded(host);
+
+            auto ttl = response.maxAge > 0 ?
+                std::chrono::duration_cast<TileMissCache::Clock::duration>(std::chrono::seconds(response.maxAge)) :
+                TileMissCache::Clock::duration::zero();
+            m_misses.add(task->tileId(), ttl);
+
+            callback.func(task);
+            return;
+        }
+
+        if (failed) {
             LOGE("Error for URL request '%s': %s", url.string().c_str(), response.error);
+
+            // Loaded again by the TileManager once the host is not backed off
+            m_backoff.failed(host);
+            task->setNeedsLoading(true);
+            m_platform->requestRender();
             return;
         }
 
-        if (!response.content.empty()) {
-            auto& dlTask = static_cast<BinaryTileTask&>(*task);
-            dlTask.rawTileData = std::make_shared<std::vector<char>>(std::move(response.content));
+        m_backoff.succeeded(host);
+
+        auto& dlTask = static_cast<BinaryTileTask&>(*task);
+        if (response.status == 304) {
+            // The cache that sent the validators provides the data.
+            // Servers may leave out unchanged validators.
+            dlTask.notModified = true;
+            if (!response.etag.empty()) { dlTask.etag = response.etag; }
+            if (!response.lastModified.empty()) { dlTask.lastModified = response.lastModified; }
+            dlTask.maxAge = response.maxAge;
+
+        } else if (!content.empty()) {
+            dlTask.rawTileData = std::move(content);
+            dlTask.etag = response.etag;
+            dlTask.lastModified = response.lastModified;
+            dlTask.maxAge = response.maxAge;
         }
         callback.func(task);
     };
+}
 
+bool NetworkDataSource::finishPending(const TileID& tile, uint64_t serial, bool failed) {
+    Dispatch requests;
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        auto requestHandle = m_platform->startUrlRequest(url, onRequestFinish);
-        m_pending.push_back({ tileId, requestHandle });
-    }
+        auto it = m_pending.find(tile);
+        if (it == m_pending.end()) { return false; }
+
+        auto& entry = it->second;
+        bool hedge = entry.hedgeSerial != 0 && entry.hedgeSerial == serial;
+        if (!hedge && entry.serial != serial) { return false; }
+
+        auto now = Clock::now();
+        if (hedge) {
+            recordResponse(entry.hedgeSubdomain, now - entry.hedgeStarted, failed);
+        } else {
+            recordResponse(entry.subdomain, now - entry.started, failed);
+        }
+
+        if (entry.hedgeSerial) {
+            if (failed) {
+                m_backoff.failed(m_subdomains[hedge ? entry.hedgeSubdomain : entry.subdomain].host);
 
+                // Wait for the other request
+                if (!hedge) {
+                    m_subdomains[entry.subdomain].active--;
+                    entry.request = entry.hedgeRequest;
+                    entry.serial = entry.hedgeSerial;
+                    entry.subdomain = entry.hedgeSubdomain;
+                    entry.started = entry.hedgeStarted;
+                    m_subdomains[entry.subdomain].active++;
+                }
+                entry.hedgeRequest = 0;
+                dropHedge(entry, requests);
+
+                dispatch(requests);
+                lock.unlock();
+                apply(requests);
+                return false;
+            }
+
+            // The time of the slower request so far tells about its subdomain as well
+            if (hedge) {
+                recordResponse(entry.subdomain, now - entry.started, false);
+                if (entry.request) { requests.cancel.push_back(entry.request); }
+            } else {
+                recordResponse(entry.hedgeSubdomain, now - entry.hedgeStarted, false);
+                if (entry.hedgeRequest) { requests.cancel.push_back(entry.hedgeRequest); }
+            }
+        }
+
+        release(entry);
+        m_pending.erase(it);
+
+        dispatch(requests);
+    }
+    apply(requests);
     return true;
 }
 
 void NetworkDataSource::removePending(const TileID& tile, bool cancelRequest) {
-    UrlRequestHandle pendingRequestToCancel = 0;
-    bool foundRequest = false;
+    std::vector<uint64_t> requestsToCancel;
+    Dispatch requests;
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
-            if (it->tile == tile) {
-                pendingRequestToCancel = it->request;
-                foundRequest = true;
-                // This invalidates our iterators, so we break immediately.
-                m_pending.erase(it);
-                break;
+        auto it = m_pending.find(tile);
+        if (it != m_pending.end()) {
+            if (it->second.active) {
+                if (it->second.request) { requestsToCancel.push_back(it->second.request); }
+                if (it->second.hedgeRequest) { requestsToCancel.push_back(it->second.hedgeRequest); }
+                release(it->second);
             }
+            m_pending.erase(it);
+            dispatch(requests);
         }
     }
     // Cancelling a request will run its callback, which can call into this function again,
     // so we must perform the cancellation outside the mutex lock or we'll deadlock.
-    if (cancelRequest && foundRequest) {
-        m_platform->cancelUrlRequest(pendingRequestToCancel);
+    if (cancelRequest) {
+        for (auto request : requestsToCancel) {
+            s_sharedRequests.cancel(*m_platform, request);
+        }
     }
+    apply(requests);
 }
 
 void NetworkDataSource::cancelLoadingTile(const TileID& tile) {
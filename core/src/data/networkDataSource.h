@@ -1,8 +1,12 @@
 #pragma once
 
+#include "data/tileMissCache.h"
 #include "data/tileSource.h"
 #include "platform.h"
+#include "tile/tileHash.h"
 
+#include <array>
+#include <chrono>
 #include <unordered_map>
 
 namespace Tangram {
@@ -15,21 +19,129 @@ public:
     NetworkDataSource(std::shared_ptr<Platform> _platform, const std::string& _urlTemplate,
             std::vector<std::string>&& _urlSubdomains, bool isTms);
 
+    // Cancels the requests which are still in flight
+    ~NetworkDataSource();
+
     bool loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override;
 
     void cancelLoadingTile(const TileID& _tile) override;
 
-private:
     // Build the URL of a tile using our URL template.
     std::string buildUrlForTile(const TileID& tile, size_t subdomainIndex) const;
 
-    // Each pending tile request is stored as a pair of TileID and UrlRequestHandle.
+    size_t subdomainCount() const { return m_urlSubdomains.size(); }
+
+    // Send a copy of requests which take longer than most responses of their
+    // subdomain to another subdomain, the first response is used.
+    void setHedgeRequests(bool _hedge) { m_hedgeRequests = _hedge; }
+
+    // Tiles which the server does not have; they are passed on without data
+    TileMissCache& misses() { return m_misses; }
+
+    // Backoff of the hosts after failed requests
+    HostBackoff& backoff() { return m_backoff; }
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    // Tasks wait in the queue until a request slot is free. Once started they
+    // keep their entry with the handle of the shared request until the
+    // response arrives.
     struct TileRequest {
-        TileID tile;
-        UrlRequestHandle request;
+        std::shared_ptr<TileTask> task;
+        TileTaskCb callback;
+        uint64_t request;
+        // Tells responses apart from those to an earlier request of the same tile
+        uint64_t serial;
+        bool active;
+        size_t subdomain = 0;
+        Clock::time_point started;
+        // Copy of the request to another subdomain, when hedgeSerial is set
+        uint64_t hedgeRequest = 0;
+        uint64_t hedgeSerial = 0;
+        size_t hedgeSubdomain = 0;
+        Clock::time_point hedgeStarted;
+    };
+
+    TileIDMap<TileRequest> m_pending;
+    // Entries with a request in flight, and copies of their requests
+    size_t m_activeRequests = 0;
+    size_t m_hedges = 0;
+    uint64_t m_serial = 0;
+
+    // Response times and failures of a subdomain, or of the host of the URL
+    // template when it has no subdomains
+    struct Subdomain {
+        std::string host;
+        // Recent response times in milliseconds, the oldest one is replaced
+        std::array<float, 32> latencies{};
+        size_t samples = 0;
+        // Moving average of the response times
+        float latency = 0;
+        // Requests in flight
+        uint32_t active = 0;
+        // Failures since the last response
+        uint32_t failures = 0;
+    };
+
+    std::vector<Subdomain> m_subdomains;
+
+    // Requests to start and cancel once m_mutex is released, as the platform
+    // may run callbacks before returning.
+    struct Dispatch {
+        struct Start {
+            TileID tile;
+            uint64_t serial;
+            Url url;
+            UrlValidators validators;
+            double priority;
+            std::function<void(const UrlResponse&, ByteBuffer)> callback;
+            bool hedge;
+        };
+        std::vector<Start> start;
+        std::vector<uint64_t> cancel;
     };
 
-    std::vector<TileRequest> m_pending;
+    // Start queued requests by the current priority of their tasks, and preempt
+    // far worse active requests. m_mutex must be held.
+    void dispatch(Dispatch& dispatch);
+
+    void startRequest(TileRequest& entry, Dispatch& dispatch);
+
+    // Send a copy of the request of entry to another subdomain
+    void startHedge(TileRequest& entry, Dispatch& dispatch);
+
+    // Copy the requests which take unusually long, m_mutex must be held
+    void startHedges(Dispatch& dispatch);
+
+    // Cancel the copy of the request of entry, m_mutex must be held
+    void dropHedge(TileRequest& entry, Dispatch& dispatch);
+
+    // Release the request slots of entry, m_mutex must be held
+    void release(TileRequest& entry);
+
+    std::function<void(const UrlResponse&, ByteBuffer)> onResponse(TileRequest& entry, const Url& url,
+                                                                    uint64_t serial, size_t subdomain);
+
+    // The subdomain with the shortest expected response time, other than
+    // _exclude. m_mutex must be held.
+    size_t pickSubdomain(size_t _exclude);
+
+    // Earliest time after which a request to _subdomain is copied
+    Clock::duration hedgeDelay(size_t _subdomain) const;
+
+    // Record a response or failure of _subdomain, m_mutex must be held
+    void recordResponse(size_t _subdomain, Clock::duration _latency, bool _failed);
+
+    void apply(Dispatch& dispatch);
+
+    // Hand a dropped task back to the TileManager to be loaded again
+    void requeue(TileRequest& entry);
+
+    // Remove the pending entry of tile if it belongs to serial, returns false otherwise.
+    // A failed request returns false as well while its copy is still in flight.
+    bool finishPending(const TileID& tile, uint64_t serial, bool failed);
 
     // Remove a pending list item with the given TileID if present, and if cancelRequest is true
     // also cancels the corresponding URL request.
@@ -42,6 +154,12 @@ private:
     std::vector<std::string> m_urlSubdomains;
     size_t m_urlSubdomainIndex = 0;
     bool m_isTms = false;
+    // Tiles of file:// templates are mapped instead of requested
+    bool m_mapFiles = false;
+    bool m_hedgeRequests = false;
+
+    TileMissCache m_misses;
+    HostBackoff m_backoff;
 
     std::mutex m_mutex;
 
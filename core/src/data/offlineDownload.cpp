@@ -0,0 +1,278 @@
+#include "data/offlineDownload.h"
+
+#include "data/mbtilesDataSource.h"
+#include "data/networkDataSource.h"
+#include "log.h"
+#include "platform.h"
+#include "tile/tileHash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Tangram {
+
+// Retry interval while the MBTiles write queue is full
+static constexpr auto storeRetryInterval = std::chrono::milliseconds(50);
+
+struct OfflineDownloadState {
+    struct Response {
+        TileID tileId;
+        UrlResponse response;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Response> responses;
+    std::unordered_map<TileID, UrlRequestHandle> active;
+    OfflineProgress progress;
+    bool canceled = false;
+};
+
+// Tile columns and rows of _region at zoom _z
+static void tileRange(const OfflineRegion& _region, int _z, int& _minX, int& _maxX, int& _minY, int& _maxY) {
+    const double maxLatitude = 85.05112878;
+    int n = 1 << _z;
+
+    auto column = [n](double _lng) {
+        int x = std::floor((_lng + 180.0) / 360.0 * n);
+        return std::max(0, std::min(n - 1, x));
+    };
+    auto row = [n, maxLatitude](double _lat) {
+        double lat = std::max(-maxLatitude, std::min(maxLatitude, _lat)) * M_PI / 180.0;
+        int y = std::floor((1.0 - std::log(std::tan(lat) + 1.0 / std::cos(lat)) / M_PI) / 2.0 * n);
+        return std::max(0, std::min(n - 1, y));
+    };
+
+    _minX = column(_region.min.longitude);
+    _maxX = column(_region.max.longitude);
+    // Rows grow to the south
+    _minY = row(_region.max.latitude);
+    _maxY = row(_region.min.latitude);
+}
+
+OfflineDownload::OfflineDownload(std::shared_ptr<Platform> _platform, const std::string& _urlTemplate,
+                                 std::vector<std::string> _urlSubdomains, bool _isTms,
+                                 const std::string& _mbtilesPath, OfflineRegion _region, Options _options)
+    : m_platform(_platform),
+      m_region(_region),
+      m_options(_options),
+      m_state(std::make_shared<OfflineDownloadState>()) {
+
+    m_network = std::make_unique<NetworkDataSource>(_platform, _urlTemplate, std::move(_urlSubdomains), _isTms);
+    m_mbtiles = std::make_unique<MBTilesDataSource>(_platform, _mbtilesPath, _mbtilesPath, "", true);
+
+    m_options.maxActiveRequests = std::max(1u, m_options.maxActiveRequests);
+}
+
+OfflineDownload::~OfflineDownload() {
+    cancel();
+}
+
+bool OfflineDownload::start(OfflineProgressCallback _callback) {
+    if (m_thread.joinable()) { return true; }
+
+    if (!m_mbtiles->isWritable()) {
+        LOGE("Cannot download region to MBTiles file");
+        return false;
+    }
+
+    m_callback = _callback;
+    m_thread = std::thread(&OfflineDownload::run, this);
+    return true;
+}
+
+void OfflineDownload::cancel() {
+    std::vector<UrlRequestHandle> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->canceled = true;
+        for (auto& it : m_state->active) {
+            // Requests being started have no handle yet, their response is ignored
+            if (it.second) { requests.push_back(it.second); }
+        }
+        m_state->active.clear();
+    }
+    m_state->condition.notify_all();
+
+    // The callbacks of cancelled requests only touch the shared state
+    for (auto request : requests) { m_platform->cancelUrlRequest(request); }
+
+    if (m_thread.joinable()) { m_thread.join(); }
+}
+
+OfflineProgress OfflineDownload::progress() const {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->progress;
+}
+
+void OfflineDownload::run() {
+
+    auto state = m_state;
+
+    std::vector<int> zooms;
+    for (int z = std::max(0, m_region.minZoom); z <= m_region.maxZoom; z++) { zooms.push_back(z); }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (int z : zooms) {
+            int minX, maxX, minY, maxY;
+            tileRange(m_region, z, minX, maxX, minY, maxY);
+            state->progress.totalTiles += uint64_t(maxX - minX + 1) * (maxY - minY + 1);
+        }
+    }
+
+    // Tiles left to request, filled one zoom level at a time
+    std::deque<TileID> queue;
+    std::unordered_map<TileID, uint32_t> attempts;
+    size_t zoomIndex = 0;
+    size_t subdomain = 0;
+
+    auto fillQueue = [&]() {
+        while (queue.empty() && zoomIndex < zooms.size()) {
+            int z = zooms[zoomIndex++];
+            int minX, maxX, minY, maxY;
+            tileRange(m_region, z, minX, maxX, minY, maxY);
+
+            // Resume: skip what an earlier download stored
+            auto stored = m_mbtiles->storedTiles(z, minX, maxX, minY, maxY);
+            std::unordered_set<TileID> skip(stored.begin(), stored.end());
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->progress.storedTiles += skip.size();
+            }
+
+            for (int x = minX; x <= maxX; x++) {
+                for (int y = minY; y <= maxY; y++) {
+                    TileID id(x, y, z);
+                    if (skip.find(id) == skip.end()) { queue.push_back(id); }
+                }
+            }
+        }
+    };
+
+    auto windowStart = std::chrono::steady_clock::now();
+    uint64_t windowBytes = 0;
+
+    while (true) {
+        std::deque<OfflineDownloadState::Response> responses;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (state->canceled) { break; }
+            std::swap(responses, state->responses);
+        }
+
+        // Store finished tiles
+        for (auto& result : responses) {
+            auto& response = result.response;
+            bool stored = false;
+
+            if (!response.error && !response.content.empty()) {
+                size_t size = response.content.size();
+                ByteBuffer data(std::move(response.content));
+
+                // Wait for the writer instead of dropping tiles of the region
+                while (!(stored = m_mbtiles->queueTileData(result.tileId, data))) {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    if (state->condition.wait_for(lock, storeRetryInterval,
+                                                  [&]{ return state->canceled; })) { break; }
+                }
+                windowBytes += size;
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->progress.downloadedBytes += size;
+                if (stored) { state->progress.storedTiles++; }
+
+            } else if (attempts[result.tileId]++ < m_options.retries) {
+                LOGW("Retry offline tile %s: %s", result.tileId.toString().c_str(),
+                     response.error ? response.error : "empty response");
+                queue.push_back(result.tileId);
+                continue;
+            }
+
+            if (!stored) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->progress.failedTiles++;
+            }
+            if (m_callback) { m_callback(progress()); }
+        }
+
+        // Bandwidth cap over one second windows
+        auto now = std::chrono::steady_clock::now();
+        if (now - windowStart >= std::chrono::seconds(1)) {
+            windowStart = now;
+            windowBytes = 0;
+        }
+        bool throttled = m_options.maxBytesPerSecond > 0 && windowBytes >= m_options.maxBytesPerSecond;
+
+        // Start requests
+        fillQueue();
+        while (!throttled && !queue.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->canceled || state->active.size() >= m_options.maxActiveRequests) { break; }
+            }
+
+            TileID id = queue.front();
+            queue.pop_front();
+
+            Url url(m_network->buildUrlForTile(id, subdomain));
+            if (m_network->subdomainCount() > 0) {
+                subdomain = (subdomain + 1) % m_network->subdomainCount();
+            }
+
+            std::weak_ptr<OfflineDownloadState> weakState = state;
+            UrlCallback onFinish = [weakState, id](UrlResponse response) {
+                auto state = weakState.lock();
+                if (!state) { return; }
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (state->active.erase(id) == 0) { return; }
+                    state->responses.push_back({ id, std::move(response) });
+                }
+                state->condition.notify_all();
+            };
+
+            // Mark active before starting, the callback may run right away
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->active[id] = 0;
+            }
+            auto handle = m_platform->startUrlRequest(url, onFinish);
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                auto it = state->active.find(id);
+                if (it != state->active.end()) { it->second = handle; }
+            }
+
+            fillQueue();
+        }
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (queue.empty() && zoomIndex == zooms.size() &&
+            state->active.empty() && state->responses.empty()) {
+            state->progress.finished = true;
+            break;
+        }
+        // Wake for responses, or when the next bandwidth window starts
+        auto until = throttled ? windowStart + std::chrono::seconds(1)
+                               : std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        state->condition.wait_until(lock, until, [&]{
+                return state->canceled || !state->responses.empty() ||
+                    (!throttled && state->active.size() < m_options.maxActiveRequests && !queue.empty());
+            });
+    }
+
+    auto result = progress();
+    if (result.finished) {
+        LOG("Offline download finished: %llu tiles", (unsigned long long)result.storedTiles);
+    }
+    if (m_callback) { m_callback(result); }
+}
+
+}
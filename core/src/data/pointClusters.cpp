@@ -0,0 +1,101 @@
+#include "data/pointClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tangram {
+
+static constexpr double tileSize = 256.0;
+
+static uint64_t cellKey(int64_t _x, int64_t _y) {
+    return (uint64_t(uint32_t(_x)) << 32) | uint32_t(_y);
+}
+
+PointClusters::PointClusters(std::vector<Cluster> _points, float _radius, int _maxZoom,
+                             uint32_t _minPoints) {
+
+    int maxZoom = std::max(0, _maxZoom);
+    m_levels.resize(maxZoom + 1);
+
+    std::vector<Cluster> points = std::move(_points);
+
+    for (int z = maxZoom; z >= 0; z--) {
+        const double scale = double(1 << z);
+        const double radius = _radius / (tileSize * scale);
+        const double radius2 = radius * radius;
+
+        // Grid of cells of the radius size, neighbors are in the 3x3 cells around a point
+        const double cellsPerUnit = 1.0 / radius;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+        grid.reserve(points.size());
+        for (uint32_t i = 0; i < points.size(); i++) {
+            auto& pos = points[i].pos;
+            grid[cellKey(std::floor(pos.x * cellsPerUnit), std::floor(pos.y * cellsPerUnit))].push_back(i);
+        }
+
+        auto& clusters = m_levels[z].clusters;
+        std::vector<bool> visited(points.size(), false);
+        std::vector<uint32_t> neighbors;
+
+        for (uint32_t i = 0; i < points.size(); i++) {
+            if (visited[i]) { continue; }
+            visited[i] = true;
+
+            auto& point = points[i];
+            int64_t cx = int64_t(std::floor(point.pos.x * cellsPerUnit));
+            int64_t cy = int64_t(std::floor(point.pos.y * cellsPerUnit));
+
+            neighbors.clear();
+            uint32_t count = point.count;
+            for (int64_t x = cx - 1; x <= cx + 1; x++) {
+                for (int64_t y = cy - 1; y <= cy + 1; y++) {
+                    auto cell = grid.find(cellKey(x, y));
+                    if (cell == grid.end()) { continue; }
+                    for (auto j : cell->second) {
+                        if (visited[j]) { continue; }
+                        glm::dvec2 d = points[j].pos - point.pos;
+                        if (d.x * d.x + d.y * d.y > radius2) { continue; }
+                        neighbors.push_back(j);
+                        count += points[j].count;
+                    }
+                }
+            }
+
+            if (neighbors.empty() || count < _minPoints) {
+                clusters.push_back(point);
+                continue;
+            }
+
+            glm::dvec2 center = point.pos * double(point.count);
+            for (auto j : neighbors) {
+                visited[j] = true;
+                center += points[j].pos * double(points[j].count);
+            }
+            clusters.push_back({ center / double(count), count, 0 });
+        }
+
+        auto& tiles = m_levels[z].tiles;
+        for (uint32_t i = 0; i < clusters.size(); i++) {
+            auto& pos = clusters[i].pos;
+            uint64_t x = std::min(scale - 1, std::max(0.0, std::floor(pos.x * scale)));
+            uint64_t y = std::min(scale - 1, std::max(0.0, std::floor(pos.y * scale)));
+            tiles[(x << 32) | y].push_back(i);
+        }
+
+        // The next level merges the clusters of this one
+        points = clusters;
+    }
+}
+
+void PointClusters::getTile(int _z, int _x, int _y, std::vector<Cluster>& _out) const {
+
+    if (_z < 0 || _z > maxZoom()) { return; }
+
+    auto& level = m_levels[_z];
+    auto it = level.tiles.find((uint64_t(_x) << 32) | uint64_t(_y));
+    if (it == level.tiles.end()) { return; }
+
+    for (auto i : it->second) { _out.push_back(level.clusters[i]); }
+}
+
+}
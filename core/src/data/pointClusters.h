@@ -0,0 +1,54 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Tangram {
+
+/* Hierarchical clusters of points
+ *
+ * Built once for a set of points, in the manner of supercluster: the points of
+ * each zoom level from maxZoom down to 0 are merged with their neighbors
+ * closer than radius pixels into clusters at their weighted center. Each
+ * level is clustered from the level above, so that clusters split up
+ * consistently when zooming in. The clusters of a level are bucketed by the
+ * tiles of its zoom.
+ */
+class PointClusters {
+
+public:
+
+    struct Cluster {
+        // Web mercator in [0, 1], y pointing down
+        glm::dvec2 pos;
+        // Number of points, 1 for a point that is not clustered
+        uint32_t count;
+        // Id of the point when count is 1
+        uint64_t id;
+    };
+
+    /* Points closer than _radius, in pixels of 256px tiles, are merged into
+     * clusters of at least _minPoints. Tiles above _maxZoom show all points. */
+    PointClusters(std::vector<Cluster> _points, float _radius, int _maxZoom, uint32_t _minPoints);
+
+    int maxZoom() const { return int(m_levels.size()) - 1; }
+
+    /* Add the clusters and points of zoom _z within tile _x, _y to _out.
+     * Nothing is added above maxZoom. */
+    void getTile(int _z, int _x, int _y, std::vector<Cluster>& _out) const;
+
+private:
+
+    struct Level {
+        std::vector<Cluster> clusters;
+        // Indices into clusters by tile
+        std::unordered_map<uint64_t, std::vector<uint32_t>> tiles;
+    };
+
+    std::vector<Level> m_levels;
+};
+
+}
@@ -1,6 +1,9 @@
 #include "data/propertyItem.h"
 #include "data/properties.h"
 #include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 namespace Tangram {
 
@@ -15,47 +18,114 @@ std::string doubleToString(double _doubleValue) {
     return value;
 }
 
+namespace {
+
+struct KeyTable {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> atoms;
+    // Deque elements keep their address when the table grows
+    std::deque<std::string> names;
+
+    KeyTable() {
+        atoms.emplace("", 0);
+        names.emplace_back();
+    }
+};
+
+KeyTable& keyTable() {
+    static KeyTable s_table;
+    return s_table;
+}
+
+}
+
+uint32_t PropertyKey::intern(const std::string& _name) {
+    auto& table = keyTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.atoms.find(_name);
+    if (it != table.atoms.end()) { return it->second; }
+
+    uint32_t atom = uint32_t(table.names.size());
+    table.names.push_back(_name);
+    table.atoms.emplace(_name, atom);
+    return atom;
+}
+
+bool PropertyKey::find(const std::string& _name, PropertyKey& _key) {
+    auto& table = keyTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.atoms.find(_name);
+    if (it == table.atoms.end()) { return false; }
+
+    _key.m_atom = it->second;
+    return true;
+}
+
+const std::string& PropertyKey::name() const {
+    auto& table = keyTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names[m_atom];
+}
+
 Properties::Properties() : sourceId(0) {}
 
 Properties::~Properties() {}
 
 Properties& Properties::operator=(Properties&& _other) {
     props = std::move(_other.props);
+    shared = std::move(_other.shared);
     sourceId = _other.sourceId;
     return *this;
 }
 
 void Properties::setSorted(std::vector<Item>&& _items) {
     props = std::move(_items);
+    shared.reset();
 }
 
-const Value& Properties::get(const std::string& key) const {
+void Properties::setShared(std::shared_ptr<const std::vector<Item>> _items) {
+    props.clear();
+    shared = std::move(_items);
+}
 
-    const auto it = std::find_if(props.begin(), props.end(),
-                                 [&](const auto& item) {
-                                     return item.key == key;
-                                 });
-    if (it == props.end()) {
+void Properties::detach() {
+    if (!shared) { return; }
+    props = *shared;
+    shared.reset();
+}
+
+const Value& Properties::get(const std::string& key) const {
+    PropertyKey k;
+    if (!PropertyKey::find(key, k)) {
         return NOT_A_VALUE;
     }
+    return get(k);
+}
 
-    // auto it = std::lower_bound(props.begin(), props.end(), key,
-    //                            [](auto& item, auto& key) {
-    //                                return keyComparator(item.key, key);
-    //                            });
-    // if (it == props.end() || it->key != key) {
-    //     return NOT_FOUND;
-    // }
-
-    return it->value;
+const Value& Properties::get(PropertyKey key) const {
+    // Features have few properties, a linear scan over atoms beats
+    // a binary search here.
+    for (const auto& item : items()) {
+        if (item.key == key) { return item.value; }
+    }
+    return NOT_A_VALUE;
 }
 
-void Properties::clear() { props.clear(); }
+void Properties::clear() {
+    props.clear();
+    shared.reset();
+}
 
 bool Properties::contains(const std::string& key) const {
     return !get(key).is<none_type>();
 }
 
+bool Properties::contains(PropertyKey key) const {
+    return !get(key).is<none_type>();
+}
+
 bool Properties::getNumber(const std::string& key, double& value) const {
     auto& it = get(key);
     if (it.is<double>()) {
@@ -65,6 +135,15 @@ bool Properties::getNumber(const std::string& key, double& value) const {
     return false;
 }
 
+bool Properties::getNumber(PropertyKey key, double& value) const {
+    auto& it = get(key);
+    if (it.is<double>()) {
+        value = it.get<double>();
+        return true;
+    }
+    return false;
+}
+
 double Properties::getNumber(const std::string& key) const {
     auto& it = get(key);
     if (it.is<double>()) {
@@ -82,16 +161,23 @@ bool Properties::getString(const std::string& key, std::string& value) const {
     return false;
 }
 
-const std::string& Properties::getString(const std::string& key) const {
+static const std::string& stringValue(const Value& _value) {
     const static std::string EMPTY_STRING = "";
 
-    auto& it = get(key);
-    if (it.is<std::string>()) {
-        return it.get<std::string>();
+    if (_value.is<std::string>()) {
+        return _value.get<std::string>();
     }
     return EMPTY_STRING;
 }
 
+const std::string& Properties::getString(const std::string& key) const {
+    return stringValue(get(key));
+}
+
+const std::string& Properties::getString(PropertyKey key) const {
+    return stringValue(get(key));
+}
+
 bool Properties::getAsString(const std::string& key, std::string& value) const {
     auto& it = get(key);
 
@@ -121,19 +207,28 @@ std::string Properties::getAsString(const std::string& key) const {
 
 }
 
+std::string Properties::getAsString(PropertyKey key) const {
+
+    return asString(get(key));
+
+}
+
 void Properties::sort() {
+    detach();
     std::sort(props.begin(), props.end());
 }
 
 void Properties::set(std::string key, std::string value) {
 
-    auto it = std::lower_bound(props.begin(), props.end(), key,
+    detach();
+    PropertyKey k(key);
+    auto it = std::lower_bound(props.begin(), props.end(), k,
                                [](auto& item, auto& key) {
-                                   return keyComparator(item.key, key);
+                                   return item.key < key;
                                });
 
-    if (it == props.end() || it->key != key) {
-        props.emplace(it, std::move(key), std::move(value));
+    if (it == props.end() || it->key != k) {
+        props.emplace(it, k, std::move(value));
     } else {
         it->value = std::move(value);
     }
@@ -141,13 +236,15 @@ void Properties::set(std::string key, std::string value) {
 
 void Properties::set(std::string key, double value) {
 
-    auto it = std::lower_bound(props.begin(), props.end(), key,
+    detach();
+    PropertyKey k(key);
+    auto it = std::lower_bound(props.begin(), props.end(), k,
                                [](auto& item, auto& key) {
-                                   return keyComparator(item.key, key);
+                                   return item.key < key;
                                });
 
-    if (it == props.end() || it->key != key) {
-        props.emplace(it, std::move(key), value);
+    if (it == props.end() || it->key != k) {
+        props.emplace(it, k, value);
     } else {
         it->value = value;
     }
@@ -157,9 +254,10 @@ std::string Properties::toJson() const {
 
     std::string json = "{ ";
 
-    for (const auto& item : props) {
-        bool last = (&item == &props.back());
-        json += "\"" + item.key + "\": \"" + asString(item.value) + (last ? "\"" : "\",");
+    const auto& all = items();
+    for (const auto& item : all) {
+        bool last = (&item == &all.back());
+        json += "\"" + item.key.name() + "\": \"" + asString(item.value) + (last ? "\"" : "\",");
     }
 
     json += " }";
@@ -0,0 +1,131 @@
+#include "data/rasterAtlas.h"
+
+#include "gl/glError.h"
+#include "gl/hardware.h"
+#include "gl/renderState.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+constexpr uint32_t RasterAtlas::MAX_ATLAS_SIZE;
+
+RasterAtlas::Slot::~Slot() {
+    atlas->release(*this);
+}
+
+std::shared_ptr<RasterAtlas> RasterAtlas::create(TextureOptions _options, glm::uvec2 _slotSize) {
+    if (_slotSize.x == 0 || _slotSize.x != _slotSize.y) { return nullptr; }
+
+    uint32_t size = std::min(MAX_ATLAS_SIZE, Hardware::maxTextureSize);
+    uint32_t slotsPerSide = size / _slotSize.x;
+
+    if (slotsPerSide < 2) { return nullptr; }
+
+    return std::make_shared<RasterAtlas>(_options, _slotSize, slotsPerSide);
+}
+
+RasterAtlas::RasterAtlas(TextureOptions _options, glm::uvec2 _slotSize, uint32_t _slotsPerSide)
+    : Texture(_slotSize.x * _slotsPerSide, _slotSize.y * _slotsPerSide, _options),
+      m_slotSize(_slotSize),
+      m_slotsPerSide(_slotsPerSide) {
+
+    // Hand out the first slots first
+    for (uint32_t i = _slotsPerSide * _slotsPerSide; i > 0; i--) {
+        m_freeSlots.push_back(i - 1);
+    }
+}
+
+bool RasterAtlas::accepts(const Texture& _raster) const {
+    auto& options = _raster.getOptions();
+
+    return _raster.getWidth() == m_slotSize.x && _raster.getHeight() == m_slotSize.y &&
+        _raster.pixels() != nullptr &&
+        options.internalFormat == m_options.internalFormat &&
+        options.format == m_options.format;
+}
+
+std::shared_ptr<RasterAtlas::Slot> RasterAtlas::add(const Texture& _raster) {
+    if (isFull() || !accepts(_raster)) { return nullptr; }
+
+    auto slot = std::make_shared<Slot>();
+    slot->atlas = shared_from_this();
+    slot->index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    m_usedSlots++;
+
+    // Map [0, 1] to the centers of the first and last texel of the slot
+    float size = m_width;
+    glm::vec2 origin = glm::vec2(slot->index % m_slotsPerSide, slot->index / m_slotsPerSide);
+    slot->uvTransform = glm::vec3((origin * float(m_slotSize.x) + 0.5f) / size,
+                                  (m_slotSize.x - 1.f) / size);
+
+    // Rows are copied as stored, sample top-down rasters from the last row up
+    if (_raster.topDown()) {
+        slot->uvTransform.y += slot->uvTransform.z;
+        slot->uvTransform.z = -slot->uvTransform.z;
+    }
+
+    const GLuint* pixels = _raster.pixels();
+    m_pending.push_back({ slot.get(), std::vector<GLuint>(pixels, pixels + m_slotSize.x * m_slotSize.y) });
+
+    return slot;
+}
+
+void RasterAtlas::release(Slot& _slot) {
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [&](auto& pending) { return pending.slot == &_slot; }),
+                    m_pending.end());
+
+    m_freeSlots.push_back(_slot.index);
+    m_usedSlots--;
+}
+
+void RasterAtlas::allocate(RenderState& rs, GLuint _textureUnit) {
+    if (m_shouldResize) {
+        // Allocates the texture storage without data
+        Texture::update(rs, _textureUnit, nullptr);
+    } else {
+        bind(rs, _textureUnit);
+    }
+}
+
+void RasterAtlas::upload(RenderState& rs, Slot& _slot) {
+    auto it = std::find_if(m_pending.begin(), m_pending.end(),
+                           [&](auto& pending) { return pending.slot == &_slot; });
+    if (it == m_pending.end()) { return; }
+
+    allocate(rs, 0);
+
+    GL::texSubImage2D(m_target, 0,
+                      (_slot.index % m_slotsPerSide) * m_slotSize.x,
+                      (_slot.index / m_slotsPerSide) * m_slotSize.y,
+                      m_slotSize.x, m_slotSize.y,
+                      m_options.format, GL_UNSIGNED_BYTE, it->pixels.data());
+
+    _slot.uploaded = true;
+    m_pending.erase(it);
+}
+
+void RasterAtlas::update(RenderState& rs, GLuint _textureUnit) {
+    if (!m_shouldResize && m_pending.empty()) { return; }
+
+    allocate(rs, _textureUnit);
+
+    for (auto& pending : m_pending) {
+        auto& slot = *pending.slot;
+        GL::texSubImage2D(m_target, 0,
+                          (slot.index % m_slotsPerSide) * m_slotSize.x,
+                          (slot.index / m_slotsPerSide) * m_slotSize.y,
+                          m_slotSize.x, m_slotSize.y,
+                          m_options.format, GL_UNSIGNED_BYTE, pending.pixels.data());
+        slot.uploaded = true;
+    }
+    m_pending.clear();
+}
+
+bool RasterAtlas::isUploaded() const {
+    return Texture::isUploaded() && m_pending.empty();
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "gl/texture.h"
+
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include <memory>
+#include <vector>
+
+namespace Tangram {
+
+/* Texture that packs raster tiles of one size into a grid of slots
+ *
+ * Tiles sharing an atlas bind the same texture; a Slot is released when the
+ * last Raster referencing it goes away, i.e. when its tiles are evicted from
+ * the TileSet and TileCache. Slots are inset by half a texel so that linear
+ * filtering doesn't bleed between neighbours, which also means an atlas
+ * can't be used with mipmaps or repeat wrapping.
+ */
+class RasterAtlas : public Texture, public std::enable_shared_from_this<RasterAtlas> {
+
+public:
+
+    struct Slot {
+        std::shared_ptr<RasterAtlas> atlas;
+        uint32_t index;
+        // Transform from raster to atlas texture coordinates: uv * z + xy,
+        // with a negative z flipping v of top-down rasters: uv * (|z|, z) + xy
+        glm::vec3 uvTransform;
+        bool uploaded = false;
+
+        ~Slot();
+    };
+
+    /* Create an atlas for rasters of _slotSize that holds at least two slots
+     * within Hardware::maxTextureSize, or nullptr if none fits */
+    static std::shared_ptr<RasterAtlas> create(TextureOptions _options, glm::uvec2 _slotSize);
+
+    RasterAtlas(TextureOptions _options, glm::uvec2 _slotSize, uint32_t _slotsPerSide);
+
+    /* Returns true when the decoded pixels of _raster can be copied into this atlas */
+    bool accepts(const Texture& _raster) const;
+
+    /* Copy the decoded pixels of _raster into a free slot, to be uploaded
+     * with upload() or update(). Returns nullptr when the atlas is full */
+    std::shared_ptr<Slot> add(const Texture& _raster);
+
+    /* Upload the pending pixels of _slot */
+    void upload(RenderState& rs, Slot& _slot);
+
+    /* Allocate the atlas and upload all pending slots */
+    void update(RenderState& rs, GLuint _textureUnit) override;
+
+    bool isUploaded() const override;
+
+    bool isFull() const { return m_freeSlots.empty(); }
+    bool isEmpty() const { return m_usedSlots == 0; }
+
+    glm::uvec2 slotSize() const { return m_slotSize; }
+
+    /* Bytes of one slot */
+    size_t slotBufferSize() const { return m_slotSize.x * m_slotSize.y * sizeof(GLuint); }
+
+    // Edge length of an atlas texture, less when the hardware limits it
+    static constexpr uint32_t MAX_ATLAS_SIZE = 2048;
+
+private:
+
+    void release(Slot& _slot);
+
+    void allocate(RenderState& rs, GLuint _textureUnit);
+
+    glm::uvec2 m_slotSize;
+    uint32_t m_slotsPerSide;
+
+    std::vector<uint32_t> m_freeSlots;
+    size_t m_usedSlots = 0;
+
+    struct Pending {
+        Slot* slot;
+        std::vector<GLuint> pixels;
+    };
+    std::vector<Pending> m_pending;
+};
+
+}
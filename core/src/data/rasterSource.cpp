@@ -1,11 +1,15 @@
 #include "data/rasterSource.h"
 #include "data/propertyItem.h"
 #include "data/tileData.h"
+#include "debug/tileTrace.h"
 #include "tile/tile.h"
 #include "tile/tileTask.h"
 #include "util/mapProjection.h"
+#include "util/memoryReport.h"
 #include "platform.h"
 
+#include <algorithm>
+
 namespace Tangram {
 
 class RasterTileTask : public BinaryTileTask {
@@ -16,7 +20,7 @@ public:
     std::shared_ptr<Texture> m_texture;
 
     bool hasData() const override {
-        return bool(rawTileData) || bool(m_texture);
+        return !rawTileData.empty() || bool(m_texture);
     }
 
     bool isReady() const override {
@@ -32,8 +36,10 @@ public:
         auto source = reinterpret_cast<RasterSource*>(m_source.get());
 
         if (!m_texture) {
-            // Decode texture data
-            m_texture = source->createTexture(*rawTileData);
+            TILE_TRACE_SPAN("decode", m_tileId, m_source->id());
+            // Decode texture data, an empty texture if it isn't valid
+            inflateRawTileData();
+            m_texture = source->createTexture(rawTileData);
         }
 
         // Create tile geometries
@@ -52,38 +58,41 @@ public:
 
         for (auto& subTask : m_subTasks) {
             assert(subTask->isReady());
-            subTask->complete(*this);
+            subTask->complete(*m_tile);
         }
     }
 
-    void complete(TileTask& _mainTask) override {
+    void complete(Tile& _tile) override {
         auto source = reinterpret_cast<RasterSource*>(m_source.get());
 
         auto raster = source->getRaster(*this);
         assert(raster.isValid());
 
-        _mainTask.tile()->rasters().push_back(std::move(raster));
+        _tile.rasters().push_back(std::move(raster));
     }
 };
 
 
 RasterSource::RasterSource(const std::string& _name, std::unique_ptr<DataSource> _sources,
                            TextureOptions _options, TileSource::ZoomOptions _zoomOptions,
-                           bool _genMipmap)
+                           bool _genMipmap, bool _useAtlas)
     : TileSource(_name, std::move(_sources), _zoomOptions),
       m_texOptions(_options),
-      m_genMipmap(_genMipmap) {
+      m_genMipmap(_genMipmap),
+      m_useAtlas(_useAtlas && !_genMipmap && !Texture::isRepeatWrapping(_options.wrapping)) {
 
     std::vector<char> data = {};
     m_emptyTexture = std::make_shared<Texture>(data, m_texOptions, m_genMipmap);
 }
 
-std::shared_ptr<Texture> RasterSource::createTexture(const std::vector<char>& _rawTileData) {
+std::shared_ptr<Texture> RasterSource::createTexture(const ByteBuffer& _rawTileData) {
     if (_rawTileData.size() == 0) {
         return m_emptyTexture;
     }
 
-    auto texture = std::make_shared<Texture>(_rawTileData, m_texOptions, m_genMipmap);
+    auto texture = std::make_shared<Texture>(0u, 0u, m_texOptions, m_genMipmap);
+    // Keep the decoded rows top-down, rasters are sampled with flipped coordinates
+    texture->loadImageFromMemory(_rawTileData.data(), _rawTileData.size(), false);
 
     return texture;
 }
@@ -135,7 +144,7 @@ std::shared_ptr<TileTask> RasterSource::createTask(TileID _tileId, int _subTask)
 
         auto texIt = m_textures.find(id);
         if (texIt != m_textures.end()) {
-            task->m_texture = texIt->second;
+            task->m_texture = texIt->second.texture;
 
             // No more loading needed.
             task->startedLoading();
@@ -153,21 +162,72 @@ Raster RasterSource::getRaster(const TileTask& _task) {
 
     auto texIt = m_textures.find(id);
     if (texIt != m_textures.end()) {
-        return { id, texIt->second };
+        return { id, texIt->second.texture, texIt->second.slot };
     }
 
     auto& task = static_cast<const RasterTileTask&>(_task);
-    m_textures.emplace(id, task.m_texture);
+
+    if (m_useAtlas && task.m_texture != m_emptyTexture) {
+        if (auto slot = addToAtlas(*task.m_texture)) {
+            m_textures.emplace(id, CachedRaster{ slot->atlas, slot });
+            return { id, slot->atlas, slot };
+        }
+    }
+
+    m_textures.emplace(id, CachedRaster{ task.m_texture, nullptr });
 
     return { id, task.m_texture };
 }
 
+Raster RasterSource::parentRaster(const TileID& _tile, int _maxLevels) const {
+    TileID id(_tile.x, _tile.y, _tile.z);
+
+    for (int level = 0; level < _maxLevels && id.z > 0; level++) {
+        id = id.getParent();
+
+        auto texIt = m_textures.find(id);
+        if (texIt == m_textures.end()) { continue; }
+
+        // The parent is missing as well
+        if (texIt->second.texture == m_emptyTexture) { break; }
+
+        return { id, texIt->second.texture, texIt->second.slot };
+    }
+    return { _tile, nullptr };
+}
+
+std::shared_ptr<RasterAtlas::Slot> RasterSource::addToAtlas(const Texture& _texture) {
+    std::shared_ptr<RasterAtlas> target;
+
+    for (auto& atlas : m_atlases) {
+        if (!atlas->isFull() && atlas->accepts(_texture)) {
+            target = atlas;
+            break;
+        }
+    }
+
+    // Drop atlases of evicted rasters, but keep one to fill
+    m_atlases.erase(std::remove_if(m_atlases.begin(), m_atlases.end(), [&](auto& atlas) {
+                return atlas->isEmpty() && atlas != target;
+            }), m_atlases.end());
+
+    if (!target) {
+        target = RasterAtlas::create(m_texOptions, { _texture.getWidth(), _texture.getHeight() });
+        if (!target || !target->accepts(_texture)) { return nullptr; }
+
+        m_atlases.push_back(target);
+    }
+
+    return target->add(_texture);
+}
+
 void RasterSource::clearRasters() {
     for (auto& raster: m_rasterSources) {
         raster->clearRasters();
     }
 
     m_textures.clear();
+    m_atlases.clear();
 }
 
 void RasterSource::clearRaster(const TileID &tileID) {
@@ -187,4 +247,42 @@ void RasterSource::clearRaster(const TileID &tileID) {
     }
 }
 
+void RasterSource::reportMemory(MemoryReport& _report) const {
+    TileSource::reportMemory(_report);
+
+    // Atlases are counted once, whichever of their rasters comes first
+    for (auto& raster : m_textures) {
+        if (raster.second.texture && raster.second.texture != m_emptyTexture) {
+            _report.addTexture(_report.stats.rasters, *raster.second.texture);
+        }
+    }
+    for (auto& atlas : m_atlases) {
+        _report.addTexture(_report.stats.rasters, *atlas);
+    }
+}
+
+size_t RasterSource::releaseUnusedRasters() {
+    size_t freed = 0;
+
+    for (auto it = m_textures.begin(); it != m_textures.end();) {
+        if (it->second.use_count() > 1) {
+            ++it;
+            continue;
+        }
+        // Atlas slots free their atlas once all of them are gone
+        if (!it->second.slot && it->second.texture && it->second.texture != m_emptyTexture) {
+            freed += it->second.texture->memoryUsage().total();
+        }
+        it = m_textures.erase(it);
+    }
+
+    m_atlases.erase(std::remove_if(m_atlases.begin(), m_atlases.end(), [&](auto& atlas) {
+                if (!atlas->isEmpty()) { return false; }
+                freed += atlas->memoryUsage().total();
+                return true;
+            }), m_atlases.end());
+
+    return freed;
+}
+
 }
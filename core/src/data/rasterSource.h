@@ -1,5 +1,6 @@
 #pragma once
 
+#include "data/rasterAtlas.h"
 #include "data/tileSource.h"
 #include "gl/texture.h"
 #include "tile/tileTask.h"
@@ -17,7 +18,18 @@ class RasterSource : public TileSource {
 
     TextureOptions m_texOptions;
     bool m_genMipmap;
-    std::unordered_map<TileID, std::shared_ptr<Texture>> m_textures;
+    bool m_useAtlas;
+
+    struct CachedRaster {
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<RasterAtlas::Slot> slot;
+
+        long use_count() const { return slot ? slot.use_count() : texture.use_count(); }
+    };
+    TileIDMap<CachedRaster> m_textures;
+
+    // Atlases that rasters of this source are packed into
+    std::vector<std::shared_ptr<RasterAtlas>> m_atlases;
 
     std::shared_ptr<Texture> m_emptyTexture;
 
@@ -28,9 +40,11 @@ protected:
 
 public:
 
+    /* With _useAtlas, decoded raster tiles are packed into shared RasterAtlas
+     * textures. Ignored with mipmaps or repeat wrapping. */
     RasterSource(const std::string& _name, std::unique_ptr<DataSource> _sources,
                  TextureOptions _options, TileSource::ZoomOptions _zoomOptions = {},
-                 bool genMipmap = false);
+                 bool genMipmap = false, bool _useAtlas = false);
 
     // TODO Is this always PNG or can it also be JPEG?
     virtual const char* mimeType() const override { return "image/png"; };
@@ -43,10 +57,22 @@ public:
     virtual void clearRaster(const TileID& id) override;
     virtual bool isRaster() const override { return true; }
 
-    std::shared_ptr<Texture> createTexture(const std::vector<char>& _rawTileData);
+    void reportMemory(MemoryReport& _report) const override;
+
+    size_t releaseUnusedRasters() override;
 
+    Raster parentRaster(const TileID& _tile, int _maxLevels) const override;
+
+    std::shared_ptr<Texture> createTexture(const ByteBuffer& _rawTileData);
+
+    /* Called on the main thread when a task completes. Packs the decoded
+     * texture of the task into an atlas when enabled. */
     Raster getRaster(const TileTask& _task);
 
+private:
+
+    std::shared_ptr<RasterAtlas::Slot> addToAtlas(const Texture& _texture);
+
 };
 
 }
@@ -0,0 +1,146 @@
+#include "data/tileData.h"
+
+namespace Tangram {
+
+void ColumnarLayer::getFeature(size_t _index, Feature& _feature) const {
+
+    const auto& feature = features[_index];
+
+    _feature.geometryType = feature.geometryType;
+
+    std::vector<Properties::Item> items;
+    items.reserve(feature.tagsEnd - feature.tagsBegin);
+    for (uint32_t i = feature.tagsBegin; i < feature.tagsEnd; i++) {
+        items.emplace_back(keys[tags[i].first], values[tags[i].second]);
+    }
+    _feature.props.setSorted(std::move(items));
+    _feature.props.sourceId = sourceId;
+
+    auto pos = coordinates.begin() + feature.coordinatesBegin;
+
+    switch (feature.geometryType) {
+        case GeometryType::points:
+            _feature.points.assign(pos, coordinates.begin() + feature.coordinatesEnd);
+            _feature.lines.clear();
+            _feature.polygons.clear();
+            break;
+
+        case GeometryType::lines: {
+            auto& lines = _feature.lines;
+            lines.resize(feature.partsEnd - feature.partsBegin);
+
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                uint32_t length = parts[i].length;
+                lines[i - feature.partsBegin].assign(pos, pos + length);
+                pos += length;
+            }
+            _feature.points.clear();
+            _feature.polygons.clear();
+            break;
+        }
+        case GeometryType::polygons: {
+            auto& polygons = _feature.polygons;
+
+            size_t numPolygons = 0;
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                if (parts[i].exterior) { numPolygons++; }
+            }
+            polygons.resize(numPolygons);
+
+            Polygon* polygon = nullptr;
+            size_t polygonIndex = 0;
+            size_t ring = 0;
+
+            for (uint32_t i = feature.partsBegin; i < feature.partsEnd; i++) {
+                if (parts[i].exterior) {
+                    if (polygon) { polygon->resize(ring); }
+                    polygon = &polygons[polygonIndex++];
+                    ring = 0;
+                }
+                if (polygon->size() <= ring) { polygon->emplace_back(); }
+
+                uint32_t length = parts[i].length;
+                (*polygon)[ring++].assign(pos, pos + length);
+                pos += length;
+            }
+            if (polygon) { polygon->resize(ring); }
+
+            _feature.points.clear();
+            _feature.lines.clear();
+            break;
+        }
+        default:
+            _feature.points.clear();
+            _feature.lines.clear();
+            _feature.polygons.clear();
+            break;
+    }
+}
+
+static size_t valueUsage(const Value& _value) {
+    if (_value.is<std::string>()) { return sizeof(Value) + _value.get<std::string>().capacity(); }
+    return sizeof(Value);
+}
+
+size_t TileData::memoryUsage() const {
+
+    size_t bytes = 0;
+
+    for (auto& layer : layers) {
+        bytes += sizeof(Layer) + layer.features.capacity() * sizeof(Feature);
+        for (auto& feature : layer.features) {
+            bytes += feature.points.capacity() * sizeof(Point);
+            for (auto& line : feature.lines) {
+                bytes += sizeof(Line) + line.capacity() * sizeof(Point);
+            }
+            for (auto& polygon : feature.polygons) {
+                bytes += sizeof(Polygon);
+                for (auto& ring : polygon) {
+                    bytes += sizeof(Line) + ring.capacity() * sizeof(Point);
+                }
+            }
+            for (auto& item : feature.props.items()) {
+                bytes += sizeof(PropertyItem) - sizeof(Value) + valueUsage(item.value);
+            }
+        }
+    }
+
+    for (auto& layer : columnarLayers) {
+        bytes += sizeof(ColumnarLayer);
+        bytes += layer.keys.capacity() * sizeof(PropertyKey);
+        for (auto& value : layer.values) { bytes += valueUsage(value); }
+        bytes += layer.tags.capacity() * sizeof(layer.tags[0]);
+        bytes += layer.coordinates.capacity() * sizeof(Point);
+        bytes += layer.parts.capacity() * sizeof(ColumnarLayer::Part);
+        bytes += layer.features.capacity() * sizeof(ColumnarLayer::FeatureRange);
+    }
+
+    for (auto& view : layerViews) { bytes += view->memoryUsage(); }
+
+    return bytes;
+}
+
+void TileData::readViews() {
+
+    if (layerViews.empty()) { return; }
+
+    // Views are styled before the layers, keep that order
+    std::vector<Layer> read;
+    read.reserve(layerViews.size() + layers.size());
+
+    for (auto& view : layerViews) {
+        read.emplace_back(view->name);
+        auto& features = read.back().features;
+
+        features.resize(view->size());
+        for (size_t i = 0; i < features.size(); i++) {
+            view->getFeature(i, features[i]);
+        }
+    }
+    layerViews.clear();
+
+    for (auto& layer : layers) { read.push_back(std::move(layer)); }
+    layers = std::move(read);
+}
+
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "data/properties.h"
+#include "data/propertyItem.h"
+#include "util/arena.h"
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -50,9 +54,22 @@ Data heirarchy:
 
   A <Point> is 2 32-bit floating point coordinates representing x and y.
 
+  A <ColumnarLayer> is an alternative to <Layer> with the same content: The
+  geometry of all its features is stored in one coordinate buffer and feature
+  properties are index pairs into the layer's tables of keys and values. A
+  feature is read into a reusable <Feature> with <ColumnarLayer::getFeature>.
+  The columns are allocated from the current <Arena> of the tile worker.
+
+  A <LayerView> reads features on demand, like a <ColumnarLayer>, from storage
+  that outlives the parse, e.g. the tile index of a client source. Its features
+  refer to shared properties and it has to be read into a <Layer> before its
+  geometry can be changed, see <TileData::readViews>.
+
 */
 namespace Tangram {
 
+struct FeatureFilter;
+
 enum GeometryType {
     unknown,
     points,
@@ -89,10 +106,84 @@ struct Layer {
 
 };
 
+struct ColumnarLayer {
+
+    ColumnarLayer(const std::string& _name, int32_t _sourceId)
+        : name(_name), sourceId(_sourceId) {}
+
+    // Line or polygon ring of a feature
+    struct Part {
+        uint32_t length;
+        // True for the exterior ring of a polygon
+        bool exterior;
+    };
+
+    // Ranges in tags, parts and coordinates
+    struct FeatureRange {
+        GeometryType geometryType;
+        uint32_t tagsBegin, tagsEnd;
+        uint32_t partsBegin, partsEnd;
+        uint32_t coordinatesBegin, coordinatesEnd;
+    };
+
+    std::string name;
+    int32_t sourceId;
+
+    // Interned property keys and values
+    std::vector<PropertyKey> keys;
+    std::vector<Value> values;
+
+    // Key and value indices of feature properties in key order
+    ArenaVector<std::pair<uint32_t, uint32_t>> tags;
+
+    ArenaVector<Point> coordinates;
+    ArenaVector<Part> parts;
+    ArenaVector<FeatureRange> features;
+
+    /* Fill _feature with the feature at _index. Geometry containers of
+     * _feature are reused, so that reading all features of a layer into
+     * the same <Feature> does not allocate once its capacity suffices.
+     */
+    void getFeature(size_t _index, Feature& _feature) const;
+};
+
+struct LayerView {
+
+    LayerView(const std::string& _name, int32_t _sourceId)
+        : name(_name), sourceId(_sourceId) {}
+
+    virtual ~LayerView() {}
+
+    std::string name;
+    int32_t sourceId;
+
+    virtual size_t size() const = 0;
+
+    // Fill _feature with the feature at _index, see ColumnarLayer::getFeature
+    virtual void getFeature(size_t _index, Feature& _feature) const = 0;
+
+    // Approximate heap bytes that only the view holds
+    virtual size_t memoryUsage() const { return sizeof(*this); }
+};
+
 struct TileData {
 
     std::vector<Layer> layers;
 
+    std::vector<ColumnarLayer> columnarLayers;
+
+    std::vector<std::shared_ptr<const LayerView>> layerViews;
+
+    // Filter the features were parsed with, null when the data holds all features
+    std::shared_ptr<const FeatureFilter> featureFilter;
+
+    // Approximate heap bytes of layers and features
+    size_t memoryUsage() const;
+
+    // Copy the features of layerViews into layers, for passes that change the
+    // geometry of features in place
+    void readViews();
+
 };
 
 }
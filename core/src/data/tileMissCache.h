@@ -0,0 +1,146 @@
+#pragma once
+
+#include "tile/tileHash.h"
+#include "tile/tileID.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Tangram {
+
+/* Tiles that a data source does not have, e.g. tiles over oceans which a
+ * server answers with 404 or which are not stored in an MBTiles file. They
+ * are remembered for a while so that each pan does not request them again.
+ *
+ * Holds up to _maxEntries tiles, the oldest entries are dropped first.
+ */
+class TileMissCache {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    TileMissCache(size_t _maxEntries, Clock::duration _ttl)
+        : m_maxEntries(_maxEntries), m_ttl(_ttl) {}
+
+    /* Remember _tile as missing for _ttl, or the default TTL when _ttl is zero */
+    void add(const TileID& _tile, Clock::duration _ttl = Clock::duration::zero(),
+             Clock::time_point _now = Clock::now()) {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto key = _tile.withWrap(0);
+        auto& entry = m_misses[key];
+        entry.expires = _now + (_ttl > Clock::duration::zero() ? _ttl : m_ttl);
+        entry.serial = ++m_serial;
+        m_order.emplace_back(key, entry.serial);
+
+        while (m_misses.size() > m_maxEntries || m_order.size() > 2 * m_maxEntries) {
+            auto& oldest = m_order.front();
+            auto it = m_misses.find(oldest.first);
+            // Entries that were added again have a newer position
+            if (it != m_misses.end() && it->second.serial == oldest.second) { m_misses.erase(it); }
+            m_order.pop_front();
+        }
+    }
+
+    bool contains(const TileID& _tile, Clock::time_point _now = Clock::now()) {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_misses.find(_tile.withWrap(0));
+        if (it == m_misses.end()) { return false; }
+
+        if (it->second.expires <= _now) {
+            m_misses.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    /* Forget _tile, e.g. once it was stored */
+    void remove(const TileID& _tile) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_misses.erase(_tile.withWrap(0));
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_misses.clear();
+        m_order.clear();
+    }
+
+    size_t size() const { return m_misses.size(); }
+
+private:
+
+    struct Entry {
+        Clock::time_point expires;
+        uint64_t serial = 0;
+    };
+
+    TileIDMap<Entry> m_misses;
+    // Insertion order, with the serial of the entry at the time
+    std::deque<std::pair<TileID, uint64_t>> m_order;
+    uint64_t m_serial = 0;
+
+    size_t m_maxEntries;
+    Clock::duration m_ttl;
+
+    std::mutex m_mutex;
+};
+
+/* Exponential backoff of requests to hosts that failed to respond. The delay
+ * starts at _minDelay, doubles with each further failure up to _maxDelay and
+ * is reset by the next response of the host.
+ */
+class HostBackoff {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    HostBackoff(Clock::duration _minDelay, Clock::duration _maxDelay)
+        : m_minDelay(_minDelay), m_maxDelay(_maxDelay) {}
+
+    /* Whether requests to _host wait for the delay after its last failure */
+    bool isBackingOff(const std::string& _host, Clock::time_point _now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_hosts.find(_host);
+        return it != m_hosts.end() && _now < it->second.retry;
+    }
+
+    void failed(const std::string& _host, Clock::time_point _now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& host = m_hosts[_host];
+        host.delay = host.failures == 0 ? m_minDelay : std::min(host.delay * 2, m_maxDelay);
+        host.failures++;
+        host.retry = _now + host.delay;
+    }
+
+    void succeeded(const std::string& _host) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hosts.erase(_host);
+    }
+
+private:
+
+    struct Host {
+        Clock::time_point retry;
+        Clock::duration delay = Clock::duration::zero();
+        uint32_t failures = 0;
+    };
+
+    std::unordered_map<std::string, Host> m_hosts;
+
+    Clock::duration m_minDelay;
+    Clock::duration m_maxDelay;
+
+    std::mutex m_mutex;
+};
+
+}
@@ -4,12 +4,15 @@
 #include "data/formats/mvt.h"
 #include "data/formats/topoJson.h"
 #include "data/tileData.h"
+#include "debug/tileTrace.h"
 #include "platform.h"
+#include "tile/builtTileCache.h"
 #include "tile/tileID.h"
 #include "tile/tile.h"
 #include "tile/tileTask.h"
 #include "log.h"
 #include "util/geom.h"
+#include "util/memoryReport.h"
 
 #include <atomic>
 #include <functional>
@@ -50,6 +53,7 @@ const char* TileSource::mimeType() const {
     case Format::GeoJson: return "application/geo+json";
     case Format::TopoJson: return "application/topo+json";
     case Format::Mvt: return "application/vnd.mapbox-vector-tile";
+    case Format::Mesh: return "application/vnd.tangram.mesh-tile";
     }
     assert(false);
     return "";
@@ -78,6 +82,10 @@ void TileSource::createSubTasks(std::shared_ptr<TileTask> _task) {
     }
 }
 
+Raster TileSource::parentRaster(const TileID& _tile, int _maxLevels) const {
+    return { _tile, nullptr };
+}
+
 void TileSource::clearData() {
 
     if (m_sources) { m_sources->clear(); }
@@ -85,12 +93,36 @@ void TileSource::clearData() {
     m_generation++;
 }
 
+bool TileSource::canReuseTileData(const TileSource& _previous) const {
+    // Parsed data depends on the loaded data and on how it is parsed and clipped
+    return m_retainTileData && _previous.m_retainTileData &&
+        !isRaster() && !_previous.isRaster() &&
+        !m_dataKey.empty() && m_dataKey == _previous.m_dataKey &&
+        m_name == _previous.m_name &&
+        m_format == _previous.m_format &&
+        m_clipBuffer == _previous.m_clipBuffer &&
+        m_zoomOptions.maxZoom == _previous.m_zoomOptions.maxZoom;
+}
+
 void TileSource::loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) {
 
     if (m_sources) {
-        if (_task->needsLoading()) {
+        auto binaryTask = dynamic_cast<BinaryTileTask*>(_task.get());
+
+        if (_task->needsLoading() && binaryTask && m_builtTileCache &&
+            _task->subTasks().empty() && m_builtTileCache->has(_task->tileId())) {
+            // Restored on a worker, which loads the tile data when the file is stale
+            TILE_TRACE_BEGIN("load", _task->tileId(), m_id);
+            binaryTask->fromBuiltTileCache = true;
+            _task->startedLoading();
+            _cb.func(_task);
+
+        } else if (_task->needsLoading()) {
+            TILE_TRACE_BEGIN("load", _task->tileId(), m_id);
             if (m_sources->loadTileData(_task, _cb)) {
                 _task->startedLoading();
+            } else {
+                TILE_TRACE_END("load", _task->tileId(), m_id);
             }
         } else if(_task->hasData()) {
             _cb.func(_task);
@@ -107,6 +139,8 @@ std::shared_ptr<TileData> TileSource::parse(const TileTask& _task, const MapProj
     case Format::TopoJson: return TopoJson::parseTile(_task, _projection, m_id);
     case Format::GeoJson: return GeoJson::parseTile(_task, _projection, m_id);
     case Format::Mvt: return Mvt::parseTile(_task, _projection, m_id);
+    // Decoded into meshes by BinaryTileTask, without tile data
+    case Format::Mesh: return nullptr;
     }
     assert(false);
     return nullptr;
@@ -135,6 +169,10 @@ void TileSource::clearRaster(const TileID& id) {
     }
 }
 
+void TileSource::reportMemory(MemoryReport& _report) const {
+    if (m_sources) { m_sources->reportMemory(_report); }
+}
+
 void TileSource::addRasterSource(std::shared_ptr<TileSource> _rasterSource) {
     /*
      * We limit the parent source by any attached raster source's min/max.
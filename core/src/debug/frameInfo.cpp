@@ -1,104 +1,34 @@
 #include "debug/frameInfo.h"
 
+#include "debug/performanceMonitor.h"
 #include "debug/textDisplay.h"
 #include "gl.h"
 #include "gl/glError.h"
 #include "gl/primitives.h"
+#include "gl/renderState.h"
 #include "map.h"
 #include "tile/tileManager.h"
 #include "tile/tile.h"
 #include "tile/tileCache.h"
 #include "view/view.h"
 
-#include <deque>
-#include <ctime>
-
-#define TIME_TO_MS(start, end) (float(end - start) / CLOCKS_PER_SEC * 1000.0f)
-
-#define DEBUG_STATS_MAX_SIZE 128
+#include <algorithm>
 
 namespace Tangram {
 
-static float s_lastUpdateTime = 0.0;
-
-static clock_t s_startFrameTime = 0,
-    s_endFrameTime = 0,
-    s_startUpdateTime = 0,
-    s_endUpdateTime = 0;
-
-void FrameInfo::beginUpdate() {
-
-    if (getDebugFlag(DebugFlags::tangram_infos) || getDebugFlag(DebugFlags::tangram_stats)) {
-        s_startUpdateTime = clock();
-    }
-
-}
-
-void FrameInfo::endUpdate() {
+void FrameInfo::draw(RenderState& rs, const View& _view, TileManager& _tileManager,
+                     const PerformanceMonitor& _monitor) {
 
     if (getDebugFlag(DebugFlags::tangram_infos) || getDebugFlag(DebugFlags::tangram_stats)) {
-        s_endUpdateTime = clock();
-        s_lastUpdateTime = TIME_TO_MS(s_startUpdateTime, s_endUpdateTime);
-    }
-
-}
-
-void FrameInfo::beginFrame() {
-
-    if (getDebugFlag(DebugFlags::tangram_infos) || getDebugFlag(DebugFlags::tangram_stats)) {
-        s_startFrameTime = clock();
-    }
-
-}
-
-
-void FrameInfo::draw(RenderState& rs, const View& _view, TileManager& _tileManager) {
-
-    if (getDebugFlag(DebugFlags::tangram_infos) || getDebugFlag(DebugFlags::tangram_stats)) {
-        static int cpt = 0;
-
-        static std::deque<float> updatetime;
-        static std::deque<float> rendertime;
-
-        clock_t endCpu = clock();
-        static float timeCpu[60] = { 0 };
-        static float timeUpdate[60] = { 0 };
-        static float timeRender[60] = { 0 };
-        timeCpu[cpt] = TIME_TO_MS(s_startFrameTime, endCpu);
-
-        if (updatetime.size() >= DEBUG_STATS_MAX_SIZE) {
-            updatetime.pop_front();
-        }
-        if (rendertime.size() >= DEBUG_STATS_MAX_SIZE) {
-            rendertime.pop_front();
-        }
-
-        rendertime.push_back(timeRender[cpt]);
-        updatetime.push_back(timeUpdate[cpt]);
 
         // Force opengl to finish commands (for accurate frame time)
         GL::finish();
 
-        s_endFrameTime = clock();
-        timeRender[cpt] = TIME_TO_MS(s_startFrameTime, s_endFrameTime);
-
-        if (++cpt == 60) { cpt = 0; }
-
-        // Only compute average frame time every 60 frames
-        float avgTimeRender = 0.f;
-        float avgTimeCpu = 0.f;
-        float avgTimeUpdate = 0.f;
-
-        timeUpdate[cpt] = s_lastUpdateTime;
-
-        for (int i = 0; i < 60; i++) {
-            avgTimeRender += timeRender[i];
-            avgTimeCpu += timeCpu[i];
-            avgTimeUpdate += timeUpdate[i];
-        }
-        avgTimeRender /= 60;
-        avgTimeCpu /= 60;
-        avgTimeUpdate /= 60;
+        using Timer = PerformanceMonitor::Timer;
+        float avgTimeRender = _monitor.average(Timer::render);
+        float avgTimeUpdate = _monitor.average(Timer::update);
+        float avgTimeLabels = _monitor.average(Timer::labels);
+        float avgTimeUpload = _monitor.average(Timer::upload);
 
         size_t memused = 0;
         size_t features = 0;
@@ -117,9 +47,14 @@ void FrameInfo::draw(RenderState& rs, const View& _view, TileManager& _tileManag
             debuginfos.push_back("tile cache size:"
                                  + std::to_string(_tileManager.getTileCache()->getMemoryUsage() / 1024) + "kb");
             debuginfos.push_back("tile size:" + std::to_string(memused / 1024) + "kb");
-            debuginfos.push_back("avg frame cpu time:" + to_string_with_precision(avgTimeCpu, 2) + "ms");
+            debuginfos.push_back("upload:" + std::to_string(_tileManager.uploadedBytes() / 1024) + "kb"
+                                 + (_tileManager.hasPendingUploads() ? " (pending)" : ""));
+            debuginfos.push_back("draw calls:" + std::to_string(rs.frameStats().drawCalls));
+            debuginfos.push_back("state changes:" + std::to_string(rs.frameStats().stateChanges));
             debuginfos.push_back("avg frame render time:" + to_string_with_precision(avgTimeRender, 2) + "ms");
             debuginfos.push_back("avg frame update time:" + to_string_with_precision(avgTimeUpdate, 2) + "ms");
+            debuginfos.push_back("avg label time:" + to_string_with_precision(avgTimeLabels, 2) + "ms");
+            debuginfos.push_back("avg upload time:" + to_string_with_precision(avgTimeUpload, 2) + "ms");
             debuginfos.push_back("zoom:" + std::to_string(_view.getZoom()));
             debuginfos.push_back("pos:" + std::to_string(_view.getPosition().x) + "/"
                                  + std::to_string(_view.getPosition().y));
@@ -132,7 +67,10 @@ void FrameInfo::draw(RenderState& rs, const View& _view, TileManager& _tileManag
         if (getDebugFlag(DebugFlags::tangram_stats)) {
             const int scale = 5 * _view.pixelScale();
 
-            for (size_t i = 0; i < updatetime.size(); i++) {
+            auto updatetime = _monitor.samples(Timer::update);
+            auto rendertime = _monitor.samples(Timer::render);
+
+            for (size_t i = 0; i < std::min(updatetime.size(), rendertime.size()); i++) {
                 float tupdate = updatetime[i] * scale;
                 float trender = rendertime[i] * scale;
                 float offsetx = i * 4 * _view.pixelScale();
@@ -146,7 +84,7 @@ void FrameInfo::draw(RenderState& rs, const View& _view, TileManager& _tileManag
             // Draw 16.6ms horizontal line
             Primitives::setColor(rs, 0xff0000);
             Primitives::drawLine(rs, glm::vec2(0.0, 16.6 * scale),
-                glm::vec2(DEBUG_STATS_MAX_SIZE * 4 * _view.pixelScale() + 4, 16.6 * scale));
+                glm::vec2(PerformanceMonitor::windowSize * 4 * _view.pixelScale() + 4, 16.6 * scale));
         }
     }
 }
@@ -2,18 +2,16 @@
 
 namespace Tangram {
 
+class PerformanceMonitor;
 class RenderState;
 class TileManager;
 class View;
 
 struct FrameInfo {
 
-    static void beginUpdate();
-    static void beginFrame();
-
-    static void endUpdate();
-
-    static void draw(RenderState& rs, const View& _view, TileManager& _tileManager);
+    // Draws the timings of _monitor when the info or stats debug flags are set
+    static void draw(RenderState& rs, const View& _view, TileManager& _tileManager,
+                     const PerformanceMonitor& _monitor);
 };
 
 }
@@ -0,0 +1,87 @@
+#include "debug/performanceMonitor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tangram {
+
+void TimingWindow::add(float _milliseconds) {
+    m_ms[m_next] = _milliseconds;
+    m_next = (m_next + 1) % size;
+    m_count = std::min(m_count + 1, size);
+}
+
+std::vector<float> TimingWindow::samples() const {
+    std::vector<float> result;
+    result.reserve(m_count);
+
+    size_t first = (m_next + size - m_count) % size;
+    for (size_t i = 0; i < m_count; i++) {
+        result.push_back(m_ms[(first + i) % size]);
+    }
+    return result;
+}
+
+PerformanceTiming TimingWindow::timing() const {
+    PerformanceTiming result;
+    if (m_count == 0) { return result; }
+
+    std::vector<float> values(m_ms.begin(), m_ms.begin() + m_count);
+    std::sort(values.begin(), values.end());
+
+    // Nearest-rank percentile
+    auto percentile = [&](float _p) {
+        size_t rank = std::ceil(_p * values.size());
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+    result.p50 = percentile(0.5f);
+    result.p90 = percentile(0.9f);
+    result.p99 = percentile(0.99f);
+    result.max = values.back();
+
+    return result;
+}
+
+float TimingWindow::average() const {
+    if (m_count == 0) { return 0; }
+
+    float sum = 0;
+    for (size_t i = 0; i < m_count; i++) { sum += m_ms[i]; }
+    return sum / m_count;
+}
+
+void PerformanceMonitor::record(Timer _timer, Clock::time_point _start) {
+    std::chrono::duration<float, std::milli> elapsed = Clock::now() - _start;
+    addSample(_timer, elapsed.count());
+}
+
+void PerformanceMonitor::addSample(Timer _timer, float _milliseconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_windows[size_t(_timer)].add(_milliseconds);
+}
+
+std::vector<float> PerformanceMonitor::samples(Timer _timer) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_windows[size_t(_timer)].samples();
+}
+
+uint32_t PerformanceMonitor::count(Timer _timer) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_windows[size_t(_timer)].count();
+}
+
+PerformanceTiming PerformanceMonitor::timing(Timer _timer) const {
+    TimingWindow window;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        window = m_windows[size_t(_timer)];
+    }
+    return window.timing();
+}
+
+float PerformanceMonitor::average(Timer _timer) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_windows[size_t(_timer)].average();
+}
+
+}
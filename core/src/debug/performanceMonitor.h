@@ -0,0 +1,83 @@
+#pragma once
+
+#include "map.h"
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace Tangram {
+
+/* Ring buffer of the most recent samples of one timing, not synchronized */
+class TimingWindow {
+
+public:
+
+    static constexpr size_t size = 128;
+
+    void add(float _milliseconds);
+
+    PerformanceTiming timing() const;
+
+    float average() const;
+
+    // Samples, oldest first
+    std::vector<float> samples() const;
+
+    uint32_t count() const { return m_count; }
+
+private:
+
+    std::array<float, size> m_ms{};
+    size_t m_count = 0;
+    size_t m_next = 0;
+};
+
+/* Rolling window of wall-clock frame timings
+ *
+ * Samples are written on the render thread and may be read from any thread.
+ * Recording one is a clock read and a short locked store, percentiles are
+ * only computed when they are requested.
+ */
+class PerformanceMonitor {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class Timer : uint8_t {
+        update = 0,
+        render,
+        labels,
+        upload,
+        count,
+    };
+
+    static constexpr size_t windowSize = TimingWindow::size;
+
+    static Clock::time_point now() { return Clock::now(); }
+
+    // Adds the time from _start until now to the samples of _timer
+    void record(Timer _timer, Clock::time_point _start);
+
+    void addSample(Timer _timer, float _milliseconds);
+
+    PerformanceTiming timing(Timer _timer) const;
+
+    float average(Timer _timer) const;
+
+    // Samples of _timer, oldest first
+    std::vector<float> samples(Timer _timer) const;
+
+    // Number of samples in the window of _timer
+    uint32_t count(Timer _timer) const;
+
+private:
+
+    std::array<TimingWindow, size_t(Timer::count)> m_windows;
+
+    mutable std::mutex m_mutex;
+};
+
+}
@@ -0,0 +1,370 @@
+#include "debug/sessionRecorder.h"
+
+#include "log.h"
+#include "map.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+namespace Tangram {
+
+static double millisSince(SessionRecorder::Clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(SessionRecorder::Clock::now() - _start).count();
+}
+
+void SessionRecorder::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+    m_start = Clock::now();
+    m_recording = true;
+}
+
+void SessionRecorder::stop() {
+    m_recording = false;
+}
+
+void SessionRecorder::add(const char* _name, std::vector<std::string> _args) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_recording) { return; }
+
+    SessionEvent event;
+    event.time = millisSince(m_start);
+    event.name = _name;
+    event.args = std::move(_args);
+    m_events.push_back(std::move(event));
+}
+
+std::vector<SessionEvent> SessionRecorder::events() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events;
+}
+
+std::string SessionRecorder::arg(double _value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", _value);
+    return buffer;
+}
+
+std::string SessionRecorder::arg(float _value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", _value);
+    return buffer;
+}
+
+// Each event is 'time name count' followed by ' length:bytes' per argument
+std::string SessionRecorder::serialize() const {
+    auto events = this->events();
+
+    std::string data;
+    for (auto& event : events) {
+        data += arg(event.time) + " " + event.name + " " + std::to_string(event.args.size());
+        for (auto& value : event.args) {
+            data += " " + std::to_string(value.size()) + ":";
+            data += value;
+        }
+        data += "\n";
+    }
+    return data;
+}
+
+bool SessionRecorder::parse(const std::string& _data, std::vector<SessionEvent>& _events) {
+    size_t pos = 0;
+
+    auto token = [&](char _delimiter, std::string& _token) {
+        size_t end = _data.find(_delimiter, pos);
+        if (end == std::string::npos) { return false; }
+        _token = _data.substr(pos, end - pos);
+        pos = end + 1;
+        return !_token.empty();
+    };
+
+    auto number = [](const std::string& _token, size_t& _value) {
+        if (_token.find_first_not_of("0123456789") != std::string::npos) { return false; }
+        _value = std::strtoull(_token.c_str(), nullptr, 10);
+        return true;
+    };
+
+    std::string field;
+    while (pos < _data.size()) {
+        SessionEvent event;
+        size_t count = 0;
+
+        if (!token(' ', field)) { return false; }
+        event.time = std::strtod(field.c_str(), nullptr);
+        if (!token(' ', event.name)) { return false; }
+
+        size_t end = _data.find_first_of(" \n", pos);
+        if (end == std::string::npos || !number(_data.substr(pos, end - pos), count)) { return false; }
+        pos = end;
+
+        for (size_t i = 0; i < count; i++) {
+            size_t length = 0;
+            if (_data[pos++] != ' ' || !token(':', field) || !number(field, length)) { return false; }
+            if (pos + length > _data.size()) { return false; }
+            event.args.push_back(_data.substr(pos, length));
+            pos += length;
+        }
+        if (pos >= _data.size() || _data[pos++] != '\n') { return false; }
+
+        _events.push_back(std::move(event));
+    }
+    return true;
+}
+
+RecordingPlatform::RecordingPlatform(std::shared_ptr<Platform> _platform,
+                                     std::shared_ptr<SessionRecorder> _recorder)
+    : m_platform(std::move(_platform)), m_recorder(std::move(_recorder)) {}
+
+void RecordingPlatform::requestRender() const {
+    m_platform->requestRender();
+}
+
+void RecordingPlatform::setContinuousRendering(bool _isContinuous) {
+    m_platform->setContinuousRendering(_isContinuous);
+}
+
+bool RecordingPlatform::isContinuousRendering() const {
+    return m_platform->isContinuousRendering();
+}
+
+UrlCallback RecordingPlatform::recordResponse(const Url& _url, UrlCallback _callback) {
+    auto recorder = m_recorder;
+    auto start = SessionRecorder::Clock::now();
+    std::string url = _url.string();
+
+    return [=](UrlResponse _response) {
+        recorder->record("response", url, millisSince(start), _response.error != nullptr,
+                         _response.error, _response.status, _response.etag, _response.lastModified,
+                         std::to_string(_response.maxAge),
+                         std::string(_response.content.begin(), _response.content.end()));
+        _callback(std::move(_response));
+    };
+}
+
+UrlRequestHandle RecordingPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+    if (!m_recorder->isRecording()) { return m_platform->startUrlRequest(_url, _callback); }
+
+    auto callback = recordResponse(_url, std::move(_callback));
+    return m_platform->startUrlRequest(_url, std::move(callback));
+}
+
+UrlRequestHandle RecordingPlatform::startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                               UrlCallback _callback) {
+    if (!m_recorder->isRecording()) {
+        return m_platform->startConditionalUrlRequest(_url, _validators, _callback);
+    }
+
+    auto callback = recordResponse(_url, std::move(_callback));
+    return m_platform->startConditionalUrlRequest(_url, _validators, std::move(callback));
+}
+
+UrlRequestHandle RecordingPlatform::startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                               double _priority, UrlCallback _callback) {
+    if (!m_recorder->isRecording()) {
+        return m_platform->startPrioritizedUrlRequest(_url, _validators, _priority, _callback);
+    }
+
+    auto callback = recordResponse(_url, std::move(_callback));
+    return m_platform->startPrioritizedUrlRequest(_url, _validators, _priority, std::move(callback));
+}
+
+void RecordingPlatform::cancelUrlRequest(UrlRequestHandle _request) {
+    m_platform->cancelUrlRequest(_request);
+}
+
+FontSourceHandle RecordingPlatform::systemFont(const std::string& _name, const std::string& _weight,
+                                               const std::string& _face) const {
+    return m_platform->systemFont(_name, _weight, _face);
+}
+
+std::vector<FontSourceHandle> RecordingPlatform::systemFontFallbacksHandle() const {
+    return m_platform->systemFontFallbacksHandle();
+}
+
+ThreadPolicy RecordingPlatform::threadPolicy(ThreadRole _role) const {
+    return m_platform->threadPolicy(_role);
+}
+
+PowerHint RecordingPlatform::powerHint() const {
+    return m_platform->powerHint();
+}
+
+ReplayPlatform::ReplayPlatform(const std::vector<SessionEvent>& _events) {
+    for (auto& event : _events) {
+        if (event.name != "response" || event.args.size() < 9) { continue; }
+
+        auto& args = event.args;
+        Response response;
+        response.latency = std::strtod(args[1].c_str(), nullptr);
+        response.failed = args[2] == "1";
+        response.error = args[3];
+        response.status = std::atoi(args[4].c_str());
+        response.etag = args[5];
+        response.lastModified = args[6];
+        response.maxAge = std::strtoll(args[7].c_str(), nullptr, 10);
+        response.content.assign(args[8].begin(), args[8].end());
+
+        m_responses[args[0]].push_back(std::move(response));
+    }
+}
+
+UrlRequestHandle ReplayPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Pending pending;
+    pending.handle = m_nextHandle++;
+    pending.callback = std::move(_callback);
+
+    auto it = m_responses.find(_url.string());
+    if (it == m_responses.end() || it->second.empty()) {
+        pending.response.failed = true;
+        pending.response.error = "No recorded response";
+        pending.due = m_time;
+        m_misses++;
+    } else {
+        pending.response = std::move(it->second.front());
+        pending.due = m_time + pending.response.latency;
+        it->second.pop_front();
+    }
+    m_pending.push_back(std::move(pending));
+
+    return m_pending.back().handle;
+}
+
+void ReplayPlatform::cancelUrlRequest(UrlRequestHandle _request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The callback runs with the next delivery, like on a platform that cancels asynchronously
+    for (auto& pending : m_pending) {
+        if (pending.handle != _request) { continue; }
+        pending.response.failed = true;
+        pending.response.error = "Request canceled";
+        pending.response.content.clear();
+        pending.due = m_time;
+        break;
+    }
+}
+
+void ReplayPlatform::deliverResponses(double _time) {
+    std::vector<Pending> due;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_time = std::max(m_time, _time);
+
+        auto it = std::stable_partition(m_pending.begin(), m_pending.end(),
+                                        [&](auto& _pending) { return _pending.due > m_time; });
+        std::move(it, m_pending.end(), std::back_inserter(due));
+        m_pending.erase(it, m_pending.end());
+    }
+    // Callbacks may start new requests
+    std::stable_sort(due.begin(), due.end(), [](auto& a, auto& b) { return a.due < b.due; });
+    for (auto& pending : due) { respond(pending); }
+}
+
+void ReplayPlatform::respond(Pending& _pending) {
+    auto& recorded = _pending.response;
+
+    UrlResponse response;
+    response.content = std::move(recorded.content);
+    response.error = recorded.failed ? recorded.error.c_str() : nullptr;
+    response.status = recorded.status;
+    response.etag = recorded.etag;
+    response.lastModified = recorded.lastModified;
+    response.maxAge = recorded.maxAge;
+
+    _pending.callback(std::move(response));
+}
+
+SessionPlayer::SessionPlayer(std::vector<SessionEvent> _events)
+    : m_events(std::move(_events)),
+      m_platform(std::make_shared<ReplayPlatform>(m_events)) {}
+
+bool SessionPlayer::step(Map& _map) {
+    while (m_next < m_events.size()) {
+        auto& event = m_events[m_next++];
+
+        m_platform->deliverResponses(event.time);
+        apply(_map, event);
+
+        if (event.name == "update") { return true; }
+    }
+    return false;
+}
+
+static std::vector<SceneUpdate> sceneUpdates(const std::vector<std::string>& _args, size_t _first) {
+    std::vector<SceneUpdate> updates;
+    for (size_t i = _first; i + 1 < _args.size(); i += 2) {
+        updates.emplace_back(_args[i], _args[i + 1]);
+    }
+    return updates;
+}
+
+void SessionPlayer::apply(Map& _map, const SessionEvent& _event) {
+    auto& name = _event.name;
+    auto& args = _event.args;
+
+    auto d = [&](size_t i) { return i < args.size() ? std::strtod(args[i].c_str(), nullptr) : 0.0; };
+    auto f = [&](size_t i) { return float(d(i)); };
+    auto ease = [&](size_t i) { return static_cast<EaseType>(std::atoi(args[i].c_str())); };
+    auto has = [&](size_t n) { return args.size() >= n; };
+
+    if (name == "response") {
+        // Served by the ReplayPlatform
+    } else if (name == "update" && has(1)) {
+        _map.update(f(0));
+    } else if (name == "resize" && has(2)) {
+        _map.resize(int(d(0)), int(d(1)));
+    } else if (name == "setPixelScale" && has(1)) {
+        _map.setPixelScale(f(0));
+    } else if (name == "loadScene" && has(2)) {
+        _map.loadScene(args[0], args[1] == "1", sceneUpdates(args, 2));
+    } else if (name == "loadSceneAsync" && has(2)) {
+        _map.loadSceneAsync(args[0], args[1] == "1", sceneUpdates(args, 2));
+    } else if (name == "loadSceneYaml" && has(3)) {
+        _map.loadSceneYaml(args[0], args[1], args[2] == "1", sceneUpdates(args, 3));
+    } else if (name == "loadSceneYamlAsync" && has(3)) {
+        _map.loadSceneYamlAsync(args[0], args[1], args[2] == "1", sceneUpdates(args, 3));
+    } else if (name == "updateSceneAsync") {
+        _map.updateSceneAsync(sceneUpdates(args, 0));
+    } else if (name == "setPosition" && has(2)) {
+        _map.setPosition(d(0), d(1));
+    } else if (name == "setPositionEased" && has(4)) {
+        _map.setPositionEased(d(0), d(1), f(2), ease(3));
+    } else if (name == "setZoom" && has(1)) {
+        _map.setZoom(f(0));
+    } else if (name == "setZoomEased" && has(3)) {
+        _map.setZoomEased(f(0), f(1), ease(2));
+    } else if (name == "flyTo" && has(5)) {
+        _map.flyTo(d(0), d(1), f(2), f(3), f(4));
+    } else if (name == "setRotation" && has(1)) {
+        _map.setRotation(f(0));
+    } else if (name == "setRotationEased" && has(3)) {
+        _map.setRotationEased(f(0), f(1), ease(2));
+    } else if (name == "setTilt" && has(1)) {
+        _map.setTilt(f(0));
+    } else if (name == "setTiltEased" && has(3)) {
+        _map.setTiltEased(f(0), f(1), ease(2));
+    } else if (name == "setCameraType" && has(1)) {
+        _map.setCameraType(int(d(0)));
+    } else if (name == "handleTapGesture" && has(2)) {
+        _map.handleTapGesture(f(0), f(1));
+    } else if (name == "handleDoubleTapGesture" && has(2)) {
+        _map.handleDoubleTapGesture(f(0), f(1));
+    } else if (name == "handlePanGesture" && has(4)) {
+        _map.handlePanGesture(f(0), f(1), f(2), f(3));
+    } else if (name == "handleFlingGesture" && has(4)) {
+        _map.handleFlingGesture(f(0), f(1), f(2), f(3));
+    } else if (name == "handlePinchGesture" && has(4)) {
+        _map.handlePinchGesture(f(0), f(1), f(2), f(3));
+    } else if (name == "handleRotateGesture" && has(3)) {
+        _map.handleRotateGesture(f(0), f(1), f(2));
+    } else if (name == "handleShoveGesture" && has(1)) {
+        _map.handleShoveGesture(f(0));
+    } else {
+        LOGW("Skipping session event '%s' with %d arguments", name.c_str(), int(args.size()));
+    }
+}
+
+}
@@ -0,0 +1,152 @@
+#include "debug/tileTrace.h"
+
+#if defined(TANGRAM_TILE_TRACING)
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Tangram {
+namespace TileTrace {
+
+struct Event {
+    const char* name = nullptr;
+    TileID tileId = { 0, 0, 0 };
+    int32_t source = 0;
+    // Microseconds since the first event
+    int64_t timestamp = 0;
+    int64_t duration = 0;
+    // Chrome trace phase: complete, instant, async begin and end
+    char phase = 'X';
+    uint32_t thread = 0;
+};
+
+struct Buffer {
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t next = 0;
+    uint32_t thread = 0;
+};
+
+static std::mutex s_buffersMutex;
+static std::vector<std::shared_ptr<Buffer>> s_buffers;
+static const Clock::time_point s_epoch = Clock::now();
+
+static Buffer& threadBuffer() {
+    // Buffers stay registered after their thread exits so its events are kept
+    thread_local std::shared_ptr<Buffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<Buffer>();
+        buffer->events.reserve(bufferSize);
+
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        buffer->thread = s_buffers.size() + 1;
+        s_buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+static int64_t micros(Clock::time_point _time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(_time - s_epoch).count();
+}
+
+static void push(Event _event) {
+    auto& buffer = threadBuffer();
+    _event.thread = buffer.thread;
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < bufferSize) {
+        buffer.events.push_back(_event);
+    } else {
+        buffer.events[buffer.next] = _event;
+    }
+    buffer.next = (buffer.next + 1) % bufferSize;
+}
+
+void record(const char* _name, const TileID& _tileId, int32_t _source,
+            Clock::time_point _begin, Clock::time_point _end) {
+    Event event;
+    event.name = _name;
+    event.tileId = _tileId;
+    event.source = _source;
+    event.timestamp = micros(_begin);
+    event.duration = std::max<int64_t>(0, micros(_end) - event.timestamp);
+    push(event);
+}
+
+static void mark(char _phase, const char* _name, const TileID& _tileId, int32_t _source) {
+    Event event;
+    event.name = _name;
+    event.tileId = _tileId;
+    event.source = _source;
+    event.timestamp = micros(Clock::now());
+    event.phase = _phase;
+    push(event);
+}
+
+void instant(const char* _name, const TileID& _tileId, int32_t _source) {
+    mark('i', _name, _tileId, _source);
+}
+
+void asyncBegin(const char* _name, const TileID& _tileId, int32_t _source) {
+    mark('b', _name, _tileId, _source);
+}
+
+void asyncEnd(const char* _name, const TileID& _tileId, int32_t _source) {
+    mark('e', _name, _tileId, _source);
+}
+
+std::string exportChromeTrace() {
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        for (auto& buffer : s_buffers) {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const auto& a, const auto& b) { return a.timestamp < b.timestamp; });
+
+    std::string json = "{\"traceEvents\":[";
+    bool first = true;
+    for (auto& event : events) {
+        std::string tile = event.tileId.toString();
+
+        if (!first) { json += ","; }
+        first = false;
+
+        json += "{\"name\":\"";
+        json += event.name;
+        json += "\",\"cat\":\"tile\",\"ph\":\"";
+        json += event.phase;
+        json += "\",\"ts\":" + std::to_string(event.timestamp);
+        if (event.phase == 'X') {
+            json += ",\"dur\":" + std::to_string(event.duration);
+        } else if (event.phase == 'i') {
+            json += ",\"s\":\"t\"";
+        } else {
+            json += ",\"id\":\"" + tile + "#" + std::to_string(event.source) + "\"";
+        }
+        json += ",\"pid\":1,\"tid\":" + std::to_string(event.thread);
+        json += ",\"args\":{\"tile\":\"" + tile + "\",\"source\":" + std::to_string(event.source) + "}}";
+    }
+    json += "],\"displayTimeUnit\":\"ms\"}";
+
+    return json;
+}
+
+void clear() {
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    for (auto& buffer : s_buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+        buffer->next = 0;
+    }
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+/* Trace spans of the stages a tile passes through, from the load request to
+ * the first frame it is part of. Enabled by building with TANGRAM_TILE_TRACING,
+ * otherwise the TILE_TRACE macros expand to nothing.
+ *
+ * Events are recorded into a ring buffer per thread and exported in the Chrome
+ * trace event format, which chrome://tracing and the Perfetto UI open.
+ */
+
+#if defined(TANGRAM_TILE_TRACING)
+
+#include "tile/tileID.h"
+
+#include <chrono>
+#include <string>
+
+namespace Tangram {
+namespace TileTrace {
+
+using Clock = std::chrono::steady_clock;
+
+// Events kept per thread, older ones are overwritten
+constexpr size_t bufferSize = 4096;
+
+void record(const char* _name, const TileID& _tileId, int32_t _source,
+            Clock::time_point _begin, Clock::time_point _end);
+
+void instant(const char* _name, const TileID& _tileId, int32_t _source);
+
+// Span which starts and ends on different threads, matched by name, tile and source
+void asyncBegin(const char* _name, const TileID& _tileId, int32_t _source);
+void asyncEnd(const char* _name, const TileID& _tileId, int32_t _source);
+
+// Events of all threads, ordered by time
+std::string exportChromeTrace();
+
+void clear();
+
+struct Span {
+    Span(const char* _name, const TileID& _tileId, int32_t _source)
+        : name(_name), tileId(_tileId), source(_source), begin(Clock::now()) {}
+
+    ~Span() { record(name, tileId, source, begin, Clock::now()); }
+
+    const char* name;
+    TileID tileId;
+    int32_t source;
+    Clock::time_point begin;
+};
+
+}
+}
+
+#define TILE_TRACE_CONCAT_(a, b) a##b
+#define TILE_TRACE_CONCAT(a, b) TILE_TRACE_CONCAT_(a, b)
+
+#define TILE_TRACE_SPAN(name, tileId, source) \
+    ::Tangram::TileTrace::Span TILE_TRACE_CONCAT(tileTraceSpan, __LINE__)(name, tileId, source)
+#define TILE_TRACE_SINCE(name, tileId, source, begin) \
+    ::Tangram::TileTrace::record(name, tileId, source, begin, ::Tangram::TileTrace::Clock::now())
+#define TILE_TRACE_INSTANT(name, tileId, source) ::Tangram::TileTrace::instant(name, tileId, source)
+#define TILE_TRACE_BEGIN(name, tileId, source) ::Tangram::TileTrace::asyncBegin(name, tileId, source)
+#define TILE_TRACE_END(name, tileId, source) ::Tangram::TileTrace::asyncEnd(name, tileId, source)
+
+#else
+
+#define TILE_TRACE_SPAN(name, tileId, source)
+#define TILE_TRACE_SINCE(name, tileId, source, begin)
+#define TILE_TRACE_INSTANT(name, tileId, source)
+#define TILE_TRACE_BEGIN(name, tileId, source)
+#define TILE_TRACE_END(name, tileId, source)
+
+#endif
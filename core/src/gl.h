@@ -53,6 +53,7 @@ typedef float           GLclampf;   /*single precision float in [0,1] */
 typedef double          GLdouble;   /* double precision float */
 typedef double          GLclampd;   /* double precision float in [0,1] */
 typedef char            GLchar;
+typedef struct __GLsync *GLsync;
 
 /* Utility */
 #define GL_VENDOR                       0x1F00
@@ -81,6 +82,7 @@ typedef char            GLchar;
 #define GL_UNSIGNED_BYTE                0x1401
 #define GL_SHORT                        0x1402
 #define GL_UNSIGNED_SHORT               0x1403
+#define GL_UNSIGNED_SHORT_5_6_5         0x8363
 #define GL_INT                          0x1404
 #define GL_UNSIGNED_INT                 0x1405
 #define GL_FLOAT                        0x1406
@@ -141,6 +143,16 @@ typedef char            GLchar;
 #define GL_RGBA                         0x1908
 #define GL_RGBA8_OES                    0x8058
 
+// Compressed texture formats of GLES3 and KHR_texture_compression_astc_ldr
+#define GL_COMPRESSED_RGB8_ETC2                      0x9274
+#define GL_COMPRESSED_SRGB8_ETC2                     0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2  0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC                 0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC          0x9279
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR              0x93B0
+#define GL_COMPRESSED_RGBA_ASTC_12x12_KHR            0x93BD
+
 #define GL_NEAREST                      0x2600
 #define GL_LINEAR                       0x2601
 #define GL_NEAREST_MIPMAP_NEAREST       0x2700
@@ -197,6 +209,10 @@ typedef char            GLchar;
 #define GL_DEPTH_COMPONENT              0x1902
 #define GL_DEPTH_COMPONENT16            0x81A5
 
+/* Scissor */
+#define GL_SCISSOR_TEST                 0x0C11
+#define GL_SCISSOR_BOX                  0x0C10
+
 /* Stencil */
 #define GL_STENCIL_BITS                 0x0D57
 #define GL_STENCIL_TEST                 0x0B90
@@ -268,11 +284,44 @@ typedef char            GLchar;
 #define GL_LINK_STATUS                  0x8B82
 #define GL_INFO_LOG_LENGTH              0x8B84
 
+// get_program_binary
+#define GL_PROGRAM_BINARY_LENGTH        0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS   0x87FE
+
 // mapbuffer
 #define GL_READ_ONLY                    0x88B8
 #define GL_WRITE_ONLY                   0x88B9
 #define GL_READ_WRITE                   0x88BA
 
+// map_buffer_range, GLES 3
+#define GL_MAP_READ_BIT                 0x0001
+#define GL_MAP_WRITE_BIT                0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT     0x0004
+#define GL_MAP_INVALIDATE_BUFFER_BIT    0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT       0x0020
+
+// pixel_buffer_object, GLES 3
+#define GL_PIXEL_PACK_BUFFER            0x88EB
+#define GL_STREAM_READ                  0x88E1
+
+// sync objects, GLES 3
+#define GL_SYNC_GPU_COMMANDS_COMPLETE   0x9117
+#define GL_SYNC_STATUS                  0x9114
+#define GL_SIGNALED                     0x9119
+
+// uniform_buffer_object, GLES 3
+#define GL_UNIFORM_BUFFER               0x8A11
+#define GL_INVALID_INDEX                0xFFFFFFFFu
+
+// KHR_parallel_shader_compile
+#define GL_COMPLETION_STATUS_KHR        0x91B1
+
+// timer_query, disjoint_timer_query
+#define GL_TIME_ELAPSED                 0x88BF
+#define GL_QUERY_RESULT                 0x8866
+#define GL_QUERY_RESULT_AVAILABLE       0x8867
+#define GL_GPU_DISJOINT                 0x8FBB
+
 #define GL_MAX_TEXTURE_SIZE             0x0D33
 #define GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS 0x8B4D
 
@@ -284,6 +333,7 @@ struct GL {
     static void clear(GLbitfield mask);
     static void lineWidth(GLfloat width);
     static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    static void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
 
     static void enable(GLenum);
     static void disable(GLenum);
@@ -318,6 +368,9 @@ struct GL {
     static GLint getAttribLocation(GLuint program, const GLchar *name);
     static void getProgramiv(GLuint program, GLenum pname, GLint *params);
     static void getShaderiv(GLuint shader, GLenum pname, GLint *params);
+    static void getProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                                 GLenum *binaryFormat, void *binary);
+    static void programBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
 
     // Buffers
     static void bindBuffer(GLenum target, GLuint buffer);
@@ -369,6 +422,12 @@ struct GL {
                               GLenum format, GLenum type,
                               const GLvoid *pixels);
 
+    static void compressedTexImage2D(GLenum target, GLint level,
+                                     GLenum internalFormat,
+                                     GLsizei width, GLsizei height,
+                                     GLint border, GLsizei imageSize,
+                                     const GLvoid *data);
+
     static void generateMipmap(GLenum target);
 
 
@@ -381,6 +440,11 @@ struct GL {
     static void drawElements(GLenum mode, GLsizei count,
                              GLenum type, const GLvoid *indices );
 
+    // Instanced arrays, only when Hardware::supportsInstancing
+    static void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                      const GLvoid *indices, GLsizei instanceCount);
+    static void vertexAttribDivisor(GLuint index, GLuint divisor);
+
     static void uniform1f(GLint location, GLfloat v0);
     static void uniform2f(GLint location, GLfloat v0, GLfloat v1);
     static void uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
@@ -407,6 +471,8 @@ struct GL {
     // mapbuffer
     static void *mapBuffer(GLenum target, GLenum access);
     static GLboolean unmapBuffer(GLenum target);
+    // Only when Hardware::supportsMapBufferRange
+    static void *mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 
     static void finish(void);
 
@@ -417,5 +483,22 @@ struct GL {
     static void deleteVertexArrays(GLsizei n, const GLuint *arrays);
     static void genVertexArrays(GLsizei n, GLuint *arrays);
 
+    // Uniform buffers, only when Hardware::supportsUniformBuffers
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    static GLuint getUniformBlockIndex(GLuint program, const GLchar *uniformBlockName);
+    static void uniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+
+    // Timer queries, only when Hardware::supportsTimerQuery
+    static void genQueries(GLsizei n, GLuint *ids);
+    static void deleteQueries(GLsizei n, const GLuint *ids);
+    static void beginQuery(GLenum target, GLuint id);
+    static void endQuery(GLenum target);
+    static void getQueryObjectuiv(GLuint id, GLenum pname, GLuint *params);
+
+    // Sync objects, only when Hardware::supportsPixelBufferReadback
+    static GLsync fenceSync(GLenum condition, GLbitfield flags);
+    static void getSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values);
+    static void deleteSync(GLsync sync);
+
 };
 }
@@ -0,0 +1,228 @@
+#include "gl/bufferPool.h"
+
+#include "gl/glError.h"
+#include "gl/renderState.h"
+#include "gl/shaderProgram.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Tangram {
+
+constexpr size_t BufferPool::VERTEX_PAGE_SIZE;
+constexpr size_t BufferPool::INDEX_PAGE_SIZE;
+constexpr size_t BufferPool::MAX_PAGE_VERTICES;
+constexpr size_t BufferPool::MAX_EMPTY_PAGES;
+
+BufferPool::FreeList::FreeList(size_t _size) : m_size(_size), m_available(_size) {
+    if (_size > 0) { m_free.emplace(0, _size); }
+}
+
+ptrdiff_t BufferPool::FreeList::allocate(size_t _size, size_t _alignment) {
+    if (_size == 0 || _size > m_available) { return -1; }
+
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        size_t start = it->first;
+        size_t end = start + it->second;
+
+        size_t offset = (start + _alignment - 1) / _alignment * _alignment;
+        if (offset + _size > end) { continue; }
+
+        m_free.erase(it);
+
+        // Keep the padding before and the rest after the range
+        if (offset > start) { m_free.emplace(start, offset - start); }
+        if (offset + _size < end) { m_free.emplace(offset + _size, end - offset - _size); }
+
+        m_available -= _size;
+        return offset;
+    }
+    return -1;
+}
+
+void BufferPool::FreeList::release(size_t _offset, size_t _size) {
+    if (_size == 0) { return; }
+
+    m_available += _size;
+
+    auto next = m_free.lower_bound(_offset);
+
+    // Merge with the preceding free range
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == _offset) {
+            _offset = prev->first;
+            _size += prev->second;
+            m_free.erase(prev);
+        }
+    }
+    // Merge with the following free range
+    if (next != m_free.end() && _offset + _size == next->first) {
+        _size += next->second;
+        m_free.erase(next);
+    }
+
+    m_free.emplace(_offset, _size);
+}
+
+BufferPool::Page::Page(RenderState& _rs, size_t _stride, size_t _vertexBytes, size_t _indexBytes)
+    : rs(_rs), stride(_stride), vertices(_vertexBytes), indices(_indexBytes) {
+
+    GL::genBuffers(1, &vertexBuffer);
+    rs.vertexBuffer(vertexBuffer);
+    GL::bufferData(GL_ARRAY_BUFFER, _vertexBytes, nullptr, GL_STATIC_DRAW);
+
+    if (_indexBytes > 0) {
+        GL::genBuffers(1, &indexBuffer);
+        rs.indexBuffer(indexBuffer);
+        GL::bufferData(GL_ELEMENT_ARRAY_BUFFER, _indexBytes, nullptr, GL_STATIC_DRAW);
+    }
+}
+
+BufferPool::Page::~Page() {
+    GLuint buffers[] = { vertexBuffer, indexBuffer };
+    rs.queueBufferDeletion(2, buffers);
+
+    disposeVertexArrays();
+}
+
+Vao& BufferPool::Page::vertexArray(ShaderProgram& _program, VertexLayout& _layout) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    GLuint program = _program.getGlProgram();
+    for (auto& va : vertexArrays) {
+        if (va.layout == &_layout && va.program == program) { return va.vao; }
+    }
+
+    vertexArrays.push_back({ &_layout, program, {} });
+    auto& vao = vertexArrays.back().vao;
+
+    VertexOffsets offsets;
+    offsets.emplace_back(0, 0);
+    vao.initialize(rs, _program, offsets, _layout, vertexBuffer, indexBuffer);
+
+    return vao;
+}
+
+void BufferPool::Page::disposeVertexArrays() {
+    for (auto& va : vertexArrays) { va.vao.dispose(rs); }
+    vertexArrays.clear();
+}
+
+bool BufferPool::allocate(RenderState& _rs, size_t _stride,
+                          const GLbyte* _vertices, size_t _vertexBytes,
+                          const GLbyte* _indices, size_t _indexBytes, GLenum _indexType,
+                          Allocation& _allocation) {
+
+    if (_vertexBytes == 0) { return false; }
+
+    collectPages();
+
+    std::shared_ptr<Page> page;
+    ptrdiff_t vertexOffset = -1, indexOffset = 0;
+
+    for (auto& p : m_pages) {
+        if (p->stride != _stride || p->dedicated) { continue; }
+
+        std::lock_guard<std::mutex> lock(p->mutex);
+        if (p->vertices.available() < _vertexBytes || p->indices.available() < _indexBytes) {
+            continue;
+        }
+
+        vertexOffset = p->vertices.allocate(_vertexBytes, _stride);
+        if (vertexOffset < 0) { continue; }
+
+        if (_indexBytes > 0) {
+            indexOffset = p->indices.allocate(_indexBytes, sizeof(GLuint));
+            if (indexOffset < 0) {
+                p->vertices.release(vertexOffset, _vertexBytes);
+                continue;
+            }
+        }
+        page = p;
+        break;
+    }
+
+    if (!page) {
+        // Round vertex pages to the stride to use the whole page
+        size_t vertexPage = std::min(VERTEX_PAGE_SIZE / _stride, MAX_PAGE_VERTICES) * _stride;
+        size_t indexPage = INDEX_PAGE_SIZE;
+        bool dedicated = _vertexBytes > vertexPage || _indexBytes > indexPage;
+        if (dedicated) {
+            vertexPage = _vertexBytes;
+            indexPage = std::max(_indexBytes, sizeof(GLuint));
+        }
+
+        page = std::make_shared<Page>(_rs, _stride, vertexPage, indexPage);
+        page->dedicated = dedicated;
+        if (page->vertexBuffer == 0 || page->indexBuffer == 0) {
+            LOGW("Could not create mesh buffer page");
+            return false;
+        }
+        vertexOffset = page->vertices.allocate(_vertexBytes, _stride);
+        if (_indexBytes > 0) {
+            indexOffset = page->indices.allocate(_indexBytes, sizeof(GLuint));
+        }
+        m_pages.push_back(page);
+    }
+
+    _rs.vertexBuffer(page->vertexBuffer);
+    GL::bufferSubData(GL_ARRAY_BUFFER, vertexOffset, _vertexBytes, _vertices);
+
+    if (_indexBytes > 0) {
+        _rs.indexBuffer(page->indexBuffer);
+
+        size_t baseVertex = vertexOffset / _stride;
+        if (baseVertex == 0) {
+            GL::bufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset, _indexBytes, _indices);
+        } else {
+            // Only shared pages have a base, their vertices fit 16 bit indices
+            assert(_indexType == GL_UNSIGNED_SHORT);
+            const GLushort* src = reinterpret_cast<const GLushort*>(_indices);
+            m_rebased.resize(_indexBytes / sizeof(GLushort));
+            for (size_t i = 0; i < m_rebased.size(); i++) {
+                m_rebased[i] = src[i] + baseVertex;
+            }
+            GL::bufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset, _indexBytes, m_rebased.data());
+        }
+    }
+
+    _allocation.page = page;
+    _allocation.vertexOffset = vertexOffset;
+    _allocation.vertexBytes = _vertexBytes;
+    _allocation.indexOffset = indexOffset;
+    _allocation.indexBytes = _indexBytes;
+
+    return true;
+}
+
+void BufferPool::release(Allocation& _allocation) {
+    if (!_allocation) { return; }
+
+    {
+        auto& page = *_allocation.page;
+        std::lock_guard<std::mutex> lock(page.mutex);
+        page.vertices.release(_allocation.vertexOffset, _allocation.vertexBytes);
+        page.indices.release(_allocation.indexOffset, _allocation.indexBytes);
+
+        if (page.vertices.empty()) { page.disposeVertexArrays(); }
+    }
+    _allocation = {};
+}
+
+void BufferPool::collectPages() {
+    size_t empty = 0;
+
+    // Pages only referenced by the pool are empty
+    auto it = std::remove_if(m_pages.begin(), m_pages.end(), [&](auto& page) {
+            return page.use_count() == 1 && (page->dedicated || ++empty > MAX_EMPTY_PAGES);
+        });
+    m_pages.erase(it, m_pages.end());
+}
+
+void BufferPool::clear() {
+    m_pages.clear();
+}
+
+}
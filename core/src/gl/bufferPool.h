@@ -0,0 +1,133 @@
+#pragma once
+
+#include "gl.h"
+#include "gl/vao.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Tangram {
+
+class RenderState;
+class ShaderProgram;
+class VertexLayout;
+
+/* Sub-allocates static meshes out of shared vertex and index buffers
+ *
+ * Buffers are paged per vertex stride, so that meshes of all tiles with
+ * the same vertex layout are drawn from one bound buffer with per-mesh
+ * index offsets. Indices are stored relative to the start of the page,
+ * so all meshes of a page share the attribute setup and one VAO per
+ * layout and program. Allocations keep their page alive, hence the pool
+ * can be dropped at any time. Releasing an allocation is thread safe;
+ * allocate() must be called on the GL thread.
+ */
+class BufferPool {
+
+public:
+
+    // Default page sizes in bytes, larger meshes get a page of their own
+    static constexpr size_t VERTEX_PAGE_SIZE = 4 << 20;
+    static constexpr size_t INDEX_PAGE_SIZE = 1 << 20;
+    // Vertices of a shared page, addressable by 16 bit indices
+    static constexpr size_t MAX_PAGE_VERTICES = 65536;
+
+    // First fit allocator of byte ranges with coalescing of free ranges
+    class FreeList {
+    public:
+        explicit FreeList(size_t _size = 0);
+
+        // Returns the offset of a range of _size bytes aligned to _alignment,
+        // or -1 when there is no free range large enough
+        ptrdiff_t allocate(size_t _size, size_t _alignment);
+
+        void release(size_t _offset, size_t _size);
+
+        size_t size() const { return m_size; }
+        size_t available() const { return m_available; }
+        bool empty() const { return m_available == m_size; }
+
+    private:
+        // Free ranges by offset
+        std::map<size_t, size_t> m_free;
+        size_t m_size;
+        size_t m_available;
+    };
+
+    struct Page {
+        Page(RenderState& _rs, size_t _stride, size_t _vertexBytes, size_t _indexBytes);
+        ~Page();
+
+        RenderState& rs;
+        size_t stride;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+
+        // Pages for a mesh larger than a shared page hold only that mesh
+        bool dedicated = false;
+
+        std::mutex mutex;
+        FreeList vertices;
+        FreeList indices;
+
+        // VAO with _layout at the start of the page for _program, created
+        // on first use. Must be called on the GL thread.
+        Vao& vertexArray(ShaderProgram& _program, VertexLayout& _layout);
+
+    private:
+        struct VertexArray {
+            const VertexLayout* layout;
+            GLuint program;
+            Vao vao;
+        };
+        // Dropped when the page gets empty, before the layouts and
+        // programs of a scene go away
+        std::vector<VertexArray> vertexArrays;
+
+        void disposeVertexArrays();
+
+        friend class BufferPool;
+    };
+
+    struct Allocation {
+        std::shared_ptr<Page> page;
+        size_t vertexOffset = 0;
+        size_t vertexBytes = 0;
+        size_t indexOffset = 0;
+        size_t indexBytes = 0;
+
+        explicit operator bool() const { return bool(page); }
+    };
+
+    /* Copy _vertices and _indices of _indexType into a page for _stride
+     * and set _allocation to their location. The indices are rebased to
+     * the start of the page. Returns false when the buffers could not be
+     * created. */
+    bool allocate(RenderState& _rs, size_t _stride,
+                  const GLbyte* _vertices, size_t _vertexBytes,
+                  const GLbyte* _indices, size_t _indexBytes, GLenum _indexType,
+                  Allocation& _allocation);
+
+    static void release(Allocation& _allocation);
+
+    // Drop all pages; pages in use are deleted with their last allocation
+    void clear();
+
+    size_t pageCount() const { return m_pages.size(); }
+
+private:
+
+    // Empty pages to keep for new allocations
+    static constexpr size_t MAX_EMPTY_PAGES = 2;
+
+    void collectPages();
+
+    std::vector<std::shared_ptr<Page>> m_pages;
+
+    // Scratch buffer for rebased indices
+    std::vector<GLushort> m_rebased;
+};
+
+}
@@ -0,0 +1,62 @@
+#include "gl/bufferRing.h"
+
+#include "gl/glError.h"
+#include "gl/hardware.h"
+#include "gl/renderState.h"
+#include "log.h"
+
+#include <cstring>
+
+namespace Tangram {
+
+bool BufferRing::enabled() const {
+    return !m_failed && Hardware::supportsMapBufferRange;
+}
+
+GLuint BufferRing::write(RenderState& rs, const void* _data, size_t _bytes) {
+
+    if (!enabled() || _bytes == 0) { return 0; }
+
+    size_t pos = m_next;
+    m_next = (m_next + 1) % SIZE;
+
+    GLuint& buffer = m_buffers[pos];
+    if (buffer == 0) { GL::genBuffers(1, &buffer); }
+
+    rs.vertexBuffer(buffer);
+
+    if (m_capacity[pos] < _bytes) {
+        // Grow with some headroom, label counts change from frame to frame
+        m_capacity[pos] = _bytes + _bytes / 2;
+        GL::bufferData(GL_ARRAY_BUFFER, m_capacity[pos], nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    void* dataStore = GL::mapBufferRange(GL_ARRAY_BUFFER, 0, _bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                         GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dataStore) {
+        LOGW("Unable to map dynamic vertex buffer, using buffer uploads");
+        m_failed = true;
+        return 0;
+    }
+
+    std::memcpy(dataStore, _data, _bytes);
+
+    if (!GL::unmapBuffer(GL_ARRAY_BUFFER)) {
+        // The data store got corrupted, e.g. by a display mode change
+        m_failed = true;
+        return 0;
+    }
+
+    return buffer;
+}
+
+void BufferRing::dispose(RenderState& rs) {
+    rs.queueBufferDeletion(SIZE, m_buffers);
+    for (size_t i = 0; i < SIZE; i++) {
+        m_buffers[i] = 0;
+        m_capacity[i] = 0;
+    }
+}
+
+}
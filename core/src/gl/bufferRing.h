@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gl.h"
+
+#include <cstddef>
+
+namespace Tangram {
+
+class RenderState;
+
+/* Ring of vertex buffers for geometry that is rewritten every frame
+ *
+ * Each upload goes to the next buffer of the ring, which was last drawn
+ * SIZE - 1 uploads ago and is not in use by the GPU anymore. It is written
+ * through glMapBufferRange without synchronization, which saves the stall or
+ * the copy of the orphaned data store that a driver does for a rewrite of the
+ * buffer that is drawn. Requires Hardware::supportsMapBufferRange; a ring that
+ * failed to map once stays disabled and the mesh falls back to its own buffer.
+ */
+class BufferRing {
+
+public:
+
+    // Enough for the frames that drivers may have in flight
+    static constexpr size_t SIZE = 3;
+
+    // Returns the buffer that _bytes of _data were written to, or 0 when
+    // the buffers can not be mapped. Must be called on the GL thread.
+    GLuint write(RenderState& rs, const void* _data, size_t _bytes);
+
+    // Whether uploads go to the ring, otherwise meshes use their own buffer
+    bool enabled() const;
+
+    void dispose(RenderState& rs);
+
+private:
+
+    GLuint m_buffers[SIZE] = {};
+    // Size of the data store of each buffer
+    size_t m_capacity[SIZE] = {};
+    size_t m_next = 0;
+    bool m_failed = false;
+};
+
+}
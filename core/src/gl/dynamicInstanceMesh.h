@@ -0,0 +1,146 @@
+#pragma once
+
+#include "gl/mesh.h"
+#include "gl/bufferRing.h"
+#include "gl/glError.h"
+#include "gl/renderState.h"
+#include "gl/shaderProgram.h"
+#include "gl/hardware.h"
+
+#include <memory>
+#include <vector>
+
+namespace Tangram {
+
+/*
+ * DynamicInstanceMesh - One record of type T per quad, drawn as instances of
+ * the quad in RenderState::getQuadCornerBuffer. The shader receives the
+ * corner as 'a_corner' and the attributes of _instanceLayout per instance.
+ * Requires Hardware::supportsInstancing.
+ */
+template<class T>
+class DynamicInstanceMesh : public StyledMesh, protected MeshBase {
+
+public:
+
+    DynamicInstanceMesh(std::shared_ptr<VertexLayout> _instanceLayout)
+        : MeshBase(_instanceLayout, GL_TRIANGLES, GL_DYNAMIC_DRAW) {
+    }
+
+    ~DynamicInstanceMesh() override {
+        if (m_rs) {
+            if (m_ring.enabled()) { m_glVertexBuffer = 0; }
+            m_ring.dispose(*m_rs);
+        }
+    }
+
+    bool draw(RenderState& rs, ShaderProgram& _shader, bool _useVao = true) override {
+        return drawRange(rs, _shader, 0, m_nVertices);
+    }
+
+    bool drawRange(RenderState& rs, ShaderProgram& shader, size_t instancePos, size_t instanceCount);
+
+    size_t bufferSize() const override {
+        return MeshBase::bufferSize();
+    }
+
+    // Instances that are drawn are kept until swap()
+    void clear() {
+        m_instances.clear();
+    }
+
+    void swap() {
+        std::swap(m_instances, m_drawInstances);
+        m_nVertices = m_drawInstances.size();
+        m_isUploaded = false;
+    }
+
+    size_t numberOfInstances() const { return m_drawInstances.size(); }
+
+    void upload(RenderState& rs) override;
+
+    T* pushInstance() {
+        m_instances.emplace_back();
+        return &m_instances.back();
+    }
+
+private:
+
+    static VertexLayout& cornerLayout() {
+        static VertexLayout layout({{"a_corner", 2, GL_FLOAT, false, 0}});
+        return layout;
+    }
+
+    void setDivisors(ShaderProgram& _shader, GLuint _divisor);
+
+    // Written by pushInstance, m_drawInstances are uploaded and drawn
+    std::vector<T> m_instances;
+    std::vector<T> m_drawInstances;
+    // Buffers written with mapBufferRange, when supported
+    BufferRing m_ring;
+};
+
+template<class T>
+void DynamicInstanceMesh<T>::upload(RenderState& rs) {
+
+    if (m_nVertices == 0 || m_isUploaded) { return; }
+
+    m_rs = &rs;
+
+    if (m_ring.enabled()) {
+        GLuint buffer = m_ring.write(rs, m_drawInstances.data(),
+                                     m_nVertices * m_vertexLayout->getStride());
+        if (buffer) {
+            m_glVertexBuffer = buffer;
+            m_isUploaded = true;
+            return;
+        }
+        m_glVertexBuffer = 0;
+    }
+
+    if (m_glVertexBuffer == 0) {
+        GL::genBuffers(1, &m_glVertexBuffer);
+    }
+
+    MeshBase::subDataUpload(rs, reinterpret_cast<GLbyte*>(m_drawInstances.data()));
+
+    m_isUploaded = true;
+}
+
+template<class T>
+void DynamicInstanceMesh<T>::setDivisors(ShaderProgram& _shader, GLuint _divisor) {
+    for (auto& attrib : m_vertexLayout->getAttribs()) {
+        GLint location = _shader.getAttribLocation(attrib.name);
+        if (location != -1) { GL::vertexAttribDivisor(location, _divisor); }
+    }
+}
+
+template<class T>
+bool DynamicInstanceMesh<T>::drawRange(RenderState& rs, ShaderProgram& shader,
+                                       size_t instancePos, size_t instanceCount) {
+
+    if (m_nVertices == 0 || instanceCount == 0) { return false; }
+
+    if (!shader.use(rs)) { return false; }
+
+    // The corners advance per vertex, all other attributes per instance.
+    // Both layouts are enabled for the same program so that the second
+    // does not disable the attributes of the first.
+    rs.vertexBuffer(rs.getQuadCornerBuffer());
+    cornerLayout().enable(rs, shader, 0);
+
+    rs.vertexBuffer(m_glVertexBuffer);
+    m_vertexLayout->enable(rs, shader, instancePos * m_vertexLayout->getStride());
+
+    rs.indexBuffer(rs.getQuadIndexBuffer());
+
+    setDivisors(shader, 1);
+    GL::drawElementsInstanced(m_drawMode, 6, GL_UNSIGNED_SHORT, 0, instanceCount);
+    rs.countDrawCall();
+    // Divisors are attribute state shared with non-instanced draws
+    setDivisors(shader, 0);
+
+    return true;
+}
+
+}
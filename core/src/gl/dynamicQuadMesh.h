@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gl/mesh.h"
+#include "gl/bufferRing.h"
 #include "gl/glError.h"
 #include "gl/renderState.h"
 #include "gl/shaderProgram.h"
@@ -23,6 +24,14 @@ public:
         : MeshBase(_vertexLayout, _drawMode, GL_DYNAMIC_DRAW) {
     }
 
+    ~DynamicQuadMesh() override {
+        if (m_rs) {
+            // m_glVertexBuffer is one of the ring when it is used
+            if (m_ring.enabled()) { m_glVertexBuffer = 0; }
+            m_ring.dispose(*m_rs);
+        }
+    }
+
     bool draw(RenderState& rs, ShaderProgram& _shader, bool _useVao = true) override;
 
     bool drawRange(RenderState& rs, ShaderProgram& shader, size_t vertexPos, size_t vertexCount);
@@ -31,15 +40,20 @@ public:
         return MeshBase::bufferSize();
     }
 
+    // Clear vertices for next frame, the vertices that are drawn
+    // are kept until swap()
     void clear() {
-        // Clear vertices for next frame
-        m_nVertices = 0;
-        m_isUploaded = false;
         m_vertices.clear();
-        //m_batches.clear();
     }
 
-    size_t numberOfVertices() const { return m_vertices.size(); }
+    // Make the vertices pushed since clear() the ones that are uploaded and drawn
+    void swap() {
+        std::swap(m_vertices, m_drawVertices);
+        m_nVertices = m_drawVertices.size();
+        m_isUploaded = false;
+    }
+
+    size_t numberOfVertices() const { return m_drawVertices.size(); }
 
     void upload(RenderState& rs) override;
 
@@ -48,15 +62,19 @@ public:
     // Reserves space for one quad and returns pointer
     // into m_vertices to write into 4 vertices.
     T* pushQuad() {
-        m_nVertices += 4;
         m_vertices.insert(m_vertices.end(), 4, {});
-        return &m_vertices[m_nVertices - 4];
+        return &m_vertices[m_vertices.size() - 4];
     }
 
 private:
 
+    // Written by pushQuad, may be filled on another thread while
+    // m_drawVertices are drawn
     std::vector<T> m_vertices;
+    std::vector<T> m_drawVertices;
     Vao m_vaos;
+    // Buffers written with mapBufferRange, when supported
+    BufferRing m_ring;
 };
 
 template<class T>
@@ -64,12 +82,26 @@ void DynamicQuadMesh<T>::upload(RenderState& rs) {
 
     if (m_nVertices == 0 || m_isUploaded) { return; }
 
+    m_rs = &rs;
+
+    if (m_ring.enabled()) {
+        GLuint buffer = m_ring.write(rs, m_drawVertices.data(),
+                                     m_nVertices * m_vertexLayout->getStride());
+        if (buffer) {
+            m_glVertexBuffer = buffer;
+            m_isUploaded = true;
+            return;
+        }
+        // The ring is disabled from now on
+        m_glVertexBuffer = 0;
+    }
+
     // Generate vertex buffer, if needed
     if (m_glVertexBuffer == 0) {
         GL::genBuffers(1, &m_glVertexBuffer);
     }
 
-    MeshBase::subDataUpload(rs, reinterpret_cast<GLbyte*>(m_vertices.data()));
+    MeshBase::subDataUpload(rs, reinterpret_cast<GLbyte*>(m_drawVertices.data()));
 
     m_isUploaded = true;
 }
@@ -83,7 +115,8 @@ bool DynamicQuadMesh<T>::draw(RenderState& rs, ShaderProgram& shader, bool useVa
     if (!shader.use(rs)) { return false; }
 
 #ifdef DYNAMIC_MESH_VAOS
-    useVao &= Hardware::supportsVAOs;
+    // The vao would capture one buffer of the ring
+    useVao &= Hardware::supportsVAOs && !m_ring.enabled();
 
     if (useVao) {
         // Capture vao state for a default vertex offset of 0/0
@@ -128,6 +161,7 @@ bool DynamicQuadMesh<T>::draw(RenderState& rs, ShaderProgram& shader, bool useVa
 
         size_t elementsInBatch = verticesInBatch * 6 / 4;
         GL::drawElements(m_drawMode, elementsInBatch, GL_UNSIGNED_SHORT, 0);
+        rs.countDrawCall();
 
 #ifdef DYNAMIC_MESH_VAOS
         if (useVao && vertexPos == 0) {
@@ -170,6 +204,7 @@ bool DynamicQuadMesh<T>::drawRange(RenderState& rs, ShaderProgram& shader,
 
         size_t elementsInBatch = verticesInBatch * 6 / 4;
         GL::drawElements(m_drawMode, elementsInBatch, GL_UNSIGNED_SHORT, 0);
+        rs.countDrawCall();
 
         // Update counters.
         vertexPos += verticesInBatch;
@@ -12,12 +12,13 @@
 
 namespace Tangram {
 
-FrameBuffer::FrameBuffer(int _width, int _height, bool _colorRenderBuffer) :
+FrameBuffer::FrameBuffer(int _width, int _height, bool _colorRenderBuffer, GLenum _textureFilter) :
     m_glFrameBufferHandle(0),
     m_glDepthRenderBufferHandle(0),
     m_glColorRenderBufferHandle(0),
     m_valid(false),
     m_colorRenderBuffer(_colorRenderBuffer),
+    m_textureFilter(_textureFilter),
     m_width(_width), m_height(_height) {
 
 }
@@ -76,7 +77,7 @@ GLuint FrameBuffer::readAt(float _normalizedX, float _normalizedY) const {
     return pixel;
 }
 
-FrameBuffer::PixelRect FrameBuffer::readRect(float _normalizedX, float _normalizedY, float _normalizedW, float _normalizedH) const {
+FrameBuffer::PixelRect FrameBuffer::pixelRect(float _normalizedX, float _normalizedY, float _normalizedW, float _normalizedH) const {
 
     PixelRect rect;
     rect.left = fminf(fmaxf(floorf(_normalizedX * m_width), 0.f), m_width);
@@ -84,6 +85,13 @@ FrameBuffer::PixelRect FrameBuffer::readRect(float _normalizedX, float _normaliz
     rect.width = fminf(fmaxf(ceilf(_normalizedW * m_width), 0.f), m_width - rect.left);
     rect.height = fminf(fmaxf(ceilf(_normalizedH * m_height), 0.f), m_height - rect.bottom);
 
+    return rect;
+}
+
+FrameBuffer::PixelRect FrameBuffer::readRect(float _normalizedX, float _normalizedY, float _normalizedW, float _normalizedH) const {
+
+    PixelRect rect = pixelRect(_normalizedX, _normalizedY, _normalizedW, _normalizedH);
+
     rect.pixels.resize(rect.width * rect.height);
 
     GL::readPixels(rect.left, rect.bottom, rect.width, rect.height, GL_RGBA, GL_UNSIGNED_BYTE, rect.pixels.data());
@@ -115,7 +123,7 @@ void FrameBuffer::init(RenderState& _rs) {
     } else {
         TextureOptions options =
             {GL_RGBA, GL_RGBA,
-            {GL_NEAREST, GL_NEAREST},
+            {m_textureFilter, m_textureFilter},
             {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}
         };
 
@@ -173,7 +181,7 @@ FrameBuffer::~FrameBuffer() {
     }
 }
 
-void FrameBuffer::drawDebug(RenderState& _rs, glm::vec2 _dim) {
+void FrameBuffer::draw(RenderState& _rs, glm::vec2 _dim) {
 
     if (m_texture) {
         Primitives::drawTexture(_rs, *m_texture, glm::vec2{}, _dim);
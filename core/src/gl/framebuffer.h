@@ -16,7 +16,8 @@ class FrameBuffer {
 
 public:
 
-    FrameBuffer(int _width, int _height, bool _colorRenderBuffer = true);
+    // _textureFilter applies to the color texture, when _colorRenderBuffer is false
+    FrameBuffer(int _width, int _height, bool _colorRenderBuffer = true, GLenum _textureFilter = GL_NEAREST);
 
     ~FrameBuffer();
 
@@ -41,7 +42,11 @@ public:
 
     PixelRect readRect(float _normalizedX, float _normalizedY, float _normalizedW, float _normalizedH) const;
 
-    void drawDebug(RenderState& _rs, glm::vec2 _dim);
+    /* The pixels readRect would read for the same area, without reading them */
+    PixelRect pixelRect(float _normalizedX, float _normalizedY, float _normalizedW, float _normalizedH) const;
+
+    // Draw the color texture over the current render target, scaled to _dim
+    void draw(RenderState& _rs, glm::vec2 _dim);
 
 private:
 
@@ -61,6 +66,8 @@ private:
 
     bool m_colorRenderBuffer;
 
+    GLenum m_textureFilter;
+
     int m_width;
 
     int m_height;
@@ -0,0 +1,142 @@
+#include "gl/gpuTimer.h"
+
+#include "gl/glError.h"
+#include "gl/hardware.h"
+#include "log.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+GpuTimer::~GpuTimer() {
+    reset();
+}
+
+void GpuTimer::beginFrame() {
+    m_timing = false;
+    if (m_failed) { return; }
+
+    m_frame = (m_frame + 1) % frameLatency;
+    auto& queries = m_frames[m_frame];
+
+    if (!queries.empty()) {
+        // Queries complete in order, so the last one tells for the whole frame
+        GLuint available = 0;
+        GL::getQueryObjectuiv(queries.back().id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) { return; }
+
+        collect(queries);
+    }
+    m_timing = true;
+}
+
+void GpuTimer::collect(std::vector<Query>& _queries) {
+
+    // Results are undefined when the GPU was reset or changed its clock meanwhile
+    GLint disjoint = 0;
+    if (Hardware::timerQueryDisjoint) {
+        GL::getIntegerv(GL_GPU_DISJOINT, &disjoint);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_frameTimes.assign(m_labels.size(), -1.f);
+    for (auto& query : _queries) {
+        GLuint nanoseconds = 0;
+        GL::getQueryObjectuiv(query.id, GL_QUERY_RESULT, &nanoseconds);
+        m_queries.push_back(query.id);
+
+        float& time = m_frameTimes[query.label];
+        time = std::max(time, 0.f) + nanoseconds * 1e-6f;
+    }
+    _queries.clear();
+
+    if (disjoint) { return; }
+
+    for (size_t i = 0; i < m_frameTimes.size(); i++) {
+        if (m_frameTimes[i] >= 0.f) { m_windows[i].add(m_frameTimes[i]); }
+    }
+}
+
+void GpuTimer::begin(const std::string& _label) {
+    if (!m_timing || m_active) { return; }
+
+    GLuint id = 0;
+    if (!m_queries.empty()) {
+        id = m_queries.back();
+        m_queries.pop_back();
+    } else {
+        GL::genQueries(1, &id);
+        if (id == 0) {
+            LOGW("Cannot create timer queries, GPU timing is disabled");
+            m_failed = true;
+            m_timing = false;
+            return;
+        }
+    }
+
+    uint32_t label;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find(m_labels.begin(), m_labels.end(), _label);
+        label = it - m_labels.begin();
+        if (it == m_labels.end()) {
+            m_labels.push_back(_label);
+            m_windows.emplace_back();
+        }
+    }
+
+    GL::beginQuery(GL_TIME_ELAPSED, id);
+    m_frames[m_frame].push_back({ id, label });
+    m_active = true;
+}
+
+void GpuTimer::end() {
+    if (!m_active) { return; }
+
+    GL::endQuery(GL_TIME_ELAPSED);
+    m_active = false;
+}
+
+std::vector<std::pair<std::string, PerformanceTiming>> GpuTimer::timings() const {
+    std::vector<std::pair<std::string, TimingWindow>> windows;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_labels.size(); i++) {
+            if (m_windows[i].count() > 0) { windows.emplace_back(m_labels[i], m_windows[i]); }
+        }
+    }
+
+    std::vector<std::pair<std::string, PerformanceTiming>> result;
+    for (auto& window : windows) {
+        result.emplace_back(window.first, window.second.timing());
+    }
+    return result;
+}
+
+void GpuTimer::reset() {
+    if (m_active) { end(); }
+
+    for (auto& queries : m_frames) {
+        for (auto& query : queries) { m_queries.push_back(query.id); }
+        queries.clear();
+    }
+    if (!m_queries.empty()) {
+        GL::deleteQueries(m_queries.size(), m_queries.data());
+    }
+    invalidate();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_labels.clear();
+    m_windows.clear();
+}
+
+void GpuTimer::invalidate() {
+    for (auto& queries : m_frames) { queries.clear(); }
+    m_queries.clear();
+    m_timing = false;
+    m_active = false;
+    m_failed = false;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "gl.h"
+#include "debug/performanceMonitor.h"
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+/* GPU time of labeled draw passes, measured with GL_TIME_ELAPSED queries.
+ *
+ * The queries of a frame are read back frameLatency frames later, and only
+ * once the driver reports them available, so timing never stalls the
+ * pipeline. A frame is not timed while its slot still has pending queries.
+ * Only one query may be active at a time, hence begin() and end() do not nest.
+ * All methods but timings() must be called on the GL thread.
+ */
+class GpuTimer {
+
+public:
+
+    static constexpr size_t frameLatency = 4;
+
+    ~GpuTimer();
+
+    // Collect the results of an earlier frame and start timing a new one
+    void beginFrame();
+
+    void begin(const std::string& _label);
+    void end();
+
+    // GPU milliseconds by label over the recent frames
+    std::vector<std::pair<std::string, PerformanceTiming>> timings() const;
+
+    // Delete the queries and drop the results
+    void reset();
+
+    // Drop the query handles without deleting them, after the GL context was lost
+    void invalidate();
+
+private:
+
+    struct Query {
+        GLuint id;
+        uint32_t label;
+    };
+
+    void collect(std::vector<Query>& _queries);
+
+    std::array<std::vector<Query>, frameLatency> m_frames;
+    size_t m_frame = 0;
+
+    // Queries for reuse
+    std::vector<GLuint> m_queries;
+
+    bool m_timing = false;
+    bool m_active = false;
+    // Set when query objects could not be created
+    bool m_failed = false;
+
+    std::vector<std::string> m_labels;
+    std::vector<TimingWindow> m_windows;
+    std::vector<float> m_frameTimes;
+
+    mutable std::mutex m_mutex;
+};
+
+}
@@ -13,12 +13,25 @@ namespace Tangram {
 namespace Hardware {
 
 bool supportsMapBuffer = false;
+bool supportsMapBufferRange = false;
 bool supportsVAOs = false;
 bool supportsTextureNPOT = false;
 bool supportsGLRGBA8OES = false;
+bool supportsProgramBinary = false;
+bool supportsInstancing = false;
+bool supportsElementIndexUint = false;
+bool supportsETC2 = false;
+bool supportsASTC = false;
+bool supportsTimerQuery = false;
+bool supportsPixelBufferReadback = false;
+bool supportsUniformBuffers = false;
+bool supportsParallelShaderCompile = false;
+bool prefersVertexLighting = false;
+bool timerQueryDisjoint = false;
 
 uint32_t maxTextureSize = 0;
 uint32_t maxCombinedTextureUnits = 0;
+std::string driverInfo;
 static char* s_glExtensions;
 
 bool isAvailable(std::string _extension) {
@@ -56,11 +69,50 @@ void loadExtensions() {
     supportsVAOs = isAvailable("vertex_array_object");
     supportsTextureNPOT = isAvailable("texture_non_power_of_two");
     supportsGLRGBA8OES = isAvailable("rgb8_rgba8");
+    supportsProgramBinary = isAvailable("get_program_binary");
+    supportsInstancing = isAvailable("instanced_arrays");
+
+    // 32 bit indices are core in desktop GL and GLES3
+    const char* version = (const char*) GL::getString(GL_VERSION);
+    supportsElementIndexUint = version &&
+        (!strstr(version, "OpenGL ES 2") || isAvailable("element_index_uint"));
+
+    // ETC2 is core in GLES3, desktop GL gets it with ES3_compatibility
+    supportsETC2 = version && (strstr(version, "OpenGL ES 3") || isAvailable("ES3_compatibility"));
+    supportsASTC = isAvailable("texture_compression_astc_ldr");
+
+    // Uniform blocks of GLSL ES 3.00, style shaders are only translated to it on GLES3
+    supportsUniformBuffers = version && strstr(version, "OpenGL ES 3");
+
+    // Core in GLES3, EXT or ARB extension otherwise
+    supportsMapBufferRange = (version && strstr(version, "OpenGL ES 3")) || isAvailable("map_buffer_range");
+
+    // KHR or ARB variant, both only add the completion status query
+    supportsParallelShaderCompile = isAvailable("parallel_shader_compile");
+
+    // GL_TIME_ELAPSED queries, core in desktop GL 3.3
+    timerQueryDisjoint = isAvailable("disjoint_timer_query");
+    supportsTimerQuery = timerQueryDisjoint || isAvailable("timer_query");
+
+    // Core in GLES3, ARB extensions on desktop GL; the buffer is mapped for reading
+    supportsPixelBufferReadback = supportsMapBufferRange &&
+        ((version && strstr(version, "OpenGL ES 3")) ||
+         (isAvailable("pixel_buffer_object") && isAvailable("ARB_sync")));
 
     LOG("Driver supports map buffer: %d", supportsMapBuffer);
+    LOG("Driver supports map buffer range: %d", supportsMapBufferRange);
     LOG("Driver supports vaos: %d", supportsVAOs);
     LOG("Driver supports rgb8_rgba8: %d", supportsGLRGBA8OES);
     LOG("Driver supports NPOT texture: %d", supportsTextureNPOT);
+    LOG("Driver supports program binary: %d", supportsProgramBinary);
+    LOG("Driver supports instanced arrays: %d", supportsInstancing);
+    LOG("Driver supports 32 bit indices: %d", supportsElementIndexUint);
+    LOG("Driver supports ETC2 textures: %d", supportsETC2);
+    LOG("Driver supports ASTC textures: %d", supportsASTC);
+    LOG("Driver supports timer queries: %d", supportsTimerQuery);
+    LOG("Driver supports pixel buffer readback: %d", supportsPixelBufferReadback);
+    LOG("Driver supports uniform buffers: %d", supportsUniformBuffers);
+    LOG("Driver supports parallel shader compile: %d", supportsParallelShaderCompile);
 
     // find extension symbols if needed
     initGLExtensions();
@@ -74,8 +126,29 @@ void loadCapabilities() {
     GL::getIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &val);
     maxCombinedTextureUnits = val;
 
+    if (supportsProgramBinary) {
+        val = 0;
+        GL::getIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &val);
+        supportsProgramBinary = val > 0;
+    }
+
+    auto glString = [](GLenum name) {
+        auto str = reinterpret_cast<const char*>(GL::getString(name));
+        return str ? std::string(str) : std::string();
+    };
+    driverInfo = glString(GL_VENDOR) + " " + glString(GL_RENDERER) + " " + glString(GL_VERSION);
+
+    // GLES2 era mobile GPUs, which are fill rate bound with per fragment lighting
+    static const char* vertexLightingRenderers[] = {
+        "Mali-2", "Mali-3", "Mali-4", "Adreno (TM) 2", "Adreno (TM) 3", "PowerVR SGX", "Tegra 2", "Tegra 3",
+    };
+    std::string renderer = glString(GL_RENDERER);
+    prefersVertexLighting = std::any_of(std::begin(vertexLightingRenderers), std::end(vertexLightingRenderers),
+                                        [&](const char* name) { return renderer.find(name) != std::string::npos; });
+
     LOG("Hardware max texture size %d", maxTextureSize);
     LOG("Hardware max combined texture units %d", maxCombinedTextureUnits);
+    LOG("Hardware prefers vertex lighting: %d", prefersVertexLighting);
 }
 
 }
@@ -6,11 +6,30 @@ namespace Tangram {
 namespace Hardware {
 
 extern bool supportsMapBuffer;
+extern bool supportsMapBufferRange;
 extern bool supportsVAOs;
 extern bool supportsTextureNPOT;
 extern bool supportsGLRGBA8OES;
+extern bool supportsProgramBinary;
+extern bool supportsInstancing;
+extern bool supportsElementIndexUint;
+extern bool supportsETC2;
+extern bool supportsASTC;
+extern bool supportsTimerQuery;
+// Framebuffer reads into pixel pack buffers that are fenced and mapped later
+extern bool supportsPixelBufferReadback;
+// Shared uniform blocks of style programs, with GLSL ES 3.00 shaders
+extern bool supportsUniformBuffers;
+// Background compile and link of programs with KHR_parallel_shader_compile
+extern bool supportsParallelShaderCompile;
+// GPUs for which styles use vertex instead of fragment lighting
+extern bool prefersVertexLighting;
+// Set with timer queries of GL_EXT_disjoint_timer_query, which need a check for GL_GPU_DISJOINT
+extern bool timerQueryDisjoint;
 extern uint32_t maxTextureSize;
 extern uint32_t maxCombinedTextureUnits;
+// GL vendor, renderer and version of the current context
+extern std::string driverInfo;
 
 void loadCapabilities();
 void loadExtensions();
@@ -6,8 +6,39 @@
 #include "platform.h"
 #include "log.h"
 
+#include <algorithm>
+#include <memory>
+
 namespace Tangram {
 
+constexpr size_t MeshBase::CHUNK_INDICES;
+
+bool MeshBounds::isOutside(const glm::mat4& _toClip) const {
+    if (empty()) { return true; }
+
+    // Outside when all corners are on the outer side of one clip plane.
+    // Near and far planes are not tested: the vertex shaders offset depth
+    // by layer order after the projection.
+    int outside = 0xf;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner((i & 1) ? max.x : min.x,
+                         (i & 2) ? max.y : min.y,
+                         (i & 4) ? max.z : min.z, 1.f);
+        glm::vec4 c = _toClip * corner;
+
+        int code = 0;
+        if (c.x < -c.w) { code |= 1; }
+        if (c.x > c.w) { code |= 2; }
+        if (c.y < -c.w) { code |= 4; }
+        if (c.y > c.w) { code |= 8; }
+
+        outside &= code;
+        if (outside == 0) { return false; }
+    }
+    return true;
+}
+
 
 MeshBase::MeshBase() {
     m_drawMode = GL_TRIANGLES;
@@ -22,6 +53,7 @@ MeshBase::MeshBase() {
     m_dirty = false;
     m_isUploaded = false;
     m_isCompiled = false;
+    m_isReleased = false;
 }
 
 MeshBase::MeshBase(std::shared_ptr<VertexLayout> _vertexLayout, GLenum _drawMode, GLenum _hint)
@@ -34,7 +66,9 @@ MeshBase::MeshBase(std::shared_ptr<VertexLayout> _vertexLayout, GLenum _drawMode
 }
 
 MeshBase::~MeshBase() {
-    if (m_rs) {
+    if (m_allocation) {
+        BufferPool::release(m_allocation);
+    } else if (m_rs) {
         if (m_glVertexBuffer || m_glIndexBuffer) {
             GLuint buffers[] = { m_glVertexBuffer, m_glIndexBuffer };
             m_rs->queueBufferDeletion(2, buffers);
@@ -109,6 +143,27 @@ void MeshBase::subDataUpload(RenderState& rs, GLbyte* _data) {
 
 void MeshBase::upload(RenderState& rs) {
 
+    // Static meshes share the buffers of the pool with other meshes
+    if (rs.bufferPool && m_hint == GL_STATIC_DRAW && !m_allocation &&
+        rs.bufferPool->allocate(rs, m_vertexLayout->getStride(),
+                                m_glVertexData, m_nVertices * m_vertexLayout->getStride(),
+                                m_glIndexData, m_glIndexData ? m_nIndices * indexSize() : 0,
+                                m_indexType, m_allocation)) {
+
+        m_glVertexBuffer = m_allocation.page->vertexBuffer;
+        m_glIndexBuffer = m_glIndexData ? m_allocation.page->indexBuffer : 0;
+
+        delete[] m_glVertexData;
+        m_glVertexData = nullptr;
+        delete[] m_glIndexData;
+        m_glIndexData = nullptr;
+
+        m_rs = &rs;
+        m_isUploaded = true;
+        m_isReleased = false;
+        return;
+    }
+
     // Generate vertex buffer, if needed
     if (m_glVertexBuffer == 0) {
         GL::genBuffers(1, &m_glVertexBuffer);
@@ -132,7 +187,7 @@ void MeshBase::upload(RenderState& rs) {
         // Buffer element index data
         rs.indexBuffer(m_glIndexBuffer);
 
-        GL::bufferData(GL_ELEMENT_ARRAY_BUFFER, m_nIndices * sizeof(GLushort), m_glIndexData, m_hint);
+        GL::bufferData(GL_ELEMENT_ARRAY_BUFFER, m_nIndices * indexSize(), m_glIndexData, m_hint);
 
         delete[] m_glIndexData;
         m_glIndexData = nullptr;
@@ -141,10 +196,75 @@ void MeshBase::upload(RenderState& rs) {
     m_rs = &rs;
 
     m_isUploaded = true;
+    m_isReleased = false;
+}
+
+static bool readBuffer(GLenum _target, size_t _offset, size_t _size, GLbyte* _out) {
+    auto* data = static_cast<const GLbyte*>(GL::mapBufferRange(_target, _offset, _size, GL_MAP_READ_BIT));
+    if (!data) { return false; }
+
+    std::memcpy(_out, data, _size);
+
+    // The data store got corrupted when unmapping fails
+    return GL::unmapBuffer(_target);
 }
 
-bool MeshBase::draw(RenderState& rs, ShaderProgram& _shader, bool _useVao) {
-    bool useVao = _useVao && Hardware::supportsVAOs;
+size_t MeshBase::releaseBuffers(RenderState& rs) {
+
+    if (!m_isUploaded || m_hint != GL_STATIC_DRAW || m_dirty || m_nVertices == 0 ||
+        !Hardware::supportsMapBufferRange) {
+        return 0;
+    }
+
+    size_t stride = m_vertexLayout->getStride();
+    size_t vertexBytes = m_nVertices * stride;
+    size_t indexBytes = m_nIndices * indexSize();
+
+    auto vertices = std::make_unique<GLbyte[]>(vertexBytes);
+    auto indices = std::make_unique<GLbyte[]>(indexBytes);
+
+    rs.vertexBuffer(m_glVertexBuffer);
+    if (!readBuffer(GL_ARRAY_BUFFER, m_allocation.vertexOffset, vertexBytes, vertices.get())) {
+        return 0;
+    }
+    if (indexBytes > 0) {
+        rs.indexBuffer(m_glIndexBuffer);
+        if (!readBuffer(GL_ELEMENT_ARRAY_BUFFER, m_allocation.indexOffset, indexBytes, indices.get())) {
+            return 0;
+        }
+    }
+
+    if (m_allocation) {
+        // Pooled indices are rebased to the start of the page
+        size_t baseVertex = m_allocation.vertexOffset / stride;
+        if (baseVertex > 0) {
+            auto* index = reinterpret_cast<GLushort*>(indices.get());
+            for (size_t i = 0; i < m_nIndices; i++) { index[i] -= baseVertex; }
+        }
+        BufferPool::release(m_allocation);
+    } else {
+        GLuint buffers[] = { m_glVertexBuffer, m_glIndexBuffer };
+        rs.queueBufferDeletion(2, buffers);
+        m_vaos.dispose(rs);
+    }
+    m_glVertexBuffer = 0;
+    m_glIndexBuffer = 0;
+
+    m_glVertexData = vertices.release();
+    m_glIndexData = indexBytes > 0 ? indices.release() : nullptr;
+
+    m_isUploaded = false;
+    m_isReleased = true;
+
+    return vertexBytes + indexBytes;
+}
+
+bool MeshBase::draw(RenderState& rs, ShaderProgram& _shader, bool _useVao, const glm::mat4* _toClip) {
+    // Indexed meshes in a shared buffer page draw through the VAO of the
+    // page, as their indices are relative to the start of the page
+    bool pageVao = _useVao && Hardware::supportsVAOs && m_allocation &&
+        m_nIndices > 0 && m_vertexOffsets.size() == 1;
+    bool useVao = _useVao && Hardware::supportsVAOs && !m_allocation;
 
     if (!m_isCompiled) { return false; }
     if (m_nVertices == 0) { return false; }
@@ -161,7 +281,13 @@ bool MeshBase::draw(RenderState& rs, ShaderProgram& _shader, bool _useVao) {
         subDataUpload(rs);
     }
 
-    if (useVao) {
+    bool cull = _toClip && !m_chunks.empty();
+
+    if (cull && m_bounds.isOutside(*_toClip)) { return true; }
+
+    if (pageVao) {
+        m_allocation.page->vertexArray(_shader, *m_vertexLayout).bind(0);
+    } else if (useVao) {
         if (!m_vaos.isInitialized()) {
             // Capture vao state
             m_vaos.initialize(rs, _shader, m_vertexOffsets, *m_vertexLayout, m_glVertexBuffer, m_glIndexBuffer);
@@ -175,15 +301,18 @@ bool MeshBase::draw(RenderState& rs, ShaderProgram& _shader, bool _useVao) {
         }
     }
 
-    size_t indiceOffset = 0;
-    size_t vertexOffset = 0;
+    size_t indiceOffset = m_allocation.indexOffset / indexSize();
+    // Pooled indices already include the vertex offset in the page
+    size_t vertexOffset = (m_nIndices > 0) ? 0 : m_allocation.vertexOffset / m_vertexLayout->getStride();
 
     for (size_t i = 0; i < m_vertexOffsets.size(); ++i) {
         auto& o = m_vertexOffsets[i];
         uint32_t nIndices = o.first;
         uint32_t nVertices = o.second;
 
-        if (!useVao) {
+        if (pageVao) {
+            // Bound above
+        } else if (!useVao) {
             // Enable vertex attribs via vertex layout object
             size_t byteOffset = vertexOffset * m_vertexLayout->getStride();
             m_vertexLayout->enable(rs,  _shader, byteOffset);
@@ -193,36 +322,197 @@ bool MeshBase::draw(RenderState& rs, ShaderProgram& _shader, bool _useVao) {
         }
 
         // Draw as elements or arrays
-        if (nIndices > 0) {
-            GL::drawElements(m_drawMode, nIndices, GL_UNSIGNED_SHORT,
-                             (void*)(indiceOffset * sizeof(GLushort)));
+        if (nIndices > 0 && cull) {
+            drawChunks(rs, *_toClip, i, indiceOffset);
+        } else if (nIndices > 0) {
+            GL::drawElements(m_drawMode, nIndices, m_indexType,
+                             (void*)(indiceOffset * indexSize()));
+            rs.countDrawCall();
         } else if (nVertices > 0) {
             GL::drawArrays(m_drawMode, 0, nVertices);
+            rs.countDrawCall();
         }
 
         vertexOffset += nVertices;
         indiceOffset += nIndices;
     }
 
-    if (useVao) {
+    if (useVao || pageVao) {
         m_vaos.unbind();
     }
 
     return true;
 }
 
+bool MeshBase::drawChunks(RenderState& rs, const glm::mat4& _toClip, size_t _batch, size_t _indiceOffset) {
+
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), _batch,
+                               [](const Chunk& c, size_t b) { return c.batch < b; });
+
+    // Chunks of a batch are consecutive, merge runs of visible ones
+    size_t runStart = 0;
+    size_t runIndices = 0;
+    bool drawn = false;
+
+    auto flush = [&]() {
+        if (runIndices == 0) { return; }
+        GL::drawElements(m_drawMode, runIndices, m_indexType,
+                         (void*)((_indiceOffset + runStart) * indexSize()));
+        rs.countDrawCall();
+        runIndices = 0;
+        drawn = true;
+    };
+
+    for (; it != m_chunks.end() && it->batch == _batch; ++it) {
+        if (it->bounds.isOutside(_toClip)) {
+            flush();
+            continue;
+        }
+        if (runIndices == 0) { runStart = it->indexOffset; }
+        runIndices += it->nIndices;
+    }
+    flush();
+
+    return drawn;
+}
+
 size_t MeshBase::bufferSize() const {
-    return m_nVertices * m_vertexLayout->getStride() + m_nIndices * sizeof(GLushort);
+    return m_nVertices * m_vertexLayout->getStride() + m_nIndices * indexSize();
+}
+
+template<class T>
+static void put(std::vector<char>& _out, const T& _value) {
+    auto bytes = reinterpret_cast<const char*>(&_value);
+    _out.insert(_out.end(), bytes, bytes + sizeof(T));
+}
+
+template<class T>
+static bool get(const char*& _pos, const char* _end, T& _value) {
+    if (size_t(_end - _pos) < sizeof(T)) { return false; }
+    std::memcpy(&_value, _pos, sizeof(T));
+    _pos += sizeof(T);
+    return true;
+}
+
+template<class T>
+static void putArray(std::vector<char>& _out, const std::vector<T>& _values) {
+    put(_out, uint32_t(_values.size()));
+    auto bytes = reinterpret_cast<const char*>(_values.data());
+    _out.insert(_out.end(), bytes, bytes + _values.size() * sizeof(T));
+}
+
+template<class T>
+static bool getArray(const char*& _pos, const char* _end, std::vector<T>& _values) {
+    uint32_t count = 0;
+    if (!get(_pos, _end, count) || size_t(_end - _pos) / sizeof(T) < count) { return false; }
+    _values.resize(count);
+    std::memcpy(_values.data(), _pos, count * sizeof(T));
+    _pos += count * sizeof(T);
+    return true;
+}
+
+bool MeshBase::serialize(std::vector<char>& _out) const {
+
+    if (!m_isCompiled || m_isUploaded || (m_nVertices > 0 && !m_glVertexData)) { return false; }
+
+    size_t vertexBytes = m_nVertices * m_vertexLayout->getStride();
+    size_t indexBytes = m_glIndexData ? m_nIndices * indexSize() : 0;
+
+    put(_out, uint32_t(m_vertexLayout->getStride()));
+    put(_out, uint32_t(m_drawMode));
+    put(_out, uint64_t(m_nVertices));
+    _out.insert(_out.end(), m_glVertexData, m_glVertexData + vertexBytes);
+
+    put(_out, uint64_t(indexBytes ? m_nIndices : 0));
+    put(_out, uint32_t(m_indexType));
+    _out.insert(_out.end(), m_glIndexData, m_glIndexData + indexBytes);
+
+    putArray(_out, m_vertexOffsets);
+    putArray(_out, m_chunks);
+    put(_out, m_bounds);
+
+    return true;
+}
+
+bool MeshBase::deserialize(const char*& _pos, const char* _end) {
+
+    uint32_t stride = 0, drawMode = 0, indexType = 0;
+    uint64_t nVertices = 0, nIndices = 0;
+
+    if (!get(_pos, _end, stride) || stride != uint32_t(m_vertexLayout->getStride()) ||
+        !get(_pos, _end, drawMode) || drawMode != m_drawMode ||
+        !get(_pos, _end, nVertices) || size_t(_end - _pos) / stride < nVertices) {
+        return false;
+    }
+    const char* vertices = _pos;
+    _pos += nVertices * stride;
+
+    if (!get(_pos, _end, nIndices) || !get(_pos, _end, indexType)) { return false; }
+    if (indexType != GL_UNSIGNED_SHORT &&
+        (indexType != GL_UNSIGNED_INT || !Hardware::supportsElementIndexUint)) {
+        return false;
+    }
+    m_indexType = indexType;
+    if (size_t(_end - _pos) / indexSize() < nIndices) { return false; }
+    const char* indices = _pos;
+    _pos += nIndices * indexSize();
+
+    if (!getArray(_pos, _end, m_vertexOffsets) ||
+        !getArray(_pos, _end, m_chunks) ||
+        !get(_pos, _end, m_bounds)) {
+        return false;
+    }
+
+    // Batches and chunks must stay within the buffers
+    uint64_t sumIndices = 0, sumVertices = 0;
+    for (auto& offset : m_vertexOffsets) {
+        sumIndices += offset.first;
+        sumVertices += offset.second;
+    }
+    bool valid = m_vertexOffsets.empty() || (sumIndices == nIndices && sumVertices == nVertices);
+    for (auto& chunk : m_chunks) {
+        valid &= chunk.batch < m_vertexOffsets.size() &&
+            uint64_t(chunk.indexOffset) + chunk.nIndices <= m_vertexOffsets[chunk.batch].first;
+        if (!valid) { break; }
+    }
+    if (!valid) {
+        m_vertexOffsets.clear();
+        m_chunks.clear();
+        return false;
+    }
+
+    m_nVertices = nVertices;
+    m_glVertexData = new GLbyte[nVertices * stride];
+    std::memcpy(m_glVertexData, vertices, nVertices * stride);
+
+    m_nIndices = nIndices;
+    if (nIndices > 0) {
+        m_glIndexData = new GLbyte[nIndices * indexSize()];
+        std::memcpy(m_glIndexData, indices, nIndices * indexSize());
+    }
+
+    m_isCompiled = true;
+    return true;
+}
+
+void MeshBase::allocateIndices() {
+    m_indexType = (m_nVertices > MAX_INDEX_VALUE && Hardware::supportsElementIndexUint)
+        ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
+    m_glIndexData = new GLbyte[m_nIndices * indexSize()];
 }
 
 // Add indices by collecting them into batches to draw as much as
 // possible in one draw call.  The indices must be shifted by the
 // number of vertices that are present in the current batch.
 size_t MeshBase::compileIndices(const std::vector<std::pair<uint32_t, uint32_t>>& _offsets,
-                                const std::vector<uint16_t>& _indices, size_t _offset) {
+                                const std::vector<uint16_t>& _indices, size_t _offset,
+                                const std::vector<MeshBounds>* _bounds) {
 
 
-    GLushort* dst = m_glIndexData + _offset;
+    GLushort* dst16 = reinterpret_cast<GLushort*>(m_glIndexData);
+    GLuint* dst32 = reinterpret_cast<GLuint*>(m_glIndexData);
+    size_t dst = _offset;
     size_t curVertices = 0;
     size_t src = 0;
 
@@ -232,19 +522,41 @@ size_t MeshBase::compileIndices(const std::vector<std::pair<uint32_t, uint32_t>>
         curVertices = m_vertexOffsets.back().second;
     }
 
-    for (auto& p : _offsets) {
-        size_t nIndices = p.first;
-        size_t nVertices = p.second;
+    for (size_t k = 0; k < _offsets.size(); k++) {
+        size_t nIndices = _offsets[k].first;
+        size_t nVertices = _offsets[k].second;
 
-        if (curVertices + nVertices > MAX_INDEX_VALUE) {
-            m_vertexOffsets.emplace_back(0, 0);
-            curVertices = 0;
-        }
-        for (size_t i = 0; i < nIndices; i++, dst++) {
-            *dst = _indices[src++] + curVertices;
+        if (m_indexType == GL_UNSIGNED_INT) {
+            // All vertices are addressable from one batch
+            for (size_t i = 0; i < nIndices; i++) {
+                dst32[dst++] = _indices[src++] + curVertices;
+            }
+        } else {
+            if (curVertices + nVertices > MAX_INDEX_VALUE) {
+                m_vertexOffsets.emplace_back(0, 0);
+                curVertices = 0;
+            }
+            for (size_t i = 0; i < nIndices; i++) {
+                dst16[dst++] = _indices[src++] + curVertices;
+            }
         }
 
         auto& offset = m_vertexOffsets.back();
+
+        if (_bounds) {
+            // Add the feature to the last chunk of the batch, or start
+            // a new one when it would exceed CHUNK_INDICES
+            uint32_t batch = m_vertexOffsets.size() - 1;
+            if (m_chunks.empty() || m_chunks.back().batch != batch ||
+                (m_chunks.back().nIndices > 0 &&
+                 m_chunks.back().nIndices + nIndices > CHUNK_INDICES)) {
+                m_chunks.push_back({ batch, offset.first, 0, {} });
+            }
+            auto& chunk = m_chunks.back();
+            chunk.nIndices += nIndices;
+            chunk.bounds.extend((*_bounds)[k]);
+            m_bounds.extend((*_bounds)[k]);
+        }
         offset.first += nIndices;
         offset.second += nVertices;
 
@@ -1,22 +1,58 @@
 #pragma once
 
 #include "gl.h"
+#include "gl/bufferPool.h"
 #include "gl/vertexLayout.h"
 #include "gl/vao.h"
 #include "style/style.h"
 #include "util/types.h"
 #include "platform.h"
 
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+
 #include <string>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include <cstring> // for memcpy
 #include <cassert>
+#include <limits>
 
 #define MAX_INDEX_VALUE 65535 // Maximum value of GLushort
 
 namespace Tangram {
 
+/*
+ * Axis aligned box of mesh geometry in the coordinates of its vertices
+ * (tile units). Empty until extended.
+ */
+struct MeshBounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    bool empty() const { return min.x > max.x; }
+
+    void extend(const glm::vec3& _point) {
+        min = glm::min(min, _point);
+        max = glm::max(max, _point);
+    }
+
+    void extend(const MeshBounds& _bounds) {
+        min = glm::min(min, _bounds.min);
+        max = glm::max(max, _bounds.max);
+    }
+
+    // Grow in x and y, e.g. by the extrusion of lines in the vertex shader
+    void grow(float _margin) {
+        min.x -= _margin; min.y -= _margin;
+        max.x += _margin; max.y += _margin;
+    }
+
+    // Whether the box is certainly outside of the clip volume
+    bool isOutside(const glm::mat4& _toClip) const;
+};
+
 /*
  * Mesh - Drawable collection of geometry contained in a vertex buffer and
  * (optionally) an index buffer
@@ -60,6 +96,14 @@ public:
      */
     virtual void upload(RenderState& rs);
 
+    /*
+     * Read the uploaded geometry of a static mesh back into CPU memory and
+     * release its GPU buffers; the geometry is uploaded again by the next
+     * upload() or draw(). Returns the number of bytes read back, 0 when the
+     * buffers can't be mapped for reading.
+     */
+    size_t releaseBuffers(RenderState& rs);
+
     /*
      * Sub data upload of the mesh, returns true if this results in a buffer binding
      */
@@ -69,16 +113,46 @@ public:
      * Renders the geometry in this mesh using the ShaderProgram _shader; if
      * geometry has not already been uploaded it will be uploaded at this point
      */
-    bool draw(RenderState& rs, ShaderProgram& _shader, bool _useVao = true);
+    bool draw(RenderState& rs, ShaderProgram& _shader, bool _useVao = true,
+              const glm::mat4* _toClip = nullptr);
 
     size_t bufferSize() const;
 
+    // Maximum number of indices in one culling chunk
+    static constexpr size_t CHUNK_INDICES = 3072;
+
 protected:
 
+    /*
+     * Append the compiled vertices, indices and batches to _out. Returns false
+     * when there is nothing to write, i.e. the mesh is not compiled or its
+     * data was released on upload.
+     */
+    bool serialize(std::vector<char>& _out) const;
+
+    /*
+     * Read geometry written by serialize() starting at _pos, for a mesh of
+     * the same vertex layout; the mesh is compiled afterwards. Returns false
+     * for invalid data or indices the driver can't draw.
+     */
+    bool deserialize(const char*& _pos, const char* _end);
+
     // Used in draw for legth and offsets: sumIndices, sumVertices
     // needs to be set by compile()
     std::vector<std::pair<uint32_t, uint32_t>> m_vertexOffsets;
 
+    // Consecutive index ranges of m_vertexOffsets batches with their
+    // bounds. Empty when the mesh was compiled without bounds.
+    struct Chunk {
+        uint32_t batch;
+        // Index range relative to the start of the batch
+        uint32_t indexOffset;
+        uint32_t nIndices;
+        MeshBounds bounds;
+    };
+    std::vector<Chunk> m_chunks;
+    MeshBounds m_bounds;
+
     std::shared_ptr<VertexLayout> m_vertexLayout;
 
     size_t m_nVertices;
@@ -91,8 +165,18 @@ protected:
 
     size_t m_nIndices;
     GLuint m_glIndexBuffer;
-    // Compiled  indices for upload
-    GLushort* m_glIndexData = nullptr;
+    // Compiled indices for upload, GLushort or GLuint by m_indexType
+    GLbyte* m_glIndexData = nullptr;
+    // GL_UNSIGNED_INT for meshes with more vertices than 16 bit indices
+    // address, when the driver supports it. Such meshes draw in one call.
+    GLenum m_indexType = GL_UNSIGNED_SHORT;
+
+    size_t indexSize() const {
+        return m_indexType == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort);
+    }
+
+    // Choose m_indexType for m_nVertices and allocate m_glIndexData
+    void allocateIndices();
 
     GLenum m_drawMode;
     GLenum m_hint;
@@ -100,14 +184,22 @@ protected:
     bool m_isUploaded;
     bool m_isCompiled;
     bool m_dirty;
+    // Set while the geometry is held in CPU memory after releaseBuffers()
+    bool m_isReleased;
 
     RenderState* m_rs = nullptr;
 
+    // Location in RenderState::bufferPool, when uploaded into a pooled buffer
+    BufferPool::Allocation m_allocation;
+
     GLsizei m_dirtySize;
     GLintptr m_dirtyOffset;
 
     size_t compileIndices(const std::vector<std::pair<uint32_t, uint32_t>>& _offsets,
-                          const std::vector<uint16_t>& _indices, size_t _offset);
+                          const std::vector<uint16_t>& _indices, size_t _offset,
+                          const std::vector<MeshBounds>* _bounds = nullptr);
+
+    bool drawChunks(RenderState& rs, const glm::mat4& _toClip, size_t _batch, size_t _indiceOffset);
 
     void setDirty(GLintptr _byteOffset, GLsizei _byteSize);
 };
@@ -125,12 +217,32 @@ struct MeshData {
     std::vector<uint16_t> indices;
     std::vector<T> vertices;
     std::vector<std::pair<uint32_t, uint32_t>> offsets;
+    // Optional bounds of the geometry of each entry in offsets, which
+    // let the mesh skip parts outside of the view
+    std::vector<MeshBounds> bounds;
+
+    // Reserve space for _vertices and _indices more, growing geometrically
+    // so that reserving for each added feature stays amortized
+    void reserve(size_t _vertices, size_t _indices) {
+        reserve(vertices, vertices.size() + _vertices);
+        reserve(indices, indices.size() + _indices);
+    }
 
     void clear() {
         offsets.clear();
+        bounds.clear();
         indices.clear();
         vertices.clear();
     }
+
+private:
+
+    template<class V>
+    static void reserve(std::vector<V>& _vector, size_t _size) {
+        if (_size > _vector.capacity()) {
+            _vector.reserve(std::max(_size, 2 * _vector.capacity()));
+        }
+    }
 };
 
 template<class T>
@@ -147,10 +259,42 @@ public:
         return MeshBase::bufferSize();
     }
 
+    size_t vertexCount() const override {
+        return m_nVertices;
+    }
+
     bool draw(RenderState& rs, ShaderProgram& shader, bool useVao = true) override {
         return MeshBase::draw(rs, shader, useVao);
     }
 
+    bool drawVisible(RenderState& rs, ShaderProgram& shader, const glm::mat4& _tileToClip) override {
+        return MeshBase::draw(rs, shader, true, &_tileToClip);
+    }
+
+    bool isUploaded() const override {
+        return m_isUploaded || !m_isCompiled || m_nVertices == 0;
+    }
+
+    size_t uploadBuffers(RenderState& rs) override {
+        if (isUploaded()) { return 0; }
+
+        size_t bytes = bufferSize();
+        MeshBase::upload(rs);
+        return bytes;
+    }
+
+    size_t releaseBuffers(RenderState& rs) override {
+        return MeshBase::releaseBuffers(rs);
+    }
+
+    bool isReleased() const override {
+        return m_isReleased;
+    }
+
+    bool serialize(std::vector<char>& _out) const override {
+        return MeshBase::serialize(_out);
+    }
+
     void compile(const std::vector<MeshData<T>>& _meshes);
 
     void compile(const MeshData<T>& _mesh);
@@ -199,11 +343,17 @@ void Mesh<T>::compile(const std::vector<MeshData<T>>& _meshes) {
     assert(offset == m_nVertices * stride);
 
     if (m_nIndices > 0) {
-        m_glIndexData = new GLushort[m_nIndices];
+        allocateIndices();
+
+        bool hasBounds = true;
+        for (auto& m : _meshes) {
+            hasBounds &= m.bounds.size() == m.offsets.size();
+        }
 
         size_t offset = 0;
         for (auto& m : _meshes) {
-            offset = compileIndices(m.offsets, m.indices, offset);
+            offset = compileIndices(m.offsets, m.indices, offset,
+                                    hasBounds ? &m.bounds : nullptr);
         }
         assert(offset == m_nIndices);
     }
@@ -225,8 +375,11 @@ void Mesh<T>::compile(const MeshData<T>& _mesh) {
                 m_nVertices * stride);
 
     if (m_nIndices > 0) {
-        m_glIndexData = new GLushort[m_nIndices];
-        compileIndices(_mesh.offsets, _mesh.indices, 0);
+        allocateIndices();
+
+        bool hasBounds = _mesh.bounds.size() == _mesh.offsets.size();
+        compileIndices(_mesh.offsets, _mesh.indices, 0,
+                       hasBounds ? &_mesh.bounds : nullptr);
     }
 
     m_isCompiled = true;
@@ -103,6 +103,31 @@ void drawRect(RenderState& rs, const glm::vec2& _origin, const glm::vec2& _desti
     drawLine(rs, {_origin.x,_destination.y}, _origin);
 }
 
+void fillRect(RenderState& rs, const glm::vec2& _origin, const glm::vec2& _destination) {
+    init();
+
+    if (!s_shader->use(rs)) { return; }
+
+    GLint boundBuffer;
+    GL::getIntegerv(GL_ARRAY_BUFFER_BINDING, &boundBuffer);
+    rs.vertexBuffer(0);
+    rs.depthTest(GL_FALSE);
+
+    glm::vec2 verts[4] = {
+        _origin,
+        { _destination.x, _origin.y },
+        _destination,
+        { _origin.x, _destination.y }
+    };
+
+    // enable the layout for the rect vertices
+    s_layout->enable(rs, *s_shader, 0, &verts);
+
+    GL::drawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+    rs.vertexBuffer(boundBuffer);
+}
+
 void drawPoly(RenderState& rs, const glm::vec2* _polygon, size_t _n) {
     init();
 
@@ -24,6 +24,9 @@ void drawLine(RenderState& rs, const glm::vec2& _origin, const glm::vec2& _desti
 /* Draws a rect from _origin to _destination for the screen resolution _resolution */
 void drawRect(RenderState& rs, const glm::vec2& _origin, const glm::vec2& _destination);
 
+/* Fills a rect from _origin to _destination for the screen resolution _resolution */
+void fillRect(RenderState& rs, const glm::vec2& _origin, const glm::vec2& _destination);
+
 /* Draws a polyon of containing _n points in screen space for the screen resolution _resolution */
 void drawPoly(RenderState& rs, const glm::vec2* _polygon, size_t _n);
 
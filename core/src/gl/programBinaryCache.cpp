@@ -0,0 +1,113 @@
+#include "gl/programBinaryCache.h"
+
+#include "gl/hardware.h"
+#include "log.h"
+
+#include "hash-library/md5.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Tangram {
+
+static const char MAGIC[4] = { 'T', 'G', 'P', 'B' };
+
+std::string ProgramBinaryCache::path(const std::string& _vertSrc, const std::string& _fragSrc) const {
+    MD5 md5;
+    md5.add(_vertSrc.data(), _vertSrc.size());
+    md5.add("\0", 1);
+    md5.add(_fragSrc.data(), _fragSrc.size());
+    return m_directory + "/" + md5.getHash() + ".bin";
+}
+
+GLuint ProgramBinaryCache::load(const std::string& _vertSrc, const std::string& _fragSrc) {
+    if (!Hardware::supportsProgramBinary) { return 0; }
+
+    std::string file = path(_vertSrc, _fragSrc);
+    FILE* in = fopen(file.c_str(), "rb");
+    if (!in) { return 0; }
+
+    std::vector<char> data;
+    char buffer[16 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(in);
+
+    // Header: magic, version, driver info length, driver info, binary format
+    const char* pos = data.data();
+    const char* end = pos + data.size();
+    uint32_t version = 0, driverLength = 0, format = 0;
+
+    if (data.size() < sizeof(MAGIC) + 3 * sizeof(uint32_t) ||
+        std::memcmp(pos, MAGIC, sizeof(MAGIC)) != 0) { return 0; }
+    pos += sizeof(MAGIC);
+
+    std::memcpy(&version, pos, sizeof(version));
+    pos += sizeof(version);
+    std::memcpy(&driverLength, pos, sizeof(driverLength));
+    pos += sizeof(driverLength);
+
+    if (version != VERSION || size_t(end - pos) < driverLength + sizeof(format)) { return 0; }
+    if (Hardware::driverInfo.compare(0, std::string::npos, pos, driverLength) != 0) { return 0; }
+    pos += driverLength;
+
+    std::memcpy(&format, pos, sizeof(format));
+    pos += sizeof(format);
+
+    GLuint program = GL::createProgram();
+    GL::programBinary(program, format, pos, GLsizei(end - pos));
+
+    GLint isLinked = GL_FALSE;
+    GL::getProgramiv(program, GL_LINK_STATUS, &isLinked);
+
+    if (isLinked == GL_FALSE) {
+        GL::deleteProgram(program);
+        remove(file.c_str());
+        return 0;
+    }
+    return program;
+}
+
+bool ProgramBinaryCache::store(GLuint _program, const std::string& _vertSrc, const std::string& _fragSrc) {
+    if (!Hardware::supportsProgramBinary) { return false; }
+
+    GLint length = 0;
+    GL::getProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) { return false; }
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    GL::getProgramBinary(_program, length, &written, &format, binary.data());
+    if (written <= 0) { return false; }
+
+    std::string data(MAGIC, sizeof(MAGIC));
+    uint32_t header[] = { VERSION, uint32_t(Hardware::driverInfo.size()) };
+    data.append(reinterpret_cast<const char*>(header), sizeof(header));
+    data.append(Hardware::driverInfo);
+    uint32_t binaryFormat = format;
+    data.append(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+    data.append(binary.data(), written);
+
+    // Write to a temporary file and rename, so that readers never see
+    // partially written binaries
+    std::string file = path(_vertSrc, _fragSrc);
+    std::string tmpFile = file + ".tmp";
+    FILE* out = fopen(tmpFile.c_str(), "wb");
+    if (!out) { return false; }
+
+    bool ok = fwrite(data.data(), 1, data.size(), out) == data.size();
+    ok &= fclose(out) == 0;
+
+    if (!ok || rename(tmpFile.c_str(), file.c_str()) != 0) {
+        remove(tmpFile.c_str());
+        LOGW("Program binary cache: could not write '%s'", file.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
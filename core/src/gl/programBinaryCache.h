@@ -0,0 +1,39 @@
+#pragma once
+
+#include "gl.h"
+
+#include <string>
+
+namespace Tangram {
+
+/* Cache of linked shader program binaries in a directory
+ *
+ * Binaries are stored per program by the MD5 digest of its vertex and
+ * fragment source, together with the GL vendor, renderer and version of
+ * the driver that produced them. Binaries of another driver (or another
+ * VERSION of the file format) are ignored and replaced when the program
+ * has been built again.
+ */
+class ProgramBinaryCache {
+
+public:
+
+    static const uint32_t VERSION = 1;
+
+    explicit ProgramBinaryCache(std::string _directory) : m_directory(std::move(_directory)) {}
+
+    /* Returns a program created from the cached binary for these sources,
+     * or 0 when there is none or the driver rejects it */
+    GLuint load(const std::string& _vertSrc, const std::string& _fragSrc);
+
+    /* Store the binary of the linked _program built from these sources */
+    bool store(GLuint _program, const std::string& _vertSrc, const std::string& _fragSrc);
+
+private:
+
+    std::string path(const std::string& _vertSrc, const std::string& _fragSrc) const;
+
+    std::string m_directory;
+};
+
+}
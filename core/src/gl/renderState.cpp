@@ -3,6 +3,9 @@
 #include "gl/vertexLayout.h"
 #include "gl/glError.h"
 #include "gl/hardware.h"
+#include "gl/bufferPool.h"
+#include "gl/gpuTimer.h"
+#include "gl/programBinaryCache.h"
 #include "gl/texture.h"
 #include "log.h"
 #include "platform.h"
@@ -96,6 +99,12 @@ GLuint RenderState::getTextureUnit(GLuint _unit) {
 RenderState::~RenderState() {
 
     deleteQuadIndexBuffer();
+    if (m_quadCornerBuffer) {
+        GL::deleteBuffers(1, &m_quadCornerBuffer);
+    }
+    frameUniforms.dispose();
+    lightUniforms.dispose();
+    bufferPool.reset();
     flushResourceDeletion();
 
     for (auto& s : vertexShaders) {
@@ -158,6 +167,15 @@ void RenderState::invalidateHandles() {
         m_programDeletionList.clear();
         m_shaderDeletionList.clear();
     }
+
+    m_quadCornerBuffer = 0;
+    frameUniforms.invalidate();
+    lightUniforms.invalidate();
+
+    // Meshes of the old context keep their pages until they are released
+    if (bufferPool) { bufferPool->clear(); }
+
+    if (gpuTimer) { gpuTimer->invalidate(); }
 }
 
 void RenderState::cacheDefaultFramebuffer() {
@@ -196,6 +214,7 @@ inline void setGlFlag(GLenum flag, GLboolean enable) {
 bool RenderState::blending(GLboolean enable) {
     if (!m_blending.set || m_blending.enabled != enable) {
         m_blending = { enable, true };
+        m_frameStats.stateChanges++;
         setGlFlag(GL_BLEND, enable);
         return false;
     }
@@ -205,6 +224,7 @@ bool RenderState::blending(GLboolean enable) {
 bool RenderState::blendingFunc(GLenum sfactor, GLenum dfactor) {
     if (!m_blendingFunc.set || m_blendingFunc.sfactor != sfactor || m_blendingFunc.dfactor != dfactor) {
         m_blendingFunc = { sfactor, dfactor, true };
+        m_frameStats.stateChanges++;
         GL::blendFunc(sfactor, dfactor);
         return false;
     }
@@ -237,6 +257,7 @@ bool RenderState::clearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a) {
 bool RenderState::colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
     if (!m_colorMask.set || m_colorMask.r != r || m_colorMask.g != g || m_colorMask.b != b || m_colorMask.a != a) {
         m_colorMask = { r, g, b, a, true };
+        m_frameStats.stateChanges++;
         GL::colorMask(r, g, b, a);
         return false;
     }
@@ -246,6 +267,7 @@ bool RenderState::colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a)
 bool RenderState::cullFace(GLenum face) {
     if (!m_cullFace.set || m_cullFace.face != face) {
         m_cullFace = { face, true };
+        m_frameStats.stateChanges++;
         GL::cullFace(face);
         return false;
     }
@@ -255,6 +277,7 @@ bool RenderState::cullFace(GLenum face) {
 bool RenderState::culling(GLboolean enable) {
     if (!m_culling.set || m_culling.enabled != enable) {
         m_culling = { enable, true };
+        m_frameStats.stateChanges++;
         setGlFlag(GL_CULL_FACE, enable);
         return false;
     }
@@ -264,6 +287,7 @@ bool RenderState::culling(GLboolean enable) {
 bool RenderState::depthTest(GLboolean enable) {
     if (!m_depthTest.set || m_depthTest.enabled != enable) {
         m_depthTest = { enable, true };
+        m_frameStats.stateChanges++;
         setGlFlag(GL_DEPTH_TEST, enable);
         return false;
     }
@@ -273,6 +297,7 @@ bool RenderState::depthTest(GLboolean enable) {
 bool RenderState::depthMask(GLboolean enable) {
     if (!m_depthMask.set || m_depthMask.enabled != enable) {
         m_depthMask = { enable, true };
+        m_frameStats.stateChanges++;
         GL::depthMask(enable);
         return false;
     }
@@ -282,6 +307,7 @@ bool RenderState::depthMask(GLboolean enable) {
 bool RenderState::frontFace(GLenum face) {
     if (!m_frontFace.set || m_frontFace.face != face) {
         m_frontFace = { face, true };
+        m_frameStats.stateChanges++;
         GL::frontFace(face);
         return false;
     }
@@ -291,6 +317,7 @@ bool RenderState::frontFace(GLenum face) {
 bool RenderState::stencilMask(GLuint mask) {
     if (!m_stencilMask.set || m_stencilMask.mask != mask) {
         m_stencilMask = { mask, true };
+        m_frameStats.stateChanges++;
         GL::stencilMask(mask);
         return false;
     }
@@ -300,6 +327,7 @@ bool RenderState::stencilMask(GLuint mask) {
 bool RenderState::stencilFunc(GLenum func, GLint ref, GLuint mask) {
     if (!m_stencilFunc.set || m_stencilFunc.func != func || m_stencilFunc.ref != ref || m_stencilFunc.mask != mask) {
         m_stencilFunc = { func, ref, mask, true };
+        m_frameStats.stateChanges++;
         GL::stencilFunc(func, ref, mask);
         return false;
     }
@@ -309,6 +337,7 @@ bool RenderState::stencilFunc(GLenum func, GLint ref, GLuint mask) {
 bool RenderState::stencilOp(GLenum sfail, GLenum spassdfail, GLenum spassdpass) {
     if (!m_stencilOp.set || m_stencilOp.sfail != sfail || m_stencilOp.spassdfail != spassdfail || m_stencilOp.spassdpass != spassdpass) {
         m_stencilOp = { sfail, spassdfail, spassdpass, true };
+        m_frameStats.stateChanges++;
         GL::stencilOp(sfail, spassdfail, spassdpass);
         return false;
     }
@@ -318,6 +347,7 @@ bool RenderState::stencilOp(GLenum sfail, GLenum spassdfail, GLenum spassdpass)
 bool RenderState::stencilTest(GLboolean enable) {
     if (!m_stencilTest.set || m_stencilTest.enabled != enable) {
         m_stencilTest = { enable, true };
+        m_frameStats.stateChanges++;
         setGlFlag(GL_STENCIL_TEST, enable);
         return false;
     }
@@ -327,6 +357,7 @@ bool RenderState::stencilTest(GLboolean enable) {
 bool RenderState::shaderProgram(GLuint program) {
     if (!m_program.set || m_program.program != program) {
         m_program = { program, true };
+        m_frameStats.stateChanges++;
         GL::useProgram(program);
         return false;
     }
@@ -336,6 +367,7 @@ bool RenderState::shaderProgram(GLuint program) {
 bool RenderState::texture(GLenum target, GLuint handle) {
     if (!m_texture.set || m_texture.target != target || m_texture.handle != handle) {
         m_texture = { target, handle, true };
+        m_frameStats.stateChanges++;
         GL::bindTexture(target, handle);
         return false;
     }
@@ -384,6 +416,17 @@ GLuint RenderState::getQuadIndexBuffer() {
     return m_quadIndexBuffer;
 }
 
+GLuint RenderState::getQuadCornerBuffer() {
+    if (m_quadCornerBuffer == 0) {
+        const GLfloat corners[] = { -1, 1,  1, 1,  -1, -1,  1, -1 };
+
+        GL::genBuffers(1, &m_quadCornerBuffer);
+        vertexBuffer(m_quadCornerBuffer);
+        GL::bufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    }
+    return m_quadCornerBuffer;
+}
+
 void RenderState::deleteQuadIndexBuffer() {
     indexBufferUnset(m_quadIndexBuffer);
     GL::deleteBuffers(1, &m_quadIndexBuffer);
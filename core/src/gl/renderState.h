@@ -1,7 +1,9 @@
 #pragma once
 
 #include "gl.h"
+#include "gl/uniformBuffer.h"
 #include <array>
+#include <memory>
 #include <string>
 #include <mutex>
 #include <vector>
@@ -9,7 +11,10 @@
 
 namespace Tangram {
 
+class BufferPool;
+class GpuTimer;
 class Disposer;
+class ProgramBinaryCache;
 class Texture;
 
 class RenderState {
@@ -108,6 +113,10 @@ public:
 
     GLuint getQuadIndexBuffer();
 
+    // Vertex buffer of the four corners (-1/1) of an instanced quad in the
+    // vertex order of getQuadIndexBuffer
+    GLuint getQuadCornerBuffer();
+
     void flushResourceDeletion();
 
     void queueTextureDeletion(GLuint texture);
@@ -120,11 +129,51 @@ public:
 
     void queueProgramDeletion(GLuint program);
 
+    // Counters of the GL work issued since the last resetFrameStats()
+    struct FrameStats {
+        size_t drawCalls = 0;
+        // Blend, depth, stencil, program and texture state changes which
+        // were not filtered out as redundant
+        size_t stateChanges = 0;
+        // Programs built and the milliseconds spent on it, see ShaderProgram::isReady()
+        size_t programBuilds = 0;
+        float programBuildTime = 0;
+        // Styles not drawn while their programs build
+        size_t pendingPrograms = 0;
+    };
+
+    const FrameStats& frameStats() const { return m_frameStats; }
+
+    void resetFrameStats() { m_frameStats = {}; }
+
+    void countDrawCall() { m_frameStats.drawCalls++; }
+
+    void countProgramBuild(float _milliseconds) {
+        m_frameStats.programBuilds++;
+        m_frameStats.programBuildTime += _milliseconds;
+    }
+
+    void countPendingProgram() { m_frameStats.pendingPrograms++; }
+
     std::array<GLuint, MAX_ATTRIBUTES> attributeBindings = { { 0 } };
 
     std::unordered_map<std::string, GLuint> fragmentShaders;
     std::unordered_map<std::string, GLuint> vertexShaders;
 
+    // Optional persistent cache of linked programs
+    std::unique_ptr<ProgramBinaryCache> programBinaryCache;
+
+    // Optional shared buffers for static meshes
+    std::unique_ptr<BufferPool> bufferPool;
+
+    // Optional GPU timing of the draw passes, owned by the map
+    GpuTimer* gpuTimer = nullptr;
+
+    // Per-frame view and light uniforms of all style programs,
+    // only used with Hardware::supportsUniformBuffers
+    UniformBuffer frameUniforms{UniformBuffer::FRAME_BINDING};
+    UniformBuffer lightUniforms{UniformBuffer::LIGHTS_BINDING};
+
 private:
 
     std::mutex m_deletionListMutex;
@@ -141,6 +190,8 @@ private:
     void deleteQuadIndexBuffer();
     void generateQuadIndexBuffer();
 
+    GLuint m_quadCornerBuffer = 0;
+
     struct {
         GLboolean enabled;
         bool set;
@@ -224,6 +275,8 @@ private:
 
     GLint m_defaultFramebuffer = 0;
 
+    FrameStats m_frameStats;
+
 };
 
 }
@@ -1,16 +1,22 @@
 #include "gl/shaderProgram.h"
 
 #include "gl/glError.h"
+#include "gl/hardware.h"
+#include "gl/programBinaryCache.h"
 #include "gl/renderState.h"
+#include "gl/uniformBuffer.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "scene/light.h"
 #include "log.h"
 #include "platform.h"
 
+#include <chrono>
 #include <sstream>
 
 namespace Tangram {
 
+constexpr float ShaderProgram::BUILD_TIME_BUDGET;
+
 ShaderProgram::ShaderProgram() {
     // Nothing to do.
 }
@@ -24,6 +30,9 @@ ShaderProgram::~ShaderProgram() {
             // cache to keep shaders in memory only while at least one program uses them. (MEB 2018/5/17)
             m_rs->queueProgramDeletion(m_glProgram);
         }
+        if (m_pending.program) {
+            m_rs->queueProgramDeletion(m_pending.program);
+        }
     }
 }
 
@@ -64,11 +73,53 @@ bool ShaderProgram::use(RenderState& rs) {
     return false;
 }
 
+bool ShaderProgram::isReady(RenderState& rs) {
+
+    if (!m_needsBuild) { return true; }
+
+    if (Hardware::supportsParallelShaderCompile) {
+        if (m_pending.program == 0) {
+            startBuild(rs);
+            // Nothing to wait for, use() reports the errors of these sources
+            if (m_pending.program == 0) { return true; }
+        }
+        GLint complete = GL_FALSE;
+        GL::getProgramiv(m_pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete != GL_FALSE;
+    }
+
+    // Spread the builds of programs that become visible at once over frames
+    auto& stats = rs.frameStats();
+    if (stats.programBuilds > 0 && stats.programBuildTime >= BUILD_TIME_BUDGET) { return false; }
+
+    auto start = std::chrono::steady_clock::now();
+    build(rs);
+    rs.countProgramBuild(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
 bool ShaderProgram::build(RenderState& rs) {
 
     if (!m_needsBuild) { return false; }
     m_needsBuild = false;
 
+    bool built = buildProgram(rs);
+
+    // Drop a background build of sources that changed meanwhile
+    discardBuild();
+
+    return built;
+}
+
+bool ShaderProgram::usesUniformBuffers() const {
+    // Scene shader blocks may not compile as GLSL ES 3.00, see buildProgram()
+    return Hardware::supportsUniformBuffers &&
+        (ShaderSource::hasUniformBlocks(m_vertexShaderSource) ||
+         ShaderSource::hasUniformBlocks(m_fragmentShaderSource));
+}
+
+bool ShaderProgram::buildProgram(RenderState& rs) {
+
     // Delete handle for old program and shaders.
     if (m_glProgram) {
         GL::deleteProgram(m_glProgram);
@@ -82,42 +133,199 @@ bool ShaderProgram::build(RenderState& rs) {
         GL::deleteShader(m_glVertexShader);
         m_glVertexShader = 0;
     }
+    m_frameBlock = false;
+    m_lightsBlock = false;
 
     auto& vertSrc = m_vertexShaderSource;
     auto& fragSrc = m_fragmentShaderSource;
 
-    // Compile vertex and fragment shaders
-    GLint vertexShader = makeCompiledShader(rs, vertSrc, GL_VERTEX_SHADER);
-    if (vertexShader == 0) {
-        LOGE("Shader compilation failed for %s", m_description.c_str());
-        return false;
+    // Style programs share their per-frame uniforms through uniform buffers on GLES3.
+    // Scene shader blocks may not compile as GLSL ES 3.00, those keep plain uniforms.
+    if (usesUniformBuffers()) {
+
+        if (link(rs, ShaderSource::uniformBufferSource(vertSrc, false),
+                 ShaderSource::uniformBufferSource(fragSrc, true), false)) {
+
+            m_frameBlock = bindUniformBlock(UniformBuffer::FRAME_BLOCK, UniformBuffer::FRAME_BINDING);
+            m_lightsBlock = bindUniformBlock(UniformBuffer::LIGHTS_BLOCK, UniformBuffer::LIGHTS_BINDING);
+
+            if (m_frameBlock) {
+                m_attribMap.clear();
+                m_rs = &rs;
+                return true;
+            }
+        }
+        LOGW("Using plain uniforms for %s, it doesn't build with uniform buffers", m_description.c_str());
+        m_frameBlock = false;
+        m_lightsBlock = false;
+        if (m_glProgram) {
+            GL::deleteProgram(m_glProgram);
+            m_glProgram = 0;
+        }
+        // Owned by the shader cache of RenderState
+        m_glFragmentShader = 0;
+        m_glVertexShader = 0;
     }
 
-    GLint fragmentShader = makeCompiledShader(rs, fragSrc, GL_FRAGMENT_SHADER);
-    if (fragmentShader == 0) {
+    if (!link(rs, vertSrc, fragSrc, true)) {
         LOGE("Shader compilation failed for %s", m_description.c_str());
         return false;
     }
 
-    // Link shaders into a program
-    GLint program = makeLinkedShaderProgram(fragmentShader, vertexShader);
-    if (program == 0) {
-        LOGE("Shader compilation failed for %s", m_description.c_str());
-        return false;
+    // Clear any cached shader locations
+    m_attribMap.clear();
+    m_rs = &rs;
+
+    return true;
+}
+
+bool ShaderProgram::link(RenderState& rs, const std::string& _vertSrc, const std::string& _fragSrc,
+                         bool _logErrors) {
+
+    if (m_pending.program != 0 && m_pending.vertSrc == _vertSrc && m_pending.fragSrc == _fragSrc) {
+        return finishBuild(rs, _logErrors);
+    }
+
+    // Skip compiling and linking when a binary of this program was cached
+    if (rs.programBinaryCache) {
+        GLuint program = rs.programBinaryCache->load(_vertSrc, _fragSrc);
+        if (program != 0) {
+            m_glProgram = program;
+            return true;
+        }
     }
 
+    // Compile vertex and fragment shaders
+    GLint vertexShader = makeCompiledShader(rs, _vertSrc, GL_VERTEX_SHADER, _logErrors);
+    if (vertexShader == 0) { return false; }
+
+    GLint fragmentShader = makeCompiledShader(rs, _fragSrc, GL_FRAGMENT_SHADER, _logErrors);
+    if (fragmentShader == 0) { return false; }
+
+    // Link shaders into a program
+    GLint program = makeLinkedShaderProgram(fragmentShader, vertexShader, _logErrors);
+    if (program == 0) { return false; }
+
     m_glProgram = program;
     m_glFragmentShader = fragmentShader;
     m_glVertexShader = vertexShader;
 
-    // Clear any cached shader locations
-    m_attribMap.clear();
+    if (rs.programBinaryCache) {
+        rs.programBinaryCache->store(program, _vertSrc, _fragSrc);
+    }
+
+    return true;
+}
+
+void ShaderProgram::startBuild(RenderState& rs) {
+
     m_rs = &rs;
+    m_pending = PendingBuild();
+
+    if (usesUniformBuffers()) {
+        m_pending.vertSrc = ShaderSource::uniformBufferSource(m_vertexShaderSource, false);
+        m_pending.fragSrc = ShaderSource::uniformBufferSource(m_fragmentShaderSource, true);
+    } else {
+        m_pending.vertSrc = m_vertexShaderSource;
+        m_pending.fragSrc = m_fragmentShaderSource;
+    }
+
+    if (rs.programBinaryCache) {
+        m_pending.program = rs.programBinaryCache->load(m_pending.vertSrc, m_pending.fragSrc);
+        if (m_pending.program != 0) {
+            m_pending.binary = true;
+            return;
+        }
+    }
+
+    auto compile = [&](const std::string& _src, GLenum _type, bool& _created) -> GLuint {
+        auto& cache = (_type == GL_VERTEX_SHADER) ? rs.vertexShaders : rs.fragmentShaders;
 
+        auto entry = cache.emplace(_src, 0);
+        if (!entry.second) { return entry.first->second; }
+
+        GLuint shader = GL::createShader(_type);
+        const GLchar* source = (const GLchar*) _src.c_str();
+        GL::shaderSource(shader, 1, &source, NULL);
+        GL::compileShader(shader);
+
+        entry.first->second = shader;
+        _created = true;
+        return shader;
+    };
+
+    m_pending.vertexShader = compile(m_pending.vertSrc, GL_VERTEX_SHADER, m_pending.newVertexShader);
+    m_pending.fragmentShader = compile(m_pending.fragSrc, GL_FRAGMENT_SHADER, m_pending.newFragmentShader);
+
+    // A shader of these sources failed to compile before
+    if (m_pending.vertexShader == 0 || m_pending.fragmentShader == 0) {
+        m_pending = PendingBuild();
+        return;
+    }
+
+    m_pending.program = GL::createProgram();
+    GL::attachShader(m_pending.program, m_pending.fragmentShader);
+    GL::attachShader(m_pending.program, m_pending.vertexShader);
+    GL::linkProgram(m_pending.program);
+}
+
+bool ShaderProgram::finishBuild(RenderState& rs, bool _logErrors) {
+
+    PendingBuild pending = std::move(m_pending);
+    m_pending = PendingBuild();
+
+    if (!pending.binary) {
+        // Shaders that failed stay in the cache as 0, like in makeCompiledShader()
+        auto check = [&](GLuint _shader, const std::string& _src, GLenum _type) {
+            if (checkCompiledShader(_shader, _src, _logErrors)) { return true; }
+            auto& cache = (_type == GL_VERTEX_SHADER) ? rs.vertexShaders : rs.fragmentShaders;
+            cache[_src] = 0;
+            GL::deleteShader(_shader);
+            return false;
+        };
+        bool compiled = true;
+        if (pending.newVertexShader) {
+            compiled &= check(pending.vertexShader, pending.vertSrc, GL_VERTEX_SHADER);
+        }
+        if (pending.newFragmentShader) {
+            compiled &= check(pending.fragmentShader, pending.fragSrc, GL_FRAGMENT_SHADER);
+        }
+
+        if (!compiled || !checkLinkedProgram(pending.program, _logErrors)) {
+            GL::deleteProgram(pending.program);
+            return false;
+        }
+
+        m_glFragmentShader = pending.fragmentShader;
+        m_glVertexShader = pending.vertexShader;
+
+        if (rs.programBinaryCache) {
+            rs.programBinaryCache->store(pending.program, pending.vertSrc, pending.fragSrc);
+        }
+    }
+
+    m_glProgram = pending.program;
+    return true;
+}
+
+void ShaderProgram::discardBuild() {
+    // Shaders compiled for it stay in the shader cache
+    if (m_pending.program != 0) {
+        GL::deleteProgram(m_pending.program);
+    }
+    m_pending = PendingBuild();
+}
+
+bool ShaderProgram::bindUniformBlock(const std::string& _name, GLuint _binding) {
+    GLuint index = GL::getUniformBlockIndex(m_glProgram, _name.c_str());
+    if (index == GL_INVALID_INDEX) { return false; }
+
+    // Also after loading a program binary, which resets the bindings
+    GL::uniformBlockBinding(m_glProgram, index, _binding);
     return true;
 }
 
-GLuint ShaderProgram::makeLinkedShaderProgram(GLint _fragShader, GLint _vertShader) {
+GLuint ShaderProgram::makeLinkedShaderProgram(GLint _fragShader, GLint _vertShader, bool _logErrors) {
 
     GLuint program = GL::createProgram();
 
@@ -125,27 +333,37 @@ GLuint ShaderProgram::makeLinkedShaderProgram(GLint _fragShader, GLint _vertShad
     GL::attachShader(program, _vertShader);
     GL::linkProgram(program);
 
+    if (!checkLinkedProgram(program, _logErrors)) {
+        GL::deleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+bool ShaderProgram::checkLinkedProgram(GLuint _program, bool _logErrors) {
+
     GLint isLinked;
-    GL::getProgramiv(program, GL_LINK_STATUS, &isLinked);
+    GL::getProgramiv(_program, GL_LINK_STATUS, &isLinked);
 
     if (isLinked == GL_FALSE) {
         GLint infoLength = 0;
-        GL::getProgramiv(program, GL_INFO_LOG_LENGTH, &infoLength);
+        if (!_logErrors) { return false; }
+        GL::getProgramiv(_program, GL_INFO_LOG_LENGTH, &infoLength);
 
         if (infoLength > 1) {
             std::vector<GLchar> infoLog(infoLength);
-            GL::getProgramInfoLog(program, infoLength, NULL, &infoLog[0]);
+            GL::getProgramInfoLog(_program, infoLength, NULL, &infoLog[0]);
             LOGE("linking program:\n%s", &infoLog[0]);
         }
-
-        GL::deleteProgram(program);
-        return 0;
+        return false;
     }
 
-    return program;
+    return true;
 }
 
-GLuint ShaderProgram::makeCompiledShader(RenderState& rs, const std::string& _src, GLenum _type) {
+GLuint ShaderProgram::makeCompiledShader(RenderState& rs, const std::string& _src, GLenum _type,
+                                         bool _logErrors) {
 
     auto& cache = (_type == GL_VERTEX_SHADER) ? rs.vertexShaders : rs.fragmentShaders;
 
@@ -160,21 +378,33 @@ GLuint ShaderProgram::makeCompiledShader(RenderState& rs, const std::string& _sr
     GL::shaderSource(shader, 1, &source, NULL);
     GL::compileShader(shader);
 
+    if (!checkCompiledShader(shader, _src, _logErrors)) {
+        GL::deleteShader(shader);
+        return 0;
+    }
+
+    entry.first->second = shader;
+
+    return shader;
+}
+
+bool ShaderProgram::checkCompiledShader(GLuint _shader, const std::string& _src, bool _logErrors) {
+
     GLint isCompiled;
-    GL::getShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+    GL::getShaderiv(_shader, GL_COMPILE_STATUS, &isCompiled);
 
     if (isCompiled == GL_FALSE) {
         GLint infoLength = 0;
-        GL::getShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLength);
+        GL::getShaderiv(_shader, GL_INFO_LOG_LENGTH, &infoLength);
 
-        if (infoLength > 1) {
+        if (_logErrors && infoLength > 1) {
             std::string infoLog;
             infoLog.resize(infoLength);
 
-            GL::getShaderInfoLog(shader, infoLength, NULL, static_cast<GLchar*>(&infoLog[0]));
+            GL::getShaderInfoLog(_shader, infoLength, NULL, static_cast<GLchar*>(&infoLog[0]));
             LOGE("Shader compilation failed\n%s", infoLog.c_str());
 
-            std::stringstream sourceStream(source);
+            std::stringstream sourceStream(_src);
             std::string item;
             std::vector<std::string> sourceLines;
             while (std::getline(sourceStream, item)) { sourceLines.push_back(item); }
@@ -203,13 +433,10 @@ GLuint ShaderProgram::makeCompiledShader(RenderState& rs, const std::string& _sr
             }
         }
 
-        GL::deleteShader(shader);
-        return 0;
+        return false;
     }
 
-    entry.first->second = shader;
-
-    return shader;
+    return true;
 }
 
 void ShaderProgram::setUniformi(RenderState& rs, const UniformLocation& _loc, int _value) {
@@ -350,6 +577,15 @@ void ShaderProgram::setUniformf(RenderState& rs, const UniformLocation& _loc, co
     }
 }
 
+void ShaderProgram::setUniformf(RenderState& rs, const UniformLocation& _loc, const UniformArray4f& _value) {
+    if (!use(rs)) { return; }
+    GLint location = getUniformLocation(_loc);
+    if (location >= 0) {
+        bool cached = getFromCache(location, _value);
+        if (!cached) { GL::uniform4fv(location, _value.size(), (float*)_value.data()); }
+    }
+}
+
 void ShaderProgram::setUniformi(RenderState& rs, const UniformLocation& _loc, const UniformTextureArray& _value) {
     if (!use(rs)) { return; }
     GLint location = getUniformLocation(_loc);
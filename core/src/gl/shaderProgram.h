@@ -51,6 +51,15 @@ public:
     // Return true if this object represents a valid OpenGL shader program.
     bool isValid() const { return m_glProgram != 0; };
 
+    // Whether the program can be used in this frame without waiting for it to build.
+    // With KHR_parallel_shader_compile the first call starts compiling and linking in
+    // the driver and this returns false until the driver is done. Otherwise the program
+    // is built right away, unless the frame already spent BUILD_TIME_BUDGET milliseconds
+    // on building programs. use() still builds the program when it is not ready.
+    bool isReady(RenderState& rs);
+
+    static constexpr float BUILD_TIME_BUDGET = 8.f;
+
     // Bind the program in OpenGL if it is not already bound; If the shader sources
     // have been modified since the last time build() was called, also calls build().
     // Returns true if shader can be used (i.e. is valid).
@@ -74,6 +83,7 @@ public:
     void setUniformf(RenderState& rs, const UniformLocation& _loc, const UniformArray1f& _value);
     void setUniformf(RenderState& rs, const UniformLocation& _loc, const UniformArray2f& _value);
     void setUniformf(RenderState& rs, const UniformLocation& _loc, const UniformArray3f& _value);
+    void setUniformf(RenderState& rs, const UniformLocation& _loc, const UniformArray4f& _value);
     void setUniformi(RenderState& rs, const UniformLocation& _loc, const UniformTextureArray& _value);
 
     // Ensure the program is bound and then set the named uniform to the values
@@ -84,14 +94,41 @@ public:
 
     void setDescription(std::string _description) { m_description = _description; }
 
-    static GLuint makeLinkedShaderProgram(GLint _fragShader, GLint _vertShader);
-    static GLuint makeCompiledShader(RenderState& rs, const std::string& _src, GLenum _type);
+    static GLuint makeLinkedShaderProgram(GLint _fragShader, GLint _vertShader, bool _logErrors = true);
+    static GLuint makeCompiledShader(RenderState& rs, const std::string& _src, GLenum _type,
+                                     bool _logErrors = true);
+
+    // Whether the built program takes the per-frame uniforms or the dynamic
+    // lights from the blocks of UniformBuffer, instead of plain uniforms
+    bool hasFrameBlock() const { return m_frameBlock; }
+    bool hasLightsBlock() const { return m_lightsBlock; }
 
     const std::string& vertexShaderSource() { return m_vertexShaderSource; }
     const std::string& fragmentShaderSource() { return m_fragmentShaderSource; }
 
 private:
 
+    bool buildProgram(RenderState& rs);
+
+    // Whether the program is first built from sources translated to use the
+    // blocks of UniformBuffer
+    bool usesUniformBuffers() const;
+
+    // Compile and link the program from the given sources, or load it from the
+    // program binary cache. Takes the program of startBuild() for these sources.
+    bool link(RenderState& rs, const std::string& _vertSrc, const std::string& _fragSrc, bool _logErrors);
+
+    // Issue the compile and link of the sources that build() tries first,
+    // without querying their status
+    void startBuild(RenderState& rs);
+    bool finishBuild(RenderState& rs, bool _logErrors);
+    void discardBuild();
+
+    static bool checkCompiledShader(GLuint _shader, const std::string& _src, bool _logErrors);
+    static bool checkLinkedProgram(GLuint _program, bool _logErrors);
+
+    bool bindUniformBlock(const std::string& _name, GLuint _binding);
+
     // Get a uniform value from the cache, and returns false when it's a cache miss
     template <class T>
     inline bool getFromCache(GLint _location, T _value) {
@@ -110,6 +147,21 @@ private:
     GLuint m_glFragmentShader = 0;
     GLuint m_glVertexShader = 0;
 
+    // Program compiled and linked by the driver in the background
+    struct PendingBuild {
+        GLuint program = 0;
+        GLuint vertexShader = 0;
+        GLuint fragmentShader = 0;
+        std::string vertSrc;
+        std::string fragSrc;
+        // Whether the shaders were compiled for this program and still need
+        // a check of their status, they are in the shader cache already
+        bool newVertexShader = false;
+        bool newFragmentShader = false;
+        // Loaded from the program binary cache
+        bool binary = false;
+    } m_pending;
+
     fastmap<std::string, GLint> m_attribMap;
     fastmap<GLint, UniformValue> m_uniformCache;
 
@@ -120,6 +172,8 @@ private:
     std::string m_description;
 
     bool m_needsBuild = true;
+    bool m_frameBlock = false;
+    bool m_lightsBlock = false;
 
     RenderState* m_rs = nullptr;
 
@@ -46,6 +46,7 @@ std::string ShaderSource::applySourceBlocks(const std::string& _source, bool _fr
     std::set<std::string> pragmas;
 
     sourceOut << "#define TANGRAM_EPSILON 0.00001\n";
+    // Matches View::RENDER_ORIGIN_GRID
     sourceOut << "#define TANGRAM_WORLD_POSITION_WRAP 100000.\n";
 
     if (_fragShader) {
@@ -111,6 +112,49 @@ void ShaderSource::addExtensionDeclaration(const std::string& _extension) {
     addSourceBlock("extensions", oss.str());
 }
 
+std::string ShaderSource::uniformBufferSource(const std::string& _source, bool _fragShader) {
+
+    std::stringstream sourceOut;
+
+    sourceOut << "#version 300 es\n";
+    sourceOut << "#define TANGRAM_UNIFORM_BUFFERS\n";
+    // Derivatives are core in GLSL ES 3.00
+    sourceOut << "#define TANGRAM_EXTENSION_OES_standard_derivatives\n";
+    sourceOut << "#define texture2D texture\n";
+    sourceOut << "#define textureCube texture\n";
+
+    if (_fragShader) {
+        sourceOut << "#define varying in\n";
+        sourceOut << "#define gl_FragColor tangram_FragColor\n";
+    } else {
+        sourceOut << "#define attribute in\n";
+        sourceOut << "#define varying out\n";
+    }
+
+    std::stringstream sourceIn(_source);
+    std::string line;
+    bool declaredOutput = !_fragShader;
+    int conditionals = 0;
+
+    while (std::getline(sourceIn, line)) {
+        size_t start = line.find_first_not_of(" \t");
+
+        if (!declaredOutput && start != std::string::npos) {
+            if (line[start] == '#') {
+                if (line.compare(start, 3, "#if") == 0) { conditionals++; }
+                if (line.compare(start, 6, "#endif") == 0) { conditionals--; }
+            } else if (conditionals == 0 && line.compare(start, 2, "//") != 0) {
+                // Declared after the extension directives, which have to come first
+                sourceOut << "out highp vec4 tangram_FragColor;\n";
+                declaredOutput = true;
+            }
+        }
+        sourceOut << line << '\n';
+    }
+
+    return sourceOut.str();
+}
+
 std::string ShaderSource::buildSelectionFragmentSource() const {
     return SHADER_SOURCE(selection_fs);
 }
@@ -41,6 +41,15 @@ public:
     std::string buildSelectionFragmentSource() const;
 
 
+    // Whether _source declares uniform blocks when TANGRAM_UNIFORM_BUFFERS is defined
+    static bool hasUniformBlocks(const std::string& _source) {
+        return _source.find("TANGRAM_UNIFORM_BUFFERS") != std::string::npos;
+    }
+
+    // Translate GLSL ES 1.00 _source to GLSL ES 3.00 with TANGRAM_UNIFORM_BUFFERS
+    // defined, see UniformBuffer
+    static std::string uniformBufferSource(const std::string& _source, bool _fragShader);
+
     static std::string shaderSourceBlock(const unsigned char* data, size_t size) {
         std::string block;
         if (data[size - 1] == '\n') {
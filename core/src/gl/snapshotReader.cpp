@@ -0,0 +1,212 @@
+#include "gl/snapshotReader.h"
+
+#include "gl/glError.h"
+#include "gl/hardware.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Tangram {
+
+SnapshotReader::~SnapshotReader() {
+    reset();
+}
+
+bool SnapshotReader::enabled() const {
+    return !m_failed && Hardware::supportsPixelBufferReadback;
+}
+
+void SnapshotReader::read(int _x, int _y, int _width, int _height, int _downsample, Callback _callback) {
+
+    if (_width <= 0 || _height <= 0) {
+        _callback({}, 0, 0);
+        return;
+    }
+    _downsample = std::max(_downsample, 1);
+
+    if (!enabled()) {
+        readNow(_x, _y, _width, _height, _downsample, _callback);
+        return;
+    }
+
+    size_t bytes = size_t(_width) * _height * sizeof(unsigned int);
+    Read read{ 0, 0, nullptr, _width, _height, _downsample, 0, std::move(_callback) };
+
+    // Take a free buffer that fits, or grow one
+    auto it = std::find_if(m_buffers.begin(), m_buffers.end(),
+                           [&](auto& _buffer) { return _buffer.second >= bytes; });
+    if (it == m_buffers.end() && !m_buffers.empty()) { it = m_buffers.end() - 1; }
+
+    if (it != m_buffers.end()) {
+        read.buffer = it->first;
+        read.capacity = it->second;
+        m_buffers.erase(it);
+    } else {
+        GL::genBuffers(1, &read.buffer);
+    }
+
+    GL::bindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+    if (read.capacity < bytes) {
+        GL::bufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        read.capacity = bytes;
+    }
+    // With a pack buffer bound the pixels are written at offset 0 of the buffer
+    GL::readPixels(_x, _y, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GL::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    read.sync = GL::fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (!read.sync) {
+        // The framebuffer is still unchanged, read it again without the buffer
+        LOGW("Unable to create fence, reading snapshots synchronously");
+        m_failed = true;
+        release(read);
+        readNow(_x, _y, _width, _height, _downsample, read.callback);
+        return;
+    }
+
+    m_reads.push_back(std::move(read));
+}
+
+void SnapshotReader::readNow(int _x, int _y, int _width, int _height, int _downsample, Callback& _callback) {
+
+    std::vector<unsigned int> pixels(size_t(_width) * _height);
+    GL::readPixels(_x, _y, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::vector<unsigned int> out;
+    int width = 0, height = 0;
+    downsample(pixels.data(), _width, _height, _downsample, out, width, height);
+
+    _callback(std::move(out), width, height);
+}
+
+void SnapshotReader::poll() {
+
+    for (auto& read : m_reads) { read.frames++; }
+
+    while (!m_reads.empty()) {
+        auto& read = m_reads.front();
+
+        // Mapping waits for the GPU once the fence took too long
+        if (read.frames < maxFrames) {
+            GLint status = 0;
+            GL::getSynciv(read.sync, GL_SYNC_STATUS, 1, nullptr, &status);
+            if (status != GL_SIGNALED) { return; }
+        }
+
+        // Taken from the queue before the callback, which may issue new reads
+        Read done = std::move(read);
+        m_reads.pop_front();
+
+        if (!deliver(done) && !m_failed) {
+            LOGW("Unable to map pixel buffer, reading snapshots synchronously");
+            m_failed = true;
+        }
+    }
+}
+
+bool SnapshotReader::deliver(Read& _read) {
+
+    size_t bytes = size_t(_read.width) * _read.height * sizeof(unsigned int);
+
+    GL::bindBuffer(GL_PIXEL_PACK_BUFFER, _read.buffer);
+    auto* pixels = static_cast<const unsigned int*>(GL::mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes,
+                                                                       GL_MAP_READ_BIT));
+    std::vector<unsigned int> out;
+    int width = 0, height = 0;
+
+    if (pixels) {
+        downsample(pixels, _read.width, _read.height, _read.downsample, out, width, height);
+
+        if (!GL::unmapBuffer(GL_PIXEL_PACK_BUFFER)) {
+            // The data store got corrupted, e.g. by a display mode change
+            out.clear();
+            width = height = 0;
+        }
+    }
+    GL::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    release(_read);
+    _read.callback(std::move(out), width, height);
+
+    return pixels != nullptr;
+}
+
+void SnapshotReader::release(Read& _read) {
+    if (_read.sync) {
+        GL::deleteSync(_read.sync);
+        _read.sync = nullptr;
+    }
+    m_buffers.emplace_back(_read.buffer, _read.capacity);
+}
+
+void SnapshotReader::reset() {
+    for (auto& read : m_reads) { release(read); }
+    m_reads.clear();
+
+    for (auto& buffer : m_buffers) {
+        GL::deleteBuffers(1, &buffer.first);
+    }
+    m_buffers.clear();
+}
+
+void SnapshotReader::invalidate() {
+    auto reads = std::move(m_reads);
+    m_reads.clear();
+    m_buffers.clear();
+
+    for (auto& read : reads) { read.callback({}, 0, 0); }
+}
+
+void SnapshotReader::downsample(const unsigned int* _pixels, int _width, int _height, int _factor,
+                                std::vector<unsigned int>& _out, int& _outWidth, int& _outHeight) {
+
+    _factor = std::max(_factor, 1);
+    _outWidth = (_width + _factor - 1) / _factor;
+    _outHeight = (_height + _factor - 1) / _factor;
+    _out.resize(size_t(_outWidth) * _outHeight);
+
+    if (_factor == 1) {
+        for (int y = 0; y < _height; y++) {
+            std::memcpy(&_out[size_t(y) * _width], &_pixels[size_t(_height - 1 - y) * _width],
+                        _width * sizeof(unsigned int));
+        }
+        return;
+    }
+
+    // Channel sums of the blocks of one output row
+    std::vector<uint32_t> sums(size_t(_outWidth) * 4);
+
+    for (int row = 0; row < _outHeight; row++) {
+        std::fill(sums.begin(), sums.end(), 0);
+
+        int top = row * _factor;
+        int bottom = std::min(top + _factor, _height);
+
+        for (int y = top; y < bottom; y++) {
+            const unsigned int* src = &_pixels[size_t(_height - 1 - y) * _width];
+            for (int x = 0; x < _width; x++) {
+                unsigned int pixel = src[x];
+                uint32_t* sum = &sums[size_t(x / _factor) * 4];
+                sum[0] += pixel & 0xff;
+                sum[1] += (pixel >> 8) & 0xff;
+                sum[2] += (pixel >> 16) & 0xff;
+                sum[3] += pixel >> 24;
+            }
+        }
+
+        for (int col = 0; col < _outWidth; col++) {
+            int left = col * _factor;
+            uint32_t count = (bottom - top) * (std::min(left + _factor, _width) - left);
+            const uint32_t* sum = &sums[size_t(col) * 4];
+
+            unsigned int pixel = 0;
+            for (int c = 0; c < 4; c++) {
+                pixel |= ((sum[c] + count / 2) / count) << (8 * c);
+            }
+            _out[size_t(row) * _outWidth + col] = pixel;
+        }
+    }
+}
+
+}
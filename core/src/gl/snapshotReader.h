@@ -0,0 +1,86 @@
+#pragma once
+
+#include "gl.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace Tangram {
+
+/* Reads regions of the framebuffer without stalling the GL pipeline
+ *
+ * A read is issued into a pixel pack buffer and fenced. The buffer is mapped
+ * in a later frame once the fence is signaled, so the GPU copies the pixels
+ * while the next frame is drawn. Reads complete in the order they were
+ * issued. Without Hardware::supportsPixelBufferReadback, or after a buffer
+ * failed to map once, pixels are read synchronously and delivered right away.
+ * All methods must be called on the GL thread.
+ */
+class SnapshotReader {
+
+public:
+
+    // RGBA pixels with rows from the top, empty when the read was dropped
+    using Callback = std::function<void(std::vector<unsigned int>&& _pixels, int _width, int _height)>;
+
+    // Longest wait for a fence, the buffer is mapped regardless afterwards
+    static constexpr uint32_t maxFrames = 4;
+
+    ~SnapshotReader();
+
+    // Read _width x _height pixels at _x, _y from the lower left of the bound
+    // framebuffer, averaging blocks of _downsample x _downsample pixels
+    void read(int _x, int _y, int _width, int _height, int _downsample, Callback _callback);
+
+    // Deliver the reads that completed, called once per frame
+    void poll();
+
+    bool pending() const { return !m_reads.empty(); }
+
+    // Delete the buffers, reads in flight are dropped without a callback
+    void reset();
+
+    // Forget the buffers without deleting them, after the GL context was lost.
+    // Reads in flight are delivered empty.
+    void invalidate();
+
+    // Averages blocks of _factor x _factor of the _width x _height pixels that
+    // GL read from the bottom row up, into _out with rows from the top. Blocks
+    // at the right and bottom edges average the pixels they cover.
+    static void downsample(const unsigned int* _pixels, int _width, int _height, int _factor,
+                           std::vector<unsigned int>& _out, int& _outWidth, int& _outHeight);
+
+private:
+
+    struct Read {
+        GLuint buffer;
+        size_t capacity;
+        GLsync sync;
+        int width;
+        int height;
+        int downsample;
+        uint32_t frames;
+        Callback callback;
+    };
+
+    bool enabled() const;
+
+    void readNow(int _x, int _y, int _width, int _height, int _downsample, Callback& _callback);
+
+    // Returns false when the buffer can not be mapped
+    bool deliver(Read& _read);
+
+    void release(Read& _read);
+
+    std::deque<Read> m_reads;
+
+    // Buffers for reuse, with the size of their data store
+    std::vector<std::pair<GLuint, size_t>> m_buffers;
+
+    bool m_failed = false;
+};
+
+}
@@ -17,6 +17,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include <algorithm>
 #include <cstring> // for memset
 
 namespace Tangram {
@@ -44,27 +45,148 @@ Texture::~Texture() {
     }
 }
 
-bool Texture::loadImageFromMemory(const std::vector<char>& _data) {
+// KTX 1.1 file identifier and header, followed by key/value data and the mip levels
+static const char s_ktxIdentifier[12] = {
+    '\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n'
+};
+
+struct KTXHeader {
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+bool Texture::isKTX(const char* _data, size_t _length) {
+    return _length >= sizeof(s_ktxIdentifier) &&
+        std::memcmp(_data, s_ktxIdentifier, sizeof(s_ktxIdentifier)) == 0;
+}
+
+bool Texture::supportsCompressedFormat(GLenum _format) {
+    if (_format >= GL_COMPRESSED_RGB8_ETC2 && _format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC) {
+        return Hardware::supportsETC2;
+    }
+    if (_format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR && _format <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR) {
+        return Hardware::supportsASTC;
+    }
+    return false;
+}
+
+bool Texture::loadKTX(const char* _data, size_t _length) {
+    KTXHeader header;
+    size_t start = sizeof(s_ktxIdentifier) + sizeof(header);
+
+    if (_length < start) {
+        LOGW("Truncated KTX texture");
+        return false;
+    }
+    std::memcpy(&header, _data + sizeof(s_ktxIdentifier), sizeof(header));
+
+    if (header.endianness != 0x04030201) {
+        LOGW("KTX texture with swapped byte order is not supported");
+        return false;
+    }
+    // glType is 0 for compressed formats
+    if (header.glType != 0 || header.pixelDepth > 1 ||
+        header.numberOfArrayElements > 0 || header.numberOfFaces != 1) {
+        LOGW("Only compressed 2D KTX textures are supported");
+        return false;
+    }
+    if (!supportsCompressedFormat(header.glInternalFormat)) {
+        LOGW("Compressed texture format 0x%x is not available", header.glInternalFormat);
+        return false;
+    }
+
+    start += header.bytesOfKeyValueData;
+    size_t levels = std::max<uint32_t>(header.numberOfMipmapLevels, 1);
+
+    m_compressedLevels.clear();
+    m_compressedBytes = 0;
+
+    size_t offset = start;
+    for (size_t level = 0; level < levels; level++) {
+        uint32_t imageSize;
+        if (offset + sizeof(imageSize) > _length) { break; }
+        std::memcpy(&imageSize, _data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+
+        if (offset + imageSize > _length) { break; }
+        m_compressedLevels.push_back({ offset - start, imageSize });
+        m_compressedBytes += imageSize;
+
+        // Mip levels are padded to 4 bytes
+        offset += (imageSize + 3) & ~3u;
+    }
+    if (m_compressedLevels.size() != levels) {
+        LOGW("Truncated KTX texture");
+        m_compressedLevels.clear();
+        m_compressedBytes = 0;
+        return false;
+    }
+
+    m_compressedData.assign(_data + start, _data + offset);
+    m_compressedFormat = header.glInternalFormat;
+    m_data.clear();
+    m_image.reset();
+    m_levels.clear();
+    m_topDown = false;
+
+    resize(header.pixelWidth, header.pixelHeight);
+
+    // Mipmaps can't be generated for compressed data, only the levels of the file are used
+    m_generateMipmaps = false;
+    if (levels == 1 && m_options.filtering.min != GL_NEAREST) {
+        m_options.filtering.min = GL_LINEAR;
+    }
+    return true;
+}
+
+void Texture::ImageDeleter::operator()(unsigned char* _pixels) const {
+    stbi_image_free(_pixels);
+}
+
+bool Texture::loadImageFromMemory(const char* _data, size_t _length, bool _flipRows) {
     unsigned char* pixels = nullptr;
     int width, height, comp;
 
-    if (_data.size() != 0) {
-        pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(_data.data()), _data.size(), &width, &height, &comp, STBI_rgb_alpha);
+    if (isKTX(_data, _length)) {
+        if (loadKTX(_data, _length)) { return true; }
+    } else if (_length != 0) {
+        pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(_data), _length, &width, &height, &comp, STBI_rgb_alpha);
     }
 
     if (pixels) {
         // stbi_load_from_memory loads the image as a series of scanlines starting from
-        // the top-left corner of the image. This call flips the output such that the data
-        // begins at the bottom-left corner, as required for our OpenGL texture coordinates.
-        auto* rgbaPixels = reinterpret_cast<GLuint*>(pixels);
+        // the top-left corner of the image. Unless the texture is sampled with flipped
+        // coordinates this call flips the output such that the data begins at the
+        // bottom-left corner, as required for our OpenGL texture coordinates.
+        if (_flipRows) {
+            Texture::flipImageData(reinterpret_cast<GLuint*>(pixels), width, height);
+        }
+        m_topDown = !_flipRows;
 
-        Texture::flipImageData(rgbaPixels, width, height);
+        m_compressedFormat = 0;
+        m_compressedLevels.clear();
+        m_compressedData.clear();
+        m_compressedBytes = 0;
 
         resize(width, height);
 
-        setData(rgbaPixels, width * height);
+        // Uploaded from the decoded image, without a copy
+        std::vector<GLuint>().swap(m_data);
+        m_image.reset(pixels);
+        setDirty(0, m_height);
 
-        stbi_image_free(pixels);
+        prepareLevels();
 
         return true;
     }
@@ -73,6 +195,10 @@ bool Texture::loadImageFromMemory(const std::vector<char>& _data) {
     // texture data but a Tangram style shader requires a shader sampler
     GLuint blackPixel = 0x0000ff;
 
+    m_topDown = false;
+    m_compressedFormat = 0;
+    m_compressedData.clear();
+
     setData(&blackPixel, 1);
 
     return false;
@@ -88,7 +214,16 @@ Texture& Texture::operator=(Texture&& _other) {
 
     m_options = _other.m_options;
     m_data = std::move(_other.m_data);
+    m_image = std::move(_other.m_image);
+    m_topDown = _other.m_topDown;
+    m_retainData = _other.m_retainData;
     m_dirtyRanges = std::move(_other.m_dirtyRanges);
+    m_dirtyRects = std::move(_other.m_dirtyRects);
+    m_levels = std::move(_other.m_levels);
+    m_compressedLevels = std::move(_other.m_compressedLevels);
+    m_compressedData = std::move(_other.m_compressedData);
+    m_compressedFormat = _other.m_compressedFormat;
+    m_compressedBytes = _other.m_compressedBytes;
     m_shouldResize = _other.m_shouldResize;
     m_width = _other.m_width;
     m_height = _other.m_height;
@@ -101,6 +236,9 @@ Texture& Texture::operator=(Texture&& _other) {
 
 void Texture::setData(const GLuint* _data, unsigned int _dataSize) {
 
+    m_image.reset();
+    m_levels.clear();
+    m_topDown = false;
     m_data.clear();
 
     m_data.insert(m_data.begin(), _data, _data + _dataSize);
@@ -111,6 +249,9 @@ void Texture::setData(const GLuint* _data, unsigned int _dataSize) {
 void Texture::setSubData(const GLuint* _subData, uint16_t _xoff, uint16_t _yoff,
                          uint16_t _width, uint16_t _height, uint16_t _stride) {
 
+    takeImage();
+    m_levels.clear();
+
     size_t bpp = bytesPerPixel();
     size_t divisor = sizeof(GLuint) / bpp;
 
@@ -172,6 +313,28 @@ void Texture::setDirty(size_t _yoff, size_t _height) {
     }
 }
 
+void Texture::setDirtyRect(size_t _x, size_t _y, size_t _width, size_t _height) {
+    // Align rows to 4 bytes, the default GL_UNPACK_ALIGNMENT
+    size_t bpp = bytesPerPixel();
+    size_t align = std::max<size_t>(4 / bpp, 1);
+    size_t end = std::min<size_t>((_x + _width + align - 1) / align * align, m_width);
+    _x = _x / align * align;
+    _width = end - _x;
+
+    // Extend the last rect for glyphs added along the same row
+    if (!m_dirtyRects.empty()) {
+        auto& last = m_dirtyRects.back();
+        if (last.y == _y && last.height == _height && last.x + last.width >= _x &&
+            _x + _width >= last.x) {
+            size_t lastEnd = std::max(last.x + last.width, _x + _width);
+            last.x = std::min(last.x, _x);
+            last.width = lastEnd - last.x;
+            return;
+        }
+    }
+    m_dirtyRects.push_back({_x, _y, _width, _height});
+}
+
 void Texture::bind(RenderState& rs, GLuint _unit) {
     rs.textureUnit(_unit);
     rs.texture(m_target, m_glHandle);
@@ -191,33 +354,159 @@ void Texture::generate(RenderState& rs, GLuint _textureUnit) {
     m_rs = &rs;
 }
 
+void Texture::dispose() {
+    if (m_rs && m_glHandle != 0) {
+        m_rs->queueTextureDeletion(m_glHandle);
+    }
+    m_glHandle = 0;
+    m_shouldResize = true;
+}
+
 bool Texture::isValid() const {
     return m_glHandle != 0;
 }
 
+bool Texture::isUploaded() const {
+    return m_glHandle != 0 && !m_shouldResize && m_dirtyRanges.empty() && m_dirtyRects.empty();
+}
+
 void Texture::update(RenderState& rs, GLuint _textureUnit) {
 
-    if (!m_shouldResize && m_dirtyRanges.empty()) {
+    if (!m_shouldResize && m_dirtyRanges.empty() && m_dirtyRects.empty()) {
         return;
     }
 
-    if (m_glHandle == 0) {
+    if (m_glHandle == 0 && m_compressedFormat == 0 && !m_image) {
         if (m_data.size() == 0) {
             size_t divisor = sizeof(GLuint) / bytesPerPixel();
             m_data.resize((m_width * m_height) / divisor, 0);
         }
     }
 
-    GLuint* data = m_data.size() > 0 ? m_data.data() : nullptr;
+    const GLuint* data = m_image ? reinterpret_cast<const GLuint*>(m_image.get()) :
+        m_data.size() > 0 ? m_data.data() : nullptr;
 
     update(rs, _textureUnit, data);
 
-    m_data.clear();
+    releaseData();
+}
+
+const GLuint* Texture::pixels() const {
+    if (m_image) { return reinterpret_cast<const GLuint*>(m_image.get()); }
+
+    size_t divisor = sizeof(GLuint) / bytesPerPixel();
+    if (!m_data.empty() && m_data.size() == (m_width * m_height) / divisor) { return m_data.data(); }
+
+    return nullptr;
+}
+
+void Texture::takeImage() {
+    if (!m_image) { return; }
+
+    auto* pixels = reinterpret_cast<const GLuint*>(m_image.get());
+    m_data.assign(pixels, pixels + m_width * m_height);
+    m_image.reset();
+}
+
+void Texture::releaseData() {
+    std::vector<std::vector<unsigned char>>().swap(m_levels);
+
+    if (m_retainData) {
+        takeImage();
+        return;
+    }
+    m_image.reset();
+    // Free the memory, not only the elements
+    std::vector<GLuint>().swap(m_data);
+}
+
+// Pack _count RGBA pixels to RGB565 at _out
+static void packRGB565(const unsigned char* _rgba, size_t _count, unsigned char* _out) {
+    auto* out = reinterpret_cast<uint16_t*>(_out);
+    for (size_t i = 0; i < _count; i++, _rgba += 4) {
+        out[i] = uint16_t(((_rgba[0] >> 3) << 11) | ((_rgba[1] >> 2) << 5) | (_rgba[2] >> 3));
+    }
+}
+
+// Pack the _width x _height RGBA pixels of _rgba to RGB565 rows of 4 byte alignment
+static void packImageRGB565(const unsigned char* _rgba, size_t _width, size_t _height,
+                            std::vector<unsigned char>& _out) {
+    size_t rowBytes = (_width * 2 + 3) & ~size_t(3);
+    _out.resize(rowBytes * _height);
+    for (size_t row = 0; row < _height; row++) {
+        packRGB565(_rgba + row * _width * 4, _width, &_out[row * rowBytes]);
+    }
+}
+
+// Average the 2x2 blocks of the _width x _height RGBA pixels of _rgba into
+// _out, the next smaller mip level. Odd rows and columns at the end are
+// averaged with themselves.
+static void downsampleRGBA(const unsigned char* _rgba, size_t _width, size_t _height,
+                           std::vector<unsigned char>& _out) {
+    size_t width = std::max<size_t>(_width / 2, 1);
+    size_t height = std::max<size_t>(_height / 2, 1);
+    _out.resize(width * height * 4);
+
+    for (size_t y = 0; y < height; y++) {
+        const unsigned char* row0 = _rgba + std::min(y * 2, _height - 1) * _width * 4;
+        const unsigned char* row1 = _rgba + std::min(y * 2 + 1, _height - 1) * _width * 4;
+        unsigned char* out = &_out[y * width * 4];
+
+        for (size_t x = 0; x < width; x++, out += 4) {
+            size_t x0 = std::min(x * 2, _width - 1) * 4;
+            size_t x1 = std::min(x * 2 + 1, _width - 1) * 4;
+            for (size_t c = 0; c < 4; c++) {
+                out[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+            }
+        }
+    }
+}
+
+void Texture::prepareLevels() {
+    m_levels.clear();
+
+    // Only RGBA pixels of the whole texture, set as decoded or with setData()
+    const auto* rgba = reinterpret_cast<const unsigned char*>(pixels());
+    if (!rgba || bytesPerPixel() != 4 || (!m_generateMipmaps && !packed())) { return; }
+
+    m_levels.emplace_back();
+    if (packed()) { packImageRGB565(rgba, m_width, m_height, m_levels[0]); }
+    if (!m_generateMipmaps) { return; }
+
+    std::vector<unsigned char> level, next;
+    size_t width = m_width, height = m_height;
+
+    while (width > 1 || height > 1) {
+        downsampleRGBA(rgba, width, height, next);
+        width = std::max<size_t>(width / 2, 1);
+        height = std::max<size_t>(height / 2, 1);
+
+        m_levels.emplace_back();
+        if (packed()) {
+            packImageRGB565(next.data(), width, height, m_levels.back());
+        } else {
+            m_levels.back() = next;
+        }
+        level.swap(next);
+        rgba = level.data();
+    }
+}
+
+const GLvoid* Texture::packPixels(const unsigned char* _data, size_t _x, size_t _y,
+                                  size_t _width, size_t _height) {
+
+    // Rows keep the default GL_UNPACK_ALIGNMENT of 4 bytes
+    size_t rowBytes = (_width * 2 + 3) & ~size_t(3);
+    m_uploadBuffer.resize(rowBytes * _height);
+    for (size_t row = 0; row < _height; row++) {
+        packRGB565(_data + ((_y + row) * m_width + _x) * 4, _width, &m_uploadBuffer[row * rowBytes]);
+    }
+    return m_uploadBuffer.data();
 }
 
 void Texture::update(RenderState& rs, GLuint _textureUnit, const GLuint* data) {
 
-    if (!m_shouldResize && m_dirtyRanges.empty()) {
+    if (!m_shouldResize && m_dirtyRanges.empty() && m_dirtyRects.empty()) {
         return;
     }
 
@@ -234,31 +523,103 @@ void Texture::update(RenderState& rs, GLuint _textureUnit, const GLuint* data) {
             LOGW("The hardware maximum texture size is currently reached");
         }
 
+        if (m_compressedFormat != 0) {
+            for (size_t level = 0; level < m_compressedLevels.size(); level++) {
+                auto& mip = m_compressedLevels[level];
+                GL::compressedTexImage2D(m_target, level, m_compressedFormat,
+                                         std::max(m_width >> level, 1u),
+                                         std::max(m_height >> level, 1u), 0,
+                                         mip.size, m_compressedData.data() + mip.offset);
+            }
+            std::vector<char>().swap(m_compressedData);
+            m_compressedLevels.clear();
+
+            m_shouldResize = false;
+            m_dirtyRanges.clear();
+            m_dirtyRects.clear();
+            return;
+        }
+
+        // Levels prepared off the GL thread, with their mipmaps
+        if (data && !m_levels.empty()) {
+            for (size_t level = 0; level < m_levels.size(); level++) {
+                const GLvoid* pixels = data;
+                if (!m_levels[level].empty()) { pixels = m_levels[level].data(); }
+                GL::texImage2D(m_target, level, m_options.internalFormat,
+                               std::max(m_width >> level, 1u), std::max(m_height >> level, 1u), 0,
+                               m_options.format, m_options.type, pixels);
+            }
+            m_shouldResize = false;
+            m_dirtyRanges.clear();
+            m_dirtyRects.clear();
+            return;
+        }
+
+        const GLvoid* pixels = data;
+        if (data && packed()) {
+            pixels = packPixels(reinterpret_cast<const unsigned char*>(data), 0, 0, m_width, m_height);
+        }
+
         GL::texImage2D(m_target, 0, m_options.internalFormat,
                        m_width, m_height, 0, m_options.format,
-                       GL_UNSIGNED_BYTE, data);
+                       m_options.type, pixels);
 
         if (data && m_generateMipmaps) {
             // generate the mipmaps for this texture
             GL::generateMipmap(m_target);
         }
+        if (packed()) { std::vector<unsigned char>().swap(m_uploadBuffer); }
         m_shouldResize = false;
         m_dirtyRanges.clear();
+        m_dirtyRects.clear();
         return;
     }
     size_t bpp = bytesPerPixel();
     size_t divisor = sizeof(GLuint) / bpp;
 
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
     for (auto& range : m_dirtyRanges) {
         size_t offset =  (range.min * m_width) / divisor;
+        const GLvoid* pixels = data + offset;
+        if (bytes && packed()) {
+            pixels = packPixels(bytes, 0, range.min, m_width, range.max - range.min);
+        }
         GL::texSubImage2D(m_target, 0, 0, range.min, m_width, range.max - range.min,
-                          m_options.format, GL_UNSIGNED_BYTE,
-                          data + offset);
+                          m_options.format, m_options.type, pixels);
+    }
+
+    for (auto& rect : m_dirtyRects) {
+        // Rows within a dirty range were uploaded already
+        bool uploaded = std::any_of(m_dirtyRanges.begin(), m_dirtyRanges.end(), [&](auto& range) {
+                return rect.y >= range.min && rect.y + rect.height <= range.max;
+            });
+        if (uploaded || !bytes) { continue; }
+
+        if (packed()) {
+            GL::texSubImage2D(m_target, 0, rect.x, rect.y, rect.width, rect.height, m_options.format,
+                              m_options.type, packPixels(bytes, rect.x, rect.y, rect.width, rect.height));
+            continue;
+        }
+
+        size_t rowBytes = rect.width * bpp;
+        m_uploadBuffer.resize(rowBytes * rect.height);
+        for (size_t row = 0; row < rect.height; row++) {
+            std::memcpy(&m_uploadBuffer[row * rowBytes],
+                        bytes + ((rect.y + row) * m_width + rect.x) * bpp,
+                        rowBytes);
+        }
+        GL::texSubImage2D(m_target, 0, rect.x, rect.y, rect.width, rect.height,
+                          m_options.format, GL_UNSIGNED_BYTE, m_uploadBuffer.data());
     }
     m_dirtyRanges.clear();
+    m_dirtyRects.clear();
 }
 
 void Texture::resize(const unsigned int _width, const unsigned int _height) {
+    if (m_image && (_width != m_width || _height != m_height)) { m_image.reset(); }
+    m_levels.clear();
+
     m_width = _width;
     m_height = _height;
 
@@ -273,17 +634,37 @@ void Texture::resize(const unsigned int _width, const unsigned int _height) {
 
     m_shouldResize = true;
     m_dirtyRanges.clear();
+    m_dirtyRects.clear();
 }
 
 bool Texture::isRepeatWrapping(TextureWrapping _wrapping) {
     return _wrapping.wraps == GL_REPEAT || _wrapping.wrapt == GL_REPEAT;
 }
 
-size_t Texture::bufferSize() {
-    return m_width * m_height * bytesPerPixel();
+size_t Texture::bufferSize() const {
+    if (m_compressedFormat != 0) { return m_compressedBytes; }
+
+    size_t bytes = m_width * m_height * (packed() ? 2 : bytesPerPixel());
+    // The mip levels add up to a third of the base level
+    if (m_generateMipmaps) { bytes += bytes / 3; }
+    return bytes;
+}
+
+MemoryUsage Texture::memoryUsage() const {
+    MemoryUsage usage;
+    usage.cpuBytes = m_data.capacity() * sizeof(GLuint) + m_compressedData.capacity() +
+        m_uploadBuffer.capacity() + (m_image ? m_width * m_height * sizeof(GLuint) : 0);
+    for (auto& level : m_levels) { usage.cpuBytes += level.capacity(); }
+    if (m_glHandle != 0) {
+        usage.gpuBytes = bufferSize();
+    }
+    return usage;
 }
 
-size_t Texture::bytesPerPixel() {
+size_t Texture::bytesPerPixel() const {
+    // Set as RGBA
+    if (packed()) { return 4; }
+
     switch (m_options.internalFormat) {
         case GL_ALPHA:
         case GL_LUMINANCE:
@@ -2,6 +2,7 @@
 
 #include "gl.h"
 #include "scene/spriteAtlas.h"
+#include "util/types.h"
 
 #include <vector>
 #include <memory>
@@ -26,6 +27,9 @@ struct TextureOptions {
     GLenum format;
     TextureFiltering filtering;
     TextureWrapping wrapping;
+    // GL_UNSIGNED_SHORT_5_6_5 for GL_RGB textures of half the size, their pixels
+    // are still set as RGBA and packed when they are uploaded
+    GLenum type = GL_UNSIGNED_BYTE;
 };
 
 #define DEFAULT_TEXTURE_OPTION \
@@ -64,8 +68,25 @@ public:
 
     void setDirty(size_t yOffset, size_t height);
 
+    /* Mark only a rectangle for upload, instead of all rows it covers.
+     * Rectangles are widened to 4 byte row alignment. */
+    void setDirtyRect(size_t _x, size_t _y, size_t _width, size_t _height);
+
     GLuint getGlHandle() { return m_glHandle; }
 
+    /* Pixels of the whole texture that wait for upload, null when there are
+     * none. Released on upload unless the texture retains them. */
+    const GLuint* pixels() const;
+
+    /* Keep the pixel data on the CPU after upload */
+    void setRetainData(bool _retain) { m_retainData = _retain; }
+
+    /* Whether rows are stored top-down as decoded, see loadImageFromMemory().
+     * The y of texture coordinates has to be flipped to sample them. */
+    bool topDown() const { return m_topDown; }
+
+    const TextureOptions& getOptions() const { return m_options; }
+
     /* Sets texture data
      *
      * Has less priority than set sub data
@@ -76,22 +97,52 @@ public:
     void setSubData(const GLuint* _subData, uint16_t _xoff, uint16_t _yoff,
                     uint16_t _width, uint16_t _height, uint16_t _stride);
 
+    /* Queue the GL texture for deletion, it is created again on the next upload
+     * of data. Can be called off the GL thread. */
+    void dispose();
+
     /* Checks whether the texture has valid data and has been successfully uploaded to GPU */
     bool isValid() const;
 
+    /* Returns true when the texture exists on the GPU and has no pending data */
+    virtual bool isUploaded() const;
+
     typedef std::pair<GLuint, GLuint> TextureSlot;
 
     static void invalidateAllTextures();
 
     static bool isRepeatWrapping(TextureWrapping _wrapping);
 
-    bool loadImageFromMemory(const std::vector<char>& _data);
+    /* Decode PNG, JPEG, GIF, TGA or PSD data with stb_image or take KTX data with
+     * an ETC2 or ASTC compressed format as is, with rows stored bottom-up.
+     * Decoded images are uploaded from the memory of stb_image; without
+     * _flipRows their rows stay top-down, see topDown().
+     * Can be called off the GL thread. */
+    bool loadImageFromMemory(const char* _data, size_t _length, bool _flipRows = true);
+    bool loadImageFromMemory(const std::vector<char>& _data, bool _flipRows = true) {
+        return loadImageFromMemory(_data.data(), _data.size(), _flipRows);
+    }
+
+    /* Generate the mip levels of a texture with mipmaps, and pack the pixels
+     * of RGB565 textures, for the next upload of the whole texture. Done by
+     * loadImageFromMemory() for decoded images; changes to the data drop the
+     * prepared levels again. Can be called off the GL thread. */
+    void prepareLevels();
+
+    /* Returns true when _data starts with the KTX file identifier */
+    static bool isKTX(const char* _data, size_t _length);
+
+    /* Returns true when the GL context can sample the compressed _format */
+    static bool supportsCompressedFormat(GLenum _format);
 
     static void flipImageData(unsigned char *result, int w, int h, int depth);
     static void flipImageData(GLuint *result, int w, int h);
 
-    size_t bytesPerPixel();
-    size_t bufferSize();
+    size_t bytesPerPixel() const;
+    size_t bufferSize() const;
+
+    /* Pixel data waiting for upload on the CPU, the texture once created on the GPU */
+    MemoryUsage memoryUsage() const;
 
     auto& spriteAtlas() { return m_spriteAtlas; }
     const auto& spriteAtlas() const { return m_spriteAtlas; }
@@ -102,16 +153,58 @@ protected:
 
     void generate(RenderState& rs, GLuint _textureUnit);
 
+    bool loadKTX(const char* _data, size_t _length);
+
+    // Move a decoded image into m_data, before updating parts of it
+    void takeImage();
+
+    // Release pixel data after upload, unless it is retained
+    void releaseData();
+
+    // RGB565 textures, see TextureOptions::type
+    bool packed() const { return m_options.type == GL_UNSIGNED_SHORT_5_6_5; }
+
+    // Pack the RGBA pixels of a rect of _data into m_uploadBuffer
+    const GLvoid* packPixels(const unsigned char* _data, size_t _x, size_t _y, size_t _width, size_t _height);
+
     TextureOptions m_options;
     std::vector<GLuint> m_data;
     GLuint m_glHandle;
 
+    struct ImageDeleter { void operator()(unsigned char* _pixels) const; };
+    // Image decoded by stb_image, uploaded in place of m_data
+    std::unique_ptr<unsigned char, ImageDeleter> m_image;
+    bool m_topDown = false;
+    bool m_retainData = false;
+
     struct DirtyRange {
         size_t min;
         size_t max;
     };
     std::vector<DirtyRange> m_dirtyRanges;
 
+    struct DirtyRect {
+        size_t x, y, width, height;
+    };
+    std::vector<DirtyRect> m_dirtyRects;
+
+    // Rows of a dirty rect, packed for texSubImage2D
+    std::vector<unsigned char> m_uploadBuffer;
+
+    // Mip levels in the upload format, see prepareLevels(). An empty level 0
+    // is uploaded from the pixels of the texture as they are.
+    std::vector<std::vector<unsigned char>> m_levels;
+
+    // Mip levels of a KTX texture, uploaded with compressedTexImage2D
+    struct CompressedLevel {
+        size_t offset;
+        size_t size;
+    };
+    std::vector<CompressedLevel> m_compressedLevels;
+    std::vector<char> m_compressedData;
+    GLenum m_compressedFormat = 0;
+    size_t m_compressedBytes = 0;
+
     bool m_shouldResize;
 
     unsigned int m_width;
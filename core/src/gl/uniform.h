@@ -23,10 +23,11 @@ struct UniformTextureArray {
 using UniformArray1f = std::vector<float>;
 using UniformArray2f = std::vector<glm::vec2>;
 using UniformArray3f = std::vector<glm::vec3>;
+using UniformArray4f = std::vector<glm::vec4>;
 
 /* Style Block Uniform types */
 using UniformValue = variant<none_type, bool, std::string, float, int, glm::vec2, glm::vec3, glm::vec4,
-    glm::mat2, glm::mat3, glm::mat4, UniformArray1f, UniformArray2f, UniformArray3f, UniformTextureArray>;
+    glm::mat2, glm::mat3, glm::mat4, UniformArray1f, UniformArray2f, UniformArray3f, UniformArray4f, UniformTextureArray>;
 
 
 class UniformLocation {
@@ -34,6 +35,8 @@ class UniformLocation {
 public:
     UniformLocation(const std::string& _name) : name(_name) {}
 
+    const std::string& getName() const { return name; }
+
 private:
     const std::string name;
 
@@ -0,0 +1,82 @@
+#include "gl/uniformBuffer.h"
+
+#include "gl/glError.h"
+
+#include "glm/gtc/type_ptr.hpp"
+
+namespace Tangram {
+
+constexpr GLuint UniformBuffer::FRAME_BINDING;
+constexpr GLuint UniformBuffer::LIGHTS_BINDING;
+
+const std::string UniformBuffer::FRAME_BLOCK = "TangramFrame";
+const std::string UniformBuffer::LIGHTS_BLOCK = "TangramLights";
+
+void UniformBuffer::align(size_t _alignment) {
+    m_data.resize((m_data.size() + _alignment - 1) / _alignment * _alignment, 0.f);
+}
+
+void UniformBuffer::add(float _value) {
+    m_data.push_back(_value);
+}
+
+void UniformBuffer::add(const glm::vec2& _value) {
+    align(2);
+    m_data.insert(m_data.end(), glm::value_ptr(_value), glm::value_ptr(_value) + 2);
+}
+
+void UniformBuffer::add(const glm::vec3& _value) {
+    // A vec3 is aligned like a vec4, a following float takes its fourth component
+    align(4);
+    m_data.insert(m_data.end(), glm::value_ptr(_value), glm::value_ptr(_value) + 3);
+}
+
+void UniformBuffer::add(const glm::vec4& _value) {
+    align(4);
+    m_data.insert(m_data.end(), glm::value_ptr(_value), glm::value_ptr(_value) + 4);
+}
+
+void UniformBuffer::add(const glm::mat3& _value) {
+    // Columns are stored like an array of vec4
+    for (int i = 0; i < 3; i++) {
+        add(_value[i]);
+        align(4);
+    }
+}
+
+void UniformBuffer::add(const glm::mat4& _value) {
+    for (int i = 0; i < 4; i++) { add(_value[i]); }
+}
+
+void UniformBuffer::upload() {
+
+    if (m_data.empty() || (m_glHandle != 0 && m_data == m_uploaded)) { return; }
+
+    if (m_glHandle == 0) {
+        GL::genBuffers(1, &m_glHandle);
+        GL::bindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_glHandle);
+    }
+
+    // Sized to the whole block, the end of the last member is padded to a vec4
+    std::vector<float> data = m_data;
+    data.resize((data.size() + 3) / 4 * 4, 0.f);
+
+    GL::bindBuffer(GL_UNIFORM_BUFFER, m_glHandle);
+    GL::bufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(float), data.data(), GL_DYNAMIC_DRAW);
+
+    m_uploaded = m_data;
+}
+
+void UniformBuffer::dispose() {
+    if (m_glHandle != 0) {
+        GL::deleteBuffers(1, &m_glHandle);
+    }
+    invalidate();
+}
+
+void UniformBuffer::invalidate() {
+    m_glHandle = 0;
+    m_uploaded.clear();
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "gl.h"
+
+#include "glm/mat3x3.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+/* Values of a uniform block in std140 layout, shared by all programs through
+ * one binding point.
+ *
+ * Values are added in the order of the members of the block declaration, each
+ * at the alignment std140 requires for its type. upload() stores them in a GL
+ * buffer only when they changed since the last upload, so that a static view
+ * costs no GL calls per frame. Requires Hardware::supportsUniformBuffers.
+ */
+class UniformBuffer {
+
+public:
+
+    // Blocks of the style programs, see ShaderProgram::build()
+    static constexpr GLuint FRAME_BINDING = 0;
+    static constexpr GLuint LIGHTS_BINDING = 1;
+
+    static const std::string FRAME_BLOCK;
+    static const std::string LIGHTS_BLOCK;
+
+    explicit UniformBuffer(GLuint _binding) : m_binding(_binding) {}
+
+    void clear() { m_data.clear(); }
+
+    void add(float _value);
+    void add(const glm::vec2& _value);
+    void add(const glm::vec3& _value);
+    void add(const glm::vec4& _value);
+    void add(const glm::mat3& _value);
+    void add(const glm::mat4& _value);
+
+    // Start or end a struct member, structs are aligned like a vec4
+    void alignStruct() { align(4); }
+
+    // Values added since clear(), in units of floats
+    const std::vector<float>& data() const { return m_data; }
+
+    // Store the values in the buffer of the binding point, when they changed
+    void upload();
+
+    // Delete the buffer
+    void dispose();
+
+    // Drop the buffer handle without deleting it, after the GL context was lost
+    void invalidate();
+
+private:
+
+    void align(size_t _alignment);
+
+    GLuint m_binding;
+    GLuint m_glHandle = 0;
+
+    std::vector<float> m_data;
+    std::vector<float> m_uploaded;
+};
+
+}
@@ -196,6 +196,45 @@ void CurvedLabel::obbs(ScreenTransform& _transform, OBBBuffer& _obbs) {
     }
 }
 
+void CurvedLabel::prepareGlyphs() {
+
+    size_t first = m_textLabels.quads.size();
+    size_t last = 0;
+
+    for (auto& range : m_textRanges) {
+        if (range.length == 0) { continue; }
+        first = std::min(first, size_t(range.start));
+        last = std::max(last, size_t(range.end()));
+    }
+
+    m_glyphs = {};
+    if (first >= last) { return; }
+
+    m_glyphStart = first;
+    size_t count = last - first;
+
+    m_glyphs.start.resize(count);
+    m_glyphs.origin.resize(count);
+    m_glyphs.end.resize(count);
+    m_glyphs.cornerX.resize(count * 4);
+    m_glyphs.cornerY.resize(count * 4);
+
+    for (size_t i = 0; i < count; i++) {
+        auto& quad = m_textLabels.quads[first + i].quad;
+
+        float origin = (quad[0].pos.x + quad[2].pos.x) * 0.5f;
+
+        m_glyphs.start[i] = quad[0].pos.x * TextVertex::position_inv_scale;
+        m_glyphs.origin[i] = origin * TextVertex::position_inv_scale;
+        m_glyphs.end[i] = quad[2].pos.x * TextVertex::position_inv_scale;
+
+        for (int k = 0; k < 4; k++) {
+            m_glyphs.cornerX[i * 4 + k] = quad[k].pos.x - origin;
+            m_glyphs.cornerY[i * 4 + k] = quad[k].pos.y;
+        }
+    }
+}
+
 void CurvedLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2& _screenSize) {
     if (!visibleState()) { return; }
 
@@ -207,13 +246,13 @@ void CurvedLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2
         uint16_t(m_fontAttrib.fontScale),
     };
 
-    auto it = m_textLabels.quads.begin() + m_textRanges[m_textRangeIndex].start;
-    auto end = it + m_textRanges[m_textRangeIndex].length;
-    auto& style = m_textLabels.style;
+    auto& range = m_textRanges[m_textRangeIndex];
+    if (range.length == 0) { return; }
+
+    if (m_glyphs.size() == 0) { prepareGlyphs(); }
 
-    auto& meshes = style.getMeshes();
+    auto& style = m_textLabels.style;
 
-    glm::vec2 rotation;
     LineSampler<ScreenTransform> sampler { _transform };
 
     float width = m_dim.x;
@@ -222,65 +261,85 @@ void CurvedLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2
 
     float center = sampler.point(m_screenAnchorPoint).z;
 
-    std::array<glm::i16vec2, 4> vertexPosition;
+    const float minX = int16_t(-m_dim.y * TextVertex::position_scale);
+    const float minY = minX;
+    const float maxX = int16_t((_screenSize.x + m_dim.y) * TextVertex::position_scale);
+    const float maxY = int16_t((_screenSize.y + m_dim.y) * TextVertex::position_scale);
 
-    glm::i16vec2 min(-m_dim.y * TextVertex::position_scale);
-    glm::i16vec2 max((_screenSize + m_dim.y) * TextVertex::position_scale);
+    // Glyphs are placed in batches: sampling the line is sequential, the
+    // vertex positions of a batch are then computed in flat loops over
+    // the glyph table without branches.
+    const int batchSize = 16;
 
-    for (; it != end; ++it) {
-        auto quad = *it;
+    float pointX[batchSize], pointY[batchSize];
+    float rotX[batchSize], rotY[batchSize];
+    int glyph[batchSize];
+    float vertexX[batchSize * 4], vertexY[batchSize * 4];
 
-        glm::vec2 origin = {(quad.quad[0].pos.x + quad.quad[2].pos.x) * 0.5f, 0 };
-        glm::vec2 point, p1, p2, r1, r2;
+    size_t first = range.start - m_glyphStart;
+    size_t last = first + range.length;
 
-        auto xStart = quad.quad[0].pos.x * TextVertex::position_inv_scale;
-        auto xEnd = quad.quad[2].pos.x * TextVertex::position_inv_scale;
+    for (size_t batch = first; batch < last; batch += batchSize) {
+        size_t batchEnd = std::min(batch + batchSize, last);
+        int count = 0;
 
-        float px = origin.x * TextVertex::position_inv_scale;
-        if (!sampler.sample(center + px, point, rotation)) {
-            continue;
-        }
+        for (size_t i = batch; i < batchEnd; i++) {
+            glm::vec2 point, rotation, p1, p2, r1, r2;
 
-        bool ok1 = sampler.sample(center + xStart, p1, r1);
-        bool ok2 = sampler.sample(center + xEnd, p2, r2);
-        if (ok1 && ok2) {
-            if (r1 == r2) {
-                rotation = r1;
-            } else {
-                rotation = glm::normalize(p2 - p1);
+            if (!sampler.sample(center + m_glyphs.origin[i], point, rotation)) {
+                continue;
             }
-            //point = (p1 + p2) * 0.5f;
-            point = point * 0.5f + (p1 + p2) * 0.25f;
-        }
 
-        glm::i16vec2 p(point * TextVertex::position_scale);
-
-        rotation = {rotation.x, -rotation.y};
+            bool ok1 = sampler.sample(center + m_glyphs.start[i], p1, r1);
+            bool ok2 = sampler.sample(center + m_glyphs.end[i], p2, r2);
+            if (ok1 && ok2) {
+                if (r1 == r2) {
+                    rotation = r1;
+                } else {
+                    rotation = glm::normalize(p2 - p1);
+                }
+                point = point * 0.5f + (p1 + p2) * 0.25f;
+            }
 
-        bool visible = false;
+            // Truncate like the conversion to vertex units
+            pointX[count] = int16_t(point.x * TextVertex::position_scale);
+            pointY[count] = int16_t(point.y * TextVertex::position_scale);
+            rotX[count] = rotation.x;
+            rotY[count] = -rotation.y;
+            glyph[count] = i;
+            count++;
+        }
 
-        for (int i = 0; i < 4; i++) {
+        // rotateBy(corner, rotation) for the four corners of each glyph
+        for (int n = 0; n < count; n++) {
+            const float* cx = &m_glyphs.cornerX[glyph[n] * 4];
+            const float* cy = &m_glyphs.cornerY[glyph[n] * 4];
 
-            vertexPosition[i] = p + glm::i16vec2{rotateBy(glm::vec2(quad.quad[i].pos) - origin, rotation)};
+            for (int k = 0; k < 4; k++) {
+                float rx = cx[k] * rotX[n] + cy[k] * rotY[n];
+                float ry = -cx[k] * rotY[n] + cy[k] * rotX[n];
 
-            if (!visible &&
-                vertexPosition[i].x > min.x &&
-                vertexPosition[i].x < max.x &&
-                vertexPosition[i].y > min.y &&
-                vertexPosition[i].y < max.y) {
-                visible = true;
+                vertexX[n * 4 + k] = pointX[n] + float(int16_t(rx));
+                vertexY[n * 4 + k] = pointY[n] + float(int16_t(ry));
             }
         }
 
-        if (!visible) { continue; }
+        for (int n = 0; n < count; n++) {
+            const float* vx = &vertexX[n * 4];
+            const float* vy = &vertexY[n * 4];
+
+            bool visible = false;
+            for (int k = 0; k < 4; k++) {
+                visible |= (vx[k] > minX && vx[k] < maxX &&
+                            vy[k] > minY && vy[k] < maxY);
+            }
+
+            if (!visible) { continue; }
 
-        auto* quadVertices = meshes[it->atlas]->pushQuad();
+            std::array<glm::i16vec2, 4> positions;
+            for (int k = 0; k < 4; k++) { positions[k] = glm::i16vec2(vx[k], vy[k]); }
 
-        for (int i = 0; i < 4; i++) {
-            TextVertex& v = quadVertices[i];
-            v.pos = vertexPosition[i];
-            v.uv = quad.quad[i].uv;
-            v.state = state;
+            style.pushQuad(m_textLabels.quads[m_glyphStart + glyph[n]], positions, state);
         }
     }
 }
@@ -55,8 +55,25 @@ public:
         return m_modelTransform[m_anchorPoint];
     }
 
+    /* Precompute the glyph sample offsets of the text ranges. Must be
+     * called once the quads of m_textLabels are final; otherwise done
+     * on the first addVerticesToMesh(). */
+    void prepareGlyphs();
+
 protected:
 
+    /* Per glyph quad of m_textRanges, starting at m_glyphStart. Offsets
+     * are in pixels along the line relative to the label center; corners
+     * are in vertex units relative to the glyph origin. */
+    struct GlyphTable {
+        std::vector<float> start, origin, end;
+        std::vector<float> cornerX, cornerY;  // 4 per glyph
+        size_t size() const { return origin.size(); }
+    };
+
+    GlyphTable m_glyphs;
+    size_t m_glyphStart = 0;
+
     const std::vector<glm::vec2> m_modelTransform;
 
     const size_t m_anchorPoint;
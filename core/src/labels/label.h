@@ -91,6 +91,9 @@ public:
 
     virtual const Texture* texture() const { return nullptr; }
 
+    // Approximate size in bytes of this label
+    virtual size_t memoryUsage() const { return sizeof(Label); }
+
     bool update(const glm::mat4& _mvp, const ViewState& _viewState,
                 const AABB* _bounds, ScreenTransform& _transform);
 
@@ -180,6 +183,29 @@ protected:
     float m_alpha;
 };
 
+/* Deletes labels allocated with new, and only destroys the labels constructed
+ * in a LabelPool, whose memory is released with the pool */
+struct LabelDeleter {
+    LabelDeleter() = default;
+    explicit LabelDeleter(bool _pooled) : pooled(_pooled) {}
+
+    // Conversion from std::unique_ptr of a label type, e.g. from std::make_unique
+    template<typename T>
+    LabelDeleter(const std::default_delete<T>&) {}
+
+    void operator()(Label* _label) const {
+        if (pooled) {
+            _label->~Label();
+        } else {
+            delete _label;
+        }
+    }
+
+    bool pooled = false;
+};
+
+using LabelPtr = std::unique_ptr<Label, LabelDeleter>;
+
 }
 
 namespace std {
@@ -3,20 +3,63 @@
 #include "labels/curvedLabel.h"
 #include "labels/labelSet.h"
 #include "labels/obbBuffer.h"
+#include "map.h"
+#include "util/hash.h"
 #include "view/view.h" // ViewState
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/norm.hpp"
 
+#include <algorithm>
+
 namespace Tangram {
 
-void LabelCollider::addLabels(std::vector<std::unique_ptr<Label>>& _labels) {
+void LabelCollider::addLabels(std::vector<LabelPtr>& _labels) {
 
     for (auto& label : _labels) {
         if (label->canOcclude()) {
-            m_labels.push_back(label.get());
+            m_labels.emplace_back(label.get(), m_count++);
+
+            size_t seed = m_signature;
+            hash_combine(seed, label->hash());
+            hash_combine(seed, int(label->type()));
+            hash_combine(seed, label->candidatePriority());
+            hash_combine(seed, label->modelCenter().x);
+            hash_combine(seed, label->modelCenter().y);
+            m_signature = seed;
+        }
+    }
+}
+
+void LabelCollider::clear() {
+    m_labels.clear();
+    m_aabbs.clear();
+    m_count = 0;
+    m_signature = 0;
+}
+
+bool LabelCollider::apply(const LabelLayout& _layout) {
+
+    if (_layout.signature != m_signature || _layout.placements.size() != m_count) { return false; }
+
+    for (auto& entry : m_labels) {
+        auto* label = entry.label;
+
+        switch (_layout.placements[entry.index]) {
+        case LabelLayout::visible:
+            label->enterState(Label::State::none, 0.0f);
+            break;
+        case LabelLayout::occluded:
+            label->occlude();
+            label->enterState(Label::State::dead, 0.0f);
+            break;
+        default:
+            break;
         }
     }
+
+    clear();
+    return true;
 }
 
 size_t LabelCollider::filterRepeatGroups(size_t startPos, size_t curPos) {
@@ -56,7 +99,12 @@ size_t LabelCollider::filterRepeatGroups(size_t startPos, size_t curPos) {
     return endPos;
 }
 
-void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tileSize) {
+void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tileSize, LabelLayout* _layout) {
+
+    if (_layout) {
+        _layout->signature = m_signature;
+        _layout->placements.assign(m_count, LabelLayout::unplaced);
+    }
 
     // Sort labels so that all labels of one repeat group are next to each other
     std::sort(m_labels.begin(), m_labels.end(),
@@ -131,14 +179,29 @@ void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tile
         }
     }
 
-    if (m_labels.empty()) { return; }
+    if (m_labels.empty()) {
+        clear();
+        return;
+    }
+
+    bool useGrid = !Tangram::getDebugFlag(DebugFlags::isect2d_collisions);
 
-    m_isect2d.resize({screenSize.x / 128, screenSize.y / 128}, screenSize);
+    if (useGrid) {
+        m_sizes.clear();
+        for (auto& aabb : m_aabbs) {
+            m_sizes.push_back(std::max(aabb.max.x - aabb.min.x, aabb.max.y - aabb.min.y));
+        }
+        m_grid.resize(screenSize, LabelGrid::cellSize(m_sizes));
+        m_grid.intersect(m_aabbs);
+    } else {
+        m_isect2d.resize({screenSize.x / 128, screenSize.y / 128}, screenSize);
+        m_isect2d.intersect(m_aabbs);
+    }
 
-    m_isect2d.intersect(m_aabbs);
+    auto& pairs = useGrid ? m_grid.pairs : m_isect2d.pairs;
 
     // Set the first item to be the one with higher priority
-    for (auto& pair : m_isect2d.pairs) {
+    for (auto& pair : pairs) {
 
         auto& e1 = m_labels[pair.first];
         auto& e2 = m_labels[pair.second];
@@ -156,7 +219,7 @@ void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tile
     }
 
     // Sort by priority on the first item
-    std::sort(m_isect2d.pairs.begin(), m_isect2d.pairs.end(),
+    std::sort(pairs.begin(), pairs.end(),
               [&](auto& a, auto& b) {
 
                   if (a.first == b.first) { return a.second < b.second; }
@@ -200,7 +263,7 @@ void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tile
     size_t lastFilteredLabelIndex = 0;
 
     // Narrow Phase, resolve conflicts
-    for (auto& pair : m_isect2d.pairs) {
+    for (auto& pair : pairs) {
 
         auto& e1 = m_labels[pair.first];
         auto& e2 = m_labels[pair.second];
@@ -296,8 +359,14 @@ void LabelCollider::process(TileID _tileID, float _tileInverseScale, float _tile
         }
     }
 
-    m_labels.clear();
-    m_aabbs.clear();
+    if (_layout) {
+        for (auto& entry : m_labels) {
+            _layout->placements[entry.index] = entry.label->isOccluded() ?
+                LabelLayout::occluded : LabelLayout::visible;
+        }
+    }
+
+    clear();
 }
 
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "labels/label.h"
+#include "labels/labelGrid.h"
+#include "labels/labelLayout.h"
 #include "labels/screenTransform.h"
 #include "util/mapProjection.h"
 #include "util/types.h"
@@ -20,26 +22,41 @@ class LabelCollider {
 public:
 
 
-    void addLabels(std::vector<std::unique_ptr<Label>>& _labels);
+    void addLabels(std::vector<LabelPtr>& _labels);
 
-    void process(TileID _tileID, float _tileInverseScale, float _tileSize);
+    bool empty() const { return m_labels.empty(); }
+
+    /* Place the added labels as in _layout of a previous build of the tile,
+     * instead of colliding them. Returns false and keeps the labels for
+     * process() when _layout was made for other labels. */
+    bool apply(const LabelLayout& _layout);
+
+    /* Collide the added labels, the result is stored in _layout when it is
+     * not null */
+    void process(TileID _tileID, float _tileInverseScale, float _tileSize, LabelLayout* _layout = nullptr);
 
 private:
 
     size_t filterRepeatGroups(size_t startPos, size_t curPos);
 
+    void clear();
+
     using AABB = isect2d::AABB<glm::vec2>;
     using OBB = isect2d::OBB<glm::vec2>;
     using CollisionPairs = std::vector<isect2d::ISect2D<glm::vec2>::Pair>;
 
     struct LabelEntry {
 
-        LabelEntry(Label* _label)
+        LabelEntry(Label* _label, uint32_t _index)
             : label(_label),
+              index(_index),
               priority(_label->options().priority) {}
 
         Label* label;
 
+        // Position in the order the labels were added
+        uint32_t index;
+
         float priority;
 
         Range obbs;
@@ -49,10 +66,15 @@ private:
     // Parallel vectors
 
     std::vector<LabelEntry> m_labels;
+    // Number and signature of the added labels, see LabelLayout
+    uint32_t m_count = 0;
+    uint64_t m_signature = 0;
     std::vector<AABB> m_aabbs;
     std::vector<OBB> m_obbs;
 
     isect2d::ISect2D<glm::vec2> m_isect2d;
+    LabelGrid m_grid;
+    std::vector<float> m_sizes;
 
     ScreenTransform::Buffer m_transforms;
 };
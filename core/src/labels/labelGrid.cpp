@@ -0,0 +1,103 @@
+#include "labels/labelGrid.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+constexpr float LabelGrid::MIN_CELL_SIZE;
+constexpr float LabelGrid::MAX_CELL_SIZE;
+
+float LabelGrid::cellSize(std::vector<float>& _sizes) {
+    if (_sizes.empty()) { return MAX_CELL_SIZE; }
+
+    auto median = _sizes.begin() + _sizes.size() / 2;
+    std::nth_element(_sizes.begin(), median, _sizes.end());
+
+    return std::max(MIN_CELL_SIZE, std::min(MAX_CELL_SIZE, *median * 2.f));
+}
+
+void LabelGrid::resize(glm::vec2 _size, float _cellSize) {
+    _cellSize = std::max(_cellSize, MIN_CELL_SIZE);
+
+    m_cells = glm::max(glm::ivec2(glm::ceil(_size / _cellSize)), glm::ivec2(1));
+    m_invCellSize = glm::vec2(1.f / _cellSize);
+
+    clear();
+}
+
+void LabelGrid::clear() {
+    m_cellHead.assign(m_cells.x * m_cells.y, -1);
+
+    m_minX.clear();
+    m_minY.clear();
+    m_maxX.clear();
+    m_maxY.clear();
+    m_userData.clear();
+    m_visited.clear();
+
+    m_nodeBox.clear();
+    m_nodeNext.clear();
+}
+
+void LabelGrid::cellRange(const AABB& _aabb, glm::ivec2& _min, glm::ivec2& _max) const {
+    glm::ivec2 last = m_cells - 1;
+
+    // Clamp in float to not overflow int for boxes far off screen
+    glm::vec2 min = glm::clamp(_aabb.min * m_invCellSize, glm::vec2(0), glm::vec2(last));
+    glm::vec2 max = glm::clamp(_aabb.max * m_invCellSize, glm::vec2(0), glm::vec2(last));
+
+    _min = glm::ivec2(min);
+    _max = glm::ivec2(max);
+}
+
+bool LabelGrid::nextQuery() {
+    if (++m_query != 0) { return false; }
+
+    // Wrapped around: visited marks of old queries would match again
+    m_query = 1;
+    return true;
+}
+
+void LabelGrid::insert(const AABB& _aabb) {
+    int32_t box = m_minX.size();
+
+    m_minX.push_back(_aabb.min.x);
+    m_minY.push_back(_aabb.min.y);
+    m_maxX.push_back(_aabb.max.x);
+    m_maxY.push_back(_aabb.max.y);
+    m_userData.push_back(_aabb.m_userData);
+    m_visited.push_back(0);
+
+    glm::ivec2 min, max;
+    cellRange(_aabb, min, max);
+
+    for (int y = min.y; y <= max.y; y++) {
+        for (int x = min.x; x <= max.x; x++) {
+            auto& head = m_cellHead[y * m_cells.x + x];
+            m_nodeBox.push_back(box);
+            m_nodeNext.push_back(head);
+            head = m_nodeBox.size() - 1;
+        }
+    }
+}
+
+void LabelGrid::intersect(const std::vector<AABB>& _aabbs) {
+    clear();
+    pairs.clear();
+
+    for (size_t i = 0; i < _aabbs.size(); i++) {
+        AABB aabb = _aabbs[i];
+        aabb.m_userData = reinterpret_cast<void*>(i);
+        insert(aabb);
+    }
+
+    for (size_t i = 0; i < _aabbs.size(); i++) {
+        intersect(_aabbs[i], [&](auto& a, auto& b) {
+            size_t other = reinterpret_cast<size_t>(b.m_userData);
+            if (other > i) { pairs.push_back({ int(i), int(other) }); }
+            return true;
+        });
+    }
+}
+
+}
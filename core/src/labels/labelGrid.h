@@ -0,0 +1,110 @@
+#pragma once
+
+#include "glm_vec.h" // for isect2d.h
+#include "isect2d.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Tangram {
+
+/* Broadphase for label collisions on a flat uniform grid
+ *
+ * Boxes are stored as parallel arrays and linked into the cells they
+ * overlap through per-cell lists of node indices. The grid keeps its
+ * arrays between frames: clear() and resize() only reset the cell heads,
+ * so that no allocations happen once the buffers have grown to the
+ * number of labels on screen.
+ *
+ * Offers the parts of the isect2d::ISect2D interface used by Labels and
+ * LabelCollider, so that both can be switched with
+ * DebugFlags::isect2d_collisions.
+ */
+class LabelGrid {
+
+public:
+
+    using AABB = isect2d::AABB<glm::vec2>;
+    using Pair = isect2d::ISect2D<glm::vec2>::Pair;
+
+    /* Cell size as twice the median of the label box extents _sizes,
+     * clamped to [MIN_CELL_SIZE, MAX_CELL_SIZE]. Reorders _sizes. */
+    static float cellSize(std::vector<float>& _sizes);
+
+    static constexpr float MIN_CELL_SIZE = 16.f;
+    static constexpr float MAX_CELL_SIZE = 256.f;
+
+    /* Cover the area from (0, 0) to _size. Boxes outside of it are
+     * assigned to the border cells. Removes all boxes. */
+    void resize(glm::vec2 _size, float _cellSize);
+
+    void clear();
+
+    void insert(const AABB& _aabb);
+
+    /* Calls _callback(_aabb, other) for each inserted box that intersects
+     * _aabb, until it returns false. */
+    template<typename F>
+    void intersect(const AABB& _aabb, F&& _callback);
+
+    /* Insert _aabbs and set 'pairs' to the index pairs of all
+     * intersecting boxes, with first < second. */
+    void intersect(const std::vector<AABB>& _aabbs);
+
+    std::vector<Pair> pairs;
+
+private:
+
+    void cellRange(const AABB& _aabb, glm::ivec2& _min, glm::ivec2& _max) const;
+
+    bool nextQuery();
+
+    glm::ivec2 m_cells = { 1, 1 };
+    glm::vec2 m_invCellSize = { 1.f, 1.f };
+
+    // Inserted boxes
+    std::vector<float> m_minX, m_minY, m_maxX, m_maxY;
+    std::vector<void*> m_userData;
+    // Query in which the box was last visited, to report it once
+    std::vector<uint32_t> m_visited;
+    uint32_t m_query = 0;
+
+    // First node per cell, -1 when empty
+    std::vector<int32_t> m_cellHead;
+    // Cell list nodes: inserted box and next node in the cell
+    std::vector<int32_t> m_nodeBox, m_nodeNext;
+};
+
+template<typename F>
+void LabelGrid::intersect(const AABB& _aabb, F&& _callback) {
+    if (m_minX.empty()) { return; }
+
+    if (nextQuery()) {
+        std::fill(m_visited.begin(), m_visited.end(), 0);
+    }
+
+    glm::ivec2 min, max;
+    cellRange(_aabb, min, max);
+
+    for (int y = min.y; y <= max.y; y++) {
+        for (int x = min.x; x <= max.x; x++) {
+            for (int32_t node = m_cellHead[y * m_cells.x + x]; node >= 0; node = m_nodeNext[node]) {
+                int32_t box = m_nodeBox[node];
+                if (m_visited[box] == m_query) { continue; }
+                m_visited[box] = m_query;
+
+                if (_aabb.min.x > m_maxX[box] || _aabb.max.x < m_minX[box] ||
+                    _aabb.min.y > m_maxY[box] || _aabb.max.y < m_minY[box]) {
+                    continue;
+                }
+
+                AABB other(m_minX[box], m_minY[box], m_maxX[box], m_maxY[box]);
+                other.m_userData = m_userData[box];
+
+                if (!_callback(_aabb, other)) { return; }
+            }
+        }
+    }
+}
+
+}
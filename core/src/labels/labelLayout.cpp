@@ -0,0 +1,51 @@
+#include "labels/labelLayout.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+bool LabelLayoutCache::get(int32_t _sourceId, const TileID& _tileId, LabelLayout& _layout) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_layouts.find(key(_sourceId, _tileId));
+    if (it == m_layouts.end()) { return false; }
+
+    _layout = it->second;
+    return true;
+}
+
+void LabelLayoutCache::put(int32_t _sourceId, const TileID& _tileId, const LabelLayout& _layout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Key k = key(_sourceId, _tileId);
+    auto entry = m_layouts.emplace(k, _layout);
+    if (entry.second) {
+        m_order.push_back(k);
+    } else {
+        m_bytes -= entry.first->second.bytes();
+        entry.first->second = _layout;
+    }
+    m_bytes += _layout.bytes();
+
+    while (m_bytes > m_maxBytes && m_order.size() > 1) {
+        auto it = m_layouts.find(m_order.front());
+        m_order.pop_front();
+        if (it == m_layouts.end()) { continue; }
+        m_bytes -= it->second.bytes();
+        m_layouts.erase(it);
+    }
+}
+
+size_t LabelLayoutCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_layouts.size();
+}
+
+void LabelLayoutCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_layouts.clear();
+    m_order.clear();
+    m_bytes = 0;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "tile/tileID.h"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Tangram {
+
+/* Result of the tile-local collision pass of LabelCollider
+ *
+ * Holds the placement of each label of a tile in the order the style builders
+ * added them, and a signature of those labels: their parameter hashes,
+ * priorities, repeat groups and positions. A tile that is built again with
+ * the same labels takes the placements instead of colliding them again.
+ */
+struct LabelLayout {
+
+    enum Placement : uint8_t {
+        // No screen transform at the zoom of the collision pass
+        unplaced = 0,
+        visible,
+        occluded,
+    };
+
+    uint64_t signature = 0;
+    std::vector<uint8_t> placements;
+
+    size_t bytes() const { return sizeof(*this) + placements.size(); }
+};
+
+/* Label layouts of recently built tiles of one scene, shared by the tile
+ * workers. The oldest layouts are evicted above _maxBytes. */
+class LabelLayoutCache {
+
+public:
+
+    explicit LabelLayoutCache(size_t _maxBytes = 1024 * 1024) : m_maxBytes(_maxBytes) {}
+
+    bool get(int32_t _sourceId, const TileID& _tileId, LabelLayout& _layout) const;
+
+    void put(int32_t _sourceId, const TileID& _tileId, const LabelLayout& _layout);
+
+    size_t size() const;
+
+    // Drop all layouts, e.g. when labels are placed for another pixel scale
+    void clear();
+
+private:
+
+    using Key = std::pair<int32_t, TileID>;
+
+    static Key key(int32_t _sourceId, const TileID& _tileId) {
+        return { _sourceId, TileID(_tileId.x, _tileId.y, _tileId.z, _tileId.s, 0) };
+    }
+
+    mutable std::mutex m_mutex;
+    std::map<Key, LabelLayout> m_layouts;
+    // Stored layouts, oldest first
+    std::deque<Key> m_order;
+    size_t m_bytes = 0;
+    size_t m_maxBytes;
+};
+
+}
@@ -0,0 +1,34 @@
+#include "labels/labelPool.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Tangram {
+
+// Tiles with few labels keep a small block, larger ones double up to the maximum
+static constexpr size_t minBlockSize = 2048;
+static constexpr size_t maxBlockSize = 64 * 1024;
+
+void* LabelPool::allocate(size_t _bytes, size_t _align) {
+
+    auto aligned = [&]() {
+        uintptr_t pos = reinterpret_cast<uintptr_t>(m_pos);
+        return reinterpret_cast<char*>((pos + _align - 1) & ~(uintptr_t(_align) - 1));
+    };
+
+    char* pos = m_pos ? aligned() : nullptr;
+    if (!pos || pos + _bytes > m_end) {
+        size_t size = std::min(std::max(minBlockSize, m_capacity), maxBlockSize);
+        size = std::max(size, _bytes + _align);
+
+        m_blocks.emplace_back(new char[size]);
+        m_pos = m_blocks.back().get();
+        m_end = m_pos + size;
+        m_capacity += size;
+        pos = aligned();
+    }
+    m_pos = pos + _bytes;
+    return pos;
+}
+
+}
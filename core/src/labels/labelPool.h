@@ -0,0 +1,47 @@
+#pragma once
+
+#include "labels/label.h"
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Tangram {
+
+/* Contiguous storage for the labels of a tile
+ *
+ * Labels are constructed in blocks, which grow with the number of labels, so
+ * that the labels a LabelSet visits each frame are close to each other in
+ * memory instead of being single heap allocations. Memory is only released
+ * with the pool: the labels of a pool must be destroyed before it, which the
+ * LabelSet that shares the pool takes care of.
+ */
+class LabelPool {
+
+public:
+
+    LabelPool() = default;
+    LabelPool(const LabelPool&) = delete;
+    LabelPool& operator=(const LabelPool&) = delete;
+
+    template<typename T, typename... Args>
+    LabelPtr make(Args&&... _args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return LabelPtr(new (memory) T(std::forward<Args>(_args)...), LabelDeleter(true));
+    }
+
+    /* Bytes reserved by the blocks of this pool */
+    size_t capacity() const { return m_capacity; }
+
+private:
+
+    void* allocate(size_t _bytes, size_t _align);
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_pos = nullptr;
+    char* m_end = nullptr;
+    size_t m_capacity = 0;
+};
+
+}
@@ -10,8 +10,8 @@ void LabelSet::reset() {
     }
 }
 
-void LabelSet::setLabels(std::vector<std::unique_ptr<Label>>& _labels) {
-    typedef std::vector<std::unique_ptr<Label>>::iterator iter_t;
+void LabelSet::setLabels(std::vector<LabelPtr>& _labels) {
+    typedef std::vector<LabelPtr>::iterator iter_t;
     m_labels.clear();
     m_labels.insert(m_labels.end(),
                     std::move_iterator<iter_t>(_labels.begin()),
@@ -20,4 +20,19 @@ void LabelSet::setLabels(std::vector<std::unique_ptr<Label>>& _labels) {
     _labels.clear();
 }
 
+void LabelSet::addLabels(LabelSet& _other) {
+    typedef std::vector<LabelPtr>::iterator iter_t;
+    m_pools.insert(m_pools.end(), _other.m_pools.begin(), _other.m_pools.end());
+    m_labels.insert(m_labels.end(),
+                    std::move_iterator<iter_t>(_other.m_labels.begin()),
+                    std::move_iterator<iter_t>(_other.m_labels.end()));
+
+    _other.m_labels.clear();
+}
+
+LabelPool& LabelSet::pool() {
+    if (m_pools.empty()) { m_pools.push_back(std::make_shared<LabelPool>()); }
+    return *m_pools.front();
+}
+
 }
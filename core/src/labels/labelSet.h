@@ -1,6 +1,7 @@
 #pragma once
 
 #include "labels/label.h"
+#include "labels/labelPool.h"
 #include "style/style.h"
 
 #include <vector>
@@ -20,12 +21,20 @@ public:
 
     size_t bufferSize() const override { return 0; }
 
-    void setLabels(std::vector<std::unique_ptr<Label>>& _labels);
+    void setLabels(std::vector<LabelPtr>& _labels);
+
+    /* Moves the labels of _other to the end of this set, with the pools they were constructed in */
+    void addLabels(LabelSet& _other);
+
+    /* Storage for the labels of this set, builders construct them in it */
+    LabelPool& pool();
 
     void reset();
 
 protected:
-    std::vector<std::unique_ptr<Label>> m_labels;
+    // Declared before m_labels, so that pooled labels are destroyed before their pools
+    std::vector<std::shared_ptr<LabelPool>> m_pools;
+    std::vector<LabelPtr> m_labels;
 };
 
 }
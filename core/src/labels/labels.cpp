@@ -17,6 +17,8 @@
 #include "tile/tile.h"
 #include "tile/tileCache.h"
 #include "tile/tileManager.h"
+#include "util/asyncWorker.h"
+#include "util/radixSort.h"
 #include "view/view.h"
 
 #include "glm/glm.hpp"
@@ -24,19 +26,95 @@
 #include "glm/gtx/rotate_vector.hpp"
 #include "glm/gtx/norm.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <thread>
 
 namespace Tangram {
 
+using AABB = isect2d::AABB<glm::vec2>;
+
+// Minimum number of labels for which screen transforms are computed on
+// worker threads
+static const size_t PARALLEL_LABEL_COUNT = 512;
+
+static const size_t MAX_LABEL_WORKERS = 3;
+
+static AABB emptyAABB() {
+    float max = std::numeric_limits<float>::max();
+    return AABB(max, max, -max, -max);
+}
+
+static bool isEmpty(const AABB& _aabb) { return _aabb.min.x > _aabb.max.x; }
+
+static void includeAABB(AABB& _aabb, const AABB& _other) {
+    _aabb.min = glm::min(_aabb.min, _other.min);
+    _aabb.max = glm::max(_aabb.max, _other.max);
+}
+
 Labels::Labels()
     : m_needUpdate(false),
+      m_damage(emptyAABB()),
       m_lastZoom(0.0f) {}
 
 Labels::~Labels() {}
 
-void Labels::processLabelUpdate(const ViewState& _viewState, const LabelSet* _labelSet, Style* _style,
-                                const Tile* _tile, const Marker* _marker, const glm::mat4& _mvp,
-                                float _dt, bool _drawAll, bool _onlyRender, bool _isProxy) {
+// Screen area of _label, a square around its center which also bounds the
+// text of labels along lines
+static AABB labelBounds(const Label& _label) {
+    glm::vec2 dim = _label.dimension();
+    glm::vec2 offset = glm::abs(_label.options().offset);
+    float radius = 0.5f * std::max(dim.x, dim.y) + std::max(offset.x, offset.y) + 1.f;
+    glm::vec2 center = _label.screenCenter();
+    return AABB(center.x - radius, center.y - radius, center.x + radius, center.y + radius);
+}
+
+void Labels::evalState(Label& _label, const Marker* _marker, float _dt) {
+
+    auto state = _label.state();
+    bool transition = _label.evalState(_dt);
+    m_needUpdate |= transition;
+
+    if (_marker) {
+        auto bounds = labelBounds(_label);
+        auto last = m_markerBounds.find(&_label);
+        if (last == m_markerBounds.end()) {
+            includeAABB(m_damage, bounds);
+        } else if (last->second.min != bounds.min || last->second.max != bounds.max) {
+            includeAABB(m_damage, bounds);
+            includeAABB(m_damage, last->second);
+        }
+        m_nextMarkerBounds.emplace(&_label, bounds);
+    }
+
+    if (transition || state != _label.state()) {
+        includeAABB(m_damage, labelBounds(_label));
+    }
+}
+
+void Labels::addUpdateJob(const LabelSet* _labelSet, Style* _style, const Tile* _tile,
+                          const Marker* _marker, const glm::mat4& _mvp, bool _isProxy) {
+
+    if (m_jobCount == m_updateJobs.size()) { m_updateJobs.emplace_back(); }
+
+    auto& job = m_updateJobs[m_jobCount++];
+    job.labelSet = _labelSet;
+    job.style = _style;
+    job.tile = _tile;
+    job.marker = _marker;
+    job.mvp = _mvp;
+    job.proxy = _isProxy;
+    job.transforms.clear();
+    job.updated.clear();
+}
+
+void Labels::transformLabels(UpdateJob& _job, const ViewState& _viewState,
+                             bool _drawAll, bool _onlyRender) {
 
     // TODO appropriate buffer to filter out-of-screen labels
     float border = 256.0f;
@@ -48,39 +126,104 @@ void Labels::processLabelUpdate(const ViewState& _viewState, const LabelSet* _la
                       _viewState.viewportSize.x,
                       _viewState.viewportSize.y);
 
-    for (auto& label : _labelSet->getLabels()) {
+    for (auto& label : _job.labelSet->getLabels()) {
         if (!_drawAll && (label->state() == Label::State::dead) ) {
             continue;
         }
 
         Range transformRange;
-        ScreenTransform transform { m_transforms, transformRange };
+        ScreenTransform transform { _job.transforms, transformRange };
 
         // Use extendedBounds when labels take part in collision detection.
         auto bounds = (_onlyRender || !label->canOcclude())
             ? screenBounds
             : extendedBounds;
 
-        if (!label->update(_mvp, _viewState, &bounds, transform)) {
+        if (!label->update(_job.mvp, _viewState, &bounds, transform)) {
             continue;
         }
 
+        _job.updated.emplace_back(label.get(), transformRange);
+    }
+}
+
+void Labels::runUpdateJobs(const ViewState& _viewState, bool _drawAll, bool _onlyRender) {
+
+    size_t labelCount = 0;
+    for (size_t i = 0; i < m_jobCount; i++) {
+        labelCount += m_updateJobs[i].labelSet->getLabels().size();
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < m_jobCount) {
+            transformLabels(m_updateJobs[i], _viewState, _drawAll, _onlyRender);
+        }
+    };
+
+    size_t helpers = 0;
+    if (labelCount >= PARALLEL_LABEL_COUNT && m_jobCount > 1) {
+        if (m_workers.empty()) {
+            size_t threads = std::thread::hardware_concurrency();
+            size_t workers = std::min(threads > 1 ? threads - 1 : 0, MAX_LABEL_WORKERS);
+            for (size_t i = 0; i < workers; i++) {
+                m_workers.push_back(std::make_unique<AsyncWorker>());
+            }
+        }
+        helpers = std::min(m_workers.size(), m_jobCount - 1);
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t pending = helpers;
+
+    for (size_t i = 0; i < helpers; i++) {
+        m_workers[i]->enqueue([&]() {
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+            condition.notify_one();
+        });
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]{ return pending == 0; });
+}
+
+void Labels::processLabelUpdate(const ViewState& _viewState, UpdateJob& _job,
+                                float _dt, bool _onlyRender) {
+
+    // Move the transforms of the job into m_transforms
+    size_t offset = m_transforms.points.size();
+    m_transforms.points.insert(m_transforms.points.end(),
+                               _job.transforms.points.begin(),
+                               _job.transforms.points.end());
+
+    for (auto& updated : _job.updated) {
+        Label* label = updated.first;
+        Range transformRange = updated.second;
+        transformRange.start += offset;
+
+        ScreenTransform transform { m_transforms, transformRange };
 
         if (_onlyRender) {
             if (label->occludedLastFrame()) { label->occlude(); }
 
             if (label->visibleState() || !label->canOcclude()) {
-                m_needUpdate |= label->evalState(_dt);
+                evalState(*label, _job.marker, _dt);
                 label->addVerticesToMesh(transform, _viewState.viewportSize);
             }
         } else if (label->canOcclude()) {
-            m_labels.emplace_back(label.get(), _style, _tile, _marker, _isProxy, transformRange);
+            m_labels.emplace_back(label, _job.style, _job.tile, _job.marker, _job.proxy, transformRange);
         } else {
-            m_needUpdate |= label->evalState(_dt);
+            evalState(*label, _job.marker, _dt);
             label->addVerticesToMesh(transform, _viewState.viewportSize);
         }
         if (label->selectionColor()) {
-            m_selectionLabels.emplace_back(label.get(), _style, _tile, _marker, _isProxy, transformRange);
+            m_selectionLabels.emplace_back(label, _job.style, _job.tile, _job.marker, _job.proxy, transformRange);
         }
     }
 }
@@ -109,11 +252,18 @@ void Labels::updateLabels(const ViewState& _viewState, float _dt,
     m_selectionLabels.clear();
 
     m_needUpdate = false;
+    m_jobCount = 0;
+
+    m_damage = emptyAABB();
+    m_markerBounds.swap(m_nextMarkerBounds);
+    m_nextMarkerBounds.clear();
 
     // int lodDiscard = LODDiscardFunc(View::s_maxZoom, _view.getZoom());
 
     bool drawAllLabels = Tangram::getDebugFlag(DebugFlags::draw_all_labels);
 
+    m_labelUpdate++;
+
     for (const auto& tile : _tiles) {
 
         //LOG("tile: %d/%d z:%d,%d", tile->getID().x, tile->getID().y, tile->getID().z, tile->getID().s);
@@ -127,16 +277,17 @@ void Labels::updateLabels(const ViewState& _viewState, float _dt,
 
         glm::mat4 mvp = tile->mvp();
 
-        for (const auto& style : _styles) {
-            const auto& mesh = tile->getMesh(*style);
-            auto labels = dynamic_cast<const LabelSet*>(mesh.get());
-            if (!labels) { continue; }
-
-            processLabelUpdate(_viewState, labels, style.get(), tile.get(), nullptr, mvp,
-                               _dt, drawAllLabels, _onlyRender, proxyTile);
+        for (const auto& labels : tileLabelSets(tile, _styles)) {
+            addUpdateJob(labels.second, labels.first, tile.get(), nullptr, mvp, proxyTile);
         }
     }
 
+    // Forget the tiles that are not drawn anymore
+    for (auto it = m_tileLabels.begin(); it != m_tileLabels.end();) {
+        if (it->second.update != m_labelUpdate) { it = m_tileLabels.erase(it); }
+        else { ++it; }
+    }
+
     for (const auto& marker : _markers) {
 
         if (!marker->isVisible() || !marker->mesh()) { continue; }
@@ -149,14 +300,50 @@ void Labels::updateLabels(const ViewState& _viewState, float _dt,
             auto labels = dynamic_cast<const LabelSet*>(mesh);
             if (!labels) { continue; }
 
-            processLabelUpdate(_viewState, labels, style.get(), nullptr, marker.get(),
-                               marker->modelViewProjectionMatrix(),
-                               _dt, drawAllLabels, _onlyRender, false);
+            addUpdateJob(labels, style.get(), nullptr, marker.get(),
+                         marker->modelViewProjectionMatrix(), false);
         }
     }
+
+    // Screen transforms of the labels are independent of each other and
+    // computed concurrently. Adding labels and mesh vertices stays in order
+    // on this thread.
+    runUpdateJobs(_viewState, drawAllLabels, _onlyRender);
+
+    for (size_t i = 0; i < m_jobCount; i++) {
+        processLabelUpdate(_viewState, m_updateJobs[i], _dt, _onlyRender);
+    }
 }
 
-void Labels::skipTransitions(const std::vector<const Style*>& _styles, Tile& _tile, Tile& _proxy) const {
+const std::vector<std::pair<Style*, const LabelSet*>>& Labels::tileLabelSets(
+    const std::shared_ptr<Tile>& _tile, const std::vector<std::unique_ptr<Style>>& _styles) {
+
+    auto& entry = m_tileLabels[_tile.get()];
+    entry.update = m_labelUpdate;
+
+    if (entry.tile.lock() == _tile) { return entry.sets; }
+
+    entry.tile = _tile;
+    entry.sets.clear();
+    for (const auto& style : _styles) {
+        auto labels = dynamic_cast<const LabelSet*>(_tile->getMesh(*style).get());
+        if (labels) { entry.sets.emplace_back(style.get(), labels); }
+    }
+    m_newTiles.push_back(_tile);
+
+    return entry.sets;
+}
+
+// Identifies the label of a feature across zoom levels. The repeat group hash
+// includes the label text; the param hash is not used as it changes with
+// zoom dependent style properties.
+static size_t transitionKey(const Label& _label) {
+    return _label.options().repeatGroup;
+}
+
+void Labels::skipTransitions(const std::vector<const Style*>& _styles, const Tile& _tile, const Tile& _proxy) const {
+
+    std::vector<std::pair<size_t, const Label*>> proxyLabels;
 
     for (const auto& style : _styles) {
 
@@ -166,23 +353,36 @@ void Labels::skipTransitions(const std::vector<const Style*>& _styles, Tile& _ti
         auto* mesh1 = dynamic_cast<const LabelSet*>(_proxy.getMesh(*style).get());
         if (!mesh1) { continue; }
 
+        proxyLabels.clear();
+        for (auto& l1 : mesh1->getLabels()) {
+            if (!l1->visibleState()) { continue; }
+            if (!l1->canOcclude()) { continue;}
+            proxyLabels.emplace_back(transitionKey(*l1), l1.get());
+        }
+        if (proxyLabels.empty()) { continue; }
+
+        std::sort(proxyLabels.begin(), proxyLabels.end(),
+                  [](auto& a, auto& b) { return a.first < b.first; });
+
         for (auto& l0 : mesh0->getLabels()) {
             if (!l0->canOcclude()) { continue; }
             if (l0->state() != Label::State::none) { continue; }
 
-            for (auto& l1 : mesh1->getLabels()) {
-                if (!l1->visibleState()) { continue; }
-                if (!l1->canOcclude()) { continue;}
+            // Only the proxy labels with the same text and repeat group are candidates,
+            // the distance tells repeated labels of a feature apart
+            auto range = std::equal_range(proxyLabels.begin(), proxyLabels.end(),
+                                          std::make_pair(transitionKey(*l0), nullptr),
+                                          [](auto& a, auto& b) { return a.first < b.first; });
 
-                // Using repeat group to also handle labels with dynamic style properties
-                if (l0->options().repeatGroup != l1->options().repeatGroup) { continue; }
-                // if (l0->hash() != l1->hash()) { continue; }
+            float radius = std::max(l0->dimension().x, l0->dimension().y);
 
-                float d2 = glm::distance2(l0->screenCenter(), l1->screenCenter());
+            for (auto it = range.first; it != range.second; ++it) {
+                float d2 = glm::distance2(l0->screenCenter(), it->second->screenCenter());
 
                 // The new label lies within the circle defined by the bbox of l0
-                if (sqrt(d2) < std::max(l0->dimension().x, l0->dimension().y)) {
+                if (d2 < radius * radius) {
                     l0->skipTransitions();
+                    break;
                 }
             }
         }
@@ -205,6 +405,7 @@ std::shared_ptr<Tile> findProxy(int32_t _sourceID, const TileID& _proxyID,
 }
 
 void Labels::skipTransitions(const std::shared_ptr<Scene>& _scene,
+                             const std::vector<std::shared_ptr<Tile>>& _newTiles,
                              const std::vector<std::shared_ptr<Tile>>& _tiles,
                              TileManager& _tileManager, float _currentZoom) const {
 
@@ -217,7 +418,8 @@ void Labels::skipTransitions(const std::shared_ptr<Scene>& _scene,
         }
     }
 
-    for (const auto& tile : _tiles) {
+    // Labels of the other tiles were placed before
+    for (const auto& tile : _newTiles) {
         TileID tileID = tile->getID();
         std::shared_ptr<Tile> proxy;
 
@@ -245,47 +447,65 @@ void Labels::skipTransitions(const std::shared_ptr<Scene>& _scene,
     }
 }
 
-bool Labels::priorityComparator(const LabelEntry& _a, const LabelEntry& _b) {
-    if (_a.proxy != _b.proxy) {
-        return _b.proxy;
-    }
-    if (_a.priority != _b.priority) {
-        return _a.priority < _b.priority;
-    }
-    if (!_a.tile || !_b.tile) {
-        return (bool)_a.tile;
-    }
-    if (_a.tile->getID().z != _b.tile->getID().z) {
-        return _a.tile->getID().z > _b.tile->getID().z;
-    }
+// Maps _value to an unsigned integer of the same order
+static uint32_t orderedBits(float _value) {
+    // -0 equals 0
+    if (_value == 0.f) { _value = 0.f; }
 
-    auto l1 = _a.label;
-    auto l2 = _b.label;
+    uint32_t bits;
+    std::memcpy(&bits, &_value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
 
-    // Note: This causes non-deterministic placement, i.e. depending on
-    // navigation history.
-    if (l1->occludedLastFrame() != l2->occludedLastFrame()) {
-        return l2->occludedLastFrame();
-    }
-    // This prefers labels within screen over out_of_screen.
-    // Important for repeat groups!
-    if (l1->visibleState() != l2->visibleState()) {
-        return l1->visibleState();
-    }
+Labels::LabelEntry::LabelEntry(Label* _label, Style* _style, const Tile* _tile, const Marker* _marker,
+                               bool _proxy, Range _screenTransform)
+    : label(_label),
+      style(_style),
+      tile(_tile),
+      marker(_marker),
+      proxy(_proxy),
+      transformRange(_screenTransform) {
+
+    // From the most significant bit: labels of proxy tiles last, by priority,
+    // tile labels before markers, from higher tile zoom levels first
+    uint32_t zoom = _tile ? 31 - std::min(std::max(int(_tile->getID().z), 0), 31) : 0;
+
+    priorityKey = uint64_t(_proxy) << 63 |
+        uint64_t(orderedBits(_label->options().priority)) << 31 |
+        uint64_t(!_tile) << 30 |
+        uint64_t(zoom) << 25 |
+        // Note: This causes non-deterministic placement, i.e. depending on
+        // navigation history.
+        uint64_t(_label->occludedLastFrame()) << 24 |
+        // This prefers labels within screen over out_of_screen.
+        // Important for repeat groups!
+        uint64_t(!_label->visibleState()) << 23 |
+        // Keeps the candidates of a repeat group together, groups with the
+        // same lower bits are merged by candidate priority
+        (uint64_t(_label->options().repeatGroup) & 0x7fffff);
+
+    // Candidates of a feature by their priority, then labels by their parameters
+    tieKey = uint64_t(_label->type()) << 62 |
+        uint64_t(orderedBits(_label->candidatePriority())) << 30 |
+        (uint64_t(_label->hash()) & 0x3fffffff);
+}
 
-    if (l1->options().repeatGroup != l2->options().repeatGroup) {
-        return l1->options().repeatGroup < l2->options().repeatGroup;
-    }
+void Labels::sortByPriority() {
 
-    if (l1->type() == l2->type()) {
-        return l1->candidatePriority() < l2->candidatePriority();
+    m_sortItems.clear();
+    m_sortItems.reserve(m_labels.size());
+    for (size_t i = 0; i < m_labels.size(); i++) {
+        m_sortItems.push_back({ m_labels[i].priorityKey, m_labels[i].tieKey, uint32_t(i) });
     }
 
-    if (l1->hash() != l2->hash()) {
-        return l1->hash() < l2->hash();
-    }
+    radixSort(m_sortItems, m_sortScratch, [](const SortItem& _item) { return _item.tieKey; });
+    radixSort(m_sortItems, m_sortScratch, [](const SortItem& _item) { return _item.priorityKey; });
+
+    m_sortedLabels.clear();
+    m_sortedLabels.reserve(m_labels.size());
+    for (auto& item : m_sortItems) { m_sortedLabels.push_back(m_labels[item.index]); }
 
-    return l1 < l2;
+    std::swap(m_labels, m_sortedLabels);
 }
 
 bool Labels::zOrderComparator(const LabelEntry& _a, const LabelEntry& _b) {
@@ -319,10 +539,138 @@ bool Labels::zOrderComparator(const LabelEntry& _a, const LabelEntry& _b) {
     return bool(_a.tile);
 }
 
+// Screen distance within which labels count as moved together with the view
+static const float COHERENCE_EPSILON = 0.01f;
+
+// Fraction of labels that may move differently from the view, beyond which
+// occlusions are solved from scratch
+static const float MAX_INCOHERENT_LABELS = 0.25f;
+
+
+static AABB translateAABB(AABB _aabb, glm::vec2 _offset) {
+    if (!isEmpty(_aabb)) {
+        _aabb.min += _offset;
+        _aabb.max += _offset;
+    }
+    return _aabb;
+}
+
+void Labels::setPlacementBudget(float _milliseconds) {
+    m_placementBudget = _milliseconds;
+}
+
+void Labels::setIncrementalOcclusion(bool _enabled) {
+    m_incrementalOcclusion = _enabled;
+    m_placements.clear();
+}
+
+bool Labels::matchPlacements(const ViewState& _viewState) {
+
+    m_coherence.assign(m_labels.size(), { -1, false, std::numeric_limits<uint32_t>::max() });
+
+    if (m_placements.empty() || m_sourcesChanged ||
+        _viewState.zoom != m_placementZoom ||
+        _viewState.viewportSize != m_placementViewport) {
+        return false;
+    }
+
+    for (auto& placement : m_placements) { placement.matched = false; }
+
+    size_t matched = 0;
+    for (size_t i = 0; i < m_labels.size(); i++) {
+        const Label* label = m_labels[i].label;
+        auto it = std::lower_bound(m_placements.begin(), m_placements.end(), label,
+                                   [](auto& p, const Label* l) { return p.label < l; });
+
+        if (it != m_placements.end() && it->label == label) {
+            it->matched = true;
+            m_coherence[i].placement = int(it - m_placements.begin());
+            matched++;
+        }
+    }
+    if (matched == 0) { return false; }
+
+    auto delta = [&](size_t i) {
+        return m_labels[i].label->screenCenter() - m_placements[m_coherence[i].placement].screenCenter;
+    };
+
+    // The view offset is the screen movement shared by most of the labels,
+    // voted on by the first matched ones
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < m_labels.size() && candidates.size() < 16; i++) {
+        if (m_coherence[i].placement >= 0) { candidates.push_back(i); }
+    }
+
+    bool found = false;
+    for (size_t c : candidates) {
+        glm::vec2 offset = delta(c);
+        size_t votes = std::count_if(candidates.begin(), candidates.end(), [&](size_t i) {
+                return glm::length(delta(i) - offset) < COHERENCE_EPSILON;
+            });
+        if (votes * 2 > candidates.size()) {
+            m_viewOffset = offset;
+            found = true;
+            break;
+        }
+    }
+    if (!found) { return false; }
+
+    size_t moved = 0;
+    for (size_t i = 0; i < m_labels.size(); i++) {
+        if (m_coherence[i].placement < 0) { continue; }
+        if (glm::length(delta(i) - m_viewOffset) >= COHERENCE_EPSILON) {
+            m_coherence[i].moved = true;
+            moved++;
+        }
+    }
+    if (moved > matched * MAX_INCOHERENT_LABELS) { return false; }
+
+    // Lowest previous rank among the following entries, to find labels that
+    // moved ahead of others in priority order
+    for (size_t i = m_labels.size(); i-- > 1;) {
+        uint32_t rank = m_coherence[i].placement >= 0
+            ? m_placements[m_coherence[i].placement].rank
+            : std::numeric_limits<uint32_t>::max();
+        m_coherence[i - 1].nextRank = std::min(m_coherence[i].nextRank, rank);
+    }
+
+    // Labels that are gone leave their region and repeat group
+    for (auto& placement : m_placements) {
+        if (placement.matched || isEmpty(placement.extent)) { continue; }
+        m_dirtyRegions.push_back(translateAABB(placement.extent, m_viewOffset));
+        if (placement.repeats) { m_dirtyGroups.push_back(placement.repeatGroup); }
+    }
+
+    return true;
+}
+
+/* Labels are placed greedily in priority order, each one against the labels
+ * placed before it. When the view only pans, a label at the same position
+ * relative to the others, that is tested against the same labels as in the
+ * previous frame, gets the same placement. The incremental mode therefore
+ * only solves labels which are new, moved differently from the view, moved
+ * ahead in priority order, have a parent label, or whose tested region
+ * or repeat group contains a label with a changed placement. The result is
+ * the same as solving all labels.
+ */
 void Labels::handleOcclusions(const ViewState& _viewState) {
 
+    bool useGrid = !Tangram::getDebugFlag(DebugFlags::isect2d_collisions);
+
     m_isect2d.clear();
+    m_grid.clear();
     m_repeatGroups.clear();
+    m_dirtyRegions.clear();
+    m_dirtyGroups.clear();
+    m_nextPlacements.clear();
+    m_deferredCount = 0;
+
+    bool incremental = m_incrementalOcclusion && matchPlacements(_viewState);
+
+    // Labels that were not visible are deferred to the next frames once the
+    // placement budget is used up
+    auto startTime = std::chrono::steady_clock::now();
+    bool overBudget = false;
 
     using iterator = decltype(m_labels)::const_iterator;
 
@@ -337,58 +685,98 @@ void Labels::handleOcclusions(const ViewState& _viewState) {
         return static_cast<Label*>(nullptr);
     };
 
+    auto isDirty = [&](const AABB& _influence) {
+        // Grow by a pixel to be safe against rounding of the translation
+        AABB region = _influence;
+        region.min -= glm::vec2(1.f);
+        region.max += glm::vec2(1.f);
+        for (auto& dirty : m_dirtyRegions) {
+            if (region.intersect(dirty)) { return true; }
+        }
+        return false;
+    };
+
+    auto isDirtyGroup = [&](const Label* _label) {
+        if (_label->options().repeatDistance <= 0.f) { return false; }
+        return std::find(m_dirtyGroups.begin(), m_dirtyGroups.end(),
+                         _label->options().repeatGroup) != m_dirtyGroups.end();
+    };
+
     for (auto it = m_labels.begin(); it != m_labels.end(); ++it) {
         auto& entry = *it;
         auto* l = entry.label;
+        size_t index = it - m_labels.begin();
 
         ScreenTransform transform { m_transforms, entry.transformRange };
         OBBBuffer obbs { m_obbs, entry.obbsRange };
 
         l->obbs(transform, obbs);
 
-        // Parent must have been processed earlier so at this point its
-        // occlusion and anchor position is determined for the current frame.
-        if (l->isChild()) {
-            if (l->relative()->isOccluded()) {
-                l->occlude();
-                continue;
-            }
+        AABB influence = emptyAABB();
+        for (auto& obb : obbs) { includeAABB(influence, obb.getExtent()); }
+
+        const Placement* previous = nullptr;
+        bool overtaking = false;
+        bool moved = false;
+        if (incremental && m_coherence[index].placement >= 0) {
+            previous = &m_placements[m_coherence[index].placement];
+            overtaking = previous->rank > m_coherence[index].nextRank;
+            moved = m_coherence[index].moved;
         }
 
-        // Skip label if another label of this repeatGroup is
-        // within repeatDistance.
-        if (l->options().repeatDistance > 0.f) {
-            if (withinRepeatDistance(l)) {
-                l->occlude();
-                // If this label is not marked optional, then mark the relative label as occluded
-                if (l->relative() && !l->options().optional) {
-                    l->relative()->occlude();
-                }
-                continue;
-            }
+        bool coherent = previous && !previous->deferred && !overtaking && !moved && !l->isChild() &&
+            !isDirtyGroup(l) && !isDirty(translateAABB(previous->influence, m_viewOffset));
+
+        // Checked every few labels, so that the first labels make progress every frame
+        if (m_placementBudget > 0.f && !overBudget && index > 0 && index % 32 == 0) {
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+            overBudget = elapsed.count() > m_placementBudget;
         }
+        bool deferred = overBudget && !coherent && !l->visibleState();
 
-        int anchorIndex = l->anchorIndex();
+        if (deferred) {
+            // Fades in with its regular transition when placed in a later frame
+            l->occlude();
+            m_deferredCount++;
 
-        // For each anchor
-        do {
-            if (l->isOccluded()) {
-                // Update OBB for anchor fallback
-                obbs.clear();
+        } else if (coherent) {
+            // Same surrounding as in the previous frame
+            if (previous->occluded) { l->occlude(); }
+            influence = translateAABB(previous->influence, m_viewOffset);
 
-                l->obbs(transform, obbs);
+        } else if (l->isChild() && l->relative()->isOccluded()) {
+            // Parent must have been processed earlier so at this point its
+            // occlusion and anchor position is determined for the current frame.
+            l->occlude();
 
-                if (anchorIndex == l->anchorIndex()) {
-                    // Reached first anchor again
-                    break;
+        } else if (l->options().repeatDistance > 0.f && withinRepeatDistance(l)) {
+            // Skip label if another label of this repeatGroup is
+            // within repeatDistance.
+            l->occlude();
+
+        } else {
+            int anchorIndex = l->anchorIndex();
+
+            // For each anchor
+            do {
+                if (l->isOccluded()) {
+                    // Update OBB for anchor fallback
+                    obbs.clear();
+
+                    l->obbs(transform, obbs);
+                    for (auto& obb : obbs) { includeAABB(influence, obb.getExtent()); }
+
+                    if (anchorIndex == l->anchorIndex()) {
+                        // Reached first anchor again
+                        break;
+                    }
                 }
-            }
 
-            l->occlude(false);
+                l->occlude(false);
 
-            // Occlude label when its obbs intersect with a previous label.
-            for (auto& obb : obbs) {
-                m_isect2d.intersect(obb.getExtent(), [&](auto& a, auto& b) {
+                // Occlude label when its obbs intersect with a previous label.
+                for (auto& obb : obbs) {
+                    auto collide = [&](auto& a, auto& b) {
                         size_t other = reinterpret_cast<size_t>(b.m_userData);
 
                         if (!intersect(obb, m_obbs[other])) {
@@ -400,17 +788,26 @@ void Labels::handleOcclusions(const ViewState& _viewState) {
                         }
                         l->occlude();
                         return false;
+                    };
 
-                    }, false);
+                    if (useGrid) {
+                        m_grid.intersect(obb.getExtent(), collide);
+                    } else {
+                        m_isect2d.intersect(obb.getExtent(), collide, false);
+                    }
 
-                if (l->isOccluded()) { break; }
-            }
-        } while (l->isOccluded() && l->nextAnchor());
+                    if (l->isOccluded()) { break; }
+                }
+            } while (l->isOccluded() && l->nextAnchor());
+        }
+
+        AABB extent = emptyAABB();
 
         // At this point, the label has a relative that is visible,
         // if it is not an optional label, turn the relative to occluded
         if (l->isOccluded()) {
-            if (l->relative() && !l->options().optional) {
+            // Deferring a label does not hide its visible relative
+            if (l->relative() && !l->options().optional && !deferred) {
                 l->relative()->occlude();
             }
         } else {
@@ -418,30 +815,70 @@ void Labels::handleOcclusions(const ViewState& _viewState) {
             int obbPos = entry.obbsRange.start;
             for (auto& obb : obbs) {
                 auto aabb = obb.getExtent();
+                includeAABB(extent, aabb);
                 aabb.m_userData = reinterpret_cast<void*>(obbPos++);
-                m_isect2d.insert(aabb);
+                if (useGrid) {
+                    m_grid.insert(aabb);
+                } else {
+                    m_isect2d.insert(aabb);
+                }
             }
 
             if (l->options().repeatDistance > 0.f) {
-                m_repeatGroups[l->options().repeatGroup].push_back(l);
+                m_repeatGroups.insert(l->options().repeatGroup, l->options().repeatDistance,
+                                      l->screenCenter());
             }
         }
-    }
-}
 
-bool Labels::withinRepeatDistance(Label *_label) {
-    float threshold2 = pow(_label->options().repeatDistance, 2);
-
-    auto it = m_repeatGroups.find(_label->options().repeatGroup);
-    if (it != m_repeatGroups.end()) {
-        for (auto* ll : it->second) {
-            float d2 = glm::distance2(_label->screenCenter(), ll->screenCenter());
-            if (d2 < threshold2) {
-                return true;
+        if (!m_incrementalOcclusion) { continue; }
+
+        if (incremental && !coherent) {
+            bool changed = !previous || overtaking || moved ||
+                previous->occluded != l->isOccluded() ||
+                previous->anchor != l->anchorIndex();
+
+            if (changed) {
+                if (previous && !isEmpty(previous->extent)) {
+                    m_dirtyRegions.push_back(translateAABB(previous->extent, m_viewOffset));
+                }
+                if (!isEmpty(extent)) { m_dirtyRegions.push_back(extent); }
+                if (l->options().repeatDistance > 0.f) {
+                    m_dirtyGroups.push_back(l->options().repeatGroup);
+                }
             }
         }
+
+        m_nextPlacements.push_back({ l, l->screenCenter(), influence, extent,
+                                     l->options().repeatGroup, uint32_t(index), l->anchorIndex(),
+                                     l->isOccluded(), l->options().repeatDistance > 0.f, false, deferred });
+    }
+
+    if (m_incrementalOcclusion) {
+        std::sort(m_nextPlacements.begin(), m_nextPlacements.end(),
+                  [](auto& a, auto& b) { return a.label < b.label; });
+        std::swap(m_placements, m_nextPlacements);
+        m_placementZoom = _viewState.zoom;
+        m_placementViewport = _viewState.viewportSize;
+        m_sourcesChanged = false;
     }
-    return false;
+}
+
+void Labels::resizeCollisionGrid(const ViewState& _viewState) {
+
+    m_isect2d.resize({_viewState.viewportSize.x / 256, _viewState.viewportSize.y / 256},
+                     {_viewState.viewportSize.x, _viewState.viewportSize.y});
+
+    m_labelSizes.clear();
+    for (auto& entry : m_labels) {
+        auto dim = entry.label->dimension();
+        m_labelSizes.push_back(std::max(dim.x, dim.y));
+    }
+    m_grid.resize(_viewState.viewportSize, LabelGrid::cellSize(m_labelSizes));
+}
+
+bool Labels::withinRepeatDistance(Label *_label) {
+    return m_repeatGroups.within(_label->options().repeatGroup, _label->options().repeatDistance,
+                                 _label->screenCenter());
 }
 
 void Labels::updateLabelSet(const ViewState& _viewState, float _dt,
@@ -453,28 +890,60 @@ void Labels::updateLabelSet(const ViewState& _viewState, float _dt,
     m_transforms.clear();
     m_obbs.clear();
 
+    // Placements of the previous frame are only reused for the same tiles
+    // and markers
+    size_t sourceCount = 0;
+    for (const auto& tile : _tiles) {
+        std::pair<const void*, TileID> source{ tile.get(), tile->getID() };
+        m_sourcesChanged |= sourceCount >= m_placementSources.size() ||
+            m_placementSources[sourceCount] != source;
+        if (m_sourcesChanged) {
+            m_placementSources.erase(m_placementSources.begin() + sourceCount,
+                                     m_placementSources.end());
+            m_placementSources.push_back(source);
+        }
+        sourceCount++;
+    }
+    for (const auto& marker : _markers) {
+        std::pair<const void*, TileID> source{ marker->mesh(), TileID(0, 0, 0) };
+        m_sourcesChanged |= sourceCount >= m_placementSources.size() ||
+            m_placementSources[sourceCount] != source;
+        if (m_sourcesChanged) {
+            m_placementSources.erase(m_placementSources.begin() + sourceCount,
+                                     m_placementSources.end());
+            m_placementSources.push_back(source);
+        }
+        sourceCount++;
+    }
+    m_sourcesChanged |= sourceCount != m_placementSources.size();
+    m_placementSources.erase(m_placementSources.begin() + sourceCount,
+                             m_placementSources.end());
+
     /// Collect and update labels from visible tiles
     updateLabels(_viewState, _dt, _scene->styles(), _tiles, _markers, false);
 
-    std::sort(m_labels.begin(), m_labels.end(), Labels::priorityComparator);
+    sortByPriority();
 
     /// Mark labels to skip transitions
 
     if (int(m_lastZoom) != int(_viewState.zoom)) {
-        skipTransitions(_scene, _tiles, _tileManager, _viewState.zoom);
+        skipTransitions(_scene, m_newTiles, _tiles, _tileManager, _viewState.zoom);
         m_lastZoom = _viewState.zoom;
     }
+    m_newTiles.clear();
 
-    m_isect2d.resize({_viewState.viewportSize.x / 256, _viewState.viewportSize.y / 256},
-                     {_viewState.viewportSize.x, _viewState.viewportSize.y});
+    resizeCollisionGrid(_viewState);
 
     handleOcclusions(_viewState);
 
     // Update label state
     for (auto& entry : m_labels) {
-        m_needUpdate |= entry.label->evalState(_dt);
+        evalState(*entry.label, entry.marker, _dt);
     }
 
+    // Place deferred labels in the next frame
+    m_needUpdate |= m_deferredCount > 0;
+
     std::sort(m_labels.begin(), m_labels.end(), Labels::zOrderComparator);
 
     Label::AABB screenBounds{0, 0, _viewState.viewportSize.x, _viewState.viewportSize.y};
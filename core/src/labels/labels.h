@@ -2,6 +2,8 @@
 
 #include "data/properties.h"
 #include "labels/label.h"
+#include "labels/labelGrid.h"
+#include "labels/repeatGroupIndex.h"
 #include "labels/screenTransform.h"
 #include "labels/spriteLabel.h"
 #include "tile/tileID.h"
@@ -18,6 +20,7 @@
 
 namespace Tangram {
 
+class AsyncWorker;
 class FontContext;
 class LabelSet;
 class Marker;
@@ -52,6 +55,24 @@ public:
 
     bool needUpdate() const { return m_needUpdate; }
 
+    /* Screen area in pixels, y pointing down, that changed with the last
+     * update of labels whose placement did not change: labels that fade or
+     * move with their marker, where they are and where they were. Empty
+     * (min > max) when nothing changed. */
+    const Label::AABB& damage() const { return m_damage; }
+
+    /* Limit the time of handleOcclusions per frame, 0 for no limit. Labels
+     * that were not visible before are placed in later frames once the
+     * budget is used up, in priority order. */
+    void setPlacementBudget(float _milliseconds);
+
+    // Number of labels deferred by the placement budget in the last frame
+    size_t deferredLabelCount() const { return m_deferredCount; }
+
+    /* Reuse the placement of labels from the previous frame while panning,
+     * see handleOcclusions (enabled by default) */
+    void setIncrementalOcclusion(bool _enabled);
+
     std::pair<Label*, const Tile*> getLabel(uint32_t _selectionColor) const;
 
 protected:
@@ -61,48 +82,105 @@ protected:
     using CollisionPairs = std::vector<isect2d::ISect2D<glm::vec2>::Pair>;
 
 
+    // Match the labels of _newTiles with those of their proxies
     void skipTransitions(const std::shared_ptr<Scene>& _scene,
+                         const std::vector<std::shared_ptr<Tile>>& _newTiles,
                          const std::vector<std::shared_ptr<Tile>>& _tiles,
                          TileManager& _tileManager, float _currentZoom) const;
 
-    void skipTransitions(const std::vector<const Style*>& _styles, Tile& _tile, Tile& _proxy) const;
+    void skipTransitions(const std::vector<const Style*>& _styles, const Tile& _tile, const Tile& _proxy) const;
+
+    // Label sets of _tile, collected when the tile is first seen
+    const std::vector<std::pair<Style*, const LabelSet*>>& tileLabelSets(
+        const std::shared_ptr<Tile>& _tile, const std::vector<std::unique_ptr<Style>>& _styles);
+
+    // Set up the collision broadphase for the viewport and the sizes of m_labels
+    void resizeCollisionGrid(const ViewState& _viewState);
 
     void handleOcclusions(const ViewState& _viewState);
 
+    /* Match entries of m_labels with their placement in the previous frame.
+     * Returns false when the view did not just pan, so that occlusions
+     * have to be solved from scratch. */
+    bool matchPlacements(const ViewState& _viewState);
+
     bool withinRepeatDistance(Label *_label);
 
-    void processLabelUpdate(const ViewState& _viewState, const LabelSet* _labelSet, Style* _style,
-                            const Tile* _tile, const Marker *_marker, const glm::mat4& _mvp,
-                            float _dt, bool _drawAll, bool _onlyRender, bool _isProxy);
+    // Labels of one LabelSet, with their screen transforms in a buffer of their own
+    struct UpdateJob {
+        const LabelSet* labelSet;
+        Style* style;
+        const Tile* tile;
+        const Marker* marker;
+        glm::mat4 mvp;
+        bool proxy;
+
+        ScreenTransform::Buffer transforms;
+        // Labels within bounds, with their range in transforms
+        std::vector<std::pair<Label*, Range>> updated;
+    };
+
+    void addUpdateJob(const LabelSet* _labelSet, Style* _style, const Tile* _tile,
+                      const Marker* _marker, const glm::mat4& _mvp, bool _isProxy);
+
+    static void transformLabels(UpdateJob& _job, const ViewState& _viewState,
+                                bool _drawAll, bool _onlyRender);
+
+    void runUpdateJobs(const ViewState& _viewState, bool _drawAll, bool _onlyRender);
+
+    void processLabelUpdate(const ViewState& _viewState, UpdateJob& _job,
+                            float _dt, bool _onlyRender);
+
+    // Evaluate the state of _label and add the area it changed to m_damage
+    void evalState(Label& _label, const Marker* _marker, float _dt);
+
+    std::vector<UpdateJob> m_updateJobs;
+    size_t m_jobCount = 0;
+
+    std::vector<std::unique_ptr<AsyncWorker>> m_workers;
 
     bool m_needUpdate;
 
+    AABB m_damage;
+    // Screen area of the labels of markers on the last and on this update
+    std::unordered_map<const Label*, AABB> m_markerBounds;
+    std::unordered_map<const Label*, AABB> m_nextMarkerBounds;
+
     isect2d::ISect2D<glm::vec2> m_isect2d;
+    LabelGrid m_grid;
+    std::vector<float> m_labelSizes;
 
     struct LabelEntry {
 
         LabelEntry(Label* _label, Style* _style, const Tile* _tile, const Marker* _marker,
-                   bool _proxy, Range _screenTransform)
-            : label(_label),
-              style(_style),
-              tile(_tile),
-              marker(_marker),
-              priority(_label->options().priority),
-              proxy(_proxy),
-              transformRange(_screenTransform) {}
+                   bool _proxy, Range _screenTransform);
 
         Label* label;
         Style* style;
         const Tile* tile;
         const Marker* marker;
-        float priority;
         bool proxy;
 
+        // Placement order, labels are placed by ascending priorityKey and
+        // then tieKey, see sortByPriority()
+        uint64_t priorityKey;
+        uint64_t tieKey;
+
         Range transformRange;
         Range obbsRange;
     };
 
-    static bool priorityComparator(const LabelEntry& _a, const LabelEntry& _b);
+    // Sort m_labels by their keys, labels with equal keys keep the order of collection
+    void sortByPriority();
+
+    struct SortItem {
+        uint64_t priorityKey;
+        uint64_t tieKey;
+        uint32_t index;
+    };
+    std::vector<SortItem> m_sortItems;
+    std::vector<SortItem> m_sortScratch;
+    std::vector<LabelEntry> m_sortedLabels;
 
     static bool zOrderComparator(const LabelEntry& _a, const LabelEntry& _b);
 
@@ -112,9 +190,69 @@ protected:
     std::vector<LabelEntry> m_labels;
     std::vector<LabelEntry> m_selectionLabels;
 
-    std::unordered_map<size_t, std::vector<Label*>> m_repeatGroups;
+    // Label sets by tile, kept while the tile is drawn. The weak reference
+    // tells a tile apart from a later one at the same address.
+    struct TileLabels {
+        std::weak_ptr<Tile> tile;
+        std::vector<std::pair<Style*, const LabelSet*>> sets;
+        uint32_t update = 0;
+    };
+    std::unordered_map<const Tile*, TileLabels> m_tileLabels;
+    uint32_t m_labelUpdate = 0;
+
+    // Tiles whose label sets were collected since the last updateLabelSet
+    std::vector<std::shared_ptr<Tile>> m_newTiles;
+
+    RepeatGroupIndex m_repeatGroups;
 
     float m_lastZoom;
+
+    // Outcome of handleOcclusions for a label, kept for the next frame
+    struct Placement {
+        const Label* label;
+        glm::vec2 screenCenter;
+        // Extent of all OBBs tested while placing the label
+        AABB influence;
+        // Extent of the OBBs of the label when it was placed
+        AABB extent;
+        size_t repeatGroup;
+        uint32_t rank;
+        int anchor;
+        bool occluded;
+        bool repeats;
+        bool matched;
+        // Not placed because the placement budget was used up
+        bool deferred;
+    };
+
+    // Sorted by label
+    std::vector<Placement> m_placements;
+    std::vector<Placement> m_nextPlacements;
+
+    // Per entry of m_labels: index of its placement or -1, and whether
+    // it moved differently from the view
+    struct Coherence {
+        int placement;
+        bool moved;
+        uint32_t nextRank;
+    };
+    std::vector<Coherence> m_coherence;
+
+    // Screen regions and repeat groups where placements changed this frame
+    std::vector<AABB> m_dirtyRegions;
+    std::vector<size_t> m_dirtyGroups;
+
+    glm::vec2 m_viewOffset;
+
+    // Tiles and markers the placements were made for
+    std::vector<std::pair<const void*, TileID>> m_placementSources;
+    glm::vec2 m_placementViewport;
+    float m_placementZoom = 0;
+    bool m_sourcesChanged = true;
+    bool m_incrementalOcclusion = true;
+
+    float m_placementBudget = 0.f;
+    size_t m_deferredCount = 0;
 };
 
 }
@@ -0,0 +1,131 @@
+#include "labels/repeatGroupIndex.h"
+
+#include "util/hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tangram {
+
+// Groups not used for this many frames are dropped
+static const uint32_t MAX_GROUP_AGE = 256;
+
+static const size_t MIN_BUCKETS = 64;
+
+// Scan all nodes instead when a query would visit more cells
+static const float MAX_QUERY_RADIUS = 4;
+
+void RepeatGroupIndex::clear() {
+    m_frame++;
+
+    if (m_groups.size() > MIN_BUCKETS) {
+        for (auto it = m_groups.begin(); it != m_groups.end(); ) {
+            if (m_frame - it->second.frame > MAX_GROUP_AGE) {
+                it = m_groups.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    m_nodes.clear();
+
+    if (m_buckets.empty()) {
+        m_buckets.resize(MIN_BUCKETS);
+    }
+    std::fill(m_buckets.begin(), m_buckets.end(), -1);
+}
+
+glm::ivec2 RepeatGroupIndex::cellOf(glm::vec2 _position, float _cellSize) {
+    // Clamp in float to not overflow int for labels far off screen
+    const float limit = 1 << 24;
+    glm::vec2 cell = glm::clamp(glm::floor(_position / _cellSize), glm::vec2(-limit), glm::vec2(limit));
+
+    return glm::ivec2(cell);
+}
+
+size_t RepeatGroupIndex::bucket(size_t _group, glm::ivec2 _cell) const {
+    size_t seed = 0;
+    hash_combine(seed, _group);
+    hash_combine(seed, _cell.x);
+    hash_combine(seed, _cell.y);
+
+    return seed & (m_buckets.size() - 1);
+}
+
+void RepeatGroupIndex::rehash(size_t _buckets) {
+    m_buckets.assign(_buckets, -1);
+
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        auto& head = m_buckets[bucket(m_nodes[i].group, m_nodes[i].cell)];
+        m_nodes[i].next = head;
+        head = i;
+    }
+}
+
+void RepeatGroupIndex::insert(size_t _group, float _distance, glm::vec2 _position) {
+    if (m_buckets.empty()) { clear(); }
+
+    auto& group = m_groups[_group];
+    if (group.frame != m_frame || group.cellSize <= 0.f) {
+        group.cellSize = std::max(_distance, 1.f);
+        group.frame = m_frame;
+    }
+
+    glm::ivec2 cell = cellOf(_position, group.cellSize);
+
+    m_nodes.push_back({ _group, cell, _position, -1 });
+
+    if (m_nodes.size() > m_buckets.size()) {
+        rehash(m_buckets.size() * 2);
+        return;
+    }
+
+    auto& head = m_buckets[bucket(_group, cell)];
+    m_nodes.back().next = head;
+    head = m_nodes.size() - 1;
+}
+
+bool RepeatGroupIndex::within(size_t _group, float _distance, glm::vec2 _position) const {
+    if (m_nodes.empty()) { return false; }
+
+    auto it = m_groups.find(_group);
+    if (it == m_groups.end() || it->second.frame != m_frame) { return false; }
+
+    float cellSize = it->second.cellSize;
+    float threshold2 = _distance * _distance;
+
+    // Labels of the group may use a larger distance than its cell size
+    float cells = std::ceil(_distance / cellSize);
+
+    if (cells > MAX_QUERY_RADIUS) {
+        for (auto& node : m_nodes) {
+            if (node.group != _group) { continue; }
+
+            glm::vec2 d = node.position - _position;
+            if (d.x * d.x + d.y * d.y < threshold2) { return true; }
+        }
+        return false;
+    }
+
+    int radius = std::max(1, int(cells));
+
+    glm::ivec2 center = cellOf(_position, cellSize);
+
+    for (int y = center.y - radius; y <= center.y + radius; y++) {
+        for (int x = center.x - radius; x <= center.x + radius; x++) {
+            glm::ivec2 cell(x, y);
+
+            for (int32_t n = m_buckets[bucket(_group, cell)]; n >= 0; n = m_nodes[n].next) {
+                auto& node = m_nodes[n];
+                if (node.group != _group || node.cell != cell) { continue; }
+
+                glm::vec2 d = node.position - _position;
+                if (d.x * d.x + d.y * d.y < threshold2) { return true; }
+            }
+        }
+    }
+    return false;
+}
+
+}
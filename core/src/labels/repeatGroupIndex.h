@@ -0,0 +1,64 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Tangram {
+
+/* Screen space index of the placed labels per repeat group
+ *
+ * Points are hashed by repeat group and grid cell into one flat table of
+ * per-bucket node lists. The cell size of a group is the repeat distance
+ * of its first label in a frame, so that a query usually visits the 3x3
+ * cells around its position instead of every label of the group.
+ *
+ * All buffers persist between frames: clear() only resets the bucket
+ * heads, and the table grows when it holds more nodes than buckets.
+ */
+class RepeatGroupIndex {
+
+public:
+
+    void clear();
+
+    void insert(size_t _group, float _distance, glm::vec2 _position);
+
+    /* Whether a point of _group was inserted closer than _distance
+     * to _position */
+    bool within(size_t _group, float _distance, glm::vec2 _position) const;
+
+    size_t size() const { return m_nodes.size(); }
+
+private:
+
+    struct Node {
+        size_t group;
+        glm::ivec2 cell;
+        glm::vec2 position;
+        int32_t next;
+    };
+
+    struct Group {
+        float cellSize;
+        uint32_t frame;
+    };
+
+    static glm::ivec2 cellOf(glm::vec2 _position, float _cellSize);
+
+    size_t bucket(size_t _group, glm::ivec2 _cell) const;
+
+    void rehash(size_t _buckets);
+
+    // Cell size per group, set on the first insert in a frame
+    std::unordered_map<size_t, Group> m_groups;
+    uint32_t m_frame = 0;
+
+    // First node per bucket, -1 when empty. Size is a power of two.
+    std::vector<int32_t> m_buckets;
+    std::vector<Node> m_nodes;
+};
+
+}
@@ -235,17 +235,13 @@ void SpriteLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2
         uint16_t(m_alpha * SpriteVertex::alpha_scale),
     };
 
-    auto* quadVertices = m_labels.m_style.pushQuad(m_texture);
+    std::array<glm::vec4, 4> positions;
 
     if (m_options.flat) {
         FlatTransform transform(_transform);
 
         for (int i = 0; i < 4; i++) {
-            SpriteVertex& vertex = quadVertices[i];
-
-            vertex.pos = transform.projected(i);
-            vertex.uv = quad.quad[i].uv;
-            vertex.state = state;
+            positions[i] = transform.projected(i);
         }
 
     } else {
@@ -259,17 +255,12 @@ void SpriteLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2
         pos += m_anchor * scale;
 
         for (int i = 0; i < 4; i++) {
-            SpriteVertex& vertex = quadVertices[i];
             glm::vec2 coord = pos + quad.quad[i].pos * scale;
-
-            vertex.pos.x = coord.x;
-            vertex.pos.y = coord.y;
-            vertex.pos.z = 0.f;
-            vertex.pos.w = 1.f;
-            vertex.uv = quad.quad[i].uv;
-            vertex.state = state;
+            positions[i] = glm::vec4(coord, 0.f, 1.f);
         }
     }
+
+    m_labels.m_style.pushQuad(m_texture, positions, quad, state);
 }
 
 }
@@ -26,6 +26,17 @@ struct SpriteVertex {
     static const float texture_scale;
 };
 
+// Instance record of a sprite quad for PointStyle's instanced path: the
+// corners are at center +/- axisX +/- axisY in clip space
+struct SpriteInstance {
+    glm::vec4 center;
+    glm::vec4 axisX;
+    glm::vec4 axisY;
+    // Texture coordinates of the corners -1/-1 and 1/1
+    glm::i16vec4 uv;
+    SpriteVertex::State state;
+};
+
 class SpriteLabel : public Label {
 public:
 
@@ -43,6 +54,8 @@ public:
                 SpriteLabel::VertexAttributes _attrib, Texture* _texture,
                 SpriteLabels& _labels, size_t _labelsPos);
 
+    size_t memoryUsage() const override { return sizeof(SpriteLabel); }
+
     LabelType renderType() const override { return LabelType::icon; }
 
     bool updateScreenTransform(const glm::mat4& _mvp, const ViewState& _viewState,
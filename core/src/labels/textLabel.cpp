@@ -207,8 +207,6 @@ void TextLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2&
     auto end = it + m_textRanges[m_textRangeIndex].length;
     auto& style = m_textLabels.style;
 
-    auto& meshes = style.getMeshes();
-
     PointTransform transform(_transform);
 
     glm::vec2 rotation = transform.rotation();
@@ -250,25 +248,30 @@ void TextLabel::addVerticesToMesh(ScreenTransform& _transform, const glm::vec2&
         }
         if (!visible) { continue; }
 
-        auto* quadVertices = meshes[it->atlas]->pushQuad();
-
-        for (int i = 0; i < 4; i++) {
-            TextVertex& v = quadVertices[i];
-            v.pos = vertexPosition[i];
-            v.uv = quad.quad[i].uv;
-            v.state = state;
-        }
+        style.pushQuad(quad, vertexPosition, state);
     }
 }
 
 TextLabels::~TextLabels() {
-    style.context()->releaseAtlas(m_atlasRefs);
+    auto& context = style.context();
+    context->releaseGlyphs(quads);
+    context->releaseAtlas(m_atlasRefs);
 }
 
 void TextLabels::setQuads(std::vector<GlyphQuad>&& _quads, std::bitset<FontContext::max_textures> _atlasRefs) {
+    auto& context = style.context();
+    context->releaseGlyphs(quads);
+
     quads = std::move(_quads);
     m_atlasRefs = _atlasRefs;
+    m_compactionEpoch = context->retainGlyphs(quads, m_atlasRefs);
+}
+
+void TextLabels::remapGlyphs() {
+    auto& context = style.context();
+    if (m_compactionEpoch == context->compactionEpoch()) { return; }
 
+    m_compactionEpoch = context->remapGlyphs(quads, m_atlasRefs);
 }
 
 }
@@ -35,6 +35,17 @@ struct TextVertex {
     const static float alpha_scale;
 };
 
+// Instance record of a glyph quad for TextStyle's instanced path: the
+// corners are at pos + (0|1) * axisX + (0|1) * axisY in vertex units
+struct TextInstance {
+    glm::i16vec2 pos;
+    glm::i16vec2 axisX;
+    glm::i16vec2 axisY;
+    // Texture coordinates of the corners at pos and pos + axisX + axisY
+    glm::u16vec4 uv;
+    TextVertex::State state;
+};
+
 class TextLabel : public Label {
 
 public:
@@ -53,6 +64,8 @@ public:
               glm::vec2 _dim, TextLabels& _labels, TextRange _textRanges,
               TextLabelProperty::Align _preferedAlignment);
 
+    size_t memoryUsage() const override { return sizeof(TextLabel); }
+
     LabelType renderType() const override { return LabelType::text; }
 
     bool updateScreenTransform(const glm::mat4& _mvp, const ViewState& _viewState,
@@ -17,14 +17,21 @@ public:
 
     ~TextLabels() override;
 
+    /* Takes the atlas references of _quads, and references their glyphs */
     void setQuads(std::vector<GlyphQuad>&& _quads, std::bitset<FontContext::max_textures> _atlasRefs);
 
+    /* Move quads to the atlases their glyphs were compacted into since they
+     * were set. Must not run while labels are pushing the quads. */
+    void remapGlyphs();
+
     std::vector<GlyphQuad> quads;
     const TextStyle& style;
 
 private:
 
     std::bitset<FontContext::max_textures> m_atlasRefs;
+    // Compaction epoch of FontContext that quads are up to date with
+    uint32_t m_compactionEpoch = 0;
 };
 
 }
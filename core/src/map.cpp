@@ -3,55 +3,105 @@
 #include "data/clientGeoJsonSource.h"
 #include "debug/textDisplay.h"
 #include "debug/frameInfo.h"
+#include "debug/performanceMonitor.h"
+#include "debug/sessionRecorder.h"
+#include "debug/tileTrace.h"
 #include "gl.h"
 #include "gl/glError.h"
 #include "gl/framebuffer.h"
+#include "gl/gpuTimer.h"
 #include "gl/hardware.h"
 #include "gl/primitives.h"
+#include "gl/bufferPool.h"
+#include "gl/programBinaryCache.h"
 #include "gl/renderState.h"
 #include "gl/shaderProgram.h"
+#include "gl/snapshotReader.h"
 #include "labels/labels.h"
+#include "labels/textLabels.h"
 #include "marker/marker.h"
 #include "marker/markerManager.h"
 #include "platform.h"
 #include "scene/scene.h"
 #include "scene/sceneLoader.h"
+#include "scene/styleContext.h"
+#include "selection/featureIndex.h"
+#include "selection/featureStates.h"
 #include "selection/selectionQuery.h"
 #include "style/material.h"
+#include "style/renderQueue.h"
 #include "style/style.h"
 #include "text/fontContext.h"
 #include "tile/tile.h"
 #include "tile/tileCache.h"
 #include "tile/tileManager.h"
 #include "util/asyncWorker.h"
+#include "util/dynamicResolution.h"
+#include "util/framePacer.h"
 #include "util/fastmap.h"
 #include "util/inputHandler.h"
 #include "util/ease.h"
 #include "util/jobQueue.h"
+#include "util/memoryReport.h"
+#include "util/yamlHelper.h"
 #include "view/flyTo.h"
+#include "view/modelTransforms.h"
 #include "view/view.h"
 
 #include <bitset>
 #include <cmath>
+#include <limits>
 
 namespace Tangram {
 
-const static size_t MAX_WORKERS = 2;
+// Default time in seconds that the camera path is predicted ahead for prefetching
+const static float PREFETCH_LOOKAHEAD = 0.5f;
+
+// Seconds between label placements while markers are easing; in between
+// marker labels follow their marker without collision detection
+const static float EASING_PLACEMENT_INTERVAL = 0.25f;
+
+// Default seconds between compactions of the glyph atlases
+const static float GLYPH_COMPACTION_INTERVAL = 10.f;
 
 enum class EaseField { position, zoom, rotation, tilt };
 
 class Map::Impl {
 
 public:
-    Impl(std::shared_ptr<Platform> _platform) :
+    Impl(std::shared_ptr<Platform> _platform, std::shared_ptr<MapContext> _context,
+         const ResourceProfile& _profile) :
+        profile(_profile),
+        asyncWorker(std::make_unique<AsyncWorker>(_platform->threadPolicy(ThreadRole::background))),
         platform(_platform),
         inputHandler(_platform, view),
         scene(std::make_shared<Scene>(_platform, Url())),
-        tileWorker(_platform, MAX_WORKERS),
-        tileManager(_platform, tileWorker) {}
+        context(std::move(_context)),
+        tileWorkers(context ? context->m_tileWorker :
+                    std::make_shared<TileWorker>(_platform, std::max(profile.tileWorkers, 1))),
+        tileWorker(tileWorkers->addClient()),
+        tileManager(_platform, *tileWorker),
+        markerManager(_platform),
+        selectionBufferScale(profile.selectionBufferScale) {
+        tileManager.setCacheSize(profile.tileCacheSize);
+        tileManager.setPrefetchBudget(profile.prefetchTasks);
+        tileManager.setUploadBudget(profile.uploadBudget);
+    }
+
+    // Applied to the scene before it is loaded
+    void applyProfile(Scene& _scene) const {
+        _scene.sourceCacheSize = profile.sourceCacheSize;
+        _scene.maxGlyphTextures = profile.maxGlyphTextures;
+        _scene.compactRasters = profile.compactRasters;
+    }
 
     void setScene(std::shared_ptr<Scene>& _scene);
 
+    // Swap in _scene once its fonts and textures are loaded, the current
+    // scene is drawn until then
+    void setPendingScene(std::shared_ptr<Scene> _scene);
+    void updatePendingScene();
+
     void setEase(EaseField _f, Ease _e);
     void clearEase(EaseField _f);
 
@@ -62,37 +112,198 @@ public:
 
     void setPixelScale(float _pixelsPerPoint);
 
+    // Set _view to the predicted camera position 'prefetchLookahead' seconds
+    // ahead, returns false when the camera is not moving.
+    bool predictView(View& _view);
+
+    // Free memory that is not needed for the current view until _bytes are freed
+    MemoryRelease releaseMemory(uint64_t _bytes);
+
+    // Move labels onto compacted glyph atlases, release the atlases they left and
+    // start the next compaction on asyncWorker, every glyphCompactionInterval
+    void updateGlyphAtlases(float _dt);
+
+    // Place labels of _tiles and markers, or only update the labels that were placed before
+    void updateLabels(const ViewState& _viewState, float _dt, bool _placeLabels,
+                      const std::shared_ptr<Scene>& _scene,
+                      const std::vector<std::shared_ptr<Tile>>& _tiles);
+
+    // Run updateLabels on labelWorker, the label meshes become visible with finishLabels
+    void updateLabelsAsync(float _dt, bool _placeLabels);
+
+    // Block until labelWorker is done with labels, tiles and markers
+    void waitForLabels() {
+        std::unique_lock<std::mutex> lock(labelMutex);
+        labelCondition.wait(lock, [&]{ return !labelsRunning; });
+    }
+
+    // Draw the label meshes of the last completed placement
+    void swapLabels() {
+        if (labelsCompleted.exchange(false)) {
+            for (const auto& style : scene->styles()) { style->onEndUpdate(); }
+        }
+    }
+
+    void finishLabels() {
+        waitForLabels();
+        swapLabels();
+    }
+
+    // Replace the frame by a color ramp of the fragment counts, see DebugFlags::overdraw
+    void drawOverdraw(glm::vec2 _viewport);
+
+    // Draw the frame into scaledBuffer at _scale of _viewport and upscale it,
+    // see Map::setDynamicResolution. Requires tilesMutex.
+    void drawScaled(glm::vec2 _viewport, float _scale);
+
+    // Issue the reads of the snapshots requested for the drawn frame
+    void readSnapshots();
+
+    // Add the area _min to _max in pixels, y pointing down, to the next frame
+    void addDamage(glm::vec2 _min, glm::vec2 _max) {
+        damageMin = glm::min(damageMin, _min);
+        damageMax = glm::max(damageMax, _max);
+    }
+
+    bool hasDamage() const { return redrawAll || damageMin.x < damageMax.x; }
+
+    void resetDamage() {
+        redrawAll = false;
+        damageMin = glm::vec2(std::numeric_limits<float>::max());
+        damageMax = glm::vec2(std::numeric_limits<float>::lowest());
+    }
+
+    template <typename... Args>
+    void record(const char* _name, const Args&... _args) {
+        if (recorder) { recorder->record(_name, _args...); }
+    }
+
+    void recordSceneLoad(const char* _name, std::vector<std::string> _args,
+                         const std::vector<SceneUpdate>& _updates) {
+        if (!recorder || !recorder->isRecording()) { return; }
+        for (auto& update : _updates) {
+            _args.push_back(update.path);
+            _args.push_back(update.value);
+        }
+        recorder->add(_name, std::move(_args));
+    }
+
     std::mutex tilesMutex;
     std::mutex sceneMutex;
 
+    // Limits the map was created with
+    ResourceProfile profile;
+
     RenderState renderState;
     JobQueue jobQueue;
     View view;
     Labels labels;
-    std::unique_ptr<AsyncWorker> asyncWorker = std::make_unique<AsyncWorker>();
+    RenderQueue renderQueue;
+    PerformanceMonitor performance;
+    GpuTimer gpuTimer;
+    std::unique_ptr<AsyncWorker> asyncWorker;
+    std::shared_ptr<SessionRecorder> recorder;
     std::shared_ptr<Platform> platform;
     InputHandler inputHandler;
 
     std::array<Ease, 4> eases;
 
+    // Camera path of the running flyTo animation
+    std::function<glm::dvec3(float)> flyToPath;
+    float prefetchLookahead = PREFETCH_LOOKAHEAD;
+
+    // Milliseconds per update for running jobs posted by other threads, 0 for no limit
+    float jobBudget = 0.f;
+    // Milliseconds per frame for placing labels, 0 for no limit
+    float placementBudget = 0.f;
+
+    // Deadline of the current frame, see Map::update(float, float)
+    FramePacer framePacer;
+
+    // Seconds since the last label placement while markers are easing
+    float easingPlacementTime = 0.f;
+
+    // See Map::setGlyphAtlasCompaction
+    float glyphCompactionInterval = GLYPH_COMPACTION_INTERVAL;
+    float glyphCompactionTime = 0.f;
+    std::atomic<bool> glyphCompactionRunning{false};
+
+    // Labels are placed on labelWorker while the previous ones are drawn
+    bool pipelinedUpdates = false;
+    bool labelsRunning = false;
+    std::atomic<bool> labelsCompleted{false};
+    std::atomic<bool> labelsNeedUpdate{false};
+    std::mutex labelMutex;
+    std::condition_variable labelCondition;
+
     std::shared_ptr<Scene> scene;
     std::shared_ptr<Scene> lastValidScene;
+    // Loaded scene waiting for its resources, see setPendingScene
+    std::shared_ptr<Scene> pendingScene;
     std::atomic<int32_t> sceneLoadTasks{0};
     std::condition_variable sceneLoadCondition;
 
+    // Shared with the other maps of the context, if any
+    std::shared_ptr<MapContext> context;
+
     // NB: Destruction of (managed and loading) tiles must happen
     // before implicit destruction of 'scene' above!
     // In particular any references of Labels and Markers to FontContext
-    TileWorker tileWorker;
+    std::shared_ptr<TileWorker> tileWorkers;
+    std::unique_ptr<TileWorker::Client> tileWorker;
     TileManager tileManager;
+    // Transforms of the visible tiles, updated in one pass
+    ModelTransforms tileTransforms;
     MarkerManager markerManager;
     std::unique_ptr<FrameBuffer> selectionBuffer = std::make_unique<FrameBuffer>(0, 0);
 
     bool cacheGlState = false;
+    std::string sceneCachePath;
+    std::string glyphBundlePath;
     float pickRadius = .5f;
+    float selectionBufferScale;
 
     std::vector<SelectionQuery> selectionQueries;
 
+    // Area of the selection buffer drawn since the view, tiles, markers or labels last
+    // changed, in normalized window coordinates. Queries within it reuse the buffer.
+    bool selectionBufferValid = false;
+    glm::vec2 selectionAreaMin;
+    glm::vec2 selectionAreaMax;
+    bool animatedScene = false;
+
+    // Version of the feature states of the scene that was drawn last
+    uint32_t featureStatesVersion = 0;
+
+    // Frames are only drawn when something changed, see Map::setIdleFrameSkipping
+    bool idleFrameSkipping = false;
+    // Only the damaged area of frames is drawn, see Map::setPartialRedraw
+    bool partialRedraw = false;
+    // Changes since the last drawn frame: all of it or the damaged area
+    bool redrawAll = true;
+    glm::vec2 damageMin = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 damageMax = glm::vec2(std::numeric_limits<float>::lowest());
+    // Nothing changed on the last update, see Map::isIdle
+    bool idle = false;
+    unsigned long drawnDebugFlags = 0;
+
+    // Render scale of frames while the view moves, see Map::setDynamicResolution
+    DynamicResolution dynamicResolution;
+    bool fullResolutionLabels = true;
+    std::unique_ptr<FrameBuffer> scaledBuffer;
+    // The last drawn frame was upscaled
+    bool scaledFrame = false;
+
+    // Regions from the top left of the viewport, see Map::captureSnapshotAsync
+    struct SnapshotRequest {
+        int x, y, width, height;
+        int downsample;
+        SnapshotCallback callback;
+    };
+    std::vector<SnapshotRequest> snapshotRequests;
+    SnapshotReader snapshotReader;
+    PerformanceMonitor::Clock::time_point lastRenderStart;
+
     SceneReadyCallback onSceneReady = nullptr;
 
     void sceneLoadBegin() {
@@ -106,27 +317,63 @@ public:
         sceneLoadCondition.notify_one();
     }
 
+    // Stopped first, its jobs use most of the members above
+    std::unique_ptr<AsyncWorker> labelWorker;
 };
 
 void Map::Impl::setEase(EaseField _f, Ease _e) {
+    if (_f == EaseField::zoom) { flyToPath = nullptr; }
     eases[static_cast<size_t>(_f)] = _e;
     platform->requestRender();
 }
 
 void Map::Impl::clearEase(EaseField _f) {
+    if (_f == EaseField::zoom) { flyToPath = nullptr; }
     static Ease none = {};
     eases[static_cast<size_t>(_f)] = none;
 }
 
-static std::bitset<9> g_flags = 0;
+static std::bitset<12> g_flags = 0;
+
+MapContext::MapContext(std::shared_ptr<Platform> _platform, int _tileWorkers) :
+    m_platform(_platform),
+    m_tileWorker(std::make_shared<TileWorker>(_platform, _tileWorkers)) {}
+
+MapContext::~MapContext() {
+    m_tileWorker->stop();
+}
+
+ResourceProfile ResourceProfile::lowMemory() {
+    ResourceProfile profile;
+    profile.tileCacheSize = 8 * 1024 * 1024;
+    profile.sourceCacheSize = 4 * 1024 * 1024;
+    profile.tileWorkers = 1;
+    profile.prefetchTasks = 1;
+    profile.uploadBudget = 1024 * 1024;
+    profile.maxGlyphTextures = 8;
+    profile.compactRasters = true;
+    profile.selectionBufferScale = 0.25f;
+    return profile;
+}
 
-Map::Map(std::shared_ptr<Platform> _platform) : platform(_platform) {
-    impl.reset(new Impl(_platform));
+Map::Map(std::shared_ptr<Platform> _platform, const ResourceProfile& _profile) : platform(_platform) {
+    impl.reset(new Impl(_platform, nullptr, _profile));
+}
+
+Map::Map(std::shared_ptr<MapContext> _context, const ResourceProfile& _profile) : platform(_context->platform()) {
+    impl.reset(new Impl(platform, std::move(_context), _profile));
 }
 
 Map::~Map() {
     // The unique_ptr to Impl will be automatically destroyed when Map is destroyed.
-    impl->tileWorker.stop();
+    impl->waitForLabels();
+    impl->labelWorker.reset();
+    if (impl->context) {
+        // Other maps keep the workers running, stop building tiles of this one
+        impl->tileWorker->clear();
+    } else {
+        impl->tileWorkers->stop();
+    }
     impl->asyncWorker.reset();
 
     // Make sure other threads are stopped before calling stop()!
@@ -137,9 +384,42 @@ Map::~Map() {
     Primitives::deinit();
 }
 
+void Map::Impl::setPendingScene(std::shared_ptr<Scene> _scene) {
+
+    // A scene that was superseded before it was shown still reports its load
+    if (pendingScene && onSceneReady) { onSceneReady(pendingScene->id, nullptr); }
+
+    pendingScene = std::move(_scene);
+    updatePendingScene();
+}
+
+void Map::Impl::updatePendingScene() {
+
+    if (!pendingScene) { return; }
+
+    if (pendingScene->pendingFonts > 0 || pendingScene->pendingTextures > 0) {
+        platform->requestRender();
+        return;
+    }
+
+    auto next = std::move(pendingScene);
+    pendingScene.reset();
+
+    setScene(next);
+    if (onSceneReady) { onSceneReady(next->id, nullptr); }
+}
+
 void Map::Impl::setScene(std::shared_ptr<Scene>& _scene) {
 
+    waitForLabels();
+
+    if (pendingScene && pendingScene != _scene) {
+        if (onSceneReady) { onSceneReady(pendingScene->id, nullptr); }
+        pendingScene.reset();
+    }
+
     scene = _scene;
+    redrawAll = true;
 
     scene->setPixelScale(view.pixelScale());
 
@@ -176,7 +456,7 @@ void Map::Impl::setScene(std::shared_ptr<Scene>& _scene) {
 
     inputHandler.setView(view);
     tileManager.setTileSources(_scene->tileSources());
-    tileWorker.setScene(_scene);
+    tileWorker->setScene(_scene);
     markerManager.setScene(_scene);
 
     bool animated = scene->animated() == Scene::animate::yes;
@@ -190,6 +470,9 @@ void Map::Impl::setScene(std::shared_ptr<Scene>& _scene) {
     if (animated != platform->isContinuousRendering()) {
         platform->setContinuousRendering(animated);
     }
+
+    animatedScene = animated;
+    selectionBufferValid = false;
 }
 
 // NB: Not thread-safe. Must be called on the main/render thread!
@@ -197,6 +480,12 @@ void Map::Impl::setScene(std::shared_ptr<Scene>& _scene) {
 SceneID Map::loadScene(std::shared_ptr<Scene> scene,
                        const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    scene->cachePath = impl->sceneCachePath;
+    scene->glyphBundlePath = impl->glyphBundlePath;
+    impl->applyProfile(*scene);
+    // Glyph bundles are per pixel scale
+    scene->setPixelScale(impl->view.pixelScale());
+
     {
         std::unique_lock<std::mutex> lock(impl->sceneMutex);
 
@@ -227,6 +516,8 @@ SceneID Map::loadScene(std::shared_ptr<Scene> scene,
 SceneID Map::loadScene(const std::string& _scenePath, bool _useScenePosition,
                        const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    impl->recordSceneLoad("loadScene", { _scenePath, SessionRecorder::arg(_useScenePosition) }, _sceneUpdates);
+
     LOG("Loading scene file: %s", _scenePath.c_str());
     auto scene = std::make_shared<Scene>(platform, _scenePath);
     scene->useScenePosition = _useScenePosition;
@@ -236,6 +527,9 @@ SceneID Map::loadScene(const std::string& _scenePath, bool _useScenePosition,
 SceneID Map::loadSceneYaml(const std::string& _yaml, const std::string& _resourceRoot,
                            bool _useScenePosition, const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    impl->recordSceneLoad("loadSceneYaml", { _yaml, _resourceRoot, SessionRecorder::arg(_useScenePosition) },
+                          _sceneUpdates);
+
     LOG("Loading scene string");
     auto scene = std::make_shared<Scene>(platform, _yaml, _resourceRoot);
     scene->useScenePosition = _useScenePosition;
@@ -245,6 +539,8 @@ SceneID Map::loadSceneYaml(const std::string& _yaml, const std::string& _resourc
 SceneID Map::loadSceneAsync(const std::string& _scenePath, bool _useScenePosition,
                             const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    impl->recordSceneLoad("loadSceneAsync", { _scenePath, SessionRecorder::arg(_useScenePosition) }, _sceneUpdates);
+
     LOG("Loading scene file (async): %s", _scenePath.c_str());
     auto scene = std::make_shared<Scene>(platform, _scenePath);
     scene->useScenePosition = _useScenePosition;
@@ -254,6 +550,9 @@ SceneID Map::loadSceneAsync(const std::string& _scenePath, bool _useScenePositio
 SceneID Map::loadSceneYamlAsync(const std::string& _yaml, const std::string& _resourceRoot,
                                 bool _useScenePosition, const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    impl->recordSceneLoad("loadSceneYamlAsync", { _yaml, _resourceRoot, SessionRecorder::arg(_useScenePosition) },
+                          _sceneUpdates);
+
     LOG("Loading scene string (async)");
     auto scene = std::make_shared<Scene>(platform, _yaml, _resourceRoot);
     scene->useScenePosition = _useScenePosition;
@@ -265,6 +564,11 @@ SceneID Map::loadSceneAsync(std::shared_ptr<Scene> nextScene,
 
     impl->sceneLoadBegin();
 
+    nextScene->cachePath = impl->sceneCachePath;
+    nextScene->glyphBundlePath = impl->glyphBundlePath;
+    impl->applyProfile(*nextScene);
+    nextScene->setPixelScale(impl->view.pixelScale());
+
     runAsyncTask([nextScene, _sceneUpdates, this](){
 
             bool newSceneLoaded = SceneLoader::loadScene(platform, nextScene, _sceneUpdates);
@@ -286,13 +590,7 @@ SceneID Map::loadSceneAsync(std::shared_ptr<Scene> nextScene,
                 impl->lastValidScene = nextScene;
             }
 
-            impl->jobQueue.add([nextScene, newSceneLoaded, this]() {
-                    if (newSceneLoaded) {
-                        auto s = nextScene;
-                        impl->setScene(s);
-                    }
-                    if (impl->onSceneReady) { impl->onSceneReady(nextScene->id, nullptr); }
-                });
+            impl->jobQueue.add([nextScene, this]() { impl->setPendingScene(nextScene); });
 
             impl->sceneLoadEnd();
             platform->requestRender();
@@ -311,6 +609,8 @@ std::shared_ptr<Platform>& Map::getPlatform() {
 
 SceneID Map::updateSceneAsync(const std::vector<SceneUpdate>& _sceneUpdates) {
 
+    impl->recordSceneLoad("updateSceneAsync", {}, _sceneUpdates);
+
     impl->sceneLoadBegin();
 
     std::vector<SceneUpdate> updates = _sceneUpdates;
@@ -329,9 +629,45 @@ SceneID Map::updateSceneAsync(const std::vector<SceneUpdate>& _sceneUpdates) {
                 return;
             }
 
+            std::shared_ptr<Scene> currentScene;
+            std::vector<SceneLoader::UniformUpdate> uniformUpdates;
+            bool uniformsUpdated = false;
+            SceneLoader::UpdateLevel level;
             {
                 std::lock_guard<std::mutex> lock(impl->sceneMutex);
-                nextScene->copyConfig(*impl->lastValidScene);
+                currentScene = impl->lastValidScene;
+                level = SceneLoader::classifyUpdates(*currentScene, updates);
+
+                // Uniform values are set on the styles of the current scene
+                // and its config is updated for following scene updates
+                if (level == SceneLoader::UpdateLevel::uniforms) {
+                    uniformsUpdated =
+                        SceneLoader::parseUniformUpdates(*currentScene, updates, uniformUpdates) &&
+                        SceneLoader::applyUpdates(platform, *currentScene, updates);
+                    if (!uniformsUpdated) { level = SceneLoader::UpdateLevel::styling; }
+                }
+                if (!uniformsUpdated) { nextScene->copyConfig(*currentScene); }
+            }
+
+            if (uniformsUpdated) {
+                impl->jobQueue.add([nextScene, currentScene, uniformUpdates, this]() {
+                        if (impl->scene == currentScene || impl->pendingScene == currentScene) {
+                            for (auto& update : uniformUpdates) {
+                                update.style->styleUniforms()[update.index].second = update.value;
+                            }
+                        }
+                        if (impl->onSceneReady) { impl->onSceneReady(nextScene->id, nullptr); }
+                    });
+
+                impl->sceneLoadEnd();
+                platform->requestRender();
+                return;
+            }
+
+            // Keep the tile sources and their cached data when the updates
+            // do not affect them, tiles are still rebuilt with the new styling
+            if (level == SceneLoader::UpdateLevel::styling) {
+                nextScene->tileSources() = currentScene->tileSources();
             }
 
             if (!SceneLoader::applyUpdates(platform, *nextScene, updates)) {
@@ -358,10 +694,10 @@ SceneID Map::updateSceneAsync(const std::vector<SceneUpdate>& _sceneUpdates) {
             impl->jobQueue.add([nextScene, configApplied, this]() {
 
                     if (configApplied) {
-                        auto s = nextScene;
-                        impl->setScene(s);
+                        impl->setPendingScene(nextScene);
+                    } else if (impl->onSceneReady) {
+                        impl->onSceneReady(nextScene->id, nullptr);
                     }
-                    if (impl->onSceneReady) { impl->onSceneReady(nextScene->id, nullptr); }
                 });
 
             impl->sceneLoadEnd();
@@ -376,23 +712,92 @@ void Map::setMBTiles(const char* _dataSourceName, const char* _mbtilesFilePath)
     updateSceneAsync({SceneUpdate{scenePath.c_str(), _mbtilesFilePath}});
 }
 
+std::shared_ptr<OfflineDownload> Map::downloadRegion(const char* _dataSourceName, const char* _mbtilesFilePath,
+                                                     const OfflineRegion& _region,
+                                                     OfflineProgressCallback _callback,
+                                                     const OfflineDownloadOptions& _options) {
+
+    std::string url;
+    std::vector<std::string> subdomains;
+    bool isTms = false;
+    {
+        std::lock_guard<std::mutex> lock(impl->sceneMutex);
+        auto source = impl->scene->config()["sources"][_dataSourceName];
+        if (!source) {
+            LOGE("Cannot download region: Unknown DataSource '%s'", _dataSourceName);
+            return nullptr;
+        }
+        url = SceneLoader::loadSourceUrl(_dataSourceName, source);
+        subdomains = SceneLoader::loadSourceSubdomains(source);
+        if (auto tmsNode = source["tms"]) { getBool(tmsNode, isTms); }
+    }
+
+    if (url.find("{x}") == std::string::npos || url.find("{y}") == std::string::npos ||
+        url.find("{z}") == std::string::npos) {
+        LOGE("Cannot download region: DataSource '%s' is not tiled", _dataSourceName);
+        return nullptr;
+    }
+
+    auto download = std::make_shared<OfflineDownload>(platform, url, std::move(subdomains), isTms,
+                                                      _mbtilesFilePath, _region, _options);
+    if (!download->start(_callback)) { return nullptr; }
+
+    return download;
+}
+
 void Map::resize(int _newWidth, int _newHeight) {
 
+    impl->record("resize", _newWidth, _newHeight);
+
     LOGS("resize: %d x %d", _newWidth, _newHeight);
     LOG("resize: %d x %d", _newWidth, _newHeight);
 
     impl->renderState.viewport(0, 0, _newWidth, _newHeight);
+    impl->redrawAll = true;
 
     impl->view.setSize(_newWidth, _newHeight);
 
-    impl->selectionBuffer = std::make_unique<FrameBuffer>(_newWidth/2, _newHeight/2);
+    impl->selectionBuffer = std::make_unique<FrameBuffer>(_newWidth * impl->selectionBufferScale,
+                                                          _newHeight * impl->selectionBufferScale);
+    impl->selectionBufferValid = false;
 
     Primitives::setResolution(impl->renderState, _newWidth, _newHeight);
 }
 
+bool Map::update(float _dt, float _deadline) {
+
+    impl->framePacer.beginFrame(_deadline);
+    bool viewComplete = update(_dt);
+
+    // render() ends the frame, unless none is drawn
+    if (impl->idleFrameSkipping && impl->idle) { impl->framePacer.endFrame(); }
+
+    return viewComplete;
+}
+
 bool Map::update(float _dt) {
 
-    impl->jobQueue.runJobs();
+    using Timer = PerformanceMonitor::Timer;
+
+    impl->record("update", _dt);
+
+    // Labels placed on the previous update are drawn from here on
+    impl->finishLabels();
+
+    // Before the deadline of the frame the update and render have to be done
+    float jobBudget = impl->jobBudget;
+    if (impl->framePacer.paced()) {
+        float reserve = impl->performance.average(Timer::update) + impl->performance.average(Timer::render);
+        float budget = impl->framePacer.budget(reserve);
+        jobBudget = jobBudget > 0.f ? std::min(jobBudget, budget) : budget;
+    }
+
+    // Jobs left over by the budget run on the next frame
+    if (impl->jobQueue.runJobs(jobBudget)) {
+        platform->requestRender();
+    }
+
+    impl->updatePendingScene();
 
     // Wait until font and texture resources are fully loaded
     if (impl->scene->pendingFonts > 0 || impl->scene->pendingTextures > 0) {
@@ -400,7 +805,7 @@ bool Map::update(float _dt) {
         return false;
     }
 
-    FrameInfo::beginUpdate();
+    auto updateStart = PerformanceMonitor::now();
 
     impl->scene->updateTime(_dt);
 
@@ -419,6 +824,23 @@ bool Map::update(float _dt) {
     impl->view.update();
 
     bool markersChanged = impl->markerManager.update(impl->view, _dt);
+    bool markersEasing = impl->markerManager.isEasing();
+    markersNeedUpdate = markersEasing;
+
+    // Easing markers only move their labels, which are placed again at an interval
+    // rather than on every frame.
+    if (markersEasing) {
+        impl->easingPlacementTime += _dt;
+        if (impl->easingPlacementTime >= EASING_PLACEMENT_INTERVAL) {
+            impl->easingPlacementTime = 0.f;
+            markersChanged = true;
+        }
+    } else {
+        impl->easingPlacementTime = 0.f;
+    }
+
+    // Before the text meshes are sized for the textures of compacted glyphs
+    impl->updateGlyphAtlases(_dt);
 
     for (const auto& style : impl->scene->styles()) {
         style->onBeginUpdate();
@@ -429,34 +851,85 @@ bool Map::update(float _dt) {
 
         impl->tileManager.updateTileSets(impl->view);
 
+        View predictedView = impl->view;
+        if (impl->predictView(predictedView)) {
+            impl->tileManager.updatePrefetch(&predictedView);
+        } else {
+            impl->tileManager.updatePrefetch(nullptr);
+        }
+
         auto& tiles = impl->tileManager.getVisibleTiles();
-        auto& markers = impl->markerManager.markers();
 
-        if (impl->view.changedOnLastUpdate() ||
+        bool placeLabels = impl->view.changedOnLastUpdate() ||
             impl->tileManager.hasTileSetChanged() ||
-            markersChanged) {
+            markersChanged ||
+            impl->labels.deferredLabelCount() > 0;
 
+        if (placeLabels) {
+            auto& transforms = impl->tileTransforms;
+            transforms.clear();
             for (const auto& tile : tiles) {
-                tile->update(_dt, impl->view);
+                transforms.add(tile->getOrigin(), tile->getScale());
+            }
+            transforms.update(impl->view);
+            for (size_t i = 0; i < tiles.size(); i++) {
+                tiles[i]->setTransform(transforms.translation(i), transforms.mvp(i));
             }
-            impl->labels.updateLabelSet(impl->view.state(), _dt, impl->scene, tiles, markers,
-                                        impl->tileManager);
+        }
+
+        if (impl->pipelinedUpdates) {
+            impl->updateLabelsAsync(_dt, placeLabels);
         } else {
-            impl->labels.updateLabels(impl->view.state(), _dt, impl->scene->styles(), tiles, markers);
+            // Labels that do not fit before the deadline are placed on the next frames
+            if (impl->framePacer.paced()) {
+                float budget = impl->framePacer.budget(impl->performance.average(Timer::render));
+                impl->labels.setPlacementBudget(impl->placementBudget > 0.f ?
+                                                std::min(impl->placementBudget, budget) : budget);
+            }
+            impl->updateLabels(impl->view.state(), _dt, placeLabels, impl->scene, tiles);
+            if (impl->framePacer.paced()) {
+                impl->labels.setPlacementBudget(impl->placementBudget);
+            }
+            for (const auto& style : impl->scene->styles()) {
+                style->onEndUpdate();
+            }
         }
     }
 
-    FrameInfo::endUpdate();
+    impl->performance.record(PerformanceMonitor::Timer::update, updateStart);
 
     bool viewChanged = impl->view.changedOnLastUpdate();
     bool tilesChanged = impl->tileManager.hasTileSetChanged();
     bool tilesLoading = impl->tileManager.hasLoadingTiles();
-    bool labelsNeedUpdate = impl->labels.needUpdate();
+    bool labelsNeedUpdate = impl->pipelinedUpdates ?
+        impl->labelsNeedUpdate.load() : impl->labels.needUpdate();
 
     if (viewChanged || tilesChanged || tilesLoading || labelsNeedUpdate || impl->sceneLoadTasks > 0) {
         viewComplete = false;
     }
 
+    // Feature states apply without rebuilding tiles, see Map::setFeatureState
+    uint32_t statesVersion = impl->scene->featureStates()->version();
+    bool statesChanged = statesVersion != impl->featureStatesVersion;
+    impl->featureStatesVersion = statesVersion;
+
+    // Styles may move features in their shaders over time
+    if (viewChanged || tilesChanged || markersChanged || markersEasing || labelsNeedUpdate ||
+        statesChanged || impl->animatedScene) {
+        impl->selectionBufferValid = false;
+    }
+
+    // Labels placed on the label worker are only known when they are drawn
+    if (viewChanged || tilesChanged || markersChanged || statesChanged || impl->animatedScene ||
+        impl->sceneLoadTasks > 0 || (impl->pipelinedUpdates && (labelsNeedUpdate || markersEasing))) {
+        impl->redrawAll = true;
+    } else if (!impl->pipelinedUpdates) {
+        auto& damage = impl->labels.damage();
+        if (damage.min.x <= damage.max.x) { impl->addDamage(damage.min, damage.max); }
+    }
+
+    impl->idle = viewComplete && !markersEasing && !impl->hasDamage();
+
     // Request render if labels are in fading states or markers are easing.
     if (labelsNeedUpdate || markersNeedUpdate) {
         platform->requestRender();
@@ -465,10 +938,378 @@ bool Map::update(float _dt) {
     return viewComplete;
 }
 
+void Map::Impl::updateGlyphAtlases(float _dt) {
+
+    auto fontContext = scene->fontContext();
+    if (!fontContext || glyphCompactionInterval <= 0.f) { return; }
+
+    glyphCompactionTime += _dt;
+    if (glyphCompactionTime < glyphCompactionInterval) { return; }
+    glyphCompactionTime = 0.f;
+
+    // Quads of tiles built before a compaction. The label worker is done with
+    // them since finishLabels().
+    if (fontContext->compactionEpoch() > 0) {
+        std::lock_guard<std::mutex> lock(tilesMutex);
+
+        auto remap = [&](const Tile& _tile) {
+            for (const auto& style : scene->styles()) {
+                if (auto* textLabels = dynamic_cast<TextLabels*>(_tile.getMesh(*style).get())) {
+                    textLabels->remapGlyphs();
+                }
+            }
+        };
+        for (const auto& tile : tileManager.getVisibleTiles()) { remap(*tile); }
+        for (const auto& source : scene->tileSources()) {
+            tileManager.getTileCache()->forEachTile(source->id(), remap);
+        }
+        for (const auto& marker : markerManager.markers()) {
+            if (auto* textLabels = dynamic_cast<TextLabels*>(marker->mesh())) {
+                textLabels->remapGlyphs();
+            }
+        }
+
+        size_t freed = fontContext->releaseCompactedAtlases();
+        if (freed > 0) {
+            LOG("Released %lluKB of compacted glyph atlases", (unsigned long long)freed / 1024);
+        }
+    }
+
+    if (asyncWorker && !glyphCompactionRunning.exchange(true)) {
+        asyncWorker->enqueue([this, fontContext]() {
+            fontContext->compactAtlases();
+            glyphCompactionRunning = false;
+        });
+    }
+}
+
+void Map::Impl::updateLabels(const ViewState& _viewState, float _dt, bool _placeLabels,
+                             const std::shared_ptr<Scene>& _scene,
+                             const std::vector<std::shared_ptr<Tile>>& _tiles) {
+
+    auto labelStart = PerformanceMonitor::now();
+    auto& markers = markerManager.markers();
+
+    if (_placeLabels) {
+        labels.updateLabelSet(_viewState, _dt, _scene, _tiles, markers, tileManager);
+    } else {
+        labels.updateLabels(_viewState, _dt, _scene->styles(), _tiles, markers);
+    }
+    performance.record(PerformanceMonitor::Timer::labels, labelStart);
+}
+
+void Map::Impl::drawOverdraw(glm::vec2 _viewport) {
+
+    // Black for no fragments, blue for one, then green, yellow, orange and red
+    static const unsigned int ramp[] = { 0x000000, 0x0000ff, 0x00ff00, 0xffff00, 0xff8000, 0xff0000 };
+    static const int steps = sizeof(ramp) / sizeof(ramp[0]);
+
+    GL::stencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    for (int i = 0; i < steps; i++) {
+        // The last color takes all higher counts
+        GL::stencilFunc(i == steps - 1 ? GL_LEQUAL : GL_EQUAL, i, 0xFF);
+        Primitives::setColor(renderState, ramp[i]);
+        Primitives::fillRect(renderState, { 0.f, 0.f }, _viewport);
+    }
+
+    GL::disable(GL_STENCIL_TEST);
+}
+
+void Map::Impl::updateLabelsAsync(float _dt, bool _placeLabels) {
+
+    if (!labelWorker) {
+        labelWorker = std::make_unique<AsyncWorker>(platform->threadPolicy(ThreadRole::background));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(labelMutex);
+        labelsRunning = true;
+    }
+
+    // The tiles are copied since the tile sets change on the next update,
+    // while the previous label meshes are drawn
+    labelWorker->enqueue([this, _dt, _placeLabels, viewState = view.state(),
+                          scene = scene, tiles = tileManager.getVisibleTiles()]() {
+
+        updateLabels(viewState, _dt, _placeLabels, scene, tiles);
+
+        // Draw the new placement, also when nothing else requests it
+        bool needUpdate = labels.needUpdate();
+        labelsNeedUpdate = needUpdate;
+        if (_placeLabels || needUpdate) { platform->requestRender(); }
+
+        labelsCompleted = true;
+        {
+            std::lock_guard<std::mutex> lock(labelMutex);
+            labelsRunning = false;
+        }
+        labelCondition.notify_all();
+    });
+}
+
+bool Map::Impl::predictView(View& _view) {
+
+    auto& flyToEase = eases[static_cast<size_t>(EaseField::zoom)];
+
+    if (flyToPath && !flyToEase.finished() && flyToEase.d > 0) {
+        float t = std::fmin(1.f, (std::fmax(flyToEase.t, 0.f) + prefetchLookahead) / flyToEase.d);
+        glm::dvec3 pos = flyToPath(t);
+        _view.setPosition(pos.x, pos.y);
+        _view.setZoom(pos.z);
+        _view.update();
+        return true;
+    }
+
+    glm::dvec2 translation;
+    float zoom = 0.f;
+    if (inputHandler.predictFling(prefetchLookahead, translation, zoom)) {
+        _view.translate(translation.x, translation.y);
+        _view.zoom(zoom);
+        _view.update();
+        return true;
+    }
+
+    return false;
+}
+
+void Map::setSceneCachePath(const std::string& _path) {
+    impl->sceneCachePath = _path;
+}
+
+void Map::setGlyphBundlePath(const std::string& _path) {
+    impl->glyphBundlePath = _path;
+}
+
+void Map::setShaderCachePath(const std::string& _path) {
+    impl->jobQueue.add([this, _path]() {
+        if (_path.empty()) {
+            impl->renderState.programBinaryCache.reset();
+        } else {
+            impl->renderState.programBinaryCache = std::make_unique<ProgramBinaryCache>(_path);
+        }
+    });
+}
+
+void Map::setMeshBufferPooling(bool _enabled) {
+    impl->jobQueue.add([this, _enabled]() {
+        if (!_enabled) {
+            impl->renderState.bufferPool.reset();
+        } else if (!impl->renderState.bufferPool) {
+            impl->renderState.bufferPool = std::make_unique<BufferPool>();
+        }
+    });
+}
+
+void Map::setGpuTiming(bool _enabled) {
+    impl->jobQueue.add([this, _enabled]() {
+        if (!_enabled) {
+            impl->renderState.gpuTimer = nullptr;
+            impl->gpuTimer.reset();
+        } else if (!Hardware::supportsTimerQuery) {
+            LOGW("Timer queries are not supported, GPU timing is disabled");
+        } else {
+            impl->renderState.gpuTimer = &impl->gpuTimer;
+        }
+    });
+}
+
+void Map::setTileCacheSize(size_t _bytes) {
+    impl->waitForLabels();
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->tileManager.setCacheSize(std::min(_bytes, impl->profile.tileCacheSize));
+}
+
+void Map::setTileCachePolicy(TileCachePolicyType _policy) {
+    std::unique_ptr<TileCachePolicy> policy;
+    switch (_policy) {
+    case TileCachePolicyType::lru:
+        policy = std::make_unique<LruCachePolicy>();
+        break;
+    case TileCachePolicyType::zoom_aware:
+        policy = std::make_unique<ZoomAwareCachePolicy>();
+        break;
+    case TileCachePolicyType::frequency:
+        policy = std::make_unique<FrequencyCachePolicy>();
+        break;
+    }
+
+    impl->waitForLabels();
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->tileManager.getTileCache()->setPolicy(std::move(policy));
+}
+
+void Map::setTileCacheResidency(size_t _gpuBytes, size_t _cpuBytes) {
+    impl->waitForLabels();
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->tileManager.setCacheResidency(_gpuBytes, _cpuBytes);
+}
+
+void Map::setGlyphAtlasCompaction(float _interval) {
+    impl->glyphCompactionInterval = std::max(_interval, 0.f);
+    impl->glyphCompactionTime = 0.f;
+}
+
+GlyphAtlasStats Map::getGlyphAtlasStats(bool _reset) {
+    auto& fontContext = impl->scene->fontContext();
+    if (!fontContext) { return {}; }
+    return fontContext->atlasStats(_reset);
+}
+
+TileCacheStats Map::getTileCacheStats(bool _reset) {
+    impl->waitForLabels();
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    auto& cache = impl->tileManager.getTileCache();
+    auto stats = cache->getStats();
+    if (_reset) { cache->resetStats(); }
+    return stats;
+}
+
+void Map::setTilePrefetch(float _lookahead, int _maxTasks) {
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->prefetchLookahead = _lookahead;
+    impl->tileManager.setPrefetchBudget(std::min(_maxTasks, impl->profile.prefetchTasks));
+}
+
+void Map::setMaxVisibleTiles(int _count) {
+    impl->view.setMaxVisibleTiles(_count);
+    platform->requestRender();
+}
+
+void Map::setTileUploadBudget(size_t _bytes) {
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->tileManager.setUploadBudget(_bytes);
+}
+
+void Map::setHoldProxyTiles(bool _hold) {
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+    impl->tileManager.setHoldProxies(_hold);
+}
+
+void Map::setLabelPlacementBudget(float _milliseconds) {
+    impl->waitForLabels();
+    impl->placementBudget = _milliseconds;
+    impl->labels.setPlacementBudget(_milliseconds);
+}
+
+size_t Map::getDeferredLabelCount() {
+    impl->waitForLabels();
+    return impl->labels.deferredLabelCount();
+}
+
+void Map::setJobBudget(float _milliseconds) {
+    impl->jobBudget = _milliseconds;
+}
+
+void Map::setPipelinedUpdates(bool _enabled) {
+    impl->finishLabels();
+    impl->pipelinedUpdates = _enabled;
+    platform->requestRender();
+}
+
+MemoryStats Map::getMemoryStats() {
+    impl->waitForLabels();
+    MemoryReport report;
+
+    auto scene = impl->scene;
+    {
+        std::lock_guard<std::mutex> lock(impl->tilesMutex);
+
+        impl->tileManager.reportMemory(report);
+
+        // Sources without a tile set, e.g. raster samplers
+        if (scene) {
+            for (auto& source : scene->tileSources()) {
+                if (report.count(source.get())) { source->reportMemory(report); }
+            }
+        }
+    }
+
+    if (scene) {
+        for (auto& texture : scene->textures()) {
+            if (texture.second) { report.addTexture(report.stats.textures, *texture.second); }
+        }
+        if (scene->fontContext()) {
+            report.stats.fonts = scene->fontContext()->memoryUsage();
+        }
+    }
+
+    report.stats.javascript.cpuBytes = StyleContext::heapBytes();
+
+    return report.stats;
+}
+
+void Map::setBuildCostAccounting(bool _enabled) {
+    impl->tileWorkers->buildCosts().setEnabled(_enabled);
+}
+
+BuildCostStats Map::getBuildCostStats(bool _reset) {
+    return impl->tileWorkers->buildCosts().stats(_reset);
+}
+
+void Map::setSessionRecorder(std::shared_ptr<SessionRecorder> _recorder) {
+    impl->recorder = std::move(_recorder);
+}
+
+std::string Map::getTileTrace(bool _clear) {
+#if defined(TANGRAM_TILE_TRACING)
+    auto trace = TileTrace::exportChromeTrace();
+    if (_clear) { TileTrace::clear(); }
+    return trace;
+#else
+    return "";
+#endif
+}
+
+PerformanceStats Map::getPerformanceStats() {
+    using Timer = PerformanceMonitor::Timer;
+
+    PerformanceStats stats;
+    stats.update = impl->performance.timing(Timer::update);
+    stats.render = impl->performance.timing(Timer::render);
+    stats.labels = impl->performance.timing(Timer::labels);
+    stats.upload = impl->performance.timing(Timer::upload);
+    stats.frames = impl->performance.count(Timer::render);
+
+    stats.drawCalls = impl->renderState.frameStats().drawCalls;
+    stats.stateChanges = impl->renderState.frameStats().stateChanges;
+
+    for (auto& timing : impl->gpuTimer.timings()) {
+        stats.gpu.push_back({ timing.first, timing.second });
+    }
+
+    std::lock_guard<std::mutex> lock(impl->tilesMutex);
+
+    auto& tileManager = impl->tileManager;
+    stats.tilesInFlight = std::max(0, tileManager.tilesInProgress());
+    stats.visibleTiles = tileManager.getVisibleTiles().size();
+    stats.uploadedBytes = tileManager.uploadedBytes();
+
+    auto cacheStats = tileManager.getTileCache()->getStats();
+    uint64_t lookups = cacheStats.hits + cacheStats.misses;
+    if (lookups > 0) { stats.tileCacheHitRate = float(cacheStats.hits) / lookups; }
+
+    stats.gpuBytes = cacheStats.gpuBytes;
+    for (const auto& tile : tileManager.getVisibleTiles()) {
+        stats.gpuBytes += tile->getMemoryUsage();
+    }
+    return stats;
+}
+
 void Map::setPickRadius(float _radius) {
     impl->pickRadius = _radius;
 }
 
+void Map::setSelectionBufferScale(float _scale) {
+    _scale = glm::clamp(_scale, .1f, std::max(impl->profile.selectionBufferScale, .1f));
+    if (_scale == impl->selectionBufferScale) { return; }
+
+    impl->selectionBufferScale = _scale;
+    impl->selectionBuffer = std::make_unique<FrameBuffer>(impl->view.getWidth() * _scale,
+                                                          impl->view.getHeight() * _scale);
+    impl->selectionBufferValid = false;
+}
+
 void Map::pickFeatureAt(float _x, float _y, FeaturePickCallback _onFeaturePickCallback) {
     impl->selectionQueries.push_back({{_x, _y}, impl->pickRadius, _onFeaturePickCallback});
 
@@ -487,11 +1328,118 @@ void Map::pickMarkerAt(float _x, float _y, MarkerPickCallback _onMarkerPickCallb
     platform->requestRender();
 }
 
-void Map::render() {
+void Map::pickFeaturesAt(const std::vector<std::array<float, 2>>& _positions,
+                         FeaturesPickCallback _onFeaturesPickCallback) {
+    std::vector<glm::vec2> positions;
+    positions.reserve(_positions.size());
+    for (auto& position : _positions) { positions.emplace_back(position[0], position[1]); }
+
+    if (positions.empty()) {
+        _onFeaturesPickCallback({});
+        return;
+    }
+    impl->selectionQueries.emplace_back(std::move(positions), impl->pickRadius, _onFeaturesPickCallback);
+
+    platform->requestRender();
+}
+
+void Map::pickFeaturesInRect(float _x, float _y, float _width, float _height,
+                             FeaturesPickCallback _onFeaturesPickCallback) {
+    impl->selectionQueries.emplace_back(glm::vec2(_x, _y), glm::vec2(_x + _width, _y + _height),
+                                        _onFeaturesPickCallback);
+
+    platform->requestRender();
+}
+
+void Map::setFeatureIndexing(bool _enabled) {
+    impl->tileWorkers->setFeatureIndexing(_enabled);
+}
+
+void Map::pickFeatureFromIndexAt(float _x, float _y, FeaturePickCallback _onFeaturePickCallback) {
+
+    // The pick radius on the ground plane, measured towards the right of the position
+    double x = _x, y = _y;
+    double radiusX = _x + impl->pickRadius * impl->view.pixelScale(), radiusY = _y;
+    if (impl->view.screenToGroundPlane(x, y) < 0 ||
+        impl->view.screenToGroundPlane(radiusX, radiusY) < 0) {
+        _onFeaturePickCallback(nullptr);
+        return;
+    }
+    double radius = glm::distance(glm::dvec2(x, y), glm::dvec2(radiusX, radiusY));
+    glm::dvec3 eye = impl->view.getPosition();
+    glm::dvec2 meters(x + eye.x, y + eye.y);
+
+    std::shared_ptr<Properties> properties;
+    uint32_t color = 0;
+    uint32_t order = 0;
+    int zoom = 0;
+    {
+        std::lock_guard<std::mutex> lock(impl->tilesMutex);
+
+        for (const auto& tile : impl->tileManager.getVisibleTiles()) {
+            auto* index = tile->getFeatureIndex();
+            if (!index) { continue; }
+
+            float tileRadius = radius * tile->getInverseScale();
+            glm::vec2 position = (meters - tile->getOrigin()) * double(tile->getInverseScale());
+            if (glm::any(glm::lessThan(position, glm::vec2(-tileRadius))) ||
+                glm::any(glm::greaterThan(position, glm::vec2(1.f + tileRadius)))) {
+                continue;
+            }
+
+            auto result = index->query(position, tileRadius);
+            if (result.color == 0) { continue; }
+
+            // Tiles of higher zoom levels are drawn over their proxies
+            int z = tile->getID().z;
+            if (properties && (result.order < order || (result.order == order && z <= zoom))) {
+                continue;
+            }
+            if (auto selected = tile->getSelectionFeature(result.color)) {
+                properties = selected;
+                color = result.color;
+                order = result.order;
+                zoom = z;
+            }
+        }
+    }
+
+    if (!properties) {
+        _onFeaturePickCallback(nullptr);
+        return;
+    }
+    FeaturePickResult result(properties, {{_x, _y}}, color);
+    _onFeaturePickCallback(&result);
+}
+
+bool Map::setFeatureState(uint32_t _id, const FeatureState& _state) {
+    if (_id == 0) { return false; }
+
+    if (!impl->scene->featureStates()->set(_id, _state)) {
+        LOGW("Feature state of %u not set, at most %d features have a state", _id,
+             int(FeatureStates::maxStates));
+        return false;
+    }
+    platform->requestRender();
+    return true;
+}
+
+void Map::clearFeatureState(uint32_t _id) {
+    if (impl->scene->featureStates()->clear(_id)) {
+        platform->requestRender();
+    }
+}
+
+void Map::clearFeatureStates() {
+    impl->scene->featureStates()->clearAll();
+    platform->requestRender();
+}
+
+bool Map::render() {
 
     // Do not render if any texture resources are in process of being downloaded
     if (impl->scene->pendingTextures > 0) {
-        return;
+        return false;
     }
 
     bool drawSelectionBuffer = getDebugFlag(DebugFlags::selection_buffer);
@@ -499,7 +1447,11 @@ void Map::render() {
     // Cache default framebuffer handle used for rendering
     impl->renderState.cacheDefaultFramebuffer();
 
-    FrameInfo::beginFrame();
+    auto renderStart = PerformanceMonitor::now();
+    float frameTime = std::chrono::duration<float, std::milli>(renderStart - impl->lastRenderStart).count();
+    impl->lastRenderStart = renderStart;
+
+    impl->renderState.resetFrameStats();
 
     // Invalidate render states for new frame
     if (!impl->cacheGlState) {
@@ -509,61 +1461,270 @@ void Map::render() {
     // Delete batch of gl resources
     impl->renderState.flushResourceDeletion();
 
+    // Deliver the snapshots read in earlier frames, and keep drawing for the
+    // requested ones
+    impl->snapshotReader.poll();
+    if (!impl->snapshotRequests.empty()) { impl->redrawAll = true; }
+    if (impl->snapshotReader.pending()) { impl->platform->requestRender(); }
+
+    if (impl->renderState.gpuTimer) { impl->renderState.gpuTimer->beginFrame(); }
+
+    // Labels placed since the last update are drawn already when they are done
+    impl->swapLabels();
+
     for (const auto& style : impl->scene->styles()) {
         style->onBeginFrame(impl->renderState);
     }
 
+    if (Hardware::supportsUniformBuffers) {
+        Style::setupFrameUniforms(impl->renderState, impl->view, *impl->scene);
+    }
+
+    // Upload meshes of newly built tiles within the per-frame budget.
+    // Uploaded tiles replace their proxies on the next update.
+    {
+        std::lock_guard<std::mutex> lock(impl->tilesMutex);
+
+        // Tiles that do not upload before the deadline of the frame stay queued
+        size_t uploadBudget = 0;
+        if (impl->framePacer.paced()) {
+            float drawTime = impl->performance.average(PerformanceMonitor::Timer::render) -
+                impl->performance.average(PerformanceMonitor::Timer::upload);
+            uploadBudget = impl->framePacer.uploadBytes(impl->framePacer.budget(drawTime));
+            impl->framePacer.endFrame();
+        }
+
+        auto uploadStart = PerformanceMonitor::now();
+        size_t uploaded = impl->tileManager.uploadTiles(impl->renderState, uploadBudget);
+        impl->performance.record(PerformanceMonitor::Timer::upload, uploadStart);
+        impl->framePacer.addUpload(uploaded, std::chrono::duration<float, std::milli>(
+            PerformanceMonitor::now() - uploadStart).count());
+        if (uploaded > 0 || impl->tileManager.hasPendingUploads()) {
+            platform->requestRender();
+        }
+        if (uploaded > 0) { impl->redrawAll = true; }
+    }
+
     // Render feature selection pass to offscreen framebuffer
     if (impl->selectionQueries.size() > 0 || drawSelectionBuffer) {
-        impl->selectionBuffer->applyAsRenderTarget(impl->renderState);
+
+        glm::vec2 queryMin(1.f), queryMax(0.f);
+        for (const auto& selectionQuery : impl->selectionQueries) {
+            glm::vec4 area = selectionQuery.area(impl->view);
+            queryMin = glm::min(queryMin, glm::vec2(area.x, area.y));
+            queryMax = glm::max(queryMax, glm::vec2(area.x + area.z, area.y + area.w));
+        }
+
+        glm::vec2 areaMin = queryMin, areaMax = queryMax;
+        if (drawSelectionBuffer) {
+            areaMin = glm::vec2(0.f);
+            areaMax = glm::vec2(1.f);
+        }
 
         std::lock_guard<std::mutex> lock(impl->tilesMutex);
 
-        for (const auto& style : impl->scene->styles()) {
+        bool reuse = impl->selectionBufferValid &&
+            glm::all(glm::greaterThanEqual(areaMin, impl->selectionAreaMin)) &&
+            glm::all(glm::lessThanEqual(areaMax, impl->selectionAreaMax));
+
+        if (reuse) {
+            impl->selectionBuffer->bind(impl->renderState);
+        } else {
+            // Keep the area that is still valid and draw only within the union
+            if (impl->selectionBufferValid) {
+                areaMin = glm::min(areaMin, impl->selectionAreaMin);
+                areaMax = glm::max(areaMax, impl->selectionAreaMax);
+            }
+            glm::vec2 size(impl->selectionBuffer->getWidth(), impl->selectionBuffer->getHeight());
+            glm::ivec2 min = glm::clamp(glm::floor(areaMin * size), glm::vec2(0.f), size);
+            glm::ivec2 max = glm::clamp(glm::ceil(areaMax * size), glm::vec2(0.f), size);
+
+            // Clear and draw only the area of the queries
+            GL::enable(GL_SCISSOR_TEST);
+            GL::scissor(min.x, min.y, max.x - min.x, max.y - min.y);
+
+            impl->selectionBuffer->applyAsRenderTarget(impl->renderState);
 
-            style->drawSelectionFrame(impl->renderState, impl->view, *(impl->scene),
-                                      impl->tileManager.getVisibleTiles(),
-                                      impl->markerManager.markers());
+            auto* gpuTimer = impl->renderState.gpuTimer;
+            if (gpuTimer) { gpuTimer->begin("selection"); }
+
+            for (const auto& style : impl->scene->styles()) {
+
+                style->drawSelectionFrame(impl->renderState, impl->view, *(impl->scene),
+                                          impl->tileManager.getVisibleTiles(),
+                                          impl->markerManager.markers());
+            }
+
+            if (gpuTimer) { gpuTimer->end(); }
+
+            GL::disable(GL_SCISSOR_TEST);
+
+            impl->selectionBufferValid = impl->selectionBuffer->valid();
+            impl->selectionAreaMin = areaMin;
+            impl->selectionAreaMax = areaMax;
         }
 
-        std::vector<SelectionColorRead> colorCache;
-        // Resolve feature selection queries
-        for (const auto& selectionQuery : impl->selectionQueries) {
-            selectionQuery.process(impl->view, *impl->selectionBuffer, impl->markerManager,
-                                   impl->tileManager, impl->labels, colorCache);
+        if (!impl->selectionQueries.empty()) {
+            impl->waitForLabels();
+
+            // Read the pixels of all queries at once, with a pixel of margin for
+            // the rounding of the query areas to pixels
+            auto& buffer = *impl->selectionBuffer;
+            glm::vec2 margin(1.f / buffer.getWidth(), 1.f / buffer.getHeight());
+            glm::vec2 readMin = queryMin - margin, readSize = queryMax - queryMin + 2.f * margin;
+            auto readback = buffer.readRect(readMin.x, readMin.y, readSize.x, readSize.y);
+
+            // Resolve feature selection queries
+            for (const auto& selectionQuery : impl->selectionQueries) {
+                selectionQuery.process(impl->view, buffer, readback, impl->markerManager,
+                                       impl->tileManager, impl->labels);
+            }
         }
 
         impl->selectionQueries.clear();
     }
 
-    // Setup default framebuffer for a new frame
+    // Debug views draw over the whole frame
+    if (g_flags.to_ulong() != impl->drawnDebugFlags || g_flags.any()) {
+        impl->drawnDebugFlags = g_flags.to_ulong();
+        impl->redrawAll = true;
+    }
+
+    bool drawOverdraw = getDebugFlag(DebugFlags::overdraw);
+
+    // Draw moving frames at a lower resolution while they are too slow
+    float renderScale = impl->dynamicResolution.update(frameTime, impl->view.changedOnLastUpdate());
+    bool scaled = renderScale < 1.f && !drawSelectionBuffer && !drawOverdraw;
+    if (!impl->dynamicResolution.enabled()) { impl->scaledBuffer.reset(); }
+
+    // Scaled frames are drawn whole, and replaced once the view stops
+    if (scaled || impl->scaledFrame) { impl->redrawAll = true; }
+
+    // The frame drawn before is still current
+    if (impl->idleFrameSkipping && !impl->hasDamage()) {
+        return false;
+    }
+
     glm::vec2 viewport(impl->view.getWidth(), impl->view.getHeight());
-    FrameBuffer::apply(impl->renderState, impl->renderState.defaultFrameBuffer(),
-                       viewport, impl->scene->background().toColorF());
+
+    // Clear and draw only the damaged area over the retained frame
+    bool scissor = impl->partialRedraw && !impl->redrawAll;
+    if (scissor) {
+        glm::ivec2 min = glm::clamp(glm::floor(impl->damageMin), glm::vec2(0.f), viewport);
+        glm::ivec2 max = glm::clamp(glm::ceil(impl->damageMax), glm::vec2(0.f), viewport);
+        GL::enable(GL_SCISSOR_TEST);
+        GL::scissor(min.x, int(viewport.y) - max.y, max.x - min.x, max.y - min.y);
+    }
+    impl->resetDamage();
+
+    // Setup default framebuffer for a new frame
+    if (!scaled) {
+        FrameBuffer::apply(impl->renderState, impl->renderState.defaultFrameBuffer(),
+                           viewport, impl->scene->background().toColorF());
+    }
 
     if (drawSelectionBuffer) {
-        impl->selectionBuffer->drawDebug(impl->renderState, viewport);
-        FrameInfo::draw(impl->renderState, impl->view, impl->tileManager);
-        return;
+        impl->selectionBuffer->draw(impl->renderState, viewport);
+        FrameInfo::draw(impl->renderState, impl->view, impl->tileManager, impl->performance);
+        impl->performance.record(PerformanceMonitor::Timer::render, renderStart);
+        return true;
+    }
+
+    if (drawOverdraw) {
+        // Count the fragments drawn to each pixel
+        GL::enable(GL_STENCIL_TEST);
+        GL::clear(GL_STENCIL_BUFFER_BIT);
+        GL::stencilFunc(GL_ALWAYS, 0, 0xFF);
+        GL::stencilOp(GL_KEEP, GL_KEEP, GL_INCR);
     }
 
     {
         std::lock_guard<std::mutex> lock(impl->tilesMutex);
 
-        // Loop over all styles
-        for (const auto& style : impl->scene->styles()) {
+        // Draw styles grouped by their render state
+        impl->renderQueue.prepare(impl->scene->styles());
+        if (scaled) {
+            impl->drawScaled(viewport, renderScale);
+        } else {
+            impl->renderQueue.draw(impl->renderState,
+                                   impl->view, *(impl->scene),
+                                   impl->tileManager.getVisibleTiles(),
+                                   impl->markerManager.markers());
+        }
+    }
+    impl->scaledFrame = scaled;
+
+    // Draw the view at full resolution when it stops
+    if (scaled) { impl->platform->requestRender(); }
 
-            style->draw(impl->renderState,
-                        impl->view, *(impl->scene),
-                        impl->tileManager.getVisibleTiles(),
-                        impl->markerManager.markers());
+    if (drawOverdraw) { impl->drawOverdraw(viewport); }
 
-        }
+    if (scissor) { GL::disable(GL_SCISSOR_TEST); }
+
+    // Draw the styles that wait for their programs once they are built
+    if (impl->renderState.frameStats().pendingPrograms > 0) {
+        impl->platform->requestRender();
+        impl->redrawAll = true;
     }
 
+    if (getDebugFlag(DebugFlags::labels)) { impl->waitForLabels(); }
     impl->labels.drawDebug(impl->renderState, impl->view);
 
-    FrameInfo::draw(impl->renderState, impl->view, impl->tileManager);
+    FrameInfo::draw(impl->renderState, impl->view, impl->tileManager, impl->performance);
+
+    if (!impl->snapshotRequests.empty()) { impl->readSnapshots(); }
+
+    impl->performance.record(PerformanceMonitor::Timer::render, renderStart);
+    return true;
+}
+
+void Map::Impl::readSnapshots() {
+
+    int width = view.getWidth();
+    int height = view.getHeight();
+
+    for (auto& request : snapshotRequests) {
+        // Clip to the viewport, GL reads from the lower left
+        int minX = std::max(request.x, 0);
+        int minY = std::max(request.y, 0);
+        int maxX = std::min(request.x + request.width, width);
+        int maxY = std::min(request.y + request.height, height);
+
+        snapshotReader.read(minX, height - maxY, maxX - minX, maxY - minY,
+                            request.downsample, std::move(request.callback));
+    }
+    snapshotRequests.clear();
+
+    if (snapshotReader.pending()) { platform->requestRender(); }
+}
+
+void Map::Impl::drawScaled(glm::vec2 _viewport, float _scale) {
+
+    ColorF background = scene->background().toColorF();
+    auto& tiles = tileManager.getVisibleTiles();
+    auto& markers = markerManager.markers();
+
+    glm::ivec2 size = glm::max(glm::ivec2(_viewport * _scale), glm::ivec2(1));
+    if (!scaledBuffer || scaledBuffer->getWidth() != size.x || scaledBuffer->getHeight() != size.y) {
+        scaledBuffer = std::make_unique<FrameBuffer>(size.x, size.y, false, GL_LINEAR);
+    }
+
+    if (!scaledBuffer->applyAsRenderTarget(renderState, background)) {
+        FrameBuffer::apply(renderState, renderState.defaultFrameBuffer(), _viewport, background);
+        renderQueue.draw(renderState, view, *scene, tiles, markers);
+        return;
+    }
+
+    auto pass = fullResolutionLabels ? RenderQueue::Pass::geometry : RenderQueue::Pass::all;
+    renderQueue.draw(renderState, view, *scene, tiles, markers, pass);
+
+    FrameBuffer::apply(renderState, renderState.defaultFrameBuffer(), _viewport, background);
+    renderState.blending(GL_FALSE);
+    scaledBuffer->draw(renderState, _viewport);
+
+    if (fullResolutionLabels) {
+        renderQueue.draw(renderState, view, *scene, tiles, markers, RenderQueue::Pass::labels);
+    }
 }
 
 int Map::getViewportHeight() {
@@ -582,6 +1743,20 @@ void Map::captureSnapshot(unsigned int* _data) {
     GL::readPixels(0, 0, impl->view.getWidth(), impl->view.getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)_data);
 }
 
+void Map::captureSnapshotAsync(SnapshotCallback _callback, int _downsample) {
+    captureSnapshotAsync(0, 0, std::numeric_limits<int>::max() / 2, std::numeric_limits<int>::max() / 2,
+                         std::move(_callback), _downsample);
+}
+
+void Map::captureSnapshotAsync(int _x, int _y, int _width, int _height,
+                               SnapshotCallback _callback, int _downsample) {
+    impl->jobQueue.add([this, _x, _y, _width, _height, _downsample, callback = std::move(_callback)]() {
+        impl->snapshotRequests.push_back({ _x, _y, _width, _height, _downsample, callback });
+        impl->redrawAll = true;
+    });
+    impl->platform->requestRender();
+}
+
 void Map::Impl::setPositionNow(double _lon, double _lat) {
 
     glm::dvec2 meters = view.getMapProjection().LonLatToMeters({ _lon, _lat});
@@ -593,6 +1768,8 @@ void Map::Impl::setPositionNow(double _lon, double _lat) {
 
 void Map::setPosition(double _lon, double _lat) {
 
+    impl->record("setPosition", _lon, _lat);
+
     impl->setPositionNow(_lon, _lat);
     impl->clearEase(EaseField::position);
 
@@ -600,6 +1777,8 @@ void Map::setPosition(double _lon, double _lat) {
 
 void Map::setPositionEased(double _lon, double _lat, float _duration, EaseType _e) {
 
+    impl->record("setPositionEased", _lon, _lat, _duration, int(_e));
+
     double lonStart, latStart;
     getPosition(lonStart, latStart);
 
@@ -634,6 +1813,8 @@ void Map::Impl::setZoomNow(float _z) {
 
 void Map::setZoom(float _z) {
 
+    impl->record("setZoom", _z);
+
     impl->setZoomNow(_z);
     impl->clearEase(EaseField::zoom);
 
@@ -641,6 +1822,8 @@ void Map::setZoom(float _z) {
 
 void Map::setZoomEased(float _z, float _duration, EaseType _e) {
 
+    impl->record("setZoomEased", _z, _duration, int(_e));
+
     float z_start = getZoom();
     auto cb = [=](float t) { impl->setZoomNow(ease(z_start, _z, t, _e)); };
     impl->setEase(EaseField::zoom, { _duration, cb });
@@ -649,6 +1832,8 @@ void Map::setZoomEased(float _z, float _duration, EaseType _e) {
 
 void Map::flyTo(double _lon, double _lat, float _z, float _duration, float _speed) {
 
+    impl->record("flyTo", _lon, _lat, _z, _duration, _speed);
+
     double lonStart = 0., latStart = 0.;
     getPosition(lonStart, latStart);
     float zStart = getZoom();
@@ -682,6 +1867,7 @@ void Map::flyTo(double _lon, double _lat, float _z, float _duration, float _spee
     float duration = _duration > 0 ? _duration : distance / _speed;
 
     impl->setEase(EaseField::zoom, { duration, cb });
+    impl->flyToPath = fn;
 
 }
 
@@ -700,6 +1886,8 @@ void Map::Impl::setRotationNow(float _radians) {
 
 void Map::setRotation(float _radians) {
 
+    impl->record("setRotation", _radians);
+
     impl->setRotationNow(_radians);
     impl->clearEase(EaseField::rotation);
 
@@ -707,6 +1895,8 @@ void Map::setRotation(float _radians) {
 
 void Map::setRotationEased(float _radians, float _duration, EaseType _e) {
 
+    impl->record("setRotationEased", _radians, _duration, int(_e));
+
     float radians_start = getRotation();
 
     // Ease over the smallest angular distance needed
@@ -735,6 +1925,8 @@ void Map::Impl::setTiltNow(float _radians) {
 
 void Map::setTilt(float _radians) {
 
+    impl->record("setTilt", _radians);
+
     impl->setTiltNow(_radians);
     impl->clearEase(EaseField::tilt);
 
@@ -742,6 +1934,8 @@ void Map::setTilt(float _radians) {
 
 void Map::setTiltEased(float _radians, float _duration, EaseType _e) {
 
+    impl->record("setTiltEased", _radians, _duration, int(_e));
+
     float tilt_start = getTilt();
     auto cb = [=](float t) { impl->setTiltNow(ease(tilt_start, _radians, t, _e)); };
     impl->setEase(EaseField::tilt, { _duration, cb });
@@ -783,13 +1977,15 @@ bool Map::lngLatToScreenPosition(double _lng, double _lat, double* _x, double* _
 
 void Map::setPixelScale(float _pixelsPerPoint) {
 
+    impl->record("setPixelScale", _pixelsPerPoint);
+
     impl->setPixelScale(_pixelsPerPoint);
 
 }
 
 void Map::Impl::setPixelScale(float _pixelsPerPoint) {
 
-    // If the pixel scale changes we need to re-build all the tiles.
+    // If the pixel scale changes we need to re-build the labels of all tiles.
     // This is expensive, so first check whether the new value is different.
     if (_pixelsPerPoint == view.pixelScale()) {
         // Nothing to do!
@@ -798,8 +1994,10 @@ void Map::Impl::setPixelScale(float _pixelsPerPoint) {
     view.setPixelScale(_pixelsPerPoint);
     scene->setPixelScale(_pixelsPerPoint);
 
-    // Tiles must be rebuilt to apply the new pixel scale to labels.
-    tileManager.clearTileSets();
+    // Lines and polygons are scaled by u_device_pixel_ratio, only labels
+    // must be rebuilt to apply the new pixel scale. The current tiles stay
+    // shown until then.
+    tileManager.rebuildLabels();
 
     // Markers must be rebuilt to apply the new pixel scale.
     markerManager.rebuildAll();
@@ -807,6 +2005,8 @@ void Map::Impl::setPixelScale(float _pixelsPerPoint) {
 
 void Map::setCameraType(int _type) {
 
+    impl->record("setCameraType", _type);
+
     impl->view.setCameraType(static_cast<CameraType>(_type));
     platform->requestRender();
 
@@ -819,16 +2019,19 @@ int Map::getCameraType() {
 }
 
 void Map::addTileSource(std::shared_ptr<TileSource> _source) {
+    impl->waitForLabels();
     std::lock_guard<std::mutex> lock(impl->tilesMutex);
     impl->tileManager.addClientTileSource(_source);
 }
 
 bool Map::removeTileSource(TileSource& source) {
+    impl->waitForLabels();
     std::lock_guard<std::mutex> lock(impl->tilesMutex);
     return impl->tileManager.removeClientTileSource(source);
 }
 
 void Map::clearTileSource(TileSource& _source, bool _data, bool _tiles) {
+    impl->waitForLabels();
     std::lock_guard<std::mutex> lock(impl->tilesMutex);
 
     if (_tiles) { impl->tileManager.clearTileSet(_source.id()); }
@@ -838,112 +2041,145 @@ void Map::clearTileSource(TileSource& _source, bool _data, bool _tiles) {
 }
 
 MarkerID Map::markerAdd() {
+    impl->waitForLabels();
     return impl->markerManager.add();
 }
 
 bool Map::markerRemove(MarkerID _marker) {
+    impl->waitForLabels();
     bool success = impl->markerManager.remove(_marker);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetPoint(MarkerID _marker, LngLat _lngLat) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setPoint(_marker, _lngLat);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetPointEased(MarkerID _marker, LngLat _lngLat, float _duration, EaseType ease) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setPointEased(_marker, _lngLat, _duration, ease);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetPolyline(MarkerID _marker, LngLat* _coordinates, int _count) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setPolyline(_marker, _coordinates, _count);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetPolygon(MarkerID _marker, LngLat* _coordinates, int* _counts, int _rings) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setPolygon(_marker, _coordinates, _counts, _rings);
     platform->requestRender();
     return success;
 }
 
+bool Map::markerSetPoints(MarkerID _marker, const LngLat* _coordinates, int _count) {
+    impl->waitForLabels();
+    bool success = impl->markerManager.setPoints(_marker, _coordinates, _count);
+    platform->requestRender();
+    return success;
+}
+
 bool Map::markerSetStylingFromString(MarkerID _marker, const char* _styling) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setStylingFromString(_marker, _styling);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetStylingFromPath(MarkerID _marker, const char* _path) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setStylingFromPath(_marker, _path);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetBitmap(MarkerID _marker, int _width, int _height, const unsigned int* _data) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setBitmap(_marker, _width, _height, _data);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetVisible(MarkerID _marker, bool _visible) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setVisible(_marker, _visible);
     platform->requestRender();
     return success;
 }
 
 bool Map::markerSetDrawOrder(MarkerID _marker, int _drawOrder) {
+    impl->waitForLabels();
     bool success = impl->markerManager.setDrawOrder(_marker, _drawOrder);
     platform->requestRender();
     return success;
 }
 
 void Map::markerRemoveAll() {
+    impl->waitForLabels();
     impl->markerManager.removeAll();
     platform->requestRender();
 }
 
 void Map::handleTapGesture(float _posX, float _posY) {
 
+    impl->record("handleTapGesture", _posX, _posY);
+
     impl->inputHandler.handleTapGesture(_posX, _posY);
 
 }
 
 void Map::handleDoubleTapGesture(float _posX, float _posY) {
 
+    impl->record("handleDoubleTapGesture", _posX, _posY);
+
     impl->inputHandler.handleDoubleTapGesture(_posX, _posY);
 
 }
 
 void Map::handlePanGesture(float _startX, float _startY, float _endX, float _endY) {
 
+    impl->record("handlePanGesture", _startX, _startY, _endX, _endY);
+
     impl->inputHandler.handlePanGesture(_startX, _startY, _endX, _endY);
 
 }
 
 void Map::handleFlingGesture(float _posX, float _posY, float _velocityX, float _velocityY) {
 
+    impl->record("handleFlingGesture", _posX, _posY, _velocityX, _velocityY);
+
     impl->inputHandler.handleFlingGesture(_posX, _posY, _velocityX, _velocityY);
 
 }
 
 void Map::handlePinchGesture(float _posX, float _posY, float _scale, float _velocity) {
 
+    impl->record("handlePinchGesture", _posX, _posY, _scale, _velocity);
+
     impl->inputHandler.handlePinchGesture(_posX, _posY, _scale, _velocity);
 
 }
 
 void Map::handleRotateGesture(float _posX, float _posY, float _radians) {
 
+    impl->record("handleRotateGesture", _posX, _posY, _radians);
+
     impl->inputHandler.handleRotateGesture(_posX, _posY, _radians);
 
 }
 
 void Map::handleShoveGesture(float _distance) {
 
+    impl->record("handleShoveGesture", _distance);
+
     impl->inputHandler.handleShoveGesture(_distance);
 
 }
@@ -953,7 +2189,10 @@ void Map::setupGL() {
     LOG("setup GL");
 
     impl->renderState.invalidate();
+    impl->snapshotReader.invalidate();
+    impl->redrawAll = true;
 
+    impl->waitForLabels();
     impl->tileManager.clearTileSets();
 
     impl->markerManager.rebuildAll();
@@ -962,6 +2201,8 @@ void Map::setupGL() {
         impl->selectionBuffer = std::make_unique<FrameBuffer>(impl->selectionBuffer->getWidth(),
                                                               impl->selectionBuffer->getHeight());
     }
+    impl->selectionBufferValid = false;
+    impl->scaledBuffer.reset();
 
     // Set default primitive render color
     Primitives::setColor(impl->renderState, 0xffffff);
@@ -985,15 +2226,101 @@ void Map::runAsyncTask(std::function<void()> _task) {
 
 void Map::onMemoryWarning() {
 
-    impl->tileManager.clearTileSets(true);
+    releaseMemory(MemoryPressure::critical);
+}
+
+MemoryRelease Map::Impl::releaseMemory(uint64_t _bytes) {
+
+    MemoryRelease release;
+
+    auto remaining = [&]() {
+        uint64_t freed = release.total();
+        return size_t(std::min<uint64_t>(_bytes > freed ? _bytes - freed : 0,
+                                         std::numeric_limits<size_t>::max()));
+    };
+
+    waitForLabels();
+
+    auto scene = this->scene;
+    {
+        std::lock_guard<std::mutex> lock(tilesMutex);
+
+        if (scene) {
+            for (auto& source : scene->tileSources()) {
+                if (remaining() == 0) { break; }
+                release.rawCache += source->releaseCachedData(remaining());
+            }
+        }
+        if (remaining() > 0) {
+            release.tileCache = tileManager.releaseCachedTiles(view, remaining());
+        }
+    }
+
+    if (remaining() > 0 && scene && scene->fontContext()) {
+        release.fonts = scene->fontContext()->releaseUnusedAtlases();
+    }
 
-    if (impl->scene && impl->scene->fontContext()) {
-        impl->scene->fontContext()->releaseFonts();
+    if (remaining() > 0 && scene) {
+        std::lock_guard<std::mutex> lock(tilesMutex);
+        for (auto& source : scene->tileSources()) {
+            release.rasters += source->releaseUnusedRasters();
+        }
     }
+
+    LOG("Released %lluKB: raw tiles %lluKB, cache %lluKB, fonts %lluKB, rasters %lluKB",
+        (unsigned long long)release.total() / 1024, (unsigned long long)release.rawCache / 1024,
+        (unsigned long long)release.tileCache / 1024, (unsigned long long)release.fonts / 1024,
+        (unsigned long long)release.rasters / 1024);
+
+    return release;
+}
+
+MemoryRelease Map::releaseMemory(MemoryPressure _pressure) {
+
+    uint64_t bytes = std::numeric_limits<uint64_t>::max();
+
+    if (_pressure == MemoryPressure::moderate) {
+        // Half of what the releasable categories currently hold
+        auto stats = getMemoryStats();
+        bytes = (stats.rawCache.total() + stats.tileCache.total() +
+                 stats.fonts.total() + stats.rasters.total()) / 2;
+    } else {
+        StyleContext::requestGarbageCollection();
+    }
+
+    return impl->releaseMemory(bytes);
+}
+
+MemoryRelease Map::releaseMemory(uint64_t _bytes) {
+
+    uint64_t total = getMemoryStats().total().total();
+    if (total <= _bytes) { return {}; }
+
+    return impl->releaseMemory(total - _bytes);
 }
 
 void Map::setDefaultBackgroundColor(float r, float g, float b) {
     impl->renderState.defaultOpaqueClearColor(r, g, b);
+    impl->redrawAll = true;
+}
+
+bool Map::isIdle() const {
+    return impl->idle;
+}
+
+void Map::setIdleFrameSkipping(bool _enabled) {
+    impl->idleFrameSkipping = _enabled;
+    impl->redrawAll = true;
+}
+
+void Map::setPartialRedraw(bool _enabled) {
+    impl->partialRedraw = _enabled;
+    impl->redrawAll = true;
+}
+
+void Map::setDynamicResolution(float _minScale, float _targetFrameTime, bool _fullResolutionLabels) {
+    impl->dynamicResolution.setLimits(_minScale, _targetFrameTime);
+    impl->fullResolutionLabels = _fullResolutionLabels;
 }
 
 void setDebugFlag(DebugFlags _flag, bool _on) {
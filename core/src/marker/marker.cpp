@@ -41,6 +41,7 @@ bool Marker::evaluateRuleForContext(StyleContext& ctx) {
 void Marker::setDrawRuleData(std::unique_ptr<DrawRuleData> drawRuleData) {
     m_drawRuleData = std::move(drawRuleData);
     m_drawRule = std::make_unique<DrawRule>(*m_drawRuleData, "", 0);
+    m_drawRuleSet->resetZoomDependent();
 }
 
 void Marker::mergeRules(const SceneLayer& layer) {
@@ -52,6 +53,7 @@ bool Marker::finalizeRuleMergingForName(const std::string& name) {
     for (auto& rule : m_drawRuleSet->matchedRules()) {
         if (name == *rule.name) {
             m_drawRule = std::make_unique<DrawRule>(rule);
+            m_drawRuleSet->resetZoomDependent();
             found = true;
             break;
         }
@@ -82,7 +84,7 @@ void Marker::clearMesh() {
     m_mesh.reset();
 }
 
-void Marker::setTexture(std::unique_ptr<Texture> texture) {
+void Marker::setTexture(std::shared_ptr<Texture> texture) {
     m_texture = std::move(texture);
 }
 
@@ -93,14 +95,23 @@ void Marker::setEase(const glm::dvec2& dest, float duration, EaseType e) {
 }
 
 void Marker::update(float dt, const View& view) {
-    // Update easing
-    if (!m_ease.finished()) { m_ease.update(dt); }
+    updateEase(dt);
     // Apply marker-view translation to the model matrix
-    const auto& viewOrigin = view.getPosition();
-    m_modelMatrix[3][0] = m_origin.x - viewOrigin.x;
-    m_modelMatrix[3][1] = m_origin.y - viewOrigin.y;
+    auto translation = view.getRelativeToEye(m_origin);
+    m_modelMatrix[3][0] = translation.x;
+    m_modelMatrix[3][1] = translation.y;
+
+    m_modelViewProjectionMatrix = view.getModelViewProjection(m_modelMatrix);
+}
+
+void Marker::updateEase(float dt) {
+    if (!m_ease.finished()) { m_ease.update(dt); }
+}
 
-    m_modelViewProjectionMatrix = view.getViewProjectionMatrix() * m_modelMatrix;
+void Marker::setTransform(const glm::vec2& translation, const glm::mat4& modelViewProjection) {
+    m_modelMatrix[3][0] = translation.x;
+    m_modelMatrix[3][1] = translation.y;
+    m_modelViewProjectionMatrix = modelViewProjection;
 }
 
 void Marker::setVisible(bool visible) {
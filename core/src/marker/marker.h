@@ -65,7 +65,8 @@ public:
 
     void clearMesh();
 
-    void setTexture(std::unique_ptr<Texture> texture);
+    // Set the bitmap texture of the marker, markers with the same bitmap share it.
+    void setTexture(std::shared_ptr<Texture> texture);
 
     // Set an ease for the origin of this marker in Mercator meters.
     void setEase(const glm::dvec2& destination, float duration, EaseType ease);
@@ -75,6 +76,13 @@ public:
     // Set the model matrix for the marker using the current view and update any eases.
     void update(float dt, const View& view);
 
+    // Update any eases, the transform is then set with setTransform.
+    void updateEase(float dt);
+
+    // Set the translation of the model matrix and the model-view-projection matrix,
+    // computed for all markers at once by ModelTransforms.
+    void setTransform(const glm::vec2& translation, const glm::mat4& modelViewProjection);
+
     // Set whether this marker should be visible.
     void setVisible(bool visible);
 
@@ -135,7 +143,7 @@ protected:
 
     std::unique_ptr<Feature> m_feature;
     std::unique_ptr<StyledMesh> m_mesh;
-    std::unique_ptr<Texture> m_texture;
+    std::shared_ptr<Texture> m_texture;
     std::unique_ptr<DrawRuleMergeSet> m_drawRuleSet;
     std::unique_ptr<DrawRuleData> m_drawRuleData;
     std::unique_ptr<DrawRule> m_drawRule;
@@ -11,12 +11,114 @@
 #include "labels/labelSet.h"
 #include "log.h"
 #include "selection/featureSelection.h"
+#include "util/asyncWorker.h"
+#include "util/mapProjection.h"
 
 #include <algorithm>
+#include <cmath>
+#include <mutex>
 
 namespace Tangram {
 
-MarkerManager::MarkerManager() {}
+static const size_t MAX_STYLING_PARAMS = 256;
+
+// FNV-1a of the size and pixels of a marker bitmap
+static uint64_t bitmapHash(int _width, int _height, const unsigned int* _data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&](uint32_t _value) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (_value >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    };
+    mix(uint32_t(_width));
+    mix(uint32_t(_height));
+    for (size_t i = 0, n = size_t(_width) * size_t(_height); i < n; i++) { mix(_data[i]); }
+    return hash;
+}
+
+// Draw rule of a batch evaluated on the main thread, owning copies of the evaluated parameters
+struct MarkerManager::BatchJob {
+    MarkerID markerID;
+    uint32_t generation;
+    int zoom;
+    std::string styleName;
+    std::unique_ptr<DrawRuleData> ruleData;
+    bool isOutlineOnly;
+    uint32_t selectionColor;
+    FeatureSelection* featureSelection;
+    std::vector<glm::dvec2> points;
+    BoundingBox bounds;
+};
+
+struct MarkerManager::BatchResult {
+    MarkerID markerID;
+    uint32_t generation;
+    int zoom;
+    uint32_t styleId;
+    uint32_t selectionColor;
+    BoundingBox bounds;
+    std::unique_ptr<StyledMesh> mesh;
+};
+
+// StyleBuilders of the batch worker thread, shared with the jobs so a scene
+// stays alive until its last job finished
+struct MarkerManager::BatchBuilder {
+    std::shared_ptr<Platform> platform;
+    std::shared_ptr<Scene> scene;
+    fastmap<std::string, std::unique_ptr<StyleBuilder>> styleBuilders;
+
+    std::mutex mutex;
+    // Latest generation enqueued for each batch, superseded jobs are skipped
+    std::unordered_map<MarkerID, uint32_t> latest;
+    std::vector<BatchResult> results;
+
+    void build(BatchJob& job);
+};
+
+void MarkerManager::BatchBuilder::build(BatchJob& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = latest.find(job.markerID);
+        if (it == latest.end() || it->second != job.generation) { return; }
+    }
+
+    auto it = styleBuilders.find(job.styleName);
+    if (it == styleBuilders.end()) { return; }
+    auto& styler = *it->second;
+
+    DrawRule rule(*job.ruleData, "", 0);
+    rule.isOutlineOnly = job.isOutlineOnly;
+    rule.selectionColor = job.selectionColor;
+    rule.featureSelection = job.featureSelection;
+
+    // Points are relative to the batch origin in units of a tile at the zoom level, like
+    // the single point of a marker relative to its position (see Marker::setMesh)
+    Feature feature;
+    feature.geometryType = GeometryType::points;
+    double scale = std::exp2(job.zoom) / (MapProjection::HALF_CIRCUMFERENCE * 2);
+    auto origin = job.bounds.min;
+    for (const auto& point : job.points) {
+        feature.points.emplace_back((point.x - origin.x) * scale, (point.y - origin.y) * scale);
+    }
+
+    Marker marker(job.markerID);
+    styler.setup(marker, job.zoom);
+
+    std::unique_ptr<StyledMesh> mesh;
+    if (styler.addFeature(feature, rule)) {
+        mesh = styler.build();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back({ job.markerID, job.generation, job.zoom, styler.style().getID(),
+                            job.selectionColor, job.bounds, std::move(mesh) });
+    }
+    platform->requestRender();
+}
+
+MarkerManager::MarkerManager(std::shared_ptr<Platform> platform) : m_platform(platform) {}
 
 MarkerManager::~MarkerManager() {}
 
@@ -28,24 +130,38 @@ void MarkerManager::setScene(std::shared_ptr<Scene> scene) {
     m_styleContext = std::make_unique<StyleContext>();
     m_styleContext->initFunctions(*scene);
 
+    // Parsed params refer to functions and stops of the previous scene
+    m_stylingParams.clear();
+
     // Initialize StyleBuilders.
     m_styleBuilders.clear();
     for (auto& style : scene->styles()) {
         m_styleBuilders[style->getName()] = style->createBuilder();
     }
 
+    // Batches of the previous scene still building are dropped with their builder.
+    m_batchBuilder = std::make_shared<BatchBuilder>();
+    m_batchBuilder->platform = m_platform;
+    m_batchBuilder->scene = scene;
+    for (auto& style : scene->styles()) {
+        m_batchBuilder->styleBuilders[style->getName()] = style->createBuilder();
+    }
+
     removeAll();
 }
 
 MarkerID MarkerManager::add() {
     m_dirty = true;
 
-    // Add a new empty marker object to the list of markers.
+    // Add a new empty marker object to the list of markers, after the
+    // markers of the same draw order.
     auto id = ++m_idCounter;
-    m_markers.push_back(std::make_unique<Marker>(id));
+    auto marker = std::make_unique<Marker>(id);
+    auto it = std::upper_bound(m_markers.begin(), m_markers.end(), marker, Marker::compareByDrawOrder);
+    size_t slot = it - m_markers.begin();
+    m_markers.insert(it, std::move(marker));
 
-    // Sort the marker list by draw order.
-    std::stable_sort(m_markers.begin(), m_markers.end(), Marker::compareByDrawOrder);
+    updateSlots(slot, m_markers.size());
 
     // Return a handle for the marker.
     return id;
@@ -55,13 +171,16 @@ MarkerID MarkerManager::add() {
 bool MarkerManager::remove(MarkerID markerID) {
     m_dirty = true;
 
-    for (auto it = m_markers.begin(), end = m_markers.end(); it != end; ++it) {
-        if (it->get()->id() == markerID) {
-            m_markers.erase(it);
-            return true;
-        }
-    }
-    return false;
+    auto entry = m_markerSlots.find(markerID);
+    if (entry == m_markerSlots.end()) { return false; }
+
+    size_t slot = entry->second;
+    m_markerSlots.erase(entry);
+    m_markers.erase(m_markers.begin() + slot);
+    m_batches.erase(markerID);
+
+    updateSlots(slot, m_markers.size());
+    return true;
 }
 
 bool MarkerManager::setStyling(MarkerID markerID, const char* styling, bool isPath) {
@@ -87,13 +206,31 @@ bool MarkerManager::setBitmap(MarkerID markerID, int width, int height, const un
 
     m_dirty = true;
 
-    TextureOptions options = { GL_RGBA, GL_RGBA, { GL_LINEAR, GL_LINEAR }, { GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE } };
-    auto texture = std::make_unique<Texture>(width, height, options);
     unsigned int size = width * height;
-    texture->setData(bitmapData, size);
+
+    // Fleets of markers with the same icon use one texture
+    uint64_t hash = bitmapHash(width, height, bitmapData);
+    auto& entry = m_bitmapTextures[hash];
+    auto texture = entry.lock();
+
+    if (!texture || int(texture->getWidth()) != width || int(texture->getHeight()) != height) {
+        TextureOptions options = { GL_RGBA, GL_RGBA, { GL_LINEAR, GL_LINEAR }, { GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE } };
+        texture = std::make_shared<Texture>(width, height, options);
+        texture->setData(bitmapData, size);
+        entry = texture;
+    }
 
     marker->setTexture(std::move(texture));
 
+    // Forget bitmaps of which no marker is left
+    for (auto it = m_bitmapTextures.begin(); it != m_bitmapTextures.end();) {
+        if (it->second.expired()) {
+            it = m_bitmapTextures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
     // The geometry is unchanged, but the mesh must be rebuilt because DynamicQuadMesh contains
     // texture batches as part of its data.
     buildMesh(*marker, m_zoom);
@@ -117,10 +254,29 @@ bool MarkerManager::setDrawOrder(MarkerID markerID, int drawOrder) {
 
     m_dirty = true;
 
+    int previousOrder = marker->drawOrder();
+    if (drawOrder == previousOrder) { return true; }
+
+    size_t slot = m_markerSlots[markerID];
     marker->setDrawOrder(drawOrder);
 
-    // Sort the marker list by draw order.
-    std::stable_sort(m_markers.begin(), m_markers.end(), Marker::compareByDrawOrder);
+    // Move the marker to its new slot instead of sorting the list again. The list is
+    // ordered as by a stable sort: a marker moved up goes before the markers of its new
+    // draw order, moved down it goes after them.
+    auto begin = m_markers.begin();
+    if (drawOrder > previousOrder) {
+        auto target = std::lower_bound(begin + slot + 1, m_markers.end(), m_markers[slot],
+                                       Marker::compareByDrawOrder);
+        auto last = target - begin - 1;
+        std::rotate(begin + slot, begin + slot + 1, target);
+        updateSlots(slot, last + 1);
+    } else {
+        auto target = std::upper_bound(begin, begin + slot, m_markers[slot],
+                                       Marker::compareByDrawOrder);
+        auto first = target - begin;
+        std::rotate(target, begin + slot, begin + slot + 1);
+        updateSlots(first, slot + 1);
+    }
     return true;
 }
 
@@ -135,8 +291,11 @@ bool MarkerManager::setPoint(MarkerID markerID, LngLat lngLat) {
 
     marker->clearMesh();
 
+    // A batch keeps a 'point' feature without points, so the feature is replaced.
+    bool wasBatch = m_batches.erase(markerID) > 0;
+
     // If the marker does not have a 'point' feature mesh built, build it.
-    if (!marker->mesh() || !marker->feature() || marker->feature()->geometryType != GeometryType::points) {
+    if (wasBatch || !marker->mesh() || !marker->feature() || marker->feature()->geometryType != GeometryType::points) {
         auto feature = std::make_unique<Feature>();
         feature->geometryType = GeometryType::points;
         feature->points.emplace_back();
@@ -161,7 +320,7 @@ bool MarkerManager::setPointEased(MarkerID markerID, LngLat lngLat, float durati
     m_dirty = true;
 
     // If the marker does not have a 'point' feature built, set that point immediately.
-    if (!marker->mesh() || !marker->feature() || marker->feature()->geometryType != GeometryType::points) {
+    if (m_batches.count(markerID) || !marker->mesh() || !marker->feature() || marker->feature()->geometryType != GeometryType::points) {
         return setPoint(markerID, lngLat);
     }
 
@@ -181,6 +340,7 @@ bool MarkerManager::setPolyline(MarkerID markerID, LngLat* coordinates, int coun
     m_dirty = true;
 
     marker->clearMesh();
+    m_batches.erase(markerID);
 
     if (!coordinates || count < 2) { return false; }
 
@@ -207,11 +367,13 @@ bool MarkerManager::setPolyline(MarkerID markerID, LngLat* coordinates, int coun
 
     // Project and offset the coordinates into the marker-local coordinate system.
     auto origin = marker->origin(); // SW corner.
+    std::vector<glm::dvec2> degrees;
+    degrees.reserve(count);
     for (int i = 0; i < count; ++i) {
-        auto degrees = glm::dvec2(coordinates[i].longitude, coordinates[i].latitude);
-        auto meters = m_mapProjection->LonLatToMeters(degrees);
-        line.emplace_back((meters.x - origin.x) * scale, (meters.y - origin.y) * scale);
+        degrees.emplace_back(coordinates[i].longitude, coordinates[i].latitude);
     }
+    line.resize(count);
+    m_mapProjection->LonLatToLocal(degrees.data(), line.data(), count, origin, scale);
 
     // Update the feature data for the marker.
     marker->setFeature(std::move(feature));
@@ -232,6 +394,7 @@ bool MarkerManager::setPolygon(MarkerID markerID, LngLat* coordinates, int* coun
     m_dirty = true;
 
     marker->clearMesh();
+    m_batches.erase(markerID);
 
     if (!coordinates || !counts || rings < 1) { return false; }
 
@@ -265,16 +428,18 @@ bool MarkerManager::setPolygon(MarkerID markerID, LngLat* coordinates, int* coun
 
     // Project and offset the coordinates into the marker-local coordinate system.
     auto origin = marker->origin(); // SW corner.
+    std::vector<glm::dvec2> degrees;
     ring = coordinates;
     for (int i = 0; i < rings; ++i) {
         int count = counts[i];
         polygon.emplace_back();
         auto& line = polygon.back();
+        degrees.clear();
         for (int j = 0; j < count; ++j) {
-            auto degrees = glm::dvec2(ring[j].longitude, ring[j].latitude);
-            auto meters = m_mapProjection->LonLatToMeters(degrees);
-            line.emplace_back((meters.x - origin.x) * scale, (meters.y - origin.y) * scale);
+            degrees.emplace_back(ring[j].longitude, ring[j].latitude);
         }
+        line.resize(count);
+        m_mapProjection->LonLatToLocal(degrees.data(), line.data(), count, origin, scale);
         ring += count;
     }
 
@@ -287,33 +452,103 @@ bool MarkerManager::setPolygon(MarkerID markerID, LngLat* coordinates, int* coun
     return true;
 }
 
+bool MarkerManager::setPoints(MarkerID markerID, const LngLat* coordinates, int count) {
+
+    if (!m_scene) { return false; }
+
+    Marker* marker = getMarkerOrNull(markerID);
+    if (!marker) { return false; }
+
+    m_dirty = true;
+
+    auto& batch = m_batches[markerID];
+    batch.points.clear();
+    batch.zoom = -1;
+
+    if (!coordinates || count < 1) {
+        marker->clearMesh();
+        return false;
+    }
+
+    // Project the points in place and determine their bounds.
+    auto& points = batch.points;
+    points.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        points.emplace_back(coordinates[i].longitude, coordinates[i].latitude);
+    }
+    m_mapProjection->LonLatToMeters(points.data(), points.data(), count);
+
+    BoundingBox bounds;
+    bounds.min = points[0];
+    bounds.max = points[0];
+    for (auto& meters : points) {
+        bounds.expand(meters.x, meters.y);
+    }
+
+    // The mesh of the previous points is drawn at their bounds until the new one is built.
+    batch.bounds = bounds;
+
+    // The feature only marks the geometry type, the points are built from the batch.
+    if (!marker->feature() || marker->feature()->geometryType != GeometryType::points ||
+        !marker->feature()->points.empty()) {
+        auto feature = std::make_unique<Feature>();
+        feature->geometryType = GeometryType::points;
+        marker->setFeature(std::move(feature));
+    }
+
+    buildBatch(*marker, batch, m_zoom);
+
+    return true;
+}
+
 bool MarkerManager::update(const View& _view, float _dt) {
 
     m_zoom = _view.getZoom();
 
-    bool rebuilt = false;
+    bool rebuilt = applyBatchResults();
     bool easing = false;
     bool dirty = m_dirty;
     m_dirty = false;
+    m_transforms.clear();
 
     for (auto& marker : m_markers) {
 
-        if (m_zoom != marker->builtZoomLevel()) {
+        auto batch = m_batches.find(marker->id());
+        if (batch != m_batches.end()) {
+            // The mesh for the last zoom is drawn until the batch is rebuilt.
+            if (m_zoom != batch->second.zoom) {
+                buildBatch(*marker, batch->second, m_zoom);
+            }
+        } else if (m_zoom != marker->builtZoomLevel()) {
             buildMesh(*marker, m_zoom);
             rebuilt = true;
         }
 
-        marker->update(_dt, _view);
+        bool wasEasing = marker->isEasing();
+        marker->updateEase(_dt);
         easing |= marker->isEasing();
+        m_transforms.add(marker->origin(), marker->modelMatrix()[0][0]);
+
+        // Labels are placed again once a marker reached its destination.
+        dirty |= wasEasing && !marker->isEasing();
     }
 
-    return rebuilt || easing || dirty;
+    m_transforms.update(_view);
+    for (size_t i = 0; i < m_markers.size(); i++) {
+        m_markers[i]->setTransform(m_transforms.translation(i), m_transforms.mvp(i));
+    }
+
+    m_easing = easing;
+
+    return rebuilt || dirty;
 }
 
 void MarkerManager::removeAll() {
     m_dirty = true;
 
     m_markers.clear();
+    m_markerSlots.clear();
+    m_batches.clear();
 
 }
 
@@ -386,6 +621,13 @@ bool MarkerManager::buildStyling(Marker& marker) {
         return marker.finalizeRuleMergingForName(path.substr(start, end - start));
     }
 
+    // Markers are restyled often with the same few strings
+    auto cached = m_stylingParams.find(markerStyling.string);
+    if (cached != m_stylingParams.end()) {
+        marker.setDrawRuleData(std::make_unique<DrawRuleData>("", 0, cached->second));
+        return true;
+    }
+
     std::vector<StyleParam> params;
 
     // If the styling is not a path, try to load it as a string of YAML.
@@ -405,18 +647,18 @@ bool MarkerManager::buildStyling(Marker& marker) {
         m_styleContext->addFunction(sceneJsFnList[i]);
     }
 
+    if (m_stylingParams.size() >= MAX_STYLING_PARAMS) { m_stylingParams.clear(); }
+    m_stylingParams.emplace(markerStyling.string, params);
+
     marker.setDrawRuleData(std::make_unique<DrawRuleData>("", 0, std::move(params)));
 
     return true;
 }
 
-bool MarkerManager::buildMesh(Marker& marker, int zoom) {
-
-    marker.clearMesh();
+StyleBuilder* MarkerManager::evaluateRule(Marker& marker, int zoom) {
 
-    auto feature = marker.feature();
     auto rule = marker.drawRule();
-    if (!feature || !rule) { return false; }
+    if (!rule) { return nullptr; }
 
     StyleBuilder* styler = nullptr;
     {
@@ -426,7 +668,7 @@ bool MarkerManager::buildMesh(Marker& marker, int zoom) {
             styler = it->second.get();
         } else {
             LOGN("Invalid style %s", name.c_str());
-            return false;
+            return nullptr;
         }
     }
 
@@ -437,9 +679,7 @@ bool MarkerManager::buildMesh(Marker& marker, int zoom) {
 
     bool valid = marker.evaluateRuleForContext(*m_styleContext);
 
-    if (!valid) { return false; }
-
-    styler->setup(marker, zoom);
+    if (!valid) { return nullptr; }
 
     uint32_t selectionColor = 0;
     bool interactive = false;
@@ -452,14 +692,112 @@ bool MarkerManager::buildMesh(Marker& marker, int zoom) {
         rule->selectionColor = 0;
     }
 
+    return styler;
+}
+
+bool MarkerManager::buildMesh(Marker& marker, int zoom) {
+
+    auto batch = m_batches.find(marker.id());
+    if (batch != m_batches.end()) {
+        return buildBatch(marker, batch->second, zoom);
+    }
+
+    marker.clearMesh();
+
+    auto feature = marker.feature();
+    if (!feature) { return false; }
+
+    StyleBuilder* styler = evaluateRule(marker, zoom);
+    if (!styler) { return false; }
+
+    auto rule = marker.drawRule();
+
+    styler->setup(marker, zoom);
+
     if (!styler->addFeature(*feature, *rule)) { return false; }
 
-    marker.setSelectionColor(selectionColor);
+    marker.setSelectionColor(rule->selectionColor);
     marker.setMesh(styler->style().getID(), zoom, styler->build());
 
     return true;
 }
 
+bool MarkerManager::buildBatch(Marker& marker, Batch& batch, int zoom) {
+
+    batch.zoom = zoom;
+
+    if (batch.points.empty()) { return false; }
+
+    StyleBuilder* styler = evaluateRule(marker, zoom);
+    if (!styler) {
+        marker.clearMesh();
+        return false;
+    }
+
+    // The evaluated parameters point into the marker's draw rule set, which is
+    // evaluated again on the next build, so the job gets its own copies.
+    auto rule = marker.drawRule();
+    std::vector<StyleParam> params;
+    for (size_t i = 0; i < StyleParamKeySize; ++i) {
+        if (!rule->active[i] || !rule->params[i].param) { continue; }
+        params.push_back(*rule->params[i].param);
+        params.back().function = -1;
+    }
+
+    auto job = std::make_shared<BatchJob>();
+    job->markerID = marker.id();
+    job->generation = ++batch.generation;
+    job->zoom = zoom;
+    job->styleName = styler->style().getName();
+    job->ruleData = std::make_unique<DrawRuleData>(*rule->name, rule->id, std::move(params));
+    job->isOutlineOnly = rule->isOutlineOnly;
+    job->selectionColor = rule->selectionColor;
+    job->featureSelection = rule->featureSelection;
+    job->points = batch.points;
+    job->bounds = batch.bounds;
+
+    {
+        std::lock_guard<std::mutex> lock(m_batchBuilder->mutex);
+        m_batchBuilder->latest[job->markerID] = job->generation;
+    }
+
+    if (!m_batchWorker) {
+        m_batchWorker = std::make_unique<AsyncWorker>(m_platform->threadPolicy(ThreadRole::background));
+    }
+
+    auto builder = m_batchBuilder;
+    m_batchWorker->enqueue([builder, job]() { builder->build(*job); });
+
+    return true;
+}
+
+bool MarkerManager::applyBatchResults() {
+
+    if (!m_batchBuilder) { return false; }
+
+    std::vector<BatchResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_batchBuilder->mutex);
+        results.swap(m_batchBuilder->results);
+    }
+
+    bool applied = false;
+    for (auto& result : results) {
+        auto batch = m_batches.find(result.markerID);
+        if (batch == m_batches.end() || batch->second.generation != result.generation) { continue; }
+
+        Marker* marker = getMarkerOrNull(result.markerID);
+        if (!marker) { continue; }
+
+        marker->setBounds(result.bounds);
+        marker->setSelectionColor(result.selectionColor);
+        marker->setMesh(result.styleId, result.zoom, std::move(result.mesh));
+        applied = true;
+    }
+
+    return applied;
+}
+
 const Marker* MarkerManager::getMarkerOrNullBySelectionColor(uint32_t selectionColor) const {
     for (const auto& marker : m_markers) {
         if (marker->isVisible() && marker->selectionColor() == selectionColor) {
@@ -472,10 +810,15 @@ const Marker* MarkerManager::getMarkerOrNullBySelectionColor(uint32_t selectionC
 
 Marker* MarkerManager::getMarkerOrNull(MarkerID markerID) {
     if (!markerID) { return nullptr; }
-    for (const auto& entry : m_markers) {
-        if (entry->id() == markerID) { return entry.get(); }
+    auto entry = m_markerSlots.find(markerID);
+    if (entry == m_markerSlots.end()) { return nullptr; }
+    return m_markers[entry->second].get();
+}
+
+void MarkerManager::updateSlots(size_t begin, size_t end) {
+    for (size_t slot = begin; slot < end; ++slot) {
+        m_markerSlots[m_markers[slot]->id()] = slot;
     }
-    return nullptr;
 }
 
 } // namespace Tangram
@@ -3,25 +3,32 @@
 #include "scene/drawRule.h"
 #include "util/ease.h"
 #include "util/fastmap.h"
+#include "util/geom.h"
 #include "util/types.h"
+#include "view/modelTransforms.h"
 
+#include "glm/vec2.hpp"
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace Tangram {
 
+class AsyncWorker;
 class MapProjection;
 class Marker;
+class Platform;
 class Scene;
 class StyleBuilder;
 class StyleContext;
+class Texture;
 class View;
 
 class MarkerManager {
 
 public:
 
-    MarkerManager();
+    explicit MarkerManager(std::shared_ptr<Platform> platform);
     ~MarkerManager();
     // Set the Scene object whose styling information will be used to build markers.
     void setScene(std::shared_ptr<Scene> scene);
@@ -64,11 +71,20 @@ public:
     // Set a marker to a polygon feature at the given position; returns true if the marker was found and updated.
     bool setPolygon(MarkerID markerID, LngLat* coordinates, int* counts, int rings);
 
+    // Set a marker to a batch of point features at the given positions, all drawn with the marker's styling;
+    // the batch is built into one mesh off the main thread, and the previous mesh is drawn until the new
+    // one is ready. Returns true if the marker was found and updated.
+    bool setPoints(MarkerID markerID, const LngLat* coordinates, int count);
+
     // Update the zoom level for all markers; markers are built for one zoom
     // level at a time so when the current zoom changes, all marker meshes are
-    // rebuilt. Returns true when any Markers changed since last call to update.
+    // rebuilt. Returns true when any Markers changed since last call to update,
+    // markers moving along their ease are reported by isEasing() instead.
     bool update(const View& _view, float _dt);
 
+    // Whether any marker was easing in the last call to update.
+    bool isEasing() const { return m_easing; }
+
     // Remove and destroy all markers.
     void removeAll();
 
@@ -81,22 +97,63 @@ public:
 
 private:
 
+    struct Batch {
+        // Positions in Mercator meters
+        std::vector<glm::dvec2> points;
+        BoundingBox bounds;
+        // Incremented for each build, results of older builds are dropped
+        uint32_t generation = 0;
+        // Zoom level of the last build requested, -1 when the batch needs to be built
+        int zoom = -1;
+    };
+
+    struct BatchJob;
+    struct BatchResult;
+    struct BatchBuilder;
+
     Marker* getMarkerOrNull(MarkerID markerID);
 
+    // Update the index of the markers in slots [begin, end) after they moved
+    void updateSlots(size_t begin, size_t end);
+
     bool setStyling(MarkerID markerID, const char* styling, bool isPath);
     bool buildStyling(Marker& marker);
     bool buildMesh(Marker& marker, int zoom);
+    bool buildBatch(Marker& marker, Batch& batch, int zoom);
+    bool applyBatchResults();
+
+    // Evaluate the draw rule of the marker for the zoom level, returns the StyleBuilder for the rule
+    // or null if the rule is invalid
+    StyleBuilder* evaluateRule(Marker& marker, int zoom);
 
     std::unique_ptr<StyleContext> m_styleContext;
     std::shared_ptr<Scene> m_scene;
+    // Markers ordered by draw order, and the slot of each marker in that list
     std::vector<std::unique_ptr<Marker>> m_markers;
+    std::unordered_map<MarkerID, size_t> m_markerSlots;
+    // Transforms of m_markers, in the same order
+    ModelTransforms m_transforms;
     std::vector<std::string> m_jsFnList;
+    // Style params parsed from the YAML styling strings of markers in this scene
+    std::unordered_map<std::string, std::vector<StyleParam>> m_stylingParams;
     fastmap<std::string, std::unique_ptr<StyleBuilder>> m_styleBuilders;
     MapProjection* m_mapProjection = nullptr;
+    std::shared_ptr<Platform> m_platform;
+
+    // Bitmap textures by the hash of their size and pixels, shared by the
+    // markers with the same bitmap
+    std::unordered_map<uint64_t, std::weak_ptr<Texture>> m_bitmapTextures;
+
+    std::unordered_map<MarkerID, Batch> m_batches;
+    std::shared_ptr<BatchBuilder> m_batchBuilder;
 
     uint32_t m_idCounter = 0;
     int m_zoom = 0;
     bool m_dirty = false;
+    bool m_easing = false;
+
+    // Declared last so that batch builds finish before anything they use is destroyed
+    std::unique_ptr<AsyncWorker> m_batchWorker;
 
 };
 
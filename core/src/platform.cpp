@@ -4,6 +4,12 @@
 #include <fstream>
 #include <string>
 
+#if defined(__APPLE__)
+#include <pthread.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
 namespace Tangram {
 
 Platform::Platform() : m_continuousRendering(false) {}
@@ -18,6 +24,17 @@ bool Platform::isContinuousRendering() const {
     return m_continuousRendering;
 }
 
+UrlRequestHandle Platform::startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                      UrlCallback _callback) {
+    return startUrlRequest(_url, _callback);
+}
+
+UrlRequestHandle Platform::startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                      double _priority, UrlCallback _callback) {
+    if (_validators.empty()) { return startUrlRequest(_url, _callback); }
+    return startConditionalUrlRequest(_url, _validators, _callback);
+}
+
 bool Platform::bytesFromFileSystem(const char* _path, std::function<char*(size_t)> _allocator) {
     std::ifstream resource(_path, std::ifstream::ate | std::ifstream::binary);
 
@@ -46,4 +63,45 @@ std::vector<FontSourceHandle> Platform::systemFontFallbacksHandle() const {
     return {};
 }
 
+ThreadPolicy Platform::threadPolicy(ThreadRole _role) const {
+    ThreadPolicy policy;
+    switch (_role) {
+    case ThreadRole::tileWorker:
+        policy.priority = 10;
+        break;
+    case ThreadRole::network:
+        break;
+    case ThreadRole::background:
+        policy.priority = 10;
+        policy.qos = ThreadQoS::background;
+        break;
+    }
+    return policy;
+}
+
+void setCurrentThreadPolicy(const ThreadPolicy& _policy) {
+
+#if defined(__APPLE__)
+    // The QoS class has to be set before the priority, which is relative to it
+    static const qos_class_t classes[] = { QOS_CLASS_BACKGROUND, QOS_CLASS_UTILITY, QOS_CLASS_USER_INITIATED };
+    pthread_set_qos_class_self_np(classes[size_t(_policy.qos)], 0);
+#endif
+
+    setCurrentThreadPriority(_policy.priority);
+
+#if defined(__linux__)
+    if (_policy.affinity != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+            if (_policy.affinity & (uint64_t(1) << i)) { CPU_SET(i, &cpus); }
+        }
+        // Applies to the calling thread only
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+            LOGW("Cannot set the CPU affinity of a thread to %llx", (unsigned long long)_policy.affinity);
+        }
+    }
+#endif
+}
+
 } // namespace Tangram
@@ -0,0 +1,46 @@
+#include "scene/dashAtlas.h"
+
+#include "util/dashArray.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+DashAtlas::DashAtlas()
+    : Texture(1, 1, {GL_RGBA, GL_RGBA, {GL_NEAREST, GL_NEAREST}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}}) {}
+
+auto DashAtlas::add(const std::vector<float>& _pattern, float _dashScale) -> Dash {
+
+    for (size_t i = 0; i < m_patterns.size(); i++) {
+        auto& p = m_patterns[i];
+        if (p.pattern == _pattern && p.dashScale == _dashScale) {
+            return { uint32_t(i), uint32_t(p.pixels.size()) };
+        }
+    }
+
+    m_patterns.push_back({ _pattern, _dashScale, DashArray::render(_pattern, _dashScale) });
+
+    // Rebuild the texture, patterns are only added while loading a scene
+    size_t width = m_patterns.size();
+    size_t height = 1;
+    for (auto& p : m_patterns) { height = std::max(height, p.pixels.size()); }
+
+    std::vector<GLuint> data(width * height, 0);
+    for (size_t x = 0; x < width; x++) {
+        auto& pixels = m_patterns[x].pixels;
+        for (size_t y = 0; y < pixels.size(); y++) {
+            data[y * width + x] = pixels[y];
+        }
+    }
+
+    resize(width, height);
+    setData(data.data(), data.size());
+
+    return { uint32_t(width - 1), uint32_t(m_patterns.back().pixels.size()) };
+}
+
+glm::vec2 DashAtlas::uvScale(const Dash& _dash) const {
+    return { (_dash.column + 0.5f) / getWidth(), float(_dash.length) / getHeight() };
+}
+
+}
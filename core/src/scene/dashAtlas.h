@@ -0,0 +1,47 @@
+#pragma once
+
+#include "gl/texture.h"
+
+#include "glm/vec2.hpp"
+#include <vector>
+
+namespace Tangram {
+
+/* Texture holding the dash patterns of all PolylineStyles of a scene
+ *
+ * Each distinct pattern is rendered into one column of the texture, starting
+ * at the top row. Styles with the same dash array share their column and all
+ * dashed styles bind the same texture.
+ */
+class DashAtlas : public Texture {
+
+public:
+
+    struct Dash {
+        uint32_t column = 0;
+        // Length of the pattern in pixels
+        uint32_t length = 0;
+    };
+
+    DashAtlas();
+
+    /* Add the pattern rendered by DashArray::render(), returns the column
+     * of an identical pattern added before if there is one */
+    Dash add(const std::vector<float>& _pattern, float _dashScale);
+
+    /* Texture coordinate of the center of the column of _dash, and the
+     * fraction of the atlas height covered by its pattern */
+    glm::vec2 uvScale(const Dash& _dash) const;
+
+private:
+
+    struct Pattern {
+        std::vector<float> pattern;
+        float dashScale;
+        std::vector<unsigned int> pixels;
+    };
+
+    std::vector<Pattern> m_patterns;
+};
+
+}
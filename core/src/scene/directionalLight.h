@@ -19,6 +19,8 @@ public:
     virtual void setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
                               LightUniforms& _uniforms) override;
 
+    virtual void setupUniformBuffer(const View& _view, UniformBuffer& _buffer) override;
+
     struct Uniforms : public LightUniforms {
 
         Uniforms(const std::string& _name)
@@ -39,6 +41,9 @@ protected:
     virtual std::string getInstanceAssignBlock() override;
     virtual const std::string& getTypeName() override;
 
+    /*  Direction of the light in eye space */
+    glm::vec3 viewDirection(const View& _view) const;
+
     glm::vec3 m_direction;
 
 private:
@@ -19,7 +19,14 @@ DrawRuleData::DrawRuleData(std::string _name, int _id,
                            std::vector<StyleParam> _parameters)
     : parameters(std::move(_parameters)),
       name(std::move(_name)),
-      id(_id) {}
+      id(_id) {
+
+    for (const auto& param : parameters) {
+        auto key = static_cast<uint8_t>(param.key);
+        keys[key] = true;
+        dynamicKeys[key] = param.function >= 0 || param.isZoomDependent();
+    }
+}
 
 std::string DrawRuleData::toString() const {
     std::string str = "{\n";
@@ -41,9 +48,17 @@ DrawRule::DrawRule(const DrawRuleData& _ruleData, const std::string& _layerName,
 
     for (const auto& param : _ruleData.parameters) {
         auto key = static_cast<uint8_t>(param.key);
-        active[key] = true;
         params[key] = { &param, _layerName.c_str(), _layerDepth };
     }
+    active = _ruleData.keys;
+    dynamic = _ruleData.dynamicKeys;
+}
+
+void DrawRule::set(const StyleParam& _param, const char* _layerName, size_t _layerDepth) {
+    auto key = static_cast<uint8_t>(_param.key);
+    active[key] = true;
+    dynamic[key] = _param.function >= 0 || _param.isZoomDependent();
+    params[key] = { &_param, _layerName, _layerDepth };
 }
 
 bool DrawRule::hasParameterSet(StyleParamKey _key) const {
@@ -61,6 +76,16 @@ void DrawRule::merge(const DrawRuleData& _ruleData, const SceneLayer& _layer) {
     const auto depthNew = _layer.depth();
     const char* layerNew = _layer.name().c_str();
 
+    // Without common keys all parameters of _ruleData are taken
+    if ((active & _ruleData.keys).none()) {
+        for (const auto& paramNew : _ruleData.parameters) {
+            params[static_cast<uint8_t>(paramNew.key)] = { &paramNew, layerNew, depthNew };
+        }
+        active |= _ruleData.keys;
+        dynamic |= _ruleData.dynamicKeys;
+        return;
+    }
+
     for (const auto& paramNew : _ruleData.parameters) {
 
         auto key = static_cast<uint8_t>(paramNew.key);
@@ -70,6 +95,7 @@ void DrawRule::merge(const DrawRuleData& _ruleData, const SceneLayer& _layer) {
             (depthNew == param.depth && strcmp(layerNew, param.name) > 0)) {
             param = { &paramNew, layerNew, depthNew };
             active[key] = true;
+            dynamic[key] = _ruleData.dynamicKeys[key];
         }
     }
 }
@@ -113,6 +139,9 @@ void DrawRule::logGetError(StyleParamKey _expectedKey, const StyleParam& _param)
     LOGE("wrong type '%d'for StyleParam '%d'", _param.value.which(), _expectedKey);
 }
 
+// Size of the match cache per DrawRuleMergeSet
+static const size_t MATCH_CACHE_SIZE = 128;
+
 bool DrawRuleMergeSet::match(const Feature& _feature, const SceneLayer& _layer, StyleContext& _ctx) {
 
     _ctx.setFeature(_feature);
@@ -124,8 +153,107 @@ bool DrawRuleMergeSet::match(const Feature& _feature, const SceneLayer& _layer,
         return false;
     }
 
+    bool hit = false;
+    MatchEntry* entry = findMatch(_feature, _layer, _ctx, hit);
+    if (hit) {
+        m_matchedRules = entry->rules;
+        return entry->matched;
+    }
+
+    bool matched = matchLayers(_feature, _layer, _ctx);
+
+    if (entry) {
+        entry->matched = matched;
+        entry->rules = m_matchedRules;
+        entry->valid = true;
+    }
+
+    return matched;
+}
+
+const DrawRuleMergeSet::LayerInputs& DrawRuleMergeSet::layerInputs(const SceneLayer& _layer,
+                                                                   const StyleContext& _ctx) {
+    auto it = m_layerInputs.find(&_layer);
+    if (it != m_layerInputs.end()) { return it->second; }
+
+    LayerInputs inputs;
+
+    auto addKey = [&](PropertyKey _key) {
+        if (std::find(inputs.properties.begin(), inputs.properties.end(), _key) ==
+            inputs.properties.end()) {
+            inputs.properties.push_back(_key);
+        }
+    };
+
+    std::vector<const SceneLayer*> layers = { &_layer };
+    while (!layers.empty()) {
+        auto& layer = *layers.back();
+        layers.pop_back();
+
+        for (auto& key : layer.program().keys()) { addKey(key); }
+
+        for (auto& ins : layer.program().instructions()) {
+            if (ins.op != FilterProgram::Op::function) { continue; }
+
+            auto* function = _ctx.functionInputs(ins.arg);
+            if (!function || !function->memoizable) {
+                inputs.cacheable = false;
+                continue;
+            }
+            for (auto& key : function->properties) { addKey(key); }
+        }
+
+        for (auto& sublayer : layer.sublayers()) { layers.push_back(&sublayer); }
+    }
+
+    return m_layerInputs.emplace(&_layer, std::move(inputs)).first->second;
+}
+
+DrawRuleMergeSet::MatchEntry* DrawRuleMergeSet::findMatch(const Feature& _feature, const SceneLayer& _layer,
+                                                          StyleContext& _ctx, bool& _hit) {
+    _hit = false;
+
+    auto& inputs = layerInputs(_layer, _ctx);
+    if (!inputs.cacheable) { return nullptr; }
+
+    // Zoom and geometry are always part of the key: filters may use them
+    // through keywords and pixel area ranges.
+    m_matchInputs.clear();
+    m_matchInputs.push_back(_ctx.getKeyword(FilterKeyword::zoom));
+    m_matchInputs.push_back(_ctx.getKeyword(FilterKeyword::geometry));
+    for (auto& key : inputs.properties) {
+        m_matchInputs.push_back(_ctx.getProperty(_feature, key));
+    }
+
+    size_t hash = std::hash<const SceneLayer*>()(&_layer);
+    for (auto& value : m_matchInputs) { hash_combine(hash, StyleContext::hashValue(value)); }
+
+    if (m_matchCache.empty()) { m_matchCache.resize(MATCH_CACHE_SIZE); }
+    auto& entry = m_matchCache[hash % MATCH_CACHE_SIZE];
+
+    if (entry.valid && entry.hash == hash && entry.layer == &_layer &&
+        entry.inputs == m_matchInputs) {
+        m_matchHits++;
+        _hit = true;
+        return &entry;
+    }
+
+    m_matchMisses++;
+
+    // Take over the slot for the current inputs
+    entry.valid = false;
+    entry.hash = hash;
+    entry.layer = &_layer;
+    entry.inputs = m_matchInputs;
+    entry.rules.clear();
+
+    return &entry;
+}
+
+bool DrawRuleMergeSet::matchLayers(const Feature& _feature, const SceneLayer& _layer, StyleContext& _ctx) {
+
     // If the first filter doesn't match, return immediately
-    if (!_layer.filter().eval(_feature, _ctx)) { return false; }
+    if (!_layer.program().eval(_feature, _ctx)) { return false; }
 
     m_queuedLayers.push_back(&_layer);
 
@@ -146,7 +274,7 @@ bool DrawRuleMergeSet::match(const Feature& _feature, const SceneLayer& _layer,
                 continue;
             }
 
-            if (sublayer.filter().eval(_feature, _ctx)) {
+            if (sublayer.program().eval(_feature, _ctx)) {
                 m_queuedLayers.push_back(&sublayer);
             }
         }
@@ -162,13 +290,15 @@ bool DrawRuleMergeSet::evaluateRuleForContext(DrawRule& rule, StyleContext& ctx)
         return false;
     }
 
+    // Only parameters with functions or stops are evaluated, 'params'
+    // of inactive keys are never read.
+    auto evaluate = rule.active & rule.dynamic;
+    if (evaluate.none()) { return true; }
+
     bool valid = true;
     for (size_t i = 0; i < StyleParamKeySize; ++i) {
 
-        if (!rule.active[i]) {
-            rule.params[i].param = nullptr;
-            continue;
-        }
+        if (!evaluate[i]) { continue; }
 
         auto*& param = rule.params[i].param;
 
@@ -187,17 +317,32 @@ bool DrawRuleMergeSet::evaluateRuleForContext(DrawRule& rule, StyleContext& ctx)
                     rule.active[i] = false;
                 }
             }
-        } else if (param->stops) {
-            m_evaluated[i] = *param;
-            param = &m_evaluated[i];
-
-            Stops::eval(*param->stops, param->key, ctx.getKeywordZoom(), m_evaluated[i].value);
+        } else if (param->isZoomDependent()) {
+            param = &evalZoomDependent(*param, ctx.getKeywordZoom());
         }
     }
 
     return valid;
 }
 
+const StyleParam& DrawRuleMergeSet::evalZoomDependent(const StyleParam& _param, float _zoom) {
+
+    if (_zoom != m_zoomEvaluatedAt) {
+        m_zoomEvaluated.clear();
+        m_zoomEvaluatedAt = _zoom;
+    }
+
+    auto it = m_zoomEvaluated.find(&_param);
+    if (it != m_zoomEvaluated.end()) {
+        return it->second;
+    }
+
+    auto& evaluated = m_zoomEvaluated.emplace(&_param, _param).first->second;
+    Stops::eval(*_param.stops, _param.key, _zoom, evaluated.value);
+
+    return evaluated;
+}
+
 void DrawRuleMergeSet::mergeRules(const SceneLayer& _layer) {
 
     size_t pos, end = m_matchedRules.size();
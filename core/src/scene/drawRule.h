@@ -3,6 +3,7 @@
 #include "scene/styleParam.h"
 
 #include <bitset>
+#include <unordered_map>
 #include <vector>
 #include <set>
 
@@ -46,6 +47,11 @@ struct DrawRuleData {
     std::string name;
     int id;
 
+    // Keys of 'parameters', and of those evaluated per feature or zoom
+    // by a function or stops
+    std::bitset<StyleParamKeySize> keys;
+    std::bitset<StyleParamKeySize> dynamicKeys;
+
     DrawRuleData(std::string _name, int _id, std::vector<StyleParam> _parameters);
 
     std::string toString() const;
@@ -71,6 +77,8 @@ struct DrawRule {
     // 480 (on 32bit arch) or 980 byte for params array.
     std::bitset<StyleParamKeySize> active = { 0 };
 
+    // Active parameters that evaluateRuleForContext must evaluate
+    std::bitset<StyleParamKeySize> dynamic = { 0 };
 
     // draw-style name and id
     const std::string* name = nullptr;
@@ -83,6 +91,9 @@ struct DrawRule {
 
     void merge(const DrawRuleData& _ruleData, const SceneLayer& _layer);
 
+    // Set the parameter for _key, e.g. a default of the style
+    void set(const StyleParam& _param, const char* _layerName, size_t _layerDepth);
+
     bool isJSFunction(StyleParamKey _key) const;
 
     bool contains(StyleParamKey _key) const;
@@ -131,7 +142,50 @@ public:
 
     auto& matchedRules() { return m_matchedRules; }
 
+    // Number of match calls answered from the match cache, and of
+    // cacheable calls that had to walk the layer tree.
+    size_t matchCacheHits() const { return m_matchHits; }
+    size_t matchCacheMisses() const { return m_matchMisses; }
+
+    // Drop zoom dependent parameters evaluated for the previous rules.
+    // Must be called when the StyleParams of matched rules may be freed.
+    void resetZoomDependent() { m_zoomEvaluated.clear(); }
+
 private:
+    bool matchLayers(const Feature& _feature, const SceneLayer& _layer, StyleContext& _ctx);
+
+    // Inputs of all filters in the tree of a layer
+    struct LayerInputs {
+        std::vector<PropertyKey> properties;
+        // False when a filter function reads unknown inputs
+        bool cacheable = true;
+    };
+
+    // Matched rules of a layer for one set of filter inputs
+    struct MatchEntry {
+        const SceneLayer* layer = nullptr;
+        size_t hash = 0;
+        bool valid = false;
+        bool matched = false;
+        std::vector<Value> inputs;
+        std::vector<DrawRule> rules;
+    };
+
+    // Returns the cache slot for the filter inputs of _feature, or nullptr
+    // when _layer is not cacheable. _hit is set when the slot holds the
+    // result for these inputs, otherwise the slot is prepared for it.
+    MatchEntry* findMatch(const Feature& _feature, const SceneLayer& _layer,
+                          StyleContext& _ctx, bool& _hit);
+
+    const LayerInputs& layerInputs(const SceneLayer& _layer, const StyleContext& _ctx);
+
+    std::unordered_map<const SceneLayer*, LayerInputs> m_layerInputs;
+    // Direct mapped by hash of layer and inputs
+    std::vector<MatchEntry> m_matchCache;
+    std::vector<Value> m_matchInputs;
+    size_t m_matchHits = 0;
+    size_t m_matchMisses = 0;
+
     // Reusable containers 'matchedRules' and 'queuedLayers'
     std::vector<DrawRule> m_matchedRules;
     std::vector<const SceneLayer*> m_queuedLayers;
@@ -139,6 +193,13 @@ private:
     // Container for dynamically-evaluated parameters
     StyleParam m_evaluated[StyleParamKeySize];
 
+    // Zoom dependent parameters evaluated at m_zoomEvaluatedAt, by the
+    // parameter of the scene layer. Features of a tile share these.
+    const StyleParam& evalZoomDependent(const StyleParam& _param, float _zoom);
+
+    std::unordered_map<const StyleParam*, StyleParam> m_zoomEvaluated;
+    float m_zoomEvaluatedAt = -1;
+
 };
 
 }
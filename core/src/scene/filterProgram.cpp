@@ -0,0 +1,187 @@
+#include "scene/filterProgram.h"
+
+#include "data/tileData.h"
+#include "scene/styleContext.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Tangram {
+
+FilterProgram::FilterProgram(const Filter& _filter) {
+    compile(_filter);
+}
+
+uint16_t FilterProgram::addKey(const std::string& _key) {
+    PropertyKey key(_key);
+    for (size_t i = 0; i < m_keys.size(); i++) {
+        if (m_keys[i] == key) { return uint16_t(i); }
+    }
+    m_keys.push_back(key);
+    return uint16_t(m_keys.size() - 1);
+}
+
+void FilterProgram::compileOperator(const std::vector<Filter>& _operands, Op _jump, bool _empty) {
+    if (_operands.empty()) {
+        emit(Op::constant, _empty);
+        return;
+    }
+
+    std::vector<size_t> jumps;
+    for (size_t i = 0; i < _operands.size(); i++) {
+        compile(_operands[i]);
+        if (i + 1 < _operands.size()) {
+            jumps.push_back(m_code.size());
+            emit(_jump);
+        }
+    }
+    // Short-circuit to the end of this operator, keeping the result
+    for (size_t jump : jumps) {
+        m_code[jump].arg = uint32_t(m_code.size());
+    }
+}
+
+void FilterProgram::compile(const Filter& _filter) {
+    using Data = Filter::Data;
+
+    switch (_filter.data.which()) {
+
+    case Data::type<Filter::OperatorAll>::value:
+        compileOperator(_filter.operands(), Op::jump_if_false, true);
+        break;
+
+    case Data::type<Filter::OperatorAny>::value:
+        compileOperator(_filter.operands(), Op::jump_if_true, false);
+        break;
+
+    case Data::type<Filter::OperatorNone>::value:
+        compileOperator(_filter.operands(), Op::jump_if_true, false);
+        emit(Op::negate);
+        break;
+
+    case Data::type<Filter::Existence>::value: {
+        auto& f = _filter.data.get<Filter::Existence>();
+        emit(Op::existence, f.exists, FilterKeyword::undefined, addKey(f.key));
+        break;
+    }
+    case Data::type<Filter::EqualitySet>::value: {
+        auto& f = _filter.data.get<Filter::EqualitySet>();
+        uint16_t key = (f.keyword == FilterKeyword::undefined) ? addKey(f.key) : 0;
+        emit(Op::equal, uint32_t(m_values.size()), f.keyword, key, uint32_t(f.values.size()));
+        m_values.insert(m_values.end(), f.values.begin(), f.values.end());
+        break;
+    }
+    case Data::type<Filter::Equality>::value: {
+        auto& f = _filter.data.get<Filter::Equality>();
+        uint16_t key = (f.keyword == FilterKeyword::undefined) ? addKey(f.key) : 0;
+        emit(Op::equal, uint32_t(m_values.size()), f.keyword, key, 1);
+        m_values.push_back(f.value);
+        break;
+    }
+    case Data::type<Filter::Range>::value: {
+        auto& f = _filter.data.get<Filter::Range>();
+        uint16_t key = (f.keyword == FilterKeyword::undefined) ? addKey(f.key) : 0;
+        emit(Op::range, uint32_t(m_ranges.size()), f.keyword, key);
+        m_ranges.push_back({ f.min, f.max, f.hasPixelArea });
+        break;
+    }
+    case Data::type<Filter::Function>::value:
+        emit(Op::function, _filter.data.get<Filter::Function>().id);
+        break;
+
+    default:
+        // Empty filter passes everything
+        emit(Op::constant, true);
+        break;
+    }
+}
+
+static bool matchNumber(double _a, double _b) {
+    if (_a == _b) { return true; }
+    return std::fabs(_a - _b) <= std::numeric_limits<double>::epsilon();
+}
+
+bool FilterProgram::eval(const Feature& _feature, StyleContext& _ctx) const {
+
+    auto value = [&](const Instruction& ins) -> const Value& {
+        if (ins.keyword != FilterKeyword::undefined) {
+            return _ctx.getKeyword(ins.keyword);
+        }
+        return _ctx.getProperty(_feature, m_keys[ins.key]);
+    };
+
+    bool result = true;
+    const size_t size = m_code.size();
+    size_t pc = 0;
+
+    while (pc < size) {
+        const Instruction& ins = m_code[pc++];
+
+        switch (ins.op) {
+        case Op::constant:
+            result = ins.arg != 0;
+            break;
+
+        case Op::jump_if_true:
+            if (result) { pc = ins.arg; }
+            break;
+
+        case Op::jump_if_false:
+            if (!result) { pc = ins.arg; }
+            break;
+
+        case Op::negate:
+            result = !result;
+            break;
+
+        case Op::existence:
+            result = value(ins).is<none_type>() != (ins.arg != 0);
+            break;
+
+        case Op::equal: {
+            auto& v = value(ins);
+            auto begin = m_values.begin() + ins.arg;
+            auto end = begin + ins.count;
+            result = false;
+
+            if (v.is<double>()) {
+                double num = v.get<double>();
+                for (auto it = begin; it != end; ++it) {
+                    if (it->is<double>() && matchNumber(num, it->get<double>())) {
+                        result = true;
+                        break;
+                    }
+                }
+            } else if (v.is<std::string>()) {
+                auto& str = v.get<std::string>();
+                for (auto it = begin; it != end; ++it) {
+                    if (it->is<std::string>() && it->get<std::string>() == str) {
+                        result = true;
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case Op::range: {
+            auto& v = value(ins);
+            result = false;
+
+            if (v.is<double>()) {
+                auto& range = m_ranges[ins.arg];
+                double scale = range.hasPixelArea ? _ctx.getPixelAreaScale() : 1.f;
+                double num = v.get<double>();
+                result = num >= range.min * scale && num < range.max * scale;
+            }
+            break;
+        }
+        case Op::function:
+            result = _ctx.evalFilter(ins.arg);
+            break;
+        }
+    }
+
+    return result;
+}
+
+}
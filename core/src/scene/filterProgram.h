@@ -0,0 +1,82 @@
+#pragma once
+
+#include "data/propertyKey.h"
+#include "scene/filters.h"
+
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+class StyleContext;
+struct Feature;
+
+/* Filter compiled to a flat instruction sequence
+ *
+ * Operators are turned into conditional jumps on the current result, so that
+ * evaluation short-circuits without recursion or visiting the variant tree.
+ * Property keys are interned at compile time; StyleContext caches the values
+ * of the current feature by key atom, so that each key is looked up at most
+ * once per feature across all layers.
+ */
+class FilterProgram {
+
+public:
+
+    enum class Op : uint8_t {
+        constant,       // result = arg
+        jump_if_true,   // if result: continue at arg
+        jump_if_false,  // if !result: continue at arg
+        negate,         // result = !result
+        existence,      // result = (key exists) == arg
+        equal,          // result = key matches one of values[arg, arg + count)
+        range,          // result = key in ranges[arg]
+        function,       // result = scene function arg
+    };
+
+    struct Instruction {
+        Op op;
+        FilterKeyword keyword;
+        // Index into m_keys, used when keyword is undefined
+        uint16_t key;
+        uint32_t arg;
+        uint32_t count;
+    };
+
+    struct Range {
+        float min;
+        float max;
+        bool hasPixelArea;
+    };
+
+    FilterProgram() {}
+
+    explicit FilterProgram(const Filter& _filter);
+
+    bool eval(const Feature& _feature, StyleContext& _ctx) const;
+
+    const std::vector<Instruction>& instructions() const { return m_code; }
+
+    const std::vector<PropertyKey>& keys() const { return m_keys; }
+
+private:
+
+    void compile(const Filter& _filter);
+    void compileOperator(const std::vector<Filter>& _operands, Op _jump, bool _empty);
+
+    uint16_t addKey(const std::string& _key);
+
+    void emit(Op _op, uint32_t _arg = 0, FilterKeyword _keyword = FilterKeyword::undefined,
+              uint16_t _key = 0, uint32_t _count = 0) {
+        m_code.push_back({ _op, _keyword, _key, _arg, _count });
+    }
+
+    std::vector<Instruction> m_code;
+
+    std::vector<Value> m_values;
+    std::vector<Range> m_ranges;
+
+    std::vector<PropertyKey> m_keys;
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include "log.h"
 #include "platform.h"
+#include "scene/sceneCache.h"
 #include "scene/sceneLoader.h"
 #include "util/zipArchive.h"
 
@@ -15,6 +16,25 @@ using YAML::NodeType;
 
 namespace Tangram {
 
+// Scene files parsed by earlier scene loads, by URL. Reloading a scene, or
+// loading another one with the same imports, takes the YAML of unchanged
+// files from here instead of parsing them again.
+struct ParsedScene {
+    std::string digest;
+    Node node;
+    std::vector<Url> imports;
+};
+
+static const size_t MAX_PARSED_SCENES = 64;
+
+static std::mutex s_parsedScenesMutex;
+static std::unordered_map<Url, ParsedScene> s_parsedScenes;
+
+void Importer::clearParsedScenes() {
+    std::lock_guard<std::mutex> lock(s_parsedScenesMutex);
+    s_parsedScenes.clear();
+}
+
 Importer::Importer(std::shared_ptr<Scene> scene)
     : m_scene(scene) {
 }
@@ -27,19 +47,21 @@ Node Importer::applySceneImports(std::shared_ptr<Platform> platform) {
 
     if (!m_scene->yaml().empty()) {
         // Load scene from yaml string.
-        addSceneString(sceneUrl, m_scene->yaml());
+        auto& yaml = m_scene->yaml();
+        auto digest = SceneCache::digest(yaml.data(), yaml.size());
+        m_sceneDigests[sceneUrl] = digest;
+        addSceneString(sceneUrl, yaml, digest);
     } else {
         // Load scene from yaml file.
         m_sceneQueue.push_back(sceneUrl);
     }
 
     std::atomic_uint activeDownloads(0);
-    std::mutex sceneMutex;
     std::condition_variable condition;
 
     while (true) {
         {
-            std::unique_lock<std::mutex> lock(sceneMutex);
+            std::unique_lock<std::mutex> lock(m_sceneMutex);
 
             if (m_sceneQueue.empty()) {
                 if (activeDownloads == 0) {
@@ -55,20 +77,28 @@ Node Importer::applySceneImports(std::shared_ptr<Platform> platform) {
                 continue;
             }
 
-            if (m_importedScenes.find(nextUrlToImport) != m_importedScenes.end()) {
+            if (m_importedScenes.find(nextUrlToImport) != m_importedScenes.end() ||
+                !m_requestedScenes.insert(nextUrlToImport).second) {
                 // This scene URL has already been imported, we're done!
                 continue;
             }
+            activeDownloads++;
+
+            // Don't wait for this scene to find its imports when they are
+            // known from an earlier load. Imports that it no longer has are
+            // fetched for nothing but never merged.
+            queueKnownImports(nextUrlToImport);
         }
 
-        activeDownloads++;
+        // Requests for all known imports are in flight at the same time and
+        // their responses are parsed on the threads that deliver them.
         m_scene->startUrlRequest(platform, nextUrlToImport, [&, nextUrlToImport](UrlResponse response) {
-            std::unique_lock<std::mutex> lock(sceneMutex);
             if (response.error) {
                 LOGE("Unable to retrieve '%s': %s", nextUrlToImport.string().c_str(), response.error);
             } else {
                 addSceneData(nextUrlToImport, response.content);
             }
+            std::unique_lock<std::mutex> lock(m_sceneMutex);
             activeDownloads--;
             condition.notify_all();
         });
@@ -87,9 +117,10 @@ void Importer::addSceneData(const Url& sceneUrl, std::vector<char>& sceneContent
 
     LOGD("Process: '%s'", sceneUrl.string().c_str());
 
-    // Don't load imports twice
-    if (m_importedScenes.find(sceneUrl) != m_importedScenes.end()) {
-        return;
+    auto digest = SceneCache::digest(sceneContent.data(), sceneContent.size());
+    {
+        std::lock_guard<std::mutex> lock(m_sceneMutex);
+        m_sceneDigests[sceneUrl] = digest;
     }
 
     std::string sceneString;
@@ -97,7 +128,15 @@ void Importer::addSceneData(const Url& sceneUrl, std::vector<char>& sceneContent
         // We're loading a scene from a zip archive!
         // First, create an archive from the data.
         auto zipArchive = std::make_shared<ZipArchive>();
-        zipArchive->loadFromMemory(sceneContent);
+        // Local archives are mapped instead of kept in memory, scene files,
+        // textures and fonts are then read from it when they are requested.
+        ByteBuffer mapped;
+        if (sceneUrl.hasFileScheme()) { mapped = ByteBuffer::mapFile(sceneUrl.path()); }
+        if (!mapped.empty()) {
+            zipArchive->loadFromBuffer(std::move(mapped));
+        } else {
+            zipArchive->loadFromMemory(sceneContent);
+        }
         // Find the "base" scene file in the archive entries.
         for (const auto& entry : zipArchive->entries()) {
             auto ext = Url::getPathExtension(entry.path);
@@ -111,26 +150,65 @@ void Importer::addSceneData(const Url& sceneUrl, std::vector<char>& sceneContent
             }
         }
         // Add the archive to the scene.
+        std::lock_guard<std::mutex> lock(m_sceneMutex);
         m_scene->addZipArchive(sceneUrl, zipArchive);
     } else {
         sceneString = std::string(sceneContent.data(), sceneContent.size());
     }
 
-    addSceneString(sceneUrl, sceneString);
+    addSceneString(sceneUrl, sceneString, digest);
+}
+
+void Importer::queueKnownImports(const Url& sceneUrl) {
+
+    std::lock_guard<std::mutex> lock(s_parsedScenesMutex);
+    auto it = s_parsedScenes.find(sceneUrl);
+    if (it == s_parsedScenes.end()) { return; }
+
+    for (const auto& import : it->second.imports) {
+        m_sceneQueue.push_back(import);
+    }
 }
 
-void Importer::addSceneString(const Url& sceneUrl, const std::string& sceneString) {
+void Importer::addSceneString(const Url& sceneUrl, const std::string& sceneString,
+                              const std::string& digest) {
     Node sceneNode;
-    try {
-        sceneNode = YAML::Load(sceneString);
-    } catch (YAML::ParserException e) {
-        LOGE("Parsing scene config '%s'", e.what());
-        return;
+    std::vector<Url> imports;
+    bool parsed = false;
+
+    if (!digest.empty()) {
+        std::lock_guard<std::mutex> lock(s_parsedScenesMutex);
+        auto it = s_parsedScenes.find(sceneUrl);
+        if (it != s_parsedScenes.end() && it->second.digest == digest) {
+            // Merging modifies the scene nodes, the parsed ones are kept apart
+            sceneNode = YAML::Clone(it->second.node);
+            imports = it->second.imports;
+            parsed = true;
+        }
+    }
+
+    if (!parsed) {
+        try {
+            sceneNode = YAML::Load(sceneString);
+        } catch (YAML::ParserException e) {
+            LOGE("Parsing scene config '%s'", e.what());
+            return;
+        }
+
+        imports = getResolvedImportUrls(sceneNode, sceneUrl);
+
+        if (!digest.empty()) {
+            std::lock_guard<std::mutex> lock(s_parsedScenesMutex);
+            if (s_parsedScenes.size() >= MAX_PARSED_SCENES) { s_parsedScenes.clear(); }
+            s_parsedScenes[sceneUrl] = { digest, YAML::Clone(sceneNode), imports };
+        }
     }
 
+    std::lock_guard<std::mutex> lock(m_sceneMutex);
+
     m_importedScenes[sceneUrl] = sceneNode;
 
-    for (const auto& import : getResolvedImportUrls(sceneNode, sceneUrl)) {
+    for (const auto& import : imports) {
         m_sceneQueue.push_back(import);
     }
 }
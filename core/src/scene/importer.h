@@ -6,8 +6,10 @@
 #include "yaml-cpp/yaml.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace Tangram {
@@ -26,6 +28,12 @@ public:
     // Loads the main scene with deep merging dependent imported scenes.
     Node applySceneImports(std::shared_ptr<Platform> platform);
 
+    // MD5 digests of the contents of all scene files that were imported
+    const std::unordered_map<Url, std::string>& sceneDigests() const { return m_sceneDigests; }
+
+    // Drop the parsed scene files that are kept for later scene loads
+    static void clearParsedScenes();
+
     static bool isZipArchiveUrl(const Url& url);
 
     static Url getBaseUrlForZipArchive(const Url& archiveUrl);
@@ -40,10 +48,18 @@ public:
 protected:
 
     // Process and store data for an imported scene from a vector of bytes.
+    // May be called concurrently for different scenes.
     void addSceneData(const Url& sceneUrl, std::vector<char>& sceneContent);
 
     // Process and store data for an imported scene from a string of YAML.
-    void addSceneString(const Url& sceneUrl, const std::string& sceneString);
+    // With the _digest of the file, a scene file that was parsed for an
+    // earlier scene load with the same contents is taken from memory.
+    void addSceneString(const Url& sceneUrl, const std::string& sceneString,
+                        const std::string& digest = "");
+
+    // Queue the imports that sceneUrl had in an earlier scene load, so that
+    // they are fetched along with it. Requires m_sceneMutex.
+    void queueKnownImports(const Url& sceneUrl);
 
     // Get the sequence of scene names that are designated to be imported into the
     // input scene node by its 'import' fields.
@@ -63,6 +79,14 @@ protected:
     std::unordered_map<Url, Node> m_importedScenes;
 
     std::vector<Url> m_sceneQueue;
+
+    std::unordered_map<Url, std::string> m_sceneDigests;
+
+    // Scene URLs that were requested, to fetch each import only once
+    std::unordered_set<Url> m_requestedScenes;
+
+    // Guards the scene containers above while responses are processed
+    std::mutex m_sceneMutex;
 };
 
 }
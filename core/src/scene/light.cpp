@@ -1,6 +1,7 @@
 #include "scene/light.h"
 
 #include "gl/shaderProgram.h"
+#include "gl/uniformBuffer.h"
 #include "lights_glsl.h"
 #include "platform.h"
 #include "util/floatFormatter.h"
@@ -53,6 +54,12 @@ void Light::setupProgram(RenderState& rs, const View& _view, ShaderProgram& _sha
     _shader.setUniformf(rs, _uniforms.specular, m_specular);
 }
 
+void Light::setupUniformBuffer(const View& _view, UniformBuffer& _buffer) {
+    _buffer.add(m_ambient);
+    _buffer.add(m_diffuse);
+    _buffer.add(m_specular);
+}
+
 auto Light::assembleLights(const std::vector<std::unique_ptr<Light>>& _lights) ->
     std::map<std::string, std::string> {
 
@@ -89,16 +96,51 @@ auto Light::assembleLights(const std::vector<std::unique_ptr<Light>>& _lights) -
     }
     sourceBlocks["setup"] = setupBlock.str();
 
+    // Uniforms of the dynamic lights, shared by all programs with uniform buffers.
+    // Style::setupFrameUniforms adds their values in the same order.
+    std::stringstream uniforms;
+    for (auto& light : _lights) {
+        if (light->isDynamic()) {
+            uniforms << "    " << light->getTypeName() << " " << light->getUniformName() << ";\n";
+        }
+    }
+    if (uniforms.tellp() > 0) {
+        lighting << "\n#ifdef TANGRAM_UNIFORM_BUFFERS\n";
+        lighting << "layout(std140) uniform TangramLights {\n" << uniforms.str() << "};\n";
+        lighting << "#else\n";
+        for (auto& light : _lights) {
+            if (light->isDynamic()) {
+                lighting << "uniform " << light->getTypeName() << " " << light->getUniformName() << ";\n";
+            }
+        }
+        lighting << "#endif\n";
+    }
+
     for (auto& light : _lights) {
         lighting << '\n' << light->getInstanceBlock();
     }
     // After lights definitions are all added, add the main lighting functions
     std::string lightingBlock = SHADER_SOURCE(lights_glsl);
 
+    // Lights with a range are skipped for geometry out of their reach
+    int rangedLights = 0;
+    for (auto& light : _lights) {
+        if (light->hasRange()) { rangedLights++; }
+    }
+    if (rangedLights > 0) {
+        lighting << "\nuniform float u_lights_visible[" << rangedLights << "];\n";
+    }
+
     // The main lighting functions each contain a tag where all light instances should be computed;
     std::stringstream lights;
+    int rangedLight = 0;
     for (auto& light : _lights) {
-        lights << '\n' << light->getInstanceComputeBlock();
+        if (light->hasRange()) {
+            lights << "\nif (u_lights_visible[" << rangedLight++ << "] != 0.0) { "
+                   << light->getInstanceComputeBlock() << "}";
+        } else {
+            lights << '\n' << light->getInstanceComputeBlock();
+        }
     }
 
     const std::string tag = "#pragma tangram: lights_to_compute";
@@ -129,8 +171,7 @@ std::string Light::getInstanceBlock() {
     std::string block = "";
     const std::string& typeName = getTypeName();
     if (m_dynamic) {
-        //  If is dynamic, define the uniform and copy it to the global instance of the light struct
-        block += "uniform " + typeName + " " + getUniformName() + ";\n";
+        //  If is dynamic, define the global instance of the light struct, the uniform is copied to it
         block += typeName + " " + getInstanceName() + ";\n";
     } else {
         //  If is not dynamic define the global instance of the light struct and fill the variables
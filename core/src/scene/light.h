@@ -2,6 +2,7 @@
 
 #include "gl/uniform.h"
 
+#include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
 #include <map>
 #include <memory>
@@ -12,6 +13,7 @@ namespace Tangram {
 
 class RenderState;
 class ShaderProgram;
+class UniformBuffer;
 class View;
 
 enum class LightType {
@@ -98,6 +100,20 @@ public:
     virtual void setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
                               LightUniforms& _uniforms);
 
+    /*  Add the values of this DYNAMICAL light to the shared block of lights, in the
+     *  order of the members of its struct, see UniformBuffer::LIGHTS_BLOCK */
+    virtual void setupUniformBuffer(const View& _view, UniformBuffer& _buffer);
+
+    /*  Whether the light has no effect farther than range() from its position, so that
+     *  geometry out of its reach can skip it. Lights with a range are computed only when
+     *  their entry of u_lights_visible is set, in the order of the scene lights. */
+    virtual bool hasRange() const { return false; }
+
+    virtual float range() const { return 0; }
+
+    /*  Position of the light in projected meters, for lights with a range */
+    virtual glm::dvec3 worldPosition(const View& _view) const { return glm::dvec3(0.0); }
+
     /*  STATIC Function that compose sourceBlocks with Lights on a ProgramShader */
     static std::map<std::string, std::string>  assembleLights(const std::vector<std::unique_ptr<Light>>& _lights);
 
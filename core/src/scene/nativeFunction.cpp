@@ -0,0 +1,595 @@
+#include "scene/nativeFunction.h"
+
+#include "data/propertyItem.h"
+#include "data/tileData.h"
+#include "scene/filters.h"
+#include "scene/styleContext.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Tangram {
+
+using Result = NativeFunction::Result;
+using Op = NativeFunction::Op;
+
+bool Result::toBoolean() const {
+    switch (type) {
+    case boolean: return boolValue;
+    case number: return numberValue != 0 && !std::isnan(numberValue);
+    case string: return !stringValue.empty();
+    default: return false;
+    }
+}
+
+static void setNumber(Result& _result, double _value) {
+    _result.type = Result::number;
+    _result.numberValue = _value;
+}
+
+static void setBoolean(Result& _result, bool _value) {
+    _result.type = Result::boolean;
+    _result.boolValue = _value;
+}
+
+static void setValue(Result& _result, const Value& _value) {
+    if (_value.is<double>()) {
+        setNumber(_result, _value.get<double>());
+    } else if (_value.is<std::string>()) {
+        _result.type = Result::string;
+        _result.stringValue = _value.get<std::string>();
+    } else {
+        _result.type = Result::undefined;
+    }
+}
+
+// JS ToNumber. Returns false for strings that need the full JS number grammar.
+static bool toNumber(const Result& _result, double& _number) {
+    switch (_result.type) {
+    case Result::undefined: _number = NAN; return true;
+    case Result::null: _number = 0; return true;
+    case Result::boolean: _number = _result.boolValue ? 1 : 0; return true;
+    case Result::number: _number = _result.numberValue; return true;
+    case Result::string: break;
+    }
+
+    const std::string& str = _result.stringValue;
+    size_t begin = str.find_first_not_of(" \t\n\r");
+    if (begin == std::string::npos) {
+        _number = 0;
+        return true;
+    }
+    size_t end = str.find_last_not_of(" \t\n\r") + 1;
+
+    for (size_t i = begin; i < end; i++) {
+        if (!std::strchr("0123456789+-.eE", str[i])) { return false; }
+    }
+
+    std::string trimmed = str.substr(begin, end - begin);
+    char* last = nullptr;
+    double number = std::strtod(trimmed.c_str(), &last);
+    _number = (last == trimmed.c_str() + trimmed.size()) ? number : NAN;
+    return true;
+}
+
+// JS ToString. Returns false for numbers that are not plain integers,
+// which would need the JS number formatting.
+static bool toString(const Result& _result, std::string& _string) {
+    switch (_result.type) {
+    case Result::undefined: _string = "undefined"; return true;
+    case Result::null: _string = "null"; return true;
+    case Result::boolean: _string = _result.boolValue ? "true" : "false"; return true;
+    case Result::string: _string = _result.stringValue; return true;
+    case Result::number: break;
+    }
+
+    double number = _result.numberValue;
+    if (!std::isfinite(number) || std::floor(number) != number || std::fabs(number) >= 1e15) {
+        return false;
+    }
+    if (number == 0) { number = 0; } // -0
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.0f", number);
+    _string = buffer;
+    return true;
+}
+
+static bool strictEquals(const Result& _a, const Result& _b) {
+    if (_a.type != _b.type) { return false; }
+
+    switch (_a.type) {
+    case Result::boolean: return _a.boolValue == _b.boolValue;
+    case Result::number: return _a.numberValue == _b.numberValue;
+    case Result::string: return _a.stringValue == _b.stringValue;
+    default: return true;
+    }
+}
+
+static bool looseEquals(const Result& _a, const Result& _b, bool& _equal) {
+    if (_a.type == _b.type) {
+        _equal = strictEquals(_a, _b);
+        return true;
+    }
+    bool aNull = (_a.type == Result::undefined || _a.type == Result::null);
+    bool bNull = (_b.type == Result::undefined || _b.type == Result::null);
+    if (aNull || bNull) {
+        _equal = aNull && bNull;
+        return true;
+    }
+    double a, b;
+    if (!toNumber(_a, a) || !toNumber(_b, b)) { return false; }
+    _equal = (a == b);
+    return true;
+}
+
+static bool isAscii(const std::string& _str) {
+    for (char c : _str) {
+        if (static_cast<unsigned char>(c) >= 0x80) { return false; }
+    }
+    return true;
+}
+
+static bool compare(Op _op, const Result& _a, const Result& _b, bool& _out) {
+    int order;
+
+    if (_a.type == Result::string && _b.type == Result::string) {
+        // JS compares UTF-16 code units, which matches byte order only for ASCII
+        if (!isAscii(_a.stringValue) || !isAscii(_b.stringValue)) { return false; }
+        order = _a.stringValue.compare(_b.stringValue);
+    } else {
+        double a, b;
+        if (!toNumber(_a, a) || !toNumber(_b, b)) { return false; }
+        if (std::isnan(a) || std::isnan(b)) {
+            _out = false;
+            return true;
+        }
+        order = (a < b) ? -1 : (a > b) ? 1 : 0;
+    }
+
+    switch (_op) {
+    case Op::less: _out = order < 0; break;
+    case Op::less_equal: _out = order <= 0; break;
+    case Op::greater: _out = order > 0; break;
+    case Op::greater_equal: _out = order >= 0; break;
+    default: return false;
+    }
+    return true;
+}
+
+class NativeFunction::Parser {
+
+public:
+
+    Parser(const std::string& _source, NativeFunction& _function) :
+        m_source(_source), m_function(_function) {}
+
+    bool parseFunction() {
+        next();
+        if (!expectIdent("function") || !expect("(") || !expect(")") || !expect("{") ||
+            !expectIdent("return")) {
+            return false;
+        }
+        m_function.m_root = parseExpression();
+        if (isPunct(";")) { next(); }
+        if (!expect("}")) { return false; }
+        return m_ok && m_token.type == Token::end;
+    }
+
+private:
+
+    struct Token {
+        enum Type { end, number, string, ident, punct, invalid };
+        Type type = end;
+        std::string text;
+        double value = 0;
+    };
+
+    uint32_t fail() {
+        m_ok = false;
+        return 0;
+    }
+
+    uint32_t add(Op _op, uint32_t _a = 0, uint32_t _b = 0, uint32_t _c = 0) {
+        NativeFunction::Node node;
+        node.op = _op;
+        node.a = _a;
+        node.b = _b;
+        node.c = _c;
+        m_function.m_nodes.push_back(node);
+        return uint32_t(m_function.m_nodes.size() - 1);
+    }
+
+    uint32_t addConstant(const Result& _value) {
+        m_function.m_constants.push_back(_value);
+        return add(Op::constant, uint32_t(m_function.m_constants.size() - 1));
+    }
+
+    uint32_t addProperty(const std::string& _name) {
+        PropertyKey key(_name);
+        auto& keys = m_function.m_keys;
+        size_t index = 0;
+        while (index < keys.size() && keys[index] != key) { index++; }
+        if (index == keys.size()) { keys.push_back(key); }
+        return add(Op::property, uint32_t(index));
+    }
+
+    bool isPunct(const char* _text) const {
+        return m_token.type == Token::punct && m_token.text == _text;
+    }
+
+    bool expect(const char* _text) {
+        if (!isPunct(_text)) { return false; }
+        next();
+        return true;
+    }
+
+    bool expectIdent(const char* _text) {
+        if (m_token.type != Token::ident || m_token.text != _text) { return false; }
+        next();
+        return true;
+    }
+
+    static bool isIdentStart(char c) { return std::isalpha(c) || c == '_' || c == '$'; }
+    static bool isIdentChar(char c) { return std::isalnum(c) || c == '_' || c == '$'; }
+
+    void skipSpace() {
+        const size_t size = m_source.size();
+        while (m_pos < size) {
+            if (std::isspace(m_source[m_pos])) {
+                m_pos++;
+            } else if (m_source.compare(m_pos, 2, "//") == 0) {
+                m_pos = m_source.find('\n', m_pos);
+                if (m_pos == std::string::npos) { m_pos = size; }
+            } else if (m_source.compare(m_pos, 2, "/*") == 0) {
+                m_pos = m_source.find("*/", m_pos + 2);
+                m_pos = (m_pos == std::string::npos) ? size : m_pos + 2;
+            } else {
+                break;
+            }
+        }
+    }
+
+    void next() {
+        skipSpace();
+
+        const size_t size = m_source.size();
+        m_token = Token();
+
+        if (m_pos >= size) { return; }
+
+        char c = m_source[m_pos];
+
+        if (std::isdigit(c) || (c == '.' && m_pos + 1 < size && std::isdigit(m_source[m_pos + 1]))) {
+            // No legacy octal literals
+            if (c == '0' && m_pos + 1 < size && std::isdigit(m_source[m_pos + 1])) {
+                m_token.type = Token::invalid;
+                return;
+            }
+            const char* begin = m_source.c_str() + m_pos;
+            char* last = nullptr;
+            m_token.value = std::strtod(begin, &last);
+            m_pos += last - begin;
+            m_token.type = (m_pos < size && isIdentChar(m_source[m_pos]))
+                ? Token::invalid : Token::number;
+            return;
+        }
+
+        if (c == '\'' || c == '"') {
+            m_pos++;
+            while (m_pos < size && m_source[m_pos] != c) {
+                char ch = m_source[m_pos++];
+                if (ch == '\\') {
+                    if (m_pos >= size) { break; }
+                    char esc = m_source[m_pos++];
+                    switch (esc) {
+                    case 'n': ch = '\n'; break;
+                    case 't': ch = '\t'; break;
+                    case '\\': case '\'': case '"': ch = esc; break;
+                    default:
+                        m_token.type = Token::invalid;
+                        return;
+                    }
+                }
+                m_token.text += ch;
+            }
+            if (m_pos >= size) {
+                m_token.type = Token::invalid;
+                return;
+            }
+            m_pos++;
+            m_token.type = Token::string;
+            return;
+        }
+
+        if (isIdentStart(c)) {
+            size_t start = m_pos;
+            while (m_pos < size && isIdentChar(m_source[m_pos])) { m_pos++; }
+            m_token.type = Token::ident;
+            m_token.text = m_source.substr(start, m_pos - start);
+            return;
+        }
+
+        static const char* punctuators[] = {
+            "===", "!==", "==", "!=", "<=", ">=", "&&", "||",
+            "(", ")", "{", "}", "[", "]", ".", ";", "?", ":",
+            "+", "-", "*", "/", "%", "<", ">", "!",
+        };
+        for (const char* p : punctuators) {
+            size_t length = std::strlen(p);
+            if (m_source.compare(m_pos, length, p) == 0) {
+                m_pos += length;
+                m_token.type = Token::punct;
+                m_token.text = p;
+                return;
+            }
+        }
+        m_token.type = Token::invalid;
+    }
+
+    uint32_t parseExpression() {
+        uint32_t condition = parseBinary(0);
+        if (!isPunct("?")) { return condition; }
+        next();
+        uint32_t a = parseExpression();
+        if (!expect(":")) { return fail(); }
+        uint32_t b = parseExpression();
+        return add(Op::conditional, condition, a, b);
+    }
+
+    // Binary operators by increasing precedence
+    uint32_t parseBinary(int _level) {
+        static const std::vector<std::vector<std::pair<const char*, Op>>> levels = {
+            { { "||", Op::logical_or } },
+            { { "&&", Op::logical_and } },
+            { { "===", Op::strict_equal }, { "!==", Op::strict_not_equal },
+              { "==", Op::equal }, { "!=", Op::not_equal } },
+            { { "<=", Op::less_equal }, { ">=", Op::greater_equal },
+              { "<", Op::less }, { ">", Op::greater } },
+            { { "+", Op::add }, { "-", Op::subtract } },
+            { { "*", Op::multiply }, { "/", Op::divide }, { "%", Op::modulo } },
+        };
+
+        if (_level == int(levels.size())) { return parseUnary(); }
+
+        uint32_t lhs = parseBinary(_level + 1);
+
+        while (m_ok) {
+            bool found = false;
+            for (auto& op : levels[_level]) {
+                if (isPunct(op.first)) {
+                    next();
+                    uint32_t rhs = parseBinary(_level + 1);
+                    lhs = add(op.second, lhs, rhs);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) { break; }
+        }
+        return lhs;
+    }
+
+    uint32_t parseUnary() {
+        if (isPunct("!")) {
+            next();
+            return add(Op::logical_not, parseUnary());
+        }
+        if (isPunct("-")) {
+            next();
+            return add(Op::negate, parseUnary());
+        }
+        if (isPunct("+")) {
+            next();
+            return add(Op::plus, parseUnary());
+        }
+        return parsePrimary();
+    }
+
+    uint32_t parsePrimary() {
+        Token token = m_token;
+
+        switch (token.type) {
+        case Token::number: {
+            next();
+            Result value;
+            setNumber(value, token.value);
+            return addConstant(value);
+        }
+        case Token::string: {
+            next();
+            Result value;
+            value.type = Result::string;
+            value.stringValue = token.text;
+            return addConstant(value);
+        }
+        case Token::punct:
+            if (token.text == "(") {
+                next();
+                uint32_t node = parseExpression();
+                if (!expect(")")) { return fail(); }
+                return node;
+            }
+            return fail();
+
+        case Token::ident:
+            break;
+
+        default:
+            return fail();
+        }
+
+        next();
+        const std::string& name = token.text;
+        Result value;
+
+        if (name == "feature") {
+            if (isPunct(".")) {
+                next();
+                if (m_token.type != Token::ident) { return fail(); }
+                std::string key = m_token.text;
+                next();
+                return addProperty(key);
+            }
+            if (isPunct("[")) {
+                next();
+                if (m_token.type != Token::string) { return fail(); }
+                std::string key = m_token.text;
+                next();
+                if (!expect("]")) { return fail(); }
+                return addProperty(key);
+            }
+            return fail();
+        }
+        if (name == "$zoom") { return add(Op::zoom); }
+        if (name == "$geometry") { return add(Op::geometry); }
+
+        if (name == "true" || name == "false") {
+            setBoolean(value, name == "true");
+        } else if (name == "null") {
+            value.type = Result::null;
+        } else if (name == "undefined") {
+            value.type = Result::undefined;
+        } else if (name == "point") {
+            setNumber(value, GeometryType::points);
+        } else if (name == "line") {
+            setNumber(value, GeometryType::lines);
+        } else if (name == "polygon") {
+            setNumber(value, GeometryType::polygons);
+        } else {
+            return fail();
+        }
+        return addConstant(value);
+    }
+
+    const std::string& m_source;
+    NativeFunction& m_function;
+
+    size_t m_pos = 0;
+    Token m_token;
+    bool m_ok = true;
+};
+
+std::unique_ptr<NativeFunction> NativeFunction::compile(const std::string& _source) {
+    auto function = std::make_unique<NativeFunction>();
+
+    Parser parser(_source, *function);
+    if (!parser.parseFunction()) { return nullptr; }
+
+    return function;
+}
+
+bool NativeFunction::eval(const Feature* _feature, const StyleContext& _ctx, Result& _result) const {
+    return eval(m_root, _feature, _ctx, _result);
+}
+
+bool NativeFunction::eval(uint32_t _node, const Feature* _feature, const StyleContext& _ctx,
+                          Result& _result) const {
+
+    const Node& node = m_nodes[_node];
+
+    switch (node.op) {
+    case Op::constant:
+        _result = m_constants[node.a];
+        return true;
+
+    case Op::property:
+        if (!_feature) { return false; }
+        setValue(_result, _feature->props.get(m_keys[node.a]));
+        return true;
+
+    case Op::zoom:
+    case Op::geometry: {
+        auto& value = _ctx.getKeyword(node.op == Op::zoom ? FilterKeyword::zoom : FilterKeyword::geometry);
+        // Unset keywords are not defined in the JS context either
+        if (value.is<none_type>()) { return false; }
+        setValue(_result, value);
+        return true;
+    }
+    case Op::negate:
+    case Op::plus: {
+        double value;
+        if (!eval(node.a, _feature, _ctx, _result) || !toNumber(_result, value)) { return false; }
+        setNumber(_result, node.op == Op::negate ? -value : value);
+        return true;
+    }
+    case Op::logical_not:
+        if (!eval(node.a, _feature, _ctx, _result)) { return false; }
+        setBoolean(_result, !_result.toBoolean());
+        return true;
+
+    case Op::logical_and:
+    case Op::logical_or:
+        if (!eval(node.a, _feature, _ctx, _result)) { return false; }
+        if (_result.toBoolean() == (node.op == Op::logical_or)) { return true; }
+        return eval(node.b, _feature, _ctx, _result);
+
+    case Op::conditional:
+        if (!eval(node.a, _feature, _ctx, _result)) { return false; }
+        return eval(_result.toBoolean() ? node.b : node.c, _feature, _ctx, _result);
+
+    default:
+        break;
+    }
+
+    // Binary operators
+    Result rhs;
+    if (!eval(node.a, _feature, _ctx, _result) || !eval(node.b, _feature, _ctx, rhs)) {
+        return false;
+    }
+
+    switch (node.op) {
+    case Op::add:
+        if (_result.type == Result::string || rhs.type == Result::string) {
+            std::string a, b;
+            if (!toString(_result, a) || !toString(rhs, b)) { return false; }
+            _result.type = Result::string;
+            _result.stringValue = a + b;
+            return true;
+        }
+        // fall through
+    case Op::subtract:
+    case Op::multiply:
+    case Op::divide:
+    case Op::modulo: {
+        double a, b;
+        if (!toNumber(_result, a) || !toNumber(rhs, b)) { return false; }
+        switch (node.op) {
+        case Op::add: setNumber(_result, a + b); break;
+        case Op::subtract: setNumber(_result, a - b); break;
+        case Op::multiply: setNumber(_result, a * b); break;
+        case Op::divide: setNumber(_result, a / b); break;
+        default: setNumber(_result, std::fmod(a, b)); break;
+        }
+        return true;
+    }
+    case Op::less:
+    case Op::less_equal:
+    case Op::greater:
+    case Op::greater_equal: {
+        bool out;
+        if (!compare(node.op, _result, rhs, out)) { return false; }
+        setBoolean(_result, out);
+        return true;
+    }
+    case Op::equal:
+    case Op::not_equal: {
+        bool equal;
+        if (!looseEquals(_result, rhs, equal)) { return false; }
+        setBoolean(_result, equal == (node.op == Op::equal));
+        return true;
+    }
+    case Op::strict_equal:
+    case Op::strict_not_equal: {
+        bool equal = strictEquals(_result, rhs);
+        setBoolean(_result, equal == (node.op == Op::strict_equal));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+}
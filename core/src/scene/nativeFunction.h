@@ -0,0 +1,91 @@
+#pragma once
+
+#include "data/propertyKey.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+class StyleContext;
+struct Feature;
+
+/* Native evaluation of simple JS scene functions
+ *
+ * Recognizes functions of the form 'function() { return <expression>; }'
+ * where the expression only uses number, string and boolean literals,
+ * feature properties, $zoom, $geometry, the geometry constants and the
+ * arithmetic, comparison, logical and conditional operators. Evaluation
+ * follows JS semantics; StyleContext falls back to duktape for all other
+ * functions.
+ */
+class NativeFunction {
+
+public:
+
+    struct Result {
+        enum Type : uint8_t { undefined, null, boolean, number, string };
+
+        Type type = undefined;
+        bool boolValue = false;
+        double numberValue = 0;
+        std::string stringValue;
+
+        bool toBoolean() const;
+    };
+
+    /* Returns nullptr when _source is outside of the supported subset */
+    static std::unique_ptr<NativeFunction> compile(const std::string& _source);
+
+    /* Evaluate for _feature in the keyword state of _ctx. Returns false when
+     * the result depends on something only duktape handles, e.g. formatting a
+     * fractional number as string, or an unset keyword. */
+    bool eval(const Feature* _feature, const StyleContext& _ctx, Result& _result) const;
+
+    enum class Op : uint8_t {
+        constant,   // a: index into m_constants
+        property,   // a: index into m_keys
+        zoom,
+        geometry,
+        negate,
+        plus,
+        logical_not,
+        add,
+        subtract,
+        multiply,
+        divide,
+        modulo,
+        less,
+        less_equal,
+        greater,
+        greater_equal,
+        equal,
+        not_equal,
+        strict_equal,
+        strict_not_equal,
+        logical_and,
+        logical_or,
+        conditional,
+    };
+
+    struct Node {
+        Op op;
+        // Operand nodes or constant/key index
+        uint32_t a = 0, b = 0, c = 0;
+    };
+
+private:
+
+    class Parser;
+
+    bool eval(uint32_t _node, const Feature* _feature, const StyleContext& _ctx, Result& _result) const;
+
+    std::vector<Node> m_nodes;
+    uint32_t m_root = 0;
+
+    std::vector<Result> m_constants;
+    std::vector<PropertyKey> m_keys;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "scene/pointLight.h"
 
 #include "gl/shaderProgram.h"
+#include "gl/uniformBuffer.h"
 #include "platform.h"
 #include "pointLight_glsl.h"
 #include "util/floatFormatter.h"
@@ -46,9 +47,7 @@ std::unique_ptr<LightUniforms> PointLight::getUniforms() {
     return std::make_unique<Uniforms>(getUniformName());
 }
 
-void PointLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
-                              LightUniforms& _uniforms) {
-    Light::setupProgram(rs, _view, _shader, _uniforms);
+glm::vec4 PointLight::viewPosition(const View& _view) const {
 
     glm::vec4 position = glm::vec4(m_position.value, 0.0);
 
@@ -79,6 +78,24 @@ void PointLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram&
         position = _view.getViewMatrix() * position;
     }
 
+    return position;
+}
+
+glm::dvec3 PointLight::worldPosition(const View& _view) const {
+
+    // Rotate the vector from the eye back to world axes
+    glm::vec3 position = glm::transpose(glm::mat3(_view.getViewMatrix())) * glm::vec3(viewPosition(_view));
+
+    const auto& eye = _view.getEye();
+    return _view.getPosition() + glm::dvec3(eye.x, eye.y, 0.0) + glm::dvec3(position.x, position.y, position.z + eye.z);
+}
+
+void PointLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
+                              LightUniforms& _uniforms) {
+    Light::setupProgram(rs, _view, _shader, _uniforms);
+
+    glm::vec4 position = viewPosition(_view);
+
     auto& u = static_cast<Uniforms&>(_uniforms);
 
     _shader.setUniformf(rs, u.position, position);
@@ -96,6 +113,15 @@ void PointLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram&
     }
 }
 
+void PointLight::setupUniformBuffer(const View& _view, UniformBuffer& _buffer) {
+    Light::setupUniformBuffer(_view, _buffer);
+
+    _buffer.add(viewPosition(_view));
+    _buffer.add(m_attenuation);
+    _buffer.add(m_innerRadius);
+    _buffer.add(m_outerRadius);
+}
+
 std::string PointLight::getClassBlock() {
     return SHADER_SOURCE(pointLight_glsl);
 }
@@ -121,15 +147,9 @@ std::string PointLight::getInstanceAssignBlock() {
     std::string block = Light::getInstanceAssignBlock();
     if (!m_dynamic) {
         block += ", " + ff::to_string(m_position.value);
-        if (m_attenuation!=0.0) {
-            block += ", " + ff::to_string(m_attenuation);
-        }
-        if (m_innerRadius!=0.0) {
-            block += ", " + ff::to_string(m_innerRadius);
-        }
-        if (m_outerRadius!=0.0) {
-            block += ", " + ff::to_string(m_outerRadius);
-        }
+        block += ", " + ff::to_string(m_attenuation);
+        block += ", " + ff::to_string(m_innerRadius);
+        block += ", " + ff::to_string(m_outerRadius);
         block += ")";
     }
     return block;
@@ -24,11 +24,20 @@ public:
     virtual void setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
                               LightUniforms& _uniforms) override;
 
+    virtual void setupUniformBuffer(const View& _view, UniformBuffer& _buffer) override;
+
+    // The attenuation reaches zero at the outer radius
+    virtual bool hasRange() const override { return m_outerRadius > 0; }
+
+    virtual float range() const override { return m_outerRadius; }
+
+    virtual glm::dvec3 worldPosition(const View& _view) const override;
+
     struct Uniforms : public LightUniforms {
         Uniforms(const std::string& _name)
             : LightUniforms(_name),
               position(_name+".position"),
-              attenuation(_name+".attenuation"),
+              attenuation(_name+".attenuationExponent"),
               innerRadius(_name+".innerRadius"),
               outerRadius(_name+".outerRadius") {}
 
@@ -44,6 +53,9 @@ public:
 
 protected:
 
+    /*  Position of the light in camera space */
+    glm::vec4 viewPosition(const View& _view) const;
+
     /*  GLSL block code with structs and need functions for this light type */
     virtual std::string getClassBlock() override;
     virtual std::string getInstanceDefinesBlock() override;
@@ -2,15 +2,19 @@
 
 #include "data/tileSource.h"
 #include "gl/shaderProgram.h"
+#include "labels/labelLayout.h"
 #include "scene/dataLayer.h"
 #include "scene/importer.h"
 #include "scene/light.h"
 #include "scene/spriteAtlas.h"
 #include "scene/stops.h"
+#include "scene/styleContext.h"
 #include "selection/featureSelection.h"
+#include "selection/featureStates.h"
 #include "style/material.h"
 #include "style/style.h"
 #include "text/fontContext.h"
+#include "util/hash.h"
 #include "util/mapProjection.h"
 #include "util/util.h"
 #include "util/zipArchive.h"
@@ -27,7 +31,9 @@ Scene::Scene(std::shared_ptr<const Platform> _platform, const Url& _url)
     : id(s_serial++),
       m_url(_url),
       m_fontContext(std::make_shared<FontContext>(_platform)),
-      m_featureSelection(std::make_unique<FeatureSelection>()) {
+      m_featureSelection(std::make_unique<FeatureSelection>()),
+      m_featureStates(std::make_unique<FeatureStates>()),
+      m_labelLayouts(std::make_unique<LabelLayoutCache>()) {
 
     // For now we only have one projection..
     // TODO how to share projection with view?
@@ -37,7 +43,9 @@ Scene::Scene(std::shared_ptr<const Platform> _platform, const Url& _url)
 Scene::Scene(std::shared_ptr<const Platform> _platform, const std::string& _yaml, const Url& _url)
     : id(s_serial++),
       m_fontContext(std::make_shared<FontContext>(_platform)),
-      m_featureSelection(std::make_unique<FeatureSelection>()) {
+      m_featureSelection(std::make_unique<FeatureSelection>()),
+      m_featureStates(std::make_unique<FeatureStates>()),
+      m_labelLayouts(std::make_unique<LabelLayoutCache>()) {
 
     m_url = _url;
     m_yaml = _yaml;
@@ -48,6 +56,8 @@ Scene::Scene(std::shared_ptr<const Platform> _platform, const std::string& _yaml
 void Scene::copyConfig(const Scene& _other) {
 
     m_featureSelection.reset(new FeatureSelection());
+    m_featureStates.reset(new FeatureStates());
+    m_labelLayouts.reset(new LabelLayoutCache());
 
     m_config = YAML::Clone(_other.m_config);
     m_fontContext = _other.m_fontContext;
@@ -84,26 +94,9 @@ Style* Scene::findStyle(const std::string& _name) {
 UrlRequestHandle Scene::startUrlRequest(std::shared_ptr<Platform> platform, Url url, UrlCallback callback) {
     if (url.scheme() == "zip") {
         UrlResponse response;
-        // URL for a file in a zip archive, get the encoded source URL.
-        auto source = Importer::getArchiveUrlForZipEntry(url);
-        // Search for the source URL in our archive map.
-        auto it = m_zipArchives.find(source);
-        if (it != m_zipArchives.end()) {
-            auto& archive = it->second;
-            // Found the archive! Now create a response for the request.
-            auto zipEntryPath = url.path().substr(1);
-            auto entry = archive->findEntry(zipEntryPath);
-            if (entry) {
-                response.content.resize(entry->uncompressedSize);
-                bool success = archive->decompressEntry(entry, response.content.data());
-                if (!success) {
-                    response.error = "Unable to decompress zip archive file.";
-                }
-            } else {
-                response.error = "Did not find zip archive entry.";
-            }
-        } else {
-            response.error = "Could not find zip archive.";
+        auto data = readZipEntry(url, response.error);
+        if (!response.error) {
+            response.content.assign(data.begin(), data.end());
         }
         callback(response);
         return 0;
@@ -117,6 +110,30 @@ void Scene::addZipArchive(Url url, std::shared_ptr<ZipArchive> zipArchive) {
     m_zipArchives.emplace(url, zipArchive);
 }
 
+ByteBuffer Scene::readZipEntry(const Url& _url, const char*& _error) {
+    _error = nullptr;
+    // URL for a file in a zip archive, get the encoded source URL.
+    auto source = Importer::getArchiveUrlForZipEntry(_url);
+    // Search for the source URL in our archive map.
+    auto it = m_zipArchives.find(source);
+    if (it == m_zipArchives.end()) {
+        _error = "Could not find zip archive.";
+        return {};
+    }
+    auto& archive = it->second;
+    auto entry = archive->findEntry(_url.path().substr(1));
+    if (!entry) {
+        _error = "Did not find zip archive entry.";
+        return {};
+    }
+    // Compressed entries are inflated on the thread that requests them
+    auto data = archive->entryBuffer(entry);
+    if (data.empty() && entry->uncompressedSize > 0) {
+        _error = "Unable to decompress zip archive file.";
+    }
+    return data;
+}
+
 int Scene::addIdForName(const std::string& _name) {
     int id = getIdForName(_name);
 
@@ -143,6 +160,14 @@ int Scene::addJsFunction(const std::string& _function) {
     return m_jsFunctions.size()-1;
 }
 
+const Scene::CompiledFunctions& Scene::compiledFunctions() const {
+    std::call_once(m_jsCompileOnce, [this]() {
+        m_jsCompiled.sources = m_jsFunctions;
+        m_jsCompiled.bytecode = StyleContext::compileFunctions(m_jsFunctions);
+    });
+    return m_jsCompiled;
+}
+
 const Light* Scene::findLight(const std::string &_name) const {
     for (auto& light : m_lights) {
         if (light->getInstanceName() == _name) { return light.get(); }
@@ -150,6 +175,33 @@ const Light* Scene::findLight(const std::string &_name) const {
     return nullptr;
 }
 
+std::shared_ptr<ShaderProgram> Scene::shaderProgram(const std::string& _vertSrc, const std::string& _fragSrc,
+                                                   const std::string& _description) const {
+    size_t hash = 0;
+    hash_combine(hash, _vertSrc);
+    hash_combine(hash, _fragSrc);
+
+    auto& programs = m_shaderPrograms[hash];
+    for (auto& program : programs) {
+        if (program->vertexShaderSource() == _vertSrc &&
+            program->fragmentShaderSource() == _fragSrc) {
+            return program;
+        }
+    }
+
+    auto program = std::make_shared<ShaderProgram>();
+    program->setDescription(_description);
+    program->setShaderSource(_vertSrc, _fragSrc);
+    programs.push_back(program);
+    return program;
+}
+
+size_t Scene::shaderProgramCount() const {
+    size_t count = 0;
+    for (auto& entry : m_shaderPrograms) { count += entry.second.size(); }
+    return count;
+}
+
 std::shared_ptr<Texture> Scene::getTexture(const std::string& textureName) const {
     auto texIt = m_textures.find(textureName);
     if (texIt == m_textures.end()) {
@@ -182,6 +234,9 @@ void Scene::setPixelScale(float _scale) {
         style->setPixelScale(_scale);
     }
     m_fontContext->setPixelScale(_scale);
+
+    // Layouts were placed with the label sizes of the previous scale
+    m_labelLayouts->clear();
 }
 
 }
@@ -2,6 +2,8 @@
 
 #include "map.h"
 #include "platform.h"
+#include "scene/spriteAtlas.h"
+#include "util/byteBuffer.h"
 #include "util/color.h"
 #include "util/url.h"
 #include "util/yamlHelper.h"
@@ -9,6 +11,7 @@
 
 #include <atomic>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -21,13 +24,17 @@
 
 namespace Tangram {
 
+class DashAtlas;
 class DataLayer;
 class FeatureSelection;
+class FeatureStates;
+class LabelLayoutCache;
 class FontContext;
 class Light;
 class MapProjection;
 class Platform;
 class SceneLayer;
+class ShaderProgram;
 class Style;
 class Texture;
 class TileSource;
@@ -62,6 +69,18 @@ public:
 
     Camera m_camera;
 
+    /* Content hash of the resolved scene, computed by SceneLoader::applyConfig.
+     * Caches of data derived from the scene key their entries on it; the
+     * digests of styles and sources let them invalidate only what changed. */
+    struct Fingerprint {
+        // Configuration including textures and fonts, and the styles below
+        std::string scene;
+        // Style definition and its shader sources, by style name
+        std::map<std::string, std::string> styles;
+        // Source definition, by source name
+        std::map<std::string, std::string> sources;
+    };
+
     enum animate {
         yes, no, none
     };
@@ -85,12 +104,16 @@ public:
     auto& lights() { return m_lights; }
     auto& lightBlocks() { return m_lightShaderBlocks; }
     auto& textures() { return m_textures; }
+    auto& dashAtlas() { return m_dashAtlas; }
     auto& functions() { return m_jsFunctions; }
     auto& stops() { return m_stops; }
     auto& background() { return m_background; }
     auto& fontContext() { return m_fontContext; }
     auto& globalRefs() { return m_globalRefs; }
     auto& featureSelection() { return m_featureSelection; }
+    auto& featureStates() { return m_featureStates; }
+    auto& labelLayouts() { return m_labelLayouts; }
+    auto& spriteNames() { return m_spriteNames; }
     Style* findStyle(const std::string& _name);
 
     const auto& url() const { return m_url; }
@@ -106,11 +129,24 @@ public:
     const auto& fontContext() const { return m_fontContext; }
     const auto& globalRefs() const { return m_globalRefs; }
     const auto& featureSelection() const { return m_featureSelection; }
+    const auto& featureStates() const { return m_featureStates; }
+    const auto& fingerprint() const { return m_fingerprint; }
+    void setFingerprint(Fingerprint _fingerprint) { m_fingerprint = std::move(_fingerprint); }
 
     const Style* findStyle(const std::string& _name) const;
 
     const Light* findLight(const std::string& _name) const;
 
+    /* Returns the program of the given sources, shared by all styles that
+     * build the same sources after mixing and define expansion, so that each
+     * unique program is compiled and linked once. Creates the program with
+     * _description when there is none yet. */
+    std::shared_ptr<ShaderProgram> shaderProgram(const std::string& _vertSrc, const std::string& _fragSrc,
+                                                 const std::string& _description) const;
+
+    /* Number of unique programs returned by shaderProgram() */
+    size_t shaderProgramCount() const;
+
     // Start an asynchronous request for the scene resource at the given URL.
     // In addition to the URL types supported by the platform instance, this
     // also supports a custom ZIP URL scheme. ZIP URLs are of the form:
@@ -125,6 +161,11 @@ public:
 
     void addZipArchive(Url url, std::shared_ptr<ZipArchive> zipArchive);
 
+    // Data of the file at the ZIP URL _url, read in place from the archive
+    // when it is stored without compression. Returns an empty buffer and sets
+    // _error when it can't be read.
+    ByteBuffer readZipEntry(const Url& _url, const char*& _error);
+
     void updateTime(float _dt) { m_time += _dt; }
     float time() const { return m_time; }
 
@@ -133,7 +174,27 @@ public:
 
     int addJsFunction(const std::string& _function);
 
+    struct CompiledFunctions {
+        std::vector<std::string> sources;
+        std::vector<std::string> bytecode;
+    };
+
+    // Snapshot of functions() with their bytecode, compiled on first use
+    // and shared by the StyleContexts of all workers. Functions that are
+    // added later, e.g. for marker styling, are not part of it.
+    const CompiledFunctions& compiledFunctions() const;
+
     bool useScenePosition = true;
+
+    // File of the binary scene cache, see SceneCache. Empty to always
+    // load the scene from YAML.
+    std::string cachePath;
+    // File of precomputed glyph SDFs, see FontContext::setGlyphBundle
+    std::string glyphBundlePath;
+    // Limits of the map that loads the scene, see ResourceProfile
+    size_t sourceCacheSize = 16 * 1024 * 1024;
+    size_t maxGlyphTextures = 64;
+    bool compactRasters = false;
     glm::dvec2 startPosition = { 0, 0 };
     float startZoom = 0;
 
@@ -145,7 +206,7 @@ public:
 
     std::shared_ptr<Texture> getTexture(const std::string& name) const;
 
-    float pixelScale() { return m_pixelScale; }
+    float pixelScale() const { return m_pixelScale; }
     void setPixelScale(float _scale);
 
     std::atomic_ushort pendingTextures{0};
@@ -163,6 +224,8 @@ private:
     // The root node of the YAML scene configuration
     YAML::Node m_config;
 
+    Fingerprint m_fingerprint;
+
     std::unique_ptr<MapProjection> m_mapProjection;
 
     std::vector<DataLayer> m_layers;
@@ -174,6 +237,9 @@ private:
 
     std::unordered_map<std::string, std::shared_ptr<Texture>> m_textures;
 
+    // Dash patterns of all polyline styles
+    std::shared_ptr<DashAtlas> m_dashAtlas;
+
     // Container for any zip archives needed for the scene. For each entry, the
     // key is the original URL from which the zip archive was retrieved and the
     // value is a ZipArchive initialized with the compressed archive data.
@@ -189,6 +255,9 @@ private:
     std::vector<std::string> m_names;
 
     std::vector<std::string> m_jsFunctions;
+
+    mutable std::once_flag m_jsCompileOnce;
+    mutable CompiledFunctions m_jsCompiled;
     std::list<Stops> m_stops;
 
     Color m_background;
@@ -197,6 +266,18 @@ private:
 
     std::unique_ptr<FeatureSelection> m_featureSelection;
 
+    // Set by Map::setFeatureState, selection colors refer to the tiles of this scene
+    std::unique_ptr<FeatureStates> m_featureStates;
+
+    // Results of the label collision pass of recently built tiles
+    std::unique_ptr<LabelLayoutCache> m_labelLayouts;
+
+    // Handles of the sprite names of atlases and draw rules
+    SpriteNames m_spriteNames;
+
+    // Programs of the styles by the hash of their sources, filled while styles are built
+    mutable std::unordered_map<size_t, std::vector<std::shared_ptr<ShaderProgram>>> m_shaderPrograms;
+
     animate m_animated = none;
 
     float m_pixelScale = 1.0f;
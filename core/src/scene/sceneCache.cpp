@@ -0,0 +1,243 @@
+#include "scene/sceneCache.h"
+
+#include "log.h"
+#include "platform.h"
+#include "scene/importer.h"
+#include "scene/scene.h"
+
+#include "hash-library/md5.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Tangram {
+
+static const char MAGIC[4] = { 'T', 'G', 'S', 'C' };
+
+enum NodeTag : uint8_t { tag_null, tag_scalar, tag_sequence, tag_map };
+
+static void putU32(std::string& _out, uint32_t _value) {
+    _out.append(reinterpret_cast<const char*>(&_value), sizeof(_value));
+}
+
+static void putString(std::string& _out, const std::string& _value) {
+    putU32(_out, _value.size());
+    _out.append(_value);
+}
+
+static bool getU32(const char*& _pos, const char* _end, uint32_t& _value) {
+    if (size_t(_end - _pos) < sizeof(_value)) { return false; }
+    std::memcpy(&_value, _pos, sizeof(_value));
+    _pos += sizeof(_value);
+    return true;
+}
+
+static bool getString(const char*& _pos, const char* _end, std::string& _value) {
+    uint32_t size = 0;
+    if (!getU32(_pos, _end, size) || size_t(_end - _pos) < size) { return false; }
+    _value.assign(_pos, size);
+    _pos += size;
+    return true;
+}
+
+std::string SceneCache::digest(const char* _data, size_t _size) {
+    MD5 md5;
+    return md5(_data, _size);
+}
+
+bool SceneCache::encode(const YAML::Node& _node, std::string& _out) {
+    switch (_node.Type()) {
+    case YAML::NodeType::Scalar:
+        _out.push_back(tag_scalar);
+        putString(_out, _node.Scalar());
+        return true;
+
+    case YAML::NodeType::Sequence:
+        _out.push_back(tag_sequence);
+        putU32(_out, _node.size());
+        for (const auto& entry : _node) {
+            if (!encode(entry, _out)) { return false; }
+        }
+        return true;
+
+    case YAML::NodeType::Map:
+        _out.push_back(tag_map);
+        putU32(_out, _node.size());
+        for (const auto& entry : _node) {
+            if (!entry.first.IsScalar()) { return false; }
+            putString(_out, entry.first.Scalar());
+            if (!encode(entry.second, _out)) { return false; }
+        }
+        return true;
+
+    default:
+        _out.push_back(tag_null);
+        return true;
+    }
+}
+
+bool SceneCache::decode(const char*& _pos, const char* _end, YAML::Node& _node) {
+    if (_pos == _end) { return false; }
+
+    uint8_t tag = *_pos++;
+    uint32_t size = 0;
+
+    switch (tag) {
+    case tag_null:
+        _node = YAML::Node(YAML::NodeType::Null);
+        return true;
+
+    case tag_scalar: {
+        std::string scalar;
+        if (!getString(_pos, _end, scalar)) { return false; }
+        _node = YAML::Node(scalar);
+        return true;
+    }
+    case tag_sequence:
+        if (!getU32(_pos, _end, size)) { return false; }
+        _node = YAML::Node(YAML::NodeType::Sequence);
+        for (uint32_t i = 0; i < size; i++) {
+            YAML::Node entry;
+            if (!decode(_pos, _end, entry)) { return false; }
+            _node.push_back(entry);
+        }
+        return true;
+
+    case tag_map:
+        if (!getU32(_pos, _end, size)) { return false; }
+        _node = YAML::Node(YAML::NodeType::Map);
+        for (uint32_t i = 0; i < size; i++) {
+            std::string key;
+            YAML::Node value;
+            if (!getString(_pos, _end, key) || !decode(_pos, _end, value)) { return false; }
+            _node[key] = value;
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool SceneCache::write(const Scene& _scene, const std::string& _path,
+                       const Digests& _digests, const YAML::Node& _config) {
+
+    std::string data(MAGIC, sizeof(MAGIC));
+    putU32(data, VERSION);
+    putString(data, _scene.url().string());
+
+    putU32(data, _digests.size());
+    for (auto& entry : _digests) {
+        if (Importer::isZipArchiveUrl(entry.first)) { return false; }
+        putString(data, entry.first.string());
+        putString(data, entry.second);
+    }
+
+    if (!encode(_config, data)) {
+        LOGW("Scene cache: configuration can not be cached");
+        return false;
+    }
+
+    // Write to a temporary file and rename, so that readers never see
+    // partially written caches
+    std::string tmpPath = _path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) { return false; }
+
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok &= fclose(file) == 0;
+
+    if (!ok || rename(tmpPath.c_str(), _path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        LOGW("Scene cache: could not write '%s'", _path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SceneCache::read(const std::shared_ptr<Platform>& _platform, Scene& _scene,
+                      const std::string& _path, YAML::Node& _config) {
+
+    FILE* file = fopen(_path.c_str(), "rb");
+    if (!file) { return false; }
+
+    std::vector<char> data;
+    char buffer[16 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+
+    const char* pos = data.data();
+    const char* end = pos + data.size();
+
+    uint32_t version = 0;
+    std::string rootUrl;
+    uint32_t count = 0;
+
+    if (data.size() < sizeof(MAGIC) || std::memcmp(pos, MAGIC, sizeof(MAGIC)) != 0) { return false; }
+    pos += sizeof(MAGIC);
+
+    if (!getU32(pos, end, version) || version != VERSION) { return false; }
+    if (!getString(pos, end, rootUrl) || rootUrl != _scene.url().string()) { return false; }
+    if (!getU32(pos, end, count)) { return false; }
+
+    std::vector<std::pair<Url, std::string>> sources;
+    for (uint32_t i = 0; i < count; i++) {
+        std::string url, digest;
+        if (!getString(pos, end, url) || !getString(pos, end, digest)) { return false; }
+        sources.emplace_back(Url(url), std::move(digest));
+    }
+
+    // Fetch all scene files at once and compare them with their digests
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t pending = 0;
+    bool unchanged = true;
+
+    for (auto& source : sources) {
+        if (source.first == _scene.url() && !_scene.yaml().empty()) {
+            auto& yaml = _scene.yaml();
+            unchanged &= digest(yaml.data(), yaml.size()) == source.second;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+        }
+        const std::string* expected = &source.second;
+        _scene.startUrlRequest(_platform, source.first, [&, expected](UrlResponse response) {
+            bool match = !response.error &&
+                digest(response.content.data(), response.content.size()) == *expected;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            unchanged &= match;
+            pending--;
+            condition.notify_all();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]{ return pending == 0; });
+    }
+
+    if (!unchanged) {
+        LOG("Scene cache: scene files changed, loading from YAML");
+        return false;
+    }
+
+    if (!decode(pos, end, _config) || pos != end) {
+        LOGW("Scene cache: invalid data in '%s'", _path.c_str());
+        _config = YAML::Node();
+        return false;
+    }
+    return true;
+}
+
+}
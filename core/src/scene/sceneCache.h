@@ -0,0 +1,54 @@
+#pragma once
+
+#include "util/url.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Tangram {
+
+class Platform;
+class Scene;
+
+/* Binary cache of a resolved scene configuration
+ *
+ * Stores the scene YAML after all imports were fetched, merged and their
+ * URLs resolved, together with the MD5 digest of every scene file it was
+ * built from. When loading from the cache the files are fetched
+ * concurrently and compared with the recorded digests; only when all of
+ * them are unchanged the configuration is read back from the binary form
+ * instead of parsing and merging the YAML files.
+ *
+ * The file starts with a magic and VERSION, files written by another
+ * version are ignored.
+ */
+class SceneCache {
+
+public:
+
+    static const uint32_t VERSION = 1;
+
+    // Digests of scene files by URL, as recorded by the Importer
+    using Digests = std::unordered_map<Url, std::string>;
+
+    /* Returns false when the cache at _path does not exist, has another
+     * version, or was written for other scene files than those of _scene */
+    static bool read(const std::shared_ptr<Platform>& _platform, Scene& _scene,
+                     const std::string& _path, YAML::Node& _config);
+
+    /* Write _config of _scene to _path. Scenes loaded from zip archives or
+     * with non-scalar map keys are not cached. */
+    static bool write(const Scene& _scene, const std::string& _path,
+                      const Digests& _digests, const YAML::Node& _config);
+
+    static std::string digest(const char* _data, size_t _size);
+
+    // Binary form of a YAML node tree
+    static bool encode(const YAML::Node& _node, std::string& _out);
+    static bool decode(const char*& _pos, const char* _end, YAML::Node& _node);
+};
+
+}
@@ -1,6 +1,8 @@
 #include "scene/sceneLoader.h"
 
 #include "data/clientGeoJsonSource.h"
+#include "data/diskCacheDataSource.h"
+#include "data/featureFilter.h"
 #include "data/memoryCacheDataSource.h"
 #include "data/mbtilesDataSource.h"
 #include "data/networkDataSource.h"
@@ -20,6 +22,7 @@
 #include "scene/dataLayer.h"
 #include "scene/filters.h"
 #include "scene/importer.h"
+#include "scene/sceneCache.h"
 #include "scene/scene.h"
 #include "scene/sceneLayer.h"
 #include "scene/spriteAtlas.h"
@@ -27,18 +30,22 @@
 #include "scene/stops.h"
 #include "scene/styleMixer.h"
 #include "scene/styleParam.h"
+#include "tile/builtTileCache.h"
 #include "util/base64.h"
 #include "util/floatFormatter.h"
 #include "util/yamlHelper.h"
 #include "view/view.h"
 
 #include "csscolorparser.hpp"
+#include "hash-library/md5.h"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <future>
 #include <iterator>
 #include <regex>
 #include <vector>
@@ -54,14 +61,50 @@ namespace Tangram {
 // TODO: make this configurable: 16MB default in-memory DataSource cache:
 constexpr size_t CACHE_SIZE = 16 * (1024 * 1024);
 
+// Default size bound of a persistent tile cache: 64MB
+constexpr size_t DISK_CACHE_SIZE = 64 * (1024 * 1024);
+
 static const std::string GLOBAL_PREFIX = "global.";
 
+// Collects the duration of each scene loading phase for the timing report
+class PhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void phase(const char* _name) {
+        auto now = Clock::now();
+        float ms = std::chrono::duration<float, std::milli>(now - m_start).count();
+        m_report += std::string(m_report.empty() ? "" : ", ") + _name + " " + ff::to_string(ms) + "ms";
+        m_start = now;
+    }
+
+    const std::string& report() const { return m_report; }
+
+private:
+    Clock::time_point m_start = Clock::now();
+    std::string m_report;
+};
+
 bool SceneLoader::loadScene(const std::shared_ptr<Platform>& _platform, std::shared_ptr<Scene> _scene,
                             const std::vector<SceneUpdate>& _updates) {
 
-    Importer sceneImporter(_scene);
+    PhaseTimer timer;
 
-    _scene->config() = sceneImporter.applySceneImports(_platform);
+    Node config;
+    bool cached = !_scene->cachePath.empty() &&
+        SceneCache::read(_platform, *_scene, _scene->cachePath, config);
+
+    if (!cached) {
+        Importer sceneImporter(_scene);
+        config = sceneImporter.applySceneImports(_platform);
+
+        if (config && !_scene->cachePath.empty()) {
+            SceneCache::write(*_scene, _scene->cachePath, sceneImporter.sceneDigests(), config);
+        }
+    }
+
+    _scene->config() = config;
+    timer.phase(cached ? "cached imports" : "imports");
 
     if (!_scene->config()) {
         return false;
@@ -71,9 +114,17 @@ bool SceneLoader::loadScene(const std::shared_ptr<Platform>& _platform, std::sha
         LOGW("Scene updates failed when loading scene");
         return false;
     }
+    timer.phase("updates");
 
     // Load font resources
+    _scene->fontContext()->setMaxTextures(_scene->maxGlyphTextures);
     _scene->fontContext()->loadFonts();
+    if (!_scene->glyphBundlePath.empty()) {
+        _scene->fontContext()->setGlyphBundle(_scene->glyphBundlePath);
+    }
+    timer.phase("font resources");
+
+    LOG("Scene loading: %s", timer.report().c_str());
 
     applyConfig(_platform, _scene);
 
@@ -112,6 +163,121 @@ bool SceneLoader::applyUpdates(const std::shared_ptr<Platform>& platform, Scene&
     return true;
 }
 
+static std::vector<std::string> splitUpdatePath(const std::string& _path) {
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    while (true) {
+        size_t end = _path.find('.', start);
+        tokens.push_back(_path.substr(start, end - start));
+        if (end == std::string::npos) { break; }
+        start = end + 1;
+    }
+    return tokens;
+}
+
+// Whether one path is equal to, or a parent of the other
+static bool updatePathsOverlap(const std::string& _a, const std::string& _b) {
+    const std::string& shorter = _a.size() < _b.size() ? _a : _b;
+    const std::string& longer = _a.size() < _b.size() ? _b : _a;
+
+    if (longer.compare(0, shorter.size(), shorter) != 0) { return false; }
+    return longer.size() == shorter.size() || longer[shorter.size()] == '.' || longer[shorter.size()] == '#';
+}
+
+static SceneLoader::UpdateLevel classifyUpdatePath(const Scene& _scene, const std::string& _path) {
+    using Level = SceneLoader::UpdateLevel;
+
+    auto tokens = splitUpdatePath(_path);
+    const std::string& root = tokens[0];
+
+    if (root == "sources") { return Level::full; }
+
+    if (root == "global") {
+        // Globals are resolved into the config on applyConfig, so they need
+        // the styling rebuild at least, and a full one when sources use them
+        std::string globalPath = _path.size() > GLOBAL_PREFIX.size() ? _path.substr(GLOBAL_PREFIX.size()) : "";
+        for (const auto& ref : _scene.globalRefs()) {
+            if (globalPath.empty() || updatePathsOverlap(ref.second.codedPath, globalPath)) {
+                if (classifyUpdatePath(_scene, ref.first.codedPath) == Level::full) { return Level::full; }
+            }
+        }
+        return Level::styling;
+    }
+
+    if (root == "styles" && tokens.size() == 5 && tokens[2] == "shaders" && tokens[3] == "uniforms") {
+        // Styles mixing this style have their own merged copy of its uniforms
+        StyleMixer mixer;
+        for (const auto& style : _scene.config()["styles"]) {
+            for (const auto& name : mixer.getStylesToMix(style.second)) {
+                if (name == tokens[1]) { return Level::styling; }
+            }
+        }
+        return Level::uniforms;
+    }
+
+    return Level::styling;
+}
+
+SceneLoader::UpdateLevel SceneLoader::classifyUpdates(const Scene& scene, const std::vector<SceneUpdate>& updates) {
+    auto level = UpdateLevel::uniforms;
+
+    for (const auto& update : updates) {
+        if (update.path.empty()) { return UpdateLevel::full; }
+        level = std::max(level, classifyUpdatePath(scene, update.path));
+    }
+    return level;
+}
+
+bool SceneLoader::parseUniformUpdates(Scene& scene, const std::vector<SceneUpdate>& updates,
+                                      std::vector<UniformUpdate>& out) {
+    for (const auto& update : updates) {
+        auto tokens = splitUpdatePath(update.path);
+        if (tokens.size() != 5) { return false; }
+
+        Style* style = scene.findStyle(tokens[1]);
+        if (!style) { return false; }
+
+        // A new uniform needs to be declared in the shader
+        auto& uniforms = style->styleUniforms();
+        auto it = std::find_if(uniforms.begin(), uniforms.end(),
+                               [&](const auto& u) { return u.first.getName() == tokens[4]; });
+        if (it == uniforms.end()) { return false; }
+
+        Node node;
+        try {
+            node = YAML::Load(update.value);
+        } catch (const YAML::ParserException& e) {
+            return false;
+        }
+
+        // Only take numeric values, textures are loaded while parsing them
+        double number;
+        bool boolean;
+        if (node.IsScalar()) {
+            if (!getDouble(node, number) && !getBool(node, boolean)) { return false; }
+        } else if (node.IsSequence()) {
+            for (const auto& entry : node) {
+                if (!entry.IsScalar() || !getDouble(entry, number)) { return false; }
+            }
+        } else {
+            return false;
+        }
+
+        StyleUniform uniform;
+        if (!parseStyleUniforms(nullptr, node, nullptr, uniform)) { return false; }
+
+        auto& current = it->second;
+        if (uniform.value.which() != current.which()) { return false; }
+        if (current.is<UniformArray1f>() &&
+            current.get<UniformArray1f>().size() != uniform.value.get<UniformArray1f>().size()) {
+            return false;
+        }
+
+        out.push_back({ style, size_t(it - uniforms.begin()), std::move(uniform.value) });
+    }
+    return true;
+}
+
 void printFilters(const SceneLayer& layer, int indent){
     LOG("%*s >>> %s\n", indent, "", layer.name().c_str());
     layer.filter().print(indent + 2);
@@ -175,8 +341,71 @@ void SceneLoader::applyGlobals(Node root, Scene& scene) {
     }
 }
 
+// Add the binary form of _node to _md5
+static void addNode(MD5& _md5, const Node& _node) {
+    std::string data;
+    if (!SceneCache::encode(_node, data)) { data = YAML::Dump(_node); }
+    _md5.add(data.data(), data.size());
+}
+
+static void addString(MD5& _md5, const std::string& _value) {
+    uint32_t size = _value.size();
+    _md5.add(&size, sizeof(size));
+    _md5.add(_value.data(), _value.size());
+}
+
+Scene::Fingerprint SceneLoader::computeFingerprint(const Scene& _scene) {
+
+    Scene::Fingerprint fingerprint;
+    const Node& config = _scene.config();
+
+    // Each part of the configuration is hashed once: the scene digest is
+    // taken over the digests of its sections, styles and sources
+    std::map<std::string, std::string> sections;
+    if (config.IsMap()) {
+        for (const auto& entry : config) {
+            const std::string& key = entry.first.Scalar();
+            if ((key == "styles" || key == "sources") && entry.second.IsMap()) {
+                auto& digests = (key == "styles") ? fingerprint.styles : fingerprint.sources;
+                for (const auto& item : entry.second) {
+                    MD5 md5;
+                    addNode(md5, item.second);
+                    digests[item.first.Scalar()] = md5.getHash();
+                }
+                continue;
+            }
+            MD5 md5;
+            addNode(md5, entry.second);
+            sections[key] = md5.getHash();
+        }
+    }
+
+    // Shader sources include the globals, lights and materials a style uses
+    for (auto& style : _scene.styles()) {
+        auto& shader = style->getShaderSource();
+        MD5 md5;
+        addString(md5, fingerprint.styles[style->getName()]);
+        addString(md5, shader.buildVertexSource());
+        addString(md5, shader.buildFragmentSource());
+        fingerprint.styles[style->getName()] = md5.getHash();
+    }
+
+    MD5 md5;
+    for (auto* digests : { &sections, &fingerprint.styles, &fingerprint.sources }) {
+        for (auto& entry : *digests) {
+            addString(md5, entry.first);
+            addString(md5, entry.second);
+        }
+    }
+    fingerprint.scene = md5.getHash();
+
+    return fingerprint;
+}
+
 bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const std::shared_ptr<Scene>& _scene) {
 
+    PhaseTimer timer;
+
     Node& config = _scene->config();
 
     // Instantiate built-in styles
@@ -191,11 +420,13 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
     if (config["global"]) {
         applyGlobals(config, *_scene);
     }
-
+    timer.phase("globals");
 
     if (Node sources = config["sources"]) {
         for (const auto& source : sources) {
             std::string srcName = source.first.Scalar();
+            // Sources kept from the previous scene on scene updates
+            if (_scene->getTileSource(srcName)) { continue; }
             try { loadSource(_platform, srcName, source.second, sources, _scene); }
             catch (YAML::RepresentationException e) {
                 LOGNode("Parsing sources: '%s'", source, e.what());
@@ -204,6 +435,7 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
     } else {
         LOGW("No source defined in the yaml scene configuration.");
     }
+    timer.phase("sources");
 
     if (Node textures = config["textures"]) {
         for (const auto& texture : textures) {
@@ -213,6 +445,7 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
             }
         }
     }
+    timer.phase("textures");
 
     if (Node fonts = config["fonts"]) {
         if (fonts.IsMap()) {
@@ -224,6 +457,7 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
             }
         }
     }
+    timer.phase("fonts");
 
     if (Node styles = config["styles"]) {
         StyleMixer mixer;
@@ -258,6 +492,7 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
             pointStyle->setTextures(_scene->textures());
         }
     }
+    timer.phase("styles");
 
     if (Node layers = config["layers"]) {
         for (const auto& layer : layers) {
@@ -267,6 +502,37 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
             }
         }
     }
+    // Parsers skip the features no layer takes, and the properties no layer reads.
+    // Interactive features are picked with all properties, unless the scene
+    // lists the ones picking needs.
+    std::vector<std::string> pickingProperties;
+    bool pickingAllowlist = false;
+    if (Node pickingNode = config["scene"]["picking_properties"]) {
+        if (pickingNode.IsSequence()) {
+            for (const auto& property : pickingNode) {
+                if (property.IsScalar()) { pickingProperties.push_back(property.Scalar()); }
+            }
+            pickingAllowlist = true;
+        } else {
+            LOGNode("Invalid 'picking_properties', expected a sequence", pickingNode);
+        }
+    }
+    for (auto& source : _scene->tileSources()) {
+        if (source->isRaster()) { continue; }
+        FeatureFilter::Usage usage;
+        usage.functions = &_scene->functions();
+        usage.pickingProperties = pickingAllowlist ? &pickingProperties : nullptr;
+        // Parsed data is handed to the application as it is
+        usage.allProperties = source->retainTileData();
+        source->setFeatureFilter(FeatureFilter::build(_scene->layers(), source->name(), usage));
+    }
+    timer.phase("layers");
+
+    // All scene functions are known now: compile them while the rest of
+    // the scene is set up, so that tile workers only load the bytecode.
+    auto compiledFunctions = std::async(std::launch::async, [&]() {
+        _scene->compiledFunctions();
+    });
 
     if (Node lights = config["lights"]) {
         for (const auto& light : lights) {
@@ -285,6 +551,7 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
     }
 
     _scene->lightBlocks() = Light::assembleLights(_scene->lights());
+    timer.phase("lights");
 
     if (Node camera = config["camera"]) {
         try { loadCamera(camera, _scene); }
@@ -309,6 +576,24 @@ bool SceneLoader::applyConfig(const std::shared_ptr<Platform>& _platform, const
     for (auto& style : _scene->styles()) {
         style->build(*_scene);
     }
+    LOGD("Built %d styles with %d unique shader programs", int(_scene->styles().size()),
+         int(_scene->shaderProgramCount()));
+    timer.phase("style build");
+
+    _scene->setFingerprint(computeFingerprint(*_scene));
+
+    // Cached built tiles are valid for this configuration only
+    for (auto& source : _scene->tileSources()) {
+        if (source->builtTileCache()) {
+            source->builtTileCache()->setSceneKey(_scene->fingerprint().scene);
+        }
+    }
+    timer.phase("fingerprint");
+
+    compiledFunctions.wait();
+    timer.phase("functions");
+
+    LOG("Scene config: %s", timer.report().c_str());
 
     return true;
 }
@@ -583,6 +868,21 @@ std::shared_ptr<Texture> SceneLoader::fetchTexture(const std::shared_ptr<Platfor
         if (!texture->loadImageFromMemory(textureData)) {
             LOGE("Invalid Base64 texture");
         }
+    } else if (url.scheme() == "zip") {
+        texture = std::make_shared<Texture>(std::vector<char>(), options, generateMipmaps, density);
+        texture->spriteAtlas() = std::move(_atlas);
+
+        // Decoded from the archive data, i.e. in place for stored images
+        const char* error = nullptr;
+        auto data = scene->readZipEntry(url, error);
+        if (error) {
+            LOGE("Error retrieving URL '%s': %s", url.string().c_str(), error);
+        } else if (!texture->loadImageFromMemory(data.data(), data.size())) {
+            LOGE("Invalid texture data from URL '%s'", url.string().c_str());
+        }
+        if (texture->spriteAtlas()) {
+            texture->spriteAtlas()->updateSpriteNodes({texture->getWidth(), texture->getHeight()});
+        }
     } else {
         texture = std::make_shared<Texture>(std::vector<char>(), options, generateMipmaps, density);
         texture->spriteAtlas() = std::move(_atlas);
@@ -678,7 +978,7 @@ void SceneLoader::loadTexture(const std::shared_ptr<Platform>& platform, const s
                 glm::vec2 pos = glm::vec2(desc.x, desc.y);
                 glm::vec2 size = glm::vec2(desc.z, desc.w);
 
-                atlas->addSpriteNode(spriteName, pos, size);
+                atlas->addSpriteNode(spriteName, pos, size, scene->spriteNames().handle(spriteName));
             }
         }
     }
@@ -789,10 +1089,27 @@ void SceneLoader::loadStyleProps(const std::shared_ptr<Platform>& platform, Styl
         }
     }
 
+    if (Node prepassNode = styleNode["depth_prepass"]) {
+        bool prepass;
+        if (getBool(prepassNode, prepass, "depth_prepass")) {
+            style.setDepthPrepass(prepass);
+        }
+    }
+
     if (Node texcoordsNode = styleNode["texcoords"]) {
         style.setTexCoordsGeneration(texcoordsNode.as<bool>());
     }
 
+    if (Node optimizeNode = styleNode["optimize_meshes"]) {
+        bool optimize = false;
+        if (getBool(optimizeNode, optimize, "optimize_meshes")) { style.setOptimizeMeshes(optimize); }
+    }
+
+    if (Node minSizeNode = styleNode["min_feature_size"]) {
+        double pixels = 0;
+        if (getDouble(minSizeNode, pixels, "min_feature_size")) { style.setMinFeatureSize(std::max(pixels, 0.0)); }
+    }
+
     if (Node dashNode = styleNode["dash"]) {
         if (auto polylineStyle = dynamic_cast<PolylineStyle*>(&style)) {
             if (dashNode.IsSequence()) {
@@ -801,11 +1118,36 @@ void SceneLoader::loadStyleProps(const std::shared_ptr<Platform>& platform, Styl
                     dashValues.push_back(dashValue.as<float>());
                 }
                 polylineStyle->setDashArray(dashValues);
+                if (!scene->dashAtlas()) {
+                    scene->dashAtlas() = std::make_shared<DashAtlas>();
+                }
+                polylineStyle->setDashAtlas(scene->dashAtlas());
                 polylineStyle->setTexCoordsGeneration(true);
             }
         }
     }
 
+    if (Node featureStateNode = styleNode["feature_state"]) {
+        // Only geometry styles read the feature states
+        if (dynamic_cast<PolylineStyle*>(&style) || dynamic_cast<PolygonStyle*>(&style)) {
+            bool featureStates = false;
+            if (getBool(featureStateNode, featureStates, "feature_state")) {
+                style.setFeatureStates(featureStates);
+            }
+        } else {
+            LOGW("Style %s does not support feature states", style.getName().c_str());
+        }
+    }
+
+    if (Node dynamicWidthNode = styleNode["dynamic_width"]) {
+        if (auto polylineStyle = dynamic_cast<PolylineStyle*>(&style)) {
+            bool dynamicWidth = false;
+            if (getBool(dynamicWidthNode, dynamicWidth, "dynamic_width")) {
+                polylineStyle->setDynamicWidth(dynamicWidth);
+            }
+        }
+    }
+
     if (Node dashBackgroundColor = styleNode["dash_background_color"]) {
         if (auto polylineStyle = dynamic_cast<PolylineStyle*>(&style)) {
             glm::vec4 backgroundColor = getColorAsVec4(dashBackgroundColor);
@@ -916,42 +1258,12 @@ bool SceneLoader::loadStyle(const std::shared_ptr<Platform>& platform, const std
     return true;
 }
 
-void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const std::string& name,
-                             const Node& source, const Node& sources, const std::shared_ptr<Scene>& _scene) {
-    if (_scene->getTileSource(name)) {
-        LOGW("Duplicate TileSource: %s", name.c_str());
-        return;
-    }
+std::string SceneLoader::loadSourceUrl(const std::string& name, const Node& source) {
 
-    std::string type;
     std::string url;
-    std::string mbtiles;
-    std::vector<std::string> subdomains;
-
-    int32_t minDisplayZoom = -1;
-    int32_t maxDisplayZoom = -1;
-    int32_t maxZoom = 18;
-    int32_t zoomBias = 0;
-    bool generateCentroids = false;
-
-    if (auto typeNode = source["type"]) {
-        type = typeNode.Scalar();
-    }
     if (auto urlNode = source["url"]) {
         url = urlNode.Scalar();
     }
-    if (auto minDisplayZoomNode = source["min_display_zoom"]) {
-        minDisplayZoom = minDisplayZoomNode.as<int32_t>(minDisplayZoom);
-    }
-    if (auto maxDisplayZoomNode = source["max_display_zoom"]) {
-        maxDisplayZoom = maxDisplayZoomNode.as<int32_t>(maxDisplayZoom);
-    }
-    if (auto maxZoomNode = source["max_zoom"]) {
-        maxZoom = maxZoomNode.as<int32_t>(maxZoom);
-    }
-    if (auto tileSizeNode = source["tile_size"]) {
-        zoomBias = TileSource::zoomBiasFromTileSize(tileSizeNode.as<int32_t>());
-    }
 
     // Parse and append any URL parameters.
     if (auto urlParamsNode = source["url_params"]) {
@@ -979,6 +1291,13 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
         url = urlStream.str();
     }
 
+    return url;
+}
+
+std::vector<std::string> SceneLoader::loadSourceSubdomains(const Node& source) {
+
+    std::vector<std::string> subdomains;
+
     // Apply URL subdomain configuration.
     if (Node subDomainNode = source["url_subdomains"]) {
         if (subDomainNode.IsSequence()) {
@@ -990,6 +1309,46 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
         }
     }
 
+    return subdomains;
+}
+
+void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const std::string& name,
+                             const Node& source, const Node& sources, const std::shared_ptr<Scene>& _scene) {
+    if (_scene->getTileSource(name)) {
+        LOGW("Duplicate TileSource: %s", name.c_str());
+        return;
+    }
+
+    std::string type;
+    std::string url;
+    std::string mbtiles;
+    std::vector<std::string> subdomains;
+
+    int32_t minDisplayZoom = -1;
+    int32_t maxDisplayZoom = -1;
+    int32_t maxZoom = 18;
+    int32_t zoomBias = 0;
+    bool generateCentroids = false;
+
+    if (auto typeNode = source["type"]) {
+        type = typeNode.Scalar();
+    }
+    if (auto minDisplayZoomNode = source["min_display_zoom"]) {
+        minDisplayZoom = minDisplayZoomNode.as<int32_t>(minDisplayZoom);
+    }
+    if (auto maxDisplayZoomNode = source["max_display_zoom"]) {
+        maxDisplayZoom = maxDisplayZoomNode.as<int32_t>(maxDisplayZoom);
+    }
+    if (auto maxZoomNode = source["max_zoom"]) {
+        maxZoom = maxZoomNode.as<int32_t>(maxZoom);
+    }
+    if (auto tileSizeNode = source["tile_size"]) {
+        zoomBias = TileSource::zoomBiasFromTileSize(tileSizeNode.as<int32_t>());
+    }
+
+    url = loadSourceUrl(name, source);
+    subdomains = loadSourceSubdomains(source);
+
     // Check whether the URL template and subdomains make sense together, and warn if not.
     bool hasSubdomainPlaceholder = (url.find("{s}") != std::string::npos);
     if (hasSubdomainPlaceholder && subdomains.empty()) {
@@ -1019,15 +1378,51 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
     }
 
     auto rawSources = std::make_unique<MemoryCacheDataSource>();
-    rawSources->setCacheSize(CACHE_SIZE);
+    rawSources->setCacheSize(std::min(CACHE_SIZE, _scene->sourceCacheSize));
+    if (auto compressionNode = source["memory_cache_compression"]) {
+        bool compress = false;
+        if (getBool(compressionNode, compress)) { rawSources->setCompression(compress); }
+    }
 
     if (isMBTilesFile) {
         // If we have MBTiles, we know the source is tiled.
         tiled = true;
+        MBTilesDataSource::ReadOptions readOptions;
+        if (auto connectionsNode = source["read_connections"]) {
+            readOptions.connections = connectionsNode.as<uint32_t>(readOptions.connections);
+        }
+        if (auto mmapNode = source["mmap_size"]) {
+            // Size in megabytes
+            readOptions.mmapSize = mmapNode.as<int64_t>(0) * (1024 * 1024);
+        }
         // Create an MBTiles data source from the file at the url and add it to the source chain.
-        rawSources->setNext(std::make_unique<MBTilesDataSource>(platform, name, url, ""));
+        rawSources->setNext(std::make_unique<MBTilesDataSource>(platform, name, url, "", false, false,
+                                                                readOptions));
     } else if (tiled) {
-        rawSources->setNext(std::make_unique<NetworkDataSource>(platform, url, std::move(subdomains), isTms));
+        auto networkSource = std::make_unique<NetworkDataSource>(platform, url, std::move(subdomains), isTms);
+        if (auto hedgeNode = source["hedge_requests"]) {
+            bool hedge = false;
+            if (getBool(hedgeNode, hedge)) { networkSource->setHedgeRequests(hedge); }
+        }
+
+        // Optional directory for a persistent cache of downloaded tiles
+        if (auto cacheNode = source["cache"]) {
+            size_t cacheSize = DISK_CACHE_SIZE;
+            if (auto cacheSizeNode = source["cache_size"]) {
+                // Size in megabytes
+                cacheSize = cacheSizeNode.as<size_t>(cacheSize / (1024 * 1024)) * (1024 * 1024);
+            }
+            auto diskCache = std::make_unique<DiskCacheDataSource>(cacheNode.Scalar(), cacheSize);
+            diskCache->setNext(std::move(networkSource));
+            rawSources->setNext(std::move(diskCache));
+        } else {
+            rawSources->setNext(std::move(networkSource));
+        }
+    }
+
+    if (tiled) {
+        // Sources for the same tiles, e.g. with other zoom ranges, keep them once
+        rawSources->shareCache(url + (isTms ? "#tms" : ""));
     }
 
     std::shared_ptr<TileSource> sourcePtr;
@@ -1038,10 +1433,26 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
         if (auto genLabelCentroidsNode = source["generate_label_centroids"]) {
             generateCentroids = true;
         }
+        // 'cluster: true', or a map of the options to change
+        PointClusterOptions clusterOptions;
+        if (Node clusterNode = source["cluster"]) {
+            if (clusterNode.IsMap()) {
+                clusterOptions.enabled = true;
+                clusterOptions.radius = clusterNode["radius"].as<float>(clusterOptions.radius);
+                clusterOptions.maxZoom = clusterNode["max_zoom"].as<int>(clusterOptions.maxZoom);
+                clusterOptions.minPoints = clusterNode["min_points"].as<uint32_t>(clusterOptions.minPoints);
+            } else {
+                getBool(clusterNode, clusterOptions.enabled, "cluster");
+            }
+        }
         sourcePtr = std::make_shared<ClientGeoJsonSource>(platform, name, url, generateCentroids,
-                                                          zoomOptions);
+                                                          zoomOptions, clusterOptions);
     } else if (type == "Raster") {
         TextureOptions options = {GL_RGBA, GL_RGBA, {GL_LINEAR, GL_LINEAR}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE} };
+        if (_scene->compactRasters) {
+            options.internalFormat = options.format = GL_RGB;
+            options.type = GL_UNSIGNED_SHORT_5_6_5;
+        }
         bool generateMipmaps = false;
         if (Node filtering = source["filtering"]) {
             if (extractTexFiltering(filtering, options.filtering)) {
@@ -1049,8 +1460,13 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
             }
         }
 
+        bool useAtlas = false;
+        if (Node atlas = source["atlas"]) {
+            useAtlas = atlas.as<bool>(false);
+        }
+
         sourcePtr = std::make_shared<RasterSource>(name, std::move(rawSources), options, zoomOptions,
-                                                   generateMipmaps);
+                                                   generateMipmaps, useAtlas);
     } else {
         sourcePtr = std::make_shared<TileSource>(name, std::move(rawSources), zoomOptions);
 
@@ -1060,13 +1476,57 @@ void SceneLoader::loadSource(const std::shared_ptr<Platform>& platform, const st
             sourcePtr->setFormat(TileSource::Format::TopoJson);
         } else if (type == "MVT") {
             sourcePtr->setFormat(TileSource::Format::Mvt);
+        } else if (type == "Mesh") {
+            sourcePtr->setFormat(TileSource::Format::Mesh);
         } else {
-            LOGE("Source '%s' does not have a valid type. Valid types are 'GeoJSON', 'TopoJSON', and 'MVT'. " \
+            LOGE("Source '%s' does not have a valid type. Valid types are 'GeoJSON', 'TopoJSON', 'MVT' and 'Mesh'. " \
                 "This source will be ignored.", name.c_str());
             return;
         }
     }
 
+    if (Node clipBuffer = source["clip_buffer"]) {
+        sourcePtr->setClipBuffer(clipBuffer.as<float>(-1.f));
+    }
+    if (Node simplify = source["simplify_tolerance"]) {
+        sourcePtr->setSimplifyTolerance(simplify.as<float>(0.f));
+    }
+    if (Node waitForRasters = source["wait_for_rasters"]) {
+        bool wait = true;
+        if (getBool(waitForRasters, wait)) { sourcePtr->setWaitForRasters(wait); }
+    }
+    if (Node progressiveBuild = source["progressive_build"]) {
+        bool progressive = false;
+        if (getBool(progressiveBuild, progressive)) { sourcePtr->setProgressiveBuild(progressive); }
+    }
+    if (Node maxLoading = source["max_loading_tiles"]) {
+        sourcePtr->setMaxLoadingTiles(maxLoading.as<int>(0));
+    }
+    if (Node loadWeight = source["load_weight"]) {
+        double weight;
+        if (getDouble(loadWeight, weight, "load_weight")) { sourcePtr->setLoadWeight(weight); }
+    }
+    if (Node retainTileData = source["retain_tile_data"]) {
+        bool retain = false;
+        if (getBool(retainTileData, retain)) { sourcePtr->setRetainTileData(retain); }
+    }
+    if (tiled) {
+        sourcePtr->setDataKey(url + (isTms ? "#tms" : ""));
+    }
+    // Optional directory for a persistent cache of built tiles
+    if (auto builtCacheNode = source["built_tile_cache"]) {
+        if (tiled && !sourcePtr->isRaster()) {
+            size_t cacheSize = DISK_CACHE_SIZE;
+            if (auto cacheSizeNode = source["built_tile_cache_size"]) {
+                // Size in megabytes
+                cacheSize = cacheSizeNode.as<size_t>(cacheSize / (1024 * 1024)) * (1024 * 1024);
+            }
+            sourcePtr->setBuiltTileCache(std::make_shared<BuiltTileCache>(builtCacheNode.Scalar(), cacheSize));
+        } else {
+            LOGW("Source '%s': built_tile_cache requires a tiled vector source", name.c_str());
+        }
+    }
+
     _scene->tileSources().push_back(sourcePtr);
 
     if (auto rasters = source["rasters"]) {
@@ -1529,6 +1989,11 @@ void SceneLoader::parseStyleParams(Node params, const std::shared_ptr<Scene>& sc
                 out.push_back(std::move(param));
             } else {
                 out.push_back(StyleParam{ key, val });
+
+                auto& param = out.back();
+                if (param.key == StyleParamKey::sprite || param.key == StyleParamKey::sprite_default) {
+                    param.handle = scene->spriteNames().handle(val);
+                }
             }
             break;
         }
@@ -45,9 +45,37 @@ struct SceneLoader {
                              const std::vector<SceneUpdate>& updates);
     static void applyGlobals(Node root, Scene& scene);
 
+    /* Hash the configuration and the shader sources of the styles of a
+     * scene, see Scene::Fingerprint */
+    static Scene::Fingerprint computeFingerprint(const Scene& scene);
+
+    /* How much of a loaded scene has to be rebuilt to apply scene updates */
+    enum class UpdateLevel {
+        uniforms, // Only style uniform values change, set on the current styles
+        styling,  // Rebuild the scene but keep its tile sources and their caches
+        full,
+    };
+
+    static UpdateLevel classifyUpdates(const Scene& scene, const std::vector<SceneUpdate>& updates);
+
+    struct UniformUpdate {
+        Style* style;
+        size_t index; // into style->styleUniforms()
+        UniformValue value;
+    };
+
+    /* Parse uniform values of 'uniforms' level updates for the styles of
+     * _scene. Returns false when a value can not be set in place, e.g. when
+     * it changes the type of the uniform or refers to a texture. */
+    static bool parseUniformUpdates(Scene& scene, const std::vector<SceneUpdate>& updates,
+                                    std::vector<UniformUpdate>& out);
+
     /*** all public for testing ***/
 
     static void loadBackground(Node background, const std::shared_ptr<Scene>& scene);
+    // URL template of a source with its url_params applied
+    static std::string loadSourceUrl(const std::string& name, const Node& source);
+    static std::vector<std::string> loadSourceSubdomains(const Node& source);
     static void loadSource(const std::shared_ptr<Platform>& platform, const std::string& name,
                            const Node& source, const Node& sources, const std::shared_ptr<Scene>& scene);
     static void loadSourceRasters(const std::shared_ptr<Platform>& platform, std::shared_ptr<TileSource>& source, Node rasterNode,
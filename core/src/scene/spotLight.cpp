@@ -1,6 +1,7 @@
 #include "scene/spotLight.h"
 
 #include "gl/shaderProgram.h"
+#include "gl/uniformBuffer.h"
 #include "platform.h"
 #include "spotLight_glsl.h"
 #include "util/floatFormatter.h"
@@ -42,21 +43,32 @@ std::unique_ptr<LightUniforms> SpotLight::getUniforms() {
     return std::make_unique<Uniforms>(getUniformName());
 }
 
-void SpotLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
-                             LightUniforms& _uniforms) {
-    PointLight::setupProgram(rs, _view, _shader, _uniforms);
-
+glm::vec3 SpotLight::viewDirection(const View& _view) const {
     glm::vec3 direction = m_direction;
     if (m_origin == LightOrigin::world) {
         direction = glm::normalize(_view.getNormalMatrix() * direction);
     }
+    return direction;
+}
+
+void SpotLight::setupProgram(RenderState& rs, const View& _view, ShaderProgram& _shader,
+                             LightUniforms& _uniforms) {
+    PointLight::setupProgram(rs, _view, _shader, _uniforms);
 
     auto& u = static_cast<Uniforms&>(_uniforms);
-    _shader.setUniformf(rs, u.direction, direction);
+    _shader.setUniformf(rs, u.direction, viewDirection(_view));
     _shader.setUniformf(rs, u.spotCosCutoff, m_spotCosCutoff);
     _shader.setUniformf(rs, u.spotExponent, m_spotExponent);
 }
 
+void SpotLight::setupUniformBuffer(const View& _view, UniformBuffer& _buffer) {
+    PointLight::setupUniformBuffer(_view, _buffer);
+
+    _buffer.add(viewDirection(_view));
+    _buffer.add(m_spotCosCutoff);
+    _buffer.add(m_spotExponent);
+}
+
 std::string SpotLight::getClassBlock() {
     return SHADER_SOURCE(spotLight_glsl);
 }
@@ -66,15 +78,9 @@ std::string SpotLight::getInstanceAssignBlock() {
 
     if (!m_dynamic) {
         block += ", " + ff::to_string(m_position.value);
-        if (m_attenuation!=0.0) {
-            block += ", " + ff::to_string(m_attenuation);
-        }
-        if (m_innerRadius!=0.0) {
-            block += ", " + ff::to_string(m_innerRadius);
-        }
-        if (m_outerRadius!=0.0) {
-            block += ", " + ff::to_string(m_outerRadius);
-        }
+        block += ", " + ff::to_string(m_attenuation);
+        block += ", " + ff::to_string(m_innerRadius);
+        block += ", " + ff::to_string(m_outerRadius);
 
         block += ", " + ff::to_string(m_direction);
         block += ", " + ff::to_string(m_spotCosCutoff);
@@ -2,19 +2,65 @@
 
 namespace Tangram {
 
+constexpr uint32_t SpriteNames::none;
+
+uint32_t SpriteNames::handle(const std::string& _name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_handles.find(_name);
+    if (it != m_handles.end()) { return it->second; }
+
+    uint32_t handle = m_handles.map.size();
+    m_handles[_name] = handle;
+    return handle;
+}
+
+size_t SpriteNames::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_handles.map.size();
+}
+
 SpriteAtlas::SpriteAtlas() {}
 
-void SpriteAtlas::addSpriteNode(const std::string& _name, glm::vec2 _origin, glm::vec2 _size) {
-    m_spritesNodes[_name] = SpriteNode { {}, {}, _size, _origin};
+void SpriteAtlas::addSpriteNode(const std::string& _name, glm::vec2 _origin, glm::vec2 _size,
+                                uint32_t _handle) {
+
+    SpriteNode node { {}, {}, _size, _origin };
+
+    auto it = m_spritesNodes.find(_name);
+    uint32_t index;
+    if (it != m_spritesNodes.end()) {
+        index = it->second;
+        m_nodes[index] = node;
+    } else {
+        index = m_nodes.size();
+        m_nodes.push_back(node);
+        m_spritesNodes[_name] = index;
+    }
+
+    if (_handle != SpriteNames::none) {
+        if (_handle >= m_nodesByHandle.size()) {
+            m_nodesByHandle.resize(_handle + 1, SpriteNames::none);
+        }
+        m_nodesByHandle[_handle] = index;
+    }
 }
 
-bool SpriteAtlas::getSpriteNode(const std::string& _name, SpriteNode& _node) const {
+const SpriteNode* SpriteAtlas::findSpriteNode(const std::string& _name) const {
     auto it = m_spritesNodes.find(_name);
     if (it == m_spritesNodes.end()) {
+        return nullptr;
+    }
+    return &m_nodes[it->second];
+}
+
+bool SpriteAtlas::getSpriteNode(const std::string& _name, SpriteNode& _node) const {
+    auto node = findSpriteNode(_name);
+    if (!node) {
         return false;
     }
 
-    _node = it->second;
+    _node = *node;
     return true;
 }
 
@@ -22,18 +68,18 @@ void SpriteAtlas::updateSpriteNodes(const glm::vec2& _textureSize) {
     float atlasWidth = _textureSize.x;
     float atlasHeight = _textureSize.y;
 
-    for (auto& spriteNode : m_spritesNodes) {
+    for (auto& spriteNode : m_nodes) {
 
-        const auto& origin = spriteNode.second.m_origin;
-        const auto& size = spriteNode.second.m_size;
+        const auto& origin = spriteNode.m_origin;
+        const auto& size = spriteNode.m_size;
 
         float uvL = origin.x / atlasWidth;
         float uvR = uvL + size.x / atlasWidth;
         float uvB = 1.f - origin.y / atlasHeight;
         float uvT = uvB - size.y / atlasHeight;
 
-        spriteNode.second.m_uvBL = { uvL, uvB };
-        spriteNode.second.m_uvTR = { uvR, uvT };
+        spriteNode.m_uvBL = { uvL, uvB };
+        spriteNode.m_uvTR = { uvR, uvT };
 
     }
 }
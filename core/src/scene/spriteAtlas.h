@@ -5,6 +5,7 @@
 #include "glm/glm.hpp"
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace Tangram {
 
@@ -15,18 +16,52 @@ struct SpriteNode {
     glm::vec2 m_origin;
 };
 
+/* Handles of the sprite names of a scene
+ *
+ * Sprite names of the atlases and constant sprite names of draw rules get
+ * the same handle while the scene is loaded, so that sprites of constant
+ * names are found without comparing strings per feature.
+ */
+class SpriteNames {
+
+public:
+    static constexpr uint32_t none = ~0u;
+
+    /* Returns the handle of _name, adding it when it has none yet */
+    uint32_t handle(const std::string& _name);
+
+    size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    fastmap<std::string, uint32_t> m_handles;
+};
+
 class SpriteAtlas {
 
 public:
     SpriteAtlas();
 
-    /* Creates a sprite node in the atlas located at _origin in the texture by a size in pixels _size */
-    void addSpriteNode(const std::string& _name, glm::vec2 _origin, glm::vec2 _size);
+    /* Creates a sprite node in the atlas located at _origin in the texture by a size in pixels _size,
+     * _handle is the one of _name in the SpriteNames of the scene */
+    void addSpriteNode(const std::string& _name, glm::vec2 _origin, glm::vec2 _size,
+                       uint32_t _handle = SpriteNames::none);
     bool getSpriteNode(const std::string& _name, SpriteNode& _node) const;
+
+    /* Sprite node by name or by handle, null when the atlas has no such sprite */
+    const SpriteNode* findSpriteNode(const std::string& _name) const;
+    const SpriteNode* findSpriteNode(uint32_t _handle) const {
+        return _handle < m_nodesByHandle.size() && m_nodesByHandle[_handle] != SpriteNames::none
+            ? &m_nodes[m_nodesByHandle[_handle]] : nullptr;
+    }
+
     void updateSpriteNodes(const glm::vec2&  _textureSize);
 
 private:
-    fastmap<std::string, SpriteNode> m_spritesNodes;
+    std::vector<SpriteNode> m_nodes;
+    // Index in m_nodes by name and by handle
+    fastmap<std::string, uint32_t> m_spritesNodes;
+    std::vector<uint32_t> m_nodesByHandle;
 };
 
 }
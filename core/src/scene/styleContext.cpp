@@ -3,14 +3,24 @@
 #include "data/propertyItem.h"
 #include "data/tileData.h"
 #include "log.h"
+#include "map.h"
 #include "platform.h"
 #include "scene/filters.h"
+#include "scene/nativeFunction.h"
 #include "scene/scene.h"
 #include "util/mapProjection.h"
 #include "util/builders.h"
+#include "util/hash.h"
 
 #include "duktape.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
 #define DUMP(...) // do { logMsg(__VA_ARGS__); duk_dump_context_stderr(m_ctx); } while(0)
 #define DBG(...) do { logMsg(__VA_ARGS__); duk_dump_context_stderr(m_ctx); } while(0)
 
@@ -18,11 +28,18 @@
 namespace Tangram {
 
 const static char INSTANCE_ID[] = "\xff""\xff""obj";
-const static char FUNC_ID[] = "\xff""\xff""fns";
 
 static const std::string key_geom("$geometry");
 static const std::string key_zoom("$zoom");
 
+// Memoized results per function
+static const size_t MEMO_SIZE = 64;
+// Memo key of filter results, style results use their StyleParamKey
+static const int MEMO_FILTER = -1;
+
+static void parseNativeResult(StyleParamKey _key, const NativeFunction::Result& _result,
+                              StyleParam::Value& _val);
+
 static const std::vector<std::string> s_geometryStrings = {
     "", // unknown
     "point",
@@ -30,8 +47,73 @@ static const std::vector<std::string> s_geometryStrings = {
     "polygon",
 };
 
+// Duktape allocator that counts the bytes of all heaps. Each allocation is
+// prefixed by its size, the header keeps the maximum alignment.
+static std::atomic<size_t> s_heapBytes{0};
+
+union AllocHeader {
+    size_t size;
+    std::max_align_t align;
+};
+
+static void* heapAlloc(void*, duk_size_t _size) {
+    if (_size == 0) { return nullptr; }
+    auto* header = static_cast<AllocHeader*>(std::malloc(sizeof(AllocHeader) + _size));
+    if (!header) { return nullptr; }
+    header->size = _size;
+    s_heapBytes += _size;
+    return header + 1;
+}
+
+static void heapFree(void*, void* _ptr) {
+    if (!_ptr) { return; }
+    auto* header = static_cast<AllocHeader*>(_ptr) - 1;
+    s_heapBytes -= header->size;
+    std::free(header);
+}
+
+static void* heapRealloc(void* _udata, void* _ptr, duk_size_t _size) {
+    if (!_ptr) { return heapAlloc(_udata, _size); }
+    if (_size == 0) {
+        heapFree(_udata, _ptr);
+        return nullptr;
+    }
+    auto* header = static_cast<AllocHeader*>(_ptr) - 1;
+    size_t oldSize = header->size;
+    header = static_cast<AllocHeader*>(std::realloc(header, sizeof(AllocHeader) + _size));
+    if (!header) { return nullptr; }
+    header->size = _size;
+    s_heapBytes += _size;
+    s_heapBytes -= oldSize;
+    return header + 1;
+}
+
+static duk_context* createHeap() {
+    return duk_create_heap(heapAlloc, heapRealloc, heapFree, nullptr, nullptr);
+}
+
+size_t StyleContext::heapBytes() {
+    return s_heapBytes;
+}
+
+static std::atomic<uint32_t> s_gcRequests{0};
+
+void StyleContext::requestGarbageCollection() {
+    s_gcRequests++;
+}
+
+void StyleContext::collectRequestedGarbage() {
+    uint32_t requests = s_gcRequests;
+    if (requests == m_gcRequest) { return; }
+    m_gcRequest = requests;
+
+    // Twice, objects with finalizers are freed in the second pass
+    duk_gc(m_ctx, 0);
+    duk_gc(m_ctx, 0);
+}
+
 StyleContext::StyleContext() {
-    m_ctx = duk_create_heap_default();
+    m_ctx = createHeap();
 
     //// Create global geometry constants
     // TODO make immutable
@@ -151,7 +233,12 @@ void StyleContext::parseSceneGlobals(const YAML::Node& node) {
 
 void StyleContext::setSceneGlobals(const YAML::Node& sceneGlobals) {
 
-    if (!sceneGlobals) { return; }
+    if (!sceneGlobals) {
+        // Drop globals of a previous scene
+        duk_push_undefined(m_ctx);
+        duk_put_global_string(m_ctx, "global");
+        return;
+    }
 
     //[ "ctx" ]
     // globalObject
@@ -170,17 +257,74 @@ void StyleContext::initFunctions(const Scene& _scene) {
     m_sceneId = _scene.id;
 
     setSceneGlobals(_scene.config()["global"]);
-    setFunctions(_scene.functions());
+    auto& functions = _scene.compiledFunctions();
+    loadFunctions(functions.sources, &functions.bytecode);
+}
+
+std::vector<std::string> StyleContext::compileFunctions(const std::vector<std::string>& _functions) {
+
+    std::vector<std::string> bytecode;
+    bytecode.reserve(_functions.size());
+
+    duk_context* ctx = createHeap();
+
+    for (auto& function : _functions) {
+        duk_push_string(ctx, function.c_str());
+        duk_push_string(ctx, "");
+
+        if (duk_pcompile(ctx, DUK_COMPILE_FUNCTION) == 0) {
+            duk_dump_function(ctx);
+            duk_size_t size = 0;
+            auto* data = static_cast<const char*>(duk_get_buffer(ctx, -1, &size));
+            bytecode.emplace_back(data, size);
+        } else {
+            LOGW("Compile failed: %s\n%s\n---",
+                 duk_safe_to_string(ctx, -1),
+                 function.c_str());
+            bytecode.emplace_back();
+        }
+        duk_pop(ctx);
+    }
+
+    duk_destroy_heap(ctx);
+
+    return bytecode;
 }
 
 bool StyleContext::setFunctions(const std::vector<std::string>& _functions) {
+    return loadFunctions(_functions, nullptr);
+}
+
+bool StyleContext::loadFunctions(const std::vector<std::string>& _functions,
+                                 const std::vector<std::string>* _bytecode) {
 
     auto arr_idx = duk_push_array(m_ctx);
     int id = 0;
 
     bool ok = true;
 
+    m_memos.clear();
+    m_nativeFunctions.clear();
+
     for (auto& function : _functions) {
+        m_memos.push_back({ analyzeFunction(function), {} });
+        compileNativeFunction(id, function);
+
+        if (_bytecode) {
+            // Compile errors were reported by compileFunctions
+            auto& code = (*_bytecode)[id];
+            if (!code.empty()) {
+                void* buffer = duk_push_fixed_buffer(m_ctx, code.size());
+                std::memcpy(buffer, code.data(), code.size());
+                duk_load_function(m_ctx);
+                duk_put_prop_index(m_ctx, arr_idx, id);
+            } else {
+                ok = false;
+            }
+            id++;
+            continue;
+        }
+
         duk_push_string(m_ctx, function.c_str());
         duk_push_string(m_ctx, "");
 
@@ -196,8 +340,12 @@ bool StyleContext::setFunctions(const std::vector<std::string>& _functions) {
         id++;
     }
 
-    if (!duk_put_global_string(m_ctx, FUNC_ID)) {
-        LOGE("'fns' object not set");
+    // The functions array stays on the value stack, so that calls index
+    // it directly instead of looking it up as global of the heap.
+    if (m_functionsIdx >= 0) {
+        duk_replace(m_ctx, m_functionsIdx);
+    } else {
+        m_functionsIdx = duk_get_top_index(m_ctx);
     }
 
     m_functionCount = id;
@@ -207,16 +355,20 @@ bool StyleContext::setFunctions(const std::vector<std::string>& _functions) {
 }
 
 bool StyleContext::addFunction(const std::string& _function) {
-    // Get all functions (array) in context
-    if (!duk_get_global_string(m_ctx, FUNC_ID)) {
+    if (m_functionsIdx < 0) {
         LOGE("AddFunction - functions array not initialized");
-        duk_pop(m_ctx); // pop [undefined] sitting at stack top
         return false;
     }
+    // Get all functions (array) in context
+    duk_dup(m_ctx, m_functionsIdx);
 
     int id = m_functionCount++;
     bool ok = true;
 
+    m_memos.resize(id);
+    m_memos.push_back({ analyzeFunction(_function), {} });
+    compileNativeFunction(id, _function);
+
     duk_push_string(m_ctx, _function.c_str());
     duk_push_string(m_ctx, "");
 
@@ -239,6 +391,7 @@ bool StyleContext::addFunction(const std::string& _function) {
 void StyleContext::setFeature(const Feature& _feature) {
 
     m_feature = &_feature;
+    nextFeatureGeneration();
 
     if (m_keywordGeom != m_feature->geometryType) {
         setKeyword(key_geom, s_geometryStrings[m_feature->geometryType]);
@@ -292,27 +445,61 @@ const Value& StyleContext::getKeyword(const std::string& _key) const {
 
 void StyleContext::clear() {
     m_feature = nullptr;
+    nextFeatureGeneration();
+}
+
+void StyleContext::nextFeatureGeneration() {
+    if (++m_featureGeneration == 0) {
+        // Wrapped around: Drop entries that could appear valid again
+        m_propertyCache.assign(m_propertyCache.size(), {});
+        m_featureGeneration = 1;
+    }
+}
+
+const Value& StyleContext::getProperty(const Feature& _feature, PropertyKey _key) {
+    if (&_feature != m_feature) { return _feature.props.get(_key); }
+
+    uint32_t atom = _key.atom();
+    if (atom >= m_propertyCache.size()) {
+        m_propertyCache.resize(atom + 1);
+    }
+    auto& entry = m_propertyCache[atom];
+    if (entry.generation != m_featureGeneration) {
+        entry.value = &_feature.props.get(_key);
+        entry.generation = m_featureGeneration;
+    }
+    return *entry.value;
+}
+
+bool StyleContext::jsPropertyKey(const char* _name, PropertyKey& _key) {
+    m_jsKeyName = _name;
+
+    auto it = m_jsPropertyKeys.find(m_jsKeyName);
+    if (it != m_jsPropertyKeys.end()) {
+        _key = it->second;
+        return true;
+    }
+
+    // Unknown names are looked up again: Features of later tiles may intern them
+    if (!PropertyKey::find(m_jsKeyName, _key)) { return false; }
+
+    m_jsPropertyKeys.emplace(m_jsKeyName, _key);
+    return true;
 }
 
 bool StyleContext::evalFunction(FunctionID id) {
-    // Get all functions (array) in context
-    if (!duk_get_global_string(m_ctx, FUNC_ID)) {
+    if (m_functionsIdx < 0) {
         LOGE("EvalFilterFn - functions array not initialized");
-        duk_pop(m_ctx); // pop [undefined] sitting at stack top
         return false;
     }
 
     // Get function at index `id` from functions array, put it at stack top
-    if (!duk_get_prop_index(m_ctx, -1, id)) {
+    if (!duk_get_prop_index(m_ctx, m_functionsIdx, id)) {
         LOGE("EvalFilterFn - function %d not set", id);
         duk_pop(m_ctx); // pop "undefined" sitting at stack top
-        duk_pop(m_ctx); // pop functions (array) now sitting at stack top
         return false;
     }
 
-    // pop fns array
-    duk_remove(m_ctx, -2);
-
     // call popped function (sitting at stack top), evaluated value is put on stack top
     if (duk_pcall(m_ctx, 0) != 0) {
         LOGE("EvalFilterFn: %s", duk_safe_to_string(m_ctx, -1));
@@ -323,8 +510,33 @@ bool StyleContext::evalFunction(FunctionID id) {
     return true;
 }
 
+void StyleContext::compileNativeFunction(FunctionID _id, const std::string& _function) {
+    m_nativeFunctions.resize(_id + 1);
+    m_nativeFunctions[_id] = NativeFunction::compile(_function);
+
+    if (getDebugFlag(DebugFlags::native_functions)) {
+        LOG("Function %d evaluated %s: %s", _id,
+            m_nativeFunctions[_id] ? "natively" : "by duktape", _function.c_str());
+    }
+}
+
+bool StyleContext::isNativeFunction(FunctionID _id) const {
+    return _id < m_nativeFunctions.size() && m_nativeFunctions[_id];
+}
+
 bool StyleContext::evalFilter(FunctionID _id) {
 
+    if (isNativeFunction(_id)) {
+        NativeFunction::Result result;
+        if (m_nativeFunctions[_id]->eval(m_feature, *this, result)) {
+            return result.toBoolean();
+        }
+    }
+
+    bool hit = false;
+    MemoEntry* memo = findMemo(_id, MEMO_FILTER, hit);
+    if (hit) { return memo->result.get<bool>(); }
+
     if (!evalFunction(_id)) { return false; };
 
     // Evaluate the "truthiness" of the function result at the top of the stack.
@@ -333,11 +545,31 @@ bool StyleContext::evalFilter(FunctionID _id) {
     // pop result
     duk_pop(m_ctx);
 
+    if (memo) {
+        memo->result = result;
+        memo->valid = true;
+    }
+
     return result;
 }
 
 bool StyleContext::evalStyle(FunctionID _id, StyleParamKey _key, StyleParam::Value& _val) {
 
+    if (isNativeFunction(_id)) {
+        NativeFunction::Result result;
+        if (m_nativeFunctions[_id]->eval(m_feature, *this, result)) {
+            parseNativeResult(_key, result, _val);
+            return !_val.is<none_type>();
+        }
+    }
+
+    bool hit = false;
+    MemoEntry* memo = findMemo(_id, static_cast<int>(_key), hit);
+    if (hit) {
+        _val = memo->result;
+        return !_val.is<none_type>();
+    }
+
     if (!evalFunction(_id)) { return false; }
 
     // parse evaluated result at stack top
@@ -346,42 +578,316 @@ bool StyleContext::evalStyle(FunctionID _id, StyleParamKey _key, StyleParam::Val
     // pop result, empty stack
     duk_pop(m_ctx);
 
+    if (memo) {
+        memo->result = _val;
+        memo->valid = true;
+    }
+
     return !_val.is<none_type>();
 }
 
-void StyleContext::parseStyleResult(StyleParamKey _key, StyleParam::Value& _val) const {
-    _val = none_type{};
+size_t StyleContext::hashValue(const Value& _value) {
+    if (_value.is<double>()) {
+        return std::hash<double>()(_value.get<double>());
+    } else if (_value.is<std::string>()) {
+        return std::hash<std::string>()(_value.get<std::string>());
+    }
+    return 0;
+}
 
-    if (duk_is_string(m_ctx, -1)) {
-        std::string value(duk_get_string(m_ctx, -1));
+StyleContext::MemoEntry* StyleContext::findMemo(FunctionID _id, int _key, bool& _hit) {
+    _hit = false;
 
-        switch (_key) {
-            case StyleParamKey::text_source:
-            case StyleParamKey::text_source_left:
-            case StyleParamKey::text_source_right:
-                _val = value;
-                break;
-            default:
-                _val = StyleParam::parseString(_key, value);
+    if (_id >= m_memos.size()) { return nullptr; }
+
+    auto& memo = m_memos[_id];
+    auto& inputs = memo.inputs;
+
+    if (!inputs.memoizable) { return nullptr; }
+    if (!inputs.properties.empty() && !m_feature) { return nullptr; }
+
+    m_memoInputs.clear();
+    for (auto& key : inputs.properties) {
+        m_memoInputs.push_back(&m_feature->props.get(key));
+    }
+    if (inputs.zoom) { m_memoInputs.push_back(&getKeyword(FilterKeyword::zoom)); }
+    if (inputs.geometry) { m_memoInputs.push_back(&getKeyword(FilterKeyword::geometry)); }
+
+    size_t hash = std::hash<int>()(_key);
+    for (auto* value : m_memoInputs) { hash_combine(hash, hashValue(*value)); }
+
+    if (memo.entries.empty()) { memo.entries.resize(MEMO_SIZE); }
+    auto& entry = memo.entries[hash % MEMO_SIZE];
+
+    if (entry.valid && entry.hash == hash && entry.key == _key &&
+        std::equal(m_memoInputs.begin(), m_memoInputs.end(), entry.inputs.begin(),
+                   [](const Value* a, const Value& b) { return *a == b; })) {
+        m_memoHits++;
+        _hit = true;
+        return &entry;
+    }
+
+    // Take over the slot for the current inputs
+    entry.valid = false;
+    entry.hash = hash;
+    entry.key = _key;
+    entry.inputs.clear();
+    for (auto* value : m_memoInputs) { entry.inputs.push_back(*value); }
+
+    return &entry;
+}
+
+StyleContext::FunctionInputs StyleContext::analyzeFunction(const std::string& _source) {
+    // Scans the tokens of _source for the inputs it can read: feature
+    // properties accessed as 'feature.name' or feature['name'], and the
+    // $zoom and $geometry keywords. Any construct that this scan can not
+    // resolve makes the function non memoizable.
+    FunctionInputs inputs;
+
+    const size_t size = _source.size();
+    size_t pos = 0;
+    char prev = '(';
+
+    auto isIdentStart = [](char c) { return std::isalpha(c) || c == '_' || c == '$'; };
+    auto isIdentChar = [](char c) { return std::isalnum(c) || c == '_' || c == '$'; };
+
+    auto skipSpace = [&]() {
+        while (pos < size) {
+            if (std::isspace(_source[pos])) {
+                pos++;
+            } else if (_source.compare(pos, 2, "//") == 0) {
+                pos = _source.find('\n', pos);
+                if (pos == std::string::npos) { pos = size; }
+            } else if (_source.compare(pos, 2, "/*") == 0) {
+                pos = _source.find("*/", pos + 2);
+                pos = (pos == std::string::npos) ? size : pos + 2;
+            } else {
                 break;
+            }
+        }
+    };
+
+    auto readIdent = [&]() {
+        size_t start = pos;
+        while (pos < size && isIdentChar(_source[pos])) { pos++; }
+        return _source.substr(start, pos - start);
+    };
+
+    // Reads a string literal at pos, returns false for an unterminated one
+    auto readString = [&](std::string& _str) {
+        char quote = _source[pos++];
+        while (pos < size && _source[pos] != quote) {
+            if (_source[pos] == '\\') {
+                // Escaped characters make the literal unsuitable as a key
+                _str.clear();
+                return false;
+            }
+            _str += _source[pos++];
         }
+        if (pos >= size) { return false; }
+        pos++;
+        return true;
+    };
+
+    auto addProperty = [&](const std::string& _name) {
+        PropertyKey key(_name);
+        if (std::find(inputs.properties.begin(), inputs.properties.end(), key) ==
+            inputs.properties.end()) {
+            inputs.properties.push_back(key);
+        }
+    };
 
-    } else if (duk_is_boolean(m_ctx, -1)) {
-        bool value = duk_get_boolean(m_ctx, -1);
+    while (true) {
+        skipSpace();
+        if (pos >= size) { break; }
 
-        switch (_key) {
-            case StyleParamKey::interactive:
-            case StyleParamKey::text_interactive:
-            case StyleParamKey::visible:
-                _val = value;
-                break;
-            case StyleParamKey::extrude:
-                _val = value ? glm::vec2(NAN, NAN) : glm::vec2(0.0f, 0.0f);
-                break;
-            default:
-                break;
+        char c = _source[pos];
+
+        if (c == '\'' || c == '"') {
+            std::string str;
+            if (!readString(str)) { return {}; }
+            prev = c;
+            continue;
+        }
+        if (c == '`') {
+            // Template literals can hold expressions
+            return {};
+        }
+        if (c == '/' && std::strchr("(,=:[!&|?{};+-*%<>~^", prev)) {
+            // Regular expression literal
+            return {};
         }
 
+        if (!isIdentStart(c)) {
+            prev = c;
+            pos++;
+            continue;
+        }
+
+        bool member = (prev == '.');
+        std::string ident = readIdent();
+        // A '/' after these starts a regular expression
+        prev = (ident == "return" || ident == "typeof") ? '(' : 'a';
+
+        if (member) {
+            if (ident == "random") { return {}; }
+            continue;
+        }
+
+        if (ident == "feature") {
+            skipSpace();
+            if (pos < size && _source[pos] == '.') {
+                pos++;
+                skipSpace();
+                if (pos >= size || !isIdentStart(_source[pos])) { return {}; }
+                addProperty(readIdent());
+
+            } else if (pos < size && _source[pos] == '[') {
+                pos++;
+                skipSpace();
+                std::string name;
+                if (pos >= size || (_source[pos] != '\'' && _source[pos] != '"') ||
+                    !readString(name)) {
+                    return {};
+                }
+                skipSpace();
+                if (pos >= size || _source[pos] != ']') { return {}; }
+                pos++;
+                addProperty(name);
+
+            } else {
+                // Feature used as a whole, e.g. passed on or with 'in'
+                return {};
+            }
+        } else if (ident == "$zoom") {
+            inputs.zoom = true;
+        } else if (ident == "$geometry") {
+            inputs.geometry = true;
+        } else if (ident[0] == '$' || ident == "this" || ident == "eval" ||
+                   ident == "Function" || ident == "Date") {
+            return {};
+        }
+    }
+
+    inputs.memoizable = true;
+    return inputs;
+}
+
+// Same clamping as duk_get_uint
+static uint32_t toUint(double _value) {
+    if (std::isnan(_value) || _value <= 0) { return 0; }
+    if (_value >= double(UINT32_MAX)) { return UINT32_MAX; }
+    return static_cast<uint32_t>(_value);
+}
+
+static void parseStyleString(StyleParamKey _key, const std::string& _value, StyleParam::Value& _val) {
+    switch (_key) {
+        case StyleParamKey::text_source:
+        case StyleParamKey::text_source_left:
+        case StyleParamKey::text_source_right:
+            _val = _value;
+            break;
+        default:
+            _val = StyleParam::parseString(_key, _value);
+            break;
+    }
+}
+
+static void parseStyleBoolean(StyleParamKey _key, bool _value, StyleParam::Value& _val) {
+    switch (_key) {
+        case StyleParamKey::interactive:
+        case StyleParamKey::text_interactive:
+        case StyleParamKey::visible:
+            _val = _value;
+            break;
+        case StyleParamKey::extrude:
+            _val = _value ? glm::vec2(NAN, NAN) : glm::vec2(0.0f, 0.0f);
+            break;
+        default:
+            break;
+    }
+}
+
+static void parseStyleNumber(StyleParamKey _key, double _value, StyleParam::Value& _val) {
+    switch (_key) {
+        case StyleParamKey::text_source:
+        case StyleParamKey::text_source_left:
+        case StyleParamKey::text_source_right:
+            _val = doubleToString(_value);
+            break;
+        case StyleParamKey::extrude:
+            _val = glm::vec2(0.f, static_cast<float>(_value));
+            break;
+        case StyleParamKey::placement_spacing: {
+            _val = StyleParam::Width{static_cast<float>(_value), Unit::pixel};
+            break;
+        }
+        case StyleParamKey::width:
+        case StyleParamKey::outline_width: {
+            // TODO more efficient way to return pixels.
+            // atm this only works by return value as string
+            _val = StyleParam::Width{static_cast<float>(_value)};
+            break;
+        }
+        case StyleParamKey::angle:
+        case StyleParamKey::text_font_stroke_width:
+        case StyleParamKey::placement_min_length_ratio: {
+            _val = static_cast<float>(_value);
+            break;
+        }
+        case StyleParamKey::size: {
+            StyleParam::SizeValue vec;
+            vec.x.value = static_cast<float>(_value);
+            _val = vec;
+            break;
+        }
+        case StyleParamKey::order:
+        case StyleParamKey::outline_order:
+        case StyleParamKey::priority:
+        case StyleParamKey::color:
+        case StyleParamKey::outline_color:
+        case StyleParamKey::text_font_fill:
+        case StyleParamKey::text_font_stroke_color: {
+            _val = toUint(_value);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Same conversions as parseStyleResult for the result types of native functions
+static void parseNativeResult(StyleParamKey _key, const NativeFunction::Result& _result,
+                              StyleParam::Value& _val) {
+    _val = none_type{};
+
+    switch (_result.type) {
+    case NativeFunction::Result::string:
+        parseStyleString(_key, _result.stringValue, _val);
+        break;
+    case NativeFunction::Result::boolean:
+        parseStyleBoolean(_key, _result.boolValue, _val);
+        break;
+    case NativeFunction::Result::number:
+        if (!std::isnan(_result.numberValue)) {
+            parseStyleNumber(_key, _result.numberValue, _val);
+        }
+        break;
+    default:
+        _val = Undefined();
+        break;
+    }
+}
+
+void StyleContext::parseStyleResult(StyleParamKey _key, StyleParam::Value& _val) const {
+    _val = none_type{};
+
+    if (duk_is_string(m_ctx, -1)) {
+        parseStyleString(_key, duk_get_string(m_ctx, -1), _val);
+
+    } else if (duk_is_boolean(m_ctx, -1)) {
+        parseStyleBoolean(_key, duk_get_boolean(m_ctx, -1), _val);
+
     } else if (duk_is_array(m_ctx, -1)) {
         duk_get_prop_string(m_ctx, -1, "length");
         int len = duk_get_int(m_ctx, -1);
@@ -443,54 +949,8 @@ void StyleContext::parseStyleResult(StyleParamKey _key, StyleParam::Value& _val)
         // Ignore setting value
         LOGD("duk evaluates JS method to NAN.\n");
     } else if (duk_is_number(m_ctx, -1)) {
+        parseStyleNumber(_key, duk_get_number(m_ctx, -1), _val);
 
-        switch (_key) {
-            case StyleParamKey::text_source:
-            case StyleParamKey::text_source_left:
-            case StyleParamKey::text_source_right:
-                _val = doubleToString(static_cast<double>(duk_get_number(m_ctx, -1)));
-                break;
-            case StyleParamKey::extrude:
-                _val = glm::vec2(0.f, static_cast<float>(duk_get_number(m_ctx, -1)));
-                break;
-            case StyleParamKey::placement_spacing: {
-                double v = duk_get_number(m_ctx, -1);
-                _val = StyleParam::Width{static_cast<float>(v), Unit::pixel};
-                break;
-            }
-            case StyleParamKey::width:
-            case StyleParamKey::outline_width: {
-                // TODO more efficient way to return pixels.
-                // atm this only works by return value as string
-                double v = duk_get_number(m_ctx, -1);
-                _val = StyleParam::Width{static_cast<float>(v)};
-                break;
-            }
-            case StyleParamKey::angle:
-            case StyleParamKey::text_font_stroke_width:
-            case StyleParamKey::placement_min_length_ratio: {
-                _val = static_cast<float>(duk_get_number(m_ctx, -1));
-                break;
-            }
-            case StyleParamKey::size: {
-                StyleParam::SizeValue vec;
-                vec.x.value = static_cast<float>(duk_get_number(m_ctx, -1));
-                _val = vec;
-                break;
-            }
-            case StyleParamKey::order:
-            case StyleParamKey::outline_order:
-            case StyleParamKey::priority:
-            case StyleParamKey::color:
-            case StyleParamKey::outline_color:
-            case StyleParamKey::text_font_fill:
-            case StyleParamKey::text_font_stroke_color: {
-                _val = static_cast<uint32_t>(duk_get_uint(m_ctx, -1));
-                break;
-            }
-            default:
-                break;
-        }
     } else if (duk_is_null_or_undefined(m_ctx, -1)) {
         // Explicitly set value as 'undefined'. This is important for some styling rules.
         _val = Undefined();
@@ -505,15 +965,17 @@ void StyleContext::parseStyleResult(StyleParamKey _key, StyleParam::Value& _val)
 duk_ret_t StyleContext::jsHasProperty(duk_context *_ctx) {
 
     duk_get_prop_string(_ctx, 0, INSTANCE_ID);
-    auto* attr = static_cast<const StyleContext*> (duk_to_pointer(_ctx, -1));
+    auto* attr = static_cast<StyleContext*> (duk_to_pointer(_ctx, -1));
     if (!attr || !attr->m_feature) {
         LOGE("Error: no context set %p %p", attr, attr ? attr->m_feature : nullptr);
         duk_pop(_ctx);
         return 0;
     }
 
-    const char* key = duk_require_string(_ctx, 1);
-    duk_push_boolean(_ctx, attr->m_feature->props.contains(key));
+    PropertyKey key;
+    bool found = attr->jsPropertyKey(duk_require_string(_ctx, 1), key) &&
+        !attr->getProperty(*attr->m_feature, key).is<none_type>();
+    duk_push_boolean(_ctx, found);
 
     return 1;
 }
@@ -523,7 +985,7 @@ duk_ret_t StyleContext::jsGetProperty(duk_context *_ctx) {
 
     // Get the StyleContext instance from JS Feature object (first parameter).
     duk_get_prop_string(_ctx, 0, INSTANCE_ID);
-    auto* attr = static_cast<const StyleContext*> (duk_to_pointer(_ctx, -1));
+    auto* attr = static_cast<StyleContext*> (duk_to_pointer(_ctx, -1));
     if (!attr || !attr->m_feature) {
         LOGE("Error: no context set %p %p",  attr, attr ? attr->m_feature : nullptr);
         duk_pop(_ctx);
@@ -531,9 +993,14 @@ duk_ret_t StyleContext::jsGetProperty(duk_context *_ctx) {
     }
 
     // Get the property name (second parameter)
-    const char* key = duk_require_string(_ctx, 1);
+    PropertyKey key;
+    if (!attr->jsPropertyKey(duk_require_string(_ctx, 1), key)) {
+        duk_push_undefined(_ctx);
+        return 1;
+    }
 
-    auto it = attr->m_feature->props.get(key);
+    // Shares the lookups of the current feature with all other functions
+    const auto& it = attr->getProperty(*attr->m_feature, key);
     if (it.is<std::string>()) {
         duk_push_string(_ctx, it.get<std::string>().c_str());
     } else if (it.is<double>()) {
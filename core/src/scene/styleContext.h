@@ -1,5 +1,6 @@
 #pragma once
 
+#include "data/propertyKey.h"
 #include "scene/styleParam.h"
 #include "util/fastmap.h"
 
@@ -8,6 +9,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct duk_hthread;
 typedef struct duk_hthread duk_context;
@@ -18,6 +20,7 @@ namespace YAML {
 
 namespace Tangram {
 
+class NativeFunction;
 class Scene;
 struct Feature;
 struct StyleParam;
@@ -58,14 +61,33 @@ public:
     /* Called from Filter::eval */
     bool evalFilter(FunctionID id);
 
+    /* Called from FilterProgram::eval: Property @_key of @_feature. Lookups
+     * for the current feature are cached. */
+    const Value& getProperty(const Feature& _feature, PropertyKey _key);
+
     /* Called from DrawRule::eval */
     bool evalStyle(FunctionID id, StyleParamKey _key, StyleParam::Value& _val);
 
     /*
-     * Setup filter and style functions from @_scene
+     * Setup filter and style functions from @_scene. The duktape heap is
+     * reused when switching scenes; functions are loaded from the bytecode
+     * that the scene compiles once for all contexts.
      */
     void initFunctions(const Scene& _scene);
 
+    /* Compile _functions to duktape bytecode, see duk_dump_function.
+     * Functions that fail to compile are logged and left empty. */
+    static std::vector<std::string> compileFunctions(const std::vector<std::string>& _functions);
+
+    /* Bytes allocated by the duktape heaps of all StyleContexts */
+    static size_t heapBytes();
+
+    /* Ask all StyleContexts to run a full garbage collection. Each context
+     * runs it on its own thread, in the next collectRequestedGarbage() */
+    static void requestGarbageCollection();
+
+    void collectRequestedGarbage();
+
     /*
      * Unset Feature handle
      */
@@ -78,11 +100,64 @@ public:
     void setKeyword(const std::string& _key, Value _value);
     const Value& getKeyword(const std::string& _key) const;
 
+    /* Inputs read by a JS function, found by scanning its source. The result
+     * of a memoizable function only depends on these, so evalFilter and
+     * evalStyle can answer repeated inputs without calling into duktape. */
+    struct FunctionInputs {
+        std::vector<PropertyKey> properties;
+        bool zoom = false;
+        bool geometry = false;
+        bool memoizable = false;
+    };
+
+    static FunctionInputs analyzeFunction(const std::string& _source);
+
+    /* Inputs of function _id, nullptr when there is no such function */
+    const FunctionInputs* functionInputs(FunctionID _id) const {
+        return _id < m_memos.size() ? &m_memos[_id].inputs : nullptr;
+    }
+
+    /* Hash of property values, consistent with Value equality */
+    static size_t hashValue(const Value& _value);
+
+    /* Number of function evaluations answered from memoized results */
+    size_t memoHits() const { return m_memoHits; }
+
+    /* Whether function _id is evaluated natively, without duktape */
+    bool isNativeFunction(FunctionID _id) const;
+
 private:
     static int jsGetProperty(duk_context *_ctx);
     static int jsHasProperty(duk_context *_ctx);
 
     bool evalFunction(FunctionID id);
+    // Key of the property _name read by a JS function, without taking the
+    // lock of the process-wide key table once the name was seen.
+    bool jsPropertyKey(const char* _name, PropertyKey& _key);
+    // Compiles _functions, or loads them from _bytecode when given
+    bool loadFunctions(const std::vector<std::string>& _functions,
+                       const std::vector<std::string>* _bytecode);
+    void nextFeatureGeneration();
+    void compileNativeFunction(FunctionID _id, const std::string& _function);
+
+    struct MemoEntry {
+        size_t hash = 0;
+        int key = -1;
+        bool valid = false;
+        std::vector<Value> inputs;
+        StyleParam::Value result;
+    };
+
+    struct FunctionMemo {
+        FunctionInputs inputs;
+        // Direct mapped by hash of the inputs
+        std::vector<MemoEntry> entries;
+    };
+
+    // Returns the memo slot for the current inputs of function _id or
+    // nullptr when it is not memoizable. _hit is set when the slot holds
+    // the result for these inputs, otherwise the slot is prepared for it.
+    MemoEntry* findMemo(FunctionID _id, int _key, bool& _hit);
     void parseStyleResult(StyleParamKey _key, StyleParam::Value& _val) const;
     void parseSceneGlobals(const YAML::Node& node);
 
@@ -90,12 +165,38 @@ private:
     int m_keywordGeom= -1;
     int m_keywordZoom = -1;
 
+    // Last garbage collection request handled by this context
+    uint32_t m_gcRequest = 0;
+
     int m_functionCount = 0;
 
+    std::vector<FunctionMemo> m_memos;
+
+    // Functions evaluated without duktape, by function id. Empty for
+    // functions outside the supported subset.
+    std::vector<std::unique_ptr<NativeFunction>> m_nativeFunctions;
+    std::vector<const Value*> m_memoInputs;
+    size_t m_memoHits = 0;
+
     int32_t m_sceneId = -1;
 
     const Feature* m_feature = nullptr;
 
+    // Property lookups of m_feature by key atom, valid for the current generation
+    struct CachedProperty {
+        const Value* value = nullptr;
+        uint32_t generation = 0;
+    };
+    std::vector<CachedProperty> m_propertyCache;
+    uint32_t m_featureGeneration = 1;
+
+    // Keys of property names read by JS functions
+    std::unordered_map<std::string, PropertyKey> m_jsPropertyKeys;
+    std::string m_jsKeyName;
+
+    // Value stack index of the functions array, -1 until functions are loaded
+    int m_functionsIdx = -1;
+
     mutable duk_context *m_ctx;
 };
 
@@ -92,6 +92,7 @@ void StyleMixer::applyStyleMixins(Node _style, const std::vector<Node>& _mixins)
     // Merge boolean flags as a disjunction.
     mergeBooleanFieldAsDisjunction("animated", _style, _mixins);
     mergeBooleanFieldAsDisjunction("texcoords", _style, _mixins);
+    mergeBooleanFieldAsDisjunction("depth_prepass", _style, _mixins);
 
     // Merge scalar fields with newer values taking precedence.
     mergeFieldTakingLast("base", _style, _mixins);
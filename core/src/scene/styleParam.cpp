@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cstring>
 #include <map>
+#include <unordered_map>
 
 namespace Tangram {
 
@@ -165,7 +166,56 @@ StyleParam::StyleParam(const std::string& _key, const std::string& _value) {
     }
 }
 
+// Keys whose values are cached by parseString
+static bool isCachedValue(StyleParamKey _key) {
+    switch (_key) {
+    case StyleParamKey::anchor:
+    case StyleParamKey::buffer:
+    case StyleParamKey::color:
+    case StyleParamKey::offset:
+    case StyleParamKey::outline_color:
+    case StyleParamKey::outline_width:
+    case StyleParamKey::size:
+    case StyleParamKey::text_anchor:
+    case StyleParamKey::text_buffer:
+    case StyleParamKey::text_font_fill:
+    case StyleParamKey::text_font_size:
+    case StyleParamKey::text_font_stroke_color:
+    case StyleParamKey::text_offset:
+    case StyleParamKey::width:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static const size_t MAX_CACHED_VALUES = 1024;
+
 StyleParam::Value StyleParam::parseString(StyleParamKey key, const std::string& _value) {
+    if (!isCachedValue(key)) {
+        return parseValue(key, _value);
+    }
+
+    // Draw rules, scene updates, marker styling and style functions parse
+    // the same few strings over and over, on the tile workers as well
+    static thread_local std::unordered_map<std::string, Value> s_values;
+
+    std::string cacheKey;
+    cacheKey.reserve(_value.size() + 1);
+    cacheKey.push_back(static_cast<char>(key));
+    cacheKey += _value;
+
+    auto it = s_values.find(cacheKey);
+    if (it != s_values.end()) { return it->second; }
+
+    if (s_values.size() >= MAX_CACHED_VALUES) { s_values.clear(); }
+
+    Value value = parseValue(key, _value);
+    s_values.emplace(std::move(cacheKey), value);
+    return value;
+}
+
+StyleParam::Value StyleParam::parseValue(StyleParamKey key, const std::string& _value) {
     auto allowedUnits = unitsForStyleParam(key);
 
     switch (key) {
@@ -261,10 +311,10 @@ StyleParam::Value StyleParam::parseString(StyleParamKey key, const std::string&
         if (_value.find(',') != std::string::npos) {
             std::stringstream ss(_value);
             while (std::getline(ss, tmp, ',')) {
-                textSource.keys.push_back(tmp);
+                textSource.keys.emplace_back(tmp);
             }
         } else {
-            textSource.keys.push_back(_value);
+            textSource.keys.emplace_back(_value);
         }
         return std::move(textSource);
     }
@@ -439,7 +489,7 @@ std::string StyleParam::toString() const {
             return k + value.get<std::string>();
         } else if (value.is<TextSource>()) {
             // TODO add more..
-            return k + value.get<TextSource>().keys[0];
+            return k + value.get<TextSource>().keys[0].name();
         }
         break;
     case StyleParamKey::transition_hide_time:
@@ -553,8 +603,7 @@ int StyleParam::parseValueUnitPair(const std::string& _value, size_t offset,
 
     for (size_t i = 0; i < s_units.size(); ++i) {
         const auto& unit = s_units[i];
-        std::string valueUnit;
-        if (unit == _value.substr(offset, std::min<int>(_value.length(), unit.length()))) {
+        if (_value.compare(offset, unit.length(), unit) == 0) {
             _result.unit = static_cast<Unit>(1 << i);
             offset += unit.length();
             break;
@@ -661,9 +710,40 @@ bool StyleParam::parseVec3(const std::string& _value, uint8_t allowedUnits, Unit
     return parseVec(_value, allowedUnits, _vec);
 }
 
+static int hexDigit(char _c) {
+    if (_c >= '0' && _c <= '9') { return _c - '0'; }
+    if (_c >= 'a' && _c <= 'f') { return _c - 'a' + 10; }
+    if (_c >= 'A' && _c <= 'F') { return _c - 'A' + 10; }
+    return -1;
+}
+
+// Parse '#rgb' and '#rrggbb' colors, returns false for any other form
+static bool parseHexColor(const std::string& _color, Color& _result) {
+    size_t length = _color.length();
+    if ((length != 4 && length != 7) || _color[0] != '#') { return false; }
+
+    int digits[6];
+    for (size_t i = 1; i < length; i++) {
+        digits[i - 1] = hexDigit(_color[i]);
+        if (digits[i - 1] < 0) { return false; }
+    }
+
+    if (length == 4) {
+        _result = Color(digits[0] * 17, digits[1] * 17, digits[2] * 17, 1.f);
+    } else {
+        _result = Color(digits[0] * 16 + digits[1], digits[2] * 16 + digits[3],
+                        digits[4] * 16 + digits[5], 1.f);
+    }
+    return true;
+}
+
 uint32_t StyleParam::parseColor(const std::string& _color) {
     Color color;
 
+    if (parseHexColor(_color, color)) {
+        return color.getInt();
+    }
+
     // First, try to parse as comma-separated rgba components.
     glm::vec4 rgba(1.0f);
     int elements = parseVec(_color, rgba);
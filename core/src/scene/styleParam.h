@@ -1,5 +1,6 @@
 #pragma once
 
+#include "data/propertyKey.h"
 #include "labels/labelProperty.h"
 #include "util/variant.h"
 
@@ -157,7 +158,7 @@ struct StyleParam {
 
 
     struct TextSource {
-        std::vector<std::string> keys;
+        std::vector<PropertyKey> keys;
         bool operator==(const TextSource& _other) const {
             return keys == _other.keys;
         }
@@ -228,11 +229,16 @@ struct StyleParam {
     Value value;
     Stops* stops = nullptr;
     int32_t function = -1;
+    // Handle of a constant sprite name in the SpriteNames of the scene
+    uint32_t handle = ~0u;
 
     bool operator<(const StyleParam& _rhs) const { return key < _rhs.key; }
     bool valid() const { return !value.is<none_type>() || stops != nullptr || function >= 0; }
     operator bool() const { return valid(); }
 
+    /* Whether the evaluated value only depends on the zoom of the tile */
+    bool isZoomDependent() const { return stops != nullptr && function < 0; }
+
     std::string toString() const;
 
     /* parse a font size (in em, pt, %) and give the appropriate size in pixel */
@@ -252,8 +258,13 @@ struct StyleParam {
     static int parseValueUnitPair(const std::string& _value, size_t start,
                                   StyleParam::ValueUnitPair& _result);
 
+    // Values of the keys that are slow to parse, like colors, widths and
+    // offsets, are cached per thread by key and _value
     static Value parseString(StyleParamKey key, const std::string& _value);
 
+    // parseString without the cache
+    static Value parseValue(StyleParamKey key, const std::string& _value);
+
     static bool isColor(StyleParamKey _key);
     static bool isSize(StyleParamKey _key);
     static bool isWidth(StyleParamKey _key);
@@ -0,0 +1,224 @@
+#include "selection/featureIndex.h"
+
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace Tangram {
+
+// Children per node
+static const uint32_t NODE_SIZE = 16;
+
+// Position along a Hilbert curve through a 2^16 x 2^16 grid
+static uint32_t hilbertIndex(uint32_t _x, uint32_t _y) {
+    const uint32_t n = 1 << 16;
+    uint32_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (_x & s) > 0;
+        uint32_t ry = (_y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                _x = n - 1 - _x;
+                _y = n - 1 - _y;
+            }
+            std::swap(_x, _y);
+        }
+    }
+    return d;
+}
+
+static float segmentDistance(glm::vec2 _p, glm::vec2 _a, glm::vec2 _b) {
+    glm::vec2 ab = _b - _a;
+    float length2 = glm::dot(ab, ab);
+    float t = length2 > 0.f ? glm::clamp(glm::dot(_p - _a, ab) / length2, 0.f, 1.f) : 0.f;
+    return glm::distance(_p, _a + t * ab);
+}
+
+void FeatureIndex::add(const Feature& _feature, uint32_t _color, uint32_t _order) {
+
+    Entry entry;
+    entry.color = _color;
+    entry.order = _order;
+    entry.sequence = m_entries.size();
+    entry.type = _feature.geometryType;
+    entry.partsBegin = m_parts.size();
+
+    auto addPart = [this](const Line& _line) {
+        uint32_t begin = m_points.size();
+        m_points.insert(m_points.end(), _line.begin(), _line.end());
+        m_parts.push_back({ begin, uint32_t(m_points.size()) });
+    };
+
+    switch (_feature.geometryType) {
+    case GeometryType::points:
+        addPart(_feature.points);
+        break;
+    case GeometryType::lines:
+        for (auto& line : _feature.lines) { addPart(line); }
+        break;
+    case GeometryType::polygons:
+        for (auto& polygon : _feature.polygons) {
+            for (auto& ring : polygon) { addPart(ring); }
+        }
+        break;
+    default:
+        break;
+    }
+
+    entry.partsEnd = m_parts.size();
+
+    if (entry.partsBegin == entry.partsEnd ||
+        m_parts[entry.partsBegin].begin == m_points.size()) {
+        m_parts.resize(entry.partsBegin);
+        return;
+    }
+    m_entries.push_back(entry);
+}
+
+void FeatureIndex::build() {
+
+    m_boxes.clear();
+    m_levels.clear();
+
+    if (m_entries.empty()) { return; }
+
+    std::vector<Box> bounds;
+    bounds.reserve(m_entries.size());
+    for (auto& entry : m_entries) {
+        Box box{ m_points[m_parts[entry.partsBegin].begin], m_points[m_parts[entry.partsBegin].begin] };
+        for (uint32_t i = m_parts[entry.partsBegin].begin; i < m_parts[entry.partsEnd - 1].end; i++) {
+            box.min = glm::min(box.min, m_points[i]);
+            box.max = glm::max(box.max, m_points[i]);
+        }
+        bounds.push_back(box);
+    }
+
+    // Order the entries by the Hilbert index of their centers, so that the
+    // entries below a node are close to each other
+    std::vector<uint32_t> hilbert;
+    hilbert.reserve(m_entries.size());
+    for (auto& box : bounds) {
+        glm::vec2 center = glm::clamp((box.min + box.max) * 0.5f, 0.f, 1.f) * float(0xffff);
+        hilbert.push_back(hilbertIndex(center.x, center.y));
+    }
+
+    std::vector<uint32_t> order(m_entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) {
+        return hilbert[_a] < hilbert[_b];
+    });
+
+    std::vector<Entry> entries;
+    entries.reserve(m_entries.size());
+    for (uint32_t i : order) {
+        entries.push_back(m_entries[i]);
+        m_boxes.push_back(bounds[i]);
+    }
+    m_entries.swap(entries);
+
+    // Pack NODE_SIZE boxes of each level into one box of the next level
+    m_levels.push_back(0);
+    uint32_t begin = 0;
+    uint32_t end = m_boxes.size();
+    while (end - begin > 1) {
+        for (uint32_t i = begin; i < end; i += NODE_SIZE) {
+            Box box = m_boxes[i];
+            for (uint32_t j = i + 1; j < std::min(i + NODE_SIZE, end); j++) {
+                box.min = glm::min(box.min, m_boxes[j].min);
+                box.max = glm::max(box.max, m_boxes[j].max);
+            }
+            m_boxes.push_back(box);
+        }
+        begin = end;
+        end = m_boxes.size();
+        m_levels.push_back(begin);
+    }
+    m_levels.push_back(end);
+}
+
+bool FeatureIndex::hit(const Entry& _entry, glm::vec2 _position, float _radius) const {
+
+    if (_entry.type == GeometryType::points) {
+        auto& part = m_parts[_entry.partsBegin];
+        for (uint32_t i = part.begin; i < part.end; i++) {
+            if (glm::distance(_position, m_points[i]) <= _radius) { return true; }
+        }
+        return false;
+    }
+
+    bool inside = false;
+    for (uint32_t p = _entry.partsBegin; p < _entry.partsEnd; p++) {
+        auto& part = m_parts[p];
+        bool closed = _entry.type == GeometryType::polygons;
+
+        for (uint32_t i = closed ? part.begin : part.begin + 1; i < part.end; i++) {
+            glm::vec2 a = m_points[i == part.begin ? part.end - 1 : i - 1];
+            glm::vec2 b = m_points[i];
+
+            if (segmentDistance(_position, a, b) <= _radius) { return true; }
+
+            // Even-odd rule over all rings of the polygons
+            if (closed && ((a.y > _position.y) != (b.y > _position.y)) &&
+                (_position.x < a.x + (b.x - a.x) * (_position.y - a.y) / (b.y - a.y))) {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+FeatureIndex::Result FeatureIndex::query(glm::vec2 _position, float _radius) const {
+
+    Result result;
+    if (m_levels.empty()) { return result; }
+
+    const Entry* top = nullptr;
+    glm::vec2 min = _position - _radius;
+    glm::vec2 max = _position + _radius;
+
+    // Level and index within the level of the nodes to visit, starting at the root
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back(m_levels.size() - 2, 0);
+
+    while (!stack.empty()) {
+        uint32_t level = stack.back().first;
+        uint32_t index = stack.back().second;
+        stack.pop_back();
+
+        auto& box = m_boxes[m_levels[level] + index];
+        if (box.max.x < min.x || box.max.y < min.y || box.min.x > max.x || box.min.y > max.y) {
+            continue;
+        }
+
+        if (level == 0) {
+            auto& entry = m_entries[index];
+            bool above = !top || entry.order > top->order ||
+                (entry.order == top->order && entry.sequence > top->sequence);
+            if (above && hit(entry, _position, _radius)) { top = &entry; }
+            continue;
+        }
+
+        uint32_t childCount = m_levels[level] - m_levels[level - 1];
+        uint32_t end = std::min((index + 1) * NODE_SIZE, childCount);
+        for (uint32_t child = index * NODE_SIZE; child < end; child++) {
+            stack.emplace_back(level - 1, child);
+        }
+    }
+
+    if (top) {
+        result.color = top->color;
+        result.order = top->order;
+    }
+    return result;
+}
+
+size_t FeatureIndex::memoryUsage() const {
+    return m_entries.capacity() * sizeof(Entry) +
+        m_parts.capacity() * sizeof(Part) +
+        m_points.capacity() * sizeof(glm::vec2) +
+        m_boxes.capacity() * sizeof(Box) +
+        m_levels.capacity() * sizeof(uint32_t);
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "data/tileData.h"
+
+#include "glm/vec2.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Tangram {
+
+/* Index of the interactive features of a tile for picking them without
+ * drawing the selection buffer
+ *
+ * Features are added with their geometry in tile coordinates while the tile is
+ * built. build() sorts them along a Hilbert curve and packs a tree of bounding
+ * boxes over them, which query walks to test only the features near a point.
+ */
+class FeatureIndex {
+
+public:
+
+    struct Result {
+        // Selection color of the feature, 0 when no feature was found
+        uint32_t color = 0;
+        uint32_t order = 0;
+    };
+
+    // Add the geometry of _feature with its selection _color and draw _order
+    void add(const Feature& _feature, uint32_t _color, uint32_t _order);
+
+    // Must be called after adding features and before querying them
+    void build();
+
+    // Returns the feature drawn on top of the others within _radius of _position
+    Result query(glm::vec2 _position, float _radius) const;
+
+    bool empty() const { return m_entries.empty(); }
+
+    size_t memoryUsage() const;
+
+private:
+
+    struct Box {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    struct Part {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct Entry {
+        uint32_t color;
+        uint32_t order;
+        // Features added later are drawn on top of earlier ones with the same order
+        uint32_t sequence;
+        GeometryType type;
+        uint32_t partsBegin;
+        uint32_t partsEnd;
+    };
+
+    bool hit(const Entry& _entry, glm::vec2 _position, float _radius) const;
+
+    std::vector<Entry> m_entries;
+    std::vector<Part> m_parts;
+    std::vector<glm::vec2> m_points;
+
+    // Bounds of the entries, followed by the bounds of each level of nodes up to the root
+    std::vector<Box> m_boxes;
+    // Offset of each level in m_boxes and the end of the last level
+    std::vector<uint32_t> m_levels;
+};
+
+}
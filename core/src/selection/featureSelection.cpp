@@ -18,4 +18,16 @@ uint32_t FeatureSelection::nextColorIdentifier() {
     return entry;
 }
 
+uint32_t FeatureSelection::reserveColors(uint32_t _count) {
+
+    uint32_t first = m_entry.fetch_add(_count);
+
+    // skip ranges containing zero
+    while (first == 0 || uint32_t(first + _count - 1) < first) {
+        first = m_entry.fetch_add(_count);
+    }
+
+    return first;
+}
+
 }
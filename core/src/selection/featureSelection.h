@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 
 namespace Tangram {
 
@@ -12,6 +13,9 @@ public:
 
     uint32_t nextColorIdentifier();
 
+    // Returns the first of _count consecutive colors, none of them zero
+    uint32_t reserveColors(uint32_t _count);
+
 private:
 
     std::atomic<uint32_t> m_entry;
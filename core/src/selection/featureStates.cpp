@@ -0,0 +1,66 @@
+#include "selection/featureStates.h"
+
+namespace Tangram {
+
+constexpr size_t FeatureStates::maxStates;
+
+bool FeatureStates::set(uint32_t _id, const FeatureState& _state) {
+    if (_id == 0) { return false; }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_states.find(_id);
+    if (it == m_states.end()) {
+        if (m_states.size() == maxStates) { return false; }
+        m_states.emplace(_id, _state);
+    } else {
+        it->second = _state;
+    }
+    m_version++;
+    return true;
+}
+
+bool FeatureStates::clear(uint32_t _id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_states.erase(_id) == 0) { return false; }
+    m_version++;
+    return true;
+}
+
+void FeatureStates::clearAll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_states.empty()) { return; }
+    m_states.clear();
+    m_version++;
+}
+
+size_t FeatureStates::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_states.size();
+}
+
+int FeatureStates::uniforms(UniformArray4f& _ids, UniformArray4f& _values) const {
+
+    // Unused entries must still be set, arrays are uploaded in full
+    _ids.assign(maxStates, glm::vec4(0.f));
+    _values.assign(maxStates, glm::vec4(0.f));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int count = 0;
+    for (auto& entry : m_states) {
+        // Selection colors are written to vertices as ABGR bytes
+        uint32_t id = entry.first;
+        _ids[count] = glm::vec4(id & 0xff, (id >> 8) & 0xff, (id >> 16) & 0xff, (id >> 24) & 0xff) / 255.f;
+
+        auto& state = entry.second;
+        _values[count] = glm::vec4(state.color >= 0 ? float(state.color & 0xffffff) : -1.f,
+                                   state.alpha, state.offset[0], state.offset[1]);
+        count++;
+    }
+    return count;
+}
+
+}
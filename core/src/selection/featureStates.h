@@ -0,0 +1,51 @@
+#pragma once
+
+#include "map.h"
+#include "gl/uniform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace Tangram {
+
+/* States of features by their selection color, see Map::setFeatureState
+ *
+ * Styles with feature states look up the selection color of each vertex in
+ * a small uniform table, so a state applies on the next frame without
+ * rebuilding tiles. Setting and clearing states is synchronized, the table
+ * is read on the GL thread.
+ */
+class FeatureStates {
+
+public:
+
+    static constexpr size_t maxStates = 16;
+
+    // Returns false when maxStates features have a state already
+    bool set(uint32_t _id, const FeatureState& _state);
+
+    // Returns false when _id had no state
+    bool clear(uint32_t _id);
+
+    void clearAll();
+
+    size_t size() const;
+
+    // Counts the changes of states, e.g. for styles to skip unchanged tables
+    uint32_t version() const { return m_version; }
+
+    /* Fill _ids with the selection colors of the states as normalized RGBA, and
+     * _values with (0xRRGGBB or -1, alpha, offset x, offset y) of each state.
+     * Returns the number of states. */
+    int uniforms(UniformArray4f& _ids, UniformArray4f& _values) const;
+
+private:
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint32_t, FeatureState> m_states;
+    std::atomic<uint32_t> m_version{0};
+};
+
+}
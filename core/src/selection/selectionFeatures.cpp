@@ -0,0 +1,115 @@
+#include "selection/selectionFeatures.h"
+
+#include "data/properties.h"
+#include "data/propertyItem.h"
+#include "selection/featureSelection.h"
+
+namespace Tangram {
+
+constexpr uint32_t SelectionFeatures::RANGE_SIZE;
+constexpr uint32_t SelectionFeatures::NO_ITEMS;
+
+uint32_t SelectionFeatures::nextColor(FeatureSelection& _selection) {
+
+    uint32_t next = m_features.size();
+
+    if (m_ranges.empty() || next - m_ranges.back().feature == RANGE_SIZE) {
+        m_ranges.push_back({ _selection.reserveColors(RANGE_SIZE), next });
+    }
+    m_features.emplace_back();
+
+    auto& range = m_ranges.back();
+    return range.color + (next - range.feature);
+}
+
+int32_t SelectionFeatures::index(uint32_t _color) const {
+    for (auto& range : m_ranges) {
+        uint32_t offset = _color - range.color;
+        if (offset < RANGE_SIZE && range.feature + offset < m_features.size()) {
+            return range.feature + offset;
+        }
+    }
+    return -1;
+}
+
+uint32_t SelectionFeatures::valueIndex(const Value& _value) {
+
+    uint32_t index = m_values.size();
+
+    if (_value.is<std::string>()) {
+        auto it = m_stringValues.emplace(_value.get<std::string>(), index);
+        if (!it.second) { return it.first->second; }
+    } else if (_value.is<double>()) {
+        auto it = m_numberValues.emplace(_value.get<double>(), index);
+        if (!it.second) { return it.first->second; }
+    }
+    m_values.push_back(_value);
+    return index;
+}
+
+void SelectionFeatures::set(uint32_t _color, const Properties& _properties) {
+
+    int32_t i = index(_color);
+    if (i < 0) { return; }
+
+    auto& feature = m_features[i];
+    if (feature.itemsBegin == NO_ITEMS) { m_count++; }
+
+    feature.sourceId = _properties.sourceId;
+    feature.itemsBegin = m_items.size();
+    for (auto& item : _properties.items()) {
+        m_items.emplace_back(item.key, valueIndex(item.value));
+    }
+    feature.itemsEnd = m_items.size();
+}
+
+void SelectionFeatures::finish() {
+    m_stringValues = {};
+    m_numberValues = {};
+    m_items.shrink_to_fit();
+    m_values.shrink_to_fit();
+}
+
+void SelectionFeatures::clear() {
+    m_ranges.clear();
+    m_features.clear();
+    m_items.clear();
+    m_values.clear();
+    m_count = 0;
+    m_stringValues.clear();
+    m_numberValues.clear();
+}
+
+std::shared_ptr<Properties> SelectionFeatures::get(uint32_t _color) const {
+
+    int32_t i = index(_color);
+    if (i < 0 || m_features[i].itemsBegin == NO_ITEMS) { return nullptr; }
+
+    auto& feature = m_features[i];
+
+    // Items were added in the order of the sorted properties
+    std::vector<Properties::Item> items;
+    items.reserve(feature.itemsEnd - feature.itemsBegin);
+    for (uint32_t item = feature.itemsBegin; item < feature.itemsEnd; item++) {
+        items.emplace_back(m_items[item].first, m_values[m_items[item].second]);
+    }
+
+    auto properties = std::make_shared<Properties>();
+    properties->setSorted(std::move(items));
+    properties->sourceId = feature.sourceId;
+    return properties;
+}
+
+size_t SelectionFeatures::memoryUsage() const {
+    size_t usage = m_ranges.capacity() * sizeof(Range) +
+        m_features.capacity() * sizeof(Feature) +
+        m_items.capacity() * sizeof(m_items[0]) +
+        m_values.capacity() * sizeof(Value);
+
+    for (auto& value : m_values) {
+        if (value.is<std::string>()) { usage += value.get<std::string>().capacity(); }
+    }
+    return usage;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "data/propertyKey.h"
+#include "util/variant.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Tangram {
+
+class FeatureSelection;
+struct Properties;
+
+/* Properties of the interactive features of a tile by their selection color
+ *
+ * Colors are handed out from ranges reserved for the tile, so that a color
+ * maps to its feature by an offset into the range. The properties are kept
+ * as key and value indices into a table of the distinct values of the tile;
+ * <Properties> are only created for the features that are picked.
+ */
+class SelectionFeatures {
+
+public:
+
+    // Returns the color for the next feature, reserving a range of colors from _selection as needed
+    uint32_t nextColor(FeatureSelection& _selection);
+
+    // Set the properties of the feature of _color, the last one returned by nextColor
+    void set(uint32_t _color, const Properties& _properties);
+
+    // Release what is only needed while adding features
+    void finish();
+
+    void clear();
+
+    // Returns the properties of the feature of _color or null
+    std::shared_ptr<Properties> get(uint32_t _color) const;
+
+    // Number of features with properties
+    size_t size() const { return m_count; }
+
+    size_t memoryUsage() const;
+
+private:
+
+    static constexpr uint32_t RANGE_SIZE = 64;
+    static constexpr uint32_t NO_ITEMS = uint32_t(-1);
+
+    struct Range {
+        uint32_t color;
+        // Index of the feature of the first color
+        uint32_t feature;
+    };
+
+    struct Feature {
+        uint32_t itemsBegin = NO_ITEMS;
+        uint32_t itemsEnd = NO_ITEMS;
+        int32_t sourceId = 0;
+    };
+
+    // Returns the index of the feature of _color or -1
+    int32_t index(uint32_t _color) const;
+
+    uint32_t valueIndex(const Value& _value);
+
+    std::vector<Range> m_ranges;
+    std::vector<Feature> m_features;
+    std::vector<std::pair<PropertyKey, uint32_t>> m_items;
+    std::vector<Value> m_values;
+    size_t m_count = 0;
+
+    // Indices of the values in m_values while adding features
+    std::unordered_map<std::string, uint32_t> m_stringValues;
+    std::unordered_map<double, uint32_t> m_numberValues;
+};
+
+}
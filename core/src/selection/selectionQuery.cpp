@@ -1,6 +1,5 @@
 #include "selection/selectionQuery.h"
 
-#include "gl/framebuffer.h"
 #include "labels/label.h"
 #include "labels/labels.h"
 #include "marker/marker.h"
@@ -8,6 +7,7 @@
 #include "tile/tileManager.h"
 #include "view/view.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace Tangram {
@@ -15,44 +15,137 @@ namespace Tangram {
 SelectionQuery::SelectionQuery(glm::vec2 _position, float _radius, QueryCallback _queryCallback)
     : m_position(_position), m_radius(_radius), m_queryCallback(_queryCallback) {}
 
+SelectionQuery::SelectionQuery(std::vector<glm::vec2> _positions, float _radius, FeaturesPickCallback _queryCallback)
+    : m_position(_positions.empty() ? glm::vec2(0.f) : _positions[0]),
+      m_radius(_radius),
+      m_queryCallback(_queryCallback),
+      m_positions(std::move(_positions)) {}
+
+SelectionQuery::SelectionQuery(glm::vec2 _min, glm::vec2 _max, FeaturesPickCallback _queryCallback)
+    : m_position(glm::min(_min, _max)), m_radius(0.f), m_queryCallback(_queryCallback),
+      m_rectMax(glm::max(_min, _max)), m_rect(true) {}
+
 QueryType SelectionQuery::type() const {
+    if (m_queryCallback.is<FeaturesPickCallback>()) { return QueryType::features; }
     return m_queryCallback.is<FeaturePickCallback>() ? QueryType::feature :
           (m_queryCallback.is<LabelPickCallback>() ? QueryType::label : QueryType::marker);
 }
 
-void SelectionQuery::process(const View& _view, const FrameBuffer& _framebuffer, const MarkerManager& _markerManager,
-                             const TileManager& _tileManager, const Labels& _labels, std::vector<SelectionColorRead>& _colorCache) const {
-
+glm::vec4 SelectionQuery::area(const View& _view, glm::vec2 _position) const {
     float radius = m_radius * _view.pixelScale();
-    glm::vec2 windowCoordinates = _view.normalizedWindowCoordinates(m_position.x - radius, m_position.y + radius);
-    glm::vec2 windowSize = _view.normalizedWindowCoordinates(m_position.x + radius, m_position.y - radius) - windowCoordinates;
-
-    GLuint color = 0;
-
-    auto it = std::find_if(_colorCache.begin(), _colorCache.end(), [=](const auto& _colorRead) {
-        return (m_position == _colorRead.position) && (m_radius == _colorRead.radius);
-    });
-
-    if (it == _colorCache.end()) {
-        // Find the first non-zero color nearest to the position and within the selection radius.
-        auto rect = _framebuffer.readRect(windowCoordinates.x, windowCoordinates.y, windowSize.x, windowSize.y);
-        float minDistance = std::fmin(rect.width, rect.height);
-        float hw = static_cast<float>(rect.width) / 2.f, hh = static_cast<float>(rect.height) / 2.f;
-        for (int32_t row = 0; row < rect.height; row++) {
-            for (int32_t col = 0; col < rect.width; col++) {
-                uint32_t sample = rect.pixels[row * rect.width + col];
-                float distance = std::hypot(row - hw, col - hh);
-                if (sample != 0 && distance < minDistance) {
-                    color = sample;
-                    minDistance = distance;
-                }
+    glm::vec2 windowCoordinates = _view.normalizedWindowCoordinates(_position.x - radius, _position.y + radius);
+    glm::vec2 windowSize = _view.normalizedWindowCoordinates(_position.x + radius, _position.y - radius) - windowCoordinates;
+
+    return { windowCoordinates, windowSize };
+}
+
+glm::vec4 SelectionQuery::area(const View& _view) const {
+    if (m_rect) {
+        glm::vec2 windowCoordinates = _view.normalizedWindowCoordinates(m_position.x, m_rectMax.y);
+        glm::vec2 windowSize = _view.normalizedWindowCoordinates(m_rectMax.x, m_position.y) - windowCoordinates;
+        return { windowCoordinates, windowSize };
+    }
+    if (m_positions.empty()) { return area(_view, m_position); }
+
+    glm::vec4 first = area(_view, m_positions[0]);
+    glm::vec2 min(first.x, first.y), max(first.x + first.z, first.y + first.w);
+    for (auto& position : m_positions) {
+        glm::vec4 a = area(_view, position);
+        min = glm::min(min, glm::vec2(a.x, a.y));
+        max = glm::max(max, glm::vec2(a.x + a.z, a.y + a.w));
+    }
+    return { min, max - min };
+}
+
+static uint32_t pixelAt(const FrameBuffer::PixelRect& _readback, int32_t _x, int32_t _y) {
+    int32_t col = _x - _readback.left, row = _y - _readback.bottom;
+    if (col < 0 || row < 0 || col >= _readback.width || row >= _readback.height) { return 0; }
+    return _readback.pixels[row * _readback.width + col];
+}
+
+// Find the first non-zero color nearest to the center of _area, within the radius of the area.
+static uint32_t nearestColor(const FrameBuffer& _framebuffer, const FrameBuffer::PixelRect& _readback,
+                             glm::vec4 _area) {
+    auto rect = _framebuffer.pixelRect(_area.x, _area.y, _area.z, _area.w);
+
+    uint32_t color = 0;
+    float minDistance = std::fmin(rect.width, rect.height);
+    float hw = static_cast<float>(rect.width) / 2.f, hh = static_cast<float>(rect.height) / 2.f;
+    for (int32_t row = 0; row < rect.height; row++) {
+        for (int32_t col = 0; col < rect.width; col++) {
+            uint32_t sample = pixelAt(_readback, rect.left + col, rect.bottom + row);
+            float distance = std::hypot(row - hw, col - hh);
+            if (sample != 0 && distance < minDistance) {
+                color = sample;
+                minDistance = distance;
+            }
+        }
+    }
+    return color;
+}
+
+static std::shared_ptr<Properties> selectionFeature(const TileManager& _tileManager, uint32_t _color) {
+    for (const auto& tile : _tileManager.getVisibleTiles()) {
+        if (auto props = tile->getSelectionFeature(_color)) { return props; }
+    }
+    return nullptr;
+}
+
+void SelectionQuery::processFeatures(const View& _view, const FrameBuffer& _framebuffer,
+                                     const FrameBuffer::PixelRect& _readback,
+                                     const TileManager& _tileManager) const {
+
+    auto& cb = m_queryCallback.get<FeaturesPickCallback>();
+    std::vector<FeaturePickResult> results;
+
+    if (!m_rect) {
+        for (auto& position : m_positions) {
+            uint32_t color = nearestColor(_framebuffer, _readback, area(_view, position));
+            if (color == 0) { continue; }
+
+            if (auto props = selectionFeature(_tileManager, color)) {
+                results.emplace_back(props, std::array<float, 2>{{position.x, position.y}}, color);
+            }
+        }
+        cb(results);
+        return;
+    }
+
+    // Each feature once, at the first of its pixels from the bottom left
+    glm::vec4 rectArea = area(_view);
+    auto rect = _framebuffer.pixelRect(rectArea.x, rectArea.y, rectArea.z, rectArea.w);
+    glm::vec2 pixelSize(_view.getWidth() / _framebuffer.getWidth(),
+                        _view.getHeight() / _framebuffer.getHeight());
+    std::vector<uint32_t> colors;
+
+    for (int32_t row = 0; row < rect.height; row++) {
+        for (int32_t col = 0; col < rect.width; col++) {
+            uint32_t color = pixelAt(_readback, rect.left + col, rect.bottom + row);
+            if (color == 0 || std::find(colors.begin(), colors.end(), color) != colors.end()) {
+                continue;
+            }
+            colors.push_back(color);
+
+            if (auto props = selectionFeature(_tileManager, color)) {
+                float x = (rect.left + col + .5f) * pixelSize.x;
+                float y = _view.getHeight() - (rect.bottom + row + .5f) * pixelSize.y;
+                results.emplace_back(props, std::array<float, 2>{{x, y}}, color);
             }
         }
-        // Cache the resulting color for other queries.
-        _colorCache.push_back({color, m_radius, m_position});
-    } else {
-        color = it->color;
     }
+    cb(results);
+}
+
+void SelectionQuery::process(const View& _view, const FrameBuffer& _framebuffer,
+                             const FrameBuffer::PixelRect& _readback, const MarkerManager& _markerManager,
+                             const TileManager& _tileManager, const Labels& _labels) const {
+
+    if (type() == QueryType::features) {
+        processFeatures(_view, _framebuffer, _readback, _tileManager);
+        return;
+    }
+
+    GLuint color = nearestColor(_framebuffer, _readback, area(_view));
 
     switch (type()) {
     case QueryType::feature: {
@@ -63,12 +156,10 @@ void SelectionQuery::process(const View& _view, const FrameBuffer& _framebuffer,
             return;
         }
 
-        for (const auto& tile : _tileManager.getVisibleTiles()) {
-            if (auto props = tile->getSelectionFeature(color)) {
-                FeaturePickResult queryResult(props, {{m_position.x, m_position.y}});
-                cb(&queryResult);
-                return;
-            }
+        if (auto props = selectionFeature(_tileManager, color)) {
+            FeaturePickResult queryResult(props, {{m_position.x, m_position.y}}, color);
+            cb(&queryResult);
+            return;
         }
 
         cb(nullptr);
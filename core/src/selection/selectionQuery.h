@@ -1,13 +1,16 @@
 #pragma once
 
+#include "gl/framebuffer.h"
 #include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
 #include "map.h"
 #include "util/variant.h"
 
+#include <vector>
+
 namespace Tangram {
 
 class MarkerManager;
-class FrameBuffer;
 class TileManager;
 class Labels;
 class View;
@@ -16,30 +19,50 @@ enum class QueryType {
     feature,
     marker,
     label,
+    features,
 };
 
-using QueryCallback = variant<FeaturePickCallback, LabelPickCallback, MarkerPickCallback>;
-
-struct SelectionColorRead {
-    uint32_t color;
-    float radius;
-    glm::vec2 position;
-};
+using QueryCallback = variant<FeaturePickCallback, LabelPickCallback, MarkerPickCallback, FeaturesPickCallback>;
 
 class SelectionQuery {
 
 public:
     SelectionQuery(glm::vec2 _position, float _radius, QueryCallback _queryCallback);
 
-    void process(const View& _view, const FrameBuffer& _framebuffer, const MarkerManager& _markerManager,
-                 const TileManager& _tileManager, const Labels& _labels, std::vector<SelectionColorRead>& _cache) const;
+    /* Query the features at each of _positions */
+    SelectionQuery(std::vector<glm::vec2> _positions, float _radius, FeaturesPickCallback _queryCallback);
+
+    /* Query all features within the rectangle from _min to _max in screen coordinates */
+    SelectionQuery(glm::vec2 _min, glm::vec2 _max, FeaturesPickCallback _queryCallback);
+
+    /* Resolve the query from _readback, the pixels of _framebuffer read for the
+     * area of all queries of the frame */
+    void process(const View& _view, const FrameBuffer& _framebuffer, const FrameBuffer::PixelRect& _readback,
+                 const MarkerManager& _markerManager, const TileManager& _tileManager,
+                 const Labels& _labels) const;
 
     QueryType type() const;
 
+    /* Area of the selection buffer read by the query in normalized window
+     * coordinates, as x, y, width and height */
+    glm::vec4 area(const View& _view) const;
+
 private:
+    glm::vec4 area(const View& _view, glm::vec2 _position) const;
+
+    void processFeatures(const View& _view, const FrameBuffer& _framebuffer,
+                         const FrameBuffer::PixelRect& _readback, const TileManager& _tileManager) const;
+
     glm::vec2 m_position;
     float m_radius;
     QueryCallback m_queryCallback;
 
+    // All positions of a query for several features
+    std::vector<glm::vec2> m_positions;
+
+    // Corner opposite to m_position of a rectangle query
+    glm::vec2 m_rectMax;
+    bool m_rect = false;
+
 };
 }
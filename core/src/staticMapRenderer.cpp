@@ -0,0 +1,231 @@
+#include "staticMapRenderer.h"
+
+#include "log.h"
+
+#define MINIZ_NO_ZLIB_APIS
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <miniz.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Tangram {
+
+static double millisSince(StaticMapRenderer::Clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(StaticMapRenderer::Clock::now() - _start).count();
+}
+
+// Distance of two views in tiles at the zoom of _b. Views at other zooms
+// share few built tiles, a zoom level counts as far as a view width of tiles.
+static double viewDistance(const StaticMapRequest& _a, const StaticMapRequest& _b) {
+    auto mercator = [](const StaticMapRequest& _r, double _scale, double& _x, double& _y) {
+        double lat = std::max(-85.0511, std::min(85.0511, _r.lat)) * M_PI / 180.0;
+        _x = (_r.lon + 180.0) / 360.0 * _scale;
+        _y = (1.0 - std::log(std::tan(lat) + 1.0 / std::cos(lat)) / M_PI) * 0.5 * _scale;
+    };
+    double scale = std::exp2(std::round(_b.zoom));
+    double ax, ay, bx, by;
+    mercator(_a, scale, ax, ay);
+    mercator(_b, scale, bx, by);
+
+    double viewTiles = std::max(_b.width, _b.height) / 256.0;
+    return std::hypot(ax - bx, ay - by) + std::abs(_a.zoom - _b.zoom) * viewTiles * 4;
+}
+
+StaticMapRenderer::StaticMapRenderer(std::shared_ptr<MapContext> _context, const std::string& _scenePath,
+                                     std::vector<std::function<bool()>> _makeCurrent, Options _options)
+    : m_context(std::move(_context)),
+      m_scenePath(_scenePath),
+      m_makeCurrent(std::move(_makeCurrent)),
+      m_options(std::move(_options)),
+      m_start(Clock::now()) {
+
+    m_running = m_makeCurrent.size();
+    for (size_t i = 0; i < m_makeCurrent.size(); i++) {
+        m_threads.emplace_back(&StaticMapRenderer::run, this, i);
+    }
+}
+
+StaticMapRenderer::~StaticMapRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_jobs.clear();
+    }
+    m_jobsChanged.notify_all();
+
+    for (auto& thread : m_threads) { thread.join(); }
+}
+
+uint64_t StaticMapRenderer::request(const StaticMapRequest& _request, StaticMapCallback _callback) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_nextId++;
+        m_jobs.push_back({ id, _request, std::move(_callback), Clock::now() });
+        m_stats.requests++;
+    }
+    m_jobsChanged.notify_all();
+    return id;
+}
+
+void StaticMapRenderer::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobsChanged.wait(lock, [this]{
+        return m_stop || m_running == 0 || (m_jobs.empty() && m_drawing == 0);
+    });
+}
+
+StaticMapStats StaticMapRenderer::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    StaticMapStats stats = m_stats;
+    stats.queued = m_jobs.size();
+    double seconds = millisSince(m_start) / 1000.0;
+    if (seconds > 0) { stats.imagesPerSecond = stats.images / seconds; }
+    if (stats.images > 0) {
+        stats.averageLatency = m_totalLatency / stats.images;
+        stats.averageRenderTime = m_totalRenderTime / stats.images;
+    }
+    return stats;
+}
+
+bool StaticMapRenderer::nextJob(const StaticMapRequest* _last, Job& _job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobsChanged.wait(lock, [this]{ return m_stop || !m_jobs.empty(); });
+    if (m_stop) { return false; }
+
+    auto next = m_jobs.begin();
+    if (_last) {
+        double nearest = std::numeric_limits<double>::max();
+        for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+            double distance = viewDistance(*_last, it->request);
+            if (distance < nearest) {
+                nearest = distance;
+                next = it;
+            }
+        }
+        // Views within the last one, or overlapping it
+        double viewTiles = std::max(_last->width, _last->height) / 256.0;
+        if (nearest < viewTiles) { m_stats.reusedViews++; }
+    }
+    _job = std::move(*next);
+    m_jobs.erase(next);
+    m_drawing++;
+    return true;
+}
+
+void StaticMapRenderer::run(size_t _context) {
+
+    if (!m_makeCurrent[_context]()) {
+        LOGE("StaticMapRenderer: cannot make GL context %d current", int(_context));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running--;
+        }
+        m_jobsChanged.notify_all();
+        return;
+    }
+
+    bool sceneReady = true;
+    Map map(m_context, m_options.profile);
+    map.setSceneReadyListener([&](SceneID, const SceneError* _error) {
+        if (_error) {
+            LOGE("StaticMapRenderer: cannot load scene '%s', error %d", m_scenePath.c_str(), _error->error);
+            sceneReady = false;
+        }
+    });
+    map.setupGL();
+    map.loadScene(m_scenePath);
+
+    Job job;
+    StaticMapRequest last;
+    bool hasLast = false;
+
+    while (nextJob(hasLast ? &last : nullptr, job)) {
+        StaticMapImage image;
+        image.id = job.id;
+
+        auto drawStart = Clock::now();
+        if (sceneReady) { draw(map, job, image); }
+        image.renderTime = millisSince(drawStart);
+        image.latency = millisSince(job.queued);
+
+        last = job.request;
+        hasLast = true;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.images++;
+            if (!image.complete) { m_stats.incomplete++; }
+            m_totalLatency += image.latency;
+            m_totalRenderTime += image.renderTime;
+        }
+
+        if (job.callback) { job.callback(std::move(image)); }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_drawing--;
+        }
+        m_jobsChanged.notify_all();
+    }
+}
+
+void StaticMapRenderer::draw(Map& _map, Job& _job, StaticMapImage& _image) {
+
+    const auto& request = _job.request;
+    int width = std::max(request.width, 1);
+    int height = std::max(request.height, 1);
+
+    if (_map.getViewportWidth() != width || _map.getViewportHeight() != height) {
+        _map.resize(width, height);
+    }
+    _map.setPosition(request.lon, request.lat);
+    _map.setZoom(request.zoom);
+    _map.setRotation(request.rotation);
+    _map.setTilt(request.tilt);
+
+    // Draw until the tiles of the view are loaded and labels are placed
+    auto start = Clock::now();
+    while (true) {
+        bool viewComplete = _map.update(m_options.frameDelta);
+        _map.render();
+        if (viewComplete && _map.isIdle() && _map.getPerformanceStats().tilesInFlight == 0) {
+            _image.complete = true;
+            break;
+        }
+        if (millisSince(start) > m_options.timeout) {
+            LOGW("StaticMapRenderer: tiles of request %d not loaded within %.0fms",
+                 int(_job.id), m_options.timeout);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<unsigned int> pixels(width * height);
+    _map.captureSnapshot(pixels.data());
+
+    // GL reads the rows from the bottom
+    _image.width = width;
+    _image.height = height;
+    _image.pixels.resize(width * height);
+    for (int y = 0; y < height; y++) {
+        std::memcpy(&_image.pixels[y * width], &pixels[(height - 1 - y) * width], width * sizeof(unsigned int));
+    }
+
+    if (request.png) {
+        size_t size = 0;
+        void* png = tdefl_write_image_to_png_file_in_memory(_image.pixels.data(), width, height, 4, &size);
+        if (png) {
+            _image.png.assign(static_cast<char*>(png), static_cast<char*>(png) + size);
+            mz_free(png);
+        } else {
+            LOGE("StaticMapRenderer: cannot encode PNG of request %d", int(_job.id));
+        }
+    }
+}
+
+}
@@ -1,10 +1,13 @@
 #include "style/pointStyle.h"
 
+#include "gl/dynamicInstanceMesh.h"
 #include "gl/dynamicQuadMesh.h"
+#include "gl/hardware.h"
 #include "gl/shaderProgram.h"
 #include "gl/texture.h"
 #include "gl/vertexLayout.h"
 #include "platform.h"
+#include "scene/scene.h"
 #include "scene/spriteAtlas.h"
 #include "style/pointStyleBuilder.h"
 #include "view/view.h"
@@ -31,6 +34,22 @@ void PointStyle::build(const Scene& _scene) {
     m_textStyle->build(_scene);
 
     m_mesh = std::make_unique<DynamicQuadMesh<SpriteVertex>>(m_vertexLayout, m_drawMode);
+
+    m_instances = std::make_unique<DynamicInstanceMesh<SpriteInstance>>(m_instanceLayout);
+
+    // Own programs for the instanced variant: the default ones may be
+    // shared with other styles using the vertex layout of m_mesh.
+    const std::string instanced = "#define TANGRAM_INSTANCED\n";
+
+    m_instancedProgram = _scene.shaderProgram(instanced + m_shaderProgram->vertexShaderSource(),
+                                              m_shaderProgram->fragmentShaderSource(),
+                                              "instanced {style:" + m_name + "}");
+
+    if (m_selection) {
+        m_instancedSelectionProgram = _scene.shaderProgram(instanced + m_selectionProgram->vertexShaderSource(),
+                                                           m_selectionProgram->fragmentShaderSource(),
+                                                           "instanced selection_program {style:" + m_name + "}");
+    }
 }
 
 void PointStyle::constructVertexLayout() {
@@ -44,6 +63,18 @@ void PointStyle::constructVertexLayout() {
         {"a_aa_factor", 1, GL_SHORT, true, 0},
         {"a_alpha", 1, GL_UNSIGNED_SHORT, true, 0},
     }));
+
+    m_instanceLayout = std::shared_ptr<VertexLayout>(new VertexLayout({
+        {"a_position", 4, GL_FLOAT, false, 0},
+        {"a_axis_x", 4, GL_FLOAT, false, 0},
+        {"a_axis_y", 4, GL_FLOAT, false, 0},
+        {"a_uv", 4, GL_SHORT, true, 0},
+        {"a_selection_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_outline_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_aa_factor", 1, GL_SHORT, true, 0},
+        {"a_alpha", 1, GL_UNSIGNED_SHORT, true, 0},
+    }));
 }
 
 void PointStyle::constructShaderProgram() {
@@ -52,14 +83,44 @@ void PointStyle::constructShaderProgram() {
 }
 
 void PointStyle::onBeginUpdate() {
+    // Hardware extensions are known once the GL context exists. Choose the
+    // program variant before the first labels are pushed and drawn.
+    if (!m_instancingResolved) {
+        m_instancingResolved = true;
+
+        if (Hardware::supportsInstancing) {
+            m_instanced = true;
+            m_shaderProgram = m_instancedProgram;
+            if (m_selection) { m_selectionProgram = m_instancedSelectionProgram; }
+        }
+    }
+
     m_mesh->clear();
+    m_instances->clear();
     m_batches.clear();
     m_textStyle->onBeginUpdate();
 }
 
+bool PointStyle::programsReady(RenderState& rs) {
+    // Start building both, the labels draw with the programs of m_textStyle
+    bool ready = Style::programsReady(rs);
+    return m_textStyle->programsReady(rs) && ready;
+}
+
+void PointStyle::onEndUpdate() {
+    m_mesh->swap();
+    m_instances->swap();
+    std::swap(m_batches, m_drawBatches);
+    m_textStyle->onEndUpdate();
+}
+
 void PointStyle::onBeginFrame(RenderState& rs) {
     // Upload meshes for next frame
-    m_mesh->upload(rs);
+    if (m_instanced) {
+        m_instances->upload(rs);
+    } else {
+        m_mesh->upload(rs);
+    }
     m_textStyle->onBeginFrame(rs);
 }
 
@@ -74,8 +135,8 @@ void PointStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _sc
                                         _view.getOrthoViewportMatrix());
 
 
-    size_t vertexPos = 0;
-    for (auto& batch : m_batches) {
+    size_t quadPos = 0;
+    for (auto& batch : m_drawBatches) {
 
         auto tex = batch.texture;
 
@@ -86,9 +147,13 @@ void PointStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _sc
             tex->bind(rs, texUnit);
         }
 
-        m_mesh->drawRange(rs, *m_shaderProgram, vertexPos, batch.vertexCount);
+        if (m_instanced) {
+            m_instances->drawRange(rs, *m_shaderProgram, quadPos, batch.quadCount);
+        } else {
+            m_mesh->drawRange(rs, *m_shaderProgram, quadPos * 4, batch.quadCount * 4);
+        }
 
-        vertexPos += batch.vertexCount;
+        quadPos += batch.quadCount;
     }
 
     m_textStyle->onBeginDrawFrame(rs, _view, _scene);
@@ -97,14 +162,22 @@ void PointStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _sc
 void PointStyle::onBeginDrawSelectionFrame(RenderState& rs, const View& _view, Scene& _scene) {
     if (!m_selection) { return; }
 
-    m_mesh->upload(rs);
+    if (m_instanced) {
+        m_instances->upload(rs);
+    } else {
+        m_mesh->upload(rs);
+    }
 
     Style::onBeginDrawSelectionFrame(rs, _view, _scene);
 
     m_selectionProgram->setUniformMatrix4f(rs, m_selectionUniforms.uOrtho,
                                            _view.getOrthoViewportMatrix());
 
-    m_mesh->draw(rs, *m_selectionProgram, false);
+    if (m_instanced) {
+        m_instances->draw(rs, *m_selectionProgram, false);
+    } else {
+        m_mesh->draw(rs, *m_selectionProgram, false);
+    }
 
     m_textStyle->onBeginDrawSelectionFrame(rs, _view, _scene);
 }
@@ -118,15 +191,35 @@ void PointStyle::setPixelScale(float _pixelScale) {
     m_textStyle->setPixelScale(_pixelScale);
 }
 
-SpriteVertex* PointStyle::pushQuad(Texture* texture) const {
+void PointStyle::pushQuad(Texture* _texture, const std::array<glm::vec4, 4>& _positions,
+                          const SpriteQuad& _quad, const SpriteVertex::State& _state) const {
 
-    if (m_batches.empty() || m_batches.back().texture != texture) {
-        m_batches.push_back({ texture });
+    if (m_batches.empty() || m_batches.back().texture != _texture) {
+        m_batches.push_back({ _texture });
     }
 
-    m_batches.back().vertexCount += 4;
+    m_batches.back().quadCount += 1;
 
-    return m_mesh->pushQuad();
+    if (m_instanced) {
+        // Corners are ordered (-1, 1), (1, 1), (-1, -1), (1, -1) and
+        // lie on a parallelogram, also for flat sprites in clip space.
+        SpriteInstance& instance = *m_instances->pushInstance();
+
+        instance.center = (_positions[0] + _positions[3]) * 0.5f;
+        instance.axisX = (_positions[1] - _positions[0]) * 0.5f;
+        instance.axisY = (_positions[0] - _positions[2]) * 0.5f;
+        instance.uv = { _quad.quad[2].uv, _quad.quad[1].uv };
+        instance.state = _state;
+        return;
+    }
+
+    SpriteVertex* vertices = m_mesh->pushQuad();
+
+    for (int i = 0; i < 4; i++) {
+        vertices[i].pos = _positions[i];
+        vertices[i].uv = _quad.quad[i].uv;
+        vertices[i].state = _state;
+    }
 }
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "gl/dynamicInstanceMesh.h"
 #include "gl/dynamicQuadMesh.h"
 #include "labels/spriteLabel.h"
 #include "labels/labelProperty.h"
@@ -25,9 +26,11 @@ public:
     virtual ~PointStyle();
 
     virtual void onBeginUpdate() override;
+    virtual void onEndUpdate() override;
     virtual void onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _scene) override;
     virtual void onBeginFrame(RenderState& rs) override;
     virtual void onBeginDrawSelectionFrame(RenderState& rs, const View& _view, Scene& _scene) override;
+    virtual bool programsReady(RenderState& rs) override;
     virtual void draw(RenderState& rs, const Tile& _tile) override {}
     virtual void draw(RenderState& rs, const Marker& _marker) override {}
 
@@ -42,7 +45,9 @@ public:
     const auto& defaultTexture() const { return m_defaultTexture; }
 
     auto& mesh() const { return m_mesh; }
-    virtual size_t dynamicMeshSize() const override { return m_mesh->bufferSize(); }
+    virtual size_t dynamicMeshSize() const override {
+        return m_mesh->bufferSize() + m_instances->bufferSize();
+    }
 
     virtual std::unique_ptr<StyleBuilder> createBuilder() const override;
 
@@ -54,7 +59,11 @@ public:
     TextStyle& textStyle() const { return *m_textStyle; }
     virtual void setPixelScale(float _pixelScale) override;
 
-    SpriteVertex* pushQuad(Texture* texture) const;
+    // Add a sprite quad with the clip space corners _positions
+    void pushQuad(Texture* _texture, const std::array<glm::vec4, 4>& _positions,
+                  const SpriteQuad& _quad, const SpriteVertex::State& _state) const;
+
+    bool isInstanced() const { return m_instanced; }
 
 protected:
 
@@ -72,11 +81,21 @@ protected:
     struct TextureBatch {
         TextureBatch(Texture* t) : texture(t) {}
         Texture* texture = nullptr;
-        size_t vertexCount = 0;
+        size_t quadCount = 0;
     };
 
     mutable std::unique_ptr<DynamicQuadMesh<SpriteVertex>> m_mesh;
+
+    // One SpriteInstance per quad when the hardware supports instancing
+    std::shared_ptr<VertexLayout> m_instanceLayout;
+    mutable std::unique_ptr<DynamicInstanceMesh<SpriteInstance>> m_instances;
+    std::shared_ptr<ShaderProgram> m_instancedProgram;
+    std::shared_ptr<ShaderProgram> m_instancedSelectionProgram;
+    bool m_instanced = false;
+    bool m_instancingResolved = false;
     mutable std::vector<TextureBatch> m_batches;
+    // Batches of the quads that are drawn
+    std::vector<TextureBatch> m_drawBatches;
 
     std::unique_ptr<TextStyle> m_textStyle;
 };
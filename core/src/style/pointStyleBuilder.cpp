@@ -20,15 +20,7 @@ namespace Tangram {
 
 void IconMesh::setTextLabels(std::unique_ptr<StyledMesh> _textLabels) {
 
-    auto* mesh = static_cast<TextLabels*>(_textLabels.get());
-    auto& labels = mesh->getLabels();
-
-    typedef std::vector<std::unique_ptr<Label>>::iterator iter_t;
-    m_labels.insert(m_labels.end(),
-                    std::move_iterator<iter_t>(labels.begin()),
-                    std::move_iterator<iter_t>(labels.end()));
-
-    labels.clear();
+    addLabels(*static_cast<TextLabels*>(_textLabels.get()));
 
     textLabels = std::move(_textLabels);
 }
@@ -54,7 +46,7 @@ std::unique_ptr<StyledMesh> PointStyleBuilder::build() {
            if (label->state() != Label::State::dead) { sumLabels +=1; }
         }
 
-       std::vector<std::unique_ptr<Label>> labels;
+       std::vector<LabelPtr> labels;
        labels.reserve(sumLabels);
 
        for (auto& label : m_labels) {
@@ -90,6 +82,8 @@ void PointStyleBuilder::setup(const Tile& _tile) {
     m_spriteLabels = std::make_unique<SpriteLabels>(m_style);
 
     m_textStyleBuilder->setup(_tile);
+    // Labels left from a build without quads live in the pool of the last mesh
+    m_labels.clear();
     m_iconMesh = std::make_unique<IconMesh>();
 }
 
@@ -99,6 +93,8 @@ void PointStyleBuilder::setup(const Marker& _marker, int zoom) {
     m_spriteLabels = std::make_unique<SpriteLabels>(m_style);
 
     m_textStyleBuilder->setup(_marker, zoom);
+    // Labels left from a build without quads live in the pool of the last mesh
+    m_labels.clear();
     m_iconMesh = std::make_unique<IconMesh>();
 
     m_texture = _marker.texture();
@@ -128,7 +124,11 @@ auto PointStyleBuilder::applyRule(const DrawRule& _rule) const -> Parameters {
     Parameters p;
 
     _rule.get(StyleParamKey::color, p.color);
-    _rule.get(StyleParamKey::sprite, p.sprite);
+    // Constant sprite names carry their handle, function results are found by name
+    if (auto& sprite = _rule.findParameter(StyleParamKey::sprite)) {
+        p.spriteHandle = sprite.handle;
+        if (p.spriteHandle == SpriteNames::none) { _rule.get(StyleParamKey::sprite, p.sprite); }
+    }
     _rule.get(StyleParamKey::offset, p.labelOptions.offset);
     _rule.get(StyleParamKey::buffer, p.labelOptions.buffer);
 
@@ -140,7 +140,12 @@ auto PointStyleBuilder::applyRule(const DrawRule& _rule) const -> Parameters {
         p.labelOptions.priority = (float)priority;
     }
 
-    _rule.get(StyleParamKey::sprite_default, p.spriteDefault);
+    if (auto& spriteDefault = _rule.findParameter(StyleParamKey::sprite_default)) {
+        p.spriteDefaultHandle = spriteDefault.handle;
+        if (p.spriteDefaultHandle == SpriteNames::none) {
+            _rule.get(StyleParamKey::sprite_default, p.spriteDefault);
+        }
+    }
     p.dynamicTexture = _rule.get(StyleParamKey::texture, p.texture);
 
     _rule.get(StyleParamKey::placement, p.placement);
@@ -226,7 +231,7 @@ void PointStyleBuilder::addLabel(const Point& _point, const glm::vec4& _quad, Te
         }
     }
 
-    m_labels.push_back(std::make_unique<SpriteLabel>(glm::vec3(glm::vec2(_point), m_zoom),
+    m_labels.push_back(m_iconMesh->pool().make<SpriteLabel>(glm::vec3(glm::vec2(_point), m_zoom),
                                                      _params.size,
                                                      _params.labelOptions,
                                                      SpriteLabel::VertexAttributes{
@@ -306,7 +311,6 @@ bool PointStyleBuilder::getTexture(const Parameters& _params, Texture **_texture
 
 bool PointStyleBuilder::evalSizeParam(const DrawRule& _rule, Parameters& _params, const Texture* _texture) const {
     StyleParam::SizeValue size;
-    SpriteNode spriteNode;
     glm::vec2 spriteSize(NAN);
 
     if (_texture) {
@@ -314,12 +318,14 @@ bool PointStyleBuilder::evalSizeParam(const DrawRule& _rule, Parameters& _params
 
         const auto &atlas = _texture->spriteAtlas();
         if (atlas) {
-            if (!atlas->getSpriteNode(_params.sprite, spriteNode) &&
-                !atlas->getSpriteNode(_params.spriteDefault, spriteNode)) {
+            _params.spriteNode = findSprite(_params, *atlas);
+            if (!_params.spriteNode) {
                 return false;
             }
-            spriteSize = spriteNode.m_size * _texture->invDensity();
-        } else if ( !_params.sprite.empty() || !_params.spriteDefault.empty()) {
+            spriteSize = _params.spriteNode->m_size * _texture->invDensity();
+        } else if (!_params.sprite.empty() || !_params.spriteDefault.empty() ||
+                   _params.spriteHandle != SpriteNames::none ||
+                   _params.spriteDefaultHandle != SpriteNames::none) {
             // missing sprite atlas for texture but sprite specified in draw rule
             return false;
         }
@@ -353,6 +359,20 @@ bool PointStyleBuilder::evalSizeParam(const DrawRule& _rule, Parameters& _params
     return true;
 }
 
+const SpriteNode* PointStyleBuilder::findSprite(const Parameters& _params, const SpriteAtlas& _atlas) const {
+
+    const SpriteNode* node = (_params.spriteHandle != SpriteNames::none)
+        ? _atlas.findSpriteNode(_params.spriteHandle)
+        : _atlas.findSpriteNode(_params.sprite);
+
+    if (!node) {
+        node = (_params.spriteDefaultHandle != SpriteNames::none)
+            ? _atlas.findSpriteNode(_params.spriteDefaultHandle)
+            : _atlas.findSpriteNode(_params.spriteDefault);
+    }
+    return node;
+}
+
 bool PointStyleBuilder::getUVQuad(Parameters& _params, glm::vec4& _quad, const Texture* _texture) const {
 
     _quad = glm::vec4(0.0, 1.0, 1.0, 0.0);
@@ -360,15 +380,14 @@ bool PointStyleBuilder::getUVQuad(Parameters& _params, glm::vec4& _quad, const T
     if (_texture) {
         const auto& atlas = _texture->spriteAtlas();
         if (atlas) {
-            SpriteNode spriteNode;
-            if (!atlas->getSpriteNode(_params.sprite, spriteNode) &&
-                !atlas->getSpriteNode(_params.spriteDefault, spriteNode)) {
+            const SpriteNode* spriteNode = _params.spriteNode ? _params.spriteNode : findSprite(_params, *atlas);
+            if (!spriteNode) {
                 return false;
             }
-            _quad.x = spriteNode.m_uvBL.x;
-            _quad.y = spriteNode.m_uvBL.y;
-            _quad.z = spriteNode.m_uvTR.x;
-            _quad.w = spriteNode.m_uvTR.y;
+            _quad.x = spriteNode->m_uvBL.x;
+            _quad.y = spriteNode->m_uvBL.y;
+            _quad.z = spriteNode->m_uvTR.x;
+            _quad.w = spriteNode->m_uvTR.y;
         }
     } else {
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "scene/spriteAtlas.h"
 #include "style/style.h"
 #include "style/pointStyle.h"
 #include "style/textStyleBuilder.h"
@@ -26,6 +27,11 @@ struct PointStyleBuilder : public StyleBuilder {
         bool dynamicTexture = false;
         std::string sprite;
         std::string spriteDefault;
+        // Handles of constant sprite names, see SpriteNames
+        uint32_t spriteHandle = SpriteNames::none;
+        uint32_t spriteDefaultHandle = SpriteNames::none;
+        // Sprite of the texture atlas, set by evalSizeParam
+        const SpriteNode* spriteNode = nullptr;
         std::string texture;
         glm::vec2 size = { 16.f, 16.f };
         uint32_t color = 0xffffffff;
@@ -70,6 +76,8 @@ struct PointStyleBuilder : public StyleBuilder {
 
     void addLayoutItems(LabelCollider& _layout) override;
 
+    bool buildsLabels() const override { return true; }
+
     bool addFeature(const Feature& _feat, const DrawRule& _rule) override;
 
 private:
@@ -95,7 +103,10 @@ private:
     bool evalSizeParam(const DrawRule& _rule, Parameters& _params, const Texture* _texture) const;
     bool getUVQuad(Parameters& _params, glm::vec4& _quad, const Texture* _texture) const;
 
-    std::vector<std::unique_ptr<Label>> m_labels;
+    // Sprite node of the sprite of _params or of its default sprite
+    const SpriteNode* findSprite(const Parameters& _params, const SpriteAtlas& _atlas) const;
+
+    std::vector<LabelPtr> m_labels;
     std::vector<SpriteQuad> m_quads;
 
     std::unique_ptr<IconMesh> m_iconMesh;
@@ -120,6 +131,7 @@ namespace std {
             std::hash<Tangram::Label::Options> optionsHash;
             std::size_t seed = 0;
             hash_combine(seed, p.sprite);
+            hash_combine(seed, p.spriteHandle);
             hash_combine(seed, p.color);
             hash_combine(seed, p.size.x);
             hash_combine(seed, p.size.y);
@@ -10,10 +10,12 @@
 #include "tile/tile.h"
 #include "util/builders.h"
 #include "util/extrude.h"
+#include "util/meshOptimizer.h"
 
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/gtc/type_precision.hpp"
+#include <algorithm>
 #include <cmath>
 
 #include "polygon_fs.h"
@@ -41,6 +43,19 @@ struct PolygonVertexNoUVs {
     GLuint selection;
 };
 
+// Vertex of unlit styles, without normals
+struct PolygonVertexFlat {
+
+    PolygonVertexFlat(glm::vec3 position, uint32_t order, glm::vec3 normal, glm::vec2 uv, GLuint abgr, GLuint selection)
+        : pos(glm::i16vec4{ glm::round(position * position_scale), order }),
+          abgr(abgr),
+          selection(selection) {}
+
+    glm::i16vec4 pos; // pos.w contains layer (params.order)
+    GLuint abgr;
+    GLuint selection;
+};
+
 struct PolygonVertex : PolygonVertexNoUVs {
 
     PolygonVertex(glm::vec3 position, uint32_t order, glm::vec3 normal, glm::vec2 uv, GLuint abgr, GLuint selection)
@@ -51,11 +66,32 @@ struct PolygonVertex : PolygonVertexNoUVs {
 
 PolygonStyle::PolygonStyle(std::string _name, Blending _blendMode, GLenum _drawMode, bool _selection)
     : Style(_name, _blendMode, _drawMode, _selection)
-{}
+{
+    // Footprints within a pixel hardly cover a fragment
+    m_minFeatureSize = 0.5f;
+}
 
 void PolygonStyle::constructVertexLayout() {
 
-    if (m_texCoordsGeneration) {
+    // Normals are only read for lighting, normal rasters and by custom
+    // shader blocks
+    m_useNormals = true;
+    if (m_lightingType == LightingType::none &&
+        m_rasterType != RasterType::normal &&
+        !m_texCoordsGeneration) {
+
+        const auto& blocks = m_shaderSource->getSourceBlocks();
+        m_useNormals = std::any_of(blocks.begin(), blocks.end(),
+                                   [](const auto& b) { return b.first != "defines"; });
+    }
+
+    if (!m_useNormals) {
+        m_vertexLayout = std::shared_ptr<VertexLayout>(new VertexLayout({
+            {"a_position", 4, GL_SHORT, false, 0},
+            {"a_color", 4, GL_UNSIGNED_BYTE, true, 0},
+            {"a_selection_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        }));
+    } else if (m_texCoordsGeneration) {
         m_vertexLayout = std::shared_ptr<VertexLayout>(new VertexLayout({
             {"a_position", 4, GL_SHORT, false, 0},
             {"a_normal", 4, GL_BYTE, true, 0}, // The 4th byte is for padding
@@ -82,6 +118,9 @@ void PolygonStyle::constructShaderProgram() {
     if (m_texCoordsGeneration) {
         m_shaderSource->addSourceBlock("defines", "#define TANGRAM_USE_TEX_COORDS\n");
     }
+    if (!m_useNormals) {
+        m_shaderSource->addSourceBlock("defines", "#define TANGRAM_NO_NORMALS\n");
+    }
 }
 
 template <class V>
@@ -103,34 +142,59 @@ public:
         m_tileUnitsPerMeter = _tile.getInverseScale();
         m_zoom = _tile.getID().z;
         m_meshData.clear();
+        m_walls.clear();
     }
 
     void setup(const Marker& _marker, int zoom) override {
         m_zoom = zoom;
         m_tileUnitsPerMeter = 1.f / _marker.modelScale();
         m_meshData.clear();
+        m_walls.clear();
     }
 
     bool addPolygon(const Polygon& _polygon, const Properties& _props, const DrawRule& _rule) override;
 
+    void setTriangulationCache(TriangulationCache* _cache) override {
+        m_builder.triangulation = _cache;
+    }
+
     const Style& style() const override { return m_style; }
 
     std::unique_ptr<StyledMesh> build() override;
 
-    PolygonStyleBuilder(const PolygonStyle& _style) : m_style(_style) {}
+    PolygonStyleBuilder(const PolygonStyle& _style) : m_style(_style) {
+        // Covered walls may only be skipped when the ones covering them are opaque
+        if (m_style.blendMode() == Blending::opaque) {
+            m_builder.occlusion = &m_walls;
+        }
+    }
 
     Parameters parseRule(const DrawRule& _rule, const Properties& _props);
 
-    PolygonBuilder& polygonBuilder() { return m_builder; }
+    // Writes the vertices of the current polygon to m_meshData
+    struct VertexWriter {
+        std::vector<V>* vertices;
+        Parameters params;
+
+        void operator()(const glm::vec3& coord, const glm::vec3& normal, const glm::vec2& uv) {
+            vertices->push_back({ coord, params.order, normal, uv, params.color, params.selectionColor });
+        }
+    };
+
+    PolygonBuilderT<VertexWriter>& polygonBuilder() { return m_builder; }
 
 private:
 
     const PolygonStyle& m_style;
 
-    PolygonBuilder m_builder;
+    PolygonBuilderT<VertexWriter> m_builder;
 
     MeshData<V> m_meshData;
 
+    MeshOptimizer m_optimizer;
+
+    WallOcclusion m_walls;
+
     float m_tileUnitsPerMeter = 0;
     int m_zoom = 0;
 
@@ -140,6 +204,11 @@ template <class V>
 std::unique_ptr<StyledMesh> PolygonStyleBuilder<V>::build() {
     if (m_meshData.vertices.empty()) { return nullptr; }
 
+    if (m_style.optimizeMeshes()) {
+        auto stats = m_optimizer.optimize(m_meshData);
+        m_style.addVertexCacheStats(stats.triangles, stats.missesBefore, stats.missesAfter);
+    }
+
     auto mesh = std::make_unique<Mesh<V>>(m_style.vertexLayout(),
                                                       m_style.drawMode());
     mesh->compile(m_meshData);
@@ -175,11 +244,12 @@ bool PolygonStyleBuilder<V>::addPolygon(const Polygon& _polygon, const Propertie
 
     m_builder.keepTileEdges = p.keepTileEdges;
 
-    m_builder.addVertex = [this, p](const glm::vec3& coord,
-                                 const glm::vec3& normal,
-                                 const glm::vec2& uv) {
-        m_meshData.vertices.push_back({ coord, p.order, normal, uv, p.color, p.selectionColor });
-    };
+    m_builder.addVertex = { &m_meshData.vertices, p };
+
+    size_t nVertices, nIndices;
+    Builders::polygonSize(_polygon, p.minHeight != p.height, nVertices, nIndices);
+    m_meshData.reserve(nVertices, nIndices);
+    m_builder.indices.reserve(nIndices);
 
     if (p.minHeight != p.height) {
         Builders::buildPolygonExtrusion(_polygon, p.minHeight,
@@ -194,13 +264,29 @@ bool PolygonStyleBuilder<V>::addPolygon(const Polygon& _polygon, const Propertie
 
     m_meshData.offsets.emplace_back(m_builder.indices.size(),
                                     m_builder.numVertices);
+
+    // The outer ring contains the polygon and its extrusion
+    MeshBounds bounds;
+    if (!_polygon.empty()) {
+        float minZ = (p.minHeight != p.height) ? std::min(p.minHeight, p.height) : p.height;
+        for (auto& point : _polygon[0]) {
+            bounds.extend({ point.x, point.y, minZ });
+            bounds.extend({ point.x, point.y, p.height });
+        }
+    }
+    m_meshData.bounds.push_back(bounds);
+
     m_builder.clear();
 
     return true;
 }
 
 std::unique_ptr<StyleBuilder> PolygonStyle::createBuilder() const {
-    if (m_texCoordsGeneration) {
+    if (!m_useNormals) {
+        auto builder = std::make_unique<PolygonStyleBuilder<PolygonVertexFlat>>(*this);
+        builder->polygonBuilder().useTexCoords = false;
+        return std::move(builder);
+    } else if (m_texCoordsGeneration) {
         auto builder = std::make_unique<PolygonStyleBuilder<PolygonVertex>>(*this);
         builder->polygonBuilder().useTexCoords = true;
         return std::move(builder);
@@ -18,6 +18,13 @@ public:
     virtual std::unique_ptr<StyleBuilder> createBuilder() const override;
     virtual ~PolygonStyle() {}
 
+    /* Whether the vertex layout includes normals, set by constructVertexLayout */
+    bool useNormals() const { return m_useNormals; }
+
+protected:
+
+    bool m_useNormals = true;
+
 };
 
 }
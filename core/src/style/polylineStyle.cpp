@@ -9,6 +9,7 @@
 #include "marker/marker.h"
 #include "material.h"
 #include "platform.h"
+#include "scene/scene.h"
 #include "scene/stops.h"
 #include "scene/drawRule.h"
 #include "tile/tile.h"
@@ -17,10 +18,13 @@
 #include "util/extrude.h"
 #include "util/floatFormatter.h"
 #include "util/mapProjection.h"
+#include "view/view.h"
 
 #include "glm/vec3.hpp"
 #include "glm/gtc/type_precision.hpp"
 
+#include <cmath>
+
 #include "polyline_vs.h"
 #include "polyline_fs.h"
 
@@ -29,9 +33,13 @@ constexpr float position_scale = 8192.0f;
 constexpr float texture_scale = 8192.0f;
 constexpr float order_scale = 2.0f;
 constexpr float dash_scale = 20.f;
+// Scale of the log2 of tile units per pixel of dynamic width vertices
+constexpr float width_unit_scale = 1024.f;
 
 namespace Tangram {
 
+constexpr size_t PolylineStyle::maxWidthClasses;
+
 struct PolylineVertexNoUVs {
     PolylineVertexNoUVs(glm::vec2 position, glm::vec2 extrude, glm::vec2 uv,
                         glm::i16vec2 width, glm::i16vec2 height, GLuint abgr, GLuint selection)
@@ -67,7 +75,10 @@ struct PolylineVertex : PolylineVertexNoUVs {
 
 PolylineStyle::PolylineStyle(std::string _name, Blending _blendMode, GLenum _drawMode, bool _selection)
     : Style(_name, _blendMode, _drawMode, _selection)
-{}
+{
+    // Pieces of lines within a pixel are hardly visible
+    m_minFeatureSize = 0.5f;
+}
 
 void PolylineStyle::constructVertexLayout() {
 
@@ -94,7 +105,17 @@ void PolylineStyle::constructVertexLayout() {
 void PolylineStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _scene) {
     Style::onBeginDrawFrame(rs, _view, _scene);
 
-    if (m_texture) {
+    if (m_dashAtlas) {
+        GLuint textureUnit = rs.nextAvailableTextureUnit();
+
+        m_dashAtlas->update(rs, textureUnit);
+        m_dashAtlas->bind(rs, textureUnit);
+
+        m_shaderProgram->setUniformi(rs, m_uTexture, textureUnit);
+        m_shaderProgram->setUniformf(rs, m_uTextureRatio, float(m_dash.length));
+        m_shaderProgram->setUniformf(rs, m_uDashAtlas, m_dashAtlas->uvScale(m_dash));
+
+    } else if (m_texture) {
         GLuint textureUnit = rs.nextAvailableTextureUnit();
 
         m_texture->update(rs, textureUnit);
@@ -103,6 +124,73 @@ void PolylineStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene&
         m_shaderProgram->setUniformi(rs, m_uTexture, textureUnit);
         m_shaderProgram->setUniformf(rs, m_uTextureRatio, m_texture->getHeight() / m_texture->getWidth());
     }
+
+    if (m_dynamicWidth) {
+        float zoom = _view.getZoom();
+        float tileSize = _scene.mapProjection()->TileSize();
+
+        m_widthTable.assign(maxWidthClasses, 0.f);
+        {
+            std::lock_guard<std::mutex> lock(m_widthMutex);
+            for (size_t i = 0; i < m_widthClasses.size(); i++) {
+                auto& widthClass = m_widthClasses[i];
+                float width = widthClass.fill.eval(zoom, tileSize);
+                if (widthClass.hasOutline) { width += 2.f * widthClass.outline.eval(zoom, tileSize); }
+                // NB: 0.5 because 'width' will be extruded in both directions
+                m_widthTable[i] = .5f * width;
+            }
+        }
+        m_shaderProgram->setUniformf(rs, m_uLineWidths, m_widthTable);
+    }
+}
+
+float PolylineStyle::WidthFunction::eval(float _zoom, float _tileSize) const {
+    if (stops) { return stops->evalExpFloat(_zoom); }
+    if (!meters) { return value; }
+
+    // Pixels per meter at _zoom
+    return value * _tileSize / (2.f * MapProjection::HALF_CIRCUMFERENCE) * exp2(_zoom);
+}
+
+uint16_t PolylineStyle::widthClass(const StyleParam& _fill, const StyleParam* _outline) const {
+
+    auto function = [](const StyleParam& _param) {
+        WidthFunction result;
+        if (_param.stops) {
+            result.stops = _param.stops;
+        } else if (_param.value.is<StyleParam::Width>()) {
+            auto& width = _param.value.get<StyleParam::Width>();
+            result.value = width.value;
+            result.meters = width.isMeter();
+        }
+        return result;
+    };
+
+    WidthClass widthClass;
+    widthClass.fill = function(_fill);
+    if (_outline) {
+        widthClass.outline = function(*_outline);
+        widthClass.hasOutline = true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_widthMutex);
+
+    for (size_t i = 0; i < m_widthClasses.size(); i++) {
+        auto& other = m_widthClasses[i];
+        if (other.fill == widthClass.fill && other.hasOutline == widthClass.hasOutline &&
+            (!other.hasOutline || other.outline == widthClass.outline)) {
+            return i;
+        }
+    }
+
+    if (m_widthClasses.size() == maxWidthClasses) {
+        LOGW("Style %s has more than %d line widths, use fewer width rules or disable `dynamic_width`",
+             m_name.c_str(), int(maxWidthClasses));
+        return maxWidthClasses - 1;
+    }
+
+    m_widthClasses.push_back(widthClass);
+    return m_widthClasses.size() - 1;
 }
 
 void PolylineStyle::setDashBackgroundColor(const glm::vec4 _dashBackgroundColor) {
@@ -116,12 +204,17 @@ void PolylineStyle::constructShaderProgram() {
                                      SHADER_SOURCE(polyline_vs));
 
     if (m_dashArray.size() > 0) {
-        TextureOptions options {GL_RGBA, GL_RGBA, {GL_NEAREST, GL_NEAREST}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}};
-        // provides precision for dash patterns that are a fraction of line width
-        auto pixels = DashArray::render(m_dashArray, dash_scale);
+        if (m_dashAtlas) {
+            // provides precision for dash patterns that are a fraction of line width
+            m_dash = m_dashAtlas->add(m_dashArray, dash_scale);
+            m_shaderSource->addSourceBlock("defines", "#define TANGRAM_LINE_DASH_ATLAS\n", false);
+        } else {
+            TextureOptions options {GL_RGBA, GL_RGBA, {GL_NEAREST, GL_NEAREST}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}};
+            auto pixels = DashArray::render(m_dashArray, dash_scale);
 
-        m_texture = std::make_shared<Texture>(1, pixels.size(), options);
-        m_texture->setData(pixels.data(), pixels.size());
+            m_texture = std::make_shared<Texture>(1, pixels.size(), options);
+            m_texture->setData(pixels.data(), pixels.size());
+        }
 
         if (m_dashBackground) {
             m_shaderSource->addSourceBlock("defines", "#define TANGRAM_LINE_BACKGROUND_COLOR vec3(" +
@@ -145,6 +238,11 @@ void PolylineStyle::constructShaderProgram() {
     if (m_texCoordsGeneration) {
         m_shaderSource->addSourceBlock("defines", "#define TANGRAM_USE_TEX_COORDS\n");
     }
+
+    if (m_dynamicWidth) {
+        m_shaderSource->addSourceBlock("defines", "#define TANGRAM_LINE_WIDTH_TABLE " +
+                                       std::to_string(maxWidthClasses) + "\n", false);
+    }
 }
 
 template <class V>
@@ -158,6 +256,8 @@ public:
             // Values prepared for the currently build mesh
             glm::i16vec2 height;
             glm::i16vec2 width;
+            // Largest extrusion within the zoom level of the tile, in tile units
+            float extent = 0.f;
             uint32_t color;
             float miterLimit = 3.0;
             CapTypes cap = CapTypes::butt;
@@ -166,6 +266,7 @@ public:
             void set(float _width, float _dWdZ, float _height, float _order) {
                 height = { glm::round(_height * position_scale), _order * order_scale};
                 width = { glm::round(_width * extrusion_scale), glm::round(_dWdZ * extrusion_scale) };
+                extent = std::max(std::abs(_width), std::abs(_width + _dWdZ));
             }
         } fill, stroke;
 
@@ -194,21 +295,46 @@ public:
     void buildLine(const Line& _line, const typename Parameters::Attributes& _att,
                    MeshData<V>& _mesh, GLuint _selection);
 
+    MeshBounds lineBounds(const Line& _line, const typename Parameters::Attributes& _att) const;
+
     Parameters parseRule(const DrawRule& _rule, const Properties& _props);
 
     bool evalWidth(const StyleParam& _styleParam, float& width, float& slope);
 
-    PolyLineBuilder& polylineBuilder() { return m_builder; }
+    // Replace the widths of _params by their classes, see PolylineStyle::setDynamicWidth
+    void setWidthClasses(const DrawRule& _rule, Parameters& _params) const;
+
+    // Writes the vertices of the current line to a mesh
+    struct VertexWriter {
+        std::vector<V>* vertices;
+        const typename Parameters::Attributes* att;
+        GLuint selection;
+        float zoom;
+
+        void operator()(const glm::vec2& coord, const glm::vec2& normal, const glm::vec2& uv) {
+            vertices->push_back({{ coord.x,coord.y }, normal, { uv.x, uv.y * zoom },
+                                 att->width, att->height, att->color, selection});
+        }
+    };
+
+    PolyLineBuilderT<VertexWriter>& polylineBuilder() { return m_builder; }
+
+    void setPolyLineCache(PolyLineCache* _cache) override { m_polyLines = _cache; }
 
 private:
 
     const PolylineStyle& m_style;
-    PolyLineBuilder m_builder;
+    PolyLineBuilderT<VertexWriter> m_builder;
+
+    // Tesselations shared with the builder of an outline_style
+    PolyLineCache* m_polyLines = nullptr;
 
     std::vector<MeshData<V>> m_meshData;
 
     float m_tileUnitsPerMeter = 0;
     float m_tileUnitsPerPixel = 0;
+    // Scaled log2 of m_tileUnitsPerPixel, applied to widths of the width table
+    short m_widthUnits = 0;
     int m_zoom = 0;
     float m_overzoom2 = 1;
 };
@@ -223,6 +349,7 @@ void PolylineStyleBuilder<V>::setup(const Tile& tile) {
     m_overzoom2 = exp2(id.s - id.z);
     m_tileUnitsPerMeter = tile.getInverseScale();
     m_tileUnitsPerPixel = 1.f / tile.getProjection()->TileSize();
+    m_widthUnits = glm::round(std::log2(m_tileUnitsPerPixel) * width_unit_scale);
 
     // When a tile is overzoomed, we are actually styling the area of its
     // 'source' tile, which will have a larger effective pixel size at the
@@ -242,6 +369,7 @@ void PolylineStyleBuilder<V>::setup(const Marker& marker, int zoom) {
     // "tile size" for building a Marker is the size of a tile in pixels multiplied
     // by the ratio of the Marker's extent to the length of a tile side at this zoom.
     m_tileUnitsPerPixel = metersPerTile / (marker.extent() * 256.f);
+    m_widthUnits = glm::round(std::log2(m_tileUnitsPerPixel) * width_unit_scale);
 
 }
 
@@ -394,6 +522,18 @@ bool PolylineStyleBuilder<V>::evalWidth(const StyleParam& _styleParam, float& wi
     return false;
 }
 
+template <class V>
+void PolylineStyleBuilder<V>::setWidthClasses(const DrawRule& _rule, Parameters& _params) const {
+
+    auto& width = _rule.findParameter(StyleParamKey::width);
+    _params.fill.width = { m_style.widthClass(width, nullptr), m_widthUnits };
+
+    if (_params.outlineOn) {
+        auto& outlineWidth = _rule.findParameter(StyleParamKey::outline_width);
+        _params.stroke.width = { m_style.widthClass(width, &outlineWidth), m_widthUnits };
+    }
+}
+
 template <class V>
 bool PolylineStyleBuilder<V>::addFeature(const Feature& _feat, const DrawRule& _rule) {
 
@@ -404,6 +544,8 @@ bool PolylineStyleBuilder<V>::addFeature(const Feature& _feat, const DrawRule& _
 
     if (params.fill.width[0] <= 0.0f && params.fill.width[1] <= 0.0f ) { return false; }
 
+    if (m_style.dynamicWidth()) { setWidthClasses(_rule, params); }
+
     if (_feat.geometryType == GeometryType::lines) {
         // Line geometries are never clipped to tiles, so keep all segments
         params.keepTileEdges = true;
@@ -428,11 +570,27 @@ template <class V>
 void PolylineStyleBuilder<V>::buildLine(const Line& _line, const typename Parameters::Attributes& _att,
                                         MeshData<V>& _mesh, GLuint selection) {
 
-    float zoom = m_overzoom2;
-    m_builder.addVertex = [&](const glm::vec2& coord, const glm::vec2& normal, const glm::vec2& uv) {
-        _mesh.vertices.push_back({{ coord.x,coord.y }, normal, { uv.x, uv.y * zoom },
-                                  _att.width, _att.height, _att.color, selection});
-    };
+    m_builder.addVertex = { &_mesh.vertices, &_att, selection, m_overzoom2 };
+
+    if (m_polyLines && m_polyLines->enabled()) {
+        // Write the vertices of the line tesselated for the other builder
+        auto& cached = m_polyLines->get(_line, m_builder);
+
+        _mesh.reserve(cached.vertices.size(), cached.indices.size());
+        for (auto& vertex : cached.vertices) {
+            m_builder.addVertex(vertex.coord, vertex.enormal, vertex.uv);
+        }
+        _mesh.indices.insert(_mesh.indices.end(), cached.indices.begin(), cached.indices.end());
+
+        _mesh.offsets.emplace_back(cached.indices.size(), cached.vertices.size());
+        _mesh.bounds.push_back(lineBounds(_line, _att));
+        return;
+    }
+
+    size_t nVertices, nIndices;
+    Builders::polyLineSize(_line, m_builder, nVertices, nIndices);
+    _mesh.reserve(nVertices, nIndices);
+    m_builder.indices.reserve(nIndices);
 
     Builders::buildPolyLine(_line, m_builder);
 
@@ -442,10 +600,27 @@ void PolylineStyleBuilder<V>::buildLine(const Line& _line, const typename Parame
 
     _mesh.offsets.emplace_back(m_builder.indices.size(),
                                m_builder.numVertices);
+    _mesh.bounds.push_back(lineBounds(_line, _att));
 
     m_builder.clear();
 }
 
+template <class V>
+MeshBounds PolylineStyleBuilder<V>::lineBounds(const Line& _line,
+                                               const typename Parameters::Attributes& _att) const {
+    MeshBounds bounds;
+
+    float z = _att.height[0] / position_scale;
+    for (auto& point : _line) { bounds.extend({ point.x, point.y, z }); }
+
+    // The vertex shader extrudes by the width interpolated to the next
+    // zoom and scaled for overzoom. Allow proxy tiles one zoom level
+    // below and miter joins.
+    bounds.grow(_att.extent * 2.f * m_overzoom2 * std::max(_att.miterLimit, 1.f));
+
+    return bounds;
+}
+
 template <class V>
 void PolylineStyleBuilder<V>::addMesh(const Line& _line, const Parameters& _params) {
 
@@ -478,6 +653,8 @@ void PolylineStyleBuilder<V>::addMesh(const Line& _line, const Parameters& _para
         size_t nIndices = fill.offsets.back().first;
         size_t nVertices = fill.offsets.back().second;
         stroke.offsets.emplace_back(nIndices, nVertices);
+        stroke.reserve(nVertices, nIndices);
+        stroke.bounds.push_back(lineBounds(_line, _params.stroke));
 
         auto indicesIt = fill.indices.end() - nIndices;
         stroke.indices.insert(stroke.indices.end(),
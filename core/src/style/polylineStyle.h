@@ -1,15 +1,19 @@
 #pragma once
 
+#include "scene/dashAtlas.h"
 #include "style/style.h"
 
-namespace Tangram {
+#include <mutex>
 
-class Texture;
+namespace Tangram {
 
 class PolylineStyle : public Style {
 
 public:
 
+    // Size of the width table of dynamic width styles
+    static constexpr size_t maxWidthClasses = 32;
+
     PolylineStyle(std::string _name, Blending _blendMode = Blending::opaque, GLenum _drawMode = GL_TRIANGLES, bool _selection = true);
 
     virtual void constructVertexLayout() override;
@@ -19,19 +23,63 @@ public:
     virtual ~PolylineStyle() {}
 
     void setDashArray(std::vector<float> _dashArray) { m_dashArray = _dashArray; }
+
+    /* Render the dash array into _atlas, shared with the other dashed
+     * styles of the scene, instead of a texture of this style */
+    void setDashAtlas(std::shared_ptr<DashAtlas> _atlas) { m_dashAtlas = _atlas; }
     void setTexture(std::shared_ptr<Texture>& _texture) { m_texture = _texture; }
 
     void setDashBackgroundColor(const glm::vec4 _dashBackgroundColor);
 
+    /* Apply line widths in the vertex shader instead of baking them into the
+     * vertices. Vertices carry the class of their width rule, e.g. a width
+     * with stops or a width with an outline, and the widths of all classes
+     * are evaluated at the current zoom on each frame. Widths then follow
+     * their stops between zoom levels and on proxy tiles without rebuilding
+     * tiles. */
+    void setDynamicWidth(bool _enabled) { m_dynamicWidth = _enabled; }
+    bool dynamicWidth() const { return m_dynamicWidth; }
+
+    /* Index in the width table of the width _fill, widened by twice _outline
+     * when it is not null. Called by the builders on the tile workers. */
+    uint16_t widthClass(const StyleParam& _fill, const StyleParam* _outline) const;
+
 private:
 
+    struct WidthFunction {
+        const Stops* stops = nullptr;
+        float value = 0.f;
+        bool meters = false;
+
+        bool operator==(const WidthFunction& _other) const {
+            return stops == _other.stops && value == _other.value && meters == _other.meters;
+        }
+        // Width in pixels at _zoom
+        float eval(float _zoom, float _tileSize) const;
+    };
+
+    struct WidthClass {
+        WidthFunction fill;
+        WidthFunction outline;
+        bool hasOutline = false;
+    };
+
     std::vector<float> m_dashArray;
     std::shared_ptr<Texture> m_texture;
+    std::shared_ptr<DashAtlas> m_dashAtlas;
+    DashAtlas::Dash m_dash;
     bool m_dashBackground = false;
     glm::vec4 m_dashBackgroundColor;
 
+    bool m_dynamicWidth = false;
+    mutable std::mutex m_widthMutex;
+    mutable std::vector<WidthClass> m_widthClasses;
+    UniformArray1f m_widthTable;
+
     UniformLocation m_uTexture{"u_texture"};
     UniformLocation m_uTextureRatio{"u_texture_ratio"};
+    UniformLocation m_uDashAtlas{"u_dash_atlas"};
+    UniformLocation m_uLineWidths{"u_line_widths"};
 };
 
 }
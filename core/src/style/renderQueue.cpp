@@ -0,0 +1,93 @@
+#include "style/renderQueue.h"
+
+#include "gl/gpuTimer.h"
+#include "gl/renderState.h"
+#include "marker/marker.h"
+#include "style/pointStyle.h"
+#include "style/textStyle.h"
+#include "tile/tile.h"
+#include "view/view.h"
+
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+
+namespace Tangram {
+
+void RenderQueue::sort(std::vector<Entry>& _entries) {
+
+    std::sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b) {
+        // Keep the order of Style::compare up to the name
+        if (a.blend != Blending::opaque && b.blend != Blending::opaque) {
+            if (a.blendOrder != b.blendOrder) {
+                return a.blendOrder < b.blendOrder;
+            }
+        }
+        if (a.blend != b.blend) {
+            return static_cast<uint8_t>(a.blend) < static_cast<uint8_t>(b.blend);
+        }
+        if (a.program != b.program) {
+            return a.program < b.program;
+        }
+        return a.index < b.index;
+    });
+}
+
+void RenderQueue::sortFrontToBack(std::vector<std::shared_ptr<Tile>>& _tiles, glm::dvec2 _eye) {
+
+    auto distance = [&](const std::shared_ptr<Tile>& tile) {
+        glm::dvec2 center = tile->getOrigin() + glm::dvec2(tile->getScale() * 0.5);
+        glm::dvec2 d = center - _eye;
+        return glm::dot(d, d);
+    };
+
+    std::stable_sort(_tiles.begin(), _tiles.end(), [&](const auto& a, const auto& b) {
+        return distance(a) < distance(b);
+    });
+}
+
+void RenderQueue::prepare(const std::vector<std::unique_ptr<Style>>& _styles) {
+    m_entries.clear();
+    m_styles.clear();
+
+    for (const auto& style : _styles) {
+        bool label = dynamic_cast<const TextStyle*>(style.get()) ||
+            dynamic_cast<const PointStyle*>(style.get());
+        m_entries.push_back({ style->blendMode(), style->blendOrder(),
+                              reinterpret_cast<uintptr_t>(style->shaderProgram()),
+                              uint32_t(m_styles.size()), label });
+        m_styles.push_back(style.get());
+    }
+
+    sort(m_entries);
+}
+
+void RenderQueue::draw(RenderState& rs, const View& _view, Scene& _scene,
+                       const std::vector<std::shared_ptr<Tile>>& _tiles,
+                       const std::vector<std::unique_ptr<Marker>>& _markers,
+                       Pass _pass) {
+
+    glm::dvec3 eye = _view.getPosition() + glm::dvec3(_view.getEye());
+    m_frontToBack.assign(_tiles.begin(), _tiles.end());
+    sortFrontToBack(m_frontToBack, { eye.x, eye.y });
+
+    for (auto& entry : m_entries) {
+        if ((_pass == Pass::geometry && entry.label) || (_pass == Pass::labels && !entry.label)) {
+            continue;
+        }
+
+        auto* style = m_styles[entry.index];
+        if (rs.gpuTimer) { rs.gpuTimer->begin(style->getName()); }
+
+        // Proxy tiles overlap their descendants, blended styles keep drawing
+        // them in the order of the TileManager
+        bool opaque = entry.blend == Blending::opaque;
+        style->draw(rs, _view, _scene, opaque ? m_frontToBack : _tiles, _markers);
+
+        if (rs.gpuTimer) { rs.gpuTimer->end(); }
+    }
+
+    m_frontToBack.clear();
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "style/style.h"
+
+#include "glm/vec2.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Tangram {
+
+class Marker;
+class RenderState;
+class Scene;
+class Tile;
+class View;
+
+/* Draw order of the styles of a scene
+ *
+ * Scene styles are sorted by Style::compare: blend mode, blend order and
+ * then name. Styles that only differ by name can be drawn in any order,
+ * so RenderQueue groups those by shader program. Consecutive styles then
+ * share program binds and blend, depth and stencil state, which lets
+ * RenderState filter the redundant calls.
+ *
+ * Opaque styles draw their tiles nearest to the eye first, so that early
+ * depth testing rejects the fragments of farther tiles behind them.
+ * Other blend modes keep the tile order of the TileManager.
+ */
+class RenderQueue {
+
+public:
+
+    struct Entry {
+        Blending blend;
+        int blendOrder;
+        // Shader program key, styles with identical sources share one
+        uintptr_t program;
+        // Index in the scene styles
+        uint32_t index;
+        // Text and point styles, drawn by Pass::labels
+        bool label;
+    };
+
+    enum class Pass : uint8_t {
+        all,
+        // Styles other than labels
+        geometry,
+        labels,
+    };
+
+    /* Order _entries by the constraints of Style::compare, then by
+     * program and by their original index. */
+    static void sort(std::vector<Entry>& _entries);
+
+    /* Order _tiles by the distance of their center to _eye, in meters */
+    static void sortFrontToBack(std::vector<std::shared_ptr<Tile>>& _tiles, glm::dvec2 _eye);
+
+    /* Collect and sort the styles to draw in this frame */
+    void prepare(const std::vector<std::unique_ptr<Style>>& _styles);
+
+    /* Draw the styles of _pass. Drawing labels in a pass after the geometry
+     * draws them over any later styles. */
+    void draw(RenderState& rs, const View& _view, Scene& _scene,
+              const std::vector<std::shared_ptr<Tile>>& _tiles,
+              const std::vector<std::unique_ptr<Marker>>& _markers,
+              Pass _pass = Pass::all);
+
+    const std::vector<Entry>& entries() const { return m_entries; }
+
+private:
+
+    std::vector<Entry> m_entries;
+    std::vector<Style*> m_styles;
+    // Visible tiles of the current frame, nearest first
+    std::vector<std::shared_ptr<Tile>> m_frontToBack;
+};
+
+}
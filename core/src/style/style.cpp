@@ -4,6 +4,8 @@
 #include "gl/renderState.h"
 #include "gl/shaderProgram.h"
 #include "gl/mesh.h"
+#include "gl/hardware.h"
+#include "gl/uniformBuffer.h"
 #include "log.h"
 #include "map.h"
 #include "marker/marker.h"
@@ -11,12 +13,17 @@
 #include "scene/scene.h"
 #include "scene/spriteAtlas.h"
 #include "scene/styleParam.h"
+#include "selection/featureStates.h"
 #include "style/material.h"
 #include "tile/tile.h"
 #include "view/view.h"
 
+#include "featureState_glsl.h"
+#include "frame_glsl.h"
 #include "rasters_glsl.h"
 
+#include <limits>
+
 namespace Tangram {
 
 Style::Style(std::string _name, Blending _blendMode, GLenum _drawMode, bool _selection) :
@@ -43,6 +50,14 @@ void Style::build(const Scene& _scene) {
     constructVertexLayout();
     constructShaderProgram();
 
+    m_shaderSource->addSourceBlock("frame", SHADER_SOURCE(frame_glsl));
+
+    if (m_featureStates) {
+        m_shaderSource->addSourceBlock("defines", "#define TANGRAM_FEATURE_STATES " +
+                                       std::to_string(FeatureStates::maxStates) + "\n", false);
+        m_shaderSource->addSourceBlock("feature_state", SHADER_SOURCE(featureState_glsl));
+    }
+
     if (m_blend == Blending::inlay) {
         m_shaderSource->addSourceBlock("defines", "#define TANGRAM_BLEND_INLAY\n", false);
     } else if (m_blend == Blending::overlay) {
@@ -53,6 +68,11 @@ void Style::build(const Scene& _scene) {
         m_material.uniforms = m_material.material->injectOnProgram(*m_shaderSource);
     }
 
+    // Fragment lighting costs too much on some GPUs, see Hardware::prefersVertexLighting
+    if (m_lightingType == LightingType::fragment && Hardware::prefersVertexLighting) {
+        m_lightingType = LightingType::vertex;
+    }
+
     if (m_lightingType != LightingType::none) {
 
         switch (m_lightingType) {
@@ -71,7 +91,11 @@ void Style::build(const Scene& _scene) {
             if (uniforms) {
                 m_lights.emplace_back(light.get(), std::move(uniforms));
             }
+            if (light->hasRange()) {
+                m_lightRanges.push_back({ light.get(), {}, light->range() });
+            }
         }
+        m_lightsVisible.assign(m_lightRanges.size(), 1.f);
         for (auto& block : _scene.lightBlocks()) {
             m_shaderSource->addSourceBlock(block.first, block.second);
         }
@@ -85,45 +109,21 @@ void Style::build(const Scene& _scene) {
         blocks.find("raster") != blocks.end()) {
         m_hasColorShaderBlock = true;
     }
+    if (blocks.find("position") != blocks.end() ||
+        blocks.find("width") != blocks.end()) {
+        m_cullMeshes = false;
+    }
 
     std::string vertSrc = m_shaderSource->buildVertexSource();
     std::string fragSrc = m_shaderSource->buildFragmentSource();
 
-    for (auto& s : _scene.styles()) {
-        auto& prg = s->m_shaderProgram;
-        if (!prg) { break; }
-        if (prg->vertexShaderSource() == vertSrc &&
-            prg->fragmentShaderSource() == fragSrc) {
-            m_shaderProgram = prg;
-            break;
-        }
-    }
-    if (!m_shaderProgram) {
-        m_shaderProgram = std::make_shared<ShaderProgram>();
-        m_shaderProgram->setDescription("{style:" + m_name + "}");
-        m_shaderProgram->setShaderSource(vertSrc, fragSrc);
-    }
+    // Styles that differ only in name or mix in the same blocks share one program
+    m_shaderProgram = _scene.shaderProgram(vertSrc, fragSrc, "{style:" + m_name + "}");
 
     if (m_selection) {
-        std::string vertSrc = m_shaderSource->buildSelectionVertexSource();
-        std::string fragSrc = m_shaderSource->buildSelectionFragmentSource();
-
-        for (auto& s : _scene.styles()) {
-            if (!s->m_selection) { continue; }
-
-            auto& prg = s->m_selectionProgram;
-            if (!prg) { break; }
-            if (prg->vertexShaderSource() == vertSrc &&
-                prg->fragmentShaderSource() == fragSrc) {
-                m_selectionProgram = prg;
-                break;
-            }
-        }
-        if (!m_selectionProgram) {
-            m_selectionProgram = std::make_shared<ShaderProgram>();
-            m_selectionProgram->setDescription("selection_program {style:" + m_name + "}");
-            m_selectionProgram->setShaderSource(vertSrc, fragSrc);
-        }
+        m_selectionProgram = _scene.shaderProgram(m_shaderSource->buildSelectionVertexSource(),
+                                                  m_shaderSource->buildSelectionFragmentSource(),
+                                                  "selection_program {style:" + m_name + "}");
     }
 
     // Clear ShaderSource builder
@@ -226,35 +226,82 @@ void Style::setupShaderUniforms(RenderState& rs, ShaderProgram& _program, const
     // Reset the currently used texture unit to 0
     rs.resetTextureUnit();
 
-    // Set time uniforms style's shader programs
-    _program.setUniformf(rs, _uniforms.uTime, _scene.time());
-
-    _program.setUniformf(rs, _uniforms.uDevicePixelRatio, m_pixelScale);
-
     if (m_material.uniforms) {
         m_material.material->setupProgram(rs, *m_shaderProgram, *m_material.uniforms);
     }
 
-    // Set up lights
-    for (const auto& light : m_lights) {
-        light.light->setupProgram(rs, _view, *m_shaderProgram, *light.uniforms);
+    // Set up lights, unless they come from the lights uniform buffer
+    if (!_program.hasLightsBlock()) {
+        for (const auto& light : m_lights) {
+            light.light->setupProgram(rs, _view, *m_shaderProgram, *light.uniforms);
+        }
     }
 
-    // Set Map Position
-    _program.setUniformf(rs, _uniforms.uResolution, _view.getWidth(), _view.getHeight());
+    for (auto& range : m_lightRanges) {
+        range.position = glm::dvec2(range.light->worldPosition(_view));
+    }
 
-    const auto& mapPos = _view.getPosition();
-    _program.setUniformf(rs, _uniforms.uMapPosition, mapPos.x, mapPos.y, _view.getZoom());
-    _program.setUniformMatrix3f(rs, _uniforms.uNormalMatrix, _view.getNormalMatrix());
-    _program.setUniformMatrix3f(rs, _uniforms.uInverseNormalMatrix, _view.getInverseNormalMatrix());
-    _program.setUniformf(rs, _uniforms.uMetersPerPixel, 1.0 / _view.pixelsPerMeter());
-    _program.setUniformMatrix4f(rs, _uniforms.uView, _view.getViewMatrix());
-    _program.setUniformMatrix4f(rs, _uniforms.uProj, _view.getProjectionMatrix());
+    // View and time uniforms come from the frame uniform buffer when the
+    // program declares it, see setupFrameUniforms()
+    if (!_program.hasFrameBlock()) {
+        _program.setUniformf(rs, _uniforms.uTime, _scene.time());
+
+        _program.setUniformf(rs, _uniforms.uDevicePixelRatio, m_pixelScale);
+
+        // Set Map Position
+        _program.setUniformf(rs, _uniforms.uResolution, _view.getWidth(), _view.getHeight());
+
+        const auto& mapPos = _view.getPosition();
+        _program.setUniformf(rs, _uniforms.uMapPosition, mapPos.x, mapPos.y, _view.getZoom());
+        _program.setUniformf(rs, _uniforms.uEyeOffset, _view.getEyeOffset());
+        _program.setUniformMatrix3f(rs, _uniforms.uNormalMatrix, _view.getNormalMatrix());
+        _program.setUniformMatrix3f(rs, _uniforms.uInverseNormalMatrix, _view.getInverseNormalMatrix());
+        _program.setUniformf(rs, _uniforms.uMetersPerPixel, 1.0 / _view.pixelsPerMeter());
+        _program.setUniformMatrix4f(rs, _uniforms.uView, _view.getViewMatrix());
+        _program.setUniformMatrix4f(rs, _uniforms.uProj, _view.getProjectionMatrix());
+    }
+
+    if (m_featureStates && _scene.featureStates()) {
+        int count = _scene.featureStates()->uniforms(m_featureStateIds, m_featureStateValues);
+        _program.setUniformf(rs, _uniforms.uFeatureStateIds, m_featureStateIds);
+        _program.setUniformf(rs, _uniforms.uFeatureStates, m_featureStateValues);
+        _program.setUniformi(rs, _uniforms.uFeatureStateCount, count);
+    }
 
     setupSceneShaderUniforms(rs, _scene, _uniforms);
 
 }
 
+void Style::setupFrameUniforms(RenderState& rs, const View& _view, const Scene& _scene) {
+
+    // In the order of the TangramFrame block in frame.glsl
+    auto& frame = rs.frameUniforms;
+    frame.clear();
+    frame.add(_view.getViewMatrix());
+    frame.add(_view.getProjectionMatrix());
+    frame.add(_view.getNormalMatrix());
+    frame.add(_view.getInverseNormalMatrix());
+    const auto& mapPos = _view.getPosition();
+    frame.add(glm::vec3(mapPos.x, mapPos.y, _view.getZoom()));
+    frame.add(_scene.time());
+    frame.add(glm::vec2(_view.getWidth(), _view.getHeight()));
+    frame.add(_view.getEyeOffset());
+    frame.add(float(1.0 / _view.pixelsPerMeter()));
+    frame.add(_scene.pixelScale());
+    frame.upload();
+
+    // In the order of the TangramLights block, see Light::assembleLights()
+    auto& lights = rs.lightUniforms;
+    lights.clear();
+    for (auto& light : _scene.lights()) {
+        if (!light->isDynamic()) { continue; }
+        lights.alignStruct();
+        light->setupUniformBuffer(_view, lights);
+        lights.alignStruct();
+    }
+    lights.upload();
+}
+
 void Style::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _scene) {
 
     setupShaderUniforms(rs, *m_shaderProgram, _view, _scene, m_mainUniforms);
@@ -303,6 +350,24 @@ void Style::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _scene)
     }
 }
 
+void Style::setupLightCulling(RenderState& rs, const glm::dvec2& _min, const glm::dvec2& _max) {
+
+    if (m_lightRanges.empty()) { return; }
+
+    // Horizontal distance to the bounds, heights only add to the distance
+    for (size_t i = 0; i < m_lightRanges.size(); i++) {
+        auto& range = m_lightRanges[i];
+        glm::dvec2 d = glm::max(glm::max(_min - range.position, range.position - _max), glm::dvec2(0.0));
+        m_lightsVisible[i] = glm::dot(d, d) <= range.range * range.range ? 1.f : 0.f;
+    }
+
+    m_shaderProgram->setUniformf(rs, m_mainUniforms.uLightsVisible, m_lightsVisible);
+}
+
+bool Style::programsReady(RenderState& rs) {
+    return m_shaderProgram->isReady(rs);
+}
+
 void Style::drawSelectionFrame(RenderState& rs, const View& _view, Scene& _scene,
                                const std::vector<std::shared_ptr<Tile>>& _tiles,
                                const std::vector<std::unique_ptr<Marker>>& _markers) {
@@ -374,6 +439,9 @@ void Style::drawSelectionFrame(Tangram::RenderState& rs, const Tangram::Tile &_t
 
     if (!styleMesh) { return; }
 
+    // Drawn once the rasters of the tile or of its parents are loaded
+    if (hasRasters() && _tile.rastersPending() && _tile.parentRasters() == 0) { return; }
+
     TileID tileID = _tile.getID();
 
     m_selectionProgram->setUniformMatrix4f(rs, m_selectionUniforms.uModel, _tile.getModelMatrix());
@@ -406,16 +474,42 @@ void Style::draw(RenderState& rs, const View& _view, Scene& _scene,
         return;
     }
 
+    // Draw in a later frame instead of waiting for the programs to build
+    if (!programsReady(rs)) {
+        rs.countPendingProgram();
+        return;
+    }
+
     onBeginDrawFrame(rs, _view, _scene);
 
-    if (m_blend == Blending::translucent) {
+    m_viewProjection = _view.getViewProjectionMatrix();
+
+    // The overdraw debug view counts fragments in the stencil buffer, see Map::render
+    bool countOverdraw = getDebugFlag(DebugFlags::overdraw);
+    bool translucent = m_blend == Blending::translucent && !countOverdraw;
+    bool depthPrepass = m_blend == Blending::opaque && m_depthPrepass;
+
+    if (translucent || depthPrepass) {
         rs.colorMask(false, false, false, false);
     }
 
     for (const auto& tile : _tiles) { draw(rs, *tile); }
     for (const auto& marker : _markers) { draw(rs, *marker); }
 
-    if (m_blend == Blending::translucent) {
+    if (depthPrepass) {
+        // Shade only the fragments that made it into the depth buffer
+        rs.colorMask(true, true, true, true);
+        rs.depthMask(GL_FALSE);
+        GL::depthFunc(GL_LEQUAL);
+
+        for (const auto& tile : _tiles) { draw(rs, *tile); }
+        for (const auto& marker : _markers) { draw(rs, *marker); }
+
+        GL::depthFunc(GL_LESS);
+        rs.depthMask(GL_TRUE);
+    }
+
+    if (translucent) {
         rs.colorMask(true, true, true, true);
         GL::depthFunc(GL_EQUAL);
 
@@ -447,6 +541,7 @@ void Style::draw(RenderState& rs, const Tile& _tile) {
         UniformTextureArray textureIndexUniform;
         UniformArray2f rasterSizeUniform;
         UniformArray3f rasterOffsetsUniform;
+        UniformArray3f rasterAtlasUniform;
 
         for (auto& raster : _tile.rasters()) {
             if (raster.isValid()) {
@@ -456,7 +551,8 @@ void Style::draw(RenderState& rs, const Tile& _tile) {
                 texture->bind(rs, texUnit);
 
                 textureIndexUniform.slots.push_back(texUnit);
-                rasterSizeUniform.push_back({texture->getWidth(), texture->getHeight()});
+                rasterSizeUniform.push_back(raster.size());
+                rasterAtlasUniform.push_back(raster.uvTransform());
 
                 if (tileID.z > raster.tileID.z) {
                     float dz = tileID.z - raster.tileID.z;
@@ -476,6 +572,7 @@ void Style::draw(RenderState& rs, const Tile& _tile) {
         m_shaderProgram->setUniformi(rs, m_mainUniforms.uRasters, textureIndexUniform);
         m_shaderProgram->setUniformf(rs, m_mainUniforms.uRasterSizes, rasterSizeUniform);
         m_shaderProgram->setUniformf(rs, m_mainUniforms.uRasterOffsets, rasterOffsetsUniform);
+        m_shaderProgram->setUniformf(rs, m_mainUniforms.uRasterAtlas, rasterAtlasUniform);
     }
 
     m_shaderProgram->setUniformMatrix4f(rs, m_mainUniforms.uModel, _tile.getModelMatrix());
@@ -486,7 +583,13 @@ void Style::draw(RenderState& rs, const Tile& _tile) {
                                  tileID.s,
                                  tileID.z);
 
-    if (!styleMesh->draw(rs, *m_shaderProgram)) {
+    setupLightCulling(rs, _tile.getOrigin(), _tile.getOrigin() + glm::dvec2(_tile.getScale()));
+
+    bool drawn = m_cullMeshes
+        ? styleMesh->drawVisible(rs, *m_shaderProgram, m_viewProjection * _tile.getModelMatrix())
+        : styleMesh->draw(rs, *m_shaderProgram);
+
+    if (!drawn) {
         LOGN("Mesh built by style %s cannot be drawn", m_name.c_str());
     }
 
@@ -512,6 +615,10 @@ void Style::draw(RenderState& rs, const Marker& marker) {
                                  marker.origin().x, marker.origin().y,
                                  marker.builtZoomLevel(), marker.builtZoomLevel());
 
+    // Marker meshes are not bounded, all lights reach them
+    setupLightCulling(rs, glm::dvec2(std::numeric_limits<double>::lowest()),
+                      glm::dvec2(std::numeric_limits<double>::max()));
+
     if (!mesh->draw(rs, *m_shaderProgram)) {
         LOGN("Mesh built by style %s cannot be drawn", m_name.c_str());
     }
@@ -526,11 +633,10 @@ void Style::applyDefaultDrawRules(DrawRule& _rule) const {
         for (auto& param : m_defaultDrawRule->parameters) {
             auto key = static_cast<uint8_t>(param.key);
             if (!_rule.active[key]) {
-                _rule.active[key] = true;
                 // NOTE: layername and layer depth are actually immaterial here, since these are
                 // only used during layer draw rules merging. Adding a default string for
                 // debugging purposes.
-                _rule.params[key] = { &param, "default_style_draw_rule", 0 };
+                _rule.set(param, "default_style_draw_rule", 0);
             }
         }
     }
@@ -6,6 +6,7 @@
 #include "scene/drawRule.h"
 #include "util/fastmap.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -18,6 +19,7 @@ class Light;
 class MapProjection;
 class Marker;
 class Material;
+class PolyLineCache;
 class RenderState;
 class Scene;
 class ShaderProgram;
@@ -25,6 +27,7 @@ class ShaderSource;
 class Style;
 class Tile;
 class TileSource;
+class TriangulationCache;
 class VertexLayout;
 class View;
 struct DrawRule;
@@ -57,6 +60,32 @@ struct StyledMesh {
     virtual bool draw(RenderState& rs, ShaderProgram& _shader, bool _useVao = true) = 0;
     virtual size_t bufferSize() const = 0;
 
+    /* Number of compiled vertices, zero for meshes that don't count them */
+    virtual size_t vertexCount() const { return 0; }
+
+    /* Draw only the parts of the mesh that may be inside of the view
+     * frustum, _tileToClip maps mesh coordinates to clip space */
+    virtual bool drawVisible(RenderState& rs, ShaderProgram& _shader, const glm::mat4& _tileToClip) {
+        return draw(rs, _shader);
+    }
+
+    /* Returns false while the mesh holds data that is not uploaded yet */
+    virtual bool isUploaded() const { return true; }
+
+    /* Upload pending data to GPU buffers, returns the number of uploaded bytes */
+    virtual size_t uploadBuffers(RenderState& rs) { return 0; }
+
+    /* Read the uploaded data back into CPU memory and release the GPU buffers,
+     * see TileCache::applyResidency. Returns the number of bytes read back. */
+    virtual size_t releaseBuffers(RenderState& rs) { return 0; }
+
+    /* Returns true while releaseBuffers() moved the data into CPU memory */
+    virtual bool isReleased() const { return false; }
+
+    /* Append the compiled geometry to _out, see BuiltTileCache. Returns false
+     * for meshes that can't be stored or were uploaded already. */
+    virtual bool serialize(std::vector<char>& _out) const { return false; }
+
     virtual ~StyledMesh() {}
 };
 
@@ -89,6 +118,15 @@ public:
 
     virtual void addSelectionItems(LabelCollider& _layout) {}
 
+    /* Whether the mesh of this builder is a LabelSet, placed by addLayoutItems */
+    virtual bool buildsLabels() const { return false; }
+
+    /* Share polygon triangulations of the current feature with other builders */
+    virtual void setTriangulationCache(TriangulationCache* _cache) {}
+
+    /* Share polyline tesselations of the current feature with other builders */
+    virtual void setPolyLineCache(PolyLineCache* _cache) {}
+
     virtual const Style& style() const = 0;
 };
 
@@ -134,6 +172,10 @@ protected:
     Blending m_blend = Blending::opaque;
     int m_blendOrder = -1;
 
+    /* Draw opaque meshes into the depth buffer first, so that the color pass
+     * shades only the visible fragments of extrusions */
+    bool m_depthPrepass = false;
+
     /* Draw mode to pass into <Mesh>es created with this style */
     GLenum m_drawMode;
 
@@ -145,6 +187,27 @@ protected:
 
     bool m_hasColorShaderBlock = false;
 
+    /* Whether features are drawn with their states, see Map::setFeatureState */
+    bool m_featureStates = false;
+
+    /* Whether tile meshes can be culled by their bounds, i.e. no shader
+     * block moves vertices */
+    bool m_cullMeshes = true;
+
+    /* Whether built meshes are reordered for the vertex cache, see MeshOptimizer */
+    bool m_optimizeMeshes = false;
+
+    /* Lines and polygons with bounds smaller than this many pixels at the
+     * styling zoom of their tile are not built, see TileBuilder::applyStyling */
+    float m_minFeatureSize = 0;
+
+    mutable std::atomic<uint64_t> m_optimizedTriangles{0};
+    mutable std::atomic<uint64_t> m_cacheMissesBefore{0};
+    mutable std::atomic<uint64_t> m_cacheMissesAfter{0};
+
+    /* View projection of the current frame, for mesh culling */
+    glm::mat4 m_viewProjection;
+
     RasterType m_rasterType = RasterType::none;
 
     bool m_selection;
@@ -157,6 +220,7 @@ private:
         UniformLocation uDevicePixelRatio{"u_device_pixel_ratio"};
         UniformLocation uResolution{"u_resolution"};
         UniformLocation uMapPosition{"u_map_position"};
+        UniformLocation uEyeOffset{"u_eye_offset"};
         UniformLocation uNormalMatrix{"u_normal_matrix"};
         UniformLocation uInverseNormalMatrix{"u_inverse_normal_matrix"};
         UniformLocation uMetersPerPixel{"u_meters_per_pixel"};
@@ -169,6 +233,11 @@ private:
         UniformLocation uRasters{"u_rasters"};
         UniformLocation uRasterSizes{"u_raster_sizes"};
         UniformLocation uRasterOffsets{"u_raster_offsets"};
+        UniformLocation uRasterAtlas{"u_raster_atlas"};
+        UniformLocation uLightsVisible{"u_lights_visible"};
+        UniformLocation uFeatureStateIds{"u_feature_state_ids"};
+        UniformLocation uFeatureStates{"u_feature_states"};
+        UniformLocation uFeatureStateCount{"u_feature_state_count"};
 
         std::vector<StyleUniform> styleUniforms;
     } m_mainUniforms, m_selectionUniforms;
@@ -196,6 +265,23 @@ private:
     std::vector<LightHandle> m_lights;
     MaterialHandle m_material;
 
+    // Scene lights with a range in the order of u_lights_visible, with their
+    // position and range in projected meters for the current frame
+    struct LightRange {
+        const Light* light;
+        glm::dvec2 position;
+        double range;
+    };
+    std::vector<LightRange> m_lightRanges;
+    UniformArray1f m_lightsVisible;
+
+    // Tables of the feature states, refilled for each program
+    UniformArray4f m_featureStateIds;
+    UniformArray4f m_featureStateValues;
+
+    /* Set u_lights_visible for geometry within _min and _max in projected meters */
+    void setupLightCulling(RenderState& rs, const glm::dvec2& _min, const glm::dvec2& _max);
+
 public:
 
     Style(std::string _name, Blending _blendMode, GLenum _drawMode, bool _selection);
@@ -222,12 +308,22 @@ public:
 
     static const std::vector<std::string>& builtInStyleNames();
 
+    /* Store the view, time and dynamic light values of the frame in the
+     * uniform buffers of @rs, used by all style programs that declare the
+     * blocks. Requires Hardware::supportsUniformBuffers. */
+    static void setupFrameUniforms(RenderState& rs, const View& _view, const Scene& _scene);
+
     Blending blendMode() const { return m_blend; };
     int blendOrder() const { return m_blendOrder; };
 
+    const ShaderProgram* shaderProgram() const { return m_shaderProgram.get(); }
+
     void setBlendMode(Blending _blendMode) { m_blend = _blendMode; }
     void setBlendOrder(int _blendOrder) { m_blendOrder = _blendOrder; }
 
+    bool depthPrepass() const { return m_depthPrepass; }
+    void setDepthPrepass(bool _depthPrepass) { m_depthPrepass = _depthPrepass; }
+
     /* Whether or not the style is animated */
     bool isAnimated() { return m_animated; }
 
@@ -236,6 +332,11 @@ public:
 
     virtual void onBeginUpdate() {}
 
+    /* Called once labels of this update are placed, the dynamic meshes
+     * filled since onBeginUpdate become the ones that are drawn
+     */
+    virtual void onEndUpdate() {}
+
     virtual void onBeginFrame(RenderState& rs) {}
 
     /* Create <VertexLayout> corresponding to this style; subclasses must
@@ -258,6 +359,9 @@ public:
     /* Perform any unsetup needed after drawing each frame */
     virtual void onEndDrawFrame(RenderState& rs, const View& _view, Scene& _scene) {}
 
+    /* Whether the programs drawing this <Style> are built, see ShaderProgram::isReady() */
+    virtual bool programsReady(RenderState& rs);
+
     /* Draws the geometry associated with this <Style> */
     virtual void draw(RenderState& rs, const Tile& _tile);
 
@@ -287,6 +391,40 @@ public:
 
     bool genTexCoords() const { return m_texCoordsGeneration; }
 
+    void setOptimizeMeshes(bool _optimize) { m_optimizeMeshes = _optimize; }
+
+    bool optimizeMeshes() const { return m_optimizeMeshes; }
+
+    void setMinFeatureSize(float _pixels) { m_minFeatureSize = _pixels; }
+
+    float minFeatureSize() const { return m_minFeatureSize; }
+
+    struct VertexCacheStats {
+        uint64_t triangles = 0;
+        uint64_t missesBefore = 0;
+        uint64_t missesAfter = 0;
+
+        // Average cache misses per triangle, as built and as optimized
+        float acmrBefore() const { return triangles ? float(missesBefore) / triangles : 0.f; }
+        float acmrAfter() const { return triangles ? float(missesAfter) / triangles : 0.f; }
+    };
+
+    /* Modelled vertex cache misses of all meshes built with optimizeMeshes() */
+    VertexCacheStats vertexCacheStats() const {
+        return { m_optimizedTriangles, m_cacheMissesBefore, m_cacheMissesAfter };
+    }
+
+    /* Called by StyleBuilders, possibly on several workers at once */
+    void addVertexCacheStats(uint64_t _triangles, uint64_t _missesBefore, uint64_t _missesAfter) const {
+        m_optimizedTriangles += _triangles;
+        m_cacheMissesBefore += _missesBefore;
+        m_cacheMissesAfter += _missesAfter;
+    }
+
+    void setFeatureStates(bool _featureStates) { m_featureStates = _featureStates; }
+
+    bool hasFeatureStates() const { return m_featureStates; }
+
     void setID(uint32_t _id) { m_id = _id; }
 
     Material& getMaterial() { return *m_material.material; }
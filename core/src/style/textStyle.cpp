@@ -1,12 +1,15 @@
 #include "style/textStyle.h"
 #include "style/textStyleBuilder.h"
 
+#include "gl/dynamicInstanceMesh.h"
 #include "gl/dynamicQuadMesh.h"
+#include "gl/hardware.h"
 #include "gl/mesh.h"
 #include "gl/renderState.h"
 #include "gl/shaderProgram.h"
 #include "labels/textLabels.h"
 #include "log.h"
+#include "scene/scene.h"
 #include "text/fontContext.h"
 #include "view/view.h"
 
@@ -33,6 +36,18 @@ void TextStyle::constructVertexLayout() {
         {"a_alpha", 1, GL_UNSIGNED_SHORT, true, 0},
         {"a_scale", 1, GL_UNSIGNED_SHORT, false, 0},
     }));
+
+    m_instanceLayout = std::shared_ptr<VertexLayout>(new VertexLayout({
+        {"a_position", 2, GL_SHORT, false, 0},
+        {"a_axis_x", 2, GL_SHORT, false, 0},
+        {"a_axis_y", 2, GL_SHORT, false, 0},
+        {"a_uv", 4, GL_UNSIGNED_SHORT, false, 0},
+        {"a_selection_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_color", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_stroke", 4, GL_UNSIGNED_BYTE, true, 0},
+        {"a_alpha", 1, GL_UNSIGNED_SHORT, true, 0},
+        {"a_scale", 1, GL_UNSIGNED_SHORT, false, 0},
+    }));
 }
 
 void TextStyle::constructShaderProgram() {
@@ -48,16 +63,53 @@ void TextStyle::constructShaderProgram() {
     m_shaderSource->addSourceBlock("defines", "#define TANGRAM_TEXT\n");
 }
 
+void TextStyle::build(const Scene& _scene) {
+    Style::build(_scene);
+
+    // Own programs for the instanced variant, as for PointStyle
+    const std::string instanced = "#define TANGRAM_INSTANCED\n";
+
+    m_instancedProgram = _scene.shaderProgram(instanced + m_shaderProgram->vertexShaderSource(),
+                                              m_shaderProgram->fragmentShaderSource(),
+                                              "instanced {style:" + m_name + "}");
+
+    if (m_selection) {
+        m_instancedSelectionProgram = _scene.shaderProgram(instanced + m_selectionProgram->vertexShaderSource(),
+                                                           m_selectionProgram->fragmentShaderSource(),
+                                                           "instanced selection_program {style:" + m_name + "}");
+    }
+}
+
 void TextStyle::onBeginUpdate() {
 
+    // Hardware extensions are known once the GL context exists
+    if (!m_instancingResolved) {
+        m_instancingResolved = true;
+
+        if (Hardware::supportsInstancing && m_instancedProgram) {
+            m_instanced = true;
+            m_shaderProgram = m_instancedProgram;
+            if (m_selection) { m_selectionProgram = m_instancedSelectionProgram; }
+        }
+    }
+
     // Clear vertices from previous frame
     for (auto& mesh : m_meshes) { mesh->clear(); }
+    for (auto& mesh : m_instances) { mesh->clear(); }
 
     // Ensure that meshes are available to push to on labels::update()
     size_t s = m_context->glyphTextureCount();
     while (m_meshes.size() < s) {
         m_meshes.push_back(std::make_unique<DynamicQuadMesh<TextVertex>>(m_vertexLayout, GL_TRIANGLES));
     }
+    while (m_instanced && m_instances.size() < s) {
+        m_instances.push_back(std::make_unique<DynamicInstanceMesh<TextInstance>>(m_instanceLayout));
+    }
+}
+
+void TextStyle::onEndUpdate() {
+    for (auto& mesh : m_meshes) { mesh->swap(); }
+    for (auto& mesh : m_instances) { mesh->swap(); }
 }
 
 void TextStyle::onBeginFrame(RenderState& rs) {
@@ -65,8 +117,26 @@ void TextStyle::onBeginFrame(RenderState& rs) {
     // Upload meshes and textures
     m_context->updateTextures(rs);
 
-    for (auto& mesh : m_meshes) {
-        mesh->upload(rs);
+    for (auto& mesh : m_meshes) { mesh->upload(rs); }
+    for (auto& mesh : m_instances) { mesh->upload(rs); }
+}
+
+void TextStyle::drawMeshes(RenderState& rs, ShaderProgram& _program, bool _selection, GLuint _texUnit) {
+
+    if (m_instanced) {
+        for (size_t i = 0; i < m_instances.size(); i++) {
+            if (m_instances[i]->numberOfInstances() == 0) { continue; }
+            if (!_selection) { m_context->bindTexture(rs, i, _texUnit); }
+            m_instances[i]->draw(rs, _program);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        if (m_meshes[i]->isReady()) {
+            if (!_selection) { m_context->bindTexture(rs, i, _texUnit); }
+            m_meshes[i]->draw(rs, _program, !_selection);
+        }
     }
 }
 
@@ -86,39 +156,25 @@ void TextStyle::onBeginDrawFrame(RenderState& rs, const View& _view, Scene& _sce
 
     if (m_sdf) {
         m_shaderProgram->setUniformi(rs, m_mainUniforms.uPass, 1);
-
-        for (size_t i = 0; i < m_meshes.size(); i++) {
-            if (m_meshes[i]->isReady()) {
-                m_context->bindTexture(rs, i, texUnit);
-                m_meshes[i]->draw(rs, *m_shaderProgram);
-            }
-        }
+        drawMeshes(rs, *m_shaderProgram, false, texUnit);
         m_shaderProgram->setUniformi(rs, m_mainUniforms.uPass, 0);
     }
 
-    for (size_t i = 0; i < m_meshes.size(); i++) {
-        if (m_meshes[i]->isReady()) {
-            m_context->bindTexture(rs, i, texUnit);
-            m_meshes[i]->draw(rs, *m_shaderProgram);
-        }
-    }
+    drawMeshes(rs, *m_shaderProgram, false, texUnit);
 }
 
 void TextStyle::onBeginDrawSelectionFrame(RenderState& rs, const View& _view, Scene& _scene) {
     if (!m_selection) { return; }
 
     for (auto& mesh : m_meshes) { mesh->upload(rs); }
+    for (auto& mesh : m_instances) { mesh->upload(rs); }
 
     Style::onBeginDrawSelectionFrame(rs, _view, _scene);
 
     m_selectionProgram->setUniformMatrix4f(rs, m_selectionUniforms.uOrtho,
                                            _view.getOrthoViewportMatrix());
 
-    for (const auto& mesh : m_meshes) {
-        if (mesh->isReady()) {
-            mesh->draw(rs, *m_selectionProgram, false);
-        }
-    }
+    drawMeshes(rs, *m_selectionProgram, true, 0);
 }
 
 std::unique_ptr<StyleBuilder> TextStyle::createBuilder() const {
@@ -136,11 +192,39 @@ DynamicQuadMesh<TextVertex>& TextStyle::getMesh(size_t id) const {
     return *m_meshes[id];
 }
 
+void TextStyle::pushQuad(const GlyphQuad& _quad, const std::array<glm::i16vec2, 4>& _positions,
+                         const TextVertex::State& _state) const {
+
+    if (m_instanced) {
+        // Corners 0 and 3 are opposite, 1 and 2 lie along y and x of corner 0
+        TextInstance& instance = *m_instances[_quad.atlas]->pushInstance();
+
+        instance.pos = _positions[0];
+        instance.axisX = _positions[2] - _positions[0];
+        instance.axisY = _positions[1] - _positions[0];
+        instance.uv = { _quad.quad[0].uv, _quad.quad[3].uv };
+        instance.state = _state;
+        return;
+    }
+
+    auto* quadVertices = m_meshes[_quad.atlas]->pushQuad();
+
+    for (int i = 0; i < 4; i++) {
+        TextVertex& v = quadVertices[i];
+        v.pos = _positions[i];
+        v.uv = _quad.quad[i].uv;
+        v.state = _state;
+    }
+}
+
 size_t TextStyle::dynamicMeshSize() const {
     size_t size = 0;
     for (const auto& mesh : m_meshes) {
         size += mesh->bufferSize();
     }
+    for (const auto& mesh : m_instances) {
+        size += mesh->bufferSize();
+    }
 
     return size;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "gl/dynamicInstanceMesh.h"
 #include "gl/dynamicQuadMesh.h"
 #include "style/style.h"
 #include "labels/labelProperty.h"
@@ -63,6 +64,17 @@ protected:
 
     mutable std::vector<std::unique_ptr<DynamicQuadMesh<TextVertex>>> m_meshes;
 
+    // One TextInstance per glyph and glyph atlas when the hardware supports instancing
+    std::shared_ptr<VertexLayout> m_instanceLayout;
+    mutable std::vector<std::unique_ptr<DynamicInstanceMesh<TextInstance>>> m_instances;
+    std::shared_ptr<ShaderProgram> m_instancedProgram;
+    std::shared_ptr<ShaderProgram> m_instancedSelectionProgram;
+    bool m_instanced = false;
+    bool m_instancingResolved = false;
+
+    // Draw the glyphs of each atlas, binding the atlas to _texUnit unless _selection
+    void drawMeshes(RenderState& rs, ShaderProgram& _program, bool _selection, GLuint _texUnit);
+
 public:
 
     TextStyle(std::string _name, std::shared_ptr<FontContext> _fontContext, bool _sdf = false,
@@ -71,11 +83,15 @@ public:
     void constructVertexLayout() override;
     void constructShaderProgram() override;
 
+    void build(const Scene& _scene) override;
+
     /* Create the LabelMeshes associated with FontContext GlyphTexture<s>
      * No GL involved, called from Tangram::update()
      */
     virtual void onBeginUpdate() override;
 
+    virtual void onEndUpdate() override;
+
     /* Upload the buffers of the text batches
      * Upload the texture atlases
      */
@@ -97,7 +113,9 @@ public:
 
     DynamicQuadMesh<TextVertex>& getMesh(size_t id) const;
 
-    auto& getMeshes() const { return m_meshes; }
+    // Add the glyph _quad with the corners _positions in vertex units
+    void pushQuad(const GlyphQuad& _quad, const std::array<glm::i16vec2, 4>& _positions,
+                  const TextVertex::State& _state) const;
 
     virtual size_t dynamicMeshSize() const override;
 
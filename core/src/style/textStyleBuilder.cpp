@@ -29,7 +29,7 @@
 
 namespace Tangram {
 
-const static std::string key_name("name");
+const static PropertyKey key_name("name");
 
 TextStyleBuilder::TextStyleBuilder(const TextStyle& _style) : m_style(_style) {}
 
@@ -43,6 +43,8 @@ void TextStyleBuilder::setup(const Tile& _tile){
 
     m_atlasRefs.reset();
 
+    // Labels left from a build without quads live in the pool of the last set
+    m_labels.clear();
     m_textLabels = std::make_unique<TextLabels>(m_style);
 }
 
@@ -59,6 +61,8 @@ void TextStyleBuilder::setup(const Marker& marker, int zoom) {
 
     m_atlasRefs.reset();
 
+    // Labels left from a build without quads live in the pool of the last set
+    m_labels.clear();
     m_textLabels = std::make_unique<TextLabels>(m_style);
 }
 
@@ -114,7 +118,7 @@ std::unique_ptr<StyledMesh> TextStyleBuilder::build() {
         size_t quadStart = 0;
         quadPos = 0;
 
-        std::vector<std::unique_ptr<Label>> labels;
+        std::vector<LabelPtr> labels;
         labels.reserve(sumLabels);
 
         std::vector<GlyphQuad> quads;
@@ -159,6 +163,13 @@ std::unique_ptr<StyledMesh> TextStyleBuilder::build() {
         m_textLabels->setQuads(std::move(quads), m_atlasRefs);
     }
 
+    // Glyph sample tables of curved labels, now that quads are final
+    for (auto& label : m_textLabels->getLabels()) {
+        if (label->type() == Label::Type::curved) {
+            static_cast<CurvedLabel*>(label.get())->prepareGlyphs();
+        }
+    }
+
     m_labels.clear();
     m_quads.clear();
 
@@ -520,12 +531,12 @@ void TextStyleBuilder::addCurvedTextLabels(const Line& _line, const TextStyle::P
             selectionColor = _rule.featureSelection->nextColorIdentifier();
         }
 
-        m_labels.emplace_back(new CurvedLabel(l, _params.labelOptions, prio,
-                                               {_attributes.fill,
+        m_labels.push_back(m_textLabels->pool().make<CurvedLabel>(l, _params.labelOptions, prio,
+                                               TextLabel::VertexAttributes{_attributes.fill,
                                                        _attributes.stroke,
                                                        _attributes.fontScale,
                                                        selectionColor},
-                                               {_attributes.width, _attributes.height},
+                                               glm::vec2(_attributes.width, _attributes.height),
                                                *m_textLabels, _attributes.textRanges,
                                                TextLabelProperty::Align::center,
                                                anchor));
@@ -766,6 +777,22 @@ bool isComplexShapingScript(const icu::UnicodeString& _text) {
     return false;
 }
 
+// Whether _text can be passed to layoutText as UTF-8, i.e. has no complex
+// shaping script and its transform needs no ICU. Checked on the bytes: lead
+// bytes below 0xD8 encode codepoints below U+0600.
+bool isSimpleText(const TextStyle::Parameters& _params) {
+    using Transform = TextLabelProperty::Transform;
+
+    if (_params.transform == Transform::capitalize) { return false; }
+
+    bool caseTransform = _params.transform != Transform::none;
+
+    for (unsigned char c : _params.text) {
+        if (c >= 0xD8 || (caseTransform && c >= 0x80)) { return false; }
+    }
+    return true;
+}
+
 bool TextStyleBuilder::prepareLabel(TextStyle::Parameters& _params, Label::Type _type,
                                     LabelAttributes& _attributes) {
 
@@ -774,12 +801,30 @@ bool TextStyleBuilder::prepareLabel(TextStyle::Parameters& _params, Label::Type
         return false;
     }
 
-    auto text = icu::UnicodeString::fromUTF8(_params.text);
+    // Fast path: no conversion for layout of cached texts, no script check
+    bool simple = isSimpleText(_params);
+
+    icu::UnicodeString text;
+    std::string transformed;
+
+    if (simple) {
+        if (_params.transform == TextLabelProperty::Transform::lowercase) {
+            transformed = _params.text;
+            for (auto& c : transformed) { c = std::tolower(c, std::locale::classic()); }
+        } else if (_params.transform == TextLabelProperty::Transform::uppercase) {
+            transformed = _params.text;
+            for (auto& c : transformed) { c = std::toupper(c, std::locale::classic()); }
+        }
+        if (_type == Label::Type::line) { _params.hasComplexShaping = false; }
+
+    } else {
+        text = icu::UnicodeString::fromUTF8(_params.text);
 
-    applyTextTransform(_params, text);
+        applyTextTransform(_params, text);
 
-    if (_type == Label::Type::line) {
-        _params.hasComplexShaping = isComplexShapingScript(text);
+        if (_type == Label::Type::line) {
+            _params.hasComplexShaping = isComplexShapingScript(text);
+        }
     }
 
     // Scale factor by which the texture glyphs are scaled to match fontSize
@@ -803,7 +848,15 @@ bool TextStyleBuilder::prepareLabel(TextStyle::Parameters& _params, Label::Type
     _attributes.textRanges = TextRange{};
 
     glm::vec2 bbox(0);
-    if (ctx->layoutText(_params, text, m_quads, m_atlasRefs, bbox, _attributes.textRanges)) {
+    bool laidOut = false;
+    if (simple) {
+        auto& utf8 = (_params.transform == TextLabelProperty::Transform::none) ? _params.text : transformed;
+        laidOut = ctx->layoutText(_params, utf8, m_quads, m_atlasRefs, bbox, _attributes.textRanges);
+    } else {
+        laidOut = ctx->layoutText(_params, text, m_quads, m_atlasRefs, bbox, _attributes.textRanges);
+    }
+
+    if (laidOut) {
 
         int start = _attributes.quadsStart;
         for (auto& range : _attributes.textRanges) {
@@ -829,12 +882,12 @@ Label* TextStyleBuilder::addLabel(Label::Type _type, TextLabel::Coordinates _coo
         selectionColor = _rule.featureSelection->nextColorIdentifier();
     }
 
-    m_labels.emplace_back(new TextLabel(_coordinates, _type, _params.labelOptions,
-                                        {_attributes.fill,
+    m_labels.push_back(m_textLabels->pool().make<TextLabel>(_coordinates, _type, _params.labelOptions,
+                                        TextLabel::VertexAttributes{_attributes.fill,
                                          _attributes.stroke,
                                          _attributes.fontScale,
                                          selectionColor},
-                                        {_attributes.width, _attributes.height},
+                                        glm::vec2(_attributes.width, _attributes.height),
                                         *m_textLabels, _attributes.textRanges,
                                         _params.align));
 
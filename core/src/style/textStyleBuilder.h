@@ -58,10 +58,12 @@ public:
                              const TextStyle::Parameters& _params);
 
     bool checkRule(const DrawRule& _rule) const override;
-    std::vector<std::unique_ptr<Label>>* labels() { return &m_labels; }
+    std::vector<LabelPtr>* labels() { return &m_labels; }
 
     void addLayoutItems(LabelCollider& _layout) override;
 
+    bool buildsLabels() const override { return true; }
+
 protected:
 
     const TextStyle& m_style;
@@ -72,7 +74,7 @@ protected:
     // Buffers to hold data for TextLabels until build()
     std::vector<GlyphQuad> m_quads;
     std::bitset<FontContext::max_textures> m_atlasRefs;
-    std::vector<std::unique_ptr<Label>> m_labels;
+    std::vector<LabelPtr> m_labels;
 
     float m_tileSize = 0;
     float m_tileScale = 0;
@@ -2,16 +2,19 @@
 
 #include "log.h"
 #include "platform.h"
+#include "text/glyphPacker.h"
+#include "text/glyphSdf.h"
 
-#define SDF_IMPLEMENTATION
-#include "sdf.h"
-
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <regex>
 
 #define SDF_WIDTH 6
 
 #define MIN_LINE_WIDTH 4
+#define UNWRAPPED_LINE_WIDTH (1 << 16)
 
 namespace Tangram {
 
@@ -21,17 +24,156 @@ FontContext::FontContext(std::shared_ptr<const Platform> _platform) :
     m_sdfRadius(SDF_WIDTH),
     m_atlas(*this, GlyphTexture::size, m_sdfRadius),
     m_batch(m_atlas, m_scratch),
-    m_platform(_platform) {}
+    m_platform(_platform) {
+    m_scratch.atlasSlots = &m_atlasSlots;
+}
+
+FontContext::~FontContext() {
+    if (m_bundleChanged) { saveGlyphBundle(); }
+}
 
 void FontContext::setPixelScale(float _scale) {
-    m_sdfRadius = SDF_WIDTH * _scale;
+    std::lock_guard<std::mutex> lock(m_fontMutex);
+
+    float radius = SDF_WIDTH * _scale;
+    if (radius == m_sdfRadius) { return; }
+
+    // Bundles hold SDFs of one radius
+    if (m_bundleChanged) { saveGlyphBundle(); }
+    m_sdfRadius = radius;
+    loadGlyphBundle();
+}
+
+static const char BUNDLE_MAGIC[4] = { 'T', 'G', 'G', 'B' };
+static const uint32_t BUNDLE_VERSION = 1;
+
+// Upper bound of SDF data recorded in a glyph bundle
+static const size_t MAX_BUNDLE_BYTES = 8 * 1024 * 1024;
+
+// Identify a glyph by its rasterized bitmap, FNV-1a
+static uint64_t glyphKey(const unsigned char* _src, uint16_t _width, uint16_t _height, uint16_t _pad) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+
+    add(_width & 0xff); add(_width >> 8);
+    add(_height & 0xff); add(_height >> 8);
+    add(_pad & 0xff);
+    for (size_t i = 0, n = size_t(_width) * _height; i < n; i++) { add(_src[i]); }
+    return hash;
+}
+
+void FontContext::setGlyphBundle(const std::string& _path) {
+    std::lock_guard<std::mutex> lock(m_fontMutex);
+
+    if (m_bundleChanged) { saveGlyphBundle(); }
+    m_bundlePath = _path;
+    loadGlyphBundle();
+}
+
+bool FontContext::writeGlyphBundle() {
+    std::lock_guard<std::mutex> lock(m_fontMutex);
+    return saveGlyphBundle();
+}
+
+void FontContext::loadGlyphBundle() {
+    m_bundleGlyphs.clear();
+    m_bundlePixels.clear();
+    m_bundleChanged = false;
+
+    const std::string& path = m_bundlePath;
+    if (path.empty()) { return; }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) { return; }
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[16 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+
+    struct { char magic[4]; uint32_t version; float radius; uint32_t count; } header;
+    if (data.size() < sizeof(header)) { return; }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 ||
+        header.version != BUNDLE_VERSION || header.radius != m_sdfRadius) {
+        LOG("Glyph bundle '%s' does not match, rasterizing glyphs", path.c_str());
+        return;
+    }
+
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        BundleGlyph glyph;
+        uint64_t key;
+        if (data.size() - pos < sizeof(key) + 4) { break; }
+        std::memcpy(&key, &data[pos], sizeof(key));
+        std::memcpy(&glyph.width, &data[pos + 8], 2);
+        std::memcpy(&glyph.height, &data[pos + 10], 2);
+        pos += sizeof(key) + 4;
+
+        size_t size = size_t(glyph.width) * glyph.height;
+        if (data.size() - pos < size) { break; }
+
+        glyph.offset = m_bundlePixels.size();
+        m_bundlePixels.insert(m_bundlePixels.end(), &data[pos], &data[pos] + size);
+        m_bundleGlyphs.emplace(key, glyph);
+        pos += size;
+    }
+
+    LOG("Loaded %d glyphs from bundle '%s'", int(m_bundleGlyphs.size()), path.c_str());
+}
+
+bool FontContext::saveGlyphBundle() {
+    if (m_bundlePath.empty()) { return false; }
+
+    std::string data(BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    auto put = [&](const void* _value, size_t _size) {
+        data.append(reinterpret_cast<const char*>(_value), _size);
+    };
+    uint32_t count = m_bundleGlyphs.size();
+    put(&BUNDLE_VERSION, sizeof(BUNDLE_VERSION));
+    put(&m_sdfRadius, sizeof(m_sdfRadius));
+    put(&count, sizeof(count));
+
+    for (auto& entry : m_bundleGlyphs) {
+        auto& glyph = entry.second;
+        put(&entry.first, sizeof(entry.first));
+        put(&glyph.width, 2);
+        put(&glyph.height, 2);
+        put(&m_bundlePixels[glyph.offset], size_t(glyph.width) * glyph.height);
+    }
+
+    // Write to a temporary file and rename, so that readers never see
+    // partially written bundles
+    std::string tmpPath = m_bundlePath + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) { return false; }
+
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok &= fclose(file) == 0;
+
+    if (!ok || rename(tmpPath.c_str(), m_bundlePath.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        LOGW("Could not write glyph bundle '%s'", m_bundlePath.c_str());
+        return false;
+    }
+    m_bundleChanged = false;
+    return true;
 }
 
 void FontContext::loadFonts() {
     auto fallbacks = m_platform->systemFontFallbacksHandle();
 
+    m_fallbacks.clear();
+    m_fontAliases.clear();
+    m_fallbackRanges.clear();
+
     for (size_t i = 0; i < s_fontRasterSizes.size(); i++) {
         m_font[i] = m_alfons.addFont("default", s_fontRasterSizes[i]);
+        registerFont(m_font[i], "default", i);
     }
 
     for (const auto& fallback : fallbacks) {
@@ -55,59 +197,243 @@ void FontContext::loadFonts() {
                 return;
         }
 
-        for (size_t i = 0; i < s_fontRasterSizes.size(); i++) {
-            m_font[i]->addFace(m_alfons.addFontFace(source, s_fontRasterSizes[i]));
+        // Faces are added to the fonts whose texts need them, see resolveFallbacks
+        Fallback entry;
+        entry.source = source;
+        entry.faces.resize(s_fontRasterSizes.size());
+        m_fallbacks.push_back(std::move(entry));
+    }
+}
+
+void FontContext::registerFont(const std::shared_ptr<alfons::Font>& _font, const std::string& _alias,
+                               size_t _sizeIndex) {
+    m_fontAliases[_font.get()] = { _alias, _sizeIndex };
+}
+
+const std::shared_ptr<alfons::FontFace>& FontContext::fallbackFace(size_t _index, size_t _sizeIndex) {
+    auto& face = m_fallbacks[_index].faces[_sizeIndex];
+    if (!face) {
+        face = m_alfons.addFontFace(m_fallbacks[_index].source, s_fontRasterSizes[_sizeIndex]);
+    }
+    return face;
+}
+
+bool FontContext::covers(std::shared_ptr<alfons::Font>& _font, const icu::UnicodeString& _probe) {
+    alfons::LineLayout line = m_shaper.shapeICU(_font, _probe, MIN_LINE_WIDTH, UNWRAPPED_LINE_WIDTH);
+    return !line.missingGlyphs() && !line.shapes().empty();
+}
+
+bool FontContext::resolveFallbacks(const std::shared_ptr<alfons::Font>& _font, const icu::UnicodeString& _text) {
+
+    auto entry = m_fontAliases.find(_font.get());
+    if (entry == m_fontAliases.end() || m_fallbacks.empty()) { return false; }
+
+    auto& ranges = m_fallbackRanges[entry->second.alias];
+    size_t sizeIndex = entry->second.sizeIndex;
+    auto font = _font;
+
+    // Codepoints of the text by range, ranges in order of appearance
+    std::vector<std::pair<uint32_t, icu::UnicodeString>> probes;
+    for (int32_t i = 0; i < _text.length(); i = _text.moveIndex32(i, 1)) {
+        UChar32 c = _text.char32At(i);
+        if (c < 0x20) { continue; }
+        uint32_t range = uint32_t(c) >> fallback_range_bits;
+        auto probe = std::find_if(probes.begin(), probes.end(), [&](auto& p) { return p.first == range; });
+        if (probe == probes.end()) {
+            probes.emplace_back(range, icu::UnicodeString());
+            probe = probes.end() - 1;
+        }
+        probe->second.append(c);
+    }
+
+    bool added = false;
+    for (auto& probe : probes) {
+        auto resolved = ranges.find(probe.first);
+
+        if (resolved == ranges.end()) {
+            int index = range_unresolved;
+            if (covers(font, probe.second)) {
+                index = range_covered;
+            } else {
+                // The first fallback of the platform order that covers the range
+                for (size_t i = 0; i < m_fallbacks.size() && index == range_unresolved; i++) {
+                    auto& fallback = m_fallbacks[i];
+                    auto coverage = fallback.coverage.find(probe.first);
+                    if (coverage == fallback.coverage.end()) {
+                        if (!fallback.probe) {
+                            fallback.probe = m_alfons.getFont("fallback_" + std::to_string(i), s_fontRasterSizes[0]);
+                            fallback.probe->addFace(fallbackFace(i, 0));
+                        }
+                        coverage = fallback.coverage.emplace(probe.first, covers(fallback.probe, probe.second)).first;
+                    }
+                    if (coverage->second) { index = int(i); }
+                }
+                if (index == range_unresolved) {
+                    LOGD("No font fallback for codepoints from U+%04X", probe.first << fallback_range_bits);
+                }
+            }
+            resolved = ranges.emplace(probe.first, index).first;
+        }
+
+        // Fonts of other raster sizes of the alias add the face of the resolved fallback
+        if (resolved->second >= 0) {
+            auto& face = fallbackFace(resolved->second, sizeIndex);
+            auto& faces = _font->faces();
+            if (std::find(faces.begin(), faces.end(), face) == faces.end()) {
+                _font->addFace(face);
+                added = true;
+            }
         }
     }
+    return added;
 }
 
-// Synchronized on m_mutex in layoutText(), called on tile-worker threads
+// Called from layoutText() on tile-worker threads
 void FontContext::addTexture(alfons::AtlasID id, uint16_t width, uint16_t height) {
 
     std::lock_guard<std::mutex> lock(m_textureMutex);
 
-    if (m_textures.size() == max_textures) {
-        LOGE("Way too many glyph textures!");
-        return;
+    if (id >= m_atlasSlots.size()) { m_atlasSlots.resize(id + 1, -1); }
+
+    // Take the slot of a released compacted texture
+    auto it = std::find_if(m_textures.begin(), m_textures.end(), [](auto& _texture) {
+        return _texture.atlas == GlyphTexture::no_atlas && !_texture.compacted;
+    });
+    if (it == m_textures.end()) {
+        if (m_textures.size() >= m_maxTextures) {
+            LOGE("Way too many glyph textures!");
+            return;
+        }
+        m_textures.emplace_back();
+        it = m_textures.end() - 1;
     }
-    m_textures.emplace_back();
+    it->atlas = id;
+    m_atlasSlots[id] = int(it - m_textures.begin());
 }
 
-// Synchronized on m_mutex in layoutText(), called on tile-worker threads
+// Synchronized on m_fontMutex in layoutText(), called on tile-worker threads
 void FontContext::addGlyph(alfons::AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
                            const unsigned char* src, uint16_t pad) {
 
-    std::lock_guard<std::mutex> lock(m_textureMutex);
+    if (id >= m_atlasSlots.size() || m_atlasSlots[id] < 0) { return; }
+    size_t slot = m_atlasSlots[id];
 
-    if (id >= max_textures) { return; }
+    // Stage the glyph, its SDF is built by buildGlyphs() once the text is
+    // shaped, without holding m_fontMutex
+    uint16_t width = gw + pad * 2;
+    uint16_t height = gh + pad * 2;
 
-    auto& texData = m_textures[id].texData;
-    auto& texture = m_textures[id].texture;
+    size_t offset = m_stagedPixels.size();
+    size_t size = size_t(width) * height;
 
-    size_t stride = GlyphTexture::size;
-    size_t width =  GlyphTexture::size;
+    {
+        std::lock_guard<std::mutex> lock(m_textureMutex);
+        auto& glyphTexture = m_textures[slot];
+        glyphTexture.glyphs.push_back({ gx, gy, width, height, 0, -1, 0 });
+        glyphTexture.pending++;
+        glyphTexture.reclaim = false;
+    }
 
-    unsigned char* dst = &texData[(gx + pad) + (gy + pad) * stride];
+    // Take the SDF from the glyph bundle when it was computed before
+    uint64_t key = 0;
+    if (!m_bundlePath.empty()) {
+        key = glyphKey(src, gw, gh, pad);
+        auto it = m_bundleGlyphs.find(key);
+        if (it != m_bundleGlyphs.end() &&
+            it->second.width == width && it->second.height == height) {
+            auto start = m_bundlePixels.begin() + it->second.offset;
+            m_stagedPixels.insert(m_stagedPixels.end(), start, start + size);
+            m_stagedGlyphs.push_back({ slot, gx, gy, width, height, offset, key, m_atlasGeneration[slot], false });
+            return;
+        }
+    }
+
+    m_stagedPixels.resize(offset + size, 0);
+    unsigned char* dst = &m_stagedPixels[offset];
 
     for (size_t y = 0, pos = 0; y < gh; y++, pos += gw) {
-        std::memcpy(dst + (y * stride), src + pos, gw);
+        std::memcpy(dst + pad + (y + pad) * width, src + pos, gw);
+    }
+    m_stagedGlyphs.push_back({ slot, gx, gy, width, height, offset, key, m_atlasGeneration[slot], true });
+}
+
+void FontContext::buildGlyphs(std::unique_lock<std::mutex>& _fontLock) {
+    if (m_stagedGlyphs.empty()) { return; }
+
+    std::vector<StagedGlyph> glyphs;
+    std::vector<unsigned char> pixels;
+    std::swap(glyphs, m_stagedGlyphs);
+    std::swap(pixels, m_stagedPixels);
+
+    float radius = m_sdfRadius;
+    bool record = !m_bundlePath.empty();
+
+    // Other workers shape their texts meanwhile. Their labels may use these
+    // glyphs from the shaped text cache before they are committed, and show
+    // them with the next upload of the atlas.
+    _fontLock.unlock();
+
+    static thread_local GlyphSdfScratch s_sdfScratch;
+    for (auto& glyph : glyphs) {
+        if (!glyph.bitmap) { continue; }
+        unsigned char* dst = &pixels[glyph.offset];
+        buildGlyphSdf(dst, glyph.width, radius, dst, glyph.width, glyph.height, glyph.width, s_sdfScratch);
     }
 
-    dst = &texData[size_t(gx) + (size_t(gy) * width)];
-    gw += pad * 2;
-    gh += pad * 2;
+    commitGlyphs(glyphs, pixels);
 
-    size_t bytes = size_t(gw) * size_t(gh) * sizeof(float) * 3;
-    if (m_sdfBuffer.size() < bytes) {
-        m_sdfBuffer.resize(bytes);
+    _fontLock.lock();
+
+    // Record for the next session, unless the bundle changed with the radius
+    if (!record || m_bundlePath.empty() || radius != m_sdfRadius) { return; }
+
+    for (auto& glyph : glyphs) {
+        if (!glyph.bitmap) { continue; }
+        size_t size = size_t(glyph.width) * glyph.height;
+        if (m_bundlePixels.size() + size > MAX_BUNDLE_BYTES) { break; }
+
+        const unsigned char* src = &pixels[glyph.offset];
+        m_bundleGlyphs[glyph.key] = { m_bundlePixels.size(), glyph.width, glyph.height };
+        m_bundlePixels.insert(m_bundlePixels.end(), src, src + size);
+        m_bundleChanged = true;
     }
+}
+
+void FontContext::commitGlyphs(const std::vector<StagedGlyph>& _glyphs,
+                               const std::vector<unsigned char>& _pixels) {
+
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    size_t stride = GlyphTexture::size;
 
-    sdfBuildDistanceFieldNoAlloc(dst, width, m_sdfRadius,
-                                 dst, gw, gh, width,
-                                 &m_sdfBuffer[0]);
+    for (auto& glyph : _glyphs) {
+        if (glyph.atlas >= m_textures.size()) { continue; }
 
-    texture.setDirty(gy, gh);
-    m_textures[id].dirty = true;
+        // The atlas was cleared after the glyph was added, its rect may
+        // belong to another glyph now
+        if (glyph.generation != m_atlasGeneration[glyph.atlas]) { continue; }
+
+        m_textures[glyph.atlas].pending--;
+
+        auto& texData = m_textures[glyph.atlas].texData;
+        // Pixels of released atlases are allocated again on first use
+        if (texData.empty()) { texData.assign(stride * stride, 0); }
+
+        const unsigned char* src = &_pixels[glyph.offset];
+
+        for (size_t y = 0; y < glyph.height; y++) {
+            std::memcpy(&texData[glyph.x + (glyph.y + y) * stride],
+                        src + y * glyph.width, glyph.width);
+        }
+
+        m_textures[glyph.atlas].texture.setDirtyRect(glyph.x, glyph.y, glyph.width, glyph.height);
+        m_textures[glyph.atlas].dirty = true;
+    }
+}
+
+void FontContext::setMaxTextures(size_t _count) {
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+    m_maxTextures = std::min<size_t>(std::max<size_t>(_count, 1), max_textures);
 }
 
 void FontContext::releaseAtlas(std::bitset<max_textures> _refs) {
@@ -118,6 +444,212 @@ void FontContext::releaseAtlas(std::bitset<max_textures> _refs) {
     }
 }
 
+GlyphTexture::Glyph* FontContext::findGlyph(size_t _slot, const GlyphQuad& _quad) {
+    if (_slot >= m_textures.size()) { return nullptr; }
+    auto& glyphTexture = m_textures[_slot];
+
+    glm::u16vec2 corner = glm::min(_quad.quad[0].uv, _quad.quad[3].uv);
+    uint32_t key = corner.x | (uint32_t(corner.y) << 16);
+
+    auto it = glyphTexture.corners.find(key);
+    if (it != glyphTexture.corners.end()) { return &glyphTexture.glyphs[it->second]; }
+
+    // Quads lie within the padded rect of their glyph
+    for (uint32_t i = 0; i < glyphTexture.glyphs.size(); i++) {
+        auto& glyph = glyphTexture.glyphs[i];
+        if (corner.x >= glyph.x && corner.x < glyph.x + glyph.width &&
+            corner.y >= glyph.y && corner.y < glyph.y + glyph.height) {
+            glyphTexture.corners.emplace(key, i);
+            return &glyph;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t FontContext::retainGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs) {
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    for (auto& quad : _quads) {
+        if (auto* glyph = findGlyph(quad.atlas, quad)) { glyph->refs++; }
+    }
+    moveGlyphs(_quads, _refs);
+
+    return m_compactionEpoch;
+}
+
+uint32_t FontContext::remapGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs) {
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    moveGlyphs(_quads, _refs);
+
+    return m_compactionEpoch;
+}
+
+void FontContext::releaseGlyphs(const std::vector<GlyphQuad>& _quads) {
+    if (_quads.empty()) { return; }
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    for (auto& quad : _quads) {
+        auto* glyph = findGlyph(quad.atlas, quad);
+        if (glyph && glyph->refs > 0) { glyph->refs--; }
+    }
+}
+
+void FontContext::moveGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs) {
+
+    std::bitset<max_textures> left, used;
+
+    for (auto& quad : _quads) {
+        if (quad.atlas < m_textures.size() && m_textures[quad.atlas].forwards.any()) {
+            auto* glyph = findGlyph(quad.atlas, quad);
+
+            if (glyph && glyph->movedTo >= 0) {
+                auto& moved = m_textures[glyph->movedTo].glyphs[glyph->movedIndex];
+                glm::ivec2 delta(int(moved.x) - glyph->x, int(moved.y) - glyph->y);
+                for (auto& corner : quad.quad) {
+                    corner.uv = glm::u16vec2(glm::ivec2(corner.uv) + delta);
+                }
+                if (glyph->refs > 0) { glyph->refs--; }
+                moved.refs++;
+
+                left[quad.atlas] = true;
+                quad.atlas = glyph->movedTo;
+            }
+        }
+        if (quad.atlas < max_textures) { used[quad.atlas] = true; }
+    }
+
+    if (!left.any()) { return; }
+
+    // Reference the entered atlases, release the ones no quad uses anymore
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        if (used[i] && !_refs[i]) {
+            _refs[i] = true;
+            m_atlasRefCount[i]++;
+        } else if (left[i] && !used[i] && _refs[i]) {
+            _refs[i] = false;
+            m_atlasRefCount[i]--;
+        }
+    }
+}
+
+size_t FontContext::compactAtlases() {
+    std::lock_guard<std::mutex> fontLock(m_fontMutex);
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    const size_t size = GlyphTexture::size;
+
+    // Alfons adds new glyphs to its last atlas
+    int lastAtlas = GlyphTexture::no_atlas;
+    for (auto& glyphTexture : m_textures) { lastAtlas = std::max(lastAtlas, glyphTexture.atlas); }
+
+    // Glyphs that retained labels use, by texture and index
+    std::vector<std::pair<size_t, uint32_t>> live;
+    std::vector<uint16_t> widths, heights;
+    size_t sources = 0;
+
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        auto& glyphTexture = m_textures[i];
+        if (glyphTexture.atlas == GlyphTexture::no_atlas || glyphTexture.atlas == lastAtlas ||
+            glyphTexture.pending > 0 || glyphTexture.forwards.any() ||
+            glyphTexture.texData.empty() || m_atlasRefCount[i] == 0) {
+            continue;
+        }
+
+        size_t area = 0;
+        for (auto& glyph : glyphTexture.glyphs) {
+            if (glyph.refs > 0) { area += size_t(glyph.width) * glyph.height; }
+        }
+        if (area > size * size * compaction_max_usage) { continue; }
+
+        sources++;
+        for (uint32_t g = 0; g < glyphTexture.glyphs.size(); g++) {
+            auto& glyph = glyphTexture.glyphs[g];
+            if (glyph.refs == 0) { continue; }
+            live.emplace_back(i, g);
+            widths.push_back(glyph.width);
+            heights.push_back(glyph.height);
+        }
+    }
+
+    if (sources < 2) { return 0; }
+
+    std::vector<PackedGlyph> placed;
+    size_t pages = packGlyphs(widths, heights, size, placed);
+    if (pages >= sources) { return 0; }
+
+    // Free slots, then new ones
+    std::vector<size_t> slots;
+    for (size_t i = 0; i < m_textures.size() && slots.size() < pages; i++) {
+        auto& glyphTexture = m_textures[i];
+        if (glyphTexture.atlas == GlyphTexture::no_atlas && !glyphTexture.compacted) {
+            slots.push_back(i);
+        }
+    }
+    if (slots.size() + (m_maxTextures - std::min(m_maxTextures, m_textures.size())) < pages) { return 0; }
+
+    while (slots.size() < pages) {
+        slots.push_back(m_textures.size());
+        m_textures.emplace_back();
+    }
+
+    for (size_t slot : slots) {
+        auto& glyphTexture = m_textures[slot];
+        glyphTexture.compacted = true;
+        glyphTexture.texData.assign(size * size, 0);
+        glyphTexture.dirty = true;
+        glyphTexture.reclaim = false;
+    }
+
+    size_t moved = 0;
+    for (size_t k = 0; k < live.size(); k++) {
+        if (placed[k].page == PackedGlyph::none) { continue; }
+
+        size_t slot = slots[placed[k].page];
+        auto& from = m_textures[live[k].first];
+        auto& to = m_textures[slot];
+        auto& glyph = from.glyphs[live[k].second];
+
+        for (size_t y = 0; y < glyph.height; y++) {
+            std::memcpy(&to.texData[placed[k].x + (placed[k].y + y) * size],
+                        &from.texData[glyph.x + (glyph.y + y) * size], glyph.width);
+        }
+
+        glyph.movedTo = int(slot);
+        glyph.movedIndex = to.glyphs.size();
+        to.glyphs.push_back({ placed[k].x, placed[k].y, glyph.width, glyph.height, 0, -1, 0 });
+
+        // Keep the new texture while labels still use the old one
+        if (!from.forwards[slot]) {
+            from.forwards[slot] = true;
+            m_atlasRefCount[slot]++;
+        }
+        moved++;
+    }
+
+    if (moved == 0) { return 0; }
+
+    m_atlasStats.compactions++;
+    m_atlasStats.movedGlyphs += moved;
+    m_compactionEpoch++;
+
+    LOGD("Compacted %d glyph atlases into %d, moved %d glyphs", int(sources), int(pages), int(moved));
+
+    return moved;
+}
+
+GlyphAtlasStats FontContext::atlasStats(bool _reset) {
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    GlyphAtlasStats stats = m_atlasStats;
+    stats.atlases = 0;
+    for (auto& glyphTexture : m_textures) {
+        if (!glyphTexture.texData.empty()) { stats.atlases++; }
+    }
+    if (_reset) { m_atlasStats = {}; }
+    return stats;
+}
+
 void FontContext::updateTextures(RenderState& rs) {
     std::lock_guard<std::mutex> lock(m_textureMutex);
 
@@ -140,16 +672,118 @@ bool FontContext::layoutText(TextStyle::Parameters& _params, const icu::UnicodeS
                              std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs,
                              glm::vec2& _size, TextRange& _textRanges) {
 
-    std::lock_guard<std::mutex> lock(m_fontMutex);
+    std::unique_lock<std::mutex> lock(m_fontMutex);
+
+    std::string key = shapedTextKey(_params, reinterpret_cast<const char*>(_text.getBuffer()),
+                                    _text.length() * sizeof(UChar), false);
+
+    if (findShapedText(key, _quads, _refs, _size, _textRanges)) { return true; }
 
-    alfons::LineLayout line = m_shaper.shapeICU(_params.font, _text, MIN_LINE_WIDTH,
-                                                _params.wordWrap ? _params.maxLineWidth : 0);
+    auto& line = lineLayout(_params.font, reinterpret_cast<const char*>(_text.getBuffer()),
+                            _text.length() * sizeof(UChar), false);
+
+    bool shaped = shapeText(_params, line, key, _quads, _refs, _size, _textRanges);
+    buildGlyphs(lock);
+    return shaped;
+}
+
+bool FontContext::layoutText(TextStyle::Parameters& _params, const std::string& _text,
+                             std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs,
+                             glm::vec2& _size, TextRange& _textRanges) {
+
+    std::unique_lock<std::mutex> lock(m_fontMutex);
+
+    std::string key = shapedTextKey(_params, _text.data(), _text.size(), true);
+
+    if (findShapedText(key, _quads, _refs, _size, _textRanges)) { return true; }
+
+    auto& line = lineLayout(_params.font, _text.data(), _text.size(), true);
+
+    bool shaped = shapeText(_params, line, key, _quads, _refs, _size, _textRanges);
+    buildGlyphs(lock);
+    return shaped;
+}
+
+const alfons::LineLayout& FontContext::lineLayout(const std::shared_ptr<alfons::Font>& _font,
+                                                  const char* _text, size_t _length, bool _utf8) {
+
+    std::string key;
+    key.reserve(sizeof(alfons::Font*) + 1 + _length);
+    auto font = _font.get();
+    key.append(reinterpret_cast<const char*>(&font), sizeof(font));
+    key.push_back(_utf8 ? 1 : 0);
+    key.append(_text, _length);
+
+    auto cached = m_lineLayoutIndex.find(key);
+    if (cached != m_lineLayoutIndex.end()) {
+        m_lineLayouts.splice(m_lineLayouts.begin(), m_lineLayouts, cached->second);
+        return cached->second->second;
+    }
+
+    // Only texts which are not cached are converted for shaping
+    icu::UnicodeString text = _utf8
+        ? icu::UnicodeString::fromUTF8(icu::StringPiece(_text, _length))
+        : icu::UnicodeString(reinterpret_cast<const UChar*>(_text), int32_t(_length / sizeof(UChar)));
+
+    // The shaper only finds break opportunities when wrapping; no line gets
+    // this long, so wrapping is left to TextWrapper::wrapLine.
+    alfons::LineLayout line = m_shaper.shapeICU(_font, text, MIN_LINE_WIDTH, UNWRAPPED_LINE_WIDTH);
+
+    if ((line.missingGlyphs() || line.shapes().empty()) && resolveFallbacks(_font, text)) {
+        line = m_shaper.shapeICU(_font, text, MIN_LINE_WIDTH, UNWRAPPED_LINE_WIDTH);
+    }
+
+    m_lineLayouts.emplace_front(key, std::move(line));
+    m_lineLayoutIndex[key] = m_lineLayouts.begin();
+
+    if (m_lineLayouts.size() > max_line_layouts) {
+        m_lineLayoutIndex.erase(m_lineLayouts.back().first);
+        m_lineLayouts.pop_back();
+    }
+    return m_lineLayouts.front().second;
+}
+
+bool FontContext::findShapedText(const std::string& _key, std::vector<GlyphQuad>& _quads,
+                                 std::bitset<max_textures>& _refs, glm::vec2& _size,
+                                 TextRange& _textRanges) {
+
+    auto cached = m_shapedTextIndex.find(_key);
+    if (cached == m_shapedTextIndex.end()) { return false; }
+
+    size_t quadsStart = _quads.size();
+
+    // Move to front of the LRU list
+    m_shapedTexts.splice(m_shapedTexts.begin(), m_shapedTexts, cached->second);
+    auto& shaped = cached->second->second;
+
+    _quads.insert(_quads.end(), shaped.quads.begin(), shaped.quads.end());
+    for (size_t i = 0; i < 3; i++) {
+        _textRanges[i] = Range(shaped.ranges[i].start + quadsStart, shaped.ranges[i].length);
+    }
+    _size = shaped.size;
+
+    addAtlasRefs(_quads.begin() + quadsStart, _quads.end(), _refs);
+    return true;
+}
+
+bool FontContext::shapeText(TextStyle::Parameters& _params, const alfons::LineLayout& _line,
+                            const std::string& _key, std::vector<GlyphQuad>& _quads,
+                            std::bitset<max_textures>& _refs, glm::vec2& _size,
+                            TextRange& _textRanges) {
+
+    size_t quadsStart = _quads.size();
 
-    if (line.missingGlyphs() || line.shapes().size() == 0) {
+    if (_line.missingGlyphs() || _line.shapes().size() == 0) {
         // Nothing to do!
         return false;
     }
 
+    // The cached line is kept unwrapped
+    alfons::LineLayout line = _line;
+    if (_params.wordWrap && _params.maxLineWidth > 0) {
+        TextWrapper::wrapLine(line, MIN_LINE_WIDTH, _params.maxLineWidth);
+    }
+
     line.setScale(_params.fontScale);
 
     // m_batch.drawShapeRange() calls FontContext's TextureCallback for new glyphs
@@ -157,7 +791,6 @@ bool FontContext::layoutText(TextStyle::Parameters& _params, const icu::UnicodeS
 
     m_scratch.quads = &_quads;
 
-    size_t quadsStart = _quads.size();
     alfons::LineMetrics metrics;
 
     std::array<bool, 3> alignments = {};
@@ -247,32 +880,191 @@ bool FontContext::layoutText(TextStyle::Parameters& _params, const icu::UnicodeS
     glm::vec2 offset((metrics.aabb.x + width * 0.5) * TextVertex::position_scale,
                      (metrics.aabb.y + height * 0.5) * TextVertex::position_scale);
 
-    {
-        std::lock_guard<std::mutex> lock(m_textureMutex);
-        for (; it != _quads.end(); ++it) {
+    for (; it != _quads.end(); ++it) {
+        it->quad[0].pos -= offset;
+        it->quad[1].pos -= offset;
+        it->quad[2].pos -= offset;
+        it->quad[3].pos -= offset;
+    }
 
-            if (!_refs[it->atlas]) {
-                _refs[it->atlas] = true;
-                m_atlasRefCount[it->atlas]++;
-            }
+    // Keep the glyph quads for other labels with the same text and parameters
+    ShapedText shaped;
+    shaped.quads.assign(_quads.begin() + quadsStart, _quads.end());
+    for (size_t i = 0; i < 3; i++) {
+        shaped.ranges[i] = Range(_textRanges[i].start - quadsStart, _textRanges[i].length);
+    }
+    shaped.size = _size;
+    for (auto& quad : shaped.quads) { shaped.atlases[quad.atlas] = true; }
+    m_shapedTextAtlases |= shaped.atlases;
+
+    m_shapedTexts.emplace_front(_key, std::move(shaped));
+    m_shapedTextIndex[_key] = m_shapedTexts.begin();
+
+    if (m_shapedTexts.size() > max_shaped_texts) {
+        m_shapedTextIndex.erase(m_shapedTexts.back().first);
+        m_shapedTexts.pop_back();
+    }
+
+    addAtlasRefs(_quads.begin() + quadsStart, _quads.end(), _refs);
+
+    return true;
+}
+
+std::string FontContext::shapedTextKey(const TextStyle::Parameters& _params, const char* _text,
+                                       size_t _length, bool _utf8) const {
+
+    // Alignments used by layoutText
+    uint8_t alignments = 0;
+    if (_params.align != TextLabelProperty::Align::none) {
+        alignments |= 1 << int(_params.align);
+    }
+    for (int i = 0; i < _params.labelOptions.anchors.count; i++) {
+        auto alignment = TextLabelProperty::alignFromAnchor(_params.labelOptions.anchors[i]);
+        if (alignment != TextLabelProperty::Align::none) {
+            alignments |= 1 << int(alignment);
+        }
+    }
+
+    struct {
+        const alfons::Font* font;
+        float fontScale;
+        float lineSpacing;
+        uint32_t maxLines;
+        uint32_t maxLineWidth;
+        uint8_t wordWrap;
+        uint8_t alignments;
+        uint8_t utf8;
+    } params;
+
+    std::memset(&params, 0, sizeof(params));
+    params.font = _params.font.get();
+    params.fontScale = _params.fontScale;
+    params.lineSpacing = _params.lineSpacing;
+    params.wordWrap = _params.wordWrap;
+    params.alignments = alignments;
+    params.utf8 = _utf8;
+    if (_params.wordWrap) {
+        params.maxLines = _params.maxLines;
+        params.maxLineWidth = _params.maxLineWidth;
+    }
+
+    std::string key(reinterpret_cast<const char*>(&params), sizeof(params));
+    key.append(_text, _length);
+    return key;
+}
+
+void FontContext::addAtlasRefs(std::vector<GlyphQuad>::iterator _begin,
+                               std::vector<GlyphQuad>::iterator _end,
+                               std::bitset<max_textures>& _refs) {
 
-            it->quad[0].pos -= offset;
-            it->quad[1].pos -= offset;
-            it->quad[2].pos -= offset;
-            it->quad[3].pos -= offset;
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+    for (auto it = _begin; it != _end; ++it) {
+        if (!_refs[it->atlas]) {
+            _refs[it->atlas] = true;
+            m_atlasRefCount[it->atlas]++;
         }
+    }
+
+    // Clear unused textures
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        if (m_atlasRefCount[i] == 0) { clearAtlas(i); }
+    }
+}
+
+void FontContext::clearAtlas(size_t _slot) {
+    auto& glyphTexture = m_textures[_slot];
+    if (glyphTexture.atlas == GlyphTexture::no_atlas && !glyphTexture.compacted) { return; }
+
+    if (glyphTexture.atlas != GlyphTexture::no_atlas) { m_atlas.clear(glyphTexture.atlas); }
+    m_atlasGeneration[_slot]++;
+
+    auto& texData = glyphTexture.texData;
+    if (glyphTexture.compacted) {
+        // Free the slot for new compactions and alfons atlases
+        std::vector<unsigned char>().swap(texData);
+        glyphTexture.texture.dispose();
+        glyphTexture.dirty = false;
+        glyphTexture.compacted = false;
+    } else if (!texData.empty()) {
+        texData.assign(texData.size(), 0);
+    }
+
+    glyphTexture.glyphs.clear();
+    glyphTexture.corners.clear();
+    glyphTexture.pending = 0;
 
-        // Clear unused textures
+    // The last label left for the textures holding the moved glyphs
+    if (glyphTexture.forwards.any()) {
         for (size_t i = 0; i < m_textures.size(); i++) {
-            if (m_atlasRefCount[i] == 0) {
-                m_atlas.clear(i);
-                m_textures[i].texData.assign(GlyphTexture::size *
-                                             GlyphTexture::size, 0);
-            }
+            if (glyphTexture.forwards[i]) { m_atlasRefCount[i] -= 1; }
         }
+        glyphTexture.forwards.reset();
+        glyphTexture.reclaim = true;
     }
 
-    return true;
+    // Cached quads refer to glyphs of the cleared atlas
+    clearShapedTexts(_slot);
+}
+
+void FontContext::clearShapedTexts(size_t _atlas) {
+    if (!m_shapedTextAtlases[_atlas]) { return; }
+    m_shapedTextAtlases[_atlas] = false;
+
+    for (auto entry = m_shapedTexts.begin(); entry != m_shapedTexts.end();) {
+        if (entry->second.atlases[_atlas]) {
+            m_shapedTextIndex.erase(entry->first);
+            entry = m_shapedTexts.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+size_t FontContext::releaseUnusedAtlases() {
+    return releaseAtlases(false);
+}
+
+size_t FontContext::releaseCompactedAtlases() {
+    return releaseAtlases(true);
+}
+
+size_t FontContext::releaseAtlases(bool _compacted) {
+    std::lock_guard<std::mutex> fontLock(m_fontMutex);
+    std::lock_guard<std::mutex> lock(m_textureMutex);
+
+    size_t freed = 0;
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        auto& glyphTexture = m_textures[i];
+        if (m_atlasRefCount[i] != 0 || glyphTexture.texData.empty()) { continue; }
+
+        // Atlases cleared before still have to report their moved glyphs
+        bool reclaim = glyphTexture.reclaim || glyphTexture.forwards.any();
+        if (_compacted && !reclaim) { continue; }
+
+        size_t cpuBytes = glyphTexture.texData.capacity();
+        size_t gpuBytes = glyphTexture.texture.memoryUsage().total();
+        freed += cpuBytes + gpuBytes;
+        if (reclaim) {
+            m_atlasStats.reclaimedCpuBytes += cpuBytes;
+            m_atlasStats.reclaimedGpuBytes += gpuBytes;
+        }
+
+        clearAtlas(i);
+        glyphTexture.reclaim = false;
+        std::vector<unsigned char>().swap(glyphTexture.texData);
+        glyphTexture.texture.dispose();
+        glyphTexture.dirty = false;
+    }
+    return freed;
+}
+
+void FontContext::clearShapedTexts() {
+    m_shapedTextAtlases.reset();
+    m_shapedTexts.clear();
+    m_shapedTextIndex.clear();
+    // Keys refer to fonts that may be released
+    m_lineLayouts.clear();
+    m_lineLayoutIndex.clear();
 }
 
 void FontContext::addFont(const FontDescription& _ft, alfons::InputSource _source) {
@@ -280,26 +1072,59 @@ void FontContext::addFont(const FontDescription& _ft, alfons::InputSource _sourc
     // NB: Synchronize for calls from download thread
     std::lock_guard<std::mutex> lock(m_fontMutex);
 
+    // Texts may be shaped with the new font as fallback
+    clearShapedTexts();
+
     for (size_t i = 0; i < s_fontRasterSizes.size(); i++) {
         auto font = m_alfons.getFont(_ft.alias, s_fontRasterSizes[i]);
         font->addFace(m_alfons.addFontFace(_source, s_fontRasterSizes[i]));
+        registerFont(font, _ft.alias, i);
 
         // add fallbacks from default font
         font->addFaces(*m_font[i]);
     }
 }
 
+MemoryUsage FontContext::memoryUsage() {
+    MemoryUsage usage;
+    {
+        std::lock_guard<std::mutex> lock(m_textureMutex);
+        for (auto& glyphTexture : m_textures) {
+            usage.cpuBytes += glyphTexture.texData.capacity();
+            usage += glyphTexture.texture.memoryUsage();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_fontMutex);
+    // Keys are stored in the list and in the index
+    for (auto& entry : m_shapedTexts) {
+        usage.cpuBytes += sizeof(entry) + sizeof(decltype(m_shapedTextIndex)::value_type) +
+            2 * entry.first.capacity() + entry.second.quads.capacity() * sizeof(GlyphQuad);
+    }
+    for (auto& entry : m_lineLayouts) {
+        usage.cpuBytes += sizeof(entry) + sizeof(decltype(m_lineLayoutIndex)::value_type) +
+            2 * entry.first.capacity() + entry.second.shapes().capacity() * sizeof(alfons::Shape);
+    }
+    usage.cpuBytes += m_bundlePixels.capacity() +
+        m_bundleGlyphs.size() * sizeof(decltype(m_bundleGlyphs)::value_type);
+
+    return usage;
+}
+
 void FontContext::releaseFonts() {
 
     std::lock_guard<std::mutex> lock(m_fontMutex);
+    clearShapedTexts();
+
     // Unload Freetype and Harfbuzz resources for all font faces
     m_alfons.unload();
 
-    // Release system font fallbacks input source data from default fonts, since
-    // those are 'weak' resources (would be automatically reloaded by alfons from
-    // its URI or source callback.
-    for (auto& font : m_font) {
-        for (auto& face : font->faces()) {
+    // Release system font fallbacks input source data, since those are 'weak'
+    // resources (would be automatically reloaded by alfons from its URI or
+    // source callback.
+    for (auto& fallback : m_fallbacks) {
+        for (auto& face : fallback.faces) {
+            if (!face) { continue; }
             alfons::InputSource& fontSource = face->descriptor().source;
 
             if (fontSource.isUri() || fontSource.hasSourceCallback()) {
@@ -310,12 +1135,12 @@ void FontContext::releaseFonts() {
 }
 
 void FontContext::ScratchBuffer::drawGlyph(const alfons::Rect& q, const alfons::AtlasGlyph& atlasGlyph) {
-    if (atlasGlyph.atlas >= max_textures) { return; }
+    if (atlasGlyph.atlas >= atlasSlots->size() || (*atlasSlots)[atlasGlyph.atlas] < 0) { return; }
 
     auto& g = *atlasGlyph.glyph;
 
     quads->push_back({
-            atlasGlyph.atlas,
+            size_t((*atlasSlots)[atlasGlyph.atlas]),
             {{glm::vec2{q.x1, q.y1} * TextVertex::position_scale, {g.u1, g.v1}},
              {glm::vec2{q.x1, q.y2} * TextVertex::position_scale, {g.u1, g.v2}},
              {glm::vec2{q.x2, q.y1} * TextVertex::position_scale, {g.u2, g.v1}},
@@ -337,8 +1162,11 @@ std::shared_ptr<alfons::Font> FontContext::getFont(const std::string& _family, c
 
     std::lock_guard<std::mutex> lock(m_fontMutex);
 
-    auto font = m_alfons.getFont(FontDescription::Alias(_family, _style, _weight), fontSize);
-    if (font->hasFaces()) { return font; }
+    auto alias = FontDescription::Alias(_family, _style, _weight);
+    auto font = m_alfons.getFont(alias, fontSize);
+    // Fonts without a system face get their faces from the fallbacks
+    if (font->hasFaces() || m_fontAliases.count(font.get())) { return font; }
+    registerFont(font, alias, sizeIndex);
 
     // First, try to load from the system fonts.
 
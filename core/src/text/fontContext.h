@@ -12,8 +12,14 @@
 #include "alfons/inputSource.h"
 #include "alfons/textBatch.h"
 #include "alfons/textShaper.h"
+#include "map.h"
+
+#include <atomic>
 #include <bitset>
+#include <list>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace Tangram {
 
@@ -30,11 +36,38 @@ struct GlyphTexture {
         texData.resize(size * size);
     }
 
+    // Atlas of alfons the texture holds, none for compacted or free textures
+    static constexpr int no_atlas = -1;
+
+    // Rect of a glyph in texData and the quads of retained labels using it
+    struct Glyph {
+        uint16_t x, y, width, height;
+        uint32_t refs;
+        // Texture and index of the glyph it was moved to by compaction, if any
+        int movedTo;
+        uint32_t movedIndex;
+    };
+
     std::vector<unsigned char> texData;
     Texture texture;
 
     bool dirty = false;
-    size_t refCount = 0;
+
+    int atlas = no_atlas;
+    // Holds glyphs moved from other textures by FontContext::compactAtlases()
+    bool compacted = false;
+
+    std::vector<Glyph> glyphs;
+    // Glyph index by the first corner of quads using it
+    std::unordered_map<uint32_t, uint32_t> corners;
+    // Glyphs added but not committed into texData yet
+    int pending = 0;
+
+    // Textures holding moved glyphs. Each keeps a reference for this texture
+    // until it is cleared, i.e. its last label moved to them.
+    std::bitset<64> forwards;
+    // Its glyphs were moved, freeing its pixels counts as reclaimed
+    bool reclaim = false;
 };
 
 struct FontDescription {
@@ -62,27 +95,54 @@ class FontContext : public alfons::TextureCallback {
 public:
 
     static constexpr int max_textures = 64;
+    static_assert(max_textures <= 64, "GlyphTexture::forwards has a bit per texture");
 
     FontContext(std::shared_ptr<const Platform> _platform);
-    virtual ~FontContext() {}
+    virtual ~FontContext();
 
     void loadFonts();
 
-    /* Synchronized on m_mutex on tile-worker threads
+    /* Synchronized on m_fontMutex on tile-worker threads
      * Called from alfons when a texture atlas needs to be created
      * Triggered from TextStyleBuilder::prepareLabel
      */
     void addTexture(alfons::AtlasID id, uint16_t width, uint16_t height) override;
 
-    /* Synchronized on m_mutex, called tile-worker threads
+    /* Synchronized on m_fontMutex, called tile-worker threads
      * Called from alfons when a glyph needs to be added the the atlas identified by id
      * Triggered from TextStyleBuilder::prepareLabel
+     * The glyph bitmap is staged, its SDF is built by buildGlyphs()
      */
     void addGlyph(alfons::AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
                   const unsigned char* src, uint16_t pad) override;
 
     void releaseAtlas(std::bitset<max_textures> _refs);
 
+    /* Reference the glyphs of _quads for a retained label set. Quads of glyphs
+     * that were moved by compactAtlases() are moved along, _refs is updated for
+     * the atlases they leave and enter. Returns the compaction epoch. */
+    uint32_t retainGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs);
+
+    /* Move quads retained before the last compaction, see retainGlyphs() */
+    uint32_t remapGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs);
+
+    void releaseGlyphs(const std::vector<GlyphQuad>& _quads);
+
+    /* Increases whenever compactAtlases() moves glyphs */
+    uint32_t compactionEpoch() const { return m_compactionEpoch; }
+
+    /* Move the live glyphs of sparse atlases, i.e. glyphs which retained labels
+     * use, into fewer new atlases. The old atlases are released once the labels
+     * using them are moved by remapGlyphs(), see releaseCompactedAtlases().
+     * Returns the number of moved glyphs. */
+    size_t compactAtlases();
+
+    /* Free the pixels and textures of atlases whose glyphs were moved and which
+     * no label refers to anymore, returns the freed bytes */
+    size_t releaseCompactedAtlases();
+
+    GlyphAtlasStats atlasStats(bool _reset);
+
     /* Update all textures batches, uploads the data to the GPU */
     void updateTextures(RenderState& rs);
 
@@ -96,42 +156,235 @@ public:
 
     void bindTexture(RenderState& rs, alfons::AtlasID _id, GLuint _unit);
 
+    /* Bytes of glyph atlases, the shaped text and line layout caches and the glyph bundle */
+    MemoryUsage memoryUsage();
+
+    /* Free the pixels and textures of atlases that no label refers to,
+     * returns the freed bytes */
+    size_t releaseUnusedAtlases();
+
     float maxStrokeWidth() { return m_sdfRadius; }
 
     bool layoutText(TextStyle::Parameters& _params, const icu::UnicodeString& _text,
                     std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs,
                     glm::vec2& _bbox, TextRange& _textRanges);
 
+    /* Layout of UTF-8 _text, which is only converted for shaping when it
+     * is not found in the shaped text cache */
+    bool layoutText(TextStyle::Parameters& _params, const std::string& _text,
+                    std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs,
+                    glm::vec2& _bbox, TextRange& _textRanges);
+
     struct ScratchBuffer : public alfons::MeshCallback {
         void drawGlyph(const alfons::Quad& q, const alfons::AtlasGlyph& altasGlyph) override {}
         void drawGlyph(const alfons::Rect& q, const alfons::AtlasGlyph& atlasGlyph) override;
         std::vector<GlyphQuad>* quads;
+        // Texture of each alfons atlas, see FontContext::m_atlasSlots
+        const std::vector<int>* atlasSlots;
     };
 
     void addFont(const FontDescription& _ft, alfons::InputSource _source);
 
     void setPixelScale(float _scale);
 
+    /* Use glyph SDFs precomputed in the bundle at _path, so that only glyphs
+     * missing from it are rasterized. Newly rasterized glyphs are added and
+     * the bundle is written back when the FontContext is destroyed. Bundles
+     * are per SDF radius, i.e. pixel scale. */
+    void setGlyphBundle(const std::string& _path);
+
+    bool writeGlyphBundle();
+
+    /* Limit the glyph textures to _count, at most max_textures. Glyphs
+     * that don't fit into them are not drawn. */
+    void setMaxTextures(size_t _count);
+
     void releaseFonts();
 
 private:
 
     static const std::vector<float> s_fontRasterSizes;
 
+    // Maximum number of texts in the shaped text cache
+    static constexpr size_t max_shaped_texts = 4096;
+
+    // Maximum number of texts in the line layout cache
+    static constexpr size_t max_line_layouts = 1024;
+
+    // Glyph quads of layoutText with ranges relative to the first quad
+    struct ShapedText {
+        std::vector<GlyphQuad> quads;
+        TextRange ranges;
+        glm::vec2 size;
+        // Atlases referenced by quads
+        std::bitset<max_textures> atlases;
+    };
+
+    // Key of the text and all parameters used by layoutText. UTF-8 and
+    // UTF-16 texts have distinct keys.
+    std::string shapedTextKey(const TextStyle::Parameters& _params, const char* _text,
+                              size_t _length, bool _utf8) const;
+
+    // Append the cached quads for _key
+    bool findShapedText(const std::string& _key, std::vector<GlyphQuad>& _quads,
+                        std::bitset<max_textures>& _refs, glm::vec2& _bbox,
+                        TextRange& _textRanges);
+
+    // Unwrapped line of _text shaped with _font, with the break
+    // opportunities of each shape. Shapes and caches the line on a miss;
+    // _text is a UTF-8 string when _utf8 is set.
+    const alfons::LineLayout& lineLayout(const std::shared_ptr<alfons::Font>& _font,
+                                         const char* _text, size_t _length, bool _utf8);
+
+    // Add the system font fallbacks that cover the codepoints of _text to
+    // _font, resolved once per codepoint range and font alias. Returns
+    // whether a face was added.
+    bool resolveFallbacks(const std::shared_ptr<alfons::Font>& _font, const icu::UnicodeString& _text);
+
+    // Whether the faces of _font have all codepoints of _probe
+    bool covers(std::shared_ptr<alfons::Font>& _font, const icu::UnicodeString& _probe);
+
+    // Face of the fallback _index at the raster size _sizeIndex, created on first use
+    const std::shared_ptr<alfons::FontFace>& fallbackFace(size_t _index, size_t _sizeIndex);
+
+    // Font that resolves codepoint ranges with fallbacks, of _alias at raster size _sizeIndex
+    void registerFont(const std::shared_ptr<alfons::Font>& _font, const std::string& _alias, size_t _sizeIndex);
+
+    // Wrap, draw and cache _line under _key
+    bool shapeText(TextStyle::Parameters& _params, const alfons::LineLayout& _line,
+                   const std::string& _key, std::vector<GlyphQuad>& _quads,
+                   std::bitset<max_textures>& _refs, glm::vec2& _bbox,
+                   TextRange& _textRanges);
+
+    // Reference the atlases of the quads in _refs and clear unused atlases
+    void addAtlasRefs(std::vector<GlyphQuad>::iterator _begin,
+                      std::vector<GlyphQuad>::iterator _end,
+                      std::bitset<max_textures>& _refs);
+
+    // Clear the glyphs of texture _slot, resets the alfons atlas it holds.
+    // Compacted textures are freed. Requires both mutexes.
+    void clearAtlas(size_t _slot);
+
+    // Free unused atlases, only the ones left by compaction when _compacted is set
+    size_t releaseAtlases(bool _compacted);
+
+    // Glyph of texture _slot that _quad shows, or nullptr. Requires m_textureMutex.
+    GlyphTexture::Glyph* findGlyph(size_t _slot, const GlyphQuad& _quad);
+
+    // Move the quads of moved glyphs, see remapGlyphs(). Requires m_textureMutex.
+    void moveGlyphs(std::vector<GlyphQuad>& _quads, std::bitset<max_textures>& _refs);
+
+    void clearShapedTexts();
+
+    // Drop shaped texts with glyphs in _atlas
+    void clearShapedTexts(size_t _atlas);
+
+    // Glyphs added by addGlyph, synchronized on m_fontMutex. Staged bitmaps
+    // are padded and turned into SDFs by buildGlyphs().
+    struct StagedGlyph {
+        // Texture slot
+        size_t atlas;
+        uint16_t x, y, width, height;
+        size_t offset;
+        // Bundle key of the bitmap
+        uint64_t key;
+        // Clears of the atlas when the glyph was added
+        uint32_t generation;
+        // Whether the pixels are the bitmap, otherwise the SDF from the bundle
+        bool bitmap;
+    };
+
+    // Build the SDFs of the staged glyphs with _fontLock released, then copy
+    // them into their atlas textures and record them in the glyph bundle
+    void buildGlyphs(std::unique_lock<std::mutex>& _fontLock);
+
+    // Copy _glyphs into their atlas textures and mark their rects for upload
+    void commitGlyphs(const std::vector<StagedGlyph>& _glyphs,
+                      const std::vector<unsigned char>& _pixels);
+
+    std::vector<StagedGlyph> m_stagedGlyphs;
+    std::vector<unsigned char> m_stagedPixels;
+
+    // Glyph SDFs by bitmap hash, synchronized on m_fontMutex
+    struct BundleGlyph {
+        size_t offset;
+        uint16_t width, height;
+    };
+    void loadGlyphBundle();
+    bool saveGlyphBundle();
+
+    std::string m_bundlePath;
+    std::unordered_map<uint64_t, BundleGlyph> m_bundleGlyphs;
+    std::vector<unsigned char> m_bundlePixels;
+    bool m_bundleChanged = false;
+
+    // Shaped texts in LRU order and by key, synchronized on m_fontMutex
+    std::list<std::pair<std::string, ShapedText>> m_shapedTexts;
+    std::unordered_map<std::string, decltype(m_shapedTexts)::iterator> m_shapedTextIndex;
+    // Atlases referenced by any shaped text
+    std::bitset<max_textures> m_shapedTextAtlases;
+
+    // Line layouts by font and text in LRU order, synchronized on m_fontMutex.
+    // Texts that are wrapped with other widths reuse their shapes and breaks.
+    std::list<std::pair<std::string, alfons::LineLayout>> m_lineLayouts;
+    std::unordered_map<std::string, decltype(m_lineLayouts)::iterator> m_lineLayoutIndex;
+
     float m_sdfRadius;
     ScratchBuffer m_scratch;
-    std::vector<unsigned char> m_sdfBuffer;
 
     std::mutex m_fontMutex;
     std::mutex m_textureMutex;
 
+    // Compactions pick alfons atlases with less of their area used by live glyphs
+    static constexpr float compaction_max_usage = 0.5f;
+
     std::array<int, max_textures> m_atlasRefCount = {{0}};
+    // Counts the clears of each atlas, changed on m_fontMutex and m_textureMutex.
+    // Glyphs staged before a clear are not copied into the atlas.
+    std::array<uint32_t, max_textures> m_atlasGeneration = {{0}};
     alfons::GlyphAtlas m_atlas;
 
     alfons::FontManager m_alfons;
     std::array<std::shared_ptr<alfons::Font>, 3> m_font;
 
+    // Codepoints per range of fallback resolution
+    static constexpr uint32_t fallback_range_bits = 7;
+    static constexpr int range_covered = -2;
+    static constexpr int range_unresolved = -1;
+
+    // System font fallbacks in the order of the platform. Their faces are
+    // only created and loaded once a text needs them.
+    struct Fallback {
+        alfons::InputSource source;
+        // By raster size
+        std::vector<std::shared_ptr<alfons::FontFace>> faces;
+        // Font of the smallest face, to test the coverage of ranges
+        std::shared_ptr<alfons::Font> probe;
+        // Whether the codepoints seen in a range are covered, by range
+        std::unordered_map<uint32_t, bool> coverage;
+    };
+    std::vector<Fallback> m_fallbacks;
+
+    struct FontAlias {
+        std::string alias;
+        size_t sizeIndex;
+    };
+    std::unordered_map<const alfons::Font*, FontAlias> m_fontAliases;
+
+    // Fallback index by codepoint range and font alias, or range_covered for
+    // ranges of the font faces and range_unresolved for ranges no font covers
+    std::unordered_map<std::string, std::unordered_map<uint32_t, int>> m_fallbackRanges;
+
+    // Textures by slot, the atlas index of glyph quads. Slots of alfons atlases
+    // are reused once their atlas is cleared; compacted textures take free slots.
     std::vector<GlyphTexture> m_textures;
+    size_t m_maxTextures = max_textures;
+
+    // Slot by alfons atlas id, -1 for atlases beyond m_maxTextures
+    std::vector<int> m_atlasSlots;
+
+    std::atomic<uint32_t> m_compactionEpoch{0};
+    GlyphAtlasStats m_atlasStats;
 
     // TextShaper to create <LineLayout> for a given text and Font
     alfons::TextShaper m_shaper;
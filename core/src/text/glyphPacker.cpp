@@ -0,0 +1,48 @@
+#include "text/glyphPacker.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Tangram {
+
+size_t packGlyphs(const std::vector<uint16_t>& _widths, const std::vector<uint16_t>& _heights,
+                  uint16_t _pageSize, std::vector<PackedGlyph>& _out) {
+
+    size_t count = _widths.size();
+    _out.assign(count, { PackedGlyph::none, 0, 0 });
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return _heights[a] > _heights[b];
+    });
+
+    size_t pages = 0;
+    uint32_t x = 0, y = 0, shelfHeight = 0;
+
+    for (uint32_t i : order) {
+        uint32_t width = _widths[i], height = _heights[i];
+        if (width > _pageSize || height > _pageSize) { continue; }
+
+        if (pages == 0) {
+            pages = 1;
+        } else if (x + width > _pageSize) {
+            // Next shelf
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (y + height > _pageSize) {
+            // Next page
+            pages++;
+            x = y = shelfHeight = 0;
+        }
+
+        _out[i] = { uint16_t(pages - 1), uint16_t(x), uint16_t(y) };
+        x += width;
+        shelfHeight = std::max(shelfHeight, height);
+    }
+    return pages;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Tangram {
+
+struct PackedGlyph {
+    static constexpr uint16_t none = 0xffff;
+
+    // Page of the glyph, none when it is larger than a page
+    uint16_t page;
+    uint16_t x, y;
+};
+
+/* Place rects of _widths and _heights on square pages of _pageSize, in
+ * shelves of the rows of equal height. The tallest rects are placed first,
+ * so that each shelf wastes little space above the rects in it.
+ *
+ * _out holds the place of each rect, in the order of _widths. Returns the
+ * number of pages used. */
+size_t packGlyphs(const std::vector<uint16_t>& _widths, const std::vector<uint16_t>& _heights,
+                  uint16_t _pageSize, std::vector<PackedGlyph>& _out);
+
+}
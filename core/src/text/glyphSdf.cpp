@@ -0,0 +1,558 @@
+#include "text/glyphSdf.h"
+
+#define SDF_IMPLEMENTATION
+#include "sdf.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace Tangram {
+
+// Nearest contour points and their squared distances, by pixel
+struct SdfField {
+    float* dist;
+    float* x;
+    float* y;
+    int width;
+};
+
+// Compare pixel _x, _y with its neighbour _kn as sdf.h does: when the
+// distance of _kn is below _limit, take its point if that is closer than _pd
+// by more than the slack
+static inline bool compareNeighbour(const SdfField& _f, int _x, int _y, int _kn, float _limit,
+                                    float& _pd, float& _px, float& _py) {
+    if (_f.dist[_kn] < _limit) {
+        float dx = _f.x[_kn] - float(_x), dy = _f.y[_kn] - float(_y);
+        float d = dx * dx + dy * dy;
+        if (d + SDF_SLACK < _pd) {
+            _px = _f.x[_kn];
+            _py = _f.y[_kn];
+            _pd = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+// (-1,0) of the forward sweep, which sdf.h considers by the distance _pd0
+// the pixel had before the sweep
+static inline bool compareLeft(const SdfField& _f, int _x, int _y, int _k, float _pd0,
+                               float& _pd, float& _px, float& _py) {
+    return compareNeighbour(_f, _x, _y, _k - 1, _pd0, _pd, _px, _py);
+}
+
+static inline void store(const SdfField& _f, int _k, float _pd, float _px, float _py) {
+    _f.dist[_k] = _pd;
+    _f.x[_k] = _px;
+    _f.y[_k] = _py;
+}
+
+// Forward sweep of one pixel: (-1,-1), (0,-1), (1,-1) and (-1,0)
+static bool updateForward(const SdfField& _f, int _x, int _y, int _k) {
+    float pd0 = _f.dist[_k], pd = pd0, px = 0, py = 0;
+    bool ch = false;
+    for (int kn = _k - _f.width - 1; kn <= _k - _f.width + 1; kn++) {
+        ch |= compareNeighbour(_f, _x, _y, kn, pd, pd, px, py);
+    }
+    ch |= compareLeft(_f, _x, _y, _k, pd0, pd, px, py);
+    if (ch) { store(_f, _k, pd, px, py); }
+    return ch;
+}
+
+// Backward sweep of one pixel: (1,0), (-1,1), (0,1) and (1,1)
+static bool updateBackward(const SdfField& _f, int _x, int _y, int _k) {
+    float pd = _f.dist[_k], px = 0, py = 0;
+    bool ch = compareNeighbour(_f, _x, _y, _k + 1, pd, pd, px, py);
+    for (int kn = _k + _f.width - 1; kn <= _k + _f.width + 1; kn++) {
+        ch |= compareNeighbour(_f, _x, _y, kn, pd, pd, px, py);
+    }
+    if (ch) { store(_f, _k, pd, px, py); }
+    return ch;
+}
+
+/* Rows are swept four pixels at a time with _groups. The neighbour in the
+ * row is taken as it was before the sweep updated it, which is exact unless
+ * the sweep changed it. Those pixels are compared again one by one; after
+ * the first pass the field rarely changes and most groups need no scalar
+ * work. */
+
+// Results of a group of four pixels
+struct SdfLanes {
+    // Forward sweep: distance before the sweep, and the pixel after the row above
+    float d0[4], dA[4], xA[4], yA[4];
+    // Pixel after all comparisons
+    float d[4], x[4], y[4];
+};
+
+// Apply the forward sweep of the first _count pixels from _k on. _above and
+// _left are lane masks of the changes by the row above and by the pixel
+// before, _dirty whether the pixel before the group changed in its
+// comparison with its own left neighbour. Returns that for the last pixel.
+static bool commitForward(const SdfField& _f, int _x, int _y, int _k, const SdfLanes& _l, int _count,
+                          int _above, int _left, bool _dirty, bool& _changed) {
+    for (int i = 0; i < _count; i++) {
+        int k = _k + i;
+        float pd = _l.d[i], px = _l.x[i], py = _l.y[i];
+        bool left = (_left >> i) & 1;
+
+        if (_dirty) {
+            pd = _l.dA[i], px = _l.xA[i], py = _l.yA[i];
+            left = compareLeft(_f, _x + i, _y, k, _l.d0[i], pd, px, py);
+        }
+        if (left || ((_above >> i) & 1)) {
+            store(_f, k, pd, px, py);
+            _changed = true;
+        }
+        _dirty = left;
+    }
+    return _dirty;
+}
+
+// Apply the backward sweep of the pixels _first to 3 from _k on, from the
+// last. _changes is the lane mask of changed pixels, _dirty whether the
+// pixel after the group changed. Returns whether the first pixel changed.
+static bool commitBackward(const SdfField& _f, int _x, int _y, int _k, const SdfLanes& _l, int _first,
+                           int _changes, bool _dirty, bool& _changed) {
+    for (int i = 3; i >= _first; i--) {
+        int k = _k + i;
+        bool ch;
+
+        if (_dirty) {
+            ch = updateBackward(_f, _x + i, _y, k);
+        } else {
+            ch = (_changes >> i) & 1;
+            if (ch) { store(_f, k, _l.d[i], _l.x[i], _l.y[i]); }
+        }
+        _changed |= ch;
+        _dirty = ch;
+    }
+    return _dirty;
+}
+
+static bool sweepForward(const SdfField& _f, int _y, bool _groups) {
+    int width = _f.width;
+    int x = 1, k = 1 + _y * width;
+    bool changed = false;
+    bool dirty = false;
+
+#if defined(__SSE2__)
+    const __m128 slack = _mm_set1_ps(SDF_SLACK);
+    const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    const __m128 cy = _mm_set1_ps(float(_y));
+    const __m128 end = _mm_set1_ps(float(width - 1));
+
+    // Pixels before the group, in the first lane
+    __m128 ld = _mm_set1_ps(_f.dist[k - 1]);
+    __m128 lx = _mm_set1_ps(_f.x[k - 1]);
+    __m128 ly = _mm_set1_ps(_f.y[k - 1]);
+
+    for (; _groups && x < width - 1; x += 4, k += 4) {
+        __m128 cx = _mm_add_ps(_mm_set1_ps(float(x)), lanes);
+        // Lanes past the end of the row are not changed
+        __m128 valid = _mm_cmplt_ps(cx, end);
+        __m128 pd0 = _mm_loadu_ps(_f.dist + k);
+        __m128 pd = pd0;
+        __m128 px = _mm_loadu_ps(_f.x + k);
+        __m128 py = _mm_loadu_ps(_f.y + k);
+        __m128 above = _mm_setzero_ps();
+
+        // (-1,-1), (0,-1) and (1,-1)
+        for (int kn = k - width - 1; kn <= k - width + 1; kn++) {
+            __m128 nx = _mm_loadu_ps(_f.x + kn);
+            __m128 ny = _mm_loadu_ps(_f.y + kn);
+            __m128 dx = _mm_sub_ps(nx, cx);
+            __m128 dy = _mm_sub_ps(ny, cy);
+            __m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            __m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(_f.dist + kn), pd),
+                                  _mm_cmplt_ps(_mm_add_ps(d, slack), pd));
+            m = _mm_and_ps(m, valid);
+            pd = _mm_or_ps(_mm_and_ps(m, d), _mm_andnot_ps(m, pd));
+            px = _mm_or_ps(_mm_and_ps(m, nx), _mm_andnot_ps(m, px));
+            py = _mm_or_ps(_mm_and_ps(m, ny), _mm_andnot_ps(m, py));
+            above = _mm_or_ps(above, m);
+        }
+
+        // (-1,0) with the pixels before in their state after the row above
+        __m128 sd = _mm_shuffle_ps(pd, pd, _MM_SHUFFLE(2, 1, 0, 3));
+        __m128 sx = _mm_shuffle_ps(px, px, _MM_SHUFFLE(2, 1, 0, 3));
+        __m128 sy = _mm_shuffle_ps(py, py, _MM_SHUFFLE(2, 1, 0, 3));
+        __m128 nd = _mm_move_ss(sd, ld);
+        __m128 nx = _mm_move_ss(sx, lx);
+        __m128 ny = _mm_move_ss(sy, ly);
+        ld = sd;
+        lx = sx;
+        ly = sy;
+
+        __m128 dx = _mm_sub_ps(nx, cx);
+        __m128 dy = _mm_sub_ps(ny, cy);
+        __m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 left = _mm_and_ps(_mm_cmplt_ps(nd, pd0), _mm_cmplt_ps(_mm_add_ps(d, slack), pd));
+        left = _mm_and_ps(left, valid);
+
+        int aboveMask = _mm_movemask_ps(above);
+        int leftMask = _mm_movemask_ps(left);
+        if ((aboveMask | leftMask) == 0 && !dirty) { continue; }
+
+        SdfLanes l;
+        _mm_storeu_ps(l.d0, pd0);
+        _mm_storeu_ps(l.dA, pd);
+        _mm_storeu_ps(l.xA, px);
+        _mm_storeu_ps(l.yA, py);
+        _mm_storeu_ps(l.d, _mm_or_ps(_mm_and_ps(left, d), _mm_andnot_ps(left, pd)));
+        _mm_storeu_ps(l.x, _mm_or_ps(_mm_and_ps(left, nx), _mm_andnot_ps(left, px)));
+        _mm_storeu_ps(l.y, _mm_or_ps(_mm_and_ps(left, ny), _mm_andnot_ps(left, py)));
+
+        dirty = commitForward(_f, x, _y, k, l, std::min(width - 1 - x, 4),
+                              aboveMask, leftMask, dirty, changed);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t slack = vdupq_n_f32(SDF_SLACK);
+    const float32x4_t lanes = { 0.f, 1.f, 2.f, 3.f };
+    const float32x4_t cy = vdupq_n_f32(float(_y));
+    const float32x4_t end = vdupq_n_f32(float(width - 1));
+    const uint32x4_t bits = { 1, 2, 4, 8 };
+
+    // Pixels before the group, in the last lane
+    float32x4_t ld = vdupq_n_f32(_f.dist[k - 1]);
+    float32x4_t lx = vdupq_n_f32(_f.x[k - 1]);
+    float32x4_t ly = vdupq_n_f32(_f.y[k - 1]);
+
+    for (; _groups && x < width - 1; x += 4, k += 4) {
+        float32x4_t cx = vaddq_f32(vdupq_n_f32(float(x)), lanes);
+        // Lanes past the end of the row are not changed
+        uint32x4_t valid = vcltq_f32(cx, end);
+        float32x4_t pd0 = vld1q_f32(_f.dist + k);
+        float32x4_t pd = pd0;
+        float32x4_t px = vld1q_f32(_f.x + k);
+        float32x4_t py = vld1q_f32(_f.y + k);
+        uint32x4_t above = vdupq_n_u32(0);
+
+        // (-1,-1), (0,-1) and (1,-1)
+        for (int kn = k - width - 1; kn <= k - width + 1; kn++) {
+            float32x4_t nx = vld1q_f32(_f.x + kn);
+            float32x4_t ny = vld1q_f32(_f.y + kn);
+            float32x4_t dx = vsubq_f32(nx, cx);
+            float32x4_t dy = vsubq_f32(ny, cy);
+            // Separate multiplies and adds, a fused multiply-add would round differently
+            float32x4_t d = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+
+            uint32x4_t m = vandq_u32(vcltq_f32(vld1q_f32(_f.dist + kn), pd),
+                                     vcltq_f32(vaddq_f32(d, slack), pd));
+            m = vandq_u32(m, valid);
+            pd = vbslq_f32(m, d, pd);
+            px = vbslq_f32(m, nx, px);
+            py = vbslq_f32(m, ny, py);
+            above = vorrq_u32(above, m);
+        }
+
+        // (-1,0) with the pixels before in their state after the row above
+        float32x4_t nd = vextq_f32(ld, pd, 3);
+        float32x4_t nx = vextq_f32(lx, px, 3);
+        float32x4_t ny = vextq_f32(ly, py, 3);
+        ld = pd;
+        lx = px;
+        ly = py;
+
+        float32x4_t dx = vsubq_f32(nx, cx);
+        float32x4_t dy = vsubq_f32(ny, cy);
+        float32x4_t d = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+        uint32x4_t left = vandq_u32(vcltq_f32(nd, pd0), vcltq_f32(vaddq_f32(d, slack), pd));
+        left = vandq_u32(left, valid);
+
+        int aboveMask = vaddvq_u32(vandq_u32(above, bits));
+        int leftMask = vaddvq_u32(vandq_u32(left, bits));
+        if ((aboveMask | leftMask) == 0 && !dirty) { continue; }
+
+        SdfLanes l;
+        vst1q_f32(l.d0, pd0);
+        vst1q_f32(l.dA, pd);
+        vst1q_f32(l.xA, px);
+        vst1q_f32(l.yA, py);
+        vst1q_f32(l.d, vbslq_f32(left, d, pd));
+        vst1q_f32(l.x, vbslq_f32(left, nx, px));
+        vst1q_f32(l.y, vbslq_f32(left, ny, py));
+
+        dirty = commitForward(_f, x, _y, k, l, std::min(width - 1 - x, 4),
+                              aboveMask, leftMask, dirty, changed);
+    }
+#endif
+
+    for (; x < width - 1; x++, k++) {
+        changed |= updateForward(_f, x, _y, k);
+    }
+    return changed;
+}
+
+static bool sweepBackward(const SdfField& _f, int _y, bool _groups) {
+    int width = _f.width;
+    // First pixel of the group
+    int x = width - 5, k = x + _y * width;
+    bool changed = false;
+    bool dirty = false;
+
+#if defined(__SSE2__)
+    const __m128 slack = _mm_set1_ps(SDF_SLACK);
+    const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    const __m128 cy = _mm_set1_ps(float(_y));
+    const __m128 start = _mm_set1_ps(1.f);
+
+    for (; _groups && x > -3; x -= 4, k -= 4) {
+        __m128 cx = _mm_add_ps(_mm_set1_ps(float(x)), lanes);
+        // Lanes before the start of the row are not changed
+        __m128 valid = _mm_cmpge_ps(cx, start);
+        __m128 pd = _mm_loadu_ps(_f.dist + k);
+        __m128 px = _mm_setzero_ps(), py = _mm_setzero_ps(), changes = _mm_setzero_ps();
+
+        // (1,0) with the pixels after as they were before the sweep, which
+        // those that changed are not, then (-1,1), (0,1) and (1,1)
+        for (int kn : { k + 1, k + width - 1, k + width, k + width + 1 }) {
+            __m128 nx = _mm_loadu_ps(_f.x + kn);
+            __m128 ny = _mm_loadu_ps(_f.y + kn);
+            __m128 dx = _mm_sub_ps(nx, cx);
+            __m128 dy = _mm_sub_ps(ny, cy);
+            __m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            __m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(_f.dist + kn), pd),
+                                  _mm_cmplt_ps(_mm_add_ps(d, slack), pd));
+            m = _mm_and_ps(m, valid);
+            pd = _mm_or_ps(_mm_and_ps(m, d), _mm_andnot_ps(m, pd));
+            px = _mm_or_ps(_mm_and_ps(m, nx), _mm_andnot_ps(m, px));
+            py = _mm_or_ps(_mm_and_ps(m, ny), _mm_andnot_ps(m, py));
+            changes = _mm_or_ps(changes, m);
+        }
+
+        int changeMask = _mm_movemask_ps(changes);
+        if (changeMask == 0 && !dirty) { continue; }
+
+        SdfLanes l;
+        _mm_storeu_ps(l.d, pd);
+        _mm_storeu_ps(l.x, px);
+        _mm_storeu_ps(l.y, py);
+
+        dirty = commitBackward(_f, x, _y, k, l, std::max(1 - x, 0), changeMask, dirty, changed);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t slack = vdupq_n_f32(SDF_SLACK);
+    const float32x4_t lanes = { 0.f, 1.f, 2.f, 3.f };
+    const float32x4_t cy = vdupq_n_f32(float(_y));
+    const float32x4_t start = vdupq_n_f32(1.f);
+    const uint32x4_t bits = { 1, 2, 4, 8 };
+
+    for (; _groups && x > -3; x -= 4, k -= 4) {
+        float32x4_t cx = vaddq_f32(vdupq_n_f32(float(x)), lanes);
+        // Lanes before the start of the row are not changed
+        uint32x4_t valid = vcgeq_f32(cx, start);
+        float32x4_t pd = vld1q_f32(_f.dist + k);
+        float32x4_t px = vdupq_n_f32(0.f), py = vdupq_n_f32(0.f);
+        uint32x4_t changes = vdupq_n_u32(0);
+
+        // (1,0) with the pixels after as they were before the sweep, which
+        // those that changed are not, then (-1,1), (0,1) and (1,1)
+        for (int kn : { k + 1, k + width - 1, k + width, k + width + 1 }) {
+            float32x4_t nx = vld1q_f32(_f.x + kn);
+            float32x4_t ny = vld1q_f32(_f.y + kn);
+            float32x4_t dx = vsubq_f32(nx, cx);
+            float32x4_t dy = vsubq_f32(ny, cy);
+            float32x4_t d = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+
+            uint32x4_t m = vandq_u32(vcltq_f32(vld1q_f32(_f.dist + kn), pd),
+                                     vcltq_f32(vaddq_f32(d, slack), pd));
+            m = vandq_u32(m, valid);
+            pd = vbslq_f32(m, d, pd);
+            px = vbslq_f32(m, nx, px);
+            py = vbslq_f32(m, ny, py);
+            changes = vorrq_u32(changes, m);
+        }
+
+        int changeMask = vaddvq_u32(vandq_u32(changes, bits));
+        if (changeMask == 0 && !dirty) { continue; }
+
+        SdfLanes l;
+        vst1q_f32(l.d, pd);
+        vst1q_f32(l.x, px);
+        vst1q_f32(l.y, py);
+
+        dirty = commitBackward(_f, x, _y, k, l, std::max(1 - x, 0), changeMask, dirty, changed);
+    }
+#endif
+
+    // Pixels left of the last group
+    for (x += 3, k += 3; x > 0; x--, k--) {
+        changed |= updateBackward(_f, x, _y, k);
+    }
+    return changed;
+}
+
+// Map the distances of row _y to bytes, as the last step of sdf.h
+static void mapRow(const SdfField& _f, int _y, float _scale, const unsigned char* _img,
+                   unsigned char* _out) {
+    int width = _f.width;
+    const float* dist = _f.dist + _y * width;
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(_scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 max = _mm_set1_ps(255.f);
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128i inside = _mm_set1_epi32(127);
+    const __m128i zeroi = _mm_setzero_si128();
+
+    for (; x + 4 <= width; x += 4) {
+        __m128 d = _mm_mul_ps(_mm_sqrt_ps(_mm_loadu_ps(dist + x)), scale);
+
+        int32_t bytes;
+        std::memcpy(&bytes, _img + x, sizeof(bytes));
+        __m128i img = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zeroi), zeroi);
+        __m128 negate = _mm_castsi128_ps(_mm_cmpgt_epi32(img, inside));
+        d = _mm_xor_ps(d, _mm_and_ps(negate, sign));
+
+        __m128 v = _mm_sub_ps(half, _mm_mul_ps(d, half));
+        v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), max);
+
+        __m128i out = _mm_cvttps_epi32(v);
+        out = _mm_packus_epi16(_mm_packs_epi32(out, zeroi), zeroi);
+        bytes = _mm_cvtsi128_si32(out);
+        std::memcpy(_out + x, &bytes, sizeof(bytes));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(_scale);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    const float32x4_t one = vdupq_n_f32(1.f);
+    const float32x4_t max = vdupq_n_f32(255.f);
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t img = vmovl_u8(vld1_u8(_img + x));
+        uint32x4_t img0 = vmovl_u16(vget_low_u16(img));
+        uint32x4_t img1 = vmovl_u16(vget_high_u16(img));
+
+        uint32x4_t out[2];
+        for (int i = 0; i < 2; i++) {
+            float32x4_t d = vmulq_f32(vsqrtq_f32(vld1q_f32(dist + x + i * 4)), scale);
+            d = vbslq_f32(vcgtq_u32(i == 0 ? img0 : img1, vdupq_n_u32(127)), vnegq_f32(d), d);
+
+            float32x4_t v = vsubq_f32(half, vmulq_f32(d, half));
+            v = vmulq_f32(vminq_f32(vmaxq_f32(v, zero), one), max);
+            out[i] = vcvtq_u32_f32(v);
+        }
+        uint16x8_t packed = vcombine_u16(vmovn_u32(out[0]), vmovn_u32(out[1]));
+        vst1_u8(_out + x, vmovn_u16(packed));
+    }
+#endif
+
+    for (; x < width; x++) {
+        float d = sqrtf(dist[x]) * _scale;
+        if (_img[x] > 127) { d = -d; }
+        _out[x] = (unsigned char)(sdf__clamp01(0.5f - d * 0.5f) * 255.0f);
+    }
+}
+
+void buildGlyphSdf(unsigned char* _out, int _outStride, float _radius,
+                   const unsigned char* _img, int _width, int _height, int _stride,
+                   GlyphSdfScratch& _scratch) {
+
+    size_t size = size_t(_width) * _height;
+    _scratch.field.resize(size * 3);
+    _scratch.rows.assign(size_t(_height) * 3, 0);
+
+    float* field = _scratch.field.data();
+    SdfField f{ field, field + size, field + size * 2, _width };
+
+    // Row sweeps read the row and the one before in the sweep direction only;
+    // rows that are unchanged since they were last swept without a change
+    // would not change again. Sweep counter at the last change of each row,
+    // and at the last forward and backward sweep that left it unchanged.
+    int* rowChanged = _scratch.rows.data();
+    int* forwardClean = rowChanged + _height;
+    int* backwardClean = forwardClean + _height;
+    int sweep = 0;
+
+    std::fill(f.dist, f.dist + size, SDF_BIG);
+    std::fill(f.x, f.x + size * 2, 0.f);
+
+    // Position of the anti-aliased pixels and distance to the boundary of the
+    // shape, as in sdfBuildDistanceFieldNoAlloc()
+    for (int y = 1; y < _height - 1; y++) {
+        for (int x = 1; x < _width - 1; x++) {
+            int k = x + y * _stride;
+
+            if (_img[k] == 255) { continue; }
+            if (_img[k] == 0) {
+                int he = _img[k - 1] == 255 || _img[k + 1] == 255;
+                int ve = _img[k - _stride] == 255 || _img[k + _stride] == 255;
+                if (!he && !ve) { continue; }
+            }
+
+            float gx = -(float)_img[k - _stride - 1] - SDF_SQRT2 * (float)_img[k - 1] - (float)_img[k + _stride - 1] + (float)_img[k - _stride + 1] + SDF_SQRT2 * (float)_img[k + 1] + (float)_img[k + _stride + 1];
+            float gy = -(float)_img[k - _stride - 1] - SDF_SQRT2 * (float)_img[k - _stride] - (float)_img[k - _stride + 1] + (float)_img[k + _stride - 1] + SDF_SQRT2 * (float)_img[k + _stride] + (float)_img[k + _stride + 1];
+            if (fabsf(gx) < 0.001f && fabsf(gy) < 0.001f) { continue; }
+
+            float glen = gx * gx + gy * gy;
+            if (glen > 0.0001f) {
+                glen = 1.0f / sqrtf(glen);
+                gx *= glen;
+                gy *= glen;
+            }
+
+            int tk = x + y * _width;
+            SDFpoint c = { (float)x, (float)y };
+            float d = sdf__edgedf(gx, gy, (float)_img[k] / 255.0f);
+            SDFpoint p = { x + gx * d, y + gy * d };
+            f.x[tk] = p.x;
+            f.y[tk] = p.y;
+            f.dist[tk] = sdf__distsqr(&c, &p);
+        }
+    }
+
+    for (int pass = 0; pass < SDF_MAX_PASSES; pass++) {
+        bool changed = false;
+        // Most pixels change in the first pass, their groups would mostly
+        // be compared again one by one
+        bool groups = pass > 0;
+
+        // Bottom-left to top-right
+        for (int y = 1; y < _height - 1; y++) {
+            if (forwardClean[y] > rowChanged[y] && forwardClean[y] > rowChanged[y - 1]) { continue; }
+
+            sweep++;
+            if (sweepForward(f, y, groups)) {
+                rowChanged[y] = sweep;
+                changed = true;
+            } else {
+                forwardClean[y] = sweep;
+            }
+        }
+        // Top-right to bottom-left
+        for (int y = _height - 2; y > 0; y--) {
+            if (backwardClean[y] > rowChanged[y] && backwardClean[y] > rowChanged[y + 1]) { continue; }
+
+            sweep++;
+            if (sweepBackward(f, y, groups)) {
+                rowChanged[y] = sweep;
+                changed = true;
+            } else {
+                backwardClean[y] = sweep;
+            }
+        }
+
+        if (!changed) { break; }
+    }
+
+    float scale = 1.0f / _radius;
+    for (int y = 0; y < _height; y++) {
+        mapRow(f, y, scale, _img + y * _stride, _out + y * _outStride);
+    }
+}
+
+}
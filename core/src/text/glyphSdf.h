@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+namespace Tangram {
+
+// Buffers of buildGlyphSdf(), resized as needed and kept for the next glyph
+struct GlyphSdfScratch {
+    std::vector<float> field;
+    std::vector<int> rows;
+};
+
+/* Signed distance field of a glyph bitmap, the same as the
+ * sdfBuildDistanceFieldNoAlloc() of sdf.h computes.
+ *
+ * The sweeps of the distance transform compare each pixel with three pixels
+ * of the previous row and with its neighbour in the row. Groups of four
+ * pixels are compared at once with SSE2 or NEON, taking the neighbours in
+ * the row as they were before the sweep; only pixels after one that changed
+ * are compared again one by one. Rows whose inputs did not change since
+ * their last sweep are skipped, and the mapping to bytes is vectorized.
+ *
+ * _out and _img may be the same buffer. */
+void buildGlyphSdf(unsigned char* _out, int _outStride, float _radius,
+                   const unsigned char* _img, int _width, int _height, int _stride,
+                   GlyphSdfScratch& _scratch);
+
+}
@@ -63,6 +63,40 @@ void TextWrapper::clearWraps() {
     m_lineWraps.clear();
 }
 
+void TextWrapper::wrapLine(alfons::LineLayout& _line, uint32_t _minChars, uint32_t _maxChars) {
+
+    auto& shapes = _line.shapes();
+
+    uint32_t charCount = 0;
+    // Last shape after which the current line may break
+    size_t lastBreak = shapes.size();
+    uint32_t lastBreakChars = 0;
+
+    for (size_t i = 0; i < shapes.size(); i++) {
+        auto& shape = shapes[i];
+
+        // Shapes of a glyph cluster count as one character
+        if (shape.cluster || i == 0) { charCount++; }
+
+        if (shape.mustBreak) {
+            charCount = 0;
+            lastBreak = shapes.size();
+            continue;
+        }
+
+        if (charCount > _maxChars && lastBreak < shapes.size() && lastBreakChars >= _minChars) {
+            shapes[lastBreak].mustBreak = true;
+            charCount -= lastBreakChars;
+            lastBreak = shapes.size();
+        }
+
+        if (shape.canBreak) {
+            lastBreak = i;
+            lastBreakChars = charCount;
+        }
+    }
+}
+
 int TextWrapper::draw(alfons::TextBatch& _batch, float _maxWidth, const alfons::LineLayout& _line,
                       TextLabelProperty::Align _alignment, float _lineSpacing,
                       alfons::LineMetrics& _layoutMetrics) {
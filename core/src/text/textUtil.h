@@ -17,6 +17,11 @@ public:
 
     void clearWraps();
 
+    /* Set mustBreak on the break opportunities of _line so that its lines
+     * have at most _maxChars characters where possible, and none is broken
+     * before _minChars. Lines ended by mustBreak are kept. */
+    static void wrapLine(alfons::LineLayout& _line, uint32_t _minChars, uint32_t _maxChars);
+
     /* Wrap an Alfons line layout, and draw the glyph quads to the TextBatch.
      *
      * This method is not threadsafe!
@@ -0,0 +1,57 @@
+#include "tile/buildCost.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+static void add(std::map<std::string, BuildCost>& _totals, const std::vector<BuildCost>& _costs) {
+    for (auto& cost : _costs) {
+        if (cost.name.empty() || (cost.features == 0 && cost.milliseconds == 0 && cost.culled == 0)) { continue; }
+
+        auto& total = _totals[cost.name];
+        total.name = cost.name;
+        total.milliseconds += cost.milliseconds;
+        total.features += cost.features;
+        total.matched += cost.matched;
+        total.vertices += cost.vertices;
+        total.bytes += cost.bytes;
+        total.culled += cost.culled;
+    }
+}
+
+static std::vector<BuildCost> sorted(const std::map<std::string, BuildCost>& _totals) {
+    std::vector<BuildCost> result;
+    result.reserve(_totals.size());
+    for (auto& entry : _totals) { result.push_back(entry.second); }
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+            return a.milliseconds > b.milliseconds;
+        });
+    return result;
+}
+
+void BuildCostAccounting::merge(const Tally& _tally) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    add(m_layers, _tally.layers);
+    add(m_styles, _tally.styles);
+    m_tiles++;
+}
+
+BuildCostStats BuildCostAccounting::stats(bool _reset) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    BuildCostStats stats;
+    stats.layers = sorted(m_layers);
+    stats.styles = sorted(m_styles);
+    stats.tiles = m_tiles;
+
+    if (_reset) {
+        m_layers.clear();
+        m_styles.clear();
+        m_tiles = 0;
+    }
+    return stats;
+}
+
+}
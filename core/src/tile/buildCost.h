@@ -0,0 +1,47 @@
+#pragma once
+
+#include "map.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Tangram {
+
+/* Session totals of the build costs of data layers and styles
+ *
+ * TileBuilders count the costs of one tile locally and merge them here once
+ * per tile, so the workers only contend for the lock at the end of a build.
+ */
+class BuildCostAccounting {
+
+public:
+
+    // Costs of one tile, indexed like Scene::layers() and by Style id
+    struct Tally {
+        std::vector<BuildCost> layers;
+        std::vector<BuildCost> styles;
+    };
+
+    void setEnabled(bool _enabled) { m_enabled = _enabled; }
+    bool enabled() const { return m_enabled; }
+
+    // Adds the named entries of _tally to the totals
+    void merge(const Tally& _tally);
+
+    // Totals sorted by time, most expensive first
+    BuildCostStats stats(bool _reset = false);
+
+private:
+
+    std::atomic<bool> m_enabled{false};
+
+    std::mutex m_mutex;
+    std::map<std::string, BuildCost> m_layers;
+    std::map<std::string, BuildCost> m_styles;
+    uint64_t m_tiles = 0;
+};
+
+}
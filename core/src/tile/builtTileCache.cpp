@@ -0,0 +1,422 @@
+#include "tile/builtTileCache.h"
+
+#include "data/tileSource.h"
+#include "gl/mesh.h"
+#include "labels/labelLayout.h"
+#include "scene/scene.h"
+#include "style/style.h"
+#include "tile/tile.h"
+#include "util/byteBuffer.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <vector>
+
+namespace Tangram {
+
+static const char MAGIC[] = { 'T', 'G', 'B', 'T' };
+static const char LABELS_MAGIC[] = { 'T', 'G', 'B', 'L' };
+static const char MESH_TILE_MAGIC[] = { 'T', 'G', 'M', 'T' };
+
+static void putU32(std::vector<char>& _out, uint32_t _value) {
+    auto bytes = reinterpret_cast<const char*>(&_value);
+    _out.insert(_out.end(), bytes, bytes + sizeof(_value));
+}
+
+static void putString(std::vector<char>& _out, const std::string& _value) {
+    putU32(_out, _value.size());
+    _out.insert(_out.end(), _value.begin(), _value.end());
+}
+
+static bool getU32(const char*& _pos, const char* _end, uint32_t& _value) {
+    if (size_t(_end - _pos) < sizeof(_value)) { return false; }
+    std::memcpy(&_value, _pos, sizeof(_value));
+    _pos += sizeof(_value);
+    return true;
+}
+
+static bool getString(const char*& _pos, const char* _end, std::string& _value) {
+    uint32_t size = 0;
+    if (!getU32(_pos, _end, size) || size_t(_end - _pos) < size) { return false; }
+    _value.assign(_pos, size);
+    _pos += size;
+    return true;
+}
+
+// Mesh restored from the compiled geometry of a Mesh<T>. The vertex type is
+// only needed to build and update vertices, the restored mesh draws from the
+// bytes of its vertex layout.
+class CachedMesh : public StyledMesh, protected MeshBase {
+public:
+
+    CachedMesh(std::shared_ptr<VertexLayout> _vertexLayout, GLenum _drawMode)
+        : MeshBase(_vertexLayout, _drawMode) {}
+
+    bool read(const char*& _pos, const char* _end) { return MeshBase::deserialize(_pos, _end); }
+
+    size_t bufferSize() const override { return MeshBase::bufferSize(); }
+
+    size_t vertexCount() const override { return m_nVertices; }
+
+    bool draw(RenderState& rs, ShaderProgram& shader, bool useVao = true) override {
+        return MeshBase::draw(rs, shader, useVao);
+    }
+
+    bool drawVisible(RenderState& rs, ShaderProgram& shader, const glm::mat4& _tileToClip) override {
+        return MeshBase::draw(rs, shader, true, &_tileToClip);
+    }
+
+    bool isUploaded() const override {
+        return m_isUploaded || !m_isCompiled || m_nVertices == 0;
+    }
+
+    size_t uploadBuffers(RenderState& rs) override {
+        if (isUploaded()) { return 0; }
+
+        size_t bytes = bufferSize();
+        MeshBase::upload(rs);
+        return bytes;
+    }
+
+    size_t releaseBuffers(RenderState& rs) override {
+        return MeshBase::releaseBuffers(rs);
+    }
+
+    bool isReleased() const override {
+        return m_isReleased;
+    }
+
+    bool serialize(std::vector<char>& _out) const override {
+        return MeshBase::serialize(_out);
+    }
+};
+
+// Append the meshes of _tile, with the digest of their style when _styleKeys
+static bool writeMeshes(std::vector<char>& _out, const Tile& _tile, const Scene& _scene, bool _styleKeys,
+                        uint32_t* _skipped) {
+
+    uint32_t meshes = 0;
+    size_t countPos = _out.size();
+    putU32(_out, 0);
+
+    for (auto& style : _scene.styles()) {
+        auto& mesh = _tile.getMesh(*style);
+        if (!mesh) { continue; }
+
+        size_t start = _out.size();
+        putString(_out, style->getName());
+        if (_styleKeys) {
+            auto key = _scene.fingerprint().styles.find(style->getName());
+            if (key == _scene.fingerprint().styles.end()) { return false; }
+            putString(_out, key->second);
+        }
+        // e.g. a LabelSet
+        if (!mesh->serialize(_out)) {
+            if (!_skipped) { return false; }
+            _out.resize(start);
+            (*_skipped)++;
+            continue;
+        }
+        meshes++;
+    }
+    std::memcpy(&_out[countPos], &meshes, sizeof(meshes));
+    return true;
+}
+
+static bool readMeshes(const char*& _pos, const char* _end, Tile& _tile, const Scene& _scene, bool _styleKeys) {
+
+    uint32_t meshes = 0;
+    if (!getU32(_pos, _end, meshes)) { return false; }
+
+    auto& styles = _scene.styles();
+    _tile.initGeometry(styles.size());
+
+    for (uint32_t i = 0; i < meshes; i++) {
+        std::string name, key;
+        if (!getString(_pos, _end, name)) { return false; }
+
+        auto style = std::find_if(styles.begin(), styles.end(),
+                                  [&](auto& s) { return s->getName() == name; });
+        if (style == styles.end()) { return false; }
+
+        if (_styleKeys) {
+            auto digest = _scene.fingerprint().styles.find(name);
+            if (!getString(_pos, _end, key) || digest == _scene.fingerprint().styles.end() ||
+                digest->second != key) {
+                return false;
+            }
+        }
+
+        auto mesh = std::make_unique<CachedMesh>((*style)->vertexLayout(), (*style)->drawMode());
+        if (!mesh->read(_pos, _end)) { return false; }
+
+        _tile.setMesh(**style, std::move(mesh));
+    }
+    return true;
+}
+
+BuiltTileCache::BuiltTileCache(std::string _directory, size_t _maxSize)
+    : m_directory(std::move(_directory)),
+      m_maxSize(_maxSize) {
+
+    openDirectory();
+}
+
+std::string BuiltTileCache::fileName(const TileID& _tileId, const char* _suffix) const {
+    return std::to_string(_tileId.z) + "-" + std::to_string(_tileId.x) + "-" +
+        std::to_string(_tileId.y) + "-" + std::to_string(_tileId.s) + "." + _suffix;
+}
+
+std::string BuiltTileCache::tilePath(const TileID& _tileId) const {
+    return m_directory + "/" + fileName(_tileId, "built");
+}
+
+void BuiltTileCache::openDirectory() {
+
+    if (mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOGE("Unable to create built tile cache directory: %s", m_directory.c_str());
+        return;
+    }
+
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) { return; }
+
+    // Oldest files are evicted first
+    std::vector<std::tuple<time_t, std::string, uint64_t>> files;
+    while (dirent* entry = readdir(dir)) {
+        int z, x, y, s;
+        char suffix[8] = {};
+        if (sscanf(entry->d_name, "%d-%d-%d-%d.%7s", &z, &x, &y, &s, suffix) != 5 ||
+            (strcmp(suffix, "built") != 0 && strcmp(suffix, "labels") != 0)) {
+            continue;
+        }
+        struct stat info;
+        std::string path = m_directory + "/" + entry->d_name;
+        if (stat(path.c_str(), &info) != 0) { continue; }
+        files.emplace_back(info.st_mtime, entry->d_name, info.st_size);
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end(), [](auto& a, auto& b) { return std::get<0>(a) < std::get<0>(b); });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& file : files) { insert(std::get<1>(file), std::get<2>(file)); }
+
+    LOG("Built tile cache opened: %s, %d files", m_directory.c_str(), int(m_index.size()));
+}
+
+bool BuiltTileCache::has(const TileID& _tileId) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.count(fileName(_tileId, "built")) > 0;
+}
+
+void BuiltTileCache::insert(const std::string& _name, uint64_t _size) {
+
+    auto entry = m_index.emplace(_name, _size);
+    if (entry.second) {
+        m_order.push_back(_name);
+    } else {
+        m_usage -= entry.first->second;
+        entry.first->second = _size;
+    }
+    m_usage += _size;
+
+    while (m_usage > m_maxSize && m_order.size() > 1) {
+        std::string name = m_order.front();
+        m_order.pop_front();
+
+        auto it = m_index.find(name);
+        if (it == m_index.end()) { continue; }
+        m_usage -= it->second;
+        m_index.erase(it);
+        ::remove((m_directory + "/" + name).c_str());
+    }
+}
+
+void BuiltTileCache::remove(const TileID& _tileId) {
+    remove(fileName(_tileId, "built"));
+}
+
+void BuiltTileCache::remove(const std::string& _name) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(_name);
+    if (it == m_index.end()) { return; }
+
+    m_usage -= it->second;
+    m_index.erase(it);
+    auto order = std::find(m_order.begin(), m_order.end(), _name);
+    if (order != m_order.end()) { m_order.erase(order); }
+    ::remove((m_directory + "/" + _name).c_str());
+}
+
+void BuiltTileCache::writeHeader(std::vector<char>& _out, const char* _magic, const Scene& _scene) const {
+    _out.insert(_out.end(), _magic, _magic + sizeof(MAGIC));
+    putU32(_out, VERSION);
+    putString(_out, m_sceneKey);
+    float pixelScale = _scene.pixelScale();
+    _out.insert(_out.end(), (const char*)&pixelScale, (const char*)&pixelScale + sizeof(pixelScale));
+}
+
+bool BuiltTileCache::readHeader(const char*& _pos, const char* _end, const char* _magic,
+                                const Scene& _scene) const {
+
+    uint32_t version = 0;
+    std::string sceneKey;
+    float pixelScale = 0;
+
+    if (size_t(_end - _pos) < sizeof(MAGIC) || std::memcmp(_pos, _magic, sizeof(MAGIC)) != 0) { return false; }
+    _pos += sizeof(MAGIC);
+
+    if (!getU32(_pos, _end, version) || version != VERSION ||
+        !getString(_pos, _end, sceneKey) || sceneKey != m_sceneKey ||
+        size_t(_end - _pos) < sizeof(pixelScale)) {
+        return false;
+    }
+    std::memcpy(&pixelScale, _pos, sizeof(pixelScale));
+    _pos += sizeof(pixelScale);
+
+    return pixelScale == _scene.pixelScale();
+}
+
+bool BuiltTileCache::write(const std::string& _name, const std::vector<char>& _data) {
+
+    // Write to a temporary file and rename, so that readers never see
+    // partially written files. Workers may store the same tile at once.
+    std::string path = m_directory + "/" + _name;
+    std::string tmpPath = path + "." + std::to_string(m_writes++) + ".tmp";
+
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) { return false; }
+
+    bool ok = fwrite(_data.data(), 1, _data.size(), file) == _data.size();
+    ok &= (fclose(file) == 0);
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOGW("Unable to write built tile: %s", path.c_str());
+        ::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert(_name, _data.size());
+    return true;
+}
+
+bool BuiltTileCache::store(const Tile& _tile, const Scene& _scene) {
+
+    if (m_sceneKey.empty() || !_tile.rasters().empty() || _tile.getSelectionFeatures().size() > 0 ||
+        _tile.getFeatureIndex()) {
+        return false;
+    }
+
+    std::vector<char> data;
+    writeHeader(data, MAGIC, _scene);
+
+    if (!writeMeshes(data, _tile, _scene, false, nullptr)) { return false; }
+
+    return write(fileName(_tile.getID(), "built"), data);
+}
+
+bool BuiltTileCache::storeLabelLayout(const TileID& _tileId, const Scene& _scene, const LabelLayout& _layout) {
+
+    if (m_sceneKey.empty()) { return false; }
+
+    std::vector<char> data;
+    writeHeader(data, LABELS_MAGIC, _scene);
+
+    auto signature = reinterpret_cast<const char*>(&_layout.signature);
+    data.insert(data.end(), signature, signature + sizeof(_layout.signature));
+    putU32(data, _layout.placements.size());
+    data.insert(data.end(), _layout.placements.begin(), _layout.placements.end());
+
+    return write(fileName(_tileId, "labels"), data);
+}
+
+bool BuiltTileCache::loadLabelLayout(const TileID& _tileId, const Scene& _scene, LabelLayout& _layout) {
+
+    std::string name = fileName(_tileId, "labels");
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_index.count(name) == 0) { return false; }
+    }
+
+    ByteBuffer data = ByteBuffer::mapFile(m_directory + "/" + name);
+    if (data.empty()) { return false; }
+
+    const char* pos = data.data();
+    const char* end = pos + data.size();
+    uint32_t count = 0;
+
+    if (!readHeader(pos, end, LABELS_MAGIC, _scene) || size_t(end - pos) < sizeof(_layout.signature)) {
+        return false;
+    }
+    std::memcpy(&_layout.signature, pos, sizeof(_layout.signature));
+    pos += sizeof(_layout.signature);
+
+    if (!getU32(pos, end, count) || size_t(end - pos) < count) { return false; }
+    _layout.placements.assign(pos, pos + count);
+    return true;
+}
+
+bool BuiltTileCache::encodeMeshTile(const Tile& _tile, const Scene& _scene, std::vector<char>& _out,
+                                    uint32_t* _skipped) {
+
+    _out.insert(_out.end(), MESH_TILE_MAGIC, MESH_TILE_MAGIC + sizeof(MESH_TILE_MAGIC));
+    putU32(_out, VERSION);
+    float pixelScale = _scene.pixelScale();
+    _out.insert(_out.end(), (const char*)&pixelScale, (const char*)&pixelScale + sizeof(pixelScale));
+
+    return writeMeshes(_out, _tile, _scene, true, _skipped);
+}
+
+std::unique_ptr<Tile> BuiltTileCache::decodeMeshTile(const char* _data, size_t _size, const TileID& _tileId,
+                                                     const TileSource& _source, const Scene& _scene) {
+
+    const char* pos = _data;
+    const char* end = _data + _size;
+    uint32_t version = 0;
+    float pixelScale = 0;
+
+    if (_size < sizeof(MESH_TILE_MAGIC) || std::memcmp(pos, MESH_TILE_MAGIC, sizeof(MESH_TILE_MAGIC)) != 0) {
+        return nullptr;
+    }
+    pos += sizeof(MESH_TILE_MAGIC);
+
+    if (!getU32(pos, end, version) || version != VERSION || size_t(end - pos) < sizeof(pixelScale)) {
+        return nullptr;
+    }
+    std::memcpy(&pixelScale, pos, sizeof(pixelScale));
+    pos += sizeof(pixelScale);
+    // Widths in pixels are built into the vertices
+    if (pixelScale != _scene.pixelScale()) { return nullptr; }
+
+    auto tile = std::make_unique<Tile>(_tileId, *_scene.mapProjection(), &_source);
+    if (!readMeshes(pos, end, *tile, _scene, true)) { return nullptr; }
+    return tile;
+}
+
+std::unique_ptr<Tile> BuiltTileCache::load(const TileID& _tileId, const TileSource& _source,
+                                           const Scene& _scene) {
+
+    // The mapping is only read while the meshes copy their geometry
+    ByteBuffer data = ByteBuffer::mapFile(tilePath(_tileId));
+    if (data.empty()) { return nullptr; }
+
+    const char* pos = data.data();
+    const char* end = pos + data.size();
+
+    if (!readHeader(pos, end, MAGIC, _scene)) { return nullptr; }
+
+    auto tile = std::make_unique<Tile>(_tileId, *_scene.mapProjection(), &_source);
+    if (!readMeshes(pos, end, *tile, _scene, false)) { return nullptr; }
+    return tile;
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "tile/tileID.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Tangram {
+
+class Scene;
+struct LabelLayout;
+class Tile;
+class TileSource;
+
+/* Persistent cache of built tiles of one tile source
+ *
+ * Stores the compiled meshes of each style of a built tile as one file per
+ * tile in _directory, so that a tile that is built again for the same scene
+ * is read back and uploaded instead of being loaded, parsed, styled and
+ * tessellated. Files carry the key of the scene configuration and the pixel
+ * scale they were built for, and files of another scene are replaced when
+ * their tile has been built again.
+ *
+ * Only tiles made of plain meshes are stored: tiles with labels, raster
+ * samplers, selection features or a feature index are built as usual.
+ * For tiles with labels the result of their collision pass is stored in a
+ * file of its own, see LabelLayout, which saves that pass when they are
+ * built again. The total size on disk is bounded by evicting the oldest files.
+ */
+class BuiltTileCache {
+
+public:
+
+    static const uint32_t VERSION = 1;
+
+    BuiltTileCache(std::string _directory, size_t _maxSize);
+
+    /* Identifies the scene that tiles are built for, see Scene::Fingerprint */
+    void setSceneKey(std::string _key) { m_sceneKey = std::move(_key); }
+
+    /* Whether a file for _tileId exists, it may still be of another scene */
+    bool has(const TileID& _tileId) const;
+
+    /* Returns the tile restored from the file of _tileId, or null when the
+     * file is invalid or was written for another scene */
+    std::unique_ptr<Tile> load(const TileID& _tileId, const TileSource& _source, const Scene& _scene);
+
+    /* Write _tile when all of its meshes can be stored. Must be called before
+     * the meshes are uploaded. */
+    bool store(const Tile& _tile, const Scene& _scene);
+
+    void remove(const TileID& _tileId);
+
+    /* Label layout of the tile _tileId built for _scene, returns false when
+     * there is none */
+    bool loadLabelLayout(const TileID& _tileId, const Scene& _scene, LabelLayout& _layout);
+
+    bool storeLabelLayout(const TileID& _tileId, const Scene& _scene, const LabelLayout& _layout);
+
+    /* Tiles of TileSource::Format::Mesh sources, built offline for the
+     * styles of a scene. Instead of a scene key each mesh carries the digest
+     * of its style, see Scene::Fingerprint, so that tiles stay valid for
+     * scenes with other sources and layers. Meshes that can't be stored, i.e.
+     * labels, are left out and counted in _skipped. */
+    static bool encodeMeshTile(const Tile& _tile, const Scene& _scene, std::vector<char>& _out,
+                               uint32_t* _skipped = nullptr);
+
+    /* Returns null for invalid data or meshes of other styles */
+    static std::unique_ptr<Tile> decodeMeshTile(const char* _data, size_t _size, const TileID& _tileId,
+                                                const TileSource& _source, const Scene& _scene);
+
+private:
+
+    void openDirectory();
+
+    // Name of the file of _tileId with _suffix, "built" or "labels"
+    std::string fileName(const TileID& _tileId, const char* _suffix) const;
+
+    std::string tilePath(const TileID& _tileId) const;
+
+    // Write _data to the file _name, replacing it at once
+    bool write(const std::string& _name, const std::vector<char>& _data);
+
+    // Header of the files for the current scene key and the pixel scale of _scene
+    void writeHeader(std::vector<char>& _out, const char* _magic, const Scene& _scene) const;
+    bool readHeader(const char*& _pos, const char* _end, const char* _magic, const Scene& _scene) const;
+
+    // Add or update the entry of the file _name and evict above m_maxSize,
+    // requires m_mutex
+    void insert(const std::string& _name, uint64_t _size);
+
+    void remove(const std::string& _name);
+
+    std::string m_directory;
+    uint64_t m_maxSize;
+    std::string m_sceneKey;
+
+    mutable std::mutex m_mutex;
+    // Size of each file by its name
+    std::unordered_map<std::string, uint64_t> m_index;
+    // Stored files, oldest first
+    std::deque<std::string> m_order;
+    uint64_t m_usage = 0;
+
+    std::atomic<uint32_t> m_writes{0};
+};
+
+}
@@ -1,15 +1,39 @@
 #include "tile/tile.h"
 
+#include "data/tileData.h"
 #include "data/tileSource.h"
 #include "labels/labelSet.h"
+#include "selection/featureIndex.h"
 #include "style/style.h"
 #include "tile/tileID.h"
+#include "util/memoryReport.h"
 #include "view/view.h"
 
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace Tangram {
 
+bool Raster::isUploaded() const {
+    return slot ? slot->uploaded : texture->isUploaded();
+}
+
+void Raster::upload(RenderState& _rs) {
+    if (slot) {
+        slot->atlas->upload(_rs, *slot);
+    } else {
+        texture->update(_rs, 0);
+    }
+}
+
+size_t Raster::bufferSize() const {
+    return slot ? slot->atlas->slotBufferSize() : texture->bufferSize();
+}
+
+glm::vec2 Raster::size() const {
+    if (slot) { return slot->atlas->slotSize(); }
+    return { texture->getWidth(), texture->getHeight() };
+}
+
 Tile::Tile(TileID _id, const MapProjection& _projection, const TileSource* _source) :
     m_id(_id),
     m_projection(&_projection),
@@ -39,9 +63,11 @@ glm::dvec2 Tile::coordToLngLat(const glm::vec2& _tileCoord) const {
 
 Tile::~Tile() {}
 
-//Note: This could set tile origin to be something different than the one if TileID's wrap is used.
-// But, this is required for wrapped tiles which are picked up from the cache
+// Required for wrapped tiles which are picked up from the cache, these are
+// cached for all wraps of their TileID
 void Tile::updateTileOrigin(const int _wrap) {
+    m_id.wrap = _wrap;
+
     BoundingBox bounds(m_projection->TileBounds(m_id));
 
     m_tileOrigin = { bounds.min.x, bounds.max.y }; // South-West corner
@@ -55,6 +81,46 @@ void Tile::updateTileOrigin(const int _wrap) {
     m_tileOrigin.x += (mapSpan * _wrap);
 }
 
+Tile::Tile(const Tile& _other, int _wrap) :
+    m_id(_other.m_id),
+    m_projection(_other.m_projection),
+    m_scale(_other.m_scale),
+    m_inverseScale(_other.m_inverseScale),
+    m_sourceId(_other.m_sourceId),
+    m_sourceGeneration(_other.m_sourceGeneration),
+    m_rastersPending(_other.m_rastersPending),
+    m_parentRasters(_other.m_parentRasters),
+    m_culledFeatures(_other.m_culledFeatures),
+    m_wrapCopy(true),
+    m_modelMatrix(_other.m_modelMatrix),
+    m_geometry(_other.m_geometry),
+    m_selectionFeatures(_other.m_selectionFeatures) {
+
+    updateTileOrigin(_wrap);
+
+    for (auto& raster : _other.m_rasters) {
+        m_rasters.emplace_back(raster.tileID, raster.texture, raster.slot);
+    }
+
+    // Labels hold the state of their placement in one copy of the world
+    for (auto& entry : m_geometry) {
+        if (dynamic_cast<const LabelSet*>(entry.get())) { entry.reset(); }
+    }
+}
+
+std::shared_ptr<Tile> Tile::copyForWrap(int _wrap) const {
+    return std::shared_ptr<Tile>(new Tile(*this, _wrap));
+}
+
+std::unique_ptr<Tile> Tile::copyForLabels() const {
+    auto tile = std::unique_ptr<Tile>(new Tile(*this, m_id.wrap));
+    tile->m_wrapCopy = false;
+    tile->m_featureIndex = m_featureIndex;
+    tile->m_tileData = m_tileData;
+    tile->m_tileDataBytes = m_tileDataBytes;
+    return tile;
+}
+
 void Tile::initGeometry(uint32_t _size) {
     m_geometry.resize(_size);
 }
@@ -62,11 +128,17 @@ void Tile::initGeometry(uint32_t _size) {
 void Tile::update(float _dt, const View& _view) {
 
     // Apply tile-view translation to the model matrix
-    const auto& viewOrigin = _view.getPosition();
-    m_modelMatrix[3][0] = m_tileOrigin.x - viewOrigin.x;
-    m_modelMatrix[3][1] = m_tileOrigin.y - viewOrigin.y;
+    auto translation = _view.getRelativeToEye(m_tileOrigin);
+    m_modelMatrix[3][0] = translation.x;
+    m_modelMatrix[3][1] = translation.y;
 
-    m_mvp = _view.getViewProjectionMatrix() * m_modelMatrix;
+    m_mvp = _view.getModelViewProjection(m_modelMatrix);
+}
+
+void Tile::setTransform(const glm::vec2& _translation, const glm::mat4& _mvp) {
+    m_modelMatrix[3][0] = _translation.x;
+    m_modelMatrix[3][1] = _translation.y;
+    m_mvp = _mvp;
 }
 
 void Tile::resetState() {
@@ -78,7 +150,7 @@ void Tile::resetState() {
     }
 }
 
-void Tile::setMesh(const Style& _style, std::unique_ptr<StyledMesh> _mesh) {
+void Tile::setMesh(const Style& _style, std::shared_ptr<StyledMesh> _mesh) {
     size_t id = _style.getID();
     if (id >= m_geometry.size()) {
         m_geometry.resize(id+1);
@@ -86,40 +158,137 @@ void Tile::setMesh(const Style& _style, std::unique_ptr<StyledMesh> _mesh) {
     m_geometry[_style.getID()] = std::move(_mesh);
 }
 
-const std::unique_ptr<StyledMesh>& Tile::getMesh(const Style& _style) const {
-    static std::unique_ptr<StyledMesh> NONE = nullptr;
+const std::shared_ptr<StyledMesh>& Tile::getMesh(const Style& _style) const {
+    static std::shared_ptr<StyledMesh> NONE = nullptr;
     if (_style.getID() >= m_geometry.size()) { return NONE; }
 
     return m_geometry[_style.getID()];
 }
 
-void Tile::setSelectionFeatures(const fastmap<uint32_t, std::shared_ptr<Properties>> _selectionFeatures) {
-    m_selectionFeatures = _selectionFeatures;
+void Tile::setSelectionFeatures(SelectionFeatures&& _selectionFeatures) {
+    m_selectionFeatures = std::move(_selectionFeatures);
+}
+
+void Tile::setFeatureIndex(std::shared_ptr<const FeatureIndex> _featureIndex) {
+    m_featureIndex = std::move(_featureIndex);
+}
+
+void Tile::setTileData(std::shared_ptr<const TileData> _tileData) {
+    m_tileData = std::move(_tileData);
+    m_tileDataBytes = m_tileData ? m_tileData->memoryUsage() : 0;
 }
 
 std::shared_ptr<Properties> Tile::getSelectionFeature(uint32_t _id) const {
-    auto it = m_selectionFeatures.find(_id);
-    if (it != m_selectionFeatures.end()) {
-        return it->second;
-    }
-    return nullptr;
+    return m_selectionFeatures.get(_id);
 }
 
 size_t Tile::getMemoryUsage() const {
+    // Counted for the tile that built them
+    if (m_wrapCopy) { return 0; }
+
     if (m_memoryUsage == 0) {
         for (auto& entry : m_geometry) {
             if (entry) {
                 m_memoryUsage += entry->bufferSize();
             }
         }
-        for (auto& raster : m_rasters) {
-            if (raster.texture) {
-                m_memoryUsage += raster.texture->bufferSize();
+        // Textures of parent rasters are counted by their own tiles
+        for (size_t i = 0; i < m_rasters.size() - m_parentRasters; i++) {
+            if (m_rasters[i].texture) {
+                m_memoryUsage += m_rasters[i].bufferSize();
             }
         }
     }
 
-    return m_memoryUsage;
+    size_t released = 0;
+    for (auto& entry : m_geometry) {
+        if (entry && entry->isReleased()) { released += entry->bufferSize(); }
+    }
+    return m_memoryUsage - released;
+}
+
+size_t Tile::getCpuMemoryUsage() const {
+    size_t usage = m_selectionFeatures.memoryUsage() + m_tileDataBytes;
+
+    if (m_featureIndex) { usage += m_featureIndex->memoryUsage(); }
+
+    for (auto& entry : m_geometry) {
+        if (!entry) { continue; }
+        if (entry->isReleased() && !m_wrapCopy) { usage += entry->bufferSize(); }
+
+        auto labelSet = dynamic_cast<const LabelSet*>(entry.get());
+        if (!labelSet) { continue; }
+        for (auto& label : labelSet->getLabels()) {
+            usage += label->memoryUsage();
+        }
+    }
+    return usage;
+}
+
+size_t Tile::releaseGpuBuffers(RenderState& _rs) {
+    if (m_wrapCopy) { return 0; }
+
+    size_t bytes = 0;
+    for (auto& entry : m_geometry) {
+        // Copies for other wraps and stages of progressive builds would lose
+        // their uploaded meshes as well
+        if (!entry || entry.use_count() > 1) { continue; }
+        bytes += entry->releaseBuffers(_rs);
+    }
+    return bytes;
+}
+
+size_t Tile::releaseTileData() {
+    size_t bytes = m_tileDataBytes;
+    setTileData(nullptr);
+    return bytes;
+}
+
+void Tile::reportMemory(MemoryReport& _report, MemoryUsage& _usage) const {
+    _usage.cpuBytes += getCpuMemoryUsage();
+    if (m_wrapCopy) { return; }
+
+    for (auto& entry : m_geometry) {
+        if (entry && !entry->isReleased()) { _usage.gpuBytes += entry->bufferSize(); }
+    }
+
+    for (auto& raster : m_rasters) {
+        if (raster.texture) { _report.addTexture(_report.stats.rasters, *raster.texture); }
+    }
+}
+
+bool Tile::isUploaded() const {
+    for (auto& entry : m_geometry) {
+        if (entry && !entry->isUploaded()) { return false; }
+    }
+    for (auto& raster : m_rasters) {
+        if (raster.texture && !raster.isUploaded()) { return false; }
+    }
+    return true;
+}
+
+size_t Tile::upload(RenderState& _rs, size_t _budget) {
+    size_t bytes = 0;
+
+    // Raster textures are decoded on the workers, upload them here instead
+    // of on first bind while drawing
+    for (auto& raster : m_rasters) {
+        if (!raster.texture || raster.isUploaded()) { continue; }
+
+        if (bytes > 0 && bytes + raster.bufferSize() > _budget) { return bytes; }
+
+        bytes += raster.bufferSize();
+        raster.upload(_rs);
+    }
+
+    for (auto& entry : m_geometry) {
+        if (!entry || entry->isUploaded()) { continue; }
+
+        if (bytes > 0 && bytes + entry->bufferSize() > _budget) { break; }
+
+        bytes += entry->uploadBuffers(_rs);
+    }
+    return bytes;
 }
 
 }
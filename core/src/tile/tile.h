@@ -1,6 +1,8 @@
 #pragma once
 
+#include "data/rasterAtlas.h"
 #include "gl/texture.h"
+#include "selection/selectionFeatures.h"
 #include "tile/tileID.h"
 #include "util/fastmap.h"
 
@@ -13,9 +15,13 @@
 
 namespace Tangram {
 
+class FeatureIndex;
 class TileSource;
 class MapProjection;
+struct TileData;
+class MemoryReport;
 struct Properties;
+class RenderState;
 class Style;
 class View;
 struct StyledMesh;
@@ -23,11 +29,32 @@ struct StyledMesh;
 struct Raster {
     TileID tileID;
     std::shared_ptr<Texture> texture;
+    // Set when the raster is packed into a shared RasterAtlas texture
+    std::shared_ptr<RasterAtlas::Slot> slot;
 
-    Raster(TileID tileID, std::shared_ptr<Texture> texture) : tileID(tileID), texture(texture) {}
-    Raster(Raster&& other) : tileID(other.tileID), texture(std::move(other.texture)) {}
+    Raster(TileID tileID, std::shared_ptr<Texture> texture,
+           std::shared_ptr<RasterAtlas::Slot> slot = nullptr)
+        : tileID(tileID), texture(texture), slot(slot) {}
+    Raster(Raster&& other)
+        : tileID(other.tileID), texture(std::move(other.texture)), slot(std::move(other.slot)) {}
 
     bool isValid() const { return texture != nullptr; }
+
+    bool isUploaded() const;
+
+    void upload(RenderState& _rs);
+
+    /* Bytes of the raster on the GPU, only its slot when in an atlas */
+    size_t bufferSize() const;
+
+    /* Size of the raster in pixels */
+    glm::vec2 size() const;
+
+    /* Transform from raster to texture coordinates, see RasterAtlas::Slot */
+    glm::vec3 uvTransform() const {
+        if (slot) { return slot->uvTransform; }
+        return texture && texture->topDown() ? glm::vec3(0, 1, -1) : glm::vec3(0, 0, 1);
+    }
 };
 
 /* Tile of vector map data
@@ -68,30 +95,96 @@ public:
 
     void initGeometry(uint32_t _size);
 
-    const std::unique_ptr<StyledMesh>& getMesh(const Style& _style) const;
+    const std::shared_ptr<StyledMesh>& getMesh(const Style& _style) const;
 
-    void setMesh(const Style& _style, std::unique_ptr<StyledMesh> _mesh);
+    /* _mesh may be shared with other tiles, e.g. the stages of a progressive build */
+    void setMesh(const Style& _style, std::shared_ptr<StyledMesh> _mesh);
 
-    void setSelectionFeatures(const fastmap<uint32_t, std::shared_ptr<Properties>> _selectionFeatures);
+    void setSelectionFeatures(SelectionFeatures&& _selectionFeatures);
 
     std::shared_ptr<Properties> getSelectionFeature(uint32_t _id) const;
 
     const auto& getSelectionFeatures() const { return m_selectionFeatures; }
 
+    void setFeatureIndex(std::shared_ptr<const FeatureIndex> _featureIndex);
+
+    /* Index of the selection features, null unless the tile was built with feature indexing */
+    const FeatureIndex* getFeatureIndex() const { return m_featureIndex.get(); }
+
+    /* Keep the parsed data the tile was built from, see TileSource::setRetainTileData() */
+    void setTileData(std::shared_ptr<const TileData> _tileData);
+
+    const std::shared_ptr<const TileData>& getTileData() const { return m_tileData; }
+
+    /* Number of features that were not built for at least one of their styles
+     * as they are smaller than its Style::minFeatureSize */
+    void setCulledFeatures(uint32_t _count) { m_culledFeatures = _count; }
+    uint32_t culledFeatures() const { return m_culledFeatures; }
+
     auto& rasters() { return m_rasters; }
     const auto& rasters() const { return m_rasters; }
 
+    /* Set while the tile is shown before its raster samplers are loaded */
+    void setRastersPending(bool _pending) { m_rastersPending = _pending; }
+    bool rastersPending() const { return m_rastersPending; }
+
+    /* Number of rasters at the end of rasters() which sample the textures of
+     * parent tiles while the rasters of this tile are pending */
+    void setParentRasters(size_t _count) { m_parentRasters = _count; }
+    size_t parentRasters() const { return m_parentRasters; }
+
     /* Update the Tile considering the current view */
     void update(float _dt, const View& _view);
 
-    /* Update tile origin based on wraping for this tile */
+    /* Set the translation relative to the eye and the model-view-projection matrix
+     * of the tile, computed for many tiles at once by ModelTransforms */
+    void setTransform(const glm::vec2& _translation, const glm::mat4& _mvp);
+
+    /* Move the tile to the copy _wrap of the world, updates its ID and origin */
     void updateTileOrigin(const int _wrap);
 
+    /* Returns this tile in the copy _wrap of the world. The copy shares the
+     * meshes and rasters of this tile, so that they are loaded, built and
+     * uploaded once. Labels are placed once per tile: meshes of labels stay
+     * with this tile. */
+    std::shared_ptr<Tile> copyForWrap(int _wrap) const;
+
+    /* Returns a copy of this tile to rebuild its labels into, e.g. for another
+     * pixel scale. The copy shares the other meshes, the rasters, the feature
+     * index and the tile data of this tile and keeps its selection features. */
+    std::unique_ptr<Tile> copyForLabels() const;
+
+    /* Whether the meshes of this tile belong to the tile it was copied from */
+    bool isWrapCopy() const { return m_wrapCopy; }
+
     void resetState();
 
-    /* Get the sum in bytes of static <Mesh>es */
+    /* Get the sum in bytes of static <Mesh>es in GPU buffers */
     size_t getMemoryUsage() const;
 
+    /* Estimate of the bytes held in CPU memory by labels, selection features
+     * and meshes that were moved out of GPU buffers */
+    size_t getCpuMemoryUsage() const;
+
+    /* Move the uploaded meshes which no other tile shares from GPU buffers
+     * into CPU memory, upload() moves them back. Returns the moved bytes. */
+    size_t releaseGpuBuffers(RenderState& _rs);
+
+    /* Drop the retained tile data, returns the freed bytes */
+    size_t releaseTileData();
+
+    /* Add the bytes of meshes, labels and selection features to _usage,
+     * and of raster textures to the rasters of _report */
+    void reportMemory(MemoryReport& _report, MemoryUsage& _usage) const;
+
+    /* Returns true when all meshes and raster textures are uploaded to the GPU */
+    bool isUploaded() const;
+
+    /* Upload raster textures, then meshes, until _budget bytes are exceeded,
+     * at least one of them is uploaded. Returns the number of uploaded bytes.
+     */
+    size_t upload(RenderState& _rs, size_t _budget);
+
     int64_t sourceGeneration() const { return m_sourceGeneration; }
 
     int32_t sourceID() const { return m_sourceId; }
@@ -102,7 +195,10 @@ public:
 
 private:
 
-    const TileID m_id;
+    // See copyForWrap and copyForLabels
+    Tile(const Tile& _other, int _wrap);
+
+    TileID m_id;
 
     const MapProjection* m_projection = nullptr;
 
@@ -118,6 +214,14 @@ private:
 
     bool m_proxyState = false;
 
+    bool m_rastersPending = false;
+
+    size_t m_parentRasters = 0;
+
+    uint32_t m_culledFeatures = 0;
+
+    bool m_wrapCopy = false;
+
     glm::dvec2 m_tileOrigin; // South-West corner of the tile in 2D projection space in meters (e.g. mercator meters)
 
     glm::mat4 m_modelMatrix; // Matrix relating tile-local coordinates to global projection space coordinates;
@@ -127,13 +231,19 @@ private:
 
     glm::mat4 m_mvp;
 
-    // Map of <Style>s and their associated <Mesh>es
-    std::vector<std::unique_ptr<StyledMesh>> m_geometry;
+    // Map of <Style>s and their associated <Mesh>es, shared with copies for other wraps
+    std::vector<std::shared_ptr<StyledMesh>> m_geometry;
     std::vector<Raster> m_rasters;
 
     mutable size_t m_memoryUsage = 0;
 
-    fastmap<uint32_t, std::shared_ptr<Properties>> m_selectionFeatures;
+    SelectionFeatures m_selectionFeatures;
+
+    // Shared with copies for rebuilt labels
+    std::shared_ptr<const FeatureIndex> m_featureIndex;
+
+    std::shared_ptr<const TileData> m_tileData;
+    size_t m_tileDataBytes = 0;
 
 };
 
@@ -4,25 +4,88 @@
 #include "data/propertyItem.h"
 #include "data/tileSource.h"
 #include "gl/mesh.h"
+#include "labels/labelLayout.h"
 #include "log.h"
 #include "scene/dataLayer.h"
 #include "scene/scene.h"
+#include "selection/featureIndex.h"
 #include "selection/featureSelection.h"
 #include "style/style.h"
+#include "tile/builtTileCache.h"
 #include "tile/tile.h"
+#include "tile/tileTask.h"
 #include "util/mapProjection.h"
 #include "view/view.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
 namespace Tangram {
 
-TileBuilder::TileBuilder(std::shared_ptr<Scene> _scene)
-    : m_scene(_scene) {
+using Clock = std::chrono::steady_clock;
+
+// Features styled between checks for a canceled task
+constexpr size_t CANCEL_CHECK_FEATURES = 64;
+
+static double millisecondsSince(Clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+}
+
+// Longest side of the bounds of the lines or polygons of _feature in tile units,
+// infinite for points which are drawn at the size of their style
+static float featureExtent(const Feature& _feature) {
+
+    glm::vec2 min(std::numeric_limits<float>::max());
+    glm::vec2 max(std::numeric_limits<float>::lowest());
+
+    auto add = [&](const Line& _line) {
+        for (auto& point : _line) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+    };
+
+    switch (_feature.geometryType) {
+    case GeometryType::lines:
+        for (auto& line : _feature.lines) { add(line); }
+        break;
+    case GeometryType::polygons:
+        // The outer ring bounds the polygon
+        for (auto& polygon : _feature.polygons) {
+            if (!polygon.empty()) { add(polygon[0]); }
+        }
+        break;
+    default:
+        return std::numeric_limits<float>::infinity();
+    }
 
-    m_styleContext.initFunctions(*_scene);
+    if (min.x > max.x) { return 0.f; }
+    return std::max(max.x - min.x, max.y - min.y);
+}
+
+TileBuilder::TileBuilder(std::shared_ptr<Scene> _scene, std::unique_ptr<StyleContext> _styleContext)
+    : m_scene(_scene),
+      m_styleContext(std::move(_styleContext)) {
+
+    if (!m_styleContext) {
+        m_styleContext = std::make_unique<StyleContext>();
+    }
+    m_styleContext->initFunctions(*_scene);
 
     // Initialize StyleBuilders
-    for (auto& style : _scene->styles()) {
-        m_styleBuilder[style->getName()] = style->createBuilder();
+    resetStyleBuilders();
+}
+
+void TileBuilder::resetStyleBuilders() {
+    for (auto& style : m_scene->styles()) {
+        auto builder = style->createBuilder();
+        if (builder) {
+            builder->setTriangulationCache(&m_triangulation);
+            builder->setPolyLineCache(&m_polyLines);
+        }
+        m_styleBuilder[style->getName()] = std::move(builder);
     }
 }
 
@@ -35,14 +98,56 @@ StyleBuilder* TileBuilder::getStyleBuilder(const std::string& _name) {
     return it->second.get();
 }
 
-void TileBuilder::applyStyling(const Feature& _feature, const SceneLayer& _layer) {
+bool TileBuilder::inStage(const StyleBuilder& _builder) const {
+    return m_stage == Stage::all || _builder.buildsLabels() == (m_stage == Stage::labels);
+}
+
+bool TileBuilder::addFeature(StyleBuilder& _style, const Feature& _feature, const DrawRule& _rule) {
+    if (!m_counting) { return _style.addFeature(_feature, _rule); }
+
+    auto start = Clock::now();
+    bool added = _style.addFeature(_feature, _rule);
+
+    auto& cost = m_tally.styles[_style.style().getID()];
+    cost.milliseconds += millisecondsSince(start);
+    if (added) { cost.features++; }
+
+    return added;
+}
+
+void TileBuilder::applyStyling(const Feature& _feature, const SceneLayer& _layer, size_t _layerIndex) {
+    if (!m_counting) {
+        applyStyling(_feature, _layer);
+        return;
+    }
+
+    auto start = Clock::now();
+    bool matched = applyStyling(_feature, _layer);
+
+    auto& cost = m_tally.layers[_layerIndex];
+    cost.milliseconds += millisecondsSince(start);
+    // Features are counted once for the passes of a progressive build
+    if (m_stage == Stage::labels) { return; }
+    cost.features++;
+    if (matched) { cost.matched++; }
+}
+
+bool TileBuilder::applyStyling(const Feature& _feature, const SceneLayer& _layer) {
 
     // If no rules matched the feature, return immediately
-    if (!m_ruleSet.match(_feature, _layer, m_styleContext)) { return; }
+    if (!m_ruleSet.match(_feature, _layer, *m_styleContext)) { return false; }
+
+    m_triangulation.clear();
+    m_polyLines.clear();
 
     uint32_t selectionColor = 0;
+    uint32_t selectionOrder = 0;
     bool added = false;
 
+    // Size in pixels, computed for the first style with a minimum size
+    float pixelSize = -1.f;
+    bool culled = false;
+
     // For each matched rule, find the style to be used and
     // build the feature with the rule's parameters
     for (auto& rule : m_ruleSet.matchedRules()) {
@@ -53,21 +158,37 @@ void TileBuilder::applyStyling(const Feature& _feature, const SceneLayer& _layer
             LOGN("Invalid style %s", rule.getStyleName().c_str());
             continue;
         }
+        if (!inStage(*style)) { continue; }
+
+        // Skip features that would be built into vertices within a pixel
+        float minSize = style->style().minFeatureSize();
+        if (minSize > 0.f) {
+            if (pixelSize < 0.f) { pixelSize = featureExtent(_feature) * m_pixelsPerUnit; }
+            if (pixelSize < minSize) {
+                culled = true;
+                if (m_counting) { m_tally.styles[style->style().getID()].culled++; }
+                continue;
+            }
+        }
 
         // Apply default draw rules defined for this style
         style->style().applyDefaultDrawRules(rule);
 
-        if (!m_ruleSet.evaluateRuleForContext(rule, m_styleContext)) {
+        if (!m_ruleSet.evaluateRuleForContext(rule, *m_styleContext)) {
             continue;
         }
 
         bool interactive = false;
         if (rule.get(StyleParamKey::interactive, interactive) && interactive) {
             if (selectionColor == 0) {
-                selectionColor = m_scene->featureSelection()->nextColorIdentifier();
+                selectionColor = m_selectionFeatures.nextColor(*m_scene->featureSelection());
             }
             rule.selectionColor = selectionColor;
             rule.featureSelection = m_scene->featureSelection().get();
+
+            uint32_t order = 0;
+            rule.get(StyleParamKey::order, order);
+            selectionOrder = std::max(selectionOrder, order);
         } else {
             rule.selectionColor = 0;
         }
@@ -79,55 +200,226 @@ void TileBuilder::applyStyling(const Feature& _feature, const SceneLayer& _layer
             auto* outlineStyle = getStyleBuilder(styleName);
             if (!outlineStyle) {
                 LOGN("Invalid style %s", styleName.c_str());
-            } else {
+            } else if (inStage(*outlineStyle)) {
+                // The outline and the style tesselate the same lines
+                m_polyLines.setEnabled(true);
                 rule.isOutlineOnly = true;
-                outlineStyle->addFeature(_feature, rule);
+                addFeature(*outlineStyle, _feature, rule);
                 rule.isOutlineOnly = false;
             }
         }
 
         // build feature with style
-        added |= style->addFeature(_feature, rule);
+        added |= addFeature(*style, _feature, rule);
+        m_polyLines.setEnabled(false);
     }
 
+    if (culled) { m_culledFeatures++; }
+
     if (added && (selectionColor != 0)) {
-        m_selectionFeatures[selectionColor] = std::make_shared<Properties>(_feature.props);
+        m_selectionFeatures.set(selectionColor, _feature.props);
+        // Labels are picked by their placement, not by the feature index
+        if (m_featureIndex && m_stage != Stage::labels) {
+            m_featureIndex->add(_feature, selectionColor, selectionOrder);
+        }
     }
+    return true;
 }
 
-std::unique_ptr<Tile> TileBuilder::build(TileID _tileID, const TileData& _tileData, const TileSource& _source) {
+void TileBuilder::placeLabels(TileID _tileID, const Tile& _tile, const TileSource& _source, float _tileSize) {
 
-    m_selectionFeatures.clear();
+    if (m_labelLayout.empty()) { return; }
+
+    auto& layouts = m_scene->labelLayouts();
+    if (!layouts) {
+        m_labelLayout.process(_tileID, _tile.getInverseScale(), _tileSize);
+        return;
+    }
+
+    // Tiles that are built again for the same scene and data place their
+    // labels as before without colliding them
+    auto& builtCache = _source.builtTileCache();
+    LabelLayout layout;
+    if (!layouts->get(_source.id(), _tileID, layout) &&
+        builtCache && builtCache->loadLabelLayout(_tileID, *m_scene, layout)) {
+        layouts->put(_source.id(), _tileID, layout);
+    }
+
+    if (m_labelLayout.apply(layout)) { return; }
+
+    m_labelLayout.process(_tileID, _tile.getInverseScale(), _tileSize, &layout);
+    layouts->put(_source.id(), _tileID, layout);
+    if (builtCache) { builtCache->storeLabelLayout(_tileID, *m_scene, layout); }
+}
+
+bool TileBuilder::styleLayers(const TileData& _tileData, const TileSource& _source, const TileTask* _task) {
+
+    size_t styled = 0;
+    auto canceled = [&]() {
+        return _task && _task->isCanceled();
+    };
+    // Checked every CANCEL_CHECK_FEATURES features: Line labels are laid
+    // out while they are added, so dense layers take long to style.
+    auto canceledAfterFeature = [&]() {
+        return ++styled % CANCEL_CHECK_FEATURES == 0 && canceled();
+    };
+
+    const auto& layers = m_scene->layers();
+    for (size_t layerIndex = 0; layerIndex < layers.size(); layerIndex++) {
+        const auto& datalayer = layers[layerIndex];
+
+        if (datalayer.source() != _source.name()) { continue; }
+
+        if (canceled()) { return false; }
+
+        const auto& dlc = datalayer.collections();
+        auto containsCollection = [&](const std::string& _name) {
+            return _name.empty() || std::find(dlc.begin(), dlc.end(), _name) != dlc.end();
+        };
+
+        for (const auto& view : _tileData.layerViews) {
+
+            if (!containsCollection(view->name)) { continue; }
+
+            for (size_t i = 0; i < view->size(); i++) {
+                view->getFeature(i, m_feature);
+                applyStyling(m_feature, datalayer, layerIndex);
+                if (canceledAfterFeature()) { return false; }
+            }
+        }
+
+        for (const auto& collection : _tileData.layers) {
+
+            if (!containsCollection(collection.name)) { continue; }
+
+            for (const auto& feat : collection.features) {
+                applyStyling(feat, datalayer, layerIndex);
+                if (canceledAfterFeature()) { return false; }
+            }
+        }
+
+        for (const auto& collection : _tileData.columnarLayers) {
+
+            if (!containsCollection(collection.name)) { continue; }
+
+            for (size_t i = 0; i < collection.features.size(); i++) {
+                collection.getFeature(i, m_feature);
+                applyStyling(m_feature, datalayer, layerIndex);
+                if (canceledAfterFeature()) { return false; }
+            }
+        }
+    }
+
+    return !canceled();
+}
+
+std::unique_ptr<StyledMesh> TileBuilder::buildMesh(StyleBuilder& _builder) {
+    if (!m_counting) { return _builder.build(); }
+
+    auto start = Clock::now();
+    auto mesh = _builder.build();
+
+    auto& cost = m_tally.styles[_builder.style().getID()];
+    cost.milliseconds += millisecondsSince(start);
+    if (mesh) {
+        cost.vertices += mesh->vertexCount();
+        cost.bytes += mesh->bufferSize();
+    }
+    return mesh;
+}
+
+std::unique_ptr<Tile> TileBuilder::build(TileID _tileID, const TileData& _tileData, const TileSource& _source,
+                                         TileTask* _task) {
 
     auto tile = std::make_unique<Tile>(_tileID, *m_scene->mapProjection(), &_source);
 
     tile->initGeometry(m_scene->styles().size());
 
-    m_styleContext.setKeywordZoom(_tileID.s);
+    return build(std::move(tile), _tileData, _source, _task, false);
+}
+
+std::unique_ptr<Tile> TileBuilder::rebuildLabels(const Tile& _tile, const TileData& _tileData,
+                                                 const TileSource& _source, TileTask* _task) {
+
+    return build(_tile.copyForLabels(), _tileData, _source, _task, true);
+}
+
+std::unique_ptr<Tile> TileBuilder::build(std::unique_ptr<Tile> _tile, const TileData& _tileData,
+                                         const TileSource& _source, TileTask* _task, bool _labelsOnly) {
+
+    TileID tileID = _tile->getID();
+
+    m_selectionFeatures.clear();
+    m_featureIndex.reset();
+
+    if (_labelsOnly) {
+        // Labels take the colors after those of the other features
+        m_selectionFeatures = _tile->getSelectionFeatures();
+    } else if (m_featureIndexing) {
+        m_featureIndex = std::make_unique<FeatureIndex>();
+    }
+
+    m_styleContext->setKeywordZoom(tileID.s);
+    m_styleContext->collectRequestedGarbage();
+
+    // Tiles are drawn from their styling zoom at least at this scale
+    m_pixelsPerUnit = m_scene->mapProjection()->TileSize() * std::exp2(tileID.s - tileID.z) *
+        m_scene->pixelScale();
+    m_culledFeatures = 0;
+
+    m_counting = m_costs && m_costs->enabled();
+    if (m_counting) {
+        auto& layers = m_scene->layers();
+        m_tally.layers.assign(layers.size(), {});
+        for (size_t i = 0; i < layers.size(); i++) { m_tally.layers[i].name = layers[i].name(); }
+
+        auto& styles = m_scene->styles();
+        m_tally.styles.assign(styles.size(), {});
+        for (auto& style : styles) { m_tally.styles[style->getID()].name = style->getName(); }
+    }
 
     for (auto& builder : m_styleBuilder) {
         if (builder.second)
-            builder.second->setup(*tile);
+            builder.second->setup(*_tile);
     }
 
-    for (const auto& datalayer : m_scene->layers()) {
+    auto abort = [&]() {
+        resetStyleBuilders();
+        m_stage = Stage::all;
+        m_counting = false;
+        m_selectionFeatures.clear();
+        m_featureIndex.reset();
+        return nullptr;
+    };
 
-        if (datalayer.source() != _source.name()) { continue; }
+    // The first stage leaves out label styles, a second pass over the
+    // tile data styles them once lines and polygons are passed on
+    bool progressive = !_labelsOnly && _task && _source.progressiveBuild() &&
+        std::any_of(m_styleBuilder.begin(), m_styleBuilder.end(),
+                    [](auto& _builder) { return _builder.second && _builder.second->buildsLabels(); });
 
-        for (const auto& collection : _tileData.layers) {
+    m_stage = _labelsOnly ? Stage::labels : progressive ? Stage::geometry : Stage::all;
 
-            if (!collection.name.empty()) {
-                const auto& dlc = datalayer.collections();
-                bool layerContainsCollection =
-                    std::find(dlc.begin(), dlc.end(), collection.name) != dlc.end();
+    if (!styleLayers(_tileData, _source, _task)) { return abort(); }
 
-                if (!layerContainsCollection) { continue; }
-            }
+    if (progressive) {
+        auto partial = std::make_unique<Tile>(tileID, *m_scene->mapProjection(), &_source);
+        partial->initGeometry(m_scene->styles().size());
 
-            for (const auto& feat : collection.features) {
-                applyStyling(feat, datalayer);
-            }
+        for (auto& builder : m_styleBuilder) {
+            if (!inStage(*builder.second)) { continue; }
+
+            auto& style = builder.second->style();
+            std::shared_ptr<StyledMesh> mesh = buildMesh(*builder.second);
+            partial->setMesh(style, mesh);
+            _tile->setMesh(style, std::move(mesh));
         }
+        // Rasters are added to the complete tile
+        partial->setRastersPending(!_task->subTasks().empty());
+        _task->setPartialTile(std::move(partial));
+
+        m_stage = Stage::labels;
+        if (!styleLayers(_tileData, _source, _task)) { return abort(); }
     }
 
     for (auto& builder : m_styleBuilder) {
@@ -137,15 +429,33 @@ std::unique_ptr<Tile> TileBuilder::build(TileID _tileID, const TileData& _tileDa
 
     float tileSize = m_scene->mapProjection()->TileSize() * m_scene->pixelScale();
 
-    m_labelLayout.process(_tileID, tile->getInverseScale(), tileSize);
+    placeLabels(tileID, *_tile, _source, tileSize);
 
     for (auto& builder : m_styleBuilder) {
-        tile->setMesh(builder.second->style(), builder.second->build());
+        if (!inStage(*builder.second)) { continue; }
+
+        _tile->setMesh(builder.second->style(), buildMesh(*builder.second));
     }
+    m_stage = Stage::all;
 
-    tile->setSelectionFeatures(m_selectionFeatures);
+    if (m_counting) {
+        m_costs->merge(m_tally);
+        m_counting = false;
+    }
+
+    // A rebuild of the labels keeps the count of the complete build
+    if (!_labelsOnly) { _tile->setCulledFeatures(m_culledFeatures); }
+
+    m_selectionFeatures.finish();
+    _tile->setSelectionFeatures(std::move(m_selectionFeatures));
+    m_selectionFeatures.clear();
+
+    if (m_featureIndex && !m_featureIndex->empty()) {
+        m_featureIndex->build();
+        _tile->setFeatureIndex(std::move(m_featureIndex));
+    }
 
-    return tile;
+    return _tile;
 }
 
 }
@@ -1,49 +1,132 @@
 #pragma once
 
+#include "data/tileData.h"
 #include "data/tileSource.h"
 #include "labels/labelCollider.h"
 #include "scene/styleContext.h"
 #include "scene/drawRule.h"
+#include "selection/selectionFeatures.h"
+#include "tile/buildCost.h"
+#include "util/builders.h"
 
 namespace Tangram {
 
+class BuildCostAccounting;
 class DataLayer;
+class FeatureIndex;
 class StyleBuilder;
+struct StyledMesh;
 class Tile;
 class TileSource;
-struct Feature;
-struct Properties;
-struct TileData;
+class TileTask;
 
 class TileBuilder {
 
 public:
 
-    TileBuilder(std::shared_ptr<Scene> _scene);
+    /* _styleContext may be passed on from the builder of a previous scene
+     * to reuse its duktape heap */
+    TileBuilder(std::shared_ptr<Scene> _scene, std::unique_ptr<StyleContext> _styleContext = nullptr);
 
     ~TileBuilder();
 
     StyleBuilder* getStyleBuilder(const std::string& _name);
 
-    std::unique_ptr<Tile> build(TileID _tileID, const TileData& _data, const TileSource& _source);
+    /* Returns null when _task is canceled while the tile is built. The
+     * build checks for it between data layers, every few features of a
+     * layer and before placing labels. For sources with progressiveBuild()
+     * the lines and polygons of the tile are passed to _task as partial
+     * tile before the labels are built. */
+    std::unique_ptr<Tile> build(TileID _tileID, const TileData& _data, const TileSource& _source,
+                                TileTask* _task = nullptr);
+
+    /* Returns a copy of _tile with the meshes of label styles built anew from
+     * _data, e.g. after the pixel scale changed. Lines and polygons, rasters
+     * and the feature index are shared with _tile. Null when _task is canceled. */
+    std::unique_ptr<Tile> rebuildLabels(const Tile& _tile, const TileData& _data, const TileSource& _source,
+                                        TileTask* _task = nullptr);
 
     const Scene& scene() const { return *m_scene; }
 
+    std::unique_ptr<StyleContext> releaseStyleContext() { return std::move(m_styleContext); }
+
+    /* Count the build costs of layers and styles into _costs while it is enabled */
+    void setCostAccounting(BuildCostAccounting* _costs) { m_costs = _costs; }
+
+    /* Index the geometry of interactive features for Tile::getFeatureIndex */
+    void setFeatureIndexing(bool _enabled) { m_featureIndexing = _enabled; }
+    bool featureIndexing() const { return m_featureIndexing; }
+
 private:
 
-    // Determine and apply DrawRules for a @_feature
-    void applyStyling(const Feature& _feature, const SceneLayer& _layer);
+    // Style builders that take features in a pass over the tile data
+    enum class Stage { all, geometry, labels };
+
+    bool inStage(const StyleBuilder& _builder) const;
+
+    // Build the styles of _data into _tile, only those of labels when _labelsOnly
+    std::unique_ptr<Tile> build(std::unique_ptr<Tile> _tile, const TileData& _data, const TileSource& _source,
+                                TileTask* _task, bool _labelsOnly);
+
+    // Style all features of _data for the data layers of _source, returns
+    // false when _task got canceled
+    bool styleLayers(const TileData& _data, const TileSource& _source, const TileTask* _task);
+
+    // Build the mesh of _builder, counting its cost
+    std::unique_ptr<StyledMesh> buildMesh(StyleBuilder& _builder);
+
+    // Determine and apply DrawRules for a @_feature, returns false when no rule matched
+    bool applyStyling(const Feature& _feature, const SceneLayer& _layer);
+
+    // Same as applyStyling above, counting its cost for the data layer at _layerIndex
+    void applyStyling(const Feature& _feature, const SceneLayer& _layer, size_t _layerIndex);
+
+    bool addFeature(StyleBuilder& _style, const Feature& _feature, const DrawRule& _rule);
+
+    // Drop the features that the style builders took for a canceled build
+    void resetStyleBuilders();
+
+    // Collide the labels of the style builders, or place them by the label layout
+    // of a previous build of the tile
+    void placeLabels(TileID _tileID, const Tile& _tile, const TileSource& _source, float _tileSize);
 
     std::shared_ptr<Scene> m_scene;
 
-    StyleContext m_styleContext;
+    std::unique_ptr<StyleContext> m_styleContext;
     DrawRuleMergeSet m_ruleSet;
 
     LabelCollider m_labelLayout;
 
     fastmap<std::string, std::unique_ptr<StyleBuilder>> m_styleBuilder;
 
-    fastmap<uint32_t, std::shared_ptr<Properties>> m_selectionFeatures;
+    // Triangulations of the current feature, shared by all style builders
+    TriangulationCache m_triangulation;
+
+    // Lines of the current feature tesselated for an outline_style
+    PolyLineCache m_polyLines;
+
+    SelectionFeatures m_selectionFeatures;
+
+    // Index of the current tile, set while m_featureIndexing
+    std::unique_ptr<FeatureIndex> m_featureIndex;
+    bool m_featureIndexing = false;
+
+    // Reused to read features of columnar layers
+    Feature m_feature;
+
+    Stage m_stage = Stage::all;
+
+    // Pixels per tile unit at the styling zoom of the current tile
+    float m_pixelsPerUnit = 0;
+
+    // Features of the current tile culled by Style::minFeatureSize
+    uint32_t m_culledFeatures = 0;
+
+    BuildCostAccounting* m_costs = nullptr;
+
+    // Costs of the current tile, valid while m_counting
+    BuildCostAccounting::Tally m_tally;
+    bool m_counting = false;
 };
 
 }
@@ -1,16 +1,22 @@
 #pragma once
 
 #include "log.h"
+#include "map.h"
 #include "tile/tile.h"
 #include "tile/tileHash.h"
 #include "tile/tileID.h"
+#include "util/memoryReport.h"
 
-#include <list>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace Tangram {
-// TileSet serial + TileID
+// TileSet serial + TileID. Tiles are cached for all wraps of their TileID,
+// keys are those of wrap 0.
 using TileCacheKey = std::pair<int32_t, TileID>;
 }
 
@@ -28,95 +34,394 @@ namespace std {
 
 namespace Tangram {
 
-class TileCache {
-    struct CacheEntry {
-        TileCacheKey key;
-        std::shared_ptr<Tile> tile;
-    };
+template<>
+struct hashmap_key<TileCacheKey> {
+    static TileCacheKey empty() { return { -1, hashmap_key<TileID>::empty() }; }
+    static TileCacheKey deleted() { return { -1, hashmap_key<TileID>::deleted() }; }
+    static size_t hash(const TileCacheKey& _key) {
+        return size_t(tileIdHash(_key.second) ^ (uint64_t(uint32_t(_key.first)) * 0x9e3779b97f4a7c15ull));
+    }
+};
+
+struct TileCacheEntry {
+    TileCacheKey key{ 0, NOT_A_TILE };
+    std::shared_ptr<Tile> tile;
+
+    uint64_t gpuBytes = 0;
+    uint64_t cpuBytes = 0;
+
+    // Number of times the tile was taken from the cache before
+    uint32_t reuses = 0;
+
+    // Set once the GPU buffers of the tile were released, or could not be
+    bool buffersReleased = false;
+
+    // Intrusive recency list: indices into the entry pool, -1 for none
+    int32_t prev = -1;
+    int32_t next = -1;
+};
+
+/* Eviction policy of the TileCache
+ *
+ * Candidates are visited from the least recently used entry on, up to
+ * window() entries. The candidate with the highest score is evicted.
+ */
+class TileCachePolicy {
+public:
+    virtual ~TileCachePolicy() {}
 
-    using CacheList = std::list<CacheEntry>;
-    using CacheMap = std::unordered_map<TileCacheKey, typename CacheList::iterator>;
+    virtual size_t window() const { return 1; }
 
+    // _age: Position of the entry counted from the least recently used end
+    virtual double score(const TileCacheEntry& _entry, size_t _age, float _viewZoom) const {
+        return -double(_age);
+    }
+};
+
+/* Evicts the least recently used tile */
+using LruCachePolicy = TileCachePolicy;
+
+/* Evicts the tile with the largest zoom distance to the view among the least
+ * recently used ones, so that proxies of nearby zoom levels are retained.
+ */
+class ZoomAwareCachePolicy : public TileCachePolicy {
 public:
+    size_t window() const override { return 16; }
+
+    double score(const TileCacheEntry& _entry, size_t _age, float _viewZoom) const override {
+        double zoomDistance = std::abs(_entry.key.second.s - _viewZoom);
+        return zoomDistance * window() - double(_age);
+    }
+};
 
-    TileCache(size_t _cacheSizeMB) :
-        m_cacheUsage(0),
-        m_cacheMaxUsage(_cacheSizeMB) {}
+/* ARC-style policy: Protects tiles that were taken from the cache before (the
+ * frequency segment) and prefers evicting tiles that were only cached once.
+ */
+class FrequencyCachePolicy : public TileCachePolicy {
+public:
+    size_t window() const override { return 16; }
+
+    double score(const TileCacheEntry& _entry, size_t _age, float _viewZoom) const override {
+        return (_entry.reuses > 0 ? 0.0 : double(window())) - double(_age);
+    }
+};
+
+class TileCache {
+
+public:
+
+    TileCache(size_t _cacheSizeBytes) :
+        m_cacheMaxUsage(_cacheSizeBytes),
+        m_policy(std::make_unique<ZoomAwareCachePolicy>()) {}
+
+    void setPolicy(std::unique_ptr<TileCachePolicy> _policy) {
+        m_policy = std::move(_policy);
+        limitCacheSize(m_cacheMaxUsage);
+    }
+
+    /* Zoom of the current view, used by zoom-aware policies */
+    void setViewZoom(float _zoom) { m_viewZoom = _zoom; }
+
+    /* GPU and CPU bytes that cached tiles may keep, 0 for no limit. See applyResidency() */
+    void setResidencyLimits(uint64_t _gpuBytes, uint64_t _cpuBytes) {
+        m_gpuLimit = _gpuBytes;
+        m_cpuLimit = _cpuBytes;
+    }
+
+    /* From the least recently used tile on, move the meshes of cached tiles
+     * into CPU memory while the GPU limit is exceeded, and drop their tile
+     * data while the CPU limit is exceeded. Reads back meshes until _budget
+     * bytes are exceeded and returns the number of bytes read. Must be called
+     * on the GL thread. */
+    size_t applyResidency(RenderState& _rs, size_t _budget) {
+        size_t bytes = 0;
+
+        for (int32_t slot = m_tail; slot >= 0 && m_gpuLimit > 0 && m_gpuUsage > m_gpuLimit &&
+                 bytes < _budget; slot = m_entries[slot].prev) {
+            auto& entry = m_entries[slot];
+            if (entry.buffersReleased || entry.gpuBytes == 0) { continue; }
+
+            entry.buffersReleased = true;
+            size_t released = entry.tile->releaseGpuBuffers(_rs);
+            if (released == 0) { continue; }
+
+            bytes += released;
+            m_stats.releasedGpuBytes += released;
+            updateUsage(entry);
+        }
+
+        for (int32_t slot = m_tail; slot >= 0 && m_cpuLimit > 0 && m_cpuUsage > m_cpuLimit;
+             slot = m_entries[slot].prev) {
+            auto& entry = m_entries[slot];
+            if (!entry.tile->getTileData()) { continue; }
+
+            m_stats.releasedCpuBytes += entry.tile->releaseTileData();
+            updateUsage(entry);
+        }
+        return bytes;
+    }
 
     std::vector<TileID> put(int32_t _sourceId, std::shared_ptr<Tile> _tile) {
-        TileCacheKey k(_sourceId, _tile->getID());
+        TileCacheKey k(_sourceId, _tile->getID().withWrap(0));
+
+        auto it = m_cacheMap.find(k);
+        if (it != m_cacheMap.end()) {
+            removeEntry(it->second);
+            m_cacheMap.erase(it);
+        }
+
+        int32_t slot = allocEntry();
+        auto& entry = m_entries[slot];
+        entry.key = k;
+        entry.tile = std::move(_tile);
+        entry.gpuBytes = entry.tile->getMemoryUsage();
+        entry.cpuBytes = entry.tile->getCpuMemoryUsage();
+
+        auto ghost = m_reuses.find(k);
+        if (ghost != m_reuses.end()) {
+            entry.reuses = ghost->second;
+            m_reuses.erase(ghost);
+        }
 
-        m_cacheList.push_front({k, _tile});
-        m_cacheMap[k] = m_cacheList.begin();
-        m_cacheUsage += _tile->getMemoryUsage();
+        linkFront(slot);
+        m_cacheMap.emplace(k, slot);
+
+        m_gpuUsage += entry.gpuBytes;
+        m_cpuUsage += entry.cpuBytes;
 
         return limitCacheSize(m_cacheMaxUsage);
     }
 
     std::shared_ptr<Tile> get(int32_t _sourceId, TileID _tileId) {
         std::shared_ptr<Tile> tile;
-        TileCacheKey k(_sourceId, _tileId);
+        TileCacheKey k(_sourceId, _tileId.withWrap(0));
 
         auto it = m_cacheMap.find(k);
         if (it != m_cacheMap.end()) {
-            std::swap(tile, (*(it->second)).tile);
-            m_cacheList.erase(it->second);
+            auto& entry = m_entries[it->second];
+            std::swap(tile, entry.tile);
+
+            // Remember reuse in case the tile comes back (ARC ghost entry).
+            // Bounded to the number of cached tiles.
+            if (m_reuses.size() > m_cacheMap.size() * 2) { m_reuses.clear(); }
+            m_reuses[k] = entry.reuses + 1;
+
+            removeEntry(it->second);
             m_cacheMap.erase(it);
-            m_cacheUsage -= tile->getMemoryUsage();
+            m_stats.hits++;
+        } else {
+            m_stats.misses++;
         }
         return tile;
     }
 
     std::shared_ptr<Tile> contains(int32_t _source, TileID _tileID) {
-        std::shared_ptr<Tile> tile;
-        TileCacheKey k(_source, _tileID);
+        TileCacheKey k(_source, _tileID.withWrap(0));
 
         auto it = m_cacheMap.find(k);
         if (it != m_cacheMap.end()) {
-            return it->second->tile;
+            return m_entries[it->second].tile;
         }
         return nullptr;
     }
 
+    /* Call _fn with each cached tile of _sourceId */
+    template <typename Fn>
+    void forEachTile(int32_t _sourceId, Fn _fn) const {
+        for (auto& it : m_cacheMap) {
+            if (it.first.first == _sourceId) { _fn(*m_entries[it.second].tile); }
+        }
+    }
+
     std::vector<TileID> limitCacheSize(size_t _cacheSizeBytes) {
         std::vector<TileID> poppedTileIDs;
         m_cacheMaxUsage = _cacheSizeBytes;
 
-        while (m_cacheUsage > m_cacheMaxUsage) {
-            if (m_cacheList.empty()) {
+        while (getMemoryUsage() > m_cacheMaxUsage) {
+            if (m_tail < 0) {
                 LOGE("Invalid cache state!");
-                m_cacheUsage = 0;
+                m_gpuUsage = 0;
+                m_cpuUsage = 0;
                 break;
             }
-            auto& tile = m_cacheList.back().tile;
-            poppedTileIDs.push_back(tile->getID());
-            m_cacheUsage -= tile->getMemoryUsage();
-            m_cacheMap.erase(m_cacheList.back().key);
-            m_cacheList.pop_back();
+            int32_t victim = selectVictim();
+            auto& entry = m_entries[victim];
+
+            poppedTileIDs.push_back(entry.key.second);
+
+            m_stats.evictions++;
+            m_stats.evictedBytes += entry.gpuBytes + entry.cpuBytes;
+
+            m_cacheMap.erase(entry.key);
+            removeEntry(victim);
         }
         return poppedTileIDs;
     }
 
-    size_t getMemoryUsage() const {
-        size_t sum = 0;
-        for (auto& entry : m_cacheList) {
-            sum += entry.tile->getMemoryUsage();
+    /* Evict entries in descending order of _score(entry) until at least _bytes
+     * are freed. Adds the freed bytes to _freed and returns the evicted keys. */
+    template <typename Score>
+    std::vector<TileCacheKey> evict(size_t _bytes, Score _score, size_t& _freed) {
+        std::vector<std::pair<double, int32_t>> candidates;
+        candidates.reserve(m_cacheMap.size());
+        for (auto& it : m_cacheMap) {
+            candidates.emplace_back(_score(m_entries[it.second]), it.second);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        std::vector<TileCacheKey> evicted;
+        size_t freed = 0;
+        for (auto& candidate : candidates) {
+            if (freed >= _bytes) { break; }
+            auto& entry = m_entries[candidate.second];
+
+            freed += entry.gpuBytes + entry.cpuBytes;
+            evicted.push_back(entry.key);
+
+            m_stats.evictions++;
+            m_stats.evictedBytes += entry.gpuBytes + entry.cpuBytes;
+
+            m_cacheMap.erase(entry.key);
+            removeEntry(candidate.second);
+        }
+        _freed += freed;
+        return evicted;
+    }
+
+    /* Sum in bytes of GPU and CPU memory held by cached tiles */
+    uint64_t getMemoryUsage() const { return m_gpuUsage + m_cpuUsage; }
+
+    uint64_t getGpuMemoryUsage() const { return m_gpuUsage; }
+
+    uint64_t getCpuMemoryUsage() const { return m_cpuUsage; }
+
+    size_t size() const { return m_cacheMap.size(); }
+
+    TileCacheStats getStats() const {
+        TileCacheStats stats = m_stats;
+        stats.tiles = m_cacheMap.size();
+        stats.gpuBytes = m_gpuUsage;
+        stats.cpuBytes = m_cpuUsage;
+        stats.maxBytes = m_cacheMaxUsage;
+        return stats;
+    }
+
+    void resetStats() { m_stats = {}; }
+
+    void reportMemory(MemoryReport& _report) const {
+        for (auto& entry : m_entries) {
+            if (entry.tile && _report.count(entry.tile.get())) {
+                entry.tile->reportMemory(_report, _report.stats.tileCache);
+            }
         }
-        return sum;
     }
 
     void clear() {
         m_cacheMap.clear();
-        m_cacheList.clear();
-        m_cacheUsage = 0;
+        m_entries.clear();
+        m_freeEntries.clear();
+        m_reuses.clear();
+        m_head = m_tail = -1;
+        m_gpuUsage = 0;
+        m_cpuUsage = 0;
     }
 
 private:
-    CacheMap m_cacheMap;
-    CacheList m_cacheList;
 
-    int m_cacheUsage;
-    int m_cacheMaxUsage;
+    int32_t allocEntry() {
+        if (!m_freeEntries.empty()) {
+            int32_t slot = m_freeEntries.back();
+            m_freeEntries.pop_back();
+            return slot;
+        }
+        m_entries.emplace_back();
+        return int32_t(m_entries.size() - 1);
+    }
+
+    void linkFront(int32_t _slot) {
+        auto& entry = m_entries[_slot];
+        entry.prev = -1;
+        entry.next = m_head;
+        if (m_head >= 0) { m_entries[m_head].prev = _slot; }
+        m_head = _slot;
+        if (m_tail < 0) { m_tail = _slot; }
+    }
+
+    void unlink(int32_t _slot) {
+        auto& entry = m_entries[_slot];
+        if (entry.prev >= 0) { m_entries[entry.prev].next = entry.next; }
+        else { m_head = entry.next; }
+        if (entry.next >= 0) { m_entries[entry.next].prev = entry.prev; }
+        else { m_tail = entry.prev; }
+        entry.prev = entry.next = -1;
+    }
+
+    void updateUsage(TileCacheEntry& _entry) {
+        m_gpuUsage -= _entry.gpuBytes;
+        m_cpuUsage -= _entry.cpuBytes;
+        _entry.gpuBytes = _entry.tile->getMemoryUsage();
+        _entry.cpuBytes = _entry.tile->getCpuMemoryUsage();
+        m_gpuUsage += _entry.gpuBytes;
+        m_cpuUsage += _entry.cpuBytes;
+    }
+
+    // Unlink entry, release its accounting and return the slot to the pool.
+    // Does not touch m_cacheMap.
+    void removeEntry(int32_t _slot) {
+        auto& entry = m_entries[_slot];
+        unlink(_slot);
+        m_gpuUsage -= entry.gpuBytes;
+        m_cpuUsage -= entry.cpuBytes;
+        entry.tile.reset();
+        entry.gpuBytes = entry.cpuBytes = 0;
+        entry.reuses = 0;
+        entry.buffersReleased = false;
+        m_freeEntries.push_back(_slot);
+    }
+
+    int32_t selectVictim() const {
+        int32_t victim = m_tail;
+        double maxScore = std::numeric_limits<double>::lowest();
+        size_t window = std::max(size_t(1), m_policy->window());
+
+        size_t age = 0;
+        for (int32_t slot = m_tail; slot >= 0 && age < window; slot = m_entries[slot].prev, age++) {
+            double score = m_policy->score(m_entries[slot], age, m_viewZoom);
+            if (score > maxScore) {
+                maxScore = score;
+                victim = slot;
+            }
+        }
+        return victim;
+    }
+
+    hashmap<TileCacheKey, int32_t> m_cacheMap;
+
+    // Entry pool, slots of removed entries are reused
+    std::vector<TileCacheEntry> m_entries;
+    std::vector<int32_t> m_freeEntries;
+
+    // Most and least recently used entries
+    int32_t m_head = -1;
+    int32_t m_tail = -1;
+
+    // Reuse counts of tiles that were taken out of the cache
+    hashmap<TileCacheKey, uint32_t> m_reuses;
+
+    uint64_t m_gpuUsage = 0;
+    uint64_t m_cpuUsage = 0;
+    uint64_t m_cacheMaxUsage;
+
+    // Residency limits, 0 for none
+    uint64_t m_gpuLimit = 0;
+    uint64_t m_cpuLimit = 0;
+
+    float m_viewZoom = 0;
+
+    std::unique_ptr<TileCachePolicy> m_policy;
+
+    TileCacheStats m_stats;
 };
 
 }
@@ -2,16 +2,46 @@
 
 #include "tile/tileID.h"
 #include "util/hash.h"
+#include "util/hashmap.h"
+
+#include <cstdint>
+
+namespace Tangram {
+
+// All fields of _id packed into 64 bits and mixed with the splitmix64
+// finalizer, so that neighboring tiles spread over all bits. Packed keys of
+// tiles up to zoom 24 are unique, except for wraps that are 64 apart.
+inline uint64_t tileIdHash(const TileID& _id) {
+    uint64_t h = uint64_t(uint32_t(_id.x)) ^ (uint64_t(uint32_t(_id.y)) << 24);
+    h ^= (uint64_t(uint8_t(_id.z)) << 48) ^ (uint64_t(uint8_t(_id.s)) << 53) ^
+        (uint64_t(uint16_t(_id.wrap)) << 58);
+
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+template<>
+struct hashmap_key<TileID> {
+    static TileID empty() { return NOT_A_TILE; }
+    static TileID deleted() { return TileID(-2, -2, -2, -2, -2); }
+    static size_t hash(const TileID& _id) { return size_t(tileIdHash(_id)); }
+};
+
+// TileIDs of tile sets, sources and caches
+template<typename T>
+using TileIDMap = hashmap<TileID, T>;
+
+}
 
 namespace std {
     template <>
     struct hash<Tangram::TileID> {
         size_t operator()(const Tangram::TileID& k) const {
-            std::size_t seed = 0;
-            hash_combine(seed, k.x);
-            hash_combine(seed, k.y);
-            hash_combine(seed, k.z);
-            return seed;
+            return size_t(Tangram::tileIdHash(k));
         }
     };
 }
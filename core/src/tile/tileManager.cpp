@@ -1,21 +1,35 @@
 #include "tile/tileManager.h"
 
+#include "data/featureFilter.h"
 #include "data/tileSource.h"
+#include "debug/tileTrace.h"
 #include "map.h"
 #include "platform.h"
 #include "tile/tile.h"
 #include "tile/tileCache.h"
+#include "tile/tileTask.h"
 #include "util/mapProjection.h"
+#include "util/memoryReport.h"
 #include "view/view.h"
 
 #include "glm/gtx/norm.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #define DBG(...) // LOGD(__VA_ARGS__)
 
+// Base load priority of speculative tiles, lower values are loaded first
+#define PREFETCH_PRIORITY 1e18
+
+#define HALF_CIRCUMFERENCE_SQ (MapProjection::HALF_CIRCUMFERENCE * MapProjection::HALF_CIRCUMFERENCE)
+
 namespace Tangram {
 
+// Zoom levels above a tile whose rasters it may sample while its own load
+static constexpr int maxParentRasterLevels = 4;
+
 
 enum class TileManager::ProxyID : uint8_t {
     no_proxies = 0,
@@ -37,6 +51,13 @@ struct TileManager::TileEntry {
     std::shared_ptr<Tile> tile;
     std::shared_ptr<TileTask> task;
 
+    /* Built tile that waits in the upload queue */
+    std::shared_ptr<Tile> staged;
+
+    /* Task of a tile shown before its rasters were loaded, keeps the
+     * raster subtasks until all of them are ready */
+    std::shared_ptr<TileTask> rasterTask;
+
     /* A Counter for number of tiles this tile acts a proxy for */
     int32_t m_proxyCounter;
 
@@ -44,6 +65,12 @@ struct TileManager::TileEntry {
     uint8_t m_proxies;
     bool m_visible;
 
+    /* Ready but drawn by its proxies until the tiles of the view are ready */
+    bool m_held = false;
+
+    /* The labels of the tile need to be rebuilt, see TileManager::rebuildLabels */
+    bool m_rebuildLabels = false;
+
     bool isReady() {
         return bool(tile);
     }
@@ -56,8 +83,12 @@ struct TileManager::TileEntry {
         return bool(task) && task->isCanceled();
     }
 
+    bool isStaged() {
+        return bool(staged);
+    }
+
     bool needsLoading() {
-        if (bool(tile)) { return false; }
+        if (bool(tile) || bool(staged)) { return false; }
         if (!task) { return true; }
         if (task->isCanceled()) { return false; }
         if (task->needsLoading()) { return true; }
@@ -71,18 +102,160 @@ struct TileManager::TileEntry {
     // Complete task only when
     // - task still exists
     // - task has a tile ready
-    // - tile has all rasters set
-    bool completeTileTask() {
+    // - tile has all rasters set, unless _waitForRasters is false
+    // A tile with meshes to upload is staged and added to _uploads,
+    // the current tile remains until the upload is done.
+    bool completeTileTask(std::vector<std::weak_ptr<Tile>>& _uploads, bool _waitForRasters) {
         if (bool(task) && task->isReady()) {
 
+            bool rastersReady = true;
             for (auto& rTask : task->subTasks()) {
-                if (!rTask->isReady()) { return false; }
+                if (!rTask->isReady()) { rastersReady = false; }
             }
+            if (!rastersReady && _waitForRasters) { return false; }
+
+            // Rasters of a previous version of the tile are not needed anymore
+            cancelRasters();
 
-            task->complete();
-            tile = task->getTile();
+            std::shared_ptr<Tile> result;
+            if (rastersReady) {
+                task->complete();
+                result = task->getTile();
+            } else {
+                // Show the geometry, the rasters are added by completeRasters()
+                auto subTasks = std::move(task->subTasks());
+                task->subTasks().clear();
+                task->complete();
+                task->subTasks() = std::move(subTasks);
+
+                result = task->getTile();
+                if (result) {
+                    result->setRastersPending(true);
+                    addParentRasters(*result);
+                    rasterTask = task;
+                }
+            }
             task.reset();
 
+            if (result && !result->isUploaded()) {
+                staged = std::move(result);
+                _uploads.push_back(staged);
+                return false;
+            }
+            tile = std::move(result);
+            staged.reset();
+
+            return true;
+        }
+        return false;
+    }
+
+    // Let _tile sample the textures of parent rasters while task loads its own,
+    // when all raster sources have one
+    void addParentRasters(Tile& _tile) {
+        std::vector<Raster> parents;
+        for (auto& rTask : task->subTasks()) {
+            auto raster = rTask->source().parentRaster(rTask->tileId(), maxParentRasterLevels);
+            if (!raster.isValid()) { return; }
+            parents.push_back(std::move(raster));
+        }
+        for (auto& raster : parents) { _tile.rasters().push_back(std::move(raster)); }
+        _tile.setParentRasters(parents.size());
+    }
+
+    // Stage the first stage of a progressive build when there is no tile to
+    // show yet, it replaces the proxies once uploaded
+    void completePartialTile(std::vector<std::weak_ptr<Tile>>& _uploads) {
+        if (!isInProgress() || bool(tile) || bool(staged) || task->isReady()) { return; }
+
+        auto partial = task->getPartialTile();
+        if (!partial) { return; }
+
+        staged = std::move(partial);
+        _uploads.push_back(staged);
+    }
+
+    // Add the rasters of a tile which was completed before they were loaded.
+    // Returns the tile when its rasters are set and need upload.
+    std::shared_ptr<Tile> completeRasters() {
+        if (!rasterTask) { return nullptr; }
+
+        for (auto& rTask : rasterTask->subTasks()) {
+            if (!rTask->isReady()) { return nullptr; }
+        }
+
+        auto& target = bool(staged) ? staged : tile;
+        if (target && target->rastersPending()) {
+            for (size_t i = 0; i < target->parentRasters(); i++) { target->rasters().pop_back(); }
+            target->setParentRasters(0);
+
+            for (auto& rTask : rasterTask->subTasks()) {
+                rTask->complete(*target);
+            }
+            target->setRastersPending(false);
+        }
+        rasterTask.reset();
+
+        return target;
+    }
+
+    bool rastersPending() {
+        return bool(rasterTask);
+    }
+
+    // Whether loading the entry starts to load data of the task or its rasters
+    bool needsData() {
+        if (!task) { return rastersNeedLoading(); }
+        if (task->isCanceled()) { return false; }
+        if (task->needsLoading()) { return true; }
+        for (auto& subtask : task->subTasks()) {
+            if (subtask->needsLoading()) { return true; }
+        }
+        return false;
+    }
+
+    // Whether data of the task or its rasters is requested and did not arrive yet
+    bool isLoading() {
+        auto loading = [](auto& _task) {
+            return !_task->isCanceled() && !_task->needsLoading() && !_task->hasData();
+        };
+        if (task) {
+            if (loading(task)) { return true; }
+            for (auto& subtask : task->subTasks()) {
+                if (loading(subtask)) { return true; }
+            }
+        }
+        if (rasterTask) {
+            for (auto& subtask : rasterTask->subTasks()) {
+                if (loading(subtask)) { return true; }
+            }
+        }
+        return false;
+    }
+
+    // Raster subtasks of rasterTask which were canceled by their DataSource
+    bool rastersNeedLoading() {
+        if (!rasterTask) { return false; }
+        for (auto& rTask : rasterTask->subTasks()) {
+            if (rTask->needsLoading()) { return true; }
+        }
+        return false;
+    }
+
+    void cancelRasters() {
+        if (rasterTask) {
+            for (auto& raster : rasterTask->subTasks()) {
+                raster->cancel();
+                raster->source().cancelLoadingTile(raster->tileId());
+            }
+            rasterTask.reset();
+        }
+    }
+
+    // Make the staged tile ready once all its meshes are uploaded
+    bool completeUpload() {
+        if (bool(staged) && staged->isUploaded()) {
+            tile = std::move(staged);
             return true;
         }
         return false;
@@ -98,6 +271,7 @@ struct TileManager::TileEntry {
 
             task.reset();
         }
+        cancelRasters();
     }
 
     /* Methods to set and get proxy counter */
@@ -137,7 +311,11 @@ struct TileManager::TileEntry {
 TileManager::TileSet::TileSet(std::shared_ptr<TileSource> _source, bool _clientSource) :
     source(_source), clientTileSource(_clientSource) {}
 
-TileManager::TileSet::~TileSet() {}
+TileManager::TileSet::~TileSet() {
+    for (auto& it : prefetchTasks) {
+        it.second->cancel();
+    }
+}
 
 TileManager::TileManager(std::shared_ptr<Platform> platform, TileTaskQueue& _tileWorker) :
     m_workers(_tileWorker) {
@@ -147,6 +325,8 @@ TileManager::TileManager(std::shared_ptr<Platform> platform, TileTaskQueue& _til
     // Callback to pass task from Download-Thread to Worker-Queue
     m_dataCallback = TileTaskCb{[this, platform](std::shared_ptr<TileTask> task) {
 
+        TILE_TRACE_END("load", task->tileId(), task->source().id());
+
         if (task->isReady()) {
              platform->requestRender();
 
@@ -163,8 +343,45 @@ TileManager::~TileManager() {
     m_tileSets.clear();
 }
 
+std::map<TileID, std::shared_ptr<const TileData>> TileManager::collectTileData(const TileSet& _tileSet,
+                                                                             const TileSource& _source) {
+
+    std::map<TileID, std::shared_ptr<const TileData>> data;
+    if (!_tileSet.source->retainTileData()) { return data; }
+
+    auto filter = _source.featureFilter();
+
+    auto add = [&](const Tile& _tile) {
+        auto& tileData = _tile.getTileData();
+        if (tileData && _tile.sourceGeneration() == _tileSet.source->generation() &&
+            FeatureFilter::covers(tileData->featureFilter.get(), filter.get())) {
+            data.emplace(_tile.getID(), tileData);
+        }
+    };
+    for (auto& it : _tileSet.tiles) {
+        if (it.second.tile) { add(*it.second.tile); }
+        if (it.second.staged) { add(*it.second.staged); }
+    }
+    m_tileCache->forEachTile(_tileSet.source->id(), add);
+
+    return data;
+}
+
 void TileManager::setTileSources(const std::vector<std::shared_ptr<TileSource>>& _sources) {
 
+    // Keep the parsed data of sources that have an equivalent in the new scene
+    std::vector<std::pair<std::shared_ptr<TileSource>,
+                          std::map<TileID, std::shared_ptr<const TileData>>>> retained;
+    for (auto& tileSet : m_tileSets) {
+        if (tileSet.clientTileSource) { continue; }
+        for (const auto& source : _sources) {
+            if (source->canReuseTileData(*tileSet.source)) {
+                retained.emplace_back(source, collectTileData(tileSet, *source));
+                break;
+            }
+        }
+    }
+
     m_tileCache->clear();
 
     // Remove all (non-client datasources) sources and respective tileSets not present in the
@@ -194,6 +411,13 @@ void TileManager::setTileSources(const std::vector<std::shared_ptr<TileSource>>&
                          }) == m_tileSets.end()) {
             LOGN("add source %s", source->name().c_str());
             m_tileSets.push_back({ source, false });
+            m_visibleTilesDirty = true;
+
+            for (auto& data : retained) {
+                if (data.first == source) {
+                    m_tileSets.back().retainedData = std::move(data.second);
+                }
+            }
         } else {
             LOGW("Duplicate named datasource (not added): %s", source->name().c_str());
         }
@@ -211,6 +435,7 @@ std::shared_ptr<TileSource> TileManager::getClientTileSource(int32_t sourceID) {
 
 void TileManager::addClientTileSource(std::shared_ptr<TileSource> _tileSource) {
     m_tileSets.push_back({ _tileSource, true });
+    m_visibleTilesDirty = true;
 }
 
 bool TileManager::removeClientTileSource(TileSource& _tileSource) {
@@ -231,8 +456,17 @@ bool TileManager::removeClientTileSource(TileSource& _tileSource) {
 
 void TileManager::clearTileSets(bool clearSourceCaches) {
     for (auto& tileSet : m_tileSets) {
+        if (!clearSourceCaches) {
+            tileSet.retainedData = collectTileData(tileSet, *tileSet.source);
+        }
+
         tileSet.tiles.clear();
 
+        for (auto& it : tileSet.prefetchTasks) {
+            cancelPrefetchTask(tileSet, it.first, *it.second);
+        }
+        tileSet.prefetchTasks.clear();
+
         if (clearSourceCaches) {
             tileSet.source->clearData();
         }
@@ -251,29 +485,67 @@ void TileManager::clearTileSet(int32_t _sourceId) {
     m_tileSetChanged = true;
 }
 
-void TileManager::updateTileSets(const View& _view) {
+void TileManager::rebuildLabels() {
+    for (auto& tileSet : m_tileSets) {
+        for (auto& it : tileSet.tiles) {
+            auto& entry = it.second;
+
+            // Tasks and staged tiles were built for the previous state.
+            // The rasters of a shown tile are still needed.
+            if (entry.task) {
+                for (auto& raster : entry.task->subTasks()) { raster->cancel(); }
+                entry.task->subTasks().clear();
+                entry.task->cancel();
+                entry.task.reset();
+            }
+            entry.staged.reset();
 
-    m_tiles.clear();
-    m_tilesInProgress = 0;
-    m_tileSetChanged = false;
+            // Copies for other wraps of the world have no labels
+            entry.m_rebuildLabels = entry.isReady() && !entry.tile->isWrapCopy();
+        }
 
-    if (!getDebugFlag(DebugFlags::freeze_tiles)) {
+        for (auto& it : tileSet.prefetchTasks) {
+            cancelPrefetchTask(tileSet, it.first, *it.second);
+        }
+        tileSet.prefetchTasks.clear();
+    }
 
-        for (auto& tileSet : m_tileSets) {
-            tileSet.visibleTiles.clear();
+    m_tileCache->clear();
+    m_tileSetChanged = true;
+}
+
+std::shared_ptr<TileTask> TileManager::createLabelsTask(TileSet& _tileSet, const TileID& _tileID,
+                                                        const std::shared_ptr<Tile>& _tile) {
+
+    auto task = _tileSet.source->createTask(_tileID);
+
+    // The rasters of _tile are kept
+    for (auto& raster : task->subTasks()) { raster->cancel(); }
+    task->subTasks().clear();
+
+    task->rebuildLabelsOf(_tile);
+
+    // Rebuild from the data retained by the tile without loading
+    if (auto& tileData = _tile->getTileData()) {
+        if (auto binaryTask = dynamic_cast<BinaryTileTask*>(task.get())) {
+            binaryTask->parsedTileData = tileData;
+            binaryTask->startedLoading();
         }
+    }
+    return task;
+}
+
+void TileManager::updateTileSets(const View& _view) {
 
-        auto tileCb = [&, zoom = _view.getZoom()](TileID _tileID){
-            for (auto& tileSet : m_tileSets) {
-                auto zoomBias = tileSet.source->zoomBias();
-                auto maxZoom = tileSet.source->maxZoom();
+    m_tiles.clear();
+    m_tilesInProgress = 0;
+    m_tileSetChanged = false;
 
-                // Insert scaled and maxZoom mapped tileID in the visible set
-                tileSet.visibleTiles.insert(_tileID.zoomBiasAdjusted(zoomBias).withMaxSourceZoom(maxZoom));
-            }
-        };
+    m_tileCache->setViewZoom(_view.getZoom());
 
-        _view.getVisibleTiles(tileCb);
+    if (!getDebugFlag(DebugFlags::freeze_tiles) &&
+        (_view.changedOnLastUpdate() || m_visibleTilesDirty)) {
+        updateVisibleTiles(_view);
     }
 
     for (auto& tileSet : m_tileSets) {
@@ -297,6 +569,48 @@ void TileManager::updateTileSets(const View& _view) {
     m_tiles.erase(std::unique(m_tiles.begin(), m_tiles.end()), m_tiles.end());
 }
 
+void TileManager::updateVisibleTiles(const View& _view) {
+
+    m_visibleTilesDirty = false;
+
+    for (auto& tileSet : m_tileSets) {
+        std::swap(tileSet.previousTiles, tileSet.visibleTiles);
+        tileSet.visibleTiles.clear();
+    }
+
+    auto tileCb = [&](TileID _tileID){
+        for (auto& tileSet : m_tileSets) {
+            auto zoomBias = tileSet.source->zoomBias();
+            auto maxZoom = tileSet.source->maxZoom();
+
+            // Insert scaled and maxZoom mapped tileID in the visible set
+            tileSet.visibleTiles.push_back(_tileID.zoomBiasAdjusted(zoomBias).withMaxSourceZoom(maxZoom));
+        }
+    };
+
+    _view.getVisibleTiles(tileCb);
+
+    for (auto& tileSet : m_tileSets) {
+        auto& visible = tileSet.visibleTiles;
+
+        // Zoom bias and max zoom mapping can produce duplicate TileIDs
+        std::sort(visible.begin(), visible.end());
+        visible.erase(std::unique(visible.begin(), visible.end()), visible.end());
+
+        auto& previous = tileSet.previousTiles;
+
+        tileSet.enteringTiles.clear();
+        std::set_difference(visible.begin(), visible.end(),
+                            previous.begin(), previous.end(),
+                            std::back_inserter(tileSet.enteringTiles));
+
+        tileSet.leavingTiles.clear();
+        std::set_difference(previous.begin(), previous.end(),
+                            visible.begin(), visible.end(),
+                            std::back_inserter(tileSet.leavingTiles));
+    }
+}
+
 void TileManager::updateTileSet(TileSet& _tileSet, const ViewState& _view) {
 
     bool newTiles = false;
@@ -313,19 +627,60 @@ void TileManager::updateTileSet(TileSet& _tileSet, const ViewState& _view) {
     std::vector<TileID> removeTiles;
     auto& tiles = _tileSet.tiles;
 
-    // Check for ready tasks, move Tile to active TileSet and unset Proxies.
+    // Check for ready tasks and uploaded tiles, move Tile to active TileSet
+    // and unset Proxies. Tiles with meshes to upload are staged first, their
+    // proxies remain until the upload is done.
+    bool waitForRasters = _tileSet.source->waitForRasters();
+    _tileSet.loadingTiles = 0;
+
     for (auto& it : tiles) {
         auto& entry = it.second;
-        if (entry.completeTileTask()) {
-            clearProxyTiles(_tileSet, it.first, entry, removeTiles);
+        entry.completePartialTile(m_uploadQueue);
+        if (entry.isLoading()) { _tileSet.loadingTiles++; }
+
+        if (entry.completeTileTask(m_uploadQueue, waitForRasters) || entry.completeUpload()) {
+            TILE_TRACE_INSTANT("ready", it.first, _tileSet.source->id());
 
+            if (m_holdProxies && hasReadyZoomStepProxy(_tileSet, it.first, entry)) {
+                if (!entry.m_held) {
+                    entry.m_held = true;
+                    _tileSet.heldTiles.push_back(it.first);
+                }
+            } else {
+                clearProxyTiles(_tileSet, it.first, entry, removeTiles);
+
+                newTiles = true;
+                m_tileSetChanged = true;
+            }
+        }
+        if (auto rasterTile = entry.completeRasters()) {
+            if (!rasterTile->isUploaded()) { m_uploadQueue.push_back(rasterTile); }
             newTiles = true;
-            m_tileSetChanged = true;
         }
     }
 
     const auto& visibleTiles = _tileSet.visibleTiles;
 
+    // Show the held tiles once all visible tiles are ready
+    if (!_tileSet.heldTiles.empty() &&
+        (!m_holdProxies || std::all_of(visibleTiles.begin(), visibleTiles.end(), [&](auto& _id) {
+                auto it = tiles.find(_id);
+                return it != tiles.end() && it->second.isReady();
+            }))) {
+
+        for (auto& id : _tileSet.heldTiles) {
+            auto it = tiles.find(id);
+            if (it == tiles.end() || !it->second.m_held) { continue; }
+
+            it->second.m_held = false;
+            clearProxyTiles(_tileSet, id, it->second, removeTiles);
+        }
+        _tileSet.heldTiles.clear();
+
+        newTiles = true;
+        m_tileSetChanged = true;
+    }
+
     // Loop over visibleTiles and add any needed tiles to tileSet
     auto curTilesIt = tiles.begin();
     auto visTilesIt = visibleTiles.begin();
@@ -348,16 +703,28 @@ void TileManager::updateTileSet(TileSet& _tileSet, const ViewState& _view) {
             auto& entry = curTilesIt->second;
             entry.setVisible(true);
 
-            auto sourceGeneration = (entry.isReady()) ?
-                entry.tile->sourceGeneration() : entry.task->sourceGeneration();
+            auto sourceGeneration = entry.isStaged() ? entry.staged->sourceGeneration() :
+                entry.isReady() ? entry.tile->sourceGeneration() : entry.task->sourceGeneration();
 
             if (entry.isReady()) {
-                m_tiles.push_back(entry.tile);
+                if (!entry.m_held) { m_tiles.push_back(entry.tile); }
 
                 if (!entry.isInProgress() &&
                     (sourceGeneration < generation)) {
                     // Tile needs update - enqueue for loading
                     entry.task = _tileSet.source->createTask(visTileId);
+                    entry.m_rebuildLabels = false;
+                    enqueueTask(_tileSet, visTileId, _view);
+                } else if (!entry.isInProgress() && entry.m_rebuildLabels &&
+                           !entry.rastersPending()) {
+                    // Completing the task drops pending rasters, wait for them
+                    entry.task = createLabelsTask(_tileSet, visTileId, entry.tile);
+                    entry.m_rebuildLabels = false;
+                    enqueueTask(_tileSet, visTileId, _view);
+                } else if (!entry.isInProgress() && entry.rastersNeedLoading()) {
+                    enqueueTask(_tileSet, visTileId, _view);
+                } else if (entry.isInProgress() && entry.needsData()) {
+                    // Not loaded on an earlier update, over the load limits
                     enqueueTask(_tileSet, visTileId, _view);
                 }
             } else if (entry.needsLoading()) {
@@ -371,7 +738,7 @@ void TileManager::updateTileSet(TileSet& _tileSet, const ViewState& _view) {
                 enqueueTask(_tileSet, visTileId, _view);
             }
 
-            if (entry.isInProgress()) {
+            if (entry.isInProgress() || entry.isStaged()) {
                 m_tilesInProgress++;
             }
 
@@ -475,35 +842,98 @@ void TileManager::updateTileSet(TileSet& _tileSet, const ViewState& _view) {
             entry.tile->setProxyState(entry.getProxyCounter() > 0);
         }
     }
+
+    // Retained data of tiles that did not come back into view
+    _tileSet.retainedData.clear();
 }
 
 void TileManager::enqueueTask(TileSet& _tileSet, const TileID& _tileID,
                               const ViewState& _view) {
 
-    // Keep the items sorted by distance
     auto tileCenter = _view.mapProjection->TileCenter(_tileID);
     double distance = glm::length2(tileCenter - _view.center);
 
-    auto it = std::upper_bound(m_loadTasks.begin(), m_loadTasks.end(), distance,
-                               [](auto& distance, auto& other){
-                                   return distance < std::get<0>(other);
-                               });
+    m_loadTasks.emplace_back(distance, &_tileSet, _tileID);
 
-    m_loadTasks.insert(it, std::make_tuple(distance, &_tileSet, _tileID));
+    TILE_TRACE_INSTANT("enqueue", _tileID, _tileSet.source->id());
 }
 
 void TileManager::loadTiles() {
 
     if (m_loadTasks.empty()) { return; }
 
-    for (auto& loadTask : m_loadTasks) {
+    // The tasks of a TileSet are enqueued together on its update
+    m_sourceLoads.clear();
+    int loading = 0;
+
+    for (auto it = m_loadTasks.begin(); it != m_loadTasks.end();) {
+        auto* tileSet = std::get<1>(*it);
+        auto end = std::find_if(it, m_loadTasks.end(), [&](auto& _task) {
+                return std::get<1>(_task) != tileSet;
+            });
+
+        int limit = tileSet->source->maxLoadingTiles();
+        if (limit <= 0) { limit = m_maxLoadingTilesPerSource; }
+        if (tileSet->clientTileSource) { limit = 0; }
+
+        m_sourceLoads.push_back({ tileSet, it, it, end, tileSet->loadingTiles, limit,
+                                  tileSet->source->loadWeight() });
+        loading += tileSet->loadingTiles;
+        it = end;
+    }
+
+    auto nearer = [](auto& _a, auto& _b) { return std::get<0>(_a) < std::get<0>(_b); };
+
+    while (true) {
+        bool full = m_maxLoadingTiles > 0 && loading >= m_maxLoadingTiles;
+
+        // Next the source with the fewest loading tiles for its weight
+        SourceLoads* loads = nullptr;
+        for (auto& source : m_sourceLoads) {
+            if (source.next == source.end) { continue; }
+            if (source.limit > 0 && source.loading >= source.limit) { continue; }
+            if (full && !source.tileSet->clientTileSource) { continue; }
+
+            if (!loads || source.loading * loads->weight < loads->loading * source.weight) {
+                loads = &source;
+            }
+        }
+        if (!loads) { break; }
+
+        // Select the nearest tasks that can start, instead of sorting all of them
+        if (loads->next == loads->sorted) {
+            auto count = loads->end - loads->next;
+            if (loads->limit > 0) {
+                count = std::min<ptrdiff_t>(count, loads->limit - loads->loading);
+            }
+            if (m_maxLoadingTiles > 0 && !loads->tileSet->clientTileSource) {
+                count = std::min<ptrdiff_t>(count, m_maxLoadingTiles - loading);
+            }
+            loads->sorted = loads->next + std::max<ptrdiff_t>(count, 1);
+            std::partial_sort(loads->next, loads->sorted, loads->end, nearer);
+        }
 
-        auto tileId = std::get<2>(loadTask);
-        auto& tileSet = *std::get<1>(loadTask);
-        auto tileIt = tileSet.tiles.find(tileId);
+        auto& tileSet = *loads->tileSet;
+        auto tileIt = tileSet.tiles.find(std::get<2>(*loads->next));
+        ++loads->next;
         auto& entry = tileIt->second;
 
-        tileSet.source->loadTileData(entry.task, m_dataCallback);
+        bool loaded = entry.isLoading();
+
+        if (entry.task) {
+            tileSet.source->loadTileData(entry.task, m_dataCallback);
+        } else if (entry.rasterTask) {
+            // Only the rasters of a tile which is shown already
+            for (auto& subTask : entry.rasterTask->subTasks()) {
+                subTask->source().loadTileData(subTask, m_dataCallback);
+            }
+        }
+
+        // Tiles with data in place, e.g. from a memory cache, don't count
+        if (!loaded && entry.isLoading()) {
+            loads->loading++;
+            loading++;
+        }
     }
 
     DBG("loading:%d pending:%d cache: %fMB",
@@ -513,14 +943,141 @@ void TileManager::loadTiles() {
     m_loadTasks.clear();
 }
 
+void TileManager::updatePrefetch(const View* _predictedView) {
+
+    for (auto& tileSet : m_tileSets) {
+        collectPrefetchTasks(tileSet);
+    }
+
+    if (!_predictedView || m_prefetchBudget <= 0) { return; }
+
+    // Visible tiles take precedence: Drop network requests of prefetch tasks
+    // when visible tiles use up the budget.
+    int available = m_prefetchBudget - m_tilesInProgress;
+
+    if (available <= 0) {
+        for (auto& tileSet : m_tileSets) {
+            auto& tasks = tileSet.prefetchTasks;
+            for (auto it = tasks.begin(); it != tasks.end();) {
+                if (!it->second->hasData()) {
+                    cancelPrefetchTask(tileSet, it->first, *it->second);
+                    it = tasks.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return;
+    }
+
+    for (auto& tileSet : m_tileSets) {
+        available -= tileSet.prefetchTasks.size();
+    }
+
+    auto state = _predictedView->state();
+
+    for (auto& tileSet : m_tileSets) {
+        if (!tileSet.source->isActiveForZoom(_predictedView->getZoom())) { continue; }
+
+        auto zoomBias = tileSet.source->zoomBias();
+        auto maxZoom = tileSet.source->maxZoom();
+
+        m_prefetchTiles.clear();
+        _predictedView->getVisibleTiles([&](TileID _tileID) {
+                m_prefetchTiles.push_back(_tileID.zoomBiasAdjusted(zoomBias).withMaxSourceZoom(maxZoom));
+            });
+
+        std::sort(m_prefetchTiles.begin(), m_prefetchTiles.end());
+        m_prefetchTiles.erase(std::unique(m_prefetchTiles.begin(), m_prefetchTiles.end()),
+                              m_prefetchTiles.end());
+
+        // Cancel prefetch tasks that are no longer on the predicted path
+        auto& tasks = tileSet.prefetchTasks;
+        for (auto it = tasks.begin(); it != tasks.end();) {
+            if (!std::binary_search(m_prefetchTiles.begin(), m_prefetchTiles.end(), it->first)) {
+                cancelPrefetchTask(tileSet, it->first, *it->second);
+                it = tasks.erase(it);
+                available++;
+            } else {
+                ++it;
+            }
+        }
+
+        for (auto& tileID : m_prefetchTiles) {
+            if (available <= 0) { break; }
+
+            if (tileSet.tiles.find(tileID) != tileSet.tiles.end() ||
+                tasks.find(tileID) != tasks.end() ||
+                m_tileCache->contains(tileSet.source->id(), tileID)) {
+                continue;
+            }
+
+            auto task = tileSet.source->createTask(tileID);
+
+            // Order behind all visible tiles, which have a priority of
+            // (at most) the squared distance to the view center.
+            auto tileCenter = state.mapProjection->TileCenter(tileID);
+            double distance = glm::length2(tileCenter - state.center) / HALF_CIRCUMFERENCE_SQ;
+            task->setPriority(PREFETCH_PRIORITY * (1.0 + distance));
+
+            tasks.emplace(tileID, task);
+            tileSet.source->loadTileData(task, m_dataCallback);
+            available--;
+        }
+    }
+}
+
+void TileManager::collectPrefetchTasks(TileSet& _tileSet) {
+
+    auto& tasks = _tileSet.prefetchTasks;
+
+    for (auto it = tasks.begin(); it != tasks.end();) {
+        auto& task = it->second;
+
+        if (task->isCanceled()) {
+            it = tasks.erase(it);
+            continue;
+        }
+
+        bool ready = task->isReady();
+        for (auto& subTask : task->subTasks()) {
+            ready &= subTask->isReady();
+        }
+
+        if (!ready) {
+            ++it;
+            continue;
+        }
+
+        task->complete();
+
+        std::shared_ptr<Tile> tile = task->getTile();
+        if (tile) {
+            auto poppedTiles = m_tileCache->put(_tileSet.source->id(), tile);
+            for (auto& tileID : poppedTiles) {
+                _tileSet.source->clearRaster(tileID);
+            }
+        }
+        it = tasks.erase(it);
+    }
+}
+
+void TileManager::cancelPrefetchTask(TileSet& _tileSet, const TileID& _tileID, TileTask& _task) {
+    for (auto& subTask : _task.subTasks()) {
+        subTask->cancel();
+    }
+    _task.cancel();
+
+    _tileSet.source->cancelLoadingTile(_tileID);
+    _tileSet.source->clearRaster(_tileID);
+}
+
 bool TileManager::addTile(TileSet& _tileSet, const TileID& _tileID) {
 
     auto tile = m_tileCache->get(_tileSet.source->id(), _tileID);
 
     if (tile) {
         if (tile->sourceGeneration() == _tileSet.source->generation()) {
-            m_tiles.push_back(tile);
-
             // Update tile origin based on wrap (set in the new tileID)
             tile->updateTileOrigin(_tileID.wrap);
 
@@ -533,20 +1090,101 @@ bool TileManager::addTile(TileSet& _tileSet, const TileID& _tileID) {
         }
     }
 
+    // Share the meshes of the tile in another copy of the world
+    if (!tile) { tile = copyWrappedTile(_tileSet, _tileID); }
+
     // Add TileEntry to TileSet
     auto entry = _tileSet.tiles.emplace(_tileID, tile);
 
-    if (!tile) {
+    if (tile) {
+        if (tile->isUploaded()) {
+            m_tiles.push_back(tile);
+        } else {
+            // Prefetched tiles were not drawn yet
+            stageTile(entry.first->second);
+            updateProxyTiles(_tileSet, _tileID, entry.first->second);
+        }
+    } else {
         // Add Proxy if corresponding proxy MapTile ready
         updateProxyTiles(_tileSet, _tileID, entry.first->second);
 
-        entry.first->second.task = _tileSet.source->createTask(_tileID);
+        // Take over a running prefetch task for this tile
+        auto prefetch = _tileSet.prefetchTasks.find(_tileID);
+        if (prefetch != _tileSet.prefetchTasks.end()) {
+            if (!prefetch->second->isCanceled()) {
+                entry.first->second.task = std::move(prefetch->second);
+            }
+            _tileSet.prefetchTasks.erase(prefetch);
+        }
+
+        if (!entry.first->second.task) {
+            auto task = _tileSet.source->createTask(_tileID);
+
+            // Rebuild from retained data, the task goes to the workers without loading
+            auto retained = _tileSet.retainedData.find(_tileID);
+            if (retained != _tileSet.retainedData.end()) {
+                if (auto binaryTask = dynamic_cast<BinaryTileTask*>(task.get())) {
+                    binaryTask->parsedTileData = std::move(retained->second);
+                    binaryTask->startedLoading();
+                }
+                _tileSet.retainedData.erase(retained);
+            }
+            entry.first->second.task = std::move(task);
+        }
     }
     entry.first->second.setVisible(true);
 
     return bool(tile);
 }
 
+std::shared_ptr<Tile> TileManager::copyWrappedTile(const TileSet& _tileSet, const TileID& _tileID) const {
+
+    auto generation = _tileSet.source->generation();
+
+    // Wraps are the last key of the TileID order, other wraps are adjacent
+    for (auto it = _tileSet.tiles.lower_bound(_tileID.withWrap(std::numeric_limits<int16_t>::min()));
+         it != _tileSet.tiles.end() && it->first.withWrap(0) == _tileID.withWrap(0); ++it) {
+
+        auto& tile = it->second.tile;
+        if (it->first.wrap != _tileID.wrap && tile &&
+            tile->sourceGeneration() == generation && !tile->rastersPending()) {
+            return tile->copyForWrap(_tileID.wrap);
+        }
+    }
+    return nullptr;
+}
+
+void TileManager::stageTile(TileEntry& _entry) {
+    _entry.staged = std::move(_entry.tile);
+    m_uploadQueue.push_back(_entry.staged);
+}
+
+size_t TileManager::uploadTiles(RenderState& _rs, size_t _maxBytes) {
+
+    size_t budget = m_uploadBudget > 0 ? m_uploadBudget : std::numeric_limits<size_t>::max();
+    if (_maxBytes > 0) { budget = std::min(budget, _maxBytes); }
+    size_t bytes = 0;
+
+    auto it = m_uploadQueue.begin();
+    while (it != m_uploadQueue.end() && bytes < budget) {
+        auto tile = it->lock();
+        if (tile) {
+            TILE_TRACE_SPAN("upload", tile->getID(), tile->sourceID());
+            bytes += tile->upload(_rs, budget - bytes);
+            if (!tile->isUploaded()) { break; }
+        }
+        ++it;
+    }
+    m_uploadQueue.erase(m_uploadQueue.begin(), it);
+
+    // Reading back meshes of cached tiles shares the budget, but is not
+    // counted as uploaded: nothing that is drawn changes
+    if (bytes < budget) { m_tileCache->applyResidency(_rs, budget - bytes); }
+
+    m_uploadedBytes = bytes;
+    return bytes;
+}
+
 void TileManager::removeTile(TileSet& _tileSet, std::map<TileID, TileEntry>::iterator& _tileIt) {
 
     auto& id = _tileIt->first;
@@ -560,11 +1198,16 @@ void TileManager::removeTile(TileSet& _tileSet, std::map<TileID, TileEntry>::ite
         //  the network request associated with this tile.
         _tileSet.source->cancelLoadingTile(id);
 
-    } else if (entry.isReady()) {
-        // Add to cache
-        auto poppedTiles = m_tileCache->put(_tileSet.source->id(), entry.tile);
-        for (auto& tileID : poppedTiles) {
-            _tileSet.source->clearRaster(tileID);
+    } else if (entry.isReady() || entry.isStaged()) {
+        // Add to cache, a staged tile is newer than the current one
+        auto& tile = entry.isStaged() ? entry.staged : entry.tile;
+        // A tile without its rasters would be shown from the cache as is.
+        // Copies of other wraps are not cached, the tile they share is.
+        if (!tile->rastersPending() && !tile->isWrapCopy()) {
+            auto poppedTiles = m_tileCache->put(_tileSet.source->id(), tile);
+            for (auto& tileID : poppedTiles) {
+                _tileSet.source->clearRaster(tileID);
+            }
         }
     }
 
@@ -612,7 +1255,11 @@ bool TileManager::updateProxyTile(TileSet& _tileSet, TileEntry& _tile,
             auto& entry = result.first->second;
             entry.incProxyCounter();
 
-            m_tiles.push_back(proxyTile);
+            if (proxyTile->isUploaded()) {
+                m_tiles.push_back(proxyTile);
+            } else {
+                stageTile(entry);
+            }
             return true;
         }
     }
@@ -649,6 +1296,27 @@ void TileManager::updateProxyTiles(TileSet& _tileSet, const TileID& _tileID, Til
     }
 }
 
+bool TileManager::hasReadyZoomStepProxy(TileSet& _tileSet, const TileID& _tileID, TileEntry& _tile) {
+    auto& tiles = _tileSet.tiles;
+
+    auto isReady = [&tiles](const TileID& _id) {
+        auto it = tiles.find(_id);
+        return it != tiles.end() && it->second.isReady();
+    };
+
+    if ((_tile.m_proxies & uint8_t(ProxyID::parent)) &&
+        isReady(_tileID.getParent(_tileSet.source->zoomBias()))) {
+        return true;
+    }
+    for (int i = 0; i < 4; i++) {
+        if ((_tile.m_proxies & (1 << i)) &&
+            isReady(_tileID.getChild(i, _tileSet.source->maxZoom()))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void TileManager::clearProxyTiles(TileSet& _tileSet, const TileID& _tileID, TileEntry& _tile,
                                   std::vector<TileID>& _removes) {
     auto& tiles = _tileSet.tiles;
@@ -690,4 +1358,53 @@ void TileManager::setCacheSize(size_t _cacheSize) {
     m_tileCache->limitCacheSize(_cacheSize);
 }
 
+void TileManager::setCacheResidency(size_t _gpuBytes, size_t _cpuBytes) {
+    m_tileCache->setResidencyLimits(_gpuBytes, _cpuBytes);
+}
+
+void TileManager::reportMemory(MemoryReport& _report) const {
+    for (auto& tileSet : m_tileSets) {
+        if (_report.count(tileSet.source.get())) { tileSet.source->reportMemory(_report); }
+
+        for (auto& it : tileSet.tiles) {
+            for (auto* tile : { it.second.tile.get(), it.second.staged.get() }) {
+                if (tile && _report.count(tile)) { tile->reportMemory(_report, _report.stats.tiles); }
+            }
+        }
+    }
+
+    m_tileCache->reportMemory(_report);
+}
+
+size_t TileManager::releaseCachedTiles(const View& _view, size_t _bytes) {
+    const auto& projection = _view.getMapProjection();
+    glm::dvec2 center(_view.getPosition().x, _view.getPosition().y);
+    double zoom = _view.getZoom();
+
+    auto world = projection.TileBounds(TileID(0, 0, 0));
+    double worldSize = world.width();
+    double viewTileSize = worldSize / std::exp2(zoom);
+
+    auto distance = [&](const TileCacheEntry& _entry) {
+        const auto& id = _entry.key.second;
+        glm::dvec2 d = glm::abs(projection.TileCenter(id) - center);
+        // Closest of the wrapped copies
+        d.x = std::min(d.x, worldSize - d.x);
+        return glm::length(d) / viewTileSize + std::abs(id.s - zoom);
+    };
+
+    size_t freed = 0;
+    auto evicted = m_tileCache->evict(_bytes, distance, freed);
+
+    for (auto& key : evicted) {
+        for (auto& tileSet : m_tileSets) {
+            if (tileSet.source->id() == key.first) {
+                tileSet.source->clearRaster(key.second);
+                break;
+            }
+        }
+    }
+    return freed;
+}
+
 }
@@ -11,13 +11,14 @@
 #include <memory>
 #include <mutex>
 #include <tuple>
-#include <set>
 #include <vector>
 
+class MemoryReport;
 class Platform;
 
 namespace Tangram {
 
+class RenderState;
 class TileSource;
 class TileCache;
 class View;
@@ -48,6 +49,11 @@ public:
 
     void clearTileSet(int32_t _sourceId);
 
+    /* Rebuild the labels of the loaded tiles, e.g. after the pixel scale
+     * changed. Tiles stay shown until their labels are rebuilt; lines,
+     * polygons and rasters are kept. Tiles in progress are loaded again. */
+    void rebuildLabels();
+
     /* Returns the set of currently visible tiles */
     const auto& getVisibleTiles() const { return m_tiles; }
 
@@ -57,6 +63,8 @@ public:
         return m_tilesInProgress > 0;
     }
 
+    int32_t tilesInProgress() const { return m_tilesInProgress; }
+
     std::shared_ptr<TileSource> getClientTileSource(int32_t sourceID);
 
     void addClientTileSource(std::shared_ptr<TileSource> _source);
@@ -70,6 +78,68 @@ public:
      */
     void setCacheSize(size_t _cacheSize);
 
+    /* @_gpuBytes, @_cpuBytes: Limits of the tile cache on either side, 0 for none.
+     * Applied by uploadTiles() within what is left of the upload budget,
+     * see TileCache::applyResidency().
+     */
+    void setCacheResidency(size_t _gpuBytes, size_t _cpuBytes);
+
+    /* @_maxTasks: Maximum number of speculative tile loads in flight.
+     * Visible tiles that are loading count against this budget. 0 disables prefetching.
+     */
+    void setPrefetchBudget(int _maxTasks) { m_prefetchBudget = _maxTasks; }
+
+    /* Load tiles of @_predictedView at low priority so that they are cached when the
+     * view gets there. Completed prefetch tasks move their tiles into the TileCache.
+     * Must be called after updateTileSets(). Pass nullptr when there is no prediction
+     * to only collect finished prefetch tasks.
+     */
+    void updatePrefetch(const View* _predictedView);
+
+    /* @_maxTiles: Tiles of all sources that wait for their data at once, 0 for no limit.
+     * @_maxTilesPerSource: Tiles of a source that wait for their data at once,
+     * unless TileSource::maxLoadingTiles() is set; 0 for no limit.
+     * Sources load their nearest tiles in turns, by their TileSource::loadWeight().
+     * Tiles over the limits wait for the next update. Client sources load their
+     * tiles in place and have no limits.
+     */
+    void setLoadLimits(int _maxTiles, int _maxTilesPerSource) {
+        m_maxLoadingTiles = _maxTiles;
+        m_maxLoadingTilesPerSource = _maxTilesPerSource;
+    }
+
+    /* @_bytes: Maximum number of mesh bytes uploaded per frame, 0 for no limit.
+     * At least one mesh is uploaded per frame.
+     */
+    void setUploadBudget(size_t _bytes) { m_uploadBudget = _bytes; }
+
+    /* When true, tiles replacing the parent or child tiles of a one level zoom
+     * step are held back until all visible tiles of their source are ready.
+     * Until then the previous tiles are drawn scaled as proxies, so that the
+     * view switches to the new zoom at once instead of tile by tile.
+     */
+    void setHoldProxies(bool _hold) { m_holdProxies = _hold; }
+
+    /* Upload meshes of staged tiles within the upload budget, or within _maxBytes
+     * when it is lower and not 0. Tiles are shown on the next update after all
+     * their meshes are uploaded, until then their proxies are drawn. Must be
+     * called on the GL thread.
+     * Returns the number of uploaded bytes.
+     */
+    size_t uploadTiles(RenderState& _rs, size_t _maxBytes = 0);
+
+    bool hasPendingUploads() const { return !m_uploadQueue.empty(); }
+
+    /* Bytes uploaded by the last call to uploadTiles() */
+    size_t uploadedBytes() const { return m_uploadedBytes; }
+
+    /* Add the bytes held by tiles, the tile cache and the sources of the tile sets to _report */
+    void reportMemory(MemoryReport& _report) const;
+
+    /* Evict cached tiles farthest from _view first, in tiles of the view zoom,
+     * until _bytes are freed. Returns the freed bytes. */
+    size_t releaseCachedTiles(const View& _view, size_t _bytes);
+
 protected:
 
     enum class ProxyID : uint8_t;
@@ -81,19 +151,55 @@ protected:
 
         std::shared_ptr<TileSource> source;
 
-        std::set<TileID> visibleTiles;
+        // Sorted and unique TileIDs of the current view
+        std::vector<TileID> visibleTiles;
         std::map<TileID, TileEntry> tiles;
 
+        // TileIDs that entered and left visibleTiles on the last view change
+        std::vector<TileID> enteringTiles;
+        std::vector<TileID> leavingTiles;
+
+        // Previous visibleTiles, kept to reuse its allocation
+        std::vector<TileID> previousTiles;
+
+        // Speculative loads for tiles of the predicted view
+        std::map<TileID, std::shared_ptr<TileTask>> prefetchTasks;
+
+        // Ready tiles that are not shown while their zoom proxies are, see setHoldProxies()
+        std::vector<TileID> heldTiles;
+
+        // Parsed data of the tiles before the tile set was cleared, tiles that
+        // come back into view on the next update are built from it
+        std::map<TileID, std::shared_ptr<const TileData>> retainedData;
+
         int64_t sourceGeneration = 0;
         bool clientTileSource;
+
+        // Tiles waiting for their data, counted on update
+        int loadingTiles = 0;
     };
 
     void updateTileSet(TileSet& tileSet, const ViewState& _view);
 
+    /* Collect the data retained by the current and cached tiles of _tileSet
+     * that holds the features _source takes, see FeatureFilter */
+    std::map<TileID, std::shared_ptr<const TileData>> collectTileData(const TileSet& _tileSet,
+                                                                      const TileSource& _source);
+
+    /* Recollect the visible tiles of all TileSets from _view and
+     * determine which tiles entered and left the view since then.
+     */
+    void updateVisibleTiles(const View& _view);
+
     void enqueueTask(TileSet& _tileSet, const TileID& _tileID, const ViewState& _view);
 
     void loadTiles();
 
+    void cancelPrefetchTask(TileSet& _tileSet, const TileID& _tileID, TileTask& _task);
+
+    /* Move finished prefetch tasks into the cache */
+    void collectPrefetchTasks(TileSet& _tileSet);
+
     /*
      * Constructs a future (async) to load data of a new visible tile this is
      *      also responsible for loading proxy tiles for the newly visible tiles
@@ -101,11 +207,22 @@ protected:
      */
     bool addTile(TileSet& _tileSet, const TileID& _tileID);
 
+    /* Returns a copy of the ready tile of another wrap of _tileID, sharing its
+     * meshes, or nullptr when there is none */
+    std::shared_ptr<Tile> copyWrappedTile(const TileSet& _tileSet, const TileID& _tileID) const;
+
+    /* Returns a task that rebuilds the labels of _tile, see rebuildLabels() */
+    std::shared_ptr<TileTask> createLabelsTask(TileSet& _tileSet, const TileID& _tileID,
+                                               const std::shared_ptr<Tile>& _tile);
+
     /*
      * Removes a tile from m_tileSet
      */
     void removeTile(TileSet& _tileSet, std::map<TileID, TileEntry>::iterator& _tileIter);
 
+    /* Move the tile of _entry into the upload queue */
+    void stageTile(TileEntry& _entry);
+
     /*
      * Checks and updates m_tileSet with proxy tiles for every new visible tile
      *  @_tile: Tile, the new visible tile for which proxies needs to be added
@@ -119,6 +236,9 @@ protected:
      */
     void clearProxyTiles(TileSet& _tileSet, const TileID& _tileID, TileEntry& _tile, std::vector<TileID>& _removes);
 
+    /* Whether a ready parent or child tile is drawn as proxy for _tile */
+    bool hasReadyZoomStepProxy(TileSet& _tileSet, const TileID& _tileID, TileEntry& _tile);
+
     int32_t m_tilesInProgress = 0;
 
     std::vector<TileSet> m_tileSets;
@@ -132,14 +252,46 @@ protected:
 
     bool m_tileSetChanged = false;
 
+    /* Set when visibleTiles must be recollected even if the view did not change */
+    bool m_visibleTilesDirty = true;
+
     /* Callback for TileSource:
      * Passes TileTask back with data for further processing by <TileWorker>s
      */
     TileTaskCb m_dataCallback;
 
-    /* Temporary list of tiles that need to be loaded */
+    int m_prefetchBudget = 0;
+
+    /* Temporary list of tiles that need to be prefetched */
+    std::vector<TileID> m_prefetchTiles;
+
+    /* Built tiles waiting for their meshes to be uploaded */
+    std::vector<std::weak_ptr<Tile>> m_uploadQueue;
+
+    size_t m_uploadBudget = 0;
+    size_t m_uploadedBytes = 0;
+
+    bool m_holdProxies = false;
+
+    /* Temporary list of tiles that need to be loaded, in the order of their
+     * TileSets and unsorted within a TileSet */
     std::vector<std::tuple<double, TileSet*, TileID>> m_loadTasks;
 
+    /* Load tasks of a TileSet in loadTiles(), from next to end, sorted by
+     * distance up to sorted */
+    struct SourceLoads {
+        TileSet* tileSet;
+        std::vector<std::tuple<double, TileSet*, TileID>>::iterator next, sorted, end;
+        int loading;
+        int limit;
+        float weight;
+    };
+    std::vector<SourceLoads> m_sourceLoads;
+
+    // The maximum of concurrent requests of the desktop platforms
+    int m_maxLoadingTiles = 20;
+    int m_maxLoadingTilesPerSource = 12;
+
 };
 
 }
@@ -1,10 +1,20 @@
 #include "tile/tileTask.h"
 
+#include "data/featureFilter.h"
+#include "data/geometryClipper.h"
+#include "data/geometrySimplifier.h"
 #include "data/tileSource.h"
+#include "debug/tileTrace.h"
 #include "scene/scene.h"
+#include "tile/builtTileCache.h"
 #include "tile/tile.h"
 #include "tile/tileBuilder.h"
+#include "util/arena.h"
 #include "util/mapProjection.h"
+#include "util/zlibHelper.h"
+#include "log.h"
+
+#include <cmath>
 
 namespace Tangram {
 
@@ -13,6 +23,7 @@ TileTask::TileTask(TileID& _tileId, std::shared_ptr<TileSource> _source, int _su
     m_subTaskId(_subTask),
     m_source(_source),
     m_sourceGeneration(_source->generation()),
+    m_featureFilter(_source->featureFilter()),
     m_ready(false),
     m_canceled(false),
     m_needsLoading(true),
@@ -30,13 +41,63 @@ void TileTask::setTile(std::unique_ptr<Tile>&& _tile) {
     m_ready = true;
 }
 
+std::unique_ptr<Tile> TileTask::getPartialTile() {
+    std::lock_guard<std::mutex> lock(m_partialMutex);
+    return std::move(m_partialTile);
+}
+
+void TileTask::setPartialTile(std::unique_ptr<Tile>&& _tile) {
+    std::lock_guard<std::mutex> lock(m_partialMutex);
+    m_partialTile = std::move(_tile);
+}
+
 void TileTask::process(TileBuilder& _tileBuilder) {
 
-    auto tileData = m_source->parse(*this, *_tileBuilder.scene().mapProjection());
+    auto tileData = parseTileData(_tileBuilder);
+
+    if (tileData) { simplifyTileData(_tileBuilder, *tileData); }
+
+    buildTile(_tileBuilder, tileData.get());
+}
+
+std::shared_ptr<TileData> TileTask::parseTileData(TileBuilder& _tileBuilder) {
+
+    std::shared_ptr<TileData> tileData;
+    {
+        TILE_TRACE_SPAN("parse", m_tileId, m_source->id());
+        tileData = m_source->parse(*this, *_tileBuilder.scene().mapProjection());
+    }
+
+    if (tileData && m_source->clipBuffer() >= 0.f) {
+        GeometryClipper clipper(m_source->clipBuffer());
+        clipper.clip(*tileData);
+    }
+
+    return tileData;
+}
+
+void TileTask::simplifyTileData(TileBuilder& _tileBuilder, TileData& _tileData) {
+
+    if (m_source->simplifyTolerance() <= 0.f) { return; }
+
+    // Size of the tile in pixels when drawn at its styling zoom
+    float tileSize = _tileBuilder.scene().mapProjection()->TileSize() *
+        std::exp2(m_tileId.s - m_tileId.z);
+
+    GeometrySimplifier simplifier(m_source->simplifyTolerance() / tileSize);
+    simplifier.simplify(_tileData);
 
-    if (tileData) {
-        m_tile = _tileBuilder.build(m_tileId, *tileData, *m_source);
-        m_ready = true;
+    m_source->addSimplifyStats(simplifier.verticesIn(), simplifier.verticesOut());
+}
+
+void TileTask::buildTile(TileBuilder& _tileBuilder, const TileData* _tileData) {
+
+    if (_tileData) {
+        TILE_TRACE_SPAN("build", m_tileId, m_source->id());
+        m_tile = m_labelsOf ? _tileBuilder.rebuildLabels(*m_labelsOf, *_tileData, *m_source, this)
+                            : _tileBuilder.build(m_tileId, *_tileData, *m_source, this);
+        // Null when the task got canceled while building
+        if (m_tile) { m_ready = true; }
     } else {
         cancel();
     }
@@ -46,9 +107,143 @@ void TileTask::complete() {
 
     for (auto& subTask : m_subTasks) {
         assert(subTask->isReady());
-        subTask->complete(*this);
+        subTask->complete(*m_tile);
+    }
+
+}
+
+void BinaryTileTask::process(TileBuilder& _tileBuilder) {
+
+    if (fromBuiltTileCache) {
+        fromBuiltTileCache = false;
+        if (!restoreBuiltTile(_tileBuilder)) { setNeedsLoading(true); }
+        return;
+    }
+
+    if (m_source->format() == TileSource::Format::Mesh) {
+        decodeMeshTile(_tileBuilder);
+        return;
+    }
+
+    buildFromTileData(_tileBuilder);
+
+    // Store the meshes before they are uploaded and release their data. Tiles
+    // with rebuilt labels share meshes that were uploaded already.
+    auto& cache = m_source->builtTileCache();
+    if (cache && m_tile && m_subTasks.empty() && !_tileBuilder.featureIndexing() && !m_labelsOf) {
+        cache->store(*m_tile, _tileBuilder.scene());
+    }
+}
+
+bool BinaryTileTask::restoreBuiltTile(TileBuilder& _tileBuilder) {
+
+    auto& cache = m_source->builtTileCache();
+    {
+        TILE_TRACE_SPAN("restore", m_tileId, m_source->id());
+        m_tile = cache->load(m_tileId, *m_source, _tileBuilder.scene());
+    }
+    if (!m_tile) {
+        cache->remove(m_tileId);
+        return false;
+    }
+    m_ready = true;
+    return true;
+}
+
+void BinaryTileTask::decodeMeshTile(TileBuilder& _tileBuilder) {
+
+    if (!inflateRawTileData() || rawTileData.empty()) {
+        cancel();
+        return;
+    }
+    {
+        TILE_TRACE_SPAN("decode", m_tileId, m_source->id());
+        m_tile = BuiltTileCache::decodeMeshTile(rawTileData.data(), rawTileData.size(), m_tileId,
+                                                *m_source, _tileBuilder.scene());
+    }
+    if (!m_tile) {
+        LOGW("Invalid mesh tile %s of source '%s'", m_tileId.toString().c_str(), m_source->name().c_str());
+        cancel();
+        return;
+    }
+    m_ready = true;
+}
+
+void BinaryTileTask::buildFromTileData(TileBuilder& _tileBuilder) {
+
+    bool retain = m_source->retainTileData();
+
+    // Parsed for the scene layers before a scene update
+    if (parsedTileData && !rawTileData.empty() &&
+        !FeatureFilter::covers(parsedTileData->featureFilter.get(), m_featureFilter.get())) {
+        parsedTileData.reset();
+    }
+
+    if (parsedTileData) {
+        buildSharedTile(_tileBuilder, *parsedTileData);
+        if (retain && m_tile) { m_tile->setTileData(parsedTileData); }
+        return;
+    }
+
+    if (!inflateRawTileData()) {
+        cancel();
+        return;
     }
 
+    bool overzoomed = m_tileId.z >= m_source->maxZoom();
+
+    if (!overzoomed && !retain) {
+        TileTask::process(_tileBuilder);
+        return;
+    }
+
+    // Overzoomed tiles load the same raw data as the tile at the max zoom of
+    // the source. Its parsed data is kept in the memory cache - or with the
+    // tile when the source retains it - so it is not allocated from the arena
+    // of this worker.
+    std::shared_ptr<TileData> tileData;
+    {
+        Arena::HeapScope heapScope;
+        tileData = parseTileData(_tileBuilder);
+    }
+    if (!tileData) {
+        cancel();
+        return;
+    }
+    if (overzoomed) { m_source->cacheTileData(*this, tileData); }
+
+    buildSharedTile(_tileBuilder, *tileData);
+
+    if (retain && m_tile) { m_tile->setTileData(std::move(tileData)); }
+}
+
+void BinaryTileTask::buildSharedTile(TileBuilder& _tileBuilder, const TileData& _tileData) {
+
+    if (m_source->simplifyTolerance() <= 0.f) {
+        buildTile(_tileBuilder, &_tileData);
+        return;
+    }
+
+    // Simplification depends on the styling zoom, simplify a copy
+    TileData tileData = _tileData;
+    simplifyTileData(_tileBuilder, tileData);
+
+    buildTile(_tileBuilder, &tileData);
+}
+
+bool BinaryTileTask::inflateRawTileData() {
+
+    if (!rawTileDataCompressed) { return true; }
+    rawTileDataCompressed = false;
+
+    std::vector<char> data;
+    if (zlib::inflate(rawTileData.data(), rawTileData.size(), data) != 0) {
+        LOGW("Invalid cached data for tile %s", m_tileId.toString().c_str());
+        rawTileData.reset();
+        return false;
+    }
+    rawTileData = ByteBuffer(std::move(data));
+    return true;
 }
 
 }
@@ -1,24 +1,34 @@
 #include "tile/tileWorker.h"
 
 #include "data/tileSource.h"
+#include "debug/tileTrace.h"
 #include "log.h"
 #include "map.h"
 #include "platform.h"
 #include "tile/tileBuilder.h"
 #include "tile/tileID.h"
 #include "tile/tileTask.h"
+#include "util/arena.h"
 
 #include <algorithm>
 
-#define WORKER_NICENESS 10
+// Queued tasks per active worker before another one is woken up
+#define TASKS_PER_WORKER 2
 
 namespace Tangram {
 
+// TileWorker of the current worker thread
+static TileWorker*& currentPool() {
+    static thread_local TileWorker* s_pool = nullptr;
+    return s_pool;
+}
+
 TileWorker::TileWorker(std::shared_ptr<Platform> _platform, int _numWorker) : m_platform(_platform) {
     m_running = true;
 
     for (int i = 0; i < _numWorker; i++) {
         auto worker = std::make_unique<Worker>();
+        worker->index = i;
         worker->thread = std::thread(&TileWorker::run, this, worker.get());
         m_workers.push_back(std::move(worker));
     }
@@ -30,88 +40,369 @@ TileWorker::~TileWorker(){
     }
 }
 
+static bool compareTasks(const std::shared_ptr<TileTask>& a, const std::shared_ptr<TileTask>& b) {
+    if (a->isProxy() != b->isProxy()) {
+        return !a->isProxy();
+    }
+    if (a->source().id() == b->source().id() &&
+        a->sourceGeneration() != b->sourceGeneration()) {
+        return a->sourceGeneration() < b->sourceGeneration();
+    }
+    return a->getPriority() < b->getPriority();
+}
+
 void TileWorker::run(Worker* instance) {
 
-    setCurrentThreadPriority(WORKER_NICENESS);
+    setCurrentThreadPolicy(m_platform->threadPolicy(ThreadRole::tileWorker));
+    currentPool() = this;
+
+    std::unordered_map<uint32_t, std::unique_ptr<TileBuilder>> builders;
+    std::unordered_map<uint32_t, std::shared_ptr<Scene>> scenes;
+    // Scenes of clients whose builder is created with their next task
+    std::unordered_map<uint32_t, std::shared_ptr<Scene>> pendingScenes;
 
-    std::unique_ptr<TileBuilder> builder;
+    // Scratch memory for parsing and building, released after each tile
+    Arena arena;
+    Arena::Scope arenaScope(arena);
 
     while (true) {
 
-        std::shared_ptr<TileTask> task;
+        std::shared_ptr<Batch> batch;
         {
             std::unique_lock<std::mutex> lock(m_mutex);
 
+            // Inactive workers sleep, the active ones steal the tasks left in
+            // their queues. All idle workers help with the jobs of a tile.
             m_condition.wait(lock, [&, this]{
-                    return !m_running || !m_queue.empty();
+                    return !m_running || openBatch() || !instance->scenes.empty() ||
+                        (m_pending > 0 && instance->index < m_activeWorkers);
                 });
 
-            if (instance->tileBuilder) {
-                builder = std::move(instance->tileBuilder);
-                LOG("Passed new TileBuilder to TileWorker");
-            }
+            scenes = std::move(instance->scenes);
+            instance->scenes.clear();
 
             // Check if thread should stop
             if (!m_running) {
                 break;
             }
 
-            if (!builder) {
+            batch = openBatch();
+        }
+
+        if (batch) {
+            Arena::HeapScope heapScope;
+            while (batch->runNext()) { m_helped++; }
+            continue;
+        }
+
+        for (auto& it : scenes) {
+            if (!it.second) {
+                builders.erase(it.first);
+                pendingScenes.erase(it.first);
                 continue;
             }
+            pendingScenes[it.first] = std::move(it.second);
+        }
+        scenes.clear();
 
-            // Remove all canceled tasks
-            auto removes = std::remove_if(m_queue.begin(), m_queue.end(),
-                                          [](const auto& a) { return a->isCanceled(); });
+        if (builders.empty() && pendingScenes.empty()) {
+            continue;
+        }
 
-            m_queue.erase(removes, m_queue.end());
+        QueueEntry entry;
+        bool stolen = false;
+        {
+            std::lock_guard<std::mutex> lock(instance->queueMutex);
+            popTask(*instance, entry);
+        }
 
-            if (m_queue.empty()) {
+        if (!entry.task) {
+            stolen = stealTask(instance, entry);
+            if (!entry.task) {
+                // All remaining tasks are being taken by other workers
+                std::this_thread::yield();
                 continue;
             }
+        }
 
-            // Pop highest priority tile from queue
-            auto it = std::min_element(m_queue.begin(), m_queue.end(),
-                [](const auto& a, const auto& b) {
-                    if (a->isProxy() != b->isProxy()) {
-                        return !a->isProxy();
-                    }
-                    if (a->source().id() == b->source().id() &&
-                        a->sourceGeneration() != b->sourceGeneration()) {
-                        return a->sourceGeneration() < b->sourceGeneration();
-                    }
-                    return a->getPriority() < b->getPriority();
-                });
+        recordWait(entry, stolen);
+
+        if (entry.task->isCanceled()) {
+            continue;
+        }
 
-            task = std::move(*it);
-            m_queue.erase(it);
+        // Switch to the new scene of the client once it has tasks, so that the
+        // workers initialize their builders in parallel and only when needed
+        auto pending = pendingScenes.find(entry.client);
+        if (pending != pendingScenes.end()) {
+            auto& builder = builders[entry.client];
+            // Keep the duktape heap of the previous scene
+            auto styleContext = builder ? builder->releaseStyleContext() : nullptr;
+            builder.reset();
+            builder = std::make_unique<TileBuilder>(std::move(pending->second), std::move(styleContext));
+            builder->setCostAccounting(&m_buildCosts);
+            pendingScenes.erase(pending);
+            LOG("Passed new Scene to TileWorker");
         }
 
-        if (task->isCanceled()) {
+        auto builder = builders.find(entry.client);
+        if (builder == builders.end()) {
+            // The client was removed
+            entry.task->cancel();
             continue;
         }
 
-        task->process(*builder);
+        {
+            auto& task = *entry.task;
+            TILE_TRACE_SINCE("queue", task.tileId(), task.source().id(), entry.enqueued);
+            TILE_TRACE_SPAN("process", task.tileId(), task.source().id());
+
+            builder->second->setFeatureIndexing(m_featureIndexing);
+            auto start = Clock::now();
+            task.process(*builder->second);
+            recordProcess(task, start);
+        }
+        arena.reset();
 
         m_platform->requestRender();
     }
 }
 
-void TileWorker::setScene(std::shared_ptr<Scene>& _scene) {
+bool TileWorker::Batch::runNext() {
+    size_t index = next++;
+    if (index >= count) { return false; }
+
+    (*job)(index);
+
+    if (++done == count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+    }
+    return true;
+}
+
+std::shared_ptr<TileWorker::Batch> TileWorker::openBatch() const {
+    for (auto& batch : m_batches) {
+        if (batch->next < batch->count) { return batch; }
+    }
+    return nullptr;
+}
+
+void TileWorker::parallelFor(size_t _count, const std::function<void(size_t)>& _job) {
+
+    Arena::HeapScope heapScope;
+
+    TileWorker* pool = currentPool();
+    if (!pool || _count < 2 || pool->m_workers.size() < 2 ||
+        pool->m_platform->powerHint() != PowerHint::normal) {
+        for (size_t i = 0; i < _count; i++) { _job(i); }
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->job = &_job;
+    batch->count = _count;
+    {
+        std::lock_guard<std::mutex> lock(pool->m_mutex);
+        pool->m_batches.push_back(batch);
+    }
+    pool->m_condition.notify_all();
+
+    while (batch->runNext()) {}
+
+    {
+        std::lock_guard<std::mutex> lock(pool->m_mutex);
+        auto& batches = pool->m_batches;
+        batches.erase(std::find(batches.begin(), batches.end(), batch));
+    }
+
+    // Wait for the jobs taken by other workers
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]() { return batch->done == batch->count; });
+}
+
+bool TileWorker::popTask(Worker& _worker, QueueEntry& _entry) {
+
+    auto& queue = _worker.queue;
+
+    // Remove all canceled tasks
+    auto removes = std::remove_if(queue.begin(), queue.end(),
+                                  [](const auto& a) { return a.task->isCanceled(); });
+
+    m_pending -= std::distance(removes, queue.end());
+    queue.erase(removes, queue.end());
+
+    if (queue.empty()) {
+        return false;
+    }
+
+    // Priorities are updated by TileManager on the task itself, so the scan
+    // over this (short) local queue always sees the current ordering.
+    auto it = std::min_element(queue.begin(), queue.end(),
+                               [](const auto& a, const auto& b) {
+                                   return compareTasks(a.task, b.task);
+                               });
+
+    _entry = std::move(*it);
+    queue.erase(it);
+    m_pending--;
+
+    return true;
+}
+
+bool TileWorker::stealTask(Worker* _thief, QueueEntry& _entry) {
+
+    // Take the best task of the most loaded worker. Busy queues are skipped
+    // instead of waiting on their lock.
+    Worker* victim = nullptr;
+    size_t maxTasks = 0;
+
     for (auto& worker : m_workers) {
-        worker->tileBuilder = std::make_unique<TileBuilder>(_scene);
+        if (worker.get() == _thief) { continue; }
+
+        std::unique_lock<std::mutex> lock(worker->queueMutex, std::try_to_lock);
+        if (lock.owns_lock() && worker->queue.size() > maxTasks) {
+            maxTasks = worker->queue.size();
+            victim = worker.get();
+        }
+    }
+
+    if (!victim) { return false; }
+
+    std::lock_guard<std::mutex> lock(victim->queueMutex);
+    return popTask(*victim, _entry);
+}
+
+void TileWorker::recordWait(const QueueEntry& _entry, bool _stolen) {
+
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _entry.enqueued);
+    uint64_t waitUs = wait.count();
+
+    _entry.task->setQueueWaitTime(waitUs);
+
+    m_processed++;
+    m_totalWait += waitUs;
+    if (_stolen) { m_stolen++; }
+
+    uint64_t maxWait = m_maxWait;
+    while (waitUs > maxWait && !m_maxWait.compare_exchange_weak(maxWait, waitUs)) {}
+}
+
+void TileWorker::recordProcess(TileTask& _task, Clock::time_point _start) {
+
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _start);
+    uint64_t timeUs = time.count();
+
+    if (_task.tile()) {
+        m_built++;
+        m_buildTime += timeUs;
+    } else if (_task.isCanceled()) {
+        m_aborted++;
+        m_abortedTime += timeUs;
     }
 }
 
+TileWorker::Stats TileWorker::getStats() const {
+    Stats stats;
+    stats.processed = m_processed;
+    stats.stolen = m_stolen;
+    stats.helped = m_helped;
+    stats.totalWait = m_totalWait;
+    stats.maxWait = m_maxWait;
+    stats.built = m_built;
+    stats.buildTime = m_buildTime;
+    stats.aborted = m_aborted;
+    stats.abortedTime = m_abortedTime;
+    return stats;
+}
+
+void TileWorker::resetStats() {
+    m_processed = 0;
+    m_stolen = 0;
+    m_helped = 0;
+    m_totalWait = 0;
+    m_maxWait = 0;
+    m_built = 0;
+    m_buildTime = 0;
+    m_aborted = 0;
+    m_abortedTime = 0;
+}
+
+void TileWorker::setScene(std::shared_ptr<Scene>& _scene) {
+    setScene(_scene, 0);
+}
+
+void TileWorker::setScene(std::shared_ptr<Scene>& _scene, uint32_t _client) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& worker : m_workers) {
+            worker->scenes[_client] = _scene;
+        }
+    }
+    m_condition.notify_all();
+}
+
+std::unique_ptr<TileWorker::Client> TileWorker::addClient() {
+    return std::make_unique<Client>(*this, m_nextClient++);
+}
+
+void TileWorker::removeClient(uint32_t _client) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& worker : m_workers) {
+            worker->scenes[_client] = nullptr;
+
+            std::lock_guard<std::mutex> queueLock(worker->queueMutex);
+            auto& queue = worker->queue;
+            auto removes = std::remove_if(queue.begin(), queue.end(),
+                                          [&](const auto& a) { return a.client == _client; });
+            m_pending -= std::distance(removes, queue.end());
+            queue.erase(removes, queue.end());
+        }
+    }
+    m_condition.notify_all();
+}
+
 void TileWorker::enqueue(std::shared_ptr<TileTask> task) {
+    enqueue(std::move(task), 0);
+}
+
+void TileWorker::enqueue(std::shared_ptr<TileTask> task, uint32_t _client) {
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        if (!m_running) {
+        if (!m_running || m_workers.empty()) {
             return;
         }
-        m_queue.push_back(std::move(task));
+
+        updateActiveWorkers(m_pending + 1);
+
+        // Distribute tasks round-robin over the active workers, idle workers steal the rest
+        auto& worker = *m_workers[m_nextWorker++ % m_activeWorkers];
+
+        std::lock_guard<std::mutex> queueLock(worker.queueMutex);
+        worker.queue.push_back({ std::move(task), Clock::now(), _client });
+        m_pending++;
     }
-    m_condition.notify_one();
+    // A single notification could wake an inactive worker, which goes back to sleep
+    m_condition.notify_all();
+}
+
+void TileWorker::updateActiveWorkers(int _pending) {
+
+    uint32_t limit = m_workers.size();
+    switch (m_platform->powerHint()) {
+    case PowerHint::normal:
+        break;
+    case PowerHint::lowBattery:
+        limit = std::max<uint32_t>(1, limit / 2);
+        break;
+    case PowerHint::thermalThrottled:
+        limit = 1;
+        break;
+    }
+
+    uint32_t needed = (std::max(_pending, 1) + TASKS_PER_WORKER - 1) / TASKS_PER_WORKER;
+    m_activeWorkers = std::min(needed, limit);
 }
 
 void TileWorker::stop() {
@@ -126,7 +417,10 @@ void TileWorker::stop() {
         worker->thread.join();
     }
 
-    m_queue.clear();
+    for (auto& worker : m_workers) {
+        worker->queue.clear();
+    }
+    m_pending = 0;
 }
 
 }
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "tile/buildCost.h"
 #include "tile/tileTask.h"
 #include "util/jobQueue.h"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace Tangram {
@@ -21,10 +25,59 @@ class TileWorker : public TileTaskQueue {
 
 public:
 
+    // Aggregated scheduler counters, times in microseconds
+    struct Stats {
+        uint64_t processed = 0;
+        uint64_t stolen = 0;
+        // Jobs of parallelFor run by workers other than the calling one
+        uint64_t helped = 0;
+        uint64_t totalWait = 0;
+        uint64_t maxWait = 0;
+        // Tasks that built a tile and the time they took
+        uint64_t built = 0;
+        uint64_t buildTime = 0;
+        // Tasks that were canceled while parsing or building and the time they
+        // took until they stopped
+        uint64_t aborted = 0;
+        uint64_t abortedTime = 0;
+
+        double averageWait() const {
+            return processed > 0 ? double(totalWait) / processed : 0.0;
+        }
+
+        // Worker time saved by stopping canceled tasks early, assuming that
+        // they would have taken as long as the average built tile
+        double savedTime() const {
+            if (built == 0) { return 0.0; }
+            double saved = double(aborted) * buildTime / built - double(abortedTime);
+            return saved > 0.0 ? saved : 0.0;
+        }
+    };
+
+    // Task queue of one Map on a pool shared by several maps, see MapContext.
+    // Workers keep a TileBuilder for the scene of each client.
+    class Client : public TileTaskQueue {
+    public:
+        Client(TileWorker& _pool, uint32_t _id) : m_pool(_pool), m_id(_id) {}
+        ~Client() { clear(); }
+
+        // Drop the queued tasks and the TileBuilders of this client, tasks
+        // enqueued afterwards are canceled until the next setScene
+        void clear() { m_pool.removeClient(m_id); }
+
+        void enqueue(std::shared_ptr<TileTask> _task) override { m_pool.enqueue(std::move(_task), m_id); }
+        void setScene(std::shared_ptr<Scene>& _scene) { m_pool.setScene(_scene, m_id); }
+
+    private:
+        TileWorker& m_pool;
+        uint32_t m_id;
+    };
+
     TileWorker(std::shared_ptr<Platform> _platform, int _numWorker);
 
     ~TileWorker();
 
+    // Enqueue and setScene for the default client
     virtual void enqueue(std::shared_ptr<TileTask> task) override;
 
     void stop();
@@ -33,23 +86,121 @@ public:
 
     void setScene(std::shared_ptr<Scene>& _scene);
 
+    std::unique_ptr<Client> addClient();
+
+    Stats getStats() const;
+
+    void resetStats();
+
+    // Build costs of the tiles built by all workers
+    BuildCostAccounting& buildCosts() { return m_buildCosts; }
+
+    // Build a FeatureIndex for the tiles built from now on
+    void setFeatureIndexing(bool _enabled) { m_featureIndexing = _enabled; }
+
+    /* Run _job(0) to _job(_count - 1) on the calling tile worker and on the
+     * idle workers of its pool, returns once all of them are done. Jobs run
+     * in any order and allocate from the heap, since their results outlive
+     * the arena of the worker that ran them. Called from other threads, or
+     * with a power hint other than normal, the jobs run on the calling thread. */
+    static void parallelFor(size_t _count, const std::function<void(size_t)>& _job);
+
+    // Workers taking tasks, scaled with the number of queued tasks and
+    // limited by Platform::powerHint()
+    uint32_t activeWorkers() const { return m_activeWorkers; }
+
 private:
 
+    using Clock = std::chrono::steady_clock;
+
+    struct QueueEntry {
+        std::shared_ptr<TileTask> task;
+        Clock::time_point enqueued;
+        uint32_t client = 0;
+    };
+
     struct Worker {
         std::thread thread;
-        std::unique_ptr<TileBuilder> tileBuilder;
+        uint32_t index = 0;
+        // Scenes to switch to by client, null for removed clients. The worker
+        // creates its next TileBuilder itself when it takes the next task of
+        // the client, passing on the StyleContext of the previous one.
+        std::unordered_map<uint32_t, std::shared_ptr<Scene>> scenes;
+
+        // Tasks assigned to this worker. Other workers may steal
+        // from it when their own queue runs empty.
+        std::mutex queueMutex;
+        std::vector<QueueEntry> queue;
+    };
+
+    // Jobs of one parallelFor call
+    struct Batch {
+        const std::function<void(size_t)>* job = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        // Run the next job, returns false when all jobs were taken
+        bool runNext();
     };
 
     void run(Worker* instance);
 
+    void enqueue(std::shared_ptr<TileTask> _task, uint32_t _client);
+
+    void setScene(std::shared_ptr<Scene>& _scene, uint32_t _client);
+
+    void removeClient(uint32_t _client);
+
+    // Batch with jobs left to take, must be called with m_mutex locked
+    std::shared_ptr<Batch> openBatch() const;
+
+    // Remove the highest priority task from _worker's queue.
+    // Must be called with _worker.queueMutex locked.
+    bool popTask(Worker& _worker, QueueEntry& _entry);
+
+    bool stealTask(Worker* _thief, QueueEntry& _entry);
+
+    void recordWait(const QueueEntry& _entry, bool _stolen);
+
+    // Count the processing time of _task into the built or aborted tasks
+    void recordProcess(TileTask& _task, Clock::time_point _start);
+
+    // Must be called with m_mutex locked
+    void updateActiveWorkers(int _pending);
+
     bool m_running;
 
     std::vector<std::unique_ptr<Worker>> m_workers;
 
+    // Only used to put idle workers to sleep, the queues have their own locks.
     std::condition_variable m_condition;
-
     std::mutex m_mutex;
-    std::vector<std::shared_ptr<TileTask>> m_queue;
+
+    // Running parallelFor calls, guarded by m_mutex
+    std::vector<std::shared_ptr<Batch>> m_batches;
+
+    // Number of tasks in all worker queues
+    std::atomic<int> m_pending{0};
+    std::atomic<uint32_t> m_nextWorker{0};
+    std::atomic<uint32_t> m_activeWorkers{1};
+    // Ids of clients, 0 is the default client
+    std::atomic<uint32_t> m_nextClient{1};
+
+    std::atomic<uint64_t> m_processed{0};
+    std::atomic<uint64_t> m_stolen{0};
+    std::atomic<uint64_t> m_helped{0};
+    std::atomic<uint64_t> m_totalWait{0};
+    std::atomic<uint64_t> m_maxWait{0};
+    std::atomic<uint64_t> m_built{0};
+    std::atomic<uint64_t> m_buildTime{0};
+    std::atomic<uint64_t> m_aborted{0};
+    std::atomic<uint64_t> m_abortedTime{0};
+
+    BuildCostAccounting m_buildCosts;
+    std::atomic<bool> m_featureIndexing{false};
 
     std::shared_ptr<Platform> m_platform;
 };
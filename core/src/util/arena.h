@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace Tangram {
+
+/* Bump allocator for short-lived scratch data
+ *
+ * Memory is taken from large blocks and only released all at once by reset(),
+ * deallocation of single allocations is a no-op. Blocks are kept for reuse,
+ * so that after the first few tiles a worker does not touch the heap for
+ * arena allocated data.
+ *
+ * An Arena is bound to the current thread with Arena::Scope. ArenaAllocators
+ * created while a scope is active allocate from that arena, otherwise they
+ * fall back to the heap.
+ */
+class Arena {
+
+public:
+
+    explicit Arena(size_t _blockSize = 256 * 1024) : m_blockSize(_blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t _bytes, size_t _align) {
+        uintptr_t pos = (m_pos + _align - 1) & ~(uintptr_t(_align) - 1);
+
+        if (pos + _bytes > m_end) {
+            nextBlock(_bytes + _align);
+            pos = (m_pos + _align - 1) & ~(uintptr_t(_align) - 1);
+        }
+        m_pos = pos + _bytes;
+        m_allocated += _bytes;
+        m_allocations++;
+
+        return reinterpret_cast<void*>(pos);
+    }
+
+    /* Release all allocations. Only valid when no object allocated from this
+     * arena is alive anymore.
+     */
+    void reset() {
+        m_current = 0;
+        m_pos = m_end = 0;
+        if (!m_blocks.empty()) { setBlock(0); }
+        m_allocated = 0;
+        m_allocations = 0;
+    }
+
+    /* Bytes and number of allocations since the last reset */
+    size_t allocated() const { return m_allocated; }
+    size_t allocations() const { return m_allocations; }
+
+    /* Reserved block memory in bytes */
+    size_t capacity() const {
+        size_t bytes = 0;
+        for (auto& block : m_blocks) { bytes += block.size; }
+        return bytes;
+    }
+
+    /* Arena bound to the current thread, nullptr if none */
+    static Arena* current() { return currentArena(); }
+
+    struct Scope {
+        Scope(Arena& _arena) : previous(currentArena()) { currentArena() = &_arena; }
+        ~Scope() { currentArena() = previous; }
+        Arena* previous;
+    };
+
+    /* Unbinds the current arena, for data that must outlive its reset */
+    struct HeapScope {
+        HeapScope() : previous(currentArena()) { currentArena() = nullptr; }
+        ~HeapScope() { currentArena() = previous; }
+        Arena* previous;
+    };
+
+private:
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    void setBlock(size_t _index) {
+        m_current = _index;
+        m_pos = reinterpret_cast<uintptr_t>(m_blocks[_index].data.get());
+        m_end = m_pos + m_blocks[_index].size;
+    }
+
+    void nextBlock(size_t _minSize) {
+        // Continue with blocks kept from before the last reset
+        for (size_t next = m_blocks.empty() ? 0 : m_current + 1; next < m_blocks.size(); next++) {
+            if (m_blocks[next].size >= _minSize) {
+                setBlock(next);
+                return;
+            }
+        }
+        size_t size = std::max(m_blockSize, _minSize);
+        m_blocks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+        setBlock(m_blocks.size() - 1);
+    }
+
+    static Arena*& currentArena() {
+        static thread_local Arena* s_current = nullptr;
+        return s_current;
+    }
+
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_current = 0;
+
+    uintptr_t m_pos = 0;
+    uintptr_t m_end = 0;
+
+    size_t m_allocated = 0;
+    size_t m_allocations = 0;
+};
+
+/* STL allocator taking memory from the Arena that was current when it was created */
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() : arena(Arena::current()) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& _other) : arena(_other.arena) {}
+
+    T* allocate(size_t _n) {
+        if (arena) {
+            return static_cast<T*>(arena->allocate(_n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(_n * sizeof(T)));
+    }
+
+    void deallocate(T* _p, size_t _n) {
+        if (!arena) { ::operator delete(_p); }
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& _other) const { return arena == _other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& _other) const { return arena != _other.arena; }
+
+    Arena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
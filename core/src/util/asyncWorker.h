@@ -1,3 +1,5 @@
+#include "platform.h"
+
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -12,6 +14,13 @@ public:
         thread = std::thread(&AsyncWorker::run, this);
     }
 
+    explicit AsyncWorker(ThreadPolicy _policy) {
+        thread = std::thread([this, _policy]() {
+            setCurrentThreadPolicy(_policy);
+            run();
+        });
+    }
+
     ~AsyncWorker() {
         {
             std::unique_lock<std::mutex> lock(m_mutex);
@@ -1,41 +1,14 @@
 #include "util/builders.h"
 
-#include "util/geom.h"
-
-#include "glm/gtx/rotate_vector.hpp"
-#include "glm/gtx/norm.hpp"
-
-namespace mapbox { namespace util {
-template <>
-struct nth<0, Tangram::Point> {
-    inline static float get(const Tangram::Point &t) { return t.x; };
-};
-template <>
-struct nth<1, Tangram::Point> {
-    inline static float get(const Tangram::Point &t) { return t.y; };
-};
-}}
-
-namespace {
-// Tests if a line segment (from point A to B) is outside the edge of a tile
-bool isOutsideTile(const glm::vec2& _a, const glm::vec2& _b) {
+#include "util/hash.h"
 
-    // tweak this adjust if catching too few/many line segments near tile edges
-    // TODO: make tolerance configurable by source if necessary
-    float tolerance = 0.0005;
-    float tile_min = 0.0 + tolerance;
-    float tile_max = 1.0 - tolerance;
+#include <cmath>
 
-    if ( (_a.x < tile_min && _b.x < tile_min) ||
-         (_a.x > tile_max && _b.x > tile_max) ||
-         (_a.y < tile_min && _b.y < tile_min) ||
-         (_a.y > tile_max && _b.y > tile_max) ) {
-        return true;
-    }
-
-    return false;
-}
-}
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 namespace Tangram {
 
@@ -51,417 +24,252 @@ JoinTypes JoinTypeFromString(const std::string& str) {
     return JoinTypes::miter;
 }
 
-void Builders::buildPolygon(const Polygon& _polygon, float _height, PolygonBuilder& _ctx) {
-
-    glm::vec2 min, max;
-    if (_ctx.useTexCoords) {
-        min = glm::vec2(std::numeric_limits<float>::max());
-        max = glm::vec2(std::numeric_limits<float>::min());
-
-        for (auto& p : _polygon[0]) {
-            min.x = std::min(min.x, p.x);
-            min.y = std::min(min.y, p.y);
-            max.x = std::max(max.x, p.x);
-            max.y = std::max(max.y, p.y);
-        }
-    }
-
-    // Run earcut, triangles are stored in _ctx.earcut.indices
-    _ctx.earcut(_polygon);
-
-    size_t sumPoints = 0;
-    for (auto& line : _polygon) {
-        sumPoints += line.size();
-    }
-
-    // Mark the points that are referenced by indices as used.
-    size_t sumVertices = 0;
-    _ctx.used.assign(sumPoints, 0);
-    for (auto i : _ctx.earcut.indices) {
-        if (_ctx.used[i] == 0) {
-            _ctx.used[i] = 1;
-            sumVertices++;
-        }
-    }
-
-    uint16_t vertexDataOffset = _ctx.numVertices;
-    _ctx.numVertices += sumVertices;
-
-    size_t ring = 0;
-    size_t offset = 0;
-
-    // Go through all points of the polyon.
-    for (size_t src = 0, dst = 0; src < sumPoints; src++) {
-        // The points of the polygon rings are indexed linearly.
-        // This maps the indices back to the original ring and point.
-        if (src - offset >= _polygon[ring].size()) {
-            offset += _polygon[ring].size();
-            ring += 1;
-        }
-
-        // Add vertex only when the point is used.
-        if (_ctx.used[src] == 0) { continue; }
+bool Builders::isOutsideTile(const glm::vec2& _a, const glm::vec2& _b) {
 
-        // Keep track of skipped points to update indices
-        _ctx.used[src] = dst++;
-
-        auto& p = _polygon[ring][src - offset];
-        glm::vec3 coord(p.x, p.y, _height);
-
-        if (_ctx.useTexCoords) {
-            glm::vec2 uv(mapValue(coord.x, min.x, max.x, 0., 1.),
-                         mapValue(coord.y, min.y, max.y, 1., 0.));
+    // tweak this adjust if catching too few/many line segments near tile edges
+    // TODO: make tolerance configurable by source if necessary
+    float tolerance = 0.0005;
+    float tile_min = 0.0 + tolerance;
+    float tile_max = 1.0 - tolerance;
 
-            _ctx.addVertex(coord, glm::vec3(0.0, 0.0, 1.0), uv);
-        } else {
-            _ctx.addVertex(coord, glm::vec3(0.0, 0.0, 1.0), glm::vec2(0));
-        }
+    if ( (_a.x < tile_min && _b.x < tile_min) ||
+         (_a.x > tile_max && _b.x > tile_max) ||
+         (_a.y < tile_min && _b.y < tile_min) ||
+         (_a.y > tile_max && _b.y > tile_max) ) {
+        return true;
     }
 
-    for (auto i : _ctx.earcut.indices) {
-        _ctx.indices.push_back(vertexDataOffset + _ctx.used[i]);
-    }
+    return false;
 }
 
-void Builders::buildPolygonExtrusion(const Polygon& _polygon, float _minHeight, float _maxHeight, PolygonBuilder& _ctx) {
-
-    auto vertexDataOffset = _ctx.numVertices;
-
-    static const glm::vec3 upVector(0.0f, 0.0f, 1.0f);
-    glm::vec3 normalVector;
-
-    for (auto& line : _polygon) {
-
-        size_t lineSize = line.size();
-
-        for (size_t i = 0; i < lineSize - 1; i++) {
+glm::vec2 Builders::perp2d(const glm::vec2& _v1, const glm::vec2& _v2 ){
+    return glm::vec2(_v2.y - _v1.y, _v1.x - _v2.x);
+}
 
-            glm::vec3 a(line[i], 0.f);
-            glm::vec3 b(line[i+1], 0.f);
+const std::vector<uint16_t>& TriangulationCache::get(const Polygon& _polygon) {
 
-            if (!_ctx.keepTileEdges && isOutsideTile(a, b)) {
-                continue;
-            }
-            normalVector = glm::cross(upVector, b - a);
-            normalVector = glm::normalize(normalVector);
+    for (size_t i = 0; i < m_size; i++) {
+        if (m_entries[i].polygon == &_polygon) { return m_entries[i].indices; }
+    }
 
-            if (std::isnan(normalVector.x)
-             || std::isnan(normalVector.y)
-             || std::isnan(normalVector.z)) {
-                continue;
-            }
+    if (m_size == m_entries.size()) { m_entries.emplace_back(); }
 
-            // 1st vertex top
-            a.z = _maxHeight;
-            _ctx.addVertex(a, normalVector, glm::vec2(1.,1.));
+    auto& entry = m_entries[m_size++];
+    auto& indices = Builders::triangulate(_polygon, m_earcut);
 
-            // 2nd vertex top
-            b.z = _maxHeight;
-            _ctx.addVertex(b, normalVector, glm::vec2(0.,1.));
+    entry.polygon = &_polygon;
+    entry.indices.assign(indices.begin(), indices.end());
 
-            // 1st vertex bottom
-            a.z = _minHeight;
-            _ctx.addVertex(a, normalVector, glm::vec2(1.,0.));
+    return entry.indices;
+}
 
-            // 2nd vertex bottom
-            b.z = _minHeight;
-            _ctx.addVertex(b, normalVector, glm::vec2(0.,0.));
+const PolyLineCache::Entry& PolyLineCache::build(Entry& _entry) {
 
-            // Start the index from the previous state of the vertex Data
-            _ctx.indices.push_back(vertexDataOffset);
-            _ctx.indices.push_back(vertexDataOffset + 1);
-            _ctx.indices.push_back(vertexDataOffset + 2);
+    m_builder.cap = _entry.cap;
+    m_builder.join = _entry.join;
+    m_builder.miterLimit = _entry.miterLimit;
+    m_builder.keepTileEdges = _entry.keepTileEdges;
+    m_builder.closedPolygon = _entry.closedPolygon;
+    m_builder.useTexCoords = _entry.useTexCoords;
 
-            _ctx.indices.push_back(vertexDataOffset + 1);
-            _ctx.indices.push_back(vertexDataOffset + 3);
-            _ctx.indices.push_back(vertexDataOffset + 2);
+    _entry.vertices.clear();
+    m_builder.addVertex = { &_entry.vertices };
 
-            vertexDataOffset += 4;
-        }
+    Builders::buildPolyLine(*_entry.line, m_builder);
 
-        _ctx.numVertices = vertexDataOffset;
-    }
-}
+    _entry.indices.assign(m_builder.indices.begin(), m_builder.indices.end());
+    m_builder.clear();
 
-// Get 2D perpendicular of two points
-glm::vec2 perp2d(const glm::vec2& _v1, const glm::vec2& _v2 ){
-    return glm::vec2(_v2.y - _v1.y, _v1.x - _v2.x);
+    return _entry;
 }
 
-// Helper function for polyline tesselation
-inline void addPolyLineVertex(const glm::vec2& _coord, const glm::vec2& _normal, const glm::vec2& _uv, PolyLineBuilder& _ctx) {
-    _ctx.numVertices++;
-    _ctx.addVertex(_coord, _normal, _uv);
+size_t WallOcclusion::EdgeHash::operator()(const Edge& _edge) const {
+    size_t seed = 0;
+    hash_combine(seed, _edge.a.x);
+    hash_combine(seed, _edge.a.y);
+    hash_combine(seed, _edge.b.x);
+    hash_combine(seed, _edge.b.y);
+    return seed;
 }
 
-// Helper function for polyline tesselation; adds indices for pairs of vertices arranged like a line strip
-void indexPairs( int _nPairs, int _nVertices, std::vector<uint16_t>& _indicesOut) {
-    for (int i = 0; i < _nPairs; i++) {
-        _indicesOut.push_back(_nVertices - 2*i - 4);
-        _indicesOut.push_back(_nVertices - 2*i - 2);
-        _indicesOut.push_back(_nVertices - 2*i - 3);
-
-        _indicesOut.push_back(_nVertices - 2*i - 3);
-        _indicesOut.push_back(_nVertices - 2*i - 2);
-        _indicesOut.push_back(_nVertices - 2*i - 1);
-    }
-}
+bool WallOcclusion::occluded(const glm::vec2& _a, const glm::vec2& _b, float _minHeight, float _maxHeight) {
 
-//  Tessalate a fan geometry between points A       B
-//  using their normals from a center        \ . . /
-//  and interpolating their UVs               \ p /
-//                                             \./
-//                                              C
-void addFan(const glm::vec2& _pC,
-            const glm::vec2& _nA, const glm::vec2& _nB, const glm::vec2& _nC,
-            const glm::vec2& _uA, const glm::vec2& _uB, const glm::vec2& _uC,
-            int _numTriangles, PolyLineBuilder& _ctx) {
-
-    // Find angle difference
-    float cross = _nA.x * _nB.y - _nA.y * _nB.x; // z component of cross(_CA, _CB)
-    float angle = atan2f(cross, glm::dot(_nA, _nB));
-
-    int startIndex = _ctx.numVertices;
-
-    // Add center vertex
-    addPolyLineVertex(_pC, _nC, _uC, _ctx);
-
-    // Add vertex for point A
-    addPolyLineVertex(_pC, _nA, _uA, _ctx);
-
-    // Add radial vertices
-    glm::vec2 radial = _nA;
-    for (int i = 0; i < _numTriangles; i++) {
-        float frac = (i + 1)/(float)_numTriangles;
-        radial = glm::rotate(_nA, angle * frac);
-
-        glm::vec2 uv(0.0);
-        if (_ctx.useTexCoords) {
-            uv = (1.f - frac) * _uA + frac * _uB;
-        }
+    // Neighbouring rings may wind the same or the opposite way
+    Edge edge = (_a.x < _b.x || (_a.x == _b.x && _a.y < _b.y)) ? Edge{ _a, _b } : Edge{ _b, _a };
 
-        addPolyLineVertex(_pC, radial, uv, _ctx);
+    float minHeight = std::min(_minHeight, _maxHeight);
+    float maxHeight = std::max(_minHeight, _maxHeight);
 
-        // Add indices
-        _ctx.indices.push_back(startIndex); // center vertex
-        _ctx.indices.push_back(startIndex + i + (angle > 0 ? 1 : 2));
-        _ctx.indices.push_back(startIndex + i + (angle > 0 ? 2 : 1));
+    auto it = m_walls.find(edge);
+    if (it == m_walls.end()) {
+        m_walls.emplace(edge, glm::vec2(minHeight, maxHeight));
+        return false;
     }
 
-}
+    auto& range = it->second;
+    if (range.x <= minHeight && range.y >= maxHeight) { return true; }
 
-// Function to add the vertices for line caps
-void addCap(const glm::vec2& _coord, const glm::vec2& _normal, int _numCorners, bool _isBeginning, PolyLineBuilder& _ctx) {
-
-    float v = _isBeginning ? 0.f : 1.f; // length-wise tex coord
-
-    if (_numCorners < 1) {
-        // "Butt" cap needs no extra vertices
-        return;
-    } else if (_numCorners == 2) {
-        // "Square" cap needs two extra vertices
-        glm::vec2 tangent(-_normal.y, _normal.x);
-        addPolyLineVertex(_coord, _normal + tangent, {0.f, v}, _ctx);
-        addPolyLineVertex(_coord, -_normal + tangent, {0.f, v}, _ctx);
-        if (!_isBeginning) { // At the beginning of a line we can't form triangles with previous vertices
-            indexPairs(1, _ctx.numVertices, _ctx.indices);
-        }
-        return;
-    }
+    // Keep the larger wall, covering more of the walls to come
+    if (maxHeight - minHeight > range.y - range.x) { range = { minHeight, maxHeight }; }
 
-    // "Round" cap type needs a fan of vertices
-    glm::vec2 nA(_normal), nB(-_normal), nC(0.f, 0.f), uA(1.f, v), uB(0.f, v), uC(0.5f, v);
-    if (_isBeginning) {
-        nA *= -1.f; // To flip the direction of the fan, we negate the normal vectors
-        nB *= -1.f;
-        uA.x = 0.f; // To keep tex coords consistent, we must reverse these too
-        uB.x = 1.f;
-    }
-    addFan(_coord, nA, nB, nC, uA, uB, uC, _numCorners, _ctx);
+    return false;
 }
 
-void buildPolyLineSegment(const Line& _line, PolyLineBuilder& _ctx, size_t _startIndex,
-                          size_t _endIndex, bool endCap = true) {
-
-    float distance = 0; // Cumulative distance along the polyline.
+bool Builders::isConvex(const Line& _ring, size_t& _size, bool& _clockwise) {
 
-    size_t origLineSize = _line.size();
+    size_t n = _ring.size();
+    if (n > 1 && _ring[0] == _ring[n - 1]) { n--; }
+    if (n < 3) { return false; }
 
-    // endIndex/startIndex could be wrapped values, calculate lineSize accordingly
-    int lineSize = (int)((_endIndex > _startIndex) ?
-                   (_endIndex - _startIndex) :
-                   (origLineSize - _startIndex + _endIndex));
-    if (lineSize < 2) { return; }
+    float turn = 0.f;
+    float dirX = 0.f, dirY = 0.f;
+    int flipsX = 0, flipsY = 0;
 
-    glm::vec2 coordCurr(_line[_startIndex]);
-    // get the Point using wrapped index in the original line geometry
-    glm::vec2 coordNext(_line[(_startIndex + 1) % origLineSize]);
-    glm::vec2 normPrev, normNext, miterVec;
+    glm::vec2 prev = _ring[n - 1] - _ring[n - 2];
 
-    int cornersOnCap = (int)_ctx.cap;
-    int trianglesOnJoin = (int)_ctx.join;
+    for (size_t i = 0; i < n; i++) {
+        glm::vec2 edge = _ring[i] - _ring[(i + n - 1) % n];
 
-    // Process first point in line with an end cap
-    normNext = glm::normalize(perp2d(coordCurr, coordNext));
-
-    if (endCap) {
-        addCap(coordCurr, normNext, cornersOnCap, true, _ctx);
-    }
-    addPolyLineVertex(coordCurr, normNext, {1.0f, 0.0f}, _ctx); // right corner
-    addPolyLineVertex(coordCurr, -normNext, {0.0f, 0.0f}, _ctx); // left corner
-
-
-    // Process intermediate points
-    for (int i = 1; i < lineSize - 1; i++) {
-        // get the Point using wrapped index in the original line geometry
-        int nextIndex = (i + _startIndex + 1) % origLineSize;
-
-        distance += glm::distance(coordCurr, coordNext);
-
-        coordCurr = coordNext;
-        coordNext = _line[nextIndex];
-
-        if (coordCurr == coordNext) {
-            continue;
+        // All corners must turn the same way
+        float cross = prev.x * edge.y - prev.y * edge.x;
+        if (cross != 0.f) {
+            if (cross * turn < 0.f) { return false; }
+            turn = cross;
         }
 
-        normPrev = normNext;
-        normNext = glm::normalize(perp2d(coordCurr, coordNext));
-
-        // Compute "normal" for miter joint
-        miterVec = normPrev + normNext;
-
-        float scale = 1.f;
-
-        // normPrev and normNext are in the opposite direction
-        // in order to prevent NaN values, we use the perp
-        // vector of those two vectors
-        if (miterVec == glm::zero<glm::vec2>()) {
-            miterVec = perp2d(glm::vec3(normNext, 0.f), glm::vec3(normPrev, 0.f));
-        } else {
-            scale = 2.f / glm::dot(miterVec, miterVec);
+        // A convex ring changes its direction along each axis only twice,
+        // which rules out rings winding around more than once
+        if (edge.x != 0.f) {
+            if (edge.x * dirX < 0.f) { flipsX++; }
+            dirX = edge.x;
         }
-
-        miterVec *= scale;
-
-        if (glm::length2(miterVec) > glm::length2(_ctx.miterLimit)) {
-            trianglesOnJoin = 1;
-            miterVec *= _ctx.miterLimit / glm::length(miterVec);
+        if (edge.y != 0.f) {
+            if (edge.y * dirY < 0.f) { flipsY++; }
+            dirY = edge.y;
         }
+        if (flipsX > 2 || flipsY > 2) { return false; }
 
-        float v = distance;
-
-        if (trianglesOnJoin == 0) {
-            // Join type is a simple miter
-
-            addPolyLineVertex(coordCurr, miterVec, {1.0, v}, _ctx); // right corner
-            addPolyLineVertex(coordCurr, -miterVec, {0.0, v}, _ctx); // left corner
-            indexPairs(1, _ctx.numVertices, _ctx.indices);
-
-        } else {
-
-            // Join type is a fan of triangles
-
-            bool isRightTurn = (normNext.x * normPrev.y - normNext.y * normPrev.x) > 0; // z component of cross(normNext, normPrev)
-
-            if (isRightTurn) {
-
-                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _ctx); // right (inner) corner
-                addPolyLineVertex(coordCurr, -normPrev, {0.0f, v}, _ctx); // left (outer) corner
-                indexPairs(1, _ctx.numVertices, _ctx.indices);
+        prev = edge;
+    }
 
-                addFan(coordCurr, -normPrev, -normNext, miterVec, {0.f, v}, {0.f, v}, {1.f, v}, trianglesOnJoin, _ctx);
+    _size = n;
+    _clockwise = turn < 0.f;
 
-                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _ctx); // right (inner) corner
-                addPolyLineVertex(coordCurr, -normNext, {0.0f, v}, _ctx); // left (outer) corner
+    return turn != 0.f;
+}
 
-            } else {
+const std::vector<uint16_t>& Builders::triangulate(const Polygon& _polygon, mapbox::detail::Earcut<uint16_t>& _earcut) {
 
-                addPolyLineVertex(coordCurr, normPrev, {1.0f, v}, _ctx); // right (outer) corner
-                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _ctx); // left (inner) corner
-                indexPairs(1, _ctx.numVertices, _ctx.indices);
+    size_t size;
+    bool clockwise;
 
-                addFan(coordCurr, normPrev, normNext, -miterVec, {1.f, v}, {1.f, v}, {0.0f, v}, trianglesOnJoin, _ctx);
+    if (_polygon.size() == 1 && isConvex(_polygon[0], size, clockwise)) {
+        auto& indices = _earcut.indices;
+        indices.clear();
 
-                addPolyLineVertex(coordCurr, normNext, {1.0f, v}, _ctx); // right (outer) corner
-                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _ctx); // left (inner) corner
-            }
+        // Emit the triangles with the same winding as earcut
+        uint16_t a = clockwise ? 0 : 1;
+        uint16_t b = clockwise ? 1 : 0;
+        for (uint16_t i = 1; i + 1 < size; i++) {
+            indices.push_back(0);
+            indices.push_back(i + a);
+            indices.push_back(i + b);
         }
+        return indices;
     }
 
-    distance += glm::distance(coordCurr, coordNext);
-
-    // Process last point in line with a cap
-    addPolyLineVertex(coordNext, normNext, {1.f, distance}, _ctx); // right corner
-    addPolyLineVertex(coordNext, -normNext, {0.f, distance}, _ctx); // left corner
-    indexPairs(1, _ctx.numVertices, _ctx.indices);
-    if (endCap) {
-        addCap(coordNext, normNext, cornersOnCap, false, _ctx);
-    }
+    _earcut(_polygon);
 
+    return _earcut.indices;
 }
 
-void Builders::buildPolyLine(const Line& _line, PolyLineBuilder& _ctx) {
+void Builders::polygonSize(const Polygon& _polygon, bool _extrude, size_t& _vertices, size_t& _indices) {
 
-    size_t lineSize = _line.size();
+    size_t points = 0;
+    for (auto& line : _polygon) { points += line.size(); }
 
-    if (_ctx.keepTileEdges) {
-
-        buildPolyLineSegment(_line, _ctx, 0, lineSize);
-
-    } else {
-
-        int cut = 0;
-        int firstCutEnd = 0;
-
-        // Determine cuts
-        for (size_t i = 0; i < lineSize - 1; i++) {
-            const glm::vec2& coordCurr = _line[i];
-            const glm::vec2& coordNext = _line[i+1];
-            if (isOutsideTile(coordCurr, coordNext)) {
-                if (cut == 0) {
-                    firstCutEnd = i + 1;
-                }
-                buildPolyLineSegment(_line, _ctx, cut, i + 1);
-                cut = i + 1;
-            }
-        }
-
-        if (_ctx.closedPolygon) {
-            if (cut == 0) {
-                // no tile edge cuts!
-                // loop and close the polygon with no endcaps
-                buildPolyLineSegment(_line, _ctx, 0, lineSize+2, false);
-            } else {
-                // merge first and last cut line-segments together
-                buildPolyLineSegment(_line, _ctx, cut, firstCutEnd);
-            }
-        } else {
-            buildPolyLineSegment(_line, _ctx, cut, lineSize);
-        }
+    // Earcut adds n + 2h - 2 triangles for n points in h holes
+    _vertices = points;
+    _indices = 3 * (points + 2 * _polygon.size());
 
+    if (_extrude) {
+        // A quad for each edge
+        _vertices += 4 * points;
+        _indices += 6 * points;
     }
-
 }
 
-void Builders::buildQuadAtPoint(const glm::vec2& _screenPosition, const glm::vec2& _size, const glm::vec2& _uvBL, const glm::vec2& _uvTR, SpriteBuilder& _ctx) {
-    float halfWidth = _size.x * .5f;
-    float halfHeight = _size.y * .5f;
-
-    _ctx.addVertex(glm::vec2(-halfWidth, -halfHeight), _screenPosition, {_uvBL.x, _uvBL.y});
-    _ctx.addVertex(glm::vec2(-halfWidth, halfHeight), _screenPosition, {_uvBL.x, _uvTR.y});
-    _ctx.addVertex(glm::vec2(halfWidth, -halfHeight), _screenPosition, {_uvTR.x, _uvBL.y});
-    _ctx.addVertex(glm::vec2(halfWidth, halfHeight), _screenPosition, {_uvTR.x, _uvTR.y});
-
-    _ctx.indices.push_back(_ctx.numVerts + 2);
-    _ctx.indices.push_back(_ctx.numVerts + 0);
-    _ctx.indices.push_back(_ctx.numVerts + 1);
-    _ctx.indices.push_back(_ctx.numVerts + 1);
-    _ctx.indices.push_back(_ctx.numVerts + 3);
-    _ctx.indices.push_back(_ctx.numVerts + 2);
+void Builders::segmentNormals(const Line& _line, std::vector<glm::vec2>& _normals, std::vector<float>& _lengths) {
+
+    size_t n = _line.size();
+    _normals.resize(n);
+    _lengths.resize(n);
+
+    size_t i = 0;
+
+    // Two segments per iteration: load points i, i+1 and i+1, i+2 and compute
+    // perp2d() and glm::normalize() lane-wise with the same operations, so
+    // that the results are identical to the scalar path.
+#if defined(__SSE2__)
+    const float* points = &_line[0].x;
+    const __m128 sign = _mm_set_ps(-1.f, 1.f, -1.f, 1.f);
+    const __m128 one = _mm_set1_ps(1.f);
+
+    for (; i + 2 < n; i += 2) {
+        __m128 a = _mm_loadu_ps(points + 2 * i);
+        __m128 b = _mm_loadu_ps(points + 2 * i + 2);
+        __m128 d = _mm_sub_ps(b, a);
+        // (dx, dy) -> (dy, -dx)
+        __m128 perp = _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), sign);
+        __m128 sq = _mm_mul_ps(perp, perp);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1))));
+        __m128 norm = _mm_mul_ps(perp, _mm_div_ps(one, len));
+
+        _mm_storeu_ps(&_normals[i].x, norm);
+        _lengths[i] = _mm_cvtss_f32(len);
+        _lengths[i + 1] = _mm_cvtss_f32(_mm_movehl_ps(len, len));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float* points = &_line[0].x;
+    const float signValues[4] = { 1.f, -1.f, 1.f, -1.f };
+    const float32x4_t sign = vld1q_f32(signValues);
+    const float32x4_t one = vdupq_n_f32(1.f);
+
+    for (; i + 2 < n; i += 2) {
+        float32x4_t a = vld1q_f32(points + 2 * i);
+        float32x4_t b = vld1q_f32(points + 2 * i + 2);
+        float32x4_t d = vsubq_f32(b, a);
+        // (dx, dy) -> (dy, -dx)
+        float32x4_t perp = vmulq_f32(vrev64q_f32(d), sign);
+        float32x4_t sq = vmulq_f32(perp, perp);
+        float32x4_t len = vsqrtq_f32(vaddq_f32(sq, vrev64q_f32(sq)));
+        float32x4_t norm = vmulq_f32(perp, vdivq_f32(one, len));
+
+        vst1q_f32(&_normals[i].x, norm);
+        _lengths[i] = vgetq_lane_f32(len, 0);
+        _lengths[i + 1] = vgetq_lane_f32(len, 2);
+    }
+#endif
+
+    // Remaining segments and the one closing the line
+    for (; i < n; i++) {
+        glm::vec2 perp = perp2d(_line[i], _line[(i + 1) % n]);
+        float len = std::sqrt(glm::dot(perp, perp));
+        _normals[i] = perp * (1.f / len);
+        _lengths[i] = len;
+    }
+}
 
-    _ctx.numVerts += 4;
+void Builders::indexPairs( int _nPairs, int _nVertices, std::vector<uint16_t>& _indicesOut) {
+    for (int i = 0; i < _nPairs; i++) {
+        _indicesOut.push_back(_nVertices - 2*i - 4);
+        _indicesOut.push_back(_nVertices - 2*i - 2);
+        _indicesOut.push_back(_nVertices - 2*i - 3);
 
+        _indicesOut.push_back(_nVertices - 2*i - 3);
+        _indicesOut.push_back(_nVertices - 2*i - 2);
+        _indicesOut.push_back(_nVertices - 2*i - 1);
+    }
 }
 
 }
@@ -2,10 +2,26 @@
 
 #include "data/tileData.h"
 
+#include "util/geom.h"
+
 #include "earcut.hpp"
+#include "glm/gtx/rotate_vector.hpp"
+#include "glm/gtx/norm.hpp"
 #include <functional>
+#include <unordered_map>
 #include <vector>
 
+namespace mapbox { namespace util {
+template <>
+struct nth<0, Tangram::Point> {
+    inline static float get(const Tangram::Point &t) { return t.x; };
+};
+template <>
+struct nth<1, Tangram::Point> {
+    inline static float get(const Tangram::Point &t) { return t.y; };
+};
+}}
+
 
 namespace Tangram {
 
@@ -33,22 +49,96 @@ JoinTypes JoinTypeFromString(const std::string& str);
  */
 typedef std::function<void(const glm::vec3& coord, const glm::vec3& normal, const glm::vec2& uv)> PolygonVertexFn;
 
+/* Triangulations of the polygons of one feature
+ *
+ * Shared by the style builders of a TileBuilder so that a polygon drawn by
+ * several rules, e.g. flat and extruded or with an outline_style, is only
+ * triangulated once. Polygons are identified by address, so the cache must
+ * be cleared before building the next feature.
+ */
+class TriangulationCache {
+public:
+    // Returns the triangle indices of _polygon, see Builders::triangulate()
+    const std::vector<uint16_t>& get(const Polygon& _polygon);
+
+    void clear() { m_size = 0; }
+
+private:
+    struct Entry {
+        const Polygon* polygon = nullptr;
+        std::vector<uint16_t> indices;
+    };
+    // The first m_size entries are in use, the others keep their capacity
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+
+    mapbox::detail::Earcut<uint16_t> m_earcut;
+};
+
+/* Walls built by Builders::buildPolygonExtrusion() in one tile
+ *
+ * Adjacent buildings share the edges between them. A wall along such an edge
+ * that is covered by the wall of a building added before only z-fights with
+ * it, and is hidden inside that building in the first place.
+ */
+class WallOcclusion {
+public:
+    /* Returns true when the wall from _a to _b between _minHeight and
+     * _maxHeight is covered by a wall added before, otherwise adds it */
+    bool occluded(const glm::vec2& _a, const glm::vec2& _b, float _minHeight, float _maxHeight);
+
+    void clear() { m_walls.clear(); }
+
+private:
+    struct Edge {
+        glm::vec2 a, b;
+        bool operator==(const Edge& _other) const { return a == _other.a && b == _other.b; }
+    };
+    struct EdgeHash {
+        size_t operator()(const Edge& _edge) const;
+    };
+    // Height range of the walls along each edge, endpoints in ascending order
+    std::unordered_map<Edge, glm::vec2, EdgeHash> m_walls;
+};
+
 /* PolygonBuilder context,
  * see Builders::buildPolygon() and Builders::buildPolygonExtrusion()
+ *
+ * VertexFn is called with the arguments of PolygonVertexFn. Styles pass a
+ * functor type so that the vertex writes are inlined into the builder.
  */
-struct PolygonBuilder {
+template<typename VertexFn>
+struct PolygonBuilderT {
     std::vector<uint16_t> indices; // indices for drawing the polyon as triangles are added to this vector
     std::vector<int> used;
 
-    PolygonVertexFn addVertex;
+    VertexFn addVertex;
     size_t numVertices = 0;
     bool keepTileEdges;
     bool useTexCoords;
 
     mapbox::detail::Earcut<uint16_t> earcut;
 
-    PolygonBuilder(PolygonVertexFn _addVertex = [](auto&,auto&,auto&){},
-                   bool _kte = true, bool _useTexCoords = true)
+    // Optional cache to share triangulations with other builders
+    TriangulationCache* triangulation = nullptr;
+
+    // Adjacent walls whose normals differ less than this angle, in radians,
+    // share their vertices and are shaded smoothly, e.g. on curved facades.
+    // Not applied to walls with texture coordinates.
+    float wallSmoothAngle = 0.35f;
+
+    // Optional walls of the tile, to skip walls covered by a neighbour
+    WallOcclusion* occlusion = nullptr;
+
+    // Scratch space of buildPolygonExtrusion()
+    struct Wall {
+        size_t index;
+        glm::vec3 normal;
+    };
+    std::vector<Wall> walls;
+
+    PolygonBuilderT(VertexFn _addVertex = VertexFn(),
+                    bool _kte = true, bool _useTexCoords = true)
         : addVertex(_addVertex), keepTileEdges(_kte), useTexCoords(_useTexCoords){}
 
     void clear() {
@@ -57,6 +147,8 @@ struct PolygonBuilder {
     }
 };
 
+using PolygonBuilder = PolygonBuilderT<PolygonVertexFn>;
+
 
 /* Callback function for PolyLineBuilder:
  *
@@ -68,10 +160,13 @@ typedef std::function<void(const glm::vec2& coord, const glm::vec2& enormal, con
 
 /* PolyLineBuilder context,
  * see Builders::buildPolyLine()
+ *
+ * VertexFn is called with the arguments of PolyLineVertexFn.
  */
-struct PolyLineBuilder {
+template<typename VertexFn>
+struct PolyLineBuilderT {
     std::vector<uint16_t> indices; // indices for drawing the polyline as triangles are added to this vector
-    PolyLineVertexFn addVertex;
+    VertexFn addVertex;
     size_t numVertices = 0;
     float miterLimit = 3.f;
     CapTypes cap;
@@ -80,10 +175,15 @@ struct PolyLineBuilder {
     bool closedPolygon;
     bool useTexCoords = false;
 
-    PolyLineBuilder(PolyLineVertexFn _addVertex = [](auto&,auto&,auto&){},
-                    CapTypes _cap = CapTypes::butt,
-                    JoinTypes _join = JoinTypes::bevel,
-                    bool _kte = true, bool _closedPoly = false)
+    // Scratch space of buildPolyLine(): unit normal and length of the segment
+    // from each point to the next, wrapping around to the first point
+    std::vector<glm::vec2> normals;
+    std::vector<float> lengths;
+
+    PolyLineBuilderT(VertexFn _addVertex = VertexFn(),
+                     CapTypes _cap = CapTypes::butt,
+                     JoinTypes _join = JoinTypes::bevel,
+                     bool _kte = true, bool _closedPoly = false)
         : addVertex(_addVertex), cap(_cap), join(_join), keepTileEdges(_kte), closedPolygon(_closedPoly) {}
 
     void clear() {
@@ -92,6 +192,66 @@ struct PolyLineBuilder {
     }
 };
 
+using PolyLineBuilder = PolyLineBuilderT<PolyLineVertexFn>;
+
+/* Tesselations of the lines of one feature by Builders::buildPolyLine()
+ *
+ * A line drawn with an outline_style is built by the polyline builders of
+ * the outline and of the fill. Line widths are vertex attributes, so both
+ * take the same coordinates and extrusion vectors and only tesselate the
+ * line once. Lines are identified by address and the options of the
+ * builder, so the cache must be cleared before building the next feature.
+ */
+class PolyLineCache {
+public:
+    struct Vertex {
+        glm::vec2 coord;
+        glm::vec2 enormal;
+        glm::vec2 uv;
+    };
+
+    struct Entry {
+        const Line* line = nullptr;
+        CapTypes cap;
+        JoinTypes join;
+        float miterLimit;
+        bool keepTileEdges;
+        bool closedPolygon;
+        bool useTexCoords;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint16_t> indices;
+    };
+
+    // Returns the tesselation of _line with the options of _ctx, valid until the next call
+    template<typename F>
+    const Entry& get(const Line& _line, const PolyLineBuilderT<F>& _ctx);
+
+    // Lines are only kept while enabled, i.e. for the builders that share them
+    void setEnabled(bool _enabled) { m_enabled = _enabled; }
+    bool enabled() const { return m_enabled; }
+
+    void clear() { m_size = 0; }
+
+private:
+    struct Recorder {
+        std::vector<Vertex>* vertices;
+
+        void operator()(const glm::vec2& _coord, const glm::vec2& _enormal, const glm::vec2& _uv) {
+            vertices->push_back({ _coord, _enormal, _uv });
+        }
+    };
+
+    const Entry& build(Entry& _entry);
+
+    // The first m_size entries are in use, the others keep their capacity
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+    bool m_enabled = false;
+
+    PolyLineBuilderT<Recorder> m_builder;
+};
+
 /* Callback function for SpriteBuilder
  * @coord tesselated coordinates of the sprite quad in screen space
  * @screenPos the screen position
@@ -101,14 +261,17 @@ typedef std::function<void(const glm::vec2& coord, const glm::vec2& screenPos, c
 
 /* SpriteBuidler context
  */
-struct SpriteBuilder {
+template<typename VertexFn>
+struct SpriteBuilderT {
     std::vector<uint16_t> indices;
-    SpriteBuilderFn addVertex;
+    VertexFn addVertex;
     size_t numVerts = 0;
 
-    SpriteBuilder(SpriteBuilderFn _addVertex) : addVertex(_addVertex) {}
+    SpriteBuilderT(VertexFn _addVertex) : addVertex(_addVertex) {}
 };
 
+using SpriteBuilder = SpriteBuilderT<SpriteBuilderFn>;
+
 class Builders {
 
 public:
@@ -117,21 +280,24 @@ public:
      * @_polygon input coordinates describing the polygon
      * @_ctx output vectors, see <PolygonBuilder>
      */
-    static void buildPolygon(const Polygon& _polygon, float _height, PolygonBuilder& _ctx);
+    template<typename F>
+    static void buildPolygon(const Polygon& _polygon, float _height, PolygonBuilderT<F>& _ctx);
 
     /* Build extruded 'walls' from a polygon
      * @_polygon input coordinates describing the polygon
      * @_minHeight the extrusion will extend from this z coordinate to the z of the polygon points
      * @_ctx output vectors, see <PolygonBuilder>
      */
-    static void buildPolygonExtrusion(const Polygon& _polygon, float _minHeight, float _maxHeight, PolygonBuilder& _ctx);
+    template<typename F>
+    static void buildPolygonExtrusion(const Polygon& _polygon, float _minHeight, float _maxHeight, PolygonBuilderT<F>& _ctx);
 
     /* Build a tesselated polygon line of fixed width from line coordinates
      * @_line input coordinates describing the line
      * @_options parameters for polyline construction
      * @_ctx output vectors, see <PolyLineBuilder>
      */
-    static void buildPolyLine(const Line& _line, PolyLineBuilder& _ctx);
+    template<typename F>
+    static void buildPolyLine(const Line& _line, PolyLineBuilderT<F>& _ctx);
 
     /* Build a tesselated quad centered on _screenOrigin
      * @_screenOrigin the sprite origin in screen space
@@ -140,8 +306,599 @@ public:
      * @_uvTR the top right UV coordinate of the quad
      * @_ctx output vectors, see <SpriteBuilder>
      */
-    static void buildQuadAtPoint(const glm::vec2& _screenOrigin, const glm::vec2& _size, const glm::vec2& _uvBL, const glm::vec2& _uvTR, SpriteBuilder& _ctx);
+    template<typename F>
+    static void buildQuadAtPoint(const glm::vec2& _screenOrigin, const glm::vec2& _size, const glm::vec2& _uvBL, const glm::vec2& _uvTR, SpriteBuilderT<F>& _ctx);
+
+    /* Triangulate _polygon into _earcut.indices. Convex rings without holes,
+     * like most building footprints, are triangulated as a fan instead of
+     * running earcut.
+     */
+    static const std::vector<uint16_t>& triangulate(const Polygon& _polygon, mapbox::detail::Earcut<uint16_t>& _earcut);
+
+    /* Upper bound of the vertices and indices added by buildPolygon() and,
+     * when _extrude is set, buildPolygonExtrusion(), to reserve output storage
+     */
+    static void polygonSize(const Polygon& _polygon, bool _extrude, size_t& _vertices, size_t& _indices);
+
+    /* Estimated number of vertices and indices added by buildPolyLine() for
+     * the cap and join types of _ctx. Exact for lines without tile edge cuts,
+     * duplicate points and joins past the miter limit.
+     */
+    template<typename F>
+    static void polyLineSize(const Line& _line, const PolyLineBuilderT<F>& _ctx, size_t& _vertices, size_t& _indices);
+
+private:
+
+    // Tests if a line segment (from point A to B) is outside the edge of a tile
+    static bool isOutsideTile(const glm::vec2& _a, const glm::vec2& _b);
+
+    // Tests if _ring is a convex polygon, optionally closed by repeating the
+    // first point, and returns its number of distinct points and winding
+    static bool isConvex(const Line& _ring, size_t& _size, bool& _clockwise);
 
+    // Get 2D perpendicular of two points
+    static glm::vec2 perp2d(const glm::vec2& _v1, const glm::vec2& _v2);
+
+    // Computes normals and lengths of all segments of _line in batches,
+    // using SSE2 or NEON where available
+    static void segmentNormals(const Line& _line, std::vector<glm::vec2>& _normals, std::vector<float>& _lengths);
+
+    // Adds indices for pairs of vertices arranged like a line strip
+    static void indexPairs(int _nPairs, int _nVertices, std::vector<uint16_t>& _indicesOut);
+
+    template<typename F>
+    static void addPolyLineVertex(const glm::vec2& _coord, const glm::vec2& _normal, const glm::vec2& _uv, PolyLineBuilderT<F>& _ctx);
+
+    template<typename F>
+    static void addFan(const glm::vec2& _pC,
+                       const glm::vec2& _nA, const glm::vec2& _nB, const glm::vec2& _nC,
+                       const glm::vec2& _uA, const glm::vec2& _uB, const glm::vec2& _uC,
+                       int _numTriangles, PolyLineBuilderT<F>& _ctx);
+
+    template<typename F>
+    static void addCap(const glm::vec2& _coord, const glm::vec2& _normal, int _numCorners, bool _isBeginning, PolyLineBuilderT<F>& _ctx);
+
+    template<typename F>
+    static void buildPolyLineSegment(const Line& _line, PolyLineBuilderT<F>& _ctx, size_t _startIndex,
+                                     size_t _endIndex, bool endCap = true);
 };
 
+template<typename F>
+void Builders::buildPolygon(const Polygon& _polygon, float _height, PolygonBuilderT<F>& _ctx) {
+
+    glm::vec2 min, max;
+    if (_ctx.useTexCoords) {
+        min = glm::vec2(std::numeric_limits<float>::max());
+        max = glm::vec2(std::numeric_limits<float>::min());
+
+        for (auto& p : _polygon[0]) {
+            min.x = std::min(min.x, p.x);
+            min.y = std::min(min.y, p.y);
+            max.x = std::max(max.x, p.x);
+            max.y = std::max(max.y, p.y);
+        }
+    }
+
+    const auto& triangles = _ctx.triangulation ?
+        _ctx.triangulation->get(_polygon) :
+        triangulate(_polygon, _ctx.earcut);
+
+    size_t sumPoints = 0;
+    for (auto& line : _polygon) {
+        sumPoints += line.size();
+    }
+
+    // Mark the points that are referenced by indices as used.
+    size_t sumVertices = 0;
+    _ctx.used.assign(sumPoints, 0);
+    for (auto i : triangles) {
+        if (_ctx.used[i] == 0) {
+            _ctx.used[i] = 1;
+            sumVertices++;
+        }
+    }
+
+    uint16_t vertexDataOffset = _ctx.numVertices;
+    _ctx.numVertices += sumVertices;
+
+    size_t ring = 0;
+    size_t offset = 0;
+
+    // Go through all points of the polyon.
+    for (size_t src = 0, dst = 0; src < sumPoints; src++) {
+        // The points of the polygon rings are indexed linearly.
+        // This maps the indices back to the original ring and point.
+        if (src - offset >= _polygon[ring].size()) {
+            offset += _polygon[ring].size();
+            ring += 1;
+        }
+
+        // Add vertex only when the point is used.
+        if (_ctx.used[src] == 0) { continue; }
+
+        // Keep track of skipped points to update indices
+        _ctx.used[src] = dst++;
+
+        auto& p = _polygon[ring][src - offset];
+        glm::vec3 coord(p.x, p.y, _height);
+
+        if (_ctx.useTexCoords) {
+            glm::vec2 uv(mapValue(coord.x, min.x, max.x, 0., 1.),
+                         mapValue(coord.y, min.y, max.y, 1., 0.));
+
+            _ctx.addVertex(coord, glm::vec3(0.0, 0.0, 1.0), uv);
+        } else {
+            _ctx.addVertex(coord, glm::vec3(0.0, 0.0, 1.0), glm::vec2(0));
+        }
+    }
+
+    for (auto i : triangles) {
+        _ctx.indices.push_back(vertexDataOffset + _ctx.used[i]);
+    }
+}
+
+template<typename F>
+void Builders::buildPolygonExtrusion(const Polygon& _polygon, float _minHeight, float _maxHeight, PolygonBuilderT<F>& _ctx) {
+
+    static const glm::vec3 upVector(0.0f, 0.0f, 1.0f);
+
+    size_t vertex = _ctx.numVertices;
+
+    // Walls with texture coordinates can't share their vertices
+    float minSmoothCos = _ctx.useTexCoords ? 2.f : std::cos(_ctx.wallSmoothAngle);
+
+    auto& walls = _ctx.walls;
+
+    for (auto& line : _polygon) {
+
+        size_t lineSize = line.size();
+        if (lineSize < 2) { continue; }
+
+        // Collect the walls of this ring: the index of their first point and normal
+        walls.clear();
+
+        for (size_t i = 0; i < lineSize - 1; i++) {
+
+            const glm::vec2& a = line[i];
+            const glm::vec2& b = line[i+1];
+
+            if (!_ctx.keepTileEdges && isOutsideTile(a, b)) {
+                continue;
+            }
+            glm::vec3 normalVector = glm::normalize(glm::cross(upVector, glm::vec3(b - a, 0.f)));
+
+            if (std::isnan(normalVector.x)
+             || std::isnan(normalVector.y)
+             || std::isnan(normalVector.z)) {
+                continue;
+            }
+
+            if (_ctx.occlusion && _ctx.occlusion->occluded(a, b, _minHeight, _maxHeight)) {
+                continue;
+            }
+
+            walls.push_back({ i, normalVector });
+        }
+
+        if (walls.empty()) { continue; }
+
+        // Walls share a corner when they are adjacent and their normals are
+        // close enough. The last wall of a closed ring connects to the first.
+        bool closed = line.front() == line.back();
+        auto joins = [&](size_t _w, size_t _next) {
+            auto& w = walls[_w];
+            auto& next = walls[_next];
+            bool adjacent = (w.index + 1 == next.index) ||
+                            (closed && w.index == lineSize - 2 && next.index == 0);
+            return adjacent && glm::dot(w.normal, next.normal) >= minSmoothCos;
+        };
+
+        size_t numWalls = walls.size();
+        bool wrapJoin = numWalls > 1 && joins(numWalls - 1, 0);
+
+        size_t firstTop = 0, firstBottom = 0;
+        size_t prevTop = 0, prevBottom = 0;
+
+        for (size_t w = 0; w < numWalls; w++) {
+
+            auto& wall = walls[w];
+            glm::vec3 a(line[wall.index], 0.f);
+            glm::vec3 b(line[wall.index + 1], 0.f);
+
+            bool joinsPrev = (w > 0) ? joins(w - 1, w) : wrapJoin;
+            bool joinsNext = (w + 1 < numWalls) ? joins(w, w + 1) : wrapJoin;
+
+            size_t startTop, startBottom;
+
+            if (joinsPrev && w > 0) {
+                startTop = prevTop;
+                startBottom = prevBottom;
+            } else {
+                glm::vec3 normal = wall.normal;
+                if (joinsPrev) { normal = glm::normalize(normal + walls[numWalls - 1].normal); }
+
+                // 1st vertex top
+                a.z = _maxHeight;
+                _ctx.addVertex(a, normal, glm::vec2(1.,1.));
+                // 1st vertex bottom
+                a.z = _minHeight;
+                _ctx.addVertex(a, normal, glm::vec2(1.,0.));
+
+                startTop = vertex++;
+                startBottom = vertex++;
+            }
+
+            if (w == 0) {
+                firstTop = startTop;
+                firstBottom = startBottom;
+            }
+
+            size_t endTop, endBottom;
+
+            if (joinsNext && w + 1 == numWalls) {
+                endTop = firstTop;
+                endBottom = firstBottom;
+            } else {
+                glm::vec3 normal = wall.normal;
+                if (joinsNext) { normal = glm::normalize(normal + walls[w + 1].normal); }
+
+                // 2nd vertex top
+                b.z = _maxHeight;
+                _ctx.addVertex(b, normal, glm::vec2(0.,1.));
+                // 2nd vertex bottom
+                b.z = _minHeight;
+                _ctx.addVertex(b, normal, glm::vec2(0.,0.));
+
+                endTop = vertex++;
+                endBottom = vertex++;
+            }
+
+            _ctx.indices.push_back(startTop);
+            _ctx.indices.push_back(endTop);
+            _ctx.indices.push_back(startBottom);
+
+            _ctx.indices.push_back(endTop);
+            _ctx.indices.push_back(endBottom);
+            _ctx.indices.push_back(startBottom);
+
+            prevTop = endTop;
+            prevBottom = endBottom;
+        }
+    }
+
+    _ctx.numVertices = vertex;
+}
+
+template<typename F>
+inline void Builders::addPolyLineVertex(const glm::vec2& _coord, const glm::vec2& _normal, const glm::vec2& _uv, PolyLineBuilderT<F>& _ctx) {
+    _ctx.numVertices++;
+    _ctx.addVertex(_coord, _normal, _uv);
+}
+
+//  Tessalate a fan geometry between points A       B
+//  using their normals from a center        \ . . /
+//  and interpolating their UVs               \ p /
+//                                             \./
+//                                              C
+template<typename F>
+void Builders::addFan(const glm::vec2& _pC,
+                      const glm::vec2& _nA, const glm::vec2& _nB, const glm::vec2& _nC,
+                      const glm::vec2& _uA, const glm::vec2& _uB, const glm::vec2& _uC,
+                      int _numTriangles, PolyLineBuilderT<F>& _ctx) {
+
+    // Find angle difference
+    float cross = _nA.x * _nB.y - _nA.y * _nB.x; // z component of cross(_CA, _CB)
+    float angle = atan2f(cross, glm::dot(_nA, _nB));
+
+    int startIndex = _ctx.numVertices;
+
+    // Add center vertex
+    addPolyLineVertex(_pC, _nC, _uC, _ctx);
+
+    // Add vertex for point A
+    addPolyLineVertex(_pC, _nA, _uA, _ctx);
+
+    // Add radial vertices
+    glm::vec2 radial = _nA;
+    for (int i = 0; i < _numTriangles; i++) {
+        float frac = (i + 1)/(float)_numTriangles;
+        radial = glm::rotate(_nA, angle * frac);
+
+        glm::vec2 uv(0.0);
+        if (_ctx.useTexCoords) {
+            uv = (1.f - frac) * _uA + frac * _uB;
+        }
+
+        addPolyLineVertex(_pC, radial, uv, _ctx);
+
+        // Add indices
+        _ctx.indices.push_back(startIndex); // center vertex
+        _ctx.indices.push_back(startIndex + i + (angle > 0 ? 1 : 2));
+        _ctx.indices.push_back(startIndex + i + (angle > 0 ? 2 : 1));
+    }
+
+}
+
+// Function to add the vertices for line caps
+template<typename F>
+void Builders::addCap(const glm::vec2& _coord, const glm::vec2& _normal, int _numCorners, bool _isBeginning, PolyLineBuilderT<F>& _ctx) {
+
+    float v = _isBeginning ? 0.f : 1.f; // length-wise tex coord
+
+    if (_numCorners < 1) {
+        // "Butt" cap needs no extra vertices
+        return;
+    } else if (_numCorners == 2) {
+        // "Square" cap needs two extra vertices
+        glm::vec2 tangent(-_normal.y, _normal.x);
+        addPolyLineVertex(_coord, _normal + tangent, {0.f, v}, _ctx);
+        addPolyLineVertex(_coord, -_normal + tangent, {0.f, v}, _ctx);
+        if (!_isBeginning) { // At the beginning of a line we can't form triangles with previous vertices
+            indexPairs(1, _ctx.numVertices, _ctx.indices);
+        }
+        return;
+    }
+
+    // "Round" cap type needs a fan of vertices
+    glm::vec2 nA(_normal), nB(-_normal), nC(0.f, 0.f), uA(1.f, v), uB(0.f, v), uC(0.5f, v);
+    if (_isBeginning) {
+        nA *= -1.f; // To flip the direction of the fan, we negate the normal vectors
+        nB *= -1.f;
+        uA.x = 0.f; // To keep tex coords consistent, we must reverse these too
+        uB.x = 1.f;
+    }
+    addFan(_coord, nA, nB, nC, uA, uB, uC, _numCorners, _ctx);
+}
+
+template<typename F>
+void Builders::buildPolyLineSegment(const Line& _line, PolyLineBuilderT<F>& _ctx, size_t _startIndex,
+                                    size_t _endIndex, bool endCap) {
+
+    float distance = 0; // Cumulative distance along the polyline.
+
+    size_t origLineSize = _line.size();
+
+    // endIndex/startIndex could be wrapped values, calculate lineSize accordingly
+    int lineSize = (int)((_endIndex > _startIndex) ?
+                   (_endIndex - _startIndex) :
+                   (origLineSize - _startIndex + _endIndex));
+    if (lineSize < 2) { return; }
+
+    glm::vec2 coordCurr(_line[_startIndex]);
+    // get the Point using wrapped index in the original line geometry
+    glm::vec2 coordNext(_line[(_startIndex + 1) % origLineSize]);
+    glm::vec2 normPrev, normNext, miterVec;
+
+    int cornersOnCap = (int)_ctx.cap;
+    int trianglesOnJoin = (int)_ctx.join;
+
+    // Process first point in line with an end cap
+    normNext = _ctx.normals[_startIndex];
+
+    if (endCap) {
+        addCap(coordCurr, normNext, cornersOnCap, true, _ctx);
+    }
+    addPolyLineVertex(coordCurr, normNext, {1.0f, 0.0f}, _ctx); // right corner
+    addPolyLineVertex(coordCurr, -normNext, {0.0f, 0.0f}, _ctx); // left corner
+
+
+    // Process intermediate points
+    for (int i = 1; i < lineSize - 1; i++) {
+        // get the Point using wrapped index in the original line geometry
+        int currIndex = (i + _startIndex) % origLineSize;
+        int nextIndex = (i + _startIndex + 1) % origLineSize;
+
+        distance += _ctx.lengths[(i + _startIndex - 1) % origLineSize];
+
+        coordCurr = coordNext;
+        coordNext = _line[nextIndex];
+
+        if (coordCurr == coordNext) {
+            continue;
+        }
+
+        normPrev = normNext;
+        normNext = _ctx.normals[currIndex];
+
+        // Compute "normal" for miter joint
+        miterVec = normPrev + normNext;
+
+        float scale = 1.f;
+
+        // normPrev and normNext are in the opposite direction
+        // in order to prevent NaN values, we use the perp
+        // vector of those two vectors
+        if (miterVec == glm::zero<glm::vec2>()) {
+            miterVec = perp2d(glm::vec3(normNext, 0.f), glm::vec3(normPrev, 0.f));
+        } else {
+            scale = 2.f / glm::dot(miterVec, miterVec);
+        }
+
+        miterVec *= scale;
+
+        if (glm::length2(miterVec) > glm::length2(_ctx.miterLimit)) {
+            trianglesOnJoin = 1;
+            miterVec *= _ctx.miterLimit / glm::length(miterVec);
+        }
+
+        float v = distance;
+
+        if (trianglesOnJoin == 0) {
+            // Join type is a simple miter
+
+            addPolyLineVertex(coordCurr, miterVec, {1.0, v}, _ctx); // right corner
+            addPolyLineVertex(coordCurr, -miterVec, {0.0, v}, _ctx); // left corner
+            indexPairs(1, _ctx.numVertices, _ctx.indices);
+
+        } else {
+
+            // Join type is a fan of triangles
+
+            bool isRightTurn = (normNext.x * normPrev.y - normNext.y * normPrev.x) > 0; // z component of cross(normNext, normPrev)
+
+            if (isRightTurn) {
+
+                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _ctx); // right (inner) corner
+                addPolyLineVertex(coordCurr, -normPrev, {0.0f, v}, _ctx); // left (outer) corner
+                indexPairs(1, _ctx.numVertices, _ctx.indices);
+
+                addFan(coordCurr, -normPrev, -normNext, miterVec, {0.f, v}, {0.f, v}, {1.f, v}, trianglesOnJoin, _ctx);
+
+                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _ctx); // right (inner) corner
+                addPolyLineVertex(coordCurr, -normNext, {0.0f, v}, _ctx); // left (outer) corner
+
+            } else {
+
+                addPolyLineVertex(coordCurr, normPrev, {1.0f, v}, _ctx); // right (outer) corner
+                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _ctx); // left (inner) corner
+                indexPairs(1, _ctx.numVertices, _ctx.indices);
+
+                addFan(coordCurr, normPrev, normNext, -miterVec, {1.f, v}, {1.f, v}, {0.0f, v}, trianglesOnJoin, _ctx);
+
+                addPolyLineVertex(coordCurr, normNext, {1.0f, v}, _ctx); // right (outer) corner
+                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _ctx); // left (inner) corner
+            }
+        }
+    }
+
+    distance += _ctx.lengths[(lineSize - 2 + _startIndex) % origLineSize];
+
+    // Process last point in line with a cap
+    addPolyLineVertex(coordNext, normNext, {1.f, distance}, _ctx); // right corner
+    addPolyLineVertex(coordNext, -normNext, {0.f, distance}, _ctx); // left corner
+    indexPairs(1, _ctx.numVertices, _ctx.indices);
+    if (endCap) {
+        addCap(coordNext, normNext, cornersOnCap, false, _ctx);
+    }
+
+}
+
+template<typename F>
+void Builders::buildPolyLine(const Line& _line, PolyLineBuilderT<F>& _ctx) {
+
+    size_t lineSize = _line.size();
+
+    // Segment normals don't depend on joins and caps, compute them up front
+    segmentNormals(_line, _ctx.normals, _ctx.lengths);
+
+    if (_ctx.keepTileEdges) {
+
+        buildPolyLineSegment(_line, _ctx, 0, lineSize);
+
+    } else {
+
+        int cut = 0;
+        int firstCutEnd = 0;
+
+        // Determine cuts
+        for (size_t i = 0; i < lineSize - 1; i++) {
+            const glm::vec2& coordCurr = _line[i];
+            const glm::vec2& coordNext = _line[i+1];
+            if (isOutsideTile(coordCurr, coordNext)) {
+                if (cut == 0) {
+                    firstCutEnd = i + 1;
+                }
+                buildPolyLineSegment(_line, _ctx, cut, i + 1);
+                cut = i + 1;
+            }
+        }
+
+        if (_ctx.closedPolygon) {
+            if (cut == 0) {
+                // no tile edge cuts!
+                // loop and close the polygon with no endcaps
+                buildPolyLineSegment(_line, _ctx, 0, lineSize+2, false);
+            } else {
+                // merge first and last cut line-segments together
+                buildPolyLineSegment(_line, _ctx, cut, firstCutEnd);
+            }
+        } else {
+            buildPolyLineSegment(_line, _ctx, cut, lineSize);
+        }
+
+    }
+
+}
+
+template<typename F>
+void Builders::polyLineSize(const Line& _line, const PolyLineBuilderT<F>& _ctx, size_t& _vertices, size_t& _indices) {
+
+    size_t lineSize = _line.size();
+    if (lineSize < 2) {
+        _vertices = _indices = 0;
+        return;
+    }
+
+    // Closed polygons without cuts are built with two extra joins and no caps
+    bool caps = !(_ctx.closedPolygon && !_ctx.keepTileEdges);
+    size_t joins = caps ? lineSize - 2 : lineSize;
+
+    // A miter pair, or a fan between the miter and the outer corners
+    int fan = (int)_ctx.join;
+    size_t joinVertices = fan == 0 ? 2 : fan + 6;
+    size_t joinIndices = fan == 0 ? 6 : 3 * fan + 6;
+
+    // End points, and the line pair of the last segment
+    _vertices = 4 + joins * joinVertices;
+    _indices = 6 + joins * joinIndices;
+
+    if (caps) {
+        int corners = (int)_ctx.cap;
+        if (corners == 2) {
+            _vertices += 4;
+            _indices += 6;
+        } else if (corners > 2) {
+            _vertices += 2 * (corners + 2);
+            _indices += 2 * 3 * corners;
+        }
+    }
+}
+
+template<typename F>
+void Builders::buildQuadAtPoint(const glm::vec2& _screenPosition, const glm::vec2& _size, const glm::vec2& _uvBL, const glm::vec2& _uvTR, SpriteBuilderT<F>& _ctx) {
+    float halfWidth = _size.x * .5f;
+    float halfHeight = _size.y * .5f;
+
+    _ctx.addVertex(glm::vec2(-halfWidth, -halfHeight), _screenPosition, {_uvBL.x, _uvBL.y});
+    _ctx.addVertex(glm::vec2(-halfWidth, halfHeight), _screenPosition, {_uvBL.x, _uvTR.y});
+    _ctx.addVertex(glm::vec2(halfWidth, -halfHeight), _screenPosition, {_uvTR.x, _uvBL.y});
+    _ctx.addVertex(glm::vec2(halfWidth, halfHeight), _screenPosition, {_uvTR.x, _uvTR.y});
+
+    _ctx.indices.push_back(_ctx.numVerts + 2);
+    _ctx.indices.push_back(_ctx.numVerts + 0);
+    _ctx.indices.push_back(_ctx.numVerts + 1);
+    _ctx.indices.push_back(_ctx.numVerts + 1);
+    _ctx.indices.push_back(_ctx.numVerts + 3);
+    _ctx.indices.push_back(_ctx.numVerts + 2);
+
+    _ctx.numVerts += 4;
+
+}
+
+template<typename F>
+const PolyLineCache::Entry& PolyLineCache::get(const Line& _line, const PolyLineBuilderT<F>& _ctx) {
+
+    for (size_t i = 0; i < m_size; i++) {
+        auto& entry = m_entries[i];
+        if (entry.line == &_line && entry.cap == _ctx.cap && entry.join == _ctx.join &&
+            entry.miterLimit == _ctx.miterLimit && entry.keepTileEdges == _ctx.keepTileEdges &&
+            entry.closedPolygon == _ctx.closedPolygon && entry.useTexCoords == _ctx.useTexCoords) {
+            return entry;
+        }
+    }
+
+    if (m_size == m_entries.size()) { m_entries.emplace_back(); }
+
+    auto& entry = m_entries[m_size++];
+    entry.line = &_line;
+    entry.cap = _ctx.cap;
+    entry.join = _ctx.join;
+    entry.miterLimit = _ctx.miterLimit;
+    entry.keepTileEdges = _ctx.keepTileEdges;
+    entry.closedPolygon = _ctx.closedPolygon;
+    entry.useTexCoords = _ctx.useTexCoords;
+
+    return build(entry);
+}
+
 }
@@ -0,0 +1,49 @@
+#include "util/byteBuffer.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Tangram {
+
+ByteBuffer::ByteBuffer(std::vector<char>&& _bytes) {
+    auto owner = std::make_shared<std::vector<char>>(std::move(_bytes));
+    m_data = owner->data();
+    m_size = owner->size();
+    m_owner = std::move(owner);
+}
+
+ByteBuffer ByteBuffer::mapFile(const std::string& _path) {
+
+    int fd = open(_path.c_str(), O_RDONLY);
+    if (fd < 0) { return {}; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return {};
+    }
+
+    size_t size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the descriptor
+    close(fd);
+
+    if (mapped == MAP_FAILED) { return {}; }
+
+    std::shared_ptr<const void> owner(mapped, [size](const void* _mapped) {
+            munmap(const_cast<void*>(_mapped), size);
+        });
+
+    return ByteBuffer(std::move(owner), static_cast<const char*>(mapped), size);
+}
+
+ByteBuffer ByteBuffer::slice(size_t _offset, size_t _size) const {
+    _offset = std::min(_offset, m_size);
+    _size = std::min(_size, m_size - _offset);
+    return ByteBuffer(m_owner, m_data + _offset, _size);
+}
+
+}
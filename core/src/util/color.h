@@ -34,13 +34,20 @@ struct Color {
 
     inline ColorF toColorF();
 
+    // Interpolates the packed channels with an 8-bit weight, two channels per
+    // multiply: every other byte is masked out, which leaves 16 bits for each
+    // channel times the weight.
     static Color mix(const Color& _x, const Color& _y, float _a) {
-        return Color(
-            _x.r * (1 - _a) + _y.r * _a,
-            _x.g * (1 - _a) + _y.g * _a,
-            _x.b * (1 - _a) + _y.b * _a,
-            _x.a * (1 - _a) + _y.a * _a
-        );
+        if (!(_a > 0)) { return _x; }
+        if (_a >= 1) { return _y; }
+
+        uint32_t w = uint32_t(_a * 256 + 0.5f);
+        uint32_t iw = 256 - w;
+
+        uint32_t rb = (((_x.abgr & 0x00ff00ff) * iw + (_y.abgr & 0x00ff00ff) * w) >> 8) & 0x00ff00ff;
+        uint32_t ga = (((_x.abgr >> 8) & 0x00ff00ff) * iw + ((_y.abgr >> 8) & 0x00ff00ff) * w) & 0xff00ff00;
+
+        return Color(rb | ga);
     }
 
 };
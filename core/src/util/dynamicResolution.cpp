@@ -0,0 +1,46 @@
+#include "util/dynamicResolution.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+constexpr float DynamicResolution::step;
+constexpr int DynamicResolution::holdFrames;
+constexpr float DynamicResolution::maxFrameTime;
+
+void DynamicResolution::setLimits(float _minScale, float _targetFrameTime) {
+    m_minScale = std::min(std::max(_minScale, step), 1.f);
+    m_targetFrameTime = std::max(_targetFrameTime, 1.f);
+    m_scale = std::max(m_scale, m_minScale);
+}
+
+float DynamicResolution::update(float _frameTime, bool _moving) {
+
+    if (!enabled() || !_moving) {
+        m_scale = 1.f;
+        m_frameTime = 0.f;
+        m_frames = 0;
+        return m_scale;
+    }
+
+    if (_frameTime > maxFrameTime) { return m_scale; }
+
+    // Moving average of the recent frames
+    m_frameTime = m_frames == 0 ? _frameTime : m_frameTime * 0.75f + _frameTime * 0.25f;
+    if (++m_frames < holdFrames) { return m_scale; }
+
+    float scale = m_scale;
+    if (m_frameTime > m_targetFrameTime * 1.1f) {
+        scale = std::max(m_scale - step, m_minScale);
+    } else if (m_frameTime < m_targetFrameTime * 0.7f) {
+        scale = std::min(m_scale + step, 1.f);
+    }
+
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_frames = 0;
+    }
+    return m_scale;
+}
+
+}
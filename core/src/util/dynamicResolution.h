@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Tangram {
+
+/* Render scale of frames drawn while the view is moving
+ *
+ * Frames are drawn at a fraction of the full resolution while the measured
+ * frame time stays above the target and return to full resolution when it is
+ * well below it. The scale changes by steps, each step is held for a few
+ * frames so that the frame times of the new scale are measured before the
+ * next change. When the view stops moving the next frame is drawn at full
+ * resolution.
+ */
+class DynamicResolution {
+
+public:
+
+    static constexpr float step = 0.125f;
+    // Frames measured at a scale before it changes again
+    static constexpr int holdFrames = 4;
+    // Longer intervals are pauses between gestures, not frames of one
+    static constexpr float maxFrameTime = 250.f;
+
+    // Disabled when _minScale is 1
+    void setLimits(float _minScale, float _targetFrameTime);
+
+    bool enabled() const { return m_minScale < 1.f; }
+
+    // Adds the time since the last frame in milliseconds and returns the scale
+    // for the next frame
+    float update(float _frameTime, bool _moving);
+
+    float scale() const { return m_scale; }
+
+private:
+
+    float m_minScale = 1.f;
+    float m_targetFrameTime = 1000.f / 60.f;
+    float m_scale = 1.f;
+    float m_frameTime = 0.f;
+    int m_frames = 0;
+};
+
+}
@@ -60,7 +60,7 @@ Extrude parseExtrudeString(const std::string& _str) {
 
 float getLowerExtrudeMeters(const Extrude& _extrude, const Properties& _props) {
 
-    const static std::string key_min_height("min_height");
+    const static PropertyKey key_min_height("min_height");
 
     double lower = 0;
 
@@ -77,7 +77,7 @@ float getLowerExtrudeMeters(const Extrude& _extrude, const Properties& _props) {
 
 float getUpperExtrudeMeters(const Extrude& _extrude, const Properties& _props) {
 
-    const static std::string key_height("height");
+    const static PropertyKey key_height("height");
 
     double upper = 0;
 
@@ -0,0 +1,36 @@
+#include "util/framePacer.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+constexpr float FramePacer::minBudget;
+
+// Uploads smaller than this are dominated by the call overhead
+static constexpr size_t MIN_MEASURED_UPLOAD = 64 * 1024;
+
+void FramePacer::beginFrame(Clock::time_point _now, float _milliseconds) {
+    m_deadline = _now + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(std::max(_milliseconds, 0.f)));
+    m_paced = true;
+}
+
+float FramePacer::budget(Clock::time_point _now, float _reserve) const {
+    std::chrono::duration<float, std::milli> left = m_deadline - _now;
+    return std::max(left.count() - _reserve, minBudget);
+}
+
+void FramePacer::addUpload(size_t _bytes, float _milliseconds) {
+    if (_bytes < MIN_MEASURED_UPLOAD || _milliseconds <= 0.f) { return; }
+
+    float rate = _bytes / _milliseconds;
+    m_bytesPerMillisecond = m_bytesPerMillisecond == 0.f ? rate :
+        m_bytesPerMillisecond * 0.8f + rate * 0.2f;
+}
+
+size_t FramePacer::uploadBytes(float _milliseconds) const {
+    if (m_bytesPerMillisecond == 0.f) { return 0; }
+    return std::max<size_t>(size_t(m_bytesPerMillisecond * _milliseconds), 1);
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace Tangram {
+
+/* Deadline of the current frame, see Map::update
+ *
+ * The work of a frame that can be carried over, i.e. jobs, label placement
+ * and tile uploads, is given the time that is left until the deadline once
+ * the estimated time of the remaining steps is reserved. Upload budgets are
+ * in bytes, FramePacer converts them with the measured upload throughput.
+ */
+class FramePacer {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    // Shortest budget of a step, so that carried over work still progresses
+    static constexpr float minBudget = 0.05f;
+
+    // Start a frame that must be done _milliseconds from now
+    void beginFrame(float _milliseconds) { beginFrame(Clock::now(), _milliseconds); }
+    void beginFrame(Clock::time_point _now, float _milliseconds);
+
+    void endFrame() { m_paced = false; }
+
+    // Whether the current frame has a deadline
+    bool paced() const { return m_paced; }
+
+    // Milliseconds left for a step after reserving _reserve milliseconds for the
+    // following steps, at least minBudget
+    float budget(float _reserve) const { return budget(Clock::now(), _reserve); }
+    float budget(Clock::time_point _now, float _reserve) const;
+
+    // Add the time that uploading _bytes took
+    void addUpload(size_t _bytes, float _milliseconds);
+
+    // Bytes that upload within _milliseconds, 0 until the throughput is measured
+    size_t uploadBytes(float _milliseconds) const;
+
+private:
+
+    Clock::time_point m_deadline;
+    bool m_paced = false;
+
+    // Measured upload throughput
+    float m_bytesPerMillisecond = 0.f;
+};
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Tangram {
+
+/* Key traits of a hashmap, specialized for each key type:
+ *
+ * static K empty();   // Key of unused slots, never inserted
+ * static K deleted(); // Key of erased slots, never inserted
+ * static size_t hash(const K& _key);
+ *
+ * The hash must spread keys over the low bits, which select the slot.
+ */
+template<typename K>
+struct hashmap_key;
+
+/* Open addressing hash map with linear probing
+ *
+ * Entries are stored in one power-of-two sized vector instead of a node per
+ * entry, so that lookups of small keys like TileIDs touch one or two cache
+ * lines. Erased entries leave a 'deleted' key behind until the next rehash.
+ *
+ * Insertion invalidates iterators and references; erase only invalidates
+ * those of the erased entry, so entries can be erased while iterating.
+ */
+template<typename K, typename T, typename Key = hashmap_key<K>>
+class hashmap {
+
+public:
+
+    using value_type = std::pair<K, T>;
+
+    template<typename Map, typename V>
+    class basic_iterator {
+    public:
+        V& operator*() const { return m_map->m_slots[m_slot]; }
+        V* operator->() const { return &m_map->m_slots[m_slot]; }
+
+        basic_iterator& operator++() {
+            m_slot++;
+            skip();
+            return *this;
+        }
+
+        bool operator==(const basic_iterator& _other) const { return m_slot == _other.m_slot; }
+        bool operator!=(const basic_iterator& _other) const { return m_slot != _other.m_slot; }
+
+    private:
+        friend class hashmap;
+
+        basic_iterator(Map* _map, size_t _slot) : m_map(_map), m_slot(_slot) { skip(); }
+
+        void skip() {
+            while (m_slot < m_map->m_slots.size() && !m_map->occupied(m_slot)) { m_slot++; }
+        }
+
+        Map* m_map;
+        size_t m_slot;
+    };
+
+    using iterator = basic_iterator<hashmap, value_type>;
+    using const_iterator = basic_iterator<const hashmap, const value_type>;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_slots.size()); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_slots.size()); }
+
+    iterator find(const K& _key) { return iterator(this, findSlot(_key)); }
+    const_iterator find(const K& _key) const { return const_iterator(this, findSlot(_key)); }
+
+    size_t count(const K& _key) const { return findSlot(_key) < m_slots.size() ? 1 : 0; }
+
+    T& operator[](const K& _key) {
+        return m_slots[insertSlot(_key).first].second;
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(const K& _key, Args&&... _args) {
+        auto slot = insertSlot(_key);
+        if (slot.second) { m_slots[slot.first].second = T(std::forward<Args>(_args)...); }
+        return { iterator(this, slot.first), slot.second };
+    }
+
+    /* Returns the iterator following _it */
+    iterator erase(iterator _it) {
+        size_t slot = _it.m_slot;
+        eraseSlot(slot);
+        return iterator(this, slot + 1);
+    }
+
+    size_t erase(const K& _key) {
+        size_t slot = findSlot(_key);
+        if (slot == m_slots.size()) { return 0; }
+        eraseSlot(slot);
+        return 1;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /* Removes all entries, keeping the capacity */
+    void clear() {
+        for (auto& slot : m_slots) {
+            slot.first = Key::empty();
+            slot.second = T{};
+        }
+        m_size = 0;
+        m_used = 0;
+    }
+
+    /* Grow to hold _count entries without rehashing */
+    void reserve(size_t _count) {
+        if (_count * 4 > m_slots.size() * 3) { rehash(capacityFor(std::max(_count, m_size))); }
+    }
+
+private:
+
+    bool occupied(size_t _slot) const {
+        auto& key = m_slots[_slot].first;
+        return !(key == Key::empty()) && !(key == Key::deleted());
+    }
+
+    // Returns the slot of _key or m_slots.size()
+    size_t findSlot(const K& _key) const {
+        if (m_size == 0) { return m_slots.size(); }
+
+        size_t mask = m_slots.size() - 1;
+        for (size_t slot = Key::hash(_key) & mask; ; slot = (slot + 1) & mask) {
+            auto& key = m_slots[slot].first;
+            if (key == _key) { return slot; }
+            if (key == Key::empty()) { return m_slots.size(); }
+        }
+    }
+
+    // Returns the slot of _key and whether it was inserted
+    std::pair<size_t, bool> insertSlot(const K& _key) {
+        // At most 3/4 of the slots are used by entries and deleted keys
+        if ((m_used + 1) * 4 > m_slots.size() * 3) { rehash(capacityFor(m_size + 1)); }
+
+        size_t mask = m_slots.size() - 1;
+        size_t reuse = m_slots.size();
+
+        for (size_t slot = Key::hash(_key) & mask; ; slot = (slot + 1) & mask) {
+            auto& key = m_slots[slot].first;
+            if (key == _key) { return { slot, false }; }
+
+            if (key == Key::empty()) {
+                if (reuse == m_slots.size()) {
+                    reuse = slot;
+                    m_used++;
+                }
+                m_slots[reuse].first = _key;
+                m_size++;
+                return { reuse, true };
+            }
+            if (reuse == m_slots.size() && key == Key::deleted()) { reuse = slot; }
+        }
+    }
+
+    void eraseSlot(size_t _slot) {
+        m_slots[_slot].first = Key::deleted();
+        m_slots[_slot].second = T{};
+        m_size--;
+    }
+
+    // Smallest capacity that holds _count entries at half load
+    static size_t capacityFor(size_t _count) {
+        size_t capacity = 16;
+        while (capacity < _count * 2) { capacity *= 2; }
+        return capacity;
+    }
+
+    void rehash(size_t _capacity) {
+        std::vector<value_type> slots;
+        slots.reserve(_capacity);
+        for (size_t i = 0; i < _capacity; i++) { slots.emplace_back(Key::empty(), T{}); }
+        std::swap(slots, m_slots);
+
+        size_t mask = _capacity - 1;
+        for (auto& entry : slots) {
+            if (entry.first == Key::empty() || entry.first == Key::deleted()) { continue; }
+
+            size_t slot = Key::hash(entry.first) & mask;
+            while (!(m_slots[slot].first == Key::empty())) { slot = (slot + 1) & mask; }
+            m_slots[slot] = std::move(entry);
+        }
+        m_used = m_size;
+    }
+
+    std::vector<value_type> m_slots;
+    // Number of entries
+    size_t m_size = 0;
+    // Number of entries and deleted keys
+    size_t m_used = 0;
+};
+
+}
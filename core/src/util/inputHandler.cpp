@@ -28,14 +28,31 @@ namespace Tangram {
 
 InputHandler::InputHandler(std::shared_ptr<Platform> _platform, View& _view) : m_platform(_platform), m_view(_view) {}
 
-void InputHandler::update(float _dt) {
+bool InputHandler::isFlinging() const {
 
     auto velocityPanPixels = m_view.pixelsPerMeter() / m_view.pixelScale() * m_velocityPan;
 
-    bool isFlinging = glm::length(velocityPanPixels) > THRESHOLD_STOP_PAN ||
-                      std::abs(m_velocityZoom) > THRESHOLD_STOP_ZOOM;
+    return glm::length(velocityPanPixels) > THRESHOLD_STOP_PAN ||
+           std::abs(m_velocityZoom) > THRESHOLD_STOP_ZOOM;
+}
+
+bool InputHandler::predictFling(float _dt, glm::dvec2& _translation, float& _zoom) const {
+
+    if (!isFlinging()) { return false; }
+
+    // Integral of the exponentially damped velocity v(t) = v0 * exp(-k * t)
+    float pan = (1.f - std::exp(-DAMPING_PAN * _dt)) / DAMPING_PAN;
+    float zoom = (1.f - std::exp(-DAMPING_ZOOM * _dt)) / DAMPING_ZOOM;
+
+    _translation = glm::dvec2(m_velocityPan * pan);
+    _zoom = m_velocityZoom * zoom;
+
+    return true;
+}
+
+void InputHandler::update(float _dt) {
 
-    if (isFlinging) {
+    if (isFlinging()) {
 
         m_velocityPan -= _dt * DAMPING_PAN * m_velocityPan;
         m_view.translate(_dt * m_velocityPan.x, _dt * m_velocityPan.y);
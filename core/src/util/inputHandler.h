@@ -26,6 +26,11 @@ public:
 
     void cancelFling();
 
+    // Predict the view translation (in meters) and zoom change that the
+    // current fling produces within the next _dt seconds. Returns false when
+    // the view is not flinging.
+    bool predictFling(float _dt, glm::dvec2& _translation, float& _zoom) const;
+
     void setView(View& _view) { m_view = _view; }
 
 private:
@@ -34,6 +39,8 @@ private:
 
     void onGesture();
 
+    bool isFlinging() const;
+
     std::shared_ptr<Platform> m_platform;
 
     View& m_view;
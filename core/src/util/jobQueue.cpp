@@ -1,49 +1,79 @@
 #include "util/jobQueue.h"
 
+#include <chrono>
+
 namespace Tangram {
 
 JobQueue::~JobQueue() {
 
-    if (!m_jobs.empty()) { runJobs(); }
+    runJobs();
 }
 
-void JobQueue::add(Job job) {
+void JobQueue::push(Node* _node) {
 
-    if (!m_stopped) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_jobs.push_back(std::move(job));
-    } else {
-        job();
-    }
+    _node->next = m_added.load(std::memory_order_relaxed);
+    while (!m_added.compare_exchange_weak(_node->next, _node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {}
 }
 
-void JobQueue::runJobs() {
-    std::vector<Job> localJobs;
+bool JobQueue::runJobs(float _budget) {
+
+    Node* jobs = nullptr;
 
     {
-        // steal contents of m_jobs inside the lock
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_jobs.swap(localJobs);
-        // now the lock can be released as we won't touch m_jobs anymore
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+
+        // Take the added jobs and reverse them into the order they were added
+        Node* added = m_added.exchange(nullptr, std::memory_order_acquire);
+        Node* ordered = nullptr;
+        while (added) {
+            Node* next = added->next;
+            added->next = ordered;
+            ordered = added;
+            added = next;
+        }
+
+        // Jobs that were left over come first
+        if (m_pending) {
+            Node* last = m_pending;
+            while (last->next) { last = last->next; }
+            last->next = ordered;
+            jobs = m_pending;
+            m_pending = nullptr;
+        } else {
+            jobs = ordered;
+        }
     }
 
+    if (!jobs) { return false; }
+
     // execute jobs outside of the lock
-    for (auto& jobref : localJobs) {
-        Job job = std::move(jobref);
-        job();
-        // job dtor triggers here
-    }
+    auto startTime = std::chrono::steady_clock::now();
 
+    while (jobs) {
+        Node* job = jobs;
+        jobs = job->next;
+        job->run();
+        // job dtor triggers here
+        delete job;
 
-    // try to give back memory to m_jobs
-    if (!localJobs.empty()) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_jobs.empty() && m_jobs.capacity() < localJobs.capacity()) {
-            // clear does not release capacity/memory
-            localJobs.clear();
-            m_jobs.swap(localJobs);
+        if (_budget > 0.f && jobs) {
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+            if (elapsed.count() > _budget) { break; }
         }
     }
+
+    if (!jobs) { return false; }
+
+    // Put the jobs that were left back in front of the ones taken by other threads meanwhile
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    Node* last = jobs;
+    while (last->next) { last = last->next; }
+    last->next = m_pending;
+    m_pending = jobs;
+
+    return true;
 }
 
 } // namespace Tangram
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <mutex>
-#include <vector>
-#include <atomic>
+#include <type_traits>
+#include <utility>
 
 namespace Tangram {
 
 // JobQueue allows you to queue a sequence of jobs to run later.
 // This is useful for OpenGL resources that must be created and destroyed on the GL thread.
+//
+// Adding a job does not lock: each job is one allocation holding its captures,
+// pushed onto a lock-free list.
 
 class JobQueue {
 
@@ -21,19 +25,50 @@ public:
     ~JobQueue();
 
     // Put a job on the queue. This is thread-safe.
-    void add(Job job);
+    template<typename F>
+    void add(F&& _job) {
+        if (m_stopped) {
+            _job();
+            return;
+        }
+        push(new JobNode<typename std::decay<F>::type>(std::forward<F>(_job)));
+    }
 
-    // Run all jobs on the queue in the order they were added, then remove them. This is thread-safe.
-    void runJobs();
+    // Run jobs on the queue in the order they were added, then remove them. With a
+    // _budget in milliseconds, jobs left once it is used up stay queued for the next
+    // call; at least one job is run. Returns true when jobs are left. This is thread-safe.
+    bool runJobs(float _budget = 0.f);
 
     void stop() {
         m_stopped = true;
         runJobs();
     }
+
 private:
 
-    std::vector<Job> m_jobs;
-    std::mutex m_mutex;
+    struct Node {
+        virtual ~Node() = default;
+        virtual void run() = 0;
+        Node* next = nullptr;
+    };
+
+    template<typename F>
+    struct JobNode : Node {
+        template<typename G>
+        explicit JobNode(G&& _job) : job(std::forward<G>(_job)) {}
+        void run() override { job(); }
+        F job;
+    };
+
+    void push(Node* _node);
+
+    // Jobs added since the last runJobs, most recent first
+    std::atomic<Node*> m_added{nullptr};
+
+    // Jobs taken from m_added in order, that were left over by a budget
+    Node* m_pending = nullptr;
+    std::mutex m_pendingMutex;
+
     std::atomic<bool> m_stopped{false};
 };
 
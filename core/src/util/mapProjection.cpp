@@ -16,23 +16,61 @@ MercatorProjection::MercatorProjection(int _tileSize) :
     m_Res = 2.0 * HALF_CIRCUMFERENCE * invTileSize;
 }
 
-glm::dvec2 MercatorProjection::LonLatToMeters(const glm::dvec2 _lonLat) const {
+// Shared by the virtual and the batch functions, so that both give the same result
+static inline glm::dvec2 mercatorLonLatToMeters(const glm::dvec2 _lonLat) {
     glm::dvec2 meters;
-    meters.x = _lonLat.x * HALF_CIRCUMFERENCE * INV_180;
-    meters.y = log( tan( PI*0.25 + _lonLat.y * PI * INV_360));
+    meters.x = _lonLat.x * MapProjection::HALF_CIRCUMFERENCE * MapProjection::INV_180;
+    meters.y = log( tan( PI*0.25 + _lonLat.y * PI * MapProjection::INV_360));
     meters.y = meters.y * (double)R_EARTH;
     return (meters);
 }
 
-glm::dvec2 MercatorProjection::MetersToLonLat(const glm::dvec2 _meters) const {
+static inline glm::dvec2 mercatorMetersToLonLat(const glm::dvec2 _meters) {
     glm::dvec2 lonLat;
-    double invHalfCircum = 1.0/HALF_CIRCUMFERENCE;
+    double invHalfCircum = 1.0/MapProjection::HALF_CIRCUMFERENCE;
     double invPI = 1.0/PI;
     lonLat.x = _meters.x * invHalfCircum * 180.0;
     lonLat.y = (2.0 * atan(exp( (_meters.y / R_EARTH ) )) - PI*0.5) * 180 * invPI;
     return lonLat;
 }
 
+void MapProjection::LonLatToMeters(const glm::dvec2* _lonLat, glm::dvec2* _meters, size_t _count) const {
+    if (m_type == ProjectionType::mercator) {
+        for (size_t i = 0; i < _count; i++) { _meters[i] = mercatorLonLatToMeters(_lonLat[i]); }
+    } else {
+        for (size_t i = 0; i < _count; i++) { _meters[i] = LonLatToMeters(_lonLat[i]); }
+    }
+}
+
+void MapProjection::MetersToLonLat(const glm::dvec2* _meters, glm::dvec2* _lonLat, size_t _count) const {
+    if (m_type == ProjectionType::mercator) {
+        for (size_t i = 0; i < _count; i++) { _lonLat[i] = mercatorMetersToLonLat(_meters[i]); }
+    } else {
+        for (size_t i = 0; i < _count; i++) { _lonLat[i] = MetersToLonLat(_meters[i]); }
+    }
+}
+
+void MapProjection::LonLatToLocal(const glm::dvec2* _lonLat, glm::vec2* _out, size_t _count,
+                                  glm::dvec2 _origin, double _inverseScale) const {
+    if (m_type == ProjectionType::mercator) {
+        for (size_t i = 0; i < _count; i++) {
+            _out[i] = glm::vec2((mercatorLonLatToMeters(_lonLat[i]) - _origin) * _inverseScale);
+        }
+    } else {
+        for (size_t i = 0; i < _count; i++) {
+            _out[i] = glm::vec2((LonLatToMeters(_lonLat[i]) - _origin) * _inverseScale);
+        }
+    }
+}
+
+glm::dvec2 MercatorProjection::LonLatToMeters(const glm::dvec2 _lonLat) const {
+    return mercatorLonLatToMeters(_lonLat);
+}
+
+glm::dvec2 MercatorProjection::MetersToLonLat(const glm::dvec2 _meters) const {
+    return mercatorMetersToLonLat(_meters);
+}
+
 glm::dvec2 MercatorProjection::PixelsToMeters(const glm::dvec2 _pix, const int _zoom) const {
     glm::dvec2 meters;
     double res = m_Res / (1 << _zoom);
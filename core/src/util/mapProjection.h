@@ -140,6 +140,21 @@ public:
 
     virtual double TileSize() const = 0;
 
+    /*
+     * Batch versions of LonLatToMeters and MetersToLonLat for _count
+     * coordinates, _out may be the same array as _in. The mercator
+     * projection is applied without a virtual call per coordinate.
+     */
+    void LonLatToMeters(const glm::dvec2* _lonLat, glm::dvec2* _meters, size_t _count) const;
+    void MetersToLonLat(const glm::dvec2* _meters, glm::dvec2* _lonLat, size_t _count) const;
+
+    /*
+     * Projects _count lon lat coordinates into the space of a tile or a
+     * marker: (meters - _origin) * _inverseScale
+     */
+    void LonLatToLocal(const glm::dvec2* _lonLat, glm::vec2* _out, size_t _count,
+                       glm::dvec2 _origin, double _inverseScale) const;
+
     virtual ~MapProjection() {}
 };
 
@@ -158,6 +173,9 @@ public:
      */
     MercatorProjection(int  _tileSize=256);
 
+    using MapProjection::LonLatToMeters;
+    using MapProjection::MetersToLonLat;
+
     virtual glm::dvec2 LonLatToMeters(const glm::dvec2 _lonLat) const override;
     virtual glm::dvec2 MetersToLonLat(const glm::dvec2 _meters) const override;
     virtual glm::dvec2 PixelsToMeters(const glm::dvec2 _pix, const int _zoom) const override;
@@ -0,0 +1,11 @@
+#include "util/memoryReport.h"
+
+#include "gl/texture.h"
+
+namespace Tangram {
+
+void MemoryReport::addTexture(MemoryUsage& _usage, const Texture& _texture) {
+    if (count(&_texture)) { _usage += _texture.memoryUsage(); }
+}
+
+}
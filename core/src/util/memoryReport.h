@@ -0,0 +1,34 @@
+#pragma once
+
+#include "map.h"
+
+#include <unordered_set>
+
+namespace Tangram {
+
+class Texture;
+
+/* Collects the MemoryStats of tiles, sources, caches and textures.
+ *
+ * Owners add their bytes to the category they belong to. Objects shared by
+ * several owners, like raster atlases or raw caches of sources with the same
+ * URL, are counted only by the first owner that reports them.
+ */
+class MemoryReport {
+
+public:
+
+    // Returns true the first time it is called for _object
+    bool count(const void* _object) { return m_counted.insert(_object).second; }
+
+    // Add the bytes of _texture to _usage, unless it was counted already
+    void addTexture(MemoryUsage& _usage, const Texture& _texture);
+
+    MemoryStats stats;
+
+private:
+
+    std::unordered_set<const void*> m_counted;
+};
+
+}
@@ -0,0 +1,133 @@
+#include "util/meshOptimizer.h"
+
+#include <algorithm>
+
+namespace Tangram {
+
+constexpr uint32_t MeshOptimizer::cacheSize;
+
+uint32_t MeshOptimizer::cacheMisses(const uint16_t* _indices, size_t _count, size_t _vertexCount) {
+
+    // A vertex is in the FIFO cache while fewer than cacheSize misses followed
+    // its own, the number of which is kept as its time
+    m_cacheTime.assign(_vertexCount, 0);
+    uint32_t misses = 0;
+
+    for (size_t i = 0; i < _count; i++) {
+        uint32_t& time = m_cacheTime[_indices[i]];
+        if (time == 0 || misses - time >= cacheSize) {
+            misses++;
+            time = misses;
+        }
+    }
+    return misses;
+}
+
+void MeshOptimizer::reorderTriangles(uint16_t* _indices, size_t _count, size_t _vertexCount) {
+
+    size_t triangles = _count / 3;
+    if (triangles < 2) { return; }
+
+    // Triangles of each vertex
+    m_liveTriangles.assign(_vertexCount, 0);
+    for (size_t i = 0; i < triangles * 3; i++) { m_liveTriangles[_indices[i]]++; }
+
+    m_adjacencyOffsets.resize(_vertexCount + 1);
+    m_adjacencyOffsets[0] = 0;
+    for (size_t v = 0; v < _vertexCount; v++) {
+        m_adjacencyOffsets[v + 1] = m_adjacencyOffsets[v] + m_liveTriangles[v];
+    }
+    m_adjacency.resize(triangles * 3);
+    m_candidates.assign(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangles; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            m_adjacency[m_candidates[_indices[t * 3 + k]]++] = uint32_t(t);
+        }
+    }
+
+    m_cacheTime.assign(_vertexCount, 0);
+    m_emitted.assign(triangles, false);
+    m_deadEnds.clear();
+    m_output.clear();
+    m_output.reserve(triangles * 3);
+
+    // Timestamps start above the cache size, so that unused vertices are out of the cache
+    uint32_t time = cacheSize + 1;
+    size_t nextVertex = 1;
+    int64_t fanning = 0;
+
+    while (fanning >= 0) {
+        m_candidates.clear();
+
+        // Emit the remaining triangles around the fanning vertex
+        for (uint32_t a = m_adjacencyOffsets[fanning]; a < m_adjacencyOffsets[fanning + 1]; a++) {
+            uint32_t t = m_adjacency[a];
+            if (m_emitted[t]) { continue; }
+
+            for (size_t k = 0; k < 3; k++) {
+                uint16_t v = _indices[t * 3 + k];
+                m_output.push_back(v);
+                m_deadEnds.push_back(v);
+                m_candidates.push_back(v);
+                m_liveTriangles[v]--;
+                if (time - m_cacheTime[v] > cacheSize) { m_cacheTime[v] = time++; }
+            }
+            m_emitted[t] = true;
+        }
+
+        // Continue with the vertex which stays in the cache while its
+        // triangles are emitted, preferring the oldest one
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : m_candidates) {
+            if (m_liveTriangles[v] == 0) { continue; }
+
+            int64_t priority = 0;
+            if (time - m_cacheTime[v] + 2 * m_liveTriangles[v] <= cacheSize) {
+                priority = time - m_cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        if (fanning >= 0) { continue; }
+
+        // Dead end: take a recent vertex with triangles left, or the next one in order
+        while (!m_deadEnds.empty()) {
+            uint32_t v = m_deadEnds.back();
+            m_deadEnds.pop_back();
+            if (m_liveTriangles[v] > 0) {
+                fanning = v;
+                break;
+            }
+        }
+        while (fanning < 0 && nextVertex < _vertexCount) {
+            if (m_liveTriangles[nextVertex] > 0) { fanning = nextVertex; }
+            nextVertex++;
+        }
+    }
+
+    std::copy(m_output.begin(), m_output.end(), _indices);
+}
+
+const std::vector<uint16_t>& MeshOptimizer::reorderVertices(uint16_t* _indices, size_t _count,
+                                                            size_t _vertexCount) {
+
+    const uint16_t unused = uint16_t(-1);
+    m_remap.assign(_vertexCount, unused);
+
+    uint16_t next = 0;
+    for (size_t i = 0; i < _count; i++) {
+        uint16_t& position = m_remap[_indices[i]];
+        if (position == unused) { position = next++; }
+        _indices[i] = position;
+    }
+    for (auto& position : m_remap) {
+        if (position == unused) { position = next++; }
+    }
+    return m_remap;
+}
+
+}
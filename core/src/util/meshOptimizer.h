@@ -0,0 +1,101 @@
+#pragma once
+
+#include "gl/mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Tangram {
+
+/* Reorders triangle lists for the post-transform vertex cache of the GPU
+ *
+ * Triangles are ordered with Tipsify (Sander, Nehab and Barczak, 2007), which
+ * fans around recently used vertices and picks the next fan by the cache
+ * positions of their vertices. Vertices are then renumbered by their first use,
+ * so that vertex fetches go through the buffer in order.
+ *
+ * Keeps scratch buffers between meshes, one instance per StyleBuilder.
+ */
+class MeshOptimizer {
+
+public:
+
+    /* Size of the FIFO vertex cache which is modelled for reordering and ACMR */
+    static constexpr uint32_t cacheSize = 16;
+
+    struct Stats {
+        uint64_t triangles = 0;
+        // Vertex cache misses of the triangles as built and as reordered
+        uint64_t missesBefore = 0;
+        uint64_t missesAfter = 0;
+    };
+
+    /* Misses of the modelled vertex cache for _count indices of _vertexCount vertices */
+    uint32_t cacheMisses(const uint16_t* _indices, size_t _count, size_t _vertexCount);
+
+    /* Reorder the triangles of _indices in place */
+    void reorderTriangles(uint16_t* _indices, size_t _count, size_t _vertexCount);
+
+    /* Renumber the vertices of _indices by first use. Returns the new position
+     * of each vertex; unused vertices are moved behind the used ones. */
+    const std::vector<uint16_t>& reorderVertices(uint16_t* _indices, size_t _count, size_t _vertexCount);
+
+    /* Reorder each entry of _mesh.offsets on its own, so that the bounds of
+     * the entries remain valid. */
+    template<class T>
+    Stats optimize(MeshData<T>& _mesh);
+
+private:
+
+    // Triangles of each vertex, in m_adjacency from m_adjacencyOffsets[v]
+    std::vector<uint32_t> m_adjacencyOffsets;
+    std::vector<uint32_t> m_adjacency;
+    std::vector<uint32_t> m_liveTriangles;
+    std::vector<uint32_t> m_cacheTime;
+    std::vector<uint32_t> m_deadEnds;
+    std::vector<uint32_t> m_candidates;
+    std::vector<bool> m_emitted;
+    std::vector<uint16_t> m_output;
+    std::vector<uint16_t> m_remap;
+};
+
+template<class T>
+MeshOptimizer::Stats MeshOptimizer::optimize(MeshData<T>& _mesh) {
+
+    Stats stats;
+    std::vector<T> vertices;
+
+    size_t indexOffset = 0;
+    size_t vertexOffset = 0;
+
+    for (auto& entry : _mesh.offsets) {
+        uint16_t* indices = _mesh.indices.data() + indexOffset;
+        size_t indexCount = entry.first;
+        size_t vertexCount = entry.second;
+
+        uint32_t misses = cacheMisses(indices, indexCount, vertexCount);
+        stats.triangles += indexCount / 3;
+        stats.missesBefore += misses;
+
+        // All vertices fit into the cache, none is transformed twice
+        if (vertexCount > cacheSize && misses > vertexCount) {
+            reorderTriangles(indices, indexCount, vertexCount);
+            auto& remap = reorderVertices(indices, indexCount, vertexCount);
+
+            auto first = _mesh.vertices.begin() + vertexOffset;
+            vertices.assign(first, first + vertexCount);
+            for (size_t i = 0; i < vertexCount; i++) {
+                *(first + remap[i]) = vertices[i];
+            }
+            misses = cacheMisses(indices, indexCount, vertexCount);
+        }
+        stats.missesAfter += misses;
+
+        indexOffset += indexCount;
+        vertexOffset += vertexCount;
+    }
+
+    return stats;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Tangram {
+
+/**
+ * Sorts _items by the 64 bit key that _key returns for each of them, in
+ * ascending order. Items with equal keys keep their order, so sorting by a
+ * secondary key first and by the primary key then orders by both.
+ *
+ * Sorts in passes over the 8 bit digits of the keys, from the lowest one.
+ * Digits that all keys share are skipped. _scratch is swapped with _items
+ * and keeps its capacity for the next sort.
+ */
+template<typename T, typename Key>
+void radixSort(std::vector<T>& _items, std::vector<T>& _scratch, Key _key) {
+
+    constexpr int digits = sizeof(uint64_t);
+
+    size_t size = _items.size();
+    if (size < 2) { return; }
+
+    // Histograms of all digits in one pass over the keys
+    std::array<std::array<uint32_t, 256>, digits> counts{};
+    for (const auto& item : _items) {
+        uint64_t key = _key(item);
+        for (int d = 0; d < digits; d++) {
+            counts[d][(key >> (8 * d)) & 0xff]++;
+        }
+    }
+
+    _scratch.resize(size);
+    uint64_t firstKey = _key(_items[0]);
+
+    for (int d = 0; d < digits; d++) {
+        auto& count = counts[d];
+        int shift = 8 * d;
+
+        if (count[(firstKey >> shift) & 0xff] == size) { continue; }
+
+        // Offsets of the buckets
+        uint32_t offset = 0;
+        for (auto& bucket : count) {
+            uint32_t items = bucket;
+            bucket = offset;
+            offset += items;
+        }
+
+        for (auto& item : _items) {
+            _scratch[count[(_key(item) >> shift) & 0xff]++] = std::move(item);
+        }
+        std::swap(_items, _scratch);
+    }
+}
+
+}
@@ -1,5 +1,7 @@
 #include "zipArchive.h"
 
+#include <cstring>
+
 namespace Tangram {
 
 ZipArchive::ZipArchive() {
@@ -10,56 +12,139 @@ ZipArchive::~ZipArchive() {
     reset();
 }
 
+// Size of the fixed part of a local file header, followed by the file name and extra field.
+static const size_t localHeaderSize = 30;
+
+static uint16_t readU16(const char* data) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    return bytes[0] | (bytes[1] << 8);
+}
+
 bool ZipArchive::loadFromMemory(std::vector<char> compressedArchiveData) {
+    return loadFromBuffer(ByteBuffer(std::move(compressedArchiveData)));
+}
+
+bool ZipArchive::loadFromBuffer(ByteBuffer archiveData) {
     // Reset to an empty state.
     reset();
     // Initialize the buffer and archive with the input data.
-    buffer.swap(compressedArchiveData);
+    buffer = std::move(archiveData);
     if (!mz_zip_reader_init_mem(&minizData, buffer.data(), buffer.size(), 0)) {
         return false;
     }
     // Scan the archive entries into a list.
     auto numberOfFiles = mz_zip_reader_get_num_files(&minizData);
     entryList.reserve(numberOfFiles);
+    storedOffsets.resize(numberOfFiles, 0);
     for (size_t i = 0; i < numberOfFiles; i++) {
         Entry entry;
         mz_zip_archive_file_stat stats;
         if (mz_zip_reader_file_stat(&minizData, i, &stats)) {
             entry.path = stats.m_filename;
             entry.uncompressedSize = stats.m_uncomp_size;
+
+            // The data of stored entries follows their local header
+            size_t header = stats.m_local_header_ofs;
+            if (stats.m_method == 0 && !(stats.m_bit_flag & 1) && stats.m_comp_size == stats.m_uncomp_size &&
+                header + localHeaderSize <= buffer.size()) {
+                const char* local = buffer.data() + header;
+                size_t offset = header + localHeaderSize + readU16(local + 26) + readU16(local + 28);
+                if (readU16(local) == 0x4b50 && readU16(local + 2) == 0x0403 &&
+                    offset + entry.uncompressedSize <= buffer.size()) {
+                    entry.stored = true;
+                    storedOffsets[i] = offset;
+                }
+            }
         }
+        entryIndex.emplace(entry.path, entryList.size());
         entryList.push_back(entry);
     }
     return true;
 }
 
 const ZipArchive::Entry* ZipArchive::findEntry(const std::string& path) const {
-    for (const auto& entry : entryList) {
-        if (entry.path == path) {
-            return &entry;
-        }
+    auto it = entryIndex.find(path);
+    if (it == entryIndex.end()) {
+        return nullptr;
     }
-    return nullptr;
+    return &entryList[it->second];
 }
 
-bool ZipArchive::decompressEntry(const Entry* entry, char* output) {
+int ZipArchive::entryPosition(const Entry* entry) const {
     // Check that the given pointer refers to an entry in our list.
     if (entry == nullptr || entry < entryList.data() || entry >= entryList.data() + entryList.size()) {
-        return false;
+        return -1;
     }
     // Get the index of the entry (this arithmetic is only legal in an array).
-    size_t index = entry - entryList.data();
+    return int(entry - entryList.data());
+}
+
+bool ZipArchive::decompressEntry(const Entry* entry, char* output) {
+    int index = entryPosition(entry);
+    if (index < 0) {
+        return false;
+    }
     size_t size = entry->uncompressedSize;
+    if (!entryData.empty()) {
+        if (size > 0) {
+            std::memcpy(output, entryData[index].data(), size);
+        }
+        return true;
+    }
+    if (entry->stored) {
+        std::memcpy(output, buffer.data() + storedOffsets[index], size);
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(minizMutex);
     return mz_zip_reader_extract_to_mem(&minizData, index, output, size, 0);
 }
 
+ByteBuffer ZipArchive::entryBuffer(const Entry* entry) {
+    int index = entryPosition(entry);
+    if (index < 0) {
+        return {};
+    }
+    if (entryData.empty() && entry->stored) {
+        return buffer.slice(storedOffsets[index], entry->uncompressedSize);
+    }
+    std::vector<char> data(entry->uncompressedSize);
+    if (!decompressEntry(entry, data.data())) {
+        return {};
+    }
+    return ByteBuffer(std::move(data));
+}
+
+bool ZipArchive::decompressAll() {
+    if (!entryData.empty()) {
+        return true;
+    }
+    std::vector<std::vector<char>> data(entryList.size());
+    for (size_t i = 0; i < entryList.size(); i++) {
+        size_t size = entryList[i].uncompressedSize;
+        data[i].resize(size);
+        if (size > 0 && !decompressEntry(&entryList[i], data[i].data())) {
+            return false;
+        }
+    }
+    entryData.swap(data);
+    // The compressed data is no longer needed.
+    mz_zip_reader_end(&minizData);
+    mz_zip_zero_struct(&minizData);
+    buffer.reset();
+    storedOffsets.clear();
+    return true;
+}
+
 void ZipArchive::reset() {
     // Close and free the miniz archive (if null, this is a no-op).
     mz_zip_reader_end(&minizData);
     mz_zip_zero_struct(&minizData);
     // Empty the buffer and entry list.
-    buffer.clear();
+    buffer.reset();
+    storedOffsets.clear();
     entryList.clear();
+    entryIndex.clear();
+    entryData.clear();
 }
 
 }
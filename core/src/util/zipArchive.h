@@ -4,7 +4,11 @@
 #define MINIZ_NO_ZLIB_COMPATIBLE_NAMES // Disable zlib names, to prevent conflicts against stock zlib.
 #include <miniz.h>
 
+#include "util/byteBuffer.h"
+
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Tangram {
@@ -17,6 +21,8 @@ public:
     struct Entry {
         std::string path;
         size_t uncompressedSize = 0;
+        // Stored without compression, its data is read in place
+        bool stored = false;
     };
 
     // Create an empty archive.
@@ -35,6 +41,10 @@ public:
     // data is loaded or the archive is destroyed.
     bool loadFromMemory(std::vector<char> compressedArchiveData);
 
+    // Load a zip archive from data shared with its owner, e.g. a memory mapped
+    // file. Only the central directory is read, entries are read on demand.
+    bool loadFromBuffer(ByteBuffer archiveData);
+
     // Empty the archive.
     void reset();
 
@@ -51,15 +61,42 @@ public:
     // from this archive or it can't be decompressed, otherwise returns true.
     bool decompressEntry(const Entry* entry, char* output);
 
+    // Data of the given entry. Stored entries share the archive data without
+    // copying, compressed entries are inflated into a new buffer. Returns an
+    // empty buffer if the entry is not from this archive or can't be
+    // decompressed. Can be called from several threads at once.
+    ByteBuffer entryBuffer(const Entry* entry);
+
+    // Decompress all entries into memory and release the archive data.
+    // Afterwards decompressEntry only copies the entry data and can be called
+    // from several threads at once. Returns false if any entry can't be
+    // decompressed, the archive is then left unchanged.
+    bool decompressAll();
+
 protected:
+    // Index of entry in entryList, or -1 for entries not from this archive.
+    int entryPosition(const Entry* entry) const;
+
     // Buffer of compressed zip archive data.
-    std::vector<char> buffer;
+    ByteBuffer buffer;
+
+    // Offset of the data of each stored entry in buffer.
+    std::vector<size_t> storedOffsets;
 
     // List of file entries in the archive.
     std::vector<Entry> entryList;
 
+    // Index of each entry in entryList by its path.
+    std::unordered_map<std::string, size_t> entryIndex;
+
+    // Uncompressed data of each entry, once decompressAll succeeded.
+    std::vector<std::vector<char>> entryData;
+
     // Archive data used by miniz.
     mz_zip_archive minizData;
+
+    // Synchronizes the extraction of compressed entries by miniz.
+    std::mutex minizMutex;
 };
 
 } // namespace Tangram
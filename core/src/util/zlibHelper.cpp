@@ -52,5 +52,30 @@ int inflate(const char* _data, size_t _size, std::vector<char>& dst) {
     return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
 }
 
+int deflate(const char* _data, size_t _size, std::vector<char>& dst, int _level) {
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+
+    int ret = deflateInit2(&strm, _level, Z_DEFLATED, 16+MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) { return ret; }
+
+    // Compress in one call into a buffer of the worst case size
+    size_t start = dst.size();
+    dst.resize(start + deflateBound(&strm, _size));
+
+    strm.avail_in = _size;
+    strm.next_in = (Bytef*)_data;
+    strm.avail_out = dst.size() - start;
+    strm.next_out = (Bytef*)(dst.data() + start);
+
+    ret = deflate(&strm, Z_FINISH);
+    dst.resize(dst.size() - strm.avail_out);
+
+    deflateEnd(&strm);
+
+    return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
+}
+
 }
 }
@@ -8,5 +8,8 @@ namespace zlib {
 
 int inflate(const char* _data, size_t _size, std::vector<char>& dst);
 
+// Compress to gzip format, readable by inflate(). _level from 1 (fastest) to 9
+int deflate(const char* _data, size_t _size, std::vector<char>& dst, int _level);
+
 }
 }
@@ -0,0 +1,101 @@
+#include "view/modelTransforms.h"
+
+#include "view/view.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace Tangram {
+
+void ModelTransforms::clear() {
+    m_originX.clear();
+    m_originY.clear();
+    m_scales.clear();
+}
+
+size_t ModelTransforms::add(const glm::dvec2& _origin, float _scale) {
+    m_originX.push_back(_origin.x);
+    m_originY.push_back(_origin.y);
+    m_scales.push_back(_scale);
+    return m_scales.size() - 1;
+}
+
+void ModelTransforms::update(const View& _view) {
+
+    size_t count = m_scales.size();
+    m_translations.resize(count);
+    m_mvps.resize(count);
+
+    const double eyeX = _view.getPosition().x;
+    const double eyeY = _view.getPosition().y;
+    const glm::mat4& vp = _view.getViewProjectionMatrix();
+
+    // The translations are differences of doubles rounded once to float, as
+    // in View::getRelativeToEye(). Columns of the matrices are products of the
+    // view-projection columns with the scale and the translation; the model
+    // has no z translation, so the third column doesn't add to the fourth.
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128d eye = _mm_set_pd(eyeY, eyeX);
+    const __m128 vp0 = _mm_loadu_ps(&vp[0][0]);
+    const __m128 vp1 = _mm_loadu_ps(&vp[1][0]);
+    const __m128 vp2 = _mm_loadu_ps(&vp[2][0]);
+    const __m128 vp3 = _mm_loadu_ps(&vp[3][0]);
+
+    for (; i < count; i++) {
+        __m128d origin = _mm_set_pd(m_originY[i], m_originX[i]);
+        __m128 t = _mm_cvtpd_ps(_mm_sub_pd(origin, eye));
+        _mm_storel_pi(reinterpret_cast<__m64*>(&m_translations[i]), t);
+
+        __m128 s = _mm_set1_ps(m_scales[i]);
+        __m128 tx = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 ty = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1));
+
+        float* mvp = &m_mvps[i][0][0];
+        _mm_storeu_ps(mvp, _mm_mul_ps(vp0, s));
+        _mm_storeu_ps(mvp + 4, _mm_mul_ps(vp1, s));
+        _mm_storeu_ps(mvp + 8, _mm_mul_ps(vp2, s));
+        _mm_storeu_ps(mvp + 12, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vp0, tx), _mm_mul_ps(vp1, ty)), vp3));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t eye = { eyeX, eyeY };
+    const float32x4_t vp0 = vld1q_f32(&vp[0][0]);
+    const float32x4_t vp1 = vld1q_f32(&vp[1][0]);
+    const float32x4_t vp2 = vld1q_f32(&vp[2][0]);
+    const float32x4_t vp3 = vld1q_f32(&vp[3][0]);
+
+    for (; i < count; i++) {
+        float64x2_t origin = { m_originX[i], m_originY[i] };
+        float32x2_t t = vcvt_f32_f64(vsubq_f64(origin, eye));
+        vst1_f32(&m_translations[i].x, t);
+
+        float32x4_t s = vdupq_n_f32(m_scales[i]);
+
+        float* mvp = &m_mvps[i][0][0];
+        vst1q_f32(mvp, vmulq_f32(vp0, s));
+        vst1q_f32(mvp + 4, vmulq_f32(vp1, s));
+        vst1q_f32(mvp + 8, vmulq_f32(vp2, s));
+        // Separate multiplies and adds, a fused multiply-add would round differently
+        vst1q_f32(mvp + 12, vaddq_f32(vaddq_f32(vmulq_n_f32(vp0, vget_lane_f32(t, 0)),
+                                                vmulq_n_f32(vp1, vget_lane_f32(t, 1))), vp3));
+    }
+#endif
+
+    for (; i < count; i++) {
+        glm::vec2 t(m_originX[i] - eyeX, m_originY[i] - eyeY);
+        m_translations[i] = t;
+
+        float s = m_scales[i];
+        glm::mat4& mvp = m_mvps[i];
+        mvp[0] = vp[0] * s;
+        mvp[1] = vp[1] * s;
+        mvp[2] = vp[2] * s;
+        mvp[3] = vp[0] * t.x + vp[1] * t.y + vp[3];
+    }
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include <vector>
+
+namespace Tangram {
+
+class View;
+
+/* Transforms of models which only scale and translate, like tiles and markers.
+ * Origins and scales are kept in contiguous arrays, so that the translations
+ * relative to the eye and the model-view-projection matrices of all models are
+ * computed in one pass per frame. The results match View::getRelativeToEye()
+ * and View::getModelViewProjection() for each model.
+ */
+class ModelTransforms {
+
+public:
+
+    void clear();
+
+    /* Adds a model scaled by _scale with its origin at _origin in projection units, returns its index */
+    size_t add(const glm::dvec2& _origin, float _scale);
+
+    void update(const View& _view);
+
+    size_t size() const { return m_scales.size(); }
+
+    /* Valid after update() */
+    const glm::vec2& translation(size_t _index) const { return m_translations[_index]; }
+    const glm::mat4& mvp(size_t _index) const { return m_mvps[_index]; }
+
+private:
+
+    std::vector<double> m_originX;
+    std::vector<double> m_originY;
+    std::vector<float> m_scales;
+
+    std::vector<glm::vec2> m_translations;
+    std::vector<glm::mat4> m_mvps;
+};
+
+}
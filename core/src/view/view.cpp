@@ -6,7 +6,9 @@
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/rotate_vector.hpp"
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #define MAX_LOD 6
 
@@ -331,6 +333,21 @@ double View::screenToGroundPlaneInternal(double& _screenX, double& _screenY) con
     return t;
 }
 
+glm::mat4 View::getModelViewProjection(const glm::mat4& _model) const {
+    glm::mat4 mvp;
+    mvp[0] = m_viewProj[0] * _model[0][0];
+    mvp[1] = m_viewProj[1] * _model[1][1];
+    mvp[2] = m_viewProj[2] * _model[2][2];
+    mvp[3] = m_viewProj[0] * _model[3][0] + m_viewProj[1] * _model[3][1] +
+             m_viewProj[2] * _model[3][2] + m_viewProj[3];
+    return mvp;
+}
+
+glm::vec2 View::getEyeOffset() const {
+    return glm::vec2(m_pos.x - std::floor(m_pos.x / RENDER_ORIGIN_GRID) * RENDER_ORIGIN_GRID,
+                     m_pos.y - std::floor(m_pos.y / RENDER_ORIGIN_GRID) * RENDER_ORIGIN_GRID);
+}
+
 float View::pixelsPerMeter() const {
 
     double metersPerTile = 2.0 * MapProjection::HALF_CIRCUMFERENCE * exp2(-m_zoom);
@@ -474,9 +491,6 @@ void View::getVisibleTiles(const std::function<void(TileID)>& _tileCb) const {
     // Location of the view center in tile space
     glm::dvec2 e = (glm::dvec2(m_pos.x + m_eye.x, m_pos.y + m_eye.y) - tileSpaceOrigin) * tileSpaceAxes;
 
-    static const int imax = std::numeric_limits<int>::max();
-    static const int imin = std::numeric_limits<int>::min();
-
     // Scan options - avoid heap allocation for std::function
     // [1] http://www.drdobbs.com/cpp/efficient-use-of-lambda-expressions-and/232500059?pgno=2
     struct ScanParams {
@@ -484,44 +498,48 @@ void View::getVisibleTiles(const std::function<void(TileID)>& _tileCb) const {
 
         int zoom;
         int maxZoom = int(s_maxZoom);
+        int maxLod = 0;
 
-        // Distance thresholds in tile space for levels of detail:
-        // Element [n] in each array is the minimum tile index at which level-of-detail n
-        // should be applied in that direction.
-        int x_limit_pos[MAX_LOD] = { imax };
-        int x_limit_neg[MAX_LOD] = { imin };
-        int y_limit_pos[MAX_LOD] = { imax };
-        int y_limit_neg[MAX_LOD] = { imin };
+        // Eye position in tile space, with the squared height
+        double eyeX = 0, eyeY = 0, eyeZ2 = 0;
+
+        // Element [n] is the minimum squared distance in tile space from the eye to the
+        // nearest point of a block of 2^n x 2^n tiles for level-of-detail n to be applied
+        double lodDistance2[MAX_LOD + 1] = { 0 };
 
         glm::ivec4 last = glm::ivec4{-1};
+        std::vector<TileID>* tiles = nullptr;
     };
 
     ScanParams opt{ zoom };
 
+    // Screen-space error: the screen area of a tile at distance d from an eye at height h is
+    // about size^2 * h / d^3, tilted away from the view by h / d. A tile at level-of-detail n
+    // has 4^n the area, so it covers no more pixels than a full zoom tile at the view center
+    // once it is 4^(n/3) times as far from the eye. Blocks are tested as a whole, so all tiles
+    // in one block agree and never overlap.
+    double centerDistance = m_pos.z * invTileSize;
     if (m_type == CameraType::perspective) {
-
-        // Determine zoom reduction for tiles far from the center of view
-        double tilesAtFullZoom = std::max(m_width, m_height) * invTileSize * 0.5;
-        double viewCenterX = (m_pos.x + hc) * invTileSize;
-        double viewCenterY = (m_pos.y - hc) * -invTileSize;
-
-        for (int i = 0; i < MAX_LOD; i++) {
-            int j = i + 1;
-            double r = invLodFunc(i) + tilesAtFullZoom;
-            opt.x_limit_neg[i] = ((int(viewCenterX - r) >> j) - 1) << j;
-            opt.y_limit_pos[i] = ((int(viewCenterY + r) >> j) + 1) << j;
-            opt.y_limit_neg[i] = ((int(viewCenterY - r) >> j) - 1) << j;
-            opt.x_limit_pos[i] = ((int(viewCenterX + r) >> j) + 1) << j;
-        }
+        opt.maxLod = std::min(MAX_LOD, zoom);
+        opt.eyeX = e.x;
+        opt.eyeY = e.y;
+        opt.eyeZ2 = glm::pow(m_eye.z * invTileSize, 2.);
     }
 
-    Rasterize::ScanCallback s = [&opt, &_tileCb](int x, int y) {
+    Rasterize::ScanCallback s = [&opt](int x, int y) {
 
         int lod = 0;
-        while (lod < MAX_LOD && x >= opt.x_limit_pos[lod]) { lod++; }
-        while (lod < MAX_LOD && x <  opt.x_limit_neg[lod]) { lod++; }
-        while (lod < MAX_LOD && y >= opt.y_limit_pos[lod]) { lod++; }
-        while (lod < MAX_LOD && y <  opt.y_limit_neg[lod]) { lod++; }
+        for (int l = opt.maxLod; l > 0; l--) {
+            double size = 1 << l;
+            double minX = (x >> l) << l;
+            double minY = (y >> l) << l;
+            double dx = std::max(minX - opt.eyeX, 0.) + std::max(opt.eyeX - (minX + size), 0.);
+            double dy = std::max(minY - opt.eyeY, 0.) + std::max(opt.eyeY - (minY + size), 0.);
+            if (dx * dx + dy * dy + opt.eyeZ2 >= opt.lodDistance2[l]) {
+                lod = l;
+                break;
+            }
+        }
 
         x >>= lod;
         y >>= lod;
@@ -532,23 +550,46 @@ void View::getVisibleTiles(const std::function<void(TileID)>& _tileCb) const {
         // Wrap x to the range [0, (1 << z))
         tile.x = x & ((1 << tile.z) - 1);
         tile.y = y;
-        tile.w = (x - tile.x) >> opt.zoom; // wrap
+        tile.w = (x - tile.x) >> tile.z; // wrap
 
         if (tile != opt.last) {
             opt.last = tile;
 
-            _tileCb(TileID(tile.x, tile.y, tile.z, tile.z, tile.w));
+            opt.tiles->emplace_back(tile.x, tile.y, tile.z, tile.z, tile.w);
         }
     };
 
-    // Rasterize view trapezoid into tiles
-    Rasterize::scanTriangle(a, b, c, 0, maxTileIndex, s);
-    Rasterize::scanTriangle(c, d, a, 0, maxTileIndex, s);
+    std::vector<TileID> tiles;
+    opt.tiles = &tiles;
+
+    // Tighten the level-of-detail distances until the tiles fit into the limit
+    for (double scale = 1.; ; scale *= 0.5) {
+        for (int l = 1; l <= opt.maxLod; l++) {
+            opt.lodDistance2[l] = glm::pow(centerDistance * exp2(2. * l / 3.) * scale, 2.);
+        }
+        tiles.clear();
+        opt.last = glm::ivec4{-1};
+
+        // Rasterize view trapezoid into tiles
+        Rasterize::scanTriangle(a, b, c, 0, maxTileIndex, s);
+        Rasterize::scanTriangle(c, d, a, 0, maxTileIndex, s);
+
+        // Rasterize the area bounded by the point under the view center and the two nearest corners
+        // of the view trapezoid. This is necessary to not cull any geometry with height in these tiles
+        // (which should remain visible, even though the base of the tile is not).
+        Rasterize::scanTriangle(a, b, e, 0, maxTileIndex, s);
+
+        // Tiles at lower levels-of-detail are found once for each row they span
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+        if (m_maxVisibleTiles == 0 || int(tiles.size()) <= m_maxVisibleTiles ||
+            opt.maxLod == 0 || scale < exp2(-MAX_LOD)) {
+            break;
+        }
+    }
 
-    // Rasterize the area bounded by the point under the view center and the two nearest corners
-    // of the view trapezoid. This is necessary to not cull any geometry with height in these tiles
-    // (which should remain visible, even though the base of the tile is not).
-    Rasterize::scanTriangle(a, b, e, 0, maxTileIndex, s);
+    for (const auto& tile : tiles) { _tileCb(tile); }
 }
 
 }
@@ -147,7 +147,24 @@ public:
     const glm::mat4& getProjectionMatrix() const { return m_proj; }
 
     /* Gets the combined view and projection transformation */
-    const glm::mat4 getViewProjectionMatrix() const { return m_viewProj; }
+    const glm::mat4& getViewProjectionMatrix() const { return m_viewProj; }
+
+    /* Gets the translation from the eye to _origin in projection units; the difference is taken in double
+       precision, so the result stays precise in float at any zoom (relative-to-eye rendering) */
+    glm::vec2 getRelativeToEye(const glm::dvec2& _origin) const {
+        return glm::vec2(_origin.x - m_pos.x, _origin.y - m_pos.y);
+    }
+
+    /* Gets the combined transformation of a model matrix that only scales and translates, like those of
+       tiles and markers, with the view and projection; cheaper than the full matrix product */
+    glm::mat4 getModelViewProjection(const glm::mat4& _model) const;
+
+    /* Gets the view position relative to the closest multiple of RENDER_ORIGIN_GRID below it; world
+       positions in shaders are built from this offset instead of the imprecise float map position */
+    glm::vec2 getEyeOffset() const;
+
+    /* Grid of the origin of getEyeOffset() in projection units, matches TANGRAM_WORLD_POSITION_WRAP */
+    static constexpr double RENDER_ORIGIN_GRID = 100000.;
 
     /* Gets the normal matrix; transforms surface normals from model space to camera space */
     const glm::mat3& getNormalMatrix() const { return m_normalMatrix; }
@@ -180,9 +197,14 @@ public:
     /* Gets the screen position from a latitude/longitude */
     glm::vec2 lonLatToScreenPosition(double lon, double lat, bool& clipped) const;
 
-    /* Returns the set of all tiles visible at the current position and zoom */
+    /* Returns the set of all tiles visible at the current position and zoom; with a perspective camera,
+       tiles far from the eye are taken from lower zoom levels as they cover fewer pixels */
     void getVisibleTiles(const std::function<void(TileID)>& _tileCb) const;
 
+    /* Limit the number of visible tiles, 0 for no limit; when a tilted view exceeds it, distant
+       tiles are taken from lower zoom levels sooner until it fits */
+    void setMaxVisibleTiles(int _count) { m_maxVisibleTiles = _count; m_dirtyTiles = true; }
+
     /* Returns true if the view properties have changed since the last call to update() */
     bool changedOnLastUpdate() const { return m_changed; }
 
@@ -238,6 +260,7 @@ protected:
     float m_pixelScale = 1.0f;
     float m_fov = 0.25 * PI;
     float m_maxPitch = 90.f;
+    int m_maxVisibleTiles = 0;
 
     CameraType m_type;
 
@@ -2,6 +2,7 @@
 
 #include "data/properties.h"
 #include "data/propertyItem.h"
+#include "gl/hardware.h"
 #include "log.h"
 #include "map.h"
 #include "util/url.h"
@@ -29,6 +30,22 @@
 PFNGLBINDVERTEXARRAYOESPROC glBindVertexArrayOESEXT = 0;
 PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArraysOESEXT = 0;
 PFNGLGENVERTEXARRAYSOESPROC glGenVertexArraysOESEXT = 0;
+PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOESEXT = 0;
+PFNGLPROGRAMBINARYOESPROC glProgramBinaryOESEXT = 0;
+PFNGLDRAWELEMENTSINSTANCEDEXTPROC glDrawElementsInstancedEXTEXT = 0;
+PFNGLVERTEXATTRIBDIVISOREXTPROC glVertexAttribDivisorEXTEXT = 0;
+PFNGLGENQUERIESEXTPROC glGenQueriesEXTEXT = 0;
+PFNGLDELETEQUERIESEXTPROC glDeleteQueriesEXTEXT = 0;
+PFNGLBEGINQUERYEXTPROC glBeginQueryEXTEXT = 0;
+PFNGLENDQUERYEXTPROC glEndQueryEXTEXT = 0;
+PFNGLGETQUERYOBJECTUIVEXTPROC glGetQueryObjectuivEXTEXT = 0;
+PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRangeEXTEXT = 0;
+PFNGLBINDBUFFERBASEPROC glBindBufferBaseEXT = 0;
+PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndexEXT = 0;
+PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBindingEXT = 0;
+PFNGLFENCESYNCPROC glFenceSyncEXT = 0;
+PFNGLGETSYNCIVPROC glGetSyncivEXT = 0;
+PFNGLDELETESYNCPROC glDeleteSyncEXT = 0;
 
 namespace Tangram {
 
@@ -75,7 +92,7 @@ void AndroidPlatform::setupJniEnv(JNIEnv* jniEnv) {
     bindJniEnvToThread(jniEnv);
 
     jclass tangramClass = jniEnv->FindClass("com/mapzen/tangram/MapController");
-    startUrlRequestMID = jniEnv->GetMethodID(tangramClass, "startUrlRequest", "(Ljava/lang/String;J)V");
+    startUrlRequestMID = jniEnv->GetMethodID(tangramClass, "startUrlRequest", "(Ljava/lang/String;JDZ)V");
     cancelUrlRequestMID = jniEnv->GetMethodID(tangramClass, "cancelUrlRequest", "(J)V");
     getFontFilePath = jniEnv->GetMethodID(tangramClass, "getFontFilePath", "(Ljava/lang/String;)Ljava/lang/String;");
     getFontFallbackFilePath = jniEnv->GetMethodID(tangramClass, "getFontFallbackFilePath", "(II)Ljava/lang/String;");
@@ -298,8 +315,17 @@ std::vector<char> AndroidPlatform::bytesFromFile(const Url& url) const {
 }
 
 UrlRequestHandle AndroidPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+    // Deliver immediately, e.g. for scene imports that a synchronous scene load waits for
+    return startUrlRequest(_url, 0, false, _callback);
+}
 
-    JniThreadBinding jniEnv(jvm);
+UrlRequestHandle AndroidPlatform::startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                             double _priority, UrlCallback _callback) {
+    // The OkHttp cache of the HttpHandler revalidates its entries itself
+    return startUrlRequest(_url, _priority, true, _callback);
+}
+
+UrlRequestHandle AndroidPlatform::startUrlRequest(Url _url, double _priority, bool _batched, UrlCallback _callback) {
 
     // Get the current value of the request counter and add one, atomically.
     UrlRequestHandle requestHandle = m_urlRequestCount++;
@@ -314,6 +340,8 @@ UrlRequestHandle AndroidPlatform::startUrlRequest(Url _url, UrlCallback _callbac
         return requestHandle;
     }
 
+    JniThreadBinding jniEnv(jvm);
+
     // Store our callback, associated with the request handle.
     {
         std::lock_guard<std::mutex> lock(m_callbackMutex);
@@ -328,7 +356,10 @@ UrlRequestHandle AndroidPlatform::startUrlRequest(Url _url, UrlCallback _callbac
     jstring jUrl = jstringFromString(jniEnv, _url.string());
 
     // Call the MapController method to start the URL request.
-    jniEnv->CallVoidMethod(m_tangramInstance, startUrlRequestMID, jUrl, jRequestHandle);
+    jniEnv->CallVoidMethod(m_tangramInstance, startUrlRequestMID, jUrl, jRequestHandle,
+                           static_cast<jdouble>(_priority), static_cast<jboolean>(_batched));
+
+    jniEnv->DeleteLocalRef(jUrl);
 
     return requestHandle;
 }
@@ -344,41 +375,93 @@ void AndroidPlatform::cancelUrlRequest(UrlRequestHandle request) {
     // We currently don't try to cancel requests for local files.
 }
 
-void AndroidPlatform::onUrlComplete(JNIEnv* _jniEnv, jlong _jRequestHandle, jbyteArray _jBytes, jstring _jError) {
-    // Start building a response object.
+UrlResponse AndroidPlatform::makeResponse(JNIEnv* _jniEnv, jobject _jBody, jint _jLength, jstring _jError,
+                                          std::string& _error) {
     UrlResponse response;
 
-    // If the request was successful, we will receive a non-null byte array.
-    if (_jBytes != nullptr) {
-        size_t length = _jniEnv->GetArrayLength(_jBytes);
-        response.content.resize(length);
-        _jniEnv->GetByteArrayRegion(_jBytes, 0, length, reinterpret_cast<jbyte*>(response.content.data()));
-        // TODO: Can we use a DirectByteBuffer to transfer data with fewer copies?
+    // If the request was successful, we will receive a non-null buffer.
+    if (_jBody != nullptr) {
+        auto* data = static_cast<const char*>(_jniEnv->GetDirectBufferAddress(_jBody));
+        jlong capacity = _jniEnv->GetDirectBufferCapacity(_jBody);
+        if (data && _jLength >= 0 && _jLength <= capacity) {
+            response.content.assign(data, data + _jLength);
+        } else {
+            _error = "Response body is not a direct ByteBuffer";
+        }
     }
 
     // If the request was unsuccessful, we will receive a non-null error string.
-    std::string error;
     if (_jError != nullptr) {
-        error = stringFromJString(_jniEnv, _jError);
-        response.error = error.c_str();
+        _error = stringFromJString(_jniEnv, _jError);
+    }
+    if (!_error.empty()) {
+        response.error = _error.c_str();
+    }
+
+    return response;
+}
+
+UrlCallback AndroidPlatform::takeCallback(jlong _jRequestHandle) {
+    UrlCallback callback;
+    auto it = m_callbacks.find(static_cast<UrlRequestHandle>(_jRequestHandle));
+    if (it != m_callbacks.end()) {
+        callback = std::move(it->second);
+        m_callbacks.erase(it);
     }
+    return callback;
+}
+
+void AndroidPlatform::onUrlComplete(JNIEnv* _jniEnv, jlong _jRequestHandle, jobject _jBody, jint _jLength, jstring _jError) {
+
+    std::string error;
+    UrlResponse response = makeResponse(_jniEnv, _jBody, _jLength, _jError, error);
 
     // Find the callback associated with the request.
     UrlCallback callback;
     {
         std::lock_guard<std::mutex> lock(m_callbackMutex);
-        UrlRequestHandle requestHandle = static_cast<UrlRequestHandle>(_jRequestHandle);
-        auto it = m_callbacks.find(requestHandle);
-        if (it != m_callbacks.end()) {
-            callback = std::move(it->second);
-            m_callbacks.erase(it);
-        }
+        callback = takeCallback(_jRequestHandle);
     }
     if (callback) {
         callback(response);
     }
 }
 
+void AndroidPlatform::onUrlsComplete(JNIEnv* _jniEnv, jlongArray _jRequestHandles, jobjectArray _jBodies,
+                                     jintArray _jLengths, jobjectArray _jErrors) {
+
+    jsize count = _jniEnv->GetArrayLength(_jRequestHandles);
+    std::vector<jlong> requestHandles(count);
+    std::vector<jint> lengths(count);
+    _jniEnv->GetLongArrayRegion(_jRequestHandles, 0, count, requestHandles.data());
+    _jniEnv->GetIntArrayRegion(_jLengths, 0, count, lengths.data());
+
+    // Take the callbacks of the whole batch at once
+    std::vector<UrlCallback> callbacks(count);
+    {
+        std::lock_guard<std::mutex> lock(m_callbackMutex);
+        for (jsize i = 0; i < count; i++) {
+            callbacks[i] = takeCallback(requestHandles[i]);
+        }
+    }
+
+    for (jsize i = 0; i < count; i++) {
+        if (!callbacks[i]) { continue; }
+
+        jobject jBody = _jniEnv->GetObjectArrayElement(_jBodies, i);
+        auto jError = static_cast<jstring>(_jniEnv->GetObjectArrayElement(_jErrors, i));
+
+        std::string error;
+        UrlResponse response = makeResponse(_jniEnv, jBody, lengths[i], jError, error);
+
+        // Local references of a batch would exceed the local reference table
+        if (jBody) { _jniEnv->DeleteLocalRef(jBody); }
+        if (jError) { _jniEnv->DeleteLocalRef(jError); }
+
+        callbacks[i](response);
+    }
+}
+
 void setCurrentThreadPriority(int priority) {
     int  tid = gettid();
     setpriority(PRIO_PROCESS, tid, priority);
@@ -401,7 +484,7 @@ void labelPickCallback(jobject listener, const Tangram::LabelPickResult* labelPi
         jobject hashmap = jniEnv->NewObject(hashmapClass, hashmapInitMID);
 
         for (const auto& item : properties->items()) {
-            jstring jkey = jstringFromString(jniEnv, item.key);
+            jstring jkey = jstringFromString(jniEnv, item.key.name());
             jstring jvalue = jstringFromString(jniEnv, properties->asString(item.value));
             jniEnv->CallObjectMethod(hashmap, hashmapPutMID, jkey, jvalue);
         }
@@ -456,7 +539,7 @@ void featurePickCallback(jobject listener, const Tangram::FeaturePickResult* fea
         position[1] = featurePickResult->position[1];
 
         for (const auto& item : properties->items()) {
-            jstring jkey = jstringFromString(jniEnv, item.key);
+            jstring jkey = jstringFromString(jniEnv, item.key.name());
             jstring jvalue = jstringFromString(jniEnv, properties->asString(item.value));
             jniEnv->CallObjectMethod(hashmap, hashmapPutMID, jkey, jvalue);
         }
@@ -476,6 +559,56 @@ void initGLExtensions() {
     glBindVertexArrayOESEXT = (PFNGLBINDVERTEXARRAYOESPROC) dlsym(libhandle, "glBindVertexArrayOES");
     glDeleteVertexArraysOESEXT = (PFNGLDELETEVERTEXARRAYSOESPROC) dlsym(libhandle, "glDeleteVertexArraysOES");
     glGenVertexArraysOESEXT = (PFNGLGENVERTEXARRAYSOESPROC) dlsym(libhandle, "glGenVertexArraysOES");
+    glGetProgramBinaryOESEXT = (PFNGLGETPROGRAMBINARYOESPROC) dlsym(libhandle, "glGetProgramBinaryOES");
+    glProgramBinaryOESEXT = (PFNGLPROGRAMBINARYOESPROC) dlsym(libhandle, "glProgramBinaryOES");
+
+    if (!glGetProgramBinaryOESEXT || !glProgramBinaryOESEXT) {
+        Hardware::supportsProgramBinary = false;
+    }
+
+    glDrawElementsInstancedEXTEXT = (PFNGLDRAWELEMENTSINSTANCEDEXTPROC) dlsym(libhandle, "glDrawElementsInstancedEXT");
+    glVertexAttribDivisorEXTEXT = (PFNGLVERTEXATTRIBDIVISOREXTPROC) dlsym(libhandle, "glVertexAttribDivisorEXT");
+
+    if (!glDrawElementsInstancedEXTEXT || !glVertexAttribDivisorEXTEXT) {
+        Hardware::supportsInstancing = false;
+    }
+
+    glGenQueriesEXTEXT = (PFNGLGENQUERIESEXTPROC) dlsym(libhandle, "glGenQueriesEXT");
+    glDeleteQueriesEXTEXT = (PFNGLDELETEQUERIESEXTPROC) dlsym(libhandle, "glDeleteQueriesEXT");
+    glBeginQueryEXTEXT = (PFNGLBEGINQUERYEXTPROC) dlsym(libhandle, "glBeginQueryEXT");
+    glEndQueryEXTEXT = (PFNGLENDQUERYEXTPROC) dlsym(libhandle, "glEndQueryEXT");
+    glGetQueryObjectuivEXTEXT = (PFNGLGETQUERYOBJECTUIVEXTPROC) dlsym(libhandle, "glGetQueryObjectuivEXT");
+
+    if (!glGenQueriesEXTEXT || !glDeleteQueriesEXTEXT || !glBeginQueryEXTEXT ||
+        !glEndQueryEXTEXT || !glGetQueryObjectuivEXTEXT) {
+        Hardware::supportsTimerQuery = false;
+    }
+
+    // Exported by libGLESv2 on devices with GLES 3
+    glBindBufferBaseEXT = (PFNGLBINDBUFFERBASEPROC) dlsym(libhandle, "glBindBufferBase");
+    glGetUniformBlockIndexEXT = (PFNGLGETUNIFORMBLOCKINDEXPROC) dlsym(libhandle, "glGetUniformBlockIndex");
+    glUniformBlockBindingEXT = (PFNGLUNIFORMBLOCKBINDINGPROC) dlsym(libhandle, "glUniformBlockBinding");
+
+    if (!glBindBufferBaseEXT || !glGetUniformBlockIndexEXT || !glUniformBlockBindingEXT) {
+        Hardware::supportsUniformBuffers = false;
+    }
+
+    // Core in GLES 3, buffers are still unmapped with OES_mapbuffer
+    glMapBufferRangeEXTEXT = (PFNGLMAPBUFFERRANGEEXTPROC) dlsym(libhandle, "glMapBufferRange");
+    if (!glMapBufferRangeEXTEXT) {
+        glMapBufferRangeEXTEXT = (PFNGLMAPBUFFERRANGEEXTPROC) dlsym(libhandle, "glMapBufferRangeEXT");
+    }
+    if (!glMapBufferRangeEXTEXT || !Hardware::supportsMapBuffer) {
+        Hardware::supportsMapBufferRange = false;
+    }
+
+    glFenceSyncEXT = (PFNGLFENCESYNCPROC) dlsym(libhandle, "glFenceSync");
+    glGetSyncivEXT = (PFNGLGETSYNCIVPROC) dlsym(libhandle, "glGetSynciv");
+    glDeleteSyncEXT = (PFNGLDELETESYNCPROC) dlsym(libhandle, "glDeleteSync");
+
+    if (!glFenceSyncEXT || !glGetSyncivEXT || !glDeleteSyncEXT || !Hardware::supportsMapBufferRange) {
+        Hardware::supportsPixelBufferReadback = false;
+    }
 
     glExtensionsLoaded = true;
 }
@@ -39,10 +39,17 @@ public:
     FontSourceHandle systemFont(const std::string& _name, const std::string& _weight, const std::string& _face) const override;
     std::vector<FontSourceHandle> systemFontFallbacksHandle() const override;
     UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
+    UrlRequestHandle startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                double _priority, UrlCallback _callback) override;
     void cancelUrlRequest(UrlRequestHandle _request) override;
     void sceneReadyCallback(SceneID id, const SceneError* error);
 
-    void onUrlComplete(JNIEnv* jniEnv, jlong jRequestHandle, jbyteArray jBytes, jstring jError);
+    // Response bodies are direct ByteBuffers holding jLength bytes
+    void onUrlComplete(JNIEnv* jniEnv, jlong jRequestHandle, jobject jBody, jint jLength, jstring jError);
+
+    // Deliver the responses that MapController collected since the last frame
+    void onUrlsComplete(JNIEnv* jniEnv, jlongArray jRequestHandles, jobjectArray jBodies,
+                        jintArray jLengths, jobjectArray jErrors);
 
     static void bindJniEnvToThread(JNIEnv* jniEnv);
     static void setupJniEnv(JNIEnv* _jniEnv);
@@ -54,6 +61,15 @@ private:
     std::string fontPath(const std::string& _family, const std::string& _weight, const std::string& _style) const;
     std::string fontFallbackPath(int _importance, int _weightHint) const;
 
+    // _batched responses are delivered once per frame by MapController
+    UrlRequestHandle startUrlRequest(Url _url, double _priority, bool _batched, UrlCallback _callback);
+
+    // Remove the callback of _jRequestHandle, requires m_callbackMutex
+    UrlCallback takeCallback(jlong _jRequestHandle);
+
+    static UrlResponse makeResponse(JNIEnv* _jniEnv, jobject _jBody, jint _jLength, jstring _jError,
+                                    std::string& _error);
+
     jobject m_tangramInstance;
     AAssetManager* m_assetManager;
 
@@ -1,5 +1,6 @@
 #include "androidPlatform.h"
 #include "data/clientGeoJsonSource.h"
+#include "log.h"
 #include "map.h"
 
 #include <cassert>
@@ -20,6 +21,38 @@ std::vector<Tangram::SceneUpdate> unpackSceneUpdates(JNIEnv* jniEnv, jobjectArra
     return sceneUpdates;
 }
 
+Tangram::Properties unpackProperties(JNIEnv* jniEnv, jobjectArray jproperties) {
+    size_t n_properties = (jproperties == NULL) ? 0 : jniEnv->GetArrayLength(jproperties) / 2;
+
+    Tangram::Properties properties;
+    for (size_t i = 0; i < n_properties; ++i) {
+        jstring jkey = (jstring) (jniEnv->GetObjectArrayElement(jproperties, 2 * i));
+        jstring jvalue = (jstring) (jniEnv->GetObjectArrayElement(jproperties, 2 * i + 1));
+        auto key = stringFromJString(jniEnv, jkey);
+        auto value = stringFromJString(jniEnv, jvalue);
+        properties.set(key, value);
+        jniEnv->DeleteLocalRef(jkey);
+        jniEnv->DeleteLocalRef(jvalue);
+    }
+    return properties;
+}
+
+// Coordinates of a direct DoubleBuffer of longitude, latitude pairs starting at
+// _offset doubles, read in place. Returns null when the buffer is not direct.
+const Tangram::LngLat* directCoordinates(JNIEnv* jniEnv, jobject jcoordinates, jint offset, jint count) {
+    static_assert(sizeof(Tangram::LngLat) == 2 * sizeof(jdouble), "LngLat must be a pair of doubles");
+
+    if (!jcoordinates || count <= 0) { return nullptr; }
+
+    auto* data = static_cast<jdouble*>(jniEnv->GetDirectBufferAddress(jcoordinates));
+    jlong capacity = jniEnv->GetDirectBufferCapacity(jcoordinates);
+    if (!data || offset < 0 || offset + 2 * jlong(count) > capacity) {
+        LOGE("Coordinates must be a direct DoubleBuffer holding %d points", count);
+        return nullptr;
+    }
+    return reinterpret_cast<const Tangram::LngLat*>(data + offset);
+}
+
 extern "C" {
 
     JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeSetPosition(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jdouble lon, jdouble lat) {
@@ -279,11 +312,18 @@ extern "C" {
         map->handleShoveGesture(distance);
     }
 
-    JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeOnUrlComplete(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong requestHandle, jbyteArray fetchedBytes, jstring errorString) {
+    JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeOnUrlComplete(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong requestHandle, jobject body, jint length, jstring errorString) {
+        assert(mapPtr > 0);
+        auto map = reinterpret_cast<Tangram::Map*>(mapPtr);
+        auto platform = static_cast<AndroidPlatform*>(map->getPlatform().get());
+        platform->onUrlComplete(jniEnv, requestHandle, body, length, errorString);
+    }
+
+    JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeOnUrlsComplete(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlongArray requestHandles, jobjectArray bodies, jintArray lengths, jobjectArray errorStrings) {
         assert(mapPtr > 0);
         auto map = reinterpret_cast<Tangram::Map*>(mapPtr);
         auto platform = static_cast<AndroidPlatform*>(map->getPlatform().get());
-        platform->onUrlComplete(jniEnv, requestHandle, fetchedBytes, errorString);
+        platform->onUrlsComplete(jniEnv, requestHandles, bodies, lengths, errorStrings);
     }
 
     JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeSetPickRadius(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jfloat radius) {
@@ -388,10 +428,23 @@ extern "C" {
             polyline.emplace_back(coordinates[2 * i], coordinates[2 * i + 1]);
         }
 
+        jniEnv->ReleaseDoubleArrayElements(jcoordinates, coordinates, JNI_ABORT);
+
         auto result = map->markerSetPolyline(static_cast<unsigned int>(markerID), polyline.data(), count);
         return result;
     }
 
+    JNIEXPORT bool JNICALL Java_com_mapzen_tangram_MapController_nativeMarkerSetPolylineBuffer(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong markerID, jobject jcoordinates, jint offset, jint count) {
+        assert(mapPtr > 0);
+        auto map = reinterpret_cast<Tangram::Map*>(mapPtr);
+
+        auto* coordinates = directCoordinates(jniEnv, jcoordinates, offset, count);
+        if (!coordinates) { return false; }
+
+        // The marker copies the coordinates it keeps, so they are passed in place
+        return map->markerSetPolyline(static_cast<unsigned int>(markerID), const_cast<Tangram::LngLat*>(coordinates), count);
+    }
+
     JNIEXPORT bool JNICALL Java_com_mapzen_tangram_MapController_nativeMarkerSetPolygon(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong markerID, jdoubleArray jcoordinates, jintArray jcounts, jint rings) {
         assert(mapPtr > 0);
         auto map = reinterpret_cast<Tangram::Map*>(mapPtr);
@@ -407,12 +460,37 @@ extern "C" {
         for (size_t i = 0; i < rings; i++) {
             size_t ringCount = *(counts+i);
             for (size_t j = 0; j < ringCount; j++) {
-                polygonCoords.emplace_back(coordinates[coordsCount + 2 * j], coordinates[coordsCount + 2 * j + 1]);
+                polygonCoords.emplace_back(coordinates[2 * (coordsCount + j)], coordinates[2 * (coordsCount + j) + 1]);
             }
             coordsCount += ringCount;
         }
 
         auto result = map->markerSetPolygon(static_cast<unsigned int>(markerID), polygonCoords.data(), counts, rings);
+
+        jniEnv->ReleaseDoubleArrayElements(jcoordinates, coordinates, JNI_ABORT);
+        jniEnv->ReleaseIntArrayElements(jcounts, counts, JNI_ABORT);
+        return result;
+    }
+
+    JNIEXPORT bool JNICALL Java_com_mapzen_tangram_MapController_nativeMarkerSetPolygonBuffer(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong markerID, jobject jcoordinates, jint offset, jint count, jintArray jcounts, jint rings) {
+        assert(mapPtr > 0);
+        auto map = reinterpret_cast<Tangram::Map*>(mapPtr);
+        if (!jcounts || rings == 0) { return false; }
+
+        auto* coordinates = directCoordinates(jniEnv, jcoordinates, offset, count);
+        if (!coordinates) { return false; }
+
+        auto* counts = jniEnv->GetIntArrayElements(jcounts, NULL);
+
+        jint total = 0;
+        for (jint i = 0; i < rings; i++) { total += counts[i]; }
+
+        bool result = false;
+        if (total <= count) {
+            result = map->markerSetPolygon(static_cast<unsigned int>(markerID), const_cast<Tangram::LngLat*>(coordinates), counts, rings);
+        }
+
+        jniEnv->ReleaseIntArrayElements(jcounts, counts, JNI_ABORT);
         return result;
     }
 
@@ -471,19 +549,8 @@ extern "C" {
 
         size_t n_points = jniEnv->GetArrayLength(jcoordinates) / 2;
         size_t n_rings = (jrings == NULL) ? 0 : jniEnv->GetArrayLength(jrings);
-        size_t n_properties = (jproperties == NULL) ? 0 : jniEnv->GetArrayLength(jproperties) / 2;
-
-        Tangram::Properties properties;
-
-        for (size_t i = 0; i < n_properties; ++i) {
-            jstring jkey = (jstring) (jniEnv->GetObjectArrayElement(jproperties, 2 * i));
-            jstring jvalue = (jstring) (jniEnv->GetObjectArrayElement(jproperties, 2 * i + 1));
-            auto key = stringFromJString(jniEnv, jkey);
-            auto value = stringFromJString(jniEnv, jvalue);
-            properties.set(key, value);
-            jniEnv->DeleteLocalRef(jkey);
-            jniEnv->DeleteLocalRef(jvalue);
-        }
+
+        Tangram::Properties properties = unpackProperties(jniEnv, jproperties);
 
         auto* coordinates = jniEnv->GetDoubleArrayElements(jcoordinates, NULL);
 
@@ -519,6 +586,39 @@ extern "C" {
 
     }
 
+    JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeAddFeatureBuffer(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong sourcePtr,
+        jobject jcoordinates, jint offset, jint count, jintArray jrings, jobjectArray jproperties) {
+
+        assert(mapPtr > 0);
+        assert(sourcePtr > 0);
+        auto source = reinterpret_cast<Tangram::ClientGeoJsonSource*>(sourcePtr);
+
+        // Coordinates are read in place from the buffer and copied only once,
+        // into the geometry of the source.
+        auto* coordinates = directCoordinates(jniEnv, jcoordinates, offset, count);
+        if (!coordinates) { return; }
+
+        size_t n_rings = (jrings == NULL) ? 0 : jniEnv->GetArrayLength(jrings);
+
+        Tangram::Properties properties = unpackProperties(jniEnv, jproperties);
+
+        if (n_rings > 0) {
+            auto* rings = jniEnv->GetIntArrayElements(jrings, NULL);
+            jint total = 0;
+            for (size_t i = 0; i < n_rings; i++) { total += rings[i]; }
+            if (total <= count) {
+                source->addPoly(properties, coordinates, rings, n_rings);
+            } else {
+                LOGE("Polygon rings hold more points than the %d coordinates", count);
+            }
+            jniEnv->ReleaseIntArrayElements(jrings, rings, JNI_ABORT);
+        } else if (count > 1) {
+            source->addLine(properties, coordinates, count);
+        } else {
+            source->addPoint(properties, coordinates[0]);
+        }
+    }
+
     JNIEXPORT void JNICALL Java_com_mapzen_tangram_MapController_nativeAddGeoJson(JNIEnv* jniEnv, jobject obj, jlong mapPtr, jlong sourcePtr, jstring geojson) {
         assert(mapPtr > 0);
         assert(sourcePtr > 0);
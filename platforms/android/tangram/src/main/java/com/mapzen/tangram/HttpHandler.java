@@ -10,7 +10,10 @@ import java.net.InetAddress;
 import java.net.Socket;
 import java.net.UnknownHostException;
 import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.Iterator;
 import java.util.List;
+import java.util.PriorityQueue;
 import java.util.concurrent.TimeUnit;
 
 import javax.net.ssl.SSLContext;
@@ -25,6 +28,7 @@ import okhttp3.ConnectionSpec;
 import okhttp3.HttpUrl;
 import okhttp3.OkHttpClient;
 import okhttp3.Request;
+import okhttp3.Response;
 import okhttp3.TlsVersion;
 
 /**
@@ -37,6 +41,36 @@ public class HttpHandler {
     protected OkHttpClient okClient;
     protected CachePolicy cachePolicy;
 
+    private static class PendingRequest {
+        final String url;
+        final Callback callback;
+        final long requestHandle;
+        final double priority;
+        final long order;
+
+        PendingRequest(final String url, final Callback callback, final long requestHandle,
+                       final double priority, final long order) {
+            this.url = url;
+            this.callback = callback;
+            this.requestHandle = requestHandle;
+            this.priority = priority;
+            this.order = order;
+        }
+    }
+
+    // Prioritized requests that wait for the dispatcher, most urgent first
+    private final PriorityQueue<PendingRequest> pendingRequests = new PriorityQueue<>(64,
+            new Comparator<PendingRequest>() {
+                @Override
+                public int compare(final PendingRequest a, final PendingRequest b) {
+                    if (a.priority != b.priority) {
+                        return a.priority < b.priority ? -1 : 1;
+                    }
+                    return a.order < b.order ? -1 : (a.order == b.order ? 0 : 1);
+                }
+            });
+    private long pendingOrder;
+
     /**
      * Enables TLS v1.2 when creating SSLSockets.
      * <p/>
@@ -194,11 +228,78 @@ public class HttpHandler {
         }
     }
 
+    /**
+     * Begin an HTTP request with a priority
+     * Requests wait in the handler while the dispatcher of the client has queued calls, so that
+     * the most urgent ones are started first. They are started with
+     * {@link #onRequest(String, Callback, long)}.
+     * @param url URL for the requested resource
+     * @param cb Callback for handling request result
+     * @param requestHandle the identifier for the request
+     * @param priority Importance of the request, lower values are more urgent
+     */
+    public void onRequest(@NonNull final String url, @NonNull final Callback cb, final long requestHandle,
+                          final double priority) {
+        synchronized (pendingRequests) {
+            pendingRequests.add(new PendingRequest(url, cb, requestHandle, priority, pendingOrder++));
+        }
+        startPendingRequests();
+    }
+
+    private void startPendingRequests() {
+        while (true) {
+            final PendingRequest next;
+            synchronized (pendingRequests) {
+                if (pendingRequests.isEmpty() || okClient.dispatcher().queuedCallsCount() > 0) {
+                    return;
+                }
+                next = pendingRequests.poll();
+            }
+            // Start the next pending request when this one is done
+            onRequest(next.url, new Callback() {
+                @Override
+                public void onFailure(final Call call, final IOException e) {
+                    try {
+                        next.callback.onFailure(call, e);
+                    } finally {
+                        startPendingRequests();
+                    }
+                }
+
+                @Override
+                public void onResponse(final Call call, final Response response) throws IOException {
+                    try {
+                        next.callback.onResponse(call, response);
+                    } finally {
+                        startPendingRequests();
+                    }
+                }
+            }, next.requestHandle);
+        }
+    }
+
    /**
     * Cancel an HTTP request
     * @param requestHandle the identifier for the request to be cancelled
     */
    public void onCancel(final long requestHandle) {
+       // check and cancel pending request
+       PendingRequest canceled = null;
+       synchronized (pendingRequests) {
+           for (final Iterator<PendingRequest> it = pendingRequests.iterator(); it.hasNext();) {
+               final PendingRequest pending = it.next();
+               if (pending.requestHandle == requestHandle) {
+                   it.remove();
+                   canceled = pending;
+                   break;
+               }
+           }
+       }
+       if (canceled != null) {
+           canceled.callback.onFailure(null, new IOException("Canceled"));
+           return;
+       }
+
        // check and cancel running call
        for (final Call runningCall : okClient.dispatcher().runningCalls()) {
            if (runningCall.request().tag().equals(requestHandle)) {
@@ -18,10 +18,14 @@ import android.util.LongSparseArray;
 import com.mapzen.tangram.TouchInput.Gestures;
 
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.DoubleBuffer;
+import java.util.ArrayList;
 import java.util.HashMap;
 import java.util.Iterator;
 import java.util.List;
 import java.util.Map;
+import java.util.concurrent.ConcurrentLinkedQueue;
 
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
@@ -30,6 +34,7 @@ import okhttp3.Call;
 import okhttp3.Callback;
 import okhttp3.Response;
 import okhttp3.ResponseBody;
+import okio.BufferedSource;
 
 /**
  * {@code MapController} is the main class for interacting with a Tangram map.
@@ -1109,6 +1114,13 @@ public class MapController implements Renderer {
         nativeAddFeature(mapPointer, sourcePtr, coordinates, rings, properties);
     }
 
+    void addFeature(final long sourcePtr, @NonNull final DoubleBuffer coordinates, final int[] rings, final String[] properties) {
+        checkPointer(mapPointer);
+        checkPointer(sourcePtr);
+        nativeAddFeatureBuffer(mapPointer, sourcePtr, coordinates, coordinates.position(),
+                coordinates.remaining() / 2, rings, properties);
+    }
+
     void addGeoJson(final long sourcePtr, final String geoJson) {
         checkPointer(mapPointer);
         checkPointer(sourcePtr);
@@ -1186,6 +1198,20 @@ public class MapController implements Renderer {
         return nativeMarkerSetPolygon(mapPointer, markerId, coordinates, rings, count);
     }
 
+    boolean setMarkerPolyline(final long markerId, @NonNull final DoubleBuffer coordinates) {
+        checkPointer(mapPointer);
+        checkId(markerId);
+        return nativeMarkerSetPolylineBuffer(mapPointer, markerId, coordinates, coordinates.position(),
+                coordinates.remaining() / 2);
+    }
+
+    boolean setMarkerPolygon(final long markerId, @NonNull final DoubleBuffer coordinates, final int[] rings) {
+        checkPointer(mapPointer);
+        checkId(markerId);
+        return nativeMarkerSetPolygonBuffer(mapPointer, markerId, coordinates, coordinates.position(),
+                coordinates.remaining() / 2, rings, rings.length);
+    }
+
     boolean setMarkerVisible(final long markerId, final boolean visible) {
         checkPointer(mapPointer);
         checkId(markerId);
@@ -1261,6 +1287,8 @@ public class MapController implements Renderer {
     private synchronized native boolean nativeMarkerSetPointEased(long mapPtr, long markerID, double lng, double lat, float duration, int ease);
     private synchronized native boolean nativeMarkerSetPolyline(long mapPtr, long markerID, double[] coordinates, int count);
     private synchronized native boolean nativeMarkerSetPolygon(long mapPtr, long markerID, double[] coordinates, int[] rings, int count);
+    private synchronized native boolean nativeMarkerSetPolylineBuffer(long mapPtr, long markerID, DoubleBuffer coordinates, int offset, int count);
+    private synchronized native boolean nativeMarkerSetPolygonBuffer(long mapPtr, long markerID, DoubleBuffer coordinates, int offset, int count, int[] rings, int ringCount);
     private synchronized native boolean nativeMarkerSetVisible(long mapPtr, long markerID, boolean visible);
     private synchronized native boolean nativeMarkerSetDrawOrder(long mapPtr, long markerID, int drawOrder);
     private synchronized native void nativeMarkerRemoveAll(long mapPtr);
@@ -1270,12 +1298,14 @@ public class MapController implements Renderer {
 
     private synchronized native void nativeSetDefaultBackgroundColor(long mapPtr, float r, float g, float b);
 
-    private native void nativeOnUrlComplete(long mapPtr, long requestHandle, byte[] rawDataBytes, String errorMessage);
+    private native void nativeOnUrlComplete(long mapPtr, long requestHandle, ByteBuffer body, int length, String errorMessage);
+    private native void nativeOnUrlsComplete(long mapPtr, long[] requestHandles, ByteBuffer[] bodies, int[] lengths, String[] errorMessages);
 
     synchronized native long nativeAddTileSource(long mapPtr, String name, boolean generateCentroid);
     synchronized native void nativeRemoveTileSource(long mapPtr, long sourcePtr);
     synchronized native void nativeClearTileSource(long mapPtr, long sourcePtr);
     synchronized native void nativeAddFeature(long mapPtr, long sourcePtr, double[] coordinates, int[] rings, String[] properties);
+    synchronized native void nativeAddFeatureBuffer(long mapPtr, long sourcePtr, DoubleBuffer coordinates, int offset, int count, int[] rings, String[] properties);
     synchronized native void nativeAddGeoJson(long mapPtr, long sourcePtr, String geoJson);
 
     native void nativeSetDebugFlag(int flag, boolean on);
@@ -1302,6 +1332,22 @@ public class MapController implements Renderer {
     private LongSparseArray<Marker> markers;
     private Handler uiThreadHandler;
 
+    // Responses of batched URL requests, delivered on the next frame
+    private final ConcurrentLinkedQueue<UrlResponse> urlResponses = new ConcurrentLinkedQueue<>();
+    private final ArrayList<UrlResponse> urlResponseBatch = new ArrayList<>();
+
+    private static class UrlResponse {
+        final long requestHandle;
+        final ByteBuffer body;
+        final String error;
+
+        UrlResponse(final long requestHandle, @Nullable final ByteBuffer body, @Nullable final String error) {
+            this.requestHandle = requestHandle;
+            this.body = body;
+            this.error = error;
+        }
+    }
+
     // GLSurfaceView.Renderer methods
     // ==============================
 
@@ -1317,6 +1363,8 @@ public class MapController implements Renderer {
             return;
         }
 
+        deliverUrlResponses();
+
         boolean viewComplete;
         synchronized(this) {
             viewComplete = nativeUpdate(mapPointer, delta);
@@ -1370,7 +1418,8 @@ public class MapController implements Renderer {
     }
 
     @Keep
-    void startUrlRequest(@NonNull final String url, final long requestHandle) {
+    void startUrlRequest(@NonNull final String url, final long requestHandle, final double priority,
+                         final boolean batched) {
         if (httpHandler == null) {
             return;
         }
@@ -1378,28 +1427,90 @@ public class MapController implements Renderer {
         final Callback callback = new Callback() {
             @Override
             public void onFailure(final Call call, final IOException e) {
-                nativeOnUrlComplete(mapPointer, requestHandle, null, e.getMessage());
+                onUrlComplete(requestHandle, null, e.getMessage(), batched);
             }
 
             @Override
             public void onResponse(final Call call, final Response response) throws IOException {
                 if (!response.isSuccessful()) {
-                    nativeOnUrlComplete(mapPointer, requestHandle, null, response.message());
+                    onUrlComplete(requestHandle, null, response.message(), batched);
                     throw new IOException("Unexpected response code: " + response + " for URL: " + url);
                 }
                 final ResponseBody body = response.body();
                 if (body == null) {
-                    nativeOnUrlComplete(mapPointer, requestHandle, null, response.message());
+                    onUrlComplete(requestHandle, null, response.message(), batched);
                     throw new IOException("Unexpected null body for URL: " + url);
                 }
                 else {
-                    final byte[] bytes = body.bytes();
-                    nativeOnUrlComplete(mapPointer, requestHandle, bytes, null);
+                    onUrlComplete(requestHandle, readBody(body), null, batched);
                 }
             }
         };
 
-        httpHandler.onRequest(url, callback, requestHandle);
+        if (batched) {
+            httpHandler.onRequest(url, callback, requestHandle, priority);
+        } else {
+            httpHandler.onRequest(url, callback, requestHandle);
+        }
+    }
+
+    // Read the body into a direct buffer that native code reads without another copy from the JVM heap
+    @NonNull
+    private static ByteBuffer readBody(@NonNull final ResponseBody body) throws IOException {
+        final long length = body.contentLength();
+        if (length < 0 || length > Integer.MAX_VALUE) {
+            final byte[] bytes = body.bytes();
+            final ByteBuffer buffer = ByteBuffer.allocateDirect(bytes.length);
+            buffer.put(bytes);
+            buffer.flip();
+            return buffer;
+        }
+        final ByteBuffer buffer = ByteBuffer.allocateDirect((int)length);
+        final BufferedSource source = body.source();
+        try {
+            while (buffer.hasRemaining() && source.read(buffer) != -1) {}
+        } finally {
+            body.close();
+        }
+        buffer.flip();
+        return buffer;
+    }
+
+    private void onUrlComplete(final long requestHandle, @Nullable final ByteBuffer body, @Nullable final String error,
+                               final boolean batched) {
+        if (!batched) {
+            nativeOnUrlComplete(mapPointer, requestHandle, body, body != null ? body.remaining() : 0, error);
+            return;
+        }
+        urlResponses.add(new UrlResponse(requestHandle, body, error));
+        requestRender();
+    }
+
+    // Deliver the responses of batched requests with one native call, on the render thread
+    private void deliverUrlResponses() {
+        UrlResponse response;
+        while ((response = urlResponses.poll()) != null) {
+            urlResponseBatch.add(response);
+        }
+        final int count = urlResponseBatch.size();
+        if (count == 0) {
+            return;
+        }
+
+        final long[] requestHandles = new long[count];
+        final ByteBuffer[] bodies = new ByteBuffer[count];
+        final int[] lengths = new int[count];
+        final String[] errors = new String[count];
+        for (int i = 0; i < count; i++) {
+            response = urlResponseBatch.get(i);
+            requestHandles[i] = response.requestHandle;
+            bodies[i] = response.body;
+            lengths[i] = response.body != null ? response.body.remaining() : 0;
+            errors[i] = response.error;
+        }
+        urlResponseBatch.clear();
+
+        nativeOnUrlsComplete(mapPointer, requestHandles, bodies, lengths, errors);
     }
 
     // Called from JNI on worker or render-thread.
@@ -8,6 +8,7 @@ import com.mapzen.tangram.geometry.Point;
 import com.mapzen.tangram.geometry.Polygon;
 import com.mapzen.tangram.geometry.Polyline;
 
+import java.nio.DoubleBuffer;
 import java.util.List;
 import java.util.Map;
 
@@ -104,6 +105,51 @@ public class MapData {
         return this;
     }
 
+    /**
+     * Add a polyline feature from packed coordinates, without copying them into Java objects first.
+     * @param coordinates A direct buffer in native byte order of longitude, latitude pairs, read
+     * from its position to its limit.
+     * @param properties The properties of the feature, used for filtering and styling according to
+     * the scene file used by the map; may be null.
+     * @return This object, for chaining.
+     */
+    @NonNull
+    public MapData addPolyline(@NonNull final DoubleBuffer coordinates, @Nullable final Map<String, String> properties) {
+        map.addFeature(pointer, coordinates, null, getPropertyArray(properties));
+        return this;
+    }
+
+    /**
+     * Add a polygon feature from packed coordinates, without copying them into Java objects first.
+     * @param coordinates A direct buffer in native byte order of longitude, latitude pairs, read
+     * from its position to its limit. The rings follow each other, each one closed by repeating its
+     * first point.
+     * @param rings The number of points of each ring; the first ring is the exterior.
+     * @param properties The properties of the feature, used for filtering and styling according to
+     * the scene file used by the map; may be null.
+     * @return This object, for chaining.
+     */
+    @NonNull
+    public MapData addPolygon(@NonNull final DoubleBuffer coordinates, @NonNull final int[] rings,
+                              @Nullable final Map<String, String> properties) {
+        map.addFeature(pointer, coordinates, rings, getPropertyArray(properties));
+        return this;
+    }
+
+    @Nullable
+    private static String[] getPropertyArray(@Nullable final Map<String, String> properties) {
+        if (properties == null) {
+            return null;
+        }
+        final String[] out = new String[properties.size() * 2];
+        int i = 0;
+        for (final Map.Entry<String, String> entry : properties.entrySet()) {
+            out[i++] = entry.getKey();
+            out[i++] = entry.getValue();
+        }
+        return out;
+    }
+
     /**
      * Add features described in a GeoJSON string to this collection.
      * @param data A string containing a <a href="http://geojson.org/">GeoJSON</a> FeatureCollection
@@ -13,6 +13,8 @@ import android.util.DisplayMetrics;
 import com.mapzen.tangram.geometry.Polygon;
 import com.mapzen.tangram.geometry.Polyline;
 
+import java.nio.DoubleBuffer;
+
 /**
  * Class used to display points, polylines, and bitmaps dynamically on a map. Do not create one of
  * these objects directly, instead use {@link MapController#addMarker()}.
@@ -180,6 +182,31 @@ public class Marker {
                 polygon.getRingArray(), polygon.getRingArray().length);
     }
 
+    /**
+     * Sets the polyline to be displayed from packed coordinates, without copying them into Java
+     * objects first. When using this method, a 'lines' style must also be set.
+     * See {@link Marker#setStyling(String)}.
+     * @param coordinates a direct buffer in native byte order of longitude, latitude pairs, read
+     * from its position to its limit
+     * @return whether the polyline was successfully set
+     */
+    public boolean setPolyline(@NonNull final DoubleBuffer coordinates) {
+        return map.setMarkerPolyline(markerId, coordinates);
+    }
+
+    /**
+     * Sets the polygon to be displayed from packed coordinates, without copying them into Java
+     * objects first. When using this method, a 'polygon' style must also be set.
+     * See {@link Marker#setStyling(String)}.
+     * @param coordinates a direct buffer in native byte order of longitude, latitude pairs, read
+     * from its position to its limit
+     * @param rings the number of points of each ring in coordinates
+     * @return whether the polygon was successfully set
+     */
+    public boolean setPolygon(@NonNull final DoubleBuffer coordinates, @NonNull final int[] rings) {
+        return map.setMarkerPolygon(markerId, coordinates, rings);
+    }
+
     /**
      * Changes the marker's visibility on the map.
      * @param visible whether or not the marker should be visible
@@ -1,5 +1,6 @@
 #include "glfwApp.h"
 #include <GLFW/glfw3.h>
+#include <cmath>
 #include <cstdlib>
 
 #ifndef BUILD_NUM_STRING
@@ -153,6 +154,7 @@ void create(std::shared_ptr<Platform> p, int w, int h) {
 
     // Setup graphics
     map->setupGL();
+    map->setIdleFrameSkipping(true);
     int fWidth = 0, fHeight = 0;
     glfwGetFramebufferSize(main_window, &fWidth, &fHeight);
     framebufferResizeCallback(main_window, fWidth, fHeight);
@@ -165,6 +167,11 @@ void run() {
 
     double lastTime = glfwGetTime();
 
+    // Frames are due on the vsync after the last swap returned
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    double framePeriod = 1.0 / (mode && mode->refreshRate > 0 ? mode->refreshRate : 60);
+    double lastSwap = lastTime;
+
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(main_window)) {
 
@@ -172,12 +179,15 @@ void run() {
         double delta = currentTime - lastTime;
         lastTime = currentTime;
 
-        // Render
-        map->update(delta);
-        map->render();
+        double deadline = framePeriod - std::fmod(currentTime - lastSwap, framePeriod);
 
-        // Swap front and back buffers
-        glfwSwapBuffers(main_window);
+        // Render, the front buffer keeps showing frames that did not change
+        map->update(delta, deadline * 1000.0);
+        if (map->render()) {
+            // Swap front and back buffers
+            glfwSwapBuffers(main_window);
+            lastSwap = glfwGetTime();
+        }
 
         // Poll for and process events
         if (platform->isContinuousRendering()) {
@@ -401,6 +411,9 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
             case GLFW_KEY_9:
                 Tangram::toggleDebugFlag(Tangram::DebugFlags::selection_buffer);
                 break;
+            case GLFW_KEY_0:
+                Tangram::toggleDebugFlag(Tangram::DebugFlags::overdraw);
+                break;
             case GLFW_KEY_BACKSPACE:
                 recreate_context = true;
                 break;
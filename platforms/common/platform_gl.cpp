@@ -24,6 +24,9 @@ void GL::lineWidth(GLfloat width) {
 void GL::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
     GL_CHECK(glViewport(x, y, width, height));
 }
+void GL::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GL_CHECK(glScissor(x, y, width, height));
+}
 
 void GL::enable(GLenum id) {
     GL_CHECK(glEnable(id));
@@ -128,6 +131,13 @@ GLint GL::getAttribLocation(GLuint program, const GLchar *name) {
 void GL::getProgramiv(GLuint program, GLenum pname, GLint *params) {
     GL_CHECK(glGetProgramiv(program,pname,params));
 }
+void GL::getProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                          GLenum *binaryFormat, void *binary) {
+    GL_CHECK(glGetProgramBinary(program, bufSize, length, binaryFormat, binary));
+}
+void GL::programBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {
+    GL_CHECK(glProgramBinary(program, binaryFormat, binary, length));
+}
 void GL::getShaderiv(GLuint shader, GLenum pname, GLint *params) {
     GL_CHECK(glGetShaderiv(shader,pname, params));
 }
@@ -177,6 +187,10 @@ void GL::texSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
                        GLenum format, GLenum type, const GLvoid *pixels) {
     GL_CHECK(glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels)); }
 
+void GL::compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                              GLint border, GLsizei imageSize, const GLvoid *data) {
+    GL_CHECK(glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data)); }
+
 void GL::generateMipmap(GLenum target) {
     GL_CHECK(glGenerateMipmap(target));
 }
@@ -198,6 +212,13 @@ void GL::drawArrays(GLenum mode, GLint first, GLsizei count ) {
 void GL::drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices ) {
     GL_CHECK(glDrawElements(mode, count, type, indices ));
 }
+void GL::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                               const GLvoid *indices, GLsizei instanceCount) {
+    GL_CHECK(glDrawElementsInstanced(mode, count, type, indices, instanceCount));
+}
+void GL::vertexAttribDivisor(GLuint index, GLuint divisor) {
+    GL_CHECK(glVertexAttribDivisor(index, divisor));
+}
 
 void GL::uniform1f(GLint location, GLfloat v0) {
     GL_CHECK(glUniform1f(location, v0));
@@ -271,6 +292,11 @@ GLboolean GL::unmapBuffer(GLenum target) {
     GL_CHECK();
     return result;
 }
+void* GL::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    auto result = glMapBufferRange(target, offset, length, access);
+    GL_CHECK();
+    return result;
+}
 
 void GL::finish(void) {
     GL_CHECK(glFinish());
@@ -287,6 +313,49 @@ void GL::genVertexArrays(GLsizei n, GLuint *arrays) {
     GL_CHECK(glGenVertexArrays(n, arrays));
 }
 
+// Uniform buffers
+void GL::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    GL_CHECK(glBindBufferBase(target, index, buffer));
+}
+GLuint GL::getUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) {
+    auto result = glGetUniformBlockIndex(program, uniformBlockName);
+    GL_CHECK();
+    return result;
+}
+void GL::uniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+    GL_CHECK(glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding));
+}
+
+// Timer queries
+void GL::genQueries(GLsizei n, GLuint *ids) {
+    GL_CHECK(glGenQueries(n, ids));
+}
+void GL::deleteQueries(GLsizei n, const GLuint *ids) {
+    GL_CHECK(glDeleteQueries(n, ids));
+}
+void GL::beginQuery(GLenum target, GLuint id) {
+    GL_CHECK(glBeginQuery(target, id));
+}
+void GL::endQuery(GLenum target) {
+    GL_CHECK(glEndQuery(target));
+}
+void GL::getQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) {
+    GL_CHECK(glGetQueryObjectuiv(id, pname, params));
+}
+
+// Sync objects
+GLsync GL::fenceSync(GLenum condition, GLbitfield flags) {
+    auto result = glFenceSync(condition, flags);
+    GL_CHECK();
+    return result;
+}
+void GL::getSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values) {
+    GL_CHECK(glGetSynciv(sync, pname, bufSize, length, values));
+}
+void GL::deleteSync(GLsync sync) {
+    GL_CHECK(glDeleteSync(sync));
+}
+
 // Framebuffer
 void GL::bindFramebuffer(GLenum target, GLuint framebuffer) {
     GL_CHECK(glBindFramebuffer(target, framebuffer));
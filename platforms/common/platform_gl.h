@@ -13,10 +13,50 @@
 extern PFNGLBINDVERTEXARRAYOESPROC glBindVertexArrayOESEXT;
 extern PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArraysOESEXT;
 extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArraysOESEXT;
+extern PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOESEXT;
+extern PFNGLPROGRAMBINARYOESPROC glProgramBinaryOESEXT;
+extern PFNGLDRAWELEMENTSINSTANCEDEXTPROC glDrawElementsInstancedEXTEXT;
+extern PFNGLVERTEXATTRIBDIVISOREXTPROC glVertexAttribDivisorEXTEXT;
+extern PFNGLGENQUERIESEXTPROC glGenQueriesEXTEXT;
+extern PFNGLDELETEQUERIESEXTPROC glDeleteQueriesEXTEXT;
+extern PFNGLBEGINQUERYEXTPROC glBeginQueryEXTEXT;
+extern PFNGLENDQUERYEXTPROC glEndQueryEXTEXT;
+extern PFNGLGETQUERYOBJECTUIVEXTPROC glGetQueryObjectuivEXTEXT;
+extern PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRangeEXTEXT;
+
+// GLES 3 functions are not declared by the GLES 2 headers
+typedef void (GL_APIENTRYP PFNGLBINDBUFFERBASEPROC) (GLenum target, GLuint index, GLuint buffer);
+typedef GLuint (GL_APIENTRYP PFNGLGETUNIFORMBLOCKINDEXPROC) (GLuint program, const GLchar *uniformBlockName);
+typedef void (GL_APIENTRYP PFNGLUNIFORMBLOCKBINDINGPROC) (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+extern PFNGLBINDBUFFERBASEPROC glBindBufferBaseEXT;
+extern PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndexEXT;
+extern PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBindingEXT;
+typedef GLsync (GL_APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (GL_APIENTRYP PFNGLGETSYNCIVPROC) (GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values);
+typedef void (GL_APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+extern PFNGLFENCESYNCPROC glFenceSyncEXT;
+extern PFNGLGETSYNCIVPROC glGetSyncivEXT;
+extern PFNGLDELETESYNCPROC glDeleteSyncEXT;
 
 #define glDeleteVertexArrays glDeleteVertexArraysOESEXT
 #define glGenVertexArrays glGenVertexArraysOESEXT
 #define glBindVertexArray glBindVertexArrayOESEXT
+#define glGetProgramBinary glGetProgramBinaryOESEXT
+#define glProgramBinary glProgramBinaryOESEXT
+#define glDrawElementsInstanced glDrawElementsInstancedEXTEXT
+#define glVertexAttribDivisor glVertexAttribDivisorEXTEXT
+#define glGenQueries glGenQueriesEXTEXT
+#define glDeleteQueries glDeleteQueriesEXTEXT
+#define glBeginQuery glBeginQueryEXTEXT
+#define glEndQuery glEndQueryEXTEXT
+#define glGetQueryObjectuiv glGetQueryObjectuivEXTEXT
+#define glMapBufferRange glMapBufferRangeEXTEXT
+#define glBindBufferBase glBindBufferBaseEXT
+#define glGetUniformBlockIndex glGetUniformBlockIndexEXT
+#define glUniformBlockBinding glUniformBlockBindingEXT
+#define glFenceSync glFenceSyncEXT
+#define glGetSynciv glGetSyncivEXT
+#define glDeleteSync glDeleteSyncEXT
 #endif // TANGRAM_ANDROID
 
 #ifdef TANGRAM_IOS
@@ -25,6 +65,32 @@ extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArraysOESEXT;
 #define glDeleteVertexArrays glDeleteVertexArraysOES
 #define glGenVertexArrays glGenVertexArraysOES
 #define glBindVertexArray glBindVertexArrayOES
+#define glDrawElementsInstanced glDrawElementsInstancedEXT
+#define glVertexAttribDivisor glVertexAttribDivisorEXT
+#define glMapBufferRange glMapBufferRangeEXT
+
+// Dummy program binary functions, Hardware::supportsProgramBinary is false
+static void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                               GLenum *binaryFormat, void *binary) { if (length) { *length = 0; } }
+static void glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {}
+
+// Dummy timer query functions, iOS has no GL_TIME_ELAPSED queries
+static void glGenQueries(GLsizei n, GLuint *ids) { for (GLsizei i = 0; i < n; i++) { ids[i] = 0; } }
+static void glDeleteQueries(GLsizei n, const GLuint *ids) {}
+static void glBeginQuery(GLenum target, GLuint id) {}
+static void glEndQuery(GLenum target) {}
+static void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) { *params = 0; }
+
+// Dummy uniform buffer functions, Hardware::supportsUniformBuffers is false
+static void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {}
+static GLuint glGetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) { return 0xFFFFFFFFu; }
+static void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {}
+
+// Dummy sync functions, Hardware::supportsPixelBufferReadback is false
+typedef struct __GLsync *GLsync;
+static GLsync glFenceSync(GLenum condition, GLbitfield flags) { return nullptr; }
+static void glGetSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values) { *values = 0; }
+static void glDeleteSync(GLsync sync) {}
 #endif // TANGRAM_IOS
 
 #ifdef TANGRAM_OSX
@@ -36,6 +102,27 @@ extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArraysOESEXT;
 #define glDeleteVertexArrays glDeleteVertexArraysAPPLE
 #define glGenVertexArrays glGenVertexArraysAPPLE
 #define glBindVertexArray glBindVertexArrayAPPLE
+#define glDrawElementsInstanced glDrawElementsInstancedARB
+#define glVertexAttribDivisor glVertexAttribDivisorARB
+
+// Dummy program binary functions, Hardware::supportsProgramBinary is false
+static void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                               GLenum *binaryFormat, void *binary) { if (length) { *length = 0; } }
+static void glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {}
+
+// Dummy uniform buffer functions, Hardware::supportsUniformBuffers is false
+static void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {}
+static GLuint glGetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) { return 0xFFFFFFFFu; }
+static void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {}
+
+// Dummy map buffer range function, Hardware::supportsMapBufferRange is false
+static void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) { return nullptr; }
+
+// Dummy sync functions, Hardware::supportsPixelBufferReadback is false
+typedef struct __GLsync *GLsync;
+static GLsync glFenceSync(GLenum condition, GLbitfield flags) { return nullptr; }
+static void glGetSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values) { *values = 0; }
+static void glDeleteSync(GLsync sync) {}
 #endif // TANGRAM_OSX
 
 #ifdef TANGRAM_LINUX
@@ -57,6 +144,37 @@ static void glBindVertexArray(GLuint array) {}
 static void glDeleteVertexArrays(GLsizei n, const GLuint *arrays) {}
 static void glGenVertexArrays(GLsizei n, GLuint *arrays) {}
 
+// Dummy instancing functions, Hardware::supportsInstancing is false
+static void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                    const GLvoid *indices, GLsizei instanceCount) {}
+static void glVertexAttribDivisor(GLuint index, GLuint divisor) {}
+
+// Dummy program binary functions, Hardware::supportsProgramBinary is false
+static void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                               GLenum *binaryFormat, void *binary) { if (length) { *length = 0; } }
+static void glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {}
+
+// Dummy timer query functions, Hardware::supportsTimerQuery is false
+static void glGenQueries(GLsizei n, GLuint *ids) { for (GLsizei i = 0; i < n; i++) { ids[i] = 0; } }
+static void glDeleteQueries(GLsizei n, const GLuint *ids) {}
+static void glBeginQuery(GLenum target, GLuint id) {}
+static void glEndQuery(GLenum target) {}
+static void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) { *params = 0; }
+
+// Dummy uniform buffer functions, Hardware::supportsUniformBuffers is false
+static void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {}
+static GLuint glGetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) { return 0xFFFFFFFFu; }
+static void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {}
+
+// Dummy map buffer range function, Hardware::supportsMapBufferRange is false
+static void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) { return nullptr; }
+
+// Dummy sync functions, Hardware::supportsPixelBufferReadback is false
+typedef struct __GLsync *GLsync;
+static GLsync glFenceSync(GLenum condition, GLbitfield flags) { return nullptr; }
+static void glGetSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values) { *values = 0; }
+static void glDeleteSync(GLsync sync) {}
+
 #endif // TANGRAM_RPI
 
 #if defined(TANGRAM_ANDROID) || defined(TANGRAM_IOS) || defined(TANGRAM_RPI)
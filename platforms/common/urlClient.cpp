@@ -1,6 +1,8 @@
 #include "urlClient.h"
 #include "log.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <curl/curl.h>
 
@@ -19,18 +21,32 @@ struct CurlGlobals {
 
 const char* requestCancelledError = "Request cancelled";
 
+constexpr std::array<uint32_t, 10> UrlClient::LatencyHistogram::boundsMs;
+
 UrlClient::UrlClient(Options options) : m_options(options) {
-    assert(options.numberOfThreads > 0);
-    // Start the curl threads.
+    assert(options.maxActiveTasks > 0);
+
+    // DNS results and TLS sessions are shared by all easy handles. Only
+    // the curl thread uses them, so the share needs no lock callbacks.
+    m_share = curl_share_init();
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    // Connections are cached by the multi handle and kept alive between
+    // requests, HTTP/2 streams to the same host are multiplexed.
+    m_multi = curl_multi_init();
+    curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, options.http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+    curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, long(options.maxHostConnections));
+    curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, long(options.maxActiveTasks));
+
+    m_tasks.resize(options.maxActiveTasks);
+
+    // Start the curl thread.
     m_keepRunning = true;
-    m_tasks.resize(options.numberOfThreads);
-    for (uint32_t i = 0; i < options.numberOfThreads; i++) {
-        m_threads.emplace_back(&UrlClient::curlLoop, this, i);
-    }
+    m_thread = std::thread(&UrlClient::curlLoop, this);
 }
 
 UrlClient::~UrlClient() {
-    // Make all tasks canceled.
     {
         // Lock the mutex to prevent concurrent modification of the list by the curl loop thread.
         std::lock_guard<std::mutex> lock(m_requestMutex);
@@ -42,31 +58,32 @@ UrlClient::~UrlClient() {
             }
         }
         m_requests.clear();
-        for (auto& task : m_tasks) {
-            task.request.canceled = true;
-        }
-    }
-    // Stop the curl threads.
-    m_keepRunning = false;
-    m_requestCondition.notify_all();
-    for (auto& thread : m_threads) {
-        thread.join();
+        m_keepRunning = false;
     }
+    // Stop the curl thread, it cancels the active requests.
+    curl_multi_wakeup(m_multi);
+    m_thread.join();
+
+    curl_multi_cleanup(m_multi);
+    curl_share_cleanup(m_share);
 }
 
 UrlRequestHandle UrlClient::addRequest(const std::string& url, UrlCallback onComplete) {
-    // Create a new request.
-    m_requestCount++;
-    Request request = {url, onComplete, m_requestCount, false};
-    // Add the request to our list.
+    return addRequest(url, {}, onComplete);
+}
+
+UrlRequestHandle UrlClient::addRequest(const std::string& url, const UrlValidators& validators,
+                                       UrlCallback onComplete) {
+    UrlRequestHandle handle;
     {
         // Lock the mutex to prevent concurrent modification of the list by the curl loop thread.
         std::lock_guard<std::mutex> lock(m_requestMutex);
-        m_requests.push_back(request);
+        handle = ++m_requestCount;
+        m_requests.push_back({url, onComplete, handle, validators});
     }
-    // Notify a thread to start the transfer.
-    m_requestCondition.notify_one();
-    return m_requestCount;
+    // Wake the curl thread to start the transfer.
+    curl_multi_wakeup(m_multi);
+    return handle;
 }
 
 void UrlClient::cancelRequest(UrlRequestHandle handle) {
@@ -84,19 +101,21 @@ void UrlClient::cancelRequest(UrlRequestHandle handle) {
                 break;
             }
         }
+        // Otherwise the request may be active, let the curl thread abort it.
+        if (!callback) { m_canceled.push_back(handle); }
     }
     // We run the callback outside of the mutex lock to prevent deadlock in case the callback
     // makes further calls into this UrlClient.
     if (callback) {
         callback(getCanceledResponse());
+    } else {
+        curl_multi_wakeup(m_multi);
     }
+}
 
-    // Next check the active request list.
-    for (auto& task : m_tasks) {
-        if (task.request.handle == handle) {
-            task.request.canceled = true;
-        }
-    }
+UrlClient::LatencyHistogram UrlClient::latencyHistogram() const {
+    std::lock_guard<std::mutex> lock(m_latencyMutex);
+    return m_latency;
 }
 
 UrlClient::Response UrlClient::getCanceledResponse() {
@@ -116,84 +135,210 @@ size_t UrlClient::curlWriteCallback(char* ptr, size_t size, size_t n, void* user
     return addedSize;
 }
 
-int UrlClient::curlProgressCallback(void* user, double dltotal, double dlnow, double ultotal, double ulnow) {
-    // Signals libCURL to abort the request if marked as canceled.
-    auto* task = reinterpret_cast<UrlClient::Task*>(user);
-    return static_cast<int>(task->request.canceled);
+size_t UrlClient::curlHeaderCallback(char* ptr, size_t size, size_t n, void* user) {
+    // Picks the cache headers from the response header lines.
+    auto* response = reinterpret_cast<UrlClient::Response*>(user);
+    auto length = size * n;
+    std::string line(ptr, length);
+
+    auto colon = line.find(':');
+    if (colon == std::string::npos) { return length; }
+
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    auto valueStart = line.find_first_not_of(" \t", colon + 1);
+    auto valueEnd = line.find_last_not_of(" \t\r\n");
+    if (valueStart == std::string::npos || valueEnd < valueStart) { return length; }
+    std::string value = line.substr(valueStart, valueEnd - valueStart + 1);
+
+    if (name == "etag") {
+        response->etag = value;
+    } else if (name == "last-modified") {
+        response->lastModified = value;
+    } else if (name == "cache-control") {
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        if (value.find("no-store") != std::string::npos ||
+            value.find("no-cache") != std::string::npos) {
+            response->maxAge = 0;
+        } else {
+            auto maxAge = value.find("max-age=");
+            if (maxAge != std::string::npos) {
+                response->maxAge = std::strtoll(value.c_str() + maxAge + 8, nullptr, 10);
+            }
+        }
+    }
+    return length;
 }
 
-void UrlClient::curlLoop(uint32_t index) {
-    assert(m_tasks.size() > index);
-    Task& task = m_tasks[index];
-    LOGD("curlLoop %u starting", index);
-    // Create a buffer for curl error messages.
-    char curlErrorString[CURL_ERROR_SIZE] = {0};
-    // Set up an easy handle for reuse.
-    auto handle = curl_easy_init();
-    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &curlWriteCallback);
-    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &task.response);
-    curl_easy_setopt(handle, CURLOPT_PROGRESSFUNCTION, &curlProgressCallback);
-    curl_easy_setopt(handle, CURLOPT_PROGRESSDATA, &task);
-    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
-    curl_easy_setopt(handle, CURLOPT_HEADER, 0L);
-    curl_easy_setopt(handle, CURLOPT_VERBOSE, 0L);
-    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip");
-    curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, curlErrorString);
-    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
-    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, m_options.connectionTimeoutMs);
-    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, m_options.requestTimeoutMs);
-    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1);
-    curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 20);
+void UrlClient::startTask(Task& task, Request&& request) {
+    static_assert(sizeof(task.errorString) >= CURL_ERROR_SIZE, "Error buffer too small");
+
+    task.request = std::move(request);
+    task.active = true;
+    task.start = std::chrono::steady_clock::now();
+    task.errorString[0] = '\0';
+
+    if (!task.handle) {
+        // Set up an easy handle for reuse.
+        auto handle = curl_easy_init();
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &curlWriteCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &task.response);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &curlHeaderCallback);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &task.response);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, &task);
+        curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+        curl_easy_setopt(handle, CURLOPT_HEADER, 0L);
+        curl_easy_setopt(handle, CURLOPT_VERBOSE, 0L);
+        curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip");
+        curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, task.errorString);
+        curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, long(m_options.connectionTimeoutMs));
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, long(m_options.requestTimeoutMs));
+        curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 20L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        if (m_options.http2) {
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            // Rather wait for a connection to multiplex on than open a new one
+            curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+        }
+        task.handle = handle;
+    }
+
+    curl_slist* headers = nullptr;
+    auto& validators = task.request.validators;
+    if (!validators.etag.empty()) {
+        headers = curl_slist_append(headers, ("If-None-Match: " + validators.etag).c_str());
+    }
+    if (!validators.lastModified.empty()) {
+        headers = curl_slist_append(headers, ("If-Modified-Since: " + validators.lastModified).c_str());
+    }
+    // Also clears the headers of an earlier request on the reused handle
+    curl_easy_setopt(task.handle, CURLOPT_HTTPHEADER, headers);
+    task.headers = headers;
+
+    const char* url = task.request.url.data();
+    curl_easy_setopt(task.handle, CURLOPT_URL, url);
+    LOGD("curlLoop starting request for url: %s", url);
+
+    curl_multi_add_handle(m_multi, task.handle);
+}
+
+void UrlClient::finishTask(Task& task, const char* error) {
+    curl_multi_remove_handle(m_multi, task.handle);
+    task.active = false;
+
+    long status = 0;
+    curl_easy_getinfo(task.handle, CURLINFO_RESPONSE_CODE, &status);
+    task.response.status = int(status);
+
+    auto elapsed = std::chrono::steady_clock::now() - task.start;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+    if (error != requestCancelledError) {
+        std::lock_guard<std::mutex> lock(m_latencyMutex);
+        auto& bounds = LatencyHistogram::boundsMs;
+        size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), uint32_t(ms)) - bounds.begin();
+        m_latency.counts[bucket]++;
+        m_latency.totalMs += ms;
+        m_latency.requests++;
+        if (error) { m_latency.failures++; }
+    }
+
+    task.response.error = error;
+    // If a callback is given, always run it regardless of request result.
+    if (task.request.callback) {
+        LOGD("curlLoop performing request callback");
+        task.request.callback(task.response);
+    }
+
+    // Reset the response.
+    task.response.content.clear();
+    task.response.error = nullptr;
+    task.response.status = 0;
+    task.response.etag.clear();
+    task.response.lastModified.clear();
+    task.response.maxAge = -1;
+    task.request = {};
+
+    curl_slist_free_all(static_cast<curl_slist*>(task.headers));
+    task.headers = nullptr;
+}
+
+void UrlClient::curlLoop() {
+    LOGD("curlLoop starting");
+
+    setCurrentThreadPolicy(m_options.threadPolicy);
+
+    std::vector<UrlRequestHandle> canceled;
+
     // Loop until the session is destroyed.
-    while (m_keepRunning) {
-        bool haveRequest = false;
-        // Wait until the condition variable is notified.
+    while (true) {
         {
-            std::unique_lock<std::mutex> lock(m_requestMutex);
-            if (m_requests.empty()) {
-                LOGD("curlLoop %u waiting", index);
-                m_requestCondition.wait(lock);
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            if (!m_keepRunning) { break; }
+
+            std::swap(canceled, m_canceled);
+
+            // Fill free tasks from the front of the request list.
+            size_t taken = 0;
+            for (auto& task : m_tasks) {
+                if (task.active) { continue; }
+                if (taken == m_requests.size()) { break; }
+                startTask(task, std::move(m_requests[taken++]));
             }
-            LOGD("curlLoop %u notified", index);
-            // Try to get a request from the list.
-            if (!m_requests.empty()) {
-                // Take the first request from our list.
-                task.request = m_requests.front();
-                m_requests.erase(m_requests.begin());
-                haveRequest = true;
+            m_requests.erase(m_requests.begin(), m_requests.begin() + taken);
+        }
+
+        for (auto handle : canceled) {
+            for (auto& task : m_tasks) {
+                if (task.active && task.request.handle == handle) {
+                    LOGD("curlLoop aborted request for url: %s", task.request.url.c_str());
+                    finishTask(task, requestCancelledError);
+                }
             }
         }
-        if (haveRequest) {
-            // Configure the easy handle.
-            const char* url = task.request.url.data();
-            curl_easy_setopt(handle, CURLOPT_URL, url);
-            LOGD("curlLoop %u starting request for url: %s", index, url);
-            // Perform the request.
-            auto result = curl_easy_perform(handle);
-            // Handle success or error.
+        canceled.clear();
+
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) { continue; }
+
+            char* user = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &user);
+            auto* task = reinterpret_cast<Task*>(user);
+            if (!task) { continue; }
+
+            auto result = message->data.result;
+            const char* url = task->request.url.c_str();
             if (result == CURLE_OK) {
-                LOGD("curlLoop %u succeeded for url: %s", index, url);
-                task.response.error = nullptr;
-            } else if (result == CURLE_ABORTED_BY_CALLBACK) {
-                LOGD("curlLoop %u aborted request for url: %s", index, url);
-                task.response.error = requestCancelledError;
+                LOGD("curlLoop succeeded for url: %s", url);
+                finishTask(*task, nullptr);
             } else {
-                LOGD("curlLoop %u failed with error '%s' for url: %s", index, curlErrorString, url);
-                task.response.error = curlErrorString;
-            }
-            // If a callback is given, always run it regardless of request result.
-            if (task.request.callback) {
-                LOGD("curlLoop %u performing request callback", index);
-                task.request.callback(task.response);
+                if (task->errorString[0] == '\0') {
+                    std::strncpy(task->errorString, curl_easy_strerror(result),
+                                 sizeof(task->errorString) - 1);
+                }
+                LOGD("curlLoop failed with error '%s' for url: %s", task->errorString, url);
+                finishTask(*task, task->errorString);
             }
         }
-        // Reset the response.
-        task.response.content.clear();
-        task.response.error = nullptr;
+
+        // Sleep until a transfer makes progress or curl_multi_wakeup is called.
+        curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
     }
-    LOGD("curlLoop %u exiting", index);
-    // Clean up our easy handle.
-    curl_easy_cleanup(handle);
+
+    // Abort the active requests.
+    for (auto& task : m_tasks) {
+        if (task.active) { finishTask(task, requestCancelledError); }
+        if (task.handle) { curl_easy_cleanup(task.handle); }
+    }
+
+    LOGD("curlLoop exiting");
 }
 
 } // namespace Tangram
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "platform.h"
-#include <condition_variable>
+#include <array>
+#include <chrono>
 #include <functional>
 #include <mutex>
 #include <string>
@@ -15,9 +16,26 @@ class UrlClient {
 public:
 
     struct Options {
-        uint32_t numberOfThreads = 4;
+        // Transfers running at once, more requests wait in a queue
+        uint32_t maxActiveTasks = 20;
+        // Connections kept per host, HTTP/2 requests share one of them
+        uint32_t maxHostConnections = 6;
         uint32_t connectionTimeoutMs = 3000;
         uint32_t requestTimeoutMs = 30000;
+        bool http2 = true;
+        // Applied to the curl thread when it starts
+        ThreadPolicy threadPolicy;
+    };
+
+    // Counts of finished requests by latency
+    struct LatencyHistogram {
+        // Upper bound of each bucket, the last one takes all slower requests
+        static constexpr std::array<uint32_t, 10> boundsMs = {{
+            10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 }};
+        std::array<uint64_t, boundsMs.size() + 1> counts{};
+        uint64_t totalMs = 0;
+        uint64_t requests = 0;
+        uint64_t failures = 0;
     };
 
     UrlClient(Options options);
@@ -25,38 +43,59 @@ public:
 
     UrlRequestHandle addRequest(const std::string& url, UrlCallback onComplete);
 
+    // Sends the validators as 'If-None-Match' and 'If-Modified-Since'
+    UrlRequestHandle addRequest(const std::string& url, const UrlValidators& validators,
+                                UrlCallback onComplete);
+
     void cancelRequest(UrlRequestHandle request);
 
+    // Snapshot of the latencies of all completed requests
+    LatencyHistogram latencyHistogram() const;
+
 private:
 
     struct Request {
         std::string url;
         UrlCallback callback;
         UrlRequestHandle handle;
-        bool canceled;
+        UrlValidators validators;
     };
 
     using Response = UrlResponse;
 
     struct Task {
+        void* handle = nullptr;
+        // curl_slist of the conditional request headers
+        void* headers = nullptr;
         Request request;
         Response response;
+        std::chrono::steady_clock::time_point start;
+        char errorString[256] = {0};
+        bool active = false;
     };
 
     static Response getCanceledResponse();
     static size_t curlWriteCallback(char* ptr, size_t size, size_t n, void* user);
-    static int curlProgressCallback(void* user, double dltotal, double dlnow, double ultotal, double ulnow);
+    static size_t curlHeaderCallback(char* ptr, size_t size, size_t n, void* user);
 
-    void curlLoop(uint32_t index);
+    void curlLoop();
+    void startTask(Task& task, Request&& request);
+    void finishTask(Task& task, const char* error);
 
-    std::vector<std::thread> m_threads;
+    std::thread m_thread;
     std::vector<Task> m_tasks;
     std::vector<Request> m_requests;
-    std::condition_variable m_requestCondition;
+    std::vector<UrlRequestHandle> m_canceled;
     std::mutex m_requestMutex;
+    // CURLM and CURLSH handles
+    void* m_multi = nullptr;
+    void* m_share = nullptr;
     Options m_options;
     UrlRequestHandle m_requestCount = 0;
     bool m_keepRunning = false;
+
+    LatencyHistogram m_latency;
+    mutable std::mutex m_latencyMutex;
 };
 
 } // namespace Tangram
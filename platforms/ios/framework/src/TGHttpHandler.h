@@ -25,6 +25,9 @@ NS_ASSUME_NONNULL_BEGIN
     - cache location: `/tangram_cache`
     - cache memory capacity: 4Mb
     - cache disk capacity: 30Mb
+    - HTTP pipelining enabled, at most 6 connections per host
+
+ HTTP/2 connections are multiplexed by NSURLSession when the server supports it.
 
  To change this configuration, create a new http handler and set it to the map view with
  `-[TGMapViewController httpHandler]`.
@@ -38,6 +41,17 @@ TG_EXPORT
  */
 @property(nonatomic, strong) NSMutableDictionary *HTTPAdditionalHeaders;
 
+/**
+ The memory capacity of the URL cache shared by all requests of this handler, in bytes.
+ Changing it resizes the cache in place, without dropping the responses it holds.
+ */
+@property(nonatomic, assign) NSUInteger cacheMemoryCapacity;
+
+/**
+ The disk capacity of the URL cache shared by all requests of this handler, in bytes.
+ */
+@property(nonatomic, assign) NSUInteger cacheDiskCapacity;
+
 /**
  Initializes a http handler with the default configuration.
 
@@ -75,6 +89,19 @@ TG_EXPORT
  */
 - (NSUInteger)downloadRequestAsync:(NSString *)url completionHandler:(TGDownloadCompletionHandler)completionHandler;
 
+/**
+ Creates an asynchronous download request with a priority.
+
+ @param url the URL of the download request
+ @param priority the relative priority of the request, from `NSURLSessionTaskPriorityLow` to `NSURLSessionTaskPriorityHigh`
+ @param completionHandler a handler to be called once the network request completed
+ @return an integer that uniquely identifies the resulting task within this handler
+
+ @note This method will be automatically called by the map view instance, tiles closer to the
+ view center have a higher priority.
+ */
+- (NSUInteger)downloadRequestAsync:(NSString *)url priority:(float)priority completionHandler:(TGDownloadCompletionHandler)completionHandler;
+
 /**
  Cancels a download request for a specific URL.
 
@@ -74,6 +74,10 @@
 
     sessionConfiguration.timeoutIntervalForRequest = 30;
     sessionConfiguration.timeoutIntervalForResource = 60;
+    // Only used for HTTP/1.1 servers, HTTP/2 servers multiplex the
+    // requests of one connection
+    sessionConfiguration.HTTPShouldUsePipelining = YES;
+    sessionConfiguration.HTTPMaximumConnectionsPerHost = 6;
 
     return sessionConfiguration;
 }
@@ -101,13 +105,40 @@
     self.session = [NSURLSession sessionWithConfiguration:self.configuration];
 }
 
+- (NSUInteger)cacheMemoryCapacity
+{
+    return self.configuration.URLCache.memoryCapacity;
+}
+
+- (void)setCacheMemoryCapacity:(NSUInteger)cacheMemoryCapacity
+{
+    // The session shares the cache object of its configuration
+    self.configuration.URLCache.memoryCapacity = cacheMemoryCapacity;
+}
+
+- (NSUInteger)cacheDiskCapacity
+{
+    return self.configuration.URLCache.diskCapacity;
+}
+
+- (void)setCacheDiskCapacity:(NSUInteger)cacheDiskCapacity
+{
+    self.configuration.URLCache.diskCapacity = cacheDiskCapacity;
+}
+
 #pragma mark - Instance Methods
 
 - (NSUInteger)downloadRequestAsync:(NSString*)url completionHandler:(TGDownloadCompletionHandler)completionHandler
+{
+    return [self downloadRequestAsync:url priority:NSURLSessionTaskPriorityDefault completionHandler:completionHandler];
+}
+
+- (NSUInteger)downloadRequestAsync:(NSString*)url priority:(float)priority completionHandler:(TGDownloadCompletionHandler)completionHandler
 {
     NSURLSessionDataTask* dataTask = [self.session dataTaskWithURL:[NSURL URLWithString:url]
                                                                       completionHandler:completionHandler];
 
+    dataTask.priority = priority;
     [dataTask resume];
 
     return [dataTask taskIdentifier];
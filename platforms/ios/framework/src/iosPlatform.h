@@ -16,6 +16,8 @@ public:
     std::vector<FontSourceHandle> systemFontFallbacksHandle() const override;
     FontSourceHandle systemFont(const std::string& _name, const std::string& _weight, const std::string& _face) const override;
     UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
+    UrlRequestHandle startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                double _priority, UrlCallback _callback) override;
     void cancelUrlRequest(UrlRequestHandle _request) override;
 
 private:
@@ -4,6 +4,8 @@
 
 #include "iosPlatform.h"
 #include "log.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -137,7 +139,26 @@ FontSourceHandle iOSPlatform::systemFont(const std::string& _name, const std::st
     return FontSourceHandle(std::string(font.fontName.UTF8String));
 }
 
+// Tasks of tiles in view have a priority below this, prefetched tiles above
+static const double kPrefetchPriority = 1e18;
+
+// NSURLSessionTask priorities range from 0 to 1, higher is more important and
+// NSURLSessionTaskPriorityDefault is 0.5. Tiles in view are requested above
+// the default, the closest to the view center first, and prefetched tiles at
+// NSURLSessionTaskPriorityLow.
+static float taskPriority(double _priority) {
+    if (_priority >= kPrefetchPriority) { return NSURLSessionTaskPriorityLow; }
+    double distance = std::log10(1.0 + std::max(_priority, 0.0));
+    return NSURLSessionTaskPriorityDefault + 0.5f / float(1.0 + distance);
+}
+
 UrlRequestHandle iOSPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+    return startPrioritizedUrlRequest(_url, {}, 0, _callback);
+}
+
+UrlRequestHandle iOSPlatform::startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                         double _priority, UrlCallback _callback) {
+    // Stale responses are revalidated by the NSURLCache of the session
     __strong TGMapView* mapView = m_mapView;
 
     UrlResponse errorResponse;
@@ -190,7 +211,9 @@ UrlRequestHandle iOSPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
     };
 
     NSString* url = [NSString stringWithUTF8String:_url.string().c_str()];
-    NSUInteger taskIdentifier = [httpHandler downloadRequestAsync:url completionHandler:handler];
+    NSUInteger taskIdentifier = [httpHandler downloadRequestAsync:url
+                                                         priority:taskPriority(_priority)
+                                                completionHandler:handler];
 
     return taskIdentifier;
 }
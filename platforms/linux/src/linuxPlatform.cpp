@@ -71,6 +71,11 @@ UrlRequestHandle LinuxPlatform::startUrlRequest(Url _url, UrlCallback _callback)
     return m_urlClient.addRequest(_url.string(), _callback);
 }
 
+UrlRequestHandle LinuxPlatform::startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                           UrlCallback _callback) {
+    return m_urlClient.addRequest(_url.string(), _validators, _callback);
+}
+
 void LinuxPlatform::cancelUrlRequest(UrlRequestHandle _request) {
     m_urlClient.cancelRequest(_request);
 }
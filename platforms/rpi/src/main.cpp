@@ -45,6 +45,7 @@ struct LaunchOptions {
     float rotation = 0.0f;
     float tilt = 0.0f;
     bool hasLocationSet = false;
+    bool lowMemory = false;
 };
 
 LaunchOptions getLaunchOptions(int argc, char **argv) {
@@ -77,6 +78,8 @@ LaunchOptions getLaunchOptions(int argc, char **argv) {
             options.tilt = std::stof(argValue);
         } else if (argName == "-r" || argName == "--rotation") {
             options.rotation = std::stof(argValue);
+        } else if (argName == "-p" || argName == "--profile") {
+            options.lowMemory = (argValue == "low-memory");
         }
     }
     return options;
@@ -119,7 +122,7 @@ int main(int argc, char **argv) {
     LaunchOptions options = getLaunchOptions(argc, argv);
 
     UrlClient::Options urlClientOptions;
-    urlClientOptions.numberOfThreads = 4;
+    urlClientOptions.maxActiveTasks = options.lowMemory ? 4 : 20;
 
     platform = std::make_shared<RpiPlatform>(urlClientOptions);
 
@@ -150,7 +153,7 @@ int main(int argc, char **argv) {
 
     Url sceneUrl = Url(options.sceneFilePath).resolved(baseUrl);
 
-    map = new Map(platform);
+    map = new Map(platform, options.lowMemory ? ResourceProfile::lowMemory() : ResourceProfile());
     map->loadScene(sceneUrl.string(), !options.hasLocationSet, updates);
     map->setupGL();
     map->resize(getWindowWidth(), getWindowHeight());
@@ -68,6 +68,11 @@ UrlRequestHandle RpiPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
     return m_urlClient.addRequest(_url.string(), _callback);
 }
 
+UrlRequestHandle RpiPlatform::startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                         UrlCallback _callback) {
+    return m_urlClient.addRequest(_url.string(), _validators, _callback);
+}
+
 void RpiPlatform::cancelUrlRequest(UrlRequestHandle _request) {
     m_urlClient.cancelRequest(_request);
 }
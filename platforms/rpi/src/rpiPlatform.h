@@ -17,6 +17,8 @@ public:
     void requestRender() const override;
     std::vector<FontSourceHandle> systemFontFallbacksHandle() const override;
     UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
+    UrlRequestHandle startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                UrlCallback _callback) override;
     void cancelUrlRequest(UrlRequestHandle _url) override;
     FontSourceHandle systemFont(const std::string& _name, const std::string& _weight,
             const std::string& _face) const override;
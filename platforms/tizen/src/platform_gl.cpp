@@ -21,6 +21,9 @@ void GL::lineWidth(GLfloat width) {
 void GL::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
     __evas_gl_glapi->glViewport(x, y, width, height);
 }
+void GL::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    __evas_gl_glapi->glScissor(x, y, width, height);
+}
 
 void GL::enable(GLenum id) {
     __evas_gl_glapi->glEnable(id);
@@ -117,6 +120,13 @@ GLint GL::getAttribLocation(GLuint program, const GLchar *name) {
 void GL::getProgramiv(GLuint program, GLenum pname, GLint *params) {
     __evas_gl_glapi->glGetProgramiv(program,pname,params);
 }
+void GL::getProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                          GLenum *binaryFormat, void *binary) {
+    __evas_gl_glapi->glGetProgramBinaryOES(program, bufSize, length, binaryFormat, binary);
+}
+void GL::programBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {
+    __evas_gl_glapi->glProgramBinaryOES(program, binaryFormat, binary, length);
+}
 void GL::getShaderiv(GLuint shader, GLenum pname, GLint *params) {
     __evas_gl_glapi->glGetShaderiv(shader,pname, params);
 }
@@ -166,6 +176,10 @@ void GL::texSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
                        GLenum format, GLenum type, const GLvoid *pixels) {
     __evas_gl_glapi->glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels); }
 
+void GL::compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                              GLint border, GLsizei imageSize, const GLvoid *data) {
+    __evas_gl_glapi->glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data); }
+
 void GL::generateMipmap(GLenum target) {
     __evas_gl_glapi->glGenerateMipmap(target);
 }
@@ -187,6 +201,13 @@ void GL::drawArrays(GLenum mode, GLint first, GLsizei count ) {
 void GL::drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices ) {
     __evas_gl_glapi->glDrawElements(mode, count, type, indices );
 }
+void GL::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                               const GLvoid *indices, GLsizei instanceCount) {
+    __evas_gl_glapi->glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+}
+void GL::vertexAttribDivisor(GLuint index, GLuint divisor) {
+    __evas_gl_glapi->glVertexAttribDivisor(index, divisor);
+}
 
 void GL::uniform1f(GLint location, GLfloat v0) {
     __evas_gl_glapi->glUniform1f(location, v0);
@@ -256,6 +277,10 @@ void* GL::mapBuffer(GLenum target, GLenum access) {
 GLboolean GL::unmapBuffer(GLenum target) {
     return __evas_gl_glapi->glUnmapBufferOES(target);
 }
+// Not part of the Evas GL 2.0 API, dynamic meshes upload their buffers
+void* GL::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    return nullptr;
+}
 
 void GL::finish(void) {
     __evas_gl_glapi->glFinish();
@@ -272,6 +297,33 @@ void GL::genVertexArrays(GLsizei n, GLuint *arrays) {
     __evas_gl_glapi->glGenVertexArraysOES(n, arrays);
 }
 
+// Uniform buffers are not part of the Evas GL 2.0 API, programs fall back to plain uniforms
+void GL::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {}
+GLuint GL::getUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) {
+    return GL_INVALID_INDEX;
+}
+void GL::uniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {}
+
+// Timer queries are not part of the Evas GL 2.0 API, no query is created
+void GL::genQueries(GLsizei n, GLuint *ids) {
+    for (GLsizei i = 0; i < n; i++) { ids[i] = 0; }
+}
+void GL::deleteQueries(GLsizei n, const GLuint *ids) {}
+void GL::beginQuery(GLenum target, GLuint id) {}
+void GL::endQuery(GLenum target) {}
+void GL::getQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) {
+    *params = 0;
+}
+
+// Sync objects are not part of the Evas GL 2.0 API, snapshots are read synchronously
+GLsync GL::fenceSync(GLenum condition, GLbitfield flags) {
+    return nullptr;
+}
+void GL::getSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values) {
+    *values = GL_SIGNALED;
+}
+void GL::deleteSync(GLsync sync) {}
+
 // Framebuffer
 void GL::bindFramebuffer(GLenum target, GLuint framebuffer) {
     __evas_gl_glapi->glBindFramebuffer(target, framebuffer);
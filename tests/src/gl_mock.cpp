@@ -1,7 +1,19 @@
 #include "gl.h"
 
+#include <cstring>
+#include <map>
+#include <vector>
+
 namespace Tangram {
 
+// Contents of the vertex and index buffers, per target, so that tests can
+// map them for reading
+static std::map<GLenum, std::vector<char>> bufferStores;
+
+static bool storesData(GLenum target) {
+    return target == GL_ARRAY_BUFFER || target == GL_ELEMENT_ARRAY_BUFFER;
+}
+
 GLenum GL::getError() {
     return 0;
 }
@@ -16,6 +28,8 @@ void GL::lineWidth(GLfloat width) {
 }
 void GL::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
 }
+void GL::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+}
 
 void GL::enable(GLenum id) {
 }
@@ -87,6 +101,11 @@ void GL::getProgramiv(GLuint program, GLenum pname, GLint *params) {
 }
 void GL::getShaderiv(GLuint shader, GLenum pname, GLint *params) {
 }
+void GL::getProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                          GLenum *binaryFormat, void *binary) {
+}
+void GL::programBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) {
+}
 
 // Buffers
 void GL::bindBuffer(GLenum target, GLuint buffer) {
@@ -96,8 +115,16 @@ void GL::deleteBuffers(GLsizei n, const GLuint *buffers) {
 void GL::genBuffers(GLsizei n, GLuint *buffers) {
 }
 void GL::bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    if (!storesData(target)) { return; }
+    auto& store = bufferStores[target];
+    store.assign(size, 0);
+    if (data) { std::memcpy(store.data(), data, size); }
 }
 void GL::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    if (!storesData(target)) { return; }
+    auto& store = bufferStores[target];
+    if (store.size() < size_t(offset + size)) { store.resize(offset + size); }
+    std::memcpy(store.data() + offset, data, size);
 }
 void GL::readPixels(GLint x, GLint y, GLsizei width, GLsizei height,
                     GLenum format, GLenum type, GLvoid* pixels) {
@@ -120,6 +147,9 @@ void GL::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei wi
 void GL::texSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
                        GLenum format, GLenum type, const GLvoid *pixels) {
 }
+void GL::compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                              GLint border, GLsizei imageSize, const GLvoid *data) {
+}
 void GL::generateMipmap(GLenum target) {
 }
 
@@ -135,6 +165,11 @@ void GL::drawArrays(GLenum mode, GLint first, GLsizei count ) {
 }
 void GL::drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices ) {
 }
+void GL::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                               const GLvoid *indices, GLsizei instanceCount) {
+}
+void GL::vertexAttribDivisor(GLuint index, GLuint divisor) {
+}
 
 void GL::uniform1f(GLint location, GLfloat v0) {
 }
@@ -185,6 +220,14 @@ void* GL::mapBuffer(GLenum target, GLenum access) {
 GLboolean GL::unmapBuffer(GLenum target) {
     return true;
 }
+void* GL::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    auto it = bufferStores.find(target);
+    if (access != GL_MAP_READ_BIT || it == bufferStores.end() ||
+        it->second.size() < size_t(offset + length)) {
+        return nullptr;
+    }
+    return it->second.data() + offset;
+}
 
 void GL::finish(void) {
 }
@@ -197,6 +240,25 @@ void GL::deleteVertexArrays(GLsizei n, const GLuint *arrays) {
 void GL::genVertexArrays(GLsizei n, GLuint *arrays) {
 }
 
+void GL::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+}
+GLuint GL::getUniformBlockIndex(GLuint program, const GLchar *uniformBlockName) {
+    return GL_INVALID_INDEX;
+}
+void GL::uniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+}
+
+void GL::genQueries(GLsizei n, GLuint *ids) {
+}
+void GL::deleteQueries(GLsizei n, const GLuint *ids) {
+}
+void GL::beginQuery(GLenum target, GLuint id) {
+}
+void GL::endQuery(GLenum target) {
+}
+void GL::getQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) {
+}
+
 // Framebuffer
 void GL::bindFramebuffer(GLenum target, GLuint framebuffer) {
 }
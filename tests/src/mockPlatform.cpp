@@ -5,6 +5,8 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cmath>
 
 #include <libgen.h>
 
@@ -31,32 +33,201 @@ std::vector<FontSourceHandle> MockPlatform::systemFontFallbacksHandle() const {
     return handles;
 }
 
-UrlRequestHandle MockPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+MockPlatform::NetworkProfile MockPlatform::NetworkProfile::mobile3G() {
+    NetworkProfile profile;
+    profile.latencyMs = 300;
+    profile.jitterMs = 100;
+    profile.bytesPerSecond = 750 * 1000 / 8;
+    profile.errorRate = 0.01f;
+    profile.maxConnections = 6;
+    return profile;
+}
+
+MockPlatform::NetworkProfile MockPlatform::NetworkProfile::lte() {
+    NetworkProfile profile;
+    profile.latencyMs = 70;
+    profile.jitterMs = 20;
+    profile.bytesPerSecond = 9 * 1000 * 1000 / 8;
+    profile.errorRate = 0.001f;
+    profile.maxConnections = 6;
+    return profile;
+}
+
+MockPlatform::~MockPlatform() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    if (m_network.joinable()) { m_network.join(); }
+}
+
+UrlResponse MockPlatform::respond(const Url& _url) const {
 
     UrlResponse response;
 
     auto it = m_files.find(_url);
     if (it != m_files.end()) {
         response.content = it->second;
+    } else if (m_hasFallback) {
+        response.content = m_fallback;
     } else {
         response.error = "Url contents could not be found!";
     }
 
-    _callback(response);
+    return response;
+}
+
+UrlRequestHandle MockPlatform::startUrlRequest(Url _url, UrlCallback _callback) {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_simulate) {
+        UrlResponse response = respond(_url);
+        lock.unlock();
+
+        _callback(response);
+        return 0;
+    }
+
+    Request request{ ++m_requestCount, std::move(_callback), respond(_url), {} };
+    UrlRequestHandle handle = request.handle;
 
-    return 0;
+    if (m_profile.maxConnections == 0 || m_active.size() < m_profile.maxConnections) {
+        connect(request, Clock::now());
+        m_active.push_back(std::move(request));
+        lock.unlock();
+        m_condition.notify_all();
+    } else {
+        m_queued.push_back(std::move(request));
+    }
+
+    return handle;
 }
 
-void MockPlatform::cancelUrlRequest(UrlRequestHandle _request) {}
+void MockPlatform::cancelUrlRequest(UrlRequestHandle _request) {
+
+    UrlCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto matches = [&](const Request& _r) { return _r.handle == _request; };
+
+        auto queued = std::find_if(m_queued.begin(), m_queued.end(), matches);
+        if (queued != m_queued.end()) {
+            callback = std::move(queued->callback);
+            m_queued.erase(queued);
+        }
+        // The transfer keeps its share of the link, like a request which the
+        // host already started to send
+        auto active = std::find_if(m_active.begin(), m_active.end(), matches);
+        if (active != m_active.end()) {
+            callback = std::move(active->callback);
+            m_active.erase(active);
+        }
+    }
+    m_condition.notify_all();
+
+    if (callback) {
+        UrlResponse response;
+        response.error = "Request cancelled";
+        callback(response);
+    }
+}
+
+void MockPlatform::connect(Request& _request, Clock::time_point _now) {
+
+    double latency = m_profile.latencyMs;
+    if (m_profile.jitterMs > 0 && latency > 0) {
+        // Parameters of the log-normal distribution with this mean and deviation
+        double variance = std::log(1.0 + std::pow(m_profile.jitterMs / latency, 2));
+        std::lognormal_distribution<double> distribution(std::log(latency) - variance / 2,
+                                                         std::sqrt(variance));
+        latency = distribution(m_random);
+    }
+    auto firstByte = _now + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(latency));
+
+    if (std::uniform_real_distribution<float>(0, 1)(m_random) < m_profile.errorRate) {
+        _request.response = UrlResponse();
+        _request.response.error = "Simulated network error";
+        _request.done = firstByte;
+        return;
+    }
+
+    // Transfers over the link one after another, in the order they start
+    _request.done = firstByte;
+    if (m_profile.bytesPerSecond > 0) {
+        auto transfer = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(_request.response.content.size() / m_profile.bytesPerSecond));
+        _request.done = std::max(firstByte, m_linkFree) + transfer;
+        m_linkFree = _request.done;
+    }
+    _request.response.status = _request.response.error ? 404 : 200;
+}
+
+void MockPlatform::runNetwork() {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_stop) {
+        if (m_active.empty()) {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        auto next = std::min_element(m_active.begin(), m_active.end(),
+                                     [](auto& _a, auto& _b) { return _a.done < _b.done; });
+        auto now = Clock::now();
+        if (next->done > now) {
+            m_condition.wait_until(lock, next->done);
+            continue;
+        }
+
+        Request request = std::move(*next);
+        m_active.erase(next);
+
+        // The freed connection goes to the oldest waiting request
+        if (!m_queued.empty()) {
+            connect(m_queued.front(), now);
+            m_active.push_back(std::move(m_queued.front()));
+            m_queued.pop_front();
+        }
+
+        lock.unlock();
+        request.callback(std::move(request.response));
+        lock.lock();
+    }
+}
 
 void MockPlatform::putMockUrlContents(Url url, std::string contents) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_files[url].assign(contents.begin(), contents.end());
 }
 
 void MockPlatform::putMockUrlContents(Url url, std::vector<char> contents) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_files[url] = contents;
 }
 
+void MockPlatform::putMockUrlFallback(std::vector<char> contents) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fallback = std::move(contents);
+    m_hasFallback = true;
+}
+
+void MockPlatform::setNetworkProfile(const NetworkProfile& _profile) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_profile = _profile;
+        m_random.seed(_profile.seed);
+        m_simulate = true;
+    }
+    if (!m_network.joinable()) {
+        m_network = std::thread(&MockPlatform::runNetwork, this);
+    }
+}
+
 std::vector<char> MockPlatform::getBytesFromFile(const char* path) {
     std::vector<char> result;
     auto allocator = [&](size_t size) {
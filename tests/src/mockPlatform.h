@@ -2,6 +2,12 @@
 
 #include "platform.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <unordered_map>
 
 namespace Tangram {
@@ -10,6 +16,31 @@ class MockPlatform : public Platform {
 
 public:
 
+    // Conditions of the simulated network between the platform and the
+    // hosts of the mock URL contents
+    struct NetworkProfile {
+        // Mean time until the first byte of a response arrives, and its
+        // standard deviation. Latencies are log-normal distributed, so that
+        // a few responses take much longer than most.
+        float latencyMs = 0;
+        float jitterMs = 0;
+        // Bytes per second shared by all connections, 0 for no limit
+        double bytesPerSecond = 0;
+        // Share of the requests which fail after their latency
+        float errorRate = 0;
+        // Requests in flight at once, the others wait for a free connection.
+        // 0 for no limit.
+        size_t maxConnections = 0;
+        // Seed of the random latencies and failures
+        uint32_t seed = 0;
+
+        // 'Regular 3G' and 'Good 4G' as throttled by browser dev tools
+        static NetworkProfile mobile3G();
+        static NetworkProfile lte();
+    };
+
+    ~MockPlatform() override;
+
     void requestRender() const override;
     std::vector<FontSourceHandle> systemFontFallbacksHandle() const override;
     UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override;
@@ -19,13 +50,54 @@ public:
     void putMockUrlContents(Url url, std::string contents);
     void putMockUrlContents(Url url, std::vector<char> contents);
 
+    // Content for the URLs without mock contents, instead of an error
+    void putMockUrlFallback(std::vector<char> contents);
+
+    // Deliver the responses on a network thread, after the delays of
+    // _profile. Without a profile startUrlRequest responds right away.
+    void setNetworkProfile(const NetworkProfile& _profile);
 
     // Get the contents of a local file (not mock URL contents).
     static std::vector<char> getBytesFromFile(const char* path);
 
 private:
 
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        UrlRequestHandle handle;
+        UrlCallback callback;
+        UrlResponse response;
+        Clock::time_point done;
+    };
+
+    // Content of _url, or an error. Must be called with m_mutex held.
+    UrlResponse respond(const Url& _url) const;
+
+    // Takes a connection for _request and schedules its response
+    void connect(Request& _request, Clock::time_point _now);
+
+    void runNetwork();
+
     std::unordered_map<Url, std::vector<char>> m_files;
+    std::vector<char> m_fallback;
+    bool m_hasFallback = false;
+
+    NetworkProfile m_profile;
+    bool m_simulate = false;
+    std::mt19937 m_random;
+
+    // Requests waiting for a connection, and those in flight
+    std::deque<Request> m_queued;
+    std::vector<Request> m_active;
+    // When the link finishes the transfers scheduled so far
+    Clock::time_point m_linkFree;
+    UrlRequestHandle m_requestCount = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_network;
+    bool m_stop = false;
 
 };
 
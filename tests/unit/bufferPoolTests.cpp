@@ -0,0 +1,70 @@
+#include "catch.hpp"
+
+#include "gl/bufferPool.h"
+
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+using FreeList = BufferPool::FreeList;
+
+TEST_CASE("FreeList allocates aligned ranges and coalesces released ones", "[BufferPool]") {
+
+    FreeList list(1000);
+
+    auto a = list.allocate(100, 12);
+    auto b = list.allocate(100, 12);
+    auto c = list.allocate(100, 12);
+
+    REQUIRE(a == 0);
+    REQUIRE(b == 108);
+    REQUIRE(c == 216);
+    REQUIRE(list.available() == 700);
+
+    // Too large for the remaining space
+    REQUIRE(list.allocate(800, 1) == -1);
+
+    list.release(b, 100);
+    // First fit reuses the gap
+    REQUIRE(list.allocate(50, 4) == 100);
+    list.release(100, 50);
+
+    list.release(a, 100);
+    list.release(c, 100);
+    REQUIRE(list.empty());
+
+    // All ranges merged back into one
+    REQUIRE(list.allocate(1000, 1) == 0);
+}
+
+TEST_CASE("FreeList does not hand out overlapping ranges", "[BufferPool]") {
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> size(1, 64);
+
+    FreeList list(4096);
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    for (int i = 0; i < 2000; i++) {
+        if (!ranges.empty() && (i % 3 == 0)) {
+            size_t n = rng() % ranges.size();
+            list.release(ranges[n].first, ranges[n].second);
+            ranges.erase(ranges.begin() + n);
+            continue;
+        }
+        size_t s = size(rng);
+        auto offset = list.allocate(s, 4);
+        if (offset < 0) { continue; }
+
+        REQUIRE((offset % 4) == 0);
+        REQUIRE((size_t(offset) + s) <= list.size());
+        for (auto& r : ranges) {
+            REQUIRE((size_t(offset) + s <= r.first || r.first + r.second <= size_t(offset)));
+        }
+        ranges.emplace_back(offset, s);
+    }
+
+    for (auto& r : ranges) { list.release(r.first, r.second); }
+    REQUIRE(list.empty());
+}
@@ -0,0 +1,53 @@
+#include "catch.hpp"
+
+#include "tile/buildCost.h"
+
+using namespace Tangram;
+
+TEST_CASE("BuildCostAccounting sums tallies by name", "[BuildCost]") {
+
+    BuildCostAccounting costs;
+
+    BuildCostAccounting::Tally tally;
+    tally.layers = { { "roads", 2.0, 10, 8 }, { "water", 1.0, 3, 3 }, { "unused", 0, 0, 0 } };
+    tally.styles = { { "lines", 1.5, 8, 0, 400, 8000 } };
+
+    costs.merge(tally);
+    tally.layers[1].milliseconds = 4.0;
+    costs.merge(tally);
+
+    auto stats = costs.stats(true);
+    REQUIRE(stats.tiles == 2);
+
+    // Sorted by time, layers without features are left out
+    REQUIRE(stats.layers.size() == 2);
+    REQUIRE(stats.layers[0].name == "water");
+    REQUIRE(stats.layers[0].milliseconds == Approx(5.0));
+    REQUIRE(stats.layers[1].features == 20);
+    REQUIRE(stats.layers[1].matched == 16);
+
+    REQUIRE(stats.styles.size() == 1);
+    REQUIRE(stats.styles[0].vertices == 800);
+    REQUIRE(stats.styles[0].bytes == 16000);
+
+    REQUIRE(costs.stats().tiles == 0);
+}
+
+TEST_CASE("BuildCostAccounting counts culled features of styles", "[BuildCost]") {
+
+    BuildCostAccounting costs;
+
+    BuildCostAccounting::Tally tally;
+    tally.styles = { { "polygons", 0, 0, 0, 0, 0, 12 }, { "lines", 0.5, 4, 0, 80, 1600, 3 } };
+
+    costs.merge(tally);
+    costs.merge(tally);
+
+    // Styles that culled all their features are kept
+    auto stats = costs.stats();
+    REQUIRE(stats.styles.size() == 2);
+    REQUIRE(stats.styles[0].name == "lines");
+    REQUIRE(stats.styles[0].culled == 6);
+    REQUIRE(stats.styles[1].name == "polygons");
+    REQUIRE(stats.styles[1].culled == 24);
+}
@@ -0,0 +1,45 @@
+#include "catch.hpp"
+
+#include "util/byteBuffer.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace Tangram;
+
+TEST_CASE("ByteBuffer takes the memory of a vector", "[ByteBuffer]") {
+    std::vector<char> bytes = { 'a', 'b', 'c', 'd' };
+    const char* memory = bytes.data();
+
+    ByteBuffer buffer(std::move(bytes));
+    REQUIRE(buffer.data() == memory);
+    REQUIRE(buffer.size() == 4);
+
+    // Copies and slices share the bytes
+    ByteBuffer copy = buffer;
+    buffer.reset();
+    REQUIRE(buffer.empty());
+    REQUIRE(copy.data() == memory);
+
+    auto slice = copy.slice(1, 10);
+    copy.reset();
+    REQUIRE(slice.size() == 3);
+    REQUIRE(std::memcmp(slice.data(), "bcd", 3) == 0);
+}
+
+TEST_CASE("ByteBuffer maps files", "[ByteBuffer]") {
+    const char* path = "byteBufferTest.bin";
+
+    FILE* file = fopen(path, "wb");
+    REQUIRE(file);
+    fwrite("tile data", 1, 9, file);
+    fclose(file);
+
+    auto buffer = ByteBuffer::mapFile(path);
+    // Mapped pages stay valid after the file is removed
+    remove(path);
+    REQUIRE(buffer.size() == 9);
+    REQUIRE(std::memcmp(buffer.data(), "tile data", 9) == 0);
+
+    REQUIRE(ByteBuffer::mapFile(path).empty());
+}
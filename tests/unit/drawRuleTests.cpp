@@ -1,7 +1,10 @@
 #include "catch.hpp"
 
+#include "data/tileData.h"
 #include "scene/drawRule.h"
 #include "scene/sceneLayer.h"
+#include "scene/stops.h"
+#include "scene/styleContext.h"
 #include "platform.h"
 
 #include <cstdio>
@@ -205,3 +208,105 @@ TEST_CASE("DrawRule correctly reports that it doesn't contain a parameter", "[Dr
 
 
 }
+
+TEST_CASE("DrawRuleMergeSet evaluates Stops once per zoom", "[DrawRule]") {
+    Stops stops({ Stops::Frame(10, 1.f), Stops::Frame(20, 2.f) });
+
+    DrawRuleData data = { "dg1", dg1, { StyleParam(StyleParamKey::order, &stops) } };
+    REQUIRE(data.parameters[0].isZoomDependent());
+
+    DrawRuleMergeSet set;
+    StyleContext ctx;
+    ctx.setKeywordZoom(15);
+
+    DrawRule rule1(data, "layer", 0);
+    REQUIRE(set.evaluateRuleForContext(rule1, ctx));
+    auto* evaluated = &rule1.findParameter(StyleParamKey::order);
+    REQUIRE(evaluated != &data.parameters[0]);
+    REQUIRE(evaluated->value.get<float>() == Approx(1.5f));
+
+    // Features at the same zoom share the evaluated parameter
+    DrawRule rule2(data, "layer", 0);
+    REQUIRE(set.evaluateRuleForContext(rule2, ctx));
+    REQUIRE(&rule2.findParameter(StyleParamKey::order) == evaluated);
+
+    ctx.setKeywordZoom(20);
+    DrawRule rule3(data, "layer", 0);
+    REQUIRE(set.evaluateRuleForContext(rule3, ctx));
+    REQUIRE(rule3.findParameter(StyleParamKey::order).value.get<float>() == Approx(2.f));
+}
+
+TEST_CASE("DrawRule tracks the parameters that are evaluated per feature", "[DrawRule]") {
+    Stops stops({ Stops::Frame(10, 1.f), Stops::Frame(20, 2.f) });
+
+    DrawRuleData dynamicData = { "dg1", dg1, { StyleParam(StyleParamKey::width, &stops),
+                                               { StyleParamKey::color, "value_1a" } } };
+    DrawRuleData staticData = { "dg1", dg1, { { StyleParamKey::width, "value_2b" } } };
+
+    auto width = static_cast<uint8_t>(StyleParamKey::width);
+    auto color = static_cast<uint8_t>(StyleParamKey::color);
+    REQUIRE(dynamicData.keys.count() == 2);
+    REQUIRE(dynamicData.dynamicKeys.count() == 1);
+    REQUIRE(dynamicData.dynamicKeys[width]);
+
+    const SceneLayer layer_a = { "a", Filter(), { dynamicData }, {}, true };
+    const SceneLayer layer_b = { "b", Filter(), { staticData }, {}, true };
+
+    DrawRuleMergeSet set;
+    set.mergeRules(layer_a);
+    auto& rule = set.matchedRules()[0];
+    REQUIRE(rule.dynamic[width]);
+
+    // The static width of layer 'b' wins
+    set.mergeRules(layer_b);
+    REQUIRE(rule.active[width]);
+    REQUIRE(rule.active[color]);
+    REQUIRE(!rule.dynamic[width]);
+
+    StyleContext ctx;
+    ctx.setKeywordZoom(15);
+    REQUIRE(set.evaluateRuleForContext(rule, ctx));
+    REQUIRE(rule.findParameter(StyleParamKey::width).value.get<std::string>() == "value_2b");
+    REQUIRE(rule.findParameter(StyleParamKey::color).value.get<std::string>() == "value_1a");
+}
+
+TEST_CASE("DrawRuleMergeSet caches matched rules by filter inputs", "[DrawRule]") {
+    const SceneLayer layer = { "roads", Filter(), {},
+                               { { "residential", Filter::MatchEquality("kind", { Value("residential") }),
+                                   { instance_a() }, {}, true } },
+                               true };
+
+    DrawRuleMergeSet set;
+    StyleContext ctx;
+    ctx.setKeywordZoom(10);
+
+    Feature feat1;
+    feat1.props.set("kind", "residential");
+    feat1.props.set("name", "a");
+
+    REQUIRE(set.match(feat1, layer, ctx));
+    REQUIRE(set.matchedRules().size() == 1);
+    REQUIRE(set.matchCacheHits() == 0);
+    REQUIRE(set.matchCacheMisses() == 1);
+
+    // Properties that no filter reads do not change the result
+    Feature feat2;
+    feat2.props.set("kind", "residential");
+    feat2.props.set("name", "b");
+
+    REQUIRE(set.match(feat2, layer, ctx));
+    REQUIRE(set.matchedRules().size() == 1);
+    REQUIRE(set.matchCacheHits() == 1);
+
+    Feature feat3;
+    feat3.props.set("kind", "highway");
+
+    REQUIRE(set.match(feat3, layer, ctx));
+    REQUIRE(set.matchedRules().empty());
+    REQUIRE(set.matchCacheMisses() == 2);
+
+    ctx.setKeywordZoom(11);
+    REQUIRE(set.match(feat1, layer, ctx));
+    REQUIRE(set.matchedRules().size() == 1);
+    REQUIRE(set.matchCacheMisses() == 3);
+}
@@ -388,3 +388,157 @@ TEST_CASE( "Test evalFunction explicit", "[Duktape][evalFunction]") {
     }
 
 }
+
+TEST_CASE( "Test analyzeFunction finds function inputs", "[Duktape][memo]") {
+    auto inputs = StyleContext::analyzeFunction(
+        R"(function() { return feature.kind === 'park' && feature['name:en'] && $zoom > 10; })");
+
+    REQUIRE(inputs.memoizable);
+    REQUIRE(inputs.zoom);
+    REQUIRE(!inputs.geometry);
+    REQUIRE(inputs.properties.size() == 2);
+    REQUIRE(inputs.properties[0].name() == "kind");
+    REQUIRE(inputs.properties[1].name() == "name:en");
+
+    REQUIRE(!StyleContext::analyzeFunction(R"(function() { return 'kind' in feature; })").memoizable);
+    REQUIRE(!StyleContext::analyzeFunction(R"(function() { var k = 'a'; return feature[k]; })").memoizable);
+    REQUIRE(!StyleContext::analyzeFunction(R"(function() { return Math.random() > 0.5; })").memoizable);
+}
+
+TEST_CASE( "Test evalFilter memoizes results by function inputs", "[Duktape][memo]") {
+    Feature feat1;
+    feat1.props.set("kind", "park");
+    feat1.props.set("name", "a");
+
+    Feature feat2;
+    feat2.props.set("kind", "park");
+    feat2.props.set("name", "b");
+
+    Feature feat3;
+    feat3.props.set("kind", "forest");
+
+    StyleContext ctx;
+    ctx.setKeyword("$zoom", 10);
+    REQUIRE(ctx.setFunctions({ R"(function() { return feature.kind === 'park' && $zoom > 9; })"}));
+
+    ctx.setFeature(feat1);
+    REQUIRE(ctx.evalFilter(0) == true);
+    REQUIRE(ctx.memoHits() == 0);
+
+    // Same inputs, other properties differ
+    ctx.setFeature(feat2);
+    REQUIRE(ctx.evalFilter(0) == true);
+    REQUIRE(ctx.memoHits() == 1);
+
+    ctx.setFeature(feat3);
+    REQUIRE(ctx.evalFilter(0) == false);
+    REQUIRE(ctx.memoHits() == 1);
+
+    ctx.setKeyword("$zoom", 9);
+    ctx.setFeature(feat1);
+    REQUIRE(ctx.evalFilter(0) == false);
+    REQUIRE(ctx.memoHits() == 1);
+}
+
+TEST_CASE( "Test simple functions are evaluated natively", "[Duktape][native]") {
+    Feature feat;
+    feat.props.set("kind", "park");
+    feat.props.set("height", 12);
+
+    StyleContext ctx;
+    ctx.setKeyword("$zoom", 10);
+    ctx.setFeature(feat);
+
+    REQUIRE(ctx.setFunctions({
+                R"(function() { return feature.height * 2; })",
+                R"(function() { return feature.kind === 'park' ? '#0f0' : '#f00'; })",
+                R"(function() { return feature.kind == 'park' && $zoom >= 10; })",
+                R"(function() { return Math.max(feature.height, 20); })",
+                R"(function() { return feature.height / 5 + 'px'; })" }));
+
+    REQUIRE(ctx.isNativeFunction(0));
+    REQUIRE(ctx.isNativeFunction(1));
+    REQUIRE(ctx.isNativeFunction(2));
+    REQUIRE(!ctx.isNativeFunction(3));
+    REQUIRE(ctx.isNativeFunction(4));
+
+    StyleParam::Value value;
+
+    REQUIRE(ctx.evalStyle(0, StyleParamKey::width, value));
+    REQUIRE(value.is<StyleParam::Width>());
+    REQUIRE(value.get<StyleParam::Width>().value == 24);
+
+    REQUIRE(ctx.evalStyle(1, StyleParamKey::color, value));
+    REQUIRE(value.is<uint32_t>());
+    REQUIRE(value.get<uint32_t>() == 0xff00ff00);
+
+    REQUIRE(ctx.evalFilter(2) == true);
+    REQUIRE(ctx.evalStyle(3, StyleParamKey::width, value));
+    REQUIRE(value.get<StyleParam::Width>().value == 20);
+
+    // Formatting 2.4 as string falls back to duktape
+    REQUIRE(ctx.evalStyle(4, StyleParamKey::width, value));
+    REQUIRE(value.is<StyleParam::Width>());
+}
+
+TEST_CASE( "Test functions loaded from scene bytecode", "[Duktape][initFunctions]") {
+    Scene scene1(std::make_shared<MockPlatform>(), Url());
+    scene1.addJsFunction(R"(function() { return Math.max(feature.a, 2); })");
+    scene1.addJsFunction(R"(function() { return this is not a function; })");
+
+    auto& bytecode = scene1.compiledFunctions().bytecode;
+    REQUIRE(bytecode.size() == 2);
+    REQUIRE(!bytecode[0].empty());
+    REQUIRE(bytecode[1].empty());
+    // Compiled only once
+    REQUIRE(&scene1.compiledFunctions().bytecode == &bytecode);
+
+    Feature feat;
+    feat.props.set("a", 5);
+
+    StyleContext ctx;
+    ctx.initFunctions(scene1);
+    ctx.setFeature(feat);
+
+    StyleParam::Value value;
+    REQUIRE(ctx.evalStyle(0, StyleParamKey::width, value) == true);
+    REQUIRE(value.get<StyleParam::Width>().value == 5.f);
+
+    // Switching scenes reuses the context
+    Scene scene2(std::make_shared<MockPlatform>(), Url());
+    scene2.addJsFunction(R"(function() { return Math.min(feature.a, 2); })");
+
+    ctx.initFunctions(scene2);
+    ctx.setFeature(feat);
+    REQUIRE(ctx.evalStyle(0, StyleParamKey::width, value) == true);
+    REQUIRE(value.get<StyleParam::Width>().value == 2.f);
+}
+
+TEST_CASE( "Test JS functions share property lookups of a feature", "[Duktape][evalFunction]") {
+    StyleContext ctx;
+    REQUIRE(ctx.setFunctions({
+                R"(function() { return ('js_shared_a' in feature) && !('js_shared_b' in feature); })",
+                R"(function() { return feature['js_shared_' + 'b'] === 'B'; })"}));
+    REQUIRE(!ctx.isNativeFunction(0));
+    REQUIRE(!ctx.isNativeFunction(1));
+
+    Feature first;
+    first.props.set("js_shared_a", 1);
+    ctx.setFeature(first);
+    REQUIRE(ctx.evalFilter(0) == true);
+    REQUIRE(ctx.evalFilter(1) == false);
+
+    // A property name that had no key yet is found once a feature sets it
+    Feature second;
+    second.props.set("js_shared_a", 1);
+    second.props.set("js_shared_b", "B");
+    ctx.setFeature(second);
+    REQUIRE(ctx.evalFilter(0) == false);
+    REQUIRE(ctx.evalFilter(1) == true);
+
+    // Functions added later are called like the others
+    REQUIRE(ctx.addFunction(R"(function() { return Math.max(feature.js_shared_a + 1, 0); })"));
+    StyleParam::Value value;
+    REQUIRE(ctx.evalStyle(2, StyleParamKey::order, value));
+    REQUIRE(value.get<uint32_t>() == 2);
+}
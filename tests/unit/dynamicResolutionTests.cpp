@@ -0,0 +1,48 @@
+#include "catch.hpp"
+
+#include "util/dynamicResolution.h"
+
+using namespace Tangram;
+
+TEST_CASE("DynamicResolution lowers the scale of slow frames while moving", "[DynamicResolution]") {
+
+    DynamicResolution resolution;
+
+    // Disabled by default
+    REQUIRE(resolution.update(50.f, true) == 1.f);
+
+    resolution.setLimits(0.5f, 16.f);
+
+    // Each step is held for a few frames
+    for (int i = 0; i < DynamicResolution::holdFrames - 1; i++) {
+        REQUIRE(resolution.update(40.f, true) == 1.f);
+    }
+    REQUIRE(resolution.update(40.f, true) == 1.f - DynamicResolution::step);
+
+    // Never below the minimum scale
+    for (int i = 0; i < 100; i++) { resolution.update(40.f, true); }
+    REQUIRE(resolution.scale() == 0.5f);
+
+    // Full resolution as soon as the view stops
+    REQUIRE(resolution.update(40.f, false) == 1.f);
+}
+
+TEST_CASE("DynamicResolution raises the scale of fast frames", "[DynamicResolution]") {
+
+    DynamicResolution resolution;
+    resolution.setLimits(0.25f, 16.f);
+
+    for (int i = 0; i < 100; i++) { resolution.update(40.f, true); }
+    REQUIRE(resolution.scale() == 0.25f);
+
+    // Frames within the target keep their scale
+    for (int i = 0; i < 100; i++) { resolution.update(15.f, true); }
+    REQUIRE(resolution.scale() == 0.25f);
+
+    for (int i = 0; i < 100; i++) { resolution.update(8.f, true); }
+    REQUIRE(resolution.scale() == 1.f);
+
+    // Pauses are not frame times
+    for (int i = 0; i < 100; i++) { resolution.update(1000.f, true); }
+    REQUIRE(resolution.scale() == 1.f);
+}
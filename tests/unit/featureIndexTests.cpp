@@ -0,0 +1,57 @@
+#include "catch.hpp"
+
+#include "selection/featureIndex.h"
+
+using namespace Tangram;
+
+static Feature square(glm::vec2 _min, glm::vec2 _max) {
+    Feature feature;
+    feature.geometryType = GeometryType::polygons;
+    feature.polygons.push_back({{ _min, { _max.x, _min.y }, _max, { _min.x, _max.y } }});
+    return feature;
+}
+
+TEST_CASE("FeatureIndex finds the feature drawn on top", "[FeatureIndex]") {
+
+    FeatureIndex index;
+
+    Feature line;
+    line.geometryType = GeometryType::lines;
+    line.lines.push_back({{ 0.1f, 0.5f }, { 0.9f, 0.5f }});
+
+    index.add(square({ 0.f, 0.f }, { 1.f, 1.f }), 1, 0);
+    index.add(line, 2, 10);
+    index.add(square({ 0.2f, 0.2f }, { 0.4f, 0.4f }), 3, 0);
+    index.build();
+
+    REQUIRE(index.query({ 0.8f, 0.8f }, 0.f).color == 1);
+    // Same order, added later
+    REQUIRE(index.query({ 0.3f, 0.3f }, 0.f).color == 3);
+    // Higher order
+    REQUIRE(index.query({ 0.5f, 0.51f }, 0.02f).color == 2);
+    REQUIRE(index.query({ 0.5f, 0.51f }, 0.f).color == 1);
+    REQUIRE(index.query({ 1.5f, 0.5f }, 0.1f).color == 0);
+}
+
+TEST_CASE("FeatureIndex queries many features", "[FeatureIndex]") {
+
+    FeatureIndex index;
+
+    // A grid of 40x40 squares, more than fit in a few levels of nodes
+    for (int y = 0; y < 40; y++) {
+        for (int x = 0; x < 40; x++) {
+            glm::vec2 min(x / 40.f, y / 40.f);
+            index.add(square(min, min + 0.02f), 1 + y * 40 + x, 0);
+        }
+    }
+    index.build();
+
+    for (int y = 0; y < 40; y++) {
+        for (int x = 0; x < 40; x++) {
+            glm::vec2 center(x / 40.f + 0.01f, y / 40.f + 0.01f);
+            REQUIRE(index.query(center, 0.f).color == uint32_t(1 + y * 40 + x));
+            // Between the squares
+            REQUIRE(index.query(center + 0.0125f, 0.f).color == 0);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#include "catch.hpp"
+
+#include "selection/featureStates.h"
+
+using namespace Tangram;
+
+TEST_CASE("FeatureStates fill the uniform tables of their features", "[FeatureStates]") {
+
+    FeatureStates states;
+    REQUIRE(states.size() == 0);
+    uint32_t version = states.version();
+
+    FeatureState highlight;
+    highlight.color = 0xff8000;
+    highlight.alpha = .5f;
+    highlight.offset = {{0.f, -4.f}};
+
+    REQUIRE(states.set(0x04030201, highlight));
+    REQUIRE(!states.set(0, highlight));
+    REQUIRE(states.version() != version);
+
+    UniformArray4f ids, values;
+    REQUIRE(states.uniforms(ids, values) == 1);
+    REQUIRE(ids.size() == FeatureStates::maxStates);
+    REQUIRE(ids[0].x == Approx(1.f / 255.f));
+    REQUIRE(ids[0].w == Approx(4.f / 255.f));
+    REQUIRE(values[0].x == float(0xff8000));
+    REQUIRE(values[0].y == .5f);
+    REQUIRE(values[0].w == -4.f);
+
+    // Keeping the color
+    REQUIRE(states.set(0x04030201, FeatureState()));
+    states.uniforms(ids, values);
+    REQUIRE(values[0].x == -1.f);
+
+    REQUIRE(states.clear(0x04030201));
+    REQUIRE(!states.clear(0x04030201));
+    REQUIRE(states.uniforms(ids, values) == 0);
+}
+
+TEST_CASE("FeatureStates are limited to the size of the table", "[FeatureStates]") {
+
+    FeatureStates states;
+    for (uint32_t id = 1; id <= FeatureStates::maxStates; id++) {
+        REQUIRE(states.set(id, FeatureState()));
+    }
+    REQUIRE(!states.set(FeatureStates::maxStates + 1, FeatureState()));
+
+    // Existing states can still change
+    REQUIRE(states.set(1, FeatureState()));
+
+    states.clearAll();
+    REQUIRE(states.size() == 0);
+    REQUIRE(states.set(FeatureStates::maxStates + 1, FeatureState()));
+}
@@ -0,0 +1,46 @@
+#include "catch.hpp"
+
+#include "util/framePacer.h"
+
+using namespace Tangram;
+
+using Clock = FramePacer::Clock;
+
+static Clock::time_point after(Clock::time_point _time, float _milliseconds) {
+    return _time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(_milliseconds));
+}
+
+TEST_CASE("FramePacer gives steps the time left until the deadline", "[FramePacer]") {
+
+    FramePacer pacer;
+    REQUIRE(!pacer.paced());
+
+    auto start = Clock::now();
+    pacer.beginFrame(start, 16.f);
+    REQUIRE(pacer.paced());
+
+    REQUIRE(pacer.budget(start, 0.f) == Approx(16.f).epsilon(0.001));
+    REQUIRE(pacer.budget(start, 6.f) == Approx(10.f).epsilon(0.001));
+    REQUIRE(pacer.budget(after(start, 12.f), 0.f) == Approx(4.f).epsilon(0.001));
+
+    // Work past the deadline still progresses
+    REQUIRE(pacer.budget(after(start, 20.f), 0.f) == FramePacer::minBudget);
+    REQUIRE(pacer.budget(start, 30.f) == FramePacer::minBudget);
+
+    pacer.endFrame();
+    REQUIRE(!pacer.paced());
+}
+
+TEST_CASE("FramePacer converts upload time to bytes", "[FramePacer]") {
+
+    FramePacer pacer;
+    REQUIRE(pacer.uploadBytes(4.f) == 0);
+
+    // Too small to measure
+    pacer.addUpload(1000, 1.f);
+    REQUIRE(pacer.uploadBytes(4.f) == 0);
+
+    pacer.addUpload(1024 * 1024, 2.f);
+    REQUIRE(pacer.uploadBytes(4.f) == 2 * 1024 * 1024);
+    REQUIRE(pacer.uploadBytes(0.f) == 1);
+}
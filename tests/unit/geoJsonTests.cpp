@@ -0,0 +1,139 @@
+#include "catch.hpp"
+
+#include "data/featureFilter.h"
+#include "data/formats/geoJson.h"
+#include "util/mapProjection.h"
+
+#include <string>
+
+using namespace Tangram;
+
+// Members out of GeoJSON order, nested and unsupported values are skipped
+static const std::string s_layers = R"({
+    "roads": {
+        "features": [
+            { "type": "Feature",
+              "geometry": { "coordinates": [[-74.01, 40.70], [-74.00, 40.71], [-73.99, 40.70]],
+                            "type": "LineString" },
+              "properties": { "kind": "major_road", "min_zoom": 12, "oneway": true,
+                              "tags": { "a": 1 }, "refs": [1, 2], "none": null } },
+            { "type": "Feature",
+              "properties": {},
+              "geometry": { "type": "MultiLineString",
+                            "coordinates": [[[-74.01, 40.70], [-74.00, 40.71]], [[-73.99, 40.70], [-73.98, 40.71]]] } }
+        ],
+        "type": "FeatureCollection"
+    },
+    "pois": {
+        "type": "FeatureCollection",
+        "crs": { "type": "name" },
+        "features": [
+            { "type": "Feature", "properties": { "name": "a" },
+              "geometry": { "type": "Point", "coordinates": [-74.00, 40.70, 10] } },
+            { "type": "Feature", "properties": { "name": "b" },
+              "geometry": { "type": "MultiPoint", "coordinates": [[-74.00, 40.70], [-74.01, 40.71]] } }
+        ]
+    },
+    "buildings": {
+        "type": "FeatureCollection",
+        "features": [
+            { "type": "Feature", "properties": { "height": 20.5 },
+              "geometry": { "type": "Polygon",
+                            "coordinates": [[[-74.01, 40.70], [-74.00, 40.70], [-74.00, 40.71], [-74.01, 40.70]]] } },
+            { "type": "Feature", "properties": {},
+              "geometry": { "type": "MultiPolygon",
+                            "coordinates": [[[[-74.01, 40.70], [-74.00, 40.70], [-74.00, 40.71], [-74.01, 40.70]]],
+                                            [[[-73.99, 40.70], [-73.98, 40.70], [-73.98, 40.71], [-73.99, 40.70]],
+                                             [[-73.985, 40.702], [-73.984, 40.702], [-73.984, 40.703], [-73.985, 40.702]]]] } }
+        ]
+    },
+    "other": { "type": "Topology", "features": [] }
+})";
+
+TEST_CASE("GeoJSON tiles are parsed like the document walk", "[GeoJson]") {
+
+    MercatorProjection projection;
+    TileID tileId(4823, 6160, 14);
+    int32_t sourceId = 3;
+
+    auto tileData = GeoJson::parseTile(s_layers.data(), s_layers.size(), tileId, projection, sourceId);
+
+    const char* error;
+    size_t offset;
+    auto document = JsonParseBytes(s_layers.data(), s_layers.size(), &error, &offset);
+    REQUIRE(error == nullptr);
+
+    BoundingBox tileBounds(projection.TileBounds(tileId));
+    glm::dvec2 tileOrigin = {tileBounds.min.x, tileBounds.max.y*-1.0};
+    double tileInverseScale = 1.0 / tileBounds.width();
+    auto transform = [&](glm::dvec2 _lonLat) {
+        glm::dvec2 meters = projection.LonLatToMeters(_lonLat);
+        return Point{ (meters.x - tileOrigin.x) * tileInverseScale, (meters.y - tileOrigin.y) * tileInverseScale };
+    };
+
+    REQUIRE(tileData->layers.size() == 3);
+
+    for (auto& layer : tileData->layers) {
+        auto expected = GeoJson::getLayer(document[layer.name.c_str()], transform, sourceId);
+        REQUIRE(layer.features.size() == expected.features.size());
+
+        for (size_t i = 0; i < layer.features.size(); i++) {
+            auto& feature = layer.features[i];
+            auto& expectedFeature = expected.features[i];
+            REQUIRE(feature.geometryType == expectedFeature.geometryType);
+            REQUIRE(feature.points == expectedFeature.points);
+            REQUIRE(feature.lines == expectedFeature.lines);
+            REQUIRE(feature.polygons == expectedFeature.polygons);
+            REQUIRE(feature.props.sourceId == sourceId);
+            REQUIRE(feature.props.items().size() == expectedFeature.props.items().size());
+            for (auto& item : expectedFeature.props.items()) {
+                REQUIRE(feature.props.get(item.key) == item.value);
+            }
+        }
+    }
+
+    auto& roads = tileData->layers[0];
+    REQUIRE(roads.name == "roads");
+    REQUIRE(roads.features[0].props.getString("kind") == "major_road");
+    REQUIRE(roads.features[0].props.getNumber("oneway") == 1);
+    REQUIRE(roads.features[0].props.items().size() == 3);
+    REQUIRE(tileData->layers[2].features[1].polygons[1].size() == 2);
+}
+
+TEST_CASE("GeoJSON tile with a root FeatureCollection has one layer", "[GeoJson]") {
+
+    MercatorProjection projection;
+    std::string json = R"({ "type": "FeatureCollection", "features": [
+        { "type": "Feature", "properties": { "name": "a" },
+          "geometry": { "type": "Point", "coordinates": [0, 0] } } ] })";
+
+    auto tileData = GeoJson::parseTile(json.data(), json.size(), TileID(0, 0, 0), projection, 0);
+    REQUIRE(tileData->layers.size() == 1);
+    REQUIRE(tileData->layers[0].name == "");
+    REQUIRE(tileData->layers[0].features.size() == 1);
+    REQUIRE(tileData->layers[0].features[0].points[0].x == Approx(0.5));
+
+    // Malformed input gives no layers
+    std::string truncated = json.substr(0, json.size() - 4);
+    tileData = GeoJson::parseTile(truncated.data(), truncated.size(), TileID(0, 0, 0), projection, 0);
+    REQUIRE(tileData->layers.empty());
+}
+
+TEST_CASE("GeoJSON parser drops the properties that the filter doesn't keep", "[GeoJson][FeatureFilter]") {
+
+    MercatorProjection projection;
+    FeatureFilter filter;
+    filter.allProperties = false;
+    filter.properties = { "kind", "name" };
+
+    auto tileData = GeoJson::parseTile(s_layers.data(), s_layers.size(), TileID(4823, 6160, 14),
+                                       projection, 0, &filter);
+    REQUIRE(tileData->layers.size() == 3);
+
+    auto& road = tileData->layers[0].features[0];
+    REQUIRE(road.props.items().size() == 1);
+    REQUIRE(road.props.getString("kind") == "major_road");
+    REQUIRE(!road.props.contains("oneway"));
+    REQUIRE(tileData->layers[1].features[0].props.getString("name") == "a");
+    REQUIRE(tileData->layers[2].features[0].props.items().empty());
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+
+#include "data/geometryClipper.h"
+
+using namespace Tangram;
+
+static float ringArea(const Line& _ring) {
+    float area = 0.f;
+    for (size_t i = 0, j = _ring.size() - 1; i < _ring.size(); j = i++) {
+        area += (_ring[j].x - _ring[i].x) * (_ring[j].y + _ring[i].y);
+    }
+    return std::abs(area) * 0.5f;
+}
+
+TEST_CASE("GeometryClipper splits lines at the buffered tile edges", "[GeometryClipper]") {
+
+    GeometryClipper clipper(0.5f);
+
+    // Leaves and re-enters the clip rectangle through the right edge
+    Line line = { {0.f, 0.5f}, {2.f, 0.5f}, {2.f, 0.75f}, {1.f, 0.75f} };
+
+    std::vector<Line> out;
+    clipper.clipLine(line, out);
+
+    REQUIRE(out.size() == 2);
+    REQUIRE(out[0] == Line({ {0.f, 0.5f}, {1.5f, 0.5f} }));
+    REQUIRE(out[1] == Line({ {1.5f, 0.75f}, {1.f, 0.75f} }));
+
+    // Lines inside are kept, lines outside are dropped
+    out.clear();
+    clipper.clipLine({ {0.f, 0.f}, {1.f, 1.f} }, out);
+    clipper.clipLine({ {3.f, 0.f}, {3.f, 1.f} }, out);
+
+    REQUIRE(out.size() == 1);
+    REQUIRE(out[0].size() == 2);
+}
+
+TEST_CASE("GeometryClipper clips rings to the buffered tile", "[GeometryClipper]") {
+
+    GeometryClipper clipper(0.f);
+
+    Line ring = { {-1.f, -1.f}, {2.f, -1.f}, {2.f, 2.f}, {-1.f, 2.f}, {-1.f, -1.f} };
+
+    Line out;
+    REQUIRE(clipper.clipRing(ring, out));
+    REQUIRE(out.front() == out.back());
+    REQUIRE(ringArea(out) == Approx(1.f));
+
+    for (auto& p : out) {
+        REQUIRE(p.x >= 0.f);
+        REQUIRE(p.x <= 1.f);
+        REQUIRE(p.y >= 0.f);
+        REQUIRE(p.y <= 1.f);
+    }
+
+    Line outside = { {2.f, 2.f}, {3.f, 2.f}, {3.f, 3.f}, {2.f, 2.f} };
+    REQUIRE(!clipper.clipRing(outside, out));
+}
+
+TEST_CASE("GeometryClipper clips features of a tile", "[GeometryClipper]") {
+
+    GeometryClipper clipper(0.f);
+
+    Feature feature;
+    feature.geometryType = GeometryType::polygons;
+
+    // A polygon straddling the left edge with a hole outside the tile,
+    // and one completely outside.
+    feature.polygons.push_back({
+            { {-1.f, 0.f}, {0.5f, 0.f}, {0.5f, 1.f}, {-1.f, 1.f}, {-1.f, 0.f} },
+            { {-0.75f, 0.25f}, {-0.25f, 0.25f}, {-0.25f, 0.75f}, {-0.75f, 0.75f}, {-0.75f, 0.25f} } });
+    feature.polygons.push_back({
+            { {2.f, 0.f}, {3.f, 0.f}, {3.f, 1.f}, {2.f, 0.f} } });
+
+    clipper.clip(feature);
+
+    REQUIRE(feature.polygons.size() == 1);
+    REQUIRE(feature.polygons[0].size() == 1);
+    REQUIRE(ringArea(feature.polygons[0][0]) == Approx(0.5f));
+}
+
+TEST_CASE("GeometryClipper clips columnar layers", "[GeometryClipper]") {
+
+    GeometryClipper clipper(0.f);
+
+    ColumnarLayer layer("layer", 0);
+
+    Line line = { {-1.f, 0.5f}, {0.5f, 0.5f} };
+    Line ring = { {0.f, 0.f}, {2.f, 0.f}, {2.f, 1.f}, {0.f, 1.f}, {0.f, 0.f} };
+
+    layer.coordinates.insert(layer.coordinates.end(), line.begin(), line.end());
+    layer.coordinates.insert(layer.coordinates.end(), ring.begin(), ring.end());
+    layer.parts.push_back({ uint32_t(line.size()), false });
+    layer.parts.push_back({ uint32_t(ring.size()), true });
+    layer.features.push_back({ GeometryType::lines, 0, 0, 0, 1, 0, 2 });
+    layer.features.push_back({ GeometryType::polygons, 0, 0, 1, 2, 2, 7 });
+
+    clipper.clip(layer);
+
+    Feature feature;
+    layer.getFeature(0, feature);
+    REQUIRE(feature.lines.size() == 1);
+    REQUIRE(feature.lines[0] == Line({ {0.f, 0.5f}, {0.5f, 0.5f} }));
+
+    layer.getFeature(1, feature);
+    REQUIRE(feature.polygons.size() == 1);
+    REQUIRE(ringArea(feature.polygons[0][0]) == Approx(1.f));
+}
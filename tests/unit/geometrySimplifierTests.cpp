@@ -0,0 +1,69 @@
+#include "catch.hpp"
+
+#include "data/geometrySimplifier.h"
+
+using namespace Tangram;
+
+TEST_CASE("GeometrySimplifier removes points within the tolerance", "[GeometrySimplifier]") {
+
+    GeometrySimplifier simplifier(0.01f);
+
+    Line line;
+    for (int i = 0; i <= 100; i++) {
+        // Small wiggles along a line with one corner
+        float x = i * 0.01f;
+        line.push_back({ x, (i % 2) * 0.001f + (i > 50 ? (x - 0.5f) : 0.f) });
+    }
+
+    Feature feature;
+    feature.geometryType = GeometryType::lines;
+    feature.lines.push_back(line);
+
+    simplifier.simplify(feature);
+
+    auto& out = feature.lines[0];
+    REQUIRE(out.size() < 10);
+    REQUIRE(out.front() == line.front());
+    REQUIRE(out.back() == line.back());
+
+    REQUIRE(simplifier.verticesIn() == line.size());
+    REQUIRE(simplifier.verticesOut() == out.size());
+}
+
+TEST_CASE("GeometrySimplifier keeps rings that would collapse", "[GeometrySimplifier]") {
+
+    GeometrySimplifier simplifier(1.f);
+
+    Line ring = { {0.f, 0.f}, {0.1f, 0.f}, {0.1f, 0.1f}, {0.f, 0.1f}, {0.f, 0.f} };
+
+    Line out = ring;
+    REQUIRE(simplifier.simplify(out.data(), out.size(), true) == ring.size());
+    REQUIRE(out == ring);
+}
+
+TEST_CASE("GeometrySimplifier compacts columnar layers", "[GeometrySimplifier]") {
+
+    GeometrySimplifier simplifier(0.01f);
+
+    ColumnarLayer layer("layer", 0);
+
+    Line line = { {0.f, 0.f}, {0.25f, 0.001f}, {0.5f, 0.f}, {0.75f, 0.001f}, {1.f, 0.f} };
+    Point point = { 0.5f, 0.5f };
+
+    layer.coordinates.insert(layer.coordinates.end(), line.begin(), line.end());
+    layer.coordinates.push_back(point);
+    layer.parts.push_back({ uint32_t(line.size()), false });
+    layer.features.push_back({ GeometryType::lines, 0, 0, 0, 1, 0, 5 });
+    layer.features.push_back({ GeometryType::points, 0, 0, 1, 1, 5, 6 });
+
+    simplifier.simplify(layer);
+
+    Feature feature;
+    layer.getFeature(0, feature);
+    REQUIRE(feature.lines.size() == 1);
+    REQUIRE(feature.lines[0] == Line({ {0.f, 0.f}, {1.f, 0.f} }));
+
+    layer.getFeature(1, feature);
+    REQUIRE(feature.points.size() == 1);
+    REQUIRE(feature.points[0] == point);
+}
@@ -0,0 +1,71 @@
+#include "catch.hpp"
+
+#include "text/glyphPacker.h"
+
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+TEST_CASE("Glyphs are packed on pages without overlapping", "[GlyphPacker]") {
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> size(4, 40);
+
+    std::vector<uint16_t> widths, heights;
+    for (int i = 0; i < 400; i++) {
+        widths.push_back(size(random));
+        heights.push_back(size(random));
+    }
+
+    std::vector<PackedGlyph> placed;
+    size_t pages = packGlyphs(widths, heights, 256, placed);
+
+    REQUIRE(placed.size() == widths.size());
+    REQUIRE(pages > 1);
+
+    // Coverage of each pixel of the pages
+    std::vector<unsigned char> covered(pages * 256 * 256, 0);
+    bool overlap = false;
+
+    for (size_t i = 0; i < placed.size(); i++) {
+        REQUIRE(placed[i].page < pages);
+        REQUIRE((placed[i].x + widths[i] <= 256));
+        REQUIRE((placed[i].y + heights[i] <= 256));
+
+        for (int y = 0; y < heights[i]; y++) {
+            for (int x = 0; x < widths[i]; x++) {
+                auto& pixel = covered[(placed[i].page * 256 + placed[i].y + y) * 256 + placed[i].x + x];
+                if (pixel) { overlap = true; }
+                pixel = 1;
+            }
+        }
+    }
+    REQUIRE(!overlap);
+}
+
+TEST_CASE("Glyph packer fills a page before taking the next one", "[GlyphPacker]") {
+
+    std::vector<PackedGlyph> placed;
+
+    REQUIRE(packGlyphs({}, {}, 256, placed) == 0);
+    REQUIRE(placed.empty());
+
+    // Four quarters fill one page exactly
+    REQUIRE(packGlyphs({ 128, 128, 128, 128 }, { 128, 128, 128, 128 }, 256, placed) == 1);
+    REQUIRE(packGlyphs({ 128, 128, 128, 128, 128 }, { 128, 128, 128, 128, 128 }, 256, placed) == 2);
+    REQUIRE(placed[4].page == 1);
+    REQUIRE(placed[4].x == 0);
+    REQUIRE(placed[4].y == 0);
+
+    // The taller glyph starts the shelf, the smaller one follows it
+    REQUIRE(packGlyphs({ 10, 20 }, { 10, 30 }, 256, placed) == 1);
+    REQUIRE(placed[1].x == 0);
+    REQUIRE(placed[0].x == 20);
+    REQUIRE(placed[0].y == 0);
+
+    // Glyphs larger than a page are left out
+    REQUIRE(packGlyphs({ 300, 10 }, { 10, 10 }, 256, placed) == 1);
+    REQUIRE(placed[0].page == PackedGlyph::none);
+    REQUIRE(placed[1].page == 0);
+}
@@ -0,0 +1,87 @@
+#include "catch.hpp"
+
+#include "text/glyphSdf.h"
+#include "sdf.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+// Anti-aliased ring with a padding of _pad pixels, like a staged glyph
+static std::vector<unsigned char> ringBitmap(int _width, int _height, int _pad, float _inner, float _outer) {
+    std::vector<unsigned char> img(_width * _height, 0);
+    float cx = _width * 0.5f, cy = _height * 0.5f;
+
+    for (int y = _pad; y < _height - _pad; y++) {
+        for (int x = _pad; x < _width - _pad; x++) {
+            float r = std::hypot(x + 0.5f - cx, y + 0.5f - cy);
+            float a = std::fmin(std::fmax(std::fmin(r - _inner, _outer - r) + 0.5f, 0.f), 1.f);
+            img[x + y * _width] = (unsigned char)(a * 255.f);
+        }
+    }
+    return img;
+}
+
+static void requireSameSdf(const std::vector<unsigned char>& _img, int _width, int _height, float _radius) {
+
+    auto expected = _img;
+    std::vector<unsigned char> temp(_width * _height * sizeof(float) * 3);
+    sdfBuildDistanceFieldNoAlloc(expected.data(), _width, _radius, expected.data(),
+                                 _width, _height, _width, temp.data());
+
+    auto result = _img;
+    GlyphSdfScratch scratch;
+    buildGlyphSdf(result.data(), _width, _radius, result.data(), _width, _height, _width, scratch);
+
+    REQUIRE(result.size() == expected.size());
+    for (size_t i = 0; i < result.size(); i++) {
+        REQUIRE(int(result[i]) == int(expected[i]));
+    }
+}
+
+TEST_CASE("buildGlyphSdf matches the scalar distance field", "[glyphSdf]") {
+
+    // Even and odd widths, to cover the rows that do not fill a vector
+    for (int size : { 16, 23, 37, 64 }) {
+        auto img = ringBitmap(size, size + 3, 3, size * 0.15f, size * 0.35f);
+        requireSameSdf(img, size, size + 3, 3.f);
+    }
+}
+
+TEST_CASE("buildGlyphSdf matches the scalar distance field on noise", "[glyphSdf]") {
+
+    std::mt19937 random(11);
+
+    for (int size : { 3, 5, 6, 9, 29 }) {
+        int width = size, height = size + 2;
+        std::vector<unsigned char> img(width * height, 0);
+
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 1; x < width - 1; x++) {
+                // Mostly flat areas with hard and anti-aliased edges
+                int v = random() % 8;
+                img[x + y * width] = v < 3 ? 0 : v < 6 ? 255 : random() % 256;
+            }
+        }
+        requireSameSdf(img, width, height, 4.f);
+    }
+}
+
+TEST_CASE("buildGlyphSdf reuses its scratch buffer for smaller glyphs", "[glyphSdf]") {
+
+    GlyphSdfScratch scratch;
+    auto large = ringBitmap(48, 48, 3, 6.f, 18.f);
+    buildGlyphSdf(large.data(), 48, 3.f, large.data(), 48, 48, 48, scratch);
+    size_t capacity = scratch.field.capacity();
+
+    auto small = ringBitmap(12, 12, 3, 1.f, 4.f);
+    auto expected = small;
+    std::vector<unsigned char> temp(12 * 12 * sizeof(float) * 3);
+    sdfBuildDistanceFieldNoAlloc(expected.data(), 12, 3.f, expected.data(), 12, 12, 12, temp.data());
+
+    buildGlyphSdf(small.data(), 12, 3.f, small.data(), 12, 12, 12, scratch);
+    REQUIRE(scratch.field.capacity() == capacity);
+    REQUIRE((small == expected));
+}
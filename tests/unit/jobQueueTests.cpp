@@ -3,6 +3,7 @@
 
 #include "util/jobQueue.h"
 
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -64,3 +65,26 @@ TEST_CASE("stress test JobQueue", "[JobQueue]") {
 
     CHECK(globalCounter == (numThreads * runJobsRepeats * addJobRepeats));
 }
+
+TEST_CASE("JobQueue runs jobs in order within a budget", "[JobQueue]") {
+
+    JobQueue jobQueue;
+    std::vector<int> order;
+
+    for (int i = 0; i < 3; i++) {
+        jobQueue.add([&, i] {
+            order.push_back(i);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        });
+    }
+
+    // The budget is used up by the first job
+    CHECK(jobQueue.runJobs(1.f));
+    CHECK(order == std::vector<int>{ 0 });
+
+    jobQueue.add([&] { order.push_back(3); });
+
+    CHECK(!jobQueue.runJobs());
+    CHECK(order == (std::vector<int>{ 0, 1, 2, 3 }));
+    CHECK(!jobQueue.runJobs());
+}
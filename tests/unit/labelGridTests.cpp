@@ -0,0 +1,107 @@
+#include "catch.hpp"
+
+#include "labels/labelGrid.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+using AABB = LabelGrid::AABB;
+
+static bool overlaps(const AABB& _a, const AABB& _b) {
+    return !(_a.min.x > _b.max.x || _a.max.x < _b.min.x ||
+             _a.min.y > _b.max.y || _a.max.y < _b.min.y);
+}
+
+static std::vector<AABB> randomBoxes(size_t _count) {
+    std::mt19937 rng(1);
+    // Include boxes outside of the grid area
+    std::uniform_real_distribution<float> pos(-100, 500);
+    std::uniform_real_distribution<float> size(1, 80);
+
+    std::vector<AABB> boxes;
+    for (size_t i = 0; i < _count; i++) {
+        float x = pos(rng), y = pos(rng);
+        boxes.emplace_back(x, y, x + size(rng), y + size(rng));
+    }
+    return boxes;
+}
+
+TEST_CASE("LabelGrid reports each intersecting box once", "[Labels][LabelGrid]") {
+
+    auto boxes = randomBoxes(200);
+
+    LabelGrid grid;
+    grid.resize({400, 400}, 32);
+
+    for (size_t i = 0; i < boxes.size(); i++) {
+        AABB aabb = boxes[i];
+        aabb.m_userData = reinterpret_cast<void*>(i);
+        grid.insert(aabb);
+    }
+
+    AABB query(90, 90, 170, 130);
+
+    std::vector<size_t> found;
+    grid.intersect(query, [&](auto& a, auto& b) {
+            found.push_back(reinterpret_cast<size_t>(b.m_userData));
+            return true;
+        });
+    std::sort(found.begin(), found.end());
+
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        if (overlaps(query, boxes[i])) { expected.push_back(i); }
+    }
+
+    REQUIRE(!expected.empty());
+    REQUIRE(found == expected);
+
+    // Stops when the callback returns false
+    size_t calls = 0;
+    grid.intersect(query, [&](auto& a, auto& b) { calls++; return false; });
+    REQUIRE(calls == 1);
+}
+
+TEST_CASE("LabelGrid finds the same pairs as a brute force test", "[Labels][LabelGrid]") {
+
+    auto boxes = randomBoxes(300);
+
+    std::vector<std::pair<int, int>> expected;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        for (size_t j = i + 1; j < boxes.size(); j++) {
+            if (overlaps(boxes[i], boxes[j])) { expected.emplace_back(i, j); }
+        }
+    }
+
+    std::vector<float> sizes;
+    for (auto& b : boxes) { sizes.push_back(std::max(b.max.x - b.min.x, b.max.y - b.min.y)); }
+
+    LabelGrid grid;
+    grid.resize({400, 400}, LabelGrid::cellSize(sizes));
+
+    // Run twice to check that reusing the grid gives the same result
+    for (int run = 0; run < 2; run++) {
+        grid.intersect(boxes);
+
+        std::vector<std::pair<int, int>> pairs;
+        for (auto& p : grid.pairs) { pairs.emplace_back(p.first, p.second); }
+        std::sort(pairs.begin(), pairs.end());
+
+        REQUIRE(pairs == expected);
+    }
+}
+
+TEST_CASE("LabelGrid cell size follows the median label size", "[Labels][LabelGrid]") {
+
+    std::vector<float> sizes = { 10, 40, 30, 500, 20 };
+    REQUIRE(LabelGrid::cellSize(sizes) == 60.f);
+
+    std::vector<float> small = { 1, 2, 3 };
+    REQUIRE(LabelGrid::cellSize(small) == LabelGrid::MIN_CELL_SIZE);
+
+    std::vector<float> none;
+    REQUIRE(LabelGrid::cellSize(none) == LabelGrid::MAX_CELL_SIZE);
+}
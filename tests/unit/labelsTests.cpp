@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "gl/dynamicQuadMesh.h"
+#include "labels/labelCollider.h"
 #include "labels/labels.h"
 #include "labels/textLabel.h"
 #include "labels/textLabels.h"
@@ -11,6 +12,7 @@
 #include "tile/tile.h"
 #include "view/view.h"
 
+#include <algorithm>
 #include <memory>
 
 namespace Tangram {
@@ -215,4 +217,234 @@ TEST_CASE( "Test anchor fallback behavior", "[Labels][AnchorFallback]" ) {
     }
 
 }
+
+TEST_CASE( "Incremental occlusion matches full placement when panning", "[Labels][Incremental]" ) {
+
+    View view(256, 256);
+    view.setPosition(0, 0);
+    view.setZoom(0);
+    view.update(false);
+
+    Tile tile({0,0,0}, view.getMapProjection());
+
+    class TestLabels : public Labels {
+    public:
+        TestLabels(View& _v, bool _incremental) {
+            m_isect2d.resize({1, 1}, {_v.getWidth(), _v.getHeight()});
+            setIncrementalOcclusion(_incremental);
+        }
+
+        void addLabel(Label* _l, Tile* _t, View& _v) {
+            m_labels.push_back({_l, nullptr, _t, nullptr, false, {}});
+            ScreenTransform transform(m_transforms, m_labels.back().transformRange);
+            _l->update(_t->mvp(), _v.state(), bounds, transform);
+        }
+        void run(View& _v) { handleOcclusions(_v.state()); }
+        void clear() {
+            m_labels.clear();
+            m_transforms.clear();
+            m_obbs.clear();
+        }
+    };
+
+    // Overlapping labels, so that some are occluded or use anchor fallbacks
+    std::vector<glm::vec2> positions = {
+        {0.5, 0.5}, {0.5 - 1./256, 0.5}, {0.5, 0.5 + 10./256}, {0.5, 0.5},
+        {0.55, 0.5}, {0.55 + 4./256, 0.5 + 4./256}, {0.45, 0.45},
+    };
+
+    std::vector<TextLabel> incrementalLabels, fullLabels;
+    for (auto& pos : positions) {
+        incrementalLabels.push_back(makeLabelWithAnchorFallbacks(pos));
+        fullLabels.push_back(makeLabelWithAnchorFallbacks(pos));
+    }
+
+    TestLabels incremental(view, true);
+    TestLabels full(view, false);
+
+    double pixel = view.getMapProjection().MapBounds().width() / 256.;
+
+    for (int frame = 0; frame < 8; frame++) {
+        // Pan by a few pixels each frame, add the last label midway
+        view.setPosition(frame * 7 * pixel, frame * 3 * pixel);
+        view.update(false);
+        tile.update(0, view);
+
+        size_t count = frame < 4 ? positions.size() - 1 : positions.size();
+
+        incremental.clear();
+        full.clear();
+        for (size_t i = 0; i < count; i++) {
+            incremental.addLabel(&incrementalLabels[i], &tile, view);
+            full.addLabel(&fullLabels[i], &tile, view);
+        }
+        incremental.run(view);
+        full.run(view);
+
+        for (size_t i = 0; i < count; i++) {
+            REQUIRE(incrementalLabels[i].isOccluded() == fullLabels[i].isOccluded());
+            REQUIRE(incrementalLabels[i].anchorType() == fullLabels[i].anchorType());
+        }
+    }
+}
+
+
+TEST_CASE( "Labels beyond the placement budget are deferred", "[Labels][Budget]" ) {
+
+    View view(256, 256);
+    view.setPosition(0, 0);
+    view.setZoom(0);
+    view.update(false);
+
+    Tile tile({0,0,0}, view.getMapProjection());
+    tile.update(0, view);
+
+    class TestLabels : public Labels {
+    public:
+        TestLabels(View& _v) {
+            m_isect2d.resize({1, 1}, {_v.getWidth(), _v.getHeight()});
+        }
+
+        void addLabel(Label* _l, Tile* _t, View& _v) {
+            m_labels.push_back({_l, nullptr, _t, nullptr, false, {}});
+            ScreenTransform transform(m_transforms, m_labels.back().transformRange);
+            _l->update(_t->mvp(), _v.state(), bounds, transform);
+        }
+        void run(View& _v) { handleOcclusions(_v.state()); }
+        void clear() {
+            m_labels.clear();
+            m_transforms.clear();
+            m_obbs.clear();
+        }
+    };
+
+    // Labels on a grid which do not overlap
+    std::vector<TextLabel> labels;
+    for (int i = 0; i < 64; i++) {
+        labels.push_back(makeLabelWithAnchorFallbacks({(i % 8 + 0.5) / 8, (i / 8 + 0.5) / 8}));
+    }
+
+    TestLabels placement(view);
+
+    auto run = [&]() {
+        placement.clear();
+        for (auto& l : labels) { placement.addLabel(&l, &tile, view); }
+        placement.run(view);
+    };
+
+    // The budget is exceeded at the first check, after 32 labels
+    placement.setPlacementBudget(1e-9f);
+    run();
+
+    size_t deferred = placement.deferredLabelCount();
+    REQUIRE(deferred == 32);
+    REQUIRE(std::count_if(labels.begin(), labels.end(),
+                          [](auto& l) { return l.isOccluded(); }) == int(deferred));
+
+    placement.setPlacementBudget(0);
+    run();
+
+    REQUIRE(placement.deferredLabelCount() == 0);
+    for (auto& l : labels) { REQUIRE(!l.isOccluded()); }
+}
+
+TEST_CASE( "Label layouts of a tile are reused for the same labels", "[Labels][LabelLayout]" ) {
+
+    auto makeLabels = []() {
+        std::vector<LabelPtr> labels;
+        labels.push_back(makeLabel({0.5f, 0.5f}, Label::Type::point, "0"));
+        labels.push_back(makeLabel({0.5f, 0.5001f}, Label::Type::point, "1"));
+        labels.push_back(makeLabel({0.1f, 0.1f}, Label::Type::point, "2"));
+        return labels;
+    };
+
+    TileID tileId(0, 0, 0);
+    LabelCollider collider;
+    LabelLayout layout;
+
+    auto labels = makeLabels();
+    collider.addLabels(labels);
+    collider.process(tileId, 1.f, 256.f, &layout);
+
+    REQUIRE(layout.placements.size() == 3);
+    REQUIRE(labels[2]->state() != Label::State::dead);
+    // One of the overlapping labels is occluded
+    REQUIRE((labels[0]->state() == Label::State::dead) != (labels[1]->state() == Label::State::dead));
+
+    auto rebuilt = makeLabels();
+    collider.addLabels(rebuilt);
+    REQUIRE(collider.apply(layout));
+    REQUIRE(collider.empty());
+    for (size_t i = 0; i < labels.size(); i++) {
+        REQUIRE(rebuilt[i]->state() == labels[i]->state());
+        REQUIRE(rebuilt[i]->isOccluded() == labels[i]->isOccluded());
+    }
+
+    // Labels that moved are collided again
+    std::vector<LabelPtr> moved;
+    moved.push_back(makeLabel({0.5f, 0.5f}, Label::Type::point, "0"));
+    moved.push_back(makeLabel({0.9f, 0.9f}, Label::Type::point, "1"));
+    moved.push_back(makeLabel({0.1f, 0.1f}, Label::Type::point, "2"));
+    collider.addLabels(moved);
+    REQUIRE(!collider.apply(layout));
+    collider.process(tileId, 1.f, 256.f, &layout);
+    for (auto& label : moved) { REQUIRE(label->state() != Label::State::dead); }
+}
+
+TEST_CASE( "LabelLayoutCache evicts the oldest layouts", "[Labels][LabelLayout]" ) {
+
+    LabelLayout layout;
+    layout.signature = 7;
+    layout.placements.assign(100, LabelLayout::visible);
+
+    LabelLayoutCache cache(layout.bytes() * 2);
+    cache.put(1, TileID(0, 0, 1), layout);
+    cache.put(1, TileID(1, 0, 1), layout);
+    cache.put(2, TileID(0, 0, 1), layout);
+
+    LabelLayout result;
+    REQUIRE(cache.size() == 2);
+    REQUIRE(!cache.get(1, TileID(0, 0, 1), result));
+    REQUIRE(cache.get(2, TileID(0, 0, 1), result));
+    REQUIRE(result.signature == 7);
+    REQUIRE(result.placements.size() == 100);
+}
+
+TEST_CASE( "Pooled labels are kept alive by the set they are moved to", "[Labels][LabelPool]" ) {
+
+    struct TestLabelSet : public LabelSet {};
+
+    Label::Options options;
+    options.anchors.anchor[0] = LabelProperty::Anchor::center;
+    options.anchors.count = 1;
+
+    auto makePooled = [&](LabelSet& _set, glm::vec2 _position) {
+        return _set.pool().make<TextLabel>(TextLabel::Coordinates{{glm::vec2(_position)}}, Label::Type::point,
+                                           options, TextLabel::VertexAttributes{}, glm::vec2(10, 10),
+                                           dummy, TextRange{}, TextLabelProperty::Align::none);
+    };
+
+    TestLabelSet icons;
+    {
+        TestLabelSet text;
+        std::vector<LabelPtr> labels;
+        for (int i = 0; i < 100; i++) { labels.push_back(makePooled(text, { i * 0.01f, 0.5f })); }
+        // Labels are constructed next to each other
+        auto stride = reinterpret_cast<char*>(labels[1].get()) - reinterpret_cast<char*>(labels[0].get());
+        REQUIRE(size_t(stride) == sizeof(TextLabel));
+        REQUIRE(text.pool().capacity() >= 100 * sizeof(TextLabel));
+        text.setLabels(labels);
+
+        icons.getLabels().push_back(makeLabel({0.5f, 0.5f}, Label::Type::point, "heap"));
+        icons.addLabels(text);
+        REQUIRE(text.getLabels().empty());
+    }
+
+    REQUIRE(icons.getLabels().size() == 101);
+    for (auto& label : icons.getLabels()) {
+        label->resetState();
+        REQUIRE(label->dimension() == glm::vec2(10, 10));
+    }
+}
+
 }
@@ -0,0 +1,31 @@
+#include "catch.hpp"
+
+#include "scene/ambientLight.h"
+#include "scene/light.h"
+#include "scene/pointLight.h"
+
+#include <memory>
+#include <vector>
+
+using namespace Tangram;
+
+TEST_CASE("Lights with a range are computed only where they are visible", "[Light]") {
+
+    std::vector<std::unique_ptr<Light>> lights;
+    lights.push_back(std::make_unique<AmbientLight>("ambient"));
+
+    auto point = std::make_unique<PointLight>("point");
+    REQUIRE(!point->hasRange());
+    point->setRadius(100.f);
+    REQUIRE(point->hasRange());
+    REQUIRE(point->range() == 100.f);
+    lights.push_back(std::move(point));
+
+    auto blocks = Light::assembleLights(lights);
+    auto& lighting = blocks["lighting"];
+
+    REQUIRE(lighting.find("uniform float u_lights_visible[1];") != std::string::npos);
+    REQUIRE(lighting.find("if (u_lights_visible[0] != 0.0) { calculateLight(point,") != std::string::npos);
+    // Lights without a range are always computed
+    REQUIRE(lighting.find("\ncalculateLight(ambient,") != std::string::npos);
+}
@@ -0,0 +1,199 @@
+#include "catch.hpp"
+
+#include "data/memoryCacheDataSource.h"
+#include "data/tileData.h"
+#include "data/tileSource.h"
+#include "util/memoryReport.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace Tangram;
+
+// Returns the same compressible tile for every request
+class TileDataSource : public TileSource::DataSource {
+
+public:
+
+    bool loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override {
+        auto& task = static_cast<BinaryTileTask&>(*_task);
+        std::string json;
+        for (int i = 0; i < 100; i++) { json += "{\"type\":\"Feature\",\"properties\":{}},"; }
+        task.rawTileData = ByteBuffer(std::vector<char>(json.begin(), json.end()));
+        requests++;
+        _cb.func(_task);
+        return true;
+    }
+
+    void clear() override {}
+
+    int requests = 0;
+};
+
+TEST_CASE("MemoryCacheDataSource keeps tiles compressed", "[MemoryCacheDataSource]") {
+
+    auto source = std::make_shared<TileSource>("source", nullptr);
+
+    MemoryCacheDataSource cache;
+    cache.setCacheSize(1024 * 1024);
+    cache.setCompression(true);
+
+    auto next = std::make_unique<TileDataSource>();
+    auto& network = *next;
+    cache.setNext(std::move(next));
+
+    TileID id(1, 2, 3);
+    auto load = [&]() {
+        auto task = std::make_shared<BinaryTileTask>(id, source, 0);
+        task->rawSource = cache.level;
+        cache.loadTileData(task, { [](std::shared_ptr<TileTask>) {} });
+        return task;
+    };
+
+    auto first = load();
+    REQUIRE(network.requests == 1);
+    REQUIRE(!first->rawTileDataCompressed);
+    const auto expected = std::string(first->rawTileData.begin(), first->rawTileData.end());
+
+    // Wait for the compressor to replace the entry
+    std::shared_ptr<BinaryTileTask> cached;
+    for (int i = 0; i < 100; i++) {
+        cached = load();
+        if (cached->rawTileDataCompressed) { break; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(network.requests == 1);
+    REQUIRE(cached->rawTileDataCompressed);
+    REQUIRE(cached->rawTileData.size() < expected.size() / 4);
+
+    REQUIRE(cached->inflateRawTileData());
+    REQUIRE(!cached->rawTileDataCompressed);
+    REQUIRE(std::string(cached->rawTileData.begin(), cached->rawTileData.end()) == expected);
+}
+
+TEST_CASE("MemoryCacheDataSources share a cache by key", "[MemoryCacheDataSource]") {
+
+    auto source = std::make_shared<TileSource>("source", nullptr);
+
+    MemoryCacheDataSource first, second;
+    for (auto* cache : { &first, &second }) {
+        cache->setCacheSize(1024 * 1024);
+        cache->shareCache("https://tiles/{z}/{x}/{y}.json");
+    }
+
+    auto next = std::make_unique<TileDataSource>();
+    auto& network = *next;
+    first.setNext(std::move(next));
+
+    TileID id(1, 2, 3);
+    auto task = std::make_shared<BinaryTileTask>(id, source, 0);
+    first.loadTileData(task, { [](std::shared_ptr<TileTask>) {} });
+    REQUIRE(network.requests == 1);
+
+    auto cached = std::make_shared<BinaryTileTask>(id, source, 0);
+    REQUIRE(second.loadTileData(cached, { [](std::shared_ptr<TileTask>) {} }));
+    REQUIRE(cached->rawTileData.data() == task->rawTileData.data());
+}
+
+TEST_CASE("MemoryCacheDataSources report a shared cache once", "[MemoryCacheDataSource]") {
+
+    auto source = std::make_shared<TileSource>("source", nullptr);
+
+    MemoryCacheDataSource first, second;
+    for (auto* cache : { &first, &second }) {
+        cache->setCacheSize(1024 * 1024);
+        cache->shareCache("https://tiles/{z}/{x}/{y}.geojson");
+    }
+    first.setNext(std::make_unique<TileDataSource>());
+
+    MemoryReport empty;
+    first.reportMemory(empty);
+    REQUIRE(empty.stats.rawCache.cpuBytes == 0);
+
+    TileID id(1, 2, 3);
+    auto task = std::make_shared<BinaryTileTask>(id, source, 0);
+    first.loadTileData(task, { [](std::shared_ptr<TileTask>) {} });
+
+    MemoryReport report;
+    first.reportMemory(report);
+    uint64_t bytes = report.stats.rawCache.cpuBytes;
+    REQUIRE(bytes >= task->rawTileData.size());
+    REQUIRE(report.stats.rawCache.gpuBytes == 0);
+
+    second.reportMemory(report);
+    REQUIRE(report.stats.rawCache.cpuBytes == bytes);
+}
+
+TEST_CASE("MemoryCacheDataSource releases the least recently used tiles first", "[MemoryCacheDataSource]") {
+
+    auto source = std::make_shared<TileSource>("source", nullptr);
+
+    MemoryCacheDataSource cache;
+    cache.setCacheSize(1024 * 1024);
+
+    auto next = std::make_unique<TileDataSource>();
+    auto& network = *next;
+    cache.setNext(std::move(next));
+
+    auto load = [&](TileID _id) {
+        auto task = std::make_shared<BinaryTileTask>(_id, source, 0);
+        task->rawSource = cache.level;
+        cache.loadTileData(task, { [](std::shared_ptr<TileTask>) {} });
+        return task;
+    };
+
+    TileID oldest(0, 0, 1), newest(1, 0, 1);
+    size_t tileSize = load(oldest)->rawTileData.size();
+    load(newest);
+    REQUIRE(network.requests == 2);
+
+    REQUIRE(cache.releaseMemory(1) == tileSize);
+
+    load(newest);
+    REQUIRE(network.requests == 2);
+    load(oldest);
+    REQUIRE(network.requests == 3);
+}
+
+TEST_CASE("MemoryCacheDataSource shares parsed tile data with overzoomed tiles", "[MemoryCacheDataSource]") {
+
+    auto source = std::make_shared<TileSource>("source", nullptr);
+    auto otherSource = std::make_shared<TileSource>("other", nullptr);
+
+    MemoryCacheDataSource cache;
+    cache.setCacheSize(1024 * 1024);
+    cache.setNext(std::make_unique<TileDataSource>());
+
+    auto load = [&](TileID _id, std::shared_ptr<TileSource> _source) {
+        auto task = std::make_shared<BinaryTileTask>(_id, _source, 0);
+        task->rawSource = cache.level;
+        cache.loadTileData(task, { [](std::shared_ptr<TileTask>) {} });
+        return task;
+    };
+
+    TileID id(1, 2, 3);
+    auto first = load(id, source);
+    REQUIRE(!first->parsedTileData);
+
+    auto tileData = std::make_shared<TileData>();
+    tileData->layers.emplace_back("layer");
+    tileData->layers.back().features.emplace_back();
+    tileData->layers.back().features.back().points.resize(16);
+    cache.cacheTileData(*first, tileData);
+
+    // Same data tile at a higher styling zoom
+    auto overzoomed = load(TileID(1, 2, 3, 5, 0), source);
+    REQUIRE(overzoomed->parsedTileData == tileData);
+
+    // Parsed data is only given to the source that parsed it
+    REQUIRE(!load(id, otherSource)->parsedTileData);
+
+    MemoryReport report;
+    cache.reportMemory(report);
+    REQUIRE(report.stats.rawCache.cpuBytes >= first->rawTileData.size() + tileData->memoryUsage());
+
+    // Releasing the entry drops its parsed data too
+    cache.releaseMemory(1);
+    REQUIRE(!load(id, source)->parsedTileData);
+}
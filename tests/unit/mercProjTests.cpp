@@ -7,6 +7,7 @@
 #include "util/mapProjection.h"
 
 #include <stdio.h>
+#include <vector>
 
 using namespace Tangram;
 
@@ -30,3 +31,31 @@ TEST_CASE( "Testing some functionality for mercator projection", "[MERCATOR][PRO
     REQUIRE( (testLonLat.x - lonLat.x) < epsilon);
     REQUIRE( (testLonLat.y - lonLat.y) < epsilon);
 }
+
+TEST_CASE( "Batch projection matches the projection of single coordinates", "[MERCATOR][PROJECTION]" ) {
+    MercatorProjection mercProjection;
+    const MapProjection& projection = mercProjection;
+
+    std::vector<glm::dvec2> lonLats = { {0.0, 0.0}, {-122.4, 37.8}, {13.4, 52.5}, {179.9, -85.0} };
+
+    std::vector<glm::dvec2> meters(lonLats.size());
+    projection.LonLatToMeters(lonLats.data(), meters.data(), lonLats.size());
+    for (size_t i = 0; i < lonLats.size(); i++) {
+        REQUIRE(meters[i] == mercProjection.LonLatToMeters(lonLats[i]));
+    }
+
+    // In place
+    std::vector<glm::dvec2> degrees = meters;
+    projection.MetersToLonLat(degrees.data(), degrees.data(), degrees.size());
+    for (size_t i = 0; i < lonLats.size(); i++) {
+        REQUIRE(degrees[i].x == Approx(lonLats[i].x));
+        REQUIRE(degrees[i].y == Approx(lonLats[i].y));
+    }
+
+    glm::dvec2 origin = { -1000.0, 2000.0 };
+    std::vector<glm::vec2> local(lonLats.size());
+    projection.LonLatToLocal(lonLats.data(), local.data(), lonLats.size(), origin, 0.5);
+    for (size_t i = 0; i < lonLats.size(); i++) {
+        REQUIRE(local[i] == glm::vec2((meters[i] - origin) * 0.5));
+    }
+}
@@ -0,0 +1,105 @@
+#include "catch.hpp"
+
+#include "util/meshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+struct GridVertex {
+    uint16_t x, y;
+};
+
+// A _size x _size grid of quads as one feature, with shuffled triangles
+static MeshData<GridVertex> shuffledGrid(uint16_t _size) {
+    MeshData<GridVertex> mesh;
+    uint16_t row = _size + 1;
+
+    for (uint16_t y = 0; y <= _size; y++) {
+        for (uint16_t x = 0; x <= _size; x++) { mesh.vertices.push_back({ x, y }); }
+    }
+
+    std::vector<std::array<uint16_t, 3>> triangles;
+    for (uint16_t y = 0; y < _size; y++) {
+        for (uint16_t x = 0; x < _size; x++) {
+            uint16_t i = y * row + x;
+            triangles.push_back({{ i, uint16_t(i + 1), uint16_t(i + row) }});
+            triangles.push_back({{ uint16_t(i + 1), uint16_t(i + row + 1), uint16_t(i + row) }});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(7));
+
+    for (auto& t : triangles) { mesh.indices.insert(mesh.indices.end(), t.begin(), t.end()); }
+    mesh.offsets.emplace_back(mesh.indices.size(), mesh.vertices.size());
+    return mesh;
+}
+
+// Triangles by the positions of their vertices, rotated to start at the smallest
+static std::vector<std::array<uint32_t, 3>> triangleSet(const MeshData<GridVertex>& _mesh) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i < _mesh.indices.size(); i += 3) {
+        std::array<uint32_t, 3> t;
+        for (size_t k = 0; k < 3; k++) {
+            auto& v = _mesh.vertices[_mesh.indices[i + k]];
+            t[k] = uint32_t(v.y) << 16 | v.x;
+        }
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST_CASE("MeshOptimizer reduces vertex cache misses of the same triangles", "[MeshOptimizer]") {
+
+    auto mesh = shuffledGrid(24);
+    auto before = triangleSet(mesh);
+
+    MeshOptimizer optimizer;
+    auto stats = optimizer.optimize(mesh);
+
+    REQUIRE(stats.triangles == 24 * 24 * 2);
+    REQUIRE(stats.missesAfter < stats.missesBefore);
+    // Close to one miss per vertex
+    float acmr = float(stats.missesAfter) / stats.triangles;
+    REQUIRE(acmr < 0.8f);
+
+    REQUIRE(optimizer.cacheMisses(mesh.indices.data(), mesh.indices.size(),
+                                  mesh.vertices.size()) == stats.missesAfter);
+
+    // Same triangles with the same winding
+    REQUIRE(triangleSet(mesh) == before);
+
+    // Vertices are in order of their first use
+    uint16_t next = 0;
+    for (auto index : mesh.indices) {
+        REQUIRE(index <= next);
+        if (index == next) { next++; }
+    }
+}
+
+TEST_CASE("MeshOptimizer keeps meshes that fit into the cache", "[MeshOptimizer]") {
+
+    auto small = shuffledGrid(2);
+    auto grid = shuffledGrid(12);
+
+    // Two features in one mesh, the first one too small to optimize
+    MeshData<GridVertex> mesh = small;
+    mesh.vertices.insert(mesh.vertices.end(), grid.vertices.begin(), grid.vertices.end());
+    mesh.indices.insert(mesh.indices.end(), grid.indices.begin(), grid.indices.end());
+    mesh.offsets.push_back(grid.offsets[0]);
+
+    MeshOptimizer optimizer;
+    auto stats = optimizer.optimize(mesh);
+
+    REQUIRE(stats.triangles == (2 * 2 + 12 * 12) * 2);
+    REQUIRE(std::equal(small.indices.begin(), small.indices.end(), mesh.indices.begin()));
+
+    // Indices of the second feature stay local to it
+    for (size_t i = small.indices.size(); i < mesh.indices.size(); i++) {
+        REQUIRE(mesh.indices[i] < grid.vertices.size());
+    }
+}
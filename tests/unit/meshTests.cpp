@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include "gl/mesh.h"
+#include "gl/hardware.h"
+#include "gl/renderState.h"
 
 using namespace Tangram;
 
@@ -27,6 +29,12 @@ struct TestMesh : public Mesh<Vertex> {
 
     int numVertices() const { return m_nVertices; }
     int numIndices() const { return m_nIndices; }
+
+    const auto& chunks() const { return m_chunks; }
+    size_t numBatches() const { return m_vertexOffsets.size(); }
+    GLenum indexType() const { return m_indexType; }
+
+    bool read(const char*& _pos, const char* _end) { return deserialize(_pos, _end); }
 };
 
 std::shared_ptr<TestMesh> newMesh(unsigned int size) {
@@ -170,3 +178,178 @@ TEST_CASE( "Check overflow", "[Core][TypedMesh]" ) {
 
     checkBounds(mesh);
 }
+
+TEST_CASE( "Mesh bounds outside of the clip volume", "[Core][TypedMesh]" ) {
+    glm::mat4 identity;
+
+    MeshBounds inside;
+    inside.extend({-0.5f, -0.5f, 0.f});
+    inside.extend({0.5f, 0.5f, 0.f});
+    REQUIRE(!inside.isOutside(identity));
+
+    // Overlapping the border
+    MeshBounds border;
+    border.extend({0.5f, 0.5f, 0.f});
+    border.extend({1.5f, 1.5f, 0.f});
+    REQUIRE(!border.isOutside(identity));
+
+    MeshBounds right;
+    right.extend({1.5f, -0.5f, 0.f});
+    right.extend({2.5f, 0.5f, 0.f});
+    REQUIRE(right.isOutside(identity));
+
+    right.grow(1.f);
+    REQUIRE(!right.isOutside(identity));
+
+    REQUIRE(MeshBounds().isOutside(identity));
+}
+
+TEST_CASE( "Mesh splits features with bounds into chunks", "[Core][TypedMesh]" ) {
+    auto mesh = std::make_shared<TestMesh>(layout, GL_TRIANGLES);
+    MeshData<Vertex> meshData;
+
+    const size_t featureIndices = MeshBase::CHUNK_INDICES / 2;
+
+    for (int f = 0; f < 3; f++) {
+        meshData.vertices.insert(meshData.vertices.end(), 3, {0,0,0,0});
+        for (size_t i = 0; i < featureIndices; i++) {
+            meshData.indices.push_back(i % 3);
+        }
+        meshData.offsets.emplace_back(featureIndices, 3);
+
+        MeshBounds bounds;
+        bounds.extend({float(f), 0.f, 0.f});
+        meshData.bounds.push_back(bounds);
+    }
+    mesh->compile(meshData);
+
+    auto& chunks = mesh->chunks();
+    REQUIRE(chunks.size() == 2);
+    REQUIRE(chunks[0].indexOffset == 0);
+    REQUIRE(chunks[0].nIndices == 2 * featureIndices);
+    REQUIRE(chunks[0].bounds.max.x == 1.f);
+    REQUIRE(chunks[1].indexOffset == 2 * featureIndices);
+    REQUIRE(chunks[1].nIndices == featureIndices);
+
+    // Without bounds the mesh is drawn in full
+    meshData.bounds.clear();
+    auto full = std::make_shared<TestMesh>(layout, GL_TRIANGLES);
+    full->compile(meshData);
+    REQUIRE(full->chunks().empty());
+}
+
+TEST_CASE( "Mesh with more than 65535 vertices uses 32 bit indices when supported", "[Core][TypedMesh]" ) {
+    MeshData<Vertex> meshData;
+
+    // Quads of 4 vertices, 6 indices
+    const size_t quads = 20000;
+    for (size_t q = 0; q < quads; q++) {
+        meshData.vertices.insert(meshData.vertices.end(), 4, {0,0,0,0});
+        meshData.indices.insert(meshData.indices.end(), { 0, 1, 2, 2, 1, 3 });
+        meshData.offsets.emplace_back(6, 4);
+    }
+
+    bool supported = Hardware::supportsElementIndexUint;
+
+    Hardware::supportsElementIndexUint = false;
+    TestMesh mesh16(layout, GL_TRIANGLES);
+    mesh16.compile(meshData);
+    REQUIRE(mesh16.indexType() == GL_UNSIGNED_SHORT);
+    REQUIRE(mesh16.numBatches() == 2);
+
+    Hardware::supportsElementIndexUint = true;
+    TestMesh mesh32(layout, GL_TRIANGLES);
+    mesh32.compile(meshData);
+    REQUIRE(mesh32.indexType() == GL_UNSIGNED_INT);
+    REQUIRE(mesh32.numBatches() == 1);
+    REQUIRE(mesh32.bufferSize() == mesh16.bufferSize() + quads * 6 * 2);
+
+    Hardware::supportsElementIndexUint = supported;
+}
+
+TEST_CASE( "Mesh geometry is restored from its serialized form", "[Core][TypedMesh]" ) {
+    auto mesh = std::make_shared<TestMesh>(layout, GL_TRIANGLES);
+    MeshData<Vertex> meshData;
+
+    for (int f = 0; f < 2; f++) {
+        meshData.vertices.insert(meshData.vertices.end(), 3, {float(f),0,0,0});
+        meshData.indices.insert(meshData.indices.end(), { 0, 1, 2 });
+        meshData.offsets.emplace_back(3, 3);
+
+        MeshBounds bounds;
+        bounds.extend({float(f), 0.f, 0.f});
+        meshData.bounds.push_back(bounds);
+    }
+    mesh->compile(meshData);
+
+    std::vector<char> data;
+    REQUIRE(mesh->serialize(data));
+
+    TestMesh restored(layout, GL_TRIANGLES);
+    const char* pos = data.data();
+    REQUIRE(restored.read(pos, data.data() + data.size()));
+    REQUIRE(pos == data.data() + data.size());
+    REQUIRE(restored.numVertices() == 6);
+    REQUIRE(restored.numIndices() == 6);
+    REQUIRE(restored.numBatches() == mesh->numBatches());
+    REQUIRE(restored.chunks().size() == mesh->chunks().size());
+    REQUIRE(restored.bufferSize() == mesh->bufferSize());
+    REQUIRE(!restored.isUploaded());
+
+    // Truncated data and other vertex layouts are rejected
+    TestMesh truncated(layout, GL_TRIANGLES);
+    pos = data.data();
+    REQUIRE(!truncated.read(pos, data.data() + data.size() - 1));
+
+    auto otherLayout = std::shared_ptr<VertexLayout>(new VertexLayout({ {"a", 1, GL_FLOAT, false, 0} }));
+    TestMesh other(otherLayout, GL_TRIANGLES);
+    pos = data.data();
+    REQUIRE(!other.read(pos, data.data() + data.size()));
+}
+
+TEST_CASE( "Mesh geometry is read back when its buffers are released", "[Core][TypedMesh]" ) {
+    RenderState rs;
+    auto mesh = std::make_shared<TestMesh>(layout, GL_TRIANGLES);
+    MeshData<Vertex> meshData;
+
+    for (int f = 0; f < 3; f++) {
+        meshData.vertices.insert(meshData.vertices.end(), 3, {float(f), 1, short(f), 2});
+        meshData.indices.insert(meshData.indices.end(), { 0, 1, 2 });
+        meshData.offsets.emplace_back(3, 3);
+    }
+    mesh->compile(meshData);
+
+    std::vector<char> compiled;
+    REQUIRE(mesh->serialize(compiled));
+
+    bool supported = Hardware::supportsMapBufferRange;
+
+    // Not uploaded yet
+    Hardware::supportsMapBufferRange = true;
+    REQUIRE(mesh->releaseBuffers(rs) == 0);
+
+    mesh->uploadBuffers(rs);
+    REQUIRE(mesh->isUploaded());
+
+    // Stays uploaded when the buffers can't be read
+    Hardware::supportsMapBufferRange = false;
+    REQUIRE(mesh->releaseBuffers(rs) == 0);
+    REQUIRE(mesh->isUploaded());
+    REQUIRE(!mesh->isReleased());
+
+    Hardware::supportsMapBufferRange = true;
+    REQUIRE(mesh->releaseBuffers(rs) == mesh->bufferSize());
+    REQUIRE(!mesh->isUploaded());
+    REQUIRE(mesh->isReleased());
+
+    // Same geometry as before the upload
+    std::vector<char> released;
+    REQUIRE(mesh->serialize(released));
+    REQUIRE(released == compiled);
+
+    REQUIRE(mesh->uploadBuffers(rs) == mesh->bufferSize());
+    REQUIRE(mesh->isUploaded());
+    REQUIRE(!mesh->isReleased());
+
+    Hardware::supportsMapBufferRange = supported;
+}
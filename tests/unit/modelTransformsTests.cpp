@@ -0,0 +1,48 @@
+#include "catch.hpp"
+
+#include "view/modelTransforms.h"
+#include "view/view.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace Tangram;
+
+TEST_CASE("ModelTransforms match the transforms of single models", "[ModelTransforms]") {
+
+    View view(800, 600);
+    view.setPosition(1234567.8, -2345678.9);
+    view.setZoom(15.3f);
+    view.setRoll(0.4f);
+    view.setPitch(0.3f);
+    view.update(false);
+
+    ModelTransforms transforms;
+    for (int i = 0; i < 7; i++) {
+        glm::dvec2 origin(1234000.0 + i * 611.5, -2346000.0 + i * 301.25);
+        float scale = 1222.99f / (1 << (i % 3));
+        REQUIRE(transforms.add(origin, scale) == size_t(i));
+    }
+    transforms.update(view);
+    REQUIRE(transforms.size() == 7);
+
+    for (int i = 0; i < 7; i++) {
+        glm::dvec2 origin(1234000.0 + i * 611.5, -2346000.0 + i * 301.25);
+        float scale = 1222.99f / (1 << (i % 3));
+
+        glm::mat4 model = glm::scale(glm::mat4(1.0), glm::vec3(scale));
+        auto translation = view.getRelativeToEye(origin);
+        model[3][0] = translation.x;
+        model[3][1] = translation.y;
+        auto mvp = view.getModelViewProjection(model);
+
+        REQUIRE(transforms.translation(i) == translation);
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                REQUIRE(transforms.mvp(i)[c][r] == Approx(mvp[c][r]).epsilon(1e-6));
+            }
+        }
+    }
+
+    transforms.clear();
+    REQUIRE(transforms.size() == 0);
+}
@@ -0,0 +1,315 @@
+#include "catch.hpp"
+
+#include "data/featureFilter.h"
+#include "data/formats/mvt.h"
+#include "data/tileSource.h"
+#include "scene/dataLayer.h"
+#include "tile/tileTask.h"
+#include "util/mapProjection.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Tangram;
+
+// Minimal protobuf writer for test tiles
+struct PbfWriter {
+    std::string buffer;
+
+    void varint(uint64_t _value) {
+        while (_value >= 0x80) {
+            buffer.push_back(char((_value & 0x7f) | 0x80));
+            _value >>= 7;
+        }
+        buffer.push_back(char(_value));
+    }
+    void key(uint32_t _tag, uint32_t _type) { varint((_tag << 3) | _type); }
+    void varintField(uint32_t _tag, uint64_t _value) { key(_tag, 0); varint(_value); }
+    void bytes(uint32_t _tag, const std::string& _bytes) {
+        key(_tag, 2);
+        varint(_bytes.size());
+        buffer += _bytes;
+    }
+    void packed(uint32_t _tag, const std::vector<uint32_t>& _values) {
+        PbfWriter values;
+        for (auto value : _values) { values.varint(value); }
+        bytes(_tag, values.buffer);
+    }
+};
+
+// Layer of point features, each tagged with 'kind' set to the value at _kinds
+static std::string layer(const std::string& _name, const std::vector<std::string>& _values,
+                         const std::vector<uint32_t>& _kinds) {
+    PbfWriter layer;
+    layer.bytes(1, _name);
+    for (auto kind : _kinds) {
+        PbfWriter feature;
+        feature.packed(2, { 0, kind });
+        feature.varintField(3, 1);
+        // moveTo(1) 10,10
+        feature.packed(4, { (1 << 3) | 1, 20, 20 });
+        layer.bytes(2, feature.buffer);
+    }
+    layer.bytes(3, "kind");
+    for (auto& value : _values) {
+        PbfWriter stringValue;
+        stringValue.bytes(1, value);
+        layer.bytes(4, stringValue.buffer);
+    }
+    layer.varintField(5, 4096);
+    return layer.buffer;
+}
+
+static DataLayer dataLayer(const std::string& _name, const std::string& _source, Filter _filter) {
+    return DataLayer(SceneLayer(_name, std::move(_filter), {}, {}, true), _source, { _name });
+}
+
+static Filter kindFilter(const std::string& _kind) {
+    return Filter(Filter::Equality{ "kind", Value(_kind), FilterKeyword::undefined });
+}
+
+TEST_CASE("FeatureFilter keeps the values that any layer of a collection may match", "[Mvt][FeatureFilter]") {
+
+    std::vector<DataLayer> layers;
+    layers.push_back(dataLayer("roads", "mvt", kindFilter("highway")));
+    layers.push_back(dataLayer("roads", "mvt", kindFilter("major_road")));
+    layers.push_back(dataLayer("water", "mvt", Filter()));
+    layers.push_back(dataLayer("places", "other", kindFilter("city")));
+
+    auto filter = FeatureFilter::build(layers, "mvt");
+
+    auto roads = filter->collection("roads");
+    REQUIRE(roads);
+    REQUIRE(roads->key == "kind");
+    std::vector<std::string> values = { "highway", "major_road" };
+    REQUIRE(roads->values == values);
+    REQUIRE(filter->collection("water")->keepAll());
+    REQUIRE(!filter->collection("places"));
+
+    // A layer without the key filter keeps all features of the collection
+    layers.push_back(dataLayer("roads", "mvt", Filter()));
+    REQUIRE(FeatureFilter::build(layers, "mvt")->collection("roads")->keepAll());
+
+    REQUIRE(FeatureFilter::covers(nullptr, filter.get()));
+    REQUIRE(FeatureFilter::covers(filter.get(), filter.get()));
+    REQUIRE(!FeatureFilter::covers(filter.get(), nullptr));
+}
+
+TEST_CASE("Mvt parser skips features that no layer takes", "[Mvt][FeatureFilter]") {
+
+    PbfWriter tile;
+    tile.bytes(3, layer("roads", { "highway", "path" }, { 0, 1, 0 }));
+    tile.bytes(3, layer("buildings", { "house" }, { 0 }));
+
+    std::vector<DataLayer> layers;
+    layers.push_back(dataLayer("roads", "mvt", kindFilter("highway")));
+
+    auto source = std::make_shared<TileSource>("mvt", nullptr);
+    source->setFeatureFilter(FeatureFilter::build(layers, "mvt"));
+
+    TileID tileId(0, 0, 0);
+    BinaryTileTask task(tileId, source, -1);
+    task.rawTileData = ByteBuffer(std::vector<char>(tile.buffer.begin(), tile.buffer.end()));
+
+    MercatorProjection projection;
+    auto tileData = Mvt::parseTile(task, projection, source->id());
+
+    REQUIRE(tileData);
+    REQUIRE(tileData->featureFilter == source->featureFilter());
+    REQUIRE(tileData->columnarLayers.size() == 1);
+    REQUIRE(tileData->columnarLayers[0].name == "roads");
+    REQUIRE(tileData->columnarLayers[0].features.size() == 2);
+
+    // Without filter all features are parsed
+    source->setFeatureFilter(nullptr);
+    BinaryTileTask unfiltered(tileId, source, -1);
+    unfiltered.rawTileData = task.rawTileData;
+
+    tileData = Mvt::parseTile(unfiltered, projection, source->id());
+    REQUIRE(tileData->columnarLayers.size() == 2);
+    REQUIRE(tileData->columnarLayers[0].features.size() == 3);
+}
+
+static DataLayer ruleLayer(const std::string& _name, std::vector<StyleParam> _params) {
+    std::vector<DrawRuleData> rules;
+    rules.emplace_back("points", 0, std::move(_params));
+    return DataLayer(SceneLayer(_name, Filter(), std::move(rules), {}, true), "mvt", { _name });
+}
+
+TEST_CASE("FeatureFilter keeps the properties that the layers read", "[Mvt][FeatureFilter]") {
+
+    std::vector<DataLayer> layers;
+    layers.push_back(dataLayer("roads", "mvt", kindFilter("highway")));
+
+    StyleParam textSource(StyleParamKey::text_source);
+    textSource.value = StyleParam::TextSource{ { PropertyKey("ref") } };
+    layers.push_back(ruleLayer("roads", { textSource }));
+
+    auto filter = FeatureFilter::build(layers, "mvt");
+    REQUIRE(!filter->allProperties);
+    std::vector<std::string> properties = { "height", "kind", "min_height", "name", "ref" };
+    REQUIRE(filter->properties == properties);
+    REQUIRE(filter->keepsProperty("kind"));
+    REQUIRE(!filter->keepsProperty("population"));
+
+    // Functions are resolved with the scene functions
+    StyleParam color(StyleParamKey::color);
+    color.function = 0;
+    layers.push_back(ruleLayer("roads", { color }));
+    REQUIRE(FeatureFilter::build(layers, "mvt")->allProperties);
+
+    std::vector<std::string> functions = { "function() { return feature.colour || feature['alt']; }" };
+    FeatureFilter::Usage usage;
+    usage.functions = &functions;
+    filter = FeatureFilter::build(layers, "mvt", usage);
+    REQUIRE(filter->keepsProperty("colour"));
+    REQUIRE(filter->keepsProperty("alt"));
+    REQUIRE(!filter->keepsProperty("population"));
+
+    functions[0] = "function() { return describe(feature); }";
+    REQUIRE(FeatureFilter::build(layers, "mvt", usage)->allProperties);
+    functions[0] = "function() { return feature.colour; }";
+
+    // Interactive features are picked with all properties, or with the allowlist
+    StyleParam interactive(StyleParamKey::interactive);
+    interactive.value = true;
+    layers.push_back(ruleLayer("roads", { interactive }));
+    REQUIRE(FeatureFilter::build(layers, "mvt", usage)->allProperties);
+
+    std::vector<std::string> picking = { "id" };
+    usage.pickingProperties = &picking;
+    filter = FeatureFilter::build(layers, "mvt", usage);
+    REQUIRE(filter->keepsProperty("id"));
+    REQUIRE(!filter->keepsProperty("population"));
+    REQUIRE(!FeatureFilter::covers(filter.get(), FeatureFilter::build(layers, "mvt").get()));
+
+    usage.allProperties = true;
+    REQUIRE(FeatureFilter::build(layers, "mvt", usage)->allProperties);
+}
+
+TEST_CASE("Mvt parser drops the properties that no layer reads", "[Mvt][FeatureFilter]") {
+
+    PbfWriter layerMsg;
+    layerMsg.bytes(1, "roads");
+    PbfWriter feature;
+    feature.packed(2, { 0, 0, 1, 1, 2, 0 });
+    feature.varintField(3, 1);
+    feature.packed(4, { (1 << 3) | 1, 20, 20 });
+    layerMsg.bytes(2, feature.buffer);
+    for (auto key : { "kind", "population", "name" }) { layerMsg.bytes(3, key); }
+    for (auto value : { "highway", "many" }) {
+        PbfWriter stringValue;
+        stringValue.bytes(1, value);
+        layerMsg.bytes(4, stringValue.buffer);
+    }
+    layerMsg.varintField(5, 4096);
+
+    PbfWriter tile;
+    tile.bytes(3, layerMsg.buffer);
+
+    std::vector<DataLayer> layers;
+    layers.push_back(dataLayer("roads", "mvt", kindFilter("highway")));
+
+    auto source = std::make_shared<TileSource>("mvt", nullptr);
+    source->setFeatureFilter(FeatureFilter::build(layers, "mvt"));
+
+    TileID tileId(0, 0, 0);
+    BinaryTileTask task(tileId, source, -1);
+    task.rawTileData = ByteBuffer(std::vector<char>(tile.buffer.begin(), tile.buffer.end()));
+
+    MercatorProjection projection;
+    auto tileData = Mvt::parseTile(task, projection, source->id());
+
+    REQUIRE(tileData->columnarLayers.size() == 1);
+    auto& layer = tileData->columnarLayers[0];
+    REQUIRE(layer.features.size() == 1);
+
+    std::vector<std::string> keys;
+    for (uint32_t t = layer.features[0].tagsBegin; t < layer.features[0].tagsEnd; t++) {
+        keys.push_back(layer.keys[layer.tags[t].first].name());
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<std::string> kept = { "kind", "name" };
+    REQUIRE(keys == kept);
+}
+
+TEST_CASE("Mvt parser decodes the layers of large tiles in tile order", "[Mvt]") {
+
+    // Large enough to be decoded one layer per job
+    PbfWriter tile;
+    std::vector<std::string> names = { "water", "roads", "buildings" };
+    for (size_t i = 0; i < names.size(); i++) {
+        tile.bytes(3, layer(names[i], { "a", "b" }, std::vector<uint32_t>(10000 * (i + 1), 1)));
+    }
+    REQUIRE(tile.buffer.size() > 256 * 1024);
+
+    auto source = std::make_shared<TileSource>("mvt", nullptr);
+    TileID tileId(0, 0, 0);
+    BinaryTileTask task(tileId, source, -1);
+    task.rawTileData = ByteBuffer(std::vector<char>(tile.buffer.begin(), tile.buffer.end()));
+
+    MercatorProjection projection;
+    auto tileData = Mvt::parseTile(task, projection, source->id());
+
+    REQUIRE(tileData);
+    REQUIRE(tileData->columnarLayers.size() == 3);
+    for (size_t i = 0; i < names.size(); i++) {
+        REQUIRE(tileData->columnarLayers[i].name == names[i]);
+        REQUIRE(tileData->columnarLayers[i].features.size() == 10000 * (i + 1));
+    }
+}
+
+TEST_CASE("Mvt parser returns no data for canceled tasks", "[Mvt]") {
+
+    PbfWriter tile;
+    tile.bytes(3, layer("roads", { "highway" }, { 0, 0 }));
+
+    auto source = std::make_shared<TileSource>("mvt", nullptr);
+    TileID tileId(0, 0, 0);
+    BinaryTileTask task(tileId, source, -1);
+    task.rawTileData = ByteBuffer(std::vector<char>(tile.buffer.begin(), tile.buffer.end()));
+
+    MercatorProjection projection;
+    REQUIRE(Mvt::parseTile(task, projection, source->id()));
+
+    task.cancel();
+    REQUIRE(!Mvt::parseTile(task, projection, source->id()));
+}
+
+TEST_CASE("Mvt decodes long LineTo commands like single points", "[Mvt]") {
+
+    // moveTo(1), lineTo(100) with small, large and repeated deltas
+    std::vector<uint32_t> commands = { (1 << 3) | 1, 200, 300, (100 << 3) | 2 };
+    std::vector<int32_t> deltas;
+    for (int i = 0; i < 200; i++) {
+        int32_t delta = (i % 17 == 0) ? 5000 - i * 50 : (i % 23 == 0) ? 0 : (i % 7) - 3;
+        deltas.push_back(delta);
+        commands.push_back(uint32_t((delta << 1) ^ (delta >> 31)));
+    }
+    PbfWriter geometry;
+    for (auto value : commands) { geometry.varint(value); }
+
+    Mvt::ParserContext ctx(0);
+    ctx.tileExtent = 4096;
+    Mvt::getGeometry(ctx, protobuf::message(geometry.buffer.data(), geometry.buffer.size()));
+
+    std::vector<Point> expected;
+    double invTileExtent = 1.0 / (ctx.tileExtent - 1.0);
+    int64_t x = 100, y = 150;
+    expected.emplace_back(invTileExtent * x, invTileExtent * (ctx.tileExtent - y));
+    for (size_t i = 0; i < deltas.size(); i += 2) {
+        x += deltas[i];
+        y += deltas[i + 1];
+        Point p(invTileExtent * x, invTileExtent * (ctx.tileExtent - y));
+        if (expected.back() != p) { expected.push_back(p); }
+    }
+
+    REQUIRE(ctx.geometry.sizes.size() == 1);
+    REQUIRE(ctx.geometry.sizes[0] == int(expected.size()));
+    REQUIRE(ctx.geometry.coordinates.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(ctx.geometry.coordinates[i] == expected[i]);
+    }
+}
@@ -0,0 +1,344 @@
+#include "catch.hpp"
+
+#include "data/networkDataSource.h"
+#include "data/tileSource.h"
+#include "mockPlatform.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+using namespace Tangram;
+
+// Keeps requests open until the test finishes them
+class DeferredPlatform : public MockPlatform {
+
+public:
+
+    UrlRequestHandle startUrlRequest(Url _url, UrlCallback _callback) override {
+        requests[++count] = std::move(_callback);
+        urls[count] = _url.string();
+        return count;
+    }
+
+    UrlRequestHandle startConditionalUrlRequest(Url _url, const UrlValidators& _validators,
+                                                UrlCallback _callback) override {
+        validators = _validators;
+        return startUrlRequest(_url, _callback);
+    }
+
+    UrlRequestHandle startPrioritizedUrlRequest(Url _url, const UrlValidators& _validators,
+                                                double _priority, UrlCallback _callback) override {
+        priorities.push_back(_priority);
+        return Platform::startPrioritizedUrlRequest(_url, _validators, _priority, _callback);
+    }
+
+    void cancelUrlRequest(UrlRequestHandle _request) override {
+        canceled.push_back(_request);
+        finish(_request, "Request cancelled");
+    }
+
+    void finish(UrlRequestHandle _request, const char* _error = nullptr, int _status = 200) {
+        auto it = requests.find(_request);
+        if (it == requests.end()) { return; }
+        auto callback = std::move(it->second);
+        requests.erase(it);
+
+        UrlResponse response;
+        response.error = _error;
+        response.status = _status;
+        if (!_error && _status == 200) { response.content = { 'x' }; }
+        callback(response);
+    }
+
+    std::map<UrlRequestHandle, UrlCallback> requests;
+    std::map<UrlRequestHandle, std::string> urls;
+    std::vector<UrlRequestHandle> canceled;
+    UrlValidators validators;
+    std::vector<double> priorities;
+    UrlRequestHandle count = 0;
+};
+
+struct Loader {
+    Loader(const std::string& _url = "{z}/{x}/{y}", std::vector<std::string>&& _subdomains = {})
+        : network(platform, _url, std::move(_subdomains), false) {}
+
+    std::shared_ptr<DeferredPlatform> platform = std::make_shared<DeferredPlatform>();
+    std::shared_ptr<TileSource> source = std::make_shared<TileSource>("source", nullptr);
+    NetworkDataSource network;
+    std::vector<TileID> loaded;
+
+    std::shared_ptr<TileTask> load(int _x, double _priority) {
+        TileID id(_x, 0, 10);
+        auto task = std::make_shared<BinaryTileTask>(id, source, 0);
+        task->setPriority(_priority);
+        if (network.loadTileData(task, { [this](std::shared_ptr<TileTask> _task) {
+                        loaded.push_back(_task->tileId()); } })) {
+            task->startedLoading();
+        }
+        return task;
+    }
+};
+
+TEST_CASE("NetworkDataSource starts queued requests by priority", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    std::vector<std::shared_ptr<TileTask>> tasks;
+    for (int i = 0; i < 20; i++) { tasks.push_back(loader.load(i, 100 + i)); }
+
+    REQUIRE(loader.platform->requests.size() == 16);
+
+    // Priorities change after the tasks were queued
+    tasks[19]->setPriority(50);
+    tasks[17]->setPriority(40);
+
+    loader.platform->finish(1);
+
+    REQUIRE(loader.loaded.size() == 1);
+    REQUIRE(loader.platform->requests.size() == 16);
+
+    // The request for tile 17 was started last
+    loader.platform->finish(loader.platform->count);
+    REQUIRE(loader.loaded.back() == TileID(17, 0, 10));
+
+    loader.platform->finish(loader.platform->count);
+    REQUIRE(loader.loaded.back() == TileID(19, 0, 10));
+}
+
+TEST_CASE("NetworkDataSource passes the priority of tasks to the platform", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    loader.load(0, 100);
+    loader.load(1, 1e18);
+
+    REQUIRE(loader.platform->priorities == std::vector<double>({ 100, 1e18 }));
+}
+
+TEST_CASE("NetworkDataSource preempts requests which became unimportant", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    std::vector<std::shared_ptr<TileTask>> tasks;
+    for (int i = 0; i < 16; i++) { tasks.push_back(loader.load(i, 100)); }
+
+    // Less important tasks wait for a free slot
+    auto waiting = loader.load(16, 1000);
+    REQUIRE(loader.platform->canceled.empty());
+    REQUIRE(loader.platform->requests.size() == 16);
+
+    // Tile 0 moved far away from the view
+    tasks[0]->setPriority(1e6);
+
+    auto important = loader.load(17, 100);
+    REQUIRE(loader.platform->canceled.size() == 1);
+    REQUIRE(loader.platform->requests.size() == 16);
+
+    // The preempted task is loaded again by the TileManager
+    REQUIRE(tasks[0]->needsLoading());
+    REQUIRE(loader.loaded.empty());
+
+    loader.platform->finish(loader.platform->count);
+    REQUIRE(loader.loaded.back() == TileID(17, 0, 10));
+}
+
+TEST_CASE("NetworkDataSource drops the least important queued tasks", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    for (int i = 0; i < 16 + 64; i++) { loader.load(i, 100); }
+
+    auto queued = loader.load(100, 200);
+    REQUIRE(queued->needsLoading());
+
+    auto important = loader.load(101, 50);
+    REQUIRE(!important->needsLoading());
+
+    loader.network.cancelLoadingTile(TileID(0, 0, 10));
+    REQUIRE(loader.platform->canceled.size() == 1);
+    REQUIRE(loader.platform->requests.size() == 16);
+    REQUIRE(loader.loaded.empty());
+}
+
+TEST_CASE("NetworkDataSource revalidates cached tiles", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    TileID id(0, 0, 10);
+    auto task = std::make_shared<BinaryTileTask>(id, loader.source, 0);
+    // Validators of a stale copy in the disk cache
+    task->etag = "\"v1\"";
+    task->lastModified = "Tue, 13 Oct 2026 08:00:00 GMT";
+
+    REQUIRE(loader.network.loadTileData(task, { [&](std::shared_ptr<TileTask> _task) {
+                    loader.loaded.push_back(_task->tileId()); } }));
+
+    REQUIRE(loader.platform->validators.etag == "\"v1\"");
+    REQUIRE(loader.platform->validators.lastModified == "Tue, 13 Oct 2026 08:00:00 GMT");
+
+    loader.platform->finish(loader.platform->count, nullptr, 304);
+    REQUIRE(loader.loaded.size() == 1);
+    REQUIRE(task->notModified);
+    REQUIRE(!task->hasData());
+    REQUIRE(task->etag == "\"v1\"");
+}
+
+TEST_CASE("NetworkDataSources with the same URL template share requests", "[NetworkDataSource]") {
+
+    Loader loader;
+    NetworkDataSource other{ loader.platform, "{z}/{x}/{y}", {}, false };
+
+    TileID id(0, 0, 10);
+    auto otherSource = std::make_shared<TileSource>("other", nullptr);
+    auto task = std::make_shared<BinaryTileTask>(id, otherSource, 0);
+
+    std::vector<std::shared_ptr<TileTask>> otherLoaded;
+    REQUIRE(other.loadTileData(task, { [&](std::shared_ptr<TileTask> _task) {
+                    otherLoaded.push_back(_task); } }));
+    loader.load(0, 100);
+    loader.load(1, 100);
+    REQUIRE(loader.platform->requests.size() == 2);
+
+    // The response of the shared request goes to both sources
+    loader.platform->finish(1);
+    REQUIRE(otherLoaded.size() == 1);
+    REQUIRE(loader.loaded.size() == 1);
+    auto& data = static_cast<BinaryTileTask&>(*otherLoaded[0]).rawTileData;
+    REQUIRE(data.size() == 1);
+
+    // Cancelling one source keeps the request of the other
+    TileID secondId(1, 0, 10);
+    auto second = std::make_shared<BinaryTileTask>(secondId, otherSource, 0);
+    other.loadTileData(second, { [&](std::shared_ptr<TileTask> _task) {
+                otherLoaded.push_back(_task); } });
+    loader.network.cancelLoadingTile(TileID(1, 0, 10));
+    REQUIRE(loader.platform->canceled.empty());
+
+    other.cancelLoadingTile(TileID(1, 0, 10));
+    REQUIRE(loader.platform->canceled.size() == 1);
+}
+
+TEST_CASE("NetworkDataSource does not request missing tiles again", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    loader.load(0, 100);
+    loader.platform->finish(loader.platform->count, "HTTP 404", 404);
+    REQUIRE(loader.loaded.size() == 1);
+
+    // Done without a request
+    auto task = loader.load(0, 100);
+    REQUIRE(loader.platform->requests.empty());
+    REQUIRE(loader.platform->count == 1);
+    REQUIRE(loader.loaded.size() == 2);
+    REQUIRE(!task->hasData());
+
+    // Other wraps of the tile are missing as well
+    REQUIRE(loader.network.misses().contains(TileID(0, 0, 10).withWrap(1)));
+}
+
+TEST_CASE("NetworkDataSource backs off from failing hosts", "[NetworkDataSource]") {
+
+    Loader loader;
+
+    auto task = loader.load(0, 100);
+    loader.platform->finish(loader.platform->count, "HTTP 503", 503);
+    REQUIRE(loader.loaded.empty());
+    REQUIRE(task->needsLoading());
+
+    // Not requested while backing off
+    REQUIRE(!loader.network.loadTileData(task, { [](std::shared_ptr<TileTask>) {} }));
+    REQUIRE(loader.platform->requests.empty());
+
+    // The delay doubles with each failure and is reset by a response
+    using Clock = HostBackoff::Clock;
+    HostBackoff backoff(std::chrono::seconds(1), std::chrono::seconds(3));
+    auto now = Clock::now();
+    backoff.failed("host", now);
+    REQUIRE(backoff.isBackingOff("host", now + std::chrono::milliseconds(900)));
+    REQUIRE(!backoff.isBackingOff("host", now + std::chrono::seconds(1)));
+
+    backoff.failed("host", now);
+    REQUIRE(backoff.isBackingOff("host", now + std::chrono::milliseconds(1900)));
+    backoff.failed("host", now);
+    REQUIRE(!backoff.isBackingOff("host", now + std::chrono::seconds(3)));
+    REQUIRE(!backoff.isBackingOff("other", now));
+
+    backoff.succeeded("host");
+    REQUIRE(!backoff.isBackingOff("host", now));
+}
+
+TEST_CASE("TileMissCache drops expired and the oldest entries", "[NetworkDataSource]") {
+
+    using Clock = TileMissCache::Clock;
+    TileMissCache misses(2, std::chrono::seconds(10));
+    auto now = Clock::now();
+
+    misses.add(TileID(0, 0, 1), Clock::duration::zero(), now);
+    misses.add(TileID(1, 0, 1), std::chrono::seconds(1), now);
+    REQUIRE(misses.contains(TileID(1, 0, 1), now));
+    REQUIRE(!misses.contains(TileID(1, 0, 1), now + std::chrono::seconds(1)));
+    REQUIRE(misses.contains(TileID(0, 0, 1), now + std::chrono::seconds(1)));
+
+    misses.add(TileID(1, 1, 1), Clock::duration::zero(), now);
+    misses.add(TileID(0, 1, 1), Clock::duration::zero(), now);
+    REQUIRE(misses.size() == 2);
+    REQUIRE(!misses.contains(TileID(0, 0, 1), now));
+
+    misses.remove(TileID(0, 1, 1));
+    REQUIRE(!misses.contains(TileID(0, 1, 1), now));
+}
+
+TEST_CASE("NetworkDataSource sends requests to healthy subdomains", "[NetworkDataSource]") {
+
+    Loader loader("https://{s}.tiles/{z}/{x}/{y}", { "a", "b", "c" });
+
+    // Without responses the subdomains take turns
+    for (int i = 0; i < 3; i++) { loader.load(i, 100); }
+    REQUIRE(loader.platform->urls[1] == "https://a.tiles/10/0/0");
+    REQUIRE(loader.platform->urls[2] == "https://b.tiles/10/1/0");
+    REQUIRE(loader.platform->urls[3] == "https://c.tiles/10/2/0");
+
+    loader.platform->finish(1, "HTTP 503", 503);
+    loader.platform->finish(2);
+    loader.platform->finish(3);
+
+    // The failed subdomain backs off, tiles go to the others
+    for (int i = 3; i < 9; i++) { loader.load(i, 100); }
+    for (auto& url : loader.platform->urls) {
+        if (url.first > 3) { REQUIRE(url.second.find("https://a.") != 0); }
+    }
+}
+
+TEST_CASE("NetworkDataSource copies slow requests to another subdomain", "[NetworkDataSource]") {
+
+    Loader loader("https://{s}.tiles/{z}/{x}/{y}", { "a", "b" });
+    loader.network.setHedgeRequests(true);
+
+    // Fast responses of both subdomains
+    for (int i = 0; i < 16; i += 2) {
+        loader.load(i, 100);
+        loader.load(i + 1, 100);
+        loader.platform->finish(loader.platform->count - 1);
+        loader.platform->finish(loader.platform->count);
+    }
+    REQUIRE(loader.loaded.size() == 16);
+
+    auto slow = loader.load(16, 100);
+    size_t request = loader.platform->count;
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+
+    // Copied when the next request is dispatched
+    loader.load(17, 100);
+    REQUIRE(loader.platform->count == request + 2);
+    REQUIRE(loader.platform->urls[request + 2].find("tiles/10/16/0") != std::string::npos);
+    REQUIRE(loader.platform->urls[request + 2] != loader.platform->urls[request]);
+
+    // The first response is used, the other request is cancelled
+    loader.platform->finish(request + 2);
+    REQUIRE(loader.loaded.size() == 17);
+    REQUIRE(loader.loaded.back() == TileID(16, 0, 10));
+    REQUIRE(std::find(loader.platform->canceled.begin(), loader.platform->canceled.end(),
+                      request) != loader.platform->canceled.end());
+}
@@ -0,0 +1,40 @@
+#include "catch.hpp"
+
+#include "debug/performanceMonitor.h"
+
+using namespace Tangram;
+
+using Timer = PerformanceMonitor::Timer;
+
+TEST_CASE("PerformanceMonitor computes percentiles of its samples", "[PerformanceMonitor]") {
+
+    PerformanceMonitor monitor;
+
+    REQUIRE(monitor.timing(Timer::render).max == 0);
+
+    for (int i = 1; i <= 100; i++) { monitor.addSample(Timer::render, i); }
+
+    auto timing = monitor.timing(Timer::render);
+    REQUIRE(timing.p50 == 50);
+    REQUIRE(timing.p90 == 90);
+    REQUIRE(timing.p99 == 99);
+    REQUIRE(timing.max == 100);
+    REQUIRE(monitor.average(Timer::render) == Approx(50.5));
+
+    // Other timers are independent
+    REQUIRE(monitor.count(Timer::update) == 0);
+}
+
+TEST_CASE("PerformanceMonitor keeps only the most recent samples", "[PerformanceMonitor]") {
+
+    PerformanceMonitor monitor;
+
+    size_t total = PerformanceMonitor::windowSize + 10;
+    for (size_t i = 0; i < total; i++) { monitor.addSample(Timer::upload, i); }
+
+    auto samples = monitor.samples(Timer::upload);
+    REQUIRE(samples.size() == PerformanceMonitor::windowSize);
+    REQUIRE(samples.front() == 10);
+    REQUIRE(samples.back() == total - 1);
+    REQUIRE(monitor.timing(Timer::upload).max == total - 1);
+}
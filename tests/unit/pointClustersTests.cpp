@@ -0,0 +1,75 @@
+#include "catch.hpp"
+
+#include "data/pointClusters.h"
+
+#include <vector>
+
+using namespace Tangram;
+
+static uint32_t totalCount(const std::vector<PointClusters::Cluster>& _clusters) {
+    uint32_t count = 0;
+    for (auto& cluster : _clusters) { count += cluster.count; }
+    return count;
+}
+
+TEST_CASE("PointClusters merge nearby points at low zoom", "[PointClusters]") {
+
+    // Two groups of points in tile 0/0/0, far apart
+    std::vector<PointClusters::Cluster> points;
+    for (uint64_t i = 0; i < 10; i++) {
+        points.push_back({ { 0.25 + i * 1e-6, 0.25 }, 1, i });
+        points.push_back({ { 0.75, 0.75 + i * 1e-6 }, 1, 100 + i });
+    }
+
+    PointClusters clusters(points, 40, 14, 2);
+    REQUIRE(clusters.maxZoom() == 14);
+
+    std::vector<PointClusters::Cluster> tile;
+    clusters.getTile(0, 0, 0, tile);
+    REQUIRE(tile.size() == 2);
+    REQUIRE(totalCount(tile) == 20);
+    for (auto& cluster : tile) {
+        REQUIRE(cluster.count == 10);
+    }
+
+    // Each group is in its own tile at zoom 1
+    tile.clear();
+    clusters.getTile(1, 0, 0, tile);
+    REQUIRE(tile.size() == 1);
+    REQUIRE(tile[0].pos.x == Approx(0.25 + 4.5e-6));
+
+    // Nothing above the highest cluster zoom
+    tile.clear();
+    clusters.getTile(15, 0, 0, tile);
+    REQUIRE(tile.empty());
+}
+
+TEST_CASE("PointClusters keep single points apart from clusters", "[PointClusters]") {
+
+    std::vector<PointClusters::Cluster> points = {
+        { { 0.5, 0.5 }, 1, 7 },
+        { { 0.5 + 1e-6, 0.5 }, 1, 8 },
+        { { 0.1, 0.1 }, 1, 9 },
+    };
+
+    PointClusters clusters(points, 40, 10, 2);
+
+    std::vector<PointClusters::Cluster> tile;
+    clusters.getTile(0, 0, 0, tile);
+    REQUIRE(tile.size() == 2);
+
+    bool single = false;
+    for (auto& cluster : tile) {
+        if (cluster.count == 1) {
+            REQUIRE(cluster.id == 9);
+            single = true;
+        }
+    }
+    REQUIRE(single);
+
+    // Clusters need more points
+    PointClusters large(points, 40, 10, 3);
+    tile.clear();
+    large.getTile(0, 0, 0, tile);
+    REQUIRE(tile.size() == 3);
+}
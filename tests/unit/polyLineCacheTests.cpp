@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include "util/builders.h"
+
+using namespace Tangram;
+
+struct Vertices {
+    std::vector<glm::vec2>* out;
+    void operator()(const glm::vec2& _coord, const glm::vec2& _enormal, const glm::vec2& _uv) {
+        out->push_back(_coord);
+        out->push_back(_enormal);
+    }
+};
+
+TEST_CASE("PolyLineCache tesselates a line once per builder options", "[PolyLineCache]") {
+
+    Line line = { { 0.1f, 0.1f }, { 0.5f, 0.2f }, { 0.6f, 0.7f } };
+
+    std::vector<glm::vec2> expected;
+    PolyLineBuilderT<Vertices> builder;
+    builder.addVertex = { &expected };
+    builder.cap = CapTypes::round;
+    builder.join = JoinTypes::miter;
+    builder.keepTileEdges = true;
+    builder.closedPolygon = false;
+    Builders::buildPolyLine(line, builder);
+
+    PolyLineCache cache;
+    auto& entry = cache.get(line, builder);
+
+    std::vector<glm::vec2> cached;
+    for (auto& vertex : entry.vertices) {
+        cached.push_back(vertex.coord);
+        cached.push_back(vertex.enormal);
+    }
+    REQUIRE(cached == expected);
+    REQUIRE(entry.indices == builder.indices);
+
+    // The same line and options are not tesselated again
+    REQUIRE(&cache.get(line, builder) == &entry);
+
+    // Round caps take more vertices. Entries are valid until the next get().
+    size_t roundVertices = entry.vertices.size();
+    builder.cap = CapTypes::butt;
+    auto& butt = cache.get(line, builder);
+    REQUIRE(butt.cap == CapTypes::butt);
+    REQUIRE(butt.vertices.size() < roundVertices);
+
+    // Lines of the next feature may have the same address
+    cache.clear();
+    line[2] = { 0.9f, 0.2f };
+    auto& rebuilt = cache.get(line, builder);
+
+    expected.clear();
+    builder.clear();
+    Builders::buildPolyLine(line, builder);
+    REQUIRE(rebuilt.vertices.size() == expected.size() / 2);
+    REQUIRE(rebuilt.vertices.back().coord == expected[expected.size() - 2]);
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+
+#include "gl/shaderProgram.h"
+#include "gl/shaderSource.h"
+#include "gl/vertexLayout.h"
+#include "scene/scene.h"
+#include "style/polygonStyle.h"
+
+using namespace Tangram;
+
+TEST_CASE("Unlit polygon styles leave out normals", "[PolygonStyle][core]") {
+
+    PolygonStyle lit("lit");
+    lit.constructVertexLayout();
+    REQUIRE(lit.useNormals());
+    REQUIRE(lit.vertexLayout()->getStride() == 20);
+
+    PolygonStyle flat("flat");
+    flat.setLightingType(LightingType::none);
+    flat.constructVertexLayout();
+    REQUIRE(!flat.useNormals());
+    REQUIRE(flat.vertexLayout()->getStride() == 16);
+
+    // Shader blocks may read the normal
+    PolygonStyle custom("custom");
+    custom.setLightingType(LightingType::none);
+    custom.getShaderSource().addSourceBlock("normal", "normal = vec3(1.);");
+    custom.constructVertexLayout();
+    REQUIRE(custom.useNormals());
+}
+
+TEST_CASE("Styles with the same shader sources share one program", "[PolygonStyle][core]") {
+
+    Scene scene;
+
+    PolygonStyle a("a");
+    PolygonStyle b("b");
+    PolygonStyle c("c");
+    c.getShaderSource().addSourceBlock("color", "color.rgb = vec3(1.);");
+
+    a.build(scene);
+    b.build(scene);
+    c.build(scene);
+
+    REQUIRE(a.shaderProgram() == b.shaderProgram());
+    REQUIRE(a.shaderProgram() != c.shaderProgram());
+    REQUIRE(scene.shaderProgramCount() == 2);
+    REQUIRE(a.shaderProgram()->getDescription() == "{style:a}");
+}
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#include "data/properties.h"
+#include "data/propertyItem.h"
+
+using namespace Tangram;
+
+TEST_CASE("PropertyKeys with the same name share one atom", "[Core][Properties]") {
+
+    PropertyKey a("kind");
+    PropertyKey b(std::string("kind"));
+    PropertyKey c("kind_detail");
+
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+    REQUIRE(a.name() == "kind");
+    REQUIRE(c.name() == "kind_detail");
+
+    PropertyKey found;
+    REQUIRE(PropertyKey::find("kind", found));
+    REQUIRE(found == a);
+    REQUIRE(!PropertyKey::find("not-interned-property-key", found));
+}
+
+TEST_CASE("Properties are found by name and by key", "[Core][Properties]") {
+
+    Properties props;
+    props.set("name", "civic");
+    props.set("wheel", 4);
+    props.set("name", "accord");
+
+    REQUIRE(props.items().size() == 2);
+
+    REQUIRE(props.getString("name") == "accord");
+    REQUIRE(props.getString(PropertyKey("name")) == "accord");
+    REQUIRE(props.getNumber("wheel") == 4);
+
+    double wheel = 0;
+    REQUIRE(props.getNumber(PropertyKey("wheel"), wheel));
+    REQUIRE(wheel == 4);
+
+    REQUIRE(props.contains(PropertyKey("wheel")));
+    REQUIRE(!props.contains("brand"));
+    REQUIRE(props.get("unknown-property-name").is<none_type>());
+}
+
+TEST_CASE("Shared properties are copied once they are changed", "[Core][Properties]") {
+
+    Properties source;
+    source.set("name", "civic");
+    source.set("wheel", 4);
+    auto items = std::make_shared<const std::vector<Properties::Item>>(source.items());
+
+    Properties a, b;
+    a.setShared(items);
+    b.setShared(items);
+
+    REQUIRE(&a.items() == items.get());
+    REQUIRE(a.getString("name") == "civic");
+    REQUIRE(b.get(PropertyKey("wheel")).get<double>() == 4);
+
+    b.set("name", "accord");
+    REQUIRE(&b.items() != items.get());
+    REQUIRE(b.getString("name") == "accord");
+    REQUIRE(b.getNumber("wheel") == 4);
+    REQUIRE(a.getString("name") == "civic");
+    REQUIRE(items->size() == 2);
+
+    Properties c = a;
+    REQUIRE(&c.items() == items.get());
+    c.clear();
+    REQUIRE(c.items().empty());
+    REQUIRE(a.items().size() == 2);
+}
@@ -0,0 +1,51 @@
+#include "catch.hpp"
+
+#include "util/radixSort.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace Tangram;
+
+struct Item {
+    uint64_t key;
+    uint32_t index;
+};
+
+TEST_CASE("radixSort orders like a stable sort", "[radixSort]") {
+
+    std::mt19937_64 random(7);
+    std::vector<Item> items;
+    for (uint32_t i = 0; i < 5000; i++) {
+        // Keys that share most of their digits and repeat
+        uint64_t key = (random() % 64) << 40 | (random() % 3);
+        items.push_back({ key, i });
+    }
+
+    auto expected = items;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const Item& _a, const Item& _b) { return _a.key < _b.key; });
+
+    std::vector<Item> scratch;
+    radixSort(items, scratch, [](const Item& _item) { return _item.key; });
+
+    REQUIRE(items.size() == expected.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        REQUIRE(items[i].key == expected[i].key);
+        REQUIRE(items[i].index == expected[i].index);
+    }
+}
+
+TEST_CASE("radixSort by a secondary key first orders by both keys", "[radixSort]") {
+
+    std::vector<Item> items = { { 2, 0 }, { 1, 1 }, { 2, 2 }, { 1, 3 }, { 0xffffffffffffffff, 4 } };
+
+    std::vector<Item> scratch;
+    // Secondary: higher indices first
+    radixSort(items, scratch, [](const Item& _item) { return uint64_t(10 - _item.index); });
+    radixSort(items, scratch, [](const Item& _item) { return _item.key; });
+
+    std::vector<uint32_t> order;
+    for (auto& item : items) { order.push_back(item.index); }
+    REQUIRE(order == (std::vector<uint32_t>{ 3, 1, 2, 0, 4 }));
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+
+#include "data/rasterAtlas.h"
+#include "gl/renderState.h"
+
+#include <memory>
+#include <vector>
+
+using namespace Tangram;
+
+static const TextureOptions s_options = {GL_RGBA, GL_RGBA, {GL_LINEAR, GL_LINEAR},
+                                         {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}};
+
+static Texture rasterTexture(unsigned int _size) {
+    Texture texture(_size, _size, s_options);
+    std::vector<GLuint> pixels(_size * _size, 0xff00ff00);
+    texture.setData(pixels.data(), pixels.size());
+    return texture;
+}
+
+TEST_CASE("RasterAtlas hands out slots until full", "[RasterAtlas]") {
+    auto atlas = std::make_shared<RasterAtlas>(s_options, glm::uvec2(64), 2);
+    auto raster = rasterTexture(64);
+
+    REQUIRE(atlas->getWidth() == 128);
+    REQUIRE(atlas->isEmpty());
+
+    std::vector<std::shared_ptr<RasterAtlas::Slot>> slots;
+    for (int i = 0; i < 4; i++) {
+        slots.push_back(atlas->add(raster));
+        REQUIRE(slots.back());
+    }
+    REQUIRE(atlas->isFull());
+    REQUIRE(!atlas->add(raster));
+
+    // Second slot starts at texel 64 in x, inset by half a texel
+    REQUIRE(slots[1]->uvTransform.x == Approx(64.5f / 128.f));
+    REQUIRE(slots[1]->uvTransform.y == Approx(0.5f / 128.f));
+    REQUIRE(slots[1]->uvTransform.z == Approx(63.f / 128.f));
+
+    // Releasing a slot makes it available again
+    uint32_t index = slots[2]->index;
+    slots[2].reset();
+    REQUIRE(!atlas->isFull());
+
+    auto slot = atlas->add(raster);
+    REQUIRE(slot);
+    REQUIRE(slot->index == index);
+}
+
+TEST_CASE("RasterAtlas accepts only rasters of its slot size", "[RasterAtlas]") {
+    auto atlas = std::make_shared<RasterAtlas>(s_options, glm::uvec2(64), 2);
+
+    auto small = rasterTexture(32);
+    REQUIRE(!atlas->accepts(small));
+    REQUIRE(!atlas->add(small));
+
+    // Pixels are gone once a texture is uploaded
+    Texture empty(64, 64, s_options);
+    REQUIRE(!atlas->accepts(empty));
+}
+
+TEST_CASE("RasterAtlas uploads pending slots", "[RasterAtlas]") {
+    RenderState rs;
+    auto atlas = std::make_shared<RasterAtlas>(s_options, glm::uvec2(64), 2);
+    auto raster = rasterTexture(64);
+
+    auto first = atlas->add(raster);
+    auto second = atlas->add(raster);
+    REQUIRE(!atlas->isUploaded());
+
+    atlas->upload(rs, *first);
+    REQUIRE(first->uploaded);
+    REQUIRE(!second->uploaded);
+    REQUIRE(!atlas->isUploaded());
+
+    atlas->update(rs, 0);
+    REQUIRE(second->uploaded);
+}
+
+// Uncompressed 2x2 TGA, red top row and green bottom row
+static std::vector<char> tgaImage() {
+    std::vector<char> tga = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 32, 0x28 };
+    const char red[] = { 0, 0, char(0xff), char(0xff) };
+    const char green[] = { 0, char(0xff), 0, char(0xff) };
+    for (auto* pixel : { red, red, green, green }) { tga.insert(tga.end(), pixel, pixel + 4); }
+    return tga;
+}
+
+TEST_CASE("RasterAtlas flips the slots of rasters decoded top-down", "[RasterAtlas]") {
+    auto atlas = std::make_shared<RasterAtlas>(s_options, glm::uvec2(2), 2);
+
+    Texture flipped(0, 0, s_options);
+    REQUIRE(flipped.loadImageFromMemory(tgaImage()));
+    REQUIRE(!flipped.topDown());
+    REQUIRE(flipped.pixels()[0] == 0xff00ff00);
+
+    Texture raster(0, 0, s_options);
+    REQUIRE(raster.loadImageFromMemory(tgaImage(), false));
+    REQUIRE(raster.topDown());
+    REQUIRE(raster.pixels()[0] == 0xff0000ff);
+
+    auto bottomUp = atlas->add(flipped);
+    auto topDown = atlas->add(raster);
+    REQUIRE(bottomUp->uvTransform.z == Approx(1.f / 4.f));
+    REQUIRE(topDown->uvTransform.y == Approx(1.5f / 4.f));
+    REQUIRE(topDown->uvTransform.z == Approx(-1.f / 4.f));
+}
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include "style/renderQueue.h"
+#include "tile/tile.h"
+#include "util/mapProjection.h"
+
+#include <vector>
+
+using namespace Tangram;
+
+using Entry = RenderQueue::Entry;
+
+static std::vector<uint32_t> order(std::vector<Entry> _entries) {
+    RenderQueue::sort(_entries);
+
+    std::vector<uint32_t> indices;
+    for (auto& e : _entries) { indices.push_back(e.index); }
+    return indices;
+}
+
+TEST_CASE("RenderQueue groups opaque styles by program", "[RenderQueue][core]") {
+
+    std::vector<Entry> entries = {
+        { Blending::opaque, -1, 2, 0 },
+        { Blending::opaque, -1, 1, 1 },
+        { Blending::opaque, 4, 2, 2 },
+        { Blending::opaque, -1, 1, 3 },
+    };
+
+    // The blend order of opaque styles does not matter
+    REQUIRE(order(entries) == std::vector<uint32_t>({ 1, 3, 0, 2 }));
+}
+
+TEST_CASE("RenderQueue keeps the blend constraints of Style::compare", "[RenderQueue][core]") {
+
+    std::vector<Entry> entries = {
+        { Blending::overlay, 3, 1, 0 },
+        { Blending::add, 10, 1, 1 },
+        { Blending::opaque, -1, 2, 2 },
+        { Blending::inlay, 0, 2, 3 },
+        { Blending::overlay, 3, 2, 4 },
+        { Blending::multiply, 10, 2, 5 },
+        { Blending::overlay, 3, 1, 6 },
+        { Blending::opaque, -1, 1, 7 },
+    };
+
+    // Styles only swap within the same blend mode and blend order
+    REQUIRE(order(entries) == std::vector<uint32_t>({ 7, 2, 3, 0, 6, 4, 1, 5 }));
+}
+
+TEST_CASE("RenderQueue draws the tiles nearest to the eye first", "[RenderQueue][core]") {
+
+    MercatorProjection projection;
+    std::vector<std::shared_ptr<Tile>> tiles;
+    for (int x = 0; x < 4; x++) {
+        tiles.push_back(std::make_shared<Tile>(TileID(x, 1, 2), projection));
+    }
+
+    // Center of tile 2/2/1
+    auto& eyeTile = tiles[2];
+    glm::dvec2 eye = eyeTile->getOrigin() + glm::dvec2(eyeTile->getScale() * 0.5);
+
+    RenderQueue::sortFrontToBack(tiles, eye);
+
+    std::vector<int> columns;
+    for (auto& tile : tiles) { columns.push_back(tile->getID().x); }
+    REQUIRE(columns == std::vector<int>({ 2, 1, 3, 0 }));
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+
+#include "labels/repeatGroupIndex.h"
+
+#include <random>
+#include <vector>
+
+using namespace Tangram;
+
+TEST_CASE("RepeatGroupIndex matches a linear scan", "[Labels][RepeatGroupIndex]") {
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> pos(-200, 1200);
+    std::uniform_int_distribution<int> group(1, 4);
+
+    struct Point { size_t group; glm::vec2 position; };
+
+    RepeatGroupIndex index;
+
+    // Run over several frames to check that clear() resets the index
+    for (int frame = 0; frame < 3; frame++) {
+        index.clear();
+
+        std::vector<Point> points;
+        for (int i = 0; i < 300; i++) {
+            Point p{ size_t(group(rng)), { pos(rng), pos(rng) } };
+            points.push_back(p);
+            index.insert(p.group, 100, p.position);
+        }
+
+        for (int i = 0; i < 300; i++) {
+            size_t g = group(rng);
+            glm::vec2 q(pos(rng), pos(rng));
+            // Distances larger than the cell size of the group
+            float distance = (i % 3 == 0) ? 250 : 100;
+
+            bool expected = false;
+            for (auto& p : points) {
+                if (p.group == g && glm::distance(p.position, q) < distance) { expected = true; }
+            }
+
+            REQUIRE(index.within(g, distance, q) == expected);
+        }
+        REQUIRE(index.size() == points.size());
+    }
+
+    index.clear();
+    REQUIRE(!index.within(1, 100, { 0, 0 }));
+}
@@ -0,0 +1,82 @@
+#include "catch.hpp"
+
+#include "mockPlatform.h"
+#include "scene/importer.h"
+#include "scene/sceneCache.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <cstdio>
+
+using namespace Tangram;
+
+static const char* CACHE_PATH = "scene_cache_test.bin";
+
+static std::shared_ptr<MockPlatform> getPlatformWithSceneFiles() {
+    auto platform = std::make_shared<MockPlatform>();
+
+    platform->putMockUrlContents("/root/a.yaml", R"END(
+        import: b.yaml
+        value: a
+        list: [1, { x: 2 }, ~]
+    )END");
+
+    platform->putMockUrlContents("/root/b.yaml", R"END(
+        value: b
+        has_b: true
+        textures: { tex: { url: img/tex.png } }
+    )END");
+
+    return platform;
+}
+
+TEST_CASE("Scene configuration survives binary encoding", "[SceneCache]") {
+    YAML::Node node = YAML::Load(R"END(
+        a: { b: [1, 2, { c: d }], e: ~ }
+        f: 'text'
+    )END");
+
+    std::string data;
+    REQUIRE(SceneCache::encode(node, data));
+
+    YAML::Node decoded;
+    const char* pos = data.data();
+    REQUIRE(SceneCache::decode(pos, data.data() + data.size(), decoded));
+    REQUIRE(pos == data.data() + data.size());
+
+    REQUIRE(decoded["a"]["b"].size() == 3);
+    REQUIRE(decoded["a"]["b"][1].Scalar() == "2");
+    REQUIRE(decoded["a"]["b"][2]["c"].Scalar() == "d");
+    REQUIRE(decoded["a"]["e"].IsNull());
+    REQUIRE(decoded["f"].Scalar() == "text");
+}
+
+TEST_CASE("Scene cache is used while scene files are unchanged", "[SceneCache]") {
+    auto platform = getPlatformWithSceneFiles();
+
+    auto scene = std::make_shared<Scene>(platform, Url("/root/a.yaml"));
+    Importer importer(scene);
+    auto config = importer.applySceneImports(platform);
+
+    REQUIRE(importer.sceneDigests().size() == 2);
+    REQUIRE(SceneCache::write(*scene, CACHE_PATH, importer.sceneDigests(), config));
+
+    YAML::Node cached;
+    auto scene2 = std::make_shared<Scene>(platform, Url("/root/a.yaml"));
+    REQUIRE(SceneCache::read(platform, *scene2, CACHE_PATH, cached));
+
+    CHECK(cached["value"].Scalar() == "a");
+    CHECK(cached["has_b"].Scalar() == "true");
+    CHECK(cached["list"][1]["x"].Scalar() == "2");
+    CHECK(cached["textures"]["tex"]["url"].Scalar() == config["textures"]["tex"]["url"].Scalar());
+
+    // Another scene does not use the cache
+    auto scene3 = std::make_shared<Scene>(platform, Url("/root/b.yaml"));
+    REQUIRE(!SceneCache::read(platform, *scene3, CACHE_PATH, cached));
+
+    // Changes in an imported file invalidate the cache
+    platform->putMockUrlContents("/root/b.yaml", "value: changed");
+    REQUIRE(!SceneCache::read(platform, *scene2, CACHE_PATH, cached));
+
+    std::remove(CACHE_PATH);
+}
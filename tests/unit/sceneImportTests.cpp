@@ -300,3 +300,29 @@ TEST_CASE("Scene load from source string", "[import][core]") {
     CHECK(root["scalar_at_end"].Scalar() == "scalar");
     CHECK(root["null_at_end"].IsNull());
 }
+
+TEST_CASE("Scene files parsed by an earlier load are only reused while unchanged", "[import][core]") {
+    Importer::clearParsedScenes();
+
+    auto platform = getPlatformWithImportFiles();
+    {
+        Importer importer(std::make_shared<Scene>(platform, Url("/root/c.yaml")));
+        auto root = importer.applySceneImports(platform);
+        CHECK(root["has_b"].Scalar() == "true");
+        // Merging must not change the parsed scenes kept for the next load
+        root["has_b"] = "merged";
+    }
+
+    platform->putMockUrlContents("/root/a.yaml", R"END(
+        value: a
+        has_a: changed
+    )END");
+
+    Importer importer(std::make_shared<Scene>(platform, Url("/root/c.yaml")));
+    auto root = importer.applySceneImports(platform);
+
+    CHECK(root["value"].Scalar() == "c");
+    CHECK(root["has_a"].Scalar() == "changed");
+    CHECK(root["has_b"].Scalar() == "true");
+    CHECK(root["has_c"].Scalar() == "true");
+}
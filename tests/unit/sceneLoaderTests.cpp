@@ -56,6 +56,35 @@ TEST_CASE("Correctly instantiate a style from a YAML configuration") {
     REQUIRE(styles[2]->getMaterial().hasSpecular() == false);
 }
 
+TEST_CASE("Dynamic width styles share a width class per width rule") {
+    std::shared_ptr<Platform> platform = std::make_shared<MockPlatform>();
+    std::shared_ptr<Scene> scene = std::make_shared<Scene>(platform, Url());
+
+    scene->styles().emplace_back(new PolylineStyle("lines"));
+
+    YAML::Node node = YAML::Load(R"END(
+        base: lines
+        dynamic_width: true
+        )END");
+
+    SceneLoader::loadStyle(platform, "roads", node, scene);
+
+    auto roads = dynamic_cast<PolylineStyle*>(scene->styles()[1].get());
+    REQUIRE(roads);
+    REQUIRE(roads->dynamicWidth());
+    REQUIRE(!dynamic_cast<PolylineStyle*>(scene->styles()[0].get())->dynamicWidth());
+
+    StyleParam pixels("width", "4px");
+    StyleParam meters("width", "4");
+    StyleParam outline("outline_width", "1px");
+
+    REQUIRE(roads->widthClass(pixels, nullptr) == 0);
+    REQUIRE(roads->widthClass(meters, nullptr) == 1);
+    REQUIRE(roads->widthClass(pixels, &outline) == 2);
+    REQUIRE(roads->widthClass(StyleParam("width", "4px"), nullptr) == 0);
+    REQUIRE(roads->widthClass(meters, &outline) == 3);
+}
+
 TEST_CASE("Test light parameter parsing") {
     YAML::Node node = YAML::Load("position: [100px, 0, 20m]");
 
@@ -71,3 +100,39 @@ TEST_CASE("Test light parameter parsing") {
     REQUIRE(pos.units[1] == Unit::meter);
     REQUIRE(pos.units[2] == Unit::meter);
 }
+
+TEST_CASE("Scene fingerprint changes with the parts of the configuration that changed") {
+    std::shared_ptr<Platform> platform = std::make_shared<MockPlatform>();
+    std::shared_ptr<Scene> scene = std::make_shared<Scene>(platform, Url());
+
+    const char* yaml = R"END(
+        sources:
+            osm: { type: MVT, url: "https://tiles/{z}/{x}/{y}.mvt" }
+            other: { type: GeoJSON, url: "data.json" }
+        styles:
+            roads: { base: lines }
+        layers:
+            earth: { data: { source: osm } }
+        )END";
+
+    scene->config() = YAML::Load(yaml);
+    auto fingerprint = SceneLoader::computeFingerprint(*scene);
+
+    REQUIRE(!fingerprint.scene.empty());
+    REQUIRE(fingerprint.sources.size() == 2);
+    REQUIRE(fingerprint.styles.count("roads") == 1);
+
+    // Stable for the same configuration
+    scene->config() = YAML::Load(yaml);
+    REQUIRE(SceneLoader::computeFingerprint(*scene).scene == fingerprint.scene);
+
+    scene->config()["sources"]["other"]["url"] = "other.json";
+    auto changed = SceneLoader::computeFingerprint(*scene);
+    REQUIRE(changed.scene != fingerprint.scene);
+    REQUIRE(changed.sources["osm"] == fingerprint.sources["osm"]);
+    REQUIRE(changed.sources["other"] != fingerprint.sources["other"]);
+    REQUIRE(changed.styles == fingerprint.styles);
+
+    scene->config()["layers"]["earth"]["data"]["source"] = "other";
+    REQUIRE(SceneLoader::computeFingerprint(*scene).scene != changed.scene);
+}
@@ -249,3 +249,49 @@ TEST_CASE("Scene update statuses") {
     CHECK(scene.errors.front().error == Error::scene_update_value_yaml_syntax_error);
     scene.errors.clear();
 }
+
+TEST_CASE("Classify scene updates by the parts of the scene they affect") {
+    auto platform_mock = std::make_shared<MockPlatform>();
+    Scene scene(platform_mock, Url());
+    REQUIRE(loadConfig(R"END(
+global:
+    width: 2
+    url: https://example.com/tiles
+sources:
+    osm:
+        url: global.url
+styles:
+    a:
+        base: polygons
+        shaders:
+            uniforms:
+                u_value: 1
+    b:
+        mix: a
+    c:
+        base: lines
+        shaders:
+            uniforms:
+                u_value: 1
+layers:
+    roads:
+        draw:
+            c:
+                width: global.width
+)END", scene.config()));
+    SceneLoader::applyGlobals(scene.config(), scene);
+
+    using Level = SceneLoader::UpdateLevel;
+
+    CHECK(SceneLoader::classifyUpdates(scene, {{"styles.c.shaders.uniforms.u_value", "2"}}) == Level::uniforms);
+    // Style 'b' has a mixed copy of the uniforms of 'a'
+    CHECK(SceneLoader::classifyUpdates(scene, {{"styles.a.shaders.uniforms.u_value", "2"}}) == Level::styling);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"styles.c.shaders", "{}"}}) == Level::styling);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"layers.roads.draw.c.width", "3"}}) == Level::styling);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"global.width", "3"}}) == Level::styling);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"global.url", "https://example.org"}}) == Level::full);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"global", "{}"}}) == Level::full);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"sources.osm.url", "https://example.org"}}) == Level::full);
+    CHECK(SceneLoader::classifyUpdates(scene, {{"styles.c.shaders.uniforms.u_value", "2"},
+                                               {"layers.roads.draw.c.width", "3"}}) == Level::styling);
+}
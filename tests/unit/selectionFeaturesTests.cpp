@@ -0,0 +1,52 @@
+#include "catch.hpp"
+
+#include "data/properties.h"
+#include "data/propertyItem.h"
+#include "selection/featureSelection.h"
+#include "selection/selectionFeatures.h"
+
+using namespace Tangram;
+
+TEST_CASE("SelectionFeatures returns the properties of each color", "[SelectionFeatures]") {
+
+    FeatureSelection selection;
+    SelectionFeatures features;
+
+    std::vector<uint32_t> colors;
+    for (int i = 0; i < 100; i++) {
+        Properties properties;
+        properties.set("kind", i % 2 ? "building" : "park");
+        properties.set("id", double(i));
+        properties.sort();
+        properties.sourceId = 3;
+
+        uint32_t color = features.nextColor(selection);
+        REQUIRE(color != 0);
+        colors.push_back(color);
+
+        // A color without properties, e.g. of a feature no style was built for
+        if (i == 50) { continue; }
+        features.set(color, properties);
+    }
+    features.finish();
+
+    REQUIRE(features.size() == 99);
+
+    // Colors of other tiles are taken from their own ranges
+    REQUIRE(features.get(selection.nextColorIdentifier()) == nullptr);
+    REQUIRE(features.get(colors[50]) == nullptr);
+
+    auto properties = features.get(colors[41]);
+    REQUIRE(properties);
+    REQUIRE(properties->getString("kind") == "building");
+    REQUIRE(properties->getNumber("id") == 41);
+    REQUIRE(properties->sourceId == 3);
+}
+
+TEST_CASE("FeatureSelection reserves ranges without zero", "[SelectionFeatures]") {
+
+    FeatureSelection selection;
+    uint32_t first = selection.reserveColors(64);
+    REQUIRE(first != 0);
+    REQUIRE(selection.reserveColors(64) == first + 64);
+}
@@ -0,0 +1,96 @@
+#include "catch.hpp"
+
+#include "debug/sessionRecorder.h"
+#include "mockPlatform.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Tangram;
+
+TEST_CASE("SessionRecorder reads back its serialized events", "[SessionRecorder]") {
+
+    SessionRecorder recorder;
+    recorder.record("setZoom", 12.5f);
+
+    recorder.start();
+    recorder.record("setPosition", -74.00976419448854, 40.70532700869127);
+    // Arguments may hold delimiters and binary data
+    recorder.record("loadSceneYaml", std::string("a: 1\nb: 2"), "", true);
+    recorder.record("response", std::string("x\0 4:y\n", 7));
+    recorder.stop();
+    recorder.record("setZoom", 13.f);
+
+    std::vector<SessionEvent> events;
+    REQUIRE(SessionRecorder::parse(recorder.serialize(), events));
+
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].name == "setPosition");
+    REQUIRE(std::stod(events[0].args[0]) == -74.00976419448854);
+    REQUIRE(std::stod(events[0].args[1]) == 40.70532700869127);
+    std::vector<std::string> sceneArgs = { "a: 1\nb: 2", "", "1" };
+    REQUIRE(events[1].args == sceneArgs);
+    REQUIRE(events[2].args[0] == std::string("x\0 4:y\n", 7));
+    REQUIRE(events[0].time <= events[2].time);
+
+    REQUIRE(!SessionRecorder::parse("0 update 1 5:1", events));
+}
+
+TEST_CASE("RecordingPlatform records network responses", "[SessionRecorder]") {
+
+    auto mockPlatform = std::make_shared<MockPlatform>();
+    mockPlatform->putMockUrlContents(Url("https://tiles/0/0/0.mvt"), "tile");
+
+    auto recorder = std::make_shared<SessionRecorder>();
+    RecordingPlatform platform(mockPlatform, recorder);
+
+    recorder->start();
+    std::string content;
+    platform.startUrlRequest(Url("https://tiles/0/0/0.mvt"), [&](UrlResponse _response) {
+        content.assign(_response.content.begin(), _response.content.end());
+    });
+
+    REQUIRE(content == "tile");
+    auto events = recorder->events();
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].name == "response");
+    REQUIRE(events[0].args[0] == "https://tiles/0/0/0.mvt");
+    REQUIRE(events[0].args.back() == "tile");
+}
+
+TEST_CASE("ReplayPlatform delivers responses after the recorded latency", "[SessionRecorder]") {
+
+    SessionEvent response;
+    response.time = 20;
+    response.name = "response";
+    response.args = { "https://tiles/0/0/0.mvt", "50", "0", "", "200", "", "", "-1", "tile" };
+
+    ReplayPlatform platform({ response });
+    platform.deliverResponses(10);
+
+    int responses = 0;
+    std::string content;
+    platform.startUrlRequest(Url("https://tiles/0/0/0.mvt"), [&](UrlResponse _response) {
+        REQUIRE(_response.error == nullptr);
+        REQUIRE(_response.status == 200);
+        content.assign(_response.content.begin(), _response.content.end());
+        responses++;
+    });
+
+    platform.deliverResponses(40);
+    REQUIRE(responses == 0);
+
+    platform.deliverResponses(60);
+    REQUIRE(responses == 1);
+    REQUIRE(content == "tile");
+
+    // A request the recording has no response for fails
+    bool failed = false;
+    platform.startUrlRequest(Url("https://tiles/0/0/0.mvt"), [&](UrlResponse _response) {
+        failed = _response.error != nullptr;
+    });
+    platform.deliverResponses(60);
+    REQUIRE(failed);
+    REQUIRE(platform.misses() == 1);
+}
@@ -0,0 +1,30 @@
+#include "catch.hpp"
+
+#include "gl/hardware.h"
+#include "gl/renderState.h"
+#include "gl/shaderProgram.h"
+
+using namespace Tangram;
+
+TEST_CASE("ShaderProgram builds wait for the build time budget of the frame", "[ShaderProgram]") {
+
+    RenderState rs;
+    ShaderProgram program;
+    program.setShaderSource("void main() {}\n", "void main() {}\n");
+
+    Hardware::supportsParallelShaderCompile = false;
+
+    // Another program took the budget of this frame
+    rs.countProgramBuild(ShaderProgram::BUILD_TIME_BUDGET);
+    REQUIRE(!program.isReady(rs));
+    REQUIRE(rs.frameStats().programBuilds == 1);
+
+    // The first build of a frame always proceeds
+    rs.resetFrameStats();
+    REQUIRE(program.isReady(rs));
+    REQUIRE(rs.frameStats().programBuilds == 1);
+
+    // Built programs stay ready
+    rs.countProgramBuild(ShaderProgram::BUILD_TIME_BUDGET);
+    REQUIRE(program.isReady(rs));
+}
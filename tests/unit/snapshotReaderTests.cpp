@@ -0,0 +1,49 @@
+#include "catch.hpp"
+
+#include "gl/snapshotReader.h"
+
+#include <vector>
+
+using namespace Tangram;
+
+static unsigned int rgba(unsigned int r, unsigned int g, unsigned int b, unsigned int a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+TEST_CASE("Snapshot rows are flipped to start from the top", "[SnapshotReader]") {
+
+    // 3 x 2 pixels as read by GL, the bottom row first
+    std::vector<unsigned int> pixels = { 1, 2, 3, 4, 5, 6 };
+
+    std::vector<unsigned int> out;
+    int width = 0, height = 0;
+    SnapshotReader::downsample(pixels.data(), 3, 2, 1, out, width, height);
+
+    REQUIRE(width == 3);
+    REQUIRE(height == 2);
+    REQUIRE(out == std::vector<unsigned int>({ 4, 5, 6, 1, 2, 3 }));
+}
+
+TEST_CASE("Downsampled snapshots average the channels of each block", "[SnapshotReader]") {
+
+    // 3 x 3 pixels, the blocks of the right column and the bottom row are partial
+    std::vector<unsigned int> pixels = {
+        rgba(0, 0, 0, 255),   rgba(200, 0, 0, 255), rgba(0, 0, 90, 255),
+        rgba(100, 0, 0, 255), rgba(0, 40, 0, 255),  rgba(0, 0, 30, 255),
+        rgba(0, 10, 0, 255),  rgba(0, 30, 0, 255),  rgba(1, 2, 3, 4),
+    };
+
+    std::vector<unsigned int> out;
+    int width = 0, height = 0;
+    SnapshotReader::downsample(pixels.data(), 3, 3, 2, out, width, height);
+
+    REQUIRE(width == 2);
+    REQUIRE(height == 2);
+    REQUIRE(out.size() == 4);
+
+    // The top row of the image is the last row read by GL
+    CHECK(out[0] == rgba(25, 20, 0, 255));
+    CHECK(out[1] == rgba(1, 1, 17, 130));
+    CHECK(out[2] == rgba(100, 0, 0, 255));
+    CHECK(out[3] == rgba(0, 0, 90, 255));
+}
@@ -0,0 +1,35 @@
+#include "catch.hpp"
+
+#include "scene/spriteAtlas.h"
+
+using namespace Tangram;
+
+TEST_CASE("Sprites are found by the handles of their names", "[SpriteAtlas]") {
+
+    SpriteNames names;
+    REQUIRE(names.handle("a") == 0);
+    REQUIRE(names.handle("b") == 1);
+    REQUIRE(names.handle("a") == 0);
+    REQUIRE(names.size() == 2);
+
+    SpriteAtlas atlas;
+    atlas.addSpriteNode("b", {16, 0}, {8, 8}, names.handle("b"));
+    atlas.addSpriteNode("c", {0, 16}, {4, 4}, names.handle("c"));
+    atlas.updateSpriteNodes({32, 32});
+
+    // 'a' is a sprite name of a draw rule which is not in this atlas
+    REQUIRE(atlas.findSpriteNode(names.handle("a")) == nullptr);
+    REQUIRE(atlas.findSpriteNode(SpriteNames::none) == nullptr);
+
+    const SpriteNode* b = atlas.findSpriteNode(names.handle("b"));
+    REQUIRE(b != nullptr);
+    REQUIRE(b == atlas.findSpriteNode("b"));
+    REQUIRE(b->m_size == glm::vec2(8, 8));
+    REQUIRE(b->m_uvBL == glm::vec2(0.5f, 1.f));
+
+    REQUIRE(atlas.findSpriteNode(names.handle("c"))->m_origin == glm::vec2(0, 16));
+
+    SpriteNode node;
+    REQUIRE(atlas.getSpriteNode("c", node));
+    REQUIRE_FALSE(atlas.getSpriteNode("a", node));
+}
@@ -4,6 +4,8 @@
 #include "yaml-cpp/yaml.h"
 #include "util/mapProjection.h"
 
+#include <cmath>
+
 using namespace Tangram;
 
 Stops instance_color() {
@@ -94,6 +96,23 @@ TEST_CASE("Stops evaluate color values correctly at and between key frames", "[S
 
 }
 
+TEST_CASE("Color mix interpolates each channel of packed colors", "[Stops]") {
+
+    Color x(0, 64, 200, 255);
+    Color y(255, 0, 100, 10);
+
+    REQUIRE(Color::mix(x, y, 0.f).abgr == x.abgr);
+    REQUIRE(Color::mix(x, y, 1.f).abgr == y.abgr);
+
+    for (float a = 0.f; a <= 1.f; a += 1.f / 64) {
+        Color c = Color::mix(x, y, a);
+        REQUIRE(std::abs(c.r - (x.r * (1 - a) + y.r * a)) <= 1.f);
+        REQUIRE(std::abs(c.g - (x.g * (1 - a) + y.g * a)) <= 1.f);
+        REQUIRE(std::abs(c.b - (x.b * (1 - a) + y.b * a)) <= 1.f);
+        REQUIRE(std::abs(c.a - (x.a * (1 - a) + y.a * a)) <= 1.f);
+    }
+}
+
 TEST_CASE("Stops parses correctly from YAML distance values", "[Stops][YAML]") {
 
     YAML::Node node = YAML::Load("[ [10, 0], [16, .04], [18, .2], [19, .2] ]");
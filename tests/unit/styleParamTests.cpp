@@ -0,0 +1,36 @@
+#include "catch.hpp"
+
+#include "scene/styleParam.h"
+
+using namespace Tangram;
+
+TEST_CASE("StyleParam parses hex colors like component colors", "[StyleParam][core]") {
+
+    // Color sequences are joined with trailing commas, see parseSequence
+    REQUIRE(StyleParam::parseColor("#ff0000") == StyleParam::parseColor("1.0,0.0,0.0,"));
+    REQUIRE(StyleParam::parseColor("#0f0") == StyleParam::parseColor("0,1,0,"));
+    REQUIRE(StyleParam::parseColor("#00F") == StyleParam::parseColor("#0000ff"));
+    REQUIRE(StyleParam::parseColor("#fff") != StyleParam::parseColor("#ffe"));
+}
+
+TEST_CASE("StyleParam values are the same when parsed again", "[StyleParam][core]") {
+
+    for (int i = 0; i < 2; i++) {
+        StyleParam width("width", "3px");
+        REQUIRE(width.value.is<StyleParam::Width>());
+        REQUIRE(width.value.get<StyleParam::Width>().value == 3.f);
+        REQUIRE(width.value.get<StyleParam::Width>().unit == Unit::pixel);
+
+        StyleParam meters("width", "3");
+        REQUIRE(meters.value.get<StyleParam::Width>().unit == Unit::meter);
+
+        StyleParam offset("offset", "2px, 5px");
+        REQUIRE(offset.value.get<glm::vec2>() == glm::vec2(2.f, 5.f));
+
+        // The same string is parsed for each key
+        StyleParam buffer("buffer", "2px");
+        REQUIRE(buffer.value.get<glm::vec2>() == glm::vec2(2.f, 2.f));
+        StyleParam textOffset("text:offset", "2px");
+        REQUIRE(std::isnan(textOffset.value.get<glm::vec2>().y));
+    }
+}
@@ -1,14 +1,19 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include "gl/hardware.h"
 #include "gl/texture.h"
 
+#include <cstring>
+
 using namespace Tangram;
 
 class TestTexture : public Texture {
 public:
     using Texture::Texture;
     const std::vector<DirtyRange>& dirtyRanges() { return m_dirtyRanges; }
+    using Texture::packPixels;
+    const std::vector<std::vector<unsigned char>>& levels() { return m_levels; }
 };
 
 TEST_CASE("Merging of dirty Regions - Non overlapping, test ordering", "[Texture]") {
@@ -113,3 +118,123 @@ TEST_CASE("Merging of dirty Regions - Merge three regions, when 3rd region is ad
     }
 
 }
+
+static std::vector<char> ktxData(uint32_t _format, uint32_t _width, uint32_t _height,
+                                 const std::vector<uint32_t>& _levelSizes) {
+    const char identifier[12] = {
+        '\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n'
+    };
+    uint32_t header[13] = { 0x04030201, 0, 1, 0, _format, 0, _width, _height, 0, 0, 1,
+                            uint32_t(_levelSizes.size()), 0 };
+
+    std::vector<char> data(identifier, identifier + sizeof(identifier));
+    data.insert(data.end(), (char*)header, (char*)header + sizeof(header));
+    for (uint32_t size : _levelSizes) {
+        data.insert(data.end(), (char*)&size, (char*)&size + sizeof(size));
+        data.resize(data.size() + ((size + 3) & ~3u), 0);
+    }
+    return data;
+}
+
+TEST_CASE("Load compressed KTX textures", "[Texture]") {
+    // 64x64 ETC2 RGB with 8 bytes per 4x4 block and two mip levels
+    auto data = ktxData(GL_COMPRESSED_RGB8_ETC2, 64, 64, { 2048, 512 });
+    REQUIRE(Texture::isKTX(data.data(), data.size()));
+
+    Hardware::supportsETC2 = false;
+    {
+        Texture texture(0, 0);
+        REQUIRE(!texture.loadImageFromMemory(data));
+    }
+
+    Hardware::supportsETC2 = true;
+    {
+        Texture texture(0, 0);
+        REQUIRE(texture.loadImageFromMemory(data));
+        REQUIRE(texture.getWidth() == 64);
+        REQUIRE(texture.getHeight() == 64);
+        REQUIRE(texture.bufferSize() == 2560);
+    }
+    {
+        // Level data missing
+        data.resize(data.size() - 100);
+        Texture texture(0, 0);
+        REQUIRE(!texture.loadImageFromMemory(data));
+    }
+    Hardware::supportsETC2 = false;
+}
+
+TEST_CASE("RGB565 textures are set as RGBA and packed for upload", "[Texture]") {
+    TextureOptions options = {GL_RGB, GL_RGB, {GL_LINEAR, GL_LINEAR}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
+                              GL_UNSIGNED_SHORT_5_6_5};
+    TestTexture texture(3, 2, options);
+
+    REQUIRE(texture.bytesPerPixel() == 4);
+    REQUIRE(texture.bufferSize() == 3 * 2 * 2);
+
+    // Red, green and blue, then white
+    std::vector<GLuint> pixels = { 0xff0000ff, 0xff00ff00, 0xffff0000,
+                                   0xffffffff, 0xffffffff, 0xffffffff };
+    texture.setSubData(pixels.data(), 0, 0, 3, 2, 3);
+
+    auto* packed = static_cast<const uint16_t*>(
+        texture.packPixels(reinterpret_cast<const unsigned char*>(pixels.data()), 0, 0, 3, 2));
+    REQUIRE(packed[0] == 0xf800);
+    REQUIRE(packed[1] == 0x07e0);
+    REQUIRE(packed[2] == 0x001f);
+    // Rows are aligned to 4 bytes
+    REQUIRE(packed[4] == 0xffff);
+    REQUIRE(packed[6] == 0xffff);
+}
+
+TEST_CASE("Mip levels are prepared before the upload", "[Texture]") {
+    TextureOptions options = {GL_RGBA, GL_RGBA, {GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR},
+                              {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE}};
+    TestTexture texture(4, 2, options, true);
+
+    // Black and white columns, then a red row
+    std::vector<GLuint> pixels = { 0xff000000, 0xffffffff, 0xff000000, 0xffffffff,
+                                   0xff0000ff, 0xff0000ff, 0xff0000ff, 0xff0000ff };
+    texture.setData(pixels.data(), pixels.size());
+    REQUIRE(texture.levels().empty());
+
+    texture.prepareLevels();
+    REQUIRE(texture.levels().size() == 3);
+    // Level 0 is uploaded from the pixels of the texture
+    REQUIRE(texture.levels()[0].empty());
+    REQUIRE(texture.levels()[1].size() == 2 * 1 * 4);
+    REQUIRE(texture.levels()[2].size() == 1 * 1 * 4);
+
+    // Averages of black, white and two red pixels
+    auto& level1 = texture.levels()[1];
+    REQUIRE(int(level1[0]) == 0xbf);
+    REQUIRE(int(level1[1]) == 0x40);
+    REQUIRE(int(level1[2]) == 0x40);
+    REQUIRE(int(level1[3]) == 0xff);
+    REQUIRE(int(texture.levels()[2][0]) == 0xbf);
+
+    REQUIRE(texture.bufferSize() == 4 * 2 * 4 + 4 * 2 * 4 / 3);
+
+    // Changes to the data drop the prepared levels
+    texture.setSubData(pixels.data(), 0, 0, 4, 1, 4);
+    REQUIRE(texture.levels().empty());
+}
+
+TEST_CASE("RGB565 textures are packed before the upload", "[Texture]") {
+    TextureOptions options = {GL_RGB, GL_RGB, {GL_LINEAR, GL_LINEAR}, {GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
+                              GL_UNSIGNED_SHORT_5_6_5};
+    TestTexture texture(3, 1, options);
+
+    std::vector<GLuint> pixels = { 0xff0000ff, 0xff00ff00, 0xffff0000 };
+    texture.setData(pixels.data(), pixels.size());
+    texture.prepareLevels();
+
+    REQUIRE(texture.levels().size() == 1);
+    // Rows are aligned to 4 bytes
+    REQUIRE(texture.levels()[0].size() == 8);
+
+    auto* packed = reinterpret_cast<const uint16_t*>(texture.levels()[0].data());
+    REQUIRE(packed[0] == 0xf800);
+    REQUIRE(packed[1] == 0x07e0);
+    REQUIRE(packed[2] == 0x001f);
+}
@@ -0,0 +1,151 @@
+#include "catch.hpp"
+
+#include "data/tileData.h"
+#include "gl/hardware.h"
+#include "gl/mesh.h"
+#include "gl/renderState.h"
+#include "style/polygonStyle.h"
+#include "tile/tile.h"
+#include "tile/tileCache.h"
+#include "util/mapProjection.h"
+
+using namespace Tangram;
+
+struct Vertex {
+    float x, y;
+};
+
+static MercatorProjection s_projection;
+
+static std::shared_ptr<VertexLayout> s_layout = std::shared_ptr<VertexLayout>(new VertexLayout({
+    {"a_position", 2, GL_FLOAT, false, 0},
+}));
+
+static std::shared_ptr<Tile> newTile(TileID _id, const Style& _style, size_t _quads) {
+    MeshData<Vertex> meshData;
+    for (size_t q = 0; q < _quads; q++) {
+        meshData.vertices.insert(meshData.vertices.end(), { {0, 0}, {1, 0}, {0, 1}, {1, 1} });
+        meshData.indices.insert(meshData.indices.end(), { 0, 1, 2, 2, 1, 3 });
+        meshData.offsets.emplace_back(6, 4);
+    }
+    auto mesh = std::make_shared<Mesh<Vertex>>(s_layout, GL_TRIANGLES);
+    mesh->compile(meshData);
+
+    auto tile = std::make_shared<Tile>(_id, s_projection);
+    tile->initGeometry(1);
+    tile->setMesh(_style, std::move(mesh));
+    return tile;
+}
+
+static std::shared_ptr<TileData> newTileData(size_t _features) {
+    auto data = std::make_shared<TileData>();
+    data->layers.emplace_back("layer");
+    data->layers.back().features.resize(_features);
+    return data;
+}
+
+TEST_CASE("Tile cache moves meshes of cached tiles into CPU memory beyond its GPU limit", "[TileCache]") {
+
+    RenderState rs;
+    PolygonStyle style("polygon");
+    style.setID(0);
+
+    bool supported = Hardware::supportsMapBufferRange;
+    Hardware::supportsMapBufferRange = true;
+
+    TileCache cache(1024 * 1024);
+
+    auto older = newTile(TileID(0, 0, 1), style, 10);
+    auto newer = newTile(TileID(1, 0, 1), style, 10);
+    older->upload(rs, 0);
+    newer->upload(rs, 0);
+    size_t meshBytes = older->getMemoryUsage();
+    REQUIRE(meshBytes > 0);
+
+    cache.put(0, older);
+    cache.put(0, newer);
+    REQUIRE(cache.getGpuMemoryUsage() == 2 * meshBytes);
+    uint64_t total = cache.getMemoryUsage();
+
+    // Without limits nothing moves
+    REQUIRE(cache.applyResidency(rs, 1 << 20) == 0);
+
+    cache.setResidencyLimits(meshBytes, 0);
+
+    // The least recently used tile goes first, the sum stays the same
+    REQUIRE(cache.applyResidency(rs, 1 << 20) == meshBytes);
+    REQUIRE(cache.getGpuMemoryUsage() == meshBytes);
+    REQUIRE(cache.getMemoryUsage() == total);
+    REQUIRE(cache.getStats().releasedGpuBytes == meshBytes);
+    REQUIRE(!older->isUploaded());
+    REQUIRE(newer->isUploaded());
+
+    // Within the limit now
+    REQUIRE(cache.applyResidency(rs, 1 << 20) == 0);
+
+    // Taken from the cache, the tile is uploaded again
+    auto tile = cache.get(0, TileID(0, 0, 1));
+    REQUIRE(tile == older);
+    REQUIRE(tile->getMemoryUsage() == 0);
+    REQUIRE(tile->upload(rs, 0) == meshBytes);
+    REQUIRE(tile->isUploaded());
+    REQUIRE(tile->getMemoryUsage() == meshBytes);
+
+    Hardware::supportsMapBufferRange = supported;
+}
+
+TEST_CASE("Tile cache keeps meshes on the GPU which other tiles share", "[TileCache]") {
+
+    RenderState rs;
+    PolygonStyle style("polygon");
+    style.setID(0);
+
+    bool supported = Hardware::supportsMapBufferRange;
+    Hardware::supportsMapBufferRange = true;
+
+    TileCache cache(1024 * 1024);
+    cache.setResidencyLimits(1, 0);
+
+    auto tile = newTile(TileID(0, 0, 1), style, 10);
+    tile->upload(rs, 0);
+    auto copy = tile->copyForWrap(1);
+
+    cache.put(0, tile);
+    REQUIRE(cache.applyResidency(rs, 1 << 20) == 0);
+    REQUIRE(tile->isUploaded());
+    REQUIRE(copy->isUploaded());
+
+    Hardware::supportsMapBufferRange = supported;
+}
+
+TEST_CASE("Tile cache drops tile data of cached tiles beyond its CPU limit", "[TileCache]") {
+
+    RenderState rs;
+    PolygonStyle style("polygon");
+    style.setID(0);
+
+    TileCache cache(1024 * 1024);
+
+    auto older = newTile(TileID(0, 0, 1), style, 1);
+    auto newer = newTile(TileID(1, 0, 1), style, 1);
+    older->setTileData(newTileData(100));
+    newer->setTileData(newTileData(100));
+    older->upload(rs, 0);
+    newer->upload(rs, 0);
+
+    cache.put(0, older);
+    cache.put(0, newer);
+    uint64_t gpuBytes = cache.getGpuMemoryUsage();
+    uint64_t cpuBytes = cache.getCpuMemoryUsage();
+    size_t dataBytes = newTileData(100)->memoryUsage();
+
+    cache.setResidencyLimits(0, cpuBytes - 1);
+    REQUIRE(cache.applyResidency(rs, 1 << 20) == 0);
+
+    REQUIRE(!older->getTileData());
+    REQUIRE(newer->getTileData());
+    REQUIRE(cache.getCpuMemoryUsage() == cpuBytes - dataBytes);
+    REQUIRE(cache.getGpuMemoryUsage() == gpuBytes);
+    REQUIRE(cache.getStats().releasedCpuBytes == dataBytes);
+    REQUIRE(older->isUploaded());
+}
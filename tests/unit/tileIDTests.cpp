@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
+#include "tile/tileHash.h"
 #include "tile/tileID.h"
+#include <map>
 #include <set>
 
 using namespace Tangram;
@@ -144,3 +146,57 @@ TEST_CASE("TileID correctly applies source zoom limits for scaled tiles", "[Core
     REQUIRE(g == TileID(8, 4, 6, 10, 0));
 
 }
+
+TEST_CASE( "TileIDMap finds, replaces and erases tiles like std::map", "[Core][TileID]" ) {
+
+    TileIDMap<int> map;
+    std::map<TileID, int> reference;
+
+    // Overzoomed and wrapped tiles share x, y and z
+    for (int i = 0; i < 500; i++) {
+        TileID id(i % 40, i / 40, 12, 12 + i % 3, i % 5 - 2);
+        map[id] = i;
+        reference[id] = i;
+    }
+    REQUIRE(map.size() == reference.size());
+
+    // Erase every other tile while iterating
+    int n = 0;
+    for (auto it = map.begin(); it != map.end();) {
+        if (n++ % 2) {
+            reference.erase(it->first);
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    REQUIRE(map.size() == reference.size());
+
+    // Reuse the erased slots
+    for (int i = 0; i < 100; i++) {
+        TileID id(i, i, 14);
+        REQUIRE(map.emplace(id, i).second);
+        REQUIRE_FALSE(map.emplace(id, -1).second);
+        reference[id] = i;
+    }
+    REQUIRE(map.size() == reference.size());
+
+    for (auto& entry : reference) {
+        auto it = map.find(entry.first);
+        REQUIRE(it != map.end());
+        REQUIRE(it->second == entry.second);
+    }
+    size_t count = 0;
+    for (auto& entry : map) { count += reference.count(entry.first); }
+    REQUIRE(count == reference.size());
+
+    REQUIRE(map.erase(TileID(0, 0, 14)) == 1);
+    REQUIRE(map.erase(TileID(0, 0, 14)) == 0);
+    REQUIRE(map.find(TileID(0, 0, 14)) == map.end());
+    REQUIRE(map.count(TileID(1, 1, 14)) == 1);
+
+    map.clear();
+    REQUIRE(map.size() == 0);
+    REQUIRE(map.begin() == map.end());
+    REQUIRE(map.find(TileID(1, 1, 14)) == map.end());
+}
@@ -1,14 +1,17 @@
 #include "catch.hpp"
 
+#include "data/tileData.h"
 #include "data/tileSource.h"
 #include "mockPlatform.h"
 #include "tile/tileManager.h"
+#include "tile/tileTask.h"
 #include "tile/tileWorker.h"
 #include "util/mapProjection.h"
 #include "util/fastmap.h"
 #include "view/view.h"
 
 #include <deque>
+#include <set>
 
 using namespace Tangram;
 
@@ -106,6 +109,66 @@ struct TestTileSource : TileSource {
     }
 };
 
+// Loads binary tile tasks and retains their parsed data
+struct RetainingTileSource : TileSource {
+    int loadCount = 0;
+
+    RetainingTileSource() : TileSource("retaining", nullptr) {
+        m_generateGeometry = true;
+        setRetainTileData(true);
+        setDataKey("https://tiles/{z}/{x}/{y}.mvt");
+    }
+
+    void loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override {
+        if (_task->needsLoading()) {
+            loadCount++;
+            static_cast<BinaryTileTask&>(*_task).rawTileData = ByteBuffer(std::vector<char>{ 'x' });
+            _task->startedLoading();
+        }
+        _cb.func(std::move(_task));
+    }
+
+    void cancelLoadingTile(const TileID& _tile) override {}
+};
+
+// Keeps the tasks waiting for their data until the test delivers it
+struct WaitingTileSource : TileSource {
+    std::vector<std::shared_ptr<TileTask>> loading;
+    std::vector<TileTaskCb> callbacks;
+
+    WaitingTileSource(const std::string& _name) : TileSource(_name, nullptr) {
+        m_generateGeometry = true;
+    }
+
+    void loadTileData(std::shared_ptr<TileTask> _task, TileTaskCb _cb) override {
+        if (!_task->needsLoading()) { return; }
+        _task->startedLoading();
+        loading.push_back(std::move(_task));
+        callbacks.push_back(_cb);
+    }
+
+    void deliver() {
+        for (size_t i = 0; i < loading.size(); i++) {
+            auto& task = static_cast<TestTileSource::Task&>(*loading[i]);
+            if (task.gotData) { continue; }
+            task.gotData = true;
+            callbacks[i].func(loading[i]);
+        }
+    }
+
+    void cancelLoadingTile(const TileID& _tile) override {}
+    void clearData() override {}
+
+    std::shared_ptr<TileData> parse(const TileTask& _task,
+                                    const MapProjection& _projection) const override {
+        return nullptr;
+    }
+
+    std::shared_ptr<TileTask> createTask(TileID _tileId, int _subTask) override {
+        return std::make_shared<TestTileSource::Task>(_tileId, shared_from_this(), _subTask);
+    }
+};
+
 class TestTileManager : public TileManager {
 public:
     using Base = TileManager;
@@ -117,11 +180,11 @@ public:
         m_tilesInProgress = 0;
         m_tileSetChanged = false;
 
-        TileSet& tileSet = m_tileSets[0];
-
-        tileSet.visibleTiles = _visibleTiles;
+        for (auto& tileSet : m_tileSets) {
+            tileSet.visibleTiles.assign(_visibleTiles.begin(), _visibleTiles.end());
 
-        TileManager::updateTileSet(tileSet, _view);
+            TileManager::updateTileSet(tileSet, _view);
+        }
 
         loadTiles();
 
@@ -217,6 +280,48 @@ TEST_CASE( "Load visible Tile", "[TileManager][updateTileSets]" ) {
 
 }
 
+TEST_CASE( "Share loaded Tile with other wraps", "[TileManager][updateTileSets]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+
+    auto source = std::make_shared<TestTileSource>();
+    std::vector<std::shared_ptr<TileSource>> sources = { source };
+    tileManager.setTileSources(sources);
+
+    std::set<TileID> visibleTiles = {TileID{0,0,0}};
+    tileManager.updateTiles(viewState, visibleTiles);
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+
+    // The copy in the next world is shown without building it again
+    std::set<TileID> visibleTiles2 = {TileID{0,0,0,0,0}, TileID{0,0,0,0,1}};
+    tileManager.updateTiles(viewState, visibleTiles2);
+
+    auto& tiles = tileManager.getVisibleTiles();
+    REQUIRE(tiles.size() == 2);
+    REQUIRE(tiles[0]->getID() == TileID(0,0,0,0,0));
+    REQUIRE(tiles[1]->getID() == TileID(0,0,0,0,1));
+    REQUIRE(tiles[1]->isWrapCopy());
+    REQUIRE(source->tileTaskCount == 1);
+    REQUIRE(worker.processedCount == 1);
+
+    // Tiles of other wraps are taken from the cache
+    std::set<TileID> visibleTiles3 = {TileID{0,0,1,1,0}};
+    tileManager.updateTiles(viewState, visibleTiles3);
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles3);
+
+    std::set<TileID> visibleTiles4 = {TileID{0,0,0,0,-1}};
+    tileManager.updateTiles(viewState, visibleTiles4);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0]->getID() == TileID(0,0,0,0,-1));
+    REQUIRE(source->tileTaskCount == 2);
+    REQUIRE(worker.processedCount == 2);
+}
+
 
 TEST_CASE( "Use proxy Tile", "[TileManager][updateTileSets]" ) {
     TestTileWorker worker;
@@ -256,6 +361,85 @@ TEST_CASE( "Use proxy Tile", "[TileManager][updateTileSets]" ) {
 }
 
 
+TEST_CASE( "Show partial Tile of a progressive build instead of proxy", "[TileManager][updateTileSets]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+
+    auto source = std::make_shared<TestTileSource>();
+    std::vector<std::shared_ptr<TileSource>> sources = { source };
+    tileManager.setTileSources(sources);
+
+    std::set<TileID> visibleTiles = {TileID{0,0,0}};
+    tileManager.updateTiles(viewState, visibleTiles);
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    std::set<TileID> visibleTiles2 = {TileID{0,0,1}};
+    tileManager.updateTiles(viewState, visibleTiles2);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0]->isProxy() == true);
+
+    // The worker passes on the first stage of the tile
+    REQUIRE(worker.tasks.size() == 1);
+    auto task = worker.tasks.front();
+    auto partial = std::make_unique<Tile>(task->tileId(), s_projection, &task->source());
+    auto partialTile = partial.get();
+    task->setPartialTile(std::move(partial));
+
+    tileManager.updateTiles(viewState, visibleTiles2);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0].get() == partialTile);
+
+    // Replaced by the complete tile
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles2);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0]->getID() == TileID(0,0,1));
+    REQUIRE(tileManager.getVisibleTiles()[0].get() != partialTile);
+    REQUIRE(worker.processedCount == 2);
+}
+
+TEST_CASE( "Hold proxy Tile until all visible tiles are ready", "[TileManager][updateTileSets]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+    tileManager.setHoldProxies(true);
+
+    auto source = std::make_shared<TestTileSource>();
+    std::vector<std::shared_ptr<TileSource>> sources = { source };
+    tileManager.setTileSources(sources);
+
+    std::set<TileID> visibleTiles = {TileID{0,0,0}};
+    tileManager.updateTiles(viewState, visibleTiles);
+    worker.processTask();
+
+    /// Zoom in, 0/0/0 is the proxy of both children
+    std::set<TileID> visibleTiles2 = {TileID{0,0,1}, TileID{1,0,1}};
+    tileManager.updateTiles(viewState, visibleTiles2);
+    worker.processTask();
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0]->getID() == TileID(0,0,0));
+
+    /// The first child is ready but held back, only the proxy is drawn
+    tileManager.updateTiles(viewState, visibleTiles2);
+    worker.processTask();
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0]->getID() == TileID(0,0,0));
+    REQUIRE(tileManager.getVisibleTiles()[0]->isProxy() == true);
+
+    /// Both children replace the proxy at once
+    tileManager.updateTiles(viewState, visibleTiles2);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 2);
+    REQUIRE(tileManager.getVisibleTiles()[0]->isProxy() == false);
+    REQUIRE(tileManager.getVisibleTiles()[1]->isProxy() == false);
+    REQUIRE(source->tileTaskCount == 3);
+}
+
 TEST_CASE( "Use proxy Tile - circular proxies", "[TileManager][updateTileSets]" ) {
     TestTileWorker worker;
     TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
@@ -302,3 +486,138 @@ TEST_CASE( "Use proxy Tile - circular proxies", "[TileManager][updateTileSets]"
     REQUIRE(tileManager.getVisibleTiles()[0]->getID() == TileID(0,0,0));
 
 }
+
+TEST_CASE( "Rebuild tiles from retained data after a scene update", "[TileManager][setTileSources]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+
+    auto source = std::make_shared<RetainingTileSource>();
+    tileManager.setTileSources({ source });
+
+    std::set<TileID> visibleTiles = {TileID{0,0,0}};
+    tileManager.updateTiles(viewState, visibleTiles);
+    REQUIRE(source->loadCount == 1);
+
+    // Mimic BinaryTileTask::process of a source that retains its data
+    auto tileData = std::make_shared<const TileData>();
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles);
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    tileManager.getVisibleTiles()[0]->setTileData(tileData);
+
+    // The equivalent source of a new scene takes over the data without loading it
+    auto newSource = std::make_shared<RetainingTileSource>();
+    tileManager.setTileSources({ newSource });
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(newSource->loadCount == 0);
+    REQUIRE(worker.tasks.size() == 1);
+    auto& rebuilt = static_cast<BinaryTileTask&>(*worker.tasks.front());
+    REQUIRE(rebuilt.parsedTileData == tileData);
+
+    // Sources for other data load their tiles
+    auto otherSource = std::make_shared<RetainingTileSource>();
+    otherSource->setDataKey("https://other/{z}/{x}/{y}.mvt");
+    worker.tasks.clear();
+    tileManager.setTileSources({ otherSource });
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(otherSource->loadCount == 1);
+}
+
+TEST_CASE( "Rebuild labels of shown tiles from retained data", "[TileManager][rebuildLabels]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+
+    auto source = std::make_shared<RetainingTileSource>();
+    tileManager.setTileSources({ source });
+
+    std::set<TileID> visibleTiles = {TileID{0,0,0}};
+    tileManager.updateTiles(viewState, visibleTiles);
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles);
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+
+    auto tile = tileManager.getVisibleTiles()[0];
+    auto tileData = std::make_shared<const TileData>();
+    tile->setTileData(tileData);
+
+    tileManager.rebuildLabels();
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    // The tile stays shown while its labels are rebuilt from its data
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0] == tile);
+    REQUIRE(source->loadCount == 1);
+    REQUIRE(worker.tasks.size() == 1);
+
+    auto& rebuilt = static_cast<BinaryTileTask&>(*worker.tasks.front());
+    REQUIRE(rebuilt.rebuildsLabels());
+    REQUIRE(rebuilt.parsedTileData == tileData);
+    REQUIRE(rebuilt.subTasks().empty());
+
+    worker.processTask();
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(tileManager.getVisibleTiles().size() == 1);
+    REQUIRE(tileManager.getVisibleTiles()[0] != tile);
+    REQUIRE(worker.tasks.empty());
+}
+
+static std::set<TileID> tileRows(int _z, int _rows) {
+    std::set<TileID> tiles;
+    int size = 1 << _z;
+    for (int y = size / 2 - _rows / 2; y < size / 2 + _rows / 2; y++) {
+        for (int x = 0; x < size; x++) { tiles.insert(TileID(x, y, _z)); }
+    }
+    return tiles;
+}
+
+TEST_CASE( "Limit the loading tiles of each source and of all sources", "[TileManager][loadTiles]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+    tileManager.setLoadLimits(5, 3);
+
+    auto a = std::make_shared<WaitingTileSource>("a");
+    auto b = std::make_shared<WaitingTileSource>("b");
+    tileManager.setTileSources({ a, b });
+
+    auto visibleTiles = tileRows(3, 2);
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(a->loading.size() == 3);
+    REQUIRE(b->loading.size() == 2);
+
+    // The nearest tiles to the center of the view load first
+    for (auto& task : a->loading) {
+        REQUIRE((task->tileId().x == 3 || task->tileId().x == 4));
+    }
+
+    // Tiles which got their data leave room for others
+    a->deliver();
+    tileManager.updateTiles(viewState, visibleTiles);
+
+    REQUIRE(a->loading.size() == 6);
+    REQUIRE(b->loading.size() == 2);
+
+    // Nothing more while all slots are taken
+    tileManager.updateTiles(viewState, visibleTiles);
+    REQUIRE(a->loading.size() == 6);
+    REQUIRE(b->loading.size() == 2);
+}
+
+TEST_CASE( "Share the tile loads of sources by their weights", "[TileManager][loadTiles]" ) {
+    TestTileWorker worker;
+    TestTileManager tileManager(std::make_shared<MockPlatform>(), worker);
+    tileManager.setLoadLimits(6, 0);
+
+    auto a = std::make_shared<WaitingTileSource>("a");
+    auto b = std::make_shared<WaitingTileSource>("b");
+    b->setLoadWeight(2.f);
+    tileManager.setTileSources({ a, b });
+
+    tileManager.updateTiles(viewState, tileRows(3, 2));
+
+    REQUIRE(a->loading.size() == 2);
+    REQUIRE(b->loading.size() == 4);
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include "data/formats/topoJson.h"
+#include "util/mapProjection.h"
+
+#include <string>
+
+using namespace Tangram;
+
+// Two squares sharing the border of arc 0, the second uses it reversed
+static const std::string s_topology = R"({
+    "type": "Topology",
+    "transform": { "scale": [1, 1], "translate": [0, 0] },
+    "objects": {
+        "regions": {
+            "type": "GeometryCollection",
+            "geometries": [
+                { "type": "Polygon", "arcs": [[0, 1]], "properties": { "name": "a", "rank": 2 } },
+                { "type": "Polygon", "arcs": [[-1, 2]], "properties": { "rank": 1, "name": "b" } },
+                { "type": "LineString", "arcs": [0] },
+                { "type": "Point", "coordinates": [3, 4] }
+            ]
+        }
+    },
+    "arcs": [
+        [[1, 0], [0, 1]],
+        [[1, 1], [-1, 0], [0, -1], [1, 0]],
+        [[1, 0], [1, 0], [0, 1], [-1, 0]]
+    ]
+})";
+
+TEST_CASE("TopoJSON arcs are decoded once and stitched into features", "[TopoJson]") {
+
+    const char* error;
+    size_t offset;
+    auto document = JsonParseBytes(s_topology.data(), s_topology.size(), &error, &offset);
+    REQUIRE(error == nullptr);
+
+    auto topology = TopoJson::getTopology(document, [](const glm::dvec2* _lonLat, Point* _out, size_t _count) {
+        for (size_t i = 0; i < _count; i++) { _out[i] = Point(_lonLat[i]); }
+    });
+    REQUIRE(topology.arcs.size() == 3);
+    REQUIRE(topology.points.size() == 10);
+    REQUIRE(topology.points[topology.arcs[1].begin] == Point(1, 1));
+
+    ColumnarLayer layer("regions", 7);
+    TopoJson::getLayer(document["objects"]["regions"], topology, layer);
+    REQUIRE(layer.features.size() == 4);
+    REQUIRE(layer.keys.size() == 2);
+
+    Feature feature;
+    layer.getFeature(0, feature);
+    REQUIRE(feature.geometryType == GeometryType::polygons);
+    REQUIRE(feature.polygons.size() == 1);
+    Line ring0 = { {1, 0}, {1, 1}, {0, 1}, {0, 0}, {1, 0} };
+    REQUIRE(feature.polygons[0][0] == ring0);
+    REQUIRE(feature.props.getString("name") == "a");
+    REQUIRE(feature.props.getNumber("rank") == 2);
+    REQUIRE(feature.props.sourceId == 7);
+
+    layer.getFeature(1, feature);
+    Line ring1 = { {1, 1}, {1, 0}, {2, 0}, {2, 1}, {1, 1} };
+    REQUIRE(feature.polygons[0][0] == ring1);
+    REQUIRE(feature.props.getString("name") == "b");
+
+    layer.getFeature(2, feature);
+    REQUIRE(feature.geometryType == GeometryType::lines);
+    REQUIRE(feature.lines[0] == Line({ {1, 0}, {1, 1} }));
+
+    layer.getFeature(3, feature);
+    REQUIRE(feature.geometryType == GeometryType::points);
+    REQUIRE(feature.points[0] == Point(3, 4));
+}
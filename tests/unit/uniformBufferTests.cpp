@@ -0,0 +1,82 @@
+#include "catch.hpp"
+
+#include "gl/shaderSource.h"
+#include "gl/uniformBuffer.h"
+
+#include <string>
+
+using namespace Tangram;
+
+TEST_CASE("UniformBuffer stores values at their std140 offsets", "[UniformBuffer]") {
+
+    UniformBuffer buffer(UniformBuffer::FRAME_BINDING);
+
+    buffer.add(1.f);
+    // vec3 starts at the next vec4, a float fills its fourth component
+    buffer.add(glm::vec3(2.f));
+    buffer.add(3.f);
+    REQUIRE(buffer.data().size() == 8);
+    REQUIRE(buffer.data()[4] == 2.f);
+    REQUIRE(buffer.data()[7] == 3.f);
+
+    // vec2 is aligned to two floats
+    buffer.add(4.f);
+    buffer.add(glm::vec2(5.f));
+    REQUIRE(buffer.data().size() == 12);
+    REQUIRE(buffer.data()[10] == 5.f);
+
+    // mat3 columns are padded like vec4
+    buffer.add(glm::mat3(6.f));
+    REQUIRE(buffer.data().size() == 24);
+    REQUIRE(buffer.data()[12] == 6.f);
+    REQUIRE(buffer.data()[17] == 6.f);
+    REQUIRE(buffer.data()[15] == 0.f);
+
+    // Structs start and end at a vec4
+    buffer.add(7.f);
+    buffer.alignStruct();
+    REQUIRE(buffer.data().size() == 28);
+
+    buffer.clear();
+    REQUIRE(buffer.data().empty());
+}
+
+TEST_CASE("ShaderSource translates sources with uniform blocks to GLSL ES 3.00", "[UniformBuffer]") {
+
+    std::string frag =
+        "#ifdef GL_ES\n"
+        "precision highp float;\n"
+        "#endif\n"
+        "#extension GL_OES_standard_derivatives : enable\n"
+        "// comment\n"
+        "#ifdef TANGRAM_UNIFORM_BUFFERS\n"
+        "layout(std140) uniform TangramFrame { float u_time; };\n"
+        "#endif\n"
+        "varying vec4 v_color;\n"
+        "uniform sampler2D u_tex;\n"
+        "void main() { gl_FragColor = texture2D(u_tex, v_color.xy); }\n";
+
+    REQUIRE(ShaderSource::hasUniformBlocks(frag));
+    REQUIRE(!ShaderSource::hasUniformBlocks("varying vec4 v_color;\n"));
+
+    std::string out = ShaderSource::uniformBufferSource(frag, true);
+
+    REQUIRE(out.find("#version 300 es\n") == 0);
+    REQUIRE(out.find("#define TANGRAM_UNIFORM_BUFFERS\n") != std::string::npos);
+    REQUIRE(out.find("#define varying in\n") != std::string::npos);
+    REQUIRE(out.find("#define gl_FragColor tangram_FragColor\n") != std::string::npos);
+    REQUIRE(out.find("#define texture2D texture\n") != std::string::npos);
+
+    // The output is declared after the precision and extension directives
+    size_t decl = out.find("out highp vec4 tangram_FragColor;");
+    REQUIRE(decl != std::string::npos);
+    REQUIRE(decl > out.find("precision highp float;"));
+    REQUIRE(decl > out.find("#extension"));
+    REQUIRE(decl < out.find("varying vec4 v_color;"));
+
+    std::string vert = "attribute vec4 a_position;\nvarying vec4 v_color;\n";
+    out = ShaderSource::uniformBufferSource(vert, false);
+    REQUIRE(out.find("#define attribute in\n") != std::string::npos);
+    REQUIRE(out.find("#define varying out\n") != std::string::npos);
+    REQUIRE(out.find("tangram_FragColor") == std::string::npos);
+}
@@ -2,6 +2,7 @@
 
 #include "data/tileData.h"
 #include "mockPlatform.h"
+#include "scene/filterProgram.h"
 #include "scene/filters.h"
 #include "scene/scene.h"
 #include "scene/sceneLoader.h"
@@ -249,3 +250,34 @@ TEST_CASE("Sequences in filters implicitly create an 'any' filter", "[filters][c
     REQUIRE(filter.eval(bmw1, ctx));
     REQUIRE(!filter.eval(bike, ctx));
 }
+
+TEST_CASE("Compiled filter programs match filter evaluation", "[filters][core][yaml]") {
+    init();
+    std::vector<std::string> filters = {
+        "filter: { series: !!str 3}",
+        "filter: { name : [civic, bmw320i] }",
+        "filter: {wheel : {min : 2, max : 5}}",
+        "filter: {any : [{name : civic}, {name : bmw320i}]}",
+        "filter: {all : [ {name : civic}, {brand : honda}, {wheel: 4} ] }",
+        "filter: {none : [{name : civic}, {name : bmw320i}]}",
+        "filter: {all : [ {any: [{drive : fwd}, {check: true}]}, {none: [{type: bike}]} ] }",
+        "filter: { drive : true }",
+        "filter: { drive : false}",
+        "filter: { serial : [4398046511104] }",
+        "filter: { any : [] }",
+        "filter: { all : [] }",
+    };
+
+    for (auto& yaml : filters) {
+        Filter filter = load(yaml);
+        FilterProgram program(filter);
+
+        for (auto* feature : { &civic, &bmw1, &bike }) {
+            ctx.setFeature(*feature);
+
+            // Second evaluation uses cached property lookups
+            REQUIRE(program.eval(*feature, ctx) == filter.eval(*feature, ctx));
+            REQUIRE(program.eval(*feature, ctx) == filter.eval(*feature, ctx));
+        }
+    }
+}
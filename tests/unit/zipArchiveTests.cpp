@@ -0,0 +1,75 @@
+#include "catch.hpp"
+
+#include "util/zipArchive.h"
+
+#include <string>
+#include <vector>
+
+using namespace Tangram;
+
+// Archive of a stored and a compressed entry
+static std::vector<char> testArchive(const std::string& _stored, const std::string& _compressed) {
+    mz_zip_archive zip;
+    mz_zip_zero_struct(&zip);
+    REQUIRE(mz_zip_writer_init_heap(&zip, 0, 0));
+    REQUIRE(mz_zip_writer_add_mem(&zip, "fonts/stored.ttf", _stored.data(), _stored.size(), MZ_NO_COMPRESSION));
+    REQUIRE(mz_zip_writer_add_mem(&zip, "scene.yaml", _compressed.data(), _compressed.size(), MZ_BEST_COMPRESSION));
+
+    void* data = nullptr;
+    size_t size = 0;
+    REQUIRE(mz_zip_writer_finalize_heap_archive(&zip, &data, &size));
+    std::vector<char> archive(static_cast<char*>(data), static_cast<char*>(data) + size);
+    mz_free(data);
+    mz_zip_writer_end(&zip);
+    return archive;
+}
+
+TEST_CASE("ZipArchive reads stored entries in place", "[ZipArchive]") {
+
+    std::string stored(1000, 's');
+    std::string compressed(5000, 'c');
+    auto data = ByteBuffer(testArchive(stored, compressed));
+
+    ZipArchive archive;
+    REQUIRE(archive.loadFromBuffer(data));
+    REQUIRE(archive.entries().size() == 2);
+
+    auto storedEntry = archive.findEntry("fonts/stored.ttf");
+    REQUIRE(storedEntry);
+    REQUIRE(storedEntry->stored);
+
+    auto storedData = archive.entryBuffer(storedEntry);
+    REQUIRE(std::string(storedData.begin(), storedData.end()) == stored);
+    // Shares the archive data
+    REQUIRE(storedData.begin() >= data.begin());
+    REQUIRE(storedData.end() <= data.end());
+
+    auto compressedEntry = archive.findEntry("scene.yaml");
+    REQUIRE(compressedEntry);
+    REQUIRE_FALSE(compressedEntry->stored);
+
+    auto compressedData = archive.entryBuffer(compressedEntry);
+    REQUIRE(std::string(compressedData.begin(), compressedData.end()) == compressed);
+
+    std::string copy(stored.size(), 0);
+    REQUIRE(archive.decompressEntry(storedEntry, &copy[0]));
+    REQUIRE(copy == stored);
+
+    REQUIRE(archive.entryBuffer(nullptr).empty());
+}
+
+TEST_CASE("ZipArchive entries are the same after decompressAll", "[ZipArchive]") {
+
+    std::string stored = "stored entry";
+    std::string compressed(300, 'x');
+
+    ZipArchive archive;
+    REQUIRE(archive.loadFromMemory(testArchive(stored, compressed)));
+    REQUIRE(archive.decompressAll());
+
+    auto storedData = archive.entryBuffer(archive.findEntry("fonts/stored.ttf"));
+    REQUIRE(std::string(storedData.begin(), storedData.end()) == stored);
+
+    auto compressedData = archive.entryBuffer(archive.findEntry("scene.yaml"));
+    REQUIRE(std::string(compressedData.begin(), compressedData.end()) == compressed);
+}